@@ -0,0 +1,65 @@
+#!/usr/bin/env python
+# Compares the single window and the parallel prefix scan lowerings of
+# torch.cumsum() across sequence lengths. Each lowering runs within its own
+# process, as the XLA_CUMULATIVE_SCAN_MIN_SIZE setting is read once.
+
+from __future__ import print_function
+
+import argparse
+import os
+import subprocess
+import sys
+import time
+
+
+def run_worker(args):
+  import torch
+  import torch_xla
+  import torch_xla_py.xla_model as xm
+
+  device = xm.xla_device()
+  x = torch.randn(args.batch, args.size).to(device)
+  for i in range(0, args.test_count + 1):
+    if i == 1:
+      # Do not account the compilation of the first run.
+      start = time.time()
+    result = torch.cumsum(x, dim=1)
+    torch_xla._XLAC._xla_sync_multi([result], [str(result.device)])
+    result.cpu()
+  return 1000.0 * (time.time() - start) / args.test_count
+
+
+def run_lowering(args, size, min_size):
+  env = dict(os.environ)
+  env['XLA_CUMULATIVE_SCAN_MIN_SIZE'] = str(min_size)
+  cmd = [
+      sys.executable, __file__, '--worker', '--size',
+      str(size), '--batch',
+      str(args.batch), '--test_count',
+      str(args.test_count)
+  ]
+  output = subprocess.check_output(cmd, env=env)
+  return float(output.decode().strip().splitlines()[-1])
+
+
+def run_benchmark(args):
+  print('{:>10} {:>14} {:>14}'.format('N', 'window (ms)', 'scan (ms)'))
+  for size in [int(x) for x in args.sizes.split(',')]:
+    window_ms = run_lowering(args, size, min_size=size + 1)
+    scan_ms = run_lowering(args, size, min_size=0)
+    print('{:>10} {:>14.3f} {:>14.3f}'.format(size, window_ms, scan_ms))
+
+
+if __name__ == '__main__':
+  arg_parser = argparse.ArgumentParser()
+  arg_parser.add_argument(
+      '--sizes', type=str, default='16,64,256,1024,4096,16384')
+  arg_parser.add_argument('--batch', type=int, default=8)
+  arg_parser.add_argument('--test_count', type=int, default=20)
+  arg_parser.add_argument('--worker', action='store_true')
+  arg_parser.add_argument('--size', type=int, default=None)
+  args, pos_args = arg_parser.parse_known_args()
+  if args.worker:
+    print(run_worker(args))
+  else:
+    run_benchmark(args)
@@ -0,0 +1,82 @@
+#!/usr/bin/env python
+# Compares the unrolled small matrix lowerings of torch.cholesky(),
+# torch.triangular_solve() and torch.qr() with the generic XLA ones, across
+# (batch, size) shapes. Each lowering runs within its own process, as the
+# XLA_LINALG_UNROLL_MAX_SIZE setting is read once.
+
+from __future__ import print_function
+
+import argparse
+import os
+import subprocess
+import sys
+import time
+
+
+def run_worker(args):
+  import torch
+  import torch_xla
+  import torch_xla_py.xla_model as xm
+
+  device = xm.xla_device()
+  a = torch.randn(args.batch, args.size, args.size)
+  a = (torch.matmul(a, a.transpose(1, 2)) +
+       args.size * torch.eye(args.size)).to(device)
+  b = torch.randn(args.batch, args.size, 4).to(device)
+  for i in range(0, args.test_count + 1):
+    if i == 1:
+      # Do not account the compilation of the first run.
+      start = time.time()
+    if args.op == 'cholesky':
+      results = [torch.cholesky(a)]
+    elif args.op == 'triangular_solve':
+      results = [torch.triangular_solve(b, a, upper=False)[0]]
+    else:
+      results = list(torch.qr(a))
+    torch_xla._XLAC._xla_sync_multi(results,
+                                    [str(r.device) for r in results])
+    results[0].cpu()
+  return 1000.0 * (time.time() - start) / args.test_count
+
+
+def run_lowering(args, op, batch, size, max_size):
+  env = dict(os.environ)
+  env['XLA_LINALG_UNROLL_MAX_SIZE'] = str(max_size)
+  cmd = [
+      sys.executable, __file__, '--worker', '--op', op, '--batch',
+      str(batch), '--size',
+      str(size), '--test_count',
+      str(args.test_count)
+  ]
+  output = subprocess.check_output(cmd, env=env)
+  return float(output.decode().strip().splitlines()[-1])
+
+
+def run_benchmark(args):
+  print('{:>18} {:>8} {:>6} {:>15} {:>15}'.format('op', 'batch', 'size',
+                                                  'unrolled (ms)', 'xla (ms)'))
+  for op in args.ops.split(','):
+    for batch in [int(x) for x in args.batches.split(',')]:
+      for size in [int(x) for x in args.sizes.split(',')]:
+        unrolled_ms = run_lowering(args, op, batch, size, max_size=size)
+        xla_ms = run_lowering(args, op, batch, size, max_size=0)
+        print('{:>18} {:>8} {:>6} {:>15.3f} {:>15.3f}'.format(
+            op, batch, size, unrolled_ms, xla_ms))
+
+
+if __name__ == '__main__':
+  arg_parser = argparse.ArgumentParser()
+  arg_parser.add_argument(
+      '--ops', type=str, default='cholesky,triangular_solve,qr')
+  arg_parser.add_argument('--batches', type=str, default='1,64,1024,4096')
+  arg_parser.add_argument('--sizes', type=str, default='4,8,16,32,64')
+  arg_parser.add_argument('--test_count', type=int, default=20)
+  arg_parser.add_argument('--worker', action='store_true')
+  arg_parser.add_argument('--op', type=str, default=None)
+  arg_parser.add_argument('--batch', type=int, default=None)
+  arg_parser.add_argument('--size', type=int, default=None)
+  args, pos_args = arg_parser.parse_known_args()
+  if args.worker:
+    print(run_worker(args))
+  else:
+    run_benchmark(args)
@@ -0,0 +1,74 @@
+#!/usr/bin/env python
+# Compares the selection based and the sort based lowerings of torch.topk()
+# across (N, k) sizes. Each lowering runs within its own process, as the
+# XLA_TOPK_SELECTION_MAX_K setting is read once.
+
+from __future__ import print_function
+
+import argparse
+import os
+import subprocess
+import sys
+import time
+
+
+def run_worker(args):
+  import torch
+  import torch_xla
+  import torch_xla_py.xla_model as xm
+
+  device = xm.xla_device()
+  x = torch.randn(args.batch, args.size).to(device)
+  for i in range(0, args.test_count + 1):
+    if i == 1:
+      # Do not account the compilation of the first run.
+      start = time.time()
+    values, indices = torch.topk(x, args.k, dim=1)
+    torch_xla._XLAC._xla_sync_multi([values, indices],
+                                    [str(values.device), str(indices.device)])
+    values.cpu()
+  return 1000.0 * (time.time() - start) / args.test_count
+
+
+def run_lowering(args, size, k, max_k):
+  env = dict(os.environ)
+  env['XLA_TOPK_SELECTION_MAX_K'] = str(max_k)
+  env['XLA_TOPK_SELECTION_MIN_SIZE'] = '0'
+  cmd = [
+      sys.executable, __file__, '--worker', '--size',
+      str(size), '--k',
+      str(k), '--batch',
+      str(args.batch), '--test_count',
+      str(args.test_count)
+  ]
+  output = subprocess.check_output(cmd, env=env)
+  return float(output.decode().strip().splitlines()[-1])
+
+
+def run_benchmark(args):
+  print('{:>10} {:>6} {:>14} {:>14}'.format('N', 'k', 'select (ms)',
+                                            'sort (ms)'))
+  for size in [int(x) for x in args.sizes.split(',')]:
+    for k in [int(x) for x in args.ks.split(',')]:
+      if k > size:
+        continue
+      select_ms = run_lowering(args, size, k, max_k=k)
+      sort_ms = run_lowering(args, size, k, max_k=0)
+      print('{:>10} {:>6} {:>14.3f} {:>14.3f}'.format(size, k, select_ms,
+                                                      sort_ms))
+
+
+if __name__ == '__main__':
+  arg_parser = argparse.ArgumentParser()
+  arg_parser.add_argument('--sizes', type=str, default='1024,16384,131072')
+  arg_parser.add_argument('--ks', type=str, default='1,4,16,32,64')
+  arg_parser.add_argument('--batch', type=int, default=8)
+  arg_parser.add_argument('--test_count', type=int, default=20)
+  arg_parser.add_argument('--worker', action='store_true')
+  arg_parser.add_argument('--size', type=int, default=None)
+  arg_parser.add_argument('--k', type=int, default=None)
+  args, pos_args = arg_parser.parse_known_args()
+  if args.worker:
+    print(run_worker(args))
+  else:
+    run_benchmark(args)
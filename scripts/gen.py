@@ -212,6 +212,7 @@ _CPP_HEADER = """// Autogenerated file by {gen}. Do not edit directly!
 #include "tensorflow/compiler/xla/xla_client/tf_logging.h"
 #include "torch_xla/csrc/aten_xla_bridge.h"
 #include "torch_xla/csrc/aten_xla_type.h"
+#include "torch_xla/csrc/fallback_profiler.h"
 
 namespace torch_xla {{
 
@@ -808,6 +809,7 @@ def generate_aten_to_xla(ctx, tree, rwxtree, fname, sig, rwsig, params, fnopts):
 
   code = '{} {{\n'.format(sig)
   code += generate_entry_debug_code(tree, fname, params)
+  code += '  FallbackScope fallback_scope("{}");\n'.format(fname)
   xla_ref_param = param_name(ref_param) if ref_param else None
   tfetcher = TensorFetcher('xlatens')
   param_vars = []
@@ -0,0 +1,342 @@
+# Parse local options first, and rewrite the sys.argv[].
+# This allows to pickup the local/development XLA modules before the installed ones.
+import os
+import sys
+
+# Setup import folders.
+_XLA_FOLDER = os.path.dirname(os.path.dirname(os.path.abspath(sys.argv[0])))
+sys.path.append(os.path.join(os.path.dirname(_XLA_FOLDER), 'test'))
+sys.path.insert(0, _XLA_FOLDER)
+
+# Normal imports section starts here.
+import argparse
+import collections
+import json
+import time
+import torch
+import torch.nn as nn
+import torch.nn.functional as F
+import torch.optim as optim
+import torch_xla
+import torch_xla_py.utils as xu
+import torch_xla_py.xla_model as xm
+
+# Runs representative models for a number of steps, and breaks the time of every
+# step down into its host side phases, using the trace events recorded by the
+# XLA tracing. The steady state throughput and latency percentiles are computed
+# over the steps following the warmup ones.
+#
+# Example:
+#   python test/bench_models.py --models mnist,resnet50 --steps 50 \
+#     --json_out /tmp/bench.json
+
+# The trace events (by name) accounted to each phase. The trace phase is the
+# Python time spent recording the step operations, so it is measured directly.
+_PHASE_EVENTS = collections.OrderedDict([
+    ('collect', ['CollectSyncTensors']),
+    ('compile', ['LowerSyncTensorsGraph', 'CompileTime']),
+    ('upload', ['TransferToServerTime']),
+    ('execute', [
+        'ExecuteTime', 'ExecuteReplicatedTime', 'ExecuteParallelTime',
+        'ExecuteChainedTime'
+    ]),
+    ('download', ['TransferFromServerTime']),
+])
+
+
+class MNIST(nn.Module):
+
+  def __init__(self):
+    super(MNIST, self).__init__()
+    self.conv1 = nn.Conv2d(1, 10, kernel_size=5)
+    self.bn1 = nn.BatchNorm2d(10)
+    self.conv2 = nn.Conv2d(10, 20, kernel_size=5)
+    self.bn2 = nn.BatchNorm2d(20)
+    self.fc1 = nn.Linear(320, 50)
+    self.fc2 = nn.Linear(50, 10)
+
+  def forward(self, x):
+    x = F.relu(F.max_pool2d(self.conv1(x), 2))
+    x = self.bn1(x)
+    x = F.relu(F.max_pool2d(self.conv2(x), 2))
+    x = self.bn2(x)
+    x = torch.flatten(x, 1)
+    x = F.relu(self.fc1(x))
+    x = self.fc2(x)
+    return F.log_softmax(x, dim=1)
+
+
+class ResNetStem(nn.Module):
+  """The stem of the ResNet models, whose max pooling runs over the largest
+  activations of the network. Running it with XLA_MAX_POOL_BACKWARD set to
+  `indices` and `select_and_scatter` compares the max pooling gradients.
+  """
+
+  def __init__(self, num_classes=1000):
+    super(ResNetStem, self).__init__()
+    self.conv = nn.Conv2d(3, 64, kernel_size=7, stride=2, padding=3, bias=False)
+    self.bn = nn.BatchNorm2d(64)
+    self.fc = nn.Linear(64, num_classes)
+
+  def forward(self, x):
+    x = F.relu(self.bn(self.conv(x)))
+    x = F.max_pool2d(x, kernel_size=3, stride=2, padding=1)
+    x = torch.flatten(F.adaptive_avg_pool2d(x, 1), 1)
+    return F.log_softmax(self.fc(x), dim=1)
+
+
+class DepthwiseStack(nn.Module):
+  """The depthwise separable blocks of MobileNetV2, at their channel counts and
+  strides, which exercise the depthwise convolutions and their gradients.
+  """
+
+  # The (expanded channels, output channels, stride) of every block.
+  _BLOCKS = [(32, 16, 1), (96, 24, 2), (144, 32, 2), (192, 64, 2),
+             (384, 96, 1), (576, 160, 2), (960, 320, 1)]
+
+  def __init__(self, num_classes=1000):
+    super(DepthwiseStack, self).__init__()
+    layers = [nn.Conv2d(3, 32, kernel_size=3, stride=2, padding=1, bias=False)]
+    channels = 32
+    for expanded, out_channels, stride in self._BLOCKS:
+      layers += [
+          nn.Conv2d(channels, expanded, kernel_size=1, bias=False),
+          nn.BatchNorm2d(expanded),
+          nn.ReLU6(),
+          nn.Conv2d(
+              expanded,
+              expanded,
+              kernel_size=3,
+              stride=stride,
+              padding=1,
+              groups=expanded,
+              bias=False),
+          nn.BatchNorm2d(expanded),
+          nn.ReLU6(),
+          nn.Conv2d(expanded, out_channels, kernel_size=1, bias=False),
+          nn.BatchNorm2d(out_channels),
+      ]
+      channels = out_channels
+    self.features = nn.Sequential(*layers)
+    self.fc = nn.Linear(channels, num_classes)
+
+  def forward(self, x):
+    x = torch.flatten(F.adaptive_avg_pool2d(self.features(x), 1), 1)
+    return F.log_softmax(self.fc(x), dim=1)
+
+
+class FeaturePyramid(nn.Module):
+  """A feature pyramid network, whose top-down path upsamples every level with
+  nearest neighbor interpolation, and whose merged features are upsampled back
+  to the input resolution with bilinear interpolation, like the segmentation
+  heads do.
+  """
+
+  def __init__(self, num_classes=1000, channels=64):
+    super(FeaturePyramid, self).__init__()
+    self.stages = nn.ModuleList()
+    self.laterals = nn.ModuleList()
+    in_channels = 3
+    for out_channels in (32, 64, 128, 256):
+      self.stages.append(
+          nn.Sequential(
+              nn.Conv2d(
+                  in_channels, out_channels, kernel_size=3, stride=2,
+                  padding=1),
+              nn.ReLU()))
+      self.laterals.append(nn.Conv2d(out_channels, channels, kernel_size=1))
+      in_channels = out_channels
+    self.head = nn.Conv2d(channels, channels, kernel_size=3, padding=1)
+    self.fc = nn.Linear(channels, num_classes)
+
+  def forward(self, x):
+    size = x.shape[2:]
+    features = []
+    for stage in self.stages:
+      x = stage(x)
+      features.append(x)
+    top = self.laterals[-1](features[-1])
+    for feature, lateral in zip(features[-2::-1], self.laterals[-2::-1]):
+      top = lateral(feature) + F.interpolate(
+          top, size=feature.shape[2:], mode='nearest')
+    x = F.interpolate(
+        self.head(top), size=size, mode='bilinear', align_corners=False)
+    x = torch.flatten(F.adaptive_avg_pool2d(F.relu(x), 1), 1)
+    return F.log_softmax(self.fc(x), dim=1)
+
+
+class TransformerClassifier(nn.Module):
+
+  def __init__(self, vocab_size=32000, d_model=512, nhead=8, num_layers=6,
+               num_classes=2):
+    super(TransformerClassifier, self).__init__()
+    self.embedding = nn.Embedding(vocab_size, d_model)
+    encoder_layer = nn.TransformerEncoderLayer(d_model, nhead)
+    self.encoder = nn.TransformerEncoder(encoder_layer, num_layers)
+    self.fc = nn.Linear(d_model, num_classes)
+
+  def forward(self, x):
+    # The encoder takes (sequence, batch, features) inputs.
+    x = self.encoder(self.embedding(x).transpose(0, 1))
+    return F.log_softmax(self.fc(x.mean(dim=0)), dim=1)
+
+
+def _create_mnist(batch_size):
+  data = torch.randn(batch_size, 1, 28, 28)
+  target = torch.randint(0, 10, (batch_size,), dtype=torch.int64)
+  return MNIST(), data, target
+
+
+def _create_resnet50(batch_size):
+  import torchvision.models as models
+  data = torch.randn(batch_size, 3, 224, 224)
+  target = torch.randint(0, 1000, (batch_size,), dtype=torch.int64)
+  return models.resnet50(), data, target
+
+
+def _create_resnet_stem(batch_size):
+  data = torch.randn(batch_size, 3, 224, 224)
+  target = torch.randint(0, 1000, (batch_size,), dtype=torch.int64)
+  return ResNetStem(), data, target
+
+
+def _create_depthwise(batch_size):
+  data = torch.randn(batch_size, 3, 224, 224)
+  target = torch.randint(0, 1000, (batch_size,), dtype=torch.int64)
+  return DepthwiseStack(), data, target
+
+
+def _create_feature_pyramid(batch_size):
+  data = torch.randn(batch_size, 3, 224, 224)
+  target = torch.randint(0, 1000, (batch_size,), dtype=torch.int64)
+  return FeaturePyramid(), data, target
+
+
+def _create_transformer(batch_size, seq_len=128):
+  data = torch.randint(0, 32000, (batch_size, seq_len), dtype=torch.int64)
+  target = torch.randint(0, 2, (batch_size,), dtype=torch.int64)
+  return TransformerClassifier(), data, target
+
+
+_MODELS = collections.OrderedDict([
+    ('mnist', (_create_mnist, 128)),
+    ('resnet50', (_create_resnet50, 64)),
+    ('resnet_stem', (_create_resnet_stem, 64)),
+    ('depthwise', (_create_depthwise, 64)),
+    ('feature_pyramid', (_create_feature_pyramid, 32)),
+    ('transformer', (_create_transformer, 32)),
+])
+
+
+def _percentile(sorted_values, pct):
+  if not sorted_values:
+    return 0.0
+  index = min(
+      int(round(pct / 100.0 * (len(sorted_values) - 1))),
+      len(sorted_values) - 1)
+  return sorted_values[index]
+
+
+def _phase_times(trace):
+  durations = collections.defaultdict(float)
+  for event in json.loads(trace)['traceEvents']:
+    # Chrome trace durations are in microseconds.
+    durations[event['name']] += event['dur'] * 1e-6
+  return collections.OrderedDict(
+      (phase, sum(durations[name] for name in names))
+      for phase, names in _PHASE_EVENTS.items())
+
+
+def run_model(name, args):
+  create_fn, default_batch_size = _MODELS[name]
+  batch_size = args.batch_size or default_batch_size
+  torch.manual_seed(42)
+  device = xm.xla_device()
+  model, data, target = create_fn(batch_size)
+  model = model.to(device)
+  data = data.to(device)
+  target = target.to(device)
+  optimizer = optim.SGD(model.parameters(), lr=0.01, momentum=0.9)
+  loss_fn = nn.NLLLoss()
+  model.train()
+
+  steps = []
+  for step in range(args.warmup + args.steps):
+    torch_xla._XLAC._xla_clear_trace()
+    start = time.time()
+    optimizer.zero_grad()
+    loss = loss_fn(model(data), target)
+    loss.backward()
+    xm.optimizer_step(optimizer)
+    trace_time = time.time() - start
+    xm.mark_step()
+    # Fetching the loss waits for the step execution, and accounts for the
+    # download a training loop logging its loss would have.
+    loss.item()
+    step_time = time.time() - start
+    if step >= args.warmup:
+      phases = _phase_times(torch_xla._XLAC._xla_chrome_trace())
+      phases['trace'] = trace_time
+      steps.append({'time': step_time, 'phases': phases})
+
+  step_times = sorted(s['time'] for s in steps)
+  total_time = sum(step_times)
+  result = collections.OrderedDict()
+  result['model'] = name
+  result['batch_size'] = batch_size
+  result['steps'] = len(steps)
+  result['examples_per_sec'] = (
+      batch_size * len(steps) / total_time if total_time > 0 else 0.0)
+  for pct in (50, 90, 99):
+    result['p{}_step_time'.format(pct)] = _percentile(step_times, pct)
+  result['max_step_time'] = step_times[-1] if step_times else 0.0
+  result['mean_phase_times'] = collections.OrderedDict(
+      (phase, sum(s['phases'][phase] for s in steps) / max(len(steps), 1))
+      for phase in ['trace'] + list(_PHASE_EVENTS.keys()))
+  return result
+
+
+def _print_result(result):
+  print('{}: batch_size={} steps={} {:.2f} examples/sec'.format(
+      result['model'], result['batch_size'], result['steps'],
+      result['examples_per_sec']))
+  print(
+      '  Step time: p50={:.3f}ms p90={:.3f}ms p99={:.3f}ms max={:.3f}ms'.format(
+          1000.0 * result['p50_step_time'], 1000.0 * result['p90_step_time'],
+          1000.0 * result['p99_step_time'], 1000.0 * result['max_step_time']))
+  print('  Mean phases: {}'.format(' '.join(
+      '{}={:.3f}ms'.format(phase, 1000.0 * value)
+      for phase, value in result['mean_phase_times'].items())))
+
+
+def run_benchmarks(args):
+  torch_xla._XLAC._xla_set_tracing(True)
+  results = []
+  for name in args.models.split(','):
+    try:
+      result = run_model(name, args)
+    except Exception as e:
+      xu.eprint('Failed running model "{}": {}'.format(name, e))
+      continue
+    _print_result(result)
+    results.append(result)
+  torch_xla._XLAC._xla_set_tracing(False)
+  if args.json_out:
+    with open(args.json_out, 'w') as fd:
+      json.dump(results, fd, indent=2)
+  if args.metrics_debug:
+    print(torch_xla._XLAC._xla_metrics_report())
+
+
+if __name__ == '__main__':
+  parser = argparse.ArgumentParser()
+  parser.add_argument('--models', type=str, default=','.join(_MODELS.keys()))
+  parser.add_argument('--batch_size', type=int, default=None)
+  parser.add_argument('--steps', type=int, default=20)
+  parser.add_argument('--warmup', type=int, default=5)
+  parser.add_argument('--json_out', type=str, default=None)
+  parser.add_argument('--metrics_debug', action='store_true')
+  args = parser.parse_args()
+
+  torch.set_default_tensor_type('torch.FloatTensor')
+  run_benchmarks(args)
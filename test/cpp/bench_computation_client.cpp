@@ -0,0 +1,206 @@
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "tensorflow/compiler/xla/client/xla_builder.h"
+#include "tensorflow/compiler/xla/shape_util.h"
+#include "tensorflow/compiler/xla/xla_client/computation_client.h"
+#include "tensorflow/compiler/xla/xla_client/debug_macros.h"
+
+// Benchmarks of the round trip latency and throughput of the ComputationClient
+// primitives, against the live worker the environment configures (like
+// XRT_WORKERS and XRT_DEVICE_MAP for XRT). The transfers sweep the data sizes,
+// and most benchmarks run from a growing number of threads, to expose the
+// transport layer scaling. Run with --benchmark_format=json to get machine
+// readable results.
+
+namespace xla {
+namespace bench {
+namespace {
+
+ComputationClient* Client() { return ComputationClient::Get(); }
+
+const string& GetDevice() {
+  static string device = Client()->GetDefaultDevice();
+  return device;
+}
+
+// The shape of an F32 array with the given size in bytes.
+Shape ArrayShape(int64 size) {
+  return ShapeUtil::MakeShape(PrimitiveType::F32,
+                              {std::max<int64>(size, 4) / 4});
+}
+
+std::vector<ComputationClient::TensorSource> CreateSources(int64 size,
+                                                           size_t count) {
+  auto populate_fn = [](const ComputationClient::TensorSource& source,
+                        void* dest, size_t dest_size) {
+    std::memset(dest, 0, dest_size);
+  };
+  std::vector<ComputationClient::TensorSource> sources;
+  for (size_t i = 0; i < count; ++i) {
+    sources.emplace_back(ArrayShape(size), GetDevice(), populate_fn);
+  }
+  return sources;
+}
+
+// Builds a computation adding value to its parameter. The result is wrapped in
+// a tuple together with the parameter, if tuple is true.
+XlaComputation BuildAddComputation(const Shape& shape, float value,
+                                   bool tuple) {
+  XlaBuilder builder("BenchAdd");
+  XlaOp param = Parameter(&builder, 0, shape, "p0");
+  XlaOp result = Add(param, ConstantR0<float>(&builder, value));
+  if (tuple) {
+    Tuple(&builder, {result, param});
+  }
+  return ConsumeValue(builder.Build());
+}
+
+ComputationClient::ComputationPtr CompileAddComputation(const Shape& shape,
+                                                        float value,
+                                                        bool tuple) {
+  return Client()->Compile(BuildAddComputation(shape, value, tuple),
+                           GetDevice(), {GetDevice()}, nullptr);
+}
+
+}  // namespace
+
+// Uploads arrays of growing sizes.
+void BM_TransferToServer(benchmark::State& state) {
+  std::vector<ComputationClient::TensorSource> sources =
+      CreateSources(state.range(0), 1);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(Client()->TransferToServer(sources));
+  }
+  state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_TransferToServer)
+    ->RangeMultiplier(16)
+    ->Range(1 << 10, 1 << 26)
+    ->ThreadRange(1, 8)
+    ->UseRealTime();
+
+// Uploads a batch of small arrays with a single call.
+void BM_TransferToServerBatch(benchmark::State& state) {
+  std::vector<ComputationClient::TensorSource> sources =
+      CreateSources(1024, state.range(0));
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(Client()->TransferToServer(sources));
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_TransferToServerBatch)->RangeMultiplier(8)->Range(1, 512);
+
+// Downloads arrays of growing sizes.
+void BM_TransferFromServer(benchmark::State& state) {
+  std::vector<ComputationClient::DataPtr> handles =
+      Client()->TransferToServer(CreateSources(state.range(0), 1));
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(Client()->TransferFromServer(handles));
+  }
+  state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_TransferFromServer)
+    ->RangeMultiplier(16)
+    ->Range(1 << 10, 1 << 26)
+    ->ThreadRange(1, 8)
+    ->UseRealTime();
+
+// Compiles trivial computations, which all differ by their constant, so that
+// no compilation cache is hit.
+void BM_Compile(benchmark::State& state) {
+  Shape shape = ArrayShape(1024);
+  float value = state.thread_index() * 1e6;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(CompileAddComputation(shape, value, false));
+    value += 1.0;
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Compile)->ThreadRange(1, 8)->UseRealTime();
+
+// Executes a trivial computation, which measures the fixed cost of the
+// execution round trips.
+void BM_ExecuteComputation(benchmark::State& state) {
+  Shape shape = ArrayShape(1024);
+  ComputationClient::ComputationPtr computation =
+      CompileAddComputation(shape, 1.0, false);
+  std::vector<ComputationClient::DataPtr> arguments =
+      Client()->TransferToServer(CreateSources(1024, 1));
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(Client()->ExecuteComputation(
+        *computation, arguments, GetDevice(),
+        ComputationClient::ExecuteComputationOptions()));
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ExecuteComputation)->ThreadRange(1, 8)->UseRealTime();
+
+// Executes chains of trivial computations, each one fed with the result of
+// the previous one.
+void BM_ExecuteChained(benchmark::State& state) {
+  Shape shape = ArrayShape(1024);
+  ComputationClient::ComputationPtr computation =
+      CompileAddComputation(shape, 1.0, false);
+  std::vector<ComputationClient::DataPtr> input =
+      Client()->TransferToServer(CreateSources(1024, 1));
+  std::vector<ComputationClient::ExecuteChainedOp> ops(state.range(0) + 1);
+  ops[0].device_data = input.front();
+  for (size_t i = 1; i < ops.size(); ++i) {
+    ops[i].computation = computation;
+    ops[i].inputs.push_back({i - 1, absl::nullopt});
+  }
+  ops.back().outputs.push_back({0, absl::nullopt});
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(Client()->ExecuteChained(ops, GetDevice()));
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_ExecuteChained)->RangeMultiplier(4)->Range(1, 64);
+
+// Splits the tuple results of a computation into their elements.
+void BM_DeconstructTuple(benchmark::State& state) {
+  Shape shape = ArrayShape(1024);
+  ComputationClient::ComputationPtr computation =
+      CompileAddComputation(shape, 1.0, true);
+  std::vector<ComputationClient::DataPtr> arguments =
+      Client()->TransferToServer(CreateSources(1024, 1));
+  ComputationClient::ExecuteComputationOptions options;
+  options.explode_tuple = false;
+  for (auto _ : state) {
+    state.PauseTiming();
+    std::vector<ComputationClient::DataPtr> tuples =
+        Client()->ExecuteComputation(*computation, arguments, GetDevice(),
+                                     options);
+    state.ResumeTiming();
+    benchmark::DoNotOptimize(Client()->DeconstructTuple(tuples));
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_DeconstructTuple);
+
+// Releases batches of device handles. The releases might be deferred by the
+// client, in which case this only measures their enqueueing.
+void BM_ReleaseHandles(benchmark::State& state) {
+  std::vector<ComputationClient::TensorSource> sources =
+      CreateSources(1024, state.range(0));
+  for (auto _ : state) {
+    state.PauseTiming();
+    std::vector<ComputationClient::DataPtr> handles =
+        Client()->TransferToServer(sources);
+    state.ResumeTiming();
+    handles.clear();
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_ReleaseHandles)->RangeMultiplier(8)->Range(1, 512);
+
+}  // namespace bench
+}  // namespace xla
+
+BENCHMARK_MAIN();
@@ -0,0 +1,313 @@
+#include <benchmark/benchmark.h>
+
+#include <ATen/ATen.h>
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "tensorflow/compiler/xla/literal.h"
+#include "tensorflow/compiler/xla/shape_util.h"
+#include "tensorflow/compiler/xla/xla_client/cache.h"
+#include "tensorflow/compiler/xla/xla_client/util.h"
+#include "torch_xla/csrc/aten_xla_bridge.h"
+#include "torch_xla/csrc/aten_xla_type.h"
+#include "torch_xla/csrc/device.h"
+#include "torch_xla/csrc/ir.h"
+#include "torch_xla/csrc/ir_util.h"
+#include "torch_xla/csrc/lowering_context.h"
+#include "torch_xla/csrc/ops/arithmetic_ir_ops.h"
+#include "torch_xla/csrc/ops/ops.h"
+#include "torch_xla/csrc/tensor.h"
+#include "torch_xla/csrc/tensor_util.h"
+
+// Benchmarks of the host side hot paths: dispatching and tracing operations
+// into IR graphs, walking and lowering the graphs, looking up the caches, and
+// converting the tensor data. Run with --benchmark_format=json (or with
+// --benchmark_out=FILE --benchmark_out_format=json) to get machine readable
+// results.
+
+namespace torch_xla {
+namespace bench {
+namespace {
+
+const xla::int64 kGraphDim = 16;
+
+xla::Shape GraphShape() {
+  return xla::ShapeUtil::MakeShape(xla::PrimitiveType::F32,
+                                   {kGraphDim, kGraphDim});
+}
+
+// Builds a chain of num_nodes additions, which share the same constant input.
+ir::Value BuildGraph(xla::int64 num_nodes) {
+  ir::Value input = ir::ops::ScalarOp(1.0, GraphShape());
+  ir::Value value = input;
+  for (xla::int64 i = 0; i < num_nodes; ++i) {
+    value = value + input;
+  }
+  return value;
+}
+
+// The element type conversions exercised by the tensor copy benchmarks.
+const std::pair<at::ScalarType, xla::PrimitiveType> kCopyTypes[] = {
+    {at::ScalarType::Float, xla::PrimitiveType::F32},
+    {at::ScalarType::Float, xla::PrimitiveType::BF16},
+    {at::ScalarType::Int, xla::PrimitiveType::S32},
+    {at::ScalarType::Long, xla::PrimitiveType::S64},
+    {at::ScalarType::Byte, xla::PrimitiveType::U8},
+};
+
+// Returns the shape of the copy destination, in row major layout, or with the
+// two dimensions swapped in memory if transposed is true.
+xla::Shape CopyShape(xla::PrimitiveType type, xla::int64 dim,
+                     bool transposed) {
+  return xla::ShapeUtil::MakeShapeWithLayout(
+      type, {dim, dim},
+      transposed ? std::vector<xla::int64>{0, 1}
+                 : std::vector<xla::int64>{1, 0});
+}
+
+}  // namespace
+
+// Traces an XLATensor operation, which includes the IR node creation.
+void BM_TraceTensorOp(benchmark::State& state) {
+  Device device = *GetDefaultDevice();
+  XLATensor a = XLATensor::Create(at::rand({kGraphDim, kGraphDim}), device);
+  XLATensor b = XLATensor::Create(at::rand({kGraphDim, kGraphDim}), device);
+  // Force the upload, so that its cost does not show up in the first
+  // iteration.
+  a.GetXlaData();
+  b.GetXlaData();
+  for (auto _ : state) {
+    XLATensor c = XLATensor::add(a, b, 1.0);
+    benchmark::DoNotOptimize(c.CurrentIrValue());
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_TraceTensorOp);
+
+// Traces short chains of XLATensor operations from a growing number of
+// threads, each one with its own tensors, like the DataParallel replicas do.
+// The chains create and destroy tensors, and use scalar constants, so besides
+// the IR node creation, they exercise the tensor registry, the tensor IDs, the
+// shape cache, the device data cache and the counters, which all threads
+// share. With no contention, the throughput grows linearly with the threads.
+void BM_TraceTensorOpThreads(benchmark::State& state) {
+  Device device = *GetDefaultDevice();
+  XLATensor a = XLATensor::Create(at::rand({kGraphDim, kGraphDim}), device);
+  XLATensor b = XLATensor::Create(at::rand({kGraphDim, kGraphDim}), device);
+  a.GetXlaData();
+  b.GetXlaData();
+  for (auto _ : state) {
+    XLATensor c = XLATensor::add(a, b, 1.0);
+    XLATensor d = XLATensor::mul(c, 0.5);
+    XLATensor e = XLATensor::sub(d, a, 1.0);
+    benchmark::DoNotOptimize(e.CurrentIrValue());
+  }
+  state.SetItemsProcessed(state.iterations() * 3);
+}
+BENCHMARK(BM_TraceTensorOpThreads)->ThreadRange(1, 8)->UseRealTime();
+
+// Creates and destroys XLATensor objects from a growing number of threads,
+// keeping a few of them alive at any time, which exercises the sharded live
+// tensors registry.
+void BM_CreateDestroyTensorThreads(benchmark::State& state) {
+  const size_t kLiveTensors = 16;
+  Device device = *GetDefaultDevice();
+  at::Tensor input = at::rand({2, 2}, at::TensorOptions(at::kFloat));
+  std::vector<XLATensor> tensors;
+  for (auto _ : state) {
+    if (tensors.size() == kLiveTensors) {
+      tensors.clear();
+    }
+    tensors.push_back(XLATensor::Create(input, device));
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_CreateDestroyTensorThreads)->ThreadRange(1, 8)->UseRealTime();
+
+// Runs a tiny ATen operation over XLA tensors, which accounts for the whole
+// per operation host cost of an eager style model: the ATen dispatch, the
+// extraction of the XLATensor arguments, the tracing, and the creation of the
+// result tensor.
+void BM_AtenOpDispatch(benchmark::State& state) {
+  AtenXlaType::InitializeAtenBindings();
+  Device device = *GetDefaultDevice();
+  at::Tensor a = bridge::AtenFromXlaTensor(
+      XLATensor::Create(at::rand({kGraphDim, kGraphDim}), device));
+  at::Tensor b = bridge::AtenFromXlaTensor(
+      XLATensor::Create(at::rand({kGraphDim, kGraphDim}), device));
+  bridge::GetXlaTensor(a).GetXlaData();
+  bridge::GetXlaTensor(b).GetXlaData();
+  for (auto _ : state) {
+    at::Tensor c = at::add(a, b);
+    benchmark::DoNotOptimize(c.unsafeGetTensorImpl());
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_AtenOpDispatch);
+
+// Extracts the XLATensor out of an at::Tensor, and wraps it back.
+void BM_AtenXlaTensorRoundTrip(benchmark::State& state) {
+  Device device = *GetDefaultDevice();
+  at::Tensor a = bridge::AtenFromXlaTensor(
+      XLATensor::Create(at::rand({kGraphDim, kGraphDim}), device));
+  for (auto _ : state) {
+    at::Tensor b = bridge::AtenFromXlaTensor(bridge::GetXlaTensor(a));
+    benchmark::DoNotOptimize(b.unsafeGetTensorImpl());
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_AtenXlaTensorRoundTrip);
+
+// Creates IR nodes, including their shape inference and hashing.
+void BM_MakeNode(benchmark::State& state) {
+  ir::Value input = ir::ops::ScalarOp(1.0, GraphShape());
+  for (auto _ : state) {
+    ir::Value value = input + input;
+    benchmark::DoNotOptimize(value.hash());
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_MakeNode);
+
+// Builds and destroys chains of IR nodes, which exercises the node pool
+// allocations along with the node creation.
+void BM_TraceIrChain(benchmark::State& state) {
+  // Keep the graph depth limited, as IR graphs are destroyed recursively.
+  const xla::int64 kOpsPerChain = 4096;
+  ir::NodePtr scalar = ir::ops::ScalarOp(1.0, xla::F32);
+  for (auto _ : state) {
+    ir::Value value = ir::ops::ScalarOp(2.0, xla::F32);
+    for (xla::int64 i = 0; i < kOpsPerChain; ++i) {
+      value = value + scalar;
+    }
+    benchmark::DoNotOptimize(value.hash());
+  }
+  state.SetItemsProcessed(state.iterations() * kOpsPerChain);
+}
+BENCHMARK(BM_TraceIrChain);
+
+// Walks graphs of growing sizes, and combines the root hashes the way the
+// tensors graph sync does.
+void BM_GraphPostOrderHash(benchmark::State& state) {
+  std::vector<ir::Value> roots;
+  for (int i = 0; i < 8; ++i) {
+    roots.push_back(BuildGraph(state.range(0)));
+  }
+  std::vector<const ir::Node*> root_nodes;
+  for (auto& root : roots) {
+    root_nodes.push_back(root.node.get());
+  }
+  for (auto _ : state) {
+    size_t hash = 0;
+    for (auto& root : roots) {
+      hash = xla::util::HashCombine(hash, root.hash());
+    }
+    std::vector<const ir::Node*> post_order =
+        ir::Util::ComputePostOrder(root_nodes);
+    benchmark::DoNotOptimize(hash);
+    benchmark::DoNotOptimize(post_order.data());
+  }
+  state.SetItemsProcessed(state.iterations() * roots.size() * state.range(0));
+}
+BENCHMARK(BM_GraphPostOrderHash)->RangeMultiplier(8)->Range(8, 4096);
+
+// Lowers graphs of growing sizes to XLA operations.
+void BM_LowerGraph(benchmark::State& state) {
+  ir::Value root = BuildGraph(state.range(0));
+  for (auto _ : state) {
+    ir::LoweringContext lowering_ctx("BenchLowering");
+    xla::XlaOp op = lowering_ctx.GetOutputOp(ir::Output(root.node.get(), 0));
+    benchmark::DoNotOptimize(op);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_LowerGraph)->RangeMultiplier(8)->Range(8, 4096);
+
+// Looks up a full cache, like the graph and shape caches, from a growing
+// number of threads.
+template <typename C>
+void BM_CacheLookup(benchmark::State& state) {
+  const size_t kCacheSize = 1024;
+  static C* cache = nullptr;
+  if (state.thread_index() == 0) {
+    cache = new C(kCacheSize);
+    for (size_t i = 0; i < kCacheSize; ++i) {
+      cache->Add(xla::util::MHash(i), std::make_shared<int>(i));
+    }
+  }
+  size_t i = state.thread_index();
+  for (auto _ : state) {
+    // Keys past the cache size are misses.
+    benchmark::DoNotOptimize(
+        cache->Get(xla::util::MHash(i++ % (kCacheSize + kCacheSize / 4))));
+  }
+  state.SetItemsProcessed(state.iterations());
+  if (state.thread_index() == 0) {
+    delete cache;
+    cache = nullptr;
+  }
+}
+BENCHMARK_TEMPLATE(BM_CacheLookup, xla::util::Cache<size_t, int>)
+    ->ThreadRange(1, 8);
+BENCHMARK_TEMPLATE(BM_CacheLookup, xla::util::ShardedCache<size_t, int>)
+    ->ThreadRange(1, 8);
+
+// Converts host tensors to XLA literals, for every element type conversion and
+// layout in kCopyTypes.
+void BM_TensorToLiteral(benchmark::State& state) {
+  const xla::int64 kDim = 1024;
+  auto& types = kCopyTypes[state.range(0)];
+  at::Tensor tensor =
+      at::randint(0, 100, {kDim, kDim}, at::TensorOptions(types.first));
+  xla::Shape shape = CopyShape(types.second, kDim, state.range(1) != 0);
+  Device device = *GetDefaultDevice();
+  for (auto _ : state) {
+    xla::Literal literal = GetTensorLiteral(tensor, &shape, &device);
+    benchmark::DoNotOptimize(literal.untyped_data());
+  }
+  state.SetBytesProcessed(state.iterations() * tensor.nbytes());
+}
+BENCHMARK(BM_TensorToLiteral)
+    ->ArgsProduct({{0, 1, 2, 3, 4}, {0, 1}})
+    ->ArgNames({"type", "transposed"});
+
+// Converts XLA literals back to host tensors.
+void BM_LiteralToTensor(benchmark::State& state) {
+  const xla::int64 kDim = 1024;
+  auto& types = kCopyTypes[state.range(0)];
+  at::Tensor tensor =
+      at::randint(0, 100, {kDim, kDim}, at::TensorOptions(types.first));
+  xla::Shape shape = CopyShape(types.second, kDim, state.range(1) != 0);
+  Device device = *GetDefaultDevice();
+  xla::Literal literal = GetTensorLiteral(tensor, &shape, &device);
+  for (auto _ : state) {
+    at::Tensor result = MakeTensorFromXlaLiteral(literal, types.first);
+    benchmark::DoNotOptimize(result.data_ptr());
+  }
+  state.SetBytesProcessed(state.iterations() * tensor.nbytes());
+}
+BENCHMARK(BM_LiteralToTensor)
+    ->ArgsProduct({{0, 1, 2, 3, 4}, {0, 1}})
+    ->ArgNames({"type", "transposed"});
+
+// Hashes host tensors, like the device data cache does for its keys, either
+// contiguous or transposed.
+void BM_TensorHash(benchmark::State& state) {
+  const xla::int64 kDim = 1024;
+  at::Tensor tensor = at::rand({kDim, kDim}, at::TensorOptions(at::kFloat));
+  if (state.range(0) != 0) {
+    tensor = tensor.t();
+  }
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(TensorHash(tensor));
+  }
+  state.SetBytesProcessed(state.iterations() * tensor.nbytes());
+}
+BENCHMARK(BM_TensorHash)->Arg(0)->Arg(1)->ArgName("transposed");
+
+}  // namespace bench
+}  // namespace torch_xla
+
+BENCHMARK_MAIN();
@@ -8,12 +8,15 @@ FILTER=
 BUILD_ONLY=0
 RMBUILD=1
 LOGFILE=/tmp/pytorch_cpp_test.log
+BENCH=0
+BENCH_OUT="${BENCH_OUT:-/tmp/pytorch_cpp_bench.json}"
+CLIENT_BENCH_OUT="${CLIENT_BENCH_OUT:-/tmp/pytorch_cpp_client_bench.json}"
 
 if [ "$DEBUG" == "1" ]; then
   BUILDTYPE="Debug"
 fi
 
-while getopts 'VLDKBF:' OPTION
+while getopts 'VLDKBPF:' OPTION
 do
   case $OPTION in
     V)
@@ -31,6 +34,9 @@ do
     B)
       BUILD_ONLY=1
       ;;
+    P)
+      BENCH=1
+      ;;
     F)
       FILTER="--gtest_filter=$OPTARG"
       ;;
@@ -52,6 +58,11 @@ if [ $BUILD_ONLY -eq 0 ]; then
   else
     ./test_ptxla ${FILTER:+"$FILTER"}
   fi
+  if [ $BENCH -eq 1 ]; then
+    ./bench_ptxla --benchmark_out="$BENCH_OUT" --benchmark_out_format=json
+    ./bench_xla_client --benchmark_out="$CLIENT_BENCH_OUT" \
+      --benchmark_out_format=json
+  fi
 fi
 popd
 if [ $RMBUILD -eq 1 -a $BUILD_ONLY -eq 0 ]; then
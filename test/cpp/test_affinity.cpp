@@ -0,0 +1,77 @@
+#include <gtest/gtest.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "tensorflow/compiler/xla/xla_client/affinity.h"
+#include "tensorflow/compiler/xla/xla_client/tensor_allocator.h"
+
+namespace torch_xla {
+namespace cpp_test {
+
+TEST(AffinityTest, TestParseCpuSet) {
+  EXPECT_EQ(xla::affinity::ParseCpuSet("3"), std::vector<int>({3}));
+  EXPECT_EQ(xla::affinity::ParseCpuSet("5, 0-2,2,4-4"),
+            std::vector<int>({0, 1, 2, 4, 5}));
+  EXPECT_TRUE(xla::affinity::ParseCpuSet("").empty());
+  EXPECT_THROW(xla::affinity::ParseCpuSet("2-1"), std::runtime_error);
+  EXPECT_THROW(xla::affinity::ParseCpuSet("1-2-3"), std::runtime_error);
+  EXPECT_THROW(xla::affinity::ParseCpuSet("x"), std::runtime_error);
+  EXPECT_THROW(xla::affinity::ParseCpuSet("node100000"), std::runtime_error);
+}
+
+TEST(AffinityTest, TestParseDeviceCpus) {
+  std::map<std::string, std::vector<int>> devices_cpus =
+      xla::affinity::ParseDeviceCpus("TPU:0=0-1; TPU:1=3,2");
+  ASSERT_EQ(devices_cpus.size(), 2u);
+  EXPECT_EQ(devices_cpus["TPU:0"], std::vector<int>({0, 1}));
+  EXPECT_EQ(devices_cpus["TPU:1"], std::vector<int>({2, 3}));
+  EXPECT_THROW(xla::affinity::ParseDeviceCpus("TPU:0"), std::runtime_error);
+  // Devices which are not part of XLA_DEVICE_CPUS have no CPU set.
+  EXPECT_TRUE(xla::affinity::GetDeviceCpus("NO_DEVICE:0").empty());
+}
+
+TEST(AffinityTest, TestTensorAllocatorNumaNodes) {
+  int numa_node = 0;
+  xla::TensorAllocator allocator(
+      /*max_size=*/1 << 20, /*num_numa_nodes=*/2, [&]() { return numa_node; },
+      /*use_thread_cache=*/false);
+  const size_t kAlignment = 64;
+  const size_t kNumBytes = 1000;
+  void* node0_block = allocator.AllocateRaw(kAlignment, kNumBytes);
+  EXPECT_EQ(xla::TensorAllocator::GetBlockNumaNode(node0_block), 0);
+  // A block freed from another node goes back to the free list of the node
+  // which allocated it.
+  numa_node = 1;
+  allocator.DeallocateRaw(node0_block);
+  void* node1_block = allocator.AllocateRaw(kAlignment, kNumBytes);
+  EXPECT_NE(node1_block, node0_block);
+  EXPECT_EQ(xla::TensorAllocator::GetBlockNumaNode(node1_block), 1);
+  allocator.DeallocateRaw(node1_block);
+  EXPECT_EQ(allocator.AllocateRaw(kAlignment, kNumBytes), node1_block);
+
+  numa_node = 0;
+  EXPECT_EQ(allocator.AllocateRaw(kAlignment, kNumBytes), node0_block);
+  allocator.DeallocateRaw(node0_block);
+  allocator.DeallocateRaw(node1_block);
+}
+
+TEST(AffinityTest, TestTensorAllocatorThreadCache) {
+  xla::TensorAllocator* allocator = xla::TensorAllocator::Get();
+  const size_t kAlignment = 64;
+  const size_t kNumBytes = 3000;
+  void* block = allocator->AllocateRaw(kAlignment, kNumBytes);
+  allocator->DeallocateRaw(block);
+  // Blocks freed by a thread are picked up again by the same thread, as long
+  // as it runs on the node the block belongs to, which the thread might leave
+  // on multi-socket hosts.
+  void* reused_block = allocator->AllocateRaw(kAlignment, kNumBytes);
+  if (xla::affinity::GetNumNumaNodes() == 1) {
+    EXPECT_EQ(reused_block, block);
+  }
+  allocator->DeallocateRaw(reused_block);
+}
+
+}  // namespace cpp_test
+}  // namespace torch_xla
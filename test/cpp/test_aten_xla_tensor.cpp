@@ -798,6 +798,50 @@ TEST_F(AtenXlaTensorTest, TestTriangularSolve) {
   }
 }
 
+TEST_F(AtenXlaTensorTest, TestLinalgBatchedSizes) {
+  // Sizes on both sides of the XLA_LINALG_UNROLL_MAX_SIZE default.
+  for (int64_t m : {2, 32, 40}) {
+    torch::Tensor a =
+        torch::rand({16, m, m}, torch::TensorOptions(torch::kFloat));
+    torch::Tensor pd_a =
+        torch::matmul(a, torch::transpose(a, 1, 2)) +
+        m * torch::eye(m, torch::TensorOptions(torch::kFloat));
+    torch::Tensor b =
+        torch::randn({16, m, 3}, torch::TensorOptions(torch::kFloat));
+    for (bool upper : {true, false}) {
+      torch::Tensor l = torch::cholesky(pd_a, upper);
+      auto solution = torch::triangular_solve(b, l, /*upper=*/upper);
+      ForEachDevice([&](const torch::Device& device) {
+        torch::Tensor xla_pd_a = CopyToDevice(pd_a, device);
+        torch::Tensor xla_l = torch::cholesky(xla_pd_a, upper);
+        AllClose(l, xla_l, /*rtol=*/1e-3, /*atol=*/1e-4);
+        auto xla_solution = torch::triangular_solve(CopyToDevice(b, device),
+                                                    xla_l, /*upper=*/upper);
+        AllClose(std::get<0>(solution), std::get<0>(xla_solution),
+                 /*rtol=*/1e-3, /*atol=*/1e-4);
+      });
+    }
+    // Square, tall and wide matrices, all within the unrolled range when m
+    // is.
+    std::vector<std::vector<int64_t>> qr_sizes = {
+        {16, m, m}, {16, m, m / 2 + 1}, {16, m / 2 + 1, m}};
+    for (const auto& qr_size : qr_sizes) {
+      for (bool some : {true, false}) {
+        torch::Tensor c =
+            torch::rand(qr_size, torch::TensorOptions(torch::kFloat));
+        auto qr = torch::qr(c, some);
+        ForEachDevice([&](const torch::Device& device) {
+          auto xla_qr = torch::qr(CopyToDevice(c, device), some);
+          AllClose(std::get<0>(qr).abs(), std::get<0>(xla_qr).abs(),
+                   /*rtol=*/1e-3, /*atol=*/1e-4);
+          AllClose(std::get<1>(qr).abs(), std::get<1>(xla_qr).abs(),
+                   /*rtol=*/1e-3, /*atol=*/1e-4);
+        });
+      }
+    }
+  }
+}
+
 TEST_F(AtenXlaTensorTest, TestKthValue) {
   torch::Tensor a = torch::rand({4, 5, 3}, torch::TensorOptions(torch::kFloat));
   for (int k = 1; k <= 3; ++k) {
@@ -816,6 +860,22 @@ TEST_F(AtenXlaTensorTest, TestKthValue) {
   }
 }
 
+TEST_F(AtenXlaTensorTest, TestKthValueLargeDim) {
+  // Large enough to use the selection based lowering.
+  torch::Tensor a = torch::rand({3, 2048}, torch::TensorOptions(torch::kFloat));
+  for (int k : {1, 7, 2042, 2048}) {
+    for (bool keepdim : {false, true}) {
+      auto b = torch::kthvalue(a, k, /*dim=*/1, keepdim);
+      ForEachDevice([&](const torch::Device& device) {
+        torch::Tensor xla_a = CopyToDevice(a, device);
+        auto xla_b = torch::kthvalue(xla_a, k, /*dim=*/1, keepdim);
+        AllClose(std::get<0>(b), std::get<0>(xla_b));
+        AllEqual(std::get<1>(b), std::get<1>(xla_b));
+      });
+    }
+  }
+}
+
 TEST_F(AtenXlaTensorTest, TestTopK) {
   torch::Tensor a = torch::rand({4, 5, 3}, torch::TensorOptions(torch::kFloat));
   for (int k = 1; k <= 3; ++k) {
@@ -834,6 +894,22 @@ TEST_F(AtenXlaTensorTest, TestTopK) {
   }
 }
 
+TEST_F(AtenXlaTensorTest, TestTopKLargeDim) {
+  // Large enough to use the selection based lowering.
+  torch::Tensor a = torch::rand({2048, 3}, torch::TensorOptions(torch::kFloat));
+  for (int k : {1, 5, 32}) {
+    for (bool largest : {false, true}) {
+      auto b = torch::topk(a, k, /*dim=*/0, largest, /*sorted=*/true);
+      ForEachDevice([&](const torch::Device& device) {
+        torch::Tensor xla_a = CopyToDevice(a, device);
+        auto xla_b = torch::topk(xla_a, k, /*dim=*/0, largest, /*sorted=*/true);
+        AllClose(std::get<0>(b), std::get<0>(xla_b));
+        AllEqual(std::get<1>(b), std::get<1>(xla_b));
+      });
+    }
+  }
+}
+
 TEST_F(AtenXlaTensorTest, TestSort) {
   torch::Tensor a = torch::rand({4, 5, 3}, torch::TensorOptions(torch::kFloat));
   for (int k = 1; k <= 3; ++k) {
@@ -864,6 +940,25 @@ TEST_F(AtenXlaTensorTest, TestSortDescWithMinValue) {
   });
 }
 
+TEST_F(AtenXlaTensorTest, TestSortStable) {
+  torch::Tensor input = torch::tensor(std::vector<float>{2, 1, 2, 1, 0},
+                                      torch::TensorOptions(torch::kFloat));
+  for (bool descending : {false, true}) {
+    std::vector<int64_t> indices =
+        descending ? std::vector<int64_t>{0, 2, 1, 3, 4}
+                   : std::vector<int64_t>{4, 1, 3, 0, 2};
+    torch::Tensor expected_indices =
+        torch::tensor(indices, torch::TensorOptions(torch::kLong));
+    ForEachDevice([&](const torch::Device& device) {
+      torch::Tensor xla_input = CopyToDevice(input, device);
+      auto xla_output = torch::sort(xla_input, /*dim=*/0, descending);
+      AllEqual(std::get<0>(xla_output),
+               torch::index_select(input, 0, expected_indices));
+      AllEqual(std::get<1>(xla_output), expected_indices);
+    });
+  }
+}
+
 TEST_F(AtenXlaTensorTest, TestArgSort) {
   torch::Tensor a = torch::rand({4, 5, 3}, torch::TensorOptions(torch::kFloat));
   for (int k = 1; k <= 3; ++k) {
@@ -1667,6 +1762,20 @@ TEST_F(AtenXlaTensorTest, TestCumSumCastLong) {
   }
 }
 
+TEST_F(AtenXlaTensorTest, TestCumSumScan) {
+  // Long enough to use the parallel prefix scan lowering.
+  torch::Tensor input =
+      torch::randint(100, {3, 1000}, torch::TensorOptions(torch::kLong));
+  for (int dim : {0, 1}) {
+    torch::Tensor result = torch::cumsum(input, dim);
+    ForEachDevice([&](const torch::Device& device) {
+      torch::Tensor xla_input = CopyToDevice(input, device);
+      torch::Tensor xla_result = torch::cumsum(xla_input, dim);
+      AllEqual(result, xla_result);
+    });
+  }
+}
+
 TEST_F(AtenXlaTensorTest, TestCumProd) {
   torch::Tensor input =
       torch::rand({4, 3, 4}, torch::TensorOptions(torch::kFloat));
@@ -1709,6 +1818,20 @@ TEST_F(AtenXlaTensorTest, TestCumProdLong) {
   }
 }
 
+TEST_F(AtenXlaTensorTest, TestCumProdScan) {
+  // Long enough to use the parallel prefix scan lowering, with values close
+  // to one to keep the products finite.
+  torch::Tensor input =
+      torch::rand({2, 300}, torch::TensorOptions(torch::kFloat)) * 0.02 +
+      0.99;
+  torch::Tensor result = torch::cumprod(input, 1);
+  ForEachDevice([&](const torch::Device& device) {
+    torch::Tensor xla_input = CopyToDevice(input, device);
+    torch::Tensor xla_result = torch::cumprod(xla_input, 1);
+    AllClose(result, xla_result, /*rtol=*/1e-4, /*atol=*/1e-5);
+  });
+}
+
 TEST_F(AtenXlaTensorTest, TestCumProdCastLong) {
   torch::Tensor input =
       torch::rand({2, 3}, torch::TensorOptions(torch::kFloat)) * 7;
@@ -1789,6 +1912,20 @@ TEST_F(AtenXlaTensorTest, TestArgMax) {
   });
 }
 
+TEST_F(AtenXlaTensorTest, TestArgMaxNarrowedIndex) {
+  // The reduction runs on 32 bit indices, and the result is widened back.
+  torch::Tensor a =
+      torch::rand({3, 70000}, torch::TensorOptions(torch::kFloat));
+  a[1][69999] = 2.0;
+  torch::Tensor b = torch::argmax(a, 1, /*keepdim=*/false);
+  ForEachDevice([&](const torch::Device& device) {
+    torch::Tensor xla_a = CopyToDevice(a, device);
+    torch::Tensor xla_b = torch::argmax(xla_a, 1, /*keepdim=*/false);
+    EXPECT_EQ(xla_b.scalar_type(), torch::kLong);
+    AllEqual(b, xla_b);
+  });
+}
+
 TEST_F(AtenXlaTensorTest, TestArgMaxDim) {
   torch::Tensor a = torch::rand({4, 4, 4}, torch::TensorOptions(torch::kFloat));
   for (int dim : {1, -2}) {
@@ -2280,6 +2417,33 @@ TEST_F(AtenXlaTensorTest, TestMatmulBcast) {
   });
 }
 
+TEST_F(AtenXlaTensorTest, TestMatmulPermuted) {
+  torch::Tensor a = torch::rand({4, 2}, torch::TensorOptions(torch::kFloat));
+  torch::Tensor b = torch::rand({3, 4}, torch::TensorOptions(torch::kFloat));
+  torch::Tensor c = torch::matmul(a.t().contiguous(), b.t());
+  ForEachDevice([&](const torch::Device& device) {
+    torch::Tensor xla_a = CopyToDevice(a, device);
+    torch::Tensor xla_b = CopyToDevice(b, device);
+    torch::Tensor xla_c = torch::matmul(xla_a.t().contiguous(), xla_b.t());
+    AllClose(c, xla_c, /*rtol=*/1e-3, /*atol=*/1e-4);
+  });
+}
+
+TEST_F(AtenXlaTensorTest, TestBmmPermuted) {
+  torch::Tensor a =
+      torch::rand({4, 2, 3}, torch::TensorOptions(torch::kFloat));
+  torch::Tensor b =
+      torch::rand({5, 2, 4}, torch::TensorOptions(torch::kFloat));
+  torch::Tensor c = torch::bmm(a.permute({1, 2, 0}), b.permute({1, 0, 2}));
+  ForEachDevice([&](const torch::Device& device) {
+    torch::Tensor xla_a = CopyToDevice(a, device);
+    torch::Tensor xla_b = CopyToDevice(b, device);
+    torch::Tensor xla_c =
+        torch::bmm(xla_a.permute({1, 2, 0}), xla_b.permute({1, 0, 2}));
+    AllClose(c, xla_c, /*rtol=*/1e-3, /*atol=*/1e-4);
+  });
+}
+
 TEST_F(AtenXlaTensorTest, TestDot) {
   torch::Tensor a = torch::rand({4}, torch::TensorOptions(torch::kFloat));
   torch::Tensor b = torch::rand({4}, torch::TensorOptions(torch::kFloat));
@@ -2393,6 +2557,40 @@ TEST_F(AtenXlaTensorTest, TestEinsumBatchMatMul) {
   });
 }
 
+TEST_F(AtenXlaTensorTest, TestEinsumAttention) {
+  torch::Tensor q =
+      torch::rand({2, 6, 3, 4}, torch::TensorOptions(torch::kFloat));
+  torch::Tensor k =
+      torch::rand({2, 5, 3, 4}, torch::TensorOptions(torch::kFloat));
+  torch::Tensor v =
+      torch::rand({2, 5, 3, 4}, torch::TensorOptions(torch::kFloat));
+  torch::Tensor scores = torch::einsum("bqhd,bkhd->bhqk", {q, k});
+  torch::Tensor output = torch::einsum("bhqk,bkhd->bqhd", {scores, v});
+  ForEachDevice([&](const torch::Device& device) {
+    torch::Tensor xla_q = CopyToDevice(q, device);
+    torch::Tensor xla_k = CopyToDevice(k, device);
+    torch::Tensor xla_v = CopyToDevice(v, device);
+    torch::Tensor xla_scores = torch::einsum("bqhd,bkhd->bhqk", {xla_q, xla_k});
+    torch::Tensor xla_output =
+        torch::einsum("bhqk,bkhd->bqhd", {xla_scores, xla_v});
+    AllClose(scores, xla_scores);
+    AllClose(output, xla_output);
+  });
+}
+
+TEST_F(AtenXlaTensorTest, TestEinsumUnsharedReduction) {
+  torch::Tensor a = torch::rand({3, 4, 7}, torch::TensorOptions(torch::kFloat));
+  torch::Tensor b = torch::rand({4, 5}, torch::TensorOptions(torch::kFloat));
+  std::string equation = "ijz,jk->ik";
+  torch::Tensor c = torch::einsum(equation, {a, b});
+  ForEachDevice([&](const torch::Device& device) {
+    torch::Tensor xla_a = CopyToDevice(a, device);
+    torch::Tensor xla_b = CopyToDevice(b, device);
+    torch::Tensor xla_c = torch::einsum(equation, {xla_a, xla_b});
+    AllClose(c, xla_c);
+  });
+}
+
 TEST_F(AtenXlaTensorTest, TestEinsumPyTorchLowerBilinear) {
   torch::Tensor a = torch::rand({3, 5, 4}, torch::TensorOptions(torch::kFloat));
   torch::Tensor l = torch::rand({2, 5}, torch::TensorOptions(torch::kFloat));
@@ -2586,6 +2784,66 @@ TEST_F(AtenXlaTensorTest, TestBernoulliTensorProbInPlace) {
   });
 }
 
+TEST_F(AtenXlaTensorTest, TestNormalInPlace) {
+  torch::Tensor input =
+      torch::zeros(10000, torch::TensorOptions(torch::kFloat));
+  ForEachDevice([&](const torch::Device& device) {
+    torch::Tensor xla_input = CopyToDevice(input, device);
+    xla_input.normal_(2.0, 0.5);
+    torch::Tensor cpu_input = ToCpuTensor(xla_input);
+    double mean = cpu_input.mean().item().toDouble();
+    double std = cpu_input.std().item().toDouble();
+    EXPECT_GT(mean, 1.95);
+    EXPECT_LT(mean, 2.05);
+    EXPECT_GT(std, 0.45);
+    EXPECT_LT(std, 0.55);
+  });
+}
+
+TEST_F(AtenXlaTensorTest, TestUniformInPlace) {
+  torch::Tensor input =
+      torch::zeros(10000, torch::TensorOptions(torch::kFloat));
+  ForEachDevice([&](const torch::Device& device) {
+    torch::Tensor xla_input = CopyToDevice(input, device);
+    xla_input.uniform_(-1.0, 3.0);
+    torch::Tensor cpu_input = ToCpuTensor(xla_input);
+    EXPECT_GE(cpu_input.min().item().toDouble(), -1.0);
+    EXPECT_LT(cpu_input.max().item().toDouble(), 3.0);
+    double mean = cpu_input.mean().item().toDouble();
+    EXPECT_GT(mean, 0.9);
+    EXPECT_LT(mean, 1.1);
+  });
+}
+
+TEST_F(AtenXlaTensorTest, TestRandomInPlace) {
+  for (auto dtype : {torch::kFloat, torch::kInt, torch::kLong}) {
+    torch::Tensor input = torch::zeros(10000, torch::TensorOptions(dtype));
+    ForEachDevice([&](const torch::Device& device) {
+      torch::Tensor xla_input = CopyToDevice(input, device);
+      xla_input.random_(-3, 7);
+      torch::Tensor cpu_input = ToCpuTensor(xla_input);
+      EXPECT_EQ(cpu_input.min().item().toLong(), -3);
+      EXPECT_EQ(cpu_input.max().item().toLong(), 6);
+      EXPECT_EQ(cpu_input.fmod(1).abs().max().item().toDouble(), 0.0);
+    });
+  }
+}
+
+TEST_F(AtenXlaTensorTest, TestRandn) {
+  ForEachDevice([&](const torch::Device& device) {
+    torch::Tensor xla_output = torch::randn(
+        {100, 100}, torch::TensorOptions(torch::kFloat).device(device));
+    EXPECT_EQ(xla_output.device(), device);
+    torch::Tensor cpu_output = ToCpuTensor(xla_output);
+    double mean = cpu_output.mean().item().toDouble();
+    double std = cpu_output.std().item().toDouble();
+    EXPECT_GT(mean, -0.05);
+    EXPECT_LT(mean, 0.05);
+    EXPECT_GT(std, 0.95);
+    EXPECT_LT(std, 1.05);
+  });
+}
+
 TEST_F(AtenXlaTensorTest, TestDropout) {
   torch::Tensor a = torch::rand({17, 21}, torch::TensorOptions(torch::kFloat));
   ForEachDevice([&](const torch::Device& device) {
@@ -2887,6 +3145,20 @@ TEST_F(AtenXlaTensorTest, TestIndexSelect) {
   }
 }
 
+TEST_F(AtenXlaTensorTest, TestIndexSelectNarrowedIndex) {
+  torch::Tensor a =
+      torch::rand({70000, 2}, torch::TensorOptions(torch::kFloat));
+  torch::Tensor b =
+      torch::tensor({69999, 0, 65536, 3}, torch::TensorOptions(torch::kLong));
+  torch::Tensor c = torch::index_select(a, 0, b);
+  ForEachDevice([&](const torch::Device& device) {
+    torch::Tensor xla_a = CopyToDevice(a, device);
+    torch::Tensor xla_b = CopyToDevice(b, device);
+    torch::Tensor xla_c = torch::index_select(xla_a, 0, xla_b);
+    AllClose(c, xla_c);
+  });
+}
+
 TEST_F(AtenXlaTensorTest, TestIndexSelectRank0) {
   for (torch::ScalarType scalar_type :
        {torch::kFloat, torch::kByte, torch::kChar, torch::kShort, torch::kInt,
@@ -3163,6 +3435,50 @@ TEST_F(AtenXlaTensorTest, TestMultiIndexTailBroadcast) {
   }
 }
 
+TEST_F(AtenXlaTensorTest, TestOneIndexMiddleDim) {
+  // x[:, indices], which gathers along the second dimension, in place.
+  torch::Tensor params =
+      torch::rand({4, 3, 5, 6, 7}, torch::TensorOptions(torch::kFloat));
+  torch::Tensor indices_null;
+  torch::Tensor indices =
+      torch::randint(-3, 3, {2, 4, 3}, torch::TensorOptions(torch::kLong));
+  torch::Tensor result = torch::index(params, {indices_null, indices});
+  ForEachDevice([&](const torch::Device& device) {
+    torch::Tensor xla_params = CopyToDevice(params, device);
+    torch::Tensor xla_indices = CopyToDevice(indices, device);
+    torch::Tensor xla_result =
+        torch::index(xla_params, {indices_null, xla_indices});
+    AllEqual(result, xla_result);
+    // Neither the base nor the result get transposed.
+    EXPECT_EQ(GetTensorTextGraph(xla_result).find("permute"),
+              std::string::npos);
+  });
+}
+
+TEST_F(AtenXlaTensorTest, TestMultiIndexNonAdjacent) {
+  // x[indices_0, :, indices_1], whose index dimensions come first in the
+  // result.
+  torch::Tensor params =
+      torch::rand({4, 3, 5, 6, 7}, torch::TensorOptions(torch::kFloat));
+  torch::Tensor indices_0 =
+      torch::randint(-3, 3, {2, 4, 3}, torch::TensorOptions(torch::kLong));
+  torch::Tensor indices_null;
+  torch::Tensor indices_1 =
+      torch::randint(-3, 3, {2, 1, 3}, torch::TensorOptions(torch::kLong));
+  torch::Tensor result =
+      torch::index(params, {indices_0, indices_null, indices_1});
+  ForEachDevice([&](const torch::Device& device) {
+    torch::Tensor xla_params = CopyToDevice(params, device);
+    torch::Tensor xla_indices_0 = CopyToDevice(indices_0, device);
+    torch::Tensor xla_indices_1 = CopyToDevice(indices_1, device);
+    torch::Tensor xla_result = torch::index(
+        xla_params, {xla_indices_0, indices_null, xla_indices_1});
+    AllEqual(result, xla_result);
+    EXPECT_EQ(GetTensorTextGraph(xla_result).find("permute"),
+              std::string::npos);
+  });
+}
+
 TEST_F(AtenXlaTensorTest, TestMaskIndex) {
   for (torch::ScalarType scalar_type :
        {torch::kFloat, torch::kByte, torch::kChar, torch::kShort, torch::kInt,
@@ -3463,6 +3779,59 @@ TEST_F(AtenXlaTensorTest, TestMultiIndexPutTailBroadcast) {
   }
 }
 
+TEST_F(AtenXlaTensorTest, TestOneIndexPutMiddleDim) {
+  torch::Tensor params =
+      torch::rand({4, 3, 5, 6, 7}, torch::TensorOptions(torch::kFloat));
+  torch::Tensor indices_null;
+  torch::Tensor indices =
+      torch::randint(-3, 3, {2, 4, 3}, torch::TensorOptions(torch::kLong));
+  torch::Tensor values =
+      torch::rand({5, 6, 7}, torch::TensorOptions(torch::kFloat));
+  // Without accumulation, the duplicated indices write the same values.
+  for (bool accumulate : {false, true}) {
+    torch::Tensor result =
+        torch::index_put(params, {indices_null, indices}, values, accumulate);
+    ForEachDevice([&](const torch::Device& device) {
+      torch::Tensor xla_params = CopyToDevice(params, device);
+      torch::Tensor xla_indices = CopyToDevice(indices, device);
+      torch::Tensor xla_values = CopyToDevice(values, device);
+      torch::Tensor xla_result = torch::index_put(
+          xla_params, {indices_null, xla_indices}, xla_values, accumulate);
+      AllClose(result, xla_result);
+      EXPECT_EQ(GetTensorTextGraph(xla_result).find("permute"),
+                std::string::npos);
+    });
+  }
+}
+
+TEST_F(AtenXlaTensorTest, TestMultiIndexPutNonAdjacent) {
+  torch::Tensor params =
+      torch::rand({4, 3, 5, 6, 7}, torch::TensorOptions(torch::kFloat));
+  torch::Tensor indices_0 =
+      torch::randint(-3, 3, {2, 4, 3}, torch::TensorOptions(torch::kLong));
+  torch::Tensor indices_null;
+  torch::Tensor indices_1 =
+      torch::randint(-3, 3, {2, 1, 3}, torch::TensorOptions(torch::kLong));
+  torch::Tensor values =
+      torch::rand({3, 6, 7}, torch::TensorOptions(torch::kFloat));
+  for (bool accumulate : {false, true}) {
+    torch::Tensor result = torch::index_put(
+        params, {indices_0, indices_null, indices_1}, values, accumulate);
+    ForEachDevice([&](const torch::Device& device) {
+      torch::Tensor xla_params = CopyToDevice(params, device);
+      torch::Tensor xla_indices_0 = CopyToDevice(indices_0, device);
+      torch::Tensor xla_indices_1 = CopyToDevice(indices_1, device);
+      torch::Tensor xla_values = CopyToDevice(values, device);
+      torch::Tensor xla_result = torch::index_put(
+          xla_params, {xla_indices_0, indices_null, xla_indices_1}, xla_values,
+          accumulate);
+      AllClose(result, xla_result);
+      EXPECT_EQ(GetTensorTextGraph(xla_result).find("permute"),
+                std::string::npos);
+    });
+  }
+}
+
 TEST_F(AtenXlaTensorTest, TestMaskIndexPut) {
   torch::Tensor indices =
       torch::tensor({0, 1}, torch::TensorOptions(torch::kByte))
@@ -4451,6 +4820,32 @@ TEST_F(AtenXlaTensorTest, TestAddMatMul) {
   }
 }
 
+TEST_F(AtenXlaTensorTest, TestAddMatMulActivations) {
+  torch::Tensor input =
+      torch::randn({8, 16}, torch::TensorOptions(torch::kFloat));
+  torch::Tensor weight =
+      torch::randn({16, 12}, torch::TensorOptions(torch::kFloat));
+  torch::Tensor bias = torch::randn({12}, torch::TensorOptions(torch::kFloat));
+  std::vector<std::function<torch::Tensor(const torch::Tensor&)>>
+      activations = {
+          [](const torch::Tensor& x) { return torch::relu(x); },
+          [](const torch::Tensor& x) { return torch::sigmoid(x); },
+          [](const torch::Tensor& x) { return torch::tanh(x); },
+          [](const torch::Tensor& x) { return x.clone().relu_(); },
+      };
+  for (auto& activation : activations) {
+    torch::Tensor output = activation(torch::addmm(bias, input, weight));
+    ForEachDevice([&](const torch::Device& device) {
+      torch::Tensor xla_input = CopyToDevice(input, device);
+      torch::Tensor xla_weight = CopyToDevice(weight, device);
+      torch::Tensor xla_bias = CopyToDevice(bias, device);
+      torch::Tensor xla_output =
+          activation(torch::addmm(xla_bias, xla_input, xla_weight));
+      AllClose(output, xla_output, /*rtol=*/1e-3, /*atol=*/1e-4);
+    });
+  }
+}
+
 TEST_F(AtenXlaTensorTest, TestEmbedding) {
   torch::Tensor a = torch::rand({32, 4}, torch::TensorOptions(torch::kFloat));
   torch::Tensor i =
@@ -4468,6 +4863,50 @@ TEST_F(AtenXlaTensorTest, TestEmbedding) {
   });
 }
 
+TEST_F(AtenXlaTensorTest, TestEmbeddingBag) {
+  torch::Tensor weight =
+      torch::rand({32, 4}, torch::TensorOptions(torch::kFloat));
+  torch::Tensor indices =
+      torch::randint(0, 32, {10}, torch::TensorOptions(torch::kLong));
+  // The second bag is empty.
+  torch::Tensor offsets =
+      torch::tensor({0, 3, 3, 7}, torch::TensorOptions(torch::kLong));
+  for (int64_t mode : {0, 1, 2}) {
+    torch::Tensor output = std::get<0>(torch::embedding_bag(
+        weight, indices, offsets, /*scale_grad_by_freq=*/false, mode,
+        /*sparse=*/false, /*per_sample_weights=*/{}));
+    ForEachDevice([&](const torch::Device& device) {
+      torch::Tensor xla_output = std::get<0>(torch::embedding_bag(
+          CopyToDevice(weight, device), CopyToDevice(indices, device),
+          CopyToDevice(offsets, device), /*scale_grad_by_freq=*/false, mode,
+          /*sparse=*/false, /*per_sample_weights=*/{}));
+      AllClose(output, xla_output);
+    });
+  }
+}
+
+TEST_F(AtenXlaTensorTest, TestEmbeddingBagPerSampleWeights) {
+  torch::Tensor weight =
+      torch::rand({32, 4}, torch::TensorOptions(torch::kFloat));
+  torch::Tensor indices =
+      torch::randint(0, 32, {10}, torch::TensorOptions(torch::kLong));
+  torch::Tensor offsets =
+      torch::tensor({0, 4, 5}, torch::TensorOptions(torch::kLong));
+  torch::Tensor per_sample_weights =
+      torch::rand({10}, torch::TensorOptions(torch::kFloat));
+  torch::Tensor output = std::get<0>(torch::embedding_bag(
+      weight, indices, offsets, /*scale_grad_by_freq=*/false, /*mode=*/0,
+      /*sparse=*/false, per_sample_weights));
+  ForEachDevice([&](const torch::Device& device) {
+    torch::Tensor xla_output = std::get<0>(torch::embedding_bag(
+        CopyToDevice(weight, device), CopyToDevice(indices, device),
+        CopyToDevice(offsets, device), /*scale_grad_by_freq=*/false,
+        /*mode=*/0, /*sparse=*/false,
+        CopyToDevice(per_sample_weights, device)));
+    AllClose(output, xla_output);
+  });
+}
+
 TEST_F(AtenXlaTensorTest, TestOneHot) {
   int num_classes = 5;
   torch::Tensor input =
@@ -4737,6 +5176,40 @@ TEST_F(AtenXlaTensorTest, TestNarrowUpdateTwoSlices) {
   }
 }
 
+TEST_F(AtenXlaTensorTest, TestNarrowFillOverwrite) {
+  torch::Tensor a = torch::zeros({8, 3}, torch::TensorOptions(torch::kFloat));
+  torch::Tensor a_copy = a.clone();
+  a.narrow(0, 2, 2).fill_(1.0);
+  a.narrow(0, 1, 4).fill_(2.0);
+  a.narrow(0, 5, 2).fill_(3.0);
+  a.narrow(1, 1, 1).narrow(0, 4, 2).fill_(4.0);
+  ForEachDevice([&](const torch::Device& device) {
+    torch::Tensor xla_a = CopyToDevice(a_copy, device);
+    xla_a.narrow(0, 2, 2).fill_(1.0);
+    xla_a.narrow(0, 1, 4).fill_(2.0);
+    xla_a.narrow(0, 5, 2).fill_(3.0);
+    xla_a.narrow(1, 1, 1).narrow(0, 4, 2).fill_(4.0);
+    AllClose(a, xla_a);
+  });
+}
+
+TEST_F(AtenXlaTensorTest, TestNarrowRingBufferUpdates) {
+  // More non overlapping updates than the alias keeps pending, followed by
+  // updates overwriting some of the older ones.
+  torch::Tensor a = torch::zeros({128, 4}, torch::TensorOptions(torch::kFloat));
+  torch::Tensor a_copy = a.clone();
+  for (int i = 0; i < 200; ++i) {
+    a.narrow(0, (i * 37) % 128, 1).fill_(i);
+  }
+  ForEachDevice([&](const torch::Device& device) {
+    torch::Tensor xla_a = CopyToDevice(a_copy, device);
+    for (int i = 0; i < 200; ++i) {
+      xla_a.narrow(0, (i * 37) % 128, 1).fill_(i);
+    }
+    AllClose(a, xla_a);
+  });
+}
+
 TEST_F(AtenXlaTensorTest, TestNarrowUpdateView) {
   for (xla::int64 dim : {0, -3}) {
     for (xla::int64 start : {2, -6}) {
@@ -4963,6 +5436,51 @@ TEST_F(AtenXlaTensorTest, TestMaxPool2D) {
   }
 }
 
+TEST_F(AtenXlaTensorTest, TestMaxPool2DWithIndices) {
+  // Integer values make the windows hold repeated maximums, whose first
+  // occurrence must be returned.
+  torch::Tensor input =
+      torch::randint(0, 8, {2, 4, 15, 15}, torch::TensorOptions(torch::kFloat));
+  int kernel_size = 3;
+  for (int stride = 1; stride <= 2; ++stride) {
+    for (int padding = 0; padding <= 1; ++padding) {
+      for (bool ceil_mode : {false, true}) {
+        auto outputs = torch::max_pool2d_with_indices(
+            input, /*kernel_size=*/{kernel_size, kernel_size},
+            /*stride=*/{stride, stride},
+            /*padding=*/{padding, padding}, /*dilation=*/{1, 1},
+            /*ceil_mode=*/ceil_mode);
+        ForEachDevice([&](const torch::Device& device) {
+          torch::Tensor xla_input = CopyToDevice(input, device);
+          auto xla_outputs = torch::max_pool2d_with_indices(
+              xla_input, /*kernel_size=*/{kernel_size, kernel_size},
+              /*stride=*/{stride, stride},
+              /*padding=*/{padding, padding}, /*dilation=*/{1, 1},
+              /*ceil_mode=*/ceil_mode);
+          AllClose(std::get<0>(outputs), std::get<0>(xla_outputs));
+          AllEqual(std::get<1>(outputs), std::get<1>(xla_outputs));
+        });
+      }
+    }
+  }
+}
+
+TEST_F(AtenXlaTensorTest, TestMaxPool3DWithIndices) {
+  torch::Tensor input = torch::randint(0, 8, {2, 3, 7, 8, 9},
+                                       torch::TensorOptions(torch::kFloat));
+  auto outputs = torch::max_pool3d_with_indices(
+      input, /*kernel_size=*/{2, 3, 3}, /*stride=*/{2, 2, 1},
+      /*padding=*/{1, 1, 0}, /*dilation=*/{1, 1, 1}, /*ceil_mode=*/false);
+  ForEachDevice([&](const torch::Device& device) {
+    torch::Tensor xla_input = CopyToDevice(input, device);
+    auto xla_outputs = torch::max_pool3d_with_indices(
+        xla_input, /*kernel_size=*/{2, 3, 3}, /*stride=*/{2, 2, 1},
+        /*padding=*/{1, 1, 0}, /*dilation=*/{1, 1, 1}, /*ceil_mode=*/false);
+    AllClose(std::get<0>(outputs), std::get<0>(xla_outputs));
+    AllEqual(std::get<1>(outputs), std::get<1>(xla_outputs));
+  });
+}
+
 TEST_F(AtenXlaTensorTest, TestMaxPool2DNonSquare) {
   torch::Tensor input =
       torch::rand({1, 64, 112, 112}, torch::TensorOptions(torch::kFloat));
@@ -5442,6 +5960,95 @@ TEST_F(AtenXlaTensorTest, TestAdaptiveAvgPool2DNoBatch) {
   }
 }
 
+TEST_F(AtenXlaTensorTest, TestUpsampleNearest2D) {
+  torch::Tensor input =
+      torch::rand({2, 3, 6, 6}, torch::TensorOptions(torch::kFloat));
+  // Integer upscaling and downscaling factors, and a generic resize.
+  for (auto& output_size : std::vector<std::vector<int64_t>>{
+           {12, 18}, {3, 2}, {7, 11}, {12, 5}}) {
+    torch::Tensor output = torch::upsample_nearest2d(input, output_size);
+    ForEachDevice([&](const torch::Device& device) {
+      torch::Tensor xla_input = CopyToDevice(input, device);
+      torch::Tensor xla_output =
+          torch::upsample_nearest2d(xla_input, output_size);
+      AllClose(output, xla_output);
+    });
+  }
+}
+
+TEST_F(AtenXlaTensorTest, TestUpsampleBilinear2D) {
+  torch::Tensor input =
+      torch::rand({2, 3, 6, 6}, torch::TensorOptions(torch::kFloat));
+  for (bool align_corners : {false, true}) {
+    for (auto& output_size :
+         std::vector<std::vector<int64_t>>{{12, 12}, {3, 4}, {7, 11}}) {
+      torch::Tensor output =
+          torch::upsample_bilinear2d(input, output_size, align_corners);
+      ForEachDevice([&](const torch::Device& device) {
+        torch::Tensor xla_input = CopyToDevice(input, device);
+        torch::Tensor xla_output =
+            torch::upsample_bilinear2d(xla_input, output_size, align_corners);
+        AllClose(output, xla_output);
+      });
+    }
+  }
+}
+
+TEST_F(AtenXlaTensorTest, TestAdaptiveAvgPool3D) {
+  torch::Tensor input =
+      torch::rand({2, 3, 9, 10, 11}, torch::TensorOptions(torch::kFloat));
+  for (int64_t output_size : {3, 4}) {
+    torch::Tensor output = torch::adaptive_avg_pool3d(
+        input, {output_size, output_size, output_size});
+    ForEachDevice([&](const torch::Device& device) {
+      torch::Tensor xla_input = CopyToDevice(input, device);
+      torch::Tensor xla_output = torch::adaptive_avg_pool3d(
+          xla_input, {output_size, output_size, output_size});
+      AllClose(output, xla_output);
+    });
+  }
+}
+
+TEST_F(AtenXlaTensorTest, TestAdaptiveMaxPool2D) {
+  torch::Tensor input =
+      torch::rand({4, 2, 13, 17}, torch::TensorOptions(torch::kFloat));
+  for (int64_t output_size : {5, 13}) {
+    auto outputs =
+        torch::adaptive_max_pool2d(input, {output_size, output_size});
+    ForEachDevice([&](const torch::Device& device) {
+      torch::Tensor xla_input = CopyToDevice(input, device);
+      auto xla_outputs =
+          torch::adaptive_max_pool2d(xla_input, {output_size, output_size});
+      AllClose(std::get<0>(outputs), std::get<0>(xla_outputs));
+      AllEqual(std::get<1>(outputs), std::get<1>(xla_outputs));
+    });
+  }
+}
+
+TEST_F(AtenXlaTensorTest, TestAdaptiveMaxPool3DNoBatch) {
+  torch::Tensor input =
+      torch::rand({3, 7, 8, 9}, torch::TensorOptions(torch::kFloat));
+  auto outputs = torch::adaptive_max_pool3d(input, {3, 4, 5});
+  ForEachDevice([&](const torch::Device& device) {
+    torch::Tensor xla_input = CopyToDevice(input, device);
+    auto xla_outputs = torch::adaptive_max_pool3d(xla_input, {3, 4, 5});
+    AllClose(std::get<0>(outputs), std::get<0>(xla_outputs));
+    AllEqual(std::get<1>(outputs), std::get<1>(xla_outputs));
+  });
+}
+
+TEST_F(AtenXlaTensorTest, TestAdaptiveMaxPool1D) {
+  torch::Tensor input =
+      torch::rand({2, 3, 10}, torch::TensorOptions(torch::kFloat));
+  auto outputs = torch::adaptive_max_pool1d(input, {4});
+  ForEachDevice([&](const torch::Device& device) {
+    torch::Tensor xla_input = CopyToDevice(input, device);
+    auto xla_outputs = torch::adaptive_max_pool1d(xla_input, {4});
+    AllClose(std::get<0>(outputs), std::get<0>(xla_outputs));
+    AllEqual(std::get<1>(outputs), std::get<1>(xla_outputs));
+  });
+}
+
 TEST_F(AtenXlaTensorTest, TestNllLoss) {
   int batch = 6;
   int classes = 2;
@@ -6679,6 +7286,40 @@ TEST_F(AtenXlaTensorTest, TestAsStridedWithInplaceCopy) {
   });
 }
 
+TEST_F(AtenXlaTensorTest, TestAsStridedPatterns) {
+  torch::Tensor input =
+      torch::rand({8, 8}, torch::TensorOptions(torch::kFloat));
+  // Transpose, diagonal, broadcast, strided slice, and sliding windows.
+  std::vector<std::vector<int64_t>> sizes = {
+      {8, 8}, {8}, {4, 3, 8}, {4, 2}, {13, 4}, {3, 3, 4, 4}};
+  std::vector<std::vector<int64_t>> strides = {
+      {1, 8}, {9}, {8, 0, 1}, {16, 3}, {4, 3}, {16, 2, 8, 1}};
+  for (size_t i = 0; i < sizes.size(); ++i) {
+    torch::Tensor output =
+        torch::as_strided(input, /*size=*/sizes[i], /*stride=*/strides[i]);
+    ForEachDevice([&](const torch::Device& device) {
+      torch::Tensor xla_input = CopyToDevice(input, device);
+      torch::Tensor xla_output = torch::as_strided(
+          xla_input, /*size=*/sizes[i], /*stride=*/strides[i]);
+      AllClose(output, xla_output);
+    });
+  }
+}
+
+TEST_F(AtenXlaTensorTest, TestAsStridedDiagonalCopy) {
+  torch::Tensor grad = torch::rand({4}, torch::TensorOptions(torch::kFloat));
+  std::vector<int64_t> size = {4};
+  std::vector<int64_t> stride = {5};
+  torch::Tensor output = torch::zeros({4, 4}, grad.options());
+  output.as_strided(size, stride).copy_(grad);
+  ForEachDevice([&](const torch::Device& device) {
+    torch::Tensor xla_grad = CopyToDevice(grad, device);
+    torch::Tensor xla_output = torch::zeros({4, 4}, xla_grad.options());
+    xla_output.as_strided(size, stride).copy_(xla_grad);
+    AllClose(output, xla_output);
+  });
+}
+
 TEST_F(AtenXlaTensorTest, TestEmptyStrided) {
   std::vector<int64_t> size = {4, 4, 2};
   std::vector<int64_t> stride = {8, 2, 1};
@@ -6843,6 +7484,71 @@ TEST_F(AtenXlaTensorTest, TestAdaptiveAvgPool2DNoBatchBackward) {
   }
 }
 
+TEST_F(AtenXlaTensorTest, TestUpsampleNearest2DBackward) {
+  // Integer upscaling and downscaling factors, and a generic resize.
+  for (auto& output_size : std::vector<std::vector<int64_t>>{
+           {12, 18}, {3, 2}, {7, 11}, {12, 5}}) {
+    auto testfn =
+        [&](const std::vector<torch::Tensor>& inputs) -> torch::Tensor {
+      return torch::upsample_nearest2d(inputs[0], output_size);
+    };
+    ForEachDevice([&](const torch::Device& device) {
+      TestBackward({torch::rand({2, 3, 6, 6},
+                                torch::TensorOptions(torch::kFloat)
+                                    .requires_grad(true))},
+                   device, testfn);
+    });
+  }
+}
+
+TEST_F(AtenXlaTensorTest, TestUpsampleBilinear2DBackward) {
+  for (bool align_corners : {false, true}) {
+    for (auto& output_size :
+         std::vector<std::vector<int64_t>>{{12, 12}, {3, 4}, {7, 11}}) {
+      auto testfn =
+          [&](const std::vector<torch::Tensor>& inputs) -> torch::Tensor {
+        return torch::upsample_bilinear2d(inputs[0], output_size,
+                                          align_corners);
+      };
+      ForEachDevice([&](const torch::Device& device) {
+        TestBackward({torch::rand({2, 3, 6, 6},
+                                  torch::TensorOptions(torch::kFloat)
+                                      .requires_grad(true))},
+                     device, testfn);
+      });
+    }
+  }
+}
+
+TEST_F(AtenXlaTensorTest, TestAdaptiveAvgPool3DBackward) {
+  auto testfn = [&](const std::vector<torch::Tensor>& inputs) -> torch::Tensor {
+    return torch::adaptive_avg_pool3d(inputs[0], {3, 4, 5});
+  };
+  ForEachDevice([&](const torch::Device& device) {
+    TestBackward(
+        {torch::rand({2, 3, 9, 10, 11},
+                     torch::TensorOptions(torch::kFloat).requires_grad(true))},
+        device, testfn);
+  });
+}
+
+TEST_F(AtenXlaTensorTest, TestAdaptiveMaxPool2DBackward) {
+  for (int64_t output_size : {5, 13}) {
+    auto testfn =
+        [&](const std::vector<torch::Tensor>& inputs) -> torch::Tensor {
+      return std::get<0>(
+          torch::adaptive_max_pool2d(inputs[0], {output_size, output_size}));
+    };
+    ForEachDevice([&](const torch::Device& device) {
+      TestBackward(
+          {torch::rand(
+              {4, 2, 13, 17},
+              torch::TensorOptions(torch::kFloat).requires_grad(true))},
+          device, testfn);
+    });
+  }
+}
+
 TEST_F(AtenXlaTensorTest, TestConv2DBackward) {
   int in_channels = 4;
   int out_channels = 8;
@@ -6883,6 +7589,31 @@ TEST_F(AtenXlaTensorTest, TestConv2DBackward) {
   }
 }
 
+TEST_F(AtenXlaTensorTest, TestDepthwiseConv2DBackward) {
+  int channels = 6;
+  for (int stride = 1; stride <= 2; ++stride) {
+    for (int channel_multiplier : {1, 2}) {
+      auto testfn =
+          [&](const std::vector<torch::Tensor>& inputs) -> torch::Tensor {
+        return torch::conv2d(inputs[0], inputs[1], /*bias=*/torch::Tensor(),
+                             /*stride=*/{stride, stride},
+                             /*padding=*/{1, 1},
+                             /*dilation=*/{1, 1}, /*groups=*/channels);
+      };
+      ForEachDevice([&](const torch::Device& device) {
+        TestBackward(
+            {torch::rand({3, channels, 15, 15},
+                         torch::TensorOptions(torch::kFloat).requires_grad(
+                             true)),
+             torch::rand({channels * channel_multiplier, 1, 3, 3},
+                         torch::TensorOptions(torch::kFloat).requires_grad(
+                             true))},
+            device, testfn);
+      });
+    }
+  }
+}
+
 TEST_F(AtenXlaTensorTest, TestTransposedConv2DBackward) {
   int in_channels = 4;
   int out_channels = 8;
@@ -7357,6 +8088,31 @@ TEST_F(AtenXlaTensorTest, TestNllLossBackward) {
   }
 }
 
+TEST_F(AtenXlaTensorTest, TestCrossEntropyBackward) {
+  int batch = 6;
+  int classes = 4;
+  for (int ignore_index : {-1, 1, 5}) {
+    torch::Tensor input =
+        torch::randn({batch, classes},
+                     torch::TensorOptions(torch::kFloat).requires_grad(true));
+    torch::Tensor target =
+        torch::randint(std::min(ignore_index, 0), classes, {batch},
+                       torch::TensorOptions(torch::kLong));
+    torch::Tensor undef_weight;
+    auto testfn =
+        [&](const std::vector<torch::Tensor>& inputs) -> torch::Tensor {
+      return torch::nll_loss(
+          /*self=*/torch::log_softmax(inputs[0], /*dim=*/1),
+          /*target=*/inputs[1], /*weight=*/undef_weight,
+          /*reduction=*/Reduction::Mean, /*ignore_index=*/ignore_index);
+    };
+    ForEachDevice([&](const torch::Device& device) {
+      TestBackward({input, target}, device, testfn, /*rtol=*/1e-5,
+                   /*atol=*/1e-8);
+    });
+  }
+}
+
 TEST_F(AtenXlaTensorTest, TestSmoothL1LossBackward) {
   torch::Tensor input = torch::randn(
       {2, 4}, torch::TensorOptions(torch::kFloat).requires_grad(true));
@@ -7547,5 +8303,57 @@ TEST_F(AtenXlaTensorTest, TestEmbeddingBackward) {
   }
 }
 
+TEST_F(AtenXlaTensorTest, TestEmbeddingBagBackward) {
+  int num_weights = 32;
+  torch::Tensor offsets =
+      torch::tensor({0, 3, 3, 7}, torch::TensorOptions(torch::kLong));
+  for (int64_t mode : {0, 1, 2}) {
+    for (bool scale_grad_by_freq : {false, true}) {
+      if (mode == 2 && scale_grad_by_freq) {
+        continue;
+      }
+      auto testfn =
+          [&](const std::vector<torch::Tensor>& inputs) -> torch::Tensor {
+        return std::get<0>(torch::embedding_bag(
+            inputs[0], inputs[1], inputs[2], scale_grad_by_freq, mode,
+            /*sparse=*/false, /*per_sample_weights=*/{}));
+      };
+      ForEachDevice([&](const torch::Device& device) {
+        torch::Tensor weight = torch::rand(
+            {num_weights, 7},
+            torch::TensorOptions(torch::kFloat).requires_grad(true));
+        torch::Tensor indices = torch::randint(
+            num_weights, {10}, torch::TensorOptions(torch::kLong));
+        TestBackward({weight, indices, offsets}, device, testfn,
+                     /*rtol=*/1e-5, /*atol=*/1e-7);
+      });
+    }
+  }
+}
+
+TEST_F(AtenXlaTensorTest, TestEmbeddingBagPerSampleWeightsBackward) {
+  int num_weights = 32;
+  // The second bag is empty.
+  torch::Tensor offsets =
+      torch::tensor({0, 3, 3, 7}, torch::TensorOptions(torch::kLong));
+  auto testfn = [&](const std::vector<torch::Tensor>& inputs) -> torch::Tensor {
+    return std::get<0>(torch::embedding_bag(
+        inputs[0], inputs[1], inputs[2], /*scale_grad_by_freq=*/false,
+        /*mode=*/0, /*sparse=*/false, inputs[3]));
+  };
+  ForEachDevice([&](const torch::Device& device) {
+    torch::Tensor weight = torch::rand(
+        {num_weights, 7},
+        torch::TensorOptions(torch::kFloat).requires_grad(true));
+    torch::Tensor indices =
+        torch::randint(num_weights, {10}, torch::TensorOptions(torch::kLong));
+    torch::Tensor per_sample_weights = torch::rand(
+        {10}, torch::TensorOptions(torch::kFloat).requires_grad(true));
+    // Both the weight and the per sample weights get their gradients.
+    TestBackward({weight, indices, offsets, per_sample_weights}, device,
+                 testfn, /*rtol=*/1e-5, /*atol=*/1e-7);
+  });
+}
+
 }  // namespace cpp_test
 }  // namespace torch_xla
@@ -0,0 +1,64 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "cpp_test_util.h"
+#include "torch_xla/csrc/data_sharding.h"
+
+namespace torch_xla {
+namespace cpp_test {
+
+TEST(DataShardingTest, DisjointShards) {
+  const xla::int64 kDatasetSize = 103;
+  const xla::int64 kShards = 4;
+  const xla::int64 kGranule = 8;
+  std::vector<xla::int64> all_indices;
+  for (bool shuffle : {false, true}) {
+    all_indices.clear();
+    for (xla::int64 i = 0; i < kShards; ++i) {
+      DataShardPosition position;
+      position.index = i;
+      position.count = kShards;
+      std::vector<xla::int64> indices = GetDataShardIndices(
+          position, kDatasetSize, /*seed=*/11, /*epoch=*/3, shuffle,
+          /*drop_last=*/false, kGranule);
+      // All the shards are padded to the same multiple of the granule.
+      EXPECT_EQ(indices.size(), 32);
+      EXPECT_EQ(indices, GetDataShardIndices(position, kDatasetSize, 11, 3,
+                                             shuffle, false, kGranule));
+      all_indices.insert(all_indices.end(), indices.begin(), indices.end());
+    }
+    std::sort(all_indices.begin(), all_indices.end());
+    all_indices.erase(std::unique(all_indices.begin(), all_indices.end()),
+                      all_indices.end());
+    EXPECT_EQ(all_indices.size(), kDatasetSize);
+  }
+}
+
+TEST(DataShardingTest, DropLast) {
+  DataShardPosition position;
+  position.index = 1;
+  position.count = 2;
+  std::vector<xla::int64> indices =
+      GetDataShardIndices(position, /*dataset_size=*/21, /*seed=*/0,
+                          /*epoch=*/0, /*shuffle=*/false,
+                          /*drop_last=*/true, /*granule=*/4);
+  std::vector<xla::int64> expected = {1, 3, 5, 7, 9, 11, 13, 15};
+  EXPECT_EQ(indices, expected);
+}
+
+TEST(DataShardingTest, EpochReshuffles) {
+  DataShardPosition position;
+  std::vector<xla::int64> epoch0 =
+      GetDataShardIndices(position, 64, 5, 0, true, false, 1);
+  std::vector<xla::int64> epoch1 =
+      GetDataShardIndices(position, 64, 5, 1, true, false, 1);
+  EXPECT_NE(epoch0, epoch1);
+  std::sort(epoch0.begin(), epoch0.end());
+  std::sort(epoch1.begin(), epoch1.end());
+  EXPECT_EQ(epoch0, epoch1);
+}
+
+}  // namespace cpp_test
+}  // namespace torch_xla
@@ -0,0 +1,66 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "tensorflow/compiler/xla/xla_client/metrics.h"
+#include "tensorflow/compiler/xla/xla_client/sys_util.h"
+#include "torch_xla/csrc/execution_scheduler.h"
+
+namespace torch_xla {
+namespace cpp_test {
+namespace {
+
+xla::int64 CounterValue(const std::string& name) {
+  xla::metrics::CounterData* counter = xla::metrics::GetCounter(name);
+  return counter != nullptr ? counter->Value() : 0;
+}
+
+}  // namespace
+
+TEST(ExecutionSchedulerTest, TestPriorityDispatchOrder) {
+  using Priority = ExecutionScheduler::Priority;
+  // A device no real execution uses, so that only this test dispatches to it.
+  const std::string device = "SCHEDULER_TEST:0";
+  size_t max_executions = std::max<xla::int64>(
+      xla::sys_util::GetEnvInt("XLA_DEVICE_MAX_EXECUTIONS", 1), 1);
+  ExecutionScheduler* scheduler = ExecutionScheduler::Get();
+  std::vector<xla::util::Cleanup<int>> slots;
+  for (size_t i = 0; i < max_executions; ++i) {
+    slots.push_back(scheduler->Acquire(device, Priority::kNormal));
+  }
+
+  xla::int64 waits = CounterValue("ExecutionSchedulerWaits");
+  std::mutex mutex;
+  std::vector<Priority> dispatch_order;
+  std::vector<std::thread> threads;
+  for (Priority priority :
+       {Priority::kLow, Priority::kNormal, Priority::kHigh}) {
+    threads.emplace_back([&, priority]() {
+      xla::util::Cleanup<int> slot = scheduler->Acquire(device, priority);
+      std::lock_guard<std::mutex> lock(mutex);
+      dispatch_order.push_back(priority);
+    });
+  }
+  // The waits are counted under the scheduler lock, before waiting.
+  while (CounterValue("ExecutionSchedulerWaits") < waits + 3) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  // With a single free slot, the executions get dispatched one at a time, as
+  // the previous one releases it.
+  slots.pop_back();
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  slots.clear();
+  EXPECT_EQ(dispatch_order,
+            std::vector<Priority>(
+                {Priority::kHigh, Priority::kNormal, Priority::kLow}));
+}
+
+}  // namespace cpp_test
+}  // namespace torch_xla
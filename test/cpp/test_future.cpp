@@ -0,0 +1,73 @@
+#include <gtest/gtest.h>
+
+#include <stdexcept>
+#include <vector>
+
+#include "cpp_test_util.h"
+#include "tensorflow/compiler/xla/xla_client/future.h"
+
+namespace torch_xla {
+namespace cpp_test {
+
+TEST(FutureTest, ThenChain) {
+  xla::util::Promise<int> promise;
+  auto result = promise.GetFuture()
+                    .Then([](const int& value) { return value * 2; })
+                    .Then([](const int& value) { return value + 1; });
+  EXPECT_FALSE(result.IsReady());
+  promise.SetValue(20);
+  EXPECT_TRUE(result.IsReady());
+  EXPECT_EQ(result.Get(), 41);
+}
+
+TEST(FutureTest, ThenOnReady) {
+  xla::util::Promise<int> promise;
+  promise.SetValue(3);
+  int seen = 0;
+  xla::util::Future<xla::util::Unit> result =
+      promise.GetFuture().Then([&](const int& value) { seen = value; });
+  result.Wait();
+  EXPECT_EQ(seen, 3);
+}
+
+TEST(FutureTest, ExceptionPropagation) {
+  xla::util::Promise<int> promise;
+  bool called = false;
+  auto result =
+      promise.GetFuture()
+          .Then([](const int& value) -> int {
+            throw std::runtime_error("Failed");
+          })
+          .Then([&](const int& value) {
+            called = true;
+            return value;
+          });
+  promise.SetValue(1);
+  EXPECT_THROW(result.Get(), std::runtime_error);
+  EXPECT_FALSE(called);
+}
+
+TEST(FutureTest, WhenAll) {
+  const int kFutures = 16;
+  std::vector<xla::util::Future<int>> futures;
+  for (int i = 0; i < kFutures; ++i) {
+    futures.push_back(xla::util::ScheduleIoFuture([i]() { return i * i; }));
+  }
+  std::vector<int> values = xla::util::WhenAll(std::move(futures)).Get();
+  ASSERT_EQ(values.size(), kFutures);
+  for (int i = 0; i < kFutures; ++i) {
+    EXPECT_EQ(values[i], i * i);
+  }
+}
+
+TEST(FutureTest, WhenAllFailure) {
+  std::vector<xla::util::Future<int>> futures;
+  futures.push_back(xla::util::ScheduleIoFuture([]() { return 1; }));
+  futures.push_back(xla::util::ScheduleIoFuture(
+      []() -> int { throw std::runtime_error("Failed"); }));
+  auto result = xla::util::WhenAll(std::move(futures));
+  EXPECT_THROW(result.Wait(), std::runtime_error);
+}
+
+}  // namespace cpp_test
+}  // namespace torch_xla
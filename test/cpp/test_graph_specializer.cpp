@@ -0,0 +1,92 @@
+#include <ATen/ATen.h>
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "cpp_test_util.h"
+#include "tensorflow/compiler/xla/xla_client/metrics.h"
+#include "tensorflow/compiler/xla/xla_client/sys_util.h"
+#include "torch_xla/csrc/graph_specializer.h"
+#include "torch_xla/csrc/tensor_util.h"
+#include "torch_xla_test.h"
+
+namespace torch_xla {
+namespace cpp_test {
+namespace {
+
+class GraphSpecializerTest : public TorchXlaTest {};
+
+xla::int64 CounterValue(const std::string& name) {
+  xla::metrics::CounterData* counter = xla::metrics::GetCounter(name);
+  return counter != nullptr ? counter->Value() : 0;
+}
+
+}  // namespace
+
+TEST_F(GraphSpecializerTest, TestSpecializeAndGuardFailure) {
+  size_t steps = std::max<xla::int64>(
+      xla::sys_util::GetEnvInt("XLA_SPECIALIZE_STEPS", 8), 1);
+  // The specializer state is process wide, so use a hash no real graph has.
+  size_t hash = 0x5eca11ed;
+  ForEachDevice([&](const Device& device) {
+    at::Tensor mask = at::rand({4}, at::TensorOptions(at::kFloat));
+    xla::ComputationClient::DataPtr mask_data = TensorToXlaData(mask, device);
+    xla::int64 specialized_graphs = CounterValue("SpecializedGraphs");
+    xla::int64 specialized_syncs = CounterValue("SpecializedSyncs");
+    xla::int64 guard_failures = CounterValue("SpecializationGuardFailures");
+    // The mask stays bound to the first parameter, while the second one gets
+    // new data at every sync.
+    auto sync = [&](const xla::ComputationClient::DataPtr& first) {
+      xla::ComputationClient::DataPtr input = TensorToXlaData(
+          at::rand({4}, at::TensorOptions(at::kFloat)), device);
+      return GraphSpecializer::Get()->OnSync(hash, {first, input},
+                                             /*buffer_aliases=*/{});
+    };
+    for (size_t i = 0; i + 1 < steps; ++i) {
+      EXPECT_EQ(sync(mask_data), nullptr);
+    }
+    auto specialization = sync(mask_data);
+    ASSERT_NE(specialization, nullptr);
+    EXPECT_NE(specialization->hash, hash);
+    EXPECT_EQ(specialization->parameters, std::vector<size_t>({0}));
+    ASSERT_EQ(specialization->values.size(), 1u);
+    EXPECT_EQ(specialization->values[0].Get<float>({2}),
+              mask[2].item<float>());
+    EXPECT_EQ(CounterValue("SpecializedGraphs"), specialized_graphs + 1);
+
+    EXPECT_EQ(sync(mask_data), specialization);
+    EXPECT_EQ(CounterValue("SpecializedSyncs"), specialized_syncs + 1);
+
+    // New mask data fails the guard, and the graph goes back to the generic
+    // computation, even once the original mask comes back.
+    xla::ComputationClient::DataPtr new_mask_data = TensorToXlaData(
+        at::rand({4}, at::TensorOptions(at::kFloat)), device);
+    EXPECT_EQ(sync(new_mask_data), nullptr);
+    EXPECT_EQ(CounterValue("SpecializationGuardFailures"), guard_failures + 1);
+    EXPECT_EQ(sync(mask_data), nullptr);
+    EXPECT_EQ(CounterValue("SpecializedSyncs"), specialized_syncs + 1);
+    EXPECT_EQ(CounterValue("SpecializedGraphs"), specialized_graphs + 1);
+    ++hash;
+  });
+}
+
+TEST_F(GraphSpecializerTest, TestDonatedParametersNotFolded) {
+  size_t steps = std::max<xla::int64>(
+      xla::sys_util::GetEnvInt("XLA_SPECIALIZE_STEPS", 8), 1);
+  size_t hash = 0xd0a7ed;
+  ForEachDevice([&](const Device& device) {
+    xla::ComputationClient::DataPtr data = TensorToXlaData(
+        at::rand({4}, at::TensorOptions(at::kFloat)), device);
+    for (size_t i = 0; i < steps; ++i) {
+      EXPECT_EQ(GraphSpecializer::Get()->OnSync(hash, {data},
+                                                /*buffer_aliases=*/{{0, 0}}),
+                nullptr);
+    }
+    ++hash;
+  });
+}
+
+}  // namespace cpp_test
+}  // namespace torch_xla
@@ -1,13 +1,33 @@
 #include <gtest/gtest.h>
 
+#include <algorithm>
+
 #include "cpp_test_util.h"
+#include "tensorflow/compiler/xla/shape_util.h"
+#include "torch_xla/csrc/cache_miss_explainer.h"
+#include "torch_xla/csrc/helpers.h"
 #include "torch_xla/csrc/ir.h"
+#include "torch_xla/csrc/ir_optimizer.h"
+#include "torch_xla/csrc/ir_util.h"
 #include "torch_xla/csrc/lowering_context.h"
 #include "torch_xla/csrc/ops/arithmetic_ir_ops.h"
+#include "torch_xla/csrc/ops/cat.h"
+#include "torch_xla/csrc/ops/expand.h"
+#include "torch_xla/csrc/ops/generic_slice.h"
+#include "torch_xla/csrc/ops/mean.h"
 #include "torch_xla/csrc/ops/ops.h"
+#include "torch_xla/csrc/ops/permute.h"
+#include "torch_xla/csrc/ops/prod.h"
 #include "torch_xla/csrc/ops/scalar.h"
 #include "torch_xla/csrc/ops/select.h"
+#include "torch_xla/csrc/ops/squeeze.h"
+#include "torch_xla/csrc/ops/stack.h"
+#include "torch_xla/csrc/ops/sum.h"
+#include "torch_xla/csrc/ops/topk.h"
 #include "torch_xla/csrc/ops/unselect.h"
+#include "torch_xla/csrc/ops/view.h"
+#include "torch_xla/csrc/python_util.h"
+#include "torch_xla/csrc/tensor_util.h"
 
 namespace torch_xla {
 namespace cpp_test {
@@ -54,6 +74,251 @@ TEST(IrTest, TestHash) {
   EXPECT_NE(add1->hash(), sub->hash());
 }
 
+TEST(IrTest, TestGraphSizeBound) {
+  ir::NodePtr scalar1 = ir::ops::ScalarOp(1.0, xla::F32);
+  ir::NodePtr scalar2 = ir::ops::ScalarOp(2.0, xla::F32);
+  ir::Value add = scalar1 + scalar2;
+  EXPECT_EQ(add->graph_size_bound(), 3);
+  EXPECT_EQ(ir::Util::GetGraphSize({add.node.get()}), 3);
+
+  // Shared nodes are accounted once per path in the bound.
+  ir::Value mul = add * add;
+  EXPECT_EQ(mul->graph_size_bound(), 7);
+  EXPECT_EQ(ir::Util::GetGraphSize({mul.node.get()}), 4);
+}
+
+TEST(IrTest, TestOptimizer) {
+  ir::NodePtr scalar1 = ir::ops::ScalarOp(1.0, xla::F32);
+  ir::NodePtr scalar2 = ir::ops::ScalarOp(2.0, xla::F32);
+  ir::Value add1 = scalar1 + scalar2;
+  ir::Value add2 = scalar1 + scalar2;
+  ir::Value exp1 = ir::ops::Exp(add1);
+  ir::Value exp2 = ir::ops::Exp(add2);
+  ir::Value mul = exp1 * exp2;
+
+  std::vector<const ir::Node*> post_order =
+      ir::Util::ComputePostOrder({mul.node.get()});
+  ir::Optimizer optimizer(post_order);
+  // Both additions get folded into the same scalar, and the second
+  // exponential is merged into the first one.
+  const ir::Node* folded = optimizer.GetReplacement(add1.node.get());
+  ASSERT_TRUE(folded != nullptr);
+  EXPECT_EQ(optimizer.GetReplacement(add2.node.get()), folded);
+  const ir::ops::Scalar* folded_scalar =
+      dynamic_cast<const ir::ops::Scalar*>(folded);
+  ASSERT_TRUE(folded_scalar != nullptr);
+  EXPECT_EQ(folded_scalar->value().toDouble(), 3.0);
+  EXPECT_EQ(optimizer.GetReplacement(exp2.node.get()), exp1.node.get());
+  EXPECT_EQ(optimizer.GetReplacement(exp1.node.get()), nullptr);
+  EXPECT_EQ(optimizer.GetReplacement(mul.node.get()), nullptr);
+  EXPECT_EQ(optimizer.num_folded(), 2);
+  EXPECT_EQ(optimizer.num_merged(), 2);
+}
+
+TEST(IrTest, TestLowerCachingSubgraphs) {
+  ForEachDevice([&](const Device& device) {
+    at::Tensor a = at::rand({4, 3}, at::TensorOptions(at::kFloat));
+    at::Tensor b = at::rand({4, 3}, at::TensorOptions(at::kFloat));
+    ir::Value v_a = GetTensorIrValue(a, device);
+    ir::Value v_b = GetTensorIrValue(b, device);
+    ir::Value v_ea = ir::ops::Exp(v_a) * v_a + v_a;
+    ir::Value v_eb = ir::ops::Exp(v_b) * v_b + v_b;
+    ir::Value v_r = v_ea - v_eb;
+
+    std::vector<const ir::Node*> roots({v_r.node.get()});
+    ir::LoweringContext lowering_ctx("LowerCachingSubgraphs");
+    lowering_ctx.LowerCachingSubgraphs(ir::Util::ComputePostOrder(roots),
+                                       roots, /*min_nodes=*/3);
+    EXPECT_EQ(lowering_ctx.num_reused_subgraphs(), 1);
+    lowering_ctx.AddResult(lowering_ctx.GetOutputOp(v_r));
+    xla::XlaComputation computation = ConsumeValue(lowering_ctx.Build());
+    xla::ProgramShape program_shape =
+        ConsumeValue(computation.GetProgramShape());
+    EXPECT_EQ(program_shape.parameters_size(), 2);
+  });
+}
+
+TEST(IrTest, TestLowerParallel) {
+  ForEachDevice([&](const Device& device) {
+    at::Tensor a = at::rand({4, 3}, at::TensorOptions(at::kFloat));
+    at::Tensor b = at::rand({4, 3}, at::TensorOptions(at::kFloat));
+    ir::Value v_a = GetTensorIrValue(a, device);
+    ir::Value v_b = GetTensorIrValue(b, device);
+    // The two roots only share the device data of a, so they get lowered by
+    // separate tasks.
+    ir::Value v_r1 = ir::ops::Exp(v_a) * v_a;
+    ir::Value v_r2 = ir::ops::Exp(v_b) + v_a;
+
+    std::vector<const ir::Node*> roots({v_r1.node.get(), v_r2.node.get()});
+    ir::LoweringContext lowering_ctx("LowerParallel");
+    lowering_ctx.LowerParallel(ir::Util::ComputePostOrder(roots), roots,
+                               /*num_tasks=*/2);
+    lowering_ctx.AddResult(lowering_ctx.GetOutputOp(v_r1));
+    lowering_ctx.AddResult(lowering_ctx.GetOutputOp(v_r2));
+    xla::XlaComputation computation = ConsumeValue(lowering_ctx.Build());
+    xla::ProgramShape program_shape =
+        ConsumeValue(computation.GetProgramShape());
+    EXPECT_EQ(program_shape.parameters_size(), 2);
+    EXPECT_EQ(lowering_ctx.GetParametersData().size(), 2);
+  });
+}
+
+TEST(IrTest, TestLiveness) {
+  ForEachDevice([&](const Device& device) {
+    at::Tensor a = at::rand({4, 3}, at::TensorOptions(at::kFloat));
+    ir::Value v_a = GetTensorIrValue(a, device);
+    ir::Value v_exp = ir::ops::Exp(v_a);
+    ir::Value v_r = v_exp * v_a;
+
+    std::vector<const ir::Node*> roots({v_r.node.get()});
+    std::vector<const ir::Node*> post_order = ir::Util::ComputePostOrder(roots);
+    ir::Util::Liveness liveness = ir::Util::ComputeLiveness(post_order, roots);
+    ASSERT_EQ(liveness.live_bytes.size(), post_order.size());
+    xla::int64 bytes = 4 * 3 * sizeof(float);
+    // The device data is not accounted for, and the exponential is released
+    // once the multiplication, which is kept as root, is computed.
+    EXPECT_EQ(*std::max_element(liveness.live_bytes.begin(),
+                                liveness.live_bytes.end()),
+              2 * bytes);
+    EXPECT_EQ(liveness.live_bytes.back(), 2 * bytes);
+    EXPECT_EQ(liveness.resident_bytes.back(), bytes);
+    EXPECT_EQ(liveness.last_uses.back(), post_order.size());
+  });
+}
+
+TEST(IrTest, TestSegmentCuts) {
+  ir::Util::Liveness liveness;
+  liveness.resident_bytes.assign(16, 100);
+  liveness.resident_bytes[9] = 10;
+  // The cut goes where the fewest bytes are resident, near the middle.
+  EXPECT_EQ(ir::Util::ComputeSegmentCuts(liveness, 16, 2),
+            std::vector<size_t>({9}));
+
+  liveness.resident_bytes.assign(16, 100);
+  liveness.resident_bytes[8] = 10;
+  EXPECT_EQ(ir::Util::ComputeSegmentCuts(liveness, 16, 4),
+            std::vector<size_t>({3, 8, 11}));
+  // No cut fits within a graph too small for the segments.
+  EXPECT_TRUE(ir::Util::ComputeSegmentCuts(liveness, 1, 2).empty());
+}
+
+TEST(IrTest, TestSegments) {
+  ForEachDevice([&](const Device& device) {
+    at::Tensor a = at::rand({4, 3}, at::TensorOptions(at::kFloat));
+    ir::Value v_a = GetTensorIrValue(a, device);
+    ir::Value v_exp = ir::ops::Exp(v_a);
+    ir::NodePtr topk = ir::MakeNode<ir::ops::TopK>(
+        v_exp, /*k=*/2, /*dim=*/1, /*largest=*/true, /*sorted=*/true);
+    ir::Value v_r = ir::ops::Exp(ir::Value(topk, 0));
+    ir::NodePtr scalar = ir::ops::ScalarOp(1.0, xla::F32);
+
+    std::vector<const ir::Node*> post_order = ir::Util::ComputePostOrder(
+        {v_r.node.get(), topk.get(), scalar.get()});
+    ASSERT_EQ(post_order.size(), 5u);
+    // The first segment computes both the TopK outputs, the values for the
+    // second segment, and the indices for the roots. The scalar root is a
+    // leaf, computed by the last segment.
+    std::vector<ir::Output> roots(
+        {ir::Output(v_r.node.get()), ir::Output(topk.get(), 1),
+         ir::Output(scalar.get())});
+    ir::Util::Segments segments =
+        ir::Util::ComputeSegments(post_order, {2}, roots);
+    EXPECT_EQ(segments.node_segments.size(), 3u);
+    EXPECT_EQ(segments.node_segments.count(v_a.node.get()), 0u);
+    EXPECT_EQ(segments.node_segments.at(topk.get()), 0u);
+    EXPECT_EQ(segments.node_segments.at(v_r.node.get()), 1u);
+    ASSERT_EQ(segments.inputs[0].size(), 0u);
+    ASSERT_EQ(segments.inputs[1].size(), 1u);
+    EXPECT_EQ(segments.inputs[1][0], ir::Output(topk.get(), 0));
+    ASSERT_EQ(segments.outputs[0].size(), 2u);
+    EXPECT_EQ(segments.outputs[0][0], ir::Output(topk.get(), 0));
+    EXPECT_EQ(segments.outputs[0][1], ir::Output(topk.get(), 1));
+    ASSERT_EQ(segments.outputs[1].size(), 2u);
+    EXPECT_EQ(segments.outputs[1][0], ir::Output(v_r.node.get()));
+    EXPECT_EQ(segments.outputs[1][1], ir::Output(scalar.get()));
+    std::vector<std::pair<size_t, size_t>> root_outputs(
+        {{1, 0}, {0, 1}, {1, 1}});
+    EXPECT_EQ(segments.root_outputs, root_outputs);
+  });
+}
+
+TEST(IrTest, TestMatMulExternalPermute) {
+  ForEachDevice([&](const Device& device) {
+    at::Tensor a = at::rand({4, 3}, at::TensorOptions(at::kFloat));
+    at::Tensor b = at::rand({4, 5}, at::TensorOptions(at::kFloat));
+    ir::Value v_a = GetTensorIrValue(a, device);
+    ir::Value v_b = GetTensorIrValue(b, device);
+    ir::NodePtr permute =
+        ir::MakeNode<ir::ops::Permute>(v_a, std::vector<xla::int64>{1, 0});
+    ir::Value v_dot = ir::ops::Dot(permute, v_b);
+
+    // The permute bound to a parameter has no source to fold into the matmul,
+    // which must not lower the graph behind it.
+    xla::ComputationClient::DataPtr placeholder =
+        xla::ComputationClient::Get()->CreateDataPlaceholder(device.ToString(),
+                                                             permute->shape());
+    ir::LoweringContext lowering_ctx("MatMulExternalPermute");
+    lowering_ctx.AssignExternalOutputOp(
+        ir::Output(permute.get()), lowering_ctx.GetParameter(placeholder));
+    lowering_ctx.AddResult(lowering_ctx.GetOutputOp(v_dot));
+    xla::XlaComputation computation = ConsumeValue(lowering_ctx.Build());
+    xla::ProgramShape program_shape =
+        ConsumeValue(computation.GetProgramShape());
+    EXPECT_EQ(program_shape.parameters_size(), 2);
+    ASSERT_EQ(lowering_ctx.GetParametersData().size(), 2u);
+    EXPECT_EQ(lowering_ctx.GetParametersData()[0]->unique_id(),
+              placeholder->unique_id());
+  });
+}
+
+TEST(IrTest, TestCacheMissExplainer) {
+  ForEachDevice([&](const Device& device) {
+    at::Tensor a = at::rand({4, 3}, at::TensorOptions(at::kFloat));
+    ir::Value v_a = GetTensorIrValue(a, device);
+    ir::Value v_r1 = ir::ops::Exp(v_a) * ir::ops::ScalarOp(2.0, xla::F32);
+    ir::Value v_r2 = ir::ops::Exp(v_a) * ir::ops::ScalarOp(3.0, xla::F32);
+
+    CacheMissExplainer explainer;
+    std::string explanation = explainer.ExplainMiss(1, {v_r1.node.get()});
+    EXPECT_NE(explanation.find("No recently compiled graph"),
+              std::string::npos);
+    explanation = explainer.ExplainMiss(2, {v_r2.node.get()});
+    EXPECT_NE(explanation.find("Nearest compiled graph: 1 "),
+              std::string::npos);
+    // The scalar and its user differ.
+    EXPECT_NE(explanation.find("First nodes not in the compiled graph"),
+              std::string::npos);
+    EXPECT_EQ(explainer.GetExplanations().size(), 2);
+  });
+}
+
+TEST(IrTest, TestLowerCachingSubgraphsChain) {
+  ForEachDevice([&](const Device& device) {
+    // A chain of identical layers over different weights, where every layer
+    // consumes the output of the previous one.
+    at::Tensor x = at::rand({4, 3}, at::TensorOptions(at::kFloat));
+    ir::Value v_h = GetTensorIrValue(x, device);
+    const int num_layers = 4;
+    for (int i = 0; i < num_layers; ++i) {
+      at::Tensor w = at::rand({4, 3}, at::TensorOptions(at::kFloat));
+      at::Tensor b = at::rand({4, 3}, at::TensorOptions(at::kFloat));
+      v_h = ir::ops::Tanh(v_h * GetTensorIrValue(w, device) +
+                          GetTensorIrValue(b, device));
+    }
+
+    std::vector<const ir::Node*> roots({v_h.node.get()});
+    ir::LoweringContext lowering_ctx("LowerCachingSubgraphsChain");
+    lowering_ctx.LowerCachingSubgraphs(ir::Util::ComputePostOrder(roots),
+                                       roots, /*min_nodes=*/3);
+    EXPECT_EQ(lowering_ctx.num_reused_subgraphs(), num_layers - 1);
+    lowering_ctx.AddResult(lowering_ctx.GetOutputOp(v_h));
+    xla::XlaComputation computation = ConsumeValue(lowering_ctx.Build());
+    xla::ProgramShape program_shape =
+        ConsumeValue(computation.GetProgramShape());
+    EXPECT_EQ(program_shape.parameters_size(), 1 + 2 * num_layers);
+  });
+}
+
 TEST(IrTest, TestSelectUnselect) {
   ForEachDevice([&](const Device& device) {
     at::Tensor a =
@@ -83,5 +348,93 @@ TEST(IrTest, TestSelectUnselect) {
   });
 }
 
+TEST(IrTest, TestUnpackBits) {
+  ForEachDevice([&](const Device& device) {
+    // A rank 3 mask whose element count is not a multiple of the 32 bits
+    // words, so the last word is partially used.
+    at::Tensor mask = at::rand({3, 7, 5}, at::TensorOptions(at::kFloat)) > 0.5;
+    at::Tensor words = PackBoolTensor(mask);
+    EXPECT_EQ(words.numel(), 4);
+    ir::Value v_words = GetTensorIrValue(words, device);
+    ir::Value v_mask = ir::ops::UnpackBits(
+        v_words,
+        xla::ShapeUtil::MakeShape(xla::PrimitiveType::PRED, {3, 7, 5}));
+    auto results = ExecuteAndFetch({v_mask}, device);
+    EXPECT_TRUE(EqualValuesNoElementTypeCheck(results.front(), mask));
+  });
+}
+
+TEST(IrTest, TestNodeShapeInference) {
+  // The shapes computed by the nodes must match the ones of their lowerings.
+  ir::Value v_f = ir::ops::ScalarOp(
+      1.0, xla::ShapeUtil::MakeShape(xla::PrimitiveType::F32, {4, 1, 3}));
+  ir::Value v_i = ir::ops::ScalarOp(
+      1.0, xla::ShapeUtil::MakeShape(xla::PrimitiveType::S32, {3}));
+  ir::Value v_p = ir::ops::ScalarOp(
+      1.0, xla::ShapeUtil::MakeShape(xla::PrimitiveType::PRED, {4, 1, 3}));
+  std::vector<ir::NodePtr> nodes = {
+      ir::ops::Max(v_f, v_i),
+      ir::ops::Pow(v_i, v_p),
+      ir::ops::ReluOp(v_f),
+      ir::MakeNode<ir::ops::View>(v_f, std::vector<xla::int64>{-1, 2}),
+      ir::MakeNode<ir::ops::Permute>(v_f, std::vector<xla::int64>{2, 0, 1}),
+      ir::MakeNode<ir::ops::Expand>(v_f, std::vector<xla::int64>{2, 4, 5, 3}),
+      ir::MakeNode<ir::ops::Squeeze>(v_f, /*dim=*/-1),
+      ir::MakeNode<ir::ops::Squeeze>(v_f, /*dim=*/1),
+      ir::MakeNode<ir::ops::Squeeze>(v_f, /*dim=*/2),
+      ir::MakeNode<ir::ops::Cat>(std::vector<ir::Value>{v_f, v_f, v_f},
+                                 /*dim=*/1),
+      ir::MakeNode<ir::ops::Stack>(std::vector<ir::Value>{v_f, v_f},
+                                   /*dim=*/3),
+      ir::MakeNode<ir::ops::GenericSlice>(v_f,
+                                          std::vector<xla::int64>{1, 0, 1},
+                                          std::vector<xla::int64>{2, 1, 2}),
+      ir::MakeNode<ir::ops::Sum>(v_p, std::vector<xla::int64>{0, 2},
+                                 /*keep_reduced_dimensions=*/false,
+                                 /*dtype=*/c10::nullopt),
+      ir::MakeNode<ir::ops::Sum>(v_f, std::vector<xla::int64>{1},
+                                 /*keep_reduced_dimensions=*/true,
+                                 at::ScalarType::Double),
+      ir::MakeNode<ir::ops::Mean>(v_f, std::vector<xla::int64>{0, 1},
+                                  /*keep_reduced_dimensions=*/true,
+                                  /*dtype=*/c10::nullopt),
+      ir::MakeNode<ir::ops::Prod>(v_p, std::vector<xla::int64>{2},
+                                  /*keep_reduced_dimensions=*/false,
+                                  at::ScalarType::Long),
+  };
+  for (auto& node : nodes) {
+    ir::LoweringContext lowering_ctx("NodeShapeInference");
+    xla::XlaOp op = lowering_ctx.GetOutputOp(ir::Output(node.get(), 0));
+    EXPECT_TRUE(
+        xla::ShapeUtil::Compatible(XlaHelpers::ShapeOfXlaOp(op), node->shape()))
+        << node->ToString() << ": " << XlaHelpers::ShapeOfXlaOp(op) << " vs. "
+        << node->shape();
+  }
+}
+
+TEST(IrTest, TestInternFrames) {
+  SourceLocation loc;
+  loc.file = "model.py";
+  loc.function = "forward";
+  loc.line = 42;
+  const std::vector<SourceLocation>* frames1 = InternFrames({loc});
+  const std::vector<SourceLocation>* frames2 = InternFrames({loc});
+  EXPECT_EQ(frames1, frames2);
+  loc.line = 43;
+  const std::vector<SourceLocation>* frames3 = InternFrames({loc});
+  EXPECT_NE(frames1, frames3);
+  EXPECT_EQ(frames3->front().line, 43);
+
+  // The frames set on a node are never replaced.
+  ir::NodePtr scalar = ir::ops::ScalarOp(1.0, xla::F32);
+  const std::vector<SourceLocation>* frames = scalar->metadata().frame_info;
+  if (frames == nullptr) {
+    frames = frames1;
+  }
+  scalar->SetFrameInfo(frames1);
+  scalar->SetFrameInfo(frames3);
+  EXPECT_EQ(scalar->metadata().frame_info, frames);
+}
+
 }  // namespace cpp_test
 }  // namespace torch_xla
@@ -0,0 +1,24 @@
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "cpp_test_util.h"
+#include "tensorflow/compiler/xla/shape_util.h"
+#include "tensorflow/compiler/xla/xla_client/util.h"
+#include "torch_xla/csrc/layout_manager.h"
+
+namespace torch_xla {
+namespace cpp_test {
+
+TEST(LayoutManagerTest, ChannelsLastLayout) {
+  xla::Shape shape =
+      MakeChannelsLastLayout({8, 3, 32, 16}, xla::PrimitiveType::F32);
+  EXPECT_EQ(xla::util::ToVector<xla::int64>(shape.layout().minor_to_major()),
+            std::vector<xla::int64>({1, 3, 2, 0}));
+  shape = MakeChannelsLastLayout({8, 3, 4, 32, 16}, xla::PrimitiveType::F32);
+  EXPECT_EQ(xla::util::ToVector<xla::int64>(shape.layout().minor_to_major()),
+            std::vector<xla::int64>({1, 4, 3, 2, 0}));
+}
+
+}  // namespace cpp_test
+}  // namespace torch_xla
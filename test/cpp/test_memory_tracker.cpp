@@ -0,0 +1,43 @@
+#include <gtest/gtest.h>
+
+#include "cpp_test_util.h"
+#include "tensorflow/compiler/xla/shape_util.h"
+#include "tensorflow/compiler/xla/xla_client/memory_tracker.h"
+
+namespace torch_xla {
+namespace cpp_test {
+
+TEST(MemoryTrackerTest, LiveAndPeakBytes) {
+  xla::MemoryTracker tracker;
+  int key1 = 0;
+  int key2 = 0;
+  tracker.Allocate(&key1, "TPU:0", xla::ShapeUtil::MakeShape(xla::F32, {4, 8}),
+                   xla::MemoryTracker::Category::kInput);
+  tracker.Allocate(&key2, "TPU:0", xla::ShapeUtil::MakeShape(xla::F32, {16}),
+                   xla::MemoryTracker::Category::kActivation);
+  tracker.SetCategory(&key1, xla::MemoryTracker::Category::kParameter);
+  tracker.Free(&key2);
+
+  auto stats = tracker.GetDeviceStats().at("TPU:0");
+  EXPECT_EQ(stats.live_bytes, 4 * 8 * 4);
+  EXPECT_EQ(stats.peak_bytes, 4 * 8 * 4 + 16 * 4);
+  EXPECT_EQ(stats.live_allocations, 1);
+  EXPECT_EQ(stats.category_bytes[static_cast<int>(
+                xla::MemoryTracker::Category::kParameter)],
+            4 * 8 * 4);
+  EXPECT_EQ(stats.category_bytes[static_cast<int>(
+                xla::MemoryTracker::Category::kInput)],
+            0);
+
+  auto allocations = tracker.GetLargestAllocations(10, "TPU:0");
+  ASSERT_EQ(allocations.size(), 1);
+  EXPECT_EQ(allocations.front().bytes, 4 * 8 * 4);
+
+  tracker.ResetPeaks();
+  EXPECT_EQ(tracker.GetDeviceStats().at("TPU:0").peak_bytes, 4 * 8 * 4);
+  EXPECT_EQ(xla::MemoryTracker::ParseCategory("optimizer_state"),
+            xla::MemoryTracker::Category::kOptimizerState);
+}
+
+}  // namespace cpp_test
+}  // namespace torch_xla
@@ -0,0 +1,42 @@
+#include <gtest/gtest.h>
+
+#include <cstdlib>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+#include "cpp_test_util.h"
+#include "tensorflow/compiler/xla/xla_client/mesh_service.h"
+#include "tensorflow/compiler/xla/xla_client/sys_util.h"
+
+namespace torch_xla {
+namespace cpp_test {
+
+TEST(MeshServiceTest, CompileCacheFingerprints) {
+  // The mesh client is a process wide singleton, so bring up a local service
+  // only when the tests are not already running within a mesh.
+  if (!xla::sys_util::GetEnvString("XRT_MESH_SERVICE_ADDRESS", "").empty()) {
+    return;
+  }
+  std::string address = absl::StrCat(
+      "localhost:",
+      xla::sys_util::GetEnvInt("XLA_TEST_MESH_SERVICE_PORT", 48127));
+  xla::service::grpc::Config config;
+  config.mutable_proto();
+  xla::service::MeshService service(address, std::move(config));
+  setenv("XRT_MESH_SERVICE_ADDRESS", address.c_str(), 1);
+  const xla::service::MeshClient* client = xla::service::MeshClient::Get();
+  ASSERT_NE(client, nullptr);
+
+  EXPECT_EQ(client->PublishCompilations({"a", "b"}),
+            std::vector<bool>({true, true}));
+  // Only the first host publishing a fingerprint stores it.
+  EXPECT_EQ(client->PublishCompilations({"b", "c"}),
+            std::vector<bool>({false, true}));
+  EXPECT_EQ(client->LookupCompilations({"a", "x", "c"}),
+            std::vector<bool>({true, false, true}));
+}
+
+}  // namespace cpp_test
+}  // namespace torch_xla
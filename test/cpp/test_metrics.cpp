@@ -0,0 +1,106 @@
+#include <gtest/gtest.h>
+
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "cpp_test_util.h"
+#include "tensorflow/compiler/xla/xla_client/metrics.h"
+#include "tensorflow/compiler/xla/xla_client/tracing.h"
+
+namespace torch_xla {
+namespace cpp_test {
+
+TEST(MetricsTest, ShardedSamples) {
+  const int kThreads = 8;
+  const int kSamplesPerThread = 1000;
+  xla::metrics::MetricData data(xla::metrics::MetricFnValue,
+                                /*max_samples=*/100);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kThreads; ++t) {
+    threads.emplace_back([&, t]() {
+      for (int i = 1; i <= kSamplesPerThread; ++i) {
+        data.AddSample(t * kSamplesPerThread + i, i);
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  double accumulator = 0.0;
+  size_t total_samples = 0;
+  std::vector<xla::metrics::Sample> samples =
+      data.Samples(&accumulator, &total_samples);
+  EXPECT_EQ(total_samples, kThreads * kSamplesPerThread);
+  EXPECT_EQ(data.TotalSamples(), kThreads * kSamplesPerThread);
+  EXPECT_DOUBLE_EQ(accumulator,
+                   kThreads * kSamplesPerThread * (kSamplesPerThread + 1) / 2);
+  EXPECT_EQ(samples.size(), 100);
+  for (size_t i = 1; i < samples.size(); ++i) {
+    EXPECT_LE(samples[i - 1].timestamp_ns, samples[i].timestamp_ns);
+  }
+}
+
+TEST(MetricsTest, ShardedCounter) {
+  const int kThreads = 8;
+  const int kAddsPerThread = 10000;
+  xla::metrics::CounterData data;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kThreads; ++t) {
+    threads.emplace_back([&]() {
+      for (int i = 0; i < kAddsPerThread; ++i) {
+        data.AddValue(2);
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(data.Value(), 2 * kThreads * kAddsPerThread);
+}
+
+TEST(MetricsTest, HistogramPercentiles) {
+  xla::metrics::MetricData data(xla::metrics::MetricFnValue,
+                                /*max_samples=*/0);
+  for (int i = 1; i <= 10000; ++i) {
+    data.AddSample(i, i);
+  }
+  EXPECT_TRUE(data.Samples(nullptr, nullptr).empty());
+  // The log-scale buckets are a quarter of an octave wide, so the estimates
+  // are within ~20% of the exact percentiles.
+  EXPECT_NEAR(data.HistogramPercentile(0.5), 5000, 1000);
+  EXPECT_NEAR(data.HistogramPercentile(0.9), 9000, 1800);
+  EXPECT_NEAR(data.HistogramPercentile(0.99), 9900, 2000);
+}
+
+TEST(MetricsTest, ChromeTrace) {
+  xla::tracing::Clear();
+  xla::tracing::SetEnabled(true);
+  { XLA_TRACE_SCOPE("test", "TracedScope"); }
+  xla::tracing::SetEnabled(false);
+  { XLA_TRACE_SCOPE("test", "UntracedScope"); }
+  std::string trace = xla::tracing::DumpChromeTrace();
+  EXPECT_NE(trace.find("\"name\":\"TracedScope\""), std::string::npos);
+  EXPECT_EQ(trace.find("UntracedScope"), std::string::npos);
+  xla::tracing::Clear();
+  EXPECT_EQ(xla::tracing::DumpChromeTrace().find("TracedScope"),
+            std::string::npos);
+}
+
+TEST(MetricsTest, OpenMetricsReport) {
+  XLA_COUNTER("OpenMetrics.Test", 3);
+  static xla::metrics::Metric* metric =
+      new xla::metrics::Metric("OpenMetricsTest");
+  metric->AddSample(2.0);
+  std::string report = xla::metrics::CreateOpenMetricsReport();
+  EXPECT_NE(report.find("# TYPE xla_OpenMetrics_Test counter\n"
+                        "xla_OpenMetrics_Test_total 3\n"),
+            std::string::npos);
+  EXPECT_NE(report.find("# TYPE xla_OpenMetricsTest summary\n"),
+            std::string::npos);
+  EXPECT_NE(report.find("xla_OpenMetricsTest_count 1\n"), std::string::npos);
+  EXPECT_EQ(report.substr(report.size() - 6), "# EOF\n");
+}
+
+}  // namespace cpp_test
+}  // namespace torch_xla
@@ -4,6 +4,7 @@
 #include "torch_xla/csrc/ir.h"
 #include "torch_xla/csrc/op_by_op_executor.h"
 #include "torch_xla/csrc/ops/arithmetic_ir_ops.h"
+#include "torch_xla/csrc/ops/index_select.h"
 #include "torch_xla/csrc/ops/ops.h"
 #include "torch_xla/csrc/ops/scalar.h"
 #include "torch_xla/csrc/ops/stack.h"
@@ -68,5 +69,57 @@ TEST(OpByOpExecutorTest, TestAsyncStack) {
   });
 }
 
+TEST(OpByOpExecutorTest, TestHybridIndexSelect) {
+  ForEachDevice([&](const Device& device) {
+    at::Tensor a = at::rand({4, 8, 3}, at::TensorOptions(at::kFloat));
+    at::Tensor b = at::rand({4, 8, 3}, at::TensorOptions(at::kFloat));
+    at::Tensor index = at::randint(0, 4, {6}, at::TensorOptions(at::kLong));
+    at::Tensor c = a + b;
+    at::Tensor select = at::index_select(c, 0, index);
+    at::Tensor d = select * select;
+
+    ir::Value v_a = GetTensorIrValue(a, device);
+    ir::Value v_b = GetTensorIrValue(b, device);
+    ir::Value v_index = GetTensorIrValue(index, device);
+    ir::Value v_c = v_a + v_b;
+    ir::Value v_select = ir::MakeNode<ir::ops::IndexSelect>(v_c, 0, v_index);
+    ir::Value v_d = v_select * v_select;
+
+    OpByOpExecutor* executor = OpByOpExecutor::Get();
+    bool hybrid_mode = executor->IsHybridMode();
+    executor->SetHybridMode(true);
+    auto results_data = executor->Execute({v_c, v_d}, device.ToString(), {});
+    executor->SetHybridMode(hybrid_mode);
+    auto results = Fetch(results_data);
+
+    AllClose(results[0], c);
+    AllClose(results[1], d);
+  });
+}
+
+TEST(OpByOpExecutorTest, TestHybridFusedParameters) {
+  ForEachDevice([&](const Device& device) {
+    at::Tensor a = at::rand({4, 8, 3}, at::TensorOptions(at::kFloat));
+    at::Tensor b = at::rand({4, 8, 3}, at::TensorOptions(at::kFloat));
+
+    ir::Value v_a = GetTensorIrValue(a, device);
+    ir::Value v_b = GetTensorIrValue(b, device);
+    // Both graphs have the same node hashes, but a different mapping of the
+    // device data to the fused computation parameters.
+    ir::Value v_square = v_a * v_a;
+    ir::Value v_mul = v_a * v_b;
+
+    OpByOpExecutor* executor = OpByOpExecutor::Get();
+    bool hybrid_mode = executor->IsHybridMode();
+    executor->SetHybridMode(true);
+    auto square_data = executor->Execute({v_square}, device.ToString(), {});
+    auto mul_data = executor->Execute({v_mul}, device.ToString(), {});
+    executor->SetHybridMode(hybrid_mode);
+
+    AllClose(Fetch(square_data).front(), a * a);
+    AllClose(Fetch(mul_data).front(), a * b);
+  });
+}
+
 }  // namespace cpp_test
 }  // namespace torch_xla
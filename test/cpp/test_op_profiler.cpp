@@ -0,0 +1,57 @@
+#include <gtest/gtest.h>
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "torch_xla/csrc/ir.h"
+#include "torch_xla/csrc/op_profiler.h"
+#include "torch_xla/csrc/ops/ops.h"
+#include "torch_xla/csrc/python_util.h"
+
+namespace torch_xla {
+namespace cpp_test {
+
+TEST(OpProfilerTest, TestAddSamples) {
+  OpProfiler* profiler = OpProfiler::Get();
+  profiler->Clear();
+  // The frames are innermost first.
+  std::vector<SourceLocation> frames(
+      {{"model.py", "forward", 12}, {"train.py", "main", 3}});
+  ir::NodePtr node = ir::ops::ScalarOp(1.0, xla::F32);
+  node->SetFrameInfo(&frames);
+  xla::int64 id = profiler->RegisterNode(node.get());
+  ASSERT_GT(id, 0);
+
+  // The profiling tools decorate the op_name metadata stamped by the lowering.
+  std::string op_name = profiler->OpName(id);
+  EXPECT_EQ(profiler->AddSamples({{"fusion/" + op_name, 2000000},
+                                  {op_name + ".1", 1000000},
+                                  {"copy.3", 500000}}),
+            2u);
+
+  std::vector<OpProfiler::Record> records = profiler->GetRecords();
+  ASSERT_EQ(records.size(), 1u);
+  EXPECT_EQ(records[0].id, id);
+  EXPECT_EQ(records[0].op_type, node->op().ToString());
+  EXPECT_EQ(records[0].samples, 2);
+  EXPECT_EQ(records[0].total_ns, 3000000);
+  ASSERT_EQ(records[0].frames.size(), 2u);
+  EXPECT_EQ(records[0].frames[0].function, "forward");
+
+  std::string report = profiler->CreateReport(/*max_entries=*/10);
+  EXPECT_NE(report.find("UnattributedTime"), std::string::npos) << report;
+  EXPECT_NE(report.find("(1 samples)"), std::string::npos) << report;
+  EXPECT_NE(report.find("forward@model.py:12"), std::string::npos) << report;
+  EXPECT_NE(report.find(records[0].op_type), std::string::npos) << report;
+
+  EXPECT_EQ(profiler->CreateFoldedStacks(),
+            "main@train.py:3;forward@model.py:12;" + records[0].op_type +
+                " 3000\n");
+
+  profiler->Clear();
+  EXPECT_TRUE(profiler->GetRecords().empty());
+}
+
+}  // namespace cpp_test
+}  // namespace torch_xla
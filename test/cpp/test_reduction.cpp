@@ -0,0 +1,96 @@
+#include <gtest/gtest.h>
+
+#include <string>
+
+#include "cpp_test_util.h"
+#include "tensorflow/compiler/xla/client/xla_builder.h"
+#include "tensorflow/compiler/xla/shape_util.h"
+#include "tensorflow/compiler/xla/xla_client/debug_macros.h"
+#include "tensorflow/compiler/xla/xla_client/xla_util.h"
+#include "torch_xla/csrc/convert_ops.h"
+#include "torch_xla/csrc/helpers.h"
+#include "torch_xla/csrc/reduction.h"
+#include "torch_xla/csrc/softmax_builder.h"
+#include "torch_xla_test.h"
+
+namespace torch_xla {
+namespace cpp_test {
+namespace {
+
+class ReductionTest : public TorchXlaTest {};
+
+// Builds the computation of build_fn over a [4, 3] parameter of the given
+// type, checks its result shape, and returns its HLO text.
+template <typename F>
+std::string BuildWithParameter(xla::PrimitiveType type,
+                               const xla::Shape& result_shape,
+                               const F& build_fn) {
+  xla::XlaBuilder builder("ReductionTest");
+  xla::XlaOp x = xla::Parameter(
+      &builder, 0, xla::ShapeUtil::MakeShape(type, {4, 3}), "x");
+  xla::XlaOp result = build_fn(x);
+  EXPECT_TRUE(xla::ShapeUtil::Compatible(XlaHelpers::ShapeOfXlaOp(result),
+                                         result_shape));
+  return ConsumeValue(
+      xla::util::GetComputationHloText(ConsumeValue(builder.Build())));
+}
+
+}  // namespace
+
+TEST_F(ReductionTest, TestAccumulationType) {
+  EXPECT_EQ(GetAccumulationType(xla::PrimitiveType::BF16, "sum"),
+            xla::PrimitiveType::F32);
+  EXPECT_EQ(GetAccumulationType(xla::PrimitiveType::F16, "softmax"),
+            xla::PrimitiveType::F32);
+  EXPECT_EQ(GetAccumulationType(xla::PrimitiveType::F32, "sum"),
+            xla::PrimitiveType::F32);
+  EXPECT_EQ(GetAccumulationType(xla::PrimitiveType::S32, "mean"),
+            xla::PrimitiveType::S32);
+}
+
+TEST_F(ReductionTest, TestSumAccumulatesInF32) {
+  std::string hlo = BuildWithParameter(
+      xla::PrimitiveType::BF16,
+      xla::ShapeUtil::MakeShape(xla::PrimitiveType::BF16, {4}),
+      [](const xla::XlaOp& x) {
+        return BuildSum(x, {1}, /*keep_reduced_dimensions=*/false);
+      });
+  EXPECT_NE(hlo.find("f32[4]"), std::string::npos) << hlo;
+  EXPECT_NE(hlo.find("convert"), std::string::npos) << hlo;
+}
+
+TEST_F(ReductionTest, TestSumF32NoConvert) {
+  std::string hlo = BuildWithParameter(
+      xla::PrimitiveType::F32,
+      xla::ShapeUtil::MakeShape(xla::PrimitiveType::F32, {4}),
+      [](const xla::XlaOp& x) {
+        return BuildSum(x, {1}, /*keep_reduced_dimensions=*/false);
+      });
+  EXPECT_EQ(hlo.find("convert"), std::string::npos) << hlo;
+}
+
+TEST_F(ReductionTest, TestLogSoftmaxAccumulatesInF32) {
+  std::string hlo = BuildWithParameter(
+      xla::PrimitiveType::BF16,
+      xla::ShapeUtil::MakeShape(xla::PrimitiveType::BF16, {4, 3}),
+      [](const xla::XlaOp& x) { return BuildLogSoftmax(x, /*dim=*/1); });
+  EXPECT_NE(hlo.find("f32[4,3]"), std::string::npos) << hlo;
+  EXPECT_NE(hlo.find("convert"), std::string::npos) << hlo;
+}
+
+TEST_F(ReductionTest, TestMaybeConvertTo) {
+  xla::XlaBuilder builder("MaybeConvertTo");
+  xla::XlaOp x = xla::Parameter(
+      &builder, 0, xla::ShapeUtil::MakeShape(xla::PrimitiveType::F32, {2}),
+      "x");
+  EXPECT_EQ(MaybeConvertTo(x, xla::PrimitiveType::F32, xla::PrimitiveType::F32,
+                           /*device=*/nullptr)
+                .handle(),
+            x.handle());
+  xla::XlaOp y = MaybeConvertTo(x, xla::PrimitiveType::F32,
+                                xla::PrimitiveType::BF16, /*device=*/nullptr);
+  EXPECT_EQ(XlaHelpers::TypeOfXlaOp(y), xla::PrimitiveType::BF16);
+}
+
+}  // namespace cpp_test
+}  // namespace torch_xla
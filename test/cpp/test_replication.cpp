@@ -1,17 +1,23 @@
 #include <ATen/ATen.h>
 #include <gtest/gtest.h>
 
+#include <algorithm>
 #include <iostream>
 
+#include "absl/strings/str_cat.h"
 #include "cpp_test_util.h"
 #include "tensorflow/compiler/xla/client/xla_builder.h"
 #include "tensorflow/compiler/xla/shape_util.h"
 #include "tensorflow/compiler/xla/xla_client/computation_client.h"
 #include "tensorflow/compiler/xla/xla_client/debug_macros.h"
+#include "tensorflow/compiler/xla/xla_client/metrics.h"
 #include "tensorflow/compiler/xla/xla_client/multi_wait.h"
 #include "tensorflow/compiler/xla/xla_client/thread_pool.h"
 #include "torch_xla/csrc/aten_xla_bridge.h"
+#include "torch_xla/csrc/cross_replica_reduces.h"
 #include "torch_xla/csrc/helpers.h"
+#include "torch_xla/csrc/replicated_data.h"
+#include "torch_xla/csrc/tensor.h"
 #include "torch_xla/csrc/tensor_util.h"
 #include "torch_xla/csrc/torch_util.h"
 #include "torch_xla_test.h"
@@ -81,6 +87,260 @@ void TestSingleReplication(const std::vector<Device>& devices,
   }
 }
 
+xla::XlaComputation CreateBucketedCrsComputation(
+    const std::vector<xla::Shape>& shapes,
+    CrossReplicaSumCompression compression,
+    const std::vector<std::vector<xla::int64>>& host_groups) {
+  xla::XlaBuilder builder("BucketedCrsComputation");
+  std::vector<xla::XlaOp> params;
+  for (size_t i = 0; i < shapes.size(); ++i) {
+    params.push_back(
+        xla::Parameter(&builder, i, shapes[i], absl::StrCat("p", i)));
+  }
+  xla::Tuple(&builder, BuildCrossReplicaSum(params, /*scale=*/1.0, {},
+                                                 compression, host_groups));
+  return ConsumeValue(builder.Build());
+}
+
+void TestBucketedReplication(const std::vector<Device>& devices,
+                             const std::vector<Device>& all_devices,
+                             CrossReplicaSumCompression compression,
+                             const std::vector<std::vector<xla::int64>>&
+                                 host_groups) {
+  // Like TestSingleReplication(), but reducing tensors of different shapes
+  // with a single CRS operation. The tensor values are exactly representable
+  // in BF16, so the compressed reductions must return the same results.
+  std::vector<xla::string> device_strings;
+  std::vector<xla::string> all_device_strings;
+  for (auto& device : devices) {
+    device_strings.push_back(device.ToString());
+  }
+  for (auto& device : all_devices) {
+    all_device_strings.push_back(device.ToString());
+  }
+  std::vector<xla::Shape> shapes = {
+      xla::ShapeUtil::MakeShape(xla::PrimitiveType::F32, {8, 8}),
+      xla::ShapeUtil::MakeShape(xla::PrimitiveType::F32, {3}),
+      xla::ShapeUtil::MakeShape(xla::PrimitiveType::F32, {2, 5, 4})};
+  xla::Shape result_shape = xla::ShapeUtil::MakeTupleShape(shapes);
+  std::vector<xla::ComputationClient::CompileInstance> instances;
+  for (auto& device_str : device_strings) {
+    instances.emplace_back(
+        CreateBucketedCrsComputation(shapes, compression, host_groups),
+        device_str, all_device_strings, &result_shape);
+  }
+  auto compiled_computations =
+      xla::ComputationClient::Get()->Compile(std::move(instances));
+
+  // Every operand gets a different value, to verify the results are sliced
+  // back at the right offsets.
+  std::vector<at::Tensor> tensors;
+  for (size_t j = 0; j < shapes.size(); ++j) {
+    tensors.push_back(at::ones(XlaHelpers::I64List(shapes[j].dimensions()),
+                               at::TensorOptions(at::kFloat)) *
+                      static_cast<float>(j + 1));
+  }
+  std::vector<std::vector<xla::ComputationClient::DataPtr>> tensors_data;
+  for (auto& device_str : device_strings) {
+    tensors_data.push_back(CreateTensorsData(
+        tensors, std::vector<std::string>(shapes.size(), device_str)));
+  }
+
+  std::vector<std::vector<xla::ComputationClient::DataPtr>> results(
+      device_strings.size());
+  xla::util::MultiWait mwait(device_strings.size());
+  xla::ComputationClient::ExecuteComputationOptions exec_options;
+  for (size_t i = 0; i < device_strings.size(); ++i) {
+    auto executor = [&, i]() {
+      results[i] = xla::ComputationClient::Get()->ExecuteComputation(
+          *compiled_computations[i], tensors_data[i], device_strings[i],
+          exec_options);
+    };
+    xla::env::ScheduleIoClosure(mwait.Completer(std::move(executor)));
+  }
+  mwait.Wait();
+
+  for (size_t i = 0; i < results.size(); ++i) {
+    auto literals =
+        xla::ComputationClient::Get()->TransferFromServer(results[i]);
+    ASSERT_EQ(literals.size(), shapes.size());
+    for (size_t j = 0; j < literals.size(); ++j) {
+      at::Tensor result =
+          MakeTensorFromXlaLiteral(literals[j], tensors[j].scalar_type());
+      AllClose(result, tensors[j] * static_cast<float>(all_devices.size()));
+    }
+  }
+}
+
+xla::XlaComputation CreateCollectivesComputation(const xla::Shape& shape,
+                                                 xla::int64 shard_count) {
+  xla::XlaBuilder builder("CollectivesComputation");
+  xla::XlaOp x = xla::Parameter(&builder, 0, shape, "x");
+  xla::XlaOp gathered = BuildAllGather(x, /*dim=*/0, shard_count, {});
+  xla::XlaOp scattered =
+      BuildReduceScatter(x, /*scale=*/1.0, /*dim=*/0, shard_count, {});
+  xla::Tuple(&builder, {gathered, scattered});
+  return ConsumeValue(builder.Build());
+}
+
+void TestCollectivesReplication(const std::vector<Device>& devices,
+                                const std::vector<Device>& all_devices) {
+  // Every replica contributes a tensor filled with its index plus one, so the
+  // gathered result is the concatenation of all of them, and every slice of
+  // the scattered sum is filled with the sum of the replica values.
+  std::vector<xla::string> device_strings;
+  std::vector<xla::string> all_device_strings;
+  for (auto& device : devices) {
+    device_strings.push_back(device.ToString());
+  }
+  for (auto& device : all_devices) {
+    all_device_strings.push_back(device.ToString());
+  }
+  xla::int64 shard_count = all_devices.size();
+  xla::Shape shape =
+      xla::ShapeUtil::MakeShape(xla::PrimitiveType::F32, {2 * shard_count, 3});
+  xla::Shape result_shape = xla::ShapeUtil::MakeTupleShape(
+      {xla::ShapeUtil::MakeShape(xla::PrimitiveType::F32,
+                                 {2 * shard_count * shard_count, 3}),
+       xla::ShapeUtil::MakeShape(xla::PrimitiveType::F32, {2, 3})});
+  std::vector<xla::ComputationClient::CompileInstance> instances;
+  for (auto& device_str : device_strings) {
+    instances.emplace_back(CreateCollectivesComputation(shape, shard_count),
+                           device_str, all_device_strings, &result_shape);
+  }
+  auto compiled_computations =
+      xla::ComputationClient::Get()->Compile(std::move(instances));
+
+  std::vector<at::Tensor> tensors;
+  for (size_t i = 0; i < device_strings.size(); ++i) {
+    tensors.push_back(
+        at::ones({2 * shard_count, 3}, at::TensorOptions(at::kFloat)) *
+        static_cast<float>(i + 1));
+  }
+  auto tensors_data = CreateTensorsData(tensors, device_strings);
+
+  std::vector<std::vector<xla::ComputationClient::DataPtr>> results(
+      device_strings.size());
+  xla::util::MultiWait mwait(device_strings.size());
+  xla::ComputationClient::ExecuteComputationOptions exec_options;
+  for (size_t i = 0; i < device_strings.size(); ++i) {
+    auto executor = [&, i]() {
+      results[i] = xla::ComputationClient::Get()->ExecuteComputation(
+          *compiled_computations[i], {tensors_data[i]}, device_strings[i],
+          exec_options);
+    };
+    xla::env::ScheduleIoClosure(mwait.Completer(std::move(executor)));
+  }
+  mwait.Wait();
+
+  at::Tensor gathered = at::cat(tensors, 0);
+  float replicas_sum = static_cast<float>(shard_count * (shard_count + 1) / 2);
+  for (size_t i = 0; i < results.size(); ++i) {
+    auto literals =
+        xla::ComputationClient::Get()->TransferFromServer(results[i]);
+    ASSERT_EQ(literals.size(), 2);
+    AllClose(MakeTensorFromXlaLiteral(literals[0], at::kFloat), gathered);
+    AllClose(MakeTensorFromXlaLiteral(literals[1], at::kFloat),
+             at::ones({2, 3}, at::TensorOptions(at::kFloat)) * replicas_sum);
+  }
+}
+
+xla::int64 CounterValue(const std::string& name) {
+  xla::metrics::CounterData* counter = xla::metrics::GetCounter(name);
+  return counter != nullptr ? counter->Value() : 0;
+}
+
+// Runs a graph through the single thread replicated execution, with an input
+// holding different shards on every device.
+void TestReplicatedSync(const std::vector<Device>& devices) {
+  std::vector<std::string> device_strings;
+  for (auto& device : devices) {
+    device_strings.push_back(device.ToString());
+  }
+  std::vector<std::string> replication_devices =
+      xla::ComputationClient::Get()->GetReplicationDevices();
+  xla::ComputationClient::Get()->SetReplicationDevices(device_strings);
+  ReplicatedData::Get()->SetEnabled(true);
+
+  std::vector<at::Tensor> shards;
+  for (size_t i = 0; i < devices.size(); ++i) {
+    shards.push_back(at::rand({2, 3}, at::TensorOptions(at::kFloat)));
+  }
+  std::vector<xla::ComputationClient::DataPtr> replicas =
+      CreateTensorsData(shards, device_strings);
+  ReplicatedData::Get()->Register(replicas, /*master_index=*/0);
+  // The bias has no replicas, so it gets broadcast from the master device.
+  at::Tensor bias = at::rand({2, 3}, at::TensorOptions(at::kFloat));
+  XLATensor dev_x = XLATensor::Create(replicas[0], at::kFloat);
+  XLATensor dev_bias = XLATensor::Create(bias, devices[0]);
+  std::vector<XLATensor> tensors = {XLATensor::add(dev_x, dev_bias, 1.0)};
+  xla::int64 executions = CounterValue("ReplicatedSyncExecutions");
+  xla::int64 broadcasts = CounterValue("ReplicatedDataBroadcasts");
+  XLATensor::SyncTensorsGraph(&tensors, device_strings, /*wait=*/true,
+                              /*sync_xla_data=*/true);
+  EXPECT_EQ(CounterValue("ReplicatedSyncExecutions"), executions + 1);
+  EXPECT_EQ(CounterValue("ReplicatedDataBroadcasts"), broadcasts + 1);
+
+  // The results of the other replicas are registered under the master one.
+  std::vector<xla::ComputationClient::DataPtr> results =
+      ReplicatedData::Get()->GetReplicas(tensors[0].GetXlaData(),
+                                         device_strings,
+                                         /*master_index=*/0);
+  EXPECT_EQ(CounterValue("ReplicatedDataBroadcasts"), broadcasts + 1);
+  ASSERT_EQ(results.size(), devices.size());
+  std::vector<at::Tensor> outputs = XlaDataToTensors(
+      results, std::vector<at::ScalarType>(results.size(), at::kFloat));
+  for (size_t i = 0; i < devices.size(); ++i) {
+    AllClose(outputs[i], shards[i] + bias);
+  }
+
+  ReplicatedData::Get()->SetEnabled(false);
+  xla::ComputationClient::Get()->SetReplicationDevices(replication_devices);
+}
+
+// Runs a replicated computation asynchronously, dropping the references to
+// its arguments right after the call.
+void TestReplicatedAsync(const std::vector<Device>& devices) {
+  std::vector<std::string> device_strings;
+  for (auto& device : devices) {
+    device_strings.push_back(device.ToString());
+  }
+  xla::Shape shape = xla::ShapeUtil::MakeShape(xla::PrimitiveType::F32, {4, 4});
+  xla::XlaBuilder builder("ScaleComputation");
+  xla::XlaOp x = xla::Parameter(&builder, 0, shape, "x");
+  xla::Add(x, x);
+  std::vector<xla::ComputationClient::CompileInstance> instances;
+  instances.emplace_back(ConsumeValue(builder.Build()), device_strings.front(),
+                         device_strings, &shape);
+  auto computations =
+      xla::ComputationClient::Get()->Compile(std::move(instances));
+
+  std::vector<at::Tensor> tensors;
+  for (size_t i = 0; i < device_strings.size(); ++i) {
+    tensors.push_back(at::rand({4, 4}, at::TensorOptions(at::kFloat)));
+  }
+  std::vector<xla::ComputationClient::ReplicaResult> futures;
+  {
+    std::vector<xla::ComputationClient::DataPtr> tensors_data =
+        CreateTensorsData(tensors, device_strings);
+    std::vector<std::vector<xla::ComputationClient::DataPtr>> arguments;
+    for (auto& data : tensors_data) {
+      arguments.push_back({data});
+    }
+    xla::ComputationClient::ExecuteReplicatedOptions options;
+    futures = xla::ComputationClient::Get()->ExecuteReplicatedAsync(
+        *computations.front(), arguments, device_strings, options);
+  }
+  ASSERT_EQ(futures.size(), device_strings.size());
+  for (size_t i = 0; i < futures.size(); ++i) {
+    auto literals =
+        xla::ComputationClient::Get()->TransferFromServer(futures[i].get());
+    ASSERT_EQ(literals.size(), 1u);
+    AllClose(MakeTensorFromXlaLiteral(literals.front(), at::kFloat),
+             tensors[i] * 2);
+  }
+}
+
 }  // namespace
 
 class ReplicationTest : public AtenXlaTensorTestBase {};
@@ -92,5 +352,87 @@ TEST_F(ReplicationTest, TestNSingleReplication) {
   });
 }
 
+TEST_F(ReplicationTest, TestNBucketedReplication) {
+  WithAllDevices(DeviceType::TPU, [&](const std::vector<Device>& devices,
+                                      const std::vector<Device>& all_devices) {
+    TestBucketedReplication(devices, all_devices,
+                            CrossReplicaSumCompression::kNone, {});
+  });
+}
+
+TEST_F(ReplicationTest, TestNBucketedBF16Replication) {
+  WithAllDevices(DeviceType::TPU, [&](const std::vector<Device>& devices,
+                                      const std::vector<Device>& all_devices) {
+    TestBucketedReplication(devices, all_devices,
+                            CrossReplicaSumCompression::kBF16, {});
+  });
+}
+
+TEST_F(ReplicationTest, TestNHierarchicalReplication) {
+  WithAllDevices(DeviceType::TPU, [&](const std::vector<Device>& devices,
+                                      const std::vector<Device>& all_devices) {
+    // Splits the replicas within two simulated hosts. The flattened operands
+    // have 107 elements, which exercises the padding of the shards.
+    xla::int64 host_size = all_devices.size() / 2;
+    if (host_size < 2 || all_devices.size() % 2 != 0) {
+      return;
+    }
+    std::vector<std::vector<xla::int64>> host_groups(2);
+    for (size_t i = 0; i < all_devices.size(); ++i) {
+      host_groups[i / host_size].push_back(i);
+    }
+    TestBucketedReplication(devices, all_devices,
+                            CrossReplicaSumCompression::kNone, host_groups);
+  });
+}
+
+TEST_F(ReplicationTest, TestNCollectivesReplication) {
+  WithAllDevices(DeviceType::TPU, [&](const std::vector<Device>& devices,
+                                      const std::vector<Device>& all_devices) {
+    // The expected results need the values of all the replicas.
+    if (devices.size() != all_devices.size()) {
+      return;
+    }
+    TestCollectivesReplication(devices, all_devices);
+  });
+}
+
+TEST_F(ReplicationTest, TestReplicatedSyncExecution) {
+  // Runs on all the local devices of the default kind, which can be a single
+  // one, like on CPU.
+  Device default_device(xla::ComputationClient::Get()->GetDefaultDevice());
+  WithAllDevices(default_device.hw_type,
+                 [&](const std::vector<Device>& devices,
+                     const std::vector<Device>& all_devices) {
+                   TestReplicatedSync(devices);
+                 });
+}
+
+TEST_F(ReplicationTest, TestReplicatedAsyncExecution) {
+  Device default_device(xla::ComputationClient::Get()->GetDefaultDevice());
+  WithAllDevices(default_device.hw_type,
+                 [&](const std::vector<Device>& devices,
+                     const std::vector<Device>& all_devices) {
+                   TestReplicatedAsync(devices);
+                 });
+}
+
+TEST_F(ReplicationTest, TestTopologyOrderedDevices) {
+  WithAllDevices(DeviceType::TPU, [&](const std::vector<Device>& devices,
+                                      const std::vector<Device>& all_devices) {
+    std::vector<std::string> device_strings;
+    for (auto& device : all_devices) {
+      device_strings.push_back(device.ToString());
+    }
+    std::vector<std::string> ordered_devices =
+        xla::ComputationClient::Get()->GetTopologyOrderedDevices(
+            device_strings);
+    // The ordering must be a permutation of the input devices.
+    std::sort(device_strings.begin(), device_strings.end());
+    std::sort(ordered_devices.begin(), ordered_devices.end());
+    EXPECT_EQ(ordered_devices, device_strings);
+  });
+}
+
 }  // namespace cpp_test
 }  // namespace torch_xla
@@ -1,13 +1,23 @@
 #include <ATen/ATen.h>
 #include <gtest/gtest.h>
 
+#include <exception>
 #include <limits>
+#include <memory>
+#include <stdexcept>
+#include <thread>
 #include <vector>
 
 #include "cpp_test_util.h"
+#include "tensorflow/compiler/xla/shape_util.h"
+#include "tensorflow/compiler/xla/xla_client/metrics.h"
 #include "torch/csrc/autograd/variable.h"
+#include "torch_xla/csrc/copy_kernels.h"
+#include "torch_xla/csrc/index_cost_model.h"
+#include "torch_xla/csrc/staging_buffers.h"
 #include "torch_xla/csrc/tensor.h"
 #include "torch_xla/csrc/tensor_util.h"
+#include "torch_xla/csrc/upload_batcher.h"
 #include "torch_xla_test.h"
 
 namespace torch_xla {
@@ -71,6 +81,267 @@ TEST_F(TensorTest, TestConversions) {
   }
 }
 
+TEST_F(TensorTest, TestCopyKernels) {
+  // Use a size which is not a multiple of the vector width, to exercise the
+  // scalar tail loops as well.
+  const xla::int64 kNumElements = 1003;
+  at::Tensor input = at::randn({kNumElements}, at::TensorOptions(at::kFloat));
+  const float* fdata = input.data_ptr<float>();
+  {
+    std::vector<tensorflow::bfloat16> bf16_data(kNumElements);
+    copy_kernels::FloatToBFloat16(fdata, bf16_data.data(), kNumElements);
+    std::vector<float> fdata_back(kNumElements);
+    copy_kernels::BFloat16ToFloat(bf16_data.data(), fdata_back.data(),
+                                  kNumElements);
+    for (xla::int64 i = 0; i < kNumElements; ++i) {
+      tensorflow::bfloat16 expected =
+          static_cast<tensorflow::bfloat16>(fdata[i]);
+      EXPECT_EQ(static_cast<float>(bf16_data[i]),
+                static_cast<float>(expected));
+      EXPECT_EQ(fdata_back[i], static_cast<float>(bf16_data[i]));
+    }
+  }
+  {
+    std::vector<int64_t> i64_data(kNumElements);
+    for (xla::int64 i = 0; i < kNumElements; ++i) {
+      i64_data[i] = (i % 2 == 0 ? -i : i) * 1000003;
+    }
+    std::vector<int32_t> i32_data(kNumElements);
+    copy_kernels::Int64ToInt32(i64_data.data(), i32_data.data(), kNumElements);
+    std::vector<int64_t> i64_data_back(kNumElements);
+    copy_kernels::Int32ToInt64(i32_data.data(), i64_data_back.data(),
+                               kNumElements);
+    EXPECT_EQ(i64_data, i64_data_back);
+  }
+  {
+    std::vector<uint8_t> bytes(kNumElements);
+    for (xla::int64 i = 0; i < kNumElements; ++i) {
+      bytes[i] = i % 3 == 0 ? 0 : static_cast<uint8_t>(i * 7);
+    }
+    std::unique_ptr<bool[]> bools(new bool[kNumElements]);
+    copy_kernels::BytesToBool(bytes.data(), bools.get(), kNumElements);
+    std::vector<uint32_t> words((kNumElements + 31) / 32, 0xffffffff);
+    copy_kernels::PackBits32(bools.get(), words.data(), kNumElements);
+    for (xla::int64 i = 0; i < kNumElements; ++i) {
+      EXPECT_EQ(bools[i], bytes[i] != 0);
+      EXPECT_EQ((words[i / 32] >> (i % 32)) & 1, bytes[i] != 0 ? 1u : 0u);
+    }
+    EXPECT_EQ(words.back() >> (kNumElements % 32), 0u);
+  }
+  {
+    const xla::int64 kStride = 3;
+    std::vector<float> gathered(kNumElements / kStride);
+    copy_kernels::StridedGather32(fdata, kStride, gathered.data(),
+                                  gathered.size());
+    for (size_t i = 0; i < gathered.size(); ++i) {
+      EXPECT_EQ(gathered[i], fdata[i * kStride]);
+    }
+  }
+  {
+    // Neither side is a multiple of the 8x8 blocks, and the leading dimensions
+    // are padded.
+    const xla::int64 kRows = 33;
+    const xla::int64 kCols = 27;
+    std::vector<float> transposed(kCols * (kRows + 3));
+    copy_kernels::Transpose32(fdata, kCols + 1, transposed.data(), kRows + 3,
+                              kRows, kCols);
+    for (xla::int64 i = 0; i < kRows; ++i) {
+      for (xla::int64 j = 0; j < kCols; ++j) {
+        EXPECT_EQ(transposed[j * (kRows + 3) + i], fdata[i * (kCols + 1) + j]);
+      }
+    }
+  }
+}
+
+TEST_F(TensorTest, TestTransposedLayoutCopy) {
+  at::Tensor input = at::rand({3, 37, 41, 5}, at::TensorOptions(at::kFloat));
+  ForEachDevice([&](const Device& device) {
+    // The channels dimension moves from second to most minor (NCHW to NHWC),
+    // and the batch one to most major.
+    for (auto& minor_to_major : std::vector<std::vector<xla::int64>>(
+             {{1, 3, 2, 0}, {0, 1, 2, 3}, {2, 3, 1, 0}})) {
+      xla::Shape shape = xla::ShapeUtil::MakeShapeWithLayout(
+          xla::PrimitiveType::F32, {3, 37, 41, 5}, minor_to_major);
+      xla::Literal literal = GetTensorLiteral(input, &shape, &device);
+      at::Tensor output = MakeTensorFromXlaLiteral(literal, at::kFloat);
+      EXPECT_TRUE(EqualValues(input, output));
+      EXPECT_EQ(literal.Get<float>({2, 30, 7, 4}),
+                input[2][30][7][4].item().toFloat());
+    }
+  });
+}
+
+TEST_F(TensorTest, TestTensorHash) {
+  // Large enough to span multiple hash blocks.
+  at::Tensor a = at::rand({256, 96}, at::TensorOptions(at::kFloat));
+  at::Tensor t = a.t();
+  EXPECT_FALSE(t.is_contiguous());
+  EXPECT_EQ(TensorHash(t), TensorHash(t.contiguous()));
+  at::Tensor s = a.slice(/*dim=*/1, /*start=*/3, /*end=*/90, /*step=*/2);
+  EXPECT_EQ(TensorHash(s), TensorHash(s.contiguous()));
+  EXPECT_NE(TensorHash(a), TensorHash(t.contiguous()));
+  at::Tensor b = a.clone();
+  b[17][5] += 1.0;
+  EXPECT_NE(TensorHash(a), TensorHash(b));
+}
+
+TEST_F(TensorTest, TestTransferToServer) {
+  at::Tensor a = at::rand({32, 64}, at::TensorOptions(at::kFloat));
+  // Large enough to be copied by multiple threads.
+  at::Tensor b = at::rand({1024, 1024}, at::TensorOptions(at::kFloat));
+  // Contiguous inputs whose memory is aligned, which are zero-copy eligible
+  // (the narrowed rows start 256 bytes into the storage), a contiguous one
+  // starting 4 bytes into it, which is copied as it is not aligned, and
+  // non-contiguous ones.
+  std::vector<at::Tensor> inputs({a, a.narrow(0, 1, 8),
+                                  a.view({-1}).narrow(0, 1, 255), a.t(), b,
+                                  b.t()});
+  ForEachDevice([&](const Device& device) {
+    for (auto& input : inputs) {
+      xla::ComputationClient::DataPtr data = TensorToXlaData(input, device);
+      std::vector<xla::Literal> literals =
+          xla::ComputationClient::Get()->TransferFromServer({data});
+      at::Tensor output =
+          MakeTensorFromXlaLiteral(literals.front(), input.scalar_type());
+      EXPECT_TRUE(EqualValues(input, output));
+
+      std::vector<at::Tensor> outputs =
+          XlaDataToTensors({data}, {input.scalar_type()});
+      EXPECT_TRUE(EqualValues(input, outputs.front()));
+    }
+  });
+}
+
+TEST_F(TensorTest, TestDataValueWaits) {
+  at::Tensor a = at::rand({4, 3}, at::TensorOptions(at::kFloat));
+  ForEachDevice([&](const Device& device) {
+    xla::ComputationClient::DataPtr data = TensorToXlaData(a, device);
+    xla::ComputationClient::DataPtr placeholder =
+        xla::ComputationClient::Get()->CreateDataPlaceholder(
+            device.ToString(), data->shape());
+    EXPECT_FALSE(placeholder->HasValue());
+    at::Tensor output;
+    std::thread waiter([&]() {
+      placeholder->WaitValue();
+      output = XlaDataToTensors({placeholder}, {at::kFloat}).front();
+    });
+    placeholder->Assign(*data);
+    waiter.join();
+    EXPECT_TRUE(placeholder->HasValue());
+    EXPECT_TRUE(EqualValues(a, output));
+
+    // The waiters of a placeholder which never gets its value throw the error
+    // of the operation meant to produce it.
+    xla::ComputationClient::DataPtr failed =
+        xla::ComputationClient::Get()->CreateDataPlaceholder(
+            device.ToString(), data->shape());
+    bool thrown = false;
+    std::thread failed_waiter([&]() {
+      try {
+        failed->WaitValue();
+      } catch (const std::runtime_error&) {
+        thrown = true;
+      }
+    });
+    failed->SetError(
+        std::make_exception_ptr(std::runtime_error("Execution failed")));
+    failed_waiter.join();
+    EXPECT_TRUE(thrown);
+    EXPECT_FALSE(failed->HasValue());
+  });
+}
+
+TEST_F(TensorTest, TestUploadBatcher) {
+  UploadBatcher batcher(/*enabled=*/true, /*max_tensor_bytes=*/64);
+  at::Tensor a = at::scalar_tensor(0.5, at::TensorOptions(at::kFloat));
+  at::Tensor b = at::rand({2, 3}, at::TensorOptions(at::kFloat));
+  at::Tensor c = at::rand({32, 64}, at::TensorOptions(at::kFloat));
+  ForEachDevice([&](const Device& device) {
+    xla::ComputationClient::DataPtr a_data = batcher.Add(a, device);
+    xla::ComputationClient::DataPtr b_data = batcher.Add(b, device);
+    ASSERT_TRUE(a_data != nullptr);
+    ASSERT_TRUE(b_data != nullptr);
+    EXPECT_FALSE(a_data->HasValue());
+    // Too big to be deferred.
+    EXPECT_TRUE(batcher.Add(c, device) == nullptr);
+
+    batcher.Flush();
+    EXPECT_TRUE(a_data->HasValue());
+    EXPECT_TRUE(b_data->HasValue());
+    std::vector<at::Tensor> outputs =
+        XlaDataToTensors({a_data, b_data}, {at::kFloat, at::kFloat});
+    EXPECT_TRUE(EqualValues(a, outputs[0]));
+    EXPECT_TRUE(EqualValues(b, outputs[1]));
+  });
+}
+
+TEST_F(TensorTest, TestToScalarBatched) {
+  auto counter_value = [](const std::string& name) -> xla::int64 {
+    xla::metrics::CounterData* counter = xla::metrics::GetCounter(name);
+    return counter != nullptr ? counter->Value() : 0;
+  };
+  at::Tensor a = at::rand({4, 3}, at::TensorOptions(at::kFloat));
+  ForEachDevice([&](const Device& device) {
+    XLATensor dev_a = XLATensor::Create(a, device);
+    XLATensor dev_sum = XLATensor::sum(dev_a, {0, 1},
+                                       /*keep_reduced_dimensions=*/false,
+                                       c10::nullopt);
+    XLATensor dev_max = XLATensor::max(dev_a);
+    XLATensor dev_argmax = XLATensor::argmax(dev_a);
+    XLATensor::SyncLiveTensorsGraph(&device, /*devices=*/{}, /*wait=*/true);
+
+    xla::int64 reads = counter_value("ScalarReads");
+    EXPECT_NEAR(dev_sum.ToScalar().toDouble(), a.sum().item().toDouble(),
+                1e-4);
+    // The other scalars have been fetched along with the first one.
+    EXPECT_EQ(dev_max.ToScalar().toDouble(), a.max().item().toDouble());
+    EXPECT_EQ(dev_argmax.ToScalar().toLong(), a.argmax().item().toLong());
+    EXPECT_EQ(counter_value("ScalarReads"), reads + 1);
+  });
+}
+
+TEST_F(TensorTest, TestStagingZeroCopySources) {
+  StagingBufferPool pool(/*max_buffers_per_shape=*/2);
+  at::Tensor a = at::rand({4, 3}, at::TensorOptions(at::kFloat));
+  at::Tensor b = a.t();
+  ForEachDevice([&](const Device& device) {
+    // The transfers read the zero-copy sources in place, so they need no
+    // staging copy.
+    at::Tensor staged_a = pool.CopyToStaging(a, device);
+    EXPECT_EQ(staged_a.data_ptr() == a.data_ptr(),
+              IsZeroCopySource(a, device));
+    EXPECT_TRUE(EqualValues(staged_a, a));
+    EXPECT_FALSE(IsZeroCopySource(b, device));
+    at::Tensor staged_b = pool.CopyToStaging(b, device);
+    EXPECT_NE(staged_b.data_ptr(), b.data_ptr());
+    EXPECT_TRUE(staged_b.is_contiguous());
+    EXPECT_TRUE(EqualValues(staged_b, b));
+  });
+}
+
+TEST_F(TensorTest, TestIndexCostModel) {
+  auto counter_value = [](const std::string& name) -> xla::int64 {
+    xla::metrics::CounterData* counter = xla::metrics::GetCounter(name);
+    return counter != nullptr ? counter->Value() : 0;
+  };
+  xla::Shape table_shape =
+      xla::ShapeUtil::MakeShape(xla::PrimitiveType::F32, {1 << 20, 4});
+  xla::Shape small_index_shape =
+      xla::ShapeUtil::MakeShape(xla::PrimitiveType::S64, {1, 4});
+  IndexCostModel* cost_model = IndexCostModel::Get();
+  for (auto op : {IndexCostModel::Op::kGather, IndexCostModel::Op::kScatter}) {
+    std::string kind =
+        op == IndexCostModel::Op::kGather ? "Gather" : "Scatter";
+    xla::int64 dense_count = counter_value("Dense" + kind);
+    xla::int64 sparse_count = counter_value("Sparse" + kind);
+    // An index as big as the input always uses the dense lowering.
+    EXPECT_TRUE(cost_model->UseDense(op, table_shape, table_shape));
+    EXPECT_FALSE(cost_model->UseDense(op, table_shape, small_index_shape));
+    EXPECT_EQ(counter_value("Dense" + kind), dense_count + 1);
+    EXPECT_EQ(counter_value("Sparse" + kind), sparse_count + 1);
+  }
+}
+
 TEST_F(TensorTest, TestAdd) {
   at::Tensor a = at::rand({2, 2}, at::TensorOptions(at::kFloat));
   at::Tensor b = at::rand({2, 2}, at::TensorOptions(at::kFloat));
@@ -441,6 +712,42 @@ TEST_F(TensorTest, TestBatchNorm1D) {
   }
 }
 
+TEST_F(TensorTest, TestGroupNorm) {
+  at::Tensor input = at::rand({2, 6, 4, 5}, at::TensorOptions(at::kFloat));
+  at::Tensor weight = at::rand({6}, at::TensorOptions(at::kFloat));
+  at::Tensor bias = at::rand({6}, at::TensorOptions(at::kFloat));
+  double eps = 1e-5;
+  int num_groups = 3;
+  at::Tensor output = at::group_norm(input, num_groups, weight, bias, eps,
+                                     /*cudnn_enabled=*/false);
+  ForEachDevice([&](const Device& device) {
+    XLATensor xla_input = XLATensor::Create(input, device);
+    XLATensor xla_weight = XLATensor::Create(weight, device);
+    XLATensor xla_bias = XLATensor::Create(bias, device);
+    auto xla_output = XLATensor::group_norm(
+        xla_input, xla_weight, xla_bias, input.size(0) * num_groups,
+        /*affine_dims=*/{1}, eps);
+    AllClose(output, std::get<0>(xla_output));
+  });
+}
+
+TEST_F(TensorTest, TestLayerNorm) {
+  at::Tensor input = at::rand({2, 3, 4, 5}, at::TensorOptions(at::kFloat));
+  at::Tensor weight = at::rand({4, 5}, at::TensorOptions(at::kFloat));
+  at::Tensor undef;
+  double eps = 1e-5;
+  at::Tensor output = at::layer_norm(input, {4, 5}, weight, undef, eps,
+                                     /*cudnn_enable=*/false);
+  ForEachDevice([&](const Device& device) {
+    XLATensor xla_input = XLATensor::Create(input, device);
+    XLATensor xla_weight = XLATensor::Create(weight, device);
+    auto xla_output =
+        XLATensor::group_norm(xla_input, xla_weight, XLATensor(),
+                              /*num_groups=*/6, /*affine_dims=*/{2, 3}, eps);
+    AllClose(output, std::get<0>(xla_output));
+  });
+}
+
 TEST_F(TensorTest, TestConv2D) {
   int in_channels = 9;
   int out_channels = 3;
@@ -720,5 +1027,37 @@ TEST_F(TensorTest, TestConv3DNonSquare) {
   }
 }
 
+TEST_F(TensorTest, TestMultiThreadedCreateDestroy) {
+  static const size_t kNumThreads = 8;
+  static const size_t kTensorsPerThread = 4096;
+  static const size_t kLiveTensors = 16;
+  at::Tensor input = at::rand({2, 2}, at::TensorOptions(at::kFloat));
+  ForEachDevice([&](const Device& device) {
+    size_t base_live_count = XLATensor::GetLiveTensors(&device).size();
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < kNumThreads; ++t) {
+      threads.emplace_back([&]() {
+        std::vector<XLATensor> tensors;
+        for (size_t i = 0; i < kTensorsPerThread; ++i) {
+          if (tensors.size() == kLiveTensors) {
+            tensors.clear();
+          }
+          tensors.push_back(XLATensor::Create(input, device));
+        }
+      });
+    }
+    for (auto& thread : threads) {
+      thread.join();
+    }
+
+    std::vector<XLATensor> live_tensors = XLATensor::GetLiveTensors(&device);
+    EXPECT_EQ(live_tensors.size(), base_live_count);
+    for (size_t i = 1; i < live_tensors.size(); ++i) {
+      EXPECT_LT(live_tensors[i - 1].GetUniqueId(),
+                live_tensors[i].GetUniqueId());
+    }
+  });
+}
+
 }  // namespace cpp_test
 }  // namespace torch_xla
@@ -0,0 +1,59 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <stdexcept>
+#include <vector>
+
+#include "cpp_test_util.h"
+#include "tensorflow/compiler/xla/xla_client/metrics.h"
+#include "tensorflow/compiler/xla/xla_client/multi_wait.h"
+#include "tensorflow/compiler/xla/xla_client/thread_pool.h"
+
+namespace torch_xla {
+namespace cpp_test {
+
+TEST(ThreadPoolTest, MixedPriorities) {
+  const int kClosures = 256;
+  std::atomic<int> count(0);
+  xla::util::MultiWait mwait(kClosures);
+  for (int i = 0; i < kClosures; ++i) {
+    xla::env::Priority priority =
+        i % 2 == 0 ? xla::env::Priority::kHigh : xla::env::Priority::kNormal;
+    xla::env::ScheduleClosure(mwait.Completer([&]() { count += 1; }),
+                              priority);
+  }
+  mwait.Wait();
+  EXPECT_EQ(count.load(), kClosures);
+}
+
+TEST(ThreadPoolTest, NestedSchedule) {
+  // Closures scheduling more closures go to the worker own queue, from where
+  // the idle workers steal them.
+  const int kOuter = 16;
+  const int kInner = 16;
+  std::atomic<int> count(0);
+  xla::util::MultiWait mwait(kOuter);
+  for (int i = 0; i < kOuter; ++i) {
+    auto outer = [&]() {
+      xla::util::MultiWait inner_mwait(kInner);
+      for (int j = 0; j < kInner; ++j) {
+        xla::env::ScheduleClosure(
+            inner_mwait.Completer([&]() { count += 1; }));
+      }
+      inner_mwait.Wait();
+    };
+    xla::env::ScheduleIoClosure(mwait.Completer(std::move(outer)));
+  }
+  mwait.Wait();
+  EXPECT_EQ(count.load(), kOuter * kInner);
+}
+
+TEST(ThreadPoolTest, CompletionException) {
+  xla::env::Completion completion = xla::env::ScheduleClosureWithCompletion(
+      []() { throw std::runtime_error("Closure Exception"); },
+      xla::env::Priority::kHigh);
+  EXPECT_THROW(completion.Wait(), std::runtime_error);
+}
+
+}  // namespace cpp_test
+}  // namespace torch_xla
@@ -1,6 +1,8 @@
 #include <gtest/gtest.h>
 
 #include <string>
+#include <thread>
+#include <vector>
 
 #include "cpp_test_util.h"
 #include "tensorflow/compiler/xla/xla_client/cache.h"
@@ -36,5 +38,122 @@ TEST(XlaUtilCacheTest, BasicTest) {
   EXPECT_EQ(ptr, nullptr);
 }
 
+TEST(XlaUtilCacheTest, SizeFnTest) {
+  static const size_t kMaxSize = 100;
+  xla::util::Cache<int, std::string> cache(
+      kMaxSize,
+      [](const int& key, const std::string& value) { return value.size(); });
+
+  for (int i = 0; i < 10; ++i) {
+    cache.Add(i, std::make_shared<std::string>(10, 'x'));
+  }
+  EXPECT_EQ(cache.Size(), kMaxSize);
+  // Adding an element of size 25 must evict the three oldest ones.
+  cache.Add(10, std::make_shared<std::string>(25, 'y'));
+  EXPECT_EQ(cache.Size(), 95);
+  for (int i = 0; i < 3; ++i) {
+    EXPECT_EQ(cache.Get(i), nullptr);
+  }
+  EXPECT_NE(cache.Get(3), nullptr);
+
+  // An element bigger than the maximum size is still added.
+  auto ptr = cache.Add(11, std::make_shared<std::string>(2 * kMaxSize, 'z'));
+  ASSERT_NE(ptr, nullptr);
+  EXPECT_EQ(cache.Size(), 2 * kMaxSize);
+  EXPECT_NE(cache.Get(11), nullptr);
+
+  EXPECT_TRUE(cache.Erase(11));
+  EXPECT_EQ(cache.Size(), 0);
+}
+
+TEST(XlaUtilCacheTest, ShardedBasicTest) {
+  static const int kMaxSize = 64;
+  xla::util::ShardedCache<int, std::string> cache(kMaxSize);
+
+  for (int i = 0; i < 4 * kMaxSize; ++i) {
+    std::string istr = std::to_string(i);
+    auto ptr = cache.Add(i, std::make_shared<std::string>(istr));
+    ASSERT_NE(ptr, nullptr);
+    EXPECT_EQ(*ptr, istr);
+
+    ptr = cache.Get(i);
+    ASSERT_NE(ptr, nullptr);
+    EXPECT_EQ(*ptr, istr);
+  }
+  EXPECT_LE(cache.Size(), kMaxSize);
+
+  // Adding an existing key returns the cached object.
+  auto ptr = cache.Add(-1, std::make_shared<std::string>("MINUS"));
+  ptr = cache.Add(-1, std::make_shared<std::string>("OTHER"));
+  ASSERT_NE(ptr, nullptr);
+  EXPECT_EQ(*ptr, "MINUS");
+  EXPECT_TRUE(cache.Erase(-1));
+  EXPECT_EQ(cache.Get(-1), nullptr);
+  EXPECT_FALSE(cache.Erase(-1));
+
+  cache.Clear();
+  EXPECT_EQ(cache.Size(), 0);
+}
+
+TEST(XlaUtilCacheTest, ShardedClockTest) {
+  static const size_t kMaxSize = 100;
+  xla::util::ShardedCache<int, std::string> cache(
+      kMaxSize,
+      [](const int& key, const std::string& value) { return value.size(); },
+      /*num_shards=*/1);
+
+  for (int i = 0; i < 10; ++i) {
+    cache.Add(i, std::make_shared<std::string>(10, 'x'));
+  }
+  EXPECT_EQ(cache.Size(), kMaxSize);
+  // The referenced elements get a second chance, so adding an element of size
+  // 25 must evict the three oldest unreferenced ones.
+  EXPECT_NE(cache.Get(0), nullptr);
+  cache.Add(10, std::make_shared<std::string>(25, 'y'));
+  EXPECT_EQ(cache.Size(), 95);
+  EXPECT_NE(cache.Get(0), nullptr);
+  for (int i = 1; i < 4; ++i) {
+    EXPECT_EQ(cache.Get(i), nullptr);
+  }
+  EXPECT_NE(cache.Get(4), nullptr);
+
+  // An element bigger than the maximum size is still added.
+  auto ptr = cache.Add(11, std::make_shared<std::string>(2 * kMaxSize, 'z'));
+  ASSERT_NE(ptr, nullptr);
+  EXPECT_EQ(cache.Size(), 2 * kMaxSize);
+  EXPECT_NE(cache.Get(11), nullptr);
+
+  EXPECT_TRUE(cache.Erase(11));
+  EXPECT_EQ(cache.Size(), 0);
+}
+
+TEST(XlaUtilCacheTest, ShardedConcurrentTest) {
+  static const int kMaxSize = 128;
+  static const int kNumThreads = 8;
+  xla::util::ShardedCache<int, std::string> cache(kMaxSize);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kNumThreads; ++t) {
+    threads.emplace_back([&cache, t]() {
+      for (int i = 0; i < 10000; ++i) {
+        int key = (i * 7 + t) % (2 * kMaxSize);
+        auto ptr = cache.Get(key);
+        if (ptr == nullptr) {
+          ptr = cache.Add(key, std::make_shared<std::string>(
+                                   std::to_string(key)));
+        }
+        ASSERT_NE(ptr, nullptr);
+        EXPECT_EQ(*ptr, std::to_string(key));
+        if (i % 1000 == 0) {
+          cache.Erase(key);
+        }
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  EXPECT_LE(cache.Size(), kMaxSize);
+}
+
 }  // namespace cpp_test
 }  // namespace torch_xla
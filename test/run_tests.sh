@@ -28,10 +28,48 @@ shift $(($OPTIND - 1))
 export TRIM_GRAPH_SIZE=$MAX_GRAPH_SIZE
 export TRIM_GRAPH_CHECK_FREQUENCY=$GRAPH_CHECK_FREQUENCY
 
+function run_test {
+  if [ "$LOGFILE" != "" ]; then
+    "$@" 2>&1 | tee -a $LOGFILE
+  else
+    "$@"
+  fi
+}
+
+# Runs the given test_operations.py test classes, with the environment
+# variable setting (like VAR=1) of the feature they cover.
+function run_feature_tests {
+  local SETTING="$1"
+  shift
+  run_test env "$SETTING" python3 "$CDIR/test_operations.py" "$@" \
+    --verbosity=$VERBOSITY
+}
+
 if [ "$LOGFILE" != "" ]; then
-  python3 "$CDIR/test_operations.py" "$@" --verbosity=$VERBOSITY 2>&1 | tee $LOGFILE
-  python3 "$CDIR/test_mp_replication.py" "$@" 2>&1 | tee $LOGFILE
-else
-  python3 "$CDIR/test_operations.py" "$@" --verbosity=$VERBOSITY
-  python3 "$CDIR/test_mp_replication.py" "$@"
+  rm -f $LOGFILE
 fi
+run_test python3 "$CDIR/test_operations.py" "$@" --verbosity=$VERBOSITY
+run_test python3 "$CDIR/test_mp_replication.py" "$@"
+
+# The features read their environment variables once, so their tests run in
+# processes of their own.
+run_feature_tests XLA_GRAPH_MEMORY_BUDGET=100000 TestGraphMemoryBudget
+run_feature_tests XLA_GRAPH_COMPILE_MAX_NODES=16 TestGraphCompilePartition
+run_feature_tests XLA_HOST_COPY_BUDGET_BYTES=300000 TestHostCopyBudget
+run_feature_tests XLA_FALLBACK_REGIONS=1 TestFallbackRegions
+run_feature_tests XLA_PROMOTE_CHANGING_SCALARS=1 TestScalarPromotion
+run_feature_tests XLA_SPECIALIZE_GRAPHS=1 TestGraphSpecialization
+run_feature_tests XLA_DONATE_BUFFERS=1 TestBufferDonation
+run_feature_tests XLA_PACKED_BOOL_MIN_ELEMENTS=1000 TestPackedBoolUpload
+run_feature_tests XLA_MAX_POOL_BACKWARD=indices TestModelComparator \
+  TestParallelTensorMNIST
+
+# Two CPU devices backed by the same XRT device, so that the multi-device
+# syncs run on hosts with no accelerators.
+run_feature_tests \
+  "XRT_DEVICE_MAP=CPU:0;/job:localservice/replica:0/task:0/device:XLA_CPU:0|CPU:1;/job:localservice/replica:0/task:0/device:XLA_CPU:0" \
+  TestDeviceCopy
+
+# The in-process local client, skipping XRT, on the host platform.
+run_feature_tests XLA_LOCAL_CLIENT_DEVICE=CPU TestAtenXlaTensor TestDeviceCopy \
+  TestMaterialize TestFetchAsync TestLongGraphChain
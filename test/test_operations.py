@@ -25,18 +25,37 @@ import copy
 import itertools
 import numpy
 import re
+import subprocess
+import textwrap
+import threading
+import time
 import torch
 import torch.nn as nn
 import torch.nn.functional as F
 import torch.optim as optim
 import torch_xla
+import torch_xla_py.attention as xatt
 import torch_xla_py.data_parallel as dp
+import torch_xla_py.dropout as xdrop
+import torch_xla_py.host_embedding as he
+import torch_xla_py.host_offload as ho
+import torch_xla_py.keyd_queue as kq
+import torch_xla_py.metrics_saver as ms
+import torch_xla_py.mixed_precision as mp
 import torch_xla_py.model_comparator as mc
+import torch_xla_py.norms as xnorms
+import torch_xla_py.optimizers as xopt
 import torch_xla_py.parallel_loader as pl
+import torch_xla_py.pipeline as xpipe
+import torch_xla_py.quantization as xq
+import torch_xla_py.remat as remat
+import torch_xla_py.rnn as xrnn
+import torch_xla_py.sharded_optimizer as so
 import torch_xla_py.utils as xu
 import torch_xla_py.xla_model as xm
 import torchvision
 import unittest
+import weakref
 
 DeviceSupport = collections.namedtuple('DeviceSupport', ['num_devices'])
 
@@ -62,6 +81,12 @@ def _get_device_support(devname):
   return DeviceSupport(num_devices=num_devices) if num_devices > 0 else None
 
 
+def _requires_env(name):
+  # The tests of the features whose environment variables are read once per
+  # process, which test/run_tests.sh runs in processes of their own.
+  return unittest.skipIf(not os.environ.get(name), 'requires ' + name)
+
+
 def _support_replicated(devname, num_devices):
   devsup = _get_device_support(devname)
   if not devsup:
@@ -248,6 +273,58 @@ class TestToXlaTensorArena(XlaTestCase):
     self.assertTrue(check_fn(xla_data))
 
 
+class TestKeydQueue(XlaTestCase):
+
+  def test_keyd_queue(self):
+    queue = kq.KeydQueue(maxsize=2)
+    items = dict()
+
+    def producer():
+      for key in [3, 1, 0, 2]:
+        queue.put(key, ('item', key))
+      queue.close_write()
+
+    thread = threading.Thread(target=producer)
+    thread.start()
+    for key in range(0, 4):
+      items[key] = queue.get(key)
+    self.assertEqual(queue.get(4), None)
+    thread.join()
+    for key, item in items.items():
+      self.assertEqual(item, ('item', key))
+
+  def test_queue(self):
+    queue = kq.Queue(maxsize=4)
+    tensors = [_gen_tensor(2, 3) for _ in range(0, 3)]
+    for tensor in tensors:
+      queue.put(tensor)
+    queue.close_write()
+    for tensor in tensors:
+      self.assertTrue(queue.get() is tensor)
+    self.assertEqual(queue.get(), None)
+    queue.close()
+
+  def test_dropped_items(self):
+
+    class Item(object):
+      pass
+
+    # The replaced items are released within put(), with the GIL released
+    # while it waits, and the remaining ones by close().
+    queue = kq.KeydQueue(maxsize=4)
+    replaced, kept = Item(), Item()
+    replaced_ref, kept_ref = weakref.ref(replaced), weakref.ref(kept)
+    queue.put(0, replaced)
+    queue.put(0, Item())
+    queue.put(1, kept)
+    del replaced, kept
+    self.assertEqual(replaced_ref(), None)
+    self.assertTrue(kept_ref() is not None)
+    queue.close()
+    self.assertEqual(kept_ref(), None)
+    self.assertEqual(queue.get(0), None)
+
+
 class TestParallelLoader(XlaTestCase):
 
   def test(self):
@@ -263,6 +340,621 @@ class TestParallelLoader(XlaTestCase):
         dx = para_loader.to(data, device)
         self.assertEqual(dx.device, torch.device(device))
 
+  def test_python_workers(self):
+    devices = xm.get_xla_supported_devices()
+    batch_size = 16 * len(devices)
+    gen = xu.FnDataGenerator(
+        lambda x: x * 2.0, batch_size, _gen_tensor, dims=[8], count=10)
+    para_loader = pl.ParallelLoader(
+        gen, batch_size, devices, use_infeed=False)
+    count = 0
+    for x, (data, target) in para_loader:
+      self.assertEqual(x, count)
+      count += 1
+      for i, device in enumerate(devices):
+        dx = para_loader.to(data, device)
+        mini_batch_size = batch_size // len(devices)
+        self.assertEqual(
+            dx.cpu(), data[i * mini_batch_size:(i + 1) * mini_batch_size])
+    self.assertEqual(count, 10)
+
+  def test_lifecycle_metrics(self):
+
+    def total_samples(name):
+      data = torch_xla._XLAC._xla_metric_data(name)
+      return data[0] if data is not None else 0
+
+    devices = xm.get_xla_supported_devices()
+    batch_size = 16 * len(devices)
+    names = ['InputQueueDepth', 'InputPendingTime', 'InputReadyTime']
+    for use_infeed in [True, False]:
+      start_samples = [total_samples(name) for name in names]
+      gen = xu.FnDataGenerator(
+          lambda x: x * 2.0, batch_size, _gen_tensor, dims=[8], count=6)
+      para_loader = pl.ParallelLoader(
+          gen, batch_size, devices, use_infeed=use_infeed)
+      count = sum(1 for _ in para_loader)
+      self.assertEqual(count, 6)
+      for name, start in zip(names, start_samples):
+        self.assertGreaterEqual(total_samples(name) - start, count)
+
+
+class TestDeviceCopy(XlaTestCase):
+
+  def test_copy_between_devices(self):
+    devices = xm.get_xla_supported_devices()
+    if len(devices) < 2:
+      return
+    counter = 'DeviceToDeviceCopies'
+    copies = torch_xla._XLAC._xla_counter_value(counter) or 0
+    x = _gen_tensor(8, 16)
+    xx = x.to(devices[0]) * 2.0
+    yx = xx.to(devices[1])
+    # The source tensor stays usable while the copy is in flight.
+    xx.add_(1.0)
+    self.assertEqual(yx.device, torch.device(devices[1]))
+    self.assertEqual(yx.cpu(), x * 2.0)
+    self.assertEqual(xx.cpu(), x * 2.0 + 1.0)
+    self.assertEqual(torch_xla._XLAC._xla_counter_value(counter) - copies, 1)
+
+  def test_sync_multi_device(self):
+    devices = xm.get_xla_supported_devices()
+    if len(devices) < 2:
+      return
+    x = _gen_tensor(8, 16)
+    xtensors = [x.to(device) * float(i + 1) for i, device in enumerate(devices)]
+    synced = torch_xla._XLAC._xla_counter_value('ParallelSyncDevices') or 0
+    torch_xla._XLAC._xla_sync_multi(xtensors, devices)
+    self.assertEqual(
+        torch_xla._XLAC._xla_counter_value('ParallelSyncDevices') - synced,
+        len(devices))
+    for i, xt in enumerate(xtensors):
+      self.assertEqual(xt.device, torch.device(devices[i]))
+      self.assertEqual(xt.cpu(), x * float(i + 1))
+
+
+class TestRunSteps(XlaTestCase):
+
+  def test_run_steps(self):
+    xla_device = xm.xla_device()
+    model = nn.Linear(5, 3)
+    xla_model = copy.deepcopy(model).to(xla_device)
+    optimizer = optim.SGD(model.parameters(), lr=0.1)
+    xla_optimizer = optim.SGD(xla_model.parameters(), lr=0.1)
+    inputs = _gen_tensor(4, 2, 5)
+    for x in inputs:
+      optimizer.zero_grad()
+      loss = model(x).sum()
+      loss.backward()
+      optimizer.step()
+
+    def step_fn(x):
+      xla_optimizer.zero_grad()
+      xla_loss = xla_model(x).sum()
+      xla_loss.backward()
+      xla_optimizer.step()
+      return xla_loss
+
+    syncs = torch_xla._XLAC._xla_counter_value('MultiStepSyncs') or 0
+    xla_loss = xm.run_steps(step_fn, [inputs], device=xla_device)
+    self.assertEqual(
+        torch_xla._XLAC._xla_counter_value('MultiStepSyncs') - syncs, 1)
+    self.assertEqualRel(xla_loss.cpu(), loss, rel_err=1e-4, abs_err=1e-5)
+    for p, xla_p in zip(model.parameters(), xla_model.parameters()):
+      self.assertEqualRel(xla_p.cpu(), p, rel_err=1e-4, abs_err=1e-5)
+
+
+class TestMaterialize(XlaTestCase):
+
+  def test_set_materialize(self):
+    xla_device = xm.xla_device()
+    x = torch.randn(4, 3)
+    xla_x = x.to(xla_device)
+    xla_hidden = xla_x.exp()
+    xla_y = xla_hidden * 2
+    xm.set_materialize([xla_hidden])
+    pruned = torch_xla._XLAC._xla_counter_value('PrunedSyncTensors') or 0
+    xm.mark_step()
+    self.assertEqual(
+        torch_xla._XLAC._xla_counter_value('PrunedSyncTensors') - pruned, 1)
+    self.assertEqualRel(xla_y.cpu(), x.exp() * 2, rel_err=1e-4, abs_err=1e-5)
+    # The pruned tensor gets computed when read.
+    self.assertEqualRel(xla_hidden.cpu(), x.exp(), rel_err=1e-4, abs_err=1e-5)
+
+  def test_shared_outputs(self):
+    xla_device = xm.xla_device()
+    x = torch.randn(4, 3)
+    xla_hidden = x.to(xla_device).exp()
+    xla_loss = xla_hidden.sum()
+    xla_y = xla_hidden * 2
+    shared = torch_xla._XLAC._xla_counter_value('SyncSharedOutputs') or 0
+    users = torch_xla._XLAC._xla_counter_value('SyncSharedOutputUsers') or 0
+    self.assertEqualRel(
+        xla_loss.cpu(), x.exp().sum(), rel_err=1e-4, abs_err=1e-5)
+    # The exp() computed by the fetch of the loss is read by both the hidden
+    # tensor and the product.
+    self.assertEqual(
+        torch_xla._XLAC._xla_counter_value('SyncSharedOutputs') - shared, 1)
+    self.assertEqual(
+        torch_xla._XLAC._xla_counter_value('SyncSharedOutputUsers') - users, 2)
+    self.assertEqualRel(xla_y.cpu(), x.exp() * 2, rel_err=1e-4, abs_err=1e-5)
+
+  def test_shared_outputs_view(self):
+    xla_device = xm.xla_device()
+    x = torch.randn(4, 3)
+    xla_hidden = x.to(xla_device).exp()
+    xla_loss = xla_hidden.sum()
+    # The view and reshape nodes between the shared output and its users get
+    # cloned over the device data.
+    xla_y = xla_hidden.view(12) * 2
+    xla_z = xla_hidden.reshape(3, 4).sum(1)
+    users = torch_xla._XLAC._xla_counter_value('SyncSharedOutputUsers') or 0
+    self.assertEqualRel(
+        xla_loss.cpu(), x.exp().sum(), rel_err=1e-4, abs_err=1e-5)
+    self.assertEqual(
+        torch_xla._XLAC._xla_counter_value('SyncSharedOutputUsers') - users, 3)
+    self.assertEqualRel(
+        xla_y.cpu(), x.exp().view(12) * 2, rel_err=1e-4, abs_err=1e-5)
+    self.assertEqualRel(
+        xla_z.cpu(), x.exp().reshape(3, 4).sum(1), rel_err=1e-4, abs_err=1e-5)
+
+  def test_eager_release(self):
+    xla_device = xm.xla_device()
+    x = torch.randn(4, 3)
+    xla_x = x.to(xla_device)
+    xm.mark_step()
+    counter = 'EagerReleaseDataHandles'
+    released = torch_xla._XLAC._xla_counter_value(counter) or 0
+    # The in-place update leaves the previous data of the tensor referenced only
+    # by the execution consuming it.
+    xla_x.add_(1.0)
+    xm.mark_step()
+    self.assertEqualRel(xla_x.cpu(), x + 1.0, rel_err=1e-4, abs_err=1e-5)
+    self.assertEqual(
+        torch_xla._XLAC._xla_counter_value(counter) - released, 1)
+
+
+@_requires_env('XLA_GRAPH_MEMORY_BUDGET')
+class TestGraphMemoryBudget(XlaTestCase):
+
+  def test_split_with_reshape(self):
+    xla_device = xm.xla_device()
+    x = torch.randn(64, 64)
+    xla_hidden = x.to(xla_device).exp() * 2
+    # The concatenation keeps all its inputs live, past the budget, while the
+    # hidden tensor is the cheapest cut. The reshapes reading it get cloned
+    # over its device data.
+    xla_y = torch.cat([xla_hidden.reshape(4096) * i for i in range(1, 9)])
+    splits = torch_xla._XLAC._xla_counter_value('GraphMemorySplits') or 0
+    hidden = x.exp() * 2
+    expected = torch.cat([hidden.reshape(4096) * i for i in range(1, 9)])
+    self.assertEqualRel(xla_y.cpu(), expected, rel_err=1e-4, abs_err=1e-4)
+    self.assertGreater(
+        torch_xla._XLAC._xla_counter_value('GraphMemorySplits'), splits)
+
+
+@_requires_env('XLA_HOST_COPY_BUDGET_BYTES')
+class TestHostCopyBudget(XlaTestCase):
+
+  def test_lru_eviction(self):
+    xla_device = xm.xla_device()
+    # Three 128KB host copies, within a budget only fitting two of them.
+    xs = [torch.randn(32, 1024) for _ in range(3)]
+    xla_xs = [(x.to(xla_device) * 2) for x in xs]
+    dropped = torch_xla._XLAC._xla_counter_value('DroppedHostCopies') or 0
+    for xla_x, x in zip(xla_xs, xs):
+      self.assertEqual(xla_x.cpu(), x * 2)
+    # The least recently used copy is dropped, and fetched back from device.
+    self.assertEqual(
+        torch_xla._XLAC._xla_counter_value('DroppedHostCopies'), dropped + 1)
+    self.assertEqual(xla_xs[0].cpu(), xs[0] * 2)
+    self.assertEqual(
+        torch_xla._XLAC._xla_counter_value('DroppedHostCopies'), dropped + 2)
+    # The tensors going away release their host copies.
+    del xla_xs
+    self.assertEqual(
+        torch_xla._XLAC._xla_counter_value('DroppedHostCopies'), dropped + 2)
+
+
+@_requires_env('XLA_FALLBACK_REGIONS')
+class TestFallbackRegions(XlaTestCase):
+
+  def test_queued_uploads(self):
+    device = xm.xla_device()
+    x = torch.rand(5, 3) + 1.0
+    xla_x = x.to(device)
+    # Both the fallback results stay on host, until the addition uploads them
+    # with a single transfer.
+    xla_a = torch.lgamma(xla_x)
+    xla_b = torch.lgamma(xla_x * 2)
+    uploads = torch_xla._XLAC._xla_counter_value('QueuedUploads') or 0
+    upload_tensors = torch_xla._XLAC._xla_counter_value(
+        'QueuedUploadTensors') or 0
+    xla_c = xla_a + xla_b
+    self.assertEqualRel(
+        xla_c.cpu(), torch.lgamma(x) + torch.lgamma(x * 2), rel_err=1e-4,
+        abs_err=1e-4)
+    self.assertEqual(
+        torch_xla._XLAC._xla_counter_value('QueuedUploads'), uploads + 1)
+    self.assertEqual(
+        torch_xla._XLAC._xla_counter_value('QueuedUploadTensors'),
+        upload_tensors + 2)
+
+
+@_requires_env('XLA_PROMOTE_CHANGING_SCALARS')
+class TestScalarPromotion(XlaTestCase):
+
+  def test_steps_across_threads(self):
+    xla_device = xm.xla_device()
+    x = torch.rand(4, 4)
+    xla_x = x.to(xla_device)
+    results = []
+
+    def step(scale):
+      results.append(xla_x * scale)
+
+    # Every step is traced by a new thread, while the step marker runs on the
+    # main one. The scale hitting 1.0 still gets promoted to device data.
+    xm.mark_step()
+    promoted = torch_xla._XLAC._xla_counter_value('PromotedScalarData') or 0
+    for scale in [0.5, 1.0]:
+      thread = threading.Thread(target=step, args=(scale,))
+      thread.start()
+      thread.join()
+      xm.mark_step()
+    self.assertEqual(
+        torch_xla._XLAC._xla_counter_value('PromotedScalarData'), promoted + 1)
+    self.assertEqual(results[0].cpu(), x * 0.5)
+    self.assertEqual(results[1].cpu(), x)
+
+
+@_requires_env('XLA_SPECIALIZE_GRAPHS')
+class TestGraphSpecialization(XlaTestCase):
+
+  def test_invariant_mask(self):
+    device = xm.xla_device()
+    mask = torch.tensor([1.0, 0.0, 1.0], device=device)
+    graphs = torch_xla._XLAC._xla_counter_value('SpecializedGraphs') or 0
+    syncs = torch_xla._XLAC._xla_counter_value('SpecializedSyncs') or 0
+    failures = torch_xla._XLAC._xla_counter_value(
+        'SpecializationGuardFailures') or 0
+    # The mask keeps its device data over the steps, while the input uploads
+    # get new device data, so only the mask is folded.
+    for step in range(12):
+      x = torch.full((3,), float(step)).to(device)
+      self.assertEqual((x * mask).cpu(), torch.tensor([step, 0.0, step]))
+    self.assertEqual(
+        torch_xla._XLAC._xla_counter_value('SpecializedGraphs'), graphs + 1)
+    self.assertGreater(
+        torch_xla._XLAC._xla_counter_value('SpecializedSyncs'), syncs)
+    # A new mask fails the guard, and goes back to the generic graph.
+    mask = torch.tensor([0.0, 1.0, 0.0], device=device)
+    x = torch.full((3,), 2.0).to(device)
+    self.assertEqual((x * mask).cpu(), torch.tensor([0.0, 2.0, 0.0]))
+    self.assertEqual(
+        torch_xla._XLAC._xla_counter_value('SpecializationGuardFailures'),
+        failures + 1)
+
+
+@_requires_env('XLA_DONATE_BUFFERS')
+class TestBufferDonation(XlaTestCase):
+
+  def test_donation_cache_entries(self):
+    device = xm.xla_device()
+
+    def counter(name):
+      return torch_xla._XLAC._xla_counter_value(name) or 0
+
+    def step(keep_input):
+      x = torch.rand(7, 9)
+      xx = x.to(device)
+      # A pending tensor which is not materialized retains the input data, so
+      # the same in-place update graph runs without donating its buffer.
+      xkeep = None
+      if keep_input:
+        xkeep = xx * 2.0
+        xm.set_materialize([xkeep])
+      xx.add_(1.0)
+      names = ['DonatedBuffers', 'UncachedSyncTensors', 'CachedSyncTensors']
+      values = [counter(name) for name in names]
+      xm.mark_step()
+      deltas = [counter(name) - value for name, value in zip(names, values)]
+      self.assertEqual(xx.cpu(), x + 1.0)
+      if xkeep is not None:
+        self.assertEqual(xkeep.cpu(), x * 2.0)
+      return deltas
+
+    # The donating and the non donating computations of the graph have their
+    # own cache entries, which the following steps hit.
+    self.assertEqual(step(keep_input=False), [1, 1, 0])
+    self.assertEqual(step(keep_input=True), [0, 1, 0])
+    self.assertEqual(step(keep_input=False), [1, 0, 1])
+    self.assertEqual(step(keep_input=True), [0, 0, 1])
+
+
+@_requires_env('XLA_PACKED_BOOL_MIN_ELEMENTS')
+class TestPackedBoolUpload(XlaTestCase):
+
+  def _packed_bools(self):
+    return torch_xla._XLAC._xla_counter_value('PackedBoolTensors') or 0
+
+  def test_large_mask(self):
+    device = xm.xla_device()
+    # Above the size of the tensors going through the device data cache
+    # (XLA_DEVDATA_CACHE_MAX_TENSOR_BYTES), which are not packed, and not a
+    # multiple of the 32 bits words the masks are packed into.
+    mask = torch.rand(2049, 2053) > 0.5
+    x = torch.rand(2049, 2053)
+    packed = self._packed_bools()
+    xresult = torch.where(mask.to(device), x.to(device), -x.to(device))
+    self.assertEqual(xresult.cpu(), torch.where(mask, x, -x))
+    self.assertEqual(self._packed_bools(), packed + 1)
+
+  def test_small_mask(self):
+    device = xm.xla_device()
+    mask = torch.rand(3, 5) > 0.5
+    x = torch.rand(3, 5)
+    packed = self._packed_bools()
+    xresult = torch.where(mask.to(device), x.to(device), -x.to(device))
+    self.assertEqual(xresult.cpu(), torch.where(mask, x, -x))
+    self.assertEqual(self._packed_bools(), packed)
+
+
+@_requires_env('XLA_GRAPH_COMPILE_MAX_NODES')
+class TestGraphCompilePartition(XlaTestCase):
+
+  def _graph(self, x):
+    y = x
+    for _ in range(24):
+      y = y * 1.01 + 0.1
+    # The TopK outputs cross the segments, the values feeding the following
+    # ones, and the indices being synced.
+    values, indices = y.topk(2, dim=1)
+    z = values
+    for _ in range(24):
+      z = z * 0.99 + 0.2
+    return y, indices, z
+
+  def test_partitioned_sync(self):
+    xla_device = xm.xla_device()
+    for step in range(2):
+      x = torch.randperm(32).float().view(4, 8)
+      compiles = torch_xla._XLAC._xla_counter_value(
+          'PartitionedSyncCompiles') or 0
+      cached = torch_xla._XLAC._xla_counter_value('CachedPartitionedSyncs') or 0
+      xla_results = self._graph(x.to(xla_device))
+      torch_xla._XLAC._xla_sync_multi(list(xla_results), [])
+      for xla_result, result in zip(xla_results, self._graph(x)):
+        self.assertEqualRel(xla_result.cpu(), result, rel_err=1e-4,
+                            abs_err=1e-4)
+      # The first step compiles the segments, the second one reuses them.
+      if step == 0:
+        self.assertEqual(
+            torch_xla._XLAC._xla_counter_value('PartitionedSyncCompiles'),
+            compiles + 1)
+      else:
+        self.assertEqual(
+            torch_xla._XLAC._xla_counter_value('CachedPartitionedSyncs'),
+            cached + 1)
+
+
+class TestSyncOrder(XlaTestCase):
+
+  def test_permuted_sync(self):
+    xla_device = xm.xla_device()
+    x = torch.randn(4, 3)
+    results = []
+    for permute in [False, True]:
+      xla_x = x.to(xla_device)
+      xla_a = xla_x.exp()
+      xla_b = xla_x * 3
+      tensors = [xla_b, xla_a] if permute else [xla_a, xla_b]
+      uncached = torch_xla._XLAC._xla_counter_value('UncachedSyncTensors') or 0
+      torch_xla._XLAC._xla_sync_multi(tensors, [])
+      results.append(
+          torch_xla._XLAC._xla_counter_value('UncachedSyncTensors') - uncached)
+      self.assertEqualRel(xla_a.cpu(), x.exp(), rel_err=1e-4, abs_err=1e-5)
+      self.assertEqualRel(xla_b.cpu(), x * 3, rel_err=1e-4, abs_err=1e-5)
+    # The permuted sync hits the computation compiled by the first one.
+    self.assertEqual(results[1], 0)
+
+  def test_priority_sync(self):
+    xla_device = xm.xla_device()
+    x = torch.randn(4, 3)
+    xla_x = x.to(xla_device)
+    with xm.execution_priority('low'):
+      xla_a = xla_x.exp()
+      torch_xla._XLAC._xla_sync_multi([xla_a], [], wait=False)
+    # The normal priority sync takes the in-flight low priority result as input.
+    xla_b = xla_a * 3
+    torch_xla._XLAC._xla_sync_multi([xla_b], [], wait=False)
+    self.assertEqualRel(xla_a.cpu(), x.exp(), rel_err=1e-4, abs_err=1e-5)
+    self.assertEqualRel(xla_b.cpu(), x.exp() * 3, rel_err=1e-4, abs_err=1e-5)
+
+
+class TestSharding(XlaTestCase):
+
+  def test_mark_sharding(self):
+    xla_device = xm.xla_device()
+    x = _gen_tensor(8, 4)
+    w = _gen_tensor(4, 6)
+    xla_y = torch.mm(x.to(xla_device), w.to(xla_device))
+    xm.mark_sharding(xla_y, [2, 1], [0, None])
+    self.assertIn('sharding=', torch_xla._XLAC._get_xla_tensors_hlo([xla_y]))
+    self.assertEqualRel(xla_y.cpu(), torch.mm(x, w), rel_err=1e-4,
+                        abs_err=1e-5)
+
+
+class TestControlFlow(XlaTestCase):
+
+  def test_cond(self):
+    xla_device = xm.xla_device()
+    x = _gen_tensor(4, 3)
+    y = _gen_tensor(4, 3)
+    scale = torch.tensor(3.0)
+    xx = x.to(xla_device)
+    xy = y.to(xla_device)
+    xscale = scale.to(xla_device)
+    for pred in [True, False]:
+      xpred = torch.tensor(pred).to(xla_device)
+      results = xm.cond(xpred, lambda a, b: [a * xscale, b + 1.0],
+                        lambda a, b: [a - b, b * b], [xx, xy])
+      expected = [x * scale, y + 1.0] if pred else [x - y, y * y]
+      for result, exp in zip(results, expected):
+        self.assertEqual(result.cpu(), exp)
+
+  def test_while_loop(self):
+    xla_device = xm.xla_device()
+    x = _gen_tensor(4, 3)
+    xx = x.to(xla_device)
+    xi = torch.tensor(0, dtype=torch.int32).to(xla_device)
+    xlimit = torch.tensor(5, dtype=torch.int32).to(xla_device)
+    xi_final, xx_final = xm.while_loop(lambda i, a: i < xlimit,
+                                       lambda i, a: [i + 1, a * 2.0 + 1.0],
+                                       [xi, xx])
+    expected = x
+    for _ in range(5):
+      expected = expected * 2.0 + 1.0
+    self.assertEqual(xi_final.cpu().item(), 5)
+    self.assertEqual(xx_final.cpu(), expected)
+
+
+class TestBoundedOps(XlaTestCase):
+
+  def test_nonzero_bounded(self):
+    xla_device = xm.xla_device()
+    x = torch.tensor([[0, 1, 0], [2, 0, 3]], dtype=torch.float32)
+    indices, count = xm.nonzero_bounded(x.to(xla_device))
+    self.assertEqual(indices.size(), torch.Size([6, 2]))
+    count = count.cpu().item()
+    self.assertEqual(indices.cpu()[:count], torch.nonzero(x))
+    self.assertEqual(indices.cpu()[count:], torch.zeros(6 - count, 2).long())
+
+  def test_masked_select_bounded(self):
+    xla_device = xm.xla_device()
+    x = _gen_tensor(4, 3)
+    mask = torch.tensor([True, False, True]).view(1, 3)
+    values, count = xm.masked_select_bounded(
+        x.to(xla_device), mask.to(xla_device))
+    count = count.cpu().item()
+    self.assertEqual(count, 8)
+    self.assertEqual(values.cpu()[:count], torch.masked_select(x, mask))
+
+  def test_unique_bounded(self):
+    xla_device = xm.xla_device()
+    x = torch.tensor([3, 1, 3, 2, 1, 5], dtype=torch.int64)
+    values, count = xm.unique_bounded(x.to(xla_device))
+    valid = xm.bounded_valid_mask(count, values.size(0))
+    # The padded elements are masked on device.
+    self.assertEqual((values * valid.long()).sum().cpu().item(), 11)
+    count = count.cpu().item()
+    self.assertEqual(values.cpu()[:count], torch.unique(x))
+
+
+class TestHostEmbedding(XlaTestCase):
+
+  def test_cached_sgd(self):
+    xla_device = xm.xla_device()
+    lr = 0.5
+    weight = _gen_tensor(12, 3)
+    expected = weight.clone()
+    embedding = he.HostEmbedding(
+        weight, cache_size=4, device=xla_device, lr=lr)
+    scale = _gen_tensor(2, 3)
+    xscale = scale.to(xla_device)
+    batches = [[0, 1], [1, 2], [5, 5], [7, 8], [0, 9], [1, 0]]
+    for batch in batches:
+      indices = torch.tensor(batch)
+      embedding.prefetch(indices)
+      values = embedding.lookup(indices)
+      self.assertEqual(values.cpu(), expected.index_select(0, indices))
+      (values * xscale).sum().backward()
+      embedding.step()
+      xm.mark_step()
+      expected.index_add_(0, indices, scale * -lr)
+    embedding.flush()
+    self.assertEqual(weight, expected)
+
+  def test_bounded_pending_updates(self):
+    xla_device = xm.xla_device()
+    lr = 0.5
+    weight = _gen_tensor(12, 3)
+    expected = weight.clone()
+    embedding = he.HostEmbedding(
+        weight, cache_size=12, device=xla_device, lr=lr, max_pending_steps=1)
+    indices = torch.tensor([3, 4])
+    # The rows stay cached, so only the pending steps bound gets the older
+    # updates applied to the host table.
+    for _ in range(5):
+      embedding.prefetch(indices)
+      self.assertLessEqual(len(embedding._updates), 1)
+      (embedding.lookup(indices) * 2).sum().backward()
+      embedding.step()
+      xm.mark_step()
+      expected.index_add_(0, indices, torch.full((2, 3), -2 * lr))
+    embedding.prefetch(indices)
+    self.assertLessEqual(len(embedding._updates), 1)
+    self.assertLessEqual(len(embedding._pending_rows), 2)
+    embedding.flush()
+    self.assertEqual(weight, expected)
+    self.assertEqual(len(embedding._pending_rows), 0)
+
+
+class TestQuantization(XlaTestCase):
+
+  def _quantize_input(self, x, scale):
+    return torch.round(x / scale).clamp(-127, 127)
+
+  def test_quantized_linear(self):
+    xla_device = xm.xla_device()
+    linear = nn.Linear(8, 5)
+    x = _gen_tensor(3, 8)
+    input_scale = x.abs().max().item() / 127.0
+    qlinear = xq.QuantizedLinear.from_float(linear, input_scale).to(xla_device)
+    output = qlinear(x.to(xla_device))
+    qweight, scales = xq.quantize_per_channel(linear.weight)
+    expected = torch.mm(
+        self._quantize_input(x, input_scale),
+        qweight.float().t()) * (scales * input_scale) + linear.bias.detach()
+    self.assertEqual(output.cpu(), expected)
+    self.assertEqual(output.cpu(), linear(x).detach(), prec=0.05)
+
+  def test_quantized_conv2d(self):
+    xla_device = xm.xla_device()
+    conv = nn.Conv2d(3, 4, kernel_size=3, padding=1)
+    x = _gen_tensor(2, 3, 6, 6)
+    input_scale = x.abs().max().item() / 127.0
+    qconv = xq.QuantizedConv2d.from_float(conv, input_scale).to(xla_device)
+    output = qconv(x.to(xla_device))
+    qweight, scales = xq.quantize_per_channel(conv.weight)
+    expected = F.conv2d(
+        self._quantize_input(x, input_scale), qweight.float(),
+        padding=1) * (scales * input_scale).view(1, -1, 1, 1)
+    expected = expected + conv.bias.detach().view(1, -1, 1, 1)
+    self.assertEqual(output.cpu(), expected)
+
+
+class TestShapeBucketer(XlaTestCase):
+
+  def test(self):
+    bucketer = dp.ShapeBucketer({0: [8, 16], 1: [32]})
+    counter = 'ShapeBucketingAvoidedGraphs'
+    avoided = torch_xla._XLAC._xla_counter_value(counter) or 0
+    for batch_size in [5, 7, 8, 12]:
+      data = _gen_tensor(batch_size, 20)
+      target = _gen_int_tensor(10, (batch_size,))
+      (pdata, ptarget), masks = bucketer((data, target))
+      bsize = 8 if batch_size <= 8 else 16
+      self.assertEqual(pdata.size(), torch.Size([bsize, 32]))
+      self.assertEqual(ptarget.size(), torch.Size([bsize]))
+      self.assertEqual(pdata[:batch_size, :20], data)
+      self.assertEqual(ptarget[:batch_size], target)
+      self.assertEqual(int(masks[0].sum()), batch_size)
+      self.assertEqual(int(masks[1].sum()), 20)
+    # Sizes 7 and 8 share the bucket of size 5.
+    self.assertEqual(
+        torch_xla._XLAC._xla_counter_value(counter) - avoided, 2)
+
 
 class TestAtenTensorTo(XlaTestCase):
 
@@ -286,6 +978,28 @@ class TestAtenTensorTo(XlaTestCase):
       self.assertEqual(t0.cpu(), t1.cpu())
 
 
+class TestPipeline(XlaTestCase):
+
+  def test_forward_backward(self):
+    devices = xm.get_xla_supported_devices()
+    stages = [nn.Linear(8, 16), nn.Sequential(nn.ReLU(), nn.Linear(16, 4))]
+    ref_stages = copy.deepcopy(stages)
+    x = _gen_tensor(10, 8)
+    target = _gen_tensor(10, 4)
+    loss_fn = nn.MSELoss()
+    pipe = xpipe.Pipeline(
+        stages, [devices[i % len(devices)] for i in range(len(stages))],
+        chunks=3)
+    loss = pipe.forward_backward(x, target, loss_fn)
+    ref_loss = loss_fn(ref_stages[1](ref_stages[0](x)), target)
+    ref_loss.backward()
+    self.assertEqual(loss.cpu(), ref_loss)
+    ref_params = itertools.chain(*[s.parameters() for s in ref_stages])
+    for p, ref_p in zip(pipe.parameters(), ref_params):
+      self.assertEqual(p.grad.cpu(), ref_p.grad)
+    self.assertEqual(pipe(x).cpu(), ref_stages[1](ref_stages[0](x)))
+
+
 class XlaMNIST(nn.Module):
 
   def __init__(self):
@@ -334,6 +1048,26 @@ class TestParallelTensorMNIST(XlaTestCase):
     model_parallel(loop_fn, train_loader)
 
 
+class TestBroadcastParams(XlaTestCase):
+
+  def test_broadcast_params(self):
+    devices = xm.get_xla_supported_devices()
+    module = XlaMNIST()
+    train_loader = xu.SampleGenerator(
+        data=(torch.zeros(4, 1, 28, 28), torch.zeros(4, dtype=torch.int64)),
+        sample_count=len(devices))
+
+    def loop_fn(model, loader, device, context):
+      return [p.cpu() for p in model.parameters()]
+
+    model_parallel = dp.DataParallel(
+        module, device_ids=devices, broadcast_params=True)
+    results = model_parallel(loop_fn, train_loader)
+    for params in results:
+      for param, expected in zip(params, module.parameters()):
+        self.assertEqual(param, expected.data)
+
+
 class TestParallelTensorResnet18(XlaTestCase):
 
   def test(self):
@@ -381,6 +1115,257 @@ class TestLongGraphChain(XlaTestCase):
     self.assertEqualRel(x, xla_x.cpu(), rel_err=1e-3, abs_err=5)
 
 
+class TestFetchAsync(XlaTestCase):
+
+  def test_fetch_async(self):
+    device = xm.xla_device()
+    x = torch.rand(4, 8)
+    y = torch.rand(4, 8)
+    xla_x = x.to(device)
+    xla_y = y.to(device)
+    xla_sum = (xla_x + xla_y).sum()
+    xla_prod = xla_x * xla_y
+    xm.mark_step()
+    fetched = []
+    done = threading.Event()
+
+    def callback(h):
+      fetched.append(h.wait())
+      done.set()
+
+    handle = xm.fetch_async([xla_sum, xla_prod, xla_x], callback=callback)
+    results = handle.wait()
+    self.assertTrue(done.wait(60))
+    self.assertTrue(handle.is_ready())
+    self.assertEqual(results[0], (x + y).sum())
+    self.assertEqual(results[1], x * y)
+    self.assertEqual(results[2], x)
+    self.assertEqual(len(fetched), 1)
+    self.assertEqual(fetched[0][1], results[1])
+
+  def test_fetch_for_monitoring(self):
+    device = xm.xla_device()
+    x = torch.randn(16, 32)
+    xla_x = x.to(device)
+    bf16 = xm.fetch_for_monitoring([xla_x], transform='bf16')[0]
+    sampled = xm.fetch_for_monitoring([xla_x], transform='subsample:5')[0]
+    self.assertEqual(bf16, x, prec=1e-2 * x.abs().max().item())
+    self.assertEqual(sampled, x.view(-1)[::5])
+    dequantized = xm.fetch_for_monitoring([xla_x], transform='int8')[0]
+    self.assertEqual(dequantized, x, prec=x.abs().max().item() / 127)
+    counts, value_range = xm.fetch_for_monitoring(
+        [xla_x], transform='histogram:10')[0]
+    self.assertEqual(counts.sum().item(), x.numel())
+    self.assertEqual(value_range, torch.stack([x.min(), x.max()]))
+
+
+class TestMetricAccumulator(XlaTestCase):
+
+  def test_accumulate(self):
+    device = xm.xla_device()
+    metrics = xm.MetricAccumulator(device, topk=(1, 3))
+    outputs, targets, losses = [], [], []
+    for _ in range(3):
+      output = torch.randn(8, 10)
+      target = torch.randint(0, 10, (8,), dtype=torch.int64)
+      loss = torch.rand([])
+      metrics.add(
+          target.to(device), output=output.to(device), loss=loss.to(device))
+      xm.mark_step()
+      outputs.append(output)
+      targets.append(target)
+      losses.append(loss)
+    result = metrics.fetch().wait()
+    output = torch.cat(outputs)
+    target = torch.cat(targets)
+    _, pred = output.topk(3, dim=1)
+    hits = pred.eq(target.view(-1, 1)).float()
+    self.assertEqual(result['count'], 24)
+    self.assertAlmostEqual(result['loss'], sum(losses).item() / 3, places=5)
+    self.assertAlmostEqual(
+        result['top1'], 100.0 * hits[:, :1].sum().item() / 24, places=4)
+    self.assertAlmostEqual(
+        result['top3'], 100.0 * hits.sum().item() / 24, places=4)
+    metrics.reset()
+    self.assertEqual(metrics.fetch().wait()['count'], 0)
+
+
+class TestCheckpoint(XlaTestCase):
+
+  def test_save_load(self):
+    device = xm.xla_device()
+    model = XlaMNIST().to(device)
+    state_dict = model.state_dict()
+    state_dict['step'] = torch.tensor(7, dtype=torch.int64, device=device)
+    with tempfile.NamedTemporaryFile() as tf:
+      xm.save_checkpoint(state_dict, tf.name)
+      loaded = xm.load_checkpoint(tf.name, device=device)
+    self.assertEqual(list(loaded.keys()), list(state_dict.keys()))
+    for name, tensor in state_dict.items():
+      self.assertEqual(loaded[name].dtype, tensor.dtype)
+      self.assertEqual(loaded[name].cpu(), tensor.cpu())
+
+  def test_save_async(self):
+    device = xm.xla_device()
+    model = XlaMNIST().to(device)
+    state_dict = model.state_dict()
+    expected = {name: tensor.cpu() for name, tensor in state_dict.items()}
+    with tempfile.NamedTemporaryFile() as tf:
+      future = xm.save_checkpoint_async(state_dict, tf.name)
+      # The updates issued while the snapshot is being written must not show
+      # up in the saved values.
+      for tensor in state_dict.values():
+        tensor.add_(1.0)
+      xm.mark_step()
+      future.wait()
+      self.assertTrue(future.is_ready())
+      loaded = xm.load_checkpoint(tf.name, device=device)
+    self.assertEqual(list(loaded.keys()), list(state_dict.keys()))
+    for name, tensor in expected.items():
+      self.assertEqual(loaded[name].cpu(), tensor)
+
+
+class TestMetricsExporter(XlaTestCase):
+
+  def test_openmetrics_report(self):
+    xla_device = xm.xla_device()
+    t = torch.randn(4, 4, device=xla_device)
+    xm.mark_step()
+    report = torch_xla._XLAC._xla_openmetrics_report()
+    self.assertTrue(report.endswith('# EOF\n'))
+    self.assertIn('# TYPE xla_CreateXlaTensor counter', report)
+    self.assertIn('xla_CreateXlaTensor_total ', report)
+
+  def test_metrics_server(self):
+    try:
+      from urllib.request import urlopen
+    except ImportError:
+      from urllib2 import urlopen
+    port = ms.start_metrics_server()
+    report = urlopen('http://localhost:{}/metrics'.format(port)).read()
+    self.assertIn('# EOF', report.decode('utf-8'))
+    self.assertGreater(
+        torch_xla._XLAC._xla_counter_value('MetricsExporterScrapes') or 0, 0)
+
+
+class TestGraphBundle(XlaTestCase):
+
+  def test_save_load(self):
+    xla_device = xm.xla_device()
+    x = _gen_tensor(4, 5)
+    xx = x.to(xla_device)
+    xresult = (xx * 3.0 + 1.0).tanh()
+    self.assertEqual(xresult.cpu(), (x * 3.0 + 1.0).tanh())
+    with tempfile.NamedTemporaryFile() as tf:
+      xm.save_graph_bundle(tf.name)
+      self.assertGreater(xm.load_graph_bundle(tf.name), 0)
+    xresult = (xx * 3.0 + 1.0).tanh()
+    self.assertEqual(xresult.cpu(), (x * 3.0 + 1.0).tanh())
+
+  def test_load_in_new_process(self):
+    xla_device = xm.xla_device()
+    x = torch.rand(6, 7)
+    xresult = (x.to(xla_device) * 4.0 - 2.0).sin()
+    self.assertEqual(xresult.cpu(), (x * 4.0 - 2.0).sin())
+    # The new process starts with an empty compilation cache, so its first
+    # sync of the same graph only hits the cache if the bundle filled it.
+    script = textwrap.dedent("""
+        import sys
+        import torch
+        import torch_xla
+        import torch_xla_py.xla_model as xm
+        assert xm.load_graph_bundle(sys.argv[1]) > 0
+        x = torch.rand(6, 7)
+        xresult = (x.to(xm.xla_device()) * 4.0 - 2.0).sin()
+        assert torch.allclose(xresult.cpu(), (x * 4.0 - 2.0).sin(), atol=1e-5)
+        assert torch_xla._XLAC._xla_counter_value('CachedSyncTensors') == 1
+        """)
+    with tempfile.NamedTemporaryFile() as tf:
+      xm.save_graph_bundle(tf.name)
+      subprocess.check_call([sys.executable, '-c', script, tf.name])
+
+  def test_lazy_graph_bundle(self):
+    xla_device = xm.xla_device()
+    x = torch.rand(5, 3)
+    xx = x.to(xla_device)
+    xresult = (xx * 2.0 - 1.0).sigmoid()
+    self.assertEqual(xresult.cpu(), (x * 2.0 - 1.0).sigmoid())
+
+    def counter(name):
+      return torch_xla._XLAC._xla_counter_value(name) or 0
+
+    def compiled():
+      return (counter('SpeculativeCompiles') +
+              counter('SpeculativeCompileErrors') +
+              counter('SpeculativeCompileMisses'))
+
+    compiles = compiled()
+    hits = counter('SpeculativeCompileHits')
+    with tempfile.NamedTemporaryFile() as tf:
+      xm.save_graph_bundle(tf.name)
+      num_graphs = xm.load_graph_bundle(tf.name, lazy=True)
+      self.assertGreater(num_graphs, 0)
+    # The background compilations start with the first sync, here one of a
+    # graph which is not part of the bundle.
+    y = torch.rand(11, 13)
+    self.assertEqual((y.to(xla_device) * 5.0).cos().cpu(), (y * 5.0).cos())
+    deadline = time.time() + 120
+    while compiled() < compiles + num_graphs and time.time() < deadline:
+      time.sleep(0.05)
+    self.assertEqual(compiled(), compiles + num_graphs)
+    xresult = (xx * 2.0 - 1.0).sigmoid()
+    self.assertEqual(xresult.cpu(), (x * 2.0 - 1.0).sigmoid())
+    self.assertEqual(counter('SpeculativeCompileHits') - hits, 1)
+
+  def test_ir_capture_replay(self):
+    xla_device = xm.xla_device()
+    xx = torch.rand(5, 3).to(xla_device)
+    xresult = (xx * 3.0 + 1.0).tanh().sum(dim=1)
+    with tempfile.NamedTemporaryFile() as tf:
+      xm.save_ir_capture([xresult], tf.name)
+      stats = xm.replay_ir_capture(tf.name, device=xla_device, iterations=2)
+    self.assertGreater(stats['num_nodes'], 1)
+    self.assertGreaterEqual(stats['num_parameters'], 1)
+    self.assertEqual(len(stats['execute_ms']), 2)
+    self.assertEqual(stats['output_sizes'], [list(xresult.size())])
+
+  def test_ir_capture_replay_linear(self):
+    xla_device = xm.xla_device()
+    xx = torch.rand(5, 3).to(xla_device)
+    # The weight is device data, so it gets replayed as a parameter.
+    xw = torch.rand(4, 3).to(xla_device)
+    xb = torch.rand(4).to(xla_device)
+    xresult = xx @ xw.t() + xb
+    with tempfile.NamedTemporaryFile() as tf:
+      xm.save_ir_capture([xresult], tf.name)
+      stats = xm.replay_ir_capture(tf.name, device=xla_device, iterations=1)
+    self.assertEqual(stats['num_parameters'], 3)
+    self.assertEqual(stats['output_sizes'], [list(xresult.size())])
+
+
+class TestTensorsFromFile(XlaTestCase):
+
+  def test_tensors_from_file(self):
+    device = xm.xla_device()
+    a = torch.rand(16, 8)
+    b = torch.randint(0, 100, (5,), dtype=torch.int64)
+    with tempfile.NamedTemporaryFile() as tf:
+      tf.write(a.numpy().tobytes())
+      tf.write(a.numpy().tobytes())
+      tf.flush()
+      xla_a, xla_a_half = xm.tensors_from_file(
+          tf.name, [0, a.numel() * 4], [a.size(), (8, 8)], torch.float32,
+          device=device)
+    self.assertEqual(a, xla_a.cpu())
+    self.assertEqual(a[:8], xla_a_half.cpu())
+    with tempfile.NamedTemporaryFile() as tf:
+      tf.write(b.numpy().tobytes())
+      tf.flush()
+      mapped_file = torch_xla._XLAC.MappedFile(tf.name)
+      xla_b = xm.tensors_from_file(mapped_file, [0], [b.size()], torch.int64)
+    self.assertEqual(b, xla_b[0].cpu())
+
+
 class TestSelect(XlaTestCase):
 
   def test_get_xla_tensor(self):
@@ -470,6 +1455,22 @@ class TestAtenXlaTensor(XlaTestCase):
     x = torch.randperm(3, device=xm.xla_device())
     self.assertEqual(x.device.type, 'xla')
 
+  def test_rng_seed(self):
+    device = xm.xla_device()
+
+    def draw():
+      xm.set_rng_state(71, device=device)
+      x = torch.ones(64, 64, device=device)
+      return (torch.nn.functional.dropout(x, p=0.5, training=True).cpu(),
+              torch.randperm(32, device=device).cpu())
+
+    mask1, perm1 = draw()
+    mask2, perm2 = draw()
+    self.assertEqual(mask1, mask2)
+    self.assertEqual(perm1, perm2)
+    self.assertEqual(perm1.sort()[0], torch.arange(32))
+    self.assertNotEqual(xm.get_rng_state(device=device), 71)
+
   def test_randn_like(self):
     shape = (5, 1, 1)
     x = torch.randn_like(torch.zeros(shape, device=xm.xla_device()))
@@ -827,6 +1828,595 @@ class TestAtenXlaTensor(XlaTestCase):
         [torch.randn(0, 1, 2, 0),
          torch.tensor([], dtype=torch.long)], test_fn)
 
+  def test_embedding_sparse_backward(self):
+    xla_device = xm.xla_device()
+    num_weights = 100
+    indices = torch.randint(0, 10, (4, 8))
+    grad_output = torch.randn(4, 8, 16)
+    weight = torch.zeros(num_weights, 16, requires_grad=True)
+    torch.nn.functional.embedding(
+        indices, weight, padding_idx=3).backward(grad_output)
+    rows, row_grads = torch_xla._XLAC._xla_embedding_sparse_backward(
+        grad_output.to(xla_device),
+        indices.to(xla_device),
+        num_weights,
+        padding_idx=3)
+    rows = rows.cpu()
+    row_grads = row_grads.cpu()
+    # Each touched row must appear exactly once, the other slots are unused.
+    used = rows < num_weights
+    self.assertEqual(used.sum().item(), torch.unique(indices).numel())
+    dense = torch.zeros(num_weights, 16).index_add_(0, rows[used],
+                                                    row_grads[used])
+    self.assertEqualRel(dense, weight.grad)
+
+  def test_mixed_precision_scope(self):
+    xla_device = xm.xla_device()
+    a = torch.randn(16, 32)
+    b = torch.randn(32, 8)
+    x = torch.randn(2, 3, 8, 8)
+    conv = nn.Conv2d(3, 4, 3)
+    xla_conv = copy.deepcopy(conv).to(xla_device)
+    with mp.precision_scope('bf16', 'f32'):
+      xla_mm = torch.mm(a.to(xla_device), b.to(xla_device))
+      xla_out = xla_conv(x.to(xla_device))
+    self.assertEqual(torch_xla._XLAC._xla_get_mixed_precision(), ('', ''))
+    self.assertEqualRel(
+        xla_mm.cpu(), torch.mm(a, b), rel_err=5e-2, abs_err=0.1)
+    self.assertEqualRel(xla_out.cpu(), conv(x), rel_err=5e-2, abs_err=0.1)
+
+  def test_mixed_precision_backward(self):
+    xla_device = xm.xla_device()
+    x = torch.randn(2, 3, 8, 8)
+    conv = nn.Conv2d(3, 4, 3)
+    xla_conv = copy.deepcopy(conv).to(xla_device)
+    with mp.precision_scope('bf16', 'f32'):
+      xla_conv(x.to(xla_device)).sum().backward()
+    # The backward runs within the autograd engine threads, which must follow
+    # the policy of the scope.
+    self.assertIn(
+        'compute_type=bf16',
+        torch_xla._XLAC._get_xla_tensors_text([xla_conv.weight.grad]))
+    conv(x).sum().backward()
+    self.assertEqualRel(
+        xla_conv.weight.grad.cpu(), conv.weight.grad, rel_err=5e-2,
+        abs_err=0.1)
+
+  def test_dynamic_loss_scaler(self):
+    xla_device = xm.xla_device()
+    model = nn.Linear(4, 2).to(xla_device)
+    optimizer = optim.SGD(model.parameters(), lr=0.1)
+    scaler = mp.DynamicLossScaler(init_scale=4.0, growth_interval=1)
+    params = [p.cpu() for p in model.parameters()]
+    model(torch.randn(3, 4, device=xla_device)).sum().backward()
+    for p in model.parameters():
+      p.grad.data.fill_(float('inf'))
+    self.assertIsNone(scaler.step(optimizer))
+    self.assertEqual(scaler.loss_scale, 2.0)
+    for p, cpu_p in zip(model.parameters(), params):
+      self.assertEqual(p.cpu(), cpu_p)
+    optimizer.zero_grad()
+    scaler.scale(model(torch.randn(3, 4, device=xla_device)).sum()).backward()
+    scaler.step(optimizer)
+    self.assertEqual(scaler.loss_scale, 4.0)
+
+  def test_device_loss_scaler(self):
+    xla_device = xm.xla_device()
+    model = nn.Linear(4, 2).to(xla_device)
+    optimizer = xopt.Adam(model.parameters(), lr=0.1)
+    scaler = mp.DeviceLossScaler(init_scale=4.0, growth_interval=1)
+    params = [p.cpu() for p in model.parameters()]
+    model(torch.randn(3, 4, device=xla_device)).sum().backward()
+    for p in model.parameters():
+      p.grad.data.fill_(float('inf'))
+    scaler.step(optimizer)
+    xm.mark_step()
+    self.assertEqual(scaler.found_inf.item(), 1.0)
+    self.assertEqual(scaler.loss_scale.item(), 2.0)
+    for p, cpu_p in zip(model.parameters(), params):
+      self.assertEqual(p.cpu(), cpu_p)
+      self.assertEqual(optimizer.state[p]['exp_avg'].cpu(),
+                       torch.zeros_like(cpu_p))
+    optimizer.zero_grad()
+    scaler.scale(model(torch.randn(3, 4, device=xla_device)).sum()).backward()
+    scaler.step(optimizer)
+    xm.mark_step()
+    self.assertEqual(scaler.found_inf.item(), 0.0)
+    self.assertEqual(scaler.loss_scale.item(), 4.0)
+    for p, cpu_p in zip(model.parameters(), params):
+      self.assertFalse(torch.equal(p.cpu(), cpu_p))
+
+  def test_fused_attention(self):
+    xla_device = xm.xla_device()
+    # More keys than XLA_ATTENTION_BLOCK_SIZE, to span multiple blocks.
+    query = torch.randn(2, 3, 8, 16, requires_grad=True)
+    key = torch.randn(2, 3, 600, 16, requires_grad=True)
+    value = torch.randn(2, 3, 600, 4, requires_grad=True)
+    mask = torch.rand(2, 1, 1, 600) < 0.3
+    grad_output = torch.randn(2, 3, 8, 4)
+    scores = torch.matmul(query, key.transpose(-2, -1)) / 4.0
+    output = torch.matmul(
+        F.softmax(scores.masked_fill(mask, float('-inf')), dim=-1), value)
+    output.backward(grad_output)
+    xla_inputs = [
+        x.detach().to(xla_device).requires_grad_(True)
+        for x in (query, key, value)
+    ]
+    xla_output = xatt.attention(*xla_inputs, mask=mask.to(xla_device))
+    xla_output.backward(grad_output.to(xla_device))
+    self.assertEqualRel(xla_output.cpu(), output, rel_err=1e-3, abs_err=1e-4)
+    for x, xla_x in zip((query, key, value), xla_inputs):
+      self.assertEqualRel(xla_x.grad.cpu(), x.grad, rel_err=1e-3, abs_err=1e-4)
+
+  def test_multi_key_sort(self):
+    xla_device = xm.xla_device()
+    major = torch.tensor([1.0, 0.0, 1.0, 0.0], device=xla_device)
+    minor = torch.tensor([3, 2, 1, 0], device=xla_device)
+    values, indices = torch_xla._XLAC._xla_sort([major, minor], dim=0)
+    self.assertEqual(values.cpu(), torch.tensor([0.0, 0.0, 1.0, 1.0]))
+    self.assertEqual(indices.cpu(), torch.tensor([3, 1, 2, 0]))
+    values, indices = torch_xla._XLAC._xla_sort([major, minor],
+                                                dim=0,
+                                                descending=True)
+    self.assertEqual(values.cpu(), torch.tensor([1.0, 1.0, 0.0, 0.0]))
+    self.assertEqual(indices.cpu(), torch.tensor([0, 2, 1, 3]))
+
+  def test_fused_norms(self):
+    xla_device = xm.xla_device()
+    cases = [
+        (lambda x, w, b: F.layer_norm(x, [5, 6], w, b),
+         lambda x, w, b: xnorms.layer_norm(x, [5, 6], w, b), [5, 6]),
+        (lambda x, w, b: F.group_norm(x, 2, w, b),
+         lambda x, w, b: xnorms.group_norm(x, 2, w, b), [4]),
+        (lambda x, w, b: F.instance_norm(x, weight=w, bias=b),
+         lambda x, w, b: xnorms.instance_norm(x, w, b), [4]),
+    ]
+    for norm_fn, xla_norm_fn, affine_size in cases:
+      input = torch.randn(3, 4, 5, 6, requires_grad=True)
+      weight = torch.randn(*affine_size, requires_grad=True)
+      bias = torch.randn(*affine_size, requires_grad=True)
+      grad_output = torch.randn(3, 4, 5, 6)
+      norm_fn(input, weight, bias).backward(grad_output)
+      xla_inputs = [
+          x.detach().to(xla_device).requires_grad_(True)
+          for x in (input, weight, bias)
+      ]
+      xla_output = xla_norm_fn(*xla_inputs)
+      xla_output.backward(grad_output.to(xla_device))
+      self.assertEqualRel(
+          xla_output.cpu(),
+          norm_fn(input, weight, bias).detach(),
+          rel_err=1e-3,
+          abs_err=1e-4)
+      for x, xla_x in zip((input, weight, bias), xla_inputs):
+        self.assertEqualRel(
+            xla_x.grad.cpu(), x.grad, rel_err=1e-3, abs_err=1e-4)
+
+  def _check_rnn_while(self, xla_tensors):
+    # The sequences, and their backward, run their steps within an XLA While,
+    # rather than being unrolled over the time steps.
+    hlo = torch_xla._XLAC._get_xla_tensors_hlo(xla_tensors)
+    self.assertIn('while(', hlo)
+
+  def _check_rnn_grads(self, cpu_tensors, xla_tensors):
+    for cpu_t, xla_t in zip(cpu_tensors, xla_tensors):
+      self.assertEqualRel(xla_t.grad.cpu(), cpu_t.grad, rel_err=1e-3,
+                          abs_err=1e-4)
+
+  def test_fused_lstm_cell(self):
+    xla_device = xm.xla_device()
+    cell = nn.LSTMCell(5, 7)
+    input = torch.randn(3, 5, requires_grad=True)
+    hx = torch.randn(3, 7, requires_grad=True)
+    cx = torch.randn(3, 7, requires_grad=True)
+    h, c = cell(input, (hx, cx))
+    (h.sum() + 2 * c.sum()).backward()
+    xla_cell = copy.deepcopy(cell).to(xla_device)
+    xla_inputs = [
+        x.detach().to(xla_device).requires_grad_(True) for x in (input, hx, cx)
+    ]
+    xla_h, xla_c = xrnn.lstm_cell(*xla_inputs, xla_cell.weight_ih,
+                                  xla_cell.weight_hh, xla_cell.bias_ih,
+                                  xla_cell.bias_hh)
+    (xla_h.sum() + 2 * xla_c.sum()).backward()
+    self.assertEqualRel(xla_h.cpu(), h, rel_err=1e-3, abs_err=1e-4)
+    self.assertEqualRel(xla_c.cpu(), c, rel_err=1e-3, abs_err=1e-4)
+    self._check_rnn_grads([input, hx, cx] + list(cell.parameters()),
+                          xla_inputs + list(xla_cell.parameters()))
+
+  def test_fused_gru_cell(self):
+    xla_device = xm.xla_device()
+    cell = nn.GRUCell(5, 7)
+    input = torch.randn(3, 5, requires_grad=True)
+    hx = torch.randn(3, 7, requires_grad=True)
+    cell(input, hx).sum().backward()
+    xla_cell = copy.deepcopy(cell).to(xla_device)
+    xla_inputs = [
+        x.detach().to(xla_device).requires_grad_(True) for x in (input, hx)
+    ]
+    xla_h = xrnn.gru_cell(*xla_inputs, xla_cell.weight_ih, xla_cell.weight_hh,
+                          xla_cell.bias_ih, xla_cell.bias_hh)
+    xla_h.sum().backward()
+    self.assertEqualRel(xla_h.cpu(), cell(input, hx), rel_err=1e-3,
+                        abs_err=1e-4)
+    self._check_rnn_grads([input, hx] + list(cell.parameters()),
+                          xla_inputs + list(xla_cell.parameters()))
+
+  def test_fused_lstm(self):
+    xla_device = xm.xla_device()
+    lstm = nn.LSTM(5, 7)
+    input = torch.randn(6, 3, 5, requires_grad=True)
+    h0 = torch.randn(1, 3, 7, requires_grad=True)
+    c0 = torch.randn(1, 3, 7, requires_grad=True)
+    output, (h_n, c_n) = lstm(input, (h0, c0))
+    (output.sum() + 2 * h_n.sum() + 3 * c_n.sum()).backward()
+    xla_lstm = copy.deepcopy(lstm).to(xla_device)
+    xla_inputs = [
+        x.detach().to(xla_device).requires_grad_(True) for x in (input, h0, c0)
+    ]
+    xla_output, (xla_h_n, xla_c_n) = xrnn.lstm(
+        xla_inputs[0], xla_inputs[1][0], xla_inputs[2][0],
+        xla_lstm.weight_ih_l0, xla_lstm.weight_hh_l0, xla_lstm.bias_ih_l0,
+        xla_lstm.bias_hh_l0)
+    self._check_rnn_while([xla_output])
+    (xla_output.sum() + 2 * xla_h_n.sum() + 3 * xla_c_n.sum()).backward()
+    self._check_rnn_while([xla_inputs[0].grad])
+    self.assertEqualRel(xla_output.cpu(), output, rel_err=1e-3, abs_err=1e-4)
+    self.assertEqualRel(xla_c_n.cpu(), c_n[0], rel_err=1e-3, abs_err=1e-4)
+    self._check_rnn_grads([input, h0, c0] + list(lstm.parameters()),
+                          xla_inputs + list(xla_lstm.parameters()))
+
+  def test_fused_gru(self):
+    xla_device = xm.xla_device()
+    gru = nn.GRU(5, 7, bias=False)
+    input = torch.randn(6, 3, 5, requires_grad=True)
+    h0 = torch.randn(1, 3, 7, requires_grad=True)
+    output, h_n = gru(input, h0)
+    (output.sum() + 2 * h_n.sum()).backward()
+    xla_gru = copy.deepcopy(gru).to(xla_device)
+    xla_inputs = [
+        x.detach().to(xla_device).requires_grad_(True) for x in (input, h0)
+    ]
+    xla_output, xla_h_n = xrnn.gru(xla_inputs[0], xla_inputs[1][0],
+                                   xla_gru.weight_ih_l0, xla_gru.weight_hh_l0)
+    self._check_rnn_while([xla_output])
+    (xla_output.sum() + 2 * xla_h_n.sum()).backward()
+    self._check_rnn_while([xla_inputs[0].grad])
+    self.assertEqualRel(xla_output.cpu(), output, rel_err=1e-3, abs_err=1e-4)
+    self._check_rnn_grads([input, h0] + list(gru.parameters()),
+                          xla_inputs + list(xla_gru.parameters()))
+
+  def test_packed_dropout(self):
+    xla_device = xm.xla_device()
+    # Not a multiple of 32 elements, so that the last mask word is partial.
+    x = torch.randn(7, 45, device=xla_device, requires_grad=True)
+    output = xdrop.dropout(x, p=0.3)
+    output.backward(torch.ones_like(output))
+    output = output.cpu()
+    grad = x.grad.cpu()
+    kept = output.ne(0)
+    prob = kept.sum().item() / float(kept.numel())
+    self.assertGreater(prob, 0.6)
+    self.assertLess(prob, 0.8)
+    self.assertEqualRel(
+        output, x.detach().cpu() * kept.float() / 0.7, rel_err=1e-5)
+    self.assertEqualRel(grad, kept.float() / 0.7, rel_err=1e-5)
+
+  def test_execution_plan(self):
+    xla_device = xm.xla_device()
+    model = nn.Sequential(nn.Linear(8, 16), nn.ReLU(), nn.Linear(16, 4))
+    xla_model = copy.deepcopy(model).to(xla_device)
+    xm.mark_step()
+    plan = xm.create_execution_plan(
+        lambda x: (xla_model(x), x.sum()), [torch.randn(5, 8)],
+        device=xla_device)
+    self.assertEqual(plan.num_inputs(), 1)
+    for _ in range(3):
+      x = torch.randn(5, 8)
+      output, total = plan([x])
+      self.assertEqualRel(
+          output.cpu(), model(x).detach(), rel_err=1e-4, abs_err=1e-5)
+      self.assertEqualRel(total.cpu(), x.sum(), rel_err=1e-4, abs_err=1e-5)
+    self.assertRaises(RuntimeError, lambda: plan([torch.randn(4, 8)]))
+
+  def test_execution_plan_folds_batch_norm(self):
+    xla_device = xm.xla_device()
+    model = nn.Sequential(
+        nn.Conv2d(3, 8, 3, padding=1, bias=False), nn.BatchNorm2d(8),
+        nn.ReLU(), nn.Conv2d(8, 4, 3, stride=2), nn.BatchNorm2d(4),
+        nn.LeakyReLU(0.1))
+    for module in model.modules():
+      if isinstance(module, nn.BatchNorm2d):
+        module.weight.data.uniform_(0.5, 1.5)
+        module.bias.data.uniform_(-0.5, 0.5)
+        module.running_mean.uniform_(-0.5, 0.5)
+        module.running_var.uniform_(0.5, 1.5)
+    model.eval()
+    xla_model = copy.deepcopy(model).to(xla_device)
+    xm.mark_step()
+    folded = torch_xla._XLAC._xla_counter_value('FoldedBatchNorms') or 0
+    plan = xm.create_execution_plan(
+        xla_model, [torch.randn(2, 3, 9, 9)], device=xla_device)
+    self.assertEqual(
+        torch_xla._XLAC._xla_counter_value('FoldedBatchNorms') - folded, 2)
+    x = torch.randn(2, 3, 9, 9)
+    output, = plan([x])
+    self.assertEqualRel(
+        output.cpu(), model(x).detach(), rel_err=1e-4, abs_err=1e-4)
+
+  def test_execution_plan_folds_batch_norm_flatten(self):
+    xla_device = xm.xla_device()
+    model = nn.Sequential(
+        nn.Conv2d(3, 4, 3, padding=1, bias=False), nn.BatchNorm2d(4),
+        nn.ReLU())
+    fc = nn.Linear(4 * 5 * 5, 6)
+    model[1].running_mean.uniform_(-0.5, 0.5)
+    model[1].running_var.uniform_(0.5, 1.5)
+    model.eval()
+    xla_model = copy.deepcopy(model).to(xla_device)
+    xla_fc = copy.deepcopy(fc).to(xla_device)
+    xm.mark_step()
+    folded = torch_xla._XLAC._xla_counter_value('FoldedBatchNorms') or 0
+    # The flatten view between the folded layers and the linear one gets
+    # cloned over the folded convolution.
+    plan = xm.create_execution_plan(
+        lambda x: xla_fc(xla_model(x).view(2, -1)), [torch.randn(2, 3, 5, 5)],
+        device=xla_device)
+    self.assertEqual(
+        torch_xla._XLAC._xla_counter_value('FoldedBatchNorms') - folded, 1)
+    x = torch.randn(2, 3, 5, 5)
+    output, = plan([x])
+    self.assertEqualRel(
+        output.cpu(),
+        fc(model(x).view(2, -1)).detach(),
+        rel_err=1e-4,
+        abs_err=1e-4)
+
+  def test_batching_executor(self):
+    xla_device = xm.xla_device()
+    model = nn.Sequential(nn.Linear(8, 16), nn.ReLU(), nn.Linear(16, 4))
+    xla_model = copy.deepcopy(model).to(xla_device)
+    xm.mark_step()
+    executor = xm.create_batching_executor(
+        xla_model, [torch.randn(1, 8)],
+        batch_sizes=(2, 4, 8),
+        max_delay_ms=10.0,
+        device=xla_device)
+    inputs = [torch.randn(rows, 8) for rows in (1, 3, 2, 5, 1, 8, 2)]
+    futures = [None] * len(inputs)
+
+    def submit(index):
+      futures[index] = executor.submit([inputs[index]])
+
+    threads = [
+        threading.Thread(target=submit, args=(i,)) for i in range(len(inputs))
+    ]
+    for thread in threads:
+      thread.start()
+    for thread in threads:
+      thread.join()
+    for x, future in zip(inputs, futures):
+      output, = future.wait()
+      self.assertEqualRel(
+          output, model(x).detach(), rel_err=1e-4, abs_err=1e-5)
+    self.assertRaises(RuntimeError,
+                      lambda: executor.submit([torch.randn(9, 8)]))
+    self.assertRaises(RuntimeError,
+                      lambda: executor.submit([torch.randn(2, 7)]))
+
+  def test_checkpoint_sequential(self):
+    xla_device = xm.xla_device()
+    model = nn.Sequential(
+        nn.Linear(8, 16), nn.Tanh(), nn.Linear(16, 16), nn.Tanh(),
+        nn.Linear(16, 4))
+    x = torch.randn(5, 8)
+    model(x).sum().backward()
+    for kwargs in ({}, {'segments': 2}, {'budget_bytes': 400}):
+      xla_model = copy.deepcopy(model).to(xla_device)
+      xla_model.zero_grad()
+      xla_x = x.to(xla_device).requires_grad_(True)
+      remat.checkpoint_sequential(xla_model, xla_x, **kwargs).sum().backward()
+      for p, xla_p in zip(model.parameters(), xla_model.parameters()):
+        self.assertEqualRel(
+            xla_p.grad.cpu(), p.grad, rel_err=1e-4, abs_err=1e-5)
+
+  def test_optimizer_state_offload(self):
+    xla_device = xm.xla_device()
+    model = nn.Linear(5, 3)
+    xla_model = copy.deepcopy(model).to(xla_device)
+    optimizer = optim.Adam(model.parameters(), lr=0.1)
+    xla_optimizer = optim.Adam(xla_model.parameters(), lr=0.1)
+    offloader = ho.OptimizerStateOffloader(xla_optimizer)
+    for _ in range(3):
+      x = torch.randn(4, 5)
+      optimizer.zero_grad()
+      model(x).sum().backward()
+      optimizer.step()
+      xla_optimizer.zero_grad()
+      xla_model(x.to(xla_device)).sum().backward()
+      xm.mark_step()
+      offloader.prefetch()
+      with offloader.resident():
+        xm.optimizer_step(xla_optimizer, barrier=True)
+    offloader.prefetch()
+    for state in xla_optimizer.state.values():
+      self.assertFalse(xm.is_xla_tensor(state['exp_avg']))
+    for p, xla_p in zip(model.parameters(), xla_model.parameters()):
+      self.assertEqualRel(xla_p.cpu(), p, rel_err=1e-4, abs_err=1e-5)
+
+  def test_model_residency(self):
+    xla_device = xm.xla_device()
+    models = [nn.Linear(6, 6) for _ in range(3)]
+    # Every model holds 6 * 6 + 6 float parameters, so two of them fit.
+    manager = ho.ModelResidencyManager(2 * 42 * 4, device=xla_device)
+    for i, model in enumerate(models):
+      manager.register(i, copy.deepcopy(model).to(xla_device))
+    self.assertFalse(manager.is_resident(0))
+    self.assertTrue(manager.is_resident(2))
+    manager.prefetch(0)
+    self.assertFalse(manager.is_resident(1))
+    x = torch.randn(2, 6)
+    for i in (0, 1, 2, 0):
+      output = manager.acquire(i)(x.to(xla_device))
+      self.assertEqualRel(
+          output.cpu(), models[i](x).detach(), rel_err=1e-4, abs_err=1e-5)
+      self.assertLessEqual(manager.resident_bytes(), 2 * 42 * 4)
+
+  def test_sharded_optimizer(self):
+    xla_device = xm.xla_device()
+    # The odd parameter sizes exercise the shards padding.
+    model = nn.Linear(5, 3)
+    xla_model = copy.deepcopy(model).to(xla_device)
+    optimizer = optim.Adam(model.parameters(), lr=0.1)
+    xla_optimizer = so.ShardedOptimizer(
+        optim.Adam, xla_model.parameters(), lr=0.1)
+    for _ in range(3):
+      x = torch.randn(4, 5)
+      optimizer.zero_grad()
+      model(x).sum().backward()
+      optimizer.step()
+      xla_optimizer.zero_grad()
+      xla_model(x.to(xla_device)).sum().backward()
+      xm.optimizer_step(xla_optimizer)
+    for p, xla_p in zip(model.parameters(), xla_model.parameters()):
+      self.assertEqualRel(xla_p.cpu(), p, rel_err=1e-4, abs_err=1e-5)
+
+  def test_gradient_accumulation(self):
+    xla_device = xm.xla_device()
+    model = nn.Linear(5, 3)
+    xla_model = copy.deepcopy(model).to(xla_device)
+    optimizer = optim.SGD(model.parameters(), lr=0.1)
+    xla_optimizer = optim.SGD(xla_model.parameters(), lr=0.1)
+    for _ in range(2):
+      optimizer.zero_grad()
+      for _ in range(3):
+        x = torch.randn(4, 5)
+        model(x).sum().backward()
+        xla_model(x.to(xla_device)).sum().backward()
+        xm.optimizer_step(xla_optimizer, accumulation_steps=3)
+        xla_optimizer.zero_grad()
+      optimizer.step()
+      xm.mark_step()
+      for p, xla_p in zip(model.parameters(), xla_model.parameters()):
+        self.assertEqualRel(xla_p.cpu(), p, rel_err=1e-4, abs_err=1e-5)
+
+  def test_gradient_accumulation_unused_last(self):
+    xla_device = xm.xla_device()
+    model = nn.ModuleList([nn.Linear(5, 3), nn.Linear(5, 3)])
+    xla_model = copy.deepcopy(model).to(xla_device)
+    optimizer = optim.SGD(model.parameters(), lr=0.1)
+    xla_optimizer = optim.SGD(xla_model.parameters(), lr=0.1)
+
+    def loss_fn(model, x, step):
+      # The second layer gets no gradient within the last micro-batch.
+      loss = model[0](x).sum()
+      return loss + model[1](x).sum() if step < 2 else loss
+
+    optimizer.zero_grad()
+    for step in range(3):
+      x = torch.randn(4, 5)
+      loss_fn(model, x, step).backward()
+      loss_fn(xla_model, x.to(xla_device), step).backward()
+      xm.optimizer_step(xla_optimizer, accumulation_steps=3)
+    optimizer.step()
+    xm.mark_step()
+    for p, xla_p in zip(model.parameters(), xla_model.parameters()):
+      self.assertEqualRel(xla_p.cpu(), p, rel_err=1e-4, abs_err=1e-5)
+
+  def _test_fused_optimizer(self, optimizer_fn, xla_optimizer_fn, **kwargs):
+    xla_device = xm.xla_device()
+    model = nn.Linear(5, 3)
+    xla_model = copy.deepcopy(model).to(xla_device)
+    optimizer = optimizer_fn(model.parameters(), **kwargs)
+    xla_optimizer = xla_optimizer_fn(xla_model.parameters(), **kwargs)
+    for _ in range(3):
+      x = torch.randn(4, 5)
+      optimizer.zero_grad()
+      model(x).sum().backward()
+      optimizer.step()
+      xla_optimizer.zero_grad()
+      xla_model(x.to(xla_device)).sum().backward()
+      xm.optimizer_step(xla_optimizer, barrier=True)
+    for p, xla_p in zip(model.parameters(), xla_model.parameters()):
+      self.assertEqualRel(xla_p.cpu(), p, rel_err=1e-4, abs_err=1e-5)
+
+  def test_fused_sgd(self):
+    for kwargs in [{}, {
+        'momentum': 0.5,
+        'dampening': 0.1
+    }, {
+        'momentum': 0.9,
+        'nesterov': True,
+        'weight_decay': 0.01
+    }]:
+      self._test_fused_optimizer(optim.SGD, xopt.SGD, lr=0.1, **kwargs)
+
+  def test_fused_adam(self):
+    for amsgrad in [False, True]:
+      self._test_fused_optimizer(
+          optim.Adam,
+          xopt.Adam,
+          lr=0.1,
+          weight_decay=0.01,
+          amsgrad=amsgrad)
+
+  def test_fused_lamb(self):
+
+    class ReferenceLamb(optim.Optimizer):
+
+      def __init__(self, params, lr, weight_decay):
+        super(ReferenceLamb, self).__init__(
+            params, dict(lr=lr, weight_decay=weight_decay))
+
+      def step(self):
+        beta1, beta2, eps = 0.9, 0.999, 1e-6
+        for group in self.param_groups:
+          for p in group['params']:
+            state = self.state[p]
+            if not state:
+              state['step'] = 0
+              state['exp_avg'] = torch.zeros_like(p.data)
+              state['exp_avg_sq'] = torch.zeros_like(p.data)
+            state['step'] += 1
+            grad = p.grad.data
+            exp_avg, exp_avg_sq = state['exp_avg'], state['exp_avg_sq']
+            exp_avg.mul_(beta1).add_(1 - beta1, grad)
+            exp_avg_sq.mul_(beta2).addcmul_(1 - beta2, grad, grad)
+            update = (exp_avg / (1 - beta1**state['step'])) / (
+                (exp_avg_sq / (1 - beta2**state['step'])).sqrt() + eps)
+            update.add_(group['weight_decay'], p.data)
+            p_norm = p.data.norm()
+            u_norm = update.norm()
+            trust_ratio = 1.0
+            if p_norm > 0 and u_norm > 0:
+              trust_ratio = (p_norm / u_norm).item()
+            p.data.add_(-group['lr'] * trust_ratio, update)
+
+    self._test_fused_optimizer(
+        ReferenceLamb, xopt.Lamb, lr=0.1, weight_decay=0.01)
+
+  def test_fused_clip_grad_norm(self):
+    xla_device = xm.xla_device()
+    for norm_type in [1, 2, 3.5, float('inf')]:
+      for max_norm in [0.1, 1e6]:
+        model = nn.Linear(5, 3)
+        xla_model = copy.deepcopy(model).to(xla_device)
+        x = torch.randn(4, 5)
+        model(x).sum().backward()
+        xla_model(x.to(xla_device)).sum().backward()
+        total_norm = torch.nn.utils.clip_grad_norm_(
+            model.parameters(), max_norm, norm_type=norm_type)
+        xla_total_norm = xopt.clip_grad_norm_(
+            xla_model.parameters(), max_norm, norm_type=norm_type)
+        self.assertEqualRel(
+            xla_total_norm.cpu(),
+            torch.tensor(float(total_norm)),
+            rel_err=1e-4,
+            abs_err=1e-5)
+        for p, xla_p in zip(model.parameters(), xla_model.parameters()):
+          self.assertEqualRel(
+              xla_p.grad.cpu(), p.grad, rel_err=1e-4, abs_err=1e-5)
+
   def test_writeable_tensors_updates(self):
 
     def test_fn(s, i):
@@ -947,6 +2537,51 @@ class TestGeneric(XlaTestCase):
     self.assertEqual(b.dtype, torch.int8)
     self.assertEqual(b.sum().item(), 0)
 
+  def test_graph_stats(self):
+    torch_xla._XLAC._xla_clear_graph_stats()
+    device = xm.xla_device()
+    for _ in range(3):
+      x = torch.ones(7, 13, device=device) * 3.0
+      xm.mark_step()
+    records = torch_xla._XLAC._xla_graph_stats(sort_by='executions')
+    self.assertTrue(records)
+    self.assertEqual(records[0]['compiles'], 1)
+    self.assertEqual(records[0]['executions'], 3)
+    self.assertEqual(records[0]['output_bytes'], 3 * 7 * 13 * 4)
+    self.assertGreater(records[0]['hlo_instructions'], 0)
+
+  def test_op_profile(self):
+    torch_xla._XLAC._xla_clear_op_profile()
+    attributed = torch_xla._XLAC._xla_op_profile_add([('fusion.1', 1e-3)])
+    self.assertEqual(attributed, 0)
+    self.assertEqual(len(torch_xla._XLAC._xla_op_profile_stats()), 0)
+    report = torch_xla._XLAC._xla_op_profile_report()
+    self.assertIn('UnattributedTime', report)
+
+  def test_invariant_inputs_sync(self):
+    device = xm.xla_device()
+    mask = torch.tensor([1.0, 0.0, 1.0], device=device)
+    for step in range(12):
+      x = torch.full((3,), float(step), device=device)
+      self.assertEqual((x * mask).cpu(), torch.tensor([step, 0.0, step]))
+    mask = torch.tensor([0.0, 1.0, 0.0], device=device)
+    x = torch.full((3,), 2.0, device=device)
+    self.assertEqual((x * mask).cpu(), torch.tensor([0.0, 2.0, 0.0]))
+
+  def test_fallback_stats(self):
+    torch_xla._XLAC._xla_clear_fallback_stats()
+    device = xm.xla_device()
+    x = torch.rand(5, 3, device=device)
+    y = torch.lgamma(x)
+    self.assertEqual(y.size(), x.size())
+    records = torch_xla._XLAC._xla_fallback_stats(sort_by='calls')
+    lgamma = [r for r in records if r['name'] == 'lgamma']
+    self.assertEqual(len(lgamma), 1)
+    self.assertEqual(lgamma[0]['calls'], 1)
+    self.assertEqual(lgamma[0]['bytes_to_host'], 5 * 3 * 4)
+    self.assertEqual(lgamma[0]['bytes_to_device'], 5 * 3 * 4)
+    self.assertIn('lgamma', torch_xla._XLAC._xla_fallback_report())
+
 
 if __name__ == '__main__':
   torch.set_default_tensor_type('torch.FloatTensor')
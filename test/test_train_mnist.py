@@ -130,16 +130,13 @@ def train_mnist():
                                          tracker.global_rate())
 
   def test_loop_fn(model, loader, device, context):
-    total_samples = 0
-    correct = 0
+    metrics = xm.MetricAccumulator(device)
     model.eval()
     for x, (data, target) in loader:
       output = model(data)
-      pred = output.max(1, keepdim=True)[1]
-      correct += pred.eq(target.view_as(pred)).sum().item()
-      total_samples += data.size()[0]
+      metrics.add(target, output=output)
 
-    accuracy = 100.0 * correct / total_samples
+    accuracy = metrics.fetch().wait()['top1']
     test_utils.print_test_update(device, accuracy)
     return accuracy
 
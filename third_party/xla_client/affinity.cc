@@ -0,0 +1,214 @@
+#include "tensorflow/compiler/xla/xla_client/affinity.h"
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include <algorithm>
+#include <fstream>
+#include <map>
+
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_split.h"
+#include "absl/strings/strip.h"
+#include "tensorflow/compiler/xla/xla_client/debug_macros.h"
+#include "tensorflow/compiler/xla/xla_client/sys_util.h"
+#include "tensorflow/compiler/xla/xla_client/tf_logging.h"
+
+namespace xla {
+namespace affinity {
+namespace {
+
+int ParseCpuNumber(absl::string_view text, const string& spec) {
+  int value = 0;
+  XLA_CHECK(absl::SimpleAtoi(text, &value) && value >= 0)
+      << "Invalid CPU set specification: " << spec;
+  return value;
+}
+
+// Parses the CPU lists of the kernel (like the content of the NUMA nodes
+// cpulist files), which are comma separated lists of CPUs and CPU ranges.
+void AppendCpuList(const string& list, const string& spec,
+                   std::vector<int>* cpus) {
+  for (absl::string_view item :
+       absl::StrSplit(list, ',', absl::SkipWhitespace())) {
+    item = absl::StripAsciiWhitespace(item);
+    std::vector<absl::string_view> bounds = absl::StrSplit(item, '-');
+    XLA_CHECK_LE(bounds.size(), 2) << "Invalid CPU set specification: " << spec;
+    int start = ParseCpuNumber(bounds.front(), spec);
+    int end = ParseCpuNumber(bounds.back(), spec);
+    XLA_CHECK_LE(start, end) << "Invalid CPU set specification: " << spec;
+    for (int cpu = start; cpu <= end; ++cpu) {
+      cpus->push_back(cpu);
+    }
+  }
+}
+
+string NumaNodeCpuListPath(int node) {
+  return absl::StrCat("/sys/devices/system/node/node", node, "/cpulist");
+}
+
+// The CPUs of every NUMA node of the host, empty if the topology is not
+// exposed by the kernel.
+const std::vector<std::vector<int>>& GetNumaNodesCpus() {
+  static const std::vector<std::vector<int>>* nodes_cpus = []() {
+    auto nodes_cpus = new std::vector<std::vector<int>>();
+    while (true) {
+      std::ifstream file(NumaNodeCpuListPath(nodes_cpus->size()));
+      string list;
+      if (!file || !std::getline(file, list)) {
+        break;
+      }
+      std::vector<int> cpus;
+      AppendCpuList(list, list, &cpus);
+      nodes_cpus->push_back(std::move(cpus));
+    }
+    return nodes_cpus;
+  }();
+  return *nodes_cpus;
+}
+
+// Maps every CPU number to its NUMA node.
+const std::vector<int>& GetCpuNodes() {
+  static const std::vector<int>* cpu_nodes = []() {
+    auto cpu_nodes = new std::vector<int>();
+    const std::vector<std::vector<int>>& nodes_cpus = GetNumaNodesCpus();
+    for (size_t node = 0; node < nodes_cpus.size(); ++node) {
+      for (int cpu : nodes_cpus[node]) {
+        if (static_cast<size_t>(cpu) >= cpu_nodes->size()) {
+          cpu_nodes->resize(cpu + 1, 0);
+        }
+        (*cpu_nodes)[cpu] = node;
+      }
+    }
+    return cpu_nodes;
+  }();
+  return *cpu_nodes;
+}
+
+#if defined(__linux__)
+
+std::vector<int> GetThreadCpus() {
+  std::vector<int> cpus;
+  cpu_set_t cpu_set;
+  CPU_ZERO(&cpu_set);
+  if (pthread_getaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set) == 0) {
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+      if (CPU_ISSET(cpu, &cpu_set)) {
+        cpus.push_back(cpu);
+      }
+    }
+  }
+  return cpus;
+}
+
+#else
+
+std::vector<int> GetThreadCpus() { return {}; }
+
+#endif
+
+}  // namespace
+
+std::vector<int> ParseCpuSet(const string& spec) {
+  std::vector<int> cpus;
+  for (absl::string_view item :
+       absl::StrSplit(spec, ',', absl::SkipWhitespace())) {
+    item = absl::StripAsciiWhitespace(item);
+    if (absl::ConsumePrefix(&item, "node")) {
+      int node = ParseCpuNumber(item, spec);
+      const std::vector<std::vector<int>>& nodes_cpus = GetNumaNodesCpus();
+      XLA_CHECK_LT(static_cast<size_t>(node), nodes_cpus.size())
+          << "Invalid NUMA node in CPU set specification: " << spec;
+      cpus.insert(cpus.end(), nodes_cpus[node].begin(),
+                  nodes_cpus[node].end());
+    } else {
+      AppendCpuList(string(item), spec, &cpus);
+    }
+  }
+  std::sort(cpus.begin(), cpus.end());
+  cpus.erase(std::unique(cpus.begin(), cpus.end()), cpus.end());
+  return cpus;
+}
+
+std::vector<int> GetEnvCpus(const char* name) {
+  return ParseCpuSet(sys_util::GetEnvString(name, ""));
+}
+
+std::map<string, std::vector<int>> ParseDeviceCpus(const string& spec) {
+  std::map<string, std::vector<int>> devices_cpus;
+  for (absl::string_view entry :
+       absl::StrSplit(spec, ';', absl::SkipWhitespace())) {
+    std::vector<string> parts = absl::StrSplit(entry, '=');
+    XLA_CHECK_EQ(parts.size(), 2) << "Invalid XLA_DEVICE_CPUS entry: " << entry;
+    devices_cpus[string(absl::StripAsciiWhitespace(parts[0]))] =
+        ParseCpuSet(parts[1]);
+  }
+  return devices_cpus;
+}
+
+const std::vector<int>& GetDeviceCpus(const string& device) {
+  static const std::map<string, std::vector<int>>* devices_cpus =
+      new std::map<string, std::vector<int>>(
+          ParseDeviceCpus(sys_util::GetEnvString("XLA_DEVICE_CPUS", "")));
+  static const std::vector<int>* no_cpus = new std::vector<int>();
+  auto it = devices_cpus->find(device);
+  return it != devices_cpus->end() ? it->second : *no_cpus;
+}
+
+bool SetThreadCpus(const std::vector<int>& cpus) {
+  if (cpus.empty()) {
+    return true;
+  }
+#if defined(__linux__)
+  cpu_set_t cpu_set;
+  CPU_ZERO(&cpu_set);
+  for (int cpu : cpus) {
+    if (cpu < CPU_SETSIZE) {
+      CPU_SET(cpu, &cpu_set);
+    }
+  }
+  int error = pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set);
+  if (error != 0) {
+    TF_LOG(WARNING) << "Unable to set the thread CPU affinity: error "
+                    << error;
+    return false;
+  }
+  return true;
+#else
+  return false;
+#endif
+}
+
+int GetNumNumaNodes() {
+  return std::max<int>(GetNumaNodesCpus().size(), 1);
+}
+
+int GetCurrentNumaNode() {
+#if defined(__linux__)
+  const std::vector<int>& cpu_nodes = GetCpuNodes();
+  int cpu = sched_getcpu();
+  if (cpu >= 0 && static_cast<size_t>(cpu) < cpu_nodes.size()) {
+    return cpu_nodes[cpu];
+  }
+#endif
+  return 0;
+}
+
+ScopedThreadCpus::ScopedThreadCpus(const std::vector<int>& cpus) {
+  if (!cpus.empty()) {
+    saved_cpus_ = GetThreadCpus();
+    bound_ = !saved_cpus_.empty() && SetThreadCpus(cpus);
+  }
+}
+
+ScopedThreadCpus::~ScopedThreadCpus() {
+  if (bound_) {
+    SetThreadCpus(saved_cpus_);
+  }
+}
+
+}  // namespace affinity
+}  // namespace xla
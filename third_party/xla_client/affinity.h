@@ -0,0 +1,58 @@
+#ifndef TENSORFLOW_COMPILER_XLA_XLA_CLIENT_AFFINITY_H_
+#define TENSORFLOW_COMPILER_XLA_XLA_CLIENT_AFFINITY_H_
+
+#include <map>
+#include <vector>
+
+#include "tensorflow/compiler/xla/types.h"
+
+namespace xla {
+namespace affinity {
+
+// Parses a CPU set specification, a comma separated list of CPU numbers
+// ("3"), CPU ranges ("0-15") and NUMA nodes ("node1", which stands for all the
+// CPUs of the node). Returns the sorted, unique CPU numbers.
+std::vector<int> ParseCpuSet(const string& spec);
+
+// Returns the CPU set configured by the given environment variable, or an
+// empty vector if the variable is not set.
+std::vector<int> GetEnvCpus(const char* name);
+
+// Parses a device CPU sets specification, a semicolon separated list of
+// DEVICE=CPUSET entries (for example "TPU:0=node0;TPU:1=node1").
+std::map<string, std::vector<int>> ParseDeviceCpus(const string& spec);
+
+// Returns the CPU set the host side work of the given device (like the staging
+// copies of its transfers) should run on, as configured by XLA_DEVICE_CPUS,
+// with the ParseDeviceCpus() format. Returns an empty vector for devices which
+// have no CPU set configured.
+const std::vector<int>& GetDeviceCpus(const string& device);
+
+// Binds the calling thread to the given CPUs. An empty CPU set is a no-op.
+// Returns whether the binding succeeded.
+bool SetThreadCpus(const std::vector<int>& cpus);
+
+// The number of NUMA nodes of the host, which is 1 if the NUMA topology is not
+// available.
+int GetNumNumaNodes();
+
+// The NUMA node of the CPU the calling thread is running on.
+int GetCurrentNumaNode();
+
+// Binds the calling thread to a CPU set for the scope lifetime, and restores
+// the previous binding on exit.
+class ScopedThreadCpus {
+ public:
+  explicit ScopedThreadCpus(const std::vector<int>& cpus);
+
+  ~ScopedThreadCpus();
+
+ private:
+  std::vector<int> saved_cpus_;
+  bool bound_ = false;
+};
+
+}  // namespace affinity
+}  // namespace xla
+
+#endif  // TENSORFLOW_COMPILER_XLA_XLA_CLIENT_AFFINITY_H_
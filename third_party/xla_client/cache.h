@@ -1,12 +1,15 @@
 #ifndef TENSORFLOW_COMPILER_XLA_RPC_CACHE_H_
 #define TENSORFLOW_COMPILER_XLA_RPC_CACHE_H_
 
+#include <algorithm>
+#include <atomic>
 #include <functional>
 #include <list>
 #include <memory>
 #include <mutex>
 #include <unordered_map>
 #include <utility>
+#include <vector>
 
 namespace xla {
 namespace util {
@@ -14,15 +17,22 @@ namespace util {
 // Generic key and object cache with LRU expiration policy. The objects of type
 // T will be stored as std::shared_ptr<T> and taken and returned as such, by the
 // cache API.
+// By default every element accounts for a unit of size, so the max_size is the
+// maximum number of elements. A custom SizeFn can be used to account elements
+// with a different metric (like their size in bytes).
 template <typename K, typename T, typename H = std::hash<K>,
           typename E = std::equal_to<K>>
 class Cache {
  public:
   using TypePtr = std::shared_ptr<T>;
   using Element = std::pair<K, TypePtr>;
+  using SizeFn = std::function<size_t(const K&, const T&)>;
 
   explicit Cache(size_t max_size) : max_size_(max_size) {}
 
+  Cache(size_t max_size, SizeFn size_fn)
+      : max_size_(max_size), size_fn_(std::move(size_fn)) {}
+
   // Adds an object to the cache, unless it already exists. If the cache grows
   // beyond the limit set during construction, the oldest used object will be
   // removed from the cache.
@@ -34,10 +44,16 @@ class Cache {
     if (!emplace_result.second) {
       element_list_.erase(it);
       DoLRU(emplace_result.first->second);
-    } else if (element_list_.size() > max_size_) {
-      Element* last = &element_list_.back();
-      element_map_.erase(&last->first);
-      element_list_.pop_back();
+    } else {
+      size_ += ElementSize(*it);
+      // Never evict the element which has just been added, even if it alone
+      // exceeds the maximum size.
+      while (size_ > max_size_ && element_list_.size() > 1) {
+        Element* last = &element_list_.back();
+        size_ -= ElementSize(*last);
+        element_map_.erase(&last->first);
+        element_list_.pop_back();
+      }
     }
     return emplace_result.first->second->second;
   }
@@ -63,6 +79,7 @@ class Cache {
       return false;
     }
     auto lit = it->second;
+    size_ -= ElementSize(*lit);
     element_map_.erase(it);
     element_list_.erase(lit);
     return true;
@@ -72,6 +89,13 @@ class Cache {
     std::lock_guard<std::mutex> slock(lock_);
     element_map_.clear();
     element_list_.clear();
+    size_ = 0;
+  }
+
+  // Returns the current size of the cache, according to the SizeFn used.
+  size_t Size() {
+    std::lock_guard<std::mutex> slock(lock_);
+    return size_;
   }
 
  private:
@@ -99,12 +123,222 @@ class Cache {
     element_list_.splice(element_list_.begin(), element_list_, it);
   }
 
+  size_t ElementSize(const Element& element) const {
+    return size_fn_ ? size_fn_(element.first, *element.second) : 1;
+  }
+
   std::mutex lock_;
   size_t max_size_ = 0;
+  size_t size_ = 0;
+  SizeFn size_fn_;
   ElementList element_list_;
   ElementMap element_map_;
 };
 
+// A cache with the same API of the Cache above, meant to be shared by many
+// threads. The keys are spread over independently locked shards, and the
+// lookups do not reorder any list (they only flag the element), so the shard
+// locks are held very briefly, and the lookups of keys falling into different
+// shards do not serialize at all. The expiration policy is an approximate LRU
+// (CLOCK): a lookup marks the element as referenced, and the eviction skips
+// (and clears) the referenced elements, instead of keeping them in strict
+// usage order.
+// The max_size (and the SizeFn accounting) is split evenly among the shards,
+// so an element can be evicted before the whole cache is full.
+template <typename K, typename T, typename H = std::hash<K>,
+          typename E = std::equal_to<K>>
+class ShardedCache {
+ public:
+  using TypePtr = std::shared_ptr<T>;
+  using SizeFn = std::function<size_t(const K&, const T&)>;
+
+  static const size_t kDefaultShards = 16;
+  static const size_t kMinShardSize = 8;
+
+  explicit ShardedCache(size_t max_size, SizeFn size_fn = nullptr,
+                        size_t num_shards = kDefaultShards)
+      : size_fn_(std::move(size_fn)) {
+    // Small shards would evict too eagerly on uneven key distributions, so
+    // small caches get fewer shards.
+    num_shards =
+        std::max<size_t>(std::min(num_shards, max_size / kMinShardSize), 1);
+    size_t shard_size = (max_size + num_shards - 1) / num_shards;
+    shards_.reserve(num_shards);
+    for (size_t i = 0; i < num_shards; ++i) {
+      shards_.emplace_back(new Shard(shard_size));
+    }
+  }
+
+  // Adds an object to the cache, unless it already exists, in which case the
+  // existing object is returned.
+  TypePtr Add(K key, TypePtr object) {
+    Shard* shard = GetShard(key);
+    std::lock_guard<std::mutex> slock(shard->lock);
+    return shard->Add(std::move(key), std::move(object), size_fn_);
+  }
+
+  // Retrieves the existing object if it exists, or returns nullptr.
+  TypePtr Get(const K& key) {
+    Shard* shard = GetShard(key);
+    std::lock_guard<std::mutex> slock(shard->lock);
+    auto it = shard->element_map.find(&key);
+    if (it == shard->element_map.end()) {
+      return nullptr;
+    }
+    // Only write the flag when it changes, to avoid bouncing the cache line of
+    // the hot elements among the cores.
+    if (!it->second->referenced.load(std::memory_order_relaxed)) {
+      it->second->referenced.store(true, std::memory_order_relaxed);
+    }
+    return it->second->object;
+  }
+
+  bool Erase(const K& key) {
+    Shard* shard = GetShard(key);
+    std::lock_guard<std::mutex> slock(shard->lock);
+    auto it = shard->element_map.find(&key);
+    if (it == shard->element_map.end()) {
+      return false;
+    }
+    shard->Remove(it->second);
+    return true;
+  }
+
+  void Clear() {
+    for (auto& shard : shards_) {
+      std::lock_guard<std::mutex> slock(shard->lock);
+      shard->element_map.clear();
+      shard->element_list.clear();
+      shard->hand = shard->element_list.end();
+      shard->size = 0;
+    }
+  }
+
+  // Returns the current size of the cache, according to the SizeFn used.
+  size_t Size() {
+    size_t size = 0;
+    for (auto& shard : shards_) {
+      std::lock_guard<std::mutex> slock(shard->lock);
+      size += shard->size;
+    }
+    return size;
+  }
+
+  // Returns a snapshot of the (key, object) pairs held by the cache, without
+  // marking them as referenced.
+  std::vector<std::pair<K, TypePtr>> GetElements() {
+    std::vector<std::pair<K, TypePtr>> elements;
+    for (auto& shard : shards_) {
+      std::lock_guard<std::mutex> slock(shard->lock);
+      for (auto& element : shard->element_list) {
+        elements.emplace_back(element.key, element.object);
+      }
+    }
+    return elements;
+  }
+
+ private:
+  struct Element {
+    Element(K key, TypePtr object, size_t size)
+        : key(std::move(key)), object(std::move(object)), size(size) {}
+
+    K key;
+    TypePtr object;
+    size_t size = 0;
+    std::atomic<bool> referenced{false};
+  };
+
+  using ElementList = std::list<Element>;
+
+  struct Hasher {
+    size_t operator()(const K* key) const { return hasher(*key); }
+
+    H hasher;
+  };
+
+  struct Equaler {
+    bool operator()(const K* k1, const K* k2) const {
+      return equaler(*k1, *k2);
+    }
+
+    E equaler;
+  };
+
+  using ElementMap =
+      std::unordered_map<const K*, typename ElementList::iterator, Hasher,
+                         Equaler>;
+
+  struct Shard {
+    explicit Shard(size_t max_size)
+        : max_size(max_size), hand(element_list.end()) {}
+
+    TypePtr Add(K key, TypePtr object, const SizeFn& size_fn) {
+      size_t element_size = size_fn ? size_fn(key, *object) : 1;
+      // New elements go right behind the clock hand, so they are the last ones
+      // to be looked at by the eviction.
+      auto it = element_list.emplace(hand, std::move(key), std::move(object),
+                                     element_size);
+      auto emplace_result = element_map.emplace(&it->key, it);
+      if (!emplace_result.second) {
+        element_list.erase(it);
+        emplace_result.first->second->referenced.store(
+            true, std::memory_order_relaxed);
+        return emplace_result.first->second->object;
+      }
+      size += element_size;
+      // Never evict the element which has just been added, even if it alone
+      // exceeds the maximum size.
+      while (size > max_size && element_list.size() > 1) {
+        EvictOne(it);
+      }
+      return it->object;
+    }
+
+    void EvictOne(typename ElementList::iterator keep) {
+      while (true) {
+        if (hand == element_list.end()) {
+          hand = element_list.begin();
+        }
+        if (hand == keep ||
+            hand->referenced.exchange(false, std::memory_order_relaxed)) {
+          ++hand;
+          continue;
+        }
+        Remove(hand);
+        return;
+      }
+    }
+
+    void Remove(typename ElementList::iterator it) {
+      size -= it->size;
+      element_map.erase(&it->key);
+      if (hand == it) {
+        hand = element_list.erase(it);
+      } else {
+        element_list.erase(it);
+      }
+    }
+
+    std::mutex lock;
+    size_t max_size = 0;
+    size_t size = 0;
+    ElementList element_list;
+    ElementMap element_map;
+    typename ElementList::iterator hand;
+  };
+
+  Shard* GetShard(const K& key) {
+    size_t hash = H()(key);
+    // Mix the high bits in, as the hash of integer keys is often the identity.
+    hash ^= hash >> 17;
+    hash *= 0x9e3779b97f4a7c15ULL;
+    return shards_[(hash >> 32) % shards_.size()].get();
+  }
+
+  SizeFn size_fn_;
+  std::vector<std::unique_ptr<Shard>> shards_;
+};
+
 }  // namespace util
 }  // namespace xla
 
@@ -3,8 +3,11 @@
 #include <algorithm>
 #include <atomic>
 #include <cstdlib>
+#include <cstring>
 #include <fstream>
+#include <future>
 #include <map>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -13,8 +16,10 @@
 #include "absl/strings/str_split.h"
 #include "tensorflow/compiler/xla/status_macros.h"
 #include "tensorflow/compiler/xla/xla_client/debug_macros.h"
+#include "tensorflow/compiler/xla/xla_client/local_computation_client.h"
 #include "tensorflow/compiler/xla/xla_client/mesh_service.h"
 #include "tensorflow/compiler/xla/xla_client/sys_util.h"
+#include "tensorflow/compiler/xla/xla_client/thread_pool.h"
 #include "tensorflow/compiler/xla/xla_client/xrt_computation_client.h"
 #include "tensorflow/core/util/device_name_utils.h"
 
@@ -196,6 +201,12 @@ bool ParseMeshConfig(
 }  // namespace
 
 std::unique_ptr<ComputationClient> ComputationClient::Create() {
+  absl::optional<LocalComputationClient::Options> local_options =
+      LocalComputationClient::ParseOptions();
+  if (local_options) {
+    return std::unique_ptr<ComputationClient>(
+        new LocalComputationClient(std::move(*local_options)));
+  }
   XrtComputationClient::Options options;
   std::unique_ptr<tensorflow::tpu::TopologyProto> topology_proto;
   if (!ParseEnvBasedTpuClusterConfig(&options) &&
@@ -236,6 +247,125 @@ std::shared_ptr<ComputationClient::Computation> ComputationClient::Compile(
   return std::move(results[0]);
 }
 
+void ComputationClient::TransferFromServer(
+    tensorflow::gtl::ArraySlice<const DataPtr> handles,
+    const TransferDataFn& data_fn) {
+  std::vector<Literal> literals = TransferFromServer(handles);
+  for (size_t i = 0; i < literals.size(); ++i) {
+    data_fn(i, literals[i].shape(), literals[i].untyped_data(),
+            literals[i].size_bytes());
+  }
+}
+
+std::vector<ComputationClient::DataPtr> ComputationClient::TransferToDevice(
+    tensorflow::gtl::ArraySlice<const DataPtr> handles,
+    const string& dst_device) {
+  auto literals =
+      std::make_shared<std::vector<Literal>>(TransferFromServer(handles));
+  std::vector<TensorSource> sources;
+  sources.reserve(literals->size());
+  for (auto& literal : *literals) {
+    auto populate_fn = [&literal](const TensorSource& source, void* dest,
+                                  size_t dest_size) {
+      std::memcpy(dest, literal.untyped_data(), dest_size);
+    };
+    sources.emplace_back(literal.shape(), dst_device, std::move(populate_fn));
+    // The literals stay alive until all the sources are gone.
+    sources.back().data = literal.untyped_data();
+    sources.back().data_owner = literals;
+  }
+  return TransferToServer(sources);
+}
+
+std::vector<ComputationClient::ReplicaResult>
+ComputationClient::ExecuteReplicatedAsync(
+    const Computation& computation,
+    const std::vector<std::vector<DataPtr>>& arguments,
+    tensorflow::gtl::ArraySlice<const string> devices,
+    const ExecuteReplicatedOptions& options) {
+  // Without client specific support, all the replicas complete together.
+  auto promises =
+      std::make_shared<std::vector<std::promise<std::vector<DataPtr>>>>(
+          devices.size());
+  std::vector<ReplicaResult> results;
+  results.reserve(devices.size());
+  for (auto& promise : *promises) {
+    results.push_back(promise.get_future().share());
+  }
+  auto runner = [this, &computation, arguments,
+                 devices = std::vector<string>(devices.begin(), devices.end()),
+                 options, promises]() {
+    try {
+      std::vector<std::vector<DataPtr>> replica_results =
+          ExecuteReplicated(computation, arguments, devices, options);
+      for (size_t i = 0; i < replica_results.size(); ++i) {
+        (*promises)[i].set_value(std::move(replica_results[i]));
+      }
+    } catch (...) {
+      for (auto& promise : *promises) {
+        promise.set_exception(std::current_exception());
+      }
+    }
+  };
+  env::ScheduleIoClosure(std::move(runner), env::Priority::kHigh);
+  return results;
+}
+
+ComputationClient::ChainedResult ComputationClient::ExecuteChainedAsync(
+    tensorflow::gtl::ArraySlice<const ExecuteChainedOp> ops,
+    const string& device) {
+  auto promise = std::make_shared<std::promise<std::vector<DataPtr>>>();
+  ChainedResult result = promise->get_future().share();
+  auto runner = [this, ops = std::vector<ExecuteChainedOp>(ops.begin(),
+                                                           ops.end()),
+                 device, promise]() {
+    try {
+      promise->set_value(ExecuteChained(ops, device));
+    } catch (...) {
+      promise->set_exception(std::current_exception());
+    }
+  };
+  env::ScheduleIoClosure(std::move(runner), env::Priority::kHigh);
+  return result;
+}
+
+util::Future<std::vector<ComputationClient::DataPtr>>
+ComputationClient::ExecuteComputationFuture(
+    const Computation& computation,
+    tensorflow::gtl::ArraySlice<const DataPtr> arguments,
+    const string& device, const ExecuteComputationOptions& options) {
+  auto runner = [this, &computation,
+                 arguments =
+                     std::vector<DataPtr>(arguments.begin(), arguments.end()),
+                 device, options]() {
+    return ExecuteComputation(computation, arguments, device, options);
+  };
+  return util::ScheduleIoFuture(std::move(runner), env::Priority::kHigh);
+}
+
+util::Future<std::vector<ComputationClient::DataPtr>>
+ComputationClient::TransferToServerFuture(
+    tensorflow::gtl::ArraySlice<const TensorSource> tensors) {
+  auto runner = [this, tensors = std::vector<TensorSource>(tensors.begin(),
+                                                           tensors.end())]() {
+    return TransferToServer(tensors);
+  };
+  return util::ScheduleIoFuture(std::move(runner), env::Priority::kHigh);
+}
+
+util::Future<std::vector<Literal>> ComputationClient::TransferFromServerFuture(
+    tensorflow::gtl::ArraySlice<const DataPtr> handles) {
+  auto runner = [this, handles = std::vector<DataPtr>(handles.begin(),
+                                                      handles.end())]() {
+    return TransferFromServer(handles);
+  };
+  return util::ScheduleIoFuture(std::move(runner), env::Priority::kHigh);
+}
+
+void ComputationClient::ReleaseConsumedData(std::vector<DataPtr>* datas) {
+  datas->clear();
+}
+
 std::vector<std::string> ComputationClient::GetCompilationDevices(
     const std::string& device,
     tensorflow::gtl::ArraySlice<const std::string> devices) const {
@@ -265,6 +395,31 @@ ComputationClient* ComputationClient::Get() {
   return computation_client;
 }
 
+void ComputationClient::Data::WaitValue() {
+  if (HasValue()) {
+    return;
+  }
+  XLA_COUNTER("DataValueWaits", 1);
+  std::unique_lock<std::mutex> lock(value_mutex_);
+  value_cv_.wait(lock, [this] { return HasValue() || error_ != nullptr; });
+  if (!HasValue()) {
+    std::rethrow_exception(error_);
+  }
+}
+
+void ComputationClient::Data::SetError(std::exception_ptr error) {
+  std::lock_guard<std::mutex> lock(value_mutex_);
+  error_ = std::move(error);
+  value_cv_.notify_all();
+}
+
+void ComputationClient::Data::NotifyValue(bool has_value) {
+  std::lock_guard<std::mutex> lock(value_mutex_);
+  SetHasValue(has_value);
+  error_ = nullptr;
+  value_cv_.notify_all();
+}
+
 int64 ComputationClient::GetNextDataId() {
   static std::atomic<int64>* id_generator = new std::atomic<int64>(1);
   return id_generator->fetch_add(1);
@@ -276,18 +431,48 @@ metrics::Metric* ComputationClient::TransferToServerMetric() {
   return metric;
 }
 
+metrics::Counter* ComputationClient::TransferToServerZeroCopyCounter() {
+  static metrics::Counter* counter =
+      new metrics::Counter("TransferToServerZeroCopy");
+  return counter;
+}
+
 metrics::Metric* ComputationClient::TransferFromServerMetric() {
   static metrics::Metric* metric =
       new metrics::Metric("TransferFromServerTime", metrics::MetricFnTime);
   return metric;
 }
 
+metrics::Metric* ComputationClient::TransferToDeviceMetric() {
+  static metrics::Metric* metric =
+      new metrics::Metric("TransferToDeviceTime", metrics::MetricFnTime);
+  return metric;
+}
+
 metrics::Metric* ComputationClient::CompileMetric() {
   static metrics::Metric* metric =
       new metrics::Metric("CompileTime", metrics::MetricFnTime);
   return metric;
 }
 
+metrics::Counter* ComputationClient::PersistentCacheHitCounter() {
+  static metrics::Counter* counter =
+      new metrics::Counter("PersistentCacheHit");
+  return counter;
+}
+
+metrics::Counter* ComputationClient::PersistentCacheMissCounter() {
+  static metrics::Counter* counter =
+      new metrics::Counter("PersistentCacheMiss");
+  return counter;
+}
+
+metrics::Metric* ComputationClient::PersistentCacheDataMetric() {
+  static metrics::Metric* metric =
+      new metrics::Metric("PersistentCacheData", metrics::MetricFnBytes);
+  return metric;
+}
+
 metrics::Metric* ComputationClient::ExecuteMetric() {
   static metrics::Metric* metric =
       new metrics::Metric("ExecuteTime", metrics::MetricFnTime);
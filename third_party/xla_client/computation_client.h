@@ -1,7 +1,13 @@
 #ifndef TENSORFLOW_COMPILER_XLA_RPC_COMPUTATION_CLIENT_H_
 #define TENSORFLOW_COMPILER_XLA_RPC_COMPUTATION_CLIENT_H_
 
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <future>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 
@@ -9,6 +15,8 @@
 #include "tensorflow/compiler/xla/client/xla_computation.h"
 #include "tensorflow/compiler/xla/literal_util.h"
 #include "tensorflow/compiler/xla/types.h"
+#include "tensorflow/compiler/xla/xla_client/future.h"
+#include "tensorflow/compiler/xla/xla_client/memory_tracker.h"
 #include "tensorflow/compiler/xla/xla_client/metrics.h"
 #include "tensorflow/core/lib/gtl/array_slice.h"
 
@@ -33,12 +41,44 @@ class ComputationClient {
 
     virtual void Assign(const Data& data) = 0;
 
-    virtual bool HasValue() const = 0;
+    // Safe to call concurrently with the Assign() giving the data its value.
+    bool HasValue() const { return has_value_.load(std::memory_order_acquire); }
+
+    // Sets the category under which the device memory of the data is
+    // accounted. The category sticks to the data, so a placeholder passes it
+    // to the value it gets assigned.
+    virtual void SetMemoryCategory(MemoryTracker::Category category) {}
+
+    // Waits for the data to have a value. A placeholder gets it once the
+    // in-flight operation producing it calls Assign(), or fails, in which case
+    // the error passed to SetError() is rethrown. Only the users of the data
+    // wait, so the operations not touching it are not serialized with the one
+    // producing it.
+    void WaitValue();
+
+    // Wakes up the waiters of a placeholder whose value will never come,
+    // making them throw the error.
+    void SetError(std::exception_ptr error);
+
+   protected:
+    // Called by the implementations whenever the data gets, or drops, its
+    // value. The writes made to give the data its value are visible to the
+    // threads which then see HasValue() returning true.
+    void SetHasValue(bool has_value) {
+      has_value_.store(has_value, std::memory_order_release);
+    }
+
+    // Called by the Assign() implementations, once the data has its value.
+    void NotifyValue(bool has_value);
 
    private:
     int64 unique_id_ = 0;
     string device_;
     Shape shape_;
+    std::mutex value_mutex_;
+    std::condition_variable value_cv_;
+    std::exception_ptr error_;
+    std::atomic<bool> has_value_{false};
   };
 
   using DataPtr = std::shared_ptr<Data>;
@@ -84,6 +124,13 @@ class ComputationClient {
     Shape shape;
     string device;
     PopulateFn populate_fn;
+    // If not nullptr, the source data is already available in the same dense
+    // format the PopulateFn would produce, and the computation client can use
+    // it without copying. The data_owner keeps the memory alive until the
+    // transfer has completed. The populate_fn is still used when the client
+    // cannot use the memory directly (like in case of misaligned data).
+    const void* data = nullptr;
+    std::shared_ptr<void> data_owner;
   };
 
   struct CompileInstance {
@@ -155,6 +202,27 @@ class ComputationClient {
   virtual std::vector<Literal> TransferFromServer(
       tensorflow::gtl::ArraySlice<const DataPtr> handles) = 0;
 
+  // Receives the data of the index-th handle passed to TransferFromServer(),
+  // as a dense buffer laid out according to shape. The buffer is only valid
+  // for the duration of the call.
+  using TransferDataFn = std::function<void(size_t, const Shape&, const void*,
+                                            size_t)>;
+
+  // Like the API above, but hands the data over to data_fn instead of
+  // creating literals, so that callers can deposit it directly into their
+  // own buffers. The default implementation goes through literals.
+  virtual void TransferFromServer(
+      tensorflow::gtl::ArraySlice<const DataPtr> handles,
+      const TransferDataFn& data_fn);
+
+  // Copies the data behind the handles to the dst_device device, and returns
+  // the new handles, with the same shapes. The source handles are left
+  // untouched. The default implementation goes through the host, while
+  // clients can copy the data within the servers.
+  virtual std::vector<DataPtr> TransferToDevice(
+      tensorflow::gtl::ArraySlice<const DataPtr> handles,
+      const string& dst_device);
+
   // Compiles a set of computations.
   virtual std::vector<ComputationPtr> Compile(
       std::vector<CompileInstance> instances) = 0;
@@ -185,6 +253,17 @@ class ComputationClient {
       tensorflow::gtl::ArraySlice<const string> devices,
       const ExecuteReplicatedOptions& options) = 0;
 
+  // Same as ExecuteReplicated(), but returns immediately with one future for
+  // every replica, which becomes ready as soon as the execution of such
+  // replica completes. The computation must stay alive until all the futures
+  // are ready.
+  using ReplicaResult = std::shared_future<std::vector<DataPtr>>;
+  virtual std::vector<ReplicaResult> ExecuteReplicatedAsync(
+      const Computation& computation,
+      const std::vector<std::vector<DataPtr>>& arguments,
+      tensorflow::gtl::ArraySlice<const string> devices,
+      const ExecuteReplicatedOptions& options);
+
   // Executes the computations in parallel. Each computation must target a
   // different device, and the the common device of arguments[i] must match
   // devices[i]. The computations[i] computation is fed with arguments[i]
@@ -208,9 +287,38 @@ class ComputationClient {
       tensorflow::gtl::ArraySlice<const ExecuteChainedOp> ops,
       const string& device) = 0;
 
+  // Same as ExecuteChained(), but returns immediately with a future which
+  // becomes ready once the chained execution completes. The ops are copied, so
+  // the caller does not need to keep them alive.
+  using ChainedResult = std::shared_future<std::vector<DataPtr>>;
+  virtual ChainedResult ExecuteChainedAsync(
+      tensorflow::gtl::ArraySlice<const ExecuteChainedOp> ops,
+      const string& device);
+
+  // Future based variants of the APIs above, which return immediately, and
+  // allow the dependent work to be chained with util::Future::Then(), instead
+  // of blocking a thread waiting for the results. The arguments are copied,
+  // but the computation must stay alive until the returned future is ready.
+  virtual util::Future<std::vector<DataPtr>> ExecuteComputationFuture(
+      const Computation& computation,
+      tensorflow::gtl::ArraySlice<const DataPtr> arguments,
+      const string& device, const ExecuteComputationOptions& options);
+
+  virtual util::Future<std::vector<DataPtr>> TransferToServerFuture(
+      tensorflow::gtl::ArraySlice<const TensorSource> tensors);
+
+  virtual util::Future<std::vector<Literal>> TransferFromServerFuture(
+      tensorflow::gtl::ArraySlice<const DataPtr> handles);
+
   virtual std::vector<std::vector<DataPtr>> DeconstructTuple(
       tensorflow::gtl::ArraySlice<const DataPtr> tuples) = 0;
 
+  // Drops the references to the given data, which is done being consumed by
+  // dispatched computations. The device memory of the data which is not
+  // referenced anywhere else is released right away, instead of going through
+  // the batched release of the data handles. Clears the datas vector.
+  virtual void ReleaseConsumedData(std::vector<DataPtr>* datas);
+
   // Returns a unique string which identifies the resource domain of a given
   // device. Within a resource domain, handles to device memory or compiled
   // computations can be used for all devices part of such domain.
@@ -228,6 +336,12 @@ class ComputationClient {
 
   virtual const std::vector<string>& GetReplicationDevices() const = 0;
 
+  // Returns the devices sorted so that consecutive devices (and the last and
+  // first ones) are neighbors within the device interconnect, if the topology
+  // is known, which is the order ring based collectives run best with.
+  virtual std::vector<string> GetTopologyOrderedDevices(
+      std::vector<string> devices) const = 0;
+
   virtual void SetRngSeed(size_t seed) = 0;
 
   // Utility API around the vector based Compile() API to compile a single
@@ -257,8 +371,13 @@ class ComputationClient {
 
   // Metrics common to all client intrfaces.
   static metrics::Metric* TransferToServerMetric();
+  static metrics::Counter* TransferToServerZeroCopyCounter();
   static metrics::Metric* TransferFromServerMetric();
+  static metrics::Metric* TransferToDeviceMetric();
   static metrics::Metric* CompileMetric();
+  static metrics::Counter* PersistentCacheHitCounter();
+  static metrics::Counter* PersistentCacheMissCounter();
+  static metrics::Metric* PersistentCacheDataMetric();
   static metrics::Metric* ExecuteMetric();
   static metrics::Metric* ExecuteReplicatedMetric();
   static metrics::Metric* ExecuteParallelMetric();
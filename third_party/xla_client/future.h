@@ -0,0 +1,276 @@
+#ifndef TENSORFLOW_COMPILER_XLA_XLA_CLIENT_FUTURE_H_
+#define TENSORFLOW_COMPILER_XLA_XLA_CLIENT_FUTURE_H_
+
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "absl/types/optional.h"
+#include "tensorflow/compiler/xla/xla_client/debug_macros.h"
+#include "tensorflow/compiler/xla/xla_client/thread_pool.h"
+
+namespace xla {
+namespace util {
+
+// The value type of the futures whose producer has no result to return.
+struct Unit {};
+
+template <typename T>
+class Future;
+
+namespace internal {
+
+template <typename T>
+struct FutureState {
+  std::mutex mutex;
+  std::condition_variable cv;
+  bool completed = false;
+  absl::optional<T> value;
+  std::exception_ptr exptr;
+  std::vector<std::function<void()>> continuations;
+
+  // Moves the state to completed, and runs the continuations, on the calling
+  // thread. Exactly one of value or exptr must be set.
+  void Complete(absl::optional<T> result, std::exception_ptr result_exptr) {
+    std::vector<std::function<void()>> pending;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      XLA_CHECK(!completed) << "Future already completed";
+      value = std::move(result);
+      exptr = std::move(result_exptr);
+      completed = true;
+      pending.swap(continuations);
+      cv.notify_all();
+    }
+    for (auto& continuation : pending) {
+      continuation();
+    }
+  }
+
+  // Runs the continuation once the state is completed, right away if it
+  // already is.
+  void OnComplete(std::function<void()> continuation) {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (!completed) {
+        continuations.push_back(std::move(continuation));
+        return;
+      }
+    }
+    continuation();
+  }
+};
+
+// Invokes fn with the value, mapping a void result to Unit.
+template <typename R>
+struct Invoker {
+  template <typename F, typename T>
+  static R Invoke(F& fn, const T& value) {
+    return fn(value);
+  }
+
+  template <typename F>
+  static R Invoke(F& fn) {
+    return fn();
+  }
+};
+
+template <>
+struct Invoker<void> {
+  template <typename F, typename T>
+  static Unit Invoke(F& fn, const T& value) {
+    fn(value);
+    return Unit();
+  }
+
+  template <typename F>
+  static Unit Invoke(F& fn) {
+    fn();
+    return Unit();
+  }
+};
+
+template <typename R>
+using FutureValueType =
+    typename std::conditional<std::is_void<R>::value, Unit, R>::type;
+
+}  // namespace internal
+
+// The producer side of a Future. Either SetValue() or SetException() must be
+// called exactly once.
+template <typename T>
+class Promise {
+ public:
+  Promise() : state_(std::make_shared<internal::FutureState<T>>()) {}
+
+  Future<T> GetFuture() const { return Future<T>(state_); }
+
+  void SetValue(T value) { state_->Complete(std::move(value), nullptr); }
+
+  void SetException(std::exception_ptr exptr) {
+    state_->Complete(absl::nullopt, std::move(exptr));
+  }
+
+ private:
+  std::shared_ptr<internal::FutureState<T>> state_;
+};
+
+// A value which becomes available at some point in the future, or fails with
+// an exception. Dependent work is chained with Then(), which does not block any
+// thread while waiting. The continuations run on the thread completing the
+// future (or on the thread calling Then(), if the future is already
+// completed), so they should be short, and schedule any heavy work on the
+// xla::env thread pools.
+template <typename T>
+class Future {
+ public:
+  using ValueType = T;
+
+  Future() = default;
+
+  explicit Future(std::shared_ptr<internal::FutureState<T>> state)
+      : state_(std::move(state)) {}
+
+  bool valid() const { return state_ != nullptr; }
+
+  bool IsReady() const {
+    std::lock_guard<std::mutex> lock(state_->mutex);
+    return state_->completed;
+  }
+
+  // Blocks until the future is completed, and rethrows its exception, if any.
+  const Future& Wait() const {
+    std::unique_lock<std::mutex> lock(state_->mutex);
+    state_->cv.wait(lock, [this] { return state_->completed; });
+    if (state_->exptr != nullptr) {
+      std::rethrow_exception(state_->exptr);
+    }
+    return *this;
+  }
+
+  const T& Get() const {
+    Wait();
+    return *state_->value;
+  }
+
+  // Moves the value out of the future. Only one consumer can do that.
+  T ConsumeValue() {
+    Wait();
+    return std::move(*state_->value);
+  }
+
+  // Runs fn once the future is completed, either with a value or with an
+  // exception.
+  void OnComplete(std::function<void()> fn) const {
+    state_->OnComplete(std::move(fn));
+  }
+
+  // Returns a future holding the result of fn(value), once this future is
+  // completed. If this future fails, or fn throws, the returned future fails
+  // with the same exception. A void returning fn produces a Future<Unit>.
+  template <typename F,
+            typename R = typename std::result_of<F(const T&)>::type>
+  Future<internal::FutureValueType<R>> Then(F fn) const {
+    using V = internal::FutureValueType<R>;
+    Promise<V> promise;
+    Future<V> result = promise.GetFuture();
+    auto state = state_;
+    state_->OnComplete([state, promise, fn = std::move(fn)]() mutable {
+      if (state->exptr != nullptr) {
+        promise.SetException(state->exptr);
+        return;
+      }
+      absl::optional<V> value;
+      try {
+        value = internal::Invoker<R>::Invoke(fn, *state->value);
+      } catch (...) {
+        promise.SetException(std::current_exception());
+        return;
+      }
+      promise.SetValue(std::move(*value));
+    });
+    return result;
+  }
+
+ private:
+  std::shared_ptr<internal::FutureState<T>> state_;
+};
+
+// Returns a future which is completed once all the input futures are, with
+// their values in the same order. If any of them fails, the returned future
+// fails with the exception of the first failing one (in input order).
+template <typename T>
+Future<std::vector<T>> WhenAll(std::vector<Future<T>> futures) {
+  struct Context {
+    explicit Context(std::vector<Future<T>> futures)
+        : futures(std::move(futures)), pending(this->futures.size()) {}
+
+    std::vector<Future<T>> futures;
+    std::mutex mutex;
+    size_t pending;
+    Promise<std::vector<T>> promise;
+  };
+
+  auto context = std::make_shared<Context>(std::move(futures));
+  Future<std::vector<T>> result = context->promise.GetFuture();
+  auto complete = [context]() {
+    std::vector<T> values;
+    values.reserve(context->futures.size());
+    try {
+      for (auto& future : context->futures) {
+        values.push_back(future.Get());
+      }
+    } catch (...) {
+      context->promise.SetException(std::current_exception());
+      return;
+    }
+    context->promise.SetValue(std::move(values));
+  };
+  if (context->futures.empty()) {
+    complete();
+    return result;
+  }
+  for (auto& future : context->futures) {
+    future.OnComplete([context, complete]() {
+      std::unique_lock<std::mutex> lock(context->mutex);
+      if (--context->pending == 0) {
+        lock.unlock();
+        complete();
+      }
+    });
+  }
+  return result;
+}
+
+// Schedules fn on the IO thread pool, and returns the future of its result.
+// A void returning fn produces a Future<Unit>.
+template <typename F, typename R = typename std::result_of<F()>::type>
+Future<internal::FutureValueType<R>> ScheduleIoFuture(
+    F fn, env::Priority priority = env::Priority::kNormal) {
+  using V = internal::FutureValueType<R>;
+  Promise<V> promise;
+  Future<V> result = promise.GetFuture();
+  env::ScheduleIoClosure(
+      [promise, fn = std::move(fn)]() mutable {
+        absl::optional<V> value;
+        try {
+          value = internal::Invoker<R>::Invoke(fn);
+        } catch (...) {
+          promise.SetException(std::current_exception());
+          return;
+        }
+        promise.SetValue(std::move(*value));
+      },
+      priority);
+  return result;
+}
+
+}  // namespace util
+}  // namespace xla
+
+#endif  // TENSORFLOW_COMPILER_XLA_XLA_CLIENT_FUTURE_H_
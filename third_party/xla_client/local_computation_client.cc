@@ -0,0 +1,459 @@
+#include "tensorflow/compiler/xla/xla_client/local_computation_client.h"
+
+#include <algorithm>
+
+#include "absl/strings/str_cat.h"
+#include "tensorflow/compiler/xla/client/client_library.h"
+#include "tensorflow/compiler/xla/layout_util.h"
+#include "tensorflow/compiler/xla/service/platform_util.h"
+#include "tensorflow/compiler/xla/shape_util.h"
+#include "tensorflow/compiler/xla/xla_client/debug_macros.h"
+#include "tensorflow/compiler/xla/xla_client/multi_wait.h"
+#include "tensorflow/compiler/xla/xla_client/sys_util.h"
+#include "tensorflow/compiler/xla/xla_client/tf_logging.h"
+#include "tensorflow/compiler/xla/xla_client/thread_pool.h"
+#include "tensorflow/compiler/xla/xla_client/xla_util.h"
+
+namespace xla {
+
+LocalComputationClient::LocalData::LocalData(
+    string device, std::shared_ptr<ShapedBuffer> buffer)
+    : Data(std::move(device), buffer->on_host_shape()),
+      buffer(std::move(buffer)) {
+  SetHasValue(true);
+}
+
+void LocalComputationClient::LocalData::Assign(const Data& data) {
+  const LocalData& local_data = dynamic_cast<const LocalData&>(data);
+  if (&local_data != this) {
+    buffer = local_data.buffer;
+    if (memory_category && buffer != nullptr) {
+      MemoryTracker::Get()->SetCategory(buffer.get(), *memory_category);
+    }
+  }
+  NotifyValue(buffer != nullptr);
+}
+
+void LocalComputationClient::LocalData::SetMemoryCategory(
+    MemoryTracker::Category category) {
+  memory_category = category;
+  if (buffer != nullptr) {
+    MemoryTracker::Get()->SetCategory(buffer.get(), category);
+  }
+}
+
+LocalComputationClient::LocalComputationClient(Options options)
+    : options_(std::move(options)) {
+  se::Platform* platform =
+      ConsumeValue(PlatformUtil::GetPlatform(options_.platform));
+  client_ = ConsumeValue(ClientLibrary::GetOrCreateLocalClient(platform));
+  for (int i = 0; i < client_->device_count(); ++i) {
+    devices_.push_back(absl::StrCat(options_.device_kind, ":", i));
+  }
+  XLA_CHECK(!devices_.empty()) << "No " << options_.platform << " devices";
+  TF_LOG(INFO) << "Running on " << devices_.size() << " local "
+               << options_.platform << " devices";
+}
+
+absl::optional<LocalComputationClient::Options>
+LocalComputationClient::ParseOptions() {
+  string device_kind = sys_util::GetEnvString("XLA_LOCAL_CLIENT_DEVICE", "");
+  if (device_kind.empty()) {
+    return absl::nullopt;
+  }
+  Options options;
+  options.device_kind = device_kind;
+  if (device_kind == "CPU") {
+    options.platform = "Host";
+  } else if (device_kind == "GPU") {
+    options.platform = "CUDA";
+  } else {
+    XLA_ERROR() << "Unsupported local client device: " << device_kind;
+  }
+  return options;
+}
+
+ComputationClient::DataPtr LocalComputationClient::CreateDataPlaceholder(
+    string device, Shape shape) {
+  return std::make_shared<LocalData>(std::move(device), std::move(shape));
+}
+
+std::shared_ptr<ShapedBuffer> LocalComputationClient::CreateBuffer(
+    ScopedShapedBuffer buffer, const string& device) {
+  ShapedBuffer* owned_buffer = new ScopedShapedBuffer(std::move(buffer));
+  MemoryTracker::Get()->Allocate(owned_buffer, device,
+                                 owned_buffer->on_host_shape(),
+                                 MemoryTracker::Category::kActivation);
+  CreateDataHandlesCounter()->AddValue(1);
+  return std::shared_ptr<ShapedBuffer>(owned_buffer, [](ShapedBuffer* buffer) {
+    MemoryTracker::Get()->Free(buffer);
+    DestroyDataHandlesCounter()->AddValue(1);
+    delete buffer;
+  });
+}
+
+std::shared_ptr<ShapedBuffer> LocalComputationClient::GetTupleElementBuffer(
+    std::shared_ptr<ShapedBuffer> tuple_buffer, int64 index) {
+  ShapedBuffer* element_buffer = new ShapedBuffer(
+      ShapeUtil::GetTupleElementShape(tuple_buffer->on_host_shape(), index),
+      ShapeUtil::GetTupleElementShape(tuple_buffer->on_device_shape(), index),
+      tuple_buffer->platform(), tuple_buffer->device_ordinal());
+  tuple_buffer->buffers().ForEachElement(
+      [&](const ShapeIndex& shape_index, const se::DeviceMemoryBase& buffer) {
+        if (!shape_index.empty() && shape_index[0] == index) {
+          element_buffer->set_buffer(
+              buffer, ShapeIndex(shape_index.begin() + 1, shape_index.end()));
+        }
+      });
+  return std::shared_ptr<ShapedBuffer>(
+      element_buffer,
+      [tuple_buffer](ShapedBuffer* buffer) { delete buffer; });
+}
+
+std::vector<ComputationClient::DataPtr>
+LocalComputationClient::TransferToServer(
+    tensorflow::gtl::ArraySlice<const TensorSource> tensors) {
+  metrics::TimedSection timed(TransferToServerMetric());
+
+  int64 total_size = 0;
+  std::vector<DataPtr> results;
+  results.reserve(tensors.size());
+  for (auto& tensor : tensors) {
+    string device = GetEffectiveDevice(tensor.device);
+    int device_ordinal = GetDeviceOrdinal(device);
+    auto upload_fn = [&](const LiteralSlice& literal) {
+      return CreateBuffer(ConsumeValue(client_->LiteralToShapedBuffer(
+                              literal, device_ordinal)),
+                          device);
+    };
+    std::shared_ptr<ShapedBuffer> buffer;
+    if (tensor.data != nullptr) {
+      // The source memory is already in the literal layout, so the device
+      // buffer is filled straight from it.
+      buffer = upload_fn(BorrowingLiteral(
+          static_cast<const char*>(tensor.data), tensor.shape));
+      TransferToServerZeroCopyCounter()->AddValue(1);
+    } else {
+      Literal literal(tensor.shape);
+      tensor.populate_fn(tensor, literal.untyped_data(),
+                         literal.size_bytes());
+      buffer = upload_fn(literal);
+    }
+    total_size += ShapeUtil::ByteSizeOf(tensor.shape);
+    results.push_back(std::make_shared<LocalData>(device, std::move(buffer)));
+  }
+  OutboundDataMetric()->AddSample(total_size);
+  return results;
+}
+
+std::vector<Literal> LocalComputationClient::TransferFromServer(
+    tensorflow::gtl::ArraySlice<const DataPtr> handles) {
+  metrics::TimedSection timed(TransferFromServerMetric());
+
+  int64 total_size = 0;
+  std::vector<Literal> results;
+  results.reserve(handles.size());
+  for (auto& handle : handles) {
+    const LocalData& local_data = dynamic_cast<const LocalData&>(*handle);
+    XLA_CHECK(local_data.HasValue())
+        << "Reading from an empty data handle: " << local_data.shape();
+    results.push_back(
+        ConsumeValue(client_->ShapedBufferToLiteral(*local_data.buffer)));
+    total_size += results.back().size_bytes();
+  }
+  InboundDataMetric()->AddSample(total_size);
+  return results;
+}
+
+void LocalComputationClient::TransferFromServer(
+    tensorflow::gtl::ArraySlice<const DataPtr> handles,
+    const TransferDataFn& data_fn) {
+  // The host platform device memory is host memory, so the arrays whose device
+  // layout is the dense dim0-major one are handed over in place.
+  if (options_.platform != "Host") {
+    ComputationClient::TransferFromServer(handles, data_fn);
+    return;
+  }
+  metrics::TimedSection timed(TransferFromServerMetric());
+
+  int64 total_size = 0;
+  for (size_t i = 0; i < handles.size(); ++i) {
+    const LocalData& local_data = dynamic_cast<const LocalData&>(*handles[i]);
+    XLA_CHECK(local_data.HasValue())
+        << "Reading from an empty data handle: " << local_data.shape();
+    const ShapedBuffer& buffer = *local_data.buffer;
+    const Shape& device_shape = buffer.on_device_shape();
+    if (device_shape.IsArray() &&
+        LayoutUtil::IsMonotonicWithDim0Major(device_shape.layout())) {
+      size_t size = ShapeUtil::ByteSizeOf(device_shape);
+      data_fn(i, buffer.on_host_shape(), buffer.root_buffer().opaque(), size);
+      total_size += size;
+    } else {
+      Literal literal = ConsumeValue(client_->ShapedBufferToLiteral(buffer));
+      data_fn(i, literal.shape(), literal.untyped_data(),
+              literal.size_bytes());
+      total_size += literal.size_bytes();
+    }
+  }
+  InboundDataMetric()->AddSample(total_size);
+}
+
+std::vector<ComputationClient::ComputationPtr> LocalComputationClient::Compile(
+    std::vector<CompileInstance> instances) {
+  metrics::TimedSection timed(CompileMetric());
+
+  std::vector<ComputationPtr> results;
+  results.reserve(instances.size());
+  for (auto& instance : instances) {
+    // LocalExecutable::Run() only borrows the argument buffers, so it has no
+    // way to hand the donated ones over to the outputs.
+    const HloInputOutputAliasProto& aliases =
+        instance.computation.proto().input_output_alias();
+    XLA_CHECK_EQ(aliases.entries_size(), 0)
+        << "The local client does not support buffer donation "
+           "(XLA_DONATE_BUFFERS)";
+    ProgramShape program_shape =
+        ConsumeValue(instance.computation.GetProgramShape());
+    std::vector<const Shape*> argument_layouts;
+    argument_layouts.reserve(program_shape.parameters_size());
+    for (auto& parameter : program_shape.parameters()) {
+      argument_layouts.push_back(&parameter);
+    }
+    string device = GetEffectiveDevice(instance.compilation_device);
+    ExecutableBuildOptions build_options;
+    build_options.set_device_ordinal(GetDeviceOrdinal(device));
+    if (instance.output_shape != nullptr) {
+      build_options.set_result_layout(*instance.output_shape);
+    }
+    StatusOr<std::unique_ptr<LocalExecutable>> executable = client_->Compile(
+        instance.computation, argument_layouts, build_options);
+    if (!executable.ok()) {
+      util::ReportComputationError(executable.status(),
+                                   {&instance.computation});
+    }
+    CreateCompileHandlesCounter()->AddValue(1);
+    results.push_back(std::make_shared<LocalComputation>(
+        std::move(instance.computation), std::move(program_shape),
+        std::move(instance.devices), executable.ConsumeValueOrDie()));
+  }
+  return results;
+}
+
+std::vector<ComputationClient::DataPtr> LocalComputationClient::Execute(
+    const LocalComputation& computation,
+    tensorflow::gtl::ArraySlice<const DataPtr> arguments, const string& device,
+    bool explode_tuple) {
+  std::vector<const ShapedBuffer*> argument_buffers;
+  argument_buffers.reserve(arguments.size());
+  for (auto& argument : arguments) {
+    const LocalData& local_data = dynamic_cast<const LocalData&>(*argument);
+    XLA_CHECK(local_data.HasValue())
+        << "Executing with an empty data handle: " << local_data.shape();
+    argument_buffers.push_back(local_data.buffer.get());
+  }
+  ExecutableRunOptions run_options;
+  run_options.set_device_ordinal(GetDeviceOrdinal(device));
+  run_options.set_allocator(client_->backend().memory_allocator());
+  run_options.set_intra_op_thread_pool(
+      client_->backend().eigen_intra_op_thread_pool_device());
+  run_options.set_rng_seed(static_cast<int>(rng_seed_));
+
+  StatusOr<ScopedShapedBuffer> result =
+      computation.executable->Run(argument_buffers, run_options);
+  if (!result.ok()) {
+    util::ReportComputationError(result.status(),
+                                 {&computation.computation()});
+  }
+  ScopedShapedBuffer result_buffer = result.ConsumeValueOrDie();
+  std::vector<DataPtr> results;
+  const Shape& result_shape = result_buffer.on_host_shape();
+  if (explode_tuple && result_shape.IsTuple()) {
+    int64 num_elements = ShapeUtil::TupleElementCount(result_shape);
+    results.reserve(num_elements);
+    for (int64 i = 0; i < num_elements; ++i) {
+      // Every element owns its buffers, so that they get freed independently.
+      results.push_back(std::make_shared<LocalData>(
+          device, CreateBuffer(result_buffer.TakeSubTree({i}), device)));
+    }
+  } else {
+    results.push_back(std::make_shared<LocalData>(
+        device, CreateBuffer(std::move(result_buffer), device)));
+  }
+  return results;
+}
+
+std::vector<ComputationClient::DataPtr>
+LocalComputationClient::ExecuteComputation(
+    const Computation& computation,
+    tensorflow::gtl::ArraySlice<const DataPtr> arguments, const string& device,
+    const ExecuteComputationOptions& options) {
+  metrics::TimedSection timed(ExecuteMetric());
+  return Execute(dynamic_cast<const LocalComputation&>(computation), arguments,
+                 GetEffectiveDevice(device), options.explode_tuple);
+}
+
+std::vector<std::vector<ComputationClient::DataPtr>>
+LocalComputationClient::ExecuteReplicated(
+    const Computation& computation,
+    const std::vector<std::vector<DataPtr>>& arguments,
+    tensorflow::gtl::ArraySlice<const string> devices,
+    const ExecuteReplicatedOptions& options) {
+  metrics::TimedSection timed(ExecuteReplicatedMetric());
+  XLA_CHECK_EQ(devices.size(), 1)
+      << "The local client does not support replicated executions";
+  XLA_CHECK_EQ(arguments.size(), devices.size());
+  return {Execute(dynamic_cast<const LocalComputation&>(computation),
+                  arguments[0], GetEffectiveDevice(devices[0]),
+                  options.explode_tuple)};
+}
+
+std::vector<std::vector<ComputationClient::DataPtr>>
+LocalComputationClient::ExecuteParallel(
+    tensorflow::gtl::ArraySlice<const Computation* const> computations,
+    const std::vector<std::vector<DataPtr>>& arguments,
+    tensorflow::gtl::ArraySlice<const string> devices,
+    const ExecuteParallelOptions& options) {
+  metrics::TimedSection timed(ExecuteParallelMetric());
+  XLA_CHECK_EQ(computations.size(), arguments.size());
+  XLA_CHECK_EQ(computations.size(), devices.size());
+
+  std::vector<std::vector<DataPtr>> results(computations.size());
+  util::MultiWait mwait(computations.size());
+  for (size_t i = 0; i < computations.size(); ++i) {
+    auto runner = [&, i]() {
+      results[i] = Execute(
+          dynamic_cast<const LocalComputation&>(*computations[i]),
+          arguments[i], GetEffectiveDevice(devices[i]), options.explode_tuple);
+    };
+    env::ScheduleClosure(mwait.Completer(std::move(runner)));
+  }
+  mwait.Wait();
+  return results;
+}
+
+std::vector<ComputationClient::DataPtr> LocalComputationClient::ExecuteChained(
+    tensorflow::gtl::ArraySlice<const ExecuteChainedOp> ops,
+    const string& device) {
+  metrics::TimedSection timed(ExecuteChainedMetric());
+
+  std::vector<int64> uses(ops.size(), 0);
+  for (auto& op : ops) {
+    for (auto& input : op.inputs) {
+      uses[input.op_index] += 1;
+    }
+  }
+  string effective_device = GetEffectiveDevice(device);
+  std::vector<std::vector<DataPtr>> ops_outputs(ops.size());
+  std::vector<DataPtr> results;
+  for (size_t i = 0; i < ops.size(); ++i) {
+    const ExecuteChainedOp& op = ops[i];
+    if (op.device_data != nullptr) {
+      ops_outputs[i].push_back(op.device_data);
+    } else {
+      std::vector<DataPtr> arguments;
+      arguments.reserve(op.inputs.size());
+      for (auto& input : op.inputs) {
+        XLA_CHECK_LT(input.op_index, i);
+        XLA_CHECK_LT(input.output_index.value_or(0),
+                     ops_outputs[input.op_index].size());
+        arguments.push_back(
+            ops_outputs[input.op_index][input.output_index.value_or(0)]);
+      }
+      ops_outputs[i] =
+          Execute(dynamic_cast<const LocalComputation&>(*op.computation),
+                  arguments, effective_device, /*explode_tuple=*/true);
+    }
+
+    for (auto& output : op.outputs) {
+      if (output.result_index >= results.size()) {
+        results.resize(output.result_index + 1);
+      }
+      XLA_CHECK_LT(output.output_index.value_or(0), ops_outputs[i].size());
+      results[output.result_index] =
+          ops_outputs[i][output.output_index.value_or(0)];
+    }
+    // Drop references to any intermediate result which is not used anymore.
+    for (auto& input : op.inputs) {
+      uses[input.op_index] -= 1;
+      if (uses[input.op_index] == 0) {
+        ops_outputs[input.op_index].clear();
+      }
+    }
+  }
+  return results;
+}
+
+std::vector<std::vector<ComputationClient::DataPtr>>
+LocalComputationClient::DeconstructTuple(
+    tensorflow::gtl::ArraySlice<const DataPtr> tuples) {
+  metrics::TimedSection timed(DeconstructTupleMetric());
+
+  std::vector<std::vector<DataPtr>> results;
+  results.reserve(tuples.size());
+  for (auto& tuple : tuples) {
+    const LocalData& local_data = dynamic_cast<const LocalData&>(*tuple);
+    XLA_CHECK(local_data.HasValue());
+    XLA_CHECK(local_data.shape().IsTuple()) << local_data.shape();
+    int64 num_elements = ShapeUtil::TupleElementCount(local_data.shape());
+    std::vector<DataPtr> elements;
+    elements.reserve(num_elements);
+    for (int64 i = 0; i < num_elements; ++i) {
+      elements.push_back(std::make_shared<LocalData>(
+          local_data.device(), GetTupleElementBuffer(local_data.buffer, i)));
+    }
+    results.push_back(std::move(elements));
+  }
+  return results;
+}
+
+string LocalComputationClient::GetEffectiveDevice(const string& device) const {
+  if (device.empty()) {
+    return devices_.front();
+  }
+  if (device[0] == ':') {
+    // Allow devices with ordinal only specification, to expand from the
+    // default device type.
+    return options_.device_kind + device;
+  }
+  return device;
+}
+
+string LocalComputationClient::GetResourceDomain(const string& device) const {
+  // All the devices live within this process.
+  return "";
+}
+
+string LocalComputationClient::GetDefaultDevice() const {
+  return devices_.front();
+}
+
+size_t LocalComputationClient::GetNumDevices() const {
+  return devices_.size();
+}
+
+std::vector<string> LocalComputationClient::GetLocalDevices() const {
+  return devices_;
+}
+
+std::vector<string> LocalComputationClient::GetAllDevices() const {
+  return devices_;
+}
+
+void LocalComputationClient::SetReplicationDevices(
+    std::vector<string> devices) {
+  replication_devices_ = std::move(devices);
+}
+
+const std::vector<string>& LocalComputationClient::GetReplicationDevices()
+    const {
+  return replication_devices_;
+}
+
+std::vector<string> LocalComputationClient::GetTopologyOrderedDevices(
+    std::vector<string> devices) const {
+  return devices;
+}
+
+void LocalComputationClient::SetRngSeed(size_t seed) { rng_seed_ = seed; }
+
+}  // namespace xla
@@ -0,0 +1,147 @@
+#ifndef TENSORFLOW_COMPILER_XLA_RPC_LOCAL_COMPUTATION_CLIENT_H_
+#define TENSORFLOW_COMPILER_XLA_RPC_LOCAL_COMPUTATION_CLIENT_H_
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/types/optional.h"
+#include "tensorflow/compiler/xla/client/local_client.h"
+#include "tensorflow/compiler/xla/service/shaped_buffer.h"
+#include "tensorflow/compiler/xla/xla_client/computation_client.h"
+#include "tensorflow/compiler/xla/xla_client/memory_tracker.h"
+
+namespace xla {
+
+// A computation client which runs the computations in process, on the devices
+// of a local XLA platform (like the CPU or a GPU), through the XLA LocalClient
+// APIs. Compared to going through a TF server hosting XRT on localhost, the
+// transfers and executions skip the proto serializations and the gRPC round
+// trips, and on CPU the device buffers are read in place. ExecuteParallel()
+// runs the computations of the different devices concurrently, while
+// replicated executions and buffer donation are not supported.
+class LocalComputationClient : public ComputationClient {
+  struct LocalData : public Data {
+    LocalData(string device, Shape device_shape)
+        : Data(std::move(device), std::move(device_shape)) {}
+    LocalData(string device, std::shared_ptr<ShapedBuffer> buffer);
+
+    void Assign(const Data& data) override;
+
+    void SetMemoryCategory(MemoryTracker::Category category) override;
+
+    std::shared_ptr<ShapedBuffer> buffer;
+    absl::optional<MemoryTracker::Category> memory_category;
+  };
+
+  struct LocalComputation : public Computation {
+    LocalComputation(XlaComputation computation, ProgramShape program_shape,
+                     std::vector<string> devices,
+                     std::unique_ptr<LocalExecutable> executable)
+        : Computation(std::move(computation), std::move(program_shape),
+                      std::move(devices)),
+          executable(std::move(executable)) {}
+
+    std::unique_ptr<LocalExecutable> executable;
+  };
+
+ public:
+  struct Options {
+    // The name of the XLA platform (like "Host" or "CUDA").
+    string platform;
+    // The PyTorch device kind the platform devices are exposed as (like
+    // "CPU" or "GPU").
+    string device_kind;
+  };
+
+  explicit LocalComputationClient(Options options);
+
+  DataPtr CreateDataPlaceholder(string device, Shape shape) override;
+
+  std::vector<DataPtr> TransferToServer(
+      tensorflow::gtl::ArraySlice<const TensorSource> tensors) override;
+
+  std::vector<Literal> TransferFromServer(
+      tensorflow::gtl::ArraySlice<const DataPtr> handles) override;
+
+  void TransferFromServer(tensorflow::gtl::ArraySlice<const DataPtr> handles,
+                          const TransferDataFn& data_fn) override;
+
+  std::vector<ComputationPtr> Compile(
+      std::vector<CompileInstance> instances) override;
+
+  std::vector<DataPtr> ExecuteComputation(
+      const Computation& computation,
+      tensorflow::gtl::ArraySlice<const DataPtr> arguments,
+      const string& device, const ExecuteComputationOptions& options) override;
+
+  std::vector<std::vector<DataPtr>> ExecuteReplicated(
+      const Computation& computation,
+      const std::vector<std::vector<DataPtr>>& arguments,
+      tensorflow::gtl::ArraySlice<const string> devices,
+      const ExecuteReplicatedOptions& options) override;
+
+  std::vector<std::vector<DataPtr>> ExecuteParallel(
+      tensorflow::gtl::ArraySlice<const Computation* const> computations,
+      const std::vector<std::vector<DataPtr>>& arguments,
+      tensorflow::gtl::ArraySlice<const string> devices,
+      const ExecuteParallelOptions& options) override;
+
+  std::vector<DataPtr> ExecuteChained(
+      tensorflow::gtl::ArraySlice<const ExecuteChainedOp> ops,
+      const string& device) override;
+
+  std::vector<std::vector<DataPtr>> DeconstructTuple(
+      tensorflow::gtl::ArraySlice<const DataPtr> tuples) override;
+
+  string GetResourceDomain(const string& device) const override;
+
+  string GetDefaultDevice() const override;
+
+  size_t GetNumDevices() const override;
+
+  std::vector<string> GetLocalDevices() const override;
+
+  std::vector<string> GetAllDevices() const override;
+
+  void SetReplicationDevices(std::vector<string> devices) override;
+
+  const std::vector<string>& GetReplicationDevices() const override;
+
+  std::vector<string> GetTopologyOrderedDevices(
+      std::vector<string> devices) const override;
+
+  void SetRngSeed(size_t seed) override;
+
+  // Returns the local client options selected by the XLA_LOCAL_CLIENT_DEVICE
+  // environment variable, or nullopt if the local client is not enabled.
+  static absl::optional<Options> ParseOptions();
+
+ private:
+  string GetEffectiveDevice(const string& device) const;
+
+  // Takes ownership of a device buffer, which gets freed when the last
+  // LocalData referencing it is destroyed.
+  static std::shared_ptr<ShapedBuffer> CreateBuffer(ScopedShapedBuffer buffer,
+                                                    const string& device);
+
+  // Returns a buffer aliasing the index-th element of the tuple buffer, which
+  // keeps the tuple buffer alive.
+  static std::shared_ptr<ShapedBuffer> GetTupleElementBuffer(
+      std::shared_ptr<ShapedBuffer> tuple_buffer, int64 index);
+
+  std::vector<DataPtr> Execute(
+      const LocalComputation& computation,
+      tensorflow::gtl::ArraySlice<const DataPtr> arguments,
+      const string& device, bool explode_tuple);
+
+  Options options_;
+  LocalClient* client_ = nullptr;
+  std::vector<string> devices_;
+  std::vector<string> replication_devices_;
+  size_t rng_seed_ = 0x5a2d296e9;
+};
+
+}  // namespace xla
+
+#endif  // TENSORFLOW_COMPILER_XLA_RPC_LOCAL_COMPUTATION_CLIENT_H_
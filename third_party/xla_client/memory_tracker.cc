@@ -0,0 +1,149 @@
+#include "tensorflow/compiler/xla/xla_client/memory_tracker.h"
+
+#include <algorithm>
+#include <sstream>
+
+#include "tensorflow/compiler/xla/shape_util.h"
+#include "tensorflow/compiler/xla/xla_client/debug_macros.h"
+#include "tensorflow/compiler/xla/xla_client/metrics.h"
+
+namespace xla {
+namespace {
+
+const char* const kCategoryNames[] = {"input", "activation", "parameter",
+                                      "optimizer_state"};
+
+}  // namespace
+
+MemoryTracker* MemoryTracker::Get() {
+  static MemoryTracker* tracker = new MemoryTracker();
+  return tracker;
+}
+
+const char* MemoryTracker::CategoryName(Category category) {
+  return kCategoryNames[static_cast<int>(category)];
+}
+
+MemoryTracker::Category MemoryTracker::ParseCategory(const string& name) {
+  for (int i = 0; i < static_cast<int>(Category::kNumCategories); ++i) {
+    if (name == kCategoryNames[i]) {
+      return static_cast<Category>(i);
+    }
+  }
+  XLA_ERROR() << "Invalid memory category: " << name;
+}
+
+void MemoryTracker::Allocate(const void* key, const string& device,
+                             const Shape& shape, Category category) {
+  if (!shape.IsArray()) {
+    return;
+  }
+  Allocation allocation;
+  allocation.device = device;
+  allocation.shape = shape;
+  allocation.bytes = ShapeUtil::ByteSizeOf(shape);
+  allocation.category = category;
+
+  std::lock_guard<std::mutex> lock(lock_);
+  DeviceStats& stats = device_stats_[device];
+  stats.live_bytes += allocation.bytes;
+  stats.peak_bytes = std::max(stats.peak_bytes, stats.live_bytes);
+  stats.live_allocations += 1;
+  stats.category_bytes[static_cast<int>(category)] += allocation.bytes;
+  allocations_.emplace(key, std::move(allocation));
+}
+
+void MemoryTracker::Free(const void* key) {
+  std::lock_guard<std::mutex> lock(lock_);
+  auto it = allocations_.find(key);
+  if (it == allocations_.end()) {
+    return;
+  }
+  const Allocation& allocation = it->second;
+  DeviceStats& stats = device_stats_[allocation.device];
+  stats.live_bytes -= allocation.bytes;
+  stats.live_allocations -= 1;
+  stats.category_bytes[static_cast<int>(allocation.category)] -=
+      allocation.bytes;
+  allocations_.erase(it);
+}
+
+void MemoryTracker::SetCategory(const void* key, Category category) {
+  std::lock_guard<std::mutex> lock(lock_);
+  auto it = allocations_.find(key);
+  if (it == allocations_.end() || it->second.category == category) {
+    return;
+  }
+  Allocation& allocation = it->second;
+  DeviceStats& stats = device_stats_[allocation.device];
+  stats.category_bytes[static_cast<int>(allocation.category)] -=
+      allocation.bytes;
+  stats.category_bytes[static_cast<int>(category)] += allocation.bytes;
+  allocation.category = category;
+}
+
+std::map<string, MemoryTracker::DeviceStats> MemoryTracker::GetDeviceStats()
+    const {
+  std::lock_guard<std::mutex> lock(lock_);
+  return device_stats_;
+}
+
+std::vector<MemoryTracker::Allocation> MemoryTracker::GetLargestAllocations(
+    size_t count, const string& device) const {
+  std::vector<Allocation> allocations;
+  {
+    std::lock_guard<std::mutex> lock(lock_);
+    for (auto& key_allocation : allocations_) {
+      if (device.empty() || key_allocation.second.device == device) {
+        allocations.push_back(key_allocation.second);
+      }
+    }
+  }
+  auto bytes_greater = [](const Allocation& a1, const Allocation& a2) {
+    return a1.bytes > a2.bytes;
+  };
+  if (allocations.size() > count) {
+    std::partial_sort(allocations.begin(), allocations.begin() + count,
+                      allocations.end(), bytes_greater);
+    allocations.resize(count);
+  } else {
+    std::sort(allocations.begin(), allocations.end(), bytes_greater);
+  }
+  return allocations;
+}
+
+void MemoryTracker::ResetPeaks() {
+  std::lock_guard<std::mutex> lock(lock_);
+  for (auto& device_stats : device_stats_) {
+    device_stats.second.peak_bytes = device_stats.second.live_bytes;
+  }
+}
+
+string MemoryTracker::CreateReport(size_t max_allocations) const {
+  std::stringstream ss;
+  for (auto& device_stats : GetDeviceStats()) {
+    const DeviceStats& stats = device_stats.second;
+    ss << "Device: " << device_stats.first << "\n";
+    ss << "  LiveBytes: " << metrics::MetricFnBytes(stats.live_bytes) << "\n";
+    ss << "  PeakBytes: " << metrics::MetricFnBytes(stats.peak_bytes) << "\n";
+    ss << "  LiveAllocations: " << stats.live_allocations << "\n";
+    for (int i = 0; i < static_cast<int>(Category::kNumCategories); ++i) {
+      ss << "  " << kCategoryNames[i] << ": "
+         << metrics::MetricFnBytes(stats.category_bytes[i]) << "\n";
+    }
+  }
+  std::vector<Allocation> allocations =
+      GetLargestAllocations(max_allocations, /*device=*/"");
+  if (!allocations.empty()) {
+    ss << "Largest Allocations:\n";
+    for (auto& allocation : allocations) {
+      ss << "  " << metrics::MetricFnBytes(allocation.bytes) << " "
+         << ShapeUtil::HumanString(allocation.shape) << " "
+         << CategoryName(allocation.category) << " " << allocation.device
+         << "\n";
+    }
+  }
+  return ss.str();
+}
+
+}  // namespace xla
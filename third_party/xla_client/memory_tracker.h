@@ -0,0 +1,79 @@
+#ifndef TENSORFLOW_COMPILER_XLA_RPC_MEMORY_TRACKER_H_
+#define TENSORFLOW_COMPILER_XLA_RPC_MEMORY_TRACKER_H_
+
+#include <map>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "tensorflow/compiler/xla/shape.h"
+#include "tensorflow/compiler/xla/types.h"
+
+namespace xla {
+
+// Accounts the device memory held by the live device data handles, per device
+// and per category. The category of an allocation tells where the data came
+// from: inputs are uploaded from the host, activations are computation
+// results, while the parameter and optimizer state categories are assigned by
+// the framework, which knows the role of the tensors.
+// Only array shaped data is accounted, as the elements of tuple shaped data
+// get their own handles once the tuple is deconstructed.
+class MemoryTracker {
+ public:
+  enum class Category {
+    kInput = 0,
+    kActivation,
+    kParameter,
+    kOptimizerState,
+    kNumCategories,
+  };
+
+  struct DeviceStats {
+    int64 live_bytes = 0;
+    int64 peak_bytes = 0;
+    int64 live_allocations = 0;
+    int64 category_bytes[static_cast<int>(Category::kNumCategories)] = {};
+  };
+
+  struct Allocation {
+    string device;
+    Shape shape;
+    int64 bytes = 0;
+    Category category = Category::kActivation;
+  };
+
+  static MemoryTracker* Get();
+
+  static const char* CategoryName(Category category);
+
+  static Category ParseCategory(const string& name);
+
+  // Registers a new allocation, for the device memory owned by key.
+  void Allocate(const void* key, const string& device, const Shape& shape,
+                Category category);
+
+  void Free(const void* key);
+
+  void SetCategory(const void* key, Category category);
+
+  std::map<string, DeviceStats> GetDeviceStats() const;
+
+  // Returns the count largest live allocations, for all the devices if device
+  // is empty.
+  std::vector<Allocation> GetLargestAllocations(size_t count,
+                                                const string& device) const;
+
+  // Resets the peak bytes of every device, to their current live bytes.
+  void ResetPeaks();
+
+  string CreateReport(size_t max_allocations) const;
+
+ private:
+  mutable std::mutex lock_;
+  std::unordered_map<const void*, Allocation> allocations_;
+  std::map<string, DeviceStats> device_stats_;
+};
+
+}  // namespace xla
+
+#endif  // TENSORFLOW_COMPILER_XLA_RPC_MEMORY_TRACKER_H_
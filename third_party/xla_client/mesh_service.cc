@@ -11,11 +11,14 @@
 
 #include <atomic>
 #include <chrono>
+#include <condition_variable>
 #include <iostream>
+#include <map>
 #include <mutex>
 #include <unordered_map>
 
 #include "tensorflow/compiler/xla/status.h"
+#include "tensorflow/compiler/xla/xla_client/cache.h"
 #include "tensorflow/compiler/xla/xla_client/debug_macros.h"
 #include "tensorflow/compiler/xla/xla_client/mesh_service.grpc.pb.h"
 #include "tensorflow/compiler/xla/xla_client/multi_wait.h"
@@ -54,7 +57,13 @@ std::ostream& operator<<(std::ostream& ostrm, const ::grpc::Status& status) {
 
 class MeshServiceImpl : public grpc::MeshService::Service {
  public:
-  MeshServiceImpl(grpc::Config config) : config_(std::move(config)) {}
+  MeshServiceImpl(grpc::Config config)
+      : config_(std::move(config)),
+        compile_cache_(
+            sys_util::GetEnvInt("XRT_MESH_COMPILE_CACHE_BYTES", 1LL << 26),
+            [](const string& key, const bool& /* present */) {
+              return key.size();
+            }) {}
 
   ::grpc::Status GetConfig(::grpc::ServerContext* context,
                            const grpc::GetConfigRequest* request,
@@ -64,23 +73,42 @@ class MeshServiceImpl : public grpc::MeshService::Service {
                             const grpc::RendezvousRequest* request,
                             grpc::RendezvousResponse* response) override;
 
+  ::grpc::Status SetKeyValues(::grpc::ServerContext* context,
+                              const grpc::SetKeyValuesRequest* request,
+                              grpc::SetKeyValuesResponse* response) override;
+
+  ::grpc::Status GetKeyValues(::grpc::ServerContext* context,
+                              const grpc::GetKeyValuesRequest* request,
+                              grpc::GetKeyValuesResponse* response) override;
+
+  ::grpc::Status LookupCompilations(
+      ::grpc::ServerContext* context,
+      const grpc::LookupCompilationsRequest* request,
+      grpc::LookupCompilationsResponse* response) override;
+
+  ::grpc::Status PublishCompilations(
+      ::grpc::ServerContext* context,
+      const grpc::PublishCompilationsRequest* request,
+      grpc::PublishCompilationsResponse* response) override;
+
  private:
   struct RendezvousData {
     explicit RendezvousData(size_t count) : mwait(count), release_count(0) {}
 
     util::MultiWait mwait;
     std::atomic<size_t> release_count;
+    std::mutex lock;
+    std::map<int64, string> payloads;
   };
 
-  std::shared_ptr<RendezvousData> GetRendezvous(const string& tag) {
+  std::shared_ptr<RendezvousData> GetRendezvous(const string& tag,
+                                                size_t count) {
     std::lock_guard<std::mutex> lock(lock_);
     auto it = rendezvous_map_.find(tag);
     if (it == rendezvous_map_.end()) {
-      it =
-          rendezvous_map_
-              .emplace(tag,
-                       std::make_shared<RendezvousData>(config_.workers_size()))
-              .first;
+      it = rendezvous_map_
+               .emplace(tag, std::make_shared<RendezvousData>(count))
+               .first;
     }
     return it->second;
   }
@@ -96,6 +124,13 @@ class MeshServiceImpl : public grpc::MeshService::Service {
   std::mutex lock_;
   grpc::Config config_;
   std::unordered_map<string, std::shared_ptr<RendezvousData>> rendezvous_map_;
+  std::mutex kv_lock_;
+  std::condition_variable kv_cv_;
+  std::unordered_map<string, string> kv_map_;
+  // The compilations published by the clients, keyed by fingerprint, bounded
+  // by their size in bytes (XRT_MESH_COMPILE_CACHE_BYTES).
+  // The fingerprints of the computations compiled by any host of the mesh.
+  util::Cache<string, bool> compile_cache_;
 };
 
 ::grpc::Status MeshServiceImpl::GetConfig(::grpc::ServerContext* context,
@@ -108,7 +143,13 @@ class MeshServiceImpl : public grpc::MeshService::Service {
 ::grpc::Status MeshServiceImpl::Rendezvous(
     ::grpc::ServerContext* context, const grpc::RendezvousRequest* request,
     grpc::RendezvousResponse* response) {
-  auto rendezvous = GetRendezvous(request->tag());
+  size_t count = request->has_replicas() ? request->replicas()
+                                         : config_.workers_size();
+  auto rendezvous = GetRendezvous(request->tag(), count);
+  if (request->has_payload()) {
+    std::lock_guard<std::mutex> lock(rendezvous->lock);
+    rendezvous->payloads[request->ordinal()] = request->payload();
+  }
   rendezvous->mwait.Done();
   TF_VLOG(3) << "Entering rendezvous: tag=" << request->tag()
              << " peer=" << context->peer();
@@ -116,10 +157,81 @@ class MeshServiceImpl : public grpc::MeshService::Service {
       ToGrpcStatus(xla::util::CheckedCall([&]() { rendezvous->mwait.Wait(); }));
   TF_VLOG(3) << "Exiting rendezvous: tag=" << request->tag()
              << " peer=" << context->peer() << " status=" << status;
+  if (status.ok()) {
+    std::lock_guard<std::mutex> lock(rendezvous->lock);
+    for (auto& ordinal_payload : rendezvous->payloads) {
+      response->add_payloads(ordinal_payload.second);
+    }
+  }
   ReleaseRendezvous(request->tag(), rendezvous);
   return status;
 }
 
+::grpc::Status MeshServiceImpl::SetKeyValues(
+    ::grpc::ServerContext* context, const grpc::SetKeyValuesRequest* request,
+    grpc::SetKeyValuesResponse* response) {
+  {
+    std::lock_guard<std::mutex> lock(kv_lock_);
+    for (auto& item : request->items()) {
+      bool stored = true;
+      if (request->only_if_absent()) {
+        stored = kv_map_.emplace(item.key(), item.value()).second;
+      } else {
+        kv_map_[item.key()] = item.value();
+      }
+      response->add_stored(stored);
+    }
+  }
+  kv_cv_.notify_all();
+  return ::grpc::Status::OK;
+}
+
+::grpc::Status MeshServiceImpl::GetKeyValues(
+    ::grpc::ServerContext* context, const grpc::GetKeyValuesRequest* request,
+    grpc::GetKeyValuesResponse* response) {
+  auto has_all_keys = [&]() {
+    for (auto& key : request->keys()) {
+      if (kv_map_.count(key) == 0) {
+        return false;
+      }
+    }
+    return true;
+  };
+  std::unique_lock<std::mutex> lock(kv_lock_);
+  // Long-poll until all the keys have been set, so that waiters get released
+  // as soon as the last value lands, without the clients having to retry.
+  if (!kv_cv_.wait_for(lock, std::chrono::milliseconds(request->timeout_ms()),
+                       has_all_keys)) {
+    return ::grpc::Status(::grpc::StatusCode::DEADLINE_EXCEEDED,
+                          "Timed out waiting for the mesh key/values");
+  }
+  for (auto& key : request->keys()) {
+    response->add_values(kv_map_.at(key));
+  }
+  return ::grpc::Status::OK;
+}
+
+::grpc::Status MeshServiceImpl::LookupCompilations(
+    ::grpc::ServerContext* context,
+    const grpc::LookupCompilationsRequest* request,
+    grpc::LookupCompilationsResponse* response) {
+  for (auto& key : request->keys()) {
+    response->add_found(compile_cache_.Get(key) != nullptr);
+  }
+  return ::grpc::Status::OK;
+}
+
+::grpc::Status MeshServiceImpl::PublishCompilations(
+    ::grpc::ServerContext* context,
+    const grpc::PublishCompilationsRequest* request,
+    grpc::PublishCompilationsResponse* response) {
+  for (auto& key : request->keys()) {
+    auto present = std::make_shared<bool>(true);
+    response->add_stored(compile_cache_.Add(key, present) == present);
+  }
+  return ::grpc::Status::OK;
+}
+
 }  // namespace
 
 struct MeshService::Impl {
@@ -201,5 +313,116 @@ void MeshClient::Rendezvous(const string& tag) const {
   }
 }
 
+std::vector<string> MeshClient::Rendezvous(const string& tag, int64 replicas,
+                                           int64 ordinal,
+                                           const string* payload) const {
+  ::grpc::ClientContext context;
+  grpc::RendezvousRequest reqeust;
+  grpc::RendezvousResponse response;
+  reqeust.set_tag(tag);
+  reqeust.set_replicas(replicas);
+  reqeust.set_ordinal(ordinal);
+  if (payload != nullptr) {
+    reqeust.set_payload(*payload);
+  }
+  TF_VLOG(3) << "Waiting for rendezvous: " << tag << " ordinal=" << ordinal;
+  ::grpc::Status status = impl_->stub->Rendezvous(&context, reqeust, &response);
+  TF_VLOG(3) << "Rendezvous wait complete: " << tag;
+  if (!status.ok()) {
+    XLA_ERROR() << "Failed to meet rendezvous '" << tag << "': " << status;
+  }
+  return std::vector<string>(response.payloads().begin(),
+                             response.payloads().end());
+}
+
+void MeshClient::SetKeyValues(
+    const std::vector<std::pair<string, string>>& key_values) const {
+  ::grpc::ClientContext context;
+  grpc::SetKeyValuesRequest reqeust;
+  grpc::SetKeyValuesResponse response;
+  for (auto& key_value : key_values) {
+    grpc::KeyValue* item = reqeust.add_items();
+    item->set_key(key_value.first);
+    item->set_value(key_value.second);
+  }
+  ::grpc::Status status =
+      impl_->stub->SetKeyValues(&context, reqeust, &response);
+  if (!status.ok()) {
+    XLA_ERROR() << "Failed to set mesh key/values: " << status;
+  }
+}
+
+std::vector<bool> MeshClient::SetKeyValuesIfAbsent(
+    const std::vector<std::pair<string, string>>& key_values) const {
+  ::grpc::ClientContext context;
+  grpc::SetKeyValuesRequest reqeust;
+  grpc::SetKeyValuesResponse response;
+  for (auto& key_value : key_values) {
+    grpc::KeyValue* item = reqeust.add_items();
+    item->set_key(key_value.first);
+    item->set_value(key_value.second);
+  }
+  reqeust.set_only_if_absent(true);
+  ::grpc::Status status =
+      impl_->stub->SetKeyValues(&context, reqeust, &response);
+  if (!status.ok()) {
+    XLA_ERROR() << "Failed to set mesh key/values: " << status;
+  }
+  XLA_CHECK_EQ(response.stored_size(), key_values.size());
+  return std::vector<bool>(response.stored().begin(), response.stored().end());
+}
+
+std::vector<string> MeshClient::GetKeyValues(const std::vector<string>& keys,
+                                             double wait_seconds) const {
+  ::grpc::ClientContext context;
+  grpc::GetKeyValuesRequest reqeust;
+  grpc::GetKeyValuesResponse response;
+  for (auto& key : keys) {
+    reqeust.add_keys(key);
+  }
+  reqeust.set_timeout_ms(static_cast<int64>(wait_seconds * 1000.0));
+  ::grpc::Status status =
+      impl_->stub->GetKeyValues(&context, reqeust, &response);
+  if (!status.ok()) {
+    XLA_ERROR() << "Failed to get mesh key/values: " << status;
+  }
+  return std::vector<string>(response.values().begin(),
+                             response.values().end());
+}
+
+std::vector<bool> MeshClient::LookupCompilations(
+    const std::vector<string>& keys) const {
+  ::grpc::ClientContext context;
+  grpc::LookupCompilationsRequest request;
+  grpc::LookupCompilationsResponse response;
+  for (auto& key : keys) {
+    request.add_keys(key);
+  }
+  ::grpc::Status status =
+      impl_->stub->LookupCompilations(&context, request, &response);
+  if (!status.ok()) {
+    XLA_ERROR() << "Failed to lookup mesh compilations: " << status;
+  }
+  XLA_CHECK_EQ(response.found_size(), keys.size());
+  return std::vector<bool>(response.found().begin(), response.found().end());
+}
+
+std::vector<bool> MeshClient::PublishCompilations(
+    const std::vector<string>& keys) const {
+  ::grpc::ClientContext context;
+  grpc::PublishCompilationsRequest request;
+  grpc::PublishCompilationsResponse response;
+  for (auto& key : keys) {
+    request.add_keys(key);
+  }
+  ::grpc::Status status =
+      impl_->stub->PublishCompilations(&context, request, &response);
+  if (!status.ok()) {
+    XLA_ERROR() << "Failed to publish mesh compilations: " << status;
+  }
+  XLA_CHECK_EQ(response.stored_size(), keys.size());
+  return std::vector<bool>(response.stored().begin(), response.stored().end());
+}
+
 }  // namespace service
 }  // namespace xla
@@ -3,6 +3,8 @@
 
 #include <memory>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include "tensorflow/compiler/xla/types.h"
 #include "tensorflow/compiler/xla/xla_client/mesh_service.pb.h"
@@ -34,6 +36,36 @@ class MeshClient {
 
   void Rendezvous(const string& tag) const;
 
+  // Waits for replicas participants to enter the rendezvous with the same tag,
+  // and returns the payloads of the ones which sent one (payload not null),
+  // sorted by ordinal.
+  std::vector<string> Rendezvous(const string& tag, int64 replicas,
+                                 int64 ordinal, const string* payload) const;
+
+  // Stores all the key/value pairs with a single call to the mesh service.
+  void SetKeyValues(
+      const std::vector<std::pair<string, string>>& key_values) const;
+
+  // Like SetKeyValues(), but only stores the pairs whose key is not already
+  // set, atomically. Returns whether each pair has been stored, which lets
+  // the clients elect an owner for every key.
+  std::vector<bool> SetKeyValuesIfAbsent(
+      const std::vector<std::pair<string, string>>& key_values) const;
+
+  // Returns the values of the keys, waiting up to wait_seconds for all of them
+  // to be set.
+  std::vector<string> GetKeyValues(const std::vector<string>& keys,
+                                   double wait_seconds) const;
+
+  // Looks up the computation fingerprints within the compile cache hosted by
+  // the mesh service, and returns whether each one has been published.
+  std::vector<bool> LookupCompilations(const std::vector<string>& keys) const;
+
+  // Publishes the computation fingerprints to the mesh service compile cache.
+  // Returns whether each one has been stored, which is false for the ones
+  // another client has already published.
+  std::vector<bool> PublishCompilations(const std::vector<string>& keys) const;
+
  private:
   MeshClient(const string& address);
 
@@ -1,5 +1,7 @@
 #include "tensorflow/compiler/xla/xla_client/metrics.h"
 
+#include <algorithm>
+#include <cctype>
 #include <cmath>
 #include <map>
 #include <sstream>
@@ -71,6 +73,13 @@ MetricsArena* MetricsArena::Get() {
 void MetricsArena::RegisterMetric(const string& name, MetricReprFn repr_fn,
                                   size_t max_samples,
                                   std::shared_ptr<MetricData>* data) {
+  // Allows trading the raw samples (and their memory) for the histogram only
+  // statistics, by setting XLA_METRICS_SAMPLES=0.
+  static const int64 max_samples_override =
+      sys_util::GetEnvInt("XLA_METRICS_SAMPLES", -1);
+  if (max_samples_override >= 0) {
+    max_samples = max_samples_override;
+  }
   std::lock_guard<std::mutex> lock(lock_);
   if (*data == nullptr) {
     std::shared_ptr<MetricData> new_data =
@@ -134,19 +143,36 @@ void EmitMetricInfo(const string& name, MetricData* data,
   const int kNumPercentiles = 9;
   static double const kPercentiles[kNumPercentiles] = {
       0.01, 0.05, 0.1, 0.2, 0.5, 0.8, 0.9, 0.95, 0.99};
-  std::sort(
-      samples.begin(), samples.end(),
-      [](const Sample& s1, const Sample& s2) { return s1.value < s2.value; });
-  (*ss) << "  Percentiles: ";
-  for (int i = 0; i < kNumPercentiles; ++i) {
-    size_t index = kPercentiles[i] * samples.size();
-    if (i > 0) {
-      (*ss) << "; ";
+  if (!samples.empty()) {
+    std::sort(
+        samples.begin(), samples.end(),
+        [](const Sample& s1, const Sample& s2) { return s1.value < s2.value; });
+    (*ss) << "  Percentiles: ";
+    for (int i = 0; i < kNumPercentiles; ++i) {
+      size_t index = kPercentiles[i] * samples.size();
+      if (i > 0) {
+        (*ss) << "; ";
+      }
+      (*ss) << (kPercentiles[i] * 100.0)
+            << "%=" << data->Repr(samples[index].value);
     }
-    (*ss) << (kPercentiles[i] * 100.0)
-          << "%=" << data->Repr(samples[index].value);
+    (*ss) << std::endl;
+  }
+
+  if (total_samples > 0) {
+    const int kNumHistogramPercentiles = 3;
+    static double const kHistogramPercentiles[kNumHistogramPercentiles] = {
+        0.5, 0.9, 0.99};
+    (*ss) << "  HistogramPercentiles: ";
+    for (int i = 0; i < kNumHistogramPercentiles; ++i) {
+      if (i > 0) {
+        (*ss) << "; ";
+      }
+      (*ss) << (kHistogramPercentiles[i] * 100.0) << "%="
+            << data->Repr(data->HistogramPercentile(kHistogramPercentiles[i]));
+    }
+    (*ss) << std::endl;
   }
-  (*ss) << std::endl;
 }
 
 void EmitCounterInfo(const string& name, CounterData* data,
@@ -155,50 +181,170 @@ void EmitCounterInfo(const string& name, CounterData* data,
   (*ss) << "  Value: " << data->Value() << std::endl;
 }
 
+// Maps the metric names to valid OpenMetrics ones, within the xla_ namespace.
+string OpenMetricsName(const string& name) {
+  string metric_name = "xla_";
+  for (char c : name) {
+    metric_name.push_back(std::isalnum(static_cast<unsigned char>(c)) ? c
+                                                                      : '_');
+  }
+  return metric_name;
+}
+
+void EmitOpenMetricInfo(const string& name, MetricData* data,
+                        std::stringstream* ss) {
+  const int kNumQuantiles = 3;
+  static double const kQuantiles[kNumQuantiles] = {0.5, 0.9, 0.99};
+  string metric_name = OpenMetricsName(name);
+  size_t total_samples = data->TotalSamples();
+  (*ss) << "# TYPE " << metric_name << " summary\n";
+  if (total_samples > 0) {
+    for (int i = 0; i < kNumQuantiles; ++i) {
+      (*ss) << metric_name << "{quantile=\"" << kQuantiles[i] << "\"} "
+            << data->HistogramPercentile(kQuantiles[i]) << "\n";
+    }
+  }
+  (*ss) << metric_name << "_sum " << data->Accumulator() << "\n";
+  (*ss) << metric_name << "_count " << total_samples << "\n";
+}
+
+void EmitOpenCounterInfo(const string& name, CounterData* data,
+                         std::stringstream* ss) {
+  string metric_name = OpenMetricsName(name);
+  (*ss) << "# TYPE " << metric_name << " counter\n";
+  (*ss) << metric_name << "_total " << data->Value() << "\n";
+}
+
 }  // namespace
 
+constexpr int MetricData::kHistogramBucketsPerOctave;
+constexpr int MetricData::kHistogramBuckets;
+constexpr size_t MetricData::kNumShards;
+constexpr size_t CounterData::kNumSlots;
+
 MetricData::MetricData(MetricReprFn repr_fn, size_t max_samples)
-    : repr_fn_(std::move(repr_fn)), samples_(max_samples) {}
+    : repr_fn_(std::move(repr_fn)), max_samples_(max_samples) {}
+
+int MetricData::HistogramBucket(double value) {
+  if (!(value > 1.0)) {
+    return 0;
+  }
+  int bucket = 1 + static_cast<int>(std::log2(value) *
+                                    kHistogramBucketsPerOctave);
+  return std::min(bucket, kHistogramBuckets - 1);
+}
+
+double MetricData::HistogramBucketValue(int bucket) {
+  if (bucket == 0) {
+    return 1.0;
+  }
+  // Returns the geometric center of the bucket.
+  return std::exp2((bucket - 0.5) / kHistogramBucketsPerOctave);
+}
+
+size_t CounterData::SlotIndex() {
+  static std::atomic<size_t> next_slot(0);
+  static thread_local size_t slot_index = next_slot++ % kNumSlots;
+  return slot_index;
+}
+
+xla::int64 CounterData::Value() const {
+  xla::int64 value = 0;
+  for (auto& slot : slots_) {
+    value += slot.value.load(std::memory_order_relaxed);
+  }
+  return value;
+}
 
 void MetricData::AddSample(int64 timestamp_ns, double value) {
-  std::lock_guard<std::mutex> lock(lock_);
-  size_t position = count_ % samples_.size();
-  ++count_;
-  accumulator_ += value;
-  samples_[position] = Sample(timestamp_ns, value);
+  static std::atomic<size_t> next_shard(0);
+  static thread_local size_t shard_index = next_shard++ % kNumShards;
+  Shard& shard = shards_[shard_index];
+  std::lock_guard<std::mutex> lock(shard.lock);
+  if (shard.histogram.empty()) {
+    shard.histogram.resize(kHistogramBuckets, 0);
+  }
+  shard.histogram[HistogramBucket(value)] += 1;
+  if (max_samples_ > 0) {
+    // Buffers grow on demand, so only the shards of the threads actually
+    // posting samples pay for them.
+    size_t position = shard.count % max_samples_;
+    if (position >= shard.samples.size()) {
+      shard.samples.emplace_back(timestamp_ns, value);
+    } else {
+      shard.samples[position] = Sample(timestamp_ns, value);
+    }
+  }
+  ++shard.count;
+  shard.accumulator += value;
 }
 
 double MetricData::Accumulator() const {
-  std::lock_guard<std::mutex> lock(lock_);
-  return accumulator_;
+  double accumulator = 0.0;
+  for (auto& shard : shards_) {
+    std::lock_guard<std::mutex> lock(shard.lock);
+    accumulator += shard.accumulator;
+  }
+  return accumulator;
 }
 
 size_t MetricData::TotalSamples() const {
-  std::lock_guard<std::mutex> lock(lock_);
-  return count_;
+  size_t count = 0;
+  for (auto& shard : shards_) {
+    std::lock_guard<std::mutex> lock(shard.lock);
+    count += shard.count;
+  }
+  return count;
 }
 
 std::vector<Sample> MetricData::Samples(double* accumulator,
                                         size_t* total_samples) const {
-  std::lock_guard<std::mutex> lock(lock_);
   std::vector<Sample> samples;
-  if (count_ <= samples_.size()) {
-    samples.insert(samples.end(), samples_.begin(), samples_.begin() + count_);
-  } else {
-    size_t position = count_ % samples_.size();
-    samples.insert(samples.end(), samples_.begin() + position, samples_.end());
-    samples.insert(samples.end(), samples_.begin(),
-                   samples_.begin() + position);
+  double total_accumulator = 0.0;
+  size_t count = 0;
+  for (auto& shard : shards_) {
+    std::lock_guard<std::mutex> lock(shard.lock);
+    samples.insert(samples.end(), shard.samples.begin(), shard.samples.end());
+    total_accumulator += shard.accumulator;
+    count += shard.count;
+  }
+  std::stable_sort(samples.begin(), samples.end(),
+                   [](const Sample& s1, const Sample& s2) {
+                     return s1.timestamp_ns < s2.timestamp_ns;
+                   });
+  if (samples.size() > max_samples_) {
+    samples.erase(samples.begin(), samples.end() - max_samples_);
   }
   if (accumulator != nullptr) {
-    *accumulator = accumulator_;
+    *accumulator = total_accumulator;
   }
   if (total_samples != nullptr) {
-    *total_samples = count_;
+    *total_samples = count;
   }
   return samples;
 }
 
+double MetricData::HistogramPercentile(double fraction) const {
+  std::vector<int64> histogram(kHistogramBuckets, 0);
+  int64 count = 0;
+  for (auto& shard : shards_) {
+    std::lock_guard<std::mutex> lock(shard.lock);
+    for (size_t i = 0; i < shard.histogram.size(); ++i) {
+      histogram[i] += shard.histogram[i];
+      count += shard.histogram[i];
+    }
+  }
+  int64 rank = static_cast<int64>(fraction * count);
+  int64 seen = 0;
+  for (int i = 0; i < kHistogramBuckets; ++i) {
+    seen += histogram[i];
+    if (seen > rank) {
+      return HistogramBucketValue(i);
+    }
+  }
+  return 0.0;
+}
+
 Metric::Metric(string name, MetricReprFn repr_fn, size_t max_samples)
     : name_(std::move(name)),
       repr_fn_(std::move(repr_fn)),
@@ -315,6 +461,19 @@ string CreateMetricReport() {
   return ss.str();
 }
 
+string CreateOpenMetricsReport() {
+  MetricsArena* arena = MetricsArena::Get();
+  std::stringstream ss;
+  arena->ForEachMetric([&ss](const string& name, MetricData* data) {
+    EmitOpenMetricInfo(name, data, &ss);
+  });
+  arena->ForEachCounter([&ss](const string& name, CounterData* data) {
+    EmitOpenCounterInfo(name, data, &ss);
+  });
+  ss << "# EOF\n";
+  return ss.str();
+}
+
 std::vector<string> GetMetricNames() {
   return MetricsArena::Get()->GetMetricNames();
 }
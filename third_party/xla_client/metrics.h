@@ -9,6 +9,7 @@
 
 #include "tensorflow/compiler/xla/types.h"
 #include "tensorflow/compiler/xla/xla_client/sys_util.h"
+#include "tensorflow/compiler/xla/xla_client/tracing.h"
 
 namespace xla {
 namespace metrics {
@@ -25,10 +26,19 @@ struct Sample {
 using MetricReprFn = std::function<string(double)>;
 
 // Class used to collect time-stamped numeric samples. The samples are stored in
-// a circular buffer whose size can be configured at constructor time.
+// per-thread circular buffers whose size can be configured at constructor time,
+// which are merged when read. Besides the raw samples, a fixed size log-scale
+// histogram of all the posted values is maintained, so that percentiles can be
+// reported over the whole metric lifetime, even with small (or no) sample
+// buffers.
 class MetricData {
  public:
-  // Creates a new MetricData object with the internal circular buffer storing
+  // The histogram buckets are kHistogramBucketsPerOctave per power of two, and
+  // the first one collects all the values lower than or equal to one.
+  static constexpr int kHistogramBucketsPerOctave = 4;
+  static constexpr int kHistogramBuckets = 64 * kHistogramBucketsPerOctave + 1;
+
+  // Creates a new MetricData object with the internal circular buffers storing
   // max_samples samples. The repr_fn argument allow to specify a function which
   // pretty-prints a sample value.
   MetricData(MetricReprFn repr_fn, size_t max_samples);
@@ -40,34 +50,69 @@ class MetricData {
 
   void AddSample(int64 timestamp_ns, double value);
 
-  // Returns a vector with all the current samples, from the oldest to the
-  // newer. If accumulator is not nullptr, it will receive the current value of
-  // the metrics' accumulator (the sum of all posted values). If total_samples
-  // is not nullptr, it will receive the count of the posted values.
+  // Returns a vector with the most recent samples (at most max_samples), from
+  // the oldest to the newer. If accumulator is not nullptr, it will receive the
+  // current value of the metrics' accumulator (the sum of all posted values).
+  // If total_samples is not nullptr, it will receive the count of the posted
+  // values.
   std::vector<Sample> Samples(double* accumulator, size_t* total_samples) const;
 
+  // Returns the estimated value below which the given fraction of all the
+  // posted values falls, out of the histogram.
+  double HistogramPercentile(double fraction) const;
+
   string Repr(double value) const { return repr_fn_(value); }
 
  private:
-  mutable std::mutex lock_;
+  // The per thread data. Threads are assigned shards in round robin, so locks
+  // are only contended when more than kNumShards threads post samples at the
+  // same time.
+  struct Shard {
+    std::mutex lock;
+    size_t count = 0;
+    double accumulator = 0.0;
+    std::vector<Sample> samples;
+    std::vector<int64> histogram;
+  };
+
+  static constexpr size_t kNumShards = 16;
+
+  static int HistogramBucket(double value);
+
+  static double HistogramBucketValue(int bucket);
+
   MetricReprFn repr_fn_;
-  size_t count_ = 0;
-  std::vector<Sample> samples_;
-  double accumulator_ = 0.0;
+  size_t max_samples_;
+  mutable Shard shards_[kNumShards];
 };
 
 // Counters are a very lightweight form of metrics which do not need to track
-// sample time.
+// sample time. The value is split among cache line sized slots, which threads
+// are assigned in round robin, so that the counters bumped by every traced
+// operation do not bounce a single cache line among the tracing threads.
 class CounterData {
  public:
-  CounterData() : value_(0) {}
-
-  void AddValue(xla::int64 value) { value_ += value; }
+  void AddValue(xla::int64 value) {
+    slots_[SlotIndex()].value.fetch_add(value, std::memory_order_relaxed);
+  }
 
-  xla::int64 Value() const { return value_; }
+  xla::int64 Value() const;
 
  private:
-  std::atomic<xla::int64> value_;
+  // The slots are not declared over-aligned, as C++14 operator new (used by
+  // std::make_shared()) ignores alignments above the default one. A slot can
+  // then straddle two cache lines, but the values of two slots are always 64
+  // bytes apart, so they never share one.
+  struct Slot {
+    std::atomic<xla::int64> value{0};
+    char padding[64 - sizeof(std::atomic<xla::int64>)];
+  };
+
+  static constexpr size_t kNumSlots = 16;
+
+  static size_t SlotIndex();
+
+  Slot slots_[kNumSlots];
 };
 
 // Emits the value in a to_string() conversion.
@@ -153,6 +198,12 @@ class Counter {
 // Creates a report with the current metrics statistics.
 string CreateMetricReport();
 
+// Creates a report with the current metrics statistics, in the OpenMetrics
+// text format. Counters are exported as counters, and metrics as summaries
+// with the histogram percentiles as quantiles (in the metric units, like
+// nanoseconds for the timing metrics).
+string CreateOpenMetricsReport();
+
 // Returns the currently registered metric names. Note that the list can grow
 // since metrics are usualy function intialized (they are static function
 // variables).
@@ -172,7 +223,8 @@ std::vector<string> GetCounterNames();
 CounterData* GetCounter(const string& name);
 
 // Scope based utility class to measure the time the code takes within a given
-// C++ scope.
+// C++ scope. The section is also recorded as a trace event, if tracing is
+// enabled.
 class TimedSection {
  public:
   explicit TimedSection(Metric* metric)
@@ -181,6 +233,10 @@ class TimedSection {
   ~TimedSection() {
     int64 now = sys_util::NowNs();
     metric_->AddSample(now, now - start_);
+    if (tracing::IsEnabled()) {
+      tracing::RecordEvent("metric", metric_->Name().c_str(), start_,
+                           now - start_);
+    }
   }
 
  private:
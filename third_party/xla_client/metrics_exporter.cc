@@ -0,0 +1,210 @@
+#include "tensorflow/compiler/xla/xla_client/metrics_exporter.h"
+
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <mutex>
+#include <thread>
+
+#include "absl/strings/str_cat.h"
+#include "tensorflow/compiler/xla/xla_client/debug_macros.h"
+#include "tensorflow/compiler/xla/xla_client/metrics.h"
+#include "tensorflow/compiler/xla/xla_client/sys_util.h"
+#include "tensorflow/compiler/xla/xla_client/tf_logging.h"
+
+namespace xla {
+namespace metrics {
+namespace {
+
+const char* const kOpenMetricsContentType =
+    "application/openmetrics-text; version=1.0.0; charset=utf-8";
+
+bool SendAll(int fd, const string& data) {
+  size_t sent = 0;
+  while (sent < data.size()) {
+    ssize_t count = send(fd, data.data() + sent, data.size() - sent, 0);
+    if (count <= 0) {
+      return false;
+    }
+    sent += count;
+  }
+  return true;
+}
+
+string CreateHttpResponse(const string& status, const string& content_type,
+                          const string& body) {
+  return absl::StrCat("HTTP/1.1 ", status, "\r\nContent-Type: ", content_type,
+                      "\r\nContent-Length: ", body.size(),
+                      "\r\nConnection: close\r\n\r\n", body);
+}
+
+void ServeRequest(int fd) {
+  // Only the request line matters, so the headers are read up to a limit, and
+  // the rest of the request is ignored.
+  string request;
+  char buffer[1024];
+  while (request.find("\r\n\r\n") == string::npos && request.size() < 8192) {
+    ssize_t count = recv(fd, buffer, sizeof(buffer), 0);
+    if (count <= 0) {
+      break;
+    }
+    request.append(buffer, count);
+  }
+  string response;
+  if (request.compare(0, 12, "GET /metrics") == 0) {
+    XLA_COUNTER("MetricsExporterScrapes", 1);
+    response = CreateHttpResponse("200 OK", kOpenMetricsContentType,
+                                  CreateOpenMetricsReport());
+  } else {
+    response = CreateHttpResponse("404 Not Found", "text/plain", "Not found\n");
+  }
+  SendAll(fd, response);
+}
+
+void RunServer(int server_fd) {
+  for (;;) {
+    int fd = accept(server_fd, nullptr, nullptr);
+    if (fd < 0) {
+      TF_LOG(WARNING) << "Metrics server accept failed: "
+                      << std::strerror(errno);
+      continue;
+    }
+    ServeRequest(fd);
+    close(fd);
+  }
+}
+
+int ConnectTo(const string& host, const string& port) {
+  struct addrinfo hints;
+  std::memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  struct addrinfo* addresses = nullptr;
+  if (getaddrinfo(host.c_str(), port.c_str(), &hints, &addresses) != 0) {
+    return -1;
+  }
+  int fd = -1;
+  for (struct addrinfo* address = addresses; address != nullptr;
+       address = address->ai_next) {
+    fd = socket(address->ai_family, address->ai_socktype, address->ai_protocol);
+    if (fd < 0) {
+      continue;
+    }
+    if (connect(fd, address->ai_addr, address->ai_addrlen) == 0) {
+      break;
+    }
+    close(fd);
+    fd = -1;
+  }
+  freeaddrinfo(addresses);
+  return fd;
+}
+
+bool PushReport(const string& address) {
+  string::size_type path_pos = address.find('/');
+  string host_port = address.substr(0, path_pos);
+  string path =
+      path_pos != string::npos ? address.substr(path_pos) : "/metrics";
+  string::size_type port_pos = host_port.rfind(':');
+  string host = host_port.substr(0, port_pos);
+  string port =
+      port_pos != string::npos ? host_port.substr(port_pos + 1) : "80";
+  int fd = ConnectTo(host, port);
+  if (fd < 0) {
+    return false;
+  }
+  string body = CreateOpenMetricsReport();
+  string request = absl::StrCat(
+      "PUT ", path, " HTTP/1.1\r\nHost: ", host_port,
+      "\r\nContent-Type: ", kOpenMetricsContentType,
+      "\r\nContent-Length: ", body.size(), "\r\nConnection: close\r\n\r\n",
+      body);
+  bool pushed = SendAll(fd, request);
+  if (pushed) {
+    char buffer[64];
+    ssize_t count = recv(fd, buffer, sizeof(buffer) - 1, 0);
+    buffer[count > 0 ? count : 0] = '\0';
+    // Any 2xx status is a success.
+    pushed = std::strncmp(buffer, "HTTP/1.", 7) == 0 &&
+             std::strlen(buffer) > 9 && buffer[9] == '2';
+  }
+  close(fd);
+  return pushed;
+}
+
+}  // namespace
+
+int StartMetricsServer(int port) {
+  int server_fd = socket(AF_INET, SOCK_STREAM, 0);
+  XLA_CHECK_GE(server_fd, 0)
+      << "Unable to create the metrics server socket: " << std::strerror(errno);
+  int reuse = 1;
+  setsockopt(server_fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+  struct sockaddr_in address;
+  std::memset(&address, 0, sizeof(address));
+  address.sin_family = AF_INET;
+  // Only local scrapers are served unless told otherwise, as the report
+  // exposes details of the workload.
+  static const string host =
+      sys_util::GetEnvString("XLA_METRICS_HOST", "127.0.0.1");
+  XLA_CHECK_EQ(inet_pton(AF_INET, host.c_str(), &address.sin_addr), 1)
+      << "Invalid metrics server address: " << host;
+  address.sin_port = htons(port);
+  XLA_CHECK_EQ(bind(server_fd, reinterpret_cast<struct sockaddr*>(&address),
+                    sizeof(address)),
+               0)
+      << "Unable to bind the metrics server to port " << port << ": "
+      << std::strerror(errno);
+  XLA_CHECK_EQ(listen(server_fd, 16), 0) << std::strerror(errno);
+  socklen_t address_size = sizeof(address);
+  getsockname(server_fd, reinterpret_cast<struct sockaddr*>(&address),
+              &address_size);
+  int bound_port = ntohs(address.sin_port);
+  std::thread thread([server_fd]() { RunServer(server_fd); });
+  thread.detach();
+  TF_LOG(INFO) << "Serving the metrics on port " << bound_port;
+  return bound_port;
+}
+
+void StartMetricsPusher(const string& address, double period_s) {
+  XLA_CHECK_GT(period_s, 0.0) << "Invalid metrics push period: " << period_s;
+  std::thread thread([address, period_s]() {
+    for (;;) {
+      std::this_thread::sleep_for(std::chrono::duration<double>(period_s));
+      if (PushReport(address)) {
+        XLA_COUNTER("MetricsExporterPushes", 1);
+      } else {
+        XLA_COUNTER("MetricsExporterPushErrors", 1);
+        TF_VLOG(1) << "Failed to push the metrics to " << address;
+      }
+    }
+  });
+  thread.detach();
+}
+
+void MaybeStartMetricsExporters() {
+  static std::once_flag once;
+  std::call_once(once, []() {
+    int64 port = sys_util::GetEnvInt("XLA_METRICS_PORT", -1);
+    if (port >= 0) {
+      StartMetricsServer(port);
+    }
+    string push_address =
+        sys_util::GetEnvString("XLA_METRICS_PUSH_ADDRESS", "");
+    if (!push_address.empty()) {
+      StartMetricsPusher(
+          push_address,
+          sys_util::GetEnvInt("XLA_METRICS_PUSH_PERIOD", 60));
+    }
+  });
+}
+
+}  // namespace metrics
+}  // namespace xla
@@ -0,0 +1,31 @@
+#ifndef TENSORFLOW_COMPILER_XLA_RPC_METRICS_EXPORTER_H_
+#define TENSORFLOW_COMPILER_XLA_RPC_METRICS_EXPORTER_H_
+
+#include <string>
+
+#include "tensorflow/compiler/xla/types.h"
+
+namespace xla {
+namespace metrics {
+
+// Starts a background thread serving the CreateOpenMetricsReport() report over
+// HTTP, at the /metrics path of the given port (a zero port picks a free one).
+// The server binds the XLA_METRICS_HOST IPv4 address (default 127.0.0.1, use
+// 0.0.0.0 to serve remote scrapers).
+// The report is only created when scraped, so there is no cost on the paths
+// posting samples. Returns the port the server listens on.
+int StartMetricsServer(int port);
+
+// Starts a background thread which sends the report to a push gateway, with an
+// HTTP PUT to the "host:port/path" address, every period_s seconds.
+void StartMetricsPusher(const string& address, double period_s);
+
+// Starts the exporters configured by the XLA_METRICS_PORT and the
+// XLA_METRICS_PUSH_ADDRESS (with XLA_METRICS_PUSH_PERIOD) environment
+// variables, if any. Only the first call has effect.
+void MaybeStartMetricsExporters();
+
+}  // namespace metrics
+}  // namespace xla
+
+#endif  // TENSORFLOW_COMPILER_XLA_RPC_METRICS_EXPORTER_H_
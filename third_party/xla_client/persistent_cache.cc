@@ -0,0 +1,58 @@
+#include "tensorflow/compiler/xla/xla_client/persistent_cache.h"
+
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "tensorflow/compiler/xla/xla_client/debug_macros.h"
+#include "tensorflow/compiler/xla/xla_client/tf_logging.h"
+#include "tensorflow/core/lib/io/path.h"
+#include "tensorflow/core/platform/env.h"
+
+namespace xla {
+namespace util {
+
+PersistentCache::PersistentCache(string path) : path_(std::move(path)) {
+  tensorflow::Status status =
+      tensorflow::Env::Default()->RecursivelyCreateDir(path_);
+  XLA_CHECK(status.ok()) << "Unable to create persistent cache folder "
+                         << path_ << ": " << status;
+}
+
+std::unique_ptr<string> PersistentCache::Get(const string& key) const {
+  string entry_path = GetEntryPath(key);
+  tensorflow::Env* env = tensorflow::Env::Default();
+  if (!env->FileExists(entry_path).ok()) {
+    return nullptr;
+  }
+  auto blob = absl::make_unique<string>();
+  tensorflow::Status status =
+      tensorflow::ReadFileToString(env, entry_path, blob.get());
+  if (!status.ok()) {
+    TF_LOG(WARNING) << "Unable to read persistent cache entry " << entry_path
+                    << ": " << status;
+    return nullptr;
+  }
+  return blob;
+}
+
+void PersistentCache::Put(const string& key, const string& blob) const {
+  string entry_path = GetEntryPath(key);
+  tensorflow::Env* env = tensorflow::Env::Default();
+  string temp_path = absl::StrCat(entry_path, ".tmp.", env->NowMicros());
+  tensorflow::Status status =
+      tensorflow::WriteStringToFile(env, temp_path, blob);
+  if (status.ok()) {
+    status = env->RenameFile(temp_path, entry_path);
+  }
+  if (!status.ok()) {
+    TF_LOG(WARNING) << "Unable to write persistent cache entry " << entry_path
+                    << ": " << status;
+    env->DeleteFile(temp_path).IgnoreError();
+  }
+}
+
+string PersistentCache::GetEntryPath(const string& key) const {
+  return tensorflow::io::JoinPath(path_, key);
+}
+
+}  // namespace util
+}  // namespace xla
@@ -0,0 +1,40 @@
+#ifndef TENSORFLOW_COMPILER_XLA_RPC_PERSISTENT_CACHE_H_
+#define TENSORFLOW_COMPILER_XLA_RPC_PERSISTENT_CACHE_H_
+
+#include <memory>
+#include <string>
+
+#include "tensorflow/compiler/xla/types.h"
+
+namespace xla {
+namespace util {
+
+// A simple key/blob store backed by a (local or shared) directory. Every entry
+// is stored into its own file named after the key, and writes are performed by
+// renaming a temporary file, so that concurrent writers (possibly from
+// different processes) sharing the same directory never expose partial data.
+// The directory path can use any file system supported by the TensorFlow Env
+// (like gs:// paths).
+class PersistentCache {
+ public:
+  explicit PersistentCache(string path);
+
+  // Retrieves the blob stored for key, or nullptr if not present.
+  std::unique_ptr<string> Get(const string& key) const;
+
+  // Stores the blob for key, replacing any existing one. Failures are logged
+  // and ignored, as the persistent cache is only an optimization.
+  void Put(const string& key, const string& blob) const;
+
+  const string& path() const { return path_; }
+
+ private:
+  string GetEntryPath(const string& key) const;
+
+  string path_;
+};
+
+}  // namespace util
+}  // namespace xla
+
+#endif  // TENSORFLOW_COMPILER_XLA_RPC_PERSISTENT_CACHE_H_
@@ -0,0 +1,301 @@
+#include "tensorflow/compiler/xla/xla_client/tensor_allocator.h"
+
+#include <sys/mman.h>
+
+#include <cstdlib>
+#include <mutex>
+#include <vector>
+
+#include "tensorflow/compiler/xla/util.h"
+#include "tensorflow/compiler/xla/xla_client/affinity.h"
+#include "tensorflow/compiler/xla/xla_client/debug_macros.h"
+#include "tensorflow/compiler/xla/xla_client/metrics.h"
+#include "tensorflow/compiler/xla/xla_client/sys_util.h"
+
+namespace xla {
+namespace {
+
+const size_t kAlignment = tensorflow::Allocator::kAllocatorAlignment;
+const size_t kMinSizeClassShift = 8;
+const size_t kNumSizeClasses =
+    1 + 4 * (8 * sizeof(size_t) - kMinSizeClassShift);
+const size_t kNoSizeClass = kNumSizeClasses;
+// Blocks of this size or bigger are hugepage aligned, and advised as such.
+const size_t kHugePageSize = 2 * 1024 * 1024;
+// Blocks bigger than this are not cached within the per-thread caches.
+const size_t kMaxThreadCacheBlockSize = 1024 * 1024;
+const size_t kMaxThreadCacheBlocks = 8;
+
+// Stored right before the user memory, within the alignment-sized area.
+struct BlockHeader {
+  void* base = nullptr;
+  size_t size_class = kNoSizeClass;
+  size_t num_bytes = 0;
+  int numa_node = 0;
+};
+
+BlockHeader* GetHeader(void* ptr) {
+  return reinterpret_cast<BlockHeader*>(ptr) - 1;
+}
+
+metrics::Counter* HitsCounter() {
+  static metrics::Counter* counter =
+      new metrics::Counter("TensorAllocatorHits");
+  return counter;
+}
+
+metrics::Counter* MissesCounter() {
+  static metrics::Counter* counter =
+      new metrics::Counter("TensorAllocatorMisses");
+  return counter;
+}
+
+metrics::Counter* TrimsCounter() {
+  static metrics::Counter* counter =
+      new metrics::Counter("TensorAllocatorTrims");
+  return counter;
+}
+
+// The cached bytes go up and down, so they are sampled as a value metric.
+metrics::Metric* CachedBytesMetric() {
+  static metrics::Metric* metric = new metrics::Metric(
+      "TensorAllocatorCachedBytes", metrics::MetricFnValue);
+  return metric;
+}
+
+size_t Log2Floor(size_t value) {
+  size_t shift = 0;
+  while (value >>= 1) {
+    ++shift;
+  }
+  return shift;
+}
+
+// Size classes are 256 bytes for the smallest allocations, and then four
+// equally spaced sizes per power of two (2^k * {1.25, 1.5, 1.75, 2}).
+size_t GetSizeClass(size_t num_bytes) {
+  if (num_bytes <= (1 << kMinSizeClassShift)) {
+    return 0;
+  }
+  size_t shift = Log2Floor(num_bytes - 1);
+  size_t base = static_cast<size_t>(1) << shift;
+  size_t step = base / 4;
+  size_t index = (num_bytes - base + step - 1) / step;
+  return 1 + (shift - kMinSizeClassShift) * 4 + (index - 1);
+}
+
+size_t GetSizeClassBytes(size_t size_class) {
+  if (size_class == 0) {
+    return 1 << kMinSizeClassShift;
+  }
+  size_t shift = (size_class - 1) / 4 + kMinSizeClassShift;
+  size_t base = static_cast<size_t>(1) << shift;
+  return base + ((size_class - 1) % 4 + 1) * (base / 4);
+}
+
+void FreeBlock(void* ptr) { std::free(GetHeader(ptr)->base); }
+
+}  // namespace
+
+struct TensorAllocator::FreeList {
+  std::mutex lock;
+  std::vector<void*> blocks;
+};
+
+class TensorAllocator::ThreadCache {
+ public:
+  ~ThreadCache() {
+    destroyed_ = true;
+    TensorAllocator* allocator = TensorAllocator::Get();
+    for (size_t i = 0; i < kNumSizeClasses; ++i) {
+      for (void* ptr : blocks_[i]) {
+        allocator->ReleaseToFreeList(ptr, i);
+      }
+    }
+  }
+
+  // Returns nullptr if the calling thread is exiting, and its cache has
+  // already been destroyed.
+  static ThreadCache* Get() {
+    if (destroyed_) {
+      return nullptr;
+    }
+    thread_local ThreadCache cache;
+    return &cache;
+  }
+
+  void* Pop(size_t size_class) {
+    std::vector<void*>& blocks = blocks_[size_class];
+    if (blocks.empty()) {
+      return nullptr;
+    }
+    void* ptr = blocks.back();
+    blocks.pop_back();
+    return ptr;
+  }
+
+  bool Push(void* ptr, size_t size_class) {
+    std::vector<void*>& blocks = blocks_[size_class];
+    if (blocks.size() >= kMaxThreadCacheBlocks) {
+      return false;
+    }
+    blocks.push_back(ptr);
+    return true;
+  }
+
+ private:
+  // Trivially destructible, so it is still accessible while the thread local
+  // objects are being destroyed.
+  static thread_local bool destroyed_;
+
+  std::vector<void*> blocks_[kNumSizeClasses];
+};
+
+thread_local bool TensorAllocator::ThreadCache::destroyed_ = false;
+
+TensorAllocator* TensorAllocator::Get() {
+  static size_t max_size =
+      sys_util::GetEnvInt("XLA_TENSOR_ALLOCATOR_MAXSIZE", 1000000000);
+  static TensorAllocator* allocator = new TensorAllocator(
+      max_size, affinity::GetNumNumaNodes(), affinity::GetCurrentNumaNode,
+      /*use_thread_cache=*/true);
+  return allocator;
+}
+
+TensorAllocator::TensorAllocator(size_t max_size, int num_numa_nodes,
+                                 std::function<int()> numa_node_fn,
+                                 bool use_thread_cache)
+    : max_size_(max_size),
+      num_numa_nodes_(num_numa_nodes),
+      numa_node_fn_(std::move(numa_node_fn)),
+      use_thread_cache_(use_thread_cache),
+      free_lists_(new FreeList[num_numa_nodes_ * kNumSizeClasses]) {}
+
+TensorAllocator::~TensorAllocator() {
+  for (size_t i = 0; i < num_numa_nodes_ * kNumSizeClasses; ++i) {
+    for (void* ptr : free_lists_[i].blocks) {
+      FreeBlock(ptr);
+    }
+  }
+}
+
+void* TensorAllocator::AllocateRaw(size_t alignment, size_t num_bytes) {
+  int numa_node = GetNumaNode();
+  if (alignment > kAlignment) {
+    // Not the common case, do not bother caching.
+    return NewBlock(alignment, num_bytes, kNoSizeClass, numa_node);
+  }
+  size_t size_class = GetSizeClass(num_bytes);
+  size_t class_size = GetSizeClassBytes(size_class);
+  if (class_size > max_size_) {
+    return NewBlock(kAlignment, num_bytes, kNoSizeClass, numa_node);
+  }
+  void* ptr = nullptr;
+  ThreadCache* cache =
+      use_thread_cache_ && class_size <= kMaxThreadCacheBlockSize
+          ? ThreadCache::Get()
+          : nullptr;
+  if (cache != nullptr) {
+    ptr = cache->Pop(size_class);
+    if (ptr != nullptr && GetHeader(ptr)->numa_node != numa_node) {
+      // The thread moved to another node after caching the block.
+      ReleaseToFreeList(ptr, size_class);
+      ptr = nullptr;
+    }
+  }
+  if (ptr == nullptr) {
+    FreeList* free_list = GetFreeList(numa_node, size_class);
+    std::lock_guard<std::mutex> lock(free_list->lock);
+    if (!free_list->blocks.empty()) {
+      ptr = free_list->blocks.back();
+      free_list->blocks.pop_back();
+    }
+  }
+  if (ptr != nullptr) {
+    size_t cached_size = cached_size_ -= class_size;
+    HitsCounter()->AddValue(1);
+    CachedBytesMetric()->AddSample(cached_size);
+    return ptr;
+  }
+  MissesCounter()->AddValue(1);
+  return NewBlock(kAlignment, class_size, size_class, numa_node);
+}
+
+void TensorAllocator::DeallocateRaw(void* ptr) {
+  if (ptr == nullptr) {
+    return;
+  }
+  const BlockHeader* header = GetHeader(ptr);
+  size_t size_class = header->size_class;
+  if (size_class == kNoSizeClass) {
+    FreeBlock(ptr);
+    return;
+  }
+  size_t class_size = header->num_bytes;
+  size_t cached_size = cached_size_.fetch_add(class_size) + class_size;
+  if (cached_size > max_size_) {
+    cached_size_ -= class_size;
+    TrimsCounter()->AddValue(1);
+    FreeBlock(ptr);
+    return;
+  }
+  CachedBytesMetric()->AddSample(cached_size);
+  // Blocks of other nodes go back to their own node free lists, rather than
+  // being reused from the cache of this thread.
+  ThreadCache* cache = use_thread_cache_ &&
+                               class_size <= kMaxThreadCacheBlockSize &&
+                               header->numa_node == GetNumaNode()
+                           ? ThreadCache::Get()
+                           : nullptr;
+  if (cache == nullptr || !cache->Push(ptr, size_class)) {
+    ReleaseToFreeList(ptr, size_class);
+  }
+}
+
+int TensorAllocator::GetBlockNumaNode(void* ptr) {
+  return GetHeader(ptr)->numa_node;
+}
+
+int TensorAllocator::GetNumaNode() const {
+  return num_numa_nodes_ > 1 ? numa_node_fn_() % num_numa_nodes_ : 0;
+}
+
+TensorAllocator::FreeList* TensorAllocator::GetFreeList(int numa_node,
+                                                        size_t size_class) {
+  return &free_lists_[numa_node * kNumSizeClasses + size_class];
+}
+
+void* TensorAllocator::NewBlock(size_t alignment, size_t num_bytes,
+                                size_t size_class, int numa_node) {
+  // We allocate an extra alignment sized area to store the BlockHeader.
+  static_assert(sizeof(BlockHeader) <= kAlignment, "Header too big");
+  // To call aligned_alloc(), the size must be multiple of the alignment.
+  size_t base_alignment = alignment;
+  size_t alloc_size = alignment + RoundUpToNearest(num_bytes, alignment);
+  if (num_bytes >= kHugePageSize) {
+    base_alignment = kHugePageSize;
+    alloc_size = RoundUpToNearest(alloc_size, kHugePageSize);
+  }
+  void* base = ::aligned_alloc(base_alignment, alloc_size);
+  XLA_CHECK(base != nullptr);
+#if defined(MADV_HUGEPAGE)
+  if (num_bytes >= kHugePageSize) {
+    ::madvise(base, alloc_size, MADV_HUGEPAGE);
+  }
+#endif
+  void* ptr = reinterpret_cast<char*>(base) + alignment;
+  BlockHeader* header = GetHeader(ptr);
+  header->base = base;
+  header->size_class = size_class;
+  header->num_bytes = num_bytes;
+  header->numa_node = numa_node;
+  return ptr;
+}
+
+void TensorAllocator::ReleaseToFreeList(void* ptr, size_t size_class) {
+  FreeList* free_list = GetFreeList(GetHeader(ptr)->numa_node, size_class);
+  std::lock_guard<std::mutex> lock(free_list->lock);
+  free_list->blocks.push_back(ptr);
+}
+
+}  // namespace xla
@@ -0,0 +1,71 @@
+#ifndef TENSORFLOW_COMPILER_XLA_XLA_CLIENT_TENSOR_ALLOCATOR_H_
+#define TENSORFLOW_COMPILER_XLA_XLA_CLIENT_TENSOR_ALLOCATOR_H_
+
+#include <atomic>
+#include <functional>
+#include <memory>
+
+#include "tensorflow/compiler/xla/types.h"
+#include "tensorflow/core/framework/allocator.h"
+
+namespace xla {
+
+// A Tensorflow Allocator which caches Tensor allocations in order to avoid
+// paying the kernel's clear_page_c() price.
+// Allocation sizes are rounded up to size classes (four per power of two), so
+// that blocks can be reused by tensors of slightly different sizes. Freed
+// blocks go into a small per-thread cache first, and then into per size class
+// free lists, each with its own lock. The total size of the cached blocks is
+// bounded by XLA_TENSOR_ALLOCATOR_MAXSIZE, and blocks which do not fit are
+// released right away.
+// On multi-socket hosts, the free lists are per NUMA node. Blocks are tagged
+// with the node of the thread which allocated (and first touched) them, and
+// are only reused by threads running on the same node, including through the
+// per-thread caches.
+class TensorAllocator : public tensorflow::Allocator {
+ public:
+  // The process wide allocator.
+  static TensorAllocator* Get();
+
+  // Creates an allocator caching up to max_size bytes, with free lists for
+  // num_numa_nodes NUMA nodes, where numa_node_fn returns the node of the
+  // calling thread. The per-thread caches are shared by all the instances
+  // using them, so only the process wide allocator does.
+  TensorAllocator(size_t max_size, int num_numa_nodes,
+                  std::function<int()> numa_node_fn, bool use_thread_cache);
+
+  ~TensorAllocator() override;
+
+  string Name() override { return "XLA_TensorAllocator"; }
+
+  void* AllocateRaw(size_t alignment, size_t num_bytes) override;
+
+  void DeallocateRaw(void* ptr) override;
+
+  // The NUMA node the given block, returned by AllocateRaw(), is tagged with.
+  static int GetBlockNumaNode(void* ptr);
+
+ private:
+  struct FreeList;
+  class ThreadCache;
+
+  int GetNumaNode() const;
+
+  FreeList* GetFreeList(int numa_node, size_t size_class);
+
+  void* NewBlock(size_t alignment, size_t num_bytes, size_t size_class,
+                 int numa_node);
+
+  void ReleaseToFreeList(void* ptr, size_t size_class);
+
+  size_t max_size_ = 0;
+  std::atomic<size_t> cached_size_{0};
+  int num_numa_nodes_ = 1;
+  std::function<int()> numa_node_fn_;
+  bool use_thread_cache_ = false;
+  std::unique_ptr<FreeList[]> free_lists_;
+};
+
+}  // namespace xla
+
+#endif  // TENSORFLOW_COMPILER_XLA_XLA_CLIENT_TENSOR_ALLOCATOR_H_
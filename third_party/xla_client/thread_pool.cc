@@ -1,23 +1,53 @@
 #include "tensorflow/compiler/xla/xla_client/thread_pool.h"
 
+#include <algorithm>
+#include <atomic>
 #include <condition_variable>
 #include <deque>
 #include <exception>
 #include <mutex>
+#include <vector>
 
+#include "tensorflow/compiler/xla/types.h"
+#include "tensorflow/compiler/xla/xla_client/affinity.h"
 #include "tensorflow/compiler/xla/xla_client/metrics.h"
+#include "tensorflow/compiler/xla/xla_client/sys_util.h"
 #include "tensorflow/compiler/xla/xla_client/tf_logging.h"
 
 namespace xla {
 namespace env {
 namespace {
 
+const int kNumPriorities = static_cast<int>(Priority::kNormal) + 1;
+
+metrics::Metric* QueueWaitMetric(Priority priority) {
+  static metrics::Metric* metrics[kNumPriorities] = {
+      new metrics::Metric("ThreadPoolHighPriorityQueueWait",
+                          metrics::MetricFnTime),
+      new metrics::Metric("ThreadPoolNormalPriorityQueueWait",
+                          metrics::MetricFnTime)};
+  return metrics[static_cast<int>(priority)];
+}
+
+// A work stealing thread pool. Every worker has its own queues (one per
+// priority class), where the closures scheduled from the worker itself go, and
+// the closures scheduled from outside the pool are spread over the workers.
+// Idle workers pick the high priority closures first, of their own queue and
+// then stealing from the other workers, before falling back to the normal
+// priority ones.
+// If cpus is not empty, the workers (and the overflow threads) are bound to
+// those CPUs.
 class ThreadPool {
  public:
-  explicit ThreadPool(size_t num_threads) {
+  ThreadPool(size_t num_threads, std::vector<int> cpus)
+      : cpus_(std::move(cpus)) {
+    num_threads = std::max<size_t>(num_threads, 1);
+    for (size_t i = 0; i < num_threads; ++i) {
+      queues_.emplace_back(new WorkerQueue());
+    }
     threads_.reserve(num_threads);
     for (size_t i = 0; i < num_threads; ++i) {
-      threads_.emplace_back([this]() { Worker(); });
+      threads_.emplace_back([this, i]() { Worker(i); });
     }
   }
 
@@ -32,7 +62,7 @@ class ThreadPool {
     }
   }
 
-  void Schedule(std::function<void()> closure) {
+  void Schedule(std::function<void()> closure, Priority priority) {
     // If we have more work scheduled than waiting worker threads, just schedule
     // it on a separate thread. This prevents tricky thread-pool-size-deadlocks
     // caused by an undersized thread pool and closures that end up doing sync
@@ -40,22 +70,44 @@ class ThreadPool {
     bool scheduled = false;
     {
       std::lock_guard<std::mutex> lock(mutex_);
-      if (work_.size() < waiting_) {
-        work_.emplace_back(std::move(closure));
+      if (pending_ < waiting_) {
+        ++pending_;
         scheduled = true;
       }
     }
-    if (scheduled) {
-      cv_.notify_one();
-    } else {
+    if (!scheduled) {
       ScheduleOnThread(std::move(closure));
+      return;
     }
+    size_t index = current_pool_ == this
+                       ? current_index_
+                       : next_queue_.fetch_add(1) % queues_.size();
+    WorkerQueue* queue = queues_[index].get();
+    {
+      std::lock_guard<std::mutex> lock(queue->mutex);
+      queue->work[static_cast<int>(priority)].push_back(
+          {std::move(closure), sys_util::NowNs()});
+    }
+    cv_.notify_one();
   }
 
  private:
-  void Worker() {
+  struct WorkItem {
+    std::function<void()> closure;
+    int64 enqueue_ns = 0;
+  };
+
+  struct WorkerQueue {
+    std::mutex mutex;
+    std::deque<WorkItem> work[kNumPriorities];
+  };
+
+  void Worker(size_t index) {
+    affinity::SetThreadCpus(cpus_);
+    current_pool_ = this;
+    current_index_ = index;
     while (true) {
-      std::function<void()> closure = GetWork();
+      std::function<void()> closure = GetWork(index);
       if (closure == nullptr) {
         break;
       }
@@ -70,42 +122,91 @@ class ThreadPool {
   }
 
   void ScheduleOnThread(std::function<void()> closure) {
-    std::thread thread(std::move(closure));
+    std::thread thread([this, closure = std::move(closure)]() {
+      affinity::SetThreadCpus(cpus_);
+      closure();
+    });
     thread.detach();
   }
 
-  std::function<void()> GetWork() {
-    std::unique_lock<std::mutex> lock(mutex_);
-    ++waiting_;
-    cv_.wait(lock, [this] { return exiting_ || !work_.empty(); });
-    --waiting_;
-    if (work_.empty()) {
-      return nullptr;
+  std::function<void()> GetWork(size_t index) {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      ++waiting_;
+      cv_.wait(lock, [this] { return exiting_ || pending_ > 0; });
+      --waiting_;
+      if (pending_ == 0) {
+        return nullptr;
+      }
+      // Claiming a pending item guarantees that one item is (or will shortly
+      // be, as the scheduler pushes it right after accounting it) within the
+      // queues for this worker to take.
+      --pending_;
+    }
+    while (true) {
+      for (int priority = 0; priority < kNumPriorities; ++priority) {
+        std::function<void()> closure = TakeWork(index, priority);
+        if (closure != nullptr) {
+          return closure;
+        }
+      }
+      std::this_thread::yield();
+    }
+  }
+
+  std::function<void()> TakeWork(size_t index, int priority) {
+    for (size_t i = 0; i < queues_.size(); ++i) {
+      WorkerQueue* queue = queues_[(index + i) % queues_.size()].get();
+      std::lock_guard<std::mutex> lock(queue->mutex);
+      std::deque<WorkItem>& work = queue->work[priority];
+      if (!work.empty()) {
+        // The owner takes the oldest closure, while thieves take the newest.
+        WorkItem item;
+        if (i == 0) {
+          item = std::move(work.front());
+          work.pop_front();
+        } else {
+          item = std::move(work.back());
+          work.pop_back();
+        }
+        QueueWaitMetric(static_cast<Priority>(priority))
+            ->AddSample(sys_util::NowNs() - item.enqueue_ns);
+        return std::move(item.closure);
+      }
     }
-    std::function<void()> closure(std::move(work_.front()));
-    work_.pop_front();
-    return closure;
+    return nullptr;
   }
 
+  static thread_local ThreadPool* current_pool_;
+  static thread_local size_t current_index_;
+
+  const std::vector<int> cpus_;
+  std::vector<std::unique_ptr<WorkerQueue>> queues_;
   std::vector<std::thread> threads_;
+  std::atomic<size_t> next_queue_{0};
   std::mutex mutex_;
   std::condition_variable cv_;
   bool exiting_ = false;
-  std::deque<std::function<void()>> work_;
+  size_t pending_ = 0;
   size_t waiting_ = 0;
 };
 
+thread_local ThreadPool* ThreadPool::current_pool_ = nullptr;
+thread_local size_t ThreadPool::current_index_ = 0;
+
 ThreadPool* GetThreadPool() {
   static size_t num_threads = sys_util::GetEnvInt(
       "XLA_THREAD_POOL_SIZE", std::thread::hardware_concurrency());
-  static ThreadPool* pool = new ThreadPool(num_threads);
+  static ThreadPool* pool =
+      new ThreadPool(num_threads, affinity::GetEnvCpus("XLA_THREAD_POOL_CPUS"));
   return pool;
 }
 
 ThreadPool* GetIoThreadPool() {
   static size_t num_threads = sys_util::GetEnvInt(
       "XLA_IO_THREAD_POOL_SIZE", std::thread::hardware_concurrency());
-  static ThreadPool* pool = new ThreadPool(num_threads);
+  static ThreadPool* pool = new ThreadPool(
+      num_threads, affinity::GetEnvCpus("XLA_IO_THREAD_POOL_CPUS"));
   return pool;
 }
 
@@ -155,25 +256,27 @@ Completion::~Completion() {}
 
 void Completion::Wait() { data_->Wait(); }
 
-void ScheduleClosure(std::function<void()> closure) {
-  GetThreadPool()->Schedule(std::move(closure));
+void ScheduleClosure(std::function<void()> closure, Priority priority) {
+  GetThreadPool()->Schedule(std::move(closure), priority);
 }
 
-void ScheduleIoClosure(std::function<void()> closure) {
-  GetIoThreadPool()->Schedule(std::move(closure));
+void ScheduleIoClosure(std::function<void()> closure, Priority priority) {
+  GetIoThreadPool()->Schedule(std::move(closure), priority);
 }
 
-Completion ScheduleClosureWithCompletion(std::function<void()> closure) {
+Completion ScheduleClosureWithCompletion(std::function<void()> closure,
+                                         Priority priority) {
   auto data = std::make_shared<Completion::Data>();
   GetThreadPool()->Schedule(
-      Completion::Data::GetCompleter(data, std::move(closure)));
+      Completion::Data::GetCompleter(data, std::move(closure)), priority);
   return Completion(std::move(data));
 }
 
-Completion ScheduleIoClosureWithCompletion(std::function<void()> closure) {
+Completion ScheduleIoClosureWithCompletion(std::function<void()> closure,
+                                           Priority priority) {
   auto data = std::make_shared<Completion::Data>();
   GetIoThreadPool()->Schedule(
-      Completion::Data::GetCompleter(data, std::move(closure)));
+      Completion::Data::GetCompleter(data, std::move(closure)), priority);
   return Completion(std::move(data));
 }
 
@@ -22,14 +22,27 @@ class Completion {
   std::shared_ptr<Data> data_;
 };
 
+// The priority classes of the scheduled closures. High priority closures are
+// picked by the pool workers before any normal priority one, so latency
+// critical work (like executions and transfers) does not wait behind bulk work
+// (like compilations and large copies).
+enum class Priority {
+  kHigh = 0,
+  kNormal,
+};
+
 // Schedules a closure to be run. The closure should not block waiting for other
 // events.
-void ScheduleClosure(std::function<void()> closure);
-Completion ScheduleClosureWithCompletion(std::function<void()> closure);
+void ScheduleClosure(std::function<void()> closure,
+                     Priority priority = Priority::kNormal);
+Completion ScheduleClosureWithCompletion(std::function<void()> closure,
+                                         Priority priority = Priority::kNormal);
 
 // Schedules a closure which might wait for IO or other events/conditions.
-void ScheduleIoClosure(std::function<void()> closure);
-Completion ScheduleIoClosureWithCompletion(std::function<void()> closure);
+void ScheduleIoClosure(std::function<void()> closure,
+                       Priority priority = Priority::kNormal);
+Completion ScheduleIoClosureWithCompletion(
+    std::function<void()> closure, Priority priority = Priority::kNormal);
 
 }  // namespace env
 }  // namespace xla
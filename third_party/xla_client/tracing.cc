@@ -0,0 +1,128 @@
+#include "tensorflow/compiler/xla/xla_client/tracing.h"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <sstream>
+
+namespace xla {
+namespace tracing {
+namespace {
+
+// The ring buffer slots are protected by a sequence number, which is zero
+// while the slot is being written, and the event index plus one after. Readers
+// drop the slots whose sequence number changed while being read.
+struct Event {
+  std::atomic<uint64> seq{0};
+  std::atomic<const char*> category{nullptr};
+  std::atomic<const char*> name{nullptr};
+  std::atomic<int64> start_ns{0};
+  std::atomic<int64> duration_ns{0};
+  std::atomic<int64> tid{0};
+};
+
+class TraceBuffer {
+ public:
+  static TraceBuffer* Get() {
+    static TraceBuffer* buffer = new TraceBuffer(
+        sys_util::GetEnvInt("XLA_TRACE_BUFFER_SIZE", 128 * 1024));
+    return buffer;
+  }
+
+  void Record(const char* category, const char* name, int64 start_ns,
+              int64 duration_ns) {
+    uint64 index = next_.fetch_add(1, std::memory_order_relaxed);
+    Event& event = events_[index % size_];
+    event.seq.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    event.category.store(category, std::memory_order_relaxed);
+    event.name.store(name, std::memory_order_relaxed);
+    event.start_ns.store(start_ns, std::memory_order_relaxed);
+    event.duration_ns.store(duration_ns, std::memory_order_relaxed);
+    event.tid.store(GetThreadId(), std::memory_order_relaxed);
+    event.seq.store(index + 1, std::memory_order_release);
+  }
+
+  string Dump() const {
+    std::stringstream ss;
+    ss.precision(3);
+    ss << std::fixed << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+    int64 pid = getpid();
+    bool first = true;
+    for (size_t i = 0; i < size_; ++i) {
+      const Event& event = events_[i];
+      uint64 seq = event.seq.load(std::memory_order_acquire);
+      if (seq == 0) {
+        continue;
+      }
+      const char* category = event.category.load(std::memory_order_relaxed);
+      const char* name = event.name.load(std::memory_order_relaxed);
+      int64 start_ns = event.start_ns.load(std::memory_order_relaxed);
+      int64 duration_ns = event.duration_ns.load(std::memory_order_relaxed);
+      int64 tid = event.tid.load(std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (event.seq.load(std::memory_order_relaxed) != seq) {
+        continue;
+      }
+      if (!first) {
+        ss << ",";
+      }
+      first = false;
+      // Chrome trace timestamps are in microseconds.
+      ss << "{\"ph\":\"X\",\"cat\":\"" << category << "\",\"name\":\"" << name
+         << "\",\"pid\":" << pid << ",\"tid\":" << tid
+         << ",\"ts\":" << start_ns / 1000.0
+         << ",\"dur\":" << duration_ns / 1000.0 << "}";
+    }
+    ss << "]}";
+    return ss.str();
+  }
+
+  void Clear() {
+    for (size_t i = 0; i < size_; ++i) {
+      events_[i].seq.store(0, std::memory_order_relaxed);
+    }
+  }
+
+ private:
+  explicit TraceBuffer(size_t size)
+      : size_(std::max<size_t>(size, 1)), events_(new Event[size_]) {}
+
+  // Small sequential IDs are easier to read within the trace viewers than the
+  // std::thread::id hashes.
+  static int64 GetThreadId() {
+    static std::atomic<int64> next_tid(1);
+    static thread_local int64 tid = next_tid++;
+    return tid;
+  }
+
+  size_t size_;
+  std::unique_ptr<Event[]> events_;
+  std::atomic<uint64> next_{0};
+};
+
+std::atomic<bool>* GetEnabledFlag() {
+  static std::atomic<bool>* enabled =
+      new std::atomic<bool>(sys_util::GetEnvBool("XLA_TRACE", false));
+  return enabled;
+}
+
+}  // namespace
+
+bool IsEnabled() { return GetEnabledFlag()->load(std::memory_order_relaxed); }
+
+void SetEnabled(bool enabled) { GetEnabledFlag()->store(enabled); }
+
+void RecordEvent(const char* category, const char* name, int64 start_ns,
+                 int64 duration_ns) {
+  TraceBuffer::Get()->Record(category, name, start_ns, duration_ns);
+}
+
+string DumpChromeTrace() { return TraceBuffer::Get()->Dump(); }
+
+void Clear() { TraceBuffer::Get()->Clear(); }
+
+}  // namespace tracing
+}  // namespace xla
@@ -0,0 +1,65 @@
+#ifndef TENSORFLOW_COMPILER_XLA_RPC_TRACING_H_
+#define TENSORFLOW_COMPILER_XLA_RPC_TRACING_H_
+
+#include "tensorflow/compiler/xla/types.h"
+#include "tensorflow/compiler/xla/xla_client/sys_util.h"
+
+namespace xla {
+namespace tracing {
+
+// Tracing records timed events (with the ID of the thread generating them)
+// into a fixed size ring buffer, which can be dumped in the Chrome trace event
+// format, to be loaded by chrome://tracing or Perfetto. Recording is lock free,
+// and when the buffer wraps around the oldest events are overwritten.
+// The category and name strings are not copied, so they must outlive the
+// tracing (string literals, or the names of static objects).
+// Tracing is enabled at startup with XLA_TRACE=1, or with SetEnabled(). The
+// ring buffer holds XLA_TRACE_BUFFER_SIZE events.
+
+bool IsEnabled();
+
+void SetEnabled(bool enabled);
+
+// Records an event which started at start_ns (EPOCH nanoseconds, as returned by
+// sys_util::NowNs()) and lasted duration_ns.
+void RecordEvent(const char* category, const char* name, int64 start_ns,
+                 int64 duration_ns);
+
+// Returns the events currently held by the ring buffer, as Chrome trace event
+// format JSON.
+string DumpChromeTrace();
+
+// Drops all the recorded events.
+void Clear();
+
+// Scope based utility class to trace the time the code takes within a given
+// C++ scope. When tracing is disabled, the only cost is checking it.
+class TraceScope {
+ public:
+  TraceScope(const char* category, const char* name)
+      : category_(category),
+        name_(name),
+        start_ns_(IsEnabled() ? sys_util::NowNs() : 0) {}
+
+  ~TraceScope() {
+    if (start_ns_ != 0) {
+      RecordEvent(category_, name_, start_ns_, sys_util::NowNs() - start_ns_);
+    }
+  }
+
+ private:
+  const char* category_;
+  const char* name_;
+  int64 start_ns_;
+};
+
+#define XLA_TRACE_SCOPE(category, name) \
+  ::xla::tracing::TraceScope __trace_scope(category, name)
+
+// Traces the enclosing function, using its name.
+#define XLA_FN_TRACE(category) XLA_TRACE_SCOPE(category, __FUNCTION__)
+
+}  // namespace tracing
+}  // namespace xla
+
+#endif  // TENSORFLOW_COMPILER_XLA_RPC_TRACING_H_
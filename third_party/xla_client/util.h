@@ -8,10 +8,12 @@
 #include <numeric>
 #include <set>
 #include <type_traits>
+#include <utility>
 #include <vector>
 
 #include "absl/types/optional.h"
 #include "tensorflow/compiler/xla/status.h"
+#include "tensorflow/compiler/xla/types.h"
 #include "tensorflow/core/lib/core/errors.h"
 #include "tensorflow/core/lib/gtl/array_slice.h"
 #include "tensorflow/core/lib/hash/hash.h"
@@ -173,9 +175,77 @@ T Multiply(const S& input) {
                          std::multiplies<T>());
 }
 
+static inline uint64 HashMix(uint64 a, uint64 b) {
+  unsigned __int128 r = static_cast<unsigned __int128>(a) * b;
+  return static_cast<uint64>(r) ^ static_cast<uint64>(r >> 64);
+}
+
+static inline uint64 HashRead64(const uint8* data) {
+  uint64 value;
+  std::memcpy(&value, data, sizeof(value));
+  return value;
+}
+
+static inline uint64 HashRead32(const uint8* data) {
+  uint32 value;
+  std::memcpy(&value, data, sizeof(value));
+  return value;
+}
+
+// A non cryptographic 64 bit hash (of the wyhash family), built on 64x64->128
+// bit multiplications. The long inputs are consumed 48 bytes at a time, over
+// three independent lanes, and the short inputs (like the ones of the Hash()
+// of arithmetic values) take a couple of multiplications, inlined.
+static inline uint64 FastHash64(const void* data, size_t size, uint64 seed) {
+  static const uint64 kSecret0 = 0xa0761d6478bd642f;
+  static const uint64 kSecret1 = 0xe7037ed1a0b428db;
+  static const uint64 kSecret2 = 0x8ebc6af09c88c6e3;
+  static const uint64 kSecret3 = 0x589965cc75374cc3;
+  const uint8* ptr = static_cast<const uint8*>(data);
+  seed ^= HashMix(seed ^ kSecret0, kSecret1);
+  uint64 a = 0;
+  uint64 b = 0;
+  if (size <= 16) {
+    if (size >= 4) {
+      size_t skew = (size >> 3) << 2;
+      a = (HashRead32(ptr) << 32) | HashRead32(ptr + skew);
+      b = (HashRead32(ptr + size - 4) << 32) |
+          HashRead32(ptr + size - 4 - skew);
+    } else if (size > 0) {
+      a = (static_cast<uint64>(ptr[0]) << 16) |
+          (static_cast<uint64>(ptr[size >> 1]) << 8) | ptr[size - 1];
+    }
+  } else {
+    size_t left = size;
+    if (left > 48) {
+      uint64 seed1 = seed;
+      uint64 seed2 = seed;
+      do {
+        seed = HashMix(HashRead64(ptr) ^ kSecret1, HashRead64(ptr + 8) ^ seed);
+        seed1 = HashMix(HashRead64(ptr + 16) ^ kSecret2,
+                        HashRead64(ptr + 24) ^ seed1);
+        seed2 = HashMix(HashRead64(ptr + 32) ^ kSecret3,
+                        HashRead64(ptr + 40) ^ seed2);
+        ptr += 48;
+        left -= 48;
+      } while (left > 48);
+      seed ^= seed1 ^ seed2;
+    }
+    for (; left > 16; left -= 16, ptr += 16) {
+      seed = HashMix(HashRead64(ptr) ^ kSecret1, HashRead64(ptr + 8) ^ seed);
+    }
+    // The last 16 bytes, which can overlap the ones already consumed.
+    a = HashRead64(ptr + left - 16);
+    b = HashRead64(ptr + left - 8);
+  }
+  unsigned __int128 r = static_cast<unsigned __int128>(a ^ kSecret1) *
+                        (b ^ seed);
+  return HashMix(static_cast<uint64>(r) ^ kSecret0 ^ size,
+                 static_cast<uint64>(r >> 64) ^ kSecret1);
+}
+
 static inline size_t DataHash(const void* data, size_t size) {
-  return tensorflow::Hash64(reinterpret_cast<const char*>(data), size,
-                            0x5a2d296e9);
+  return FastHash64(data, size, 0x5a2d296e9);
 }
 
 static inline size_t StringHash(const char* data) {
@@ -196,6 +266,11 @@ static inline size_t Hash(const std::string& value) {
   return DataHash(value.data(), value.size());
 }
 
+template <typename T1, typename T2>
+size_t Hash(const std::pair<T1, T2>& value) {
+  return HashCombine(Hash(value.first), Hash(value.second));
+}
+
 // Forward declare to allow hashes of vectors of vectors to work.
 template <typename T>
 size_t ContainerHash(const T& values);
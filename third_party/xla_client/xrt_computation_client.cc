@@ -1,24 +1,39 @@
 #include "tensorflow/compiler/xla/xla_client/xrt_computation_client.h"
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <cstdlib>
+#include <cstring>
 #include <functional>
 #include <list>
+#include <set>
 #include <sstream>
 #include <unordered_map>
+#include <utility>
 
 #include "absl/memory/memory.h"
 #include "absl/strings/str_cat.h"
 #include "tensorflow/cc/ops/const_op.h"
+#include "tensorflow/compiler/xla/client/xla_builder.h"
+#include "tensorflow/compiler/xla/layout_util.h"
+#include "tensorflow/compiler/xla/primitive_util.h"
 #include "tensorflow/compiler/xla/shape_util.h"
 #include "tensorflow/compiler/xla/util.h"
+#include "tensorflow/compiler/xla/xla_client/affinity.h"
 #include "tensorflow/compiler/xla/xla_client/multi_wait.h"
 #include "tensorflow/compiler/xla/xla_client/sys_util.h"
+#include "tensorflow/compiler/xla/xla_client/tensor_allocator.h"
 #include "tensorflow/compiler/xla/xla_client/thread_pool.h"
+#include "tensorflow/compiler/xla/xla_client/tracing.h"
 #include "tensorflow/compiler/xla/xla_client/unique.h"
 #include "tensorflow/compiler/xla/xla_client/util.h"
 #include "tensorflow/compiler/xla/xla_client/xla_util.h"
 #include "tensorflow/compiler/xla/xla_client/xrt_local_service.h"
+#include "tensorflow/core/framework/allocation_description.pb.h"
 #include "tensorflow/core/framework/allocator.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/platform/protobuf.h"
 #include "tensorflow/core/util/device_name_utils.h"
 
 namespace xla {
@@ -26,129 +41,74 @@ namespace {
 
 thread_local std::vector<string> g_replication_devices;
 
-// A simple Tensorflow Allocator which caches Tensor allocations in order to
-// avoid paying the kernel's clear_page_c() price.
-class TensorAllocator : public tensorflow::Allocator {
-  struct AllocKey {
-    struct Hash {
-      size_t operator()(const AllocKey& hk) const {
-        return util::HashCombine(hk.alignment, hk.num_bytes);
-      }
-    };
-
-    bool operator==(const AllocKey& rhs) const {
-      return num_bytes == rhs.num_bytes && alignment == rhs.alignment;
-    }
-
-    size_t alignment = 0;
-    size_t num_bytes = 0;
-  };
-
-  struct AllocBlocks {
-    AllocBlocks(const AllocKey& alloc_key) : alloc_key(alloc_key) {}
-
-    AllocKey alloc_key;
-    std::vector<void*> blocks;
-  };
-
-  using AllocList = std::list<AllocBlocks>;
-
+// A TensorBuffer wrapping memory owned by the caller, which is kept alive by
+// holding a reference to its owner object.
+class ExternalTensorBuffer : public tensorflow::TensorBuffer {
  public:
-  static TensorAllocator* Get() {
-    static size_t max_size =
-        sys_util::GetEnvInt("XLA_TENSOR_ALLOCATOR_MAXSIZE", 1000000000);
-    static TensorAllocator* allocator = new TensorAllocator(max_size);
-    return allocator;
-  }
+  ExternalTensorBuffer(const void* data, size_t size,
+                       std::shared_ptr<void> owner)
+      : tensorflow::TensorBuffer(const_cast<void*>(data)),
+        size_(size),
+        owner_(std::move(owner)) {}
 
-  string Name() override { return "XLA_TensorAllocator"; }
+  size_t size() const override { return size_; }
 
-  void* AllocateRaw(size_t alignment, size_t num_bytes) override {
-    // We use an alignment-sized area before the memory returned to the caller,
-    // to store a pointer to its AllocBlocks.
-    alignment = std::max<size_t>(alignment, sizeof(void*));
-    // To call aligned_alloc(), num_bytes must be multiple of alignment.
-    num_bytes = RoundUpToNearest(num_bytes, alignment);
+  tensorflow::TensorBuffer* root_buffer() override { return this; }
 
-    AllocKey alloc_key = {alignment, num_bytes};
-    void* block = nullptr;
-    AllocBlocks* alloc_blocks = nullptr;
-    std::lock_guard<std::mutex> lock(lock_);
-    auto it = allocs_.find(alloc_key);
-    if (it != allocs_.end()) {
-      alloc_blocks = &*it->second;
-      if (!alloc_blocks->blocks.empty()) {
-        block = alloc_blocks->blocks.back();
-        alloc_blocks->blocks.pop_back();
-      }
-      // LRU
-      alloc_list_.splice(alloc_list_.begin(), alloc_list_, it->second);
-    } else {
-      allocs_.emplace(alloc_key,
-                      alloc_list_.insert(alloc_list_.begin(), alloc_key));
-      alloc_blocks = &alloc_list_.front();
-    }
-    if (block == nullptr) {
-      TrimCache(alloc_key.num_bytes);
-      block = NewBlock(alloc_blocks);
-    }
-    return block;
+  void FillAllocationDescription(
+      tensorflow::AllocationDescription* proto) const override {
+    proto->set_requested_bytes(size_);
+    proto->set_allocator_name("XLA_ExternalTensorBuffer");
   }
 
-  void DeallocateRaw(void* ptr) override {
-    if (ptr != nullptr) {
-      // The pointer to AllocBlocks is right before the user memory.
-      AllocBlocks* alloc_blocks = reinterpret_cast<AllocBlocks**>(ptr)[-1];
-      std::lock_guard<std::mutex> lock(lock_);
-      if (alloc_blocks->alloc_key.num_bytes < max_size_) {
-        alloc_blocks->blocks.push_back(ptr);
-      } else {
-        // We do not cache blocks whose size is bigger than the max cache size.
-        FreeBlock(ptr, alloc_blocks);
-      }
-    }
-  }
+  bool OwnsMemory() const override { return false; }
 
  private:
-  explicit TensorAllocator(size_t max_size) : max_size_(max_size) {}
-
-  void* NewBlock(AllocBlocks* alloc_blocks) {
-    // We allocate an extra alignment sized area to store the AllocBlocks
-    // pointer.
-    void* ptr = ::aligned_alloc(
-        alloc_blocks->alloc_key.alignment,
-        alloc_blocks->alloc_key.alignment + alloc_blocks->alloc_key.num_bytes);
-    XLA_CHECK(ptr != nullptr);
-    ptr = reinterpret_cast<char*>(ptr) + alloc_blocks->alloc_key.alignment;
-    // Store the pointer to AllocBlocks right before the user memory.
-    reinterpret_cast<AllocBlocks**>(ptr)[-1] = alloc_blocks;
-    size_ += alloc_blocks->alloc_key.num_bytes;
-    return ptr;
-  }
-
-  void FreeBlock(void* ptr, AllocBlocks* alloc_blocks) {
-    size_ -= alloc_blocks->alloc_key.num_bytes;
-    std::free(reinterpret_cast<char*>(ptr) - alloc_blocks->alloc_key.alignment);
-  }
-
-  void TrimCache(size_t num_bytes) {
-    auto it = alloc_list_.rbegin();
-    for (; size_ + num_bytes > max_size_ && it != alloc_list_.rend(); ++it) {
-      AllocBlocks* alloc_blocks = &*it;
-      while (!alloc_blocks->blocks.empty() && size_ + num_bytes > max_size_) {
-        FreeBlock(alloc_blocks->blocks.back(), alloc_blocks);
-        alloc_blocks->blocks.pop_back();
-      }
-    }
-  }
-
-  size_t max_size_ = 0;
-  std::mutex lock_;
   size_t size_ = 0;
-  AllocList alloc_list_;
-  std::unordered_map<AllocKey, AllocList::iterator, AllocKey::Hash> allocs_;
+  std::shared_ptr<void> owner_;
 };
 
+template <typename T>
+std::pair<const void*, size_t> RepeatedFieldData(
+    const tensorflow::protobuf::RepeatedField<T>& field) {
+  return std::make_pair(static_cast<const void*>(field.data()),
+                        field.size() * sizeof(T));
+}
+
+std::pair<const void*, size_t> BytesFieldData(const string& field) {
+  return std::make_pair(static_cast<const void*>(field.data()), field.size());
+}
+
+// Returns the dense array data stored within a LiteralProto, if its memory
+// representation matches the one of the equivalent Literal (little endian
+// host assumed). Returns a nullptr data pointer otherwise.
+std::pair<const void*, size_t> GetLiteralProtoData(const LiteralProto& proto) {
+  switch (proto.shape().element_type()) {
+    case PRED:
+      return RepeatedFieldData(proto.preds());
+    case S8:
+      return BytesFieldData(proto.s8s());
+    case U8:
+      return BytesFieldData(proto.u8s());
+    case BF16:
+      return BytesFieldData(proto.bf16s());
+    case S32:
+      return RepeatedFieldData(proto.s32s());
+    case U32:
+      return RepeatedFieldData(proto.u32s());
+    case S64:
+      return RepeatedFieldData(proto.s64s());
+    case U64:
+      return RepeatedFieldData(proto.u64s());
+    case F32:
+      return RepeatedFieldData(proto.f32s());
+    case F64:
+      return RepeatedFieldData(proto.f64s());
+    default:
+      return std::pair<const void*, size_t>(nullptr, 0);
+  }
+}
+
 string StripPrefix(const string& value, const string& prefix) {
   return value.find(prefix) == 0 ? value.substr(prefix.size()) : value;
 }
@@ -164,12 +124,38 @@ tensorflow::DeviceNameUtils::ParsedName ParseFullXrtDevice(
   return parsed_device;
 }
 
+// Turns a flat (rank 1) operation holding the elements of a tensor in
+// physical order, into one with the given shape and its layout.
+XlaOp MakeFromPhysicalElements(const XlaOp& flat, const Shape& shape) {
+  Shape physical_shape =
+      ShapeUtil::MakeShapeWithDescendingLayoutAndSamePhysicalLayout(shape);
+  XlaOp physical_result = Reshape(flat, physical_shape.dimensions());
+  int64 rank = shape.rank();
+  std::vector<int64> permutation(rank);
+  for (int64 i = 0; i < rank; ++i) {
+    permutation[shape.layout().minor_to_major(rank - 1 - i)] = i;
+  }
+  return Transpose(physical_result, permutation);
+}
+
 }  // namespace
 
 void XrtComputationClient::XrtData::Assign(const Data& data) {
   const XrtData& xrt_data = dynamic_cast<const XrtData&>(data);
   if (&xrt_data != this) {
     handle_ptr = xrt_data.handle_ptr;
+    if (memory_category && handle_ptr != nullptr) {
+      MemoryTracker::Get()->SetCategory(handle_ptr.get(), *memory_category);
+    }
+  }
+  NotifyValue(handle_ptr != nullptr);
+}
+
+void XrtComputationClient::XrtData::SetMemoryCategory(
+    MemoryTracker::Category category) {
+  memory_category = category;
+  if (handle_ptr != nullptr) {
+    MemoryTracker::Get()->SetCategory(handle_ptr.get(), category);
   }
 }
 
@@ -177,12 +163,33 @@ XrtComputationClient::XrtComputationClient(
     Options options,
     std::unique_ptr<tensorflow::tpu::TopologyProto> topology_proto)
     : options_(std::move(options)),
-      compilation_cache_(sys_util::GetEnvInt("XLA_COMPILATION_CACHE_SIZE", 64)),
-      rng_seed_(0x5a2d296e9) {
+      compilation_cache_(GetCompilationCacheMaxSize(),
+                         GetCompilationCacheSizeFn()),
+      rng_seed_(0x5a2d296e9),
+      chained_exec_stats_(
+          sys_util::GetEnvInt("XRT_CHAINED_EXEC_AUTO_CACHE_SIZE", 1024)) {
+  string persistent_cache_path =
+      sys_util::GetEnvString("XLA_PERSISTENT_CACHE_PATH", "");
+  if (!persistent_cache_path.empty()) {
+    TF_LOG(INFO) << "Using persistent compilation cache at "
+                 << persistent_cache_path;
+    persistent_cache_ =
+        absl::make_unique<util::PersistentCache>(persistent_cache_path);
+  }
   tensorflow::ConfigProto config = CreateConfigProto(options_);
+  tensorflow::ConfigProto compressed_config(config);
+  bool compression = SetGrpcCompression(&compressed_config);
+  if (compression && GetCompressionMinBytes() <= 0) {
+    config = compressed_config;
+  } else if (compression) {
+    compressed_session_cache_ =
+        absl::make_unique<XrtSessionCache>(compressed_config, nullptr);
+  }
   session_cache_ = absl::make_unique<XrtSessionCache>(
       config, [this](XrtSession* s) { InitSession(s); });
   alloc_session_cache_ = absl::make_unique<XrtSessionCache>(config, nullptr);
+  release_session_cache_ =
+      absl::make_unique<XrtSessionCache>(config, nullptr);
 
   auto default_device_target =
       options_.global_device_map.find(options_.default_device);
@@ -206,10 +213,69 @@ XrtComputationClient::XrtComputationClient(
   }
   TF_LOG(INFO) << "XRT default device: " << options_.default_device;
   MaybeCreateLocalService(options_);
+  // The sessions do not depend on the TPU configuration, so the ones of the
+  // default device worker are created while the (blocking) TPU topology fetch
+  // and mesh service setup are in flight. The other workers only get their
+  // sessions prewarmed in background, as the session caches create them on
+  // first use anyway.
+  env::Completion prewarm = env::ScheduleIoClosureWithCompletion(
+      [this]() { PrewarmSessions(/*default_worker=*/true); });
   InitializeDevices(std::move(topology_proto));
+  prewarm.Wait();
+  env::ScheduleIoClosure(
+      [this]() { PrewarmSessions(/*default_worker=*/false); });
   StartHandleReleaser();
 }
 
+void XrtComputationClient::PrewarmSessions(bool default_worker) {
+  static const int64 prewarm_count =
+      sys_util::GetEnvInt("XRT_PREWARM_SESSIONS", 1);
+  if (prewarm_count <= 0) {
+    return;
+  }
+  metrics::TimedSection timed(PrewarmSessionsMetric());
+  string default_target =
+      GetWorkerForXrtDevice(TorchDeviceToXrtDevice(options_.default_device))
+          .second;
+  std::set<string> targets;
+  for (auto& device : options_.devices) {
+    string target =
+        GetWorkerForXrtDevice(TorchDeviceToXrtDevice(device)).second;
+    if ((target == default_target) == default_worker) {
+      targets.insert(std::move(target));
+    }
+  }
+  if (targets.empty()) {
+    return;
+  }
+  std::vector<string> targets_vector(targets.begin(), targets.end());
+  // The compile/execute sessions carry the XRT op graphs built by
+  // InitSession(), which are the expensive part to prepare.
+  session_cache_->Prewarm(targets_vector, prewarm_count);
+  alloc_session_cache_->Prewarm(targets_vector, prewarm_count);
+}
+
+size_t XrtComputationClient::GetCompilationCacheMaxSize() {
+  int64 max_bytes = sys_util::GetEnvInt("XLA_COMPILATION_CACHE_BYTES", 0);
+  return max_bytes > 0
+             ? max_bytes
+             : sys_util::GetEnvInt("XLA_COMPILATION_CACHE_SIZE", 64);
+}
+
+XrtComputationClient::CompilationCache::SizeFn
+XrtComputationClient::GetCompilationCacheSizeFn() {
+  // When a bytes limit is specified, the cache is accounted by the size of the
+  // serialized computations, using the same limit of the upper level
+  // computation caches, so that they do not thrash each other with different
+  // eviction patterns.
+  if (sys_util::GetEnvInt("XLA_COMPILATION_CACHE_BYTES", 0) <= 0) {
+    return nullptr;
+  }
+  return [](const CompilationCacheKey& key, const Computation& computation) {
+    return key.serialized_computation.size();
+  };
+}
+
 ComputationClient::DataPtr XrtComputationClient::CreateDataPlaceholder(
     string device, Shape shape) {
   return std::make_shared<XrtData>(this, std::move(device), std::move(shape));
@@ -219,27 +285,61 @@ std::vector<ComputationClient::DataPtr> XrtComputationClient::TransferToServer(
     tensorflow::gtl::ArraySlice<const TensorSource> tensors) {
   metrics::TimedSection timed(TransferToServerMetric());
 
+  static const int64 chunk_bytes =
+      sys_util::GetEnvInt("XLA_TRANSFER_CHUNK_BYTES", 0);
+  static const int64 pack_bytes =
+      sys_util::GetEnvInt("XLA_TRANSFER_PACK_MAX_BYTES", 0);
+  // Coalesced transfers upload all the small tensors of a device within one
+  // tuple allocation, whatever their element type is.
+  static const bool coalesce =
+      sys_util::GetEnvBool("XLA_TRANSFER_COALESCE", false);
+  std::vector<size_t> direct_indices;
+  std::vector<size_t> chunked_indices;
+  std::map<std::pair<string, PrimitiveType>, std::vector<size_t>>
+      packed_groups;
+  for (size_t i = 0; i < tensors.size(); ++i) {
+    int64 size = ShapeUtil::ByteSizeOf(tensors[i].shape);
+    if (chunk_bytes > 0 && size > chunk_bytes) {
+      chunked_indices.push_back(i);
+    } else if (pack_bytes > 0 && size <= pack_bytes) {
+      PrimitiveType group_type = coalesce ? PRIMITIVE_TYPE_INVALID
+                                          : tensors[i].shape.element_type();
+      packed_groups[std::make_pair(GetEffectiveDevice(tensors[i].device),
+                                   group_type)]
+          .push_back(i);
+    } else {
+      direct_indices.push_back(i);
+    }
+  }
+  for (auto it = packed_groups.begin(); it != packed_groups.end();) {
+    // Packing a single tensor would only add an execution.
+    if (it->second.size() < 2) {
+      direct_indices.push_back(it->second.front());
+      it = packed_groups.erase(it);
+    } else {
+      ++it;
+    }
+  }
+
   std::mutex lock;
-  XrtSessionCache::SessionMap session_map;
+  // The session maps are keyed by target, so each session cache needs its
+  // own.
+  std::map<XrtSessionCache*, XrtSessionCache::SessionMap> session_maps;
   int64 total_size = 0;
-  util::MultiWait mwait(tensors.size());
+  util::MultiWait mwait(direct_indices.size());
   std::map<XrtSession*, SessionWork> session_work_map;
-  for (size_t i = 0; i < tensors.size(); ++i) {
+  for (auto i : direct_indices) {
     auto converter = [&, i]() {
       string device = GetEffectiveDevice(tensors[i].device);
       const string& xrt_device = TorchDeviceToXrtDevice(device);
-      tensorflow::Tensor tensor(
-          TensorAllocator::Get(),
-          XlaTypeToDataType(tensors[i].shape.element_type()),
-          MakeEquivalentTensorShape(tensors[i].shape));
+      tensorflow::Tensor tensor = MakeSourceTensor(tensors[i], device);
       auto tdata = tensor.tensor_data();
-      tensors[i].populate_fn(tensors[i], const_cast<char*>(tdata.data()),
-                             tdata.size());
 
       {
         std::lock_guard<std::mutex> slock(lock);
-        XrtSession* session = GetSessionForXrtDevice(alloc_session_cache_.get(),
-                                                     xrt_device, &session_map);
+        XrtSessionCache* cache = GetTransferSessionCache(tensors[i].shape);
+        XrtSession* session =
+            GetSessionForXrtDevice(cache, xrt_device, &session_maps[cache]);
         SessionWork* session_work = &session_work_map[session];
         tensorflow::Scope device_scope =
             session->root()->WithDevice(xrt_device);
@@ -261,7 +361,7 @@ std::vector<ComputationClient::DataPtr> XrtComputationClient::TransferToServer(
   std::vector<DataPtr> results(tensors.size());
   for (auto& session_work : session_work_map) {
     std::vector<tensorflow::Tensor> outputs;
-    XLA_CHECK_OK(session_work.first->session()->Run(
+    XLA_CHECK_OK(session_work.first->Run(
         session_work.second.feed_inputs, session_work.second.outputs_handles,
         &outputs));
     XLA_CHECK_EQ(outputs.size(), session_work.second.outputs_handles.size());
@@ -274,19 +374,220 @@ std::vector<ComputationClient::DataPtr> XrtComputationClient::TransferToServer(
     }
     CreateDataHandlesCounter()->AddValue(outputs.size());
   }
+  for (auto i : chunked_indices) {
+    results[i] = TransferToServerChunked(tensors[i], chunk_bytes);
+  }
+  for (auto& device_indices : packed_groups) {
+    std::vector<DataPtr> packed_results =
+        coalesce ? TransferToServerCoalesced(tensors, device_indices.second)
+                 : TransferToServerPacked(tensors, device_indices.second);
+    for (size_t i = 0; i < packed_results.size(); ++i) {
+      results[device_indices.second[i]] = std::move(packed_results[i]);
+    }
+  }
+  for (auto& data : results) {
+    data->SetMemoryCategory(MemoryTracker::Category::kInput);
+  }
   return results;
 }
 
-std::vector<Literal> XrtComputationClient::TransferFromServer(
-    tensorflow::gtl::ArraySlice<const DataPtr> handles) {
-  metrics::TimedSection timed(TransferFromServerMetric());
+ComputationClient::DataPtr XrtComputationClient::TransferToServerChunked(
+    const TensorSource& source, int64 chunk_bytes) {
+  XLA_COUNTER("ChunkedTransferToServer", 1);
+
+  string device = GetEffectiveDevice(source.device);
+  const string& xrt_device = TorchDeviceToXrtDevice(device);
+  tensorflow::Tensor tensor = MakeSourceTensor(source, device);
+  int64 num_elements = ShapeUtil::ElementsIn(source.shape);
+  tensorflow::Tensor flat_tensor;
+  XLA_CHECK(
+      flat_tensor.CopyFrom(tensor, tensorflow::TensorShape({num_elements})));
+  // The chunks share the source tensor buffer, so keep their boundaries
+  // aligned.
+  int64 element_size =
+      ShapeUtil::ByteSizeOfPrimitiveType(source.shape.element_type());
+  int64 chunk_elements =
+      RoundUpToNearest<int64>(std::max<int64>(chunk_bytes / element_size, 1),
+                              tensorflow::Allocator::kAllocatorAlignment);
+  int64 num_chunks = CeilOfRatio(num_elements, chunk_elements);
+
+  // Chunks are uploaded in parallel, each one as a separate session run, so
+  // that the serialization of a chunk overlaps with the transfer of others.
+  std::vector<DataPtr> chunks_data(num_chunks);
+  std::vector<Shape> chunks_shapes(num_chunks);
+  util::MultiWait mwait(num_chunks);
+  for (int64 i = 0; i < num_chunks; ++i) {
+    int64 base = i * chunk_elements;
+    int64 size = std::min(chunk_elements, num_elements - base);
+    chunks_shapes[i] = ShapeUtil::MakeShapeWithDescendingLayout(
+        source.shape.element_type(), {size});
+    auto uploader = [&, i, base, size]() {
+      tensorflow::Tensor chunk = flat_tensor.Slice(base, base + size);
+      XrtSessionCache::SessionMap session_map;
+      XrtSession* session =
+          GetSessionForXrtDevice(GetTransferSessionCache(chunks_shapes[i]),
+                                 xrt_device, &session_map);
+      tensorflow::Scope device_scope = session->root()->WithDevice(xrt_device);
+      const XrtSession::CachedNode& cached_node =
+          GetAllocateNode(session, device_scope, device, chunks_shapes[i]);
+      tensorflow::ClientSession::FeedType feed_inputs;
+      feed_inputs.insert({cached_node.holders[0], chunk});
+      std::vector<tensorflow::Tensor> outputs;
+      XLA_CHECK_OK(
+          session->Run(feed_inputs, {cached_node.outputs[0]}, &outputs));
+      XLA_CHECK_EQ(outputs.size(), 1);
+      chunks_data[i] = std::make_shared<XrtData>(
+          this, device, chunks_shapes[i], outputs[0].scalar<int64>()());
+      OutboundDataMetric()->AddSample(chunk.tensor_data().size());
+      CreateDataHandlesCounter()->AddValue(1);
+    };
+    env::ScheduleIoClosure(mwait.Completer(std::move(uploader)),
+                           env::Priority::kHigh);
+  }
+  mwait.Wait();
+
+  // Put the chunks back together on the device, with a computation which
+  // concatenates them, and produces the result with the source layout.
+  XlaBuilder builder("ChunkedTransfer");
+  std::vector<XlaOp> chunks_ops;
+  for (int64 i = 0; i < num_chunks; ++i) {
+    chunks_ops.push_back(Parameter(&builder, i, chunks_shapes[i],
+                                   absl::StrCat("chunk", i)));
+  }
+  XlaOp flat_result = ConcatInDim(&builder, chunks_ops, 0);
+  MakeFromPhysicalElements(flat_result, source.shape);
+
+  std::vector<CompileInstance> instances;
+  instances.emplace_back(ConsumeValue(builder.Build()), device,
+                         std::vector<string>({device}), &source.shape);
+  std::vector<ComputationPtr> computations = Compile(std::move(instances));
+  std::vector<DataPtr> results =
+      ExecuteComputation(*computations.front(), chunks_data, device,
+                         ExecuteComputationOptions());
+  XLA_CHECK_EQ(results.size(), 1);
+  return std::move(results.front());
+}
+
+std::vector<ComputationClient::DataPtr>
+XrtComputationClient::TransferToServerPacked(
+    tensorflow::gtl::ArraySlice<const TensorSource> tensors,
+    tensorflow::gtl::ArraySlice<const size_t> indices) {
+  XLA_COUNTER("PackedTransferToServer", 1);
+  XLA_COUNTER("PackedTransferToServerTensors", indices.size());
+
+  const TensorSource& first_source = tensors[indices.front()];
+  PrimitiveType type = first_source.shape.element_type();
+  string device = GetEffectiveDevice(first_source.device);
+  int64 element_size = ShapeUtil::ByteSizeOfPrimitiveType(type);
+  std::vector<int64> offsets;
+  int64 num_elements = 0;
+  for (auto i : indices) {
+    offsets.push_back(num_elements);
+    num_elements += ShapeUtil::ElementsIn(tensors[i].shape);
+  }
+  // All the tensors are laid out back to back, in physical order, within a
+  // single flat buffer which is uploaded with a single allocation.
+  auto populate_fn = [&](const TensorSource& source, void* dest_buffer,
+                         size_t dest_buffer_size) {
+    char* dest = static_cast<char*>(dest_buffer);
+    for (size_t i = 0; i < indices.size(); ++i) {
+      const TensorSource& tensor_source = tensors[indices[i]];
+      size_t size = ShapeUtil::ByteSizeOfElements(tensor_source.shape);
+      char* tensor_dest = dest + offsets[i] * element_size;
+      XLA_CHECK_LE(offsets[i] * element_size + size, dest_buffer_size);
+      if (tensor_source.data != nullptr) {
+        std::memcpy(tensor_dest, tensor_source.data, size);
+      } else {
+        tensor_source.populate_fn(tensor_source, tensor_dest, size);
+      }
+    }
+  };
+  TensorSource packed_source(
+      ShapeUtil::MakeShapeWithDescendingLayout(type, {num_elements}), device,
+      std::move(populate_fn));
+  // A single tensor is never packed, so this does not recurse further.
+  std::vector<DataPtr> packed_data = TransferToServer({packed_source});
+
+  // Slice the tensors out of the packed buffer on the device, each one with
+  // its own shape and layout.
+  XlaBuilder builder("PackedTransfer");
+  XlaOp packed_op = Parameter(&builder, 0, packed_source.shape, "packed");
+  std::vector<XlaOp> tensors_ops;
+  std::vector<Shape> tensors_shapes;
+  for (size_t i = 0; i < indices.size(); ++i) {
+    const Shape& shape = tensors[indices[i]].shape;
+    XlaOp flat_op =
+        SliceInDim(packed_op, offsets[i],
+                   offsets[i] + ShapeUtil::ElementsIn(shape), 1, 0);
+    tensors_ops.push_back(MakeFromPhysicalElements(flat_op, shape));
+    tensors_shapes.push_back(shape);
+  }
+  Tuple(&builder, tensors_ops);
+  Shape result_shape = ShapeUtil::MakeTupleShape(tensors_shapes);
+
+  std::vector<CompileInstance> instances;
+  instances.emplace_back(ConsumeValue(builder.Build()), device,
+                         std::vector<string>({device}), &result_shape);
+  std::vector<ComputationPtr> computations = Compile(std::move(instances));
+  std::vector<DataPtr> results =
+      ExecuteComputation(*computations.front(), packed_data, device,
+                         ExecuteComputationOptions());
+  XLA_CHECK_EQ(results.size(), indices.size());
+  return results;
+}
 
+std::vector<ComputationClient::DataPtr>
+XrtComputationClient::TransferToServerCoalesced(
+    tensorflow::gtl::ArraySlice<const TensorSource> tensors,
+    tensorflow::gtl::ArraySlice<const size_t> indices) {
+  XLA_COUNTER("CoalescedTransferToServer", 1);
+  XLA_COUNTER("CoalescedTransferToServerTensors", indices.size());
+
+  string device = GetEffectiveDevice(tensors[indices.front()].device);
+  const string& xrt_device = TorchDeviceToXrtDevice(device);
+  std::vector<Shape> shapes;
+  std::vector<tensorflow::Tensor> source_tensors;
+  int64 total_size = 0;
+  for (auto i : indices) {
+    shapes.push_back(tensors[i].shape);
+    source_tensors.push_back(MakeSourceTensor(tensors[i], device));
+    total_size += source_tensors.back().tensor_data().size();
+  }
   XrtSessionCache::SessionMap session_map;
+  XrtSession* session = GetSessionForXrtDevice(alloc_session_cache_.get(),
+                                               xrt_device, &session_map);
+  tensorflow::Scope device_scope = session->root()->WithDevice(xrt_device);
+  const XrtSession::CachedNode& cached_node =
+      GetAllocateTupleNode(session, device_scope, device, shapes);
+  tensorflow::ClientSession::FeedType feed_inputs;
+  for (size_t i = 0; i < source_tensors.size(); ++i) {
+    feed_inputs.insert({cached_node.holders[i], source_tensors[i]});
+  }
+  std::vector<tensorflow::Tensor> outputs;
+  XLA_CHECK_OK(session->Run(feed_inputs, {cached_node.outputs[0]}, &outputs));
+  XLA_CHECK_EQ(outputs.size(), 1);
+  OutboundDataMetric()->AddSample(total_size);
+  CreateDataHandlesCounter()->AddValue(1);
+
+  DataPtr tuple_data =
+      std::make_shared<XrtData>(this, device, ShapeUtil::MakeTupleShape(shapes),
+                                outputs[0].scalar<int64>()());
+  std::vector<std::vector<DataPtr>> results = DeconstructTuple({tuple_data});
+  XLA_CHECK_EQ(results.front().size(), indices.size());
+  return std::move(results.front());
+}
+
+std::vector<tensorflow::Tensor> XrtComputationClient::ReadServerLiterals(
+    tensorflow::gtl::ArraySlice<const DataPtr> handles) {
+  // The session maps are keyed by target, so each session cache needs its
+  // own.
+  std::map<XrtSessionCache*, XrtSessionCache::SessionMap> session_maps;
   std::map<XrtSession*, SessionWork> session_work_map;
   for (size_t i = 0; i < handles.size(); ++i) {
     const XrtData& xrt_data = dynamic_cast<const XrtData&>(*handles[i]);
-    XrtSession* session = GetSessionForDevice(session_cache_.get(),
-                                              xrt_data.device(), &session_map);
+    XrtSessionCache* cache = GetTransferSessionCache(xrt_data.shape());
+    XrtSession* session = GetSessionForDevice(cache, xrt_data.device(),
+                                              &session_maps[cache]);
     SessionWork* session_work = &session_work_map[session];
     tensorflow::Scope device_scope =
         session->root()->WithDevice(TorchDeviceToXrtDevice(xrt_data.device()));
@@ -298,24 +599,127 @@ std::vector<Literal> XrtComputationClient::TransferFromServer(
     session_work->index_mapping.push_back(i);
   }
 
-  int64 total_size = 0;
-  std::vector<Literal> results(handles.size());
+  std::vector<tensorflow::Tensor> results(handles.size());
   for (auto& session_work : session_work_map) {
     std::vector<tensorflow::Tensor> outputs;
-    XLA_CHECK_OK(session_work.first->session()->Run(
+    XLA_CHECK_OK(session_work.first->Run(
         session_work.second.feed_inputs, session_work.second.outputs_handles,
         &outputs));
     XLA_CHECK_EQ(outputs.size(), session_work.second.outputs_handles.size());
 
     for (size_t i = 0; i < outputs.size(); ++i) {
-      size_t li = session_work.second.index_mapping[i];
-      LiteralProto response;
-      XLA_CHECK(response.ParseFromString(outputs[i].scalar<string>()()));
-      results[li] = std::move(Literal::CreateFromProto(response).ValueOrDie());
-      total_size += results[li].size_bytes();
+      results[session_work.second.index_mapping[i]] = std::move(outputs[i]);
+    }
+  }
+  return results;
+}
+
+std::vector<Literal> XrtComputationClient::TransferFromServer(
+    tensorflow::gtl::ArraySlice<const DataPtr> handles) {
+  metrics::TimedSection timed(TransferFromServerMetric());
+
+  std::vector<tensorflow::Tensor> outputs = ReadServerLiterals(handles);
+  int64 total_size = 0;
+  std::vector<Literal> results(handles.size());
+  for (size_t i = 0; i < outputs.size(); ++i) {
+    LiteralProto response;
+    XLA_CHECK(response.ParseFromString(outputs[i].scalar<string>()()));
+    results[i] = std::move(Literal::CreateFromProto(response).ValueOrDie());
+    total_size += results[i].size_bytes();
+  }
+  InboundDataMetric()->AddSample(total_size);
+  return results;
+}
+
+void XrtComputationClient::TransferFromServer(
+    tensorflow::gtl::ArraySlice<const DataPtr> handles,
+    const TransferDataFn& data_fn) {
+  metrics::TimedSection timed(TransferFromServerMetric());
+
+  std::vector<tensorflow::Tensor> outputs = ReadServerLiterals(handles);
+  int64 total_size = 0;
+  for (size_t i = 0; i < outputs.size(); ++i) {
+    LiteralProto response;
+    XLA_CHECK(response.ParseFromString(outputs[i].scalar<string>()()));
+    Shape shape(response.shape());
+    std::pair<const void*, size_t> data = GetLiteralProtoData(response);
+    if (data.first != nullptr && data.second == ShapeUtil::ByteSizeOf(shape)) {
+      data_fn(i, shape, data.first, data.second);
+      total_size += data.second;
+    } else {
+      // Either an element type whose proto representation differs from the
+      // literal one, or an empty tensor.
+      Literal literal = Literal::CreateFromProto(response).ValueOrDie();
+      data_fn(i, literal.shape(), literal.untyped_data(), literal.size_bytes());
+      total_size += literal.size_bytes();
     }
   }
   InboundDataMetric()->AddSample(total_size);
+}
+
+std::vector<ComputationClient::DataPtr> XrtComputationClient::TransferToDevice(
+    tensorflow::gtl::ArraySlice<const DataPtr> handles,
+    const string& dst_device) {
+  metrics::TimedSection timed(TransferToDeviceMetric());
+
+  // The copy graph reads the source allocation into a tensor on the source
+  // worker, and allocates it on the destination device. When the two devices
+  // belong to the same worker the tensor never leaves the worker memory,
+  // otherwise the TF runtime sends it straight to the destination worker.
+  string device = GetEffectiveDevice(dst_device);
+  const string& xrt_device = TorchDeviceToXrtDevice(device);
+  XrtSessionCache::SessionMap session_map;
+  XrtSession* session = GetSessionForXrtDevice(alloc_session_cache_.get(),
+                                               xrt_device, &session_map);
+  tensorflow::Scope dst_scope = session->root()->WithDevice(xrt_device);
+  SessionWork session_work;
+  std::vector<size_t> host_indices;
+  for (size_t i = 0; i < handles.size(); ++i) {
+    const XrtData& xrt_data = dynamic_cast<const XrtData&>(*handles[i]);
+    const Shape& shape = xrt_data.shape();
+    // The tensors read by XRTReadToTensor are in row major layout, so the
+    // other layouts (and the tuples) go through the host.
+    if (!shape.IsArray() ||
+        !LayoutUtil::IsMonotonicWithDim0Major(shape.layout())) {
+      host_indices.push_back(i);
+      continue;
+    }
+    tensorflow::Scope src_scope =
+        session->root()->WithDevice(TorchDeviceToXrtDevice(xrt_data.device()));
+    const XrtSession::CachedNode& cached_node = GetCopyNode(
+        session, src_scope, dst_scope, xrt_data.device(), device, shape);
+    session_work.feed_inputs.insert(
+        {cached_node.holders[0], xrt_data.get_handle()});
+    session_work.outputs_handles.push_back(cached_node.outputs[0]);
+    session_work.index_mapping.push_back(i);
+  }
+
+  std::vector<DataPtr> results(handles.size());
+  if (!session_work.outputs_handles.empty()) {
+    std::vector<tensorflow::Tensor> outputs;
+    XLA_CHECK_OK(session->Run(session_work.feed_inputs,
+                              session_work.outputs_handles, &outputs));
+    XLA_CHECK_EQ(outputs.size(), session_work.outputs_handles.size());
+
+    for (size_t i = 0; i < outputs.size(); ++i) {
+      size_t li = session_work.index_mapping[i];
+      results[li] = std::make_shared<XrtData>(
+          this, device, handles[li]->shape(), outputs[i].scalar<int64>()());
+    }
+    CreateDataHandlesCounter()->AddValue(outputs.size());
+  }
+  if (!host_indices.empty()) {
+    XLA_COUNTER("TransferToDeviceThroughHost", host_indices.size());
+    std::vector<DataPtr> host_handles;
+    for (auto i : host_indices) {
+      host_handles.push_back(handles[i]);
+    }
+    std::vector<DataPtr> host_results =
+        ComputationClient::TransferToDevice(host_handles, device);
+    for (size_t i = 0; i < host_results.size(); ++i) {
+      results[host_indices[i]] = std::move(host_results[i]);
+    }
+  }
   return results;
 }
 
@@ -328,8 +732,43 @@ std::vector<ComputationClient::ComputationPtr> XrtComputationClient::Compile(
   std::vector<ProgramShape> program_shapes(instances.size());
   std::vector<ComputationPtr> results(instances.size());
   std::vector<CompilationCacheKey> cache_keys(instances.size());
+  std::vector<uint8> persistent_hits(instances.size(), 0);
+  // The host level keys of the cache misses, when the compilations are shared
+  // among the processes driving the devices of the same worker.
+  std::vector<string> shared_keys(instances.size());
+  const service::MeshClient* shared_client = GetSharedCompileClient();
+  const service::MeshClient* cluster_client = GetClusterCompileClient();
+  std::vector<uint8> cluster_hits(instances.size(), 0);
+  // The fingerprints of the compilations which are new to the cluster compile
+  // cache, to be published once compiled. Concurrent callers must hold the
+  // lock.
+  std::vector<string> cluster_publish;
   XrtSessionCache::SessionMap session_map;
   std::map<XrtSession*, SessionWork> session_work_map;
+  // Fetch the sessions upfront, so that a session creation does not happen
+  // while holding the lock the builders below serialize on.
+  for (auto& instance : instances) {
+    GetSessionForXrtDevice(session_cache_.get(),
+                           TorchDeviceToXrtDevice(instance.compilation_device),
+                           &session_map);
+  }
+  // Queues the compilation of the i-th instance. Concurrent callers must hold
+  // the lock.
+  auto add_compile_work = [&, this](size_t i) {
+    const CompileInstance& instance = instances[i];
+    const string& xrt_device =
+        TorchDeviceToXrtDevice(instance.compilation_device);
+    XrtSession* session =
+        GetSessionForXrtDevice(session_cache_.get(), xrt_device, &session_map);
+    SessionWork* session_work = &session_work_map[session];
+    tensorflow::Scope device_scope = session->root()->WithDevice(xrt_device);
+    const XrtSession::CachedNode& cached_node =
+        GetCompileNode(session, device_scope, instance.compilation_device);
+    session_work->feed_inputs.insert(
+        {cached_node.holders[0], cache_keys[i].serialized_computation});
+    session_work->outputs_handles.push_back(cached_node.outputs[0]);
+    session_work->index_mapping.push_back(i);
+  };
   for (size_t i = 0; i < instances.size(); ++i) {
     auto builder = [&, this, i]() {
       const CompileInstance& instance = instances[i];
@@ -341,25 +780,20 @@ std::vector<ComputationClient::ComputationPtr> XrtComputationClient::Compile(
           xrt_computation->SerializeAsString());
       auto computation_ptr = compilation_cache_.Get(cache_key);
       if (computation_ptr == nullptr) {
+        persistent_hits[i] = LookupPersistentCache(
+            instance.compilation_device, cache_key.serialized_computation);
+        if (shared_client != nullptr) {
+          shared_keys[i] = absl::StrCat(
+              "compile:", cache_key.domain, ":",
+              GetPersistentCacheKey(instance.compilation_device,
+                                    cache_key.serialized_computation));
+        }
         cache_keys[i] = std::move(cache_key);
         program_shapes[i] =
             ProgramShape(xrt_computation->config().program_shape());
-
-        const string& xrt_device =
-            TorchDeviceToXrtDevice(instance.compilation_device);
-        {
+        if (shared_client == nullptr) {
           std::lock_guard<std::mutex> slock(lock);
-          XrtSession* session = GetSessionForXrtDevice(
-              session_cache_.get(), xrt_device, &session_map);
-          SessionWork* session_work = &session_work_map[session];
-          tensorflow::Scope device_scope =
-              session->root()->WithDevice(xrt_device);
-          const XrtSession::CachedNode& cached_node = GetCompileNode(
-              session, device_scope, instance.compilation_device);
-          session_work->feed_inputs.insert(
-              {cached_node.holders[0], cache_keys[i].serialized_computation});
-          session_work->outputs_handles.push_back(cached_node.outputs[0]);
-          session_work->index_mapping.push_back(i);
+          add_compile_work(i);
         }
       } else {
         results[i] = computation_ptr;
@@ -368,38 +802,239 @@ std::vector<ComputationClient::ComputationPtr> XrtComputationClient::Compile(
     env::ScheduleClosure(mwait.Completer(std::move(builder)));
   }
   mwait.Wait();
-  mwait.Reset(session_work_map.size());
+  if (cluster_client != nullptr) {
+    LookupClusterCache(cluster_client, instances, cache_keys, results,
+                       &cluster_hits);
+  }
 
-  for (auto& session_and_work : session_work_map) {
-    XrtSession* session = session_and_work.first;
-    const SessionWork& session_work = session_and_work.second;
+  auto run_compile_work = [&, this]() {
+    mwait.Reset(session_work_map.size());
+    for (auto& session_and_work : session_work_map) {
+      XrtSession* session = session_and_work.first;
+      const SessionWork& session_work = session_and_work.second;
+
+      auto session_runner = [&, this, session]() {
+        std::vector<tensorflow::Tensor> outputs;
+        CheckCompileStatus(
+            session->Run(session_work.feed_inputs, session_work.outputs_handles,
+                         &outputs),
+            instances, session_work);
+        XLA_CHECK_EQ(outputs.size(), session_work.outputs_handles.size());
+
+        size_t output_index = 0;
+        for (auto li : session_work.index_mapping) {
+          CompileInstance* instance = &instances[li];
+          results[li] = std::make_shared<XrtComputation>(
+              this, std::move(instance->computation), program_shapes[li],
+              std::move(instance->devices),
+              outputs[output_index].scalar<int64>()(),
+              instance->compilation_device);
+          ++output_index;
+
+          if (persistent_cache_ != nullptr && !persistent_hits[li]) {
+            persistent_cache_->Put(
+                GetPersistentCacheKey(instance->compilation_device,
+                                      cache_keys[li].serialized_computation),
+                cache_keys[li].serialized_computation);
+          }
+          if (cluster_client != nullptr && !cluster_hits[li]) {
+            std::lock_guard<std::mutex> slock(lock);
+            cluster_publish.push_back(
+                GetPersistentCacheKey(instance->compilation_device,
+                                      cache_keys[li].serialized_computation));
+          }
+          compilation_cache_.Add(std::move(cache_keys[li]), results[li]);
+          CreateCompileHandlesCounter()->AddValue(1);
+        }
+      };
+      env::ScheduleIoClosure(mwait.Completer(std::move(session_runner)));
+    }
+    mwait.Wait();
+    session_work_map.clear();
+  };
+  if (shared_client == nullptr) {
+    run_compile_work();
+  } else {
+    CompileShared(shared_client, shared_keys, add_compile_work,
+                  run_compile_work);
+  }
+  if (!cluster_publish.empty()) {
+    // The cluster compile cache is only an optimization, so failing to reach
+    // the mesh service must not fail the compilation.
+    try {
+      std::vector<bool> stored =
+          cluster_client->PublishCompilations(cluster_publish);
+      XLA_COUNTER("ClusterCompileCachePublished",
+                  std::count(stored.begin(), stored.end(), true));
+    } catch (const std::exception& ex) {
+      TF_LOG(WARNING) << "Unable to publish to the cluster compile cache: "
+                      << ex.what();
+    }
+  }
+  return results;
+}
 
-    auto session_runner = [&, this, session]() {
-      std::vector<tensorflow::Tensor> outputs;
-      CheckCompileStatus(
-          session->session()->Run(session_work.feed_inputs,
-                                  session_work.outputs_handles, &outputs),
-          instances, session_work);
-      XLA_CHECK_EQ(outputs.size(), session_work.outputs_handles.size());
+const service::MeshClient* XrtComputationClient::GetClusterCompileClient() {
+  static const service::MeshClient* client = []() {
+    const service::MeshClient* mesh_client = nullptr;
+    if (!sys_util::GetEnvString("XRT_MESH_SERVICE_ADDRESS", "").empty() &&
+        sys_util::GetEnvBool("XRT_CLUSTER_COMPILE_CACHE", false)) {
+      mesh_client = service::MeshClient::Get();
+    }
+    return mesh_client;
+  }();
+  return client;
+}
 
-      size_t output_index = 0;
-      for (auto li : session_work.index_mapping) {
-        CompileInstance* instance = &instances[li];
-        results[li] = std::make_shared<XrtComputation>(
-            this, std::move(instance->computation), program_shapes[li],
-            std::move(instance->devices),
-            outputs[output_index].scalar<int64>()(),
-            instance->compilation_device);
-        ++output_index;
-
-        compilation_cache_.Add(std::move(cache_keys[li]), results[li]);
-        CreateCompileHandlesCounter()->AddValue(1);
-      }
-    };
-    env::ScheduleIoClosure(mwait.Completer(std::move(session_runner)));
+void XrtComputationClient::LookupClusterCache(
+    const service::MeshClient* cluster_client,
+    const std::vector<CompileInstance>& instances,
+    const std::vector<CompilationCacheKey>& cache_keys,
+    const std::vector<ComputationPtr>& results,
+    std::vector<uint8>* hits) const {
+  std::vector<string> keys;
+  std::vector<size_t> indices;
+  for (size_t i = 0; i < instances.size(); ++i) {
+    if (results[i] == nullptr) {
+      keys.push_back(
+          GetPersistentCacheKey(instances[i].compilation_device,
+                                cache_keys[i].serialized_computation));
+      indices.push_back(i);
+    }
   }
-  mwait.Wait();
-  return results;
+  if (keys.empty()) {
+    return;
+  }
+  std::vector<bool> found;
+  try {
+    found = cluster_client->LookupCompilations(keys);
+  } catch (const std::exception& ex) {
+    TF_LOG(WARNING) << "Unable to query the cluster compile cache: "
+                    << ex.what();
+    return;
+  }
+  size_t num_hits = 0;
+  for (size_t j = 0; j < indices.size(); ++j) {
+    if (found[j]) {
+      (*hits)[indices[j]] = 1;
+      ++num_hits;
+    }
+  }
+  XLA_COUNTER("ClusterCompileCacheHit", num_hits);
+  XLA_COUNTER("ClusterCompileCacheMiss", indices.size() - num_hits);
+}
+
+const service::MeshClient* XrtComputationClient::GetSharedCompileClient() {
+  static const service::MeshClient* client = []() {
+    const service::MeshClient* mesh_client = nullptr;
+    if (!GetMultiProcessingDevice().empty() &&
+        sys_util::GetEnvBool("XRT_SHARED_COMPILE", true)) {
+      mesh_client = service::MeshClient::Get();
+    }
+    return mesh_client;
+  }();
+  return client;
+}
+
+void XrtComputationClient::CompileShared(
+    const service::MeshClient* shared_client,
+    const std::vector<string>& shared_keys,
+    const std::function<void(size_t)>& add_compile_work,
+    const std::function<void()>& run_compile_work) {
+  static const int64 wait_seconds =
+      sys_util::GetEnvInt("XRT_SHARED_COMPILE_WAIT", 1800);
+  std::vector<std::pair<string, string>> claims;
+  std::vector<size_t> indices;
+  for (size_t i = 0; i < shared_keys.size(); ++i) {
+    if (!shared_keys[i].empty()) {
+      claims.emplace_back(shared_keys[i], GetMultiProcessingDevice());
+      indices.push_back(i);
+    }
+  }
+  if (claims.empty()) {
+    return;
+  }
+  // The first process claiming a key compiles the computation, while the
+  // other ones wait for it to publish the completion. The compile handles are
+  // reference counted by the process which owns them, so they cannot be handed
+  // over, but the followers compile requests then hit the worker side XRT
+  // compilation cache, instead of running the XLA compiler again.
+  std::vector<bool> owned = shared_client->SetKeyValuesIfAbsent(claims);
+  std::vector<size_t> followers;
+  std::vector<std::pair<string, string>> completions;
+  for (size_t j = 0; j < indices.size(); ++j) {
+    if (owned[j]) {
+      add_compile_work(indices[j]);
+      completions.emplace_back(absl::StrCat(claims[j].first, ":done"), "");
+    } else {
+      followers.push_back(indices[j]);
+    }
+  }
+  XLA_COUNTER("SharedCompileOwned", completions.size());
+  XLA_COUNTER("SharedCompileFollowed", followers.size());
+  // Waiting for the owners only after our own compilations have completed, and
+  // have been published, avoids deadlocks among processes owning parts of the
+  // other ones batches. Failed compilations are published as well, so that the
+  // followers do not wait for the timeout, and get the error themselves.
+  auto publish = [&]() {
+    if (!completions.empty()) {
+      shared_client->SetKeyValues(completions);
+    }
+  };
+  try {
+    run_compile_work();
+  } catch (...) {
+    publish();
+    throw;
+  }
+  publish();
+  if (followers.empty()) {
+    return;
+  }
+  std::vector<string> done_keys;
+  for (auto i : followers) {
+    done_keys.push_back(absl::StrCat(shared_keys[i], ":done"));
+  }
+  {
+    XLA_TIMED("SharedCompileWaitTime");
+    try {
+      shared_client->GetKeyValues(done_keys, wait_seconds);
+    } catch (const std::exception& ex) {
+      TF_LOG(WARNING) << "Compiling without waiting for the shared "
+                         "compilations: "
+                      << ex.what();
+    }
+  }
+  for (auto i : followers) {
+    add_compile_work(i);
+  }
+  run_compile_work();
+}
+
+string XrtComputationClient::GetPersistentCacheKey(
+    const string& device, const string& serialized_computation) {
+  string device_kind = device.substr(0, device.find(':'));
+  uint64 hash = tensorflow::Hash64(serialized_computation.data(),
+                                   serialized_computation.size(),
+                                   util::StringHash(device_kind.c_str()));
+  return absl::StrCat(device_kind, "-", absl::Hex(hash, absl::kZeroPad16));
+}
+
+bool XrtComputationClient::LookupPersistentCache(
+    const string& device, const string& serialized_computation) const {
+  if (persistent_cache_ == nullptr) {
+    return false;
+  }
+  std::unique_ptr<string> blob = persistent_cache_->Get(
+      GetPersistentCacheKey(device, serialized_computation));
+  // Compare the full content, to be safe against hash collisions.
+  if (blob == nullptr || *blob != serialized_computation) {
+    PersistentCacheMissCounter()->AddValue(1);
+    return false;
+  }
+  PersistentCacheHitCounter()->AddValue(1);
+  PersistentCacheDataMetric()->AddSample(blob->size());
+  return true;
 }
 
 void XrtComputationClient::CheckCompileStatus(
@@ -433,7 +1068,7 @@ XrtComputationClient::ExecuteComputation(
       GetSessionForDevice(session_cache_.get(), effective_device, &session_map);
   std::vector<tensorflow::Tensor> outputs;
   util::CheckComputationStatus(
-      session->session()->Run(feed_inputs, {exec_ops.front()}, &outputs),
+      session->Run(feed_inputs, {exec_ops.front()}, &outputs),
       {&computation.computation()});
   XLA_CHECK_EQ(outputs.size(), 1);
 
@@ -461,13 +1096,66 @@ XrtComputationClient::ExecuteReplicated(
                          feed_inputs);
 }
 
-std::vector<std::vector<ComputationClient::DataPtr>>
-XrtComputationClient::RunComputations(
-    const XrtSessionCache::SessionMap& session_map,
-    const std::vector<tensorflow::Output>& exec_ops,
-    tensorflow::gtl::ArraySlice<const Computation* const> computations,
+std::vector<ComputationClient::ReplicaResult>
+XrtComputationClient::ExecuteReplicatedAsync(
+    const Computation& computation,
+    const std::vector<std::vector<DataPtr>>& arguments,
     tensorflow::gtl::ArraySlice<const string> devices,
-    const tensorflow::ClientSession::FeedType& feed_inputs) {
+    const ExecuteReplicatedOptions& options) {
+  XLA_COUNTER("ExecuteReplicatedAsync", 1);
+
+  // The session runs outlive this call, so everything they need is either
+  // shared with, or copied into, the session runners. This includes the
+  // arguments, whose handles would otherwise get released if the caller drops
+  // them before the executions start.
+  auto arguments_ref =
+      std::make_shared<std::vector<std::vector<DataPtr>>>(arguments);
+  auto session_map = std::make_shared<XrtSessionCache::SessionMap>();
+  auto feed_inputs = std::make_shared<tensorflow::ClientSession::FeedType>();
+  auto exec_ops = std::make_shared<std::vector<tensorflow::Output>>(
+      CreateExecuteOps(session_map.get(),
+                       dynamic_cast<const XrtComputation&>(computation),
+                       arguments, options.explode_tuple, devices,
+                       feed_inputs.get()));
+  auto computations = std::make_shared<std::vector<const Computation*>>(
+      devices.size(), &computation);
+  auto devices_vector =
+      std::make_shared<std::vector<string>>(devices.begin(), devices.end());
+  auto promises =
+      std::make_shared<std::vector<std::promise<std::vector<DataPtr>>>>(
+          devices.size());
+  std::vector<ReplicaResult> results;
+  results.reserve(devices.size());
+  for (auto& promise : *promises) {
+    results.push_back(promise.get_future().share());
+  }
+  for (auto& sess_replica : GetSessionReplicas(*session_map, devices)) {
+    XrtSession* session = sess_replica.first;
+    auto session_runner = [this, session, replicas = sess_replica.second,
+                           arguments_ref, session_map, feed_inputs, exec_ops,
+                           computations, devices_vector, promises]() {
+      try {
+        std::vector<std::vector<DataPtr>> replica_results =
+            RunSessionReplicas(session, replicas, *exec_ops, *computations,
+                               *devices_vector, *feed_inputs);
+        for (size_t i = 0; i < replicas.size(); ++i) {
+          (*promises)[replicas[i]].set_value(std::move(replica_results[i]));
+        }
+      } catch (...) {
+        for (auto replica : replicas) {
+          (*promises)[replica].set_exception(std::current_exception());
+        }
+      }
+    };
+    env::ScheduleIoClosure(std::move(session_runner), env::Priority::kHigh);
+  }
+  return results;
+}
+
+std::map<XrtSession*, std::vector<size_t>>
+XrtComputationClient::GetSessionReplicas(
+    const XrtSessionCache::SessionMap& session_map,
+    tensorflow::gtl::ArraySlice<const string> devices) const {
   // In the PyTorch/XRT interface we keep a map (options_.workers_map) from a
   // worker+taskno, to the GRPC server which is the entry point for that worker.
   // Since XRT could re-distribute ops internally, if we have N hosts
@@ -487,7 +1175,49 @@ XrtComputationClient::RunComputations(
     XrtSession* session = session_map.at(worker_hostport.second).get();
     session_replicas[session].push_back(i);
   }
+  return session_replicas;
+}
+
+std::vector<std::vector<ComputationClient::DataPtr>>
+XrtComputationClient::RunSessionReplicas(
+    XrtSession* session, const std::vector<size_t>& replicas,
+    const std::vector<tensorflow::Output>& exec_ops,
+    tensorflow::gtl::ArraySlice<const Computation* const> computations,
+    tensorflow::gtl::ArraySlice<const string> devices,
+    const tensorflow::ClientSession::FeedType& feed_inputs) {
+  std::vector<tensorflow::Output> exec_nodes;
+  std::vector<const XlaComputation*> xla_computations;
+  for (auto replica : replicas) {
+    exec_nodes.push_back(exec_ops[replica]);
+    xla_computations.push_back(&computations[replica]->computation());
+  }
+  std::vector<tensorflow::Tensor> outputs;
+  util::CheckComputationStatus(
+      session->Run(feed_inputs, exec_nodes, &outputs),
+      xla_computations);
+  XLA_CHECK_EQ(outputs.size(), exec_nodes.size());
+
+  std::vector<std::vector<DataPtr>> results;
+  results.reserve(outputs.size());
+  for (size_t i = 0; i < outputs.size(); ++i) {
+    auto replica = replicas[i];
+    results.push_back(GetComputationResults(
+        outputs[i], computations[replica]->program_shape().result(),
+        GetEffectiveDevice(devices[replica])));
+  }
+  return results;
+}
+
+std::vector<std::vector<ComputationClient::DataPtr>>
+XrtComputationClient::RunComputations(
+    const XrtSessionCache::SessionMap& session_map,
+    const std::vector<tensorflow::Output>& exec_ops,
+    tensorflow::gtl::ArraySlice<const Computation* const> computations,
+    tensorflow::gtl::ArraySlice<const string> devices,
+    const tensorflow::ClientSession::FeedType& feed_inputs) {
   XLA_CHECK_EQ(computations.size(), devices.size());
+  std::map<XrtSession*, std::vector<size_t>> session_replicas =
+      GetSessionReplicas(session_map, devices);
 
   util::MultiWait mwait(session_replicas.size());
   std::vector<std::vector<DataPtr>> results(devices.size());
@@ -496,26 +1226,14 @@ XrtComputationClient::RunComputations(
     const std::vector<size_t>& replicas = sess_replica.second;
 
     auto session_runner = [&, this, session]() {
-      std::vector<tensorflow::Output> exec_nodes;
-      std::vector<const XlaComputation*> xla_computations;
-      for (auto replica : replicas) {
-        exec_nodes.push_back(exec_ops[replica]);
-        xla_computations.push_back(&computations[replica]->computation());
-      }
-      std::vector<tensorflow::Tensor> outputs;
-      util::CheckComputationStatus(
-          session->session()->Run(feed_inputs, exec_nodes, &outputs),
-          xla_computations);
-      XLA_CHECK_EQ(outputs.size(), exec_nodes.size());
-
-      for (size_t i = 0; i < outputs.size(); ++i) {
-        auto replica = replicas[i];
-        results[replica] = GetComputationResults(
-            outputs[i], computations[replica]->program_shape().result(),
-            GetEffectiveDevice(devices[replica]));
+      std::vector<std::vector<DataPtr>> replica_results = RunSessionReplicas(
+          session, replicas, exec_ops, computations, devices, feed_inputs);
+      for (size_t i = 0; i < replicas.size(); ++i) {
+        results[replicas[i]] = std::move(replica_results[i]);
       }
     };
-    env::ScheduleIoClosure(mwait.Completer(std::move(session_runner)));
+    env::ScheduleIoClosure(mwait.Completer(std::move(session_runner)),
+                           env::Priority::kHigh);
   }
   mwait.Wait();
   return results;
@@ -541,11 +1259,79 @@ XrtComputationClient::ExecuteParallel(
 std::vector<ComputationClient::DataPtr> XrtComputationClient::ExecuteChained(
     tensorflow::gtl::ArraySlice<const ExecuteChainedOp> ops,
     const string& device) {
+  // A split mode of 2 selects the fastest strategy for every chain.
   static int64 split_mode = sys_util::GetEnvInt("XRT_SPLIT_CHAINED_EXEC", 0);
+  if (split_mode == 2) {
+    return ExecuteChainedAuto(ops, device);
+  }
   return split_mode ? ExecuteChainedSplit(ops, device)
                     : ExecuteChainedXrt(ops, device);
 }
 
+std::vector<ComputationClient::DataPtr>
+XrtComputationClient::ExecuteChainedAuto(
+    tensorflow::gtl::ArraySlice<const ExecuteChainedOp> ops,
+    const string& device) {
+  static metrics::Metric* xrt_metric =
+      new metrics::Metric("ExecuteChainedAutoXrt", metrics::MetricFnTime);
+  static metrics::Metric* split_metric =
+      new metrics::Metric("ExecuteChainedAutoSplit", metrics::MetricFnTime);
+  size_t key = GetChainedExecKey(ops, device);
+  ChainedExecStatsCache::TypePtr stats = chained_exec_stats_.Get(key);
+  if (stats == nullptr) {
+    stats = chained_exec_stats_.Add(key, std::make_shared<ChainedExecStats>());
+  }
+  ChainedExecMode mode;
+  {
+    std::lock_guard<std::mutex> lock(chained_exec_lock_);
+    if (stats->selected) {
+      mode = *stats->selected;
+    } else {
+      mode = stats->runs[kChainedExecXrt] <= stats->runs[kChainedExecSplit]
+                 ? kChainedExecXrt
+                 : kChainedExecSplit;
+    }
+  }
+  if (mode == kChainedExecXrt) {
+    XLA_COUNTER("ExecuteChainedAutoXrtRuns", 1);
+  } else {
+    XLA_COUNTER("ExecuteChainedAutoSplitRuns", 1);
+  }
+
+  int64 start = sys_util::NowNs();
+  std::vector<DataPtr> results = mode == kChainedExecXrt
+                                     ? ExecuteChainedXrt(ops, device)
+                                     : ExecuteChainedSplit(ops, device);
+  int64 now = sys_util::NowNs();
+  int64 elapsed = now - start;
+  (mode == kChainedExecXrt ? xrt_metric : split_metric)->AddSample(now,
+                                                                   elapsed);
+
+  std::lock_guard<std::mutex> lock(chained_exec_lock_);
+  if (!stats->selected) {
+    // Use the best time, which is less sensitive to the first run overheads
+    // than the mean.
+    if (stats->runs[mode] == 0 || elapsed < stats->best_ns[mode]) {
+      stats->best_ns[mode] = elapsed;
+    }
+    stats->runs[mode] += 1;
+    int64 auto_runs = GetChainedExecAutoRuns();
+    if (stats->runs[kChainedExecXrt] >= auto_runs &&
+        stats->runs[kChainedExecSplit] >= auto_runs) {
+      stats->selected =
+          stats->best_ns[kChainedExecSplit] < stats->best_ns[kChainedExecXrt]
+              ? kChainedExecSplit
+              : kChainedExecXrt;
+      if (*stats->selected == kChainedExecXrt) {
+        XLA_COUNTER("ExecuteChainedAutoSelectXrt", 1);
+      } else {
+        XLA_COUNTER("ExecuteChainedAutoSelectSplit", 1);
+      }
+    }
+  }
+  return results;
+}
+
 std::vector<ComputationClient::DataPtr> XrtComputationClient::ExecuteChainedXrt(
     tensorflow::gtl::ArraySlice<const ExecuteChainedOp> ops,
     const string& device) {
@@ -613,7 +1399,7 @@ std::vector<ComputationClient::DataPtr> XrtComputationClient::ExecuteChainedXrt(
 
   std::vector<tensorflow::Tensor> outputs;
   util::CheckComputationStatus(
-      session->session()->Run(feed_inputs, {cached_node.outputs[0]}, &outputs),
+      session->Run(feed_inputs, {cached_node.outputs[0]}, &outputs),
       {});
   XLA_CHECK_EQ(outputs.size(), 1);
 
@@ -671,7 +1457,7 @@ XrtComputationClient::ExecuteChainedSplit(
 
       std::vector<tensorflow::Tensor> outputs;
       util::CheckComputationStatus(
-          session->session()->Run(feed_inputs, {exec_ops.front()}, &outputs),
+          session->Run(feed_inputs, {exec_ops.front()}, &outputs),
           {&op.computation->computation()});
       XLA_CHECK_EQ(outputs.size(), 1);
       ops_outputs[i] = GetComputationResults(
@@ -733,31 +1519,70 @@ XrtComputationClient::DeconstructTuple(
     }
   }
 
+  // The sessions of different workers are run in parallel.
+  util::MultiWait mwait(session_work_map.size());
   std::vector<std::vector<DataPtr>> results(tuples.size());
   for (auto& session_work : session_work_map) {
-    std::vector<tensorflow::Tensor> outputs;
-    XLA_CHECK_OK(session_work.first->session()->Run(
-        session_work.second.feed_inputs, session_work.second.outputs_handles,
-        &outputs));
-    XLA_CHECK_EQ(outputs.size(), session_work.second.outputs_handles.size());
+    auto session_runner = [&, this, session_work = &session_work]() {
+      std::vector<tensorflow::Tensor> outputs;
+      XLA_CHECK_OK(session_work->first->Run(
+          session_work->second.feed_inputs,
+          session_work->second.outputs_handles, &outputs));
+      XLA_CHECK_EQ(outputs.size(),
+                   session_work->second.outputs_handles.size());
 
-    size_t output_index = 0;
-    for (auto li : session_work.second.index_mapping) {
-      const XrtData& xrt_data = dynamic_cast<const XrtData&>(*tuples[li]);
-      std::vector<DataPtr> tuple_results;
-      for (size_t i = 0; i < tuple_elements_count[li]; ++i, ++output_index) {
-        tuple_results.push_back(std::make_shared<XrtData>(
-            this, xrt_data.device(),
-            ShapeUtil::GetTupleElementShape(xrt_data.shape(), i),
-            outputs[output_index].scalar<int64>()()));
+      size_t output_index = 0;
+      for (auto li : session_work->second.index_mapping) {
+        const XrtData& xrt_data = dynamic_cast<const XrtData&>(*tuples[li]);
+        std::vector<DataPtr> tuple_results;
+        tuple_results.reserve(tuple_elements_count[li]);
+        for (size_t i = 0; i < tuple_elements_count[li]; ++i, ++output_index) {
+          tuple_results.push_back(std::make_shared<XrtData>(
+              this, xrt_data.device(),
+              ShapeUtil::GetTupleElementShape(xrt_data.shape(), i),
+              outputs[output_index].scalar<int64>()()));
+        }
+        results[li] = std::move(tuple_results);
+        CreateDataHandlesCounter()->AddValue(tuple_elements_count[li]);
       }
-      results[li] = std::move(tuple_results);
-      CreateDataHandlesCounter()->AddValue(tuple_elements_count[li]);
-    }
+    };
+    env::ScheduleIoClosure(mwait.Completer(std::move(session_runner)),
+                           env::Priority::kHigh);
   }
+  mwait.Wait();
   return results;
 }
 
+void XrtComputationClient::ReleaseConsumedData(std::vector<DataPtr>* datas) {
+  std::vector<DeviceHandle> data_handles;
+  for (auto& data : *datas) {
+    // A single reference to the data object, and to its handle (which is shared
+    // by the placeholders the data has been assigned to), means no tensor nor
+    // IR node can reach the device memory anymore.
+    if (data.use_count() != 1) {
+      continue;
+    }
+    XrtData* xrt_data = dynamic_cast<XrtData*>(data.get());
+    if (xrt_data->handle_ptr == nullptr ||
+        xrt_data->handle_ptr.use_count() != 1) {
+      continue;
+    }
+    MemoryTracker::Get()->Free(xrt_data->handle_ptr.get());
+    data_handles.push_back({xrt_data->device(), xrt_data->get_handle()});
+    // With a null handle, the XrtData destructor will not queue the release.
+    xrt_data->ResetHandle();
+  }
+  datas->clear();
+  if (!data_handles.empty()) {
+    ReleaseDataHandlesCounter()->AddValue(data_handles.size());
+    EagerReleaseDataHandlesCounter()->AddValue(data_handles.size());
+    auto releaser = [this, data_handles = std::move(data_handles)]() {
+      ReleaseHandles(data_handles, {});
+    };
+    env::ScheduleIoClosure(std::move(releaser), env::Priority::kHigh);
+  }
+}
+
 XrtSession* XrtComputationClient::GetSessionForTarget(
     XrtSessionCache* cache, const string& target,
     XrtSessionCache::SessionMap* session_map) {
@@ -912,76 +1737,122 @@ std::vector<tensorflow::Output> XrtComputationClient::CreateExecuteOps(
   return exec_ops;
 }
 
-void XrtComputationClient::ReleaseHandles(
-    std::vector<DeviceHandle>* handles,
+void XrtComputationClient::AddReleaseWork(
+    const std::vector<DeviceHandle>& handles,
     const std::function<const XrtSession::CachedNode&(
         XrtSession*, const tensorflow::Scope&, const string&)>& op_generator,
-    metrics::Metric* timed_metric, metrics::Counter* destroy_counter) {
-  std::vector<DeviceHandle> released_handles;
-  {
-    std::lock_guard<std::mutex> lock(lock_);
-    released_handles.swap(*handles);
+    XrtSessionCache::SessionMap* session_map,
+    std::map<XrtSession*, SessionWork>* session_work_map) {
+  // The release operations are fed with the handles of a single device, so
+  // group the handles by (session, device) first.
+  std::map<std::pair<XrtSession*, string>, std::vector<int64>>
+      device_handles_map;
+  for (auto& handle : handles) {
+    XrtSession* session = GetSessionForDevice(release_session_cache_.get(),
+                                              handle.device, session_map);
+    device_handles_map[std::make_pair(session, handle.device)].push_back(
+        handle.handle);
   }
-  if (!released_handles.empty()) {
-    metrics::TimedSection timed(timed_metric);
-
-    XrtSessionCache::SessionMap session_map;
-    std::map<XrtSession*, std::vector<DeviceHandle>> session_handles_map;
-    for (auto& handle : released_handles) {
-      XrtSession* session = GetSessionForDevice(session_cache_.get(),
-                                                handle.device, &session_map);
-      session_handles_map[session].push_back(handle);
-    }
-    for (const auto& session_and_handles : session_handles_map) {
-      XrtSession* session = session_and_handles.first;
-      const std::vector<DeviceHandle>& session_handles =
-          session_and_handles.second;
-      tensorflow::Tensor handles_tensor(
-          tensorflow::DT_INT64,
-          tensorflow::TensorShape({session_handles.size()}));
-      auto flat_handles_tensor = handles_tensor.flat<tensorflow::int64>();
-      for (size_t i = 0; i < session_handles.size(); ++i) {
-        flat_handles_tensor(i) = session_handles[i].handle;
-      }
-      tensorflow::Scope device_scope = session->root()->WithDevice(
-          TorchDeviceToXrtDevice(session_handles.front().device));
-      const XrtSession::CachedNode& cached_node =
-          op_generator(session, device_scope, session_handles.front().device);
-      tensorflow::ClientSession::FeedType feed_inputs;
-      feed_inputs.insert({cached_node.holders[0], handles_tensor});
-
-      std::vector<tensorflow::Tensor> outputs;
-      XLA_CHECK_OK(session->session()->Run(
-          feed_inputs, {}, {cached_node.operations[0]}, &outputs));
+  for (const auto& session_device_handles : device_handles_map) {
+    XrtSession* session = session_device_handles.first.first;
+    const string& device = session_device_handles.first.second;
+    const std::vector<int64>& device_handles = session_device_handles.second;
+    tensorflow::Tensor handles_tensor(
+        tensorflow::DT_INT64, tensorflow::TensorShape({device_handles.size()}));
+    auto flat_handles_tensor = handles_tensor.flat<tensorflow::int64>();
+    for (size_t i = 0; i < device_handles.size(); ++i) {
+      flat_handles_tensor(i) = device_handles[i];
     }
-    destroy_counter->AddValue(released_handles.size());
+    tensorflow::Scope device_scope =
+        session->root()->WithDevice(TorchDeviceToXrtDevice(device));
+    const XrtSession::CachedNode& cached_node =
+        op_generator(session, device_scope, device);
+    SessionWork* session_work = &(*session_work_map)[session];
+    session_work->feed_inputs.insert({cached_node.holders[0], handles_tensor});
+    session_work->operations.push_back(cached_node.operations[0]);
   }
 }
 
-void XrtComputationClient::StartHandleReleaser() {
-  int64 num_threads = sys_util::GetEnvInt("XLA_HANDLE_RELEASE_THREADS",
-                                          options_.devices.size());
-  triggered_task_.reset(
-      new util::TriggeredTask([this]() { HandleReleaser(); }, num_threads));
-}
-
-void XrtComputationClient::HandleReleaser() {
+void XrtComputationClient::ReleaseHandles(
+    const std::vector<DeviceHandle>& data_handles,
+    const std::vector<DeviceHandle>& compile_handles) {
+  XLA_FN_TRACE("xla_client");
   auto data_op_generator =
       [this](XrtSession* session, const tensorflow::Scope& scope,
              const string& device) -> const XrtSession::CachedNode& {
     return GetReleaseAllocationHandleNode(session, scope, device);
   };
-  ReleaseHandles(&released_data_handles_, data_op_generator,
-                 ReleaseDataHandlesTimeMetric(), DestroyDataHandlesCounter());
-
   auto compile_op_generator =
       [this](XrtSession* session, const tensorflow::Scope& scope,
              const string& device) -> const XrtSession::CachedNode& {
     return GetReleaseCompileHandleNode(session, scope, device);
   };
-  ReleaseHandles(&released_compile_handles_, compile_op_generator,
-                 ReleaseCompileHandlesTimeMetric(),
-                 DestroyCompileHandlesCounter());
+
+  int64 start_time = sys_util::NowNs();
+  XrtSessionCache::SessionMap session_map;
+  std::map<XrtSession*, SessionWork> session_work_map;
+  AddReleaseWork(data_handles, data_op_generator, &session_map,
+                 &session_work_map);
+  AddReleaseWork(compile_handles, compile_op_generator, &session_map,
+                 &session_work_map);
+  // A single session run per worker releases both data and compile handles.
+  util::MultiWait mwait(session_work_map.size());
+  for (auto& session_and_work : session_work_map) {
+    XrtSession* session = session_and_work.first;
+    const SessionWork* session_work = &session_and_work.second;
+    auto runner = [session, session_work]() {
+      std::vector<tensorflow::Tensor> outputs;
+      XLA_CHECK_OK(session->Run(
+          session_work->feed_inputs, {}, session_work->operations, &outputs));
+    };
+    env::ScheduleIoClosure(mwait.Completer(std::move(runner)));
+  }
+  mwait.Wait();
+
+  double elapsed = sys_util::NowNs() - start_time;
+  if (!data_handles.empty()) {
+    ReleaseDataHandlesTimeMetric()->AddSample(elapsed);
+    DestroyDataHandlesCounter()->AddValue(data_handles.size());
+  }
+  if (!compile_handles.empty()) {
+    ReleaseCompileHandlesTimeMetric()->AddSample(elapsed);
+    DestroyCompileHandlesCounter()->AddValue(compile_handles.size());
+  }
+}
+
+void XrtComputationClient::StartHandleReleaser() {
+  int64 num_threads = sys_util::GetEnvInt("XLA_HANDLE_RELEASE_THREADS",
+                                          options_.devices.size());
+  triggered_task_.reset(
+      new util::TriggeredTask([this]() { HandleReleaser(); }, num_threads));
+}
+
+void XrtComputationClient::HandleReleaser() {
+  static thread_local bool bound = affinity::SetThreadCpus(
+      affinity::GetEnvCpus("XLA_HANDLE_RELEASE_CPUS"));
+  (void)bound;
+  std::vector<DeviceHandle> data_handles;
+  std::vector<DeviceHandle> compile_handles;
+  {
+    std::unique_lock<std::mutex> lock(lock_);
+    // Let the releases accumulate for up to the release window time, unless
+    // there are already enough of them to fill a batch.
+    int64 window_ms = GetReleaseWindowMs();
+    if (window_ms > 0) {
+      release_cv_.wait_for(lock, std::chrono::milliseconds(window_ms), [&] {
+        return released_data_handles_.size() +
+                   released_compile_handles_.size() >=
+               GetReleaseBatchSize();
+      });
+    }
+    data_handles.swap(released_data_handles_);
+    compile_handles.swap(released_compile_handles_);
+  }
+  if (!data_handles.empty() || !compile_handles.empty()) {
+    ReleaseQueueDepthMetric()->AddSample(data_handles.size() +
+                                         compile_handles.size());
+    ReleaseHandles(data_handles, compile_handles);
+  }
 }
 
 void XrtComputationClient::ReleaseHandle(int64 handle, const string& device,
@@ -989,11 +1860,76 @@ void XrtComputationClient::ReleaseHandle(int64 handle, const string& device,
   {
     std::lock_guard<std::mutex> lock(lock_);
     handles->push_back({device, handle});
+    if (released_data_handles_.size() + released_compile_handles_.size() ==
+        GetReleaseBatchSize()) {
+      release_cv_.notify_all();
+    }
   }
   triggered_task_->Activate();
 }
 
+int64 XrtComputationClient::GetReleaseWindowMs() {
+  static int64 window_ms =
+      sys_util::GetEnvInt("XLA_HANDLE_RELEASE_WINDOW_MS", 5);
+  return window_ms;
+}
+
+size_t XrtComputationClient::GetReleaseBatchSize() {
+  static size_t batch_size =
+      sys_util::GetEnvInt("XLA_HANDLE_RELEASE_BATCH_SIZE", 256);
+  return batch_size;
+}
+
+size_t XrtComputationClient::GetChainedExecKey(
+    tensorflow::gtl::ArraySlice<const ExecuteChainedOp> ops,
+    const string& device) {
+  size_t key = util::StringHash(device.c_str());
+  for (auto& op : ops) {
+    if (op.device_data != nullptr) {
+      key = util::HashCombine(key, 0x6b43a9b5f1d2);
+    } else {
+      const XrtComputation& xrt_computation =
+          dynamic_cast<const XrtComputation&>(*op.computation);
+      key = util::HashCombine(key, xrt_computation.get_handle());
+      for (auto& input : op.inputs) {
+        key = util::HashCombine(key, input.op_index);
+        key = util::HashCombine(key, input.output_index.value_or(-1));
+      }
+    }
+    for (auto& output : op.outputs) {
+      key = util::HashCombine(key, output.result_index);
+      key = util::HashCombine(key, output.output_index.value_or(-1));
+    }
+  }
+  return key;
+}
+
+int64 XrtComputationClient::GetChainedExecAutoRuns() {
+  static int64 auto_runs =
+      sys_util::GetEnvInt("XRT_CHAINED_EXEC_AUTO_RUNS", 3);
+  return auto_runs;
+}
+
+metrics::Metric* XrtComputationClient::ReleaseQueueDepthMetric() {
+  static metrics::Metric* metric =
+      new metrics::Metric("ReleaseHandlesQueueDepth");
+  return metric;
+}
+
+metrics::Counter* XrtComputationClient::EagerReleaseDataHandlesCounter() {
+  static metrics::Counter* counter =
+      new metrics::Counter("EagerReleaseDataHandles");
+  return counter;
+}
+
+metrics::Metric* XrtComputationClient::PrewarmSessionsMetric() {
+  static metrics::Metric* metric =
+      new metrics::Metric("PrewarmSessionsTime", metrics::MetricFnTime);
+  return metric;
+}
+
 void XrtComputationClient::ReleaseXrtData(XrtData* xrt_data) {
+  MemoryTracker::Get()->Free(xrt_data->handle_ptr.get());
   ReleaseHandle(xrt_data->get_handle(), xrt_data->device(),
                 &released_data_handles_);
   ReleaseDataHandlesCounter()->AddValue(1);
@@ -1176,7 +2112,10 @@ XrtComputationClient::GetComputationResults(
     const string& device) {
   std::vector<DataPtr> results;
   if (xrt_result.dims() == 1) {
+    // The execute operation already returned the exploded tuple handles, within
+    // the same session run, so there is no need for DeconstructTuple() calls.
     auto handles_vec = xrt_result.vec<int64>();
+    results.reserve(handles_vec.size());
     for (int64 i = 0; i < handles_vec.size(); ++i) {
       results.push_back(std::make_shared<XrtData>(
           this, device, ShapeUtil::GetTupleElementShape(result_shape, i),
@@ -1222,6 +2161,64 @@ const std::vector<string>& XrtComputationClient::GetReplicationDevices() const {
   return g_replication_devices;
 }
 
+std::vector<string> XrtComputationClient::GetTopologyOrderedDevices(
+    std::vector<string> devices) const {
+  std::vector<const std::vector<int>*> devices_coords;
+  for (auto& device : devices) {
+    auto target_it = options_.global_device_map.find(device);
+    if (target_it == options_.global_device_map.end()) {
+      return devices;
+    }
+    auto coords_it = device_mesh_coords_.find(target_it->second);
+    if (coords_it == device_mesh_coords_.end()) {
+      return devices;
+    }
+    devices_coords.push_back(&coords_it->second);
+  }
+  if (devices_coords.empty()) {
+    return devices;
+  }
+  // Mesh coordinates are [x, y, ..., c], where 'c' is the core number within
+  // the chip. The devices are walked in boustrophedon order, starting from the
+  // outermost spatial coordinate, then the innermost one, then the cores, and
+  // reversing the direction of a coordinate every time an outer one steps.
+  // This makes every device a mesh neighbor of the previous one, and on a
+  // torus the wraparound link closes the ring between the last and first.
+  size_t rank = devices_coords.front()->size();
+  std::vector<int> dims_order;
+  for (size_t i = rank > 1 ? rank - 1 : 0; i > 0; --i) {
+    dims_order.push_back(i - 1);
+  }
+  if (rank > 0) {
+    dims_order.push_back(rank - 1);
+  }
+  std::vector<int> extents(rank, 0);
+  for (auto coords : devices_coords) {
+    XLA_CHECK_EQ(coords->size(), rank);
+    for (size_t i = 0; i < rank; ++i) {
+      extents[i] = std::max(extents[i], (*coords)[i] + 1);
+    }
+  }
+  std::vector<std::pair<int64, size_t>> keyed_devices;
+  for (size_t i = 0; i < devices_coords.size(); ++i) {
+    int64 key = 0;
+    for (auto dim : dims_order) {
+      int64 coord = (*devices_coords[i])[dim];
+      if (key % 2 != 0) {
+        coord = extents[dim] - 1 - coord;
+      }
+      key = key * extents[dim] + coord;
+    }
+    keyed_devices.emplace_back(key, i);
+  }
+  std::stable_sort(keyed_devices.begin(), keyed_devices.end());
+  std::vector<string> ordered_devices;
+  for (auto& key_device : keyed_devices) {
+    ordered_devices.push_back(std::move(devices[key_device.second]));
+  }
+  return ordered_devices;
+}
+
 void XrtComputationClient::SetRngSeed(size_t seed) { rng_seed_ = seed; }
 
 void XrtComputationClient::InitSession(XrtSession* session) const {
@@ -1238,13 +2235,24 @@ void XrtComputationClient::InitSession(XrtSession* session) const {
       {16, &XrtComputationClient::GetReleaseCompileHandleNode},
       {16, &XrtComputationClient::GetSubTupleNode},
   };
-  auto devices = GetLocalDevices();
+  // Only the nodes of the default device are created upfront, unless
+  // XRT_EAGER_DEVICE_INIT is set, as the other devices get theirs created on
+  // first use.
+  static const bool eager_init =
+      sys_util::GetEnvBool("XRT_EAGER_DEVICE_INIT", false);
+  auto local_devices = GetLocalDevices();
+  std::vector<string> devices;
+  for (auto& device : local_devices) {
+    if (eager_init || device == options_.default_device) {
+      devices.push_back(device);
+    }
+  }
   for (auto& device : devices) {
     // HACK: The XRT ops on the remote GRPC service has only recently been
     // enabled, so until TF 1.14 is out, we cannot add XRT ops on CPU.
     // If there is only one device, even if CPU, this is the local session,
     // which carries the XRT op (as we include them in the BUILD).
-    if (device.compare(0, 4, "CPU:") == 0 && devices.size() > 1) {
+    if (device.compare(0, 4, "CPU:") == 0 && local_devices.size() > 1) {
       continue;
     }
     const string& xrt_device = TorchDeviceToXrtDevice(device);
@@ -1362,6 +2370,75 @@ const XrtSession::CachedNode& XrtComputationClient::GetAllocateNode(
   return cache->Get();
 }
 
+const XrtSession::CachedNode& XrtComputationClient::GetCopyNode(
+    XrtSession* session, const tensorflow::Scope& src_scope,
+    const tensorflow::Scope& dst_scope, const string& src_device,
+    const string& dst_device, const Shape& shape) const {
+  // Like for the allocation node, the shape and layout attributes need to be
+  // part of the key, together with the source device the read is placed on.
+  std::stringstream ss;
+  ss << "XRTCopy(" << src_device << ", " << shape << ")";
+  XrtSession::NodeCache* cache =
+      session->GetNodeCache(XrtSession::GetCacheKey(ss.str(), dst_device));
+  if (cache->Empty()) {
+    XLA_COUNTER("XRTCopy_Empty", 1);
+    std::vector<tensorflow::ops::Placeholder> holders(
+        {tensorflow::ops::Placeholder(src_scope, tensorflow::DT_INT64)});
+    tensorflow::ops::XRTReadToTensor read(
+        src_scope, holders[0], {XlaTypeToDataType(shape.element_type())});
+    std::vector<int> layout(shape.layout().minor_to_major().begin(),
+                            shape.layout().minor_to_major().end());
+    tensorflow::ops::XRTAllocateFromTensor::Attrs alloc_attrs =
+        tensorflow::ops::XRTAllocateFromTensor::Layouts(layout);
+    cache->Add(std::make_shared<XrtSession::CachedNode>(
+        tensorflow::ops::XRTAllocateFromTensor(
+            dst_scope, {read.tensors[0]},
+            {tensorflow::TensorShape(shape.dimensions())}, alloc_attrs),
+        std::move(holders)));
+  }
+  return cache->Get();
+}
+
+const XrtSession::CachedNode& XrtComputationClient::GetAllocateTupleNode(
+    XrtSession* session, const tensorflow::Scope& scope, const string& device,
+    tensorflow::gtl::ArraySlice<const Shape> shapes) const {
+  // Like for the single tensor allocation, the shapes and layouts are node
+  // attributes, so they must be part of the key.
+  std::stringstream ss;
+  ss << "XRTAllocateFromTensorTuple(";
+  for (auto& shape : shapes) {
+    ss << shape << ";";
+  }
+  ss << ")";
+  XrtSession::NodeCache* cache =
+      session->GetNodeCache(XrtSession::GetCacheKey(ss.str(), device));
+  if (cache->Empty()) {
+    XLA_COUNTER("XRTAllocateFromTensorTuple_Empty", 1);
+    std::vector<tensorflow::ops::Placeholder> holders;
+    std::vector<tensorflow::Input> inputs;
+    std::vector<tensorflow::TensorShape> tensor_shapes;
+    std::vector<int> layouts;
+    for (auto& shape : shapes) {
+      holders.push_back(tensorflow::ops::Placeholder(
+          scope, XlaTypeToDataType(shape.element_type()),
+          tensorflow::ops::Placeholder::Shape(
+              MakeEquivalentTensorShape(shape))));
+      inputs.push_back(holders.back().output);
+      tensor_shapes.push_back(tensorflow::TensorShape(shape.dimensions()));
+      layouts.insert(layouts.end(), shape.layout().minor_to_major().begin(),
+                     shape.layout().minor_to_major().end());
+    }
+    tensorflow::ops::XRTAllocateFromTensor::Attrs alloc_attrs =
+        tensorflow::ops::XRTAllocateFromTensor::Layouts(layouts).MakeTuple(
+            true);
+    cache->Add(std::make_shared<XrtSession::CachedNode>(
+        tensorflow::ops::XRTAllocateFromTensor(
+            scope, tensorflow::InputList(inputs), tensor_shapes, alloc_attrs),
+        std::move(holders)));
+  }
+  return cache->Get();
+}
+
 const XrtSession::CachedNode&
 XrtComputationClient::GetReleaseAllocationHandleNode(
     XrtSession* session, const tensorflow::Scope& scope,
@@ -1451,6 +2528,34 @@ tensorflow::DataType XrtComputationClient::XlaTypeToDataType(
               << " to tensorflow DataType";
 }
 
+tensorflow::Tensor XrtComputationClient::MakeSourceTensor(
+    const TensorSource& source, const string& device) {
+  tensorflow::DataType dtype = XlaTypeToDataType(source.shape.element_type());
+  tensorflow::TensorShape tensor_shape =
+      MakeEquivalentTensorShape(source.shape);
+  if (source.data != nullptr &&
+      reinterpret_cast<uintptr_t>(source.data) %
+              tensorflow::Allocator::kAllocatorAlignment ==
+          0) {
+    size_t size = ShapeUtil::ByteSizeOfElements(source.shape);
+    ExternalTensorBuffer* buffer =
+        new ExternalTensorBuffer(source.data, size, source.data_owner);
+    tensorflow::Tensor tensor(dtype, tensor_shape, buffer);
+    // The tensor acquired its own reference.
+    buffer->Unref();
+    TransferToServerZeroCopyCounter()->AddValue(1);
+    return tensor;
+  }
+  // Stage the data on the CPUs next to the device (XLA_DEVICE_CPUS), so that
+  // the staging buffer comes from the allocator cache of the device NUMA node,
+  // and its fresh pages are first touched there.
+  affinity::ScopedThreadCpus scoped_cpus(affinity::GetDeviceCpus(device));
+  tensorflow::Tensor tensor(TensorAllocator::Get(), dtype, tensor_shape);
+  auto tdata = tensor.tensor_data();
+  source.populate_fn(source, const_cast<char*>(tdata.data()), tdata.size());
+  return tensor;
+}
+
 tensorflow::TensorShape XrtComputationClient::MakeEquivalentTensorShape(
     const Shape& shape) {
   Shape eqiv_shape =
@@ -1489,6 +2594,42 @@ tensorflow::ConfigProto XrtComputationClient::CreateConfigProto(
   return config;
 }
 
+bool XrtComputationClient::SetGrpcCompression(
+    tensorflow::ConfigProto* config) {
+  string compression = sys_util::GetEnvString("XRT_GRPC_COMPRESSION", "");
+  if (compression.empty()) {
+    return false;
+  }
+  tensorflow::RPCOptions* rpc_options = config->mutable_rpc_options();
+  rpc_options->set_compression_algorithm(compression);
+  rpc_options->set_compression_level(
+      sys_util::GetEnvInt("XRT_GRPC_COMPRESSION_LEVEL", 3));
+  return true;
+}
+
+int64 XrtComputationClient::GetCompressionMinBytes() {
+  static const int64 min_bytes =
+      sys_util::GetEnvInt("XRT_GRPC_COMPRESSION_MIN_BYTES", 0);
+  return min_bytes;
+}
+
+XrtSessionCache* XrtComputationClient::GetTransferSessionCache(
+    const Shape& shape) const {
+  // Random looking floating point data (like weights and activations) does
+  // not compress well enough to pay for the compression time, unless
+  // XRT_GRPC_COMPRESS_FLOATS says otherwise.
+  static const bool compress_floats =
+      sys_util::GetEnvBool("XRT_GRPC_COMPRESS_FLOATS", false);
+  if (compressed_session_cache_ != nullptr &&
+      ShapeUtil::ByteSizeOf(shape) >= GetCompressionMinBytes() &&
+      (compress_floats ||
+       !primitive_util::IsFloatingPointType(shape.element_type()))) {
+    XLA_COUNTER("CompressedTransfers", 1);
+    return compressed_session_cache_.get();
+  }
+  return alloc_session_cache_.get();
+}
+
 void XrtComputationClient::MaybeCreateLocalService(
     const XrtComputationClient::Options& options) {
   static const string* const grpc_root = new string("grpc://localhost:");
@@ -2,6 +2,7 @@
 #define TENSORFLOW_COMPILER_XLA_RPC_XRT_COMPUTATION_CLIENT_H_
 
 #include <atomic>
+#include <condition_variable>
 #include <functional>
 #include <map>
 #include <memory>
@@ -19,6 +20,7 @@
 #include "tensorflow/compiler/xla/xla_client/debug_macros.h"
 #include "tensorflow/compiler/xla/xla_client/mesh_service.h"
 #include "tensorflow/compiler/xla/xla_client/metrics.h"
+#include "tensorflow/compiler/xla/xla_client/persistent_cache.h"
 #include "tensorflow/compiler/xla/xla_client/triggered_task.h"
 #include "tensorflow/compiler/xla/xla_client/util.h"
 #include "tensorflow/compiler/xla/xla_client/xrt_session.h"
@@ -55,7 +57,11 @@ class XrtComputationClient : public ComputationClient {
     XrtData(XrtComputationClient* self, string device, Shape device_shape,
             int64 handle)
         : Data(std::move(device), std::move(device_shape)),
-          handle_ptr(std::make_shared<XrtHandle>(self, handle)) {}
+          handle_ptr(std::make_shared<XrtHandle>(self, handle)) {
+      SetHasValue(true);
+      MemoryTracker::Get()->Allocate(handle_ptr.get(), this->device(), shape(),
+                                     MemoryTracker::Category::kActivation);
+    }
 
     ~XrtData() override {
       if (handle_ptr != nullptr && handle_ptr.use_count() == 1) {
@@ -67,9 +73,16 @@ class XrtComputationClient : public ComputationClient {
 
     void Assign(const Data& data) override;
 
-    bool HasValue() const override { return handle_ptr != nullptr; }
+    // Drops the handle, without queueing its release.
+    void ResetHandle() {
+      handle_ptr.reset();
+      SetHasValue(false);
+    }
+
+    void SetMemoryCategory(MemoryTracker::Category category) override;
 
     XrtHandlePtr handle_ptr;
+    absl::optional<MemoryTracker::Category> memory_category;
   };
 
   struct XrtComputation : public Computation {
@@ -141,6 +154,13 @@ class XrtComputationClient : public ComputationClient {
   std::vector<Literal> TransferFromServer(
       tensorflow::gtl::ArraySlice<const DataPtr> handles) override;
 
+  void TransferFromServer(tensorflow::gtl::ArraySlice<const DataPtr> handles,
+                          const TransferDataFn& data_fn) override;
+
+  std::vector<DataPtr> TransferToDevice(
+      tensorflow::gtl::ArraySlice<const DataPtr> handles,
+      const string& dst_device) override;
+
   std::vector<ComputationPtr> Compile(
       std::vector<CompileInstance> instances) override;
 
@@ -155,6 +175,14 @@ class XrtComputationClient : public ComputationClient {
       tensorflow::gtl::ArraySlice<const string> devices,
       const ExecuteReplicatedOptions& options) override;
 
+  // The replicas executed through the same session (that is, going to the same
+  // worker entry point) complete together.
+  std::vector<ReplicaResult> ExecuteReplicatedAsync(
+      const Computation& computation,
+      const std::vector<std::vector<DataPtr>>& arguments,
+      tensorflow::gtl::ArraySlice<const string> devices,
+      const ExecuteReplicatedOptions& options) override;
+
   std::vector<std::vector<DataPtr>> ExecuteParallel(
       tensorflow::gtl::ArraySlice<const Computation* const> computations,
       const std::vector<std::vector<DataPtr>>& arguments,
@@ -168,6 +196,8 @@ class XrtComputationClient : public ComputationClient {
   std::vector<std::vector<DataPtr>> DeconstructTuple(
       tensorflow::gtl::ArraySlice<const DataPtr> tuples) override;
 
+  void ReleaseConsumedData(std::vector<DataPtr>* datas) override;
+
   string GetResourceDomain(const string& device) const override;
 
   string GetDefaultDevice() const override;
@@ -182,6 +212,9 @@ class XrtComputationClient : public ComputationClient {
 
   const std::vector<string>& GetReplicationDevices() const override;
 
+  std::vector<string> GetTopologyOrderedDevices(
+      std::vector<string> devices) const override;
+
   void SetRngSeed(size_t seed) override;
 
   static string GetMultiProcessingDevice();
@@ -214,6 +247,9 @@ class XrtComputationClient : public ComputationClient {
     string serialized_computation;
   };
 
+  using CompilationCache = util::ShardedCache<CompilationCacheKey, Computation,
+                                              CompilationCacheKey::Hash>;
+
   // When we split a batch operation into per-session batches, we use this data
   // structure to collect the per-session work.
   struct SessionWork {
@@ -240,6 +276,50 @@ class XrtComputationClient : public ComputationClient {
       tensorflow::gtl::ArraySlice<const string> devices,
       const Shape* output_shape) const;
 
+  // Retrieves the key used to index a computation within the persistent cache.
+  // Unlike the in-memory cache key, this does not include the resource domain
+  // (which is host specific), but only the device kind, so that the cache
+  // folder can be shared among hosts with the same topology.
+  static string GetPersistentCacheKey(const string& device,
+                                      const string& serialized_computation);
+
+  // Returns the mesh client used to share the compilations among the processes
+  // of a multi-processing setup (XRT_SHARED_COMPILE), or nullptr if disabled.
+  static const service::MeshClient* GetSharedCompileClient();
+
+  // Compiles the computations whose shared_keys entry is not empty, once per
+  // host. The process claiming a key first within the mesh compiles it, while
+  // the other ones wait for its completion (up to XRT_SHARED_COMPILE_WAIT
+  // seconds) before compiling it themselves, hitting the worker side
+  // compilation cache. The add_compile_work and run_compile_work functions
+  // queue the compilation of an instance, and run the queued ones.
+  void CompileShared(const service::MeshClient* shared_client,
+                     const std::vector<string>& shared_keys,
+                     const std::function<void(size_t)>& add_compile_work,
+                     const std::function<void()>& run_compile_work);
+
+  // Returns the mesh client hosting the compile cache shared by all the hosts
+  // of a distributed job (XRT_CLUSTER_COMPILE_CACHE), or nullptr if disabled.
+  // The cache only stores the computation fingerprints, since XRT has no way to
+  // import an executable compiled by another host, so it is off by default and
+  // only useful to observe the cross host hit rate.
+  static const service::MeshClient* GetClusterCompileClient();
+
+  // Looks up the fingerprints of the cache misses (the null results) within
+  // the cluster compile cache, with a single call to the mesh service, and sets
+  // the hits entries of the ones which some host has already compiled.
+  void LookupClusterCache(const service::MeshClient* cluster_client,
+                          const std::vector<CompileInstance>& instances,
+                          const std::vector<CompilationCacheKey>& cache_keys,
+                          const std::vector<ComputationPtr>& results,
+                          std::vector<uint8>* hits) const;
+
+  // Checks whether the persistent cache contains the given computation, and
+  // updates the persistent cache metrics accordingly. The computation gets
+  // compiled anyway (see persistent_cache_), a hit only skips storing it.
+  bool LookupPersistentCache(const string& device,
+                             const string& serialized_computation) const;
+
   tensorflow::Tensor GetArgumentsInputs(
       tensorflow::gtl::ArraySlice<const DataPtr> arguments,
       const string& device);
@@ -258,6 +338,20 @@ class XrtComputationClient : public ComputationClient {
       tensorflow::gtl::ArraySlice<const string> devices,
       tensorflow::ClientSession::FeedType* feed_inputs);
 
+  // Groups the replica indices by the session which will run them.
+  std::map<XrtSession*, std::vector<size_t>> GetSessionReplicas(
+      const XrtSessionCache::SessionMap& session_map,
+      tensorflow::gtl::ArraySlice<const string> devices) const;
+
+  // Runs the replicas execute operations on session, returning their results
+  // in the replicas order.
+  std::vector<std::vector<DataPtr>> RunSessionReplicas(
+      XrtSession* session, const std::vector<size_t>& replicas,
+      const std::vector<tensorflow::Output>& exec_ops,
+      tensorflow::gtl::ArraySlice<const Computation* const> computations,
+      tensorflow::gtl::ArraySlice<const string> devices,
+      const tensorflow::ClientSession::FeedType& feed_inputs);
+
   std::vector<std::vector<DataPtr>> RunComputations(
       const XrtSessionCache::SessionMap& session_map,
       const std::vector<tensorflow::Output>& exec_ops,
@@ -274,11 +368,19 @@ class XrtComputationClient : public ComputationClient {
   std::pair<Worker, string> GetWorkerForXrtDevice(
       const string& xrt_device) const;
 
-  void ReleaseHandles(
-      std::vector<DeviceHandle>* handles,
+  // Appends to session_work_map the operations to release the given handles,
+  // using op_generator to create the release nodes.
+  void AddReleaseWork(
+      const std::vector<DeviceHandle>& handles,
       const std::function<const XrtSession::CachedNode&(
           XrtSession*, const tensorflow::Scope&, const string&)>& op_generator,
-      metrics::Metric* timed_metric, metrics::Counter* destroy_counter);
+      XrtSessionCache::SessionMap* session_map,
+      std::map<XrtSession*, SessionWork>* session_work_map);
+
+  // Releases the data and compile handles, using one session run for each of
+  // the workers involved.
+  void ReleaseHandles(const std::vector<DeviceHandle>& data_handles,
+                      const std::vector<DeviceHandle>& compile_handles);
 
   void ReleaseHandle(int64 handle, const string& device,
                      std::vector<DeviceHandle>* handles);
@@ -287,6 +389,11 @@ class XrtComputationClient : public ComputationClient {
 
   void ReleaseXrtComputation(XrtComputation* xrt_computation);
 
+  // Creates the sessions for the workers of the local devices in parallel,
+  // ahead of their first use. Only the worker of the default device is
+  // prewarmed if default_worker is true, or only the other ones if not.
+  void PrewarmSessions(bool default_worker);
+
   // Starts the handle releaser thread (which runs the HandleReleaser() API).
   void StartHandleReleaser();
 
@@ -306,6 +413,30 @@ class XrtComputationClient : public ComputationClient {
       const tensorflow::Tensor& xrt_result, const Shape& result_shape,
       const string& device);
 
+  // Uploads a tensor in chunks of (at most) chunk_bytes size, and assembles
+  // them back on the device.
+  DataPtr TransferToServerChunked(const TensorSource& source,
+                                  int64 chunk_bytes);
+
+  // Uploads the tensors at the given indices, which must have the same device
+  // and element type, packed within a single buffer, and slices them out of
+  // it on the device.
+  std::vector<DataPtr> TransferToServerPacked(
+      tensorflow::gtl::ArraySlice<const TensorSource> tensors,
+      tensorflow::gtl::ArraySlice<const size_t> indices);
+
+  // Uploads the tensors at the given indices, which must have the same device
+  // but can have any element type, as a single tuple allocation, and splits
+  // the tuple in the per tensor handles on the device.
+  std::vector<DataPtr> TransferToServerCoalesced(
+      tensorflow::gtl::ArraySlice<const TensorSource> tensors,
+      tensorflow::gtl::ArraySlice<const size_t> indices);
+
+  // Runs the XRT read operations for the given handles, and returns the
+  // serialized LiteralProto tensors, in the same order as the handles.
+  std::vector<tensorflow::Tensor> ReadServerLiterals(
+      tensorflow::gtl::ArraySlice<const DataPtr> handles);
+
   void InitSession(XrtSession* session) const;
 
   // Implement the chained execution using the XRTExecuteChained op support.
@@ -319,6 +450,13 @@ class XrtComputationClient : public ComputationClient {
       tensorflow::gtl::ArraySlice<const ExecuteChainedOp> ops,
       const string& device);
 
+  // Runs the chained execution with the strategy which has been measured to be
+  // the fastest for the given chain. The first runs of every chain alternate
+  // between the two strategies, to collect the timings.
+  std::vector<DataPtr> ExecuteChainedAuto(
+      tensorflow::gtl::ArraySlice<const ExecuteChainedOp> ops,
+      const string& device);
+
   // Creates an XRT graph with an XRTCompile operation:
   //
   //  XRTCompile(
@@ -387,6 +525,38 @@ class XrtComputationClient : public ComputationClient {
                                                 const string& device,
                                                 const Shape& shape) const;
 
+  // Creates the nodes copying the src_device allocation of the given shape to
+  // the device of the dst_scope, without going through the client:
+  //
+  //  XRTAllocateFromTensor(
+  //    XRTReadToTensor(
+  //      holders[0]
+  //    )
+  //  )
+  //
+  // With:
+  //  holders[0] = The handle place-holder to be copied (DT_INT64)
+  const XrtSession::CachedNode& GetCopyNode(XrtSession* session,
+                                            const tensorflow::Scope& src_scope,
+                                            const tensorflow::Scope& dst_scope,
+                                            const string& src_device,
+                                            const string& dst_device,
+                                            const Shape& shape) const;
+
+  // Creates an XRTAllocateFromTensor node for creating a device tuple with
+  // elements of the given shapes and layouts:
+  //
+  //  XRTAllocateFromTensor(
+  //    holders[0], ..., holders[N-1]
+  //  )
+  //
+  // With:
+  //  holders[i] = Tensor place-holder for the i-th element of the tuple
+  const XrtSession::CachedNode& GetAllocateTupleNode(
+      XrtSession* session, const tensorflow::Scope& scope,
+      const string& device,
+      tensorflow::gtl::ArraySlice<const Shape> shapes) const;
+
   // Creates an XRTReleaseAllocationHandle node:
   //
   //  XRTReleaseAllocationHandle(
@@ -436,6 +606,13 @@ class XrtComputationClient : public ComputationClient {
 
   static tensorflow::TensorShape MakeEquivalentTensorShape(const Shape& shape);
 
+  // Creates the tensor to be fed to the XRT allocation, either wrapping the
+  // source data (if available and suitably aligned), or populating a new one.
+  // The device is the effective device of the source, whose CPUs (if any, see
+  // XLA_DEVICE_CPUS) run the population of the new tensor.
+  static tensorflow::Tensor MakeSourceTensor(const TensorSource& source,
+                                             const string& device);
+
   // Builds an argument vector usable in a replicated context, out of a single
   // replica argument vector. Essentially turns a [N] into a [1][N].
   static std::vector<std::vector<DataPtr>> BuildParallelArguments(
@@ -448,27 +625,107 @@ class XrtComputationClient : public ComputationClient {
 
   static tensorflow::ConfigProto CreateConfigProto(const Options& options);
 
+  // Sets the gRPC compression configured with XRT_GRPC_COMPRESSION and
+  // XRT_GRPC_COMPRESSION_LEVEL into config. Returns false if no compression
+  // is configured.
+  static bool SetGrpcCompression(tensorflow::ConfigProto* config);
+
+  // The size above which transfers are compressed, with all the other
+  // traffic going uncompressed (XRT_GRPC_COMPRESSION_MIN_BYTES). If zero, all
+  // the traffic is compressed, when compression is enabled.
+  static int64 GetCompressionMinBytes();
+
+  // Returns the session cache which the transfers of data with the given
+  // shape, in either direction, should use.
+  XrtSessionCache* GetTransferSessionCache(const Shape& shape) const;
+
   static tensorflow::tpu::TopologyProto InitializeAndFetchTopology(
       const string& job, int task_no, const string& worker_host_port,
       const tensorflow::ConfigProto& config);
 
+  static size_t GetCompilationCacheMaxSize();
+
+  static CompilationCache::SizeFn GetCompilationCacheSizeFn();
+
+  // The time the handle releaser waits for release requests to accumulate,
+  // before sending them to the server (XLA_HANDLE_RELEASE_WINDOW_MS).
+  static int64 GetReleaseWindowMs();
+
+  // The number of pending release requests which triggers a release without
+  // waiting for the release window to expire (XLA_HANDLE_RELEASE_BATCH_SIZE).
+  static size_t GetReleaseBatchSize();
+
+  static metrics::Metric* ReleaseQueueDepthMetric();
+
+  static metrics::Counter* EagerReleaseDataHandlesCounter();
+
+  static metrics::Metric* PrewarmSessionsMetric();
+
+  // Computes a key identifying the structure of a chained execution, which does
+  // not depend on the device data fed to it.
+  static size_t GetChainedExecKey(
+      tensorflow::gtl::ArraySlice<const ExecuteChainedOp> ops,
+      const string& device);
+
+  // The number of timed runs of each chained execution strategy, before the
+  // fastest one gets selected (XRT_CHAINED_EXEC_AUTO_RUNS).
+  static int64 GetChainedExecAutoRuns();
+
   // Checks whether a local GRPC service is required, and starts it if need it.
   static void MaybeCreateLocalService(
       const XrtComputationClient::Options& options);
 
+  // The strategies used by the chained execution.
+  enum ChainedExecMode {
+    kChainedExecXrt = 0,
+    kChainedExecSplit = 1,
+  };
+
+  // The timings of the chained execution strategies for a given chain, used by
+  // ExecuteChainedAuto().
+  struct ChainedExecStats {
+    int64 runs[2] = {0, 0};
+    int64 best_ns[2] = {0, 0};
+    absl::optional<ChainedExecMode> selected;
+  };
+
+  using ChainedExecStatsCache = util::Cache<size_t, ChainedExecStats>;
+
   Options options_;
   std::mutex lock_;
   std::map<string, std::vector<int>> device_mesh_coords_;
   std::unique_ptr<XrtSessionCache> session_cache_;
+  // The data transfers run on their own sessions (hence gRPC streams, when
+  // XRT_GRPC_MULTISTREAM is enabled), so that bulk transfers do not delay the
+  // latency sensitive execute calls.
   std::unique_ptr<XrtSessionCache> alloc_session_cache_;
+  // The sessions used by the transfers to be compressed, if compression is
+  // enabled for the large transfers only.
+  std::unique_ptr<XrtSessionCache> compressed_session_cache_;
+  // Handle releases use their own sessions, so that they do not get queued
+  // behind the execute calls.
+  std::unique_ptr<XrtSessionCache> release_session_cache_;
   std::unique_ptr<util::TriggeredTask> triggered_task_;
-  util::Cache<CompilationCacheKey, Computation, CompilationCacheKey::Hash>
-      compilation_cache_;
+  CompilationCache compilation_cache_;
+  // The optional on-disk tier of the compilation cache, enabled by setting the
+  // XLA_PERSISTENT_CACHE_PATH environment variable. XRT has no way to import an
+  // executable, so the entries only hold the serialized computations, and a hit
+  // still issues an XRTCompile. That is only cheap when the XRT server still
+  // holds the executable within its own compilation cache (like when the
+  // client process restarts against the same server), so the tier mostly
+  // tracks which computations got compiled before, through the
+  // PersistentCacheHit and PersistentCacheMiss counters.
+  std::unique_ptr<util::PersistentCache> persistent_cache_;
   std::atomic<size_t> rng_seed_;
+  ChainedExecStatsCache chained_exec_stats_;
+  // Protects the content of the ChainedExecStats objects.
+  std::mutex chained_exec_lock_;
   // Access to the following members must be done while holding lock_.
   // XRT thread safety semantics.
   std::vector<DeviceHandle> released_data_handles_;
   std::vector<DeviceHandle> released_compile_handles_;
+  // Signaled when the pending releases fill a batch.
+  std::condition_variable release_cv_;
   // The mesh service which is used to coordinate all the client hosts which are
   // feeding different TPU devices in a POD (or slice) training.
   std::unique_ptr<service::MeshService> mesh_service_;
@@ -1,8 +1,23 @@
 #include "tensorflow/compiler/xla/xla_client/xrt_session.h"
 
+#include <algorithm>
+
 #include "absl/strings/str_cat.h"
+#include "tensorflow/compiler/xla/xla_client/metrics.h"
+#include "tensorflow/compiler/xla/xla_client/sys_util.h"
 
 namespace xla {
+namespace {
+
+// Sessions running more distinct signatures than this use the plain Run() API
+// for the new ones, so that the callables of a session stay bounded.
+size_t GetMaxCallables() {
+  static size_t max_callables =
+      sys_util::GetEnvInt("XRT_SESSION_MAX_CALLABLES", 1024);
+  return max_callables;
+}
+
+}  // namespace
 
 XrtSession::XrtSession(const tensorflow::SessionOptions& session_options)
     : target_(session_options.target),
@@ -19,4 +34,74 @@ string XrtSession::GetCacheKey(const string& op_name, const string& device) {
   return absl::StrCat(op_name, ";", device);
 }
 
+tensorflow::Status XrtSession::Run(
+    const tensorflow::ClientSession::FeedType& feed_inputs,
+    const std::vector<tensorflow::Output>& fetch_outputs,
+    std::vector<tensorflow::Tensor>* outputs) {
+  return Run(feed_inputs, fetch_outputs, {}, outputs);
+}
+
+tensorflow::Status XrtSession::Run(
+    const tensorflow::ClientSession::FeedType& feed_inputs,
+    const std::vector<tensorflow::Output>& fetch_outputs,
+    const std::vector<tensorflow::Operation>& run_outputs,
+    std::vector<tensorflow::Tensor>* outputs) {
+  // The feeds are sorted by name, so that the signature (and the order of the
+  // callable feed tensors) does not depend on the feed map iteration order.
+  std::vector<std::pair<string, const tensorflow::Tensor*>> feeds;
+  feeds.reserve(feed_inputs.size());
+  for (auto& feed : feed_inputs) {
+    TF_RETURN_IF_ERROR(feed.second.status);
+    feeds.emplace_back(feed.first.name(), &feed.second.tensor);
+  }
+  std::sort(feeds.begin(), feeds.end(),
+            [](const std::pair<string, const tensorflow::Tensor*>& f1,
+               const std::pair<string, const tensorflow::Tensor*>& f2) {
+              return f1.first < f2.first;
+            });
+  string key;
+  for (auto& feed : feeds) {
+    absl::StrAppend(&key, feed.first, ",");
+  }
+  absl::StrAppend(&key, ";");
+  for (auto& output : fetch_outputs) {
+    absl::StrAppend(&key, output.name(), ",");
+  }
+  absl::StrAppend(&key, ";");
+  for (auto& operation : run_outputs) {
+    absl::StrAppend(&key, operation.node()->name(), ",");
+  }
+
+  auto it = callables_.find(key);
+  if (it == callables_.end()) {
+    if (callables_.size() >= GetMaxCallables()) {
+      XLA_COUNTER("XrtSessionUncachedRuns", 1);
+      return session_.Run(feed_inputs, fetch_outputs, run_outputs, outputs);
+    }
+    tensorflow::CallableOptions options;
+    for (auto& feed : feeds) {
+      options.add_feed(feed.first);
+    }
+    for (auto& output : fetch_outputs) {
+      options.add_fetch(output.name());
+    }
+    for (auto& operation : run_outputs) {
+      options.add_target(operation.node()->name());
+    }
+    tensorflow::ClientSession::CallableHandle handle;
+    TF_RETURN_IF_ERROR(session_.MakeCallable(options, &handle));
+    XLA_COUNTER("XrtSessionCallables", 1);
+    it = callables_.emplace(std::move(key), handle).first;
+  }
+
+  std::vector<tensorflow::Tensor> feed_tensors;
+  feed_tensors.reserve(feeds.size());
+  for (auto& feed : feeds) {
+    feed_tensors.push_back(*feed.second);
+  }
+  outputs->clear();
+  return session_.RunCallable(it->second, feed_tensors, outputs,
+                              /*run_metadata=*/nullptr);
+}
+
 }  // namespace xla
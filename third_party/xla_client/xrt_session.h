@@ -4,7 +4,9 @@
 #include <functional>
 #include <map>
 #include <memory>
+#include <unordered_map>
 #include <utility>
+#include <vector>
 
 #include "tensorflow/cc/client/client_session.h"
 #include "tensorflow/cc/framework/ops.h"
@@ -82,6 +84,20 @@ class XrtSession {
 
   NodeCache* GetNodeCache(const string& key) { return &node_cache_[key]; }
 
+  // Same as the ClientSession Run() APIs, but the feeds/fetches/targets
+  // signatures get bound to session callables, the first time they are seen,
+  // so that the following runs skip the graph lookup and the feeds validation.
+  tensorflow::Status Run(
+      const tensorflow::ClientSession::FeedType& feed_inputs,
+      const std::vector<tensorflow::Output>& fetch_outputs,
+      std::vector<tensorflow::Tensor>* outputs);
+
+  tensorflow::Status Run(
+      const tensorflow::ClientSession::FeedType& feed_inputs,
+      const std::vector<tensorflow::Output>& fetch_outputs,
+      const std::vector<tensorflow::Operation>& run_outputs,
+      std::vector<tensorflow::Tensor>* outputs);
+
   void Reset();
 
   static string GetCacheKey(const string& op_name, const string& device);
@@ -91,6 +107,8 @@ class XrtSession {
   tensorflow::Scope root_;
   tensorflow::ClientSession session_;
   std::map<string, NodeCache> node_cache_;
+  std::unordered_map<string, tensorflow::ClientSession::CallableHandle>
+      callables_;
 };
 
 }  // namespace xla
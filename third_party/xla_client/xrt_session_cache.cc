@@ -1,7 +1,9 @@
 #include "tensorflow/compiler/xla/xla_client/xrt_session_cache.h"
 
 #include "tensorflow/compiler/xla/xla_client/metrics.h"
+#include "tensorflow/compiler/xla/xla_client/multi_wait.h"
 #include "tensorflow/compiler/xla/xla_client/sys_util.h"
+#include "tensorflow/compiler/xla/xla_client/thread_pool.h"
 
 namespace xla {
 
@@ -10,14 +12,22 @@ XrtSessionCache::XrtSessionCache(tensorflow::ConfigProto config,
     : config_(std::move(config)), initfn_(std::move(initfn)) {}
 
 XrtSessionCache::Ref XrtSessionCache::GetSession(const string& target) {
-  std::lock_guard<std::mutex> lock(lock_);
-  auto& session_queue = session_map_[target];
-  if (!session_queue.empty()) {
-    std::shared_ptr<XrtSession> session = std::move(session_queue.back());
-    session_queue.pop_back();
+  std::shared_ptr<XrtSession> session;
+  {
+    std::lock_guard<std::mutex> lock(lock_);
+    auto& session_queue = session_map_[target];
+    if (!session_queue.empty()) {
+      session = std::move(session_queue.back());
+      session_queue.pop_back();
+    }
+  }
+  if (session != nullptr) {
     session->Reset();
     return Ref(this, std::move(session));
   }
+  // Creating (and initializing) a session is slow, so it happens outside the
+  // lock, to not hold back the threads fetching cached sessions.
+  XLA_COUNTER("XrtSessionCacheMiss", 1);
   return Ref(this, CreateSession(target));
 }
 
@@ -35,6 +45,18 @@ void XrtSessionCache::AddSession(std::shared_ptr<XrtSession> session) {
   session_map_[session->target()].push_back(std::move(session));
 }
 
+void XrtSessionCache::Prewarm(const std::vector<string>& targets,
+                              size_t count) {
+  util::MultiWait mwait(targets.size() * count);
+  for (auto& target : targets) {
+    for (size_t i = 0; i < count; ++i) {
+      auto creator = [&, this]() { AddSession(CreateSession(target)); };
+      env::ScheduleIoClosure(mwait.Completer(std::move(creator)));
+    }
+  }
+  mwait.Wait();
+}
+
 std::shared_ptr<XrtSession> XrtSessionCache::CreateSession(
     const string& target) const {
   XLA_COUNTER("XrtSessionCount", 1);
@@ -43,16 +65,9 @@ std::shared_ptr<XrtSession> XrtSessionCache::CreateSession(
   session_options.target = target;
   session_options.config = config_;
 
+  // The compression, if any, comes with the config.
   tensorflow::RPCOptions* rpc_options =
       session_options.config.mutable_rpc_options();
-
-  string compression = sys_util::GetEnvString("XRT_GRPC_COMPRESSION", "");
-  if (!compression.empty()) {
-    rpc_options->set_compression_algorithm(compression);
-    rpc_options->set_compression_level(
-        sys_util::GetEnvInt("XRT_GRPC_COMPRESSION_LEVEL", 3));
-  }
-
   bool multi_stream = sys_util::GetEnvBool("XRT_GRPC_MULTISTREAM", true);
   rpc_options->set_disable_session_connection_sharing(multi_stream);
 
@@ -7,6 +7,7 @@
 #include <memory>
 #include <mutex>
 #include <utility>
+#include <vector>
 
 #include "tensorflow/compiler/xla/types.h"
 #include "tensorflow/compiler/xla/xla_client/xrt_session.h"
@@ -82,6 +83,11 @@ class XrtSessionCache {
 
   void AddSession(std::shared_ptr<XrtSession> session);
 
+  // Creates count sessions for each of the targets, in parallel, and adds them
+  // to the cache, so that the first users of the targets do not pay for the
+  // session creation and initialization.
+  void Prewarm(const std::vector<string>& targets, size_t count);
+
  private:
   std::shared_ptr<XrtSession> CreateSession(const string& target) const;
 
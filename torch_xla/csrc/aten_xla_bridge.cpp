@@ -7,7 +7,9 @@
 #include "absl/strings/str_cat.h"
 #include "tensorflow/compiler/xla/xla_client/computation_client.h"
 #include "tensorflow/compiler/xla/xla_client/debug_macros.h"
+#include "tensorflow/compiler/xla/xla_client/sys_util.h"
 #include "torch_xla/csrc/device.h"
+#include "torch_xla/csrc/fallback_profiler.h"
 #include "torch_xla/csrc/tensor_impl.h"
 #include "torch_xla/csrc/torch_util.h"
 
@@ -46,11 +48,29 @@ AtenXlaDeviceMapper* AtenXlaDeviceMapper::Get() {
   return device_mapper;
 }
 
+XLATensorImpl* GetXlaTensorImpl(const at::Tensor& tensor) {
+  c10::TensorImpl* impl = tensor.unsafeGetTensorImpl();
+  // Only the XLATensorImpl objects carry the XLA tensor type ID, so checking
+  // it avoids a dynamic_cast<> for every operation argument.
+  return impl->type_id() == c10::XLATensorId()
+             ? static_cast<XLATensorImpl*>(impl)
+             : nullptr;
+}
+
+// In fallback regions mode, the runs of operations falling back to CPU keep
+// their intermediate results on host: the results are only uploaded when a
+// device computation uses them, all together, and the device tensors read by
+// the fallbacks keep their fetched values, so they are only fetched once.
+bool UseFallbackRegions() {
+  static const bool use_fallback_regions =
+      xla::sys_util::GetEnvBool("XLA_FALLBACK_REGIONS", false);
+  return use_fallback_regions;
+}
+
 }  // namespace
 
 c10::optional<XLATensor> TryGetXlaTensor(const at::Tensor& tensor) {
-  XLATensorImpl* impl =
-      dynamic_cast<XLATensorImpl*>(tensor.unsafeGetTensorImpl());
+  XLATensorImpl* impl = GetXlaTensorImpl(tensor);
   if (impl == nullptr) {
     return c10::nullopt;
   }
@@ -58,10 +78,10 @@ c10::optional<XLATensor> TryGetXlaTensor(const at::Tensor& tensor) {
 }
 
 XLATensor GetXlaTensor(const at::Tensor& tensor) {
-  auto xtensor = TryGetXlaTensor(tensor);
-  XLA_CHECK(xtensor) << "Input tensor is not an XLA tensor: "
-                     << tensor.toString();
-  return *xtensor;
+  XLATensorImpl* impl = GetXlaTensorImpl(tensor);
+  XLA_CHECK(impl != nullptr)
+      << "Input tensor is not an XLA tensor: " << tensor.toString();
+  return impl->tensor();
 }
 
 std::vector<XLATensor> GetXlaTensors(
@@ -82,8 +102,8 @@ XLATensor GetOrCreateXlaTensor(const at::Tensor& tensor, const Device& device) {
   if (!tensor.defined()) {
     return XLATensor();
   }
-  auto xtensor = TryGetXlaTensor(tensor);
-  return xtensor ? *xtensor : XLATensor::Create(tensor, device);
+  XLATensorImpl* impl = GetXlaTensorImpl(tensor);
+  return impl != nullptr ? impl->tensor() : XLATensor::Create(tensor, device);
 }
 
 std::vector<at::Tensor> XlaCreateTensorList(const at::TensorList& tensors) {
@@ -92,6 +112,7 @@ std::vector<at::Tensor> XlaCreateTensorList(const at::TensorList& tensors) {
   // We need to separate out the defined tensors first, GetXlaTensor() doesn't
   // work with undefined tensors.
   std::vector<bool> to_translate(tensors.size());
+  std::vector<bool> on_host;
   for (size_t i = 0; i < tensors.size(); ++i) {
     const at::Tensor& tensor = tensors[i];
     if (tensor.defined()) {
@@ -100,14 +121,28 @@ std::vector<at::Tensor> XlaCreateTensorList(const at::TensorList& tensors) {
       } else {
         to_translate[i] = true;
         xla_tensors.push_back(GetXlaTensorUnwrap(tensor));
+        on_host.push_back(bool(xla_tensors.back().CurrentTensorData()));
       }
     }
   }
+  if (UseFallbackRegions() && !xla_tensors.empty()) {
+    // The tensors get their device data, so that their fetched values can be
+    // kept as host copies of it.
+    XLATensor::SyncTensorsGraph(&xla_tensors, {}, /*wait=*/true,
+                                /*sync_xla_data=*/false);
+  }
   auto defined_aten_xla_tensors = XLATensor::GetTensors(&xla_tensors);
   // Insert undefined tensors into the result, back into the original undefined
   // positions.
   for (size_t i = 0, defined_pos = 0; i < tensors.size(); ++i) {
     if (to_translate[i]) {
+      if (!on_host[defined_pos]) {
+        FallbackScope::RecordToHost(defined_aten_xla_tensors[defined_pos]);
+        if (UseFallbackRegions()) {
+          xla_tensors[defined_pos].SetHostCopy(
+              defined_aten_xla_tensors[defined_pos]);
+        }
+      }
       aten_xla_tensors[i] = std::move(defined_aten_xla_tensors[defined_pos++]);
     }
   }
@@ -120,16 +155,20 @@ void XlaUpdateTensors(
     tensorflow::gtl::ArraySlice<const size_t> indices) {
   for (auto index : indices) {
     XLATensor xtensor = GetXlaTensorUnwrap(dest_xla_tensors.at(index));
+    FallbackScope::RecordToDevice(source_cpu_tensors.at(index));
     xtensor.UpdateFromTensor(source_cpu_tensors.at(index));
+    if (UseFallbackRegions()) {
+      xtensor.QueueUpload();
+    }
   }
 }
 
 c10::optional<Device> GetXlaDevice(const at::Tensor& tensor) {
-  auto xtensor = TryGetXlaTensor(tensor);
-  if (!xtensor) {
+  XLATensorImpl* impl = GetXlaTensorImpl(tensor);
+  if (impl == nullptr) {
     return c10::nullopt;
   }
-  return xtensor->GetDevice();
+  return impl->tensor().GetDevice();
 }
 
 c10::optional<Device> GetXlaDevice(const at::TensorList& tensors) {
@@ -215,7 +254,17 @@ std::vector<at::Tensor> AtenFromXlaTensors(
 at::Tensor CreateXlaTensor(at::Tensor tensor,
                            const c10::optional<Device>& device) {
   if (tensor.defined() && device) {
+    FallbackScope::RecordToDevice(tensor);
+    if (UseFallbackRegions() &&
+        tensor.unsafeGetTensorImpl()->storage().use_count() > 1) {
+      // The result aliases other host data, like the host copy of one of the
+      // fallback inputs, which must not see the in place changes of it.
+      tensor = tensor.clone();
+    }
     XLATensor xla_tensor = XLATensor::Create(std::move(tensor), *device);
+    if (UseFallbackRegions()) {
+      xla_tensor.QueueUpload();
+    }
     tensor = AtenFromXlaTensor(xla_tensor);
   }
   return tensor;
@@ -2,9 +2,12 @@
 
 #include <ATen/Context.h>
 
+#include <limits>
 #include <mutex>
 
 #include "tensorflow/compiler/xla/xla_client/debug_macros.h"
+#include "tensorflow/compiler/xla/xla_client/sys_util.h"
+#include "tensorflow/compiler/xla/xla_client/tracing.h"
 #include "tensorflow/compiler/xla/xla_client/util.h"
 #include "torch_xla/csrc/aten_xla_bridge.h"
 #include "torch_xla/csrc/aten_xla_type_default.h"
@@ -13,7 +16,6 @@
 #include "torch_xla/csrc/ops/as_strided.h"
 #include "torch_xla/csrc/ops/einsum.h"
 #include "torch_xla/csrc/ops/index_ops.h"
-#include "torch_xla/csrc/pooling.h"
 #include "torch_xla/csrc/tensor_impl.h"
 #include "torch_xla/csrc/tensor_util.h"
 #include "torch_xla/csrc/torch_util.h"
@@ -52,6 +54,90 @@ bool IsNonTrivialDilation(at::IntArrayRef dilation) {
       [](const int64_t dim_dilation) { return dim_dilation != 1; });
 }
 
+// Whether the max pooling gradients are scattered at the indices computed by
+// the forward, rather than found with a select-and-scatter searching the
+// pooling windows again. The indices mode is opt-in, with XLA_MAX_POOL_BACKWARD
+// set to "indices", until it is measured against select-and-scatter.
+bool UseMaxPoolIndicesBackward() {
+  static const std::string mode = xla::sys_util::GetEnvString(
+      "XLA_MAX_POOL_BACKWARD", "select_and_scatter");
+  XLA_CHECK(mode == "indices" || mode == "select_and_scatter")
+      << "Invalid XLA_MAX_POOL_BACKWARD value: " << mode;
+  return mode == "indices";
+}
+
+// Computes the max pooling gradient, using the forward indices if they are
+// XLA tensors and the indices mode is enabled.
+at::Tensor MaxPoolNdBackward(const at::Tensor& grad_output,
+                             const at::Tensor& self,
+                             xla::int64 spatial_dim_count,
+                             at::IntArrayRef kernel_size,
+                             at::IntArrayRef stride, at::IntArrayRef padding,
+                             bool ceil_mode, const at::Tensor& indices) {
+  XLATensor input = bridge::GetXlaTensor(self);
+  c10::optional<XLATensor> xla_indices = bridge::TryGetXlaTensor(indices);
+  if (xla_indices && UseMaxPoolIndicesBackward()) {
+    return bridge::AtenFromXlaTensor(
+        XLATensor::max_pool_nd_backward_with_indices(
+            bridge::GetXlaTensor(grad_output), input, *xla_indices,
+            spatial_dim_count, XlaHelpers::I64List(kernel_size),
+            XlaHelpers::I64List(stride), XlaHelpers::I64List(padding),
+            ceil_mode));
+  }
+  return bridge::AtenFromXlaTensor(XLATensor::max_pool_nd_backward(
+      bridge::GetXlaTensor(grad_output), input, spatial_dim_count,
+      XlaHelpers::I64List(kernel_size), XlaHelpers::I64List(stride),
+      XlaHelpers::I64List(padding), ceil_mode));
+}
+
+// Computes max pooling along with the flat spatial indices of the maximums.
+std::tuple<at::Tensor, at::Tensor> MaxPoolNdWithIndices(
+    const at::Tensor& self, xla::int64 spatial_dim_count,
+    at::IntArrayRef kernel_size, at::IntArrayRef stride,
+    at::IntArrayRef padding, bool ceil_mode) {
+  auto outputs = XLATensor::max_pool_nd_with_indices(
+      bridge::GetXlaTensor(self), spatial_dim_count,
+      XlaHelpers::I64List(kernel_size), XlaHelpers::I64List(stride),
+      XlaHelpers::I64List(padding), ceil_mode);
+  return std::make_tuple(bridge::AtenFromXlaTensor(std::get<0>(outputs)),
+                         bridge::AtenFromXlaTensor(std::get<1>(outputs)));
+}
+
+// Returns the XLA tensor of an optional ATen tensor argument, which is a null
+// XLA tensor if the argument is undefined.
+XLATensor GetOptionalXlaTensor(const at::Tensor& tensor) {
+  return tensor.defined() ? bridge::GetXlaTensor(tensor) : XLATensor();
+}
+
+// Returns the exclusive upper bound of the values random_() draws by default:
+// one past the largest value of the integral types, and one past the largest
+// integer represented exactly for the floating point ones.
+xla::int64 RandomUpperBound(at::ScalarType scalar_type) {
+  switch (scalar_type) {
+    case at::ScalarType::Bool:
+      return 2;
+    case at::ScalarType::Byte:
+      return static_cast<xla::int64>(std::numeric_limits<uint8_t>::max()) + 1;
+    case at::ScalarType::Char:
+      return static_cast<xla::int64>(std::numeric_limits<int8_t>::max()) + 1;
+    case at::ScalarType::Short:
+      return static_cast<xla::int64>(std::numeric_limits<int16_t>::max()) + 1;
+    case at::ScalarType::Int:
+      return static_cast<xla::int64>(std::numeric_limits<int32_t>::max()) + 1;
+    case at::ScalarType::Long:
+      return std::numeric_limits<xla::int64>::max();
+    case at::ScalarType::Half:
+      // The half precision mantissa has 11 digits.
+      return (1LL << 11) + 1;
+    case at::ScalarType::Float:
+      return (1LL << std::numeric_limits<float>::digits) + 1;
+    case at::ScalarType::Double:
+      return (1LL << std::numeric_limits<double>::digits) + 1;
+    default:
+      XLA_ERROR() << "Type not supported by random_(): " << scalar_type;
+  }
+}
+
 bool IsOperationOnType(const c10::optional<at::ScalarType>& opt_dtype,
                        at::ScalarType tensor_type, at::ScalarType type) {
   if (opt_dtype && *opt_dtype == type) {
@@ -68,34 +154,40 @@ void AtenInitialize() {
 }  // namespace
 
 int64_t AtenXlaType::numel(const at::Tensor& self) {
+  XLA_FN_TRACE("aten");
   XLATensor self_tensor = bridge::GetXlaTensor(self);
   return xla::ShapeUtil::ElementsIn(self_tensor.shape());
 }
 
 at::Tensor AtenXlaType::__and__(const at::Tensor& self, at::Scalar other) {
+  XLA_FN_TRACE("aten");
   return bridge::AtenFromXlaTensor(
       XLATensor::__and__(bridge::GetXlaTensor(self), other));
 }
 
 at::Tensor AtenXlaType::__and__(const at::Tensor& self,
                                 const at::Tensor& other) {
+  XLA_FN_TRACE("aten");
   return bridge::AtenFromXlaTensor(XLATensor::__and__(
       bridge::GetXlaTensor(self), bridge::GetXlaTensor(other)));
 }
 
 at::Tensor& AtenXlaType::__iand__(at::Tensor& self, at::Scalar other) {
+  XLA_FN_TRACE("aten");
   XLATensor self_tensor = bridge::GetXlaTensor(self);
   XLATensor::__iand__(self_tensor, other);
   return self;
 }
 
 at::Tensor& AtenXlaType::__iand__(at::Tensor& self, const at::Tensor& other) {
+  XLA_FN_TRACE("aten");
   XLATensor self_tensor = bridge::GetXlaTensor(self);
   XLATensor::__iand__(self_tensor, bridge::GetXlaTensor(other));
   return self;
 }
 
 at::Tensor& AtenXlaType::__ilshift__(at::Tensor& self, at::Scalar other) {
+  XLA_FN_TRACE("aten");
   XLATensor self_tensor = bridge::GetXlaTensor(self);
   XLATensor::__ilshift__(self_tensor, other);
   return self;
@@ -103,24 +195,28 @@ at::Tensor& AtenXlaType::__ilshift__(at::Tensor& self, at::Scalar other) {
 
 at::Tensor& AtenXlaType::__ilshift__(at::Tensor& self,
                                      const at::Tensor& other) {
+  XLA_FN_TRACE("aten");
   XLATensor self_tensor = bridge::GetXlaTensor(self);
   XLATensor::__ilshift__(self_tensor, bridge::GetXlaTensor(other));
   return self;
 }
 
 at::Tensor& AtenXlaType::__ior__(at::Tensor& self, at::Scalar other) {
+  XLA_FN_TRACE("aten");
   XLATensor self_tensor = bridge::GetXlaTensor(self);
   XLATensor::__ior__(self_tensor, other);
   return self;
 }
 
 at::Tensor& AtenXlaType::__ior__(at::Tensor& self, const at::Tensor& other) {
+  XLA_FN_TRACE("aten");
   XLATensor self_tensor = bridge::GetXlaTensor(self);
   XLATensor::__ior__(self_tensor, bridge::GetXlaTensor(other));
   return self;
 }
 
 at::Tensor& AtenXlaType::__irshift__(at::Tensor& self, at::Scalar other) {
+  XLA_FN_TRACE("aten");
   XLATensor self_tensor = bridge::GetXlaTensor(self);
   XLATensor::__irshift__(self_tensor, other);
   return self;
@@ -128,129 +224,139 @@ at::Tensor& AtenXlaType::__irshift__(at::Tensor& self, at::Scalar other) {
 
 at::Tensor& AtenXlaType::__irshift__(at::Tensor& self,
                                      const at::Tensor& other) {
+  XLA_FN_TRACE("aten");
   XLATensor self_tensor = bridge::GetXlaTensor(self);
   XLATensor::__irshift__(self_tensor, bridge::GetXlaTensor(other));
   return self;
 }
 
 at::Tensor& AtenXlaType::__ixor__(at::Tensor& self, at::Scalar other) {
+  XLA_FN_TRACE("aten");
   XLATensor self_tensor = bridge::GetXlaTensor(self);
   XLATensor::__ixor__(self_tensor, other);
   return self;
 }
 
 at::Tensor& AtenXlaType::__ixor__(at::Tensor& self, const at::Tensor& other) {
+  XLA_FN_TRACE("aten");
   XLATensor self_tensor = bridge::GetXlaTensor(self);
   XLATensor::__ixor__(self_tensor, bridge::GetXlaTensor(other));
   return self;
 }
 
 at::Tensor AtenXlaType::__lshift__(const at::Tensor& self, at::Scalar other) {
+  XLA_FN_TRACE("aten");
   return bridge::AtenFromXlaTensor(
       XLATensor::__lshift__(bridge::GetXlaTensor(self), other));
 }
 
 at::Tensor AtenXlaType::__lshift__(const at::Tensor& self,
                                    const at::Tensor& other) {
+  XLA_FN_TRACE("aten");
   return bridge::AtenFromXlaTensor(XLATensor::__lshift__(
       bridge::GetXlaTensor(self), bridge::GetXlaTensor(other)));
 }
 
 at::Tensor AtenXlaType::__or__(const at::Tensor& self, at::Scalar other) {
+  XLA_FN_TRACE("aten");
   return bridge::AtenFromXlaTensor(
       XLATensor::__or__(bridge::GetXlaTensor(self), other));
 }
 
 at::Tensor AtenXlaType::__or__(const at::Tensor& self,
                                const at::Tensor& other) {
+  XLA_FN_TRACE("aten");
   return bridge::AtenFromXlaTensor(XLATensor::__or__(
       bridge::GetXlaTensor(self), bridge::GetXlaTensor(other)));
 }
 
 at::Tensor AtenXlaType::__rshift__(const at::Tensor& self, at::Scalar other) {
+  XLA_FN_TRACE("aten");
   return bridge::AtenFromXlaTensor(
       XLATensor::__rshift__(bridge::GetXlaTensor(self), other));
 }
 
 at::Tensor AtenXlaType::__rshift__(const at::Tensor& self,
                                    const at::Tensor& other) {
+  XLA_FN_TRACE("aten");
   return bridge::AtenFromXlaTensor(XLATensor::__rshift__(
       bridge::GetXlaTensor(self), bridge::GetXlaTensor(other)));
 }
 
 at::Tensor AtenXlaType::__xor__(const at::Tensor& self, at::Scalar other) {
+  XLA_FN_TRACE("aten");
   return bridge::AtenFromXlaTensor(
       XLATensor::__xor__(bridge::GetXlaTensor(self), other));
 }
 
 at::Tensor AtenXlaType::__xor__(const at::Tensor& self,
                                 const at::Tensor& other) {
+  XLA_FN_TRACE("aten");
   return bridge::AtenFromXlaTensor(XLATensor::__xor__(
       bridge::GetXlaTensor(self), bridge::GetXlaTensor(other)));
 }
 
 at::Tensor AtenXlaType::_adaptive_avg_pool2d(const at::Tensor& self,
                                              at::IntArrayRef output_size) {
-  auto output_size_list = XlaHelpers::I64List(output_size);
-  if (!IsSupportedAdaptiveAvgPool2d(XlaHelpers::I64List(self.sizes()),
-                                    output_size_list)) {
-    return AtenXlaTypeDefault::_adaptive_avg_pool2d(self, output_size);
-  }
-  return bridge::AtenFromXlaTensor(XLATensor::_adaptive_avg_pool2d(
-      bridge::GetXlaTensor(self), output_size_list));
+  XLA_FN_TRACE("aten");
+  return bridge::AtenFromXlaTensor(XLATensor::adaptive_avg_pool_nd(
+      bridge::GetXlaTensor(self), /*spatial_dim_count=*/2,
+      XlaHelpers::I64List(output_size)));
 }
 
 at::Tensor AtenXlaType::_adaptive_avg_pool2d_backward(
     const at::Tensor& grad_output, const at::Tensor& self) {
-  int64_t rank = grad_output.dim();
-  std::vector<xla::int64> output_size{grad_output.size(rank - 2),
-                                      grad_output.size(rank - 1)};
-  if (!IsSupportedAdaptiveAvgPool2d(XlaHelpers::I64List(self.sizes()),
-                                    output_size)) {
-    return AtenXlaTypeDefault::_adaptive_avg_pool2d_backward(grad_output, self);
-  }
-  return bridge::AtenFromXlaTensor(XLATensor::_adaptive_avg_pool2d_backward(
-      bridge::GetXlaTensor(grad_output), bridge::GetXlaTensor(self)));
+  XLA_FN_TRACE("aten");
+  return bridge::AtenFromXlaTensor(XLATensor::adaptive_avg_pool_nd_backward(
+      bridge::GetXlaTensor(grad_output), bridge::GetXlaTensor(self),
+      /*spatial_dim_count=*/2));
 }
 
 at::Tensor AtenXlaType::_cast_Byte(const at::Tensor& self,
                                    bool /* non_blocking */) {
+  XLA_FN_TRACE("aten");
   return bridge::AtenFromXlaTensor(
       XLATensor::cast(bridge::GetXlaTensor(self), at::ScalarType::Byte));
 }
 
 at::Tensor AtenXlaType::_cast_Char(const at::Tensor& self,
                                    bool /* non_blocking */) {
+  XLA_FN_TRACE("aten");
   return bridge::AtenFromXlaTensor(
       XLATensor::cast(bridge::GetXlaTensor(self), at::ScalarType::Char));
 }
 
 at::Tensor AtenXlaType::_cast_Float(const at::Tensor& self,
                                     bool /* non_blocking */) {
+  XLA_FN_TRACE("aten");
   return bridge::AtenFromXlaTensor(
       XLATensor::cast(bridge::GetXlaTensor(self), at::ScalarType::Float));
 }
 
 at::Tensor AtenXlaType::_cast_Int(const at::Tensor& self,
                                   bool /* non_blocking */) {
+  XLA_FN_TRACE("aten");
   return bridge::AtenFromXlaTensor(
       XLATensor::cast(bridge::GetXlaTensor(self), at::ScalarType::Int));
 }
 
 at::Tensor AtenXlaType::_cast_Long(const at::Tensor& self,
                                    bool /* non_blocking */) {
+  XLA_FN_TRACE("aten");
   return bridge::AtenFromXlaTensor(
       XLATensor::cast(bridge::GetXlaTensor(self), at::ScalarType::Long));
 }
 
 at::Tensor AtenXlaType::_cast_Short(const at::Tensor& self,
                                     bool /* non_blocking */) {
+  XLA_FN_TRACE("aten");
   return bridge::AtenFromXlaTensor(
       XLATensor::cast(bridge::GetXlaTensor(self), at::ScalarType::Short));
 }
 
 at::Tensor AtenXlaType::_copy_from(const at::Tensor& self,
                                    const at::Tensor& dst, bool non_blocking) {
+  XLA_FN_TRACE("aten");
   // Do not mark the tensor creation as writeable to not discard the XLA tensor
   // device context, but make a copy to avoid core data to be shared.
   std::vector<at::Tensor> tensors = {self};
@@ -263,18 +369,77 @@ at::Tensor AtenXlaType::_copy_from(const at::Tensor& self,
 }
 
 at::Tensor AtenXlaType::_dim_arange(const at::Tensor& like, int64_t dim) {
+  XLA_FN_TRACE("aten");
   return arange(like.size(dim), like.options().dtype(at::kLong));
 }
 
+std::tuple<at::Tensor, at::Tensor, at::Tensor, at::Tensor>
+AtenXlaType::_embedding_bag(const at::Tensor& weight, const at::Tensor& indices,
+                            const at::Tensor& offsets, bool scale_grad_by_freq,
+                            int64_t mode, bool sparse,
+                            const at::Tensor& per_sample_weights) {
+  XLA_FN_TRACE("aten");
+  if (per_sample_weights.defined() && mode != 0) {
+    // Let ATen report the error.
+    return AtenXlaTypeDefault::_embedding_bag(weight, indices, offsets,
+                                              scale_grad_by_freq, mode, sparse,
+                                              per_sample_weights);
+  }
+  auto results = XLATensor::embedding_bag(
+      bridge::GetXlaTensor(weight), bridge::GetXlaTensor(indices),
+      bridge::GetXlaTensor(offsets), mode,
+      GetOptionalXlaTensor(per_sample_weights));
+  return std::make_tuple(bridge::AtenFromXlaTensor(std::get<0>(results)),
+                         bridge::AtenFromXlaTensor(std::get<1>(results)),
+                         bridge::AtenFromXlaTensor(std::get<2>(results)),
+                         bridge::AtenFromXlaTensor(std::get<3>(results)));
+}
+
+at::Tensor AtenXlaType::_embedding_bag_dense_backward(
+    const at::Tensor& grad, const at::Tensor& indices,
+    const at::Tensor& offsets, const at::Tensor& offset2bag,
+    const at::Tensor& bag_size, const at::Tensor& maximum_indices,
+    int64_t num_weights, bool scale_grad_by_freq, int64_t mode,
+    const at::Tensor& per_sample_weights) {
+  XLA_FN_TRACE("aten");
+  return bridge::AtenFromXlaTensor(XLATensor::embedding_bag_dense_backward(
+      bridge::GetXlaTensor(grad), bridge::GetXlaTensor(indices),
+      bridge::GetXlaTensor(offset2bag), bridge::GetXlaTensor(bag_size),
+      bridge::GetXlaTensor(maximum_indices), num_weights, scale_grad_by_freq,
+      mode, GetOptionalXlaTensor(per_sample_weights)));
+}
+
+at::Tensor AtenXlaType::_embedding_bag_per_sample_weights_backward(
+    const at::Tensor& grad, const at::Tensor& weight,
+    const at::Tensor& indices, const at::Tensor& offsets,
+    const at::Tensor& offset2bag, int64_t mode) {
+  XLA_FN_TRACE("aten");
+  if (mode != 0) {
+    return AtenXlaTypeDefault::_embedding_bag_per_sample_weights_backward(
+        grad, weight, indices, offsets, offset2bag, mode);
+  }
+  return bridge::AtenFromXlaTensor(
+      XLATensor::embedding_bag_per_sample_weights_backward(
+          bridge::GetXlaTensor(grad), bridge::GetXlaTensor(weight),
+          bridge::GetXlaTensor(indices), bridge::GetXlaTensor(offset2bag)));
+}
+
 at::Tensor& AtenXlaType::_index_put_impl_(at::Tensor& self,
                                           at::TensorList indices,
                                           const at::Tensor& values,
                                           bool accumulate, bool /* unsafe */) {
+  XLA_FN_TRACE("aten");
   return index_put_(self, indices, values, accumulate);
 }
 
+at::Scalar AtenXlaType::_local_scalar_dense(const at::Tensor& self) {
+  XLA_FN_TRACE("aten");
+  return bridge::GetXlaTensor(self).ToScalar();
+}
+
 at::Tensor AtenXlaType::_log_softmax(const at::Tensor& self, int64_t dim,
                                      bool /* half_to_float */) {
+  XLA_FN_TRACE("aten");
   return bridge::AtenFromXlaTensor(
       XLATensor::log_softmax(bridge::GetXlaTensor(self), dim, c10::nullopt));
 }
@@ -282,12 +447,14 @@ at::Tensor AtenXlaType::_log_softmax(const at::Tensor& self, int64_t dim,
 at::Tensor AtenXlaType::_log_softmax_backward_data(
     const at::Tensor& grad_output, const at::Tensor& output, int64_t dim,
     const at::Tensor& /* self */) {
+  XLA_FN_TRACE("aten");
   return bridge::AtenFromXlaTensor(XLATensor::log_softmax_backward(
       bridge::GetXlaTensor(grad_output), bridge::GetXlaTensor(output), dim));
 }
 
 at::Tensor AtenXlaType::_softmax(const at::Tensor& self, int64_t dim,
                                  bool /* half_to_float */) {
+  XLA_FN_TRACE("aten");
   return softmax(self, dim, c10::nullopt);
 }
 
@@ -295,6 +462,7 @@ at::Tensor AtenXlaType::_softmax_backward_data(const at::Tensor& grad_output,
                                                const at::Tensor& output,
                                                int64_t dim,
                                                const at::Tensor& self) {
+  XLA_FN_TRACE("aten");
   return bridge::AtenFromXlaTensor(XLATensor::softmax_backward(
       bridge::GetXlaTensor(grad_output), bridge::GetXlaTensor(output), dim));
 }
@@ -305,37 +473,98 @@ at::Tensor AtenXlaType::_trilinear(const at::Tensor& i1, const at::Tensor& i2,
                                    at::IntArrayRef expand2,
                                    at::IntArrayRef expand3,
                                    at::IntArrayRef sumdim, int64_t unroll_dim) {
+  XLA_FN_TRACE("aten");
   return at::native::_trilinear(i1, i2, i3, expand1, expand2, expand3, sumdim,
                                 unroll_dim);
 }
 
 at::Tensor AtenXlaType::_unsafe_view(const at::Tensor& self,
                                      at::IntArrayRef size) {
+  XLA_FN_TRACE("aten");
   return view(self, size);
 }
 
 at::Tensor AtenXlaType::abs(const at::Tensor& self) {
+  XLA_FN_TRACE("aten");
   return bridge::AtenFromXlaTensor(XLATensor::abs(bridge::GetXlaTensor(self)));
 }
 
 at::Tensor& AtenXlaType::abs_(at::Tensor& self) {
+  XLA_FN_TRACE("aten");
   XLATensor self_tensor = bridge::GetXlaTensor(self);
   XLATensor::abs_(self_tensor);
   return self;
 }
 
 at::Tensor AtenXlaType::acos(const at::Tensor& self) {
+  XLA_FN_TRACE("aten");
   return bridge::AtenFromXlaTensor(XLATensor::acos(bridge::GetXlaTensor(self)));
 }
 
 at::Tensor& AtenXlaType::acos_(at::Tensor& self) {
+  XLA_FN_TRACE("aten");
   XLATensor self_tensor = bridge::GetXlaTensor(self);
   XLATensor::acos_(self_tensor);
   return self;
 }
 
+at::Tensor AtenXlaType::adaptive_avg_pool3d(const at::Tensor& self,
+                                            at::IntArrayRef output_size) {
+  XLA_FN_TRACE("aten");
+  return bridge::AtenFromXlaTensor(XLATensor::adaptive_avg_pool_nd(
+      bridge::GetXlaTensor(self), /*spatial_dim_count=*/3,
+      XlaHelpers::I64List(output_size)));
+}
+
+at::Tensor AtenXlaType::adaptive_avg_pool3d_backward(
+    const at::Tensor& grad_output, const at::Tensor& self) {
+  XLA_FN_TRACE("aten");
+  return bridge::AtenFromXlaTensor(XLATensor::adaptive_avg_pool_nd_backward(
+      bridge::GetXlaTensor(grad_output), bridge::GetXlaTensor(self),
+      /*spatial_dim_count=*/3));
+}
+
+std::tuple<at::Tensor, at::Tensor> AtenXlaType::adaptive_max_pool2d(
+    const at::Tensor& self, at::IntArrayRef output_size) {
+  XLA_FN_TRACE("aten");
+  auto outputs = XLATensor::adaptive_max_pool_nd(
+      bridge::GetXlaTensor(self), /*spatial_dim_count=*/2,
+      XlaHelpers::I64List(output_size));
+  return std::make_tuple(bridge::AtenFromXlaTensor(std::get<0>(outputs)),
+                         bridge::AtenFromXlaTensor(std::get<1>(outputs)));
+}
+
+at::Tensor AtenXlaType::adaptive_max_pool2d_backward(
+    const at::Tensor& grad_output, const at::Tensor& self,
+    const at::Tensor& indices) {
+  XLA_FN_TRACE("aten");
+  return bridge::AtenFromXlaTensor(XLATensor::adaptive_max_pool_nd_backward(
+      bridge::GetXlaTensor(grad_output), bridge::GetXlaTensor(self),
+      bridge::GetXlaTensor(indices), /*spatial_dim_count=*/2));
+}
+
+std::tuple<at::Tensor, at::Tensor> AtenXlaType::adaptive_max_pool3d(
+    const at::Tensor& self, at::IntArrayRef output_size) {
+  XLA_FN_TRACE("aten");
+  auto outputs = XLATensor::adaptive_max_pool_nd(
+      bridge::GetXlaTensor(self), /*spatial_dim_count=*/3,
+      XlaHelpers::I64List(output_size));
+  return std::make_tuple(bridge::AtenFromXlaTensor(std::get<0>(outputs)),
+                         bridge::AtenFromXlaTensor(std::get<1>(outputs)));
+}
+
+at::Tensor AtenXlaType::adaptive_max_pool3d_backward(
+    const at::Tensor& grad_output, const at::Tensor& self,
+    const at::Tensor& indices) {
+  XLA_FN_TRACE("aten");
+  return bridge::AtenFromXlaTensor(XLATensor::adaptive_max_pool_nd_backward(
+      bridge::GetXlaTensor(grad_output), bridge::GetXlaTensor(self),
+      bridge::GetXlaTensor(indices), /*spatial_dim_count=*/3));
+}
+
 at::Tensor AtenXlaType::add(const at::Tensor& self, const at::Tensor& other,
                             at::Scalar alpha) {
+  XLA_FN_TRACE("aten");
   XLATensor self_tensor = bridge::GetXlaTensor(self);
   return bridge::AtenFromXlaTensor(XLATensor::add(
       self_tensor, bridge::GetOrCreateXlaTensor(other, self_tensor.GetDevice()),
@@ -344,12 +573,14 @@ at::Tensor AtenXlaType::add(const at::Tensor& self, const at::Tensor& other,
 
 at::Tensor AtenXlaType::add(const at::Tensor& self, at::Scalar other,
                             at::Scalar alpha) {
+  XLA_FN_TRACE("aten");
   return bridge::AtenFromXlaTensor(
       XLATensor::add(bridge::GetXlaTensor(self), other, alpha));
 }
 
 at::Tensor& AtenXlaType::add_(at::Tensor& self, const at::Tensor& other,
                               at::Scalar alpha) {
+  XLA_FN_TRACE("aten");
   XLATensor self_tensor = bridge::GetXlaTensor(self);
   XLATensor::add_(self_tensor,
                   bridge::GetOrCreateXlaTensor(other, self_tensor.GetDevice()),
@@ -359,6 +590,7 @@ at::Tensor& AtenXlaType::add_(at::Tensor& self, const at::Tensor& other,
 
 at::Tensor& AtenXlaType::add_(at::Tensor& self, at::Scalar other,
                               at::Scalar alpha) {
+  XLA_FN_TRACE("aten");
   XLATensor self_tensor = bridge::GetXlaTensor(self);
   XLATensor::add_(self_tensor, other, alpha);
   return self;
@@ -367,6 +599,7 @@ at::Tensor& AtenXlaType::add_(at::Tensor& self, at::Scalar other,
 at::Tensor AtenXlaType::addcdiv(const at::Tensor& self,
                                 const at::Tensor& tensor1,
                                 const at::Tensor& tensor2, at::Scalar value) {
+  XLA_FN_TRACE("aten");
   return bridge::AtenFromXlaTensor(XLATensor::addcdiv(
       bridge::GetXlaTensor(self), value, bridge::GetXlaTensor(tensor1),
       bridge::GetXlaTensor(tensor2)));
@@ -374,6 +607,7 @@ at::Tensor AtenXlaType::addcdiv(const at::Tensor& self,
 
 at::Tensor& AtenXlaType::addcdiv_(at::Tensor& self, const at::Tensor& tensor1,
                                   const at::Tensor& tensor2, at::Scalar value) {
+  XLA_FN_TRACE("aten");
   XLATensor self_tensor = bridge::GetXlaTensor(self);
   XLATensor::addcdiv_(self_tensor, value, bridge::GetXlaTensor(tensor1),
                       bridge::GetXlaTensor(tensor2));
@@ -383,6 +617,7 @@ at::Tensor& AtenXlaType::addcdiv_(at::Tensor& self, const at::Tensor& tensor1,
 at::Tensor AtenXlaType::addcmul(const at::Tensor& self,
                                 const at::Tensor& tensor1,
                                 const at::Tensor& tensor2, at::Scalar value) {
+  XLA_FN_TRACE("aten");
   return bridge::AtenFromXlaTensor(XLATensor::addcmul(
       bridge::GetXlaTensor(self), value, bridge::GetXlaTensor(tensor1),
       bridge::GetXlaTensor(tensor2)));
@@ -390,6 +625,7 @@ at::Tensor AtenXlaType::addcmul(const at::Tensor& self,
 
 at::Tensor& AtenXlaType::addcmul_(at::Tensor& self, const at::Tensor& tensor1,
                                   const at::Tensor& tensor2, at::Scalar value) {
+  XLA_FN_TRACE("aten");
   XLATensor self_tensor = bridge::GetXlaTensor(self);
   XLATensor::addcmul_(self_tensor, value, bridge::GetXlaTensor(tensor1),
                       bridge::GetXlaTensor(tensor2));
@@ -399,6 +635,7 @@ at::Tensor& AtenXlaType::addcmul_(at::Tensor& self, const at::Tensor& tensor1,
 at::Tensor AtenXlaType::addmm(const at::Tensor& self, const at::Tensor& mat1,
                               const at::Tensor& mat2, at::Scalar beta,
                               at::Scalar alpha) {
+  XLA_FN_TRACE("aten");
   // xla::dot doesn't support integer types.
   if (beta.to<double>() != 1 || alpha.to<double>() != 1 ||
       !self.is_floating_point() || !mat1.is_floating_point() ||
@@ -414,6 +651,7 @@ at::Tensor AtenXlaType::addmm(const at::Tensor& self, const at::Tensor& mat1,
 at::Tensor AtenXlaType::alias(const at::Tensor& self) { return self; }
 
 at::Tensor AtenXlaType::all(const at::Tensor& self) {
+  XLA_FN_TRACE("aten");
   XLATensor self_tensor = bridge::GetXlaTensor(self);
   return bridge::AtenFromXlaTensor(XLATensor::all(
       self_tensor,
@@ -422,11 +660,13 @@ at::Tensor AtenXlaType::all(const at::Tensor& self) {
 }
 
 at::Tensor AtenXlaType::all(const at::Tensor& self, int64_t dim, bool keepdim) {
+  XLA_FN_TRACE("aten");
   return bridge::AtenFromXlaTensor(
       XLATensor::all(bridge::GetXlaTensor(self), {dim}, keepdim));
 }
 
 at::Tensor AtenXlaType::any(const at::Tensor& self) {
+  XLA_FN_TRACE("aten");
   XLATensor self_tensor = bridge::GetXlaTensor(self);
   return bridge::AtenFromXlaTensor(XLATensor::any(
       self_tensor,
@@ -435,12 +675,14 @@ at::Tensor AtenXlaType::any(const at::Tensor& self) {
 }
 
 at::Tensor AtenXlaType::any(const at::Tensor& self, int64_t dim, bool keepdim) {
+  XLA_FN_TRACE("aten");
   return bridge::AtenFromXlaTensor(
       XLATensor::any(bridge::GetXlaTensor(self), {dim}, keepdim));
 }
 
 at::Tensor AtenXlaType::arange(at::Scalar end,
                                const at::TensorOptions& options) {
+  XLA_FN_TRACE("aten");
   XlaOptions xla_options(options);
   return bridge::AtenFromXlaTensor(XLATensor::arange(
       0, end, 1, xla_options.get_device(), xla_options.get_scalar_type()));
@@ -448,6 +690,7 @@ at::Tensor AtenXlaType::arange(at::Scalar end,
 
 at::Tensor AtenXlaType::arange(at::Scalar start, at::Scalar end,
                                const at::TensorOptions& options) {
+  XLA_FN_TRACE("aten");
   XlaOptions xla_options(options);
   return bridge::AtenFromXlaTensor(XLATensor::arange(
       start, end, 1, xla_options.get_device(), xla_options.get_scalar_type()));
@@ -456,6 +699,7 @@ at::Tensor AtenXlaType::arange(at::Scalar start, at::Scalar end,
 at::Tensor AtenXlaType::arange(at::Scalar start, at::Scalar end,
                                at::Scalar step,
                                const at::TensorOptions& options) {
+  XLA_FN_TRACE("aten");
   XlaOptions xla_options(options);
   return bridge::AtenFromXlaTensor(
       XLATensor::arange(start, end, step, xla_options.get_device(),
@@ -464,6 +708,7 @@ at::Tensor AtenXlaType::arange(at::Scalar start, at::Scalar end,
 
 at::Tensor AtenXlaType::argmax(const at::Tensor& self,
                                c10::optional<int64_t> dim, bool keepdim) {
+  XLA_FN_TRACE("aten");
   return dim ? bridge::AtenFromXlaTensor(
                    XLATensor::argmax(bridge::GetXlaTensor(self), *dim, keepdim))
              : bridge::AtenFromXlaTensor(
@@ -472,6 +717,7 @@ at::Tensor AtenXlaType::argmax(const at::Tensor& self,
 
 at::Tensor AtenXlaType::argmin(const at::Tensor& self,
                                c10::optional<int64_t> dim, bool keepdim) {
+  XLA_FN_TRACE("aten");
   return dim ? bridge::AtenFromXlaTensor(
                    XLATensor::argmin(bridge::GetXlaTensor(self), *dim, keepdim))
              : bridge::AtenFromXlaTensor(
@@ -480,60 +726,73 @@ at::Tensor AtenXlaType::argmin(const at::Tensor& self,
 
 at::Tensor AtenXlaType::argsort(const at::Tensor& self, int64_t dim,
                                 bool descending) {
+  XLA_FN_TRACE("aten");
   return std::get<1>(sort(self, dim, descending));
 }
 
 at::Tensor AtenXlaType::as_strided(const at::Tensor& self, at::IntArrayRef size,
                                    at::IntArrayRef stride,
                                    c10::optional<int64_t> storage_offset) {
-  if (!ir::ops::AsStrided::StrideIsSupported(XlaHelpers::I64List(size),
-                                             XlaHelpers::I64List(stride))) {
+  XLA_FN_TRACE("aten");
+  XLATensor self_tensor = bridge::GetXlaTensor(self);
+  if (!ir::ops::AsStrided::StrideIsSupported(
+          self_tensor.shape(), XlaHelpers::I64List(size),
+          XlaHelpers::I64List(stride), storage_offset.value_or(0))) {
     return AtenXlaTypeDefault::as_strided(self, size, stride, storage_offset);
   }
   return bridge::AtenFromXlaTensor(XLATensor::as_strided(
-      bridge::GetXlaTensor(self), XlaHelpers::I64List(size),
+      self_tensor, XlaHelpers::I64List(size), XlaHelpers::I64List(stride),
       XlaHelpers::I64Optional(storage_offset)));
 }
 
 at::Tensor& AtenXlaType::as_strided_(at::Tensor& self, at::IntArrayRef size,
                                      at::IntArrayRef stride,
                                      c10::optional<int64_t> storage_offset) {
-  if (!ir::ops::AsStrided::StrideIsSupported(XlaHelpers::I64List(size),
-                                             XlaHelpers::I64List(stride))) {
+  XLA_FN_TRACE("aten");
+  XLATensor self_tensor = bridge::GetXlaTensor(self);
+  if (!ir::ops::AsStrided::StrideIsSupported(
+          self_tensor.shape(), XlaHelpers::I64List(size),
+          XlaHelpers::I64List(stride), storage_offset.value_or(0))) {
     return AtenXlaTypeDefault::as_strided_(self, size, stride, storage_offset);
   }
-  XLATensor self_tensor = bridge::GetXlaTensor(self);
   XLATensor::as_strided_(self_tensor, XlaHelpers::I64List(size),
+                         XlaHelpers::I64List(stride),
                          XlaHelpers::I64Optional(storage_offset));
   return self;
 }
 
 at::Tensor AtenXlaType::asin(const at::Tensor& self) {
+  XLA_FN_TRACE("aten");
   return bridge::AtenFromXlaTensor(XLATensor::asin(bridge::GetXlaTensor(self)));
 }
 
 at::Tensor& AtenXlaType::asin_(at::Tensor& self) {
+  XLA_FN_TRACE("aten");
   XLATensor self_tensor = bridge::GetXlaTensor(self);
   XLATensor::asin_(self_tensor);
   return self;
 }
 
 at::Tensor AtenXlaType::atan(const at::Tensor& self) {
+  XLA_FN_TRACE("aten");
   return bridge::AtenFromXlaTensor(XLATensor::atan(bridge::GetXlaTensor(self)));
 }
 
 at::Tensor AtenXlaType::atan2(const at::Tensor& self, const at::Tensor& other) {
+  XLA_FN_TRACE("aten");
   return bridge::AtenFromXlaTensor(XLATensor::atan2(
       bridge::GetXlaTensor(self), bridge::GetXlaTensor(other)));
 }
 
 at::Tensor& AtenXlaType::atan2_(at::Tensor& self, const at::Tensor& other) {
+  XLA_FN_TRACE("aten");
   XLATensor self_tensor = bridge::GetXlaTensor(self);
   XLATensor::atan2_(self_tensor, bridge::GetXlaTensor(other));
   return self;
 }
 
 at::Tensor& AtenXlaType::atan_(at::Tensor& self) {
+  XLA_FN_TRACE("aten");
   XLATensor self_tensor = bridge::GetXlaTensor(self);
   XLATensor::atan_(self_tensor);
   return self;
@@ -544,6 +803,7 @@ at::Tensor AtenXlaType::avg_pool1d(const at::Tensor& self,
                                    at::IntArrayRef stride,
                                    at::IntArrayRef padding, bool ceil_mode,
                                    bool count_include_pad) {
+  XLA_FN_TRACE("aten");
   // Lowering when ceil_mode is set not supported yet.
   if (ceil_mode && count_include_pad) {
     return AtenXlaTypeDefault::avg_pool1d(self, kernel_size, stride, padding,
@@ -561,6 +821,7 @@ at::Tensor AtenXlaType::avg_pool2d(const at::Tensor& self,
                                    at::IntArrayRef padding, bool ceil_mode,
                                    bool count_include_pad,
                                    c10::optional<int64_t> divisor_override) {
+  XLA_FN_TRACE("aten");
   if ((ceil_mode && count_include_pad) || divisor_override) {
     return AtenXlaTypeDefault::avg_pool2d(self, kernel_size, stride, padding,
                                           ceil_mode, count_include_pad,
@@ -577,6 +838,7 @@ at::Tensor AtenXlaType::avg_pool2d_backward(
     at::IntArrayRef kernel_size, at::IntArrayRef stride,
     at::IntArrayRef padding, bool ceil_mode, bool count_include_pad,
     c10::optional<int64_t> divisor_override) {
+  XLA_FN_TRACE("aten");
   if ((ceil_mode && count_include_pad) || divisor_override) {
     return AtenXlaTypeDefault::avg_pool2d_backward(
         grad_output, self, kernel_size, stride, padding, ceil_mode,
@@ -595,6 +857,7 @@ at::Tensor AtenXlaType::avg_pool3d(const at::Tensor& self,
                                    at::IntArrayRef padding, bool ceil_mode,
                                    bool count_include_pad,
                                    c10::optional<int64_t> divisor_override) {
+  XLA_FN_TRACE("aten");
   if ((ceil_mode && count_include_pad) || divisor_override) {
     return AtenXlaTypeDefault::avg_pool3d(self, kernel_size, stride, padding,
                                           ceil_mode, count_include_pad,
@@ -611,6 +874,7 @@ at::Tensor AtenXlaType::avg_pool3d_backward(
     at::IntArrayRef kernel_size, at::IntArrayRef stride,
     at::IntArrayRef padding, bool ceil_mode, bool count_include_pad,
     c10::optional<int64_t> divisor_override) {
+  XLA_FN_TRACE("aten");
   if ((ceil_mode && count_include_pad) || divisor_override) {
     return AtenXlaTypeDefault::avg_pool3d_backward(
         grad_output, self, kernel_size, stride, padding, ceil_mode,
@@ -625,11 +889,13 @@ at::Tensor AtenXlaType::avg_pool3d_backward(
 
 at::Tensor AtenXlaType::bartlett_window(int64_t window_length,
                                         const at::TensorOptions& options) {
+  XLA_FN_TRACE("aten");
   return at::native::bartlett_window(window_length, options);
 }
 
 at::Tensor AtenXlaType::bartlett_window(int64_t window_length, bool periodic,
                                         const at::TensorOptions& options) {
+  XLA_FN_TRACE("aten");
   return at::native::bartlett_window(window_length, periodic, options);
 }
 
@@ -637,6 +903,7 @@ at::Tensor AtenXlaType::batch_norm(
     const at::Tensor& input, const at::Tensor& weight, const at::Tensor& bias,
     const at::Tensor& running_mean, const at::Tensor& running_var,
     bool training, double momentum, double eps, bool cudnn_enabled) {
+  XLA_FN_TRACE("aten");
   if (cudnn_enabled) {
     return AtenXlaTypeDefault::batch_norm(input, weight, bias, running_mean,
                                           running_var, training, momentum, eps,
@@ -657,6 +924,7 @@ at::Tensor AtenXlaType::batch_norm(
 
 at::Tensor AtenXlaType::bernoulli(const at::Tensor& self, double p,
                                   at::Generator* generator) {
+  XLA_FN_TRACE("aten");
   if (generator != nullptr) {
     return AtenXlaTypeDefault::bernoulli(self, p, generator);
   }
@@ -666,6 +934,7 @@ at::Tensor AtenXlaType::bernoulli(const at::Tensor& self, double p,
 
 at::Tensor AtenXlaType::bernoulli(const at::Tensor& self,
                                   at::Generator* generator) {
+  XLA_FN_TRACE("aten");
   if (generator != nullptr) {
     return AtenXlaTypeDefault::bernoulli(self, generator);
   }
@@ -675,6 +944,7 @@ at::Tensor AtenXlaType::bernoulli(const at::Tensor& self,
 
 at::Tensor& AtenXlaType::bernoulli_(at::Tensor& self, double p,
                                     at::Generator* generator) {
+  XLA_FN_TRACE("aten");
   if (generator != nullptr) {
     return AtenXlaTypeDefault::bernoulli_(self, p, generator);
   }
@@ -685,6 +955,7 @@ at::Tensor& AtenXlaType::bernoulli_(at::Tensor& self, double p,
 
 at::Tensor& AtenXlaType::bernoulli_(at::Tensor& self, const at::Tensor& p,
                                     at::Generator* generator) {
+  XLA_FN_TRACE("aten");
   if (generator != nullptr) {
     return AtenXlaTypeDefault::bernoulli_(self, p, generator);
   }
@@ -697,12 +968,14 @@ at::Tensor AtenXlaType::bilinear(const at::Tensor& input1,
                                  const at::Tensor& input2,
                                  const at::Tensor& weight,
                                  const at::Tensor& bias) {
+  XLA_FN_TRACE("aten");
   return at::native::bilinear(input1, input2, weight, bias);
 }
 
 at::Tensor AtenXlaType::binary_cross_entropy_with_logits(
     const at::Tensor& self, const at::Tensor& target, const at::Tensor& weight,
     const at::Tensor& pos_weight, int64_t reduction) {
+  XLA_FN_TRACE("aten");
   return at::native::binary_cross_entropy_with_logits(self, target, weight,
                                                       pos_weight, reduction);
 }
@@ -711,21 +984,25 @@ at::Tensor AtenXlaType::binary_cross_entropy_with_logits_backward(
     const at::Tensor& grad_output, const at::Tensor& self,
     const at::Tensor& target, const at::Tensor& weight,
     const at::Tensor& pos_weight, int64_t reduction) {
+  XLA_FN_TRACE("aten");
   return at::native::binary_cross_entropy_with_logits_backward(
       grad_output, self, target, weight, pos_weight, reduction);
 }
 
 at::Tensor AtenXlaType::blackman_window(int64_t window_length,
                                         const at::TensorOptions& options) {
+  XLA_FN_TRACE("aten");
   return at::native::blackman_window(window_length, options);
 }
 
 at::Tensor AtenXlaType::blackman_window(int64_t window_length, bool periodic,
                                         const at::TensorOptions& options) {
+  XLA_FN_TRACE("aten");
   return at::native::blackman_window(window_length, periodic, options);
 }
 
 at::Tensor AtenXlaType::bmm(const at::Tensor& self, const at::Tensor& mat2) {
+  XLA_FN_TRACE("aten");
   // xla::dot doesn't support integer types.
   if (!self.is_floating_point() || !mat2.is_floating_point()) {
     return AtenXlaTypeDefault::bmm(self, mat2);
@@ -735,38 +1012,46 @@ at::Tensor AtenXlaType::bmm(const at::Tensor& self, const at::Tensor& mat2) {
 }
 
 std::vector<at::Tensor> AtenXlaType::broadcast_tensors(at::TensorList tensors) {
+  XLA_FN_TRACE("aten");
   return bridge::AtenFromXlaTensors(
       XLATensor::broadcast_tensors(bridge::GetXlaTensors(tensors)));
 }
 
 at::Tensor AtenXlaType::cat(at::TensorList tensors, int64_t dim) {
+  XLA_FN_TRACE("aten");
   return bridge::AtenFromXlaTensor(
       XLATensor::cat(bridge::GetXlaTensors(tensors), dim));
 }
 
 at::Tensor AtenXlaType::ceil(const at::Tensor& self) {
+  XLA_FN_TRACE("aten");
   return bridge::AtenFromXlaTensor(XLATensor::ceil(bridge::GetXlaTensor(self)));
 }
 
 at::Tensor& AtenXlaType::ceil_(at::Tensor& self) {
+  XLA_FN_TRACE("aten");
   XLATensor self_tensor = bridge::GetXlaTensor(self);
   XLATensor::ceil_(self_tensor);
   return self;
 }
 
 at::Tensor AtenXlaType::celu(const at::Tensor& self, at::Scalar alpha) {
+  XLA_FN_TRACE("aten");
   return at::native::celu(self, alpha);
 }
 
 at::Tensor& AtenXlaType::celu_(at::Tensor& self, at::Scalar alpha) {
+  XLA_FN_TRACE("aten");
   return at::native::celu_(self, alpha);
 }
 
 at::Tensor AtenXlaType::chain_matmul(at::TensorList matrices) {
+  XLA_FN_TRACE("aten");
   return at::native::chain_matmul(matrices);
 }
 
 at::Tensor AtenXlaType::cholesky(const at::Tensor& self, bool upper) {
+  XLA_FN_TRACE("aten");
   return bridge::AtenFromXlaTensor(
       XLATensor::cholesky(bridge::GetXlaTensor(self), upper));
 }
@@ -774,52 +1059,61 @@ at::Tensor AtenXlaType::cholesky(const at::Tensor& self, bool upper) {
 at::Tensor AtenXlaType::clamp(const at::Tensor& self,
                               c10::optional<at::Scalar> min,
                               c10::optional<at::Scalar> max) {
+  XLA_FN_TRACE("aten");
   return bridge::AtenFromXlaTensor(
       XLATensor::clamp(bridge::GetXlaTensor(self), min, max));
 }
 
 at::Tensor& AtenXlaType::clamp_(at::Tensor& self, c10::optional<at::Scalar> min,
                                 c10::optional<at::Scalar> max) {
+  XLA_FN_TRACE("aten");
   XLATensor self_tensor = bridge::GetXlaTensor(self);
   XLATensor::clamp_(self_tensor, min, max);
   return self;
 }
 
 at::Tensor AtenXlaType::clamp_max(const at::Tensor& self, at::Scalar max) {
+  XLA_FN_TRACE("aten");
   return bridge::AtenFromXlaTensor(
       XLATensor::clamp(bridge::GetXlaTensor(self), c10::nullopt, max));
 }
 
 at::Tensor& AtenXlaType::clamp_max_(at::Tensor& self, at::Scalar max) {
+  XLA_FN_TRACE("aten");
   XLATensor self_tensor = bridge::GetXlaTensor(self);
   XLATensor::clamp_(self_tensor, c10::nullopt, max);
   return self;
 }
 
 at::Tensor AtenXlaType::clamp_min(const at::Tensor& self, at::Scalar min) {
+  XLA_FN_TRACE("aten");
   return bridge::AtenFromXlaTensor(
       XLATensor::clamp(bridge::GetXlaTensor(self), min, c10::nullopt));
 }
 
 at::Tensor& AtenXlaType::clamp_min_(at::Tensor& self, at::Scalar min) {
+  XLA_FN_TRACE("aten");
   XLATensor self_tensor = bridge::GetXlaTensor(self);
   XLATensor::clamp_(self_tensor, min, c10::nullopt);
   return self;
 }
 
 at::Tensor AtenXlaType::clone(const at::Tensor& self) {
+  XLA_FN_TRACE("aten");
   return bridge::AtenFromXlaTensor(
       XLATensor::clone(bridge::GetXlaTensor(self)));
 }
 
 at::Tensor AtenXlaType::constant_pad_nd(const at::Tensor& self,
                                         at::IntArrayRef pad, at::Scalar value) {
+  XLA_FN_TRACE("aten");
   return bridge::AtenFromXlaTensor(XLATensor::constant_pad_nd(
       bridge::GetXlaTensor(self), XlaHelpers::I64List(pad), value));
 }
 
 at::Tensor AtenXlaType::contiguous(const at::Tensor& self,
                                    at::MemoryFormat memory_format) {
+  XLA_FN_TRACE("aten");
   return self;
 }
 
@@ -828,6 +1122,7 @@ at::Tensor AtenXlaType::convolution_overrideable(
     const at::Tensor& input, const at::Tensor& weight, const at::Tensor& bias,
     at::IntArrayRef stride, at::IntArrayRef padding, at::IntArrayRef dilation,
     bool transposed, at::IntArrayRef output_padding, int64_t groups) {
+  XLA_FN_TRACE("aten");
   if (bias.defined()) {
     return bridge::AtenFromXlaTensor(XLATensor::convolution_overrideable(
         bridge::GetXlaTensor(input), bridge::GetXlaTensor(weight),
@@ -850,6 +1145,7 @@ AtenXlaType::convolution_backward_overrideable(
     const at::Tensor& weight, at::IntArrayRef stride, at::IntArrayRef padding,
     at::IntArrayRef dilation, bool transposed, at::IntArrayRef output_padding,
     int64_t groups, std::array<bool, 3> output_mask) {
+  XLA_FN_TRACE("aten");
   auto gradients = XLATensor::convolution_backward_overrideable(
       bridge::GetXlaTensor(grad_output), bridge::GetXlaTensor(input),
       bridge::GetXlaTensor(weight), XlaHelpers::I64List(stride),
@@ -866,6 +1162,7 @@ AtenXlaType::convolution_backward_overrideable(
 
 at::Tensor& AtenXlaType::copy_(at::Tensor& self, const at::Tensor& src,
                                bool non_blocking) {
+  XLA_FN_TRACE("aten");
   XLATensor self_tensor = bridge::GetXlaTensor(self);
   c10::optional<XLATensor> src_tensor = bridge::TryGetXlaTensor(src);
   if (src_tensor) {
@@ -877,20 +1174,24 @@ at::Tensor& AtenXlaType::copy_(at::Tensor& self, const at::Tensor& src,
 }
 
 at::Tensor AtenXlaType::cos(const at::Tensor& self) {
+  XLA_FN_TRACE("aten");
   return bridge::AtenFromXlaTensor(XLATensor::cos(bridge::GetXlaTensor(self)));
 }
 
 at::Tensor& AtenXlaType::cos_(at::Tensor& self) {
+  XLA_FN_TRACE("aten");
   XLATensor self_tensor = bridge::GetXlaTensor(self);
   XLATensor::cos_(self_tensor);
   return self;
 }
 
 at::Tensor AtenXlaType::cosh(const at::Tensor& self) {
+  XLA_FN_TRACE("aten");
   return bridge::AtenFromXlaTensor(XLATensor::cosh(bridge::GetXlaTensor(self)));
 }
 
 at::Tensor& AtenXlaType::cosh_(at::Tensor& self) {
+  XLA_FN_TRACE("aten");
   XLATensor self_tensor = bridge::GetXlaTensor(self);
   XLATensor::cosh_(self_tensor);
   return self;
@@ -901,6 +1202,7 @@ at::Tensor AtenXlaType::cosine_embedding_loss(const at::Tensor& input1,
                                               const at::Tensor& target,
                                               double margin,
                                               int64_t reduction) {
+  XLA_FN_TRACE("aten");
   return at::native::cosine_embedding_loss(input1, input2, target, margin,
                                            reduction);
 }
@@ -908,11 +1210,13 @@ at::Tensor AtenXlaType::cosine_embedding_loss(const at::Tensor& input1,
 at::Tensor AtenXlaType::cosine_similarity(const at::Tensor& x1,
                                           const at::Tensor& x2, int64_t dim,
                                           double eps) {
+  XLA_FN_TRACE("aten");
   return at::native::cosine_similarity(x1, x2, dim, eps);
 }
 
 at::Tensor AtenXlaType::cross(const at::Tensor& self, const at::Tensor& other,
                               c10::optional<int64_t> dim) {
+  XLA_FN_TRACE("aten");
   return bridge::AtenFromXlaTensor(
       XLATensor::cross(bridge::GetXlaTensor(self), bridge::GetXlaTensor(other),
                        XlaHelpers::I64Optional(dim)));
@@ -920,6 +1224,7 @@ at::Tensor AtenXlaType::cross(const at::Tensor& self, const at::Tensor& other,
 
 at::Tensor AtenXlaType::cumprod(const at::Tensor& self, int64_t dim,
                                 c10::optional<at::ScalarType> dtype) {
+  XLA_FN_TRACE("aten");
   XLATensor self_tensor = bridge::GetXlaTensor(self);
   if (IsOperationOnType(dtype, self_tensor.dtype(), at::ScalarType::Long)) {
     // XLA reduce-window does not support S64 mode.
@@ -930,6 +1235,7 @@ at::Tensor AtenXlaType::cumprod(const at::Tensor& self, int64_t dim,
 
 at::Tensor AtenXlaType::cumsum(const at::Tensor& self, int64_t dim,
                                c10::optional<at::ScalarType> dtype) {
+  XLA_FN_TRACE("aten");
   XLATensor self_tensor = bridge::GetXlaTensor(self);
   if (IsOperationOnType(dtype, self_tensor.dtype(), at::ScalarType::Long)) {
     // XLA reduce-window does not support S64 mode.
@@ -939,21 +1245,25 @@ at::Tensor AtenXlaType::cumsum(const at::Tensor& self, int64_t dim,
 }
 
 at::Tensor AtenXlaType::diag(const at::Tensor& self, int64_t diagonal) {
+  XLA_FN_TRACE("aten");
   return bridge::AtenFromXlaTensor(
       XLATensor::diag(bridge::GetXlaTensor(self), diagonal));
 }
 
 at::Tensor AtenXlaType::diagflat(const at::Tensor& self, int64_t offset) {
+  XLA_FN_TRACE("aten");
   return at::native::diagflat(self, offset);
 }
 
 at::Tensor AtenXlaType::diagonal(const at::Tensor& self, int64_t offset,
                                  int64_t dim1, int64_t dim2) {
+  XLA_FN_TRACE("aten");
   return bridge::AtenFromXlaTensor(
       XLATensor::diagonal(bridge::GetXlaTensor(self), offset, dim1, dim2));
 }
 
 at::Tensor AtenXlaType::div(const at::Tensor& self, const at::Tensor& other) {
+  XLA_FN_TRACE("aten");
   XLATensor self_tensor = bridge::GetXlaTensor(self);
   return bridge::AtenFromXlaTensor(XLATensor::div(
       self_tensor,
@@ -961,11 +1271,13 @@ at::Tensor AtenXlaType::div(const at::Tensor& self, const at::Tensor& other) {
 }
 
 at::Tensor AtenXlaType::div(const at::Tensor& self, at::Scalar other) {
+  XLA_FN_TRACE("aten");
   return bridge::AtenFromXlaTensor(
       XLATensor::div(bridge::GetXlaTensor(self), other));
 }
 
 at::Tensor& AtenXlaType::div_(at::Tensor& self, const at::Tensor& other) {
+  XLA_FN_TRACE("aten");
   XLATensor self_tensor = bridge::GetXlaTensor(self);
   XLATensor::div_(self_tensor,
                   bridge::GetOrCreateXlaTensor(other, self_tensor.GetDevice()));
@@ -973,12 +1285,14 @@ at::Tensor& AtenXlaType::div_(at::Tensor& self, const at::Tensor& other) {
 }
 
 at::Tensor& AtenXlaType::div_(at::Tensor& self, at::Scalar other) {
+  XLA_FN_TRACE("aten");
   XLATensor self_tensor = bridge::GetXlaTensor(self);
   XLATensor::div_(self_tensor, other);
   return self;
 }
 
 at::Tensor AtenXlaType::dot(const at::Tensor& self, const at::Tensor& tensor) {
+  XLA_FN_TRACE("aten");
   XLA_CHECK_EQ(self.dim(), 1)
       << "dot: Expected 1-D argument self, but got " << self.dim() << "-D";
   XLA_CHECK_EQ(tensor.dim(), 1)
@@ -987,12 +1301,14 @@ at::Tensor AtenXlaType::dot(const at::Tensor& self, const at::Tensor& tensor) {
 }
 
 at::Tensor AtenXlaType::dropout(const at::Tensor& input, double p, bool train) {
+  XLA_FN_TRACE("aten");
   return train ? bridge::AtenFromXlaTensor(
                      XLATensor::dropout(bridge::GetXlaTensor(input), p))
                : input;
 }
 
 at::Tensor& AtenXlaType::dropout_(at::Tensor& self, double p, bool train) {
+  XLA_FN_TRACE("aten");
   if (train) {
     XLATensor self_tensor = bridge::GetXlaTensor(self);
     XLATensor::dropout_(self_tensor, p);
@@ -1001,7 +1317,8 @@ at::Tensor& AtenXlaType::dropout_(at::Tensor& self, double p, bool train) {
 }
 
 at::Tensor AtenXlaType::einsum(std::string equation, at::TensorList tensors) {
-  if (tensors.size() != 2 || !ir::ops::Einsum::SupportsEquation(equation)) {
+  XLA_FN_TRACE("aten");
+  if (!ir::ops::Einsum::SupportsEquation(equation, tensors.size())) {
     return at::native::einsum(equation, tensors);
   }
   return bridge::AtenFromXlaTensor(
@@ -1010,12 +1327,14 @@ at::Tensor AtenXlaType::einsum(std::string equation, at::TensorList tensors) {
 
 at::Tensor AtenXlaType::elu(const at::Tensor& self, at::Scalar alpha,
                             at::Scalar scale, at::Scalar input_scale) {
+  XLA_FN_TRACE("aten");
   return bridge::AtenFromXlaTensor(
       XLATensor::elu(bridge::GetXlaTensor(self), alpha, scale, input_scale));
 }
 
 at::Tensor& AtenXlaType::elu_(at::Tensor& self, at::Scalar alpha,
                               at::Scalar scale, at::Scalar input_scale) {
+  XLA_FN_TRACE("aten");
   XLATensor self_tensor = bridge::GetXlaTensor(self);
   XLATensor::elu_(self_tensor, alpha, scale, input_scale);
   return self;
@@ -1025,6 +1344,7 @@ at::Tensor AtenXlaType::elu_backward(const at::Tensor& grad_output,
                                      at::Scalar alpha, at::Scalar scale,
                                      at::Scalar input_scale,
                                      const at::Tensor& output) {
+  XLA_FN_TRACE("aten");
   return bridge::AtenFromXlaTensor(
       XLATensor::elu_backward(bridge::GetXlaTensor(grad_output), alpha, scale,
                               input_scale, bridge::GetXlaTensor(output)));
@@ -1034,6 +1354,7 @@ at::Tensor AtenXlaType::embedding(const at::Tensor& weight,
                                   const at::Tensor& indices,
                                   int64_t padding_idx, bool scale_grad_by_freq,
                                   bool sparse) {
+  XLA_FN_TRACE("aten");
   // TODO: for now route to native, which dispatches supported XLA operations.
   // We need to make use of the TPU embedding core here eventually.
   return at::native::embedding(weight, indices, padding_idx, scale_grad_by_freq,
@@ -1045,6 +1366,7 @@ at::Tensor AtenXlaType::embedding_dense_backward(const at::Tensor& grad_output,
                                                  int64_t num_weights,
                                                  int64_t padding_idx,
                                                  bool scale_grad_by_freq) {
+  XLA_FN_TRACE("aten");
   return bridge::AtenFromXlaTensor(XLATensor::embedding_dense_backward(
       bridge::GetXlaTensor(grad_output), bridge::GetXlaTensor(indices),
       num_weights, padding_idx, scale_grad_by_freq));
@@ -1053,6 +1375,7 @@ at::Tensor AtenXlaType::embedding_dense_backward(const at::Tensor& grad_output,
 at::Tensor AtenXlaType::empty(at::IntArrayRef size,
                               const at::TensorOptions& options,
                               c10::optional<at::MemoryFormat> memory_format) {
+  XLA_FN_TRACE("aten");
   // PT empty*() are optimizations to avoid initializing the data when it is
   // known it will be completely rewritten. But since for us doing a zero*()
   // does not actually end up doing any memory initialization, we use that and
@@ -1062,80 +1385,95 @@ at::Tensor AtenXlaType::empty(at::IntArrayRef size,
 }
 
 at::Tensor AtenXlaType::empty_like(const at::Tensor& self) {
+  XLA_FN_TRACE("aten");
   return full_like(self, 0);
 }
 
 at::Tensor AtenXlaType::empty_like(
     const at::Tensor& self, const at::TensorOptions& options,
     c10::optional<at::MemoryFormat> memory_format) {
+  XLA_FN_TRACE("aten");
   return full_like(self, 0, options);
 }
 
 at::Tensor AtenXlaType::empty_strided(at::IntArrayRef size,
                                       at::IntArrayRef stride,
                                       const at::TensorOptions& options) {
+  XLA_FN_TRACE("aten");
   at::Tensor t = full(size, 0, options);
   return as_strided(t, size, stride, /*storage_offset=*/0);
 }
 
 at::Tensor AtenXlaType::eq(const at::Tensor& self, at::Scalar other) {
+  XLA_FN_TRACE("aten");
   return bridge::AtenFromXlaTensor(
       XLATensor::eq(bridge::GetXlaTensor(self), other));
 }
 
 at::Tensor AtenXlaType::eq(const at::Tensor& self, const at::Tensor& other) {
+  XLA_FN_TRACE("aten");
   return bridge::AtenFromXlaTensor(
       XLATensor::eq(bridge::GetXlaTensor(self), bridge::GetXlaTensor(other)));
 }
 
 at::Tensor& AtenXlaType::eq_(at::Tensor& self, at::Scalar other) {
+  XLA_FN_TRACE("aten");
   XLATensor self_tensor = bridge::GetXlaTensor(self);
   XLATensor::eq_(self_tensor, other);
   return self;
 }
 
 at::Tensor& AtenXlaType::eq_(at::Tensor& self, const at::Tensor& other) {
+  XLA_FN_TRACE("aten");
   XLATensor self_tensor = bridge::GetXlaTensor(self);
   XLATensor::eq_(self_tensor, bridge::GetXlaTensor(other));
   return self;
 }
 
 at::Tensor AtenXlaType::erf(const at::Tensor& self) {
+  XLA_FN_TRACE("aten");
   return bridge::AtenFromXlaTensor(XLATensor::erf(bridge::GetXlaTensor(self)));
 }
 
 at::Tensor& AtenXlaType::erf_(at::Tensor& self) {
+  XLA_FN_TRACE("aten");
   XLATensor self_tensor = bridge::GetXlaTensor(self);
   XLATensor::erf_(self_tensor);
   return self;
 }
 
 at::Tensor AtenXlaType::erfc(const at::Tensor& self) {
+  XLA_FN_TRACE("aten");
   return bridge::AtenFromXlaTensor(XLATensor::erfc(bridge::GetXlaTensor(self)));
 }
 
 at::Tensor& AtenXlaType::erfc_(at::Tensor& self) {
+  XLA_FN_TRACE("aten");
   XLATensor self_tensor = bridge::GetXlaTensor(self);
   XLATensor::erfc_(self_tensor);
   return self;
 }
 
 at::Tensor AtenXlaType::erfinv(const at::Tensor& self) {
+  XLA_FN_TRACE("aten");
   return bridge::AtenFromXlaTensor(
       XLATensor::erfinv(bridge::GetXlaTensor(self)));
 }
 
 at::Tensor& AtenXlaType::erfinv_(at::Tensor& self) {
+  XLA_FN_TRACE("aten");
   XLATensor self_tensor = bridge::GetXlaTensor(self);
   XLATensor::erfinv_(self_tensor);
   return self;
 }
 
 at::Tensor AtenXlaType::exp(const at::Tensor& self) {
+  XLA_FN_TRACE("aten");
   return bridge::AtenFromXlaTensor(XLATensor::exp(bridge::GetXlaTensor(self)));
 }
 
 at::Tensor& AtenXlaType::exp_(at::Tensor& self) {
+  XLA_FN_TRACE("aten");
   XLATensor self_tensor = bridge::GetXlaTensor(self);
   XLATensor::exp_(self_tensor);
   return self;
@@ -1143,12 +1481,14 @@ at::Tensor& AtenXlaType::exp_(at::Tensor& self) {
 
 at::Tensor AtenXlaType::expand(const at::Tensor& self, at::IntArrayRef size,
                                bool implicit) {
+  XLA_FN_TRACE("aten");
   return bridge::AtenFromXlaTensor(XLATensor::expand(
       bridge::GetXlaTensor(self), xla::util::ToVector<xla::int64>(size)));
 }
 
 at::Tensor AtenXlaType::expand_as(const at::Tensor& self,
                                   const at::Tensor& other) {
+  XLA_FN_TRACE("aten");
   XLATensor other_tensor = bridge::GetXlaTensor(other);
   return bridge::AtenFromXlaTensor(
       XLATensor::expand(bridge::GetXlaTensor(self),
@@ -1157,34 +1497,40 @@ at::Tensor AtenXlaType::expand_as(const at::Tensor& self,
 }
 
 at::Tensor AtenXlaType::expm1(const at::Tensor& self) {
+  XLA_FN_TRACE("aten");
   return bridge::AtenFromXlaTensor(
       XLATensor::expm1(bridge::GetXlaTensor(self)));
 }
 
 at::Tensor& AtenXlaType::expm1_(at::Tensor& self) {
+  XLA_FN_TRACE("aten");
   XLATensor self_tensor = bridge::GetXlaTensor(self);
   XLATensor::expm1_(self_tensor);
   return self;
 }
 
 at::Tensor AtenXlaType::eye(int64_t n, const at::TensorOptions& options) {
+  XLA_FN_TRACE("aten");
   return eye(n, n, options);
 }
 
 at::Tensor AtenXlaType::eye(int64_t n, int64_t m,
                             const at::TensorOptions& options) {
+  XLA_FN_TRACE("aten");
   XlaOptions xla_options(options);
   return bridge::AtenFromXlaTensor(XLATensor::eye(
       n, m, xla_options.get_device(), xla_options.get_scalar_type()));
 }
 
 at::Tensor& AtenXlaType::fill_(at::Tensor& self, at::Scalar value) {
+  XLA_FN_TRACE("aten");
   XLATensor self_tensor = bridge::GetXlaTensor(self);
   XLATensor::fill_(self_tensor, value);
   return self;
 }
 
 at::Tensor& AtenXlaType::fill_(at::Tensor& self, const at::Tensor& value) {
+  XLA_FN_TRACE("aten");
   XLA_CHECK_EQ(value.dim(), 0) << "fill_ only supports a 0-dimensional "
                                << "value tensor, but got tensor "
                                << "with " << value.dim() << " dimension(s).";
@@ -1193,68 +1539,81 @@ at::Tensor& AtenXlaType::fill_(at::Tensor& self, const at::Tensor& value) {
 
 at::Tensor AtenXlaType::flatten(const at::Tensor& self, int64_t start_dim,
                                 int64_t end_dim) {
+  XLA_FN_TRACE("aten");
   return at::native::flatten(self, start_dim, end_dim);
 }
 
 at::Tensor AtenXlaType::flip(const at::Tensor& self, at::IntArrayRef dims) {
+  XLA_FN_TRACE("aten");
   return bridge::AtenFromXlaTensor(
       XLATensor::flip(bridge::GetXlaTensor(self), XlaHelpers::I64List(dims)));
 }
 
 at::Tensor AtenXlaType::floor(const at::Tensor& self) {
+  XLA_FN_TRACE("aten");
   return bridge::AtenFromXlaTensor(
       XLATensor::floor(bridge::GetXlaTensor(self)));
 }
 
 at::Tensor& AtenXlaType::floor_(at::Tensor& self) {
+  XLA_FN_TRACE("aten");
   XLATensor self_tensor = bridge::GetXlaTensor(self);
   XLATensor::floor_(self_tensor);
   return self;
 }
 
 at::Tensor AtenXlaType::fmod(const at::Tensor& self, const at::Tensor& other) {
+  XLA_FN_TRACE("aten");
   return bridge::AtenFromXlaTensor(
       XLATensor::fmod(bridge::GetXlaTensor(self), bridge::GetXlaTensor(other)));
 }
 
 at::Tensor AtenXlaType::fmod(const at::Tensor& self, at::Scalar other) {
+  XLA_FN_TRACE("aten");
   return bridge::AtenFromXlaTensor(
       XLATensor::fmod(bridge::GetXlaTensor(self), other));
 }
 
 at::Tensor& AtenXlaType::fmod_(at::Tensor& self, const at::Tensor& other) {
+  XLA_FN_TRACE("aten");
   XLATensor self_tensor = bridge::GetXlaTensor(self);
   XLATensor::fmod_(self_tensor, bridge::GetXlaTensor(other));
   return self;
 }
 
 at::Tensor& AtenXlaType::fmod_(at::Tensor& self, at::Scalar other) {
+  XLA_FN_TRACE("aten");
   XLATensor self_tensor = bridge::GetXlaTensor(self);
   XLATensor::fmod_(self_tensor, other);
   return self;
 }
 
 at::Tensor AtenXlaType::frac(const at::Tensor& self) {
+  XLA_FN_TRACE("aten");
   return bridge::AtenFromXlaTensor(XLATensor::frac(bridge::GetXlaTensor(self)));
 }
 
 at::Tensor& AtenXlaType::frac_(at::Tensor& self) {
+  XLA_FN_TRACE("aten");
   XLATensor self_tensor = bridge::GetXlaTensor(self);
   XLATensor::frac_(self_tensor);
   return self;
 }
 
 at::Tensor AtenXlaType::frobenius_norm(const at::Tensor& self) {
+  XLA_FN_TRACE("aten");
   return at::native::frobenius_norm(self);
 }
 
 at::Tensor AtenXlaType::frobenius_norm(const at::Tensor& self,
                                        at::IntArrayRef dim, bool keepdim) {
+  XLA_FN_TRACE("aten");
   return at::native::frobenius_norm(self, dim, keepdim);
 }
 
 at::Tensor AtenXlaType::full(at::IntArrayRef size, at::Scalar fill_value,
                              const at::TensorOptions& options) {
+  XLA_FN_TRACE("aten");
   XlaOptions xla_options(options);
   return bridge::AtenFromXlaTensor(
       XLATensor::full(XlaHelpers::I64List(size), fill_value,
@@ -1263,6 +1622,7 @@ at::Tensor AtenXlaType::full(at::IntArrayRef size, at::Scalar fill_value,
 
 at::Tensor AtenXlaType::full_like(const at::Tensor& self,
                                   at::Scalar fill_value) {
+  XLA_FN_TRACE("aten");
   XLATensor self_tensor = bridge::GetXlaTensorUnwrap(self);
   return bridge::AtenFromXlaTensor(XLATensor::full_like(
       self_tensor, fill_value, self_tensor.GetDevice(), c10::nullopt));
@@ -1270,6 +1630,7 @@ at::Tensor AtenXlaType::full_like(const at::Tensor& self,
 
 at::Tensor AtenXlaType::full_like(const at::Tensor& self, at::Scalar fill_value,
                                   const at::TensorOptions& options) {
+  XLA_FN_TRACE("aten");
   XLATensor self_tensor = bridge::GetXlaTensorUnwrap(self);
   XlaOptions xla_options(options, self_tensor.GetDevice());
   return bridge::AtenFromXlaTensor(
@@ -1280,27 +1641,32 @@ at::Tensor AtenXlaType::full_like(const at::Tensor& self, at::Scalar fill_value,
 at::Tensor AtenXlaType::gather(const at::Tensor& self, int64_t dim,
                                const at::Tensor& index,
                                bool /* sparse_grad */) {
+  XLA_FN_TRACE("aten");
   return bridge::AtenFromXlaTensor(XLATensor::gather(
       bridge::GetXlaTensor(self), dim, bridge::GetXlaTensor(index)));
 }
 
 at::Tensor AtenXlaType::ge(const at::Tensor& self, at::Scalar other) {
+  XLA_FN_TRACE("aten");
   return bridge::AtenFromXlaTensor(
       XLATensor::ge(bridge::GetXlaTensor(self), other));
 }
 
 at::Tensor AtenXlaType::ge(const at::Tensor& self, const at::Tensor& other) {
+  XLA_FN_TRACE("aten");
   return bridge::AtenFromXlaTensor(
       XLATensor::ge(bridge::GetXlaTensor(self), bridge::GetXlaTensor(other)));
 }
 
 at::Tensor& AtenXlaType::ge_(at::Tensor& self, at::Scalar other) {
+  XLA_FN_TRACE("aten");
   XLATensor self_tensor = bridge::GetXlaTensor(self);
   XLATensor::ge_(self_tensor, other);
   return self;
 }
 
 at::Tensor& AtenXlaType::ge_(at::Tensor& self, const at::Tensor& other) {
+  XLA_FN_TRACE("aten");
   XLATensor self_tensor = bridge::GetXlaTensor(self);
   XLATensor::ge_(self_tensor, bridge::GetXlaTensor(other));
   return self;
@@ -1310,27 +1676,32 @@ at::Tensor AtenXlaType::group_norm(const at::Tensor& input, int64_t num_groups,
                                    const at::Tensor& weight,
                                    const at::Tensor& bias, double eps,
                                    bool cudnn_enabled) {
+  XLA_FN_TRACE("aten");
   return at::native::group_norm(input, num_groups, weight, bias, eps,
                                 cudnn_enabled);
 }
 
 at::Tensor AtenXlaType::gt(const at::Tensor& self, at::Scalar other) {
+  XLA_FN_TRACE("aten");
   return bridge::AtenFromXlaTensor(
       XLATensor::gt(bridge::GetXlaTensor(self), other));
 }
 
 at::Tensor AtenXlaType::gt(const at::Tensor& self, const at::Tensor& other) {
+  XLA_FN_TRACE("aten");
   return bridge::AtenFromXlaTensor(
       XLATensor::gt(bridge::GetXlaTensor(self), bridge::GetXlaTensor(other)));
 }
 
 at::Tensor& AtenXlaType::gt_(at::Tensor& self, at::Scalar other) {
+  XLA_FN_TRACE("aten");
   XLATensor self_tensor = bridge::GetXlaTensor(self);
   XLATensor::gt_(self_tensor, other);
   return self;
 }
 
 at::Tensor& AtenXlaType::gt_(at::Tensor& self, const at::Tensor& other) {
+  XLA_FN_TRACE("aten");
   XLATensor self_tensor = bridge::GetXlaTensor(self);
   XLATensor::gt_(self_tensor, bridge::GetXlaTensor(other));
   return self;
@@ -1338,38 +1709,45 @@ at::Tensor& AtenXlaType::gt_(at::Tensor& self, const at::Tensor& other) {
 
 at::Tensor AtenXlaType::hamming_window(int64_t window_length,
                                        const at::TensorOptions& options) {
+  XLA_FN_TRACE("aten");
   return at::native::hamming_window(window_length, options);
 }
 
 at::Tensor AtenXlaType::hamming_window(int64_t window_length, bool periodic,
                                        const at::TensorOptions& options) {
+  XLA_FN_TRACE("aten");
   return at::native::hamming_window(window_length, periodic, options);
 }
 
 at::Tensor AtenXlaType::hamming_window(int64_t window_length, bool periodic,
                                        double alpha,
                                        const at::TensorOptions& options) {
+  XLA_FN_TRACE("aten");
   return at::native::hamming_window(window_length, periodic, alpha, options);
 }
 
 at::Tensor AtenXlaType::hamming_window(int64_t window_length, bool periodic,
                                        double alpha, double beta,
                                        const at::TensorOptions& options) {
+  XLA_FN_TRACE("aten");
   return at::native::hamming_window(window_length, periodic, alpha, beta,
                                     options);
 }
 
 at::Tensor AtenXlaType::hann_window(int64_t window_length,
                                     const at::TensorOptions& options) {
+  XLA_FN_TRACE("aten");
   return at::native::hann_window(window_length, options);
 }
 
 at::Tensor AtenXlaType::hann_window(int64_t window_length, bool periodic,
                                     const at::TensorOptions& options) {
+  XLA_FN_TRACE("aten");
   return at::native::hann_window(window_length, periodic, options);
 }
 
 at::Tensor AtenXlaType::hardshrink(const at::Tensor& self, at::Scalar lambda) {
+  XLA_FN_TRACE("aten");
   return bridge::AtenFromXlaTensor(
       XLATensor::hardshrink(bridge::GetXlaTensor(self), lambda));
 }
@@ -1377,18 +1755,21 @@ at::Tensor AtenXlaType::hardshrink(const at::Tensor& self, at::Scalar lambda) {
 at::Tensor AtenXlaType::hardshrink_backward(const at::Tensor& grad_out,
                                             const at::Tensor& self,
                                             at::Scalar lambda) {
+  XLA_FN_TRACE("aten");
   return bridge::AtenFromXlaTensor(XLATensor::hardshrink_backward(
       bridge::GetXlaTensor(grad_out), bridge::GetXlaTensor(self), lambda));
 }
 
 at::Tensor AtenXlaType::hardtanh(const at::Tensor& self, at::Scalar min_val,
                                  at::Scalar max_val) {
+  XLA_FN_TRACE("aten");
   return bridge::AtenFromXlaTensor(
       XLATensor::clamp(bridge::GetXlaTensor(self), min_val, max_val));
 }
 
 at::Tensor& AtenXlaType::hardtanh_(at::Tensor& self, at::Scalar min_val,
                                    at::Scalar max_val) {
+  XLA_FN_TRACE("aten");
   XLATensor self_tensor = bridge::GetXlaTensor(self);
   XLATensor::clamp_(self_tensor, min_val, max_val);
   return self;
@@ -1398,6 +1779,7 @@ at::Tensor AtenXlaType::hardtanh_backward(const at::Tensor& grad_output,
                                           const at::Tensor& self,
                                           at::Scalar min_val,
                                           at::Scalar max_val) {
+  XLA_FN_TRACE("aten");
   return bridge::AtenFromXlaTensor(XLATensor::hardtanh_backward(
       bridge::GetXlaTensor(grad_output), bridge::GetXlaTensor(self), min_val,
       max_val));
@@ -1406,21 +1788,25 @@ at::Tensor AtenXlaType::hardtanh_backward(const at::Tensor& grad_output,
 at::Tensor AtenXlaType::hinge_embedding_loss(const at::Tensor& self,
                                              const at::Tensor& target,
                                              double margin, int64_t reduction) {
+  XLA_FN_TRACE("aten");
   return at::native::hinge_embedding_loss(self, target, margin, reduction);
 }
 
 at::Tensor AtenXlaType::index(const at::Tensor& self, at::TensorList indices) {
+  XLA_FN_TRACE("aten");
   CanonicalIndexInfo canonical_index_info =
       GetCanonicalIndexInfo(self, indices);
   return bridge::AtenFromXlaTensor(
-      XLATensor::index(bridge::GetXlaTensor(canonical_index_info.base),
+      XLATensor::index(bridge::GetXlaTensor(self),
                        bridge::GetXlaTensors(canonical_index_info.indices),
+                       canonical_index_info.index_dims,
                        canonical_index_info.start_dim));
 }
 
 at::Tensor AtenXlaType::index_add(const at::Tensor& self, int64_t dim,
                                   const at::Tensor& index,
                                   const at::Tensor& source) {
+  XLA_FN_TRACE("aten");
   return bridge::AtenFromXlaTensor(XLATensor::index_add(
       bridge::GetXlaTensor(self), dim, bridge::GetXlaTensor(index),
       bridge::GetXlaTensor(source)));
@@ -1429,6 +1815,7 @@ at::Tensor AtenXlaType::index_add(const at::Tensor& self, int64_t dim,
 at::Tensor& AtenXlaType::index_add_(at::Tensor& self, int64_t dim,
                                     const at::Tensor& index,
                                     const at::Tensor& source) {
+  XLA_FN_TRACE("aten");
   XLATensor self_tensor = bridge::GetXlaTensor(self);
   XLATensor::index_add_(self_tensor, dim, bridge::GetXlaTensor(index),
                         bridge::GetXlaTensor(source));
@@ -1438,6 +1825,7 @@ at::Tensor& AtenXlaType::index_add_(at::Tensor& self, int64_t dim,
 at::Tensor AtenXlaType::index_copy(const at::Tensor& self, int64_t dim,
                                    const at::Tensor& index,
                                    const at::Tensor& source) {
+  XLA_FN_TRACE("aten");
   return bridge::AtenFromXlaTensor(XLATensor::index_copy(
       bridge::GetXlaTensor(self), dim, bridge::GetXlaTensor(index),
       bridge::GetXlaTensor(source)));
@@ -1446,6 +1834,7 @@ at::Tensor AtenXlaType::index_copy(const at::Tensor& self, int64_t dim,
 at::Tensor& AtenXlaType::index_copy_(at::Tensor& self, int64_t dim,
                                      const at::Tensor& index,
                                      const at::Tensor& source) {
+  XLA_FN_TRACE("aten");
   XLATensor self_tensor = bridge::GetXlaTensor(self);
   XLATensor::index_copy_(self_tensor, dim, bridge::GetXlaTensor(index),
                          bridge::GetXlaTensor(source));
@@ -1454,6 +1843,7 @@ at::Tensor& AtenXlaType::index_copy_(at::Tensor& self, int64_t dim,
 
 at::Tensor AtenXlaType::index_fill(const at::Tensor& self, int64_t dim,
                                    const at::Tensor& index, at::Scalar value) {
+  XLA_FN_TRACE("aten");
   return bridge::AtenFromXlaTensor(XLATensor::index_fill(
       bridge::GetXlaTensor(self), dim, bridge::GetXlaTensor(index), value));
 }
@@ -1461,6 +1851,7 @@ at::Tensor AtenXlaType::index_fill(const at::Tensor& self, int64_t dim,
 at::Tensor AtenXlaType::index_fill(const at::Tensor& self, int64_t dim,
                                    const at::Tensor& index,
                                    const at::Tensor& value) {
+  XLA_FN_TRACE("aten");
   return bridge::AtenFromXlaTensor(XLATensor::index_fill(
       bridge::GetXlaTensor(self), dim, bridge::GetXlaTensor(index),
       bridge::GetXlaTensor(value)));
@@ -1469,6 +1860,7 @@ at::Tensor AtenXlaType::index_fill(const at::Tensor& self, int64_t dim,
 at::Tensor& AtenXlaType::index_fill_(at::Tensor& self, int64_t dim,
                                      const at::Tensor& index,
                                      at::Scalar value) {
+  XLA_FN_TRACE("aten");
   XLATensor self_tensor = bridge::GetXlaTensor(self);
   XLATensor::index_fill_(self_tensor, dim, bridge::GetXlaTensor(index), value);
   return self;
@@ -1477,6 +1869,7 @@ at::Tensor& AtenXlaType::index_fill_(at::Tensor& self, int64_t dim,
 at::Tensor& AtenXlaType::index_fill_(at::Tensor& self, int64_t dim,
                                      const at::Tensor& index,
                                      const at::Tensor& value) {
+  XLA_FN_TRACE("aten");
   XLATensor self_tensor = bridge::GetXlaTensor(self);
   XLATensor::index_fill_(self_tensor, dim, bridge::GetXlaTensor(index),
                          bridge::GetXlaTensor(value));
@@ -1486,30 +1879,33 @@ at::Tensor& AtenXlaType::index_fill_(at::Tensor& self, int64_t dim,
 at::Tensor AtenXlaType::index_put(const at::Tensor& self,
                                   at::TensorList indices,
                                   const at::Tensor& values, bool accumulate) {
+  XLA_FN_TRACE("aten");
   CanonicalIndexInfo canonical_index_info =
       GetCanonicalIndexInfo(self, indices);
   return bridge::AtenFromXlaTensor(XLATensor::index_put(
-      bridge::GetXlaTensor(canonical_index_info.base),
+      bridge::GetXlaTensor(self),
       bridge::GetXlaTensors(canonical_index_info.indices),
-      canonical_index_info.start_dim, bridge::GetXlaTensor(values), accumulate,
-      canonical_index_info.result_permutation));
+      canonical_index_info.index_dims, canonical_index_info.start_dim,
+      bridge::GetXlaTensor(values), accumulate));
 }
 
 at::Tensor& AtenXlaType::index_put_(at::Tensor& self, at::TensorList indices,
                                     const at::Tensor& values, bool accumulate) {
+  XLA_FN_TRACE("aten");
   CanonicalIndexInfo canonical_index_info =
       GetCanonicalIndexInfo(self, indices);
   XLATensor self_tensor = bridge::GetXlaTensor(self);
-  XLATensor::index_put_(
-      self_tensor, bridge::GetXlaTensor(canonical_index_info.base),
-      bridge::GetXlaTensors(canonical_index_info.indices),
-      canonical_index_info.start_dim, bridge::GetXlaTensor(values), accumulate,
-      canonical_index_info.result_permutation);
+  XLATensor::index_put_(self_tensor,
+                        bridge::GetXlaTensors(canonical_index_info.indices),
+                        canonical_index_info.index_dims,
+                        canonical_index_info.start_dim,
+                        bridge::GetXlaTensor(values), accumulate);
   return self;
 }
 
 at::Tensor AtenXlaType::index_select(const at::Tensor& self, int64_t dim,
                                      const at::Tensor& index) {
+  XLA_FN_TRACE("aten");
   return bridge::AtenFromXlaTensor(XLATensor::index_select(
       bridge::GetXlaTensor(self), dim, bridge::GetXlaTensor(index)));
 }
@@ -1518,6 +1914,7 @@ at::Tensor AtenXlaType::instance_norm(
     const at::Tensor& input, const at::Tensor& weight, const at::Tensor& bias,
     const at::Tensor& running_mean, const at::Tensor& running_var,
     bool use_input_stats, double momentum, double eps, bool cudnn_enabled) {
+  XLA_FN_TRACE("aten");
   if (cudnn_enabled || !use_input_stats) {
     return AtenXlaTypeDefault::instance_norm(input, weight, bias, running_mean,
                                              running_var, use_input_stats,
@@ -1529,15 +1926,18 @@ at::Tensor AtenXlaType::instance_norm(
 }
 
 bool AtenXlaType::is_floating_point(const at::Tensor& self) {
+  XLA_FN_TRACE("aten");
   return at::isFloatingType(self.scalar_type());
 }
 
 bool AtenXlaType::is_signed(const at::Tensor& self) {
+  XLA_FN_TRACE("aten");
   return at::isSignedType(self.scalar_type());
 }
 
 at::Tensor AtenXlaType::kl_div(const at::Tensor& self, const at::Tensor& target,
                                int64_t reduction) {
+  XLA_FN_TRACE("aten");
   return at::native::kl_div(self, target, reduction);
 }
 
@@ -1545,6 +1945,7 @@ at::Tensor AtenXlaType::kl_div_backward(const at::Tensor& grad_output,
                                         const at::Tensor& self,
                                         const at::Tensor& target,
                                         int64_t reduction) {
+  XLA_FN_TRACE("aten");
   return bridge::AtenFromXlaTensor(XLATensor::kl_div_backward(
       bridge::GetXlaTensor(grad_output), bridge::GetXlaTensor(self),
       bridge::GetXlaTensor(target), reduction));
@@ -1553,6 +1954,7 @@ at::Tensor AtenXlaType::kl_div_backward(const at::Tensor& grad_output,
 std::tuple<at::Tensor, at::Tensor> AtenXlaType::kthvalue(const at::Tensor& self,
                                                          int64_t k, int64_t dim,
                                                          bool keepdim) {
+  XLA_FN_TRACE("aten");
   auto results =
       XLATensor::kthvalue(bridge::GetXlaTensor(self), k, dim, keepdim);
   return std::make_tuple(bridge::AtenFromXlaTensor(std::get<0>(results)),
@@ -1564,27 +1966,32 @@ at::Tensor AtenXlaType::layer_norm(const at::Tensor& input,
                                    const at::Tensor& weight,
                                    const at::Tensor& bias, double eps,
                                    bool cudnn_enable) {
+  XLA_FN_TRACE("aten");
   return at::native::layer_norm(input, normalized_shape, weight, bias, eps,
                                 cudnn_enable);
 }
 
 at::Tensor AtenXlaType::le(const at::Tensor& self, at::Scalar other) {
+  XLA_FN_TRACE("aten");
   return bridge::AtenFromXlaTensor(
       XLATensor::le(bridge::GetXlaTensor(self), other));
 }
 
 at::Tensor AtenXlaType::le(const at::Tensor& self, const at::Tensor& other) {
+  XLA_FN_TRACE("aten");
   return bridge::AtenFromXlaTensor(
       XLATensor::le(bridge::GetXlaTensor(self), bridge::GetXlaTensor(other)));
 }
 
 at::Tensor& AtenXlaType::le_(at::Tensor& self, at::Scalar other) {
+  XLA_FN_TRACE("aten");
   XLATensor self_tensor = bridge::GetXlaTensor(self);
   XLATensor::le_(self_tensor, other);
   return self;
 }
 
 at::Tensor& AtenXlaType::le_(at::Tensor& self, const at::Tensor& other) {
+  XLA_FN_TRACE("aten");
   XLATensor self_tensor = bridge::GetXlaTensor(self);
   XLATensor::le_(self_tensor, bridge::GetXlaTensor(other));
   return self;
@@ -1592,12 +1999,14 @@ at::Tensor& AtenXlaType::le_(at::Tensor& self, const at::Tensor& other) {
 
 at::Tensor AtenXlaType::leaky_relu(const at::Tensor& self,
                                    at::Scalar negative_slope) {
+  XLA_FN_TRACE("aten");
   return bridge::AtenFromXlaTensor(XLATensor::leaky_relu(
       bridge::GetXlaTensor(self), negative_slope.to<double>()));
 }
 
 at::Tensor& AtenXlaType::leaky_relu_(at::Tensor& self,
                                      at::Scalar negative_slope) {
+  XLA_FN_TRACE("aten");
   XLATensor self_tensor = bridge::GetXlaTensor(self);
   XLATensor::leaky_relu_(self_tensor, negative_slope.to<double>());
   return self;
@@ -1606,6 +2015,7 @@ at::Tensor& AtenXlaType::leaky_relu_(at::Tensor& self,
 at::Tensor AtenXlaType::leaky_relu_backward(const at::Tensor& grad_output,
                                             const at::Tensor& self,
                                             at::Scalar negative_slope) {
+  XLA_FN_TRACE("aten");
   return bridge::AtenFromXlaTensor(XLATensor::leaky_relu_backward(
       bridge::GetXlaTensor(grad_output), bridge::GetXlaTensor(self),
       negative_slope.to<double>()));
@@ -1614,53 +2024,63 @@ at::Tensor AtenXlaType::leaky_relu_backward(const at::Tensor& grad_output,
 at::Tensor AtenXlaType::linear(const at::Tensor& input,
                                const at::Tensor& weight,
                                const at::Tensor& bias) {
+  XLA_FN_TRACE("aten");
   return at::native::linear(input, weight, bias);
 }
 
 at::Tensor AtenXlaType::log(const at::Tensor& self) {
+  XLA_FN_TRACE("aten");
   return bridge::AtenFromXlaTensor(XLATensor::log(bridge::GetXlaTensor(self)));
 }
 
 at::Tensor AtenXlaType::log10(const at::Tensor& self) {
+  XLA_FN_TRACE("aten");
   return bridge::AtenFromXlaTensor(XLATensor::log_base(
       bridge::GetXlaTensor(self), ir::OpKind(at::aten::log10), 10.0));
 }
 
 at::Tensor& AtenXlaType::log10_(at::Tensor& self) {
+  XLA_FN_TRACE("aten");
   XLATensor self_tensor = bridge::GetXlaTensor(self);
   XLATensor::log_base_(self_tensor, ir::OpKind(at::aten::log10), 10.0);
   return self;
 }
 
 at::Tensor AtenXlaType::log1p(const at::Tensor& self) {
+  XLA_FN_TRACE("aten");
   return bridge::AtenFromXlaTensor(
       XLATensor::log1p(bridge::GetXlaTensor(self)));
 }
 
 at::Tensor& AtenXlaType::log1p_(at::Tensor& self) {
+  XLA_FN_TRACE("aten");
   XLATensor self_tensor = bridge::GetXlaTensor(self);
   XLATensor::log1p_(self_tensor);
   return self;
 }
 
 at::Tensor AtenXlaType::log2(const at::Tensor& self) {
+  XLA_FN_TRACE("aten");
   return bridge::AtenFromXlaTensor(XLATensor::log_base(
       bridge::GetXlaTensor(self), ir::OpKind(at::aten::log2), 2.0));
 }
 
 at::Tensor& AtenXlaType::log2_(at::Tensor& self) {
+  XLA_FN_TRACE("aten");
   XLATensor self_tensor = bridge::GetXlaTensor(self);
   XLATensor::log_base_(self_tensor, ir::OpKind(at::aten::log2), 2.0);
   return self;
 }
 
 at::Tensor& AtenXlaType::log_(at::Tensor& self) {
+  XLA_FN_TRACE("aten");
   XLATensor self_tensor = bridge::GetXlaTensor(self);
   XLATensor::log_(self_tensor);
   return self;
 }
 
 at::Tensor AtenXlaType::log_sigmoid(const at::Tensor& self) {
+  XLA_FN_TRACE("aten");
   return bridge::AtenFromXlaTensor(
       XLATensor::log_sigmoid(bridge::GetXlaTensor(self)));
 }
@@ -1668,6 +2088,7 @@ at::Tensor AtenXlaType::log_sigmoid(const at::Tensor& self) {
 at::Tensor AtenXlaType::log_sigmoid_backward(const at::Tensor& grad_output,
                                              const at::Tensor& self,
                                              const at::Tensor& buffer) {
+  XLA_FN_TRACE("aten");
   return bridge::AtenFromXlaTensor(XLATensor::log_sigmoid_backward(
       bridge::GetXlaTensor(grad_output), bridge::GetXlaTensor(self),
       bridge::GetXlaTensor(buffer)));
@@ -1675,6 +2096,7 @@ at::Tensor AtenXlaType::log_sigmoid_backward(const at::Tensor& grad_output,
 
 std::tuple<at::Tensor, at::Tensor> AtenXlaType::log_sigmoid_forward(
     const at::Tensor& self) {
+  XLA_FN_TRACE("aten");
   auto result_tuple =
       XLATensor::log_sigmoid_forward(bridge::GetXlaTensor(self));
   return std::make_tuple(bridge::AtenFromXlaTensor(std::get<0>(result_tuple)),
@@ -1683,27 +2105,32 @@ std::tuple<at::Tensor, at::Tensor> AtenXlaType::log_sigmoid_forward(
 
 at::Tensor AtenXlaType::log_softmax(const at::Tensor& self, int64_t dim,
                                     c10::optional<at::ScalarType> dtype) {
+  XLA_FN_TRACE("aten");
   return bridge::AtenFromXlaTensor(
       XLATensor::log_softmax(bridge::GetXlaTensor(self), dim, dtype));
 }
 
 at::Tensor AtenXlaType::lt(const at::Tensor& self, at::Scalar other) {
+  XLA_FN_TRACE("aten");
   return bridge::AtenFromXlaTensor(
       XLATensor::lt(bridge::GetXlaTensor(self), other));
 }
 
 at::Tensor AtenXlaType::lt(const at::Tensor& self, const at::Tensor& other) {
+  XLA_FN_TRACE("aten");
   return bridge::AtenFromXlaTensor(
       XLATensor::lt(bridge::GetXlaTensor(self), bridge::GetXlaTensor(other)));
 }
 
 at::Tensor& AtenXlaType::lt_(at::Tensor& self, at::Scalar other) {
+  XLA_FN_TRACE("aten");
   XLATensor self_tensor = bridge::GetXlaTensor(self);
   XLATensor::lt_(self_tensor, other);
   return self;
 }
 
 at::Tensor& AtenXlaType::lt_(at::Tensor& self, const at::Tensor& other) {
+  XLA_FN_TRACE("aten");
   XLATensor self_tensor = bridge::GetXlaTensor(self);
   XLATensor::lt_(self_tensor, bridge::GetXlaTensor(other));
   return self;
@@ -1713,12 +2140,14 @@ at::Tensor AtenXlaType::margin_ranking_loss(const at::Tensor& input1,
                                             const at::Tensor& input2,
                                             const at::Tensor& target,
                                             double margin, int64_t reduction) {
+  XLA_FN_TRACE("aten");
   return at::native::margin_ranking_loss(input1, input2, target, margin,
                                          reduction);
 }
 
 at::Tensor AtenXlaType::masked_fill(const at::Tensor& self,
                                     const at::Tensor& mask, at::Scalar value) {
+  XLA_FN_TRACE("aten");
   return bridge::AtenFromXlaTensor(XLATensor::masked_fill(
       bridge::GetXlaTensor(self), bridge::GetXlaTensor(mask), value));
 }
@@ -1726,6 +2155,7 @@ at::Tensor AtenXlaType::masked_fill(const at::Tensor& self,
 at::Tensor AtenXlaType::masked_fill(const at::Tensor& self,
                                     const at::Tensor& mask,
                                     const at::Tensor& value) {
+  XLA_FN_TRACE("aten");
   XLA_CHECK_EQ(value.dim(), 0) << "masked_fill only supports a 0-dimensional "
                                << "value tensor, but got tensor "
                                << "with " << value.dim() << " dimension(s).";
@@ -1734,6 +2164,7 @@ at::Tensor AtenXlaType::masked_fill(const at::Tensor& self,
 
 at::Tensor& AtenXlaType::masked_fill_(at::Tensor& self, const at::Tensor& mask,
                                       at::Scalar value) {
+  XLA_FN_TRACE("aten");
   XLATensor self_tensor = bridge::GetXlaTensor(self);
   XLATensor::masked_fill_(self_tensor, bridge::GetXlaTensor(mask), value);
   return self;
@@ -1741,6 +2172,7 @@ at::Tensor& AtenXlaType::masked_fill_(at::Tensor& self, const at::Tensor& mask,
 
 at::Tensor& AtenXlaType::masked_fill_(at::Tensor& self, const at::Tensor& mask,
                                       const at::Tensor& value) {
+  XLA_FN_TRACE("aten");
   XLA_CHECK_EQ(value.dim(), 0) << "masked_fill_ only supports a 0-dimensional "
                                << "value tensor, but got tensor "
                                << "with " << value.dim() << " dimension(s).";
@@ -1749,6 +2181,7 @@ at::Tensor& AtenXlaType::masked_fill_(at::Tensor& self, const at::Tensor& mask,
 
 at::Tensor AtenXlaType::matmul(const at::Tensor& self,
                                const at::Tensor& other) {
+  XLA_FN_TRACE("aten");
   // xla::dot doesn't support integer types.
   if (!self.is_floating_point() || !other.is_floating_point()) {
     return AtenXlaTypeDefault::matmul(self, other);
@@ -1758,16 +2191,19 @@ at::Tensor AtenXlaType::matmul(const at::Tensor& self,
 }
 
 at::Tensor AtenXlaType::max(const at::Tensor& self, const at::Tensor& other) {
+  XLA_FN_TRACE("aten");
   return bridge::AtenFromXlaTensor(
       XLATensor::max(bridge::GetXlaTensor(self), bridge::GetXlaTensor(other)));
 }
 
 at::Tensor AtenXlaType::max(const at::Tensor& self) {
+  XLA_FN_TRACE("aten");
   return bridge::AtenFromXlaTensor(XLATensor::max(bridge::GetXlaTensor(self)));
 }
 
 std::tuple<at::Tensor, at::Tensor> AtenXlaType::max(const at::Tensor& self,
                                                     int64_t dim, bool keepdim) {
+  XLA_FN_TRACE("aten");
   auto outputs = XLATensor::max(bridge::GetXlaTensor(self), dim, keepdim);
   return std::make_tuple(bridge::AtenFromXlaTensor(std::get<0>(outputs)),
                          bridge::AtenFromXlaTensor(std::get<1>(outputs)));
@@ -1778,6 +2214,7 @@ at::Tensor AtenXlaType::max_pool1d(const at::Tensor& self,
                                    at::IntArrayRef stride,
                                    at::IntArrayRef padding,
                                    at::IntArrayRef dilation, bool ceil_mode) {
+  XLA_FN_TRACE("aten");
   // Lowering when dilation is non-trivial or ceil_mode is set not supported.
   if (IsNonTrivialDilation(dilation)) {
     return AtenXlaTypeDefault::max_pool1d(self, kernel_size, stride, padding,
@@ -1794,6 +2231,7 @@ at::Tensor AtenXlaType::max_pool2d(const at::Tensor& self,
                                    at::IntArrayRef stride,
                                    at::IntArrayRef padding,
                                    at::IntArrayRef dilation, bool ceil_mode) {
+  XLA_FN_TRACE("aten");
   // Lowering when dilation is non-trivial or ceil_mode is set not supported.
   if (IsNonTrivialDilation(dilation)) {
     return AtenXlaTypeDefault::max_pool2d(self, kernel_size, stride, padding,
@@ -1808,28 +2246,14 @@ at::Tensor AtenXlaType::max_pool2d(const at::Tensor& self,
 std::tuple<at::Tensor, at::Tensor> AtenXlaType::max_pool2d_with_indices(
     const at::Tensor& self, at::IntArrayRef kernel_size, at::IntArrayRef stride,
     at::IntArrayRef padding, at::IntArrayRef dilation, bool ceil_mode) {
+  XLA_FN_TRACE("aten");
   // Lowering when ceil_mode or dilation is set not supported yet.
   if (IsNonTrivialDilation(dilation)) {
     return AtenXlaTypeDefault::max_pool2d_with_indices(
         self, kernel_size, stride, padding, dilation, ceil_mode);
   }
-  // TODO(asuhan): Here we return a placeholder tensor for the indices we hope
-  // to never evaluate, which works for the backward of max_pool2d. However, the
-  // user could request the indices to be returned, in which case we'd throw. We
-  // need to either provide a lowering or improve our infrastructure to be able
-  // to route to ATen the evaluation of outputs we hope to be unused.
-  XLATensor result = XLATensor::max_pool_nd(
-      bridge::GetXlaTensor(self), /*spatial_dim_count=*/2,
-      XlaHelpers::I64List(kernel_size), XlaHelpers::I64List(stride),
-      XlaHelpers::I64List(padding), ceil_mode);
-  xla::Shape indices_shape = result.shape();
-  indices_shape.set_element_type(
-      GetDevicePrimitiveType(xla::PrimitiveType::S64, &result.GetDevice()));
-  XLATensor indices_not_supported = XLATensor::not_supported(
-      "aten::max_pool2d_with_indices.indices", indices_shape,
-      bridge::GetXlaTensor(self).GetDevice());
-  return std::make_tuple(bridge::AtenFromXlaTensor(result),
-                         bridge::AtenFromXlaTensor(indices_not_supported));
+  return MaxPoolNdWithIndices(self, /*spatial_dim_count=*/2, kernel_size,
+                              stride, padding, ceil_mode);
 }
 
 at::Tensor AtenXlaType::max_pool2d_with_indices_backward(
@@ -1837,16 +2261,15 @@ at::Tensor AtenXlaType::max_pool2d_with_indices_backward(
     at::IntArrayRef kernel_size, at::IntArrayRef stride,
     at::IntArrayRef padding, at::IntArrayRef dilation, bool ceil_mode,
     const at::Tensor& indices) {
+  XLA_FN_TRACE("aten");
   // Lowering when ceil_mode or dilation is set not supported yet.
   if (IsNonTrivialDilation(dilation)) {
     return AtenXlaTypeDefault::max_pool2d_with_indices_backward(
         grad_output, self, kernel_size, stride, padding, dilation, ceil_mode,
         indices);
   }
-  return bridge::AtenFromXlaTensor(XLATensor::max_pool_nd_backward(
-      bridge::GetXlaTensor(grad_output), bridge::GetXlaTensor(self),
-      /*spatial_dim_count=*/2, XlaHelpers::I64List(kernel_size),
-      XlaHelpers::I64List(stride), XlaHelpers::I64List(padding), ceil_mode));
+  return MaxPoolNdBackward(grad_output, self, /*spatial_dim_count=*/2,
+                           kernel_size, stride, padding, ceil_mode, indices);
 }
 
 at::Tensor AtenXlaType::max_pool3d(const at::Tensor& self,
@@ -1854,6 +2277,7 @@ at::Tensor AtenXlaType::max_pool3d(const at::Tensor& self,
                                    at::IntArrayRef stride,
                                    at::IntArrayRef padding,
                                    at::IntArrayRef dilation, bool ceil_mode) {
+  XLA_FN_TRACE("aten");
   // Lowering when dilation is non-trivial or ceil_mode is set not supported.
   if (IsNonTrivialDilation(dilation)) {
     return AtenXlaTypeDefault::max_pool3d(self, kernel_size, stride, padding,
@@ -1870,47 +2294,33 @@ at::Tensor AtenXlaType::max_pool3d_with_indices_backward(
     at::IntArrayRef kernel_size, at::IntArrayRef stride,
     at::IntArrayRef padding, at::IntArrayRef dilation, bool ceil_mode,
     const at::Tensor& indices) {
+  XLA_FN_TRACE("aten");
   // Lowering when ceil_mode or dilation is set not supported yet.
   if (IsNonTrivialDilation(dilation)) {
     return AtenXlaTypeDefault::max_pool3d_with_indices_backward(
         grad_output, self, kernel_size, stride, padding, dilation, ceil_mode,
         indices);
   }
-  return bridge::AtenFromXlaTensor(XLATensor::max_pool_nd_backward(
-      bridge::GetXlaTensor(grad_output), bridge::GetXlaTensor(self),
-      /*spatial_dim_count=*/3, XlaHelpers::I64List(kernel_size),
-      XlaHelpers::I64List(stride), XlaHelpers::I64List(padding), ceil_mode));
+  return MaxPoolNdBackward(grad_output, self, /*spatial_dim_count=*/3,
+                           kernel_size, stride, padding, ceil_mode, indices);
 }
 
 std::tuple<at::Tensor, at::Tensor> AtenXlaType::max_pool3d_with_indices(
     const at::Tensor& self, at::IntArrayRef kernel_size, at::IntArrayRef stride,
     at::IntArrayRef padding, at::IntArrayRef dilation, bool ceil_mode) {
+  XLA_FN_TRACE("aten");
   // Lowering when ceil_mode or dilation is set not supported yet.
   if (IsNonTrivialDilation(dilation)) {
     return AtenXlaTypeDefault::max_pool3d_with_indices(
         self, kernel_size, stride, padding, dilation, ceil_mode);
   }
-  // TODO(asuhan): Here we return a placeholder tensor for the indices we hope
-  // to never evaluate, which works for the backward of max_pool3d. However, the
-  // user could request the indices to be returned, in which case we'd throw. We
-  // need to either provide a lowering or improve our infrastructure to be able
-  // to route to ATen the evaluation of outputs we hope to be unused.
-  XLATensor result = XLATensor::max_pool_nd(
-      bridge::GetXlaTensor(self), /*spatial_dim_count=*/3,
-      XlaHelpers::I64List(kernel_size), XlaHelpers::I64List(stride),
-      XlaHelpers::I64List(padding), ceil_mode);
-  xla::Shape indices_shape = result.shape();
-  indices_shape.set_element_type(
-      GetDevicePrimitiveType(xla::PrimitiveType::S64, &result.GetDevice()));
-  XLATensor indices_not_supported = XLATensor::not_supported(
-      "aten::max_pool3d_with_indices.indices", indices_shape,
-      bridge::GetXlaTensor(self).GetDevice());
-  return std::make_tuple(bridge::AtenFromXlaTensor(result),
-                         bridge::AtenFromXlaTensor(indices_not_supported));
+  return MaxPoolNdWithIndices(self, /*spatial_dim_count=*/3, kernel_size,
+                              stride, padding, ceil_mode);
 }
 
 at::Tensor AtenXlaType::mean(const at::Tensor& self,
                              c10::optional<at::ScalarType> dtype) {
+  XLA_FN_TRACE("aten");
   XLATensor self_tensor = bridge::GetXlaTensor(self);
   return bridge::AtenFromXlaTensor(XLATensor::mean(
       self_tensor,
@@ -1921,32 +2331,38 @@ at::Tensor AtenXlaType::mean(const at::Tensor& self,
 at::Tensor AtenXlaType::mean(const at::Tensor& self, at::IntArrayRef dim,
                              bool keepdim,
                              c10::optional<at::ScalarType> dtype) {
+  XLA_FN_TRACE("aten");
   return bridge::AtenFromXlaTensor(XLATensor::mean(
       bridge::GetXlaTensor(self), xla::util::ToVector<xla::int64>(dim),
       /*keep_reduced_dimensions*/ keepdim, dtype));
 }
 
 std::vector<at::Tensor> AtenXlaType::meshgrid(at::TensorList tensors) {
+  XLA_FN_TRACE("aten");
   return at::native::meshgrid(tensors);
 }
 
 at::Tensor AtenXlaType::min(const at::Tensor& self, const at::Tensor& other) {
+  XLA_FN_TRACE("aten");
   return bridge::AtenFromXlaTensor(
       XLATensor::min(bridge::GetXlaTensor(self), bridge::GetXlaTensor(other)));
 }
 
 at::Tensor AtenXlaType::min(const at::Tensor& self) {
+  XLA_FN_TRACE("aten");
   return bridge::AtenFromXlaTensor(XLATensor::min(bridge::GetXlaTensor(self)));
 }
 
 std::tuple<at::Tensor, at::Tensor> AtenXlaType::min(const at::Tensor& self,
                                                     int64_t dim, bool keepdim) {
+  XLA_FN_TRACE("aten");
   auto outputs = XLATensor::min(bridge::GetXlaTensor(self), dim, keepdim);
   return std::make_tuple(bridge::AtenFromXlaTensor(std::get<0>(outputs)),
                          bridge::AtenFromXlaTensor(std::get<1>(outputs)));
 }
 
 at::Tensor AtenXlaType::mm(const at::Tensor& self, const at::Tensor& mat2) {
+  XLA_FN_TRACE("aten");
   // xla::dot doesn't support integer types.
   if (!self.is_floating_point() || !mat2.is_floating_point()) {
     return AtenXlaTypeDefault::mm(self, mat2);
@@ -1957,6 +2373,7 @@ at::Tensor AtenXlaType::mm(const at::Tensor& self, const at::Tensor& mat2) {
 }
 
 at::Tensor AtenXlaType::mul(const at::Tensor& self, const at::Tensor& other) {
+  XLA_FN_TRACE("aten");
   XLATensor self_tensor = bridge::GetXlaTensor(self);
   return bridge::AtenFromXlaTensor(XLATensor::mul(
       self_tensor,
@@ -1964,11 +2381,13 @@ at::Tensor AtenXlaType::mul(const at::Tensor& self, const at::Tensor& other) {
 }
 
 at::Tensor AtenXlaType::mul(const at::Tensor& self, at::Scalar other) {
+  XLA_FN_TRACE("aten");
   return bridge::AtenFromXlaTensor(
       XLATensor::mul(bridge::GetXlaTensor(self), other));
 }
 
 at::Tensor& AtenXlaType::mul_(at::Tensor& self, const at::Tensor& other) {
+  XLA_FN_TRACE("aten");
   XLATensor self_tensor = bridge::GetXlaTensor(self);
   XLATensor::mul_(self_tensor,
                   bridge::GetOrCreateXlaTensor(other, self_tensor.GetDevice()));
@@ -1976,6 +2395,7 @@ at::Tensor& AtenXlaType::mul_(at::Tensor& self, const at::Tensor& other) {
 }
 
 at::Tensor& AtenXlaType::mul_(at::Tensor& self, at::Scalar other) {
+  XLA_FN_TRACE("aten");
   XLATensor self_tensor = bridge::GetXlaTensor(self);
   XLATensor::mul_(self_tensor, other);
   return self;
@@ -1983,12 +2403,14 @@ at::Tensor& AtenXlaType::mul_(at::Tensor& self, at::Scalar other) {
 
 at::Tensor AtenXlaType::narrow(const at::Tensor& self, int64_t dim,
                                int64_t start, int64_t length) {
+  XLA_FN_TRACE("aten");
   return bridge::AtenFromXlaTensor(
       XLATensor::narrow(bridge::GetXlaTensor(self), dim, start, length));
 }
 
 at::Tensor AtenXlaType::narrow_copy(const at::Tensor& self, int64_t dim,
                                     int64_t start, int64_t length) {
+  XLA_FN_TRACE("aten");
   return at::native::narrow_copy_dense(self, dim, start, length);
 }
 
@@ -1996,6 +2418,7 @@ std::tuple<at::Tensor, at::Tensor, at::Tensor> AtenXlaType::native_batch_norm(
     const at::Tensor& input, const at::Tensor& weight, const at::Tensor& bias,
     const at::Tensor& running_mean, const at::Tensor& running_var,
     bool training, double momentum, double eps) {
+  XLA_FN_TRACE("aten");
   XLATensor input_tensor = bridge::GetXlaTensor(input);
   const Device& device = input_tensor.GetDevice();
   XLATensor running_mean_tensor =
@@ -2018,6 +2441,7 @@ AtenXlaType::native_batch_norm_backward(
     const at::Tensor& running_var, const at::Tensor& save_mean,
     const at::Tensor& save_invstd, bool train, double eps,
     std::array<bool, 3> output_mask) {
+  XLA_FN_TRACE("aten");
   XLATensor grad_out_tensor = bridge::GetXlaTensor(grad_out);
   const Device& device = grad_out_tensor.GetDevice();
   auto gradients = XLATensor::native_batch_norm_backward(
@@ -2036,32 +2460,38 @@ AtenXlaType::native_batch_norm_backward(
 }
 
 at::Tensor AtenXlaType::ne(const at::Tensor& self, at::Scalar other) {
+  XLA_FN_TRACE("aten");
   return bridge::AtenFromXlaTensor(
       XLATensor::ne(bridge::GetXlaTensor(self), other));
 }
 
 at::Tensor AtenXlaType::ne(const at::Tensor& self, const at::Tensor& other) {
+  XLA_FN_TRACE("aten");
   return bridge::AtenFromXlaTensor(
       XLATensor::ne(bridge::GetXlaTensor(self), bridge::GetXlaTensor(other)));
 }
 
 at::Tensor& AtenXlaType::ne_(at::Tensor& self, at::Scalar other) {
+  XLA_FN_TRACE("aten");
   XLATensor self_tensor = bridge::GetXlaTensor(self);
   XLATensor::ne_(self_tensor, other);
   return self;
 }
 
 at::Tensor& AtenXlaType::ne_(at::Tensor& self, const at::Tensor& other) {
+  XLA_FN_TRACE("aten");
   XLATensor self_tensor = bridge::GetXlaTensor(self);
   XLATensor::ne_(self_tensor, bridge::GetXlaTensor(other));
   return self;
 }
 
 at::Tensor AtenXlaType::neg(const at::Tensor& self) {
+  XLA_FN_TRACE("aten");
   return bridge::AtenFromXlaTensor(XLATensor::neg(bridge::GetXlaTensor(self)));
 }
 
 at::Tensor& AtenXlaType::neg_(at::Tensor& self) {
+  XLA_FN_TRACE("aten");
   XLATensor self_tensor = bridge::GetXlaTensor(self);
   XLATensor::neg_(self_tensor);
   return self;
@@ -2071,6 +2501,7 @@ at::Tensor AtenXlaType::nll_loss(const at::Tensor& self,
                                  const at::Tensor& target,
                                  const at::Tensor& weight, int64_t reduction,
                                  int64_t ignore_index) {
+  XLA_FN_TRACE("aten");
   if (reduction != Reduction::Mean || weight.defined()) {
     return AtenXlaTypeDefault::nll_loss(self, target, weight, reduction,
                                         ignore_index);
@@ -2083,6 +2514,7 @@ at::Tensor AtenXlaType::nll_loss_backward(
     const at::Tensor& grad_output, const at::Tensor& self,
     const at::Tensor& target, const at::Tensor& weight, int64_t reduction,
     int64_t ignore_index, const at::Tensor& total_weight) {
+  XLA_FN_TRACE("aten");
   if (reduction != Reduction::Mean || weight.defined()) {
     return AtenXlaTypeDefault::nll_loss_backward(grad_output, self, target,
                                                  weight, reduction,
@@ -2095,6 +2527,7 @@ at::Tensor AtenXlaType::nll_loss_backward(
 std::tuple<at::Tensor, at::Tensor> AtenXlaType::nll_loss_forward(
     const at::Tensor& self, const at::Tensor& target, const at::Tensor& weight,
     int64_t reduction, int64_t ignore_index) {
+  XLA_FN_TRACE("aten");
   if (weight.defined()) {
     return AtenXlaTypeDefault::nll_loss_forward(self, target, weight, reduction,
                                                 ignore_index);
@@ -2107,6 +2540,7 @@ std::tuple<at::Tensor, at::Tensor> AtenXlaType::nll_loss_forward(
 at::Tensor AtenXlaType::norm(const at::Tensor& self,
                              c10::optional<at::Scalar> p,
                              at::ScalarType dtype) {
+  XLA_FN_TRACE("aten");
   // If p==0 it is a torch.nonzero(), which is not lowered to XLA due to dynamic
   // shapes issue.
   if (p.has_value() && p->toDouble() == 0) {
@@ -2117,6 +2551,7 @@ at::Tensor AtenXlaType::norm(const at::Tensor& self,
 }
 
 at::Tensor AtenXlaType::norm(const at::Tensor& self, at::Scalar p) {
+  XLA_FN_TRACE("aten");
   // If p==0 it is a torch.nonzero(), which is not lowered to XLA due to dynamic
   // shapes issue.
   if (p.toDouble() == 0) {
@@ -2129,6 +2564,7 @@ at::Tensor AtenXlaType::norm(const at::Tensor& self, at::Scalar p) {
 at::Tensor AtenXlaType::norm(const at::Tensor& self,
                              c10::optional<at::Scalar> p, at::IntArrayRef dim,
                              bool keepdim, at::ScalarType dtype) {
+  XLA_FN_TRACE("aten");
   // If p==0 it is a torch.nonzero(), which is not lowered to XLA due to dynamic
   // shapes issue.
   if (p.has_value() && p->toDouble() == 0) {
@@ -2141,6 +2577,7 @@ at::Tensor AtenXlaType::norm(const at::Tensor& self,
 at::Tensor AtenXlaType::norm(const at::Tensor& self,
                              c10::optional<at::Scalar> p, at::IntArrayRef dim,
                              bool keepdim) {
+  XLA_FN_TRACE("aten");
   // If p==0 it is a torch.nonzero(), which is not lowered to XLA due to dynamic
   // shapes issue.
   if (p.has_value() && p->toDouble() == 0) {
@@ -2150,45 +2587,65 @@ at::Tensor AtenXlaType::norm(const at::Tensor& self,
       bridge::GetXlaTensor(self), p, c10::nullopt, dim, keepdim));
 }
 
+at::Tensor& AtenXlaType::normal_(at::Tensor& self, double mean, double std,
+                                 at::Generator* generator) {
+  XLA_FN_TRACE("aten");
+  if (generator != nullptr) {
+    return AtenXlaTypeDefault::normal_(self, mean, std, generator);
+  }
+  XLATensor self_tensor = bridge::GetXlaTensor(self);
+  XLATensor::normal_(self_tensor, mean, std);
+  return self;
+}
+
 at::Tensor AtenXlaType::nuclear_norm(const at::Tensor& self, bool keepdim) {
+  XLA_FN_TRACE("aten");
   return at::native::nuclear_norm(self, keepdim);
 }
 
 at::Tensor AtenXlaType::ones(at::IntArrayRef size,
                              const at::TensorOptions& options) {
+  XLA_FN_TRACE("aten");
   return full(size, 1, options);
 }
 
 at::Tensor AtenXlaType::ones_like(const at::Tensor& self) {
+  XLA_FN_TRACE("aten");
   return full_like(self, 1);
 }
 
 at::Tensor AtenXlaType::ones_like(const at::Tensor& self,
                                   const at::TensorOptions& options) {
+  XLA_FN_TRACE("aten");
   return full_like(self, 1, options);
 }
 
 at::Tensor AtenXlaType::pairwise_distance(const at::Tensor& x1,
                                           const at::Tensor& x2, double p,
                                           double eps, bool keepdim) {
+  XLA_FN_TRACE("aten");
   return at::native::pairwise_distance(x1, x2, p, eps, keepdim);
 }
 
 at::Tensor AtenXlaType::permute(const at::Tensor& self, at::IntArrayRef dims) {
+  XLA_FN_TRACE("aten");
   return bridge::AtenFromXlaTensor(XLATensor::permute(
       bridge::GetXlaTensor(self), XlaHelpers::I64List(dims)));
 }
 
 at::Tensor AtenXlaType::pixel_shuffle(const at::Tensor& self,
                                       int64_t upscale_factor) {
+  XLA_FN_TRACE("aten");
   return at::native::pixel_shuffle(self, upscale_factor);
 }
 
 at::Tensor AtenXlaType::pinverse(const at::Tensor& self, double rcond) {
+  XLA_FN_TRACE("aten");
   return at::native::pinverse(self, rcond);
 }
 
 at::Tensor AtenXlaType::pow(const at::Tensor& self, at::Scalar exponent) {
+  XLA_FN_TRACE("aten");
   // xla::pow doesn't support integer types.
   if (!self.is_floating_point()) {
     return AtenXlaTypeDefault::pow(self, exponent);
@@ -2199,6 +2656,7 @@ at::Tensor AtenXlaType::pow(const at::Tensor& self, at::Scalar exponent) {
 
 at::Tensor AtenXlaType::pow(const at::Tensor& self,
                             const at::Tensor& exponent) {
+  XLA_FN_TRACE("aten");
   // xla::pow doesn't support integer types.
   if (!self.is_floating_point() || !exponent.is_floating_point()) {
     return AtenXlaTypeDefault::pow(self, exponent);
@@ -2208,6 +2666,7 @@ at::Tensor AtenXlaType::pow(const at::Tensor& self,
 }
 
 at::Tensor AtenXlaType::pow(at::Scalar self, const at::Tensor& exponent) {
+  XLA_FN_TRACE("aten");
   // xla::pow doesn't support integer types.
   if (!exponent.is_floating_point()) {
     return AtenXlaTypeDefault::pow(self, exponent);
@@ -2217,6 +2676,7 @@ at::Tensor AtenXlaType::pow(at::Scalar self, const at::Tensor& exponent) {
 }
 
 at::Tensor& AtenXlaType::pow_(at::Tensor& self, at::Scalar exponent) {
+  XLA_FN_TRACE("aten");
   // xla::pow doesn't support integer types.
   if (!self.is_floating_point()) {
     return AtenXlaTypeDefault::pow_(self, exponent);
@@ -2227,6 +2687,7 @@ at::Tensor& AtenXlaType::pow_(at::Tensor& self, at::Scalar exponent) {
 }
 
 at::Tensor& AtenXlaType::pow_(at::Tensor& self, const at::Tensor& exponent) {
+  XLA_FN_TRACE("aten");
   // xla::pow doesn't support integer types.
   if (!self.is_floating_point() || !exponent.is_floating_point()) {
     return AtenXlaTypeDefault::pow_(self, exponent);
@@ -2238,6 +2699,7 @@ at::Tensor& AtenXlaType::pow_(at::Tensor& self, const at::Tensor& exponent) {
 
 at::Tensor AtenXlaType::prod(const at::Tensor& self,
                              c10::optional<at::ScalarType> dtype) {
+  XLA_FN_TRACE("aten");
   XLATensor self_tensor = bridge::GetXlaTensor(self);
   return bridge::AtenFromXlaTensor(XLATensor::prod(
       self_tensor,
@@ -2247,18 +2709,89 @@ at::Tensor AtenXlaType::prod(const at::Tensor& self,
 
 at::Tensor AtenXlaType::prod(const at::Tensor& self, int64_t dim, bool keepdim,
                              c10::optional<at::ScalarType> dtype) {
+  XLA_FN_TRACE("aten");
   return bridge::AtenFromXlaTensor(
       XLATensor::prod(bridge::GetXlaTensor(self), {dim}, keepdim, dtype));
 }
 
 std::tuple<at::Tensor, at::Tensor> AtenXlaType::qr(const at::Tensor& self,
                                                    bool some) {
+  XLA_FN_TRACE("aten");
   auto results = XLATensor::qr(bridge::GetXlaTensor(self), some);
   return std::make_tuple(bridge::AtenFromXlaTensor(std::get<0>(results)),
                          bridge::AtenFromXlaTensor(std::get<1>(results)));
 }
 
+at::Tensor AtenXlaType::rand(at::IntArrayRef size,
+                             const at::TensorOptions& options) {
+  XLA_FN_TRACE("aten");
+  XlaOptions xla_options(options);
+  XLATensor result =
+      XLATensor::full(XlaHelpers::I64List(size), 0, xla_options.get_device(),
+                      xla_options.get_scalar_type());
+  XLATensor::uniform_(result, 0, 1);
+  return bridge::AtenFromXlaTensor(result);
+}
+
+at::Tensor AtenXlaType::rand(at::IntArrayRef size, at::Generator* generator,
+                             const at::TensorOptions& options) {
+  XLA_FN_TRACE("aten");
+  if (generator != nullptr) {
+    return AtenXlaTypeDefault::rand(size, generator, options);
+  }
+  return rand(size, options);
+}
+
+at::Tensor AtenXlaType::randn(at::IntArrayRef size,
+                              const at::TensorOptions& options) {
+  XLA_FN_TRACE("aten");
+  XlaOptions xla_options(options);
+  XLATensor result =
+      XLATensor::full(XlaHelpers::I64List(size), 0, xla_options.get_device(),
+                      xla_options.get_scalar_type());
+  XLATensor::normal_(result, 0, 1);
+  return bridge::AtenFromXlaTensor(result);
+}
+
+at::Tensor AtenXlaType::randn(at::IntArrayRef size, at::Generator* generator,
+                              const at::TensorOptions& options) {
+  XLA_FN_TRACE("aten");
+  if (generator != nullptr) {
+    return AtenXlaTypeDefault::randn(size, generator, options);
+  }
+  return randn(size, options);
+}
+
+at::Tensor& AtenXlaType::random_(at::Tensor& self, int64_t from, int64_t to,
+                                 at::Generator* generator) {
+  XLA_FN_TRACE("aten");
+  if (generator != nullptr) {
+    return AtenXlaTypeDefault::random_(self, from, to, generator);
+  }
+  XLATensor self_tensor = bridge::GetXlaTensor(self);
+  XLATensor::random_(self_tensor, from, to);
+  return self;
+}
+
+at::Tensor& AtenXlaType::random_(at::Tensor& self, int64_t to,
+                                 at::Generator* generator) {
+  XLA_FN_TRACE("aten");
+  if (generator != nullptr) {
+    return AtenXlaTypeDefault::random_(self, to, generator);
+  }
+  return random_(self, 0, to, nullptr);
+}
+
+at::Tensor& AtenXlaType::random_(at::Tensor& self, at::Generator* generator) {
+  XLA_FN_TRACE("aten");
+  if (generator != nullptr) {
+    return AtenXlaTypeDefault::random_(self, generator);
+  }
+  return random_(self, 0, RandomUpperBound(self.scalar_type()), nullptr);
+}
+
 at::Tensor AtenXlaType::randperm(int64_t n, const at::TensorOptions& options) {
+  XLA_FN_TRACE("aten");
   XlaOptions xla_options(options);
   return bridge::AtenFromXlaTensor(XLATensor::randperm(
       n, xla_options.get_device(), xla_options.get_scalar_type(at::kLong)));
@@ -2266,6 +2799,7 @@ at::Tensor AtenXlaType::randperm(int64_t n, const at::TensorOptions& options) {
 
 at::Tensor AtenXlaType::randperm(int64_t n, at::Generator* generator,
                                  const at::TensorOptions& options) {
+  XLA_FN_TRACE("aten");
   if (generator != nullptr) {
     return AtenXlaTypeDefault::randperm(n, generator, options);
   }
@@ -2273,21 +2807,25 @@ at::Tensor AtenXlaType::randperm(int64_t n, at::Generator* generator,
 }
 
 at::Tensor AtenXlaType::reciprocal(const at::Tensor& self) {
+  XLA_FN_TRACE("aten");
   return bridge::AtenFromXlaTensor(
       XLATensor::reciprocal(bridge::GetXlaTensor(self)));
 }
 
 at::Tensor& AtenXlaType::reciprocal_(at::Tensor& self) {
+  XLA_FN_TRACE("aten");
   XLATensor self_tensor = bridge::GetXlaTensor(self);
   XLATensor::reciprocal_(self_tensor);
   return self;
 }
 
 at::Tensor AtenXlaType::relu(const at::Tensor& self) {
+  XLA_FN_TRACE("aten");
   return bridge::AtenFromXlaTensor(XLATensor::relu(bridge::GetXlaTensor(self)));
 }
 
 at::Tensor& AtenXlaType::relu_(at::Tensor& self) {
+  XLA_FN_TRACE("aten");
   XLATensor self_tensor = bridge::GetXlaTensor(self);
   XLATensor::relu_(self_tensor);
   return self;
@@ -2295,22 +2833,26 @@ at::Tensor& AtenXlaType::relu_(at::Tensor& self) {
 
 at::Tensor AtenXlaType::remainder(const at::Tensor& self,
                                   const at::Tensor& other) {
+  XLA_FN_TRACE("aten");
   return bridge::AtenFromXlaTensor(XLATensor::remainder(
       bridge::GetXlaTensor(self), bridge::GetXlaTensor(other)));
 }
 
 at::Tensor AtenXlaType::remainder(const at::Tensor& self, at::Scalar other) {
+  XLA_FN_TRACE("aten");
   return bridge::AtenFromXlaTensor(
       XLATensor::remainder(bridge::GetXlaTensor(self), other));
 }
 
 at::Tensor& AtenXlaType::remainder_(at::Tensor& self, const at::Tensor& other) {
+  XLA_FN_TRACE("aten");
   XLATensor self_tensor = bridge::GetXlaTensor(self);
   XLATensor::remainder_(self_tensor, bridge::GetXlaTensor(other));
   return self;
 }
 
 at::Tensor& AtenXlaType::remainder_(at::Tensor& self, at::Scalar other) {
+  XLA_FN_TRACE("aten");
   XLATensor self_tensor = bridge::GetXlaTensor(self);
   XLATensor::remainder_(self_tensor, other);
   return self;
@@ -2318,16 +2860,19 @@ at::Tensor& AtenXlaType::remainder_(at::Tensor& self, at::Scalar other) {
 
 at::Tensor AtenXlaType::repeat(const at::Tensor& self,
                                at::IntArrayRef repeats) {
+  XLA_FN_TRACE("aten");
   return bridge::AtenFromXlaTensor(XLATensor::repeat(
       bridge::GetXlaTensor(self), XlaHelpers::I64List(repeats)));
 }
 
 at::Tensor AtenXlaType::reshape(const at::Tensor& self, at::IntArrayRef shape) {
+  XLA_FN_TRACE("aten");
   return bridge::AtenFromXlaTensor(XLATensor::reshape(
       bridge::GetXlaTensor(self), XlaHelpers::I64List(shape)));
 }
 
 at::Tensor& AtenXlaType::resize_(at::Tensor& self, at::IntArrayRef size) {
+  XLA_FN_TRACE("aten");
   XLATensor self_tensor = bridge::GetXlaTensor(self);
   XLATensor::resize_(self_tensor, XlaHelpers::I64List(size));
   return self;
@@ -2338,6 +2883,7 @@ at::Tensor AtenXlaType::rrelu_with_noise(const at::Tensor& self,
                                          at::Scalar lower, at::Scalar upper,
                                          bool training,
                                          at::Generator* generator) {
+  XLA_FN_TRACE("aten");
   if (generator != nullptr) {
     // The fallback path for rrelu_with_noise when training=true is wrong
     XLA_CHECK_EQ(training, false);
@@ -2355,6 +2901,7 @@ at::Tensor AtenXlaType::rrelu_with_noise_backward(const at::Tensor& grad_output,
                                                   at::Scalar lower,
                                                   at::Scalar upper,
                                                   bool training) {
+  XLA_FN_TRACE("aten");
   XLATensor noise_tensor = bridge::GetXlaTensor(noise);
   return bridge::AtenFromXlaTensor(XLATensor::rrelu_with_noise_backward(
       bridge::GetXlaTensor(grad_output), bridge::GetXlaTensor(self),
@@ -2362,11 +2909,13 @@ at::Tensor AtenXlaType::rrelu_with_noise_backward(const at::Tensor& grad_output,
 }
 
 at::Tensor AtenXlaType::rsqrt(const at::Tensor& self) {
+  XLA_FN_TRACE("aten");
   return bridge::AtenFromXlaTensor(
       XLATensor::rsqrt(bridge::GetXlaTensor(self)));
 }
 
 at::Tensor& AtenXlaType::rsqrt_(at::Tensor& self) {
+  XLA_FN_TRACE("aten");
   XLATensor self_tensor = bridge::GetXlaTensor(self);
   XLATensor::rsqrt_(self_tensor);
   return self;
@@ -2374,12 +2923,14 @@ at::Tensor& AtenXlaType::rsqrt_(at::Tensor& self) {
 
 at::Tensor AtenXlaType::rsub(const at::Tensor& self, const at::Tensor& other,
                              at::Scalar alpha) {
+  XLA_FN_TRACE("aten");
   return bridge::AtenFromXlaTensor(XLATensor::rsub(
       bridge::GetXlaTensor(self), bridge::GetXlaTensor(other), alpha));
 }
 
 at::Tensor AtenXlaType::rsub(const at::Tensor& self, at::Scalar other,
                              at::Scalar alpha) {
+  XLA_FN_TRACE("aten");
   return bridge::AtenFromXlaTensor(
       XLATensor::rsub(bridge::GetXlaTensor(self), other, alpha));
 }
@@ -2387,6 +2938,7 @@ at::Tensor AtenXlaType::rsub(const at::Tensor& self, at::Scalar other,
 at::Tensor AtenXlaType::scatter(const at::Tensor& self, int64_t dim,
                                 const at::Tensor& index,
                                 const at::Tensor& src) {
+  XLA_FN_TRACE("aten");
   return bridge::AtenFromXlaTensor(XLATensor::scatter(
       bridge::GetXlaTensor(self), dim, bridge::GetXlaTensor(index),
       bridge::GetXlaTensor(src)));
@@ -2394,6 +2946,7 @@ at::Tensor AtenXlaType::scatter(const at::Tensor& self, int64_t dim,
 
 at::Tensor AtenXlaType::scatter(const at::Tensor& self, int64_t dim,
                                 const at::Tensor& index, at::Scalar value) {
+  XLA_FN_TRACE("aten");
   return bridge::AtenFromXlaTensor(XLATensor::scatter(
       bridge::GetXlaTensor(self), dim, bridge::GetXlaTensor(index), value));
 }
@@ -2401,6 +2954,7 @@ at::Tensor AtenXlaType::scatter(const at::Tensor& self, int64_t dim,
 at::Tensor& AtenXlaType::scatter_(at::Tensor& self, int64_t dim,
                                   const at::Tensor& index,
                                   const at::Tensor& src) {
+  XLA_FN_TRACE("aten");
   XLATensor self_tensor = bridge::GetXlaTensor(self);
   XLATensor::scatter_(self_tensor, dim, bridge::GetXlaTensor(index),
                       bridge::GetXlaTensor(src));
@@ -2409,6 +2963,7 @@ at::Tensor& AtenXlaType::scatter_(at::Tensor& self, int64_t dim,
 
 at::Tensor& AtenXlaType::scatter_(at::Tensor& self, int64_t dim,
                                   const at::Tensor& index, at::Scalar value) {
+  XLA_FN_TRACE("aten");
   XLATensor self_tensor = bridge::GetXlaTensor(self);
   XLATensor::scatter_(self_tensor, dim, bridge::GetXlaTensor(index), value);
   return self;
@@ -2417,6 +2972,7 @@ at::Tensor& AtenXlaType::scatter_(at::Tensor& self, int64_t dim,
 at::Tensor AtenXlaType::scatter_add(const at::Tensor& self, int64_t dim,
                                     const at::Tensor& index,
                                     const at::Tensor& src) {
+  XLA_FN_TRACE("aten");
   return bridge::AtenFromXlaTensor(XLATensor::scatter_add(
       bridge::GetXlaTensor(self), dim, bridge::GetXlaTensor(index),
       bridge::GetXlaTensor(src)));
@@ -2425,6 +2981,7 @@ at::Tensor AtenXlaType::scatter_add(const at::Tensor& self, int64_t dim,
 at::Tensor& AtenXlaType::scatter_add_(at::Tensor& self, int64_t dim,
                                       const at::Tensor& index,
                                       const at::Tensor& src) {
+  XLA_FN_TRACE("aten");
   XLATensor self_tensor = bridge::GetXlaTensor(self);
   XLATensor::scatter_add_(self_tensor, dim, bridge::GetXlaTensor(index),
                           bridge::GetXlaTensor(src));
@@ -2433,24 +2990,29 @@ at::Tensor& AtenXlaType::scatter_add_(at::Tensor& self, int64_t dim,
 
 at::Tensor AtenXlaType::select(const at::Tensor& self, int64_t dim,
                                int64_t index) {
+  XLA_FN_TRACE("aten");
   return bridge::AtenFromXlaTensor(
       XLATensor::select(bridge::GetXlaTensor(self), dim, index));
 }
 
 at::Tensor AtenXlaType::selu(const at::Tensor& self) {
+  XLA_FN_TRACE("aten");
   return at::native::selu(self);
 }
 
 at::Tensor& AtenXlaType::selu_(at::Tensor& self) {
+  XLA_FN_TRACE("aten");
   return at::native::selu_(self);
 }
 
 at::Tensor AtenXlaType::sigmoid(const at::Tensor& self) {
+  XLA_FN_TRACE("aten");
   return bridge::AtenFromXlaTensor(
       XLATensor::sigmoid(bridge::GetXlaTensor(self)));
 }
 
 at::Tensor& AtenXlaType::sigmoid_(at::Tensor& self) {
+  XLA_FN_TRACE("aten");
   XLATensor self_tensor = bridge::GetXlaTensor(self);
   XLATensor::sigmoid_(self_tensor);
   return self;
@@ -2458,46 +3020,55 @@ at::Tensor& AtenXlaType::sigmoid_(at::Tensor& self) {
 
 at::Tensor AtenXlaType::sigmoid_backward(const at::Tensor& grad_output,
                                          const at::Tensor& output) {
+  XLA_FN_TRACE("aten");
   return bridge::AtenFromXlaTensor(XLATensor::sigmoid_backward(
       bridge::GetXlaTensor(grad_output), bridge::GetXlaTensor(output)));
 }
 
 at::Tensor AtenXlaType::sign(const at::Tensor& self) {
+  XLA_FN_TRACE("aten");
   return bridge::AtenFromXlaTensor(XLATensor::sign(bridge::GetXlaTensor(self)));
 }
 
 at::Tensor& AtenXlaType::sign_(at::Tensor& self) {
+  XLA_FN_TRACE("aten");
   XLATensor self_tensor = bridge::GetXlaTensor(self);
   XLATensor::sign_(self_tensor);
   return self;
 }
 
 at::Tensor AtenXlaType::sin(const at::Tensor& self) {
+  XLA_FN_TRACE("aten");
   return bridge::AtenFromXlaTensor(XLATensor::sin(bridge::GetXlaTensor(self)));
 }
 
 at::Tensor& AtenXlaType::sin_(at::Tensor& self) {
+  XLA_FN_TRACE("aten");
   XLATensor self_tensor = bridge::GetXlaTensor(self);
   XLATensor::sin_(self_tensor);
   return self;
 }
 
 at::Tensor AtenXlaType::sinh(const at::Tensor& self) {
+  XLA_FN_TRACE("aten");
   return bridge::AtenFromXlaTensor(XLATensor::sinh(bridge::GetXlaTensor(self)));
 }
 
 at::Tensor& AtenXlaType::sinh_(at::Tensor& self) {
+  XLA_FN_TRACE("aten");
   XLATensor self_tensor = bridge::GetXlaTensor(self);
   XLATensor::sinh_(self_tensor);
   return self;
 }
 
 int64_t AtenXlaType::size(const at::Tensor& self, int64_t dim) {
+  XLA_FN_TRACE("aten");
   return bridge::GetXlaTensor(self).size(dim);
 }
 
 at::Tensor AtenXlaType::slice(const at::Tensor& self, int64_t dim,
                               int64_t start, int64_t end, int64_t step) {
+  XLA_FN_TRACE("aten");
   return bridge::AtenFromXlaTensor(
       XLATensor::slice(bridge::GetXlaTensor(self), dim, start, end, step));
 }
@@ -2505,6 +3076,7 @@ at::Tensor AtenXlaType::slice(const at::Tensor& self, int64_t dim,
 at::Tensor AtenXlaType::smooth_l1_loss(const at::Tensor& self,
                                        const at::Tensor& target,
                                        int64_t reduction) {
+  XLA_FN_TRACE("aten");
   return bridge::AtenFromXlaTensor(XLATensor::smooth_l1_loss(
       bridge::GetXlaTensor(self), bridge::GetXlaTensor(target), reduction));
 }
@@ -2513,6 +3085,7 @@ at::Tensor AtenXlaType::smooth_l1_loss_backward(const at::Tensor& grad_output,
                                                 const at::Tensor& self,
                                                 const at::Tensor& target,
                                                 int64_t reduction) {
+  XLA_FN_TRACE("aten");
   return bridge::AtenFromXlaTensor(XLATensor::smooth_l1_loss_backward(
       bridge::GetXlaTensor(grad_output), bridge::GetXlaTensor(self),
       bridge::GetXlaTensor(target), reduction));
@@ -2520,12 +3093,14 @@ at::Tensor AtenXlaType::smooth_l1_loss_backward(const at::Tensor& grad_output,
 
 at::Tensor AtenXlaType::softmax(const at::Tensor& self, int64_t dim,
                                 c10::optional<at::ScalarType> dtype) {
+  XLA_FN_TRACE("aten");
   return bridge::AtenFromXlaTensor(
       XLATensor::softmax(bridge::GetXlaTensor(self), dim, dtype));
 }
 
 at::Tensor AtenXlaType::softplus(const at::Tensor& self, at::Scalar beta,
                                  at::Scalar threshold) {
+  XLA_FN_TRACE("aten");
   return bridge::AtenFromXlaTensor(
       XLATensor::softplus(bridge::GetXlaTensor(self), beta, threshold));
 }
@@ -2534,12 +3109,14 @@ at::Tensor AtenXlaType::softplus_backward(const at::Tensor& grad_output,
                                           const at::Tensor& self,
                                           at::Scalar beta, at::Scalar threshold,
                                           const at::Tensor& output) {
+  XLA_FN_TRACE("aten");
   return bridge::AtenFromXlaTensor(XLATensor::softplus_backward(
       bridge::GetXlaTensor(grad_output), bridge::GetXlaTensor(self), beta,
       threshold, bridge::GetXlaTensor(output)));
 }
 
 at::Tensor AtenXlaType::softshrink(const at::Tensor& self, at::Scalar lambda) {
+  XLA_FN_TRACE("aten");
   return bridge::AtenFromXlaTensor(
       XLATensor::softshrink(bridge::GetXlaTensor(self), lambda));
 }
@@ -2547,6 +3124,7 @@ at::Tensor AtenXlaType::softshrink(const at::Tensor& self, at::Scalar lambda) {
 at::Tensor AtenXlaType::softshrink_backward(const at::Tensor& grad_out,
                                             const at::Tensor& self,
                                             at::Scalar lambda) {
+  XLA_FN_TRACE("aten");
   return bridge::AtenFromXlaTensor(XLATensor::softshrink_backward(
       bridge::GetXlaTensor(grad_out), bridge::GetXlaTensor(self), lambda));
 }
@@ -2554,14 +3132,16 @@ at::Tensor AtenXlaType::softshrink_backward(const at::Tensor& grad_out,
 std::tuple<at::Tensor, at::Tensor> AtenXlaType::sort(const at::Tensor& self,
                                                      int64_t dim,
                                                      bool descending) {
-  auto results = XLATensor::topk(bridge::GetXlaTensor(self), self.size(dim),
-                                 dim, descending, true);
+  XLA_FN_TRACE("aten");
+  auto results = XLATensor::sort(bridge::GetXlaTensor(self), dim, descending,
+                                 /*stable=*/true);
   return std::make_tuple(bridge::AtenFromXlaTensor(std::get<0>(results)),
                          bridge::AtenFromXlaTensor(std::get<1>(results)));
 }
 
 std::vector<at::Tensor> AtenXlaType::split(const at::Tensor& self,
                                            int64_t split_size, int64_t dim) {
+  XLA_FN_TRACE("aten");
   auto xla_tensors =
       XLATensor::split(bridge::GetXlaTensor(self), split_size, dim);
   return bridge::AtenFromXlaTensors(xla_tensors);
@@ -2569,50 +3149,59 @@ std::vector<at::Tensor> AtenXlaType::split(const at::Tensor& self,
 
 std::vector<at::Tensor> AtenXlaType::split_with_sizes(
     const at::Tensor& self, at::IntArrayRef split_sizes, int64_t dim) {
+  XLA_FN_TRACE("aten");
   auto xla_tensors = XLATensor::split_with_sizes(
       bridge::GetXlaTensor(self), XlaHelpers::I64List(split_sizes), dim);
   return bridge::AtenFromXlaTensors(xla_tensors);
 }
 
 at::Tensor AtenXlaType::sqrt(const at::Tensor& self) {
+  XLA_FN_TRACE("aten");
   return bridge::AtenFromXlaTensor(XLATensor::sqrt(bridge::GetXlaTensor(self)));
 }
 
 at::Tensor& AtenXlaType::sqrt_(at::Tensor& self) {
+  XLA_FN_TRACE("aten");
   XLATensor self_tensor = bridge::GetXlaTensor(self);
   XLATensor::sqrt_(self_tensor);
   return self;
 }
 
 at::Tensor AtenXlaType::squeeze(const at::Tensor& self) {
+  XLA_FN_TRACE("aten");
   return bridge::AtenFromXlaTensor(
       XLATensor::squeeze(bridge::GetXlaTensor(self)));
 }
 
 at::Tensor AtenXlaType::squeeze(const at::Tensor& self, int64_t dim) {
+  XLA_FN_TRACE("aten");
   return bridge::AtenFromXlaTensor(
       XLATensor::squeeze(bridge::GetXlaTensor(self), dim));
 }
 
 at::Tensor& AtenXlaType::squeeze_(at::Tensor& self) {
+  XLA_FN_TRACE("aten");
   XLATensor self_tensor = bridge::GetXlaTensor(self);
   XLATensor::squeeze_(self_tensor);
   return self;
 }
 
 at::Tensor& AtenXlaType::squeeze_(at::Tensor& self, int64_t dim) {
+  XLA_FN_TRACE("aten");
   XLATensor self_tensor = bridge::GetXlaTensor(self);
   XLATensor::squeeze_(self_tensor, dim);
   return self;
 }
 
 at::Tensor AtenXlaType::stack(at::TensorList tensors, int64_t dim) {
+  XLA_FN_TRACE("aten");
   return bridge::AtenFromXlaTensor(
       XLATensor::stack(bridge::GetXlaTensors(tensors), dim));
 }
 
 at::Tensor AtenXlaType::sub(const at::Tensor& self, const at::Tensor& other,
                             at::Scalar alpha) {
+  XLA_FN_TRACE("aten");
   XLATensor self_tensor = bridge::GetXlaTensor(self);
   return bridge::AtenFromXlaTensor(XLATensor::sub(
       self_tensor, bridge::GetOrCreateXlaTensor(other, self_tensor.GetDevice()),
@@ -2621,12 +3210,14 @@ at::Tensor AtenXlaType::sub(const at::Tensor& self, const at::Tensor& other,
 
 at::Tensor AtenXlaType::sub(const at::Tensor& self, at::Scalar other,
                             at::Scalar alpha) {
+  XLA_FN_TRACE("aten");
   return bridge::AtenFromXlaTensor(
       XLATensor::sub(bridge::GetXlaTensor(self), other, alpha));
 }
 
 at::Tensor& AtenXlaType::sub_(at::Tensor& self, const at::Tensor& other,
                               at::Scalar alpha) {
+  XLA_FN_TRACE("aten");
   XLATensor self_tensor = bridge::GetXlaTensor(self);
   XLATensor::sub_(self_tensor,
                   bridge::GetOrCreateXlaTensor(other, self_tensor.GetDevice()),
@@ -2636,6 +3227,7 @@ at::Tensor& AtenXlaType::sub_(at::Tensor& self, const at::Tensor& other,
 
 at::Tensor& AtenXlaType::sub_(at::Tensor& self, at::Scalar other,
                               at::Scalar alpha) {
+  XLA_FN_TRACE("aten");
   XLATensor self_tensor = bridge::GetXlaTensor(self);
   XLATensor::sub_(self_tensor, other, alpha);
   return self;
@@ -2643,6 +3235,7 @@ at::Tensor& AtenXlaType::sub_(at::Tensor& self, at::Scalar other,
 
 at::Tensor AtenXlaType::sum(const at::Tensor& self,
                             c10::optional<at::ScalarType> dtype) {
+  XLA_FN_TRACE("aten");
   XLATensor self_tensor = bridge::GetXlaTensor(self);
   return bridge::AtenFromXlaTensor(XLATensor::sum(
       self_tensor,
@@ -2652,6 +3245,7 @@ at::Tensor AtenXlaType::sum(const at::Tensor& self,
 
 at::Tensor AtenXlaType::sum(const at::Tensor& self, at::IntArrayRef dim,
                             bool keepdim, c10::optional<at::ScalarType> dtype) {
+  XLA_FN_TRACE("aten");
   return bridge::AtenFromXlaTensor(
       XLATensor::sum(bridge::GetXlaTensor(self),
                      xla::util::ToVector<xla::int64>(dim), keepdim, dtype));
@@ -2659,11 +3253,13 @@ at::Tensor AtenXlaType::sum(const at::Tensor& self, at::IntArrayRef dim,
 
 at::Tensor AtenXlaType::sum_to_size(const at::Tensor& self,
                                     at::IntArrayRef size) {
+  XLA_FN_TRACE("aten");
   return at::native::sum_to_size(self, size);
 }
 
 std::tuple<at::Tensor, at::Tensor, at::Tensor> AtenXlaType::svd(
     const at::Tensor& self, bool some, bool compute_uv) {
+  XLA_FN_TRACE("aten");
   auto results = XLATensor::svd(bridge::GetXlaTensor(self), some, compute_uv);
   return std::make_tuple(bridge::AtenFromXlaTensor(std::get<0>(results)),
                          bridge::AtenFromXlaTensor(std::get<1>(results)),
@@ -2673,6 +3269,7 @@ std::tuple<at::Tensor, at::Tensor, at::Tensor> AtenXlaType::svd(
 std::tuple<at::Tensor, at::Tensor> AtenXlaType::symeig(const at::Tensor& self,
                                                        bool eigenvectors,
                                                        bool upper) {
+  XLA_FN_TRACE("aten");
   auto results =
       XLATensor::symeig(bridge::GetXlaTensor(self), eigenvectors, upper);
   return std::make_tuple(bridge::AtenFromXlaTensor(std::get<0>(results)),
@@ -2680,31 +3277,37 @@ std::tuple<at::Tensor, at::Tensor> AtenXlaType::symeig(const at::Tensor& self,
 }
 
 at::Tensor AtenXlaType::t(const at::Tensor& self) {
+  XLA_FN_TRACE("aten");
   return bridge::AtenFromXlaTensor(
       XLATensor::transpose(bridge::GetXlaTensor(self), 0, 1));
 }
 
 at::Tensor& AtenXlaType::t_(at::Tensor& self) {
+  XLA_FN_TRACE("aten");
   XLATensor self_tensor = bridge::GetXlaTensor(self);
   XLATensor::transpose_(self_tensor, 0, 1);
   return self;
 }
 
 at::Tensor AtenXlaType::tan(const at::Tensor& self) {
+  XLA_FN_TRACE("aten");
   return bridge::AtenFromXlaTensor(XLATensor::tan(bridge::GetXlaTensor(self)));
 }
 
 at::Tensor& AtenXlaType::tan_(at::Tensor& self) {
+  XLA_FN_TRACE("aten");
   XLATensor self_tensor = bridge::GetXlaTensor(self);
   XLATensor::tan_(self_tensor);
   return self;
 }
 
 at::Tensor AtenXlaType::tanh(const at::Tensor& self) {
+  XLA_FN_TRACE("aten");
   return bridge::AtenFromXlaTensor(XLATensor::tanh(bridge::GetXlaTensor(self)));
 }
 
 at::Tensor& AtenXlaType::tanh_(at::Tensor& self) {
+  XLA_FN_TRACE("aten");
   XLATensor self_tensor = bridge::GetXlaTensor(self);
   XLATensor::tanh_(self_tensor);
   return self;
@@ -2712,6 +3315,7 @@ at::Tensor& AtenXlaType::tanh_(at::Tensor& self) {
 
 at::Tensor AtenXlaType::tanh_backward(const at::Tensor& grad_output,
                                       const at::Tensor& output) {
+  XLA_FN_TRACE("aten");
   return bridge::AtenFromXlaTensor(XLATensor::tanh_backward(
       bridge::GetXlaTensor(grad_output), bridge::GetXlaTensor(output)));
 }
@@ -2720,17 +3324,20 @@ at::Tensor AtenXlaType::tensordot(const at::Tensor& self,
                                   const at::Tensor& other,
                                   at::IntArrayRef dims_self,
                                   at::IntArrayRef dims_other) {
+  XLA_FN_TRACE("aten");
   return at::native::tensordot(self, other, dims_self, dims_other);
 }
 
 at::Tensor AtenXlaType::threshold(const at::Tensor& self, at::Scalar threshold,
                                   at::Scalar value) {
+  XLA_FN_TRACE("aten");
   return bridge::AtenFromXlaTensor(XLATensor::threshold(
       bridge::GetXlaTensor(self), threshold.to<double>(), value.to<double>()));
 }
 
 at::Tensor& AtenXlaType::threshold_(at::Tensor& self, at::Scalar threshold,
                                     at::Scalar value) {
+  XLA_FN_TRACE("aten");
   XLATensor self_tensor = bridge::GetXlaTensor(self);
   XLATensor::threshold_(self_tensor, threshold.to<double>(),
                         value.to<double>());
@@ -2740,6 +3347,7 @@ at::Tensor& AtenXlaType::threshold_(at::Tensor& self, at::Scalar threshold,
 at::Tensor AtenXlaType::threshold_backward(const at::Tensor& grad_output,
                                            const at::Tensor& self,
                                            at::Scalar threshold) {
+  XLA_FN_TRACE("aten");
   return bridge::AtenFromXlaTensor(XLATensor::threshold_backward(
       bridge::GetXlaTensor(grad_output), bridge::GetXlaTensor(self),
       threshold.to<double>()));
@@ -2748,6 +3356,7 @@ at::Tensor AtenXlaType::threshold_backward(const at::Tensor& grad_output,
 at::Tensor AtenXlaType::to(const at::Tensor& self,
                            const at::TensorOptions& options,
                            bool /* non_blocking */, bool /* copy */) {
+  XLA_FN_TRACE("aten");
   XLATensor self_tensor = bridge::GetXlaTensor(self);
   if (options.has_device() && options.device().type() != at::kXLA) {
     return bridge::XlaToAtenTensor(self_tensor, options);
@@ -2759,17 +3368,20 @@ at::Tensor AtenXlaType::to(const at::Tensor& self,
 
 at::Tensor AtenXlaType::to(const at::Tensor& self, c10::Device device,
                            at::ScalarType dtype, bool non_blocking, bool copy) {
+  XLA_FN_TRACE("aten");
   return to(self, self.options().device(device).dtype(dtype), non_blocking,
             copy);
 }
 
 at::Tensor AtenXlaType::to(const at::Tensor& self, at::ScalarType dtype,
                            bool non_blocking, bool copy) {
+  XLA_FN_TRACE("aten");
   return to(self, self.options().dtype(dtype), non_blocking, copy);
 }
 
 at::Tensor AtenXlaType::to(const at::Tensor& self, const at::Tensor& other,
                            bool non_blocking, bool copy) {
+  XLA_FN_TRACE("aten");
   return to(self, other.options(), non_blocking, copy);
 }
 
@@ -2777,6 +3389,7 @@ std::tuple<at::Tensor, at::Tensor> AtenXlaType::topk(const at::Tensor& self,
                                                      int64_t k, int64_t dim,
                                                      bool largest,
                                                      bool sorted) {
+  XLA_FN_TRACE("aten");
   auto results =
       XLATensor::topk(bridge::GetXlaTensor(self), k, dim, largest, sorted);
   return std::make_tuple(bridge::AtenFromXlaTensor(std::get<0>(results)),
@@ -2784,22 +3397,26 @@ std::tuple<at::Tensor, at::Tensor> AtenXlaType::topk(const at::Tensor& self,
 }
 
 at::Tensor AtenXlaType::trace(const at::Tensor& self) {
+  XLA_FN_TRACE("aten");
   return bridge::AtenFromXlaTensor(
       XLATensor::trace(bridge::GetXlaTensor(self)));
 }
 
 at::Tensor AtenXlaType::one_hot(const at::Tensor& self, int64_t num_classes) {
+  XLA_FN_TRACE("aten");
   return at::native::one_hot(self, num_classes);
 }
 
 at::Tensor AtenXlaType::transpose(const at::Tensor& self, int64_t dim0,
                                   int64_t dim1) {
+  XLA_FN_TRACE("aten");
   return bridge::AtenFromXlaTensor(
       XLATensor::transpose(bridge::GetXlaTensor(self), dim0, dim1));
 }
 
 at::Tensor& AtenXlaType::transpose_(at::Tensor& self, int64_t dim0,
                                     int64_t dim1) {
+  XLA_FN_TRACE("aten");
   XLATensor self_tensor = bridge::GetXlaTensor(self);
   XLATensor::transpose_(self_tensor, dim0, dim1);
   return self;
@@ -2808,6 +3425,7 @@ at::Tensor& AtenXlaType::transpose_(at::Tensor& self, int64_t dim0,
 std::tuple<at::Tensor, at::Tensor> AtenXlaType::triangular_solve(
     const at::Tensor& b, const at::Tensor& A, bool upper, bool transpose,
     bool unitriangular) {
+  XLA_FN_TRACE("aten");
   // Currently, ATen doesn't have a left_side option. Once this
   // is added, this API will have to be changed.
   auto results = XLATensor::triangular_solve(
@@ -2818,11 +3436,13 @@ std::tuple<at::Tensor, at::Tensor> AtenXlaType::triangular_solve(
 }
 
 at::Tensor AtenXlaType::tril(const at::Tensor& self, int64_t diagonal) {
+  XLA_FN_TRACE("aten");
   return bridge::AtenFromXlaTensor(
       XLATensor::tril(bridge::GetXlaTensor(self), diagonal));
 }
 
 at::Tensor& AtenXlaType::tril_(at::Tensor& self, int64_t diagonal) {
+  XLA_FN_TRACE("aten");
   XLATensor self_tensor = bridge::GetXlaTensor(self);
   XLATensor::tril_(self_tensor, diagonal);
   return self;
@@ -2833,27 +3453,32 @@ at::Tensor AtenXlaType::triplet_margin_loss(const at::Tensor& anchor,
                                             const at::Tensor& negative,
                                             double margin, double p, double eps,
                                             bool swap, int64_t reduction) {
+  XLA_FN_TRACE("aten");
   return at::native::triplet_margin_loss(anchor, positive, negative, margin, p,
                                          eps, swap, reduction);
 }
 
 at::Tensor AtenXlaType::triu(const at::Tensor& self, int64_t diagonal) {
+  XLA_FN_TRACE("aten");
   return bridge::AtenFromXlaTensor(
       XLATensor::triu(bridge::GetXlaTensor(self), diagonal));
 }
 
 at::Tensor& AtenXlaType::triu_(at::Tensor& self, int64_t diagonal) {
+  XLA_FN_TRACE("aten");
   XLATensor self_tensor = bridge::GetXlaTensor(self);
   XLATensor::triu_(self_tensor, diagonal);
   return self;
 }
 
 at::Tensor AtenXlaType::trunc(const at::Tensor& self) {
+  XLA_FN_TRACE("aten");
   return bridge::AtenFromXlaTensor(
       XLATensor::trunc(bridge::GetXlaTensor(self)));
 }
 
 at::Tensor& AtenXlaType::trunc_(at::Tensor& self) {
+  XLA_FN_TRACE("aten");
   XLATensor self_tensor = bridge::GetXlaTensor(self);
   XLATensor::trunc_(self_tensor);
   return self;
@@ -2861,39 +3486,90 @@ at::Tensor& AtenXlaType::trunc_(at::Tensor& self) {
 
 std::vector<at::Tensor> AtenXlaType::unbind(const at::Tensor& self,
                                             int64_t dim) {
+  XLA_FN_TRACE("aten");
   return bridge::AtenFromXlaTensors(
       XLATensor::unbind(bridge::GetXlaTensor(self), dim));
 }
 
+at::Tensor& AtenXlaType::uniform_(at::Tensor& self, double from, double to,
+                                  at::Generator* generator) {
+  XLA_FN_TRACE("aten");
+  if (generator != nullptr) {
+    return AtenXlaTypeDefault::uniform_(self, from, to, generator);
+  }
+  XLATensor self_tensor = bridge::GetXlaTensor(self);
+  XLATensor::uniform_(self_tensor, from, to);
+  return self;
+}
+
 at::Tensor AtenXlaType::unsqueeze(const at::Tensor& self, int64_t dim) {
+  XLA_FN_TRACE("aten");
   return bridge::AtenFromXlaTensor(
       XLATensor::unsqueeze(bridge::GetXlaTensor(self), dim));
 }
 
 at::Tensor& AtenXlaType::unsqueeze_(at::Tensor& self, int64_t dim) {
+  XLA_FN_TRACE("aten");
   XLATensor self_tensor = bridge::GetXlaTensor(self);
   XLATensor::unsqueeze_(self_tensor, dim);
   return self;
 }
 
+at::Tensor AtenXlaType::upsample_bilinear2d(const at::Tensor& self,
+                                            at::IntArrayRef output_size,
+                                            bool align_corners) {
+  XLA_FN_TRACE("aten");
+  return bridge::AtenFromXlaTensor(XLATensor::upsample_bilinear2d(
+      bridge::GetXlaTensor(self), XlaHelpers::I64List(output_size),
+      align_corners));
+}
+
+at::Tensor AtenXlaType::upsample_bilinear2d_backward(
+    const at::Tensor& grad_output, at::IntArrayRef output_size,
+    at::IntArrayRef input_size, bool align_corners) {
+  XLA_FN_TRACE("aten");
+  return bridge::AtenFromXlaTensor(XLATensor::upsample_bilinear2d_backward(
+      bridge::GetXlaTensor(grad_output), XlaHelpers::I64List(input_size),
+      align_corners));
+}
+
+at::Tensor AtenXlaType::upsample_nearest2d(const at::Tensor& self,
+                                           at::IntArrayRef output_size) {
+  XLA_FN_TRACE("aten");
+  return bridge::AtenFromXlaTensor(XLATensor::upsample_nearest2d(
+      bridge::GetXlaTensor(self), XlaHelpers::I64List(output_size)));
+}
+
+at::Tensor AtenXlaType::upsample_nearest2d_backward(
+    const at::Tensor& grad_output, at::IntArrayRef output_size,
+    at::IntArrayRef input_size) {
+  XLA_FN_TRACE("aten");
+  return bridge::AtenFromXlaTensor(XLATensor::upsample_nearest2d_backward(
+      bridge::GetXlaTensor(grad_output), XlaHelpers::I64List(input_size)));
+}
+
 at::Tensor AtenXlaType::view(const at::Tensor& self, at::IntArrayRef size) {
+  XLA_FN_TRACE("aten");
   return bridge::AtenFromXlaTensor(
       XLATensor::view(bridge::GetXlaTensor(self), XlaHelpers::I64List(size)));
 }
 
 at::Tensor AtenXlaType::view_as(const at::Tensor& self,
                                 const at::Tensor& other) {
+  XLA_FN_TRACE("aten");
   return view(self, other.sizes());
 }
 
 at::Tensor AtenXlaType::where(const at::Tensor& condition,
                               const at::Tensor& self, const at::Tensor& other) {
+  XLA_FN_TRACE("aten");
   return bridge::AtenFromXlaTensor(XLATensor::where(
       bridge::GetXlaTensor(condition), bridge::GetXlaTensor(self),
       bridge::GetXlaTensor(other)));
 }
 
 at::Tensor& AtenXlaType::zero_(at::Tensor& self) {
+  XLA_FN_TRACE("aten");
   XLATensor self_tensor = bridge::GetXlaTensor(self);
   XLATensor::zero_(self_tensor);
   return self;
@@ -2901,15 +3577,18 @@ at::Tensor& AtenXlaType::zero_(at::Tensor& self) {
 
 at::Tensor AtenXlaType::zeros(at::IntArrayRef size,
                               const at::TensorOptions& options) {
+  XLA_FN_TRACE("aten");
   return full(size, 0, options);
 }
 
 at::Tensor AtenXlaType::zeros_like(const at::Tensor& self) {
+  XLA_FN_TRACE("aten");
   return full_like(self, 0);
 }
 
 at::Tensor AtenXlaType::zeros_like(const at::Tensor& self,
                                    const at::TensorOptions& options) {
+  XLA_FN_TRACE("aten");
   return full_like(self, 0, options);
 }
 
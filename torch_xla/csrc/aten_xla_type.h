@@ -78,10 +78,30 @@ class AtenXlaType {
 
   static at::Tensor _dim_arange(const at::Tensor& like, int64_t dim);
 
+  static std::tuple<at::Tensor, at::Tensor, at::Tensor, at::Tensor>
+  _embedding_bag(const at::Tensor& weight, const at::Tensor& indices,
+                 const at::Tensor& offsets, bool scale_grad_by_freq,
+                 int64_t mode, bool sparse,
+                 const at::Tensor& per_sample_weights);
+
+  static at::Tensor _embedding_bag_dense_backward(
+      const at::Tensor& grad, const at::Tensor& indices,
+      const at::Tensor& offsets, const at::Tensor& offset2bag,
+      const at::Tensor& bag_size, const at::Tensor& maximum_indices,
+      int64_t num_weights, bool scale_grad_by_freq, int64_t mode,
+      const at::Tensor& per_sample_weights);
+
+  static at::Tensor _embedding_bag_per_sample_weights_backward(
+      const at::Tensor& grad, const at::Tensor& weight,
+      const at::Tensor& indices, const at::Tensor& offsets,
+      const at::Tensor& offset2bag, int64_t mode);
+
   static at::Tensor& _index_put_impl_(at::Tensor& self, at::TensorList indices,
                                       const at::Tensor& values, bool accumulate,
                                       bool unsafe);
 
+  static at::Scalar _local_scalar_dense(const at::Tensor& self);
+
   static at::Tensor _log_softmax(const at::Tensor& self, int64_t dim,
                                  bool half_to_float);
 
@@ -112,6 +132,26 @@ class AtenXlaType {
 
   static at::Tensor& acos_(at::Tensor& self);
 
+  static at::Tensor adaptive_avg_pool3d(const at::Tensor& self,
+                                        at::IntArrayRef output_size);
+
+  static at::Tensor adaptive_avg_pool3d_backward(const at::Tensor& grad_output,
+                                                 const at::Tensor& self);
+
+  static std::tuple<at::Tensor, at::Tensor> adaptive_max_pool2d(
+      const at::Tensor& self, at::IntArrayRef output_size);
+
+  static at::Tensor adaptive_max_pool2d_backward(const at::Tensor& grad_output,
+                                                 const at::Tensor& self,
+                                                 const at::Tensor& indices);
+
+  static std::tuple<at::Tensor, at::Tensor> adaptive_max_pool3d(
+      const at::Tensor& self, at::IntArrayRef output_size);
+
+  static at::Tensor adaptive_max_pool3d_backward(const at::Tensor& grad_output,
+                                                 const at::Tensor& self,
+                                                 const at::Tensor& indices);
+
   static at::Tensor add(const at::Tensor& self, const at::Tensor& other,
                         at::Scalar alpha);
 
@@ -793,6 +833,9 @@ class AtenXlaType {
   static at::Tensor norm(const at::Tensor& self, c10::optional<at::Scalar> p,
                          at::IntArrayRef dim, bool keepdim);
 
+  static at::Tensor& normal_(at::Tensor& self, double mean, double std,
+                             at::Generator* generator);
+
   static at::Tensor nuclear_norm(const at::Tensor& self, bool keepdim);
 
   static int64_t numel(const at::Tensor& self);
@@ -837,6 +880,26 @@ class AtenXlaType {
   static std::tuple<at::Tensor, at::Tensor> qr(const at::Tensor& self,
                                                bool some);
 
+  static at::Tensor rand(at::IntArrayRef size,
+                         const at::TensorOptions& options);
+
+  static at::Tensor rand(at::IntArrayRef size, at::Generator* generator,
+                         const at::TensorOptions& options);
+
+  static at::Tensor randn(at::IntArrayRef size,
+                          const at::TensorOptions& options);
+
+  static at::Tensor randn(at::IntArrayRef size, at::Generator* generator,
+                          const at::TensorOptions& options);
+
+  static at::Tensor& random_(at::Tensor& self, int64_t from, int64_t to,
+                             at::Generator* generator);
+
+  static at::Tensor& random_(at::Tensor& self, int64_t to,
+                             at::Generator* generator);
+
+  static at::Tensor& random_(at::Tensor& self, at::Generator* generator);
+
   static at::Tensor randperm(int64_t n, const at::TensorOptions& options);
   static at::Tensor randperm(int64_t n, at::Generator* generator,
                              const at::TensorOptions& options);
@@ -1081,10 +1144,29 @@ class AtenXlaType {
 
   static std::vector<at::Tensor> unbind(const at::Tensor& self, int64_t dim);
 
+  static at::Tensor& uniform_(at::Tensor& self, double from, double to,
+                              at::Generator* generator);
+
   static at::Tensor unsqueeze(const at::Tensor& self, int64_t dim);
 
   static at::Tensor& unsqueeze_(at::Tensor& self, int64_t dim);
 
+  static at::Tensor upsample_bilinear2d(const at::Tensor& self,
+                                        at::IntArrayRef output_size,
+                                        bool align_corners);
+
+  static at::Tensor upsample_bilinear2d_backward(const at::Tensor& grad_output,
+                                                 at::IntArrayRef output_size,
+                                                 at::IntArrayRef input_size,
+                                                 bool align_corners);
+
+  static at::Tensor upsample_nearest2d(const at::Tensor& self,
+                                       at::IntArrayRef output_size);
+
+  static at::Tensor upsample_nearest2d_backward(const at::Tensor& grad_output,
+                                                at::IntArrayRef output_size,
+                                                at::IntArrayRef input_size);
+
   static at::Tensor view(const at::Tensor& self, at::IntArrayRef size);
 
   static at::Tensor view_as(const at::Tensor& self, const at::Tensor& other);
@@ -0,0 +1,233 @@
+#include "torch_xla/csrc/attention.h"
+
+#include <algorithm>
+
+#include "tensorflow/compiler/xla/client/lib/constants.h"
+#include "tensorflow/compiler/xla/shape_util.h"
+#include "tensorflow/compiler/xla/xla_client/debug_macros.h"
+#include "tensorflow/compiler/xla/xla_client/sys_util.h"
+#include "tensorflow/compiler/xla/xla_client/util.h"
+#include "torch_xla/csrc/helpers.h"
+
+namespace torch_xla {
+namespace {
+
+// Keeps the attention operands, and the attributes shared by the forward and
+// the backward lowerings.
+struct AttentionContext {
+  AttentionContext(const xla::XlaOp& query, const xla::XlaOp& key,
+                   const xla::XlaOp& value, const xla::XlaOp& mask,
+                   double scale, xla::int64 block_size)
+      : query(query),
+        key(key),
+        value(value),
+        mask(mask),
+        scale(scale),
+        block_size(block_size),
+        precision_config(
+            XlaHelpers::BuildPrecisionConfig(XlaHelpers::mat_mul_precision())) {
+    xla::Shape query_shape = XlaHelpers::ShapeOfXlaOp(query);
+    xla::Shape key_shape = XlaHelpers::ShapeOfXlaOp(key);
+    xla::Shape value_shape = XlaHelpers::ShapeOfXlaOp(value);
+    rank = query_shape.rank();
+    XLA_CHECK_GE(rank, 2) << "Attention operands must have rank 2 or more";
+    XLA_CHECK_EQ(key_shape.rank(), rank) << key_shape << " vs " << query_shape;
+    XLA_CHECK_EQ(value_shape.rank(), rank)
+        << value_shape << " vs " << query_shape;
+    for (xla::int64 dim = 0; dim < rank - 2; ++dim) {
+      XLA_CHECK(query_shape.dimensions(dim) == key_shape.dimensions(dim) &&
+                query_shape.dimensions(dim) == value_shape.dimensions(dim))
+          << "Mismatching attention batch dimensions: " << query_shape << ", "
+          << key_shape << ", " << value_shape;
+    }
+    XLA_CHECK_EQ(query_shape.dimensions(rank - 1),
+                 key_shape.dimensions(rank - 1))
+        << query_shape << " vs " << key_shape;
+    XLA_CHECK_EQ(key_shape.dimensions(rank - 2),
+                 value_shape.dimensions(rank - 2))
+        << key_shape << " vs " << value_shape;
+    XLA_CHECK_GT(key_shape.dimensions(rank - 2), 0) << "No attention keys";
+    XLA_CHECK_GT(block_size, 0) << "Invalid attention block size";
+    mask_shape = XlaHelpers::ShapeOfXlaOp(mask);
+    XLA_CHECK_LE(mask_shape.rank(), rank)
+        << "The attention mask " << mask_shape
+        << " does not broadcast to the scores";
+    type = query_shape.element_type();
+    num_keys = key_shape.dimensions(rank - 2);
+    scores_sizes = XlaHelpers::SizesOfXlaOp(query);
+    scores_sizes.back() = num_keys;
+  }
+
+  // The query-key dimension numbers, starting from the batch dimensions, and
+  // contracting the given lhs and rhs dimensions.
+  xla::DotDimensionNumbers DimensionNumbers(xla::int64 lhs_dim,
+                                            xla::int64 rhs_dim) const {
+    xla::DotDimensionNumbers dimension_numbers;
+    for (xla::int64 dim = 0; dim < rank - 2; ++dim) {
+      dimension_numbers.add_lhs_batch_dimensions(dim);
+      dimension_numbers.add_rhs_batch_dimensions(dim);
+    }
+    dimension_numbers.add_lhs_contracting_dimensions(lhs_dim);
+    dimension_numbers.add_rhs_contracting_dimensions(rhs_dim);
+    return dimension_numbers;
+  }
+
+  xla::XlaOp Dot(const xla::XlaOp& lhs, const xla::XlaOp& rhs,
+                 xla::int64 lhs_dim, xla::int64 rhs_dim) const {
+    return xla::DotGeneral(lhs, rhs, DimensionNumbers(lhs_dim, rhs_dim),
+                           &precision_config);
+  }
+
+  // The dimensions of the [..., Sq] row statistics within the scores.
+  std::vector<xla::int64> RowDimensions() const {
+    return xla::util::Iota<xla::int64>(rank - 1);
+  }
+
+  xla::XlaOp Scalar(double value) const {
+    return XlaHelpers::ScalarValue<double>(value, type, query.builder());
+  }
+
+  // Returns the slice of the keys dimension of op, for the given block.
+  xla::XlaOp KeyBlock(const xla::XlaOp& op, xla::int64 start,
+                      xla::int64 end) const {
+    return xla::SliceInDim(op, start, end, 1, rank - 2);
+  }
+
+  // Computes the masked scores of the keys within [start, end).
+  xla::XlaOp Scores(xla::int64 start, xla::int64 end) const {
+    xla::XlaOp scores =
+        Dot(query, KeyBlock(key, start, end), rank - 1, rank - 1) *
+        Scalar(scale);
+    std::vector<xla::int64> block_sizes(scores_sizes);
+    block_sizes.back() = end - start;
+    xla::XlaOp mask_block = mask;
+    if (mask_shape.rank() > 0 && mask_shape.dimensions().back() != 1) {
+      mask_block =
+          xla::SliceInDim(mask_block, start, end, 1, mask_shape.rank() - 1);
+    }
+    xla::Shape block_shape = xla::ShapeUtil::MakeShape(type, block_sizes);
+    mask_block = XlaHelpers::ImplicitBroadcast(
+        mask_block, XlaHelpers::ShapeOfXlaOp(mask_block), block_shape);
+    if (mask_shape.element_type() == xla::PrimitiveType::PRED) {
+      return xla::Select(
+          mask_block,
+          xla::Broadcast(xla::MinValue(query.builder(), type), block_sizes),
+          scores);
+    }
+    return scores + xla::ConvertElementType(mask_block, type);
+  }
+
+  xla::XlaOp query;
+  xla::XlaOp key;
+  xla::XlaOp value;
+  xla::XlaOp mask;
+  double scale;
+  xla::int64 block_size;
+  xla::PrecisionConfig precision_config;
+  xla::int64 rank = 0;
+  xla::Shape mask_shape;
+  xla::PrimitiveType type;
+  xla::int64 num_keys = 0;
+  std::vector<xla::int64> scores_sizes;
+};
+
+xla::XlaOp ReduceLastDim(const xla::XlaOp& input, const xla::XlaOp& init_value,
+                         const xla::XlaComputation& computation) {
+  xla::int64 rank = XlaHelpers::ShapeOfXlaOp(input).rank();
+  return xla::Reduce(input, init_value, computation, {rank - 1});
+}
+
+}  // namespace
+
+xla::int64 AttentionBlockSize() {
+  static xla::int64 block_size =
+      xla::sys_util::GetEnvInt("XLA_ATTENTION_BLOCK_SIZE", 512);
+  return block_size;
+}
+
+AttentionResult BuildAttention(const xla::XlaOp& query, const xla::XlaOp& key,
+                               const xla::XlaOp& value, const xla::XlaOp& mask,
+                               double scale, xla::int64 block_size) {
+  AttentionContext ctx(query, key, value, mask, scale, block_size);
+  xla::XlaBuilder* builder = query.builder();
+  std::vector<xla::int64> row_dims = ctx.RowDimensions();
+  xla::XlaOp min_value = xla::MinValue(builder, ctx.type);
+  xla::XlaOp zero = xla::Zero(builder, ctx.type);
+  xla::XlaOp row_max;
+  xla::XlaOp row_sum;
+  xla::XlaOp accumulator;
+  for (xla::int64 start = 0; start < ctx.num_keys; start += block_size) {
+    xla::int64 end = std::min(start + block_size, ctx.num_keys);
+    xla::XlaOp scores = ctx.Scores(start, end);
+    xla::XlaOp block_max = ReduceLastDim(
+        scores, min_value, XlaHelpers::CreateMaxComputation(ctx.type));
+    xla::XlaOp new_max = start > 0 ? xla::Max(row_max, block_max) : block_max;
+    // Rows with all the scores masked so far have a -inf maximum, which gets
+    // replaced by zero to avoid (-inf) - (-inf) NaNs.
+    xla::XlaOp safe_max = xla::Select(xla::Eq(new_max, min_value),
+                                      xla::ZerosLike(new_max), new_max);
+    xla::XlaOp probs = xla::Exp(xla::Sub(scores, safe_max, row_dims));
+    xla::XlaOp block_sum = ReduceLastDim(
+        probs, zero, XlaHelpers::CreateAddComputation(ctx.type));
+    xla::XlaOp block_output =
+        ctx.Dot(probs, ctx.KeyBlock(value, start, end), ctx.rank - 1,
+                ctx.rank - 2);
+    if (start > 0) {
+      // Rescale the partial results to the new maximum.
+      xla::XlaOp correction = xla::Exp(row_max - safe_max);
+      row_sum = row_sum * correction + block_sum;
+      accumulator =
+          xla::Mul(accumulator, correction, row_dims) + block_output;
+    } else {
+      row_sum = block_sum;
+      accumulator = block_output;
+    }
+    row_max = new_max;
+  }
+  xla::XlaOp safe_max = xla::Select(xla::Eq(row_max, min_value),
+                                    xla::ZerosLike(row_max), row_max);
+  return {xla::Div(accumulator, row_sum, row_dims),
+          safe_max + xla::Log(row_sum)};
+}
+
+AttentionGrads BuildAttentionBackward(
+    const xla::XlaOp& grad_output, const xla::XlaOp& query,
+    const xla::XlaOp& key, const xla::XlaOp& value, const xla::XlaOp& mask,
+    const xla::XlaOp& output, const xla::XlaOp& logsumexp, double scale,
+    xla::int64 block_size) {
+  AttentionContext ctx(query, key, value, mask, scale, block_size);
+  xla::XlaBuilder* builder = query.builder();
+  std::vector<xla::int64> row_dims = ctx.RowDimensions();
+  // The gradient of the softmax needs, for every row, the sum of the
+  // probabilities times their gradients, which equals sum(grad_output *
+  // output) over the value dimension.
+  xla::XlaOp grad_dot_output =
+      ReduceLastDim(grad_output * output, xla::Zero(builder, ctx.type),
+                    XlaHelpers::CreateAddComputation(ctx.type));
+  xla::XlaOp grad_query;
+  std::vector<xla::XlaOp> grad_keys;
+  std::vector<xla::XlaOp> grad_values;
+  for (xla::int64 start = 0; start < ctx.num_keys; start += block_size) {
+    xla::int64 end = std::min(start + block_size, ctx.num_keys);
+    xla::XlaOp probs =
+        xla::Exp(xla::Sub(ctx.Scores(start, end), logsumexp, row_dims));
+    grad_values.push_back(
+        ctx.Dot(probs, grad_output, ctx.rank - 2, ctx.rank - 2));
+    xla::XlaOp grad_probs = ctx.Dot(
+        grad_output, ctx.KeyBlock(value, start, end), ctx.rank - 1,
+        ctx.rank - 1);
+    xla::XlaOp grad_scores =
+        probs * xla::Sub(grad_probs, grad_dot_output, row_dims) *
+        ctx.Scalar(scale);
+    xla::XlaOp block_grad_query = ctx.Dot(
+        grad_scores, ctx.KeyBlock(key, start, end), ctx.rank - 1,
+        ctx.rank - 2);
+    grad_query = start > 0 ? grad_query + block_grad_query : block_grad_query;
+    grad_keys.push_back(
+        ctx.Dot(grad_scores, query, ctx.rank - 2, ctx.rank - 2));
+  }
+  return {grad_query, xla::ConcatInDim(builder, grad_keys, ctx.rank - 2),
+          xla::ConcatInDim(builder, grad_values, ctx.rank - 2)};
+}
+
+}  // namespace torch_xla
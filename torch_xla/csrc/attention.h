@@ -0,0 +1,42 @@
+#pragma once
+
+#include "tensorflow/compiler/xla/client/xla_builder.h"
+
+namespace torch_xla {
+
+// Returns the number of keys processed by every block of the attention
+// lowerings, from the XLA_ATTENTION_BLOCK_SIZE environment variable.
+xla::int64 AttentionBlockSize();
+
+struct AttentionResult {
+  xla::XlaOp output;
+  // The log(sum(exp(scores))) of every query row, needed by the backward.
+  xla::XlaOp logsumexp;
+};
+
+// Computes softmax(query * key^T * scale + mask) * value, where query is
+// [..., Sq, D], key [..., Sk, D] and value [..., Sk, Dv]. The mask is either a
+// PRED tensor whose true elements exclude the respective scores, or an
+// additive floating point one, and it broadcasts to [..., Sq, Sk]. The keys
+// are processed in blocks of block_size, keeping a running maximum and sum of
+// the exponentiated scores, so that no [..., Sq, Sk] tensor is materialized.
+AttentionResult BuildAttention(const xla::XlaOp& query, const xla::XlaOp& key,
+                               const xla::XlaOp& value, const xla::XlaOp& mask,
+                               double scale, xla::int64 block_size);
+
+struct AttentionGrads {
+  xla::XlaOp grad_query;
+  xla::XlaOp grad_key;
+  xla::XlaOp grad_value;
+};
+
+// Computes the gradients of BuildAttention(), given its output and logsumexp.
+// The scores of every key block are recomputed, instead of being saved by the
+// forward.
+AttentionGrads BuildAttentionBackward(
+    const xla::XlaOp& grad_output, const xla::XlaOp& query,
+    const xla::XlaOp& key, const xla::XlaOp& value, const xla::XlaOp& mask,
+    const xla::XlaOp& output, const xla::XlaOp& logsumexp, double scale,
+    xla::int64 block_size);
+
+}  // namespace torch_xla
@@ -1,10 +1,198 @@
 #include "torch_xla/csrc/batch_norm.h"
 
+#include <algorithm>
+#include <vector>
+
+#include "tensorflow/compiler/xla/client/lib/constants.h"
+#include "tensorflow/compiler/xla/shape_util.h"
+#include "tensorflow/compiler/xla/xla_client/sys_util.h"
+#include "torch_xla/csrc/cross_replica_reduces.h"
 #include "torch_xla/csrc/helpers.h"
 
 namespace torch_xla {
 namespace {
 
+// The feature dimension is always 1 for the PyTorch batch norm.
+constexpr xla::int64 kFeatureIndex = 1;
+
+// Whether the batch norm should be lowered with explicit reductions and
+// element-wise operations, instead of the XLA BatchNorm* operations.
+bool UseExplicitBatchNorm() {
+  static const bool explicit_batch_norm =
+      xla::sys_util::GetEnvBool("XLA_EXPLICIT_BATCH_NORM", false);
+  return explicit_batch_norm || UseSyncBatchNorm();
+}
+
+// The statistics of lower precision inputs are accumulated in F32.
+xla::PrimitiveType GetAccumulationType(xla::PrimitiveType type) {
+  return type == xla::PrimitiveType::BF16 || type == xla::PrimitiveType::F16
+             ? xla::PrimitiveType::F32
+             : type;
+}
+
+std::vector<xla::int64> GetReductionDimensions(const xla::Shape& shape) {
+  std::vector<xla::int64> dimensions;
+  for (xla::int64 i = 0; i < shape.rank(); ++i) {
+    if (i != kFeatureIndex) {
+      dimensions.push_back(i);
+    }
+  }
+  return dimensions;
+}
+
+xla::XlaOp BroadcastFeatures(const xla::XlaOp& features,
+                             const xla::Shape& shape) {
+  return xla::BroadcastInDim(features, shape.dimensions(), {kFeatureIndex});
+}
+
+xla::XlaOp SumFeatures(const xla::XlaOp& input,
+                       tensorflow::gtl::ArraySlice<const xla::int64> dims) {
+  xla::PrimitiveType type = XlaHelpers::ShapeOfXlaOp(input).element_type();
+  return xla::Reduce(input, xla::Zero(input.builder(), type),
+                     XlaHelpers::CreateAddComputation(type), dims);
+}
+
+// Sums the per feature reductions, and their element count, across all the
+// replicas with a single cross replica sum. Returns the global count.
+xla::XlaOp CrossReplicaSumFeatures(std::vector<xla::XlaOp*> features,
+                                   xla::int64 count) {
+  xla::XlaOp& first = *features.front();
+  xla::Shape features_shape = XlaHelpers::ShapeOfXlaOp(first);
+  xla::int64 num_features = features_shape.dimensions(0);
+  std::vector<xla::XlaOp> values;
+  for (auto feature : features) {
+    values.push_back(*feature);
+  }
+  values.push_back(xla::Reshape(
+      XlaHelpers::ScalarValue<xla::int64>(
+          count, features_shape.element_type(), first.builder()),
+      {1}));
+  xla::XlaOp sums = BuildCrossReplicaSum(
+      xla::ConcatInDim(first.builder(), values, 0), 1.0, {});
+  for (size_t i = 0; i < features.size(); ++i) {
+    *features[i] = xla::SliceInDim(sums, i * num_features,
+                                   (i + 1) * num_features, 1, 0);
+  }
+  return xla::SliceInDim(sums, features.size() * num_features,
+                         features.size() * num_features + 1, 1, 0);
+}
+
+// Computes the statistics with the two moments of the input, reduced within
+// the same pass over the input (XLA fuses sibling reductions), and normalizes
+// with a single per feature scale and offset. For better accuracy the moments
+// are computed on the input shifted by its first sample, unless the
+// statistics are synced across replicas, in which case all the replicas need
+// to use the same shift.
+BatchNormOutput BuildExplicitBatchNormTraining(const xla::XlaOp& input,
+                                               const xla::XlaOp& weight,
+                                               const xla::XlaOp& bias,
+                                               float eps_value) {
+  xla::XlaBuilder* builder = input.builder();
+  xla::Shape input_shape = XlaHelpers::ShapeOfXlaOp(input);
+  xla::PrimitiveType type = input_shape.element_type();
+  xla::PrimitiveType accumulation_type = GetAccumulationType(type);
+  xla::int64 num_features = input_shape.dimensions(kFeatureIndex);
+  std::vector<xla::int64> reduce_dims = GetReductionDimensions(input_shape);
+
+  xla::XlaOp acc_input = xla::ConvertElementType(input, accumulation_type);
+  bool sync = UseSyncBatchNorm();
+  xla::XlaOp shift;
+  if (sync) {
+    shift = xla::Broadcast(xla::Zero(builder, accumulation_type),
+                           {num_features});
+  } else {
+    std::vector<xla::int64> start_indices(input_shape.rank(), 0);
+    std::vector<xla::int64> limit_indices(input_shape.rank(), 1);
+    limit_indices[kFeatureIndex] = num_features;
+    std::vector<xla::int64> strides(input_shape.rank(), 1);
+    shift = xla::Reshape(
+        xla::Slice(acc_input, start_indices, limit_indices, strides),
+        {num_features});
+  }
+  xla::XlaOp centered = acc_input - BroadcastFeatures(shift, input_shape);
+  xla::XlaOp sum = SumFeatures(centered, reduce_dims);
+  xla::XlaOp sum_squares = SumFeatures(centered * centered, reduce_dims);
+  xla::int64 local_count =
+      xla::ShapeUtil::ElementsIn(input_shape) / num_features;
+  xla::XlaOp count = XlaHelpers::ScalarValue<xla::int64>(
+      local_count, accumulation_type, builder);
+  if (sync) {
+    count = xla::Reshape(
+        CrossReplicaSumFeatures({&sum, &sum_squares}, local_count), {});
+  }
+  xla::XlaOp shifted_mean = sum / count;
+  // Clamp the (biased) variance, which could get slightly negative due to
+  // rounding errors.
+  xla::XlaOp variance =
+      xla::Max(sum_squares / count - shifted_mean * shifted_mean,
+               xla::Zero(builder, accumulation_type));
+  xla::XlaOp mean = shifted_mean + shift;
+  xla::XlaOp invstd = BatchNormVarianceInvert(variance, eps_value);
+  xla::XlaOp scale =
+      xla::ConvertElementType(weight, accumulation_type) * invstd;
+  xla::XlaOp offset =
+      xla::ConvertElementType(bias, accumulation_type) - mean * scale;
+  xla::XlaOp output = acc_input * BroadcastFeatures(scale, input_shape) +
+                      BroadcastFeatures(offset, input_shape);
+  return {xla::ConvertElementType(output, type),
+          xla::ConvertElementType(mean, type),
+          xla::ConvertElementType(variance, type),
+          xla::ConvertElementType(invstd, type)};
+}
+
+BatchNormGrads BuildExplicitBatchNormBackward(const xla::XlaOp& grad,
+                                              const xla::XlaOp& input,
+                                              const xla::XlaOp& weight,
+                                              const xla::XlaOp& save_mean,
+                                              const xla::XlaOp& save_invstd,
+                                              bool training) {
+  xla::XlaBuilder* builder = input.builder();
+  xla::Shape input_shape = XlaHelpers::ShapeOfXlaOp(input);
+  xla::PrimitiveType type = input_shape.element_type();
+  xla::PrimitiveType accumulation_type = GetAccumulationType(type);
+  xla::int64 num_features = input_shape.dimensions(kFeatureIndex);
+  std::vector<xla::int64> reduce_dims = GetReductionDimensions(input_shape);
+
+  xla::XlaOp acc_grad = xla::ConvertElementType(grad, accumulation_type);
+  xla::XlaOp invstd = xla::ConvertElementType(save_invstd, accumulation_type);
+  xla::XlaOp normalized =
+      (xla::ConvertElementType(input, accumulation_type) -
+       BroadcastFeatures(xla::ConvertElementType(save_mean, accumulation_type),
+                         input_shape)) *
+      BroadcastFeatures(invstd, input_shape);
+  xla::XlaOp grad_bias = SumFeatures(acc_grad, reduce_dims);
+  xla::XlaOp grad_weight = SumFeatures(acc_grad * normalized, reduce_dims);
+  xla::XlaOp scale = BroadcastFeatures(
+      xla::ConvertElementType(weight, accumulation_type) * invstd, input_shape);
+  xla::XlaOp grad_input;
+  if (training) {
+    // The weight and bias gradients stay local to the replica, while the
+    // input gradient needs the sums over the whole (global) batch.
+    xla::XlaOp sum_grad = grad_bias;
+    xla::XlaOp sum_grad_normalized = grad_weight;
+    xla::int64 local_count =
+        xla::ShapeUtil::ElementsIn(input_shape) / num_features;
+    xla::XlaOp count = XlaHelpers::ScalarValue<xla::int64>(
+        local_count, accumulation_type, builder);
+    if (UseSyncBatchNorm()) {
+      count = xla::Reshape(
+          CrossReplicaSumFeatures({&sum_grad, &sum_grad_normalized},
+                                  local_count),
+          {});
+    }
+    xla::XlaOp mean_grad = BroadcastFeatures(sum_grad / count, input_shape);
+    xla::XlaOp mean_grad_normalized =
+        BroadcastFeatures(sum_grad_normalized / count, input_shape);
+    grad_input =
+        scale * (acc_grad - mean_grad - normalized * mean_grad_normalized);
+  } else {
+    grad_input = scale * acc_grad;
+  }
+  return {xla::ConvertElementType(grad_input, type),
+          xla::ConvertElementType(grad_weight, type),
+          xla::ConvertElementType(grad_bias, type)};
+}
+
 xla::XlaOp VarianceRecover(const xla::XlaOp& invstd, float eps_value) {
   xla::XlaBuilder* builder = invstd.builder();
   xla::Shape invstd_shape = XlaHelpers::ShapeOfXlaOp(invstd);
@@ -16,8 +204,41 @@ xla::XlaOp VarianceRecover(const xla::XlaOp& invstd, float eps_value) {
   return one_over_invstd * one_over_invstd - eps;
 }
 
+xla::XlaOp BroadcastGroups(const xla::XlaOp& groups_values,
+                           const xla::Shape& groups_shape) {
+  return xla::BroadcastInDim(groups_values, groups_shape.dimensions(), {0});
+}
+
+xla::XlaOp BroadcastAffine(
+    const xla::XlaOp& value, xla::PrimitiveType type, const xla::Shape& shape,
+    tensorflow::gtl::ArraySlice<const xla::int64> affine_dims) {
+  return xla::BroadcastInDim(xla::ConvertElementType(value, type),
+                             shape.dimensions(), affine_dims);
+}
+
+// The input dimensions the affine parameters do not span, over which their
+// gradients are reduced.
+std::vector<xla::int64> GetAffineReductionDimensions(
+    const xla::Shape& shape,
+    tensorflow::gtl::ArraySlice<const xla::int64> affine_dims) {
+  std::vector<xla::int64> dimensions;
+  for (xla::int64 i = 0; i < shape.rank(); ++i) {
+    if (std::find(affine_dims.begin(), affine_dims.end(), i) ==
+        affine_dims.end()) {
+      dimensions.push_back(i);
+    }
+  }
+  return dimensions;
+}
+
 }  // namespace
 
+bool UseSyncBatchNorm() {
+  static const bool sync_batch_norm =
+      xla::sys_util::GetEnvBool("XLA_SYNC_BATCH_NORM", false);
+  return sync_batch_norm;
+}
+
 xla::XlaOp BatchNormVarianceInvert(const xla::XlaOp& variance,
                                    float eps_value) {
   xla::XlaBuilder* builder = variance.builder();
@@ -33,19 +254,23 @@ BatchNormOutput BuildBatchNormTraining(const xla::XlaOp& input,
                                        const xla::XlaOp& weight,
                                        const xla::XlaOp& bias,
                                        float eps_value) {
+  if (UseExplicitBatchNorm()) {
+    return BuildExplicitBatchNormTraining(input, weight, bias, eps_value);
+  }
   xla::XlaOp outputs =
-      xla::BatchNormTraining(input, weight, bias, eps_value, 1);
+      xla::BatchNormTraining(input, weight, bias, eps_value, kFeatureIndex);
   xla::XlaOp output = xla::GetTupleElement(outputs, 0);
   xla::XlaOp batch_mean = xla::GetTupleElement(outputs, 1);
   xla::XlaOp batch_variance = xla::GetTupleElement(outputs, 2);
-  return {output, batch_mean, batch_variance};
+  return {output, batch_mean, batch_variance,
+          BatchNormVarianceInvert(batch_variance, eps_value)};
 }
 
 xla::XlaOp BuildBatchNormInference(
     const xla::XlaOp& input, const xla::XlaOp& weight, const xla::XlaOp& bias,
     const xla::XlaOp& mean, const xla::XlaOp& variance, float eps_value) {
   return xla::BatchNormInference(input, weight, bias, mean, variance, eps_value,
-                                 1);
+                                 kFeatureIndex);
 }
 
 BatchNormGrads BuildBatchNormBackward(const xla::XlaOp& grad,
@@ -54,13 +279,110 @@ BatchNormGrads BuildBatchNormBackward(const xla::XlaOp& grad,
                                       const xla::XlaOp& save_mean,
                                       const xla::XlaOp& save_invstd,
                                       bool training, float eps_value) {
+  if (UseExplicitBatchNorm()) {
+    // Uses the saved inverse of the standard deviation as is, without the
+    // round trip to the variance required by xla::BatchNormGrad().
+    return BuildExplicitBatchNormBackward(grad, input, weight, save_mean,
+                                          save_invstd, training);
+  }
   xla::XlaOp grads = xla::BatchNormGrad(input, weight, save_mean,
                                         VarianceRecover(save_invstd, eps_value),
-                                        grad, eps_value, 1);
+                                        grad, eps_value, kFeatureIndex);
   xla::XlaOp grad_input = xla::GetTupleElement(grads, 0);
   xla::XlaOp grad_weight = xla::GetTupleElement(grads, 1);
   xla::XlaOp grad_bias = xla::GetTupleElement(grads, 2);
   return {grad_input, grad_weight, grad_bias};
 }
 
+GroupNormOutput BuildGroupNorm(
+    const xla::XlaOp& input, const xla::XlaOp& weight, const xla::XlaOp& bias,
+    xla::int64 num_groups,
+    tensorflow::gtl::ArraySlice<const xla::int64> affine_dims,
+    float eps_value) {
+  xla::XlaBuilder* builder = input.builder();
+  xla::Shape input_shape = XlaHelpers::ShapeOfXlaOp(input);
+  xla::PrimitiveType type = input_shape.element_type();
+  xla::PrimitiveType accumulation_type = GetAccumulationType(type);
+  xla::int64 group_size = xla::ShapeUtil::ElementsIn(input_shape) / num_groups;
+  xla::Shape groups_shape =
+      xla::ShapeUtil::MakeShape(accumulation_type, {num_groups, group_size});
+
+  xla::XlaOp groups =
+      xla::Reshape(xla::ConvertElementType(input, accumulation_type),
+                   {num_groups, group_size});
+  // Like for the explicit batch norm, the moments are computed on the groups
+  // shifted by their first element.
+  xla::XlaOp shift =
+      xla::Reshape(xla::SliceInDim(groups, 0, 1, 1, 1), {num_groups});
+  xla::XlaOp centered = groups - BroadcastGroups(shift, groups_shape);
+  xla::XlaOp sum = SumFeatures(centered, {1});
+  xla::XlaOp sum_squares = SumFeatures(centered * centered, {1});
+  xla::XlaOp count = XlaHelpers::ScalarValue<xla::int64>(
+      group_size, accumulation_type, builder);
+  xla::XlaOp shifted_mean = sum / count;
+  xla::XlaOp variance =
+      xla::Max(sum_squares / count - shifted_mean * shifted_mean,
+               xla::Zero(builder, accumulation_type));
+  xla::XlaOp mean = shifted_mean + shift;
+  xla::XlaOp rstd = BatchNormVarianceInvert(variance, eps_value);
+  xla::XlaOp normalized =
+      xla::Reshape((groups - BroadcastGroups(mean, groups_shape)) *
+                       BroadcastGroups(rstd, groups_shape),
+                   input_shape.dimensions());
+  xla::XlaOp output =
+      normalized *
+          BroadcastAffine(weight, accumulation_type, input_shape,
+                          affine_dims) +
+      BroadcastAffine(bias, accumulation_type, input_shape, affine_dims);
+  return {xla::ConvertElementType(output, type),
+          xla::ConvertElementType(mean, type),
+          xla::ConvertElementType(rstd, type)};
+}
+
+BatchNormGrads BuildGroupNormBackward(
+    const xla::XlaOp& grad, const xla::XlaOp& input, const xla::XlaOp& weight,
+    const xla::XlaOp& mean, const xla::XlaOp& rstd, xla::int64 num_groups,
+    tensorflow::gtl::ArraySlice<const xla::int64> affine_dims) {
+  xla::XlaBuilder* builder = input.builder();
+  xla::Shape input_shape = XlaHelpers::ShapeOfXlaOp(input);
+  xla::PrimitiveType type = input_shape.element_type();
+  xla::PrimitiveType accumulation_type = GetAccumulationType(type);
+  xla::int64 group_size = xla::ShapeUtil::ElementsIn(input_shape) / num_groups;
+  xla::Shape groups_shape =
+      xla::ShapeUtil::MakeShape(accumulation_type, {num_groups, group_size});
+  std::vector<xla::int64> reduce_dims =
+      GetAffineReductionDimensions(input_shape, affine_dims);
+
+  xla::XlaOp acc_grad = xla::ConvertElementType(grad, accumulation_type);
+  xla::XlaOp acc_rstd = BroadcastGroups(
+      xla::ConvertElementType(rstd, accumulation_type), groups_shape);
+  xla::XlaOp normalized =
+      (xla::Reshape(xla::ConvertElementType(input, accumulation_type),
+                    {num_groups, group_size}) -
+       BroadcastGroups(xla::ConvertElementType(mean, accumulation_type),
+                       groups_shape)) *
+      acc_rstd;
+  xla::XlaOp grad_bias = SumFeatures(acc_grad, reduce_dims);
+  xla::XlaOp grad_weight = SumFeatures(
+      acc_grad * xla::Reshape(normalized, input_shape.dimensions()),
+      reduce_dims);
+  xla::XlaOp scaled_grad = xla::Reshape(
+      acc_grad *
+          BroadcastAffine(weight, accumulation_type, input_shape, affine_dims),
+      {num_groups, group_size});
+  xla::XlaOp count = XlaHelpers::ScalarValue<xla::int64>(
+      group_size, accumulation_type, builder);
+  xla::XlaOp mean_grad = SumFeatures(scaled_grad, {1}) / count;
+  xla::XlaOp mean_grad_normalized =
+      SumFeatures(scaled_grad * normalized, {1}) / count;
+  xla::XlaOp grad_input =
+      acc_rstd * (scaled_grad - BroadcastGroups(mean_grad, groups_shape) -
+                  normalized * BroadcastGroups(mean_grad_normalized,
+                                               groups_shape));
+  return {xla::ConvertElementType(
+              xla::Reshape(grad_input, input_shape.dimensions()), type),
+          xla::ConvertElementType(grad_weight, type),
+          xla::ConvertElementType(grad_bias, type)};
+}
+
 }  // namespace torch_xla
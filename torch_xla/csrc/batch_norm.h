@@ -1,6 +1,7 @@
 #pragma once
 
 #include "tensorflow/compiler/xla/client/xla_builder.h"
+#include "tensorflow/core/lib/gtl/array_slice.h"
 
 namespace torch_xla {
 
@@ -8,6 +9,7 @@ struct BatchNormOutput {
   xla::XlaOp output;
   xla::XlaOp batch_mean;
   xla::XlaOp batch_variance;
+  xla::XlaOp batch_invstd;
 };
 
 struct BatchNormGrads {
@@ -16,6 +18,17 @@ struct BatchNormGrads {
   xla::XlaOp grad_bias;
 };
 
+struct GroupNormOutput {
+  xla::XlaOp output;
+  xla::XlaOp mean;
+  xla::XlaOp rstd;
+};
+
+// Whether the batch norm training statistics (and the related backward
+// reductions) are computed over the global batch of all the replicas
+// (XLA_SYNC_BATCH_NORM).
+bool UseSyncBatchNorm();
+
 xla::XlaOp BatchNormVarianceInvert(const xla::XlaOp& variance, float eps_value);
 
 BatchNormOutput BuildBatchNormTraining(const xla::XlaOp& input,
@@ -35,4 +48,22 @@ BatchNormGrads BuildBatchNormBackward(const xla::XlaOp& grad,
                                       const xla::XlaOp& save_invstd,
                                       bool training, float eps_value);
 
+// Normalizes the input with the statistics of num_groups equally sized groups
+// of consecutive elements (the rows of the normalized dimensions for the layer
+// norm, the channel groups of every sample for the group and instance norms),
+// computed with a single pass over the input. The weight and bias are
+// broadcast to the input along affine_dims.
+GroupNormOutput BuildGroupNorm(
+    const xla::XlaOp& input, const xla::XlaOp& weight, const xla::XlaOp& bias,
+    xla::int64 num_groups,
+    tensorflow::gtl::ArraySlice<const xla::int64> affine_dims,
+    float eps_value);
+
+// The gradients of BuildGroupNorm(), which only need the saved per group mean
+// and inverse standard deviation besides the input.
+BatchNormGrads BuildGroupNormBackward(
+    const xla::XlaOp& grad, const xla::XlaOp& input, const xla::XlaOp& weight,
+    const xla::XlaOp& mean, const xla::XlaOp& rstd, xla::int64 num_groups,
+    tensorflow::gtl::ArraySlice<const xla::int64> affine_dims);
+
 }  // namespace torch_xla
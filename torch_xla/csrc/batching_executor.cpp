@@ -0,0 +1,170 @@
+#include "torch_xla/csrc/batching_executor.h"
+
+#include <chrono>
+#include <exception>
+
+#include "absl/strings/str_join.h"
+#include "tensorflow/compiler/xla/xla_client/debug_macros.h"
+#include "tensorflow/compiler/xla/xla_client/metrics.h"
+#include "tensorflow/compiler/xla/xla_client/sys_util.h"
+#include "tensorflow/compiler/xla/xla_client/thread_pool.h"
+
+namespace torch_xla {
+
+BatchingExecutor::BatchingExecutor(
+    std::map<int64_t, std::shared_ptr<ExecutionPlan>> plans,
+    int64_t max_delay_ns)
+    : plans_(std::move(plans)), max_delay_ns_(max_delay_ns) {
+  XLA_CHECK(!plans_.empty()) << "A batching executor needs at least one plan";
+  XLA_CHECK_GE(max_delay_ns_, 0);
+  const ExecutionPlan& first_plan = *plans_.begin()->second;
+  for (auto& size_plan : plans_) {
+    const ExecutionPlan& plan = *size_plan.second;
+    XLA_CHECK_GT(size_plan.first, 0);
+    XLA_CHECK_EQ(plan.num_inputs(), first_plan.num_inputs());
+    for (size_t i = 0; i < plan.num_inputs(); ++i) {
+      const std::vector<int64_t>& sizes = plan.input_sizes(i);
+      XLA_CHECK(!sizes.empty() && sizes[0] == size_plan.first)
+          << "The input " << i << " of the plan for batch size "
+          << size_plan.first << " has wrong sizes: ["
+          << absl::StrJoin(sizes, ", ") << "]";
+      XLA_CHECK_EQ(plan.input_type(i), first_plan.input_type(i));
+    }
+  }
+  max_batch_size_ = plans_.rbegin()->first;
+  scheduler_ = std::thread([this]() { Schedule(); });
+}
+
+BatchingExecutor::~BatchingExecutor() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    closed_ = true;
+    cv_.notify_all();
+  }
+  scheduler_.join();
+  std::unique_lock<std::mutex> lock(mutex_);
+  cv_.wait(lock, [this] { return running_batches_ == 0; });
+}
+
+BatchingExecutor::ResultFuture BatchingExecutor::Submit(
+    std::vector<at::Tensor> inputs) {
+  const ExecutionPlan& plan = *plans_.begin()->second;
+  XLA_CHECK_EQ(inputs.size(), plan.num_inputs());
+  XLA_CHECK(!inputs.empty()) << "Cannot batch requests without inputs";
+  Request request;
+  request.rows = inputs[0].dim() > 0 ? inputs[0].size(0) : 0;
+  XLA_CHECK(request.rows > 0 && request.rows <= max_batch_size_)
+      << "The requests must have between 1 and " << max_batch_size_
+      << " rows: " << request.rows;
+  for (size_t i = 0; i < inputs.size(); ++i) {
+    const std::vector<int64_t>& sizes = plan.input_sizes(i);
+    at::IntArrayRef input_sizes = inputs[i].sizes();
+    XLA_CHECK_EQ(inputs[i].scalar_type(), plan.input_type(i))
+        << "Wrong type for input " << i;
+    XLA_CHECK(input_sizes.size() == sizes.size() &&
+              input_sizes[0] == request.rows &&
+              input_sizes.slice(1).equals(at::IntArrayRef(sizes).slice(1)))
+        << "Wrong sizes for input " << i << ": ["
+        << absl::StrJoin(input_sizes, ", ") << "] vs. [" << request.rows
+        << ", " << absl::StrJoin(at::IntArrayRef(sizes).slice(1), ", ")
+        << "]";
+  }
+  request.inputs = std::move(inputs);
+  request.deadline_ns = xla::sys_util::NowNs() + max_delay_ns_;
+  ResultFuture future = request.promise.GetFuture();
+  std::lock_guard<std::mutex> lock(mutex_);
+  XLA_CHECK(!closed_) << "The batching executor is closed";
+  queued_rows_ += request.rows;
+  requests_.push_back(std::move(request));
+  cv_.notify_all();
+  return future;
+}
+
+void BatchingExecutor::Schedule() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    cv_.wait(lock, [this] { return closed_ || !requests_.empty(); });
+    if (requests_.empty()) {
+      break;
+    }
+    // Waits for more requests, until the largest batch fills up or the oldest
+    // request runs out of time. Once closed, the queue is drained right away.
+    while (!closed_ && queued_rows_ < max_batch_size_) {
+      int64_t wait_ns = requests_.front().deadline_ns - xla::sys_util::NowNs();
+      if (wait_ns <= 0) {
+        break;
+      }
+      cv_.wait_for(lock, std::chrono::nanoseconds(wait_ns));
+    }
+    auto batch = std::make_shared<std::vector<Request>>();
+    int64_t rows = 0;
+    while (!requests_.empty() &&
+           rows + requests_.front().rows <= max_batch_size_) {
+      rows += requests_.front().rows;
+      batch->push_back(std::move(requests_.front()));
+      requests_.pop_front();
+    }
+    queued_rows_ -= rows;
+    ++running_batches_;
+    xla::env::ScheduleIoClosure([this, batch, rows]() {
+      RunBatch(batch.get(), rows);
+      std::lock_guard<std::mutex> lock(mutex_);
+      --running_batches_;
+      cv_.notify_all();
+    });
+  }
+}
+
+void BatchingExecutor::RunBatch(std::vector<Request>* requests, int64_t rows) {
+  XLA_TIMED("BatchingExecutorRun");
+  try {
+    auto it = plans_.lower_bound(rows);
+    XLA_CHECK(it != plans_.end());
+    const ExecutionPlan& plan = *it->second;
+    int64_t padding = it->first - rows;
+    if (padding > 0) {
+      XLA_COUNTER("BatchingExecutorPaddedRows", padding);
+    }
+    std::vector<at::Tensor> inputs;
+    inputs.reserve(plan.num_inputs());
+    for (size_t i = 0; i < plan.num_inputs(); ++i) {
+      std::vector<at::Tensor> parts;
+      parts.reserve(requests->size() + 1);
+      for (auto& request : *requests) {
+        parts.push_back(request.inputs[i]);
+      }
+      if (padding > 0) {
+        std::vector<int64_t> sizes(plan.input_sizes(i));
+        sizes[0] = padding;
+        parts.push_back(at::zeros(sizes, parts.front().options()));
+      }
+      inputs.push_back(parts.size() == 1 ? parts.front().contiguous()
+                                         : at::cat(parts, 0));
+    }
+    std::vector<XLATensor> xla_outputs = plan.Execute(inputs);
+    std::vector<at::Tensor> outputs = XLATensor::GetTensors(&xla_outputs);
+    for (size_t i = 0; i < outputs.size(); ++i) {
+      XLA_CHECK(outputs[i].dim() > 0 && outputs[i].size(0) == it->first)
+          << "The output " << i << " of the plan for batch size "
+          << it->first << " is not batched: ["
+          << absl::StrJoin(outputs[i].sizes(), ", ") << "]";
+    }
+    int64_t offset = 0;
+    for (auto& request : *requests) {
+      std::vector<at::Tensor> results;
+      results.reserve(outputs.size());
+      for (auto& output : outputs) {
+        results.push_back(output.narrow(0, offset, request.rows));
+      }
+      offset += request.rows;
+      request.promise.SetValue(std::move(results));
+    }
+  } catch (...) {
+    std::exception_ptr exptr = std::current_exception();
+    for (auto& request : *requests) {
+      request.promise.SetException(exptr);
+    }
+  }
+}
+
+}  // namespace torch_xla
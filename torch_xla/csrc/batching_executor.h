@@ -0,0 +1,73 @@
+#pragma once
+
+#include <ATen/ATen.h>
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "tensorflow/compiler/xla/xla_client/future.h"
+#include "torch_xla/csrc/execution_plan.h"
+
+namespace torch_xla {
+
+// Groups concurrent inference requests into batches, which are run by
+// execution plans compiled for a few batch sizes. The inputs and outputs of the
+// plans are batched along their first dimension. A batch is formed once enough
+// rows are queued to fill the largest plan, or once the oldest queued request
+// has waited max_delay_ns nanoseconds. The batch is then padded with zero rows
+// to the smallest plan batch size which fits it, run as a single computation,
+// and its outputs are split back among the requests. The batches run on the IO
+// thread pool, so that the next batch can be formed while the current one
+// executes.
+class BatchingExecutor {
+ public:
+  using ResultFuture = xla::util::Future<std::vector<at::Tensor>>;
+
+  // The plans are keyed by their batch size, and all must have the same
+  // inputs, other than for the size of their first dimension.
+  BatchingExecutor(std::map<int64_t, std::shared_ptr<ExecutionPlan>> plans,
+                   int64_t max_delay_ns);
+
+  BatchingExecutor(const BatchingExecutor&) = delete;
+
+  BatchingExecutor& operator=(const BatchingExecutor&) = delete;
+
+  // Runs the queued requests, and waits for the batches in flight.
+  ~BatchingExecutor();
+
+  // Queues a request, whose host inputs all have the same number of rows (size
+  // of the first dimension), up to the largest plan batch size. Returns the
+  // future of the host tensors of the outputs of the request rows.
+  ResultFuture Submit(std::vector<at::Tensor> inputs);
+
+ private:
+  struct Request {
+    std::vector<at::Tensor> inputs;
+    int64_t rows = 0;
+    int64_t deadline_ns = 0;
+    xla::util::Promise<std::vector<at::Tensor>> promise;
+  };
+
+  void Schedule();
+
+  void RunBatch(std::vector<Request>* requests, int64_t rows);
+
+  std::map<int64_t, std::shared_ptr<ExecutionPlan>> plans_;
+  int64_t max_batch_size_ = 0;
+  int64_t max_delay_ns_ = 0;
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::deque<Request> requests_;
+  int64_t queued_rows_ = 0;
+  size_t running_batches_ = 0;
+  bool closed_ = false;
+  std::thread scheduler_;
+};
+
+}  // namespace torch_xla
@@ -0,0 +1,148 @@
+#include "torch_xla/csrc/bounded_ops.h"
+
+#include "tensorflow/compiler/xla/client/lib/arithmetic.h"
+#include "tensorflow/compiler/xla/client/lib/comparators.h"
+#include "tensorflow/compiler/xla/client/lib/constants.h"
+#include "tensorflow/compiler/xla/client/lib/slicing.h"
+#include "tensorflow/compiler/xla/shape_util.h"
+#include "tensorflow/compiler/xla/xla_client/util.h"
+#include "torch_xla/csrc/helpers.h"
+#include "torch_xla/csrc/tensor_util.h"
+#include "torch_xla/csrc/xla_lower_util.h"
+
+namespace torch_xla {
+namespace {
+
+struct Compaction {
+  // The positions of the true elements of the mask, in order, followed by the
+  // ones of the false elements.
+  xla::XlaOp positions;
+  // The number of true elements, as S32 scalar.
+  xla::XlaOp count;
+  // Whether every slot of the compacted result is within the count.
+  xla::XlaOp valid;
+};
+
+// Compacts the positions of the true elements of the 1D mask to the front,
+// with a single sort of the positions, keyed to move the false ones last.
+Compaction CompactMask(const xla::XlaOp& mask) {
+  xla::XlaBuilder* builder = mask.builder();
+  xla::int64 size = XlaHelpers::ShapeOfXlaOp(mask).dimensions(0);
+  xla::XlaOp iota = xla::Iota(builder, xla::PrimitiveType::S32, size);
+  xla::XlaOp xla_size = XlaHelpers::ScalarValue<xla::int32>(size, builder);
+  xla::XlaOp keys = xla::Select(mask, iota, iota + xla_size);
+  xla::XlaOp sorted_keys = xla::Sort(
+      {keys}, xla::CreateScalarLtComputation({xla::PrimitiveType::S32},
+                                             builder));
+  xla::XlaOp count = xla::ReduceAll(
+      xla::ConvertElementType(mask, xla::PrimitiveType::S32),
+      xla::Zero(builder, xla::PrimitiveType::S32),
+      xla::CreateScalarAddComputation(xla::PrimitiveType::S32, builder));
+  return {xla::Rem(sorted_keys, xla_size), count, xla::Lt(iota, count)};
+}
+
+xla::XlaOp ZeroPadding(const xla::XlaOp& valid, const xla::XlaOp& values) {
+  xla::Shape values_shape = XlaHelpers::ShapeOfXlaOp(values);
+  xla::XlaOp zeros = xla::Broadcast(
+      xla::Zero(values.builder(), values_shape.element_type()),
+      values_shape.dimensions());
+  if (values_shape.rank() > 1) {
+    return xla::Select(
+        xla::BroadcastInDim(valid, values_shape.dimensions(), {0}), values,
+        zeros);
+  }
+  return xla::Select(valid, values, zeros);
+}
+
+xla::XlaOp MakeCount(const xla::XlaOp& count) {
+  return xla::ConvertElementType(
+      count, GetDevicePrimitiveType(xla::PrimitiveType::S64,
+                                    /*device=*/nullptr));
+}
+
+xla::XlaOp Flatten(const xla::XlaOp& input, const xla::Shape& shape) {
+  return xla::Reshape(input, {xla::ShapeUtil::ElementsIn(shape)});
+}
+
+}  // namespace
+
+std::vector<xla::XlaOp> BuildNonZeroBounded(const xla::XlaOp& input) {
+  xla::XlaBuilder* builder = input.builder();
+  xla::Shape shape = XlaHelpers::ShapeOfXlaOp(input);
+  xla::int64 size = xla::ShapeUtil::ElementsIn(shape);
+  xla::PrimitiveType index_type =
+      GetDevicePrimitiveType(xla::PrimitiveType::S64, /*device=*/nullptr);
+  xla::XlaOp zero = xla::Zero(builder, shape.element_type());
+  if (size == 0 || shape.rank() == 0) {
+    // With no dimensions the indices are empty rows, and only the count of
+    // the scalar matters.
+    xla::XlaOp count =
+        size == 0 ? xla::Zero(builder, xla::PrimitiveType::S32)
+                  : xla::ConvertElementType(xla::Ne(input, zero),
+                                            xla::PrimitiveType::S32);
+    return {xla::Broadcast(xla::Zero(builder, index_type),
+                           {size, shape.rank()}),
+            MakeCount(count)};
+  }
+  xla::XlaOp flat = Flatten(input, shape);
+  Compaction compaction = CompactMask(xla::Ne(flat, zero));
+  xla::XlaOp positions =
+      xla::ConvertElementType(compaction.positions, index_type);
+  std::vector<xla::XlaOp> coordinates;
+  xla::int64 stride = size;
+  for (xla::int64 dim = 0; dim < shape.rank(); ++dim) {
+    xla::int64 dim_size = shape.dimensions(dim);
+    stride /= dim_size;
+    xla::XlaOp coordinate = xla::Rem(
+        xla::Div(positions, XlaHelpers::ScalarValue<xla::int64>(
+                                stride, index_type, builder)),
+        XlaHelpers::ScalarValue<xla::int64>(dim_size, index_type, builder));
+    coordinates.push_back(xla::Reshape(coordinate, {size, 1}));
+  }
+  xla::XlaOp indices = xla::ConcatInDim(builder, coordinates, 1);
+  return {ZeroPadding(compaction.valid, indices), MakeCount(compaction.count)};
+}
+
+std::vector<xla::XlaOp> BuildMaskedSelectBounded(const xla::XlaOp& input,
+                                                 const xla::XlaOp& mask) {
+  std::vector<xla::XlaOp> operands = CreateBroadcastTensors({input, mask});
+  xla::Shape shape = XlaHelpers::ShapeOfXlaOp(operands[0]);
+  xla::XlaOp flat = Flatten(operands[0], shape);
+  if (xla::ShapeUtil::ElementsIn(shape) == 0) {
+    return {flat, MakeCount(xla::Zero(input.builder(),
+                                      xla::PrimitiveType::S32))};
+  }
+  xla::XlaOp flat_mask = xla::ConvertElementType(
+      Flatten(operands[1], shape), xla::PrimitiveType::PRED);
+  Compaction compaction = CompactMask(flat_mask);
+  xla::XlaOp values = xla::TorchIndexSelect(flat, compaction.positions, 0);
+  return {ZeroPadding(compaction.valid, values), MakeCount(compaction.count)};
+}
+
+std::vector<xla::XlaOp> BuildUniqueBounded(const xla::XlaOp& input) {
+  xla::XlaBuilder* builder = input.builder();
+  xla::Shape shape = XlaHelpers::ShapeOfXlaOp(input);
+  xla::int64 size = xla::ShapeUtil::ElementsIn(shape);
+  xla::XlaOp flat = Flatten(input, shape);
+  if (size == 0) {
+    return {flat, MakeCount(xla::Zero(builder, xla::PrimitiveType::S32))};
+  }
+  xla::XlaOp sorted = xla::Sort(
+      {flat}, xla::CreateScalarLtComputation({shape.element_type()}, builder));
+  // An element is the first of its run if it differs from the previous one.
+  // The first element is compared with itself, and is forced to true.
+  xla::XlaOp previous = xla::ConcatInDim(
+      builder,
+      {xla::SliceInDim(sorted, 0, 1, 1, 0),
+       xla::SliceInDim(sorted, 0, size - 1, 1, 0)},
+      0);
+  xla::XlaOp iota = xla::Iota(builder, xla::PrimitiveType::S32, size);
+  xla::XlaOp first = xla::Or(
+      xla::Ne(sorted, previous),
+      xla::Eq(iota, xla::Zero(builder, xla::PrimitiveType::S32)));
+  Compaction compaction = CompactMask(first);
+  xla::XlaOp values = xla::TorchIndexSelect(sorted, compaction.positions, 0);
+  return {ZeroPadding(compaction.valid, values), MakeCount(compaction.count)};
+}
+
+}  // namespace torch_xla
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <vector>
+
+#include "tensorflow/compiler/xla/client/xla_builder.h"
+
+namespace torch_xla {
+
+// The lowerings of the data-dependent ops below produce bounded shapes: the
+// result is padded (with zeros) to the largest size it can have, and is
+// followed by the S64 scalar count of its valid leading rows, so that the ops
+// run on device and never need the actual size on the host.
+
+// Returns the [N, rank] indices of the non-zero elements of input (where N is
+// the number of elements of input) in row-major order, and their count.
+std::vector<xla::XlaOp> BuildNonZeroBounded(const xla::XlaOp& input);
+
+// Returns the [N] elements of input where mask (broadcast with input) is true,
+// where N is the number of elements of the broadcast shape, and their count.
+std::vector<xla::XlaOp> BuildMaskedSelectBounded(const xla::XlaOp& input,
+                                                 const xla::XlaOp& mask);
+
+// Returns the [N] unique elements of input in ascending order, where N is the
+// number of elements of input, and their count.
+std::vector<xla::XlaOp> BuildUniqueBounded(const xla::XlaOp& input);
+
+}  // namespace torch_xla
@@ -0,0 +1,212 @@
+#include "torch_xla/csrc/cache_miss_explainer.h"
+
+#include <algorithm>
+#include <sstream>
+#include <unordered_map>
+
+#include "tensorflow/compiler/xla/xla_client/metrics.h"
+#include "tensorflow/compiler/xla/xla_client/sys_util.h"
+#include "tensorflow/compiler/xla/xla_client/tf_logging.h"
+#include "tensorflow/compiler/xla/xla_client/util.h"
+#include "tensorflow/compiler/xla/xla_client/xla_util.h"
+#include "torch_xla/csrc/ir_util.h"
+
+namespace torch_xla {
+namespace {
+
+// The number of recently compiled graphs the new ones are compared with.
+size_t GetMaxFingerprints() {
+  static size_t max_fingerprints =
+      xla::sys_util::GetEnvInt("XLA_EXPLAIN_CACHE_MISSES_GRAPHS", 16);
+  return max_fingerprints;
+}
+
+// The maximum number of differing nodes listed by an explanation, in each
+// direction.
+size_t GetMaxNodes() {
+  static size_t max_nodes =
+      xla::sys_util::GetEnvInt("XLA_EXPLAIN_CACHE_MISSES_NODES", 8);
+  return max_nodes;
+}
+
+const size_t kMaxExplanations = 64;
+
+size_t GetLocalKey(const ir::Node* node) {
+  return xla::util::HashCombine(node->node_hash(),
+                                xla::util::ShapeHash(node->shape()));
+}
+
+using KeyCounts = std::unordered_map<size_t, size_t>;
+
+template <typename T>
+KeyCounts GetKeyCounts(const T& nodes) {
+  KeyCounts counts;
+  for (auto& node : nodes) {
+    ++counts[node.key];
+  }
+  return counts;
+}
+
+// Returns the nodes of the first vector whose keys are not matched by the ones
+// within the counts, up to max_nodes of them.
+template <typename T>
+std::vector<const T*> GetUnmatchedNodes(const std::vector<T>& nodes,
+                                        KeyCounts counts, size_t max_nodes) {
+  std::vector<const T*> unmatched;
+  for (auto& node : nodes) {
+    auto it = counts.find(node.key);
+    if (it != counts.end() && it->second > 0) {
+      --it->second;
+    } else if (unmatched.size() < max_nodes) {
+      unmatched.push_back(&node);
+    }
+  }
+  return unmatched;
+}
+
+}  // namespace
+
+CacheMissExplainer* CacheMissExplainer::Get() {
+  static CacheMissExplainer* explainer = new CacheMissExplainer();
+  return explainer;
+}
+
+bool CacheMissExplainer::IsEnabled() {
+  static const bool enabled =
+      xla::sys_util::GetEnvBool("XLA_EXPLAIN_CACHE_MISSES", false);
+  return enabled;
+}
+
+std::string CacheMissExplainer::ExplainMiss(
+    size_t hash, tensorflow::gtl::ArraySlice<const ir::Node* const> roots) {
+  std::shared_ptr<Fingerprint> fingerprint = CreateFingerprint(hash, roots);
+  std::deque<std::shared_ptr<Fingerprint>> fingerprints;
+  {
+    std::lock_guard<std::mutex> lock(lock_);
+    fingerprints = fingerprints_;
+  }
+  // The nearest graph is the one with the highest Jaccard similarity of the
+  // node keys multisets.
+  const Fingerprint* nearest = nullptr;
+  double similarity = 0.0;
+  KeyCounts counts = GetKeyCounts(fingerprint->nodes);
+  for (auto& cached : fingerprints) {
+    if (cached->hash == hash) {
+      // The graph itself was compiled recently.
+      nearest = cached.get();
+      similarity = 1.0;
+      break;
+    }
+    KeyCounts cached_counts = GetKeyCounts(cached->nodes);
+    size_t matched = 0;
+    for (auto& key_count : counts) {
+      auto it = cached_counts.find(key_count.first);
+      if (it != cached_counts.end()) {
+        matched += std::min(key_count.second, it->second);
+      }
+    }
+    size_t total =
+        fingerprint->nodes.size() + cached->nodes.size() - matched;
+    double cached_similarity =
+        total > 0 ? static_cast<double>(matched) / total : 1.0;
+    if (nearest == nullptr || cached_similarity > similarity) {
+      nearest = cached.get();
+      similarity = cached_similarity;
+    }
+  }
+  std::string explanation = Explain(*fingerprint, nearest, similarity);
+  XLA_COUNTER("CacheMissExplanations", 1);
+  TF_LOG(INFO) << explanation;
+
+  std::lock_guard<std::mutex> lock(lock_);
+  fingerprints_.push_back(std::move(fingerprint));
+  while (fingerprints_.size() > GetMaxFingerprints()) {
+    fingerprints_.pop_front();
+  }
+  explanations_.push_back(explanation);
+  while (explanations_.size() > kMaxExplanations) {
+    explanations_.pop_front();
+  }
+  return explanation;
+}
+
+std::vector<std::string> CacheMissExplainer::GetExplanations() const {
+  std::lock_guard<std::mutex> lock(lock_);
+  return std::vector<std::string>(explanations_.begin(), explanations_.end());
+}
+
+void CacheMissExplainer::Clear() {
+  std::lock_guard<std::mutex> lock(lock_);
+  fingerprints_.clear();
+  explanations_.clear();
+}
+
+std::shared_ptr<CacheMissExplainer::Fingerprint>
+CacheMissExplainer::CreateFingerprint(
+    size_t hash, tensorflow::gtl::ArraySlice<const ir::Node* const> roots) {
+  auto fingerprint = std::make_shared<Fingerprint>();
+  fingerprint->hash = hash;
+  fingerprint->num_roots = roots.size();
+  for (auto node : ir::Util::ComputePostOrder(roots)) {
+    // Covering the operands keys as well catches the nodes which got wired
+    // differently, while keeping the change local to its direct users.
+    NodeInfo info;
+    info.key = GetLocalKey(node);
+    for (auto& operand : node->operands()) {
+      info.key = xla::util::HashCombine(
+          info.key,
+          xla::util::HashCombine(GetLocalKey(operand.node), operand.index));
+    }
+    info.text = node->ToString();
+    info.frames = node->metadata().frame_info;
+    fingerprint->nodes.push_back(std::move(info));
+  }
+  return fingerprint;
+}
+
+std::string CacheMissExplainer::Explain(const Fingerprint& fingerprint,
+                                        const Fingerprint* nearest,
+                                        double similarity) {
+  std::stringstream ss;
+  ss << "Computation cache miss for graph " << std::hex << fingerprint.hash
+     << std::dec << " (" << fingerprint.nodes.size() << " nodes, "
+     << fingerprint.num_roots << " outputs)\n";
+  if (nearest == nullptr) {
+    ss << "  No recently compiled graph to compare with\n";
+    return ss.str();
+  }
+  if (nearest->hash == fingerprint.hash) {
+    ss << "  The graph was compiled before, and evicted from the cache\n";
+    return ss.str();
+  }
+  ss << "  Nearest compiled graph: " << std::hex << nearest->hash << std::dec
+     << " (" << nearest->nodes.size() << " nodes, " << nearest->num_roots
+     << " outputs), " << static_cast<int>(similarity * 100.0)
+     << "% similar\n";
+  if (nearest->num_roots != fingerprint.num_roots) {
+    ss << "  The number of outputs changed from " << nearest->num_roots
+       << " to " << fingerprint.num_roots << "\n";
+  }
+  std::vector<const NodeInfo*> added = GetUnmatchedNodes(
+      fingerprint.nodes, GetKeyCounts(nearest->nodes), GetMaxNodes());
+  std::vector<const NodeInfo*> removed = GetUnmatchedNodes(
+      nearest->nodes, GetKeyCounts(fingerprint.nodes), GetMaxNodes());
+  if (!added.empty()) {
+    ss << "  First nodes not in the compiled graph:\n";
+    for (auto info : added) {
+      ss << "    " << info->text << "\n";
+      if (info->frames != nullptr && !info->frames->empty()) {
+        ss << *info->frames;
+      }
+    }
+  }
+  if (!removed.empty()) {
+    ss << "  First nodes of the compiled graph not in the new one:\n";
+    for (auto info : removed) {
+      ss << "    " << info->text << "\n";
+    }
+  }
+  return ss.str();
+}
+
+}  // namespace torch_xla
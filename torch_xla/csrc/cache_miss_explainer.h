@@ -0,0 +1,66 @@
+#pragma once
+
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "tensorflow/core/lib/gtl/array_slice.h"
+#include "torch_xla/csrc/ir.h"
+#include "torch_xla/csrc/python_util.h"
+
+namespace torch_xla {
+
+// Explains the misses of the XLATensor computation cache, by comparing the
+// graph which is about to be compiled with the most similar one among the
+// recently compiled graphs. The explanation lists the nodes which differ
+// between the two (like a changed shape, a different scalar constant, or an
+// extra output), with the Python frames which created them when available
+// (see XLA_IR_DEBUG).
+// Disabled by default, it can be turned on with XLA_EXPLAIN_CACHE_MISSES=1.
+class CacheMissExplainer {
+ public:
+  static CacheMissExplainer* Get();
+
+  static bool IsEnabled();
+
+  // Explains the cache miss of the graph with the given hash and roots, and
+  // records its fingerprint for the explanations of the following misses.
+  // Returns the explanation, which is also logged.
+  std::string ExplainMiss(
+      size_t hash, tensorflow::gtl::ArraySlice<const ir::Node* const> roots);
+
+  // Returns the most recent explanations, the oldest first.
+  std::vector<std::string> GetExplanations() const;
+
+  void Clear();
+
+ private:
+  struct NodeInfo {
+    // The structural key of the node, which covers its operation, its shape
+    // and the ones of its operands.
+    size_t key = 0;
+    std::string text;
+    const std::vector<SourceLocation>* frames = nullptr;
+  };
+
+  struct Fingerprint {
+    size_t hash = 0;
+    size_t num_roots = 0;
+    // The nodes of the graph, in post-order.
+    std::vector<NodeInfo> nodes;
+  };
+
+  static std::shared_ptr<Fingerprint> CreateFingerprint(
+      size_t hash, tensorflow::gtl::ArraySlice<const ir::Node* const> roots);
+
+  static std::string Explain(const Fingerprint& fingerprint,
+                             const Fingerprint* nearest, double similarity);
+
+  mutable std::mutex lock_;
+  std::deque<std::shared_ptr<Fingerprint>> fingerprints_;
+  std::deque<std::string> explanations_;
+};
+
+}  // namespace torch_xla
@@ -0,0 +1,364 @@
+#include "torch_xla/csrc/checkpoint.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <thread>
+
+#include "tensorflow/compiler/xla/literal.h"
+#include "tensorflow/compiler/xla/shape_util.h"
+#include "tensorflow/compiler/xla/xla_client/computation_client.h"
+#include "tensorflow/compiler/xla/xla_client/debug_macros.h"
+#include "tensorflow/compiler/xla/xla_client/metrics.h"
+#include "tensorflow/compiler/xla/xla_client/multi_wait.h"
+#include "tensorflow/compiler/xla/xla_client/sys_util.h"
+#include "tensorflow/compiler/xla/xla_client/thread_pool.h"
+#include "tensorflow/compiler/xla/xla_client/util.h"
+#include "torch_xla/csrc/layout_manager.h"
+#include "torch_xla/csrc/mapped_file.h"
+#include "torch_xla/csrc/tensor_util.h"
+
+namespace torch_xla {
+namespace {
+
+// The checkpoint file starts with a header made of the magic, the offset and
+// the size of the index. The tensors data follows, each one starting at an
+// offset aligned to kDataAlignment, and the index comes last. The index holds
+// the number of entries, followed by the entries themselves, each made of the
+// name, the ATen scalar type, the serialized xla::ShapeProto of the data, and
+// the data offset and size. All the integers are 64 bit, in host byte order.
+const char kMagic[8] = {'X', 'L', 'A', 'C', 'K', 'P', 'T', '1'};
+const size_t kHeaderSize = sizeof(kMagic) + 2 * sizeof(xla::uint64);
+const size_t kDataAlignment = 64;
+
+struct Entry {
+  std::string name;
+  at::ScalarType scalar_type;
+  xla::Shape shape;
+  size_t offset = 0;
+  size_t size = 0;
+};
+
+// A [start, end) range of the entries, fetched or uploaded together.
+using Chunk = std::pair<size_t, size_t>;
+
+size_t GetChunkBytes() {
+  static const size_t chunk_bytes = xla::sys_util::GetEnvInt(
+      "XLA_CHECKPOINT_CHUNK_BYTES", 64 * 1024 * 1024);
+  return chunk_bytes;
+}
+
+size_t GetNumThreads() {
+  static const size_t num_threads = std::max<size_t>(
+      xla::sys_util::GetEnvInt("XLA_CHECKPOINT_THREADS", 4), 1);
+  return num_threads;
+}
+
+size_t AlignOffset(size_t offset) {
+  return (offset + kDataAlignment - 1) / kDataAlignment * kDataAlignment;
+}
+
+// Splits the entries into consecutive chunks not bigger than GetChunkBytes().
+// Entries bigger than that get a chunk of their own.
+std::vector<Chunk> SplitChunks(const std::vector<Entry>& entries) {
+  std::vector<Chunk> chunks;
+  size_t start = 0;
+  size_t chunk_size = 0;
+  for (size_t i = 0; i < entries.size(); ++i) {
+    if (i > start && chunk_size + entries[i].size > GetChunkBytes()) {
+      chunks.emplace_back(start, i);
+      start = i;
+      chunk_size = 0;
+    }
+    chunk_size += entries[i].size;
+  }
+  if (start < entries.size()) {
+    chunks.emplace_back(start, entries.size());
+  }
+  return chunks;
+}
+
+// Runs chunk_fn over all the chunks, with up to GetNumThreads() of them being
+// processed at the same time. Errors are rethrown once all the tasks are done.
+void RunChunks(const std::vector<Chunk>& chunks,
+               const std::function<void(const Chunk&)>& chunk_fn) {
+  size_t num_tasks = std::min(chunks.size(), GetNumThreads());
+  std::atomic<size_t> next_chunk(0);
+  xla::util::MultiWait mwait(num_tasks);
+  for (size_t i = 0; i < num_tasks; ++i) {
+    auto task = [&]() {
+      for (size_t index = next_chunk++; index < chunks.size();
+           index = next_chunk++) {
+        chunk_fn(chunks[index]);
+      }
+    };
+    xla::env::ScheduleIoClosure(mwait.Completer(std::move(task)));
+  }
+  mwait.Wait();
+}
+
+void WriteAt(int fd, const void* data, size_t size, size_t offset,
+             const std::string& path) {
+  const char* ptr = static_cast<const char*>(data);
+  while (size > 0) {
+    ssize_t written = pwrite(fd, ptr, size, offset);
+    if (written < 0 && errno == EINTR) {
+      continue;
+    }
+    XLA_CHECK_GT(written, 0)
+        << "Failed writing checkpoint " << path << ": " << std::strerror(errno);
+    ptr += written;
+    offset += written;
+    size -= written;
+  }
+}
+
+void AppendUint64(xla::uint64 value, std::string* buffer) {
+  buffer->append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+void AppendString(const std::string& value, std::string* buffer) {
+  AppendUint64(value.size(), buffer);
+  buffer->append(value);
+}
+
+std::string SerializeIndex(const std::vector<Entry>& entries) {
+  std::string index;
+  AppendUint64(entries.size(), &index);
+  for (auto& entry : entries) {
+    AppendString(entry.name, &index);
+    AppendUint64(static_cast<xla::uint64>(entry.scalar_type), &index);
+    AppendString(entry.shape.ToProto().SerializeAsString(), &index);
+    AppendUint64(entry.offset, &index);
+    AppendUint64(entry.size, &index);
+  }
+  return index;
+}
+
+// Reads the values out of a memory mapped checkpoint, checking that they do
+// not go past its end.
+class Reader {
+ public:
+  Reader(const char* data, size_t size, const std::string& path)
+      : data_(data), size_(size), path_(path) {}
+
+  const char* Read(size_t size) {
+    XLA_CHECK_LE(size, size_ - offset_) << "Truncated checkpoint: " << path_;
+    const char* ptr = data_ + offset_;
+    offset_ += size;
+    return ptr;
+  }
+
+  xla::uint64 ReadUint64() {
+    xla::uint64 value;
+    std::memcpy(&value, Read(sizeof(value)), sizeof(value));
+    return value;
+  }
+
+  std::string ReadString() {
+    size_t size = ReadUint64();
+    return std::string(Read(size), size);
+  }
+
+  void Seek(size_t offset) {
+    XLA_CHECK_LE(offset, size_) << "Truncated checkpoint: " << path_;
+    offset_ = offset;
+  }
+
+ private:
+  const char* data_;
+  size_t size_;
+  size_t offset_ = 0;
+  std::string path_;
+};
+
+std::vector<Entry> ParseIndex(const MappedFile& file,
+                              const std::string& path) {
+  Reader reader(file.data(), file.size(), path);
+  const char* magic = reader.Read(sizeof(kMagic));
+  XLA_CHECK_EQ(std::memcmp(magic, kMagic, sizeof(kMagic)), 0)
+      << "Not an XLA checkpoint: " << path;
+  size_t index_offset = reader.ReadUint64();
+  reader.ReadUint64();
+  reader.Seek(index_offset);
+  std::vector<Entry> entries(reader.ReadUint64());
+  for (auto& entry : entries) {
+    entry.name = reader.ReadString();
+    entry.scalar_type = static_cast<at::ScalarType>(reader.ReadUint64());
+    xla::ShapeProto shape_proto;
+    XLA_CHECK(shape_proto.ParseFromString(reader.ReadString()))
+        << "Corrupted checkpoint index: " << path;
+    entry.shape = xla::Shape(shape_proto);
+    entry.offset = reader.ReadUint64();
+    entry.size = reader.ReadUint64();
+    XLA_CHECK_LE(entry.offset + entry.size, index_offset)
+        << "Corrupted checkpoint index: " << path;
+  }
+  return entries;
+}
+
+// Copies the data of the entry into buffer, which is laid out according to
+// the device shape.
+void PopulateBuffer(const Entry& entry, const char* data,
+                    const xla::Shape& shape, void* buffer, size_t size) {
+  if (xla::ShapeUtil::Equal(shape, entry.shape)) {
+    XLA_CHECK_EQ(size, entry.size);
+    std::memcpy(buffer, data, size);
+    return;
+  }
+  // The device layout differs from the one the data was saved with.
+  xla::Literal literal(entry.shape);
+  std::memcpy(literal.untyped_data(), data, entry.size);
+  xla::Literal relaid_literal = literal.Relayout(shape.layout());
+  XLA_CHECK_EQ(size, relaid_literal.size_bytes());
+  std::memcpy(buffer, relaid_literal.untyped_data(), size);
+}
+
+// The device data of the tensors to save, together with the index entries
+// describing where it goes within the checkpoint file.
+struct Snapshot {
+  std::vector<xla::ComputationClient::DataPtr> tensors_data;
+  std::vector<Entry> entries;
+  // The offset of the index, right after the data of the last tensor.
+  size_t index_offset = 0;
+};
+
+Snapshot CaptureSnapshot(const std::vector<std::string>& names,
+                         std::vector<XLATensor> tensors) {
+  XLA_CHECK_EQ(names.size(), tensors.size());
+  XLATensor::SyncTensorsGraph(&tensors, /*devices=*/{}, /*wait=*/true,
+                              /*sync_xla_data=*/false);
+  Snapshot snapshot;
+  snapshot.entries.resize(tensors.size());
+  size_t offset = kHeaderSize;
+  for (size_t i = 0; i < tensors.size(); ++i) {
+    snapshot.tensors_data.push_back(tensors[i].GetXlaData());
+    Entry& entry = snapshot.entries[i];
+    entry.name = names[i];
+    entry.scalar_type = tensors[i].dtype();
+    entry.shape = snapshot.tensors_data.back()->shape();
+    entry.offset = AlignOffset(offset);
+    entry.size = xla::ShapeUtil::ByteSizeOf(entry.shape);
+    offset = entry.offset + entry.size;
+  }
+  snapshot.index_offset = offset;
+  return snapshot;
+}
+
+void WriteSnapshot(const std::string& path, const Snapshot& snapshot) {
+  int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  XLA_CHECK_GE(fd, 0) << "Unable to create checkpoint " << path << ": "
+                      << std::strerror(errno);
+  xla::util::ExceptionCleanup fd_closer(
+      [fd](xla::util::ExceptionCleanup::StatusType) { close(fd); });
+  const std::vector<Entry>& entries = snapshot.entries;
+  auto chunk_fn = [&](const Chunk& chunk) {
+    std::vector<xla::ComputationClient::DataPtr> chunk_data(
+        snapshot.tensors_data.begin() + chunk.first,
+        snapshot.tensors_data.begin() + chunk.second);
+    auto data_fn = [&](size_t index, const xla::Shape& shape,
+                       const void* data, size_t size) {
+      const Entry& entry = entries[chunk.first + index];
+      XLA_CHECK_EQ(size, entry.size) << entry.name;
+      WriteAt(fd, data, size, entry.offset, path);
+      XLA_COUNTER("CheckpointBytesSaved", size);
+    };
+    xla::ComputationClient::Get()->TransferFromServer(chunk_data, data_fn);
+  };
+  RunChunks(SplitChunks(entries), chunk_fn);
+
+  std::string index = SerializeIndex(entries);
+  WriteAt(fd, index.data(), index.size(), snapshot.index_offset, path);
+  std::string header(kMagic, sizeof(kMagic));
+  AppendUint64(snapshot.index_offset, &header);
+  AppendUint64(index.size(), &header);
+  WriteAt(fd, header.data(), header.size(), 0, path);
+}
+
+}  // namespace
+
+void SaveCheckpoint(const std::string& path,
+                    const std::vector<std::string>& names,
+                    std::vector<XLATensor> tensors) {
+  XLA_TIMED("SaveCheckpoint");
+  WriteSnapshot(path, CaptureSnapshot(names, std::move(tensors)));
+}
+
+xla::util::Future<xla::util::Unit> SaveCheckpointAsync(
+    const std::string& path, const std::vector<std::string>& names,
+    std::vector<XLATensor> tensors) {
+  auto snapshot = std::make_shared<Snapshot>();
+  {
+    XLA_TIMED("SaveCheckpointCapture");
+    *snapshot = CaptureSnapshot(names, std::move(tensors));
+  }
+  XLA_COUNTER("AsyncCheckpoints", 1);
+  xla::util::Promise<xla::util::Unit> promise;
+  xla::util::Future<xla::util::Unit> future = promise.GetFuture();
+  // The write waits for the chunk transfers running on the IO thread pool, so
+  // it runs on a thread of its own, not to take one of those.
+  std::thread thread([path, snapshot, promise]() mutable {
+    try {
+      XLA_TIMED("SaveCheckpoint");
+      WriteSnapshot(path, *snapshot);
+    } catch (...) {
+      snapshot.reset();
+      promise.SetException(std::current_exception());
+      return;
+    }
+    // Release the device data handles before signaling the completion.
+    snapshot.reset();
+    promise.SetValue(xla::util::Unit());
+  });
+  thread.detach();
+  return future;
+}
+
+std::vector<std::pair<std::string, XLATensor>> LoadCheckpoint(
+    const std::string& path, const Device& device) {
+  XLA_TIMED("LoadCheckpoint");
+  auto file = std::make_shared<MappedFile>(path);
+  std::vector<Entry> entries = ParseIndex(*file, path);
+  std::string device_str = device.ToString();
+
+  std::vector<xla::ComputationClient::DataPtr> tensors_data(entries.size());
+  auto chunk_fn = [&](const Chunk& chunk) {
+    std::vector<xla::ComputationClient::TensorSource> source_tensors;
+    for (size_t i = chunk.first; i < chunk.second; ++i) {
+      const Entry& entry = entries[i];
+      xla::Shape shape = MakeArrayShapeFromDimensions(
+          entry.shape.dimensions(), entry.shape.element_type(), device.hw_type);
+      auto populate_fn =
+          [file, &entry](const xla::ComputationClient::TensorSource& source,
+                         void* buffer, size_t size) {
+            PopulateBuffer(entry, file->data() + entry.offset, source.shape,
+                           buffer, size);
+            XLA_COUNTER("CheckpointBytesLoaded", size);
+          };
+      source_tensors.emplace_back(std::move(shape), device_str,
+                                  std::move(populate_fn));
+    }
+    std::vector<xla::ComputationClient::DataPtr> chunk_data =
+        xla::ComputationClient::Get()->TransferToServer(source_tensors);
+    std::move(chunk_data.begin(), chunk_data.end(),
+              tensors_data.begin() + chunk.first);
+  };
+  RunChunks(SplitChunks(entries), chunk_fn);
+
+  std::vector<std::pair<std::string, XLATensor>> result;
+  result.reserve(entries.size());
+  for (size_t i = 0; i < entries.size(); ++i) {
+    result.emplace_back(
+        std::move(entries[i].name),
+        XLATensor::Create(std::move(tensors_data[i]), entries[i].scalar_type));
+  }
+  return result;
+}
+
+}  // namespace torch_xla
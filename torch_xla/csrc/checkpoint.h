@@ -0,0 +1,42 @@
+#pragma once
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "tensorflow/compiler/xla/xla_client/future.h"
+#include "torch_xla/csrc/device.h"
+#include "torch_xla/csrc/tensor.h"
+
+namespace torch_xla {
+
+// Saves the named tensors to a checkpoint file, streaming their device data
+// straight into it, without creating any intermediate at::Tensor. The device
+// data is fetched in chunks of bounded size (XLA_CHECKPOINT_CHUNK_BYTES), by
+// XLA_CHECKPOINT_THREADS threads writing their chunks in parallel, so the host
+// memory used is independent from the total size of the tensors.
+// The data of every tensor is stored at an aligned offset of the file, in the
+// device layout, so that the file can be memory mapped.
+void SaveCheckpoint(const std::string& path,
+                    const std::vector<std::string>& names,
+                    std::vector<XLATensor> tensors);
+
+// Like SaveCheckpoint(), but returns once the pending IR of the tensors has
+// been synced, and their device data captured. The file is written in
+// background, while the training goes on, and the returned future completes
+// (or fails with the write error) once it is done. The captured device data
+// handles are held until then, which keeps them from being released or
+// donated to the following computations, so the snapshot is not affected by
+// the updates the tensors get in the meantime.
+xla::util::Future<xla::util::Unit> SaveCheckpointAsync(
+    const std::string& path, const std::vector<std::string>& names,
+    std::vector<XLATensor> tensors);
+
+// Loads the tensors of a checkpoint file written by SaveCheckpoint() to the
+// given device, returning them together with their names, in file order. The
+// file is memory mapped, and the device buffers are populated straight from
+// it, using the same chunking and parallelism of the save.
+std::vector<std::pair<std::string, XLATensor>> LoadCheckpoint(
+    const std::string& path, const Device& device);
+
+}  // namespace torch_xla
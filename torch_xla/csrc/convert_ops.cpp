@@ -51,6 +51,11 @@ xla::XlaOp ConvertTo(const xla::XlaOp& op, xla::PrimitiveType from,
   }
 }
 
+xla::XlaOp MaybeConvertTo(const xla::XlaOp& op, xla::PrimitiveType from,
+                          xla::PrimitiveType to, const Device* device) {
+  return from != to ? ConvertTo(op, from, to, device) : op;
+}
+
 xla::XlaOp ConvertToNumeric(const xla::XlaOp& op, xla::PrimitiveType from) {
   const Device* device = GetDefaultDevice();
   return from != xla::PrimitiveType::PRED
@@ -75,4 +80,15 @@ xla::XlaOp CastToScalarType(const xla::XlaOp& input,
   }
 }
 
+xla::PrimitiveType GetCastToScalarType(xla::PrimitiveType type,
+                                       c10::optional<at::ScalarType> dtype) {
+  if (dtype) {
+    return MakeXlaPrimitiveType(*dtype, /*device=*/nullptr);
+  }
+  return type != xla::PrimitiveType::PRED
+             ? type
+             : GetDevicePrimitiveType(xla::PrimitiveType::U8,
+                                      GetDefaultDevice());
+}
+
 }  // namespace torch_xla
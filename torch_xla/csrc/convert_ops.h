@@ -12,6 +12,10 @@ namespace torch_xla {
 xla::XlaOp ConvertTo(const xla::XlaOp& op, xla::PrimitiveType from,
                      xla::PrimitiveType to, const Device* device);
 
+// Same as ConvertTo(), but returns the input itself when the types match.
+xla::XlaOp MaybeConvertTo(const xla::XlaOp& op, xla::PrimitiveType from,
+                          xla::PrimitiveType to, const Device* device);
+
 xla::XlaOp ConvertToNumeric(const xla::XlaOp& op, xla::PrimitiveType from);
 
 xla::XlaOp ConvertToNumeric(const xla::XlaOp& op);
@@ -21,4 +25,9 @@ xla::XlaOp ConvertToNumeric(const xla::XlaOp& op);
 xla::XlaOp CastToScalarType(const xla::XlaOp& input,
                             c10::optional<at::ScalarType> dtype);
 
+// Returns the element type CastToScalarType() converts an input of the given
+// type to.
+xla::PrimitiveType GetCastToScalarType(xla::PrimitiveType type,
+                                       c10::optional<at::ScalarType> dtype);
+
 }  // namespace torch_xla
@@ -1,6 +1,8 @@
 #include "torch_xla/csrc/convolution.h"
 
 #include "tensorflow/compiler/tf2xla/kernels/conv_op_helpers.h"
+#include "tensorflow/compiler/xla/primitive_util.h"
+#include "tensorflow/compiler/xla/shape_util.h"
 #include "tensorflow/compiler/xla/xla_client/debug_macros.h"
 #include "tensorflow/core/framework/tensor_shape.h"
 #include "tensorflow/core/kernels/conv_grad_ops.h"
@@ -19,6 +21,7 @@ namespace {
  *   - BuildConvolutionBackwardOverrideable
  *     - BuildConvBackwardInput
  *     - BuildConvBackwardWeight
+ *     - BuildGroupedConvBackwardWeight (grouped and depthwise)
  *     - BuildGradBias
  *
  * Here're detailed steps from a 4D PyTorch inputs to inputs calling into
@@ -233,6 +236,57 @@ xla::XlaOp BuildConvBackwardWeight(
   return xla::Transpose(conv, inv_transpose_permutation);
 }
 
+// Computes the kernel gradient for a grouped (or depthwise) convolution, as a
+// single convolution of the input with grad_output, using a batch group count.
+// The input feature dimension plays the role of the batch, split in groups,
+// which pairs each group of input features with the output features of the
+// same group. This avoids the transposes moving the groups into the batch
+// dimension of the generic formulation, and the result comes out in the
+// PyTorch [Cout, Cin / groups, K...] kernel layout.
+xla::XlaOp BuildGroupedConvBackwardWeight(
+    const xla::XlaOp& grad_output, const xla::XlaOp& input,
+    const xla::Shape& kernel_shape,
+    tensorflow::gtl::ArraySlice<const xla::int64> spatial_stride,
+    tensorflow::gtl::ArraySlice<const xla::int64> spatial_padding,
+    tensorflow::gtl::ArraySlice<const xla::int64> spatial_dilation,
+    xla::int64 groups) {
+  xla::Shape input_shape = XlaHelpers::ShapeOfXlaOp(input);
+  xla::Shape grad_output_shape = XlaHelpers::ShapeOfXlaOp(grad_output);
+  xla::int64 num_spatial = input_shape.rank() - 2;
+  xla::ConvolutionDimensionNumbers dimension_numbers;
+  dimension_numbers.set_input_batch_dimension(1);
+  dimension_numbers.set_input_feature_dimension(0);
+  dimension_numbers.set_kernel_input_feature_dimension(0);
+  dimension_numbers.set_kernel_output_feature_dimension(1);
+  dimension_numbers.set_output_batch_dimension(1);
+  dimension_numbers.set_output_feature_dimension(0);
+  std::vector<std::pair<xla::int64, xla::int64>> dims_padding;
+  for (xla::int64 spatial_dim = 0; spatial_dim < num_spatial; ++spatial_dim) {
+    dimension_numbers.add_input_spatial_dimensions(2 + spatial_dim);
+    dimension_numbers.add_kernel_spatial_dimensions(2 + spatial_dim);
+    dimension_numbers.add_output_spatial_dimensions(2 + spatial_dim);
+    // The high padding makes the window positions match the kernel size. It
+    // is negative when the forward strides skipped the last input elements.
+    xla::int64 low_padding = spatial_padding[spatial_dim];
+    xla::int64 high_padding =
+        (kernel_shape.dimensions(2 + spatial_dim) - 1) *
+            spatial_dilation[spatial_dim] +
+        (grad_output_shape.dimensions(2 + spatial_dim) - 1) *
+            spatial_stride[spatial_dim] +
+        1 - input_shape.dimensions(2 + spatial_dim) - low_padding;
+    dims_padding.emplace_back(low_padding, high_padding);
+  }
+  xla::PrecisionConfig precision_config =
+      XlaHelpers::BuildPrecisionConfig(XlaHelpers::mat_mul_precision());
+  // The forward dilation becomes the window stride, and the forward stride
+  // dilates grad_output, which acts as the kernel.
+  return xla::ConvGeneralDilated(
+      input, grad_output, /*window_strides=*/spatial_dilation, dims_padding,
+      /*lhs_dilation=*/{}, /*rhs_dilation=*/spatial_stride, dimension_numbers,
+      /*feature_group_count=*/1, /*batch_group_count=*/groups,
+      &precision_config);
+}
+
 xla::XlaOp BuildGradBias(xla::XlaOp grad_output) {
   xla::Shape grad_output_shape = XlaHelpers::ShapeOfXlaOp(grad_output);
   // The bias contribution is linear in each output feature. Reduce the
@@ -246,6 +300,27 @@ xla::XlaOp BuildGradBias(xla::XlaOp grad_output) {
       BiasReduceDimensions(grad_output_shape.rank()));
 }
 
+// Converts op to type, if it is a floating point operation of a different type.
+xla::XlaOp ConvertFloatingOp(const xla::XlaOp& op, xla::PrimitiveType type) {
+  xla::PrimitiveType op_type = XlaHelpers::TypeOfXlaOp(op);
+  if (op_type == type || !xla::primitive_util::IsFloatingPointType(op_type)) {
+    return op;
+  }
+  return xla::ConvertElementType(op, type);
+}
+
+xla::PrimitiveType GetWidestType(
+    tensorflow::gtl::ArraySlice<const xla::PrimitiveType> types) {
+  xla::PrimitiveType widest_type = types.front();
+  for (auto type : types) {
+    if (xla::ShapeUtil::ByteSizeOfPrimitiveType(type) >
+        xla::ShapeUtil::ByteSizeOfPrimitiveType(widest_type)) {
+      widest_type = type;
+    }
+  }
+  return widest_type;
+}
+
 }  // namespace
 
 xla::XlaOp BuildTransposedConvolution(
@@ -305,7 +380,8 @@ ConvGrads BuildTransposedConvolutionBackward(
     xla::int64 groups) {
   xla::XlaOp grad_input =
       BuildConvolutionOverrideable(grad_output, kernel, stride, padding,
-                                   dilation, false, output_padding, groups);
+                                   dilation, false, output_padding, groups,
+                                   XlaHelpers::MixedPrecision());
   xla::XlaOp grad_weight = BuildConvBackwardWeight(
       input, grad_output, XlaHelpers::ShapeOfXlaOp(kernel), stride, padding,
       dilation, groups);
@@ -319,11 +395,13 @@ xla::XlaOp BuildConvolutionOverrideable(
     tensorflow::gtl::ArraySlice<const xla::int64> padding,
     tensorflow::gtl::ArraySlice<const xla::int64> dilation, bool transposed,
     tensorflow::gtl::ArraySlice<const xla::int64> output_padding,
-    xla::int64 groups) {
-  if (transposed) {
-    return BuildTransposedConvolution(input, kernel, stride, padding, dilation,
-                                      output_padding, groups);
-  } else {
+    xla::int64 groups, const XlaHelpers::MixedPrecision& mixed_precision) {
+  auto conv_fn = [&](const xla::XlaOp& input,
+                     const xla::XlaOp& kernel) -> xla::XlaOp {
+    if (transposed) {
+      return BuildTransposedConvolution(input, kernel, stride, padding,
+                                        dilation, output_padding, groups);
+    }
     auto dims_padding = MakePadding(padding);
     xla::PrecisionConfig precision_config =
         XlaHelpers::BuildPrecisionConfig(XlaHelpers::mat_mul_precision());
@@ -335,7 +413,8 @@ xla::XlaOp BuildConvolutionOverrideable(
         xla::XlaBuilder::CreateDefaultConvDimensionNumbers(stride.size()),
         /*feature_group_count*/ groups,
         /*batch_group_count=*/1, &precision_config);
-  }
+  };
+  return XlaHelpers::MixedPrecisionOp(mixed_precision, input, kernel, conv_fn);
 }
 
 xla::XlaOp BuildConvolutionOverrideableBias(
@@ -344,17 +423,20 @@ xla::XlaOp BuildConvolutionOverrideableBias(
     tensorflow::gtl::ArraySlice<const xla::int64> padding,
     tensorflow::gtl::ArraySlice<const xla::int64> dilation, bool transposed,
     tensorflow::gtl::ArraySlice<const xla::int64> output_padding,
-    xla::int64 groups) {
-  xla::XlaOp conv =
-      BuildConvolutionOverrideable(input, kernel, stride, padding, dilation,
-                                   transposed, output_padding, groups);
+    xla::int64 groups, const XlaHelpers::MixedPrecision& mixed_precision) {
+  xla::XlaOp conv = BuildConvolutionOverrideable(
+      input, kernel, stride, padding, dilation, transposed, output_padding,
+      groups, mixed_precision);
   auto broadcast_sizes = XlaHelpers::SizesOfXlaOp(conv);
   // Remove the channels dimension.
   broadcast_sizes.erase(broadcast_sizes.begin() + 1);
-  // Make the bias match the output dimensions.
-  xla::XlaOp bias_broadcast =
-      xla::Transpose(xla::Broadcast(bias, broadcast_sizes),
-                     BiasTransposePermutation(broadcast_sizes.size() + 1));
+  // Make the bias match the output dimensions. The convolution result might
+  // have a different type than the bias, if a mixed precision accumulation
+  // type is in effect.
+  xla::XlaOp bias_broadcast = xla::Transpose(
+      xla::Broadcast(ConvertFloatingOp(bias, XlaHelpers::TypeOfXlaOp(conv)),
+                     broadcast_sizes),
+      BiasTransposePermutation(broadcast_sizes.size() + 1));
   return conv + bias_broadcast;
 }
 
@@ -365,20 +447,44 @@ ConvGrads BuildConvolutionBackwardOverrideable(
     tensorflow::gtl::ArraySlice<const xla::int64> padding,
     tensorflow::gtl::ArraySlice<const xla::int64> dilation, bool transposed,
     tensorflow::gtl::ArraySlice<const xla::int64> output_padding,
-    xla::int64 groups) {
+    xla::int64 groups, const XlaHelpers::MixedPrecision& mixed_precision) {
+  xla::PrimitiveType grad_output_type = XlaHelpers::TypeOfXlaOp(grad_output);
+  xla::PrimitiveType input_type = XlaHelpers::TypeOfXlaOp(input);
+  xla::PrimitiveType kernel_type = XlaHelpers::TypeOfXlaOp(kernel);
+  // With a mixed precision accumulation type, grad_output can have a different
+  // type than input and kernel. Compute the gradients with the policy compute
+  // type, or with the widest of the operand types, and return them with the
+  // types of their respective operands.
+  xla::PrimitiveType compute_type = mixed_precision.compute_type;
+  if (compute_type == xla::PrimitiveType::PRIMITIVE_TYPE_INVALID) {
+    compute_type = GetWidestType({grad_output_type, input_type, kernel_type});
+  }
+  xla::XlaOp compute_grad_output = ConvertFloatingOp(grad_output, compute_type);
+  xla::XlaOp compute_input = ConvertFloatingOp(input, compute_type);
+  xla::XlaOp compute_kernel = ConvertFloatingOp(kernel, compute_type);
+  ConvGrads grads;
   if (transposed) {
-    return BuildTransposedConvolutionBackward(grad_output, input, kernel,
-                                              stride, padding, dilation,
-                                              output_padding, groups);
+    grads = BuildTransposedConvolutionBackward(
+        compute_grad_output, compute_input, compute_kernel, stride, padding,
+        dilation, output_padding, groups);
   } else {
-    xla::XlaOp grad_input = BuildConvBackwardInput(
-        grad_output, kernel, XlaHelpers::ShapeOfXlaOp(input), stride, padding,
-        dilation, groups);
-    xla::XlaOp grad_weight = BuildConvBackwardWeight(
-        grad_output, input, XlaHelpers::ShapeOfXlaOp(kernel), stride, padding,
-        dilation, groups);
-    xla::XlaOp grad_bias = BuildGradBias(grad_output);
-    return {grad_input, grad_weight, grad_bias};
+    grads.grad_input = BuildConvBackwardInput(
+        compute_grad_output, compute_kernel,
+        XlaHelpers::ShapeOfXlaOp(compute_input), stride, padding, dilation,
+        groups);
+    auto build_backward_weight =
+        groups > 1 ? BuildGroupedConvBackwardWeight : BuildConvBackwardWeight;
+    grads.grad_weight = build_backward_weight(
+        compute_grad_output, compute_input,
+        XlaHelpers::ShapeOfXlaOp(compute_kernel), stride, padding, dilation,
+        groups);
   }
+  grads.grad_input = ConvertFloatingOp(grads.grad_input, input_type);
+  grads.grad_weight = ConvertFloatingOp(grads.grad_weight, kernel_type);
+  // The bias gradient is a plain reduction, which is computed with the
+  // original grad_output type.
+  grads.grad_bias = BuildGradBias(grad_output);
+  return grads;
 }
+
 }  // namespace torch_xla
@@ -2,18 +2,20 @@
 
 #include "tensorflow/compiler/xla/client/xla_builder.h"
 #include "tensorflow/core/lib/gtl/array_slice.h"
+#include "torch_xla/csrc/helpers.h"
 
 namespace torch_xla {
 
 // Computes the convolution of the given input and kernel with the given
-// precision, with the given stride and padding.
+// precision, with the given stride and padding. The convolution runs according
+// to the mixed_precision policy.
 xla::XlaOp BuildConvolutionOverrideable(
     const xla::XlaOp& input, const xla::XlaOp& kernel,
     tensorflow::gtl::ArraySlice<const xla::int64> stride,
     tensorflow::gtl::ArraySlice<const xla::int64> padding,
     tensorflow::gtl::ArraySlice<const xla::int64> dilation, bool transposed,
     tensorflow::gtl::ArraySlice<const xla::int64> output_padding,
-    xla::int64 groups);
+    xla::int64 groups, const XlaHelpers::MixedPrecision& mixed_precision);
 
 // Same as above, then broadcasts the bias and adds it to the result.
 xla::XlaOp BuildConvolutionOverrideableBias(
@@ -22,7 +24,7 @@ xla::XlaOp BuildConvolutionOverrideableBias(
     tensorflow::gtl::ArraySlice<const xla::int64> padding,
     tensorflow::gtl::ArraySlice<const xla::int64> dilation, bool transposed,
     tensorflow::gtl::ArraySlice<const xla::int64> output_padding,
-    xla::int64 groups);
+    xla::int64 groups, const XlaHelpers::MixedPrecision& mixed_precision);
 
 struct ConvGrads {
   xla::XlaOp grad_input;
@@ -31,6 +33,8 @@ struct ConvGrads {
 };
 
 // Computes the gradients for a convolution with the given stride and padding.
+// The input and kernel gradients are computed with the mixed_precision compute
+// type, and returned with the types of the input and kernel.
 ConvGrads BuildConvolutionBackwardOverrideable(
     const xla::XlaOp& grad_output, const xla::XlaOp& input,
     const xla::XlaOp& kernel,
@@ -38,6 +42,6 @@ ConvGrads BuildConvolutionBackwardOverrideable(
     tensorflow::gtl::ArraySlice<const xla::int64> padding,
     tensorflow::gtl::ArraySlice<const xla::int64> dilation, bool transposed,
     tensorflow::gtl::ArraySlice<const xla::int64> output_padding,
-    xla::int64 groups);
+    xla::int64 groups, const XlaHelpers::MixedPrecision& mixed_precision);
 
 }  // namespace torch_xla
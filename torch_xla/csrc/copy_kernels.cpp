@@ -0,0 +1,365 @@
+#include "torch_xla/csrc/copy_kernels.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#include "tensorflow/compiler/xla/xla_client/sys_util.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define XLA_COPY_KERNELS_X86 1
+#endif
+
+namespace torch_xla {
+namespace copy_kernels {
+namespace {
+
+uint16_t RoundToBFloat16Bits(float value) {
+  if (std::isnan(value)) {
+    return 0x7fc0;
+  }
+  uint32_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  bits += 0x7fff + ((bits >> 16) & 1);
+  return static_cast<uint16_t>(bits >> 16);
+}
+
+// The vectorized kernel rounds to nearest even, so it can only be used if the
+// tensorflow::bfloat16 conversion (which is what the scalar path uses) does
+// the same.
+bool BFloat16RoundsToNearestEven() {
+  const float values[] = {1.00390625f, 1.01171875f, -3.0078125f,
+                          std::numeric_limits<float>::quiet_NaN()};
+  for (auto value : values) {
+    tensorflow::bfloat16 bf16 = static_cast<tensorflow::bfloat16>(value);
+    uint16_t bits;
+    std::memcpy(&bits, &bf16, sizeof(bits));
+    if (bits != RoundToBFloat16Bits(value)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// The side of the square tiles the transposes are split into.
+const xla::int64 kTransposeTile = 32;
+
+void TransposeTile32(const int32_t* source, xla::int64 source_ld,
+                     int32_t* dest, xla::int64 dest_ld, xla::int64 row_start,
+                     xla::int64 row_end, xla::int64 col_start,
+                     xla::int64 col_end) {
+  for (xla::int64 j = col_start; j < col_end; ++j) {
+    for (xla::int64 i = row_start; i < row_end; ++i) {
+      dest[j * dest_ld + i] = source[i * source_ld + j];
+    }
+  }
+}
+
+#if defined(XLA_COPY_KERNELS_X86)
+
+bool UseAvx2() {
+  static bool use_avx2 =
+      xla::sys_util::GetEnvBool("XLA_VECTORIZED_COPY", true) &&
+      __builtin_cpu_supports("avx2");
+  return use_avx2;
+}
+
+bool UseAvx2BFloat16() {
+  static bool use_avx2_bf16 = UseAvx2() && BFloat16RoundsToNearestEven();
+  return use_avx2_bf16;
+}
+
+__attribute__((target("avx2"))) xla::int64 FloatToBFloat16Avx2(
+    const float* source, uint16_t* dest, xla::int64 n) {
+  const __m256i one = _mm256_set1_epi32(1);
+  const __m256i bias = _mm256_set1_epi32(0x7fff);
+  const __m256i nan = _mm256_set1_epi32(0x7fc0);
+  xla::int64 i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m256 fvalues = _mm256_loadu_ps(source + i);
+    __m256i values = _mm256_castps_si256(fvalues);
+    __m256i lsb = _mm256_and_si256(_mm256_srli_epi32(values, 16), one);
+    __m256i rounded = _mm256_srli_epi32(
+        _mm256_add_epi32(values, _mm256_add_epi32(bias, lsb)), 16);
+    __m256 nan_mask = _mm256_cmp_ps(fvalues, fvalues, _CMP_UNORD_Q);
+    rounded = _mm256_blendv_epi8(rounded, nan, _mm256_castps_si256(nan_mask));
+    // The pack works within 128 bit lanes, so the result needs to be fixed up
+    // by moving the 64 bit quad-word 2 into position 1.
+    __m256i packed = _mm256_permute4x64_epi64(
+        _mm256_packus_epi32(rounded, rounded), 0x08);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + i),
+                     _mm256_castsi256_si128(packed));
+  }
+  return i;
+}
+
+__attribute__((target("avx2"))) xla::int64 BFloat16ToFloatAvx2(
+    const uint16_t* source, float* dest, xla::int64 n) {
+  xla::int64 i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m128i values =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i));
+    __m256i widened = _mm256_slli_epi32(_mm256_cvtepu16_epi32(values), 16);
+    _mm256_storeu_ps(dest + i, _mm256_castsi256_ps(widened));
+  }
+  return i;
+}
+
+__attribute__((target("avx2"))) xla::int64 Int64ToInt32Avx2(
+    const int64_t* source, int32_t* dest, xla::int64 n) {
+  const __m256i low_words = _mm256_setr_epi32(0, 2, 4, 6, 1, 3, 5, 7);
+  xla::int64 i = 0;
+  for (; i + 4 <= n; i += 4) {
+    __m256i values =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(source + i));
+    __m256i narrowed = _mm256_permutevar8x32_epi32(values, low_words);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + i),
+                     _mm256_castsi256_si128(narrowed));
+  }
+  return i;
+}
+
+__attribute__((target("avx2"))) xla::int64 Int32ToInt64Avx2(
+    const int32_t* source, int64_t* dest, xla::int64 n) {
+  xla::int64 i = 0;
+  for (; i + 4 <= n; i += 4) {
+    __m128i values =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dest + i),
+                        _mm256_cvtepi32_epi64(values));
+  }
+  return i;
+}
+
+__attribute__((target("avx2"))) xla::int64 StridedGather32Avx2(
+    const int32_t* source, xla::int64 source_stride, int32_t* dest,
+    xla::int64 n) {
+  int32_t stride = static_cast<int32_t>(source_stride);
+  const __m256i offsets =
+      _mm256_setr_epi32(0, stride, 2 * stride, 3 * stride, 4 * stride,
+                        5 * stride, 6 * stride, 7 * stride);
+  xla::int64 i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m256i values =
+        _mm256_i32gather_epi32(source + i * source_stride, offsets, 4);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dest + i), values);
+  }
+  return i;
+}
+
+__attribute__((target("avx2"))) xla::int64 BytesToBoolAvx2(
+    const uint8_t* source, bool* dest, xla::int64 n) {
+  const __m256i one = _mm256_set1_epi8(1);
+  xla::int64 i = 0;
+  for (; i + 32 <= n; i += 32) {
+    __m256i values =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(source + i));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dest + i),
+                        _mm256_min_epu8(values, one));
+  }
+  return i;
+}
+
+// Packs whole words only, and returns the number of elements packed.
+__attribute__((target("avx2"))) xla::int64 PackBits32Avx2(const bool* source,
+                                                          uint32_t* dest,
+                                                          xla::int64 n) {
+  const __m256i zero = _mm256_setzero_si256();
+  xla::int64 i = 0;
+  for (; i + 32 <= n; i += 32) {
+    __m256i values =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(source + i));
+    uint32_t zeros = static_cast<uint32_t>(
+        _mm256_movemask_epi8(_mm256_cmpeq_epi8(values, zero)));
+    dest[i / 32] = ~zeros;
+  }
+  return i;
+}
+
+// Transposes the 8x8 block of 32 bit elements at source into dest.
+__attribute__((target("avx2"))) void Transpose8x8Avx2(const int32_t* source,
+                                                      xla::int64 source_ld,
+                                                      int32_t* dest,
+                                                      xla::int64 dest_ld) {
+  const float* fsource = reinterpret_cast<const float*>(source);
+  float* fdest = reinterpret_cast<float*>(dest);
+  __m256 r0 = _mm256_loadu_ps(fsource);
+  __m256 r1 = _mm256_loadu_ps(fsource + source_ld);
+  __m256 r2 = _mm256_loadu_ps(fsource + 2 * source_ld);
+  __m256 r3 = _mm256_loadu_ps(fsource + 3 * source_ld);
+  __m256 r4 = _mm256_loadu_ps(fsource + 4 * source_ld);
+  __m256 r5 = _mm256_loadu_ps(fsource + 5 * source_ld);
+  __m256 r6 = _mm256_loadu_ps(fsource + 6 * source_ld);
+  __m256 r7 = _mm256_loadu_ps(fsource + 7 * source_ld);
+  // Interleave the pairs of rows, then the pairs of pairs, which leaves the
+  // columns of the 4x4 quadrants within the 128 bit lanes.
+  __m256 t0 = _mm256_unpacklo_ps(r0, r1);
+  __m256 t1 = _mm256_unpackhi_ps(r0, r1);
+  __m256 t2 = _mm256_unpacklo_ps(r2, r3);
+  __m256 t3 = _mm256_unpackhi_ps(r2, r3);
+  __m256 t4 = _mm256_unpacklo_ps(r4, r5);
+  __m256 t5 = _mm256_unpackhi_ps(r4, r5);
+  __m256 t6 = _mm256_unpacklo_ps(r6, r7);
+  __m256 t7 = _mm256_unpackhi_ps(r6, r7);
+  __m256 s0 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0));
+  __m256 s1 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2));
+  __m256 s2 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0));
+  __m256 s3 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3, 2, 3, 2));
+  __m256 s4 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(1, 0, 1, 0));
+  __m256 s5 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(3, 2, 3, 2));
+  __m256 s6 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(1, 0, 1, 0));
+  __m256 s7 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(3, 2, 3, 2));
+  _mm256_storeu_ps(fdest, _mm256_permute2f128_ps(s0, s4, 0x20));
+  _mm256_storeu_ps(fdest + dest_ld, _mm256_permute2f128_ps(s1, s5, 0x20));
+  _mm256_storeu_ps(fdest + 2 * dest_ld, _mm256_permute2f128_ps(s2, s6, 0x20));
+  _mm256_storeu_ps(fdest + 3 * dest_ld, _mm256_permute2f128_ps(s3, s7, 0x20));
+  _mm256_storeu_ps(fdest + 4 * dest_ld, _mm256_permute2f128_ps(s0, s4, 0x31));
+  _mm256_storeu_ps(fdest + 5 * dest_ld, _mm256_permute2f128_ps(s1, s5, 0x31));
+  _mm256_storeu_ps(fdest + 6 * dest_ld, _mm256_permute2f128_ps(s2, s6, 0x31));
+  _mm256_storeu_ps(fdest + 7 * dest_ld, _mm256_permute2f128_ps(s3, s7, 0x31));
+}
+
+// Transposes the rows of the tile which are part of whole 8x8 blocks, and
+// returns the first row which is not.
+xla::int64 TransposeTile32Avx2(const int32_t* source, xla::int64 source_ld,
+                               int32_t* dest, xla::int64 dest_ld,
+                               xla::int64 row_start, xla::int64 row_end,
+                               xla::int64 col_start, xla::int64 col_end) {
+  xla::int64 i = row_start;
+  for (; i + 8 <= row_end; i += 8) {
+    xla::int64 j = col_start;
+    for (; j + 8 <= col_end; j += 8) {
+      Transpose8x8Avx2(source + i * source_ld + j, source_ld,
+                       dest + j * dest_ld + i, dest_ld);
+    }
+    TransposeTile32(source, source_ld, dest, dest_ld, i, i + 8, j, col_end);
+  }
+  return i;
+}
+
+#endif  // XLA_COPY_KERNELS_X86
+
+}  // namespace
+
+void FloatToBFloat16(const float* source, tensorflow::bfloat16* dest,
+                     xla::int64 n) {
+  xla::int64 i = 0;
+#if defined(XLA_COPY_KERNELS_X86)
+  if (UseAvx2BFloat16()) {
+    i = FloatToBFloat16Avx2(source, reinterpret_cast<uint16_t*>(dest), n);
+  }
+#endif
+  for (; i < n; ++i) {
+    dest[i] = static_cast<tensorflow::bfloat16>(source[i]);
+  }
+}
+
+void BFloat16ToFloat(const tensorflow::bfloat16* source, float* dest,
+                     xla::int64 n) {
+  xla::int64 i = 0;
+#if defined(XLA_COPY_KERNELS_X86)
+  if (UseAvx2()) {
+    i = BFloat16ToFloatAvx2(reinterpret_cast<const uint16_t*>(source), dest,
+                            n);
+  }
+#endif
+  for (; i < n; ++i) {
+    dest[i] = static_cast<float>(source[i]);
+  }
+}
+
+void Int64ToInt32(const int64_t* source, int32_t* dest, xla::int64 n) {
+  xla::int64 i = 0;
+#if defined(XLA_COPY_KERNELS_X86)
+  if (UseAvx2()) {
+    i = Int64ToInt32Avx2(source, dest, n);
+  }
+#endif
+  for (; i < n; ++i) {
+    dest[i] = static_cast<int32_t>(source[i]);
+  }
+}
+
+void Int32ToInt64(const int32_t* source, int64_t* dest, xla::int64 n) {
+  xla::int64 i = 0;
+#if defined(XLA_COPY_KERNELS_X86)
+  if (UseAvx2()) {
+    i = Int32ToInt64Avx2(source, dest, n);
+  }
+#endif
+  for (; i < n; ++i) {
+    dest[i] = static_cast<int64_t>(source[i]);
+  }
+}
+
+void BytesToBool(const uint8_t* source, bool* dest, xla::int64 n) {
+  xla::int64 i = 0;
+#if defined(XLA_COPY_KERNELS_X86)
+  if (UseAvx2()) {
+    i = BytesToBoolAvx2(source, dest, n);
+  }
+#endif
+  for (; i < n; ++i) {
+    dest[i] = source[i] != 0;
+  }
+}
+
+void PackBits32(const bool* source, uint32_t* dest, xla::int64 n) {
+  xla::int64 i = 0;
+#if defined(XLA_COPY_KERNELS_X86)
+  if (UseAvx2()) {
+    i = PackBits32Avx2(source, dest, n);
+  }
+#endif
+  for (; i < n; i += 32) {
+    xla::int64 count = std::min<xla::int64>(n - i, 32);
+    uint32_t word = 0;
+    for (xla::int64 j = 0; j < count; ++j) {
+      word |= static_cast<uint32_t>(source[i + j]) << j;
+    }
+    dest[i / 32] = word;
+  }
+}
+
+void StridedGather32(const void* source, xla::int64 source_stride, void* dest,
+                     xla::int64 n) {
+  const int32_t* isource = reinterpret_cast<const int32_t*>(source);
+  int32_t* idest = reinterpret_cast<int32_t*>(dest);
+  xla::int64 i = 0;
+#if defined(XLA_COPY_KERNELS_X86)
+  // The gather offsets are 32 bit signed integers.
+  if (UseAvx2() && source_stride > 0 &&
+      source_stride <= std::numeric_limits<int32_t>::max() / 8) {
+    i = StridedGather32Avx2(isource, source_stride, idest, n);
+  }
+#endif
+  for (; i < n; ++i) {
+    idest[i] = isource[i * source_stride];
+  }
+}
+
+void Transpose32(const void* source, xla::int64 source_ld, void* dest,
+                 xla::int64 dest_ld, xla::int64 rows, xla::int64 cols) {
+  const int32_t* isource = reinterpret_cast<const int32_t*>(source);
+  int32_t* idest = reinterpret_cast<int32_t*>(dest);
+  for (xla::int64 i = 0; i < rows; i += kTransposeTile) {
+    xla::int64 row_end = std::min(i + kTransposeTile, rows);
+    for (xla::int64 j = 0; j < cols; j += kTransposeTile) {
+      xla::int64 col_end = std::min(j + kTransposeTile, cols);
+      xla::int64 row_start = i;
+#if defined(XLA_COPY_KERNELS_X86)
+      if (UseAvx2()) {
+        row_start = TransposeTile32Avx2(isource, source_ld, idest, dest_ld, i,
+                                        row_end, j, col_end);
+      }
+#endif
+      TransposeTile32(isource, source_ld, idest, dest_ld, row_start, row_end,
+                      j, col_end);
+    }
+  }
+}
+
+}  // namespace copy_kernels
+}  // namespace torch_xla
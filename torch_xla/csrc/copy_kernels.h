@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#include "tensorflow/compiler/xla/types.h"
+#include "tensorflow/core/lib/bfloat16/bfloat16.h"
+
+namespace torch_xla {
+namespace copy_kernels {
+
+// Vectorized copy/conversion kernels used by the tensor data transfer code.
+// The implementation is selected at runtime, based on the CPU features, with
+// scalar fallbacks which produce the same results.
+
+void FloatToBFloat16(const float* source, tensorflow::bfloat16* dest,
+                     xla::int64 n);
+
+void BFloat16ToFloat(const tensorflow::bfloat16* source, float* dest,
+                     xla::int64 n);
+
+void Int64ToInt32(const int64_t* source, int32_t* dest, xla::int64 n);
+
+void Int32ToInt64(const int32_t* source, int64_t* dest, xla::int64 n);
+
+// Copies n 32 bit elements, which are source_stride elements apart within the
+// source buffer, into the contiguous dest buffer.
+void StridedGather32(const void* source, xla::int64 source_stride, void* dest,
+                     xla::int64 n);
+
+// Copies the rows x cols matrix of 32 bit elements at source, whose rows are
+// source_ld elements apart, transposed into the cols x rows matrix at dest,
+// whose rows are dest_ld elements apart. Both matrices are walked in tiles
+// which fit the L1 cache.
+void Transpose32(const void* source, xla::int64 source_ld, void* dest,
+                 xla::int64 dest_ld, xla::int64 rows, xla::int64 cols);
+
+// Converts n bytes to bool, mapping any non zero byte to true.
+void BytesToBool(const uint8_t* source, bool* dest, xla::int64 n);
+
+// Packs the n bools at source into ceil(n / 32) words, element i going into
+// bit i % 32 of word i / 32. The unused bits of the last word are zero.
+void PackBits32(const bool* source, uint32_t* dest, xla::int64 n);
+
+template <typename T, size_t N>
+struct IsIntegerOfSize {
+  static constexpr bool value = std::is_integral<T>::value &&
+                                std::is_signed<T>::value && sizeof(T) == N;
+};
+
+// The bool and 8 bit integer types, whose conversions among each other keep
+// the bit patterns, except for the ones to bool.
+template <typename T>
+struct IsByteType {
+  static constexpr bool value = std::is_integral<T>::value && sizeof(T) == 1;
+};
+
+// Converts n elements from source to dest using one of the kernels above, if
+// the type pair is supported. Returns whether the conversion has been done.
+template <typename D, typename S>
+bool ConvertData(D* dest, const S* source, xla::int64 n) {
+  if (std::is_same<S, float>::value &&
+      std::is_same<D, tensorflow::bfloat16>::value) {
+    FloatToBFloat16(reinterpret_cast<const float*>(source),
+                    reinterpret_cast<tensorflow::bfloat16*>(dest), n);
+    return true;
+  }
+  if (std::is_same<S, tensorflow::bfloat16>::value &&
+      std::is_same<D, float>::value) {
+    BFloat16ToFloat(reinterpret_cast<const tensorflow::bfloat16*>(source),
+                    reinterpret_cast<float*>(dest), n);
+    return true;
+  }
+  if (IsByteType<S>::value && IsByteType<D>::value) {
+    if (std::is_same<D, bool>::value && !std::is_same<S, bool>::value) {
+      BytesToBool(reinterpret_cast<const uint8_t*>(source),
+                  reinterpret_cast<bool*>(dest), n);
+    } else {
+      std::memcpy(dest, source, n);
+    }
+    return true;
+  }
+  if (IsIntegerOfSize<S, 8>::value && IsIntegerOfSize<D, 4>::value) {
+    Int64ToInt32(reinterpret_cast<const int64_t*>(source),
+                 reinterpret_cast<int32_t*>(dest), n);
+    return true;
+  }
+  if (IsIntegerOfSize<S, 4>::value && IsIntegerOfSize<D, 8>::value) {
+    Int32ToInt64(reinterpret_cast<const int32_t*>(source),
+                 reinterpret_cast<int64_t*>(dest), n);
+    return true;
+  }
+  return false;
+}
+
+}  // namespace copy_kernels
+}  // namespace torch_xla
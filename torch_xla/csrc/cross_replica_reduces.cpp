@@ -2,24 +2,112 @@
 
 #include <vector>
 
+#include "tensorflow/compiler/xla/client/lib/constants.h"
+#include "tensorflow/compiler/xla/shape_util.h"
+#include "tensorflow/compiler/xla/xla_client/debug_macros.h"
+#include "tensorflow/compiler/xla/xla_client/util.h"
 #include "torch_xla/csrc/helpers.h"
 
 namespace torch_xla {
+namespace {
 
-xla::XlaOp BuildCrossReplicaSum(
-    const xla::XlaOp& operand, double scale,
+bool IsCompressed(xla::PrimitiveType type,
+                  CrossReplicaSumCompression compression) {
+  return compression == CrossReplicaSumCompression::kBF16 &&
+         (type == xla::PrimitiveType::F32 || type == xla::PrimitiveType::F64);
+}
+
+std::vector<xla::ReplicaGroup> CreateReplicaGroups(
     const std::vector<std::vector<xla::int64>>& groups) {
-  std::vector<xla::ReplicaGroup> crs_groups;
+  std::vector<xla::ReplicaGroup> replica_groups;
   for (auto& group : groups) {
     xla::ReplicaGroup rgroup;
     for (auto replica_id : group) {
       rgroup.add_replica_ids(replica_id);
     }
-    crs_groups.push_back(std::move(rgroup));
+    replica_groups.push_back(std::move(rgroup));
+  }
+  return replica_groups;
+}
+
+// Returns a tensor shaped as [shard_count, ...] having the i-th slice along dim
+// of the operand at index i.
+xla::XlaOp SplitToMajorDimension(const xla::XlaOp& operand, xla::int64 dim,
+                                 xla::int64 shard_count) {
+  xla::Shape shape = XlaHelpers::ShapeOfXlaOp(operand);
+  XLA_CHECK_EQ(shape.dimensions(dim) % shard_count, 0)
+      << "Dimension " << dim << " of " << shape
+      << " is not divisible by the shard count " << shard_count;
+  std::vector<xla::int64> sizes = XlaHelpers::SizesOfXlaOp(operand);
+  sizes[dim] /= shard_count;
+  sizes.insert(sizes.begin() + dim, shard_count);
+  std::vector<xla::int64> permutation =
+      xla::util::Iota<xla::int64>(sizes.size());
+  permutation.erase(permutation.begin() + dim);
+  permutation.insert(permutation.begin(), dim);
+  return xla::Transpose(xla::Reshape(operand, sizes), permutation);
+}
+
+// Sums the operand across all the replicas of host_groups, with a reduce
+// scatter within every host, a sum of the shards across the hosts, and an all
+// gather within every host. Only the shards, being 1/K of the operand (K being
+// the number of replicas per host), cross the hosts.
+xla::XlaOp BuildHierarchicalSum(
+    const xla::XlaOp& operand,
+    const std::vector<std::vector<xla::int64>>& host_groups) {
+  xla::int64 host_size = host_groups.front().size();
+  std::vector<std::vector<xla::int64>> cross_host_groups(host_size);
+  for (auto& group : host_groups) {
+    XLA_CHECK_EQ(group.size(), host_size)
+        << "All the hosts must have the same number of replicas";
+    for (xla::int64 i = 0; i < host_size; ++i) {
+      cross_host_groups[i].push_back(group[i]);
+    }
+  }
+  xla::Shape shape = XlaHelpers::ShapeOfXlaOp(operand);
+  xla::int64 size = xla::ShapeUtil::ElementsIn(shape);
+  xla::int64 padded_size = (size + host_size - 1) / host_size * host_size;
+  xla::XlaOp flat = xla::Reshape(operand, {size});
+  if (padded_size != size) {
+    xla::PaddingConfig padding_config;
+    padding_config.add_dimensions()->set_edge_padding_high(padded_size - size);
+    flat = xla::Pad(flat, xla::Zero(operand.builder(), shape.element_type()),
+                    padding_config);
+  }
+  xla::XlaOp shard = BuildReduceScatter(flat, /*scale=*/1.0, /*dim=*/0,
+                                        host_size, host_groups);
+  shard = xla::CrossReplicaSum(shard, CreateReplicaGroups(cross_host_groups));
+  xla::XlaOp gathered =
+      BuildAllGather(shard, /*dim=*/0, host_size, host_groups);
+  return xla::Reshape(xla::SliceInDim(gathered, 0, size, 1, 0),
+                      shape.dimensions());
+}
+
+}  // namespace
+
+xla::XlaOp BuildCrossReplicaSum(
+    const xla::XlaOp& operand, double scale,
+    const std::vector<std::vector<xla::int64>>& groups,
+    CrossReplicaSumCompression compression,
+    const std::vector<std::vector<xla::int64>>& host_groups) {
+  xla::Shape shape = XlaHelpers::ShapeOfXlaOp(operand);
+  bool compressed = IsCompressed(shape.element_type(), compression);
+  // With compression, the sum itself runs in BF16 within the collectives, but
+  // the result is scaled in the operand type.
+  xla::XlaOp crs =
+      compressed ? xla::ConvertElementType(operand, xla::PrimitiveType::BF16)
+                 : operand;
+  if (host_groups.empty()) {
+    crs = xla::CrossReplicaSum(crs, CreateReplicaGroups(groups));
+  } else {
+    XLA_CHECK(groups.empty())
+        << "Hierarchical cross replica sums span all the replicas";
+    crs = BuildHierarchicalSum(crs, host_groups);
+  }
+  if (compressed) {
+    crs = xla::ConvertElementType(crs, shape.element_type());
   }
-  xla::XlaOp crs = xla::CrossReplicaSum(operand, crs_groups);
   if (scale != 1.0) {
-    xla::Shape shape = XlaHelpers::ShapeOfXlaOp(operand);
     xla::XlaOp scaling_value = XlaHelpers::ScalarValue<float>(
         scale, shape.element_type(), operand.builder());
     crs = crs * scaling_value;
@@ -27,4 +115,99 @@ xla::XlaOp BuildCrossReplicaSum(
   return crs;
 }
 
+std::vector<xla::XlaOp> BuildCrossReplicaSum(
+    tensorflow::gtl::ArraySlice<const xla::XlaOp> operands, double scale,
+    const std::vector<std::vector<xla::int64>>& groups,
+    CrossReplicaSumCompression compression,
+    const std::vector<std::vector<xla::int64>>& host_groups) {
+  XLA_CHECK(!operands.empty());
+  if (operands.size() == 1) {
+    return {BuildCrossReplicaSum(operands[0], scale, groups, compression,
+                                 host_groups)};
+  }
+  std::vector<xla::Shape> shapes;
+  std::vector<xla::XlaOp> flat_operands;
+  for (auto& operand : operands) {
+    shapes.push_back(XlaHelpers::ShapeOfXlaOp(operand));
+    XLA_CHECK_EQ(shapes.back().element_type(), shapes.front().element_type())
+        << "Cross replica sum operands must have the same type: "
+        << shapes.back() << " vs " << shapes.front();
+    flat_operands.push_back(
+        xla::Reshape(operand, {xla::ShapeUtil::ElementsIn(shapes.back())}));
+  }
+  xla::XlaOp crs = BuildCrossReplicaSum(
+      xla::ConcatInDim(operands[0].builder(), flat_operands, 0), scale, groups,
+      compression, host_groups);
+  std::vector<xla::XlaOp> results;
+  xla::int64 offset = 0;
+  for (auto& shape : shapes) {
+    xla::int64 size = xla::ShapeUtil::ElementsIn(shape);
+    results.push_back(xla::Reshape(
+        xla::SliceInDim(crs, offset, offset + size, 1, 0), shape.dimensions()));
+    offset += size;
+  }
+  return results;
+}
+
+xla::XlaOp BuildAllGather(const xla::XlaOp& operand, xla::int64 dim,
+                          xla::int64 shard_count,
+                          const std::vector<std::vector<xla::int64>>& groups) {
+  // Every replica sends a copy of its operand to all the others, and receives
+  // theirs stacked along a new major dimension, which gets then merged within
+  // dim.
+  std::vector<xla::int64> sizes = XlaHelpers::SizesOfXlaOp(operand);
+  xla::XlaOp gathered = xla::AllToAll(
+      xla::Broadcast(operand, {shard_count}), /*split_dimension=*/0,
+      /*concat_dimension=*/0, shard_count, CreateReplicaGroups(groups));
+  std::vector<xla::int64> permutation =
+      xla::util::Iota<xla::int64>(sizes.size(), 1);
+  permutation.insert(permutation.begin() + dim, 0);
+  sizes[dim] *= shard_count;
+  return xla::Reshape(xla::Transpose(gathered, permutation), sizes);
+}
+
+xla::XlaOp BuildReduceScatter(
+    const xla::XlaOp& operand, double scale, xla::int64 dim,
+    xla::int64 shard_count,
+    const std::vector<std::vector<xla::int64>>& groups) {
+  // Every replica receives the slice matching its group index from all the
+  // others, stacked along a new major dimension, and sums them up.
+  xla::PrimitiveType type = XlaHelpers::TypeOfXlaOp(operand);
+  xla::XlaOp shards = xla::AllToAll(
+      SplitToMajorDimension(operand, dim, shard_count), /*split_dimension=*/0,
+      /*concat_dimension=*/0, shard_count, CreateReplicaGroups(groups));
+  xla::XlaOp result =
+      xla::Reduce(shards, xla::Zero(operand.builder(), type),
+                  XlaHelpers::CreateAddComputation(type), {0});
+  if (scale != 1.0) {
+    result =
+        result * XlaHelpers::ScalarValue<float>(scale, type, operand.builder());
+  }
+  return result;
+}
+
+xla::XlaOp BuildAllToAll(const xla::XlaOp& operand, xla::int64 split_dimension,
+                         xla::int64 concat_dimension, xla::int64 split_count,
+                         const std::vector<std::vector<xla::int64>>& groups) {
+  return xla::AllToAll(operand, split_dimension, concat_dimension, split_count,
+                       CreateReplicaGroups(groups));
+}
+
+xla::XlaOp BuildCollectivePermute(
+    const xla::XlaOp& operand,
+    const std::vector<std::pair<xla::int64, xla::int64>>& source_target_pairs) {
+  return xla::CollectivePermute(operand, source_target_pairs);
+}
+
+xla::XlaOp BuildCompressionResidual(const xla::XlaOp& operand,
+                                    CrossReplicaSumCompression compression) {
+  xla::PrimitiveType type = XlaHelpers::TypeOfXlaOp(operand);
+  if (!IsCompressed(type, compression)) {
+    return xla::ZerosLike(operand);
+  }
+  return operand -
+         xla::ConvertElementType(
+             xla::ConvertElementType(operand, xla::PrimitiveType::BF16), type);
+}
+
 }  // namespace torch_xla
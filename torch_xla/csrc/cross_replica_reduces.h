@@ -1,13 +1,71 @@
 #pragma once
 
+#include <utility>
+#include <vector>
+
 #include "tensorflow/compiler/xla/client/xla_builder.h"
+#include "tensorflow/core/lib/gtl/array_slice.h"
 
 namespace torch_xla {
 
+// The encoding of the values exchanged by the Cross Replica Sum operations.
+// With kBF16, the F32 and F64 operands are converted to BF16 before the
+// collective, and the results are converted back to the operand type, which
+// halves (or quarters) the exchanged bytes.
+enum class CrossReplicaSumCompression { kNone, kBF16 };
+
 // Builds a Cross Replica Sum operation on the operand, and scales the result by
-// scale.
+// scale. If host_groups is not empty, it lists the replicas of every host, all
+// hosts having the same number of replicas, and the sum is carried out
+// hierarchically across all the replicas (groups must be empty): a reduce
+// scatter within the hosts, a sum of the shards across the hosts, and an all
+// gather within the hosts.
 xla::XlaOp BuildCrossReplicaSum(
     const xla::XlaOp& operand, double scale,
+    const std::vector<std::vector<xla::int64>>& groups,
+    CrossReplicaSumCompression compression = CrossReplicaSumCompression::kNone,
+    const std::vector<std::vector<xla::int64>>& host_groups = {});
+
+// Builds a single Cross Replica Sum operation over all the operands, which
+// must have the same element type, by flattening and concatenating them, and
+// slicing the results back to the operands shapes.
+std::vector<xla::XlaOp> BuildCrossReplicaSum(
+    tensorflow::gtl::ArraySlice<const xla::XlaOp> operands, double scale,
+    const std::vector<std::vector<xla::int64>>& groups,
+    CrossReplicaSumCompression compression = CrossReplicaSumCompression::kNone,
+    const std::vector<std::vector<xla::int64>>& host_groups = {});
+
+// Concatenates the operands of the shard_count replicas of every group (or of
+// all the replicas if groups is empty) along dim, in replica order.
+xla::XlaOp BuildAllGather(const xla::XlaOp& operand, xla::int64 dim,
+                          xla::int64 shard_count,
+                          const std::vector<std::vector<xla::int64>>& groups);
+
+// Sums the operands across the shard_count replicas of every group (or all the
+// replicas if groups is empty), scales the result by scale, and returns the
+// i-th of its shard_count slices along dim, i being the replica index within
+// the group. The dim size must be a multiple of shard_count.
+xla::XlaOp BuildReduceScatter(
+    const xla::XlaOp& operand, double scale, xla::int64 dim,
+    xla::int64 shard_count,
     const std::vector<std::vector<xla::int64>>& groups);
 
+// Splits the operand in split_count slices along split_dimension, sends the
+// j-th slice to the j-th replica of the group, and concatenates the received
+// slices along concat_dimension.
+xla::XlaOp BuildAllToAll(const xla::XlaOp& operand, xla::int64 split_dimension,
+                         xla::int64 concat_dimension, xla::int64 split_count,
+                         const std::vector<std::vector<xla::int64>>& groups);
+
+// Sends the operand of every source replica to its target replica. The
+// replicas which are not targets of any pair get zeros.
+xla::XlaOp BuildCollectivePermute(
+    const xla::XlaOp& operand,
+    const std::vector<std::pair<xla::int64, xla::int64>>& source_target_pairs);
+
+// Returns the error which the compression introduces on the operand, which is
+// zero for the types that do not get compressed.
+xla::XlaOp BuildCompressionResidual(const xla::XlaOp& operand,
+                                    CrossReplicaSumCompression compression);
+
 }  // namespace torch_xla
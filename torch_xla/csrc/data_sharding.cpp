@@ -0,0 +1,81 @@
+#include "torch_xla/csrc/data_sharding.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <numeric>
+#include <random>
+#include <string>
+#include <utility>
+
+#include "tensorflow/compiler/xla/xla_client/computation_client.h"
+#include "tensorflow/compiler/xla/xla_client/debug_macros.h"
+#include "torch_xla/csrc/device.h"
+
+namespace torch_xla {
+namespace {
+
+// Runs a Fisher-Yates shuffle drawing straight from the generator, as the
+// std::shuffle() and std::uniform_int_distribution algorithms are
+// implementation defined, and hosts could end up with different permutations.
+void Shuffle(std::vector<xla::int64>* indices, std::mt19937_64* generator) {
+  for (size_t i = indices->size(); i > 1; --i) {
+    size_t j = (*generator)() % i;
+    std::swap((*indices)[i - 1], (*indices)[j]);
+  }
+}
+
+}  // namespace
+
+DataShardPosition GetDataShardPosition() {
+  std::vector<std::string> local_devices =
+      xla::ComputationClient::Get()->GetLocalDevices();
+  XLA_CHECK(!local_devices.empty());
+  DeviceType local_type = Device(local_devices.front()).hw_type;
+  std::vector<std::string> devices;
+  for (auto& device_str : xla::ComputationClient::Get()->GetAllDevices()) {
+    if (Device(device_str).hw_type == local_type) {
+      devices.push_back(device_str);
+    }
+  }
+  std::sort(devices.begin(), devices.end(),
+            [](const std::string& d1, const std::string& d2) {
+              return Device(d1).ordinal < Device(d2).ordinal;
+            });
+  auto it = std::find(devices.begin(), devices.end(), local_devices.front());
+  XLA_CHECK(it != devices.end()) << local_devices.front();
+  DataShardPosition position;
+  position.local_devices = local_devices.size();
+  position.count = std::max<xla::int64>(
+      devices.size() / local_devices.size(), 1);
+  position.index = (it - devices.begin()) / local_devices.size();
+  return position;
+}
+
+std::vector<xla::int64> GetDataShardIndices(
+    const DataShardPosition& position, xla::int64 dataset_size,
+    xla::int64 seed, xla::int64 epoch, bool shuffle, bool drop_last,
+    xla::int64 granule) {
+  XLA_CHECK_GT(position.count, 0);
+  XLA_CHECK_LT(position.index, position.count);
+  XLA_CHECK_GT(granule, 0);
+  std::vector<xla::int64> indices(dataset_size);
+  std::iota(indices.begin(), indices.end(), 0);
+  if (shuffle) {
+    std::seed_seq seeds{static_cast<std::uint64_t>(seed),
+                        static_cast<std::uint64_t>(epoch)};
+    std::mt19937_64 generator(seeds);
+    Shuffle(&indices, &generator);
+  }
+  xla::int64 chunk_size = position.count * granule;
+  xla::int64 total_size =
+      drop_last ? (dataset_size / chunk_size) * chunk_size
+                : ((dataset_size + chunk_size - 1) / chunk_size) * chunk_size;
+  std::vector<xla::int64> shard;
+  shard.reserve(total_size / position.count);
+  for (xla::int64 i = position.index; i < total_size; i += position.count) {
+    shard.push_back(indices[i % dataset_size]);
+  }
+  return shard;
+}
+
+}  // namespace torch_xla
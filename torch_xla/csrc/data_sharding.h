@@ -0,0 +1,35 @@
+#pragma once
+
+#include <vector>
+
+#include "tensorflow/compiler/xla/types.h"
+
+namespace torch_xla {
+
+// The position of the local host within the input sharding. Every host (or
+// process, in multi-processing mode) owning a set of local devices reads its
+// own shard of the dataset.
+struct DataShardPosition {
+  xla::int64 index = 0;
+  xla::int64 count = 1;
+  xla::int64 local_devices = 1;
+};
+
+// Computes the shard position of the local devices, out of all the devices of
+// the same kind within the mesh configuration. All the hosts get the same
+// answer for the same configuration, as the global device list is sorted.
+DataShardPosition GetDataShardPosition();
+
+// Returns the dataset indices of the shard at the given position. With shuffle,
+// the indices are permuted with a generator seeded by (seed, epoch), which
+// makes the permutation identical on all the hosts. The dataset is padded by
+// wrapping around (or truncated, with drop_last) to a multiple of
+// position.count * granule elements, so that all the hosts get the same number
+// of elements and run the same number of steps. Shards take every
+// position.count-th index.
+std::vector<xla::int64> GetDataShardIndices(
+    const DataShardPosition& position, xla::int64 dataset_size,
+    xla::int64 seed, xla::int64 epoch, bool shuffle, bool drop_last,
+    xla::int64 granule);
+
+}  // namespace torch_xla
@@ -1,11 +1,19 @@
 #include "torch_xla/csrc/debug_util.h"
 
+#include <condition_variable>
+#include <cstdlib>
+#include <deque>
 #include <fstream>
 #include <mutex>
 #include <sstream>
+#include <thread>
+#include <unordered_set>
 
 #include "tensorflow/compiler/xla/xla_client/debug_macros.h"
+#include "tensorflow/compiler/xla/xla_client/metrics.h"
 #include "tensorflow/compiler/xla/xla_client/sys_util.h"
+#include "tensorflow/compiler/xla/xla_client/tf_logging.h"
+#include "tensorflow/compiler/xla/xla_client/util.h"
 #include "torch_xla/csrc/ir.h"
 #include "torch_xla/csrc/ir_dump_util.h"
 #include "torch_xla/csrc/ir_util.h"
@@ -27,47 +35,46 @@ DebugUtil::GraphFormat DefaultGraphFormat() {
   XLA_ERROR() << "Invalid save graph format: " << fmt_str;
 }
 
-}  // namespace
-
-DebugUtil::GraphFormat DebugUtil::GetDefaultGraphFormat() {
-  static GraphFormat format = DefaultGraphFormat();
-  return format;
-}
-
-std::string DebugUtil::GetTensorsGraphInfo(
+std::vector<ir::Value> GetRootValues(
     tensorflow::gtl::ArraySlice<const XLATensor> tensors,
-    const std::vector<size_t>* indices, GraphFormat format) {
-  std::vector<const ir::Node*> root_nodes;
+    const std::vector<size_t>* indices) {
   std::vector<ir::Value> root_values;
+  auto add_root = [&](const XLATensor& tensor) {
+    ir::Value ir_value = tensor.CurrentIrValue();
+    if (ir_value) {
+      root_values.push_back(std::move(ir_value));
+    }
+  };
   if (indices != nullptr) {
     for (auto index : *indices) {
-      ir::Value ir_value = tensors[index].CurrentIrValue();
-      if (ir_value) {
-        root_nodes.push_back(ir_value.node.get());
-        root_values.push_back(std::move(ir_value));
-      }
+      add_root(tensors[index]);
     }
   } else {
     for (auto& tensor : tensors) {
-      ir::Value ir_value = tensor.CurrentIrValue();
-      if (ir_value) {
-        root_nodes.push_back(ir_value.node.get());
-        root_values.push_back(std::move(ir_value));
-      }
+      add_root(tensor);
     }
   }
+  return root_values;
+}
+
+std::string RenderGraphInfo(const std::vector<SourceLocation>& frames,
+                            const std::vector<ir::Value>& root_values,
+                            DebugUtil::GraphFormat format) {
+  std::vector<const ir::Node*> root_nodes;
+  for (auto& ir_value : root_values) {
+    root_nodes.push_back(ir_value.node.get());
+  }
   std::stringstream ss;
-  std::vector<SourceLocation> frames = GetPythonFrames();
   ss << "TensorsGraphInfo:\n";
   for (auto& location : frames) {
     ss << "  " << location.function << " (" << location.file << ":"
        << location.line << ")\n";
   }
-  if (format == GraphFormat::kText) {
+  if (format == DebugUtil::GraphFormat::kText) {
     ss << "\n" << ir::DumpUtil::ToText(root_nodes) << "\n";
-  } else if (format == GraphFormat::kDot) {
+  } else if (format == DebugUtil::GraphFormat::kDot) {
     ss << "\n" << ir::DumpUtil::ToText(root_nodes) << "\n";
-  } else if (format == GraphFormat::kHlo) {
+  } else if (format == DebugUtil::GraphFormat::kHlo) {
     ss << "\n" << ir::DumpUtil::ToHlo(root_values) << "\n";
   } else {
     XLA_ERROR() << "Invalid graph format: " << format;
@@ -75,18 +82,144 @@ std::string DebugUtil::GetTensorsGraphInfo(
   return ss.str();
 }
 
+// Renders the graphs, and appends them to the XLA_SAVE_TENSORS_FILE file, from
+// a background thread. The callers only snapshot the graph roots and the Python
+// frames, and the graph dumps are dropped if more than XLA_SAVE_TENSORS_QUEUE
+// are pending.
+class GraphDumpWriter {
+ public:
+  struct Dump {
+    std::string name;
+    std::vector<SourceLocation> frames;
+    std::vector<ir::Value> root_values;
+    DebugUtil::GraphFormat format;
+  };
+
+  static GraphDumpWriter* Get() {
+    static GraphDumpWriter* writer = Create();
+    return writer;
+  }
+
+  GraphDumpWriter(std::string path, size_t max_pending)
+      : path_(std::move(path)),
+        max_pending_(max_pending),
+        thread_([this]() { Run(); }) {}
+
+  void Enqueue(Dump dump) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (dumps_.size() >= max_pending_) {
+      XLA_COUNTER("DroppedGraphDumps", 1);
+      return;
+    }
+    dumps_.push_back(std::move(dump));
+    cv_.notify_all();
+  }
+
+  // Waits for all the queued graphs to be written.
+  void Flush() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    cv_.wait(lock, [this] { return dumps_.empty() && !writing_; });
+  }
+
+ private:
+  static GraphDumpWriter* Create() {
+    static const size_t max_pending =
+        xla::sys_util::GetEnvInt("XLA_SAVE_TENSORS_QUEUE", 64);
+    // The writer thread is never stopped, as the IR graphs it references might
+    // need statics which are gone at exit time. The pending graphs are flushed
+    // at exit instead.
+    GraphDumpWriter* writer = new GraphDumpWriter(
+        xla::sys_util::GetEnvString("XLA_SAVE_TENSORS_FILE", ""), max_pending);
+    writer->thread_.detach();
+    std::atexit([]() { Get()->Flush(); });
+    return writer;
+  }
+
+  void Run() {
+    while (true) {
+      Dump dump;
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, [this] { return !dumps_.empty(); });
+        dump = std::move(dumps_.front());
+        dumps_.pop_front();
+        writing_ = true;
+      }
+      try {
+        XLA_TIMED("GraphDumpTime");
+        std::string info =
+            RenderGraphInfo(dump.frames, dump.root_values, dump.format);
+        // Release the graph before writing it out.
+        dump.root_values.clear();
+        std::ofstream graph_file(path_, std::ios_base::app);
+        graph_file << "[" << dump.name << "]\n" << info << "\n";
+      } catch (const std::exception& ex) {
+        TF_LOG(ERROR) << "Failed to dump graph " << dump.name << ": "
+                      << ex.what();
+      }
+      std::lock_guard<std::mutex> lock(mutex_);
+      writing_ = false;
+      cv_.notify_all();
+    }
+  }
+
+  std::string path_;
+  size_t max_pending_ = 0;
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::deque<Dump> dumps_;
+  bool writing_ = false;
+  std::thread thread_;
+};
+
+// Returns whether the graph has not been dumped before. Only checked if
+// XLA_SAVE_TENSORS_UNIQUE is true (the default).
+bool IsNewGraph(const char* name, const std::vector<ir::Value>& root_values,
+                DebugUtil::GraphFormat format) {
+  static const bool unique_graphs =
+      xla::sys_util::GetEnvBool("XLA_SAVE_TENSORS_UNIQUE", true);
+  if (!unique_graphs) {
+    return true;
+  }
+  static std::mutex lock;
+  static std::unordered_set<size_t>* seen_hashes =
+      new std::unordered_set<size_t>();
+  size_t hash = xla::util::MHash(std::string(name), static_cast<int>(format));
+  for (auto& ir_value : root_values) {
+    hash = xla::util::HashCombine(hash, ir_value.hash());
+  }
+  std::lock_guard<std::mutex> guard(lock);
+  return seen_hashes->insert(hash).second;
+}
+
+}  // namespace
+
+DebugUtil::GraphFormat DebugUtil::GetDefaultGraphFormat() {
+  static GraphFormat format = DefaultGraphFormat();
+  return format;
+}
+
+std::string DebugUtil::GetTensorsGraphInfo(
+    tensorflow::gtl::ArraySlice<const XLATensor> tensors,
+    const std::vector<size_t>* indices, GraphFormat format) {
+  return RenderGraphInfo(GetPythonFrames(), GetRootValues(tensors, indices),
+                         format);
+}
+
 void DebugUtil::SaveTensorsGraphInfo(
     const char* name, tensorflow::gtl::ArraySlice<const XLATensor> tensors,
     const std::vector<size_t>* indices, GraphFormat format) {
-  static const std::string save_file =
-      xla::sys_util::GetEnvString("XLA_SAVE_TENSORS_FILE", "");
-  if (!save_file.empty()) {
-    static std::mutex lock;
-    std::string info = GetTensorsGraphInfo(tensors, indices, format);
-    std::lock_guard<std::mutex> guard(lock);
-    std::ofstream graph_file(save_file, std::ios_base::app);
-    graph_file << "[" << name << "]\n" << info << "\n";
+  static const bool save_graphs =
+      !xla::sys_util::GetEnvString("XLA_SAVE_TENSORS_FILE", "").empty();
+  if (!save_graphs) {
+    return;
+  }
+  std::vector<ir::Value> root_values = GetRootValues(tensors, indices);
+  if (!IsNewGraph(name, root_values, format)) {
+    return;
   }
+  GraphDumpWriter::Get()->Enqueue(
+      {name, GetPythonFrames(), std::move(root_values), format});
 }
 
 }  // namespace torch_xla
@@ -29,7 +29,10 @@ class DebugUtil {
 
   // If the environment variable XLA_SAVE_TENSORS_FILE is set to the proper
   // output path, an instance of the report returned by GetTensorsGraphInfo() is
-  // saved.
+  // saved. Only the graph roots and the Python frames are captured by the
+  // caller, while the report is rendered and written by a background thread.
+  // Unless XLA_SAVE_TENSORS_UNIQUE is set to false, the graphs which have
+  // already been saved (by graph hash) are skipped.
   static void SaveTensorsGraphInfo(
       const char* name, tensorflow::gtl::ArraySlice<const XLATensor> tensors,
       const std::vector<size_t>* indices,
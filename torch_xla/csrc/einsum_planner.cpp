@@ -0,0 +1,258 @@
+#include "torch_xla/csrc/einsum_planner.h"
+
+#include <algorithm>
+#include <cctype>
+#include <map>
+#include <set>
+
+#include "absl/strings/str_split.h"
+#include "tensorflow/compiler/xla/xla_client/cache.h"
+#include "tensorflow/compiler/xla/xla_client/debug_macros.h"
+#include "tensorflow/compiler/xla/xla_client/metrics.h"
+#include "tensorflow/compiler/xla/xla_client/util.h"
+#include "tensorflow/compiler/xla/xla_client/xla_util.h"
+#include "torch_xla/csrc/helpers.h"
+
+namespace torch_xla {
+namespace {
+
+using PlanCache = xla::util::Cache<size_t, EinsumPlan>;
+
+PlanCache* GetPlanCache() {
+  static const size_t kMaxPlanCacheSize = 1024;
+  static PlanCache* cache = new PlanCache(kMaxPlanCacheSize);
+  return cache;
+}
+
+bool HasLabel(const std::string& labels, char label) {
+  return labels.find(label) != std::string::npos;
+}
+
+// Fills up the dimension numbers of the contraction of the lhs and rhs labels,
+// which keeps the labels within keep, and returns the labels of its result.
+// The batch labels are ordered as they appear within batch_order, and then
+// within lhs.
+std::string ContractLabels(const std::string& lhs, const std::string& rhs,
+                           const std::string& keep,
+                           const std::string& batch_order,
+                           xla::DotDimensionNumbers* dimension_numbers) {
+  std::string batch;
+  for (char label : batch_order + lhs) {
+    if (!HasLabel(batch, label) && HasLabel(lhs, label) &&
+        HasLabel(rhs, label) && HasLabel(keep, label)) {
+      batch.push_back(label);
+    }
+  }
+  for (char label : batch) {
+    dimension_numbers->add_lhs_batch_dimensions(lhs.find(label));
+    dimension_numbers->add_rhs_batch_dimensions(rhs.find(label));
+  }
+  std::string result = batch;
+  for (size_t i = 0; i < lhs.size(); ++i) {
+    if (!HasLabel(rhs, lhs[i])) {
+      result.push_back(lhs[i]);
+    } else if (!HasLabel(keep, lhs[i])) {
+      dimension_numbers->add_lhs_contracting_dimensions(i);
+      dimension_numbers->add_rhs_contracting_dimensions(rhs.find(lhs[i]));
+    }
+  }
+  for (char label : rhs) {
+    if (!HasLabel(lhs, label)) {
+      result.push_back(label);
+    }
+  }
+  return result;
+}
+
+xla::int64 LabelsSize(const std::string& labels,
+                      const std::map<char, xla::int64>& label_sizes) {
+  xla::int64 size = 1;
+  for (char label : labels) {
+    size *= label_sizes.at(label);
+  }
+  return size;
+}
+
+}  // namespace
+
+std::shared_ptr<const EinsumPlan> EinsumPlan::Get(
+    const std::string& equation,
+    tensorflow::gtl::ArraySlice<const xla::Shape> shapes) {
+  size_t hash = xla::util::MHash(equation);
+  for (auto& shape : shapes) {
+    hash = xla::util::HashCombine(hash, xla::util::ShapeHash(shape));
+  }
+  std::shared_ptr<EinsumPlan> plan = GetPlanCache()->Get(hash);
+  if (plan != nullptr) {
+    return plan;
+  }
+  Equation parsed;
+  if (!ParseEquation(equation, shapes.size(), &parsed)) {
+    return nullptr;
+  }
+  XLA_COUNTER("EinsumPlans", 1);
+  plan.reset(new EinsumPlan(parsed, shapes));
+  return GetPlanCache()->Add(hash, std::move(plan));
+}
+
+bool EinsumPlan::SupportsEquation(const std::string& equation,
+                                  size_t num_operands) {
+  Equation parsed;
+  return ParseEquation(equation, num_operands, &parsed);
+}
+
+bool EinsumPlan::ParseEquation(const std::string& equation,
+                               size_t num_operands, Equation* parsed) {
+  std::string compact_equation;
+  for (char c : equation) {
+    if (!std::isspace(static_cast<unsigned char>(c))) {
+      compact_equation.push_back(c);
+    }
+  }
+  size_t arrow_pos = compact_equation.find("->");
+  parsed->inputs = absl::StrSplit(compact_equation.substr(0, arrow_pos), ',');
+  if (parsed->inputs.size() != num_operands) {
+    return false;
+  }
+  std::map<char, int> label_uses;
+  for (auto& input : parsed->inputs) {
+    std::set<char> labels;
+    for (char label : input) {
+      // Ellipsis and diagonals (labels repeated within an operand) are left to
+      // the generic einsum implementations.
+      if (!std::isalpha(static_cast<unsigned char>(label)) ||
+          !labels.insert(label).second) {
+        return false;
+      }
+      label_uses[label] += 1;
+    }
+  }
+  parsed->output.clear();
+  if (arrow_pos == std::string::npos) {
+    // In implicit mode the output has the labels appearing only once, in
+    // alphabetical order.
+    for (auto& label_count : label_uses) {
+      if (label_count.second == 1) {
+        parsed->output.push_back(label_count.first);
+      }
+    }
+  } else {
+    for (char label : compact_equation.substr(arrow_pos + 2)) {
+      if (label_uses.count(label) == 0 || HasLabel(parsed->output, label)) {
+        return false;
+      }
+      parsed->output.push_back(label);
+    }
+  }
+  return true;
+}
+
+EinsumPlan::EinsumPlan(const Equation& equation,
+                       tensorflow::gtl::ArraySlice<const xla::Shape> shapes) {
+  std::map<char, xla::int64> label_sizes;
+  std::map<char, int> label_uses;
+  for (size_t i = 0; i < shapes.size(); ++i) {
+    const std::string& labels = equation.inputs[i];
+    XLA_CHECK_EQ(labels.size(), shapes[i].rank())
+        << "Einsum operand " << i << " has rank " << shapes[i].rank()
+        << " but the equation has " << labels.size() << " labels for it";
+    for (size_t dim = 0; dim < labels.size(); ++dim) {
+      auto it = label_sizes.emplace(labels[dim], shapes[i].dimensions(dim));
+      XLA_CHECK_EQ(it.first->second, shapes[i].dimensions(dim))
+          << "Mismatching sizes for einsum label '" << labels[dim] << "'";
+      label_uses[labels[dim]] += 1;
+    }
+  }
+  std::vector<std::string> working;
+  for (auto& labels : equation.inputs) {
+    std::vector<xla::int64> reduce_dimensions;
+    std::string kept_labels;
+    for (size_t dim = 0; dim < labels.size(); ++dim) {
+      if (label_uses[labels[dim]] == 1 &&
+          !HasLabel(equation.output, labels[dim])) {
+        reduce_dimensions.push_back(dim);
+      } else {
+        kept_labels.push_back(labels[dim]);
+      }
+    }
+    reduce_dimensions_.push_back(std::move(reduce_dimensions));
+    working.push_back(std::move(kept_labels));
+  }
+  while (working.size() > 1) {
+    // The last contraction can pick the operand order producing the output
+    // labels order, which saves the final transpose.
+    bool last = working.size() == 2;
+    Contraction best;
+    std::string best_labels;
+    xla::int64 best_size = -1;
+    for (size_t i = 0; i < working.size(); ++i) {
+      for (size_t j = last ? 0 : i + 1; j < working.size(); ++j) {
+        if (i == j) {
+          continue;
+        }
+        std::string keep = equation.output;
+        for (size_t k = 0; k < working.size(); ++k) {
+          if (k != i && k != j) {
+            keep += working[k];
+          }
+        }
+        Contraction contraction;
+        contraction.lhs = i;
+        contraction.rhs = j;
+        std::string labels = ContractLabels(
+            working[i], working[j], keep, last ? equation.output : working[i],
+            &contraction.dimension_numbers);
+        xla::int64 size = LabelsSize(labels, label_sizes);
+        if (best_size < 0 || size < best_size ||
+            (last && labels == equation.output &&
+             best_labels != equation.output)) {
+          best = std::move(contraction);
+          best_labels = std::move(labels);
+          best_size = size;
+        }
+      }
+    }
+    working.erase(working.begin() + std::max(best.lhs, best.rhs));
+    working.erase(working.begin() + std::min(best.lhs, best.rhs));
+    working.push_back(std::move(best_labels));
+    contractions_.push_back(std::move(best));
+  }
+  if (working.front() != equation.output) {
+    for (char label : equation.output) {
+      output_permutation_.push_back(working.front().find(label));
+    }
+  }
+}
+
+xla::XlaOp EinsumPlan::Build(
+    tensorflow::gtl::ArraySlice<const xla::XlaOp> operands) const {
+  XLA_CHECK_EQ(operands.size(), reduce_dimensions_.size());
+  std::vector<xla::XlaOp> working;
+  for (size_t i = 0; i < operands.size(); ++i) {
+    xla::XlaOp operand = operands[i];
+    if (!reduce_dimensions_[i].empty()) {
+      xla::PrimitiveType type = XlaHelpers::TypeOfXlaOp(operand);
+      operand = xla::Reduce(
+          operand, XlaHelpers::ScalarValue<float>(0, type, operand.builder()),
+          XlaHelpers::CreateAddComputation(type), reduce_dimensions_[i]);
+    }
+    working.push_back(operand);
+  }
+  xla::PrecisionConfig precision_config =
+      XlaHelpers::BuildPrecisionConfig(XlaHelpers::mat_mul_precision());
+  for (auto& contraction : contractions_) {
+    std::pair<xla::XlaOp, xla::XlaOp> ops = XlaHelpers::PromoteValues(
+        working[contraction.lhs], working[contraction.rhs]);
+    xla::XlaOp result = xla::DotGeneral(ops.first, ops.second,
+                                        contraction.dimension_numbers,
+                                        &precision_config);
+    working.erase(working.begin() + std::max(contraction.lhs, contraction.rhs));
+    working.erase(working.begin() + std::min(contraction.lhs, contraction.rhs));
+    working.push_back(result);
+  }
+  return output_permutation_.empty()
+             ? working.front()
+             : xla::Transpose(working.front(), output_permutation_);
+}
+
+}  // namespace torch_xla
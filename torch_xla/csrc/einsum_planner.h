@@ -0,0 +1,69 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "tensorflow/compiler/xla/client/xla_builder.h"
+#include "tensorflow/compiler/xla/shape.h"
+#include "tensorflow/compiler/xla/types.h"
+#include "tensorflow/core/lib/gtl/array_slice.h"
+
+namespace torch_xla {
+
+// The lowering plan of an einsum equation, for operands of given shapes.
+// The operands are first reduced over the labels which appear nowhere else,
+// and then contracted pairwise, picking at every step the pair producing the
+// smallest intermediate result. Each contraction is a single xla::DotGeneral()
+// having the shared labels as batch or contracting dimensions, so no transposes
+// are emitted, other than a final one if the label order of the last
+// contraction does not match the equation output.
+// Equations with ellipsis, or with labels repeated within an operand, are not
+// supported by the planner.
+class EinsumPlan {
+ public:
+  // Returns the plan for the equation and shapes, out of a cache of the
+  // recently used ones, or nullptr if the equation is not supported.
+  static std::shared_ptr<const EinsumPlan> Get(
+      const std::string& equation,
+      tensorflow::gtl::ArraySlice<const xla::Shape> shapes);
+
+  // Returns whether the planner supports the equation with num_operands
+  // operands.
+  static bool SupportsEquation(const std::string& equation,
+                               size_t num_operands);
+
+  // Lowers the plan over the given operands.
+  xla::XlaOp Build(
+      tensorflow::gtl::ArraySlice<const xla::XlaOp> operands) const;
+
+ private:
+  struct Equation {
+    std::vector<std::string> inputs;
+    std::string output;
+  };
+
+  // A contraction between two of the working operands, the result of which is
+  // appended to the working operands list, after the lhs and rhs operands have
+  // been removed from it.
+  struct Contraction {
+    size_t lhs = 0;
+    size_t rhs = 0;
+    xla::DotDimensionNumbers dimension_numbers;
+  };
+
+  EinsumPlan(const Equation& equation,
+             tensorflow::gtl::ArraySlice<const xla::Shape> shapes);
+
+  static bool ParseEquation(const std::string& equation, size_t num_operands,
+                            Equation* parsed);
+
+  // The input dimensions to be summed before any contraction.
+  std::vector<std::vector<xla::int64>> reduce_dimensions_;
+  std::vector<Contraction> contractions_;
+  // The permutation to be applied to the final result, or empty if its label
+  // order already matches the equation output.
+  std::vector<xla::int64> output_permutation_;
+};
+
+}  // namespace torch_xla
@@ -2,6 +2,7 @@
 
 #include "tensorflow/compiler/xla/xla_client/debug_macros.h"
 #include "torch_xla/csrc/helpers.h"
+#include "torch_xla/csrc/random.h"
 #include "torch_xla/csrc/tensor_util.h"
 
 namespace torch_xla {
@@ -106,7 +107,8 @@ xla::XlaOp BuildLeakyRelu(const xla::XlaOp& input,
 }
 
 std::vector<xla::XlaOp> BuildRrelu(const xla::XlaOp& input, at::Scalar lower,
-                                   at::Scalar upper, bool training) {
+                                   at::Scalar upper, bool training,
+                                   const xla::XlaOp& seed) {
   xla::Shape shape = XlaHelpers::ShapeOfXlaOp(input);
   xla::XlaOp zero =
       XlaHelpers::ScalarValue(0, shape.element_type(), input.builder());
@@ -119,7 +121,7 @@ std::vector<xla::XlaOp> BuildRrelu(const xla::XlaOp& input, at::Scalar lower,
         XlaHelpers::ScalarValue(lower, shape.element_type(), input.builder());
     xla::XlaOp high =
         XlaHelpers::ScalarValue(upper, shape.element_type(), input.builder());
-    xla::XlaOp slope = xla::RngUniform(low, high, shape);
+    xla::XlaOp slope = RngUniform(seed, shape, low, high);
     noise = xla::Select(xla::Gt(input, zero), one, slope);
     output = input * noise;
   } else {
@@ -0,0 +1,227 @@
+#include "torch_xla/csrc/embedding_bag.h"
+
+#include <vector>
+
+#include "tensorflow/compiler/xla/client/lib/arithmetic.h"
+#include "tensorflow/compiler/xla/client/lib/constants.h"
+#include "tensorflow/compiler/xla/client/lib/slicing.h"
+#include "tensorflow/compiler/xla/shape_util.h"
+#include "tensorflow/compiler/xla/xla_client/debug_macros.h"
+#include "torch_xla/csrc/helpers.h"
+#include "torch_xla/csrc/tensor_util.h"
+#include "torch_xla/csrc/xla_lower_util.h"
+
+namespace torch_xla {
+namespace {
+
+// Returns the bag of every one of the num_indices positions, by a vectorized
+// binary search of the last offset not greater than the position, in
+// log2(B + 1) gathers of the offsets.
+xla::XlaOp BuildOffsetToBag(const xla::XlaOp& offsets,
+                            xla::int64 num_indices) {
+  xla::XlaBuilder* builder = offsets.builder();
+  xla::Shape offsets_shape = XlaHelpers::ShapeOfXlaOp(offsets);
+  xla::PrimitiveType type = offsets_shape.element_type();
+  xla::int64 num_bags = offsets_shape.dimensions(0);
+  xla::XlaOp positions = xla::Iota(builder, type, num_indices);
+  xla::XlaOp one = xla::One(builder, type);
+  xla::XlaOp two = XlaHelpers::ScalarValue<xla::int64>(2, type, builder);
+  xla::XlaOp last_bag =
+      XlaHelpers::ScalarValue<xla::int64>(num_bags - 1, type, builder);
+  xla::XlaOp low = xla::Broadcast(xla::Zero(builder, type), {num_indices});
+  xla::XlaOp high = xla::Broadcast(
+      XlaHelpers::ScalarValue<xla::int64>(num_bags, type, builder),
+      {num_indices});
+  for (xla::int64 range = num_bags; range > 0; range /= 2) {
+    xla::XlaOp active = xla::Lt(low, high);
+    xla::XlaOp middle = xla::Div(low + high, two);
+    xla::XlaOp middle_offset =
+        xla::TorchIndexSelect(offsets, xla::Min(middle, last_bag), 0);
+    xla::XlaOp right = xla::And(active, xla::Le(middle_offset, positions));
+    xla::XlaOp left = xla::And(active, xla::Not(right));
+    low = xla::Select(right, middle + one, low);
+    high = xla::Select(left, middle, high);
+  }
+  return low - one;
+}
+
+// Broadcasts the [N] values along the D dimension of the [N, D] shape.
+xla::XlaOp BroadcastRows(const xla::XlaOp& values, const xla::Shape& shape) {
+  return xla::BroadcastInDim(values, shape.dimensions(), {0});
+}
+
+// Scatters the [N, D] rows into the [B, D] buffer, at their [N] bag, combining
+// them with the computation.
+xla::XlaOp ScatterRows(const xla::XlaOp& buffer, const xla::XlaOp& bags,
+                       const xla::XlaOp& rows,
+                       const xla::XlaComputation& combiner) {
+  xla::ScatterDimensionNumbers dim_numbers;
+  dim_numbers.set_index_vector_dim(1);
+  dim_numbers.add_update_window_dims(1);
+  dim_numbers.add_inserted_window_dims(0);
+  dim_numbers.add_scatter_dims_to_operand_dims(0);
+  return xla::Scatter(buffer, bags, rows, combiner, dim_numbers);
+}
+
+xla::XlaOp ZeroEmptyBags(const xla::XlaOp& values,
+                         const xla::XlaOp& bag_size) {
+  xla::Shape shape = XlaHelpers::ShapeOfXlaOp(values);
+  xla::XlaOp not_empty = xla::Gt(
+      bag_size, xla::Zero(bag_size.builder(),
+                          XlaHelpers::ShapeOfXlaOp(bag_size).element_type()));
+  return xla::Select(
+      BroadcastRows(not_empty, shape), values,
+      xla::Broadcast(xla::Zero(values.builder(), shape.element_type()),
+                     shape.dimensions()));
+}
+
+}  // namespace
+
+EmbeddingBagResult BuildEmbeddingBag(const xla::XlaOp& weight,
+                                     const xla::XlaOp& indices,
+                                     const xla::XlaOp& offsets,
+                                     const xla::XlaOp& per_sample_weights,
+                                     EmbeddingBagMode mode) {
+  xla::XlaBuilder* builder = weight.builder();
+  xla::Shape weight_shape = XlaHelpers::ShapeOfXlaOp(weight);
+  xla::Shape indices_shape = XlaHelpers::ShapeOfXlaOp(indices);
+  xla::Shape offsets_shape = XlaHelpers::ShapeOfXlaOp(offsets);
+  XLA_CHECK_EQ(weight_shape.rank(), 2) << weight_shape;
+  XLA_CHECK_EQ(indices_shape.rank(), 1) << indices_shape;
+  XLA_CHECK_EQ(offsets_shape.rank(), 1) << offsets_shape;
+  xla::int64 num_indices = indices_shape.dimensions(0);
+  xla::int64 num_bags = offsets_shape.dimensions(0);
+  XLA_CHECK_GT(num_bags, 0) << "embedding_bag needs at least one bag";
+  xla::PrimitiveType type = weight_shape.element_type();
+  xla::PrimitiveType index_type =
+      GetDevicePrimitiveType(xla::PrimitiveType::S64, /*device=*/nullptr);
+  xla::XlaOp bag_offsets = xla::ConvertElementType(offsets, index_type);
+  xla::XlaOp offset2bag = BuildOffsetToBag(bag_offsets, num_indices);
+  // The size of every bag is the distance to the next offset (or to the end
+  // of the indices, for the last bag).
+  xla::XlaOp next_offsets = xla::ConcatInDim(
+      builder,
+      {xla::SliceInDim(bag_offsets, 1, num_bags, 1, 0),
+       xla::Reshape(XlaHelpers::ScalarValue<xla::int64>(num_indices, index_type,
+                                                        builder),
+                    {1})},
+      0);
+  xla::XlaOp bag_size = next_offsets - bag_offsets;
+
+  xla::XlaOp rows = xla::TorchIndexSelect(
+      weight, XlaHelpers::NarrowIndices(indices, weight_shape.dimensions(0)),
+      0);
+  xla::Shape rows_shape = XlaHelpers::ShapeOfXlaOp(rows);
+  if (XlaHelpers::ShapeOfXlaOp(per_sample_weights).rank() > 0) {
+    XLA_CHECK(mode == EmbeddingBagMode::kSum)
+        << "The per sample weights are only supported in sum mode";
+    rows = rows *
+           BroadcastRows(xla::ConvertElementType(per_sample_weights, type),
+                         rows_shape);
+  }
+  std::vector<xla::int64> output_dims({num_bags, weight_shape.dimensions(1)});
+  xla::XlaOp max_indices =
+      xla::Broadcast(xla::Zero(builder, index_type), {num_bags});
+  xla::XlaOp output;
+  if (mode == EmbeddingBagMode::kMax) {
+    xla::XlaOp lowest =
+        xla::Broadcast(xla::MinValue(builder, type), output_dims);
+    xla::XlaOp bag_max =
+        ScatterRows(lowest, offset2bag, rows,
+                    xla::CreateScalarMaxComputation(type, builder));
+    // The weight row of the maximum of every bag column is the smallest index
+    // whose row matches it (num_weights stands for no match).
+    xla::XlaOp no_index = XlaHelpers::ScalarValue<xla::int64>(
+        weight_shape.dimensions(0), index_type, builder);
+    xla::XlaOp candidates = xla::Select(
+        xla::Eq(rows, xla::TorchIndexSelect(bag_max, offset2bag, 0)),
+        BroadcastRows(xla::ConvertElementType(indices, index_type),
+                      rows_shape),
+        xla::Broadcast(no_index, rows_shape.dimensions()));
+    max_indices = ZeroEmptyBags(
+        ScatterRows(xla::Broadcast(no_index, output_dims), offset2bag,
+                    candidates,
+                    xla::CreateScalarMinComputation(index_type, builder)),
+        bag_size);
+    output = ZeroEmptyBags(bag_max, bag_size);
+  } else {
+    xla::XlaOp zeros = xla::Broadcast(xla::Zero(builder, type), output_dims);
+    output = CreateIndexAdd(zeros, 0, offset2bag, rows);
+    if (mode == EmbeddingBagMode::kMean) {
+      xla::XlaOp divisor = xla::ConvertElementType(
+          xla::Max(bag_size, xla::One(builder, index_type)), type);
+      output =
+          output / BroadcastRows(divisor, XlaHelpers::ShapeOfXlaOp(output));
+    }
+  }
+  return {output, offset2bag, bag_size, max_indices};
+}
+
+xla::XlaOp BuildEmbeddingBagBackward(
+    const xla::XlaOp& grad, const xla::XlaOp& indices,
+    const xla::XlaOp& offset2bag, const xla::XlaOp& bag_size,
+    const xla::XlaOp& max_indices, const xla::XlaOp& per_sample_weights,
+    xla::int64 num_weights, bool scale_grad_by_freq, EmbeddingBagMode mode) {
+  xla::XlaBuilder* builder = grad.builder();
+  xla::Shape grad_shape = XlaHelpers::ShapeOfXlaOp(grad);
+  xla::PrimitiveType type = grad_shape.element_type();
+  xla::int64 embedding_dim = grad_shape.dimensions(1);
+  if (mode == EmbeddingBagMode::kMax) {
+    // Every element of the bag gradients goes to the weight row of the
+    // respective maximum, so scatter them as a flat [B * D] vector.
+    xla::Shape max_indices_shape = XlaHelpers::ShapeOfXlaOp(max_indices);
+    xla::PrimitiveType index_type = max_indices_shape.element_type();
+    xla::XlaOp columns = xla::Iota(
+        builder, xla::ShapeUtil::MakeShape(index_type, grad_shape.dimensions()),
+        1);
+    xla::XlaOp flat_indices =
+        max_indices * XlaHelpers::ScalarValue<xla::int64>(embedding_dim,
+                                                          index_type, builder) +
+        columns;
+    xla::int64 num_elements = xla::ShapeUtil::ElementsIn(grad_shape);
+    xla::XlaOp zeros = xla::Broadcast(xla::Zero(builder, type),
+                                      {num_weights * embedding_dim});
+    xla::XlaOp grad_weight = CreateIndexAdd(
+        zeros, 0, xla::Reshape(flat_indices, {num_elements}),
+        xla::Reshape(ZeroEmptyBags(grad, bag_size), {num_elements}));
+    return xla::Reshape(grad_weight, {num_weights, embedding_dim});
+  }
+  xla::XlaOp lookup_grad = xla::TorchIndexSelect(grad, offset2bag, 0);
+  xla::Shape lookup_shape = XlaHelpers::ShapeOfXlaOp(lookup_grad);
+  xla::int64 num_indices = lookup_shape.dimensions(0);
+  // The factors of the gradient of every lookup.
+  xla::XlaOp scale = xla::Broadcast(xla::One(builder, type), {num_indices});
+  if (mode == EmbeddingBagMode::kMean) {
+    xla::PrimitiveType size_type =
+        XlaHelpers::ShapeOfXlaOp(bag_size).element_type();
+    xla::XlaOp divisor = xla::ConvertElementType(
+        xla::Max(bag_size, xla::One(builder, size_type)), type);
+    scale = scale / xla::TorchIndexSelect(divisor, offset2bag, 0);
+  }
+  if (XlaHelpers::ShapeOfXlaOp(per_sample_weights).rank() > 0) {
+    scale = scale * xla::ConvertElementType(per_sample_weights, type);
+  }
+  if (scale_grad_by_freq) {
+    xla::XlaOp counts = CreateIndexAdd(
+        xla::Broadcast(xla::Zero(builder, type), {num_weights}), 0, indices,
+        xla::Broadcast(xla::One(builder, type), {num_indices}));
+    scale = scale / xla::TorchIndexSelect(counts, indices, 0);
+  }
+  xla::XlaOp zeros =
+      xla::Broadcast(xla::Zero(builder, type), {num_weights, embedding_dim});
+  return CreateIndexAdd(zeros, 0, indices,
+                        lookup_grad * BroadcastRows(scale, lookup_shape));
+}
+
+xla::XlaOp BuildEmbeddingBagPerSampleWeightsBackward(
+    const xla::XlaOp& grad, const xla::XlaOp& weight,
+    const xla::XlaOp& indices, const xla::XlaOp& offset2bag) {
+  xla::XlaBuilder* builder = grad.builder();
+  xla::PrimitiveType type = XlaHelpers::ShapeOfXlaOp(grad).element_type();
+  xla::XlaOp products = xla::TorchIndexSelect(grad, offset2bag, 0) *
+                        xla::TorchIndexSelect(weight, indices, 0);
+  return xla::Reduce(products, xla::Zero(builder, type),
+                     xla::CreateScalarAddComputation(type, builder), {1});
+}
+
+}  // namespace torch_xla
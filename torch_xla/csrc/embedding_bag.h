@@ -0,0 +1,51 @@
+#pragma once
+
+#include "tensorflow/compiler/xla/client/xla_builder.h"
+
+namespace torch_xla {
+
+// The reduction modes of embedding_bag, with the ATen values.
+enum class EmbeddingBagMode {
+  kSum = 0,
+  kMean = 1,
+  kMax = 2,
+};
+
+struct EmbeddingBagResult {
+  // The [B, D] reduced rows of every bag.
+  xla::XlaOp output;
+  // The [N] bag of every index.
+  xla::XlaOp offset2bag;
+  // The [B] number of indices of every bag.
+  xla::XlaOp bag_size;
+  // The [B, D] weight row of every maximum, in kMax mode, or [B] zeros.
+  xla::XlaOp max_indices;
+};
+
+// Reduces the rows of the [num_weights, D] weight selected by the [N] indices
+// within every one of the B bags starting at the (sorted) [B] offsets. The
+// per_sample_weights, if not a scalar, are the [N] factors of the selected
+// rows (in kSum mode). The rows are gathered and scattered into their bag by
+// the same fused computation, and the empty bags are zeros.
+EmbeddingBagResult BuildEmbeddingBag(const xla::XlaOp& weight,
+                                     const xla::XlaOp& indices,
+                                     const xla::XlaOp& offsets,
+                                     const xla::XlaOp& per_sample_weights,
+                                     EmbeddingBagMode mode);
+
+// Computes the [num_weights, D] dense weight gradient of BuildEmbeddingBag(),
+// by scattering the gradient of every bag (or of its maximums) directly into
+// the rows of its indices.
+xla::XlaOp BuildEmbeddingBagBackward(
+    const xla::XlaOp& grad, const xla::XlaOp& indices,
+    const xla::XlaOp& offset2bag, const xla::XlaOp& bag_size,
+    const xla::XlaOp& max_indices, const xla::XlaOp& per_sample_weights,
+    xla::int64 num_weights, bool scale_grad_by_freq, EmbeddingBagMode mode);
+
+// Computes the [N] gradient of the per_sample_weights of BuildEmbeddingBag(),
+// in kSum mode.
+xla::XlaOp BuildEmbeddingBagPerSampleWeightsBackward(
+    const xla::XlaOp& grad, const xla::XlaOp& weight,
+    const xla::XlaOp& indices, const xla::XlaOp& offset2bag);
+
+}  // namespace torch_xla
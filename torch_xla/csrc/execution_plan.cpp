@@ -0,0 +1,143 @@
+#include "torch_xla/csrc/execution_plan.h"
+
+#include <map>
+#include <string>
+
+#include "absl/strings/str_join.h"
+#include "tensorflow/compiler/xla/xla_client/debug_macros.h"
+#include "tensorflow/compiler/xla/xla_client/metrics.h"
+#include "tensorflow/compiler/xla/xla_client/tf_logging.h"
+#include "tensorflow/compiler/xla/xla_client/util.h"
+#include "torch_xla/csrc/inference_folding.h"
+#include "torch_xla/csrc/lowering_context.h"
+#include "torch_xla/csrc/ops/device_data.h"
+#include "torch_xla/csrc/tensor_util.h"
+#include "torch_xla/csrc/upload_batcher.h"
+
+namespace torch_xla {
+namespace {
+
+Device GetPlanDevice(const std::vector<XLATensor>& outputs) {
+  XLA_CHECK(!outputs.empty()) << "An execution plan needs at least one output";
+  xla::util::Unique<Device> unique_device;
+  for (auto& output : outputs) {
+    unique_device.set(output.GetDevice());
+  }
+  return *unique_device;
+}
+
+}  // namespace
+
+ExecutionPlan::ExecutionPlan(std::vector<XLATensor> inputs,
+                             const std::vector<XLATensor>& outputs)
+    : device_(GetPlanDevice(outputs)) {
+  XLA_TIMED("ExecutionPlanCreate");
+  std::map<const xla::ComputationClient::Data*, size_t> inputs_data;
+  for (size_t i = 0; i < inputs.size(); ++i) {
+    XLA_CHECK_EQ(inputs[i].GetDevice(), device_);
+    XLA_CHECK(inputs[i].CurrentXlaData() != nullptr)
+        << "The inputs of an execution plan must be device data tensors";
+    // Waits for the in flight computations on the device, which could be the
+    // ones writing the device data read by the plan.
+    inputs[i].ApplyPendingGraph();
+    inputs_data.emplace(inputs[i].CurrentXlaData().get(), i);
+    input_types_.push_back(inputs[i].dtype());
+    input_sizes_.push_back(xla::util::ToVector<int64_t>(
+        inputs[i].shape().get().dimensions()));
+  }
+
+  std::vector<ir::Value> roots;
+  for (auto& output : outputs) {
+    roots.push_back(output.GetIrValue());
+    output_types_.push_back(output.dtype());
+  }
+  // The device data read by the graph might include deferred uploads.
+  UploadBatcher::Get()->Flush();
+  if (InferenceFoldingEnabled()) {
+    // Everything other than the inputs is bound to the plan, hence constant.
+    auto is_constant = [&](const ir::Node* node) {
+      const xla::ComputationClient::DataPtr& data =
+          static_cast<const ir::ops::DeviceData*>(node)->data();
+      return data->HasValue() && data->device() == device_.ToString() &&
+             inputs_data.count(data.get()) == 0;
+    };
+    roots = FoldInferenceGraph(roots, is_constant, device_);
+  }
+
+  ir::LoweringContext lowering_ctx("ExecutionPlan");
+  for (auto& root : roots) {
+    lowering_ctx.AddResult(lowering_ctx.GetOutputOp(root));
+  }
+  xla::XlaComputation computation = ConsumeValue(lowering_ctx.Build());
+  arguments_ = lowering_ctx.GetParametersData();
+  std::map<size_t, size_t> used_inputs;
+  for (size_t i = 0; i < arguments_.size(); ++i) {
+    XLA_CHECK(arguments_[i]->HasValue())
+        << "The tensors read by an execution plan must be synced before "
+           "creating it: "
+        << arguments_[i]->shape();
+    auto it = inputs_data.find(arguments_[i].get());
+    if (it != inputs_data.end()) {
+      auto used_it = used_inputs.emplace(it->second, used_inputs.size()).first;
+      input_arguments_.emplace_back(i, used_it->second);
+      // Do not hold the data of the inputs, which is replaced at every run.
+      arguments_[i] = nullptr;
+    }
+  }
+  used_inputs_.resize(used_inputs.size());
+  for (auto& index_position : used_inputs) {
+    used_inputs_[index_position.second] = index_position.first;
+  }
+
+  xla::ProgramShape program_shape = ConsumeValue(computation.GetProgramShape());
+  xla::Shape shape =
+      MakeShapeWithDeviceLayout(program_shape.result(), device_.hw_type);
+  std::vector<xla::ComputationClient::CompileInstance> instances;
+  instances.push_back({std::move(computation), device_.ToString(),
+                       xla::ComputationClient::Get()->GetCompilationDevices(
+                           device_.ToString(), {}),
+                       &shape});
+  computation_ =
+      xla::ComputationClient::Get()->Compile(std::move(instances)).front();
+  TF_VLOG(3) << "Execution plan with " << arguments_.size() << " arguments, "
+             << input_arguments_.size() << " fed by the inputs";
+}
+
+std::vector<XLATensor> ExecutionPlan::Execute(
+    const std::vector<at::Tensor>& inputs) const {
+  XLA_TIMED("ExecutionPlanExecute");
+  XLA_CHECK_EQ(inputs.size(), input_types_.size());
+  std::vector<at::Tensor> uploads;
+  uploads.reserve(used_inputs_.size());
+  for (auto index : used_inputs_) {
+    const at::Tensor& input = inputs[index];
+    XLA_CHECK_EQ(input.scalar_type(), input_types_[index])
+        << "Wrong type for input " << index;
+    XLA_CHECK(input.sizes().equals(input_sizes_[index]))
+        << "Wrong sizes for input " << index << ": ["
+        << absl::StrJoin(input.sizes(), ", ") << "] vs. ["
+        << absl::StrJoin(input_sizes_[index], ", ") << "]";
+    uploads.push_back(input);
+  }
+  std::vector<xla::ComputationClient::DataPtr> inputs_data = CreateTensorsData(
+      uploads, std::vector<std::string>(uploads.size(), device_.ToString()));
+
+  std::vector<xla::ComputationClient::DataPtr> arguments(arguments_);
+  for (auto& input_argument : input_arguments_) {
+    arguments[input_argument.first] = inputs_data[input_argument.second];
+  }
+  xla::ComputationClient::ExecuteComputationOptions options;
+  std::vector<xla::ComputationClient::DataPtr> results =
+      xla::ComputationClient::Get()->ExecuteComputation(
+          *computation_, arguments, device_.ToString(), options);
+  XLA_CHECK_EQ(results.size(), output_types_.size());
+  std::vector<XLATensor> outputs;
+  outputs.reserve(results.size());
+  for (size_t i = 0; i < results.size(); ++i) {
+    outputs.push_back(
+        XLATensor::Create(std::move(results[i]), output_types_[i]));
+  }
+  return outputs;
+}
+
+}  // namespace torch_xla
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <ATen/ATen.h>
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "tensorflow/compiler/xla/xla_client/computation_client.h"
+#include "torch_xla/csrc/device.h"
+#include "torch_xla/csrc/tensor.h"
+
+namespace torch_xla {
+
+// A graph which is traced and compiled once, and then run with new input
+// values, skipping the tracing, the graph hashing and the computation cache
+// lookup the sync of the tensors goes through. The device data the graph reads
+// other than the inputs (like the model weights) is bound to the plan when it
+// is created, so later changes to the tensors holding it are not seen by the
+// plan. This lets the plan fold the graph for inference (see
+// FoldInferenceGraph()), unless XLA_FOLD_INFERENCE_GRAPHS is false. The plan is
+// immutable once created, and Execute() can be called from multiple threads at
+// once.
+class ExecutionPlan {
+ public:
+  // Creates the plan computing the outputs as a function of the inputs, which
+  // must be the tensors the outputs were traced from. The inputs must already
+  // hold device data (like the tensors uploaded from CPU), as they are only
+  // checked, and not synced.
+  ExecutionPlan(std::vector<XLATensor> inputs,
+                const std::vector<XLATensor>& outputs);
+
+  // Uploads the input values, which must match the sizes and types of the plan
+  // inputs, and runs the computation, returning the device tensors holding the
+  // outputs.
+  std::vector<XLATensor> Execute(const std::vector<at::Tensor>& inputs) const;
+
+  const Device& device() const { return device_; }
+
+  size_t num_inputs() const { return input_types_.size(); }
+
+  at::ScalarType input_type(size_t index) const {
+    return input_types_.at(index);
+  }
+
+  const std::vector<int64_t>& input_sizes(size_t index) const {
+    return input_sizes_.at(index);
+  }
+
+ private:
+  Device device_;
+  std::shared_ptr<xla::ComputationClient::Computation> computation_;
+  // The computation arguments, where the ones fed by the inputs are nullptr.
+  std::vector<xla::ComputationClient::DataPtr> arguments_;
+  // The input indices which are read by the computation, hence uploaded.
+  std::vector<size_t> used_inputs_;
+  // The (argument index, used_inputs_ index) pairs of the arguments fed by the
+  // inputs.
+  std::vector<std::pair<size_t, size_t>> input_arguments_;
+  std::vector<at::ScalarType> input_types_;
+  std::vector<std::vector<int64_t>> input_sizes_;
+  std::vector<at::ScalarType> output_types_;
+};
+
+}  // namespace torch_xla
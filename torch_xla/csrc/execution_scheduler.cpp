@@ -0,0 +1,70 @@
+#include "torch_xla/csrc/execution_scheduler.h"
+
+#include <algorithm>
+
+#include "tensorflow/compiler/xla/xla_client/metrics.h"
+#include "tensorflow/compiler/xla/xla_client/sys_util.h"
+
+namespace torch_xla {
+namespace {
+
+thread_local ExecutionScheduler::Priority g_thread_priority =
+    ExecutionScheduler::Priority::kNormal;
+
+}  // namespace
+
+ExecutionScheduler* ExecutionScheduler::Get() {
+  static ExecutionScheduler* scheduler = new ExecutionScheduler();
+  return scheduler;
+}
+
+ExecutionScheduler::ExecutionScheduler()
+    : max_executions_(std::max<xla::int64>(
+          xla::sys_util::GetEnvInt("XLA_DEVICE_MAX_EXECUTIONS", 1), 1)) {}
+
+ExecutionScheduler::Priority ExecutionScheduler::GetThreadPriority() {
+  return g_thread_priority;
+}
+
+ExecutionScheduler::Priority ExecutionScheduler::SetThreadPriority(
+    Priority priority) {
+  Priority previous = g_thread_priority;
+  g_thread_priority = priority;
+  return previous;
+}
+
+xla::util::Cleanup<int> ExecutionScheduler::Acquire(const std::string& device,
+                                                    Priority priority) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  DeviceState* state = &devices_[device];
+  if (!CanDispatch(*state, priority)) {
+    XLA_COUNTER("ExecutionSchedulerWaits", 1);
+    ++state->waiting[static_cast<int>(priority)];
+    cv_.wait(lock, [&] { return CanDispatch(*state, priority); });
+    --state->waiting[static_cast<int>(priority)];
+  }
+  ++state->in_flight;
+  return xla::util::Cleanup<int>(
+      [this, device](int /* status */) { Release(device); });
+}
+
+bool ExecutionScheduler::CanDispatch(const DeviceState& state,
+                                     Priority priority) const {
+  if (state.in_flight >= max_executions_) {
+    return false;
+  }
+  for (int i = 0; i < static_cast<int>(priority); ++i) {
+    if (state.waiting[i] > 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void ExecutionScheduler::Release(const std::string& device) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  --devices_[device].in_flight;
+  cv_.notify_all();
+}
+
+}  // namespace torch_xla
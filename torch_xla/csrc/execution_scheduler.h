@@ -0,0 +1,64 @@
+#pragma once
+
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <string>
+
+#include "tensorflow/compiler/xla/xla_client/util.h"
+
+namespace torch_xla {
+
+// Dispatches the computations of the asynchronous syncs to the devices in
+// priority order, and bounds the number of executions in flight on every
+// device with XLA_DEVICE_MAX_EXECUTIONS (default 1, which serializes them as
+// the device locks did).
+// The priority class is a property of the thread scheduling the sync, and the
+// syncs of different classes are ordered by separate device locks, so that a
+// (low priority) evaluation graph does not queue behind the (normal priority)
+// training steps, and the other way round.
+class ExecutionScheduler {
+ public:
+  enum class Priority {
+    kHigh = 0,
+    kNormal = 1,
+    kLow = 2,
+  };
+
+  static const int kNumPriorities = static_cast<int>(Priority::kLow) + 1;
+
+  static ExecutionScheduler* Get();
+
+  // The priority class of the syncs scheduled by the calling thread.
+  static Priority GetThreadPriority();
+
+  // Sets the priority class of the calling thread, and returns the previous
+  // one.
+  static Priority SetThreadPriority(Priority priority);
+
+  // Waits until an execution of the given priority class can be dispatched to
+  // the device, which happens when it has less than the maximum executions in
+  // flight, and no higher priority executions are waiting. The returned object
+  // releases the execution slot once destroyed.
+  xla::util::Cleanup<int> Acquire(const std::string& device,
+                                  Priority priority);
+
+ private:
+  struct DeviceState {
+    size_t in_flight = 0;
+    size_t waiting[kNumPriorities] = {};
+  };
+
+  ExecutionScheduler();
+
+  bool CanDispatch(const DeviceState& state, Priority priority) const;
+
+  void Release(const std::string& device);
+
+  size_t max_executions_ = 1;
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::map<std::string, DeviceState> devices_;
+};
+
+}  // namespace torch_xla
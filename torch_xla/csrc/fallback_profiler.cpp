@@ -0,0 +1,138 @@
+#include "torch_xla/csrc/fallback_profiler.h"
+
+#include <algorithm>
+#include <sstream>
+
+#include "tensorflow/compiler/xla/xla_client/debug_macros.h"
+#include "tensorflow/compiler/xla/xla_client/sys_util.h"
+
+namespace torch_xla {
+namespace {
+
+xla::int64 SortValue(const FallbackProfiler::Record& record,
+                     const std::string& sort_key) {
+  if (sort_key == "calls") {
+    return record.calls;
+  } else if (sort_key == "time") {
+    return record.total_ns;
+  } else if (sort_key == "bytes_to_host") {
+    return record.bytes_to_host;
+  } else if (sort_key == "bytes_to_device") {
+    return record.bytes_to_device;
+  }
+  XLA_ERROR() << "Invalid fallback profiler sort key: " << sort_key;
+}
+
+}  // namespace
+
+constexpr size_t FallbackProfiler::kMaxShapes;
+
+FallbackProfiler* FallbackProfiler::Get() {
+  static FallbackProfiler* profiler = new FallbackProfiler();
+  return profiler;
+}
+
+void FallbackProfiler::Add(const std::string& name, xla::int64 total_ns,
+                           xla::int64 bytes_to_host, xla::int64 bytes_to_device,
+                           const std::string& input_shapes) {
+  xla::metrics::Counter* counter = nullptr;
+  {
+    std::lock_guard<std::mutex> lock(lock_);
+    Record& record = records_[name];
+    record.name = name;
+    record.calls += 1;
+    record.total_ns += total_ns;
+    record.bytes_to_host += bytes_to_host;
+    record.bytes_to_device += bytes_to_device;
+    auto it = record.input_shapes.find(input_shapes);
+    if (it != record.input_shapes.end()) {
+      it->second += 1;
+    } else if (record.input_shapes.size() < kMaxShapes) {
+      record.input_shapes.emplace(input_shapes, 1);
+    }
+    auto& counter_ptr = counters_[name];
+    if (counter_ptr == nullptr) {
+      counter_ptr = new xla::metrics::Counter("fallback::" + name);
+    }
+    counter = counter_ptr;
+  }
+  counter->AddValue(1);
+}
+
+std::vector<FallbackProfiler::Record> FallbackProfiler::GetRecords(
+    const std::string& sort_key) const {
+  std::vector<Record> records;
+  {
+    std::lock_guard<std::mutex> lock(lock_);
+    for (auto& name_record : records_) {
+      records.push_back(name_record.second);
+    }
+  }
+  std::stable_sort(records.begin(), records.end(),
+                   [&](const Record& r1, const Record& r2) {
+                     return SortValue(r1, sort_key) > SortValue(r2, sort_key);
+                   });
+  return records;
+}
+
+std::string FallbackProfiler::CreateReport(const std::string& sort_key) const {
+  std::stringstream ss;
+  for (auto& record : GetRecords(sort_key)) {
+    ss << "Fallback: " << record.name << "\n";
+    ss << "  Calls: " << record.calls << "\n";
+    ss << "  Time: " << xla::metrics::MetricFnTime(record.total_ns) << "\n";
+    ss << "  BytesToHost: " << xla::metrics::MetricFnBytes(record.bytes_to_host)
+       << "\n";
+    ss << "  BytesToDevice: "
+       << xla::metrics::MetricFnBytes(record.bytes_to_device) << "\n";
+    for (auto& shapes_count : record.input_shapes) {
+      ss << "  InputShapes: " << shapes_count.first << " ("
+         << shapes_count.second << " calls)\n";
+    }
+  }
+  return ss.str();
+}
+
+void FallbackProfiler::Clear() {
+  std::lock_guard<std::mutex> lock(lock_);
+  records_.clear();
+}
+
+FallbackScope::FallbackScope(const char* name)
+    : name_(name), start_ns_(xla::sys_util::NowNs()), prev_(Current()) {
+  Current() = this;
+}
+
+FallbackScope::~FallbackScope() {
+  Current() = prev_;
+  FallbackProfiler::Get()->Add(name_, xla::sys_util::NowNs() - start_ns_,
+                               bytes_to_host_, bytes_to_device_,
+                               input_shapes_);
+}
+
+FallbackScope*& FallbackScope::Current() {
+  static thread_local FallbackScope* current = nullptr;
+  return current;
+}
+
+void FallbackScope::RecordToHost(const at::Tensor& tensor) {
+  FallbackScope* scope = Current();
+  if (scope != nullptr) {
+    scope->bytes_to_host_ += tensor.nbytes();
+    std::stringstream ss;
+    ss << tensor.scalar_type() << tensor.sizes();
+    if (!scope->input_shapes_.empty()) {
+      scope->input_shapes_ += " ";
+    }
+    scope->input_shapes_ += ss.str();
+  }
+}
+
+void FallbackScope::RecordToDevice(const at::Tensor& tensor) {
+  FallbackScope* scope = Current();
+  if (scope != nullptr) {
+    scope->bytes_to_device_ += tensor.nbytes();
+  }
+}
+
+}  // namespace torch_xla
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <ATen/ATen.h>
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "tensorflow/compiler/xla/types.h"
+#include "tensorflow/compiler/xla/xla_client/metrics.h"
+
+namespace torch_xla {
+
+// Profiles the ATen operations which have no XLA lowering, and fall back to
+// running on CPU (the AtenXlaTypeDefault functions), by recording the time
+// they take and the bytes they move from and back to the device. Every
+// fallback also bumps the "fallback::<op>" counter.
+class FallbackProfiler {
+ public:
+  struct Record {
+    std::string name;
+    xla::int64 calls = 0;
+    xla::int64 total_ns = 0;
+    xla::int64 bytes_to_host = 0;
+    xla::int64 bytes_to_device = 0;
+    // The call counts by input shapes, for the first kMaxShapes distinct
+    // input shapes seen.
+    std::map<std::string, xla::int64> input_shapes;
+  };
+
+  static FallbackProfiler* Get();
+
+  void Add(const std::string& name, xla::int64 total_ns,
+           xla::int64 bytes_to_host, xla::int64 bytes_to_device,
+           const std::string& input_shapes);
+
+  // Returns the records sorted (in descending order) by sort_key, which can
+  // be "calls", "time", "bytes_to_host" or "bytes_to_device".
+  std::vector<Record> GetRecords(const std::string& sort_key) const;
+
+  std::string CreateReport(const std::string& sort_key) const;
+
+  void Clear();
+
+ private:
+  static constexpr size_t kMaxShapes = 16;
+
+  mutable std::mutex lock_;
+  std::map<std::string, Record> records_;
+  std::map<std::string, xla::metrics::Counter*> counters_;
+};
+
+// Scope tracking a CPU fallback operation. The bridge APIs moving tensors
+// between host and device account the moved tensors to the innermost scope of
+// the calling thread, if any.
+class FallbackScope {
+ public:
+  explicit FallbackScope(const char* name);
+
+  ~FallbackScope();
+
+  static void RecordToHost(const at::Tensor& tensor);
+
+  static void RecordToDevice(const at::Tensor& tensor);
+
+ private:
+  static FallbackScope*& Current();
+
+  const char* name_;
+  xla::int64 start_ns_;
+  xla::int64 bytes_to_host_ = 0;
+  xla::int64 bytes_to_device_ = 0;
+  std::string input_shapes_;
+  FallbackScope* prev_;
+};
+
+}  // namespace torch_xla
@@ -0,0 +1,112 @@
+#include "torch_xla/csrc/fetch_transform.h"
+
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_split.h"
+#include "tensorflow/compiler/xla/xla_client/debug_macros.h"
+#include "tensorflow/compiler/xla/xla_client/metrics.h"
+#include "torch_xla/csrc/ops/ops.h"
+#include "torch_xla/csrc/tensor_util.h"
+
+namespace torch_xla {
+namespace {
+
+xla::int64 ParseParam(const std::vector<std::string>& parts,
+                      const std::string& spec) {
+  xla::int64 param = 0;
+  XLA_CHECK(parts.size() == 2 && absl::SimpleAtoi(parts[1], &param) &&
+            param > 0)
+      << "Invalid fetch transform: " << spec;
+  return param;
+}
+
+// Appends to results the tensors computing the transform of the tensor, and
+// returns how many.
+size_t AppendTransformed(const XLATensor& tensor,
+                         const FetchTransform& transform,
+                         std::vector<XLATensor>* results) {
+  const Device& device = tensor.GetDevice();
+  switch (transform.kind) {
+    case FetchTransform::Kind::kNone:
+      results->push_back(tensor);
+      return 1;
+    case FetchTransform::Kind::kBFloat16:
+      if (!at::isFloatingType(tensor.dtype())) {
+        results->push_back(tensor);
+      } else {
+        results->push_back(XLATensor::Create(
+            ir::ops::ConvertTo(tensor.GetIrValue(), xla::PrimitiveType::BF16),
+            device, tensor.dtype()));
+      }
+      return 1;
+    case FetchTransform::Kind::kInt8: {
+      ir::NodePtr node = ir::ops::DynamicQuantize(
+          tensor.GetIrValue(),
+          GetDevicePrimitiveType(xla::PrimitiveType::S8, &device));
+      results->push_back(XLATensor::Create(ir::Value(node, 0), device,
+                                           at::ScalarType::Char));
+      results->push_back(XLATensor::Create(ir::Value(node, 1), device,
+                                           at::ScalarType::Float));
+      return 2;
+    }
+    case FetchTransform::Kind::kSubsample: {
+      XLATensor flat = XLATensor::view(tensor, {-1});
+      results->push_back(XLATensor::slice(flat, 0, 0, flat.size(0),
+                                          transform.param));
+      return 1;
+    }
+    case FetchTransform::Kind::kHistogram: {
+      ir::NodePtr node =
+          ir::ops::Histogram(tensor.GetIrValue(), transform.param);
+      results->push_back(XLATensor::Create(ir::Value(node, 0), device,
+                                           at::ScalarType::Float));
+      results->push_back(XLATensor::Create(ir::Value(node, 1), device,
+                                           at::ScalarType::Float));
+      return 2;
+    }
+  }
+  XLA_ERROR() << "Invalid fetch transform kind";
+}
+
+}  // namespace
+
+FetchTransform FetchTransform::Parse(const std::string& spec) {
+  std::vector<std::string> parts = absl::StrSplit(spec, ':');
+  FetchTransform transform;
+  if (parts[0] == "none" && parts.size() == 1) {
+    transform.kind = Kind::kNone;
+  } else if (parts[0] == "bf16" && parts.size() == 1) {
+    transform.kind = Kind::kBFloat16;
+  } else if (parts[0] == "int8" && parts.size() == 1) {
+    transform.kind = Kind::kInt8;
+  } else if (parts[0] == "subsample") {
+    transform.kind = Kind::kSubsample;
+    transform.param = ParseParam(parts, spec);
+  } else if (parts[0] == "histogram") {
+    transform.kind = Kind::kHistogram;
+    transform.param = ParseParam(parts, spec);
+  } else {
+    XLA_ERROR() << "Invalid fetch transform: " << spec;
+  }
+  return transform;
+}
+
+std::vector<std::vector<at::Tensor>> FetchTransformed(
+    const std::vector<XLATensor>& tensors, const FetchTransform& transform) {
+  std::vector<XLATensor> results;
+  std::vector<size_t> counts;
+  for (auto& tensor : tensors) {
+    counts.push_back(AppendTransformed(tensor, transform, &results));
+  }
+  XLA_COUNTER("TransformedFetches", tensors.size());
+  std::vector<at::Tensor> host_tensors = XLATensor::GetTensors(&results);
+  std::vector<std::vector<at::Tensor>> outputs;
+  size_t base = 0;
+  for (auto count : counts) {
+    outputs.emplace_back(host_tensors.begin() + base,
+                         host_tensors.begin() + base + count);
+    base += count;
+  }
+  return outputs;
+}
+
+}  // namespace torch_xla
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "tensorflow/compiler/xla/types.h"
+#include "torch_xla/csrc/tensor.h"
+
+namespace torch_xla {
+
+// Describes a reduction applied on device to the tensors fetched for
+// monitoring (logging, histograms), so that only its result is transferred to
+// the host. Parsed from the specs:
+//   "none": the tensor itself.
+//   "bf16": the tensor rounded to BF16 (half the bytes of F32), as float.
+//   "int8": the int8 values, with their float scale.
+//   "subsample:<stride>": every stride-th element of the flattened tensor.
+//   "histogram:<bins>": the float counts of bins equal width intervals, and
+//     the {min, max} range they span.
+struct FetchTransform {
+  enum class Kind {
+    kNone,
+    kBFloat16,
+    kInt8,
+    kSubsample,
+    kHistogram,
+  };
+
+  static FetchTransform Parse(const std::string& spec);
+
+  Kind kind = Kind::kNone;
+  // The stride of kSubsample, or the bins of kHistogram.
+  xla::int64 param = 0;
+};
+
+// Applies the transform to the tensors, and fetches the results with a single
+// sync and transfer. Returns, for each tensor, the host tensors of the result:
+// one for kNone, kBFloat16 and kSubsample, two for kInt8 and kHistogram.
+std::vector<std::vector<at::Tensor>> FetchTransformed(
+    const std::vector<XLATensor>& tensors, const FetchTransform& transform);
+
+}  // namespace torch_xla
@@ -0,0 +1,224 @@
+#include "torch_xla/csrc/graph_bundle.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_join.h"
+#include "tensorflow/compiler/xla/xla_client/computation_client.h"
+#include "tensorflow/compiler/xla/xla_client/debug_macros.h"
+#include "tensorflow/compiler/xla/xla_client/metrics.h"
+#include "torch_xla/csrc/speculative_compiler.h"
+#include "torch_xla/csrc/tensor.h"
+
+namespace torch_xla {
+namespace {
+
+// The bundle starts with the magic, followed by the topology (the list of all
+// the devices, and the one of the replication devices) and the number of
+// graphs. Every graph is made of its hash, the number of its parameters, the
+// list of the devices it was compiled for, the serialized xla::ProgramShape
+// it was compiled with, and the serialized xla::HloModuleProto. The graphs are
+// followed by the number of the graph transitions observed by the run which
+// saved the bundle, each made of the hash of the synced graph, the one of the
+// graph synced next, and the number of times it happened (the version 1
+// bundles have no transitions). All the integers are 64 bit, in host byte
+// order.
+const size_t kMagicSize = 8;
+const char kMagic[kMagicSize] = {'X', 'L', 'A', 'G', 'B', 'N', 'D', '2'};
+const char kMagicV1[kMagicSize] = {'X', 'L', 'A', 'G', 'B', 'N', 'D', '1'};
+
+void AppendUint64(xla::uint64 value, std::string* data) {
+  data->append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+void AppendString(const std::string& value, std::string* data) {
+  AppendUint64(value.size(), data);
+  data->append(value);
+}
+
+void AppendStrings(const std::vector<std::string>& values, std::string* data) {
+  AppendUint64(values.size(), data);
+  for (auto& value : values) {
+    AppendString(value, data);
+  }
+}
+
+class Reader {
+ public:
+  Reader(const std::string& data, const std::string& path)
+      : data_(data), path_(path) {}
+
+  const char* Read(size_t size) {
+    XLA_CHECK_LE(size, data_.size() - offset_)
+        << "Truncated graph bundle: " << path_;
+    const char* ptr = data_.data() + offset_;
+    offset_ += size;
+    return ptr;
+  }
+
+  xla::uint64 ReadUint64() {
+    xla::uint64 value;
+    std::memcpy(&value, Read(sizeof(value)), sizeof(value));
+    return value;
+  }
+
+  std::string ReadString() {
+    size_t size = ReadUint64();
+    return std::string(Read(size), size);
+  }
+
+  std::vector<std::string> ReadStrings() {
+    std::vector<std::string> values(ReadUint64());
+    for (auto& value : values) {
+      value = ReadString();
+    }
+    return values;
+  }
+
+ private:
+  const std::string& data_;
+  std::string path_;
+  size_t offset_ = 0;
+};
+
+std::string DescribeDevices(const std::vector<std::string>& devices) {
+  return absl::StrCat("[", absl::StrJoin(devices, ", "), "]");
+}
+
+void CheckTopology(const std::vector<std::string>& bundle_devices,
+                   const std::vector<std::string>& devices,
+                   const char* devices_kind, const std::string& path) {
+  XLA_CHECK(bundle_devices == devices)
+      << "The graph bundle " << path << " was saved with the "
+      << devices_kind << " devices " << DescribeDevices(bundle_devices)
+      << ", while the current ones are " << DescribeDevices(devices);
+}
+
+// The graphs are compiled on one of the local devices they were compiled
+// for, as the compilations are only valid within their resource domain.
+std::string GetCompilationDevice(
+    const std::vector<std::string>& devices,
+    const std::vector<std::string>& local_devices) {
+  for (auto& device : devices) {
+    if (std::find(local_devices.begin(), local_devices.end(), device) !=
+        local_devices.end()) {
+      return device;
+    }
+  }
+  XLA_ERROR() << "None of the graph devices " << DescribeDevices(devices)
+              << " is local";
+}
+
+}  // namespace
+
+void SaveGraphBundle(const std::string& path) {
+  XLA_TIMED("SaveGraphBundle");
+  xla::ComputationClient* client = xla::ComputationClient::Get();
+  std::vector<XLATensor::CachedGraph> graphs = XLATensor::GetCachedGraphs();
+  std::vector<SpeculativeCompiler::Transition> transitions =
+      SpeculativeCompiler::Get()->GetTransitions();
+  std::string data(kMagic, kMagicSize);
+  AppendStrings(client->GetAllDevices(), &data);
+  AppendStrings(client->GetReplicationDevices(), &data);
+  AppendUint64(graphs.size(), &data);
+  for (auto& graph : graphs) {
+    AppendUint64(graph.hash, &data);
+    AppendUint64(graph.num_parameters, &data);
+    AppendStrings(graph.computation->devices(), &data);
+    AppendString(
+        graph.computation->program_shape().ToProto().SerializeAsString(),
+        &data);
+    AppendString(graph.computation->computation().proto().SerializeAsString(),
+                 &data);
+  }
+  AppendUint64(transitions.size(), &data);
+  for (auto& transition : transitions) {
+    AppendUint64(transition.from_hash, &data);
+    AppendUint64(transition.to_hash, &data);
+    AppendUint64(transition.count, &data);
+  }
+  std::ofstream file(path, std::ios::binary | std::ios::trunc);
+  XLA_CHECK(file) << "Unable to create graph bundle " << path;
+  file.write(data.data(), data.size());
+  XLA_CHECK(file) << "Unable to write graph bundle " << path;
+  XLA_COUNTER("GraphBundleSavedGraphs", graphs.size());
+}
+
+size_t LoadGraphBundle(const std::string& path, bool lazy) {
+  XLA_TIMED("LoadGraphBundle");
+  std::ifstream file(path, std::ios::binary);
+  XLA_CHECK(file) << "Unable to open graph bundle " << path;
+  std::stringstream buffer;
+  buffer << file.rdbuf();
+  std::string data = buffer.str();
+  Reader reader(data, path);
+  const char* magic = reader.Read(kMagicSize);
+  bool has_transitions = std::memcmp(magic, kMagic, kMagicSize) == 0;
+  XLA_CHECK(has_transitions || std::memcmp(magic, kMagicV1, kMagicSize) == 0)
+      << "Not an XLA graph bundle: " << path;
+
+  xla::ComputationClient* client = xla::ComputationClient::Get();
+  CheckTopology(reader.ReadStrings(), client->GetAllDevices(), "service",
+                path);
+  CheckTopology(reader.ReadStrings(), client->GetReplicationDevices(),
+                "replication", path);
+  std::vector<std::string> local_devices = client->GetLocalDevices();
+  std::vector<XLATensor::CachedGraph> graphs(reader.ReadUint64());
+  std::vector<xla::Shape> output_shapes;
+  output_shapes.reserve(graphs.size());
+  std::vector<xla::ComputationClient::CompileInstance> instances;
+  for (auto& graph : graphs) {
+    graph.hash = reader.ReadUint64();
+    graph.num_parameters = reader.ReadUint64();
+    std::vector<std::string> devices = reader.ReadStrings();
+    xla::ProgramShapeProto program_shape_proto;
+    XLA_CHECK(program_shape_proto.ParseFromString(reader.ReadString()))
+        << "Corrupted graph bundle: " << path;
+    xla::HloModuleProto module_proto;
+    XLA_CHECK(module_proto.ParseFromString(reader.ReadString()))
+        << "Corrupted graph bundle: " << path;
+    xla::Shape output_shape = xla::ProgramShape(program_shape_proto).result();
+    std::string device = GetCompilationDevice(devices, local_devices);
+    if (lazy) {
+      SpeculativeCompiler::Get()->AddGraph(
+          graph.hash,
+          {xla::XlaComputation(std::move(module_proto)), std::move(device),
+           std::move(devices), std::move(output_shape), graph.num_parameters});
+    } else {
+      output_shapes.push_back(std::move(output_shape));
+      instances.push_back({xla::XlaComputation(std::move(module_proto)),
+                           std::move(device), std::move(devices),
+                           &output_shapes.back()});
+    }
+  }
+  if (has_transitions) {
+    std::vector<SpeculativeCompiler::Transition> transitions(
+        reader.ReadUint64());
+    for (auto& transition : transitions) {
+      transition.from_hash = reader.ReadUint64();
+      transition.to_hash = reader.ReadUint64();
+      transition.count = reader.ReadUint64();
+    }
+    SpeculativeCompiler::Get()->AddTransitions(transitions);
+  }
+  if (lazy) {
+    XLA_COUNTER("GraphBundleLazyGraphs", graphs.size());
+    return graphs.size();
+  }
+  // All the graphs are compiled with a single call, which runs the
+  // compilations in parallel.
+  std::vector<std::shared_ptr<xla::ComputationClient::Computation>>
+      computations = client->Compile(std::move(instances));
+  for (size_t i = 0; i < graphs.size(); ++i) {
+    graphs[i].computation = std::move(computations[i]);
+    XLATensor::AddCachedGraph(graphs[i]);
+  }
+  XLA_COUNTER("GraphBundleLoadedGraphs", graphs.size());
+  return graphs.size();
+}
+
+}  // namespace torch_xla
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <string>
+
+namespace torch_xla {
+
+// Saves the graphs held by the compilation cache into a bundle file, which
+// stores, for every graph, its hash, the number of its parameters, the
+// serialized computation (with the program shape it was compiled with), and
+// the devices it was compiled for. The graph hashes only depend on the IR
+// graphs, and the layouts of the program shapes on the static layout rules of
+// the build. The device topology of the service is stored as well, as the
+// compilations are only valid on the same one, together with the sequence of
+// graphs synced so far (see SpeculativeCompiler).
+void SaveGraphBundle(const std::string& path);
+
+// Loads a bundle written by SaveGraphBundle(), compiling all its graphs at
+// once, and adding them to the compilation cache, so that the following syncs
+// of the same graphs do not trace and compile them. If lazy is true, the
+// graphs are handed to the SpeculativeCompiler instead, which compiles them in
+// background, the ones predicted to be synced next first. Fails if the device
+// topology does not match the one the bundle was saved with. Returns the
+// number of loaded graphs.
+size_t LoadGraphBundle(const std::string& path, bool lazy);
+
+}  // namespace torch_xla
@@ -0,0 +1,148 @@
+#include "torch_xla/csrc/graph_specializer.h"
+
+#include <algorithm>
+
+#include "tensorflow/compiler/xla/shape_util.h"
+#include "tensorflow/compiler/xla/xla_client/debug_macros.h"
+#include "tensorflow/compiler/xla/xla_client/metrics.h"
+#include "tensorflow/compiler/xla/xla_client/sys_util.h"
+#include "tensorflow/compiler/xla/xla_client/util.h"
+#include "torch_xla/csrc/tensor_util.h"
+
+namespace torch_xla {
+namespace {
+
+size_t GetSpecializationSteps() {
+  static const size_t steps = std::max<xla::int64>(
+      xla::sys_util::GetEnvInt("XLA_SPECIALIZE_STEPS", 8), 1);
+  return steps;
+}
+
+xla::int64 GetMaxSpecializedBytes() {
+  static const xla::int64 max_bytes =
+      xla::sys_util::GetEnvInt("XLA_SPECIALIZE_MAX_BYTES", 1024);
+  return max_bytes;
+}
+
+bool GuardHolds(
+    const GraphSpecializer::Specialization& specialization,
+    const std::vector<xla::ComputationClient::DataPtr>& parameters_data) {
+  for (size_t i = 0; i < specialization.parameters.size(); ++i) {
+    size_t index = specialization.parameters[i];
+    if (index >= parameters_data.size() ||
+        parameters_data[index]->unique_id() != specialization.data_ids[i]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace
+
+GraphSpecializer* GraphSpecializer::Get() {
+  static GraphSpecializer* specializer = new GraphSpecializer();
+  return specializer;
+}
+
+bool GraphSpecializer::IsEnabled() {
+  static const bool enabled =
+      xla::sys_util::GetEnvBool("XLA_SPECIALIZE_GRAPHS", false);
+  return enabled;
+}
+
+std::shared_ptr<const GraphSpecializer::Specialization>
+GraphSpecializer::OnSync(
+    size_t hash,
+    const std::vector<xla::ComputationClient::DataPtr>& parameters_data,
+    const std::vector<std::pair<size_t, size_t>>& buffer_aliases) {
+  std::vector<size_t> parameters;
+  {
+    std::lock_guard<std::mutex> lock(lock_);
+    GraphState* state = &graphs_[hash];
+    if (state->generic) {
+      return nullptr;
+    }
+    if (state->specialization != nullptr) {
+      if (GuardHolds(*state->specialization, parameters_data)) {
+        XLA_COUNTER("SpecializedSyncs", 1);
+        return state->specialization;
+      }
+      XLA_COUNTER("SpecializationGuardFailures", 1);
+      state->generic = true;
+      state->specialization = nullptr;
+      return nullptr;
+    }
+    if (!Track(parameters_data, buffer_aliases, state)) {
+      state->generic = true;
+      return nullptr;
+    }
+    if (state->steps < GetSpecializationSteps()) {
+      return nullptr;
+    }
+    for (size_t i = 0; i < state->invariant.size(); ++i) {
+      if (state->invariant[i]) {
+        parameters.push_back(i);
+      }
+    }
+    // Whatever happens next, the tracking of this graph is over.
+    state->generic = true;
+    if (parameters.empty()) {
+      return nullptr;
+    }
+  }
+
+  // The values are fetched outside of the lock, as they might have to wait for
+  // the in-flight computations producing them.
+  auto specialization = std::make_shared<Specialization>();
+  specialization->hash = hash;
+  std::vector<xla::ComputationClient::DataPtr> folded_data;
+  for (auto index : parameters) {
+    xla::int64 data_id = parameters_data[index]->unique_id();
+    specialization->parameters.push_back(index);
+    specialization->data_ids.push_back(data_id);
+    specialization->hash = xla::util::HashCombine(
+        specialization->hash, xla::util::HashCombine(index, data_id));
+    folded_data.push_back(parameters_data[index]);
+  }
+  specialization->values = XlaDataToLiterals(folded_data);
+  XLA_COUNTER("SpecializedGraphs", 1);
+  XLA_COUNTER("SpecializedParameters", parameters.size());
+
+  std::lock_guard<std::mutex> lock(lock_);
+  GraphState* state = &graphs_[hash];
+  state->specialization = specialization;
+  state->generic = false;
+  return specialization;
+}
+
+bool GraphSpecializer::Track(
+    const std::vector<xla::ComputationClient::DataPtr>& parameters_data,
+    const std::vector<std::pair<size_t, size_t>>& buffer_aliases,
+    GraphState* state) const {
+  if (state->steps == 0) {
+    state->data_ids.reserve(parameters_data.size());
+    state->invariant.reserve(parameters_data.size());
+    for (auto& data : parameters_data) {
+      state->data_ids.push_back(data->unique_id());
+      state->invariant.push_back(xla::ShapeUtil::ByteSizeOf(data->shape()) <=
+                                 GetMaxSpecializedBytes());
+    }
+  } else {
+    if (state->data_ids.size() != parameters_data.size()) {
+      return false;
+    }
+    for (size_t i = 0; i < parameters_data.size(); ++i) {
+      if (parameters_data[i]->unique_id() != state->data_ids[i]) {
+        state->invariant[i] = false;
+      }
+    }
+  }
+  for (auto& alias : buffer_aliases) {
+    XLA_CHECK_LT(alias.first, state->invariant.size());
+    state->invariant[alias.first] = false;
+  }
+  ++state->steps;
+  return true;
+}
+
+}  // namespace torch_xla
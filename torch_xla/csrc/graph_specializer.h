@@ -0,0 +1,75 @@
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "tensorflow/compiler/xla/literal.h"
+#include "tensorflow/compiler/xla/types.h"
+#include "tensorflow/compiler/xla/xla_client/computation_client.h"
+
+namespace torch_xla {
+
+// Specializes the graphs on the small device data inputs which do not change
+// from one sync to the next (like sequence masks, lookup tables and flags),
+// by folding them into the computation as constants.
+// When enabled (XLA_SPECIALIZE_GRAPHS), the specializer tracks the device data
+// feeding the parameters of every graph over its first XLA_SPECIALIZE_STEPS
+// syncs. The parameters which have been bound to the same device data handle
+// all along, and whose size is within XLA_SPECIALIZE_MAX_BYTES, are then
+// fetched and folded, and the graph gets a new hash (so a new compilation).
+// Since the device data is immutable, the guard is a host side check of the
+// handles bound to the folded parameters. The first time it fails, the graph
+// goes back to the generic computation for good, so inputs which change only
+// once in a while do not trigger a recompilation every time.
+class GraphSpecializer {
+ public:
+  struct Specialization {
+    // The hash of the specialized computation.
+    size_t hash = 0;
+    // The indices of the folded parameters of the generic computation, in
+    // increasing order, with the IDs of the device data they were bound to,
+    // and their values.
+    std::vector<size_t> parameters;
+    std::vector<xla::int64> data_ids;
+    std::vector<xla::Literal> values;
+  };
+
+  static GraphSpecializer* Get();
+
+  static bool IsEnabled();
+
+  // Called with the device data bound to the parameters of every sync of the
+  // graph with the given hash, right before its computation cache lookup. The
+  // parameters whose buffers are donated to the outputs are never folded.
+  // Returns the specialization the sync should use, if any.
+  std::shared_ptr<const Specialization> OnSync(
+      size_t hash,
+      const std::vector<xla::ComputationClient::DataPtr>& parameters_data,
+      const std::vector<std::pair<size_t, size_t>>& buffer_aliases);
+
+ private:
+  struct GraphState {
+    size_t steps = 0;
+    bool generic = false;
+    // The device data IDs bound to the parameters at the first sync, and
+    // whether they have been the same ever since.
+    std::vector<xla::int64> data_ids;
+    std::vector<bool> invariant;
+    std::shared_ptr<const Specialization> specialization;
+  };
+
+  // Updates the invariance of the parameters of the graph with the ones of a
+  // new sync. Returns false if the graph cannot be specialized.
+  bool Track(
+      const std::vector<xla::ComputationClient::DataPtr>& parameters_data,
+      const std::vector<std::pair<size_t, size_t>>& buffer_aliases,
+      GraphState* state) const;
+
+  std::mutex lock_;
+  std::unordered_map<size_t, GraphState> graphs_;
+};
+
+}  // namespace torch_xla
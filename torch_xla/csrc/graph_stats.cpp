@@ -0,0 +1,154 @@
+#include "torch_xla/csrc/graph_stats.h"
+
+#include <algorithm>
+#include <sstream>
+
+#include "tensorflow/compiler/xla/shape_util.h"
+#include "tensorflow/compiler/xla/xla_client/debug_macros.h"
+#include "tensorflow/compiler/xla/xla_client/metrics.h"
+#include "tensorflow/compiler/xla/xla_client/sys_util.h"
+
+namespace torch_xla {
+namespace {
+
+xla::int64 DataBytes(
+    const std::vector<xla::ComputationClient::DataPtr>& data) {
+  xla::int64 bytes = 0;
+  for (auto& xla_data : data) {
+    bytes += xla::ShapeUtil::ByteSizeOf(xla_data->shape(),
+                                        /*pointer_size=*/sizeof(void*));
+  }
+  return bytes;
+}
+
+xla::int64 SortValue(const GraphStats::Record& record,
+                     const std::string& sort_key) {
+  if (sort_key == "compiles") {
+    return record.compiles;
+  } else if (sort_key == "compile_time") {
+    return record.compile_ns;
+  } else if (sort_key == "executions") {
+    return record.executions;
+  } else if (sort_key == "execute_time") {
+    return record.execute_ns;
+  } else if (sort_key == "input_bytes") {
+    return record.input_bytes;
+  } else if (sort_key == "output_bytes") {
+    return record.output_bytes;
+  }
+  XLA_ERROR() << "Invalid graph stats sort key: " << sort_key;
+}
+
+}  // namespace
+
+GraphStats* GraphStats::Get() {
+  static GraphStats* stats = new GraphStats();
+  return stats;
+}
+
+bool GraphStats::IsEnabled() {
+  static const bool enabled =
+      xla::sys_util::GetEnvBool("XLA_GRAPH_STATS", true);
+  return enabled;
+}
+
+void GraphStats::RecordMiss(size_t hash) {
+  static const size_t kMaxFrames =
+      xla::sys_util::GetEnvInt("XLA_GRAPH_STATS_FRAMES", 16);
+  bool wants_frames = false;
+  {
+    std::lock_guard<std::mutex> lock(lock_);
+    Record& record = records_[hash];
+    record.hash = hash;
+    wants_frames = record.misses == 0 && kMaxFrames > 0;
+    ++record.misses;
+  }
+  if (wants_frames) {
+    // Walking the Python stack needs the GIL, so it is done outside the lock.
+    std::vector<SourceLocation> frames = GetPythonFrames();
+    if (frames.size() > kMaxFrames) {
+      frames.resize(kMaxFrames);
+    }
+    std::lock_guard<std::mutex> lock(lock_);
+    records_[hash].frames = std::move(frames);
+  }
+}
+
+void GraphStats::RecordCompile(size_t hash,
+                               const xla::XlaComputation& computation,
+                               xla::int64 compile_ns) {
+  xla::int64 hlo_instructions = 0;
+  for (auto& hlo_computation : computation.proto().computations()) {
+    hlo_instructions += hlo_computation.instructions_size();
+  }
+  std::lock_guard<std::mutex> lock(lock_);
+  Record& record = records_[hash];
+  record.hash = hash;
+  record.compiles += 1;
+  record.compile_ns += compile_ns;
+  record.hlo_instructions = hlo_instructions;
+}
+
+void GraphStats::RecordExecution(
+    size_t hash, xla::int64 execute_ns,
+    const std::vector<xla::ComputationClient::DataPtr>& parameters,
+    const std::vector<xla::ComputationClient::DataPtr>& results) {
+  xla::int64 input_bytes = DataBytes(parameters);
+  xla::int64 output_bytes = DataBytes(results);
+  std::lock_guard<std::mutex> lock(lock_);
+  Record& record = records_[hash];
+  record.hash = hash;
+  record.executions += 1;
+  record.execute_ns += execute_ns;
+  record.input_bytes += input_bytes;
+  record.output_bytes += output_bytes;
+}
+
+std::vector<GraphStats::Record> GraphStats::GetRecords(
+    const std::string& sort_key) const {
+  std::vector<Record> records;
+  {
+    std::lock_guard<std::mutex> lock(lock_);
+    for (auto& hash_record : records_) {
+      records.push_back(hash_record.second);
+    }
+  }
+  std::stable_sort(records.begin(), records.end(),
+                   [&](const Record& r1, const Record& r2) {
+                     return SortValue(r1, sort_key) > SortValue(r2, sort_key);
+                   });
+  return records;
+}
+
+std::string GraphStats::CreateReport(const std::string& sort_key,
+                                     size_t max_graphs) const {
+  std::vector<Record> records = GetRecords(sort_key);
+  std::stringstream ss;
+  for (size_t i = 0; i < records.size() && i < max_graphs; ++i) {
+    const Record& record = records[i];
+    ss << "Graph: " << std::hex << record.hash << std::dec << "\n";
+    ss << "  HloInstructions: " << record.hlo_instructions << "\n";
+    ss << "  Misses: " << record.misses << "\n";
+    ss << "  Compiles: " << record.compiles << "\n";
+    ss << "  CompileTime: "
+       << xla::metrics::MetricFnTime(record.compile_ns) << "\n";
+    ss << "  Executions: " << record.executions << "\n";
+    ss << "  ExecuteTime: "
+       << xla::metrics::MetricFnTime(record.execute_ns) << "\n";
+    ss << "  InputBytes: " << xla::metrics::MetricFnBytes(record.input_bytes)
+       << "\n";
+    ss << "  OutputBytes: "
+       << xla::metrics::MetricFnBytes(record.output_bytes) << "\n";
+    if (!record.frames.empty()) {
+      ss << record.frames;
+    }
+  }
+  return ss.str();
+}
+
+void GraphStats::Clear() {
+  std::lock_guard<std::mutex> lock(lock_);
+  records_.clear();
+}
+
+}  // namespace torch_xla
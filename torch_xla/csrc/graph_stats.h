@@ -0,0 +1,71 @@
+#pragma once
+
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "tensorflow/compiler/xla/client/xla_computation.h"
+#include "tensorflow/compiler/xla/types.h"
+#include "tensorflow/compiler/xla/xla_client/computation_client.h"
+#include "torch_xla/csrc/python_util.h"
+
+namespace torch_xla {
+
+// Attributes the compilations and the executions of the step graphs to the
+// graph hashes (the keys of the XLATensor computation cache), so that the
+// graphs causing recompilations, or dominating the device time, can be tracked
+// down to the Python code creating them.
+// Enabled by default, it can be turned off with XLA_GRAPH_STATS=0.
+class GraphStats {
+ public:
+  struct Record {
+    size_t hash = 0;
+    // The Python frames of the first sync creating the graph. Frames are only
+    // captured the first time a graph is missing from the computation cache,
+    // and at most XLA_GRAPH_STATS_FRAMES of them (from the innermost).
+    std::vector<SourceLocation> frames;
+    xla::int64 misses = 0;
+    xla::int64 compiles = 0;
+    xla::int64 compile_ns = 0;
+    xla::int64 executions = 0;
+    xla::int64 execute_ns = 0;
+    xla::int64 input_bytes = 0;
+    xla::int64 output_bytes = 0;
+    xla::int64 hlo_instructions = 0;
+  };
+
+  static GraphStats* Get();
+
+  static bool IsEnabled();
+
+  // Records a computation cache miss for the graph. Must be called from the
+  // thread issuing the sync, for the Python frames to be meaningful.
+  void RecordMiss(size_t hash);
+
+  void RecordCompile(size_t hash, const xla::XlaComputation& computation,
+                     xla::int64 compile_ns);
+
+  void RecordExecution(
+      size_t hash, xla::int64 execute_ns,
+      const std::vector<xla::ComputationClient::DataPtr>& parameters,
+      const std::vector<xla::ComputationClient::DataPtr>& results);
+
+  // Returns the records sorted (in descending order) by sort_key, which can
+  // be "compiles", "compile_time", "executions", "execute_time", "input_bytes"
+  // or "output_bytes".
+  std::vector<Record> GetRecords(const std::string& sort_key) const;
+
+  // Returns a text report with the first max_graphs records, sorted by
+  // sort_key.
+  std::string CreateReport(const std::string& sort_key,
+                           size_t max_graphs) const;
+
+  void Clear();
+
+ private:
+  mutable std::mutex lock_;
+  std::unordered_map<size_t, Record> records_;
+};
+
+}  // namespace torch_xla
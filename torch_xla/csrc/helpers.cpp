@@ -1,6 +1,8 @@
 #include "torch_xla/csrc/helpers.h"
 
 #include <limits>
+#include <mutex>
+#include <sstream>
 
 #include "tensorflow/compiler/xla/primitive_util.h"
 #include "tensorflow/compiler/xla/shape_util.h"
@@ -14,6 +16,49 @@ namespace torch_xla {
 xla::PrecisionConfig::Precision XlaHelpers::s_mat_mul_precision =
     xla::PrecisionConfig::DEFAULT;
 
+thread_local XlaHelpers::MixedPrecision XlaHelpers::s_mixed_precision;
+thread_local bool XlaHelpers::s_has_mixed_precision = false;
+
+namespace {
+
+// The policy followed by the threads which did not set their own.
+std::mutex g_mixed_precision_mutex;
+XlaHelpers::MixedPrecision g_mixed_precision;
+
+}  // namespace
+
+XlaHelpers::MixedPrecision XlaHelpers::mixed_precision() {
+  if (s_has_mixed_precision) {
+    return s_mixed_precision;
+  }
+  std::lock_guard<std::mutex> lock(g_mixed_precision_mutex);
+  return g_mixed_precision;
+}
+
+void XlaHelpers::set_mixed_precision(const MixedPrecision& mixed_precision) {
+  s_mixed_precision = mixed_precision;
+  s_has_mixed_precision = true;
+  std::lock_guard<std::mutex> lock(g_mixed_precision_mutex);
+  g_mixed_precision = mixed_precision;
+}
+
+size_t XlaHelpers::MixedPrecision::Hash() const {
+  return xla::util::MHash(static_cast<int>(compute_type),
+                          static_cast<int>(accumulation_type));
+}
+
+std::string XlaHelpers::MixedPrecision::ToString() const {
+  auto type_name = [](xla::PrimitiveType type) -> std::string {
+    return type == xla::PrimitiveType::PRIMITIVE_TYPE_INVALID
+               ? "none"
+               : xla::primitive_util::LowercasePrimitiveTypeName(type);
+  };
+  std::stringstream ss;
+  ss << "compute_type=" << type_name(compute_type)
+     << ", accumulation_type=" << type_name(accumulation_type);
+  return ss.str();
+}
+
 xla::PrecisionConfig XlaHelpers::BuildPrecisionConfig(
     const xla::PrecisionConfig::Precision conv_precision) {
   xla::PrecisionConfig precision_config;
@@ -84,6 +129,24 @@ xla::int64 XlaHelpers::GetCanonicalPosition(
   return pos;
 }
 
+xla::PrimitiveType XlaHelpers::GetIndexType(xla::int64 dim_size) {
+  static const bool narrow_indices =
+      xla::sys_util::GetEnvBool("XLA_NARROW_INDICES", true);
+  return narrow_indices && dim_size <= std::numeric_limits<xla::int32>::max()
+             ? xla::PrimitiveType::S32
+             : xla::PrimitiveType::S64;
+}
+
+xla::XlaOp XlaHelpers::NarrowIndices(const xla::XlaOp& indices,
+                                     xla::int64 max_dim_size) {
+  xla::PrimitiveType type = TypeOfXlaOp(indices);
+  if ((type != xla::PrimitiveType::S64 && type != xla::PrimitiveType::U64) ||
+      GetIndexType(max_dim_size) != xla::PrimitiveType::S32) {
+    return indices;
+  }
+  return xla::ConvertElementType(indices, xla::PrimitiveType::S32);
+}
+
 XlaHelpers::MinMax XlaHelpers::MinMaxValues(xla::PrimitiveType type) {
   switch (type) {
     case xla::PrimitiveType::S8:
@@ -228,46 +291,68 @@ xla::XlaOp XlaHelpers::LinearInterpolation(const xla::XlaOp& value0,
   return value0 * alpha_value + value1 * (one - alpha_value);
 }
 
-std::pair<xla::XlaOp, xla::XlaOp> XlaHelpers::PromoteValues(
-    const xla::XlaOp& op1, const xla::XlaOp& op2) {
-  xla::PrimitiveType type1 = TypeOfXlaOp(op1);
-  xla::PrimitiveType type2 = TypeOfXlaOp(op2);
+xla::XlaOp XlaHelpers::MixedPrecisionOp(
+    const MixedPrecision& mixed_precision, const xla::XlaOp& lhs,
+    const xla::XlaOp& rhs,
+    const std::function<xla::XlaOp(const xla::XlaOp&, const xla::XlaOp&)>&
+        op_fn) {
+  std::pair<xla::XlaOp, xla::XlaOp> ops = PromoteValues(lhs, rhs);
+  xla::PrimitiveType type = TypeOfXlaOp(ops.first);
+  if (!xla::primitive_util::IsFloatingPointType(type)) {
+    return op_fn(ops.first, ops.second);
+  }
+  if (mixed_precision.compute_type !=
+          xla::PrimitiveType::PRIMITIVE_TYPE_INVALID &&
+      mixed_precision.compute_type != type) {
+    ops.first =
+        xla::ConvertElementType(ops.first, mixed_precision.compute_type);
+    ops.second =
+        xla::ConvertElementType(ops.second, mixed_precision.compute_type);
+  }
+  xla::XlaOp result = op_fn(ops.first, ops.second);
+  xla::PrimitiveType result_type =
+      mixed_precision.accumulation_type !=
+              xla::PrimitiveType::PRIMITIVE_TYPE_INVALID
+          ? mixed_precision.accumulation_type
+          : type;
+  return TypeOfXlaOp(result) != result_type
+             ? xla::ConvertElementType(result, result_type)
+             : result;
+}
+
+xla::PrimitiveType XlaHelpers::PromoteType(xla::PrimitiveType type1,
+                                           xla::PrimitiveType type2) {
   if (type1 == type2) {
-    return std::pair<xla::XlaOp, xla::XlaOp>(op1, op2);
+    return type1;
   }
   xla::int64 size1 = xla::ShapeUtil::ByteSizeOfPrimitiveType(type1);
   xla::int64 size2 = xla::ShapeUtil::ByteSizeOfPrimitiveType(type2);
   if (xla::primitive_util::IsFloatingPointType(type1)) {
-    if (!xla::primitive_util::IsFloatingPointType(type2) || size1 >= size2) {
-      return std::pair<xla::XlaOp, xla::XlaOp>(
-          op1, ConvertTo(op2, type2, type1, /*device=*/nullptr));
-    }
-    return std::pair<xla::XlaOp, xla::XlaOp>(
-        ConvertTo(op1, type1, type2, /*device=*/nullptr), op2);
+    return !xla::primitive_util::IsFloatingPointType(type2) || size1 >= size2
+               ? type1
+               : type2;
   }
   if (xla::primitive_util::IsFloatingPointType(type2) || size2 >= size1) {
-    return std::pair<xla::XlaOp, xla::XlaOp>(
-        ConvertTo(op1, type1, type2, /*device=*/nullptr), op2);
+    return type2;
   }
   if (xla::primitive_util::IsIntegralType(type1) &&
       xla::primitive_util::IsIntegralType(type2)) {
-    if (size1 >= size2) {
-      return std::pair<xla::XlaOp, xla::XlaOp>(
-          op1, ConvertTo(op2, type2, type1, /*device=*/nullptr));
-    }
-    return std::pair<xla::XlaOp, xla::XlaOp>(
-        ConvertTo(op1, type1, type2, /*device=*/nullptr), op2);
+    return size1 >= size2 ? type1 : type2;
   }
   if (type1 == xla::PrimitiveType::PRED) {
-    return std::pair<xla::XlaOp, xla::XlaOp>(
-        ConvertTo(op1, type1, type2, /*device=*/nullptr), op2);
-  }
-  if (type2 == xla::PrimitiveType::PRED) {
-    return std::pair<xla::XlaOp, xla::XlaOp>(
-        op1, ConvertTo(op2, type2, type1, /*device=*/nullptr));
+    return type2;
   }
+  return type1;
+}
+
+std::pair<xla::XlaOp, xla::XlaOp> XlaHelpers::PromoteValues(
+    const xla::XlaOp& op1, const xla::XlaOp& op2) {
+  xla::PrimitiveType type1 = TypeOfXlaOp(op1);
+  xla::PrimitiveType type2 = TypeOfXlaOp(op2);
+  xla::PrimitiveType type = PromoteType(type1, type2);
   return std::pair<xla::XlaOp, xla::XlaOp>(
-      op1, ConvertTo(op2, type2, type1, /*device=*/nullptr));
+      type1 == type ? op1 : ConvertTo(op1, type1, type, /*device=*/nullptr),
+      type2 == type ? op2 : ConvertTo(op2, type2, type, /*device=*/nullptr));
 }
 
 std::pair<xla::XlaOp, xla::XlaOp> XlaHelpers::PromoteSecondValue(
@@ -316,6 +401,14 @@ xla::Shape XlaHelpers::GetPromotedShape(const xla::Shape& shape1,
   return xla::ShapeUtil::MakeShape(shape1.element_type(), dimensions);
 }
 
+xla::Shape XlaHelpers::GetPromotedBinaryOpShape(const xla::Shape& shape1,
+                                                const xla::Shape& shape2) {
+  xla::Shape shape = GetPromotedShape(shape1, shape2);
+  shape.set_element_type(
+      PromoteType(shape1.element_type(), shape2.element_type()));
+  return shape;
+}
+
 std::pair<xla::XlaOp, xla::XlaOp> XlaHelpers::PromoteShapes(
     const xla::XlaOp& op1, const xla::XlaOp& op2) {
   xla::Shape shape1 = ShapeOfXlaOp(op1);
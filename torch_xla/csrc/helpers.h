@@ -4,6 +4,7 @@
 #include <c10/util/Optional.h>
 
 #include <functional>
+#include <string>
 #include <vector>
 
 #include "tensorflow/compiler/xla/client/xla_builder.h"
@@ -24,6 +25,23 @@ class XlaHelpers {
     at::Scalar max;
   };
 
+  // The mixed precision policy of the dot and convolution operations. The
+  // policy in effect is captured when the IR nodes are created.
+  struct MixedPrecision {
+    size_t Hash() const;
+
+    std::string ToString() const;
+
+    // If valid, the floating point operands are converted to this type before
+    // running the operation.
+    xla::PrimitiveType compute_type =
+        xla::PrimitiveType::PRIMITIVE_TYPE_INVALID;
+    // If valid, the floating point results are converted to this type.
+    // Otherwise they keep the (promoted) type of the operands.
+    xla::PrimitiveType accumulation_type =
+        xla::PrimitiveType::PRIMITIVE_TYPE_INVALID;
+  };
+
   template <class T>
   static xla::Literal ScalarLiteral(T scalar_value, xla::PrimitiveType type) {
     switch (type) {
@@ -147,6 +165,18 @@ class XlaHelpers {
       tensorflow::gtl::ArraySlice<const xla::int64> dimensions, xla::int64 dim,
       xla::int64 pos);
 
+  // Returns the type of the indices into a dimension of dim_size elements,
+  // which is S32 when they all fit (unless disabled with
+  // XLA_NARROW_INDICES=0), and S64 otherwise.
+  static xla::PrimitiveType GetIndexType(xla::int64 dim_size);
+
+  // Converts 64 bit indices into dimensions of up to max_dim_size elements to
+  // 32 bit, when GetIndexType() allows it. The valid indices of such
+  // dimensions provably fit, so the gathers and scatters fed with the narrowed
+  // indices produce the same results, while running on 32 bit arithmetic.
+  static xla::XlaOp NarrowIndices(const xla::XlaOp& indices,
+                                  xla::int64 max_dim_size);
+
   // Retrieves type's minimum and maximum values.
   static MinMax MinMaxValues(xla::PrimitiveType type);
 
@@ -190,6 +220,11 @@ class XlaHelpers {
                                                           xla::int64 dim1,
                                                           xla::int64 rank);
 
+  // Returns the type both operands of a binary operation are converted to by
+  // PromoteValues().
+  static xla::PrimitiveType PromoteType(xla::PrimitiveType type1,
+                                        xla::PrimitiveType type2);
+
   // Performs type promotion to make sure both operations return the same type.
   static std::pair<xla::XlaOp, xla::XlaOp> PromoteValues(const xla::XlaOp& op1,
                                                          const xla::XlaOp& op2);
@@ -227,6 +262,11 @@ class XlaHelpers {
   static xla::Shape GetPromotedShape(const xla::Shape& shape1,
                                      const xla::Shape& shape2);
 
+  // Returns the shape of the result of an elementwise binary operation whose
+  // operands are promoted with Promote(), without building any XLA operation.
+  static xla::Shape GetPromotedBinaryOpShape(const xla::Shape& shape1,
+                                             const xla::Shape& shape2);
+
   // Returns a new operations which broadcast the input operation into the
   // shape. The op_shape is the shape of the op operation, while shape should be
   // one that op is broadcast-able to (usually the result of a
@@ -281,8 +321,28 @@ class XlaHelpers {
     s_mat_mul_precision = precision;
   }
 
+  // The mixed precision policy is per thread, so that each device thread can
+  // select its own. The threads which never set one, like the autograd engine
+  // threads running the backward of the XLA tensors, follow the policy last
+  // set by any thread.
+  static MixedPrecision mixed_precision();
+
+  static void set_mixed_precision(const MixedPrecision& mixed_precision);
+
+  // Runs the op_fn dot or convolution builder on the lhs and rhs operands,
+  // after having promoted them to the same type and converted them to the
+  // compute type of the policy. The result is then converted to the policy
+  // accumulation type.
+  static xla::XlaOp MixedPrecisionOp(
+      const MixedPrecision& mixed_precision, const xla::XlaOp& lhs,
+      const xla::XlaOp& rhs,
+      const std::function<xla::XlaOp(const xla::XlaOp&, const xla::XlaOp&)>&
+          op_fn);
+
  private:
   static xla::PrecisionConfig::Precision s_mat_mul_precision;
+  static thread_local MixedPrecision s_mixed_precision;
+  static thread_local bool s_has_mixed_precision;
 };
 
 }  // namespace torch_xla
@@ -0,0 +1,273 @@
+#include "torch_xla/csrc/index_cost_model.h"
+
+#include <algorithm>
+#include <exception>
+#include <limits>
+#include <sstream>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+#include "tensorflow/compiler/xla/client/lib/constants.h"
+#include "tensorflow/compiler/xla/client/lib/slicing.h"
+#include "tensorflow/compiler/xla/client/xla_builder.h"
+#include "tensorflow/compiler/xla/primitive_util.h"
+#include "tensorflow/compiler/xla/shape_util.h"
+#include "tensorflow/compiler/xla/xla_client/computation_client.h"
+#include "tensorflow/compiler/xla/xla_client/debug_macros.h"
+#include "tensorflow/compiler/xla/xla_client/metrics.h"
+#include "tensorflow/compiler/xla/xla_client/persistent_cache.h"
+#include "tensorflow/compiler/xla/xla_client/sys_util.h"
+#include "tensorflow/compiler/xla/xla_client/tf_logging.h"
+#include "torch_xla/csrc/device.h"
+#include "torch_xla/csrc/helpers.h"
+#include "torch_xla/csrc/tensor_util.h"
+#include "torch_xla/csrc/xla_lower_util.h"
+
+namespace torch_xla {
+namespace {
+
+// The calibration computations use an index of kIndexRows x kColumns elements,
+// and an input with (ratio * kIndexRows) x kColumns elements, for ratios up to
+// kMaxRatio.
+constexpr xla::int64 kIndexRows = 64;
+constexpr xla::int64 kColumns = 4;
+constexpr xla::int64 kMaxRatio = 4096;
+constexpr int kTimedRuns = 5;
+
+// The element types getting their own calibration. The other types use the
+// F32 factors.
+const xla::PrimitiveType kCalibrationTypes[] = {xla::PrimitiveType::F32,
+                                                xla::PrimitiveType::S32};
+
+const IndexCostModel::Op kCalibrationOps[] = {IndexCostModel::Op::kGather,
+                                              IndexCostModel::Op::kScatter};
+
+std::string FactorKey(IndexCostModel::Op op, xla::PrimitiveType type) {
+  return absl::StrCat(op == IndexCostModel::Op::kGather ? "gather" : "scatter",
+                      ":",
+                      xla::primitive_util::LowercasePrimitiveTypeName(type));
+}
+
+std::string GetDeviceKind(const Device& device) {
+  std::string device_str = device.ToString();
+  return device_str.substr(0, device_str.find(':'));
+}
+
+xla::XlaComputation BuildCalibrationComputation(IndexCostModel::Op op,
+                                                xla::PrimitiveType type,
+                                                xla::PrimitiveType index_type,
+                                                xla::int64 ratio, bool dense) {
+  xla::XlaBuilder builder("IndexCostModel");
+  xla::XlaOp input = xla::ConvertElementType(
+      xla::Iota(&builder,
+                xla::ShapeUtil::MakeShape(xla::PrimitiveType::S32,
+                                          {ratio * kIndexRows, kColumns}),
+                0),
+      type);
+  // Spread the indices over the whole input.
+  xla::XlaOp index =
+      xla::Iota(&builder,
+                xla::ShapeUtil::MakeShape(index_type, {kIndexRows, kColumns}),
+                0) *
+      XlaHelpers::ScalarValue<xla::int64>(ratio, index_type, &builder);
+  xla::XlaOp result;
+  if (op == IndexCostModel::Op::kGather) {
+    result = xla::TorchGather(input, index, /*dim=*/0, /*sparse=*/!dense);
+  } else {
+    xla::XlaOp src = xla::ConvertElementType(
+        xla::Iota(&builder,
+                  xla::ShapeUtil::MakeShape(xla::PrimitiveType::S32,
+                                            {kIndexRows, kColumns}),
+                  1),
+        type);
+    auto add_scatter_combiner = [](const xla::XlaOp& x,
+                                   const xla::XlaOp& y) -> xla::XlaOp {
+      return x + y;
+    };
+    result = CreateScatter(input, index, src, /*dim=*/0, add_scatter_combiner,
+                           dense);
+  }
+  // Reduce the result to a scalar, so that fetching it does not add noise to
+  // the measurement.
+  xla::XlaOp root =
+      xla::Reduce(result, xla::Zero(&builder, type),
+                  XlaHelpers::CreateAddComputation(type), {0, 1});
+  return ConsumeValue(builder.Build(root));
+}
+
+// Returns the best execution time (in nanoseconds) of the computation, over
+// a few runs.
+xla::int64 MeasureExecutionNs(xla::XlaComputation computation,
+                              const Device& device) {
+  xla::ProgramShape program_shape = ConsumeValue(computation.GetProgramShape());
+  xla::Shape shape =
+      MakeShapeWithDeviceLayout(program_shape.result(), device.hw_type);
+  std::string device_str = device.ToString();
+  std::vector<xla::ComputationClient::CompileInstance> instances;
+  instances.push_back({std::move(computation), device_str,
+                       xla::ComputationClient::Get()->GetCompilationDevices(
+                           device_str, {}),
+                       &shape});
+  std::vector<std::shared_ptr<xla::ComputationClient::Computation>>
+      computations =
+          xla::ComputationClient::Get()->Compile(std::move(instances));
+  xla::ComputationClient::ExecuteComputationOptions options;
+  // The first run is not accounted, as it might include one-off costs.
+  xla::ComputationClient::Get()->ExecuteComputation(*computations.front(), {},
+                                                    device_str, options);
+  xla::int64 best_ns = std::numeric_limits<xla::int64>::max();
+  for (int i = 0; i < kTimedRuns; ++i) {
+    xla::int64 start = xla::sys_util::NowNs();
+    xla::ComputationClient::Get()->ExecuteComputation(*computations.front(),
+                                                      {}, device_str, options);
+    best_ns = std::min(best_ns, xla::sys_util::NowNs() - start);
+  }
+  return best_ns;
+}
+
+// Returns the largest input/index elements ratio for which the dense lowering
+// is faster than the sparse one. The sweep stops once the sparse lowering has
+// been faster twice in a row.
+xla::int64 CalibrateDenseFactor(IndexCostModel::Op op, xla::PrimitiveType type,
+                                xla::PrimitiveType index_type,
+                                const Device& device) {
+  xla::int64 factor = 1;
+  int sparse_wins = 0;
+  for (xla::int64 ratio = 1; ratio <= kMaxRatio && sparse_wins < 2;
+       ratio *= 2) {
+    xla::int64 dense_ns = MeasureExecutionNs(
+        BuildCalibrationComputation(op, type, index_type, ratio,
+                                    /*dense=*/true),
+        device);
+    xla::int64 sparse_ns = MeasureExecutionNs(
+        BuildCalibrationComputation(op, type, index_type, ratio,
+                                    /*dense=*/false),
+        device);
+    TF_VLOG(3) << "Index cost model " << FactorKey(op, type)
+               << ": ratio=" << ratio << " dense=" << dense_ns
+               << "ns sparse=" << sparse_ns << "ns";
+    if (dense_ns < sparse_ns) {
+      factor = ratio;
+      sparse_wins = 0;
+    } else {
+      ++sparse_wins;
+    }
+  }
+  return factor;
+}
+
+}  // namespace
+
+IndexCostModel* IndexCostModel::Get() {
+  static IndexCostModel* model = new IndexCostModel(
+      xla::sys_util::GetEnvBool("XLA_INDEX_COST_MODEL", false),
+      xla::sys_util::GetEnvString("XLA_INDEX_COST_MODEL_PATH",
+                                  "/tmp/xla_index_cost_model"));
+  return model;
+}
+
+IndexCostModel::IndexCostModel(bool calibrate, std::string path)
+    : calibrate_(calibrate),
+      path_(std::move(path)),
+      gather_factor_(xla::sys_util::GetEnvInt("XLA_DENSE_GATHER_FACTOR", 100)),
+      scatter_factor_(
+          xla::sys_util::GetEnvInt("XLA_DENSE_SCATTER_FACTOR", 100)) {}
+
+bool IndexCostModel::UseDense(Op op, const xla::Shape& input_shape,
+                              const xla::Shape& index_shape) {
+  xla::int64 input_elements = xla::ShapeUtil::ElementsIn(input_shape);
+  xla::int64 index_elements = xla::ShapeUtil::ElementsIn(index_shape);
+  bool dense = index_elements >=
+               input_elements / GetDenseFactor(op, input_shape.element_type());
+  if (op == Op::kGather) {
+    if (dense) {
+      XLA_COUNTER("DenseGather", 1);
+    } else {
+      XLA_COUNTER("SparseGather", 1);
+    }
+  } else {
+    if (dense) {
+      XLA_COUNTER("DenseScatter", 1);
+    } else {
+      XLA_COUNTER("SparseScatter", 1);
+    }
+  }
+  return dense;
+}
+
+xla::int64 IndexCostModel::GetDenseFactor(Op op, xla::PrimitiveType type) {
+  if (calibrate_) {
+    std::call_once(once_, [this]() { LoadOrCalibrate(); });
+    auto it = factors_.find(FactorKey(op, type));
+    if (it == factors_.end()) {
+      it = factors_.find(FactorKey(op, xla::PrimitiveType::F32));
+    }
+    if (it != factors_.end()) {
+      return it->second;
+    }
+  }
+  return std::max<xla::int64>(
+      op == Op::kGather ? gather_factor_ : scatter_factor_, 1);
+}
+
+void IndexCostModel::LoadOrCalibrate() {
+  const Device* device = GetDefaultDevice();
+  std::string device_kind = GetDeviceKind(*device);
+  std::string key = absl::StrCat("index_cost_model_", device_kind);
+  try {
+    xla::util::PersistentCache cache(path_);
+    std::unique_ptr<std::string> blob = cache.Get(key);
+    if (blob != nullptr && Load(*blob)) {
+      XLA_COUNTER("IndexCostModelLoads", 1);
+      return;
+    }
+    TF_LOG(INFO) << "Calibrating the index cost model for " << device_kind
+                 << " devices";
+    xla::PrimitiveType index_type =
+        GetDevicePrimitiveType(xla::PrimitiveType::S64, device);
+    for (auto op : kCalibrationOps) {
+      for (auto type : kCalibrationTypes) {
+        factors_[FactorKey(op, type)] = CalibrateDenseFactor(
+            op, GetDevicePrimitiveType(type, device), index_type, *device);
+      }
+    }
+    XLA_COUNTER("IndexCostModelCalibrations", 1);
+    cache.Put(key, Serialize());
+  } catch (const std::exception& ex) {
+    TF_LOG(WARNING) << "Index cost model calibration failed, using the "
+                    << "default factors: " << ex.what();
+    factors_.clear();
+  }
+}
+
+bool IndexCostModel::Load(const std::string& blob) {
+  std::map<std::string, xla::int64> factors;
+  std::istringstream stream(blob);
+  std::string factor_key;
+  xla::int64 factor;
+  while (stream >> factor_key >> factor) {
+    if (factor < 1) {
+      return false;
+    }
+    factors[factor_key] = factor;
+  }
+  for (auto op : kCalibrationOps) {
+    for (auto type : kCalibrationTypes) {
+      if (factors.count(FactorKey(op, type)) == 0) {
+        return false;
+      }
+    }
+  }
+  factors_ = std::move(factors);
+  return true;
+}
+
+std::string IndexCostModel::Serialize() const {
+  std::stringstream ss;
+  for (auto& key_factor : factors_) {
+    ss << key_factor.first << " " << key_factor.second << "\n";
+  }
+  return ss.str();
+}
+
+}  // namespace torch_xla
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <map>
+#include <mutex>
+#include <string>
+
+#include "tensorflow/compiler/xla/shape.h"
+#include "tensorflow/compiler/xla/types.h"
+
+namespace torch_xla {
+
+// Selects between the dense (one-hot mask based) and the native XLA
+// gather/scatter lowerings of the gather and scatter operations.
+// The dense lowering is used when the number of index elements is at least
+// the number of input elements divided by a factor. By default the factors
+// come from the XLA_DENSE_GATHER_FACTOR and XLA_DENSE_SCATTER_FACTOR variables.
+// When XLA_INDEX_COST_MODEL is enabled, the factors are instead calibrated for
+// the kind of the default device, by timing both lowerings over a range of
+// input/index size ratios, and stored within the XLA_INDEX_COST_MODEL_PATH
+// folder, so that following processes can load them back.
+class IndexCostModel {
+ public:
+  enum class Op { kGather, kScatter };
+
+  static IndexCostModel* Get();
+
+  // Returns whether the dense lowering should be used for op, with the given
+  // input and index shapes. The decision is recorded within the DenseGather,
+  // SparseGather, DenseScatter and SparseScatter counters.
+  bool UseDense(Op op, const xla::Shape& input_shape,
+                const xla::Shape& index_shape);
+
+  // Returns the factor used for op with the given element type.
+  xla::int64 GetDenseFactor(Op op, xla::PrimitiveType type);
+
+ private:
+  IndexCostModel(bool calibrate, std::string path);
+
+  void LoadOrCalibrate();
+
+  bool Load(const std::string& blob);
+
+  std::string Serialize() const;
+
+  bool calibrate_;
+  std::string path_;
+  xla::int64 gather_factor_;
+  xla::int64 scatter_factor_;
+  std::once_flag once_;
+  // Maps "<op>:<type>" keys (like "gather:f32") to the calibrated factors.
+  std::map<std::string, xla::int64> factors_;
+};
+
+}  // namespace torch_xla
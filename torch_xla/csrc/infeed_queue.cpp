@@ -0,0 +1,150 @@
+#include "torch_xla/csrc/infeed_queue.h"
+
+#include <utility>
+
+#include "tensorflow/compiler/xla/xla_client/debug_macros.h"
+#include "tensorflow/compiler/xla/xla_client/metrics.h"
+#include "tensorflow/compiler/xla/xla_client/sys_util.h"
+#include "tensorflow/compiler/xla/xla_client/thread_pool.h"
+#include "torch_xla/csrc/aten_xla_bridge.h"
+#include "torch_xla/csrc/input_profiler.h"
+#include "torch_xla/csrc/staging_buffers.h"
+#include "torch_xla/csrc/tensor.h"
+#include "torch_xla/csrc/tensor_util.h"
+
+namespace torch_xla {
+
+InfeedQueue::~InfeedQueue() {
+  Close();
+  // The uploads reference the queue, so wait for the in flight ones.
+  std::unique_lock<std::mutex> lock(mutex_);
+  cv_.wait(lock, [this] { return pending_uploads_ == 0; });
+}
+
+bool InfeedQueue::Put(size_t key, std::vector<at::Tensor> tensors,
+                      std::vector<std::string> devices) {
+  XLA_CHECK_EQ(tensors.size(), devices.size());
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    // Close() also closes the queue for writing, but a producer racing with
+    // it must see a closed queue, not a Put() error.
+    if (closed_) {
+      return false;
+    }
+    XLA_CHECK(!closed_write_) << "Put() on a queue closed for writing";
+    cv_.wait(lock, [this] { return closed_ || batches_.size() < capacity_; });
+    if (closed_) {
+      return false;
+    }
+    Batch batch;
+    batch.put_ns = xla::sys_util::NowNs();
+    XLA_CHECK(batches_.emplace(key, std::move(batch)).second)
+        << "Batch " << key << " already put";
+    ++pending_uploads_;
+  }
+  auto uploader = [this, key, tensors = std::move(tensors),
+                   devices = std::move(devices)]() mutable {
+    Upload(key, std::move(tensors), std::move(devices));
+  };
+  xla::env::ScheduleIoClosure(std::move(uploader));
+  return true;
+}
+
+void InfeedQueue::Upload(size_t key, std::vector<at::Tensor> tensors,
+                         std::vector<std::string> devices) {
+  std::vector<at::Tensor> xla_tensors;
+  std::exception_ptr exptr;
+  try {
+    XLA_TIMED("InfeedUploadTime");
+    std::vector<at::Tensor> staged_tensors;
+    staged_tensors.reserve(tensors.size());
+    for (size_t i = 0; i < tensors.size(); ++i) {
+      staged_tensors.push_back(StagingBufferPool::Get()->CopyToStaging(
+          tensors[i], Device(devices[i])));
+    }
+    // The host tensors are no longer needed once copied.
+    tensors.clear();
+    auto data_handles = CreateTensorsData(staged_tensors, devices);
+    if (InputProfiler::IsEnabled()) {
+      InputProfiler::Get()->RecordUploaded(data_handles);
+    }
+    xla_tensors.reserve(data_handles.size());
+    for (auto& data_handle : data_handles) {
+      xla_tensors.push_back(
+          bridge::AtenFromXlaTensor(XLATensor::Create(std::move(data_handle))));
+    }
+  } catch (...) {
+    exptr = std::current_exception();
+  }
+  static xla::metrics::Metric* pending_time_metric = new xla::metrics::Metric(
+      "InputPendingTime", xla::metrics::MetricFnTime);
+  xla::int64 now_ns = xla::sys_util::NowNs();
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = batches_.find(key);
+  if (it != batches_.end()) {
+    pending_time_metric->AddSample(now_ns - it->second.put_ns);
+    it->second.ready = true;
+    it->second.ready_ns = now_ns;
+    it->second.tensors = std::move(xla_tensors);
+    it->second.exptr = exptr;
+  }
+  --pending_uploads_;
+  cv_.notify_all();
+}
+
+absl::optional<std::vector<at::Tensor>> InfeedQueue::Get(size_t key) {
+  static xla::metrics::Metric* ready_time_metric = new xla::metrics::Metric(
+      "InputReadyTime", xla::metrics::MetricFnTime);
+  static xla::metrics::Metric* stall_time_metric = new xla::metrics::Metric(
+      "InputStallTime", xla::metrics::MetricFnTime);
+  std::unique_lock<std::mutex> lock(mutex_);
+  size_t ready_batches = 0;
+  for (auto& key_batch : batches_) {
+    ready_batches += key_batch.second.ready ? 1 : 0;
+  }
+  XLA_VALUE_METRIC("InputQueueDepth", ready_batches);
+  auto it = batches_.find(key);
+  xla::int64 stall_start_ns = 0;
+  if (it == batches_.end() || !it->second.ready) {
+    XLA_COUNTER("InfeedStalls", 1);
+    stall_start_ns = xla::sys_util::NowNs();
+  }
+  cv_.wait(lock, [&] {
+    if (closed_) {
+      return true;
+    }
+    it = batches_.find(key);
+    return it != batches_.end() ? it->second.ready : closed_write_;
+  });
+  if (closed_ || it == batches_.end()) {
+    return absl::nullopt;
+  }
+  xla::int64 now_ns = xla::sys_util::NowNs();
+  if (stall_start_ns > 0) {
+    stall_time_metric->AddSample(now_ns - stall_start_ns);
+  }
+  ready_time_metric->AddSample(now_ns - it->second.ready_ns);
+  Batch batch = std::move(it->second);
+  batches_.erase(it);
+  cv_.notify_all();
+  if (batch.exptr != nullptr) {
+    std::rethrow_exception(batch.exptr);
+  }
+  return std::move(batch.tensors);
+}
+
+void InfeedQueue::CloseWrite() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  closed_write_ = true;
+  cv_.notify_all();
+}
+
+void InfeedQueue::Close() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  closed_ = true;
+  closed_write_ = true;
+  batches_.clear();
+  cv_.notify_all();
+}
+
+}  // namespace torch_xla
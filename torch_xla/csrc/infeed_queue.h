@@ -0,0 +1,73 @@
+#pragma once
+
+#include <ATen/ATen.h>
+
+#include <condition_variable>
+#include <exception>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "absl/types/optional.h"
+#include "tensorflow/compiler/xla/types.h"
+
+namespace torch_xla {
+
+// A bounded queue of input batches, which are uploaded to their devices by the
+// IO thread pool, in background and without any involvement of the Python
+// interpreter. Producers put host batches keyed by batch number, and the
+// consumer gets their device tensors in any order. Up to capacity batches can
+// be in flight (either being uploaded, or ready), after which Put() blocks.
+// The lifecycle of the batches is reported by the InputQueueDepth (ready
+// batches when one is requested), InputPendingTime (put to ready),
+// InputReadyTime (ready to got) and InputStallTime (time Get() waits for a
+// batch not ready yet) metrics.
+class InfeedQueue {
+ public:
+  explicit InfeedQueue(size_t capacity) : capacity_(capacity) {}
+
+  ~InfeedQueue();
+
+  // Schedules the upload of tensors[i] to the XLA device devices[i], as the
+  // batch with the given key. The host tensors are copied into staging
+  // buffers, so the caller is free to reuse them once the upload completes.
+  // Returns false if the queue has been closed.
+  bool Put(size_t key, std::vector<at::Tensor> tensors,
+           std::vector<std::string> devices);
+
+  // Waits for the batch with the given key to be uploaded, and returns its
+  // device tensors. Returns absl::nullopt if the queue is closed, or if it is
+  // closed for writing, and the batch was never put. Upload errors are
+  // rethrown here.
+  absl::optional<std::vector<at::Tensor>> Get(size_t key);
+
+  // Tells the queue that no more batches will be put.
+  void CloseWrite();
+
+  // Closes the queue, waking up all the waiters, and dropping all the
+  // batches.
+  void Close();
+
+ private:
+  struct Batch {
+    bool ready = false;
+    xla::int64 put_ns = 0;
+    xla::int64 ready_ns = 0;
+    std::vector<at::Tensor> tensors;
+    std::exception_ptr exptr;
+  };
+
+  void Upload(size_t key, std::vector<at::Tensor> tensors,
+              std::vector<std::string> devices);
+
+  size_t capacity_ = 0;
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::map<size_t, Batch> batches_;
+  size_t pending_uploads_ = 0;
+  bool closed_ = false;
+  bool closed_write_ = false;
+};
+
+}  // namespace torch_xla
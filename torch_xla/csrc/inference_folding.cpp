@@ -0,0 +1,309 @@
+#include "torch_xla/csrc/inference_folding.h"
+
+#include <unordered_map>
+
+#include "absl/strings/str_cat.h"
+#include "tensorflow/compiler/xla/client/xla_builder.h"
+#include "tensorflow/compiler/xla/primitive_util.h"
+#include "tensorflow/compiler/xla/shape_util.h"
+#include "tensorflow/compiler/xla/xla_client/cache.h"
+#include "tensorflow/compiler/xla/xla_client/computation_client.h"
+#include "tensorflow/compiler/xla/xla_client/debug_macros.h"
+#include "tensorflow/compiler/xla/xla_client/metrics.h"
+#include "tensorflow/compiler/xla/xla_client/sys_util.h"
+#include "tensorflow/compiler/xla/xla_client/util.h"
+#include "torch_xla/csrc/helpers.h"
+#include "torch_xla/csrc/ir_util.h"
+#include "torch_xla/csrc/ops/convolution_overrideable.h"
+#include "torch_xla/csrc/ops/device_data.h"
+#include "torch_xla/csrc/ops/fused_convolution.h"
+#include "torch_xla/csrc/ops/leaky_relu.h"
+#include "torch_xla/csrc/ops/native_batch_norm_forward.h"
+#include "torch_xla/csrc/tensor_util.h"
+
+namespace torch_xla {
+namespace {
+
+using DataPtr = xla::ComputationClient::DataPtr;
+
+struct FoldedWeights {
+  DataPtr weight;
+  DataPtr bias;
+};
+
+using FoldedWeightsCache = xla::util::Cache<size_t, FoldedWeights>;
+
+FoldedWeightsCache* GetFoldedWeightsCache() {
+  static const size_t kMaxCacheBytes =
+      xla::sys_util::GetEnvInt("XLA_FOLDED_WEIGHTS_CACHE_MB", 512) * 1024 *
+      1024;
+  static FoldedWeightsCache* cache = new FoldedWeightsCache(
+      kMaxCacheBytes, [](const size_t&, const FoldedWeights& weights) {
+        return xla::ShapeUtil::ByteSizeOf(weights.weight->shape()) +
+               xla::ShapeUtil::ByteSizeOf(weights.bias->shape());
+      });
+  return cache;
+}
+
+// A convolution, the inference mode batch normalization reading it, and the
+// activation reading the normalized value, if any.
+struct FoldableChain {
+  const ir::ops::ConvolutionOverrideable* conv = nullptr;
+  const ir::ops::NativeBatchNormForward* batch_norm = nullptr;
+  const ir::Node* activation = nullptr;
+};
+
+class Folder {
+ public:
+  Folder(tensorflow::gtl::ArraySlice<const ir::Value> roots,
+         const std::function<bool(const ir::Node*)>& is_constant)
+      : is_constant_(is_constant) {
+    std::vector<const ir::Node*> nodes;
+    for (auto& root : roots) {
+      nodes.push_back(root.node.get());
+      users_[ir::Output(root.node.get(), root.index)].push_back(nullptr);
+    }
+    post_order_ = ir::Util::ComputePostOrder(nodes);
+    for (auto node : post_order_) {
+      for (auto& operand : node->operands()) {
+        users_[operand].push_back(node);
+      }
+    }
+  }
+
+  const std::vector<const ir::Node*>& post_order() const {
+    return post_order_;
+  }
+
+  // Returns whether the node is an inference mode batch normalization which
+  // can be folded, together with the convolution feeding it and the activation
+  // reading it.
+  bool Match(const ir::Node* node, FoldableChain* chain) const {
+    const auto* batch_norm =
+        dynamic_cast<const ir::ops::NativeBatchNormForward*>(node);
+    if (batch_norm == nullptr || batch_norm->training()) {
+      return false;
+    }
+    for (size_t i = 1; i < batch_norm->num_outputs(); ++i) {
+      if (NumUsers(ir::Output(batch_norm, i)) != 0) {
+        return false;
+      }
+    }
+    const ir::Output& input = batch_norm->operand(0);
+    const auto* conv =
+        dynamic_cast<const ir::ops::ConvolutionOverrideable*>(input.node);
+    if (conv == nullptr || conv->transposed() || NumUsers(input) != 1) {
+      return false;
+    }
+    xla::PrimitiveType type = conv->operand(1).shape().element_type();
+    if (!xla::primitive_util::IsFloatingPointType(type)) {
+      return false;
+    }
+    for (size_t i = 1; i < conv->operands().size(); ++i) {
+      if (!IsConstant(conv->operand(i), type)) {
+        return false;
+      }
+    }
+    for (size_t i = 1; i < batch_norm->operands().size(); ++i) {
+      if (!IsConstant(batch_norm->operand(i), type)) {
+        return false;
+      }
+    }
+    chain->conv = conv;
+    chain->batch_norm = batch_norm;
+    chain->activation = nullptr;
+    ir::Output output(batch_norm, 0);
+    if (NumUsers(output) == 1) {
+      const ir::Node* user = users_.at(output).front();
+      if (user != nullptr && (user->op() == ir::OpKind(at::aten::relu) ||
+                              dynamic_cast<const ir::ops::LeakyRelu*>(user) !=
+                                  nullptr)) {
+        chain->activation = user;
+      }
+    }
+    return true;
+  }
+
+ private:
+  size_t NumUsers(const ir::Output& output) const {
+    auto it = users_.find(output);
+    return it != users_.end() ? it->second.size() : 0;
+  }
+
+  bool IsConstant(const ir::Output& output, xla::PrimitiveType type) const {
+    return dynamic_cast<const ir::ops::DeviceData*>(output.node) != nullptr &&
+           is_constant_(output.node) &&
+           output.shape().element_type() == type;
+  }
+
+  std::function<bool(const ir::Node*)> is_constant_;
+  std::vector<const ir::Node*> post_order_;
+  // The users of the graph outputs, where the roots have a nullptr user.
+  std::unordered_map<ir::Output, std::vector<const ir::Node*>,
+                     ir::Output::Hasher>
+      users_;
+};
+
+const DataPtr& GetNodeData(const ir::Output& output) {
+  return static_cast<const ir::ops::DeviceData*>(output.node)->data();
+}
+
+// Computes weight * scale and (bias - mean) * scale + beta, with the scale
+// being gamma / sqrt(var + eps), broadcast along the output features.
+xla::XlaComputation BuildFoldingComputation(
+    tensorflow::gtl::ArraySlice<const DataPtr> data, bool has_bias,
+    double eps) {
+  xla::XlaBuilder builder("FoldBatchNorm");
+  std::vector<xla::XlaOp> params;
+  for (size_t i = 0; i < data.size(); ++i) {
+    params.push_back(xla::Parameter(&builder, i, data[i]->shape(),
+                                    absl::StrCat("p", i)));
+  }
+  size_t index = 0;
+  xla::XlaOp weight = params[index++];
+  xla::XlaOp bias = has_bias ? params[index++] : xla::XlaOp();
+  xla::XlaOp gamma = params[index++];
+  xla::XlaOp beta = params[index++];
+  xla::XlaOp mean = params[index++];
+  xla::XlaOp var = params[index++];
+  xla::PrimitiveType type = data[0]->shape().element_type();
+  xla::XlaOp scale =
+      gamma *
+      xla::Rsqrt(var + XlaHelpers::ScalarValue<double>(eps, type, &builder));
+  xla::XlaOp folded_weight =
+      xla::Mul(weight, scale, /*broadcast_dimensions=*/{0});
+  xla::XlaOp folded_bias =
+      has_bias ? (bias - mean) * scale + beta : beta - mean * scale;
+  xla::Tuple(&builder, {folded_weight, folded_bias});
+  return ConsumeValue(builder.Build());
+}
+
+FoldedWeights FoldWeights(const FoldableChain& chain, const Device& device) {
+  std::vector<DataPtr> data;
+  for (size_t i = 1; i < chain.conv->operands().size(); ++i) {
+    data.push_back(GetNodeData(chain.conv->operand(i)));
+  }
+  for (size_t i = 1; i < chain.batch_norm->operands().size(); ++i) {
+    data.push_back(GetNodeData(chain.batch_norm->operand(i)));
+  }
+  bool has_bias = chain.conv->operands().size() == 3;
+  size_t key = xla::util::MHash(has_bias, chain.batch_norm->eps());
+  for (auto& argument : data) {
+    key = xla::util::HashCombine(key, argument->unique_id());
+  }
+  FoldedWeightsCache* cache = GetFoldedWeightsCache();
+  std::shared_ptr<FoldedWeights> weights = cache->Get(key);
+  if (weights != nullptr) {
+    XLA_COUNTER("FoldedWeightsCacheHit", 1);
+    return *weights;
+  }
+  xla::XlaComputation computation =
+      BuildFoldingComputation(data, has_bias, chain.batch_norm->eps());
+  xla::ProgramShape program_shape = ConsumeValue(computation.GetProgramShape());
+  xla::Shape shape =
+      MakeShapeWithDeviceLayout(program_shape.result(), device.hw_type);
+  std::vector<xla::ComputationClient::CompileInstance> instances;
+  instances.push_back({std::move(computation), device.ToString(),
+                       xla::ComputationClient::Get()->GetCompilationDevices(
+                           device.ToString(), {}),
+                       &shape});
+  std::shared_ptr<xla::ComputationClient::Computation> folding =
+      xla::ComputationClient::Get()->Compile(std::move(instances)).front();
+  xla::ComputationClient::ExecuteComputationOptions options;
+  std::vector<DataPtr> results =
+      xla::ComputationClient::Get()->ExecuteComputation(
+          *folding, data, device.ToString(), options);
+  XLA_CHECK_EQ(results.size(), 2);
+  weights = std::make_shared<FoldedWeights>();
+  weights->weight = std::move(results[0]);
+  weights->bias = std::move(results[1]);
+  weights->weight->SetMemoryCategory(xla::MemoryTracker::Category::kParameter);
+  weights->bias->SetMemoryCategory(xla::MemoryTracker::Category::kParameter);
+  return *cache->Add(key, std::move(weights));
+}
+
+ir::NodePtr MakeFusedConvolution(const FoldableChain& chain,
+                                 const ir::Value& input,
+                                 const Device& device) {
+  FoldedWeights weights = FoldWeights(chain, device);
+  ir::ops::FusedConvolution::Activation activation =
+      ir::ops::FusedConvolution::Activation::kNone;
+  double negative_slope = 0;
+  if (chain.activation != nullptr) {
+    const auto* leaky_relu =
+        dynamic_cast<const ir::ops::LeakyRelu*>(chain.activation);
+    if (leaky_relu != nullptr) {
+      activation = ir::ops::FusedConvolution::Activation::kLeakyRelu;
+      negative_slope = leaky_relu->negative_slope();
+    } else {
+      activation = ir::ops::FusedConvolution::Activation::kRelu;
+    }
+  }
+  return ir::MakeNode<ir::ops::FusedConvolution>(
+      input, ir::MakeNode<ir::ops::DeviceData>(std::move(weights.weight)),
+      ir::MakeNode<ir::ops::DeviceData>(std::move(weights.bias)),
+      chain.conv->shape(), chain.conv->stride(), chain.conv->padding(),
+      chain.conv->dilation(), chain.conv->groups(),
+      chain.conv->mixed_precision(), activation, negative_slope);
+}
+
+}  // namespace
+
+std::vector<ir::Value> FoldInferenceGraph(
+    tensorflow::gtl::ArraySlice<const ir::Value> roots,
+    const std::function<bool(const ir::Node*)>& is_constant,
+    const Device& device) {
+  XLA_TIMED("FoldInferenceGraph");
+  Folder folder(roots, is_constant);
+  // The nodes which are replaced within the folded graph, either because they
+  // are folded, or because some of their operands are.
+  std::unordered_map<const ir::Node*, ir::NodePtr> replaced;
+  auto get_value = [&](const ir::Node* node, size_t i) -> ir::Value {
+    const ir::Output& operand = node->operand(i);
+    auto it = replaced.find(operand.node);
+    return it != replaced.end() ? ir::Value(it->second, operand.index)
+                                : node->operand_value(i);
+  };
+  for (auto node : folder.post_order()) {
+    if (replaced.count(node) > 0) {
+      // A fused activation.
+      continue;
+    }
+    FoldableChain chain;
+    if (folder.Match(node, &chain)) {
+      ir::NodePtr fused =
+          MakeFusedConvolution(chain, get_value(chain.conv, 0), device);
+      replaced.emplace(node, fused);
+      if (chain.activation != nullptr) {
+        replaced.emplace(chain.activation, fused);
+      }
+      XLA_COUNTER("FoldedBatchNorms", 1);
+      continue;
+    }
+    bool changed = false;
+    std::vector<ir::Value> operands;
+    for (size_t i = 0; i < node->operands().size(); ++i) {
+      operands.push_back(get_value(node, i));
+      changed = changed || replaced.count(node->operand(i).node) > 0;
+    }
+    if (changed) {
+      replaced.emplace(node, node->Clone(operands));
+    }
+  }
+  std::vector<ir::Value> folded_roots;
+  for (auto& root : roots) {
+    auto it = replaced.find(root.node.get());
+    folded_roots.push_back(it != replaced.end()
+                               ? ir::Value(it->second, root.index)
+                               : root);
+  }
+  return folded_roots;
+}
+
+bool InferenceFoldingEnabled() {
+  static const bool enabled =
+      xla::sys_util::GetEnvBool("XLA_FOLD_INFERENCE_GRAPHS", true);
+  return enabled;
+}
+
+}  // namespace torch_xla
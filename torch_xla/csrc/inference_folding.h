@@ -0,0 +1,33 @@
+#pragma once
+
+#include <functional>
+#include <vector>
+
+#include "tensorflow/core/lib/gtl/array_slice.h"
+#include "torch_xla/csrc/device.h"
+#include "torch_xla/csrc/ir.h"
+
+namespace torch_xla {
+
+// Folds the inference mode batch normalizations which follow a convolution into
+// the convolution weights and bias, within an IR graph whose parameters are
+// constant device data. The convolution, the batch normalization and the relu
+// or leaky relu reading its output (if any) are replaced by a single
+// ir::ops::FusedConvolution node, whose weights and bias are computed on the
+// device by a separate computation, so that the folding is not paid at every
+// run of the graph. The folded weights are cached, keyed by the device data
+// they are computed from. A chain is folded only if its intermediate values
+// are not read by other nodes, and if the convolution weights and bias and the
+// batch normalization parameters are device data nodes for which is_constant
+// returns true. Returns the roots of the folded graph, which shares the nodes
+// which are not folded with the original one.
+std::vector<ir::Value> FoldInferenceGraph(
+    tensorflow::gtl::ArraySlice<const ir::Value> roots,
+    const std::function<bool(const ir::Node*)>& is_constant,
+    const Device& device);
+
+// Whether the execution plans fold their inference graphs
+// (XLA_FOLD_INFERENCE_GRAPHS).
+bool InferenceFoldingEnabled();
+
+}  // namespace torch_xla
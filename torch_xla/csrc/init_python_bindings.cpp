@@ -3,23 +3,56 @@
 #include <c10/core/Device.h>
 #include <c10/util/Optional.h>
 
+#include <algorithm>
+#include <map>
+#include <memory>
 #include <sstream>
 #include <string>
+#include <tuple>
+#include <utility>
 #include <vector>
 
+#include "tensorflow/compiler/xla/primitive_util.h"
+#include "tensorflow/compiler/xla/shape_util.h"
+#include "tensorflow/compiler/xla/xla_client/affinity.h"
 #include "tensorflow/compiler/xla/xla_client/computation_client.h"
+#include "tensorflow/compiler/xla/xla_client/future.h"
+#include "tensorflow/compiler/xla/xla_client/memory_tracker.h"
+#include "tensorflow/compiler/xla/xla_client/mesh_service.h"
 #include "tensorflow/compiler/xla/xla_client/metrics.h"
+#include "tensorflow/compiler/xla/xla_client/metrics_exporter.h"
+#include "tensorflow/compiler/xla/xla_client/tracing.h"
 #include "tensorflow/compiler/xla/xla_client/util.h"
+#include "torch/csrc/Dtype.h"
 #include "torch/csrc/autograd/utils/wrap_outputs.h"
 #include "torch/csrc/autograd/variable.h"
 #include "torch_xla/csrc/aten_xla_bridge.h"
 #include "torch_xla/csrc/aten_xla_type.h"
+#include "torch_xla/csrc/batching_executor.h"
+#include "torch_xla/csrc/cache_miss_explainer.h"
+#include "torch_xla/csrc/checkpoint.h"
+#include "torch_xla/csrc/data_sharding.h"
 #include "torch_xla/csrc/device.h"
+#include "torch_xla/csrc/execution_plan.h"
+#include "torch_xla/csrc/execution_scheduler.h"
+#include "torch_xla/csrc/fallback_profiler.h"
+#include "torch_xla/csrc/fetch_transform.h"
+#include "torch_xla/csrc/graph_bundle.h"
+#include "torch_xla/csrc/graph_stats.h"
 #include "torch_xla/csrc/helpers.h"
+#include "torch_xla/csrc/infeed_queue.h"
+#include "torch_xla/csrc/input_profiler.h"
+#include "torch_xla/csrc/ir_capture.h"
 #include "torch_xla/csrc/ir_dump_util.h"
 #include "torch_xla/csrc/ir_util.h"
+#include "torch_xla/csrc/keyd_queue.h"
+#include "torch_xla/csrc/mapped_file.h"
+#include "torch_xla/csrc/op_profiler.h"
 #include "torch_xla/csrc/python_util.h"
+#include "torch_xla/csrc/replicated_data.h"
+#include "torch_xla/csrc/staging_buffers.h"
 #include "torch_xla/csrc/tensor_impl.h"
+#include "torch_xla/csrc/tensor_ops.h"
 #include "torch_xla/csrc/tensor_util.h"
 #include "torch_xla/csrc/torch_util.h"
 
@@ -32,6 +65,38 @@ struct NoGilSection {
   PyThreadState* state = nullptr;
 };
 
+// A Python object stored within the queues, which can drop it with the GIL
+// released (like when a keyed put replaces an item which was never got), so
+// the object is only released after acquiring the GIL.
+class QueueItem {
+ public:
+  explicit QueueItem(py::object object) : object_(std::move(object)) {}
+
+  QueueItem(QueueItem&& other) = default;
+
+  QueueItem& operator=(QueueItem&& other) {
+    if (this != &other) {
+      Release();
+      object_ = std::move(other.object_);
+    }
+    return *this;
+  }
+
+  ~QueueItem() { Release(); }
+
+  py::object Take() { return std::move(object_); }
+
+ private:
+  void Release() {
+    if (object_) {
+      py::gil_scoped_acquire gil;
+      object_ = py::object();
+    }
+  }
+
+  py::object object_;
+};
+
 c10::optional<Device> GetOptionalDevice(const std::string& device_str) {
   if (device_str.empty()) {
     return c10::nullopt;
@@ -53,6 +118,29 @@ std::string GetTensorsDump(
   return coverter(nodes);
 }
 
+// Parses the lowercase XLA type names used by the mixed precision policy
+// bindings. The empty string maps to no type.
+xla::PrimitiveType ParseMixedPrecisionType(const std::string& type_name) {
+  static const std::pair<const char*, xla::PrimitiveType> kTypes[] = {
+      {"", xla::PrimitiveType::PRIMITIVE_TYPE_INVALID},
+      {"bf16", xla::PrimitiveType::BF16},
+      {"f16", xla::PrimitiveType::F16},
+      {"f32", xla::PrimitiveType::F32},
+      {"f64", xla::PrimitiveType::F64}};
+  for (auto& name_type : kTypes) {
+    if (type_name == name_type.first) {
+      return name_type.second;
+    }
+  }
+  XLA_ERROR() << "Unsupported mixed precision type: " << type_name;
+}
+
+std::string MixedPrecisionTypeName(xla::PrimitiveType type) {
+  return type == xla::PrimitiveType::PRIMITIVE_TYPE_INVALID
+             ? ""
+             : xla::primitive_util::LowercasePrimitiveTypeName(type);
+}
+
 std::string SetCurrentDevice(const std::string& device_str) {
   c10::Device prev_device =
       XLATensorImpl::SetCurrentAtenDevice(c10::Device(device_str));
@@ -78,19 +166,491 @@ std::vector<std::string> GetXlaDevices(
   return xla_devices;
 }
 
-void InsertCrossReplicaSum(const std::vector<at::Tensor>& tensors, double scale,
-                           const py::list& groups) {
-  std::vector<std::vector<xla::int64>> crs_groups;
+CrossReplicaSumCompression ParseCrossReplicaSumCompression(
+    const std::string& compression) {
+  if (compression.empty()) {
+    return CrossReplicaSumCompression::kNone;
+  }
+  XLA_CHECK_EQ(compression, "bf16")
+      << "Unsupported cross replica sum compression: " << compression;
+  return CrossReplicaSumCompression::kBF16;
+}
+
+std::vector<std::vector<xla::int64>> GetReplicaGroups(const py::list& groups) {
+  std::vector<std::vector<xla::int64>> replica_groups;
   for (auto& group : groups) {
-    crs_groups.emplace_back();
+    replica_groups.emplace_back();
     for (auto& replica_id : group.cast<py::list>()) {
-      crs_groups.back().push_back(replica_id.cast<xla::int64>());
+      replica_groups.back().push_back(replica_id.cast<xla::int64>());
     }
   }
-  for (auto& tensor : tensors) {
-    XLATensor xtensor = bridge::GetXlaTensor(tensor);
-    XLATensor::cross_replica_sum_(xtensor, scale, crs_groups);
+  return replica_groups;
+}
+
+void InsertCrossReplicaSum(const std::vector<at::Tensor>& tensors, double scale,
+                           const py::list& groups,
+                           const std::string& compression, bool error_feedback,
+                           const py::list& host_groups) {
+  std::vector<XLATensor> xtensors = bridge::GetXlaTensors(tensors);
+  XLATensor::cross_replica_sum_(xtensors, scale, GetReplicaGroups(groups),
+                                ParseCrossReplicaSumCompression(compression),
+                                error_feedback, GetReplicaGroups(host_groups));
+}
+
+// Groups the indices of the replication devices by the host (the worker
+// owning them within the topology), in device order.
+std::vector<std::vector<xla::int64>> GetReplicationHostGroups() {
+  const std::vector<std::string>& devices =
+      xla::ComputationClient::Get()->GetReplicationDevices();
+  std::map<std::string, std::vector<xla::int64>> host_replicas;
+  std::vector<std::string> hosts;
+  for (size_t i = 0; i < devices.size(); ++i) {
+    std::string host =
+        xla::ComputationClient::Get()->GetResourceDomain(devices[i]);
+    auto it = host_replicas.find(host);
+    if (it == host_replicas.end()) {
+      hosts.push_back(host);
+      it = host_replicas.emplace(host, std::vector<xla::int64>()).first;
+    }
+    it->second.push_back(i);
+  }
+  std::vector<std::vector<xla::int64>> host_groups;
+  for (auto& host : hosts) {
+    host_groups.push_back(std::move(host_replicas[host]));
+  }
+  return host_groups;
+}
+
+const xla::service::MeshClient* GetMeshClient() {
+  const xla::service::MeshClient* client = xla::service::MeshClient::Get();
+  XLA_CHECK(client != nullptr)
+      << "The mesh service is not available (XRT_MESH_SERVICE_ADDRESS unset)";
+  return client;
+}
+
+std::vector<py::bytes> ToPyBytes(const std::vector<std::string>& values) {
+  std::vector<py::bytes> py_values;
+  for (auto& value : values) {
+    py_values.emplace_back(value);
+  }
+  return py_values;
+}
+
+py::list GetGraphStats(const std::string& sort_key) {
+  std::vector<GraphStats::Record> records =
+      GraphStats::Get()->GetRecords(sort_key);
+  py::list py_records;
+  for (auto& record : records) {
+    py::list frames;
+    for (auto& frame : record.frames) {
+      frames.append(py::make_tuple(frame.file, frame.function, frame.line));
+    }
+    py::dict py_record;
+    py_record["hash"] = record.hash;
+    py_record["frames"] = frames;
+    py_record["misses"] = record.misses;
+    py_record["compiles"] = record.compiles;
+    py_record["compile_time"] = 1.0e-9 * record.compile_ns;
+    py_record["executions"] = record.executions;
+    py_record["execute_time"] = 1.0e-9 * record.execute_ns;
+    py_record["input_bytes"] = record.input_bytes;
+    py_record["output_bytes"] = record.output_bytes;
+    py_record["hlo_instructions"] = record.hlo_instructions;
+    py_records.append(py_record);
+  }
+  return py_records;
+}
+
+py::list GetOpProfileStats() {
+  std::vector<OpProfiler::Record> records = OpProfiler::Get()->GetRecords();
+  py::list py_records;
+  for (auto& record : records) {
+    py::list frames;
+    for (auto& frame : record.frames) {
+      frames.append(py::make_tuple(frame.file, frame.function, frame.line));
+    }
+    py::dict py_record;
+    py_record["id"] = record.id;
+    py_record["op_type"] = record.op_type;
+    py_record["frames"] = frames;
+    py_record["samples"] = record.samples;
+    py_record["time"] = 1.0e-9 * record.total_ns;
+    py_records.append(py_record);
+  }
+  return py_records;
+}
+
+py::list GetFallbackStats(const std::string& sort_key) {
+  std::vector<FallbackProfiler::Record> records =
+      FallbackProfiler::Get()->GetRecords(sort_key);
+  py::list py_records;
+  for (auto& record : records) {
+    py::dict input_shapes;
+    for (auto& shapes_count : record.input_shapes) {
+      input_shapes[py::str(shapes_count.first)] = shapes_count.second;
+    }
+    py::dict py_record;
+    py_record["name"] = record.name;
+    py_record["calls"] = record.calls;
+    py_record["time"] = 1.0e-9 * record.total_ns;
+    py_record["bytes_to_host"] = record.bytes_to_host;
+    py_record["bytes_to_device"] = record.bytes_to_device;
+    py_record["input_shapes"] = input_shapes;
+    py_records.append(py_record);
+  }
+  return py_records;
+}
+
+void SetMemoryCategory(const std::vector<at::Tensor>& tensors,
+                       const std::string& category) {
+  xla::MemoryTracker::Category memory_category =
+      xla::MemoryTracker::ParseCategory(category);
+  for (auto& xtensor : bridge::GetXlaTensors(tensors)) {
+    xtensor.SetMemoryCategory(memory_category);
+  }
+}
+
+void SetMaterialize(const std::vector<at::Tensor>& tensors, bool materialize) {
+  for (auto& xtensor : bridge::GetXlaTensors(tensors)) {
+    xtensor.SetMaterialize(materialize);
+  }
+}
+
+void MarkSharding(const at::Tensor& tensor,
+                  const std::vector<xla::int64>& mesh_shape,
+                  const std::vector<xla::int64>& dim_axes) {
+  XLATensor xtensor = bridge::GetXlaTensor(tensor);
+  XLATensor::mark_sharding_(xtensor, mesh_shape, dim_axes);
+}
+
+py::dict GetMemoryInfo() {
+  py::dict py_info;
+  for (auto& device_stats : xla::MemoryTracker::Get()->GetDeviceStats()) {
+    const xla::MemoryTracker::DeviceStats& stats = device_stats.second;
+    py::dict categories;
+    for (int i = 0;
+         i < static_cast<int>(xla::MemoryTracker::Category::kNumCategories);
+         ++i) {
+      categories[xla::MemoryTracker::CategoryName(
+          static_cast<xla::MemoryTracker::Category>(i))] =
+          stats.category_bytes[i];
+    }
+    py::dict py_stats;
+    py_stats["live_bytes"] = stats.live_bytes;
+    py_stats["peak_bytes"] = stats.peak_bytes;
+    py_stats["live_allocations"] = stats.live_allocations;
+    py_stats["categories"] = categories;
+    py_info[py::str(device_stats.first)] = py_stats;
+  }
+  return py_info;
+}
+
+py::list GetLargestAllocations(size_t count, const std::string& device) {
+  std::string device_str;
+  if (!device.empty()) {
+    device_str = bridge::AtenDeviceToXlaDevice(c10::Device(device)).ToString();
+  }
+  py::list py_allocations;
+  for (auto& allocation :
+       xla::MemoryTracker::Get()->GetLargestAllocations(count, device_str)) {
+    py::dict py_allocation;
+    py_allocation["device"] = allocation.device;
+    py_allocation["shape"] = xla::ShapeUtil::HumanString(allocation.shape);
+    py_allocation["bytes"] = allocation.bytes;
+    py_allocation["category"] =
+        xla::MemoryTracker::CategoryName(allocation.category);
+    py_allocations.append(py_allocation);
+  }
+  return py_allocations;
+}
+
+std::tuple<at::Tensor, at::Tensor> EmbeddingSparseBackward(
+    const at::Tensor& grad_output, const at::Tensor& indices,
+    xla::int64 num_weights, xla::int64 padding_idx, bool scale_grad_by_freq) {
+  XLATensor rows;
+  XLATensor row_grads;
+  std::tie(rows, row_grads) = tensor_ops::EmbeddingSparseBackward(
+      bridge::GetXlaTensor(grad_output), bridge::GetXlaTensor(indices),
+      num_weights, padding_idx, scale_grad_by_freq);
+  return std::make_tuple(bridge::AtenFromXlaTensor(std::move(rows)),
+                         bridge::AtenFromXlaTensor(std::move(row_grads)));
+}
+
+// Uploads every shard to the matching device, and returns a tensor holding the
+// shard of the master device, which stands for all of them within the
+// replicated execution.
+at::Tensor CreateReplicatedTensor(const std::vector<at::Tensor>& shards,
+                                  const std::vector<std::string>& devices,
+                                  const std::string& master_device) {
+  XLA_CHECK_EQ(shards.size(), devices.size());
+  auto it = std::find(devices.begin(), devices.end(), master_device);
+  XLA_CHECK(it != devices.end())
+      << "The master device " << master_device << " is not a replica device";
+  size_t master_index = it - devices.begin();
+  std::vector<xla::ComputationClient::DataPtr> replicas =
+      CreateTensorsData(shards, devices);
+  ReplicatedData::Get()->Register(replicas, master_index);
+  return bridge::AtenFromXlaTensor(XLATensor::Create(
+      replicas[master_index], shards[master_index].scalar_type()));
+}
+
+XLATensor GetOptionalXlaTensor(const py::object& tensor) {
+  return tensor.is_none() ? XLATensor()
+                          : bridge::GetXlaTensor(tensor.cast<at::Tensor>());
+}
+
+std::tuple<at::Tensor, at::Tensor> Attention(const at::Tensor& query,
+                                             const at::Tensor& key,
+                                             const at::Tensor& value,
+                                             const XLATensor& mask,
+                                             double scale) {
+  XLATensor output;
+  XLATensor logsumexp;
+  std::tie(output, logsumexp) = XLATensor::attention(
+      bridge::GetXlaTensor(query), bridge::GetXlaTensor(key),
+      bridge::GetXlaTensor(value), mask, scale);
+  return std::make_tuple(bridge::AtenFromXlaTensor(std::move(output)),
+                         bridge::AtenFromXlaTensor(std::move(logsumexp)));
+}
+
+std::tuple<at::Tensor, at::Tensor, at::Tensor> AttentionBackward(
+    const at::Tensor& grad_output, const at::Tensor& query,
+    const at::Tensor& key, const at::Tensor& value, const XLATensor& mask,
+    const at::Tensor& output, const at::Tensor& logsumexp, double scale) {
+  XLATensor grad_query;
+  XLATensor grad_key;
+  XLATensor grad_value;
+  std::tie(grad_query, grad_key, grad_value) = XLATensor::attention_backward(
+      bridge::GetXlaTensor(grad_output), bridge::GetXlaTensor(query),
+      bridge::GetXlaTensor(key), bridge::GetXlaTensor(value), mask,
+      bridge::GetXlaTensor(output), bridge::GetXlaTensor(logsumexp), scale);
+  return std::make_tuple(bridge::AtenFromXlaTensor(std::move(grad_query)),
+                         bridge::AtenFromXlaTensor(std::move(grad_key)),
+                         bridge::AtenFromXlaTensor(std::move(grad_value)));
+}
+
+std::tuple<at::Tensor, at::Tensor, at::Tensor> GroupNorm(
+    const at::Tensor& input, const XLATensor& weight, const XLATensor& bias,
+    xla::int64 num_groups, std::vector<xla::int64> affine_dims, double eps) {
+  XLATensor output;
+  XLATensor mean;
+  XLATensor rstd;
+  std::tie(output, mean, rstd) =
+      XLATensor::group_norm(bridge::GetXlaTensor(input), weight, bias,
+                            num_groups, std::move(affine_dims), eps);
+  return std::make_tuple(bridge::AtenFromXlaTensor(std::move(output)),
+                         bridge::AtenFromXlaTensor(std::move(mean)),
+                         bridge::AtenFromXlaTensor(std::move(rstd)));
+}
+
+std::tuple<at::Tensor, at::Tensor, at::Tensor> GroupNormBackward(
+    const at::Tensor& grad_output, const at::Tensor& input,
+    const XLATensor& weight, const at::Tensor& mean, const at::Tensor& rstd,
+    xla::int64 num_groups, std::vector<xla::int64> affine_dims) {
+  XLATensor grad_input;
+  XLATensor grad_weight;
+  XLATensor grad_bias;
+  std::tie(grad_input, grad_weight, grad_bias) =
+      XLATensor::group_norm_backward(
+          bridge::GetXlaTensor(grad_output), bridge::GetXlaTensor(input),
+          weight, bridge::GetXlaTensor(mean), bridge::GetXlaTensor(rstd),
+          num_groups, std::move(affine_dims));
+  return std::make_tuple(bridge::AtenFromXlaTensor(std::move(grad_input)),
+                         bridge::AtenFromXlaTensor(std::move(grad_weight)),
+                         bridge::AtenFromXlaTensor(std::move(grad_bias)));
+}
+
+std::tuple<at::Tensor, at::Tensor> Sort(const std::vector<at::Tensor>& keys,
+                                        xla::int64 dim, bool descending,
+                                        bool stable) {
+  XLATensor values;
+  XLATensor indices;
+  std::tie(values, indices) = XLATensor::sort(bridge::GetXlaTensors(keys), dim,
+                                              descending, stable);
+  return std::make_tuple(bridge::AtenFromXlaTensor(std::move(values)),
+                         bridge::AtenFromXlaTensor(std::move(indices)));
+}
+
+std::vector<at::Tensor> RematAnchor(const std::vector<at::Tensor>& tensors,
+                                    const at::Tensor& anchor) {
+  std::vector<XLATensor> results = XLATensor::remat_anchor(
+      bridge::GetXlaTensors(tensors), bridge::GetXlaTensor(anchor));
+  std::vector<at::Tensor> at_results;
+  for (auto& result : results) {
+    at_results.push_back(
+        torch::autograd::make_variable(bridge::AtenFromXlaTensor(result)));
   }
+  return at_results;
+}
+
+std::tuple<at::Tensor, at::Tensor> PackedDropout(const at::Tensor& input,
+                                                 double p) {
+  XLATensor output;
+  XLATensor packed_mask;
+  std::tie(output, packed_mask) =
+      XLATensor::packed_dropout(bridge::GetXlaTensor(input), p);
+  return std::make_tuple(
+      torch::autograd::make_variable(bridge::AtenFromXlaTensor(output)),
+      torch::autograd::make_variable(bridge::AtenFromXlaTensor(packed_mask)));
+}
+
+at::Tensor PackedDropoutBackward(const at::Tensor& grad_output,
+                                 const at::Tensor& packed_mask, double p) {
+  XLATensor result = XLATensor::packed_dropout_backward(
+      bridge::GetXlaTensor(grad_output), bridge::GetXlaTensor(packed_mask), p);
+  return torch::autograd::make_variable(bridge::AtenFromXlaTensor(result));
+}
+
+void SgdStep(const std::vector<at::Tensor>& params,
+             const std::vector<at::Tensor>& grads,
+             const std::vector<at::Tensor>& momentum_buffers, double lr,
+             double momentum, double dampening, double weight_decay,
+             bool nesterov, bool init_buffers) {
+  std::vector<XLATensor> xla_params = bridge::GetXlaTensors(params);
+  std::vector<XLATensor> xla_buffers = bridge::GetXlaTensors(momentum_buffers);
+  XLATensor::sgd_step_(xla_params, bridge::GetXlaTensors(grads), xla_buffers,
+                       lr, momentum, dampening, weight_decay, nesterov,
+                       init_buffers);
+}
+
+void AdamStep(const std::vector<at::Tensor>& params,
+              const std::vector<at::Tensor>& grads,
+              const std::vector<at::Tensor>& exp_avgs,
+              const std::vector<at::Tensor>& exp_avg_sqs,
+              const std::vector<at::Tensor>& max_exp_avg_sqs, double step_size,
+              double beta1, double beta2, double eps, double weight_decay) {
+  std::vector<XLATensor> xla_params = bridge::GetXlaTensors(params);
+  std::vector<XLATensor> xla_exp_avgs = bridge::GetXlaTensors(exp_avgs);
+  std::vector<XLATensor> xla_exp_avg_sqs = bridge::GetXlaTensors(exp_avg_sqs);
+  std::vector<XLATensor> xla_max_exp_avg_sqs =
+      bridge::GetXlaTensors(max_exp_avg_sqs);
+  XLATensor::adam_step_(xla_params, bridge::GetXlaTensors(grads),
+                        xla_exp_avgs, xla_exp_avg_sqs, xla_max_exp_avg_sqs,
+                        step_size, beta1, beta2, eps, weight_decay);
+}
+
+void LambStep(const std::vector<at::Tensor>& params,
+              const std::vector<at::Tensor>& grads,
+              const std::vector<at::Tensor>& exp_avgs,
+              const std::vector<at::Tensor>& exp_avg_sqs, double lr,
+              double beta1, double beta2, double eps, double weight_decay,
+              double bias_correction1, double bias_correction2) {
+  std::vector<XLATensor> xla_params = bridge::GetXlaTensors(params);
+  std::vector<XLATensor> xla_exp_avgs = bridge::GetXlaTensors(exp_avgs);
+  std::vector<XLATensor> xla_exp_avg_sqs = bridge::GetXlaTensors(exp_avg_sqs);
+  XLATensor::lamb_step_(xla_params, bridge::GetXlaTensors(grads),
+                        xla_exp_avgs, xla_exp_avg_sqs, lr, beta1, beta2, eps,
+                        weight_decay, bias_correction1, bias_correction2);
+}
+
+at::Tensor ClipGradNorm(const std::vector<at::Tensor>& grads, double max_norm,
+                       double norm_type) {
+  std::vector<XLATensor> xla_grads = bridge::GetXlaTensors(grads);
+  XLATensor total_norm =
+      XLATensor::clip_grad_norm_(xla_grads, max_norm, norm_type);
+  return torch::autograd::make_variable(bridge::AtenFromXlaTensor(total_norm));
+}
+
+at::Tensor AmpUnscale(const std::vector<at::Tensor>& grads,
+                      const at::Tensor& loss_scale) {
+  std::vector<XLATensor> xla_grads = bridge::GetXlaTensors(grads);
+  XLATensor found_inf =
+      XLATensor::amp_unscale_(xla_grads, bridge::GetXlaTensor(loss_scale));
+  return torch::autograd::make_variable(bridge::AtenFromXlaTensor(found_inf));
+}
+
+void SelectFiniteUpdates(const std::vector<at::Tensor>& tensors,
+                         const std::vector<at::Tensor>& previous,
+                         const at::Tensor& found_inf) {
+  XLA_CHECK_EQ(tensors.size(), previous.size());
+  std::vector<XLATensor> xla_tensors = bridge::GetXlaTensors(tensors);
+  XLATensor::select_finite_updates_(xla_tensors,
+                                    bridge::GetXlaTensors(previous),
+                                    bridge::GetXlaTensor(found_inf));
+}
+
+void UpdateLossScale(const at::Tensor& loss_scale, const at::Tensor& good_steps,
+                     const at::Tensor& found_inf, double growth_factor,
+                     double backoff_factor, xla::int64 growth_interval,
+                     double min_scale) {
+  XLATensor xla_loss_scale = bridge::GetXlaTensor(loss_scale);
+  XLATensor xla_good_steps = bridge::GetXlaTensor(good_steps);
+  XLATensor::update_loss_scale_(xla_loss_scale, xla_good_steps,
+                                bridge::GetXlaTensor(found_inf),
+                                growth_factor, backoff_factor, growth_interval,
+                                min_scale);
+}
+
+at::Tensor QuantizedLinear(const at::Tensor& input, const at::Tensor& weight,
+                           const at::Tensor& weight_scales,
+                           const XLATensor& bias, double input_scale) {
+  XLATensor output = XLATensor::quantized_linear(
+      bridge::GetXlaTensor(input), bridge::GetXlaTensor(weight),
+      bridge::GetXlaTensor(weight_scales), bias, input_scale);
+  return torch::autograd::make_variable(bridge::AtenFromXlaTensor(output));
+}
+
+at::Tensor QuantizedConvolution(const at::Tensor& input,
+                                const at::Tensor& weight,
+                                const at::Tensor& weight_scales,
+                                const XLATensor& bias, double input_scale,
+                                std::vector<xla::int64> stride,
+                                std::vector<xla::int64> padding,
+                                std::vector<xla::int64> dilation,
+                                xla::int64 groups) {
+  XLATensor output = XLATensor::quantized_convolution(
+      bridge::GetXlaTensor(input), bridge::GetXlaTensor(weight),
+      bridge::GetXlaTensor(weight_scales), bias, input_scale,
+      std::move(stride), std::move(padding), std::move(dilation), groups);
+  return torch::autograd::make_variable(bridge::AtenFromXlaTensor(output));
+}
+
+// Wraps the padded result and the valid count of a bounded op.
+std::tuple<at::Tensor, at::Tensor> BoundedResult(
+    const std::tuple<XLATensor, XLATensor>& result) {
+  return std::make_tuple(torch::autograd::make_variable(
+                             bridge::AtenFromXlaTensor(std::get<0>(result))),
+                         torch::autograd::make_variable(
+                             bridge::AtenFromXlaTensor(std::get<1>(result))));
+}
+
+std::vector<at::Tensor> XlaToAtenTensors(
+    const std::vector<XLATensor>& xla_tensors) {
+  std::vector<at::Tensor> tensors;
+  tensors.reserve(xla_tensors.size());
+  for (auto& xla_tensor : xla_tensors) {
+    tensors.push_back(
+        torch::autograd::make_variable(bridge::AtenFromXlaTensor(xla_tensor)));
+  }
+  return tensors;
+}
+
+std::pair<xla::int64, std::vector<at::Tensor>> SubgraphParameters(
+    const std::vector<at::Tensor>& operands) {
+  auto scope_parameters =
+      XLATensor::subgraph_parameters(bridge::GetXlaTensors(operands));
+  return std::make_pair(scope_parameters.first,
+                        XlaToAtenTensors(scope_parameters.second));
+}
+
+std::vector<at::Tensor> Cond(const at::Tensor& predicate,
+                             const std::vector<at::Tensor>& operands,
+                             xla::int64 scope,
+                             const std::vector<at::Tensor>& true_outputs,
+                             const std::vector<at::Tensor>& false_outputs) {
+  return XlaToAtenTensors(XLATensor::cond(
+      bridge::GetXlaTensor(predicate), bridge::GetXlaTensors(operands), scope,
+      bridge::GetXlaTensors(true_outputs),
+      bridge::GetXlaTensors(false_outputs)));
+}
+
+std::vector<at::Tensor> WhileLoop(const std::vector<at::Tensor>& operands,
+                                  xla::int64 scope,
+                                  const at::Tensor& condition,
+                                  const std::vector<at::Tensor>& body_outputs) {
+  return XlaToAtenTensors(XLATensor::while_loop(
+      bridge::GetXlaTensors(operands), scope, bridge::GetXlaTensor(condition),
+      bridge::GetXlaTensors(body_outputs)));
 }
 
 void SyncTensors(const std::vector<at::Tensor>& tensors,
@@ -113,6 +673,17 @@ void SyncLiveTensors(const std::string& device_str,
                                   devices, wait);
 }
 
+void SyncLiveTensorsSteps(const std::string& device_str,
+                          const std::vector<at::Tensor>& step_inputs,
+                          const std::vector<at::Tensor>& stacked_inputs,
+                          bool wait) {
+  Device device = bridge::AtenDeviceToXlaDevice(c10::Device(device_str));
+  XLATensor::SyncLiveTensorsGraphSteps(device,
+                                       bridge::GetXlaTensors(step_inputs),
+                                       bridge::GetXlaTensors(stacked_inputs),
+                                       wait);
+}
+
 void StepMarker(const std::string& device_str,
                 const std::vector<std::string>& devices, bool wait) {
   auto opt_device = GetOptionalDevice(device_str);
@@ -149,8 +720,8 @@ std::string GetLiveTensorsReport(size_t nodes_threshold,
            << ", device=" << tensor.GetDevice()
            << ", ir_nodes=" << post_order.size() << "\n";
         for (size_t i = post_order.size(); i > 0; --i) {
-          if (!post_order[i - 1]->metadata().frame_info.empty()) {
-            ss << post_order[i - 1]->metadata().frame_info;
+          if (post_order[i - 1]->metadata().frame_info != nullptr) {
+            ss << *post_order[i - 1]->metadata().frame_info;
             break;
           }
         }
@@ -174,14 +745,21 @@ std::ptrdiff_t GetTensorId(const at::Tensor& tensor) {
 
 std::vector<at::Tensor> GetXlaTensorsFromAten(
     const std::vector<at::Tensor>& aten_tensors,
-    const std::vector<std::string>& devices) {
+    const std::vector<std::string>& devices, bool use_staging) {
+  std::vector<std::string> xla_devices = GetXlaDevices(devices);
   std::vector<at::Tensor> tensors;
   tensors.reserve(aten_tensors.size());
-  for (auto& aten_tensor : aten_tensors) {
-    tensors.push_back(aten_tensor);
+  for (size_t i = 0; i < aten_tensors.size(); ++i) {
+    tensors.push_back(use_staging ? StagingBufferPool::Get()->CopyToStaging(
+                                        aten_tensors[i], Device(xla_devices[i]))
+                                  : aten_tensors[i]);
   }
 
-  auto data_handles = CreateTensorsData(tensors, GetXlaDevices(devices));
+  auto data_handles = CreateTensorsData(tensors, xla_devices);
+  // The staged uploads are the ones of the input pipelines.
+  if (use_staging && InputProfiler::IsEnabled()) {
+    InputProfiler::Get()->RecordUploaded(data_handles);
+  }
 
   std::vector<at::Tensor> xla_tensors;
   xla_tensors.reserve(data_handles.size());
@@ -192,6 +770,27 @@ std::vector<at::Tensor> GetXlaTensorsFromAten(
   return xla_tensors;
 }
 
+// Uploads the host tensors from the IO thread pool, and returns the future of
+// their XLA tensors. The host tensors are referenced, not copied, so they must
+// not be modified until the upload completes.
+xla::util::Future<std::vector<at::Tensor>> GetXlaTensorsFromAtenAsync(
+    std::vector<at::Tensor> aten_tensors,
+    const std::vector<std::string>& devices) {
+  XLA_COUNTER("AsyncTensorUploads", 1);
+  auto upload_fn = [aten_tensors = std::move(aten_tensors),
+                    xla_devices = GetXlaDevices(devices)]() {
+    auto data_handles = CreateTensorsData(aten_tensors, xla_devices);
+    std::vector<at::Tensor> xla_tensors;
+    xla_tensors.reserve(data_handles.size());
+    for (auto& data_handle : data_handles) {
+      xla_tensors.push_back(
+          bridge::AtenFromXlaTensor(XLATensor::Create(std::move(data_handle))));
+    }
+    return xla_tensors;
+  };
+  return xla::util::ScheduleIoFuture(std::move(upload_fn));
+}
+
 py::object GetMetricData(const std::string& name) {
   xla::metrics::MetricData* data = xla::metrics::GetMetric(name);
   if (data == nullptr) {
@@ -248,7 +847,7 @@ void InitXlaModuleBindings(py::module m) {
     {
       NoGilSection nogil;
       std::vector<at::Tensor> xla_tensors =
-          GetXlaTensorsFromAten(tensors, devices);
+          GetXlaTensorsFromAten(tensors, devices, /*use_staging=*/false);
       result.reserve(xla_tensors.size());
       for (auto& tensor : xla_tensors) {
         result.push_back(torch::autograd::make_variable(tensor));
@@ -256,6 +855,329 @@ void InitXlaModuleBindings(py::module m) {
     }
     return result;
   });
+  m.def("_xla_staged_tensors_from_aten",
+        [](const std::vector<at::Tensor>& tensors,
+           const std::vector<std::string>& devices) {
+          std::vector<at::Tensor> result;
+          {
+            NoGilSection nogil;
+            std::vector<at::Tensor> xla_tensors =
+                GetXlaTensorsFromAten(tensors, devices, /*use_staging=*/true);
+            result.reserve(xla_tensors.size());
+            for (auto& tensor : xla_tensors) {
+              result.push_back(torch::autograd::make_variable(tensor));
+            }
+          }
+          return result;
+        });
+  py::class_<InfeedQueue, std::shared_ptr<InfeedQueue>>(m, "InfeedQueue")
+      .def(py::init<size_t>(), py::arg("capacity"))
+      .def("put",
+           [](InfeedQueue& queue, size_t key,
+              const std::vector<at::Tensor>& tensors,
+              const std::vector<std::string>& devices) {
+             NoGilSection nogil;
+             return queue.Put(key, tensors, GetXlaDevices(devices));
+           })
+      .def("get",
+           [](InfeedQueue& queue, size_t key) -> py::object {
+             absl::optional<std::vector<at::Tensor>> xla_tensors;
+             {
+               NoGilSection nogil;
+               xla_tensors = queue.Get(key);
+             }
+             if (!xla_tensors) {
+               return py::none();
+             }
+             std::vector<at::Tensor> result;
+             result.reserve(xla_tensors->size());
+             for (auto& tensor : *xla_tensors) {
+               result.push_back(torch::autograd::make_variable(tensor));
+             }
+             return py::cast(result);
+           })
+      .def("close_write", &InfeedQueue::CloseWrite)
+      .def("close", [](InfeedQueue& queue) {
+        NoGilSection nogil;
+        queue.Close();
+      });
+  // The queues move the Python items in and out, without touching their
+  // reference counts, so they can wait with the GIL released.
+  using ItemQueue = Queue<QueueItem>;
+  py::class_<ItemQueue, std::shared_ptr<ItemQueue>>(m, "Queue")
+      .def(py::init<size_t>(), py::arg("maxsize") = 1024)
+      .def("max_size", &ItemQueue::max_size)
+      .def("put",
+           [](ItemQueue& queue, py::object item) {
+             QueueItem queue_item(std::move(item));
+             NoGilSection nogil;
+             queue.Put(std::move(queue_item));
+           })
+      .def("get",
+           [](ItemQueue& queue) -> py::object {
+             absl::optional<QueueItem> item;
+             {
+               NoGilSection nogil;
+               item = queue.Get();
+             }
+             return item ? item->Take() : py::none();
+           })
+      .def("close_write", &ItemQueue::CloseWrite)
+      .def("close", [](ItemQueue& queue) { queue.Close(); });
+  using ItemKeydQueue = KeydQueue<xla::int64, QueueItem>;
+  py::class_<ItemKeydQueue, std::shared_ptr<ItemKeydQueue>>(m, "KeydQueue")
+      .def(py::init<size_t>(), py::arg("maxsize") = 1024)
+      .def("max_size", &ItemKeydQueue::max_size)
+      .def("put",
+           [](ItemKeydQueue& queue, xla::int64 key, py::object item) {
+             QueueItem queue_item(std::move(item));
+             NoGilSection nogil;
+             queue.Put(key, std::move(queue_item));
+           })
+      .def("get",
+           [](ItemKeydQueue& queue, xla::int64 key) -> py::object {
+             absl::optional<QueueItem> item;
+             {
+               NoGilSection nogil;
+               item = queue.Get(key);
+             }
+             return item ? item->Take() : py::none();
+           })
+      .def("close_write", &ItemKeydQueue::CloseWrite)
+      .def("close", [](ItemKeydQueue& queue) { queue.Close(); });
+  using TensorsFuture = xla::util::Future<std::vector<at::Tensor>>;
+  py::class_<TensorsFuture>(m, "TensorsFuture")
+      .def("is_ready", &TensorsFuture::IsReady)
+      .def("wait",
+           [](const TensorsFuture& future) {
+             std::vector<at::Tensor> tensors;
+             {
+               NoGilSection nogil;
+               tensors = future.Get();
+             }
+             std::vector<at::Tensor> result;
+             result.reserve(tensors.size());
+             for (auto& tensor : tensors) {
+               result.push_back(torch::autograd::make_variable(tensor));
+             }
+             return result;
+           })
+      .def("add_done_callback",
+           [](const TensorsFuture& future, py::function fn) {
+             // The callback might run on an IO thread, without the GIL, so
+             // the Python function is only referenced (and released) while
+             // holding it.
+             py::function* callback = new py::function(std::move(fn));
+             future.OnComplete([future, callback]() {
+               py::gil_scoped_acquire gil;
+               try {
+                 (*callback)(py::cast(future));
+               } catch (py::error_already_set& e) {
+                 e.restore();
+                 PyErr_Print();
+               }
+               delete callback;
+             });
+           });
+  m.def("_xla_get_tensors_async", [](const std::vector<at::Tensor>& tensors) {
+    NoGilSection nogil;
+    std::vector<XLATensor> xtensors = bridge::GetXlaTensors(tensors);
+    return XLATensor::GetTensorsAsync(&xtensors);
+  });
+  m.def("_xla_fetch_transformed",
+        [](const std::vector<at::Tensor>& tensors,
+           const std::string& transform) {
+          FetchTransform fetch_transform = FetchTransform::Parse(transform);
+          NoGilSection nogil;
+          return FetchTransformed(bridge::GetXlaTensors(tensors),
+                                  fetch_transform);
+        });
+  m.def("_xla_tensors_from_aten_async",
+        [](const std::vector<at::Tensor>& tensors,
+           const std::vector<std::string>& devices) {
+          NoGilSection nogil;
+          return GetXlaTensorsFromAtenAsync(tensors, devices);
+        });
+  m.def("_xla_offload_tensors_data",
+        [](const std::vector<at::Tensor>& tensors,
+           const std::vector<at::Tensor>& host_tensors) {
+          XLA_CHECK_EQ(tensors.size(), host_tensors.size());
+          std::vector<XLATensor> xtensors = bridge::GetXlaTensors(tensors);
+          for (size_t i = 0; i < xtensors.size(); ++i) {
+            xtensors[i].OffloadXlaData(host_tensors[i]);
+          }
+        });
+  m.def("_xla_restore_tensors_data",
+        [](const std::vector<at::Tensor>& tensors,
+           const std::vector<at::Tensor>& device_tensors) {
+          XLA_CHECK_EQ(tensors.size(), device_tensors.size());
+          std::vector<XLATensor> xtensors = bridge::GetXlaTensors(tensors);
+          for (size_t i = 0; i < xtensors.size(); ++i) {
+            XLATensor device_tensor = bridge::GetXlaTensor(device_tensors[i]);
+            XLA_CHECK(device_tensor.CurrentXlaData() != nullptr);
+            XLA_CHECK(xla::ShapeUtil::Compatible(
+                device_tensor.shape().get(), xtensors[i].shape().get()));
+            xtensors[i].SetXlaData(device_tensor.CurrentXlaData());
+          }
+        });
+  py::class_<ExecutionPlan, std::shared_ptr<ExecutionPlan>>(m,
+                                                            "ExecutionPlan")
+      .def(py::init([](const std::vector<at::Tensor>& inputs,
+                       const std::vector<at::Tensor>& outputs) {
+             NoGilSection nogil;
+             return std::make_shared<ExecutionPlan>(
+                 bridge::GetXlaTensors(inputs),
+                 bridge::GetXlaTensors(outputs));
+           }),
+           py::arg("inputs"), py::arg("outputs"))
+      .def("num_inputs", &ExecutionPlan::num_inputs)
+      .def("__call__",
+           [](const ExecutionPlan& plan,
+              const std::vector<at::Tensor>& inputs) {
+             std::vector<XLATensor> outputs;
+             {
+               NoGilSection nogil;
+               outputs = plan.Execute(inputs);
+             }
+             std::vector<at::Tensor> result;
+             result.reserve(outputs.size());
+             for (auto& output : outputs) {
+               result.push_back(torch::autograd::make_variable(
+                   bridge::AtenFromXlaTensor(output)));
+             }
+             return result;
+           });
+  py::class_<BatchingExecutor, std::shared_ptr<BatchingExecutor>>(
+      m, "BatchingExecutor")
+      .def(py::init([](const std::map<int64_t, std::shared_ptr<ExecutionPlan>>&
+                           plans,
+                       int64_t max_delay_ns) {
+             // The destruction waits for the batches in flight, whose
+             // completion can run Python callbacks, so it must not hold the
+             // GIL.
+             return std::shared_ptr<BatchingExecutor>(
+                 new BatchingExecutor(plans, max_delay_ns),
+                 [](BatchingExecutor* executor) {
+                   NoGilSection nogil;
+                   delete executor;
+                 });
+           }),
+           py::arg("plans"), py::arg("max_delay_ns"))
+      .def("submit",
+           [](BatchingExecutor& executor, std::vector<at::Tensor> inputs) {
+             NoGilSection nogil;
+             return executor.Submit(std::move(inputs));
+           });
+  py::class_<MappedFile, std::shared_ptr<MappedFile>>(m, "MappedFile")
+      .def(py::init<const std::string&>(), py::arg("path"))
+      .def("size", &MappedFile::size)
+      .def("path", &MappedFile::path);
+  m.def("_xla_tensors_from_mapped_file",
+        [](const std::shared_ptr<MappedFile>& file,
+           const std::vector<size_t>& offsets,
+           const std::vector<std::vector<xla::int64>>& sizes,
+           py::object dtype, const std::string& device_str) {
+          XLA_CHECK(THPDtype_Check(dtype.ptr())) << "Expected a torch.dtype";
+          at::ScalarType scalar_type =
+              reinterpret_cast<THPDtype*>(dtype.ptr())->scalar_type;
+          std::vector<at::Tensor> result;
+          {
+            NoGilSection nogil;
+            auto opt_device = GetOptionalDevice(device_str);
+            std::vector<xla::ComputationClient::DataPtr> handles =
+                MappedFileToXlaData(
+                    file, offsets, sizes, scalar_type,
+                    GetDeviceOrDefault(opt_device ? &opt_device.value()
+                                                  : nullptr));
+            result.reserve(handles.size());
+            for (auto& handle : handles) {
+              result.push_back(
+                  torch::autograd::make_variable(bridge::AtenFromXlaTensor(
+                      XLATensor::Create(std::move(handle), scalar_type))));
+            }
+          }
+          return result;
+        });
+  m.def("_xla_save_checkpoint",
+        [](const std::string& path, const std::vector<std::string>& names,
+           const std::vector<at::Tensor>& tensors) {
+          NoGilSection nogil;
+          SaveCheckpoint(path, names, bridge::GetXlaTensors(tensors));
+        });
+  using CheckpointFuture = xla::util::Future<xla::util::Unit>;
+  py::class_<CheckpointFuture>(m, "CheckpointFuture")
+      .def("is_ready", &CheckpointFuture::IsReady)
+      .def("wait", [](const CheckpointFuture& future) {
+        NoGilSection nogil;
+        future.Wait();
+      });
+  m.def("_xla_save_checkpoint_async",
+        [](const std::string& path, const std::vector<std::string>& names,
+           const std::vector<at::Tensor>& tensors) {
+          NoGilSection nogil;
+          return SaveCheckpointAsync(path, names,
+                                     bridge::GetXlaTensors(tensors));
+        });
+  m.def("_xla_save_graph_bundle", [](const std::string& path) {
+    NoGilSection nogil;
+    SaveGraphBundle(path);
+  });
+  m.def("_xla_save_ir_capture",
+        [](const std::vector<at::Tensor>& tensors, const std::string& path) {
+          std::vector<ir::Value> roots;
+          for (auto& tensor : tensors) {
+            roots.push_back(bridge::GetXlaTensor(tensor).GetIrValue());
+          }
+          NoGilSection nogil;
+          ir::IrCapture::Save(roots, path);
+        });
+  m.def("_xla_replay_ir_capture",
+        [](const std::string& path, const std::string& device,
+           size_t iterations) {
+          ir::IrCapture::ReplayStats stats;
+          {
+            NoGilSection nogil;
+            auto opt_device = GetOptionalDevice(device);
+            stats = ir::IrCapture::Replay(
+                path,
+                GetDeviceOrDefault(opt_device ? &opt_device.value() : nullptr),
+                iterations);
+          }
+          py::dict py_stats;
+          py_stats["num_nodes"] = py::cast(stats.num_nodes);
+          py_stats["num_parameters"] = py::cast(stats.num_parameters);
+          py_stats["lowering_ms"] = py::cast(stats.lowering_ms);
+          py_stats["compile_ms"] = py::cast(stats.compile_ms);
+          py_stats["execute_ms"] = py::cast(stats.execute_ms);
+          py_stats["output_sizes"] = py::cast(stats.output_sizes);
+          return py_stats;
+        },
+        py::arg("path"), py::arg("device") = "", py::arg("iterations") = 10);
+  m.def("_xla_load_graph_bundle",
+        [](const std::string& path, bool lazy) {
+          NoGilSection nogil;
+          return LoadGraphBundle(path, lazy);
+        },
+        py::arg("path"), py::arg("lazy") = false);
+  m.def("_xla_load_checkpoint",
+        [](const std::string& path, const std::string& device_str) {
+          std::vector<std::pair<std::string, XLATensor>> entries;
+          {
+            NoGilSection nogil;
+            auto opt_device = GetOptionalDevice(device_str);
+            entries = LoadCheckpoint(
+                path, GetDeviceOrDefault(opt_device ? &opt_device.value()
+                                                    : nullptr));
+          }
+          std::vector<std::pair<std::string, at::Tensor>> result;
+          result.reserve(entries.size());
+          for (auto& entry : entries) {
+            result.emplace_back(entry.first,
+                                torch::autograd::make_variable(
+                                    bridge::AtenFromXlaTensor(entry.second)));
+          }
+          return result;
+        });
   m.def("_xla_get_tensor_view_alias_id",
         [](const at::Tensor& tensor) { return GetTensorViewAliasId(tensor); });
   m.def("_xla_get_tensor_id",
@@ -272,6 +1194,25 @@ void InitXlaModuleBindings(py::module m) {
     }
     return xla_devices;
   });
+  m.def("_xla_set_replicated_execution",
+        [](bool enabled) { ReplicatedData::Get()->SetEnabled(enabled); });
+  m.def("_xla_replicated_tensor",
+        [](const std::vector<at::Tensor>& shards,
+           const std::vector<std::string>& devices,
+           const std::string& master_device) {
+          at::Tensor result;
+          {
+            NoGilSection nogil;
+            result = CreateReplicatedTensor(shards, devices, master_device);
+          }
+          return torch::autograd::make_variable(result);
+        });
+  m.def("_xla_set_execution_priority", [](int priority) {
+    XLA_CHECK(priority >= 0 && priority < ExecutionScheduler::kNumPriorities)
+        << "Invalid execution priority: " << priority;
+    return static_cast<int>(ExecutionScheduler::SetThreadPriority(
+        static_cast<ExecutionScheduler::Priority>(priority)));
+  });
   m.def("_xla_set_replication_devices",
         [](const std::vector<std::string>& devices) {
           xla::ComputationClient::Get()->SetReplicationDevices(devices);
@@ -279,17 +1220,516 @@ void InitXlaModuleBindings(py::module m) {
   m.def("_xla_get_replication_devices", []() {
     return xla::ComputationClient::Get()->GetReplicationDevices();
   });
+  m.def("_xla_get_data_shard_position", []() {
+    DataShardPosition position = GetDataShardPosition();
+    return std::make_tuple(position.index, position.count,
+                           position.local_devices);
+  });
+  m.def("_xla_get_data_shard_indices",
+        [](xla::int64 index, xla::int64 count, xla::int64 dataset_size,
+           xla::int64 seed, xla::int64 epoch, bool shuffle, bool drop_last,
+           xla::int64 granule) {
+          DataShardPosition position;
+          position.index = index;
+          position.count = count;
+          NoGilSection nogil;
+          return GetDataShardIndices(position, dataset_size, seed, epoch,
+                                     shuffle, drop_last, granule);
+        });
+  m.def("_xla_get_topology_ordered_devices",
+        [](const std::vector<std::string>& devices) {
+          return xla::ComputationClient::Get()->GetTopologyOrderedDevices(
+              devices);
+        });
   m.def("_xla_get_replication_devices_count", []() {
     return xla::ComputationClient::Get()->GetReplicationDevices().size();
   });
-  m.def("_xla_cross_replica_sum", [](const std::vector<at::Tensor>& tensors,
-                                     double scale, const py::list& groups) {
+  m.def("_xla_get_replication_host_groups",
+        []() { return GetReplicationHostGroups(); });
+  m.def("_xla_rendezvous",
+        [](const std::string& tag, xla::int64 replicas, xla::int64 ordinal,
+           const py::object& payload) {
+          std::unique_ptr<std::string> payload_data;
+          if (!payload.is_none()) {
+            payload_data.reset(new std::string(payload.cast<std::string>()));
+          }
+          std::vector<std::string> payloads;
+          {
+            NoGilSection nogil;
+            payloads = GetMeshClient()->Rendezvous(tag, replicas, ordinal,
+                                                   payload_data.get());
+          }
+          return ToPyBytes(payloads);
+        },
+        py::arg("tag"), py::arg("replicas"), py::arg("ordinal"),
+        py::arg("payload") = py::none());
+  m.def("_xla_set_key_values", [](const py::dict& key_values) {
+    std::vector<std::pair<std::string, std::string>> items;
+    for (auto& item : key_values) {
+      items.emplace_back(item.first.cast<std::string>(),
+                         item.second.cast<std::string>());
+    }
     NoGilSection nogil;
-    InsertCrossReplicaSum(tensors, scale, groups);
+    GetMeshClient()->SetKeyValues(items);
   });
+  m.def("_xla_get_key_values",
+        [](const std::vector<std::string>& keys, double wait_seconds) {
+          std::vector<std::string> values;
+          {
+            NoGilSection nogil;
+            values = GetMeshClient()->GetKeyValues(keys, wait_seconds);
+          }
+          return ToPyBytes(values);
+        },
+        py::arg("keys"), py::arg("wait_seconds") = 300.0);
+  m.def("_xla_cross_replica_sum",
+        [](const std::vector<at::Tensor>& tensors, double scale,
+           const py::list& groups, const std::string& compression,
+           bool error_feedback, const py::list& host_groups) {
+          NoGilSection nogil;
+          InsertCrossReplicaSum(tensors, scale, groups, compression,
+                                error_feedback, host_groups);
+        },
+        py::arg("tensors"), py::arg("scale"), py::arg("groups"),
+        py::arg("compression") = "", py::arg("error_feedback") = false,
+        py::arg("host_groups") = py::list());
+  m.def("_xla_all_gather",
+        [](const at::Tensor& tensor, xla::int64 dim, xla::int64 shard_count,
+           const py::list& groups) {
+          std::vector<std::vector<xla::int64>> replica_groups =
+              GetReplicaGroups(groups);
+          at::Tensor result;
+          {
+            NoGilSection nogil;
+            result = bridge::AtenFromXlaTensor(
+                XLATensor::all_gather(bridge::GetXlaTensor(tensor), dim,
+                                      shard_count, replica_groups));
+          }
+          return torch::autograd::make_variable(result);
+        });
+  m.def("_xla_reduce_scatter",
+        [](const at::Tensor& tensor, double scale, xla::int64 dim,
+           xla::int64 shard_count, const py::list& groups) {
+          std::vector<std::vector<xla::int64>> replica_groups =
+              GetReplicaGroups(groups);
+          at::Tensor result;
+          {
+            NoGilSection nogil;
+            result = bridge::AtenFromXlaTensor(
+                XLATensor::reduce_scatter(bridge::GetXlaTensor(tensor), scale,
+                                          dim, shard_count, replica_groups));
+          }
+          return torch::autograd::make_variable(result);
+        });
+  m.def("_xla_all_to_all",
+        [](const at::Tensor& tensor, xla::int64 split_dimension,
+           xla::int64 concat_dimension, xla::int64 split_count,
+           const py::list& groups) {
+          std::vector<std::vector<xla::int64>> replica_groups =
+              GetReplicaGroups(groups);
+          at::Tensor result;
+          {
+            NoGilSection nogil;
+            result = bridge::AtenFromXlaTensor(XLATensor::all_to_all(
+                bridge::GetXlaTensor(tensor), split_dimension,
+                concat_dimension, split_count, replica_groups));
+          }
+          return torch::autograd::make_variable(result);
+        });
+  m.def("_xla_collective_permute",
+        [](const at::Tensor& tensor, const py::list& source_target_pairs) {
+          std::vector<std::pair<xla::int64, xla::int64>> pairs;
+          for (auto& pair : source_target_pairs) {
+            pairs.push_back(pair.cast<std::pair<xla::int64, xla::int64>>());
+          }
+          at::Tensor result;
+          {
+            NoGilSection nogil;
+            result = bridge::AtenFromXlaTensor(XLATensor::collective_permute(
+                bridge::GetXlaTensor(tensor), std::move(pairs)));
+          }
+          return torch::autograd::make_variable(result);
+        });
+  m.def("_xla_embedding_sparse_backward",
+        [](const at::Tensor& grad_output, const at::Tensor& indices,
+           xla::int64 num_weights, xla::int64 padding_idx,
+           bool scale_grad_by_freq) {
+          at::Tensor rows;
+          at::Tensor row_grads;
+          {
+            NoGilSection nogil;
+            std::tie(rows, row_grads) =
+                EmbeddingSparseBackward(grad_output, indices, num_weights,
+                                        padding_idx, scale_grad_by_freq);
+          }
+          return py::make_tuple(torch::autograd::make_variable(rows),
+                                torch::autograd::make_variable(row_grads));
+        },
+        py::arg("grad_output"), py::arg("indices"), py::arg("num_weights"),
+        py::arg("padding_idx") = -1, py::arg("scale_grad_by_freq") = false);
+  m.def("_xla_attention",
+        [](const at::Tensor& query, const at::Tensor& key,
+           const at::Tensor& value, const py::object& mask, double scale) {
+          XLATensor xla_mask = GetOptionalXlaTensor(mask);
+          at::Tensor output;
+          at::Tensor logsumexp;
+          {
+            NoGilSection nogil;
+            std::tie(output, logsumexp) =
+                Attention(query, key, value, xla_mask, scale);
+          }
+          return py::make_tuple(torch::autograd::make_variable(output),
+                                torch::autograd::make_variable(logsumexp));
+        },
+        py::arg("query"), py::arg("key"), py::arg("value"),
+        py::arg("mask") = py::none(), py::arg("scale") = 1.0);
+  m.def("_xla_attention_backward",
+        [](const at::Tensor& grad_output, const at::Tensor& query,
+           const at::Tensor& key, const at::Tensor& value,
+           const py::object& mask, const at::Tensor& output,
+           const at::Tensor& logsumexp, double scale) {
+          XLATensor xla_mask = GetOptionalXlaTensor(mask);
+          at::Tensor grad_query;
+          at::Tensor grad_key;
+          at::Tensor grad_value;
+          {
+            NoGilSection nogil;
+            std::tie(grad_query, grad_key, grad_value) =
+                AttentionBackward(grad_output, query, key, value, xla_mask,
+                                  output, logsumexp, scale);
+          }
+          return py::make_tuple(torch::autograd::make_variable(grad_query),
+                                torch::autograd::make_variable(grad_key),
+                                torch::autograd::make_variable(grad_value));
+        },
+        py::arg("grad_output"), py::arg("query"), py::arg("key"),
+        py::arg("value"), py::arg("mask"), py::arg("output"),
+        py::arg("logsumexp"), py::arg("scale") = 1.0);
+  m.def("_xla_sort",
+        [](const std::vector<at::Tensor>& keys, xla::int64 dim,
+           bool descending, bool stable) {
+          at::Tensor values;
+          at::Tensor indices;
+          {
+            NoGilSection nogil;
+            std::tie(values, indices) = Sort(keys, dim, descending, stable);
+          }
+          return py::make_tuple(torch::autograd::make_variable(values),
+                                torch::autograd::make_variable(indices));
+        },
+        py::arg("keys"), py::arg("dim") = -1, py::arg("descending") = false,
+        py::arg("stable") = true);
+  m.def("_xla_group_norm",
+        [](const at::Tensor& input, const py::object& weight,
+           const py::object& bias, xla::int64 num_groups,
+           std::vector<xla::int64> affine_dims, double eps) {
+          XLATensor xla_weight = GetOptionalXlaTensor(weight);
+          XLATensor xla_bias = GetOptionalXlaTensor(bias);
+          at::Tensor output;
+          at::Tensor mean;
+          at::Tensor rstd;
+          {
+            NoGilSection nogil;
+            std::tie(output, mean, rstd) =
+                GroupNorm(input, xla_weight, xla_bias, num_groups,
+                          std::move(affine_dims), eps);
+          }
+          return py::make_tuple(torch::autograd::make_variable(output),
+                                torch::autograd::make_variable(mean),
+                                torch::autograd::make_variable(rstd));
+        },
+        py::arg("input"), py::arg("weight"), py::arg("bias"),
+        py::arg("num_groups"), py::arg("affine_dims"), py::arg("eps") = 1e-5);
+  m.def("_xla_group_norm_backward",
+        [](const at::Tensor& grad_output, const at::Tensor& input,
+           const py::object& weight, const at::Tensor& mean,
+           const at::Tensor& rstd, xla::int64 num_groups,
+           std::vector<xla::int64> affine_dims) {
+          XLATensor xla_weight = GetOptionalXlaTensor(weight);
+          at::Tensor grad_input;
+          at::Tensor grad_weight;
+          at::Tensor grad_bias;
+          {
+            NoGilSection nogil;
+            std::tie(grad_input, grad_weight, grad_bias) =
+                GroupNormBackward(grad_output, input, xla_weight, mean, rstd,
+                                  num_groups, std::move(affine_dims));
+          }
+          return py::make_tuple(torch::autograd::make_variable(grad_input),
+                                torch::autograd::make_variable(grad_weight),
+                                torch::autograd::make_variable(grad_bias));
+        },
+        py::arg("grad_output"), py::arg("input"), py::arg("weight"),
+        py::arg("mean"), py::arg("rstd"), py::arg("num_groups"),
+        py::arg("affine_dims"));
+  m.def("_xla_lstm_cell",
+        [](const at::Tensor& input, const at::Tensor& hx, const at::Tensor& cx,
+           const at::Tensor& w_ih, const at::Tensor& w_hh,
+           const py::object& b_ih, const py::object& b_hh) {
+          XLATensor xla_b_ih = GetOptionalXlaTensor(b_ih);
+          XLATensor xla_b_hh = GetOptionalXlaTensor(b_hh);
+          NoGilSection nogil;
+          return XlaToAtenTensors(XLATensor::lstm_cell(
+              bridge::GetXlaTensor(input), bridge::GetXlaTensor(hx),
+              bridge::GetXlaTensor(cx), bridge::GetXlaTensor(w_ih),
+              bridge::GetXlaTensor(w_hh), xla_b_ih, xla_b_hh));
+        },
+        py::arg("input"), py::arg("hx"), py::arg("cx"), py::arg("w_ih"),
+        py::arg("w_hh"), py::arg("b_ih") = py::none(),
+        py::arg("b_hh") = py::none());
+  m.def("_xla_lstm_cell_backward",
+        [](const at::Tensor& grad_h, const at::Tensor& grad_c,
+           const at::Tensor& input, const at::Tensor& hx, const at::Tensor& cx,
+           const at::Tensor& w_ih, const at::Tensor& w_hh, const at::Tensor& c,
+           const at::Tensor& gates) {
+          NoGilSection nogil;
+          return XlaToAtenTensors(XLATensor::lstm_cell_backward(
+              bridge::GetXlaTensor(grad_h), bridge::GetXlaTensor(grad_c),
+              bridge::GetXlaTensor(input), bridge::GetXlaTensor(hx),
+              bridge::GetXlaTensor(cx), bridge::GetXlaTensor(w_ih),
+              bridge::GetXlaTensor(w_hh), bridge::GetXlaTensor(c),
+              bridge::GetXlaTensor(gates)));
+        });
+  m.def("_xla_gru_cell",
+        [](const at::Tensor& input, const at::Tensor& hx,
+           const at::Tensor& w_ih, const at::Tensor& w_hh,
+           const py::object& b_ih, const py::object& b_hh) {
+          XLATensor xla_b_ih = GetOptionalXlaTensor(b_ih);
+          XLATensor xla_b_hh = GetOptionalXlaTensor(b_hh);
+          NoGilSection nogil;
+          return XlaToAtenTensors(XLATensor::gru_cell(
+              bridge::GetXlaTensor(input), bridge::GetXlaTensor(hx),
+              bridge::GetXlaTensor(w_ih), bridge::GetXlaTensor(w_hh), xla_b_ih,
+              xla_b_hh));
+        },
+        py::arg("input"), py::arg("hx"), py::arg("w_ih"), py::arg("w_hh"),
+        py::arg("b_ih") = py::none(), py::arg("b_hh") = py::none());
+  m.def("_xla_gru_cell_backward",
+        [](const at::Tensor& grad_h, const at::Tensor& input,
+           const at::Tensor& hx, const at::Tensor& w_ih,
+           const at::Tensor& w_hh, const at::Tensor& gates) {
+          NoGilSection nogil;
+          return XlaToAtenTensors(XLATensor::gru_cell_backward(
+              bridge::GetXlaTensor(grad_h), bridge::GetXlaTensor(input),
+              bridge::GetXlaTensor(hx), bridge::GetXlaTensor(w_ih),
+              bridge::GetXlaTensor(w_hh), bridge::GetXlaTensor(gates)));
+        });
+  m.def("_xla_lstm_sequence",
+        [](const at::Tensor& input, const at::Tensor& h0, const at::Tensor& c0,
+           const at::Tensor& w_ih, const at::Tensor& w_hh,
+           const py::object& b_ih, const py::object& b_hh) {
+          XLATensor xla_b_ih = GetOptionalXlaTensor(b_ih);
+          XLATensor xla_b_hh = GetOptionalXlaTensor(b_hh);
+          NoGilSection nogil;
+          return XlaToAtenTensors(XLATensor::lstm_sequence(
+              bridge::GetXlaTensor(input), bridge::GetXlaTensor(h0),
+              bridge::GetXlaTensor(c0), bridge::GetXlaTensor(w_ih),
+              bridge::GetXlaTensor(w_hh), xla_b_ih, xla_b_hh));
+        },
+        py::arg("input"), py::arg("h0"), py::arg("c0"), py::arg("w_ih"),
+        py::arg("w_hh"), py::arg("b_ih") = py::none(),
+        py::arg("b_hh") = py::none());
+  m.def("_xla_lstm_sequence_backward",
+        [](const at::Tensor& grad_output, const at::Tensor& grad_cells,
+           const at::Tensor& input, const at::Tensor& h0, const at::Tensor& c0,
+           const at::Tensor& w_ih, const at::Tensor& w_hh,
+           const at::Tensor& output, const at::Tensor& cells,
+           const at::Tensor& gates) {
+          NoGilSection nogil;
+          return XlaToAtenTensors(XLATensor::lstm_sequence_backward(
+              bridge::GetXlaTensor(grad_output),
+              bridge::GetXlaTensor(grad_cells), bridge::GetXlaTensor(input),
+              bridge::GetXlaTensor(h0), bridge::GetXlaTensor(c0),
+              bridge::GetXlaTensor(w_ih), bridge::GetXlaTensor(w_hh),
+              bridge::GetXlaTensor(output), bridge::GetXlaTensor(cells),
+              bridge::GetXlaTensor(gates)));
+        });
+  m.def("_xla_gru_sequence",
+        [](const at::Tensor& input, const at::Tensor& h0,
+           const at::Tensor& w_ih, const at::Tensor& w_hh,
+           const py::object& b_ih, const py::object& b_hh) {
+          XLATensor xla_b_ih = GetOptionalXlaTensor(b_ih);
+          XLATensor xla_b_hh = GetOptionalXlaTensor(b_hh);
+          NoGilSection nogil;
+          return XlaToAtenTensors(XLATensor::gru_sequence(
+              bridge::GetXlaTensor(input), bridge::GetXlaTensor(h0),
+              bridge::GetXlaTensor(w_ih), bridge::GetXlaTensor(w_hh), xla_b_ih,
+              xla_b_hh));
+        },
+        py::arg("input"), py::arg("h0"), py::arg("w_ih"), py::arg("w_hh"),
+        py::arg("b_ih") = py::none(), py::arg("b_hh") = py::none());
+  m.def("_xla_gru_sequence_backward",
+        [](const at::Tensor& grad_output, const at::Tensor& input,
+           const at::Tensor& h0, const at::Tensor& w_ih,
+           const at::Tensor& w_hh, const at::Tensor& output,
+           const at::Tensor& gates) {
+          NoGilSection nogil;
+          return XlaToAtenTensors(XLATensor::gru_sequence_backward(
+              bridge::GetXlaTensor(grad_output), bridge::GetXlaTensor(input),
+              bridge::GetXlaTensor(h0), bridge::GetXlaTensor(w_ih),
+              bridge::GetXlaTensor(w_hh), bridge::GetXlaTensor(output),
+              bridge::GetXlaTensor(gates)));
+        });
+  m.def("_xla_remat_anchor",
+        [](const std::vector<at::Tensor>& tensors, const at::Tensor& anchor) {
+          NoGilSection nogil;
+          return RematAnchor(tensors, anchor);
+        });
+  m.def("_xla_packed_dropout", [](const at::Tensor& input, double p) {
+    NoGilSection nogil;
+    return PackedDropout(input, p);
+  });
+  m.def("_xla_packed_dropout_backward",
+        [](const at::Tensor& grad_output, const at::Tensor& packed_mask,
+           double p) {
+          NoGilSection nogil;
+          return PackedDropoutBackward(grad_output, packed_mask, p);
+        });
+  m.def("_xla_sgd_step_",
+        [](const std::vector<at::Tensor>& params,
+           const std::vector<at::Tensor>& grads,
+           const std::vector<at::Tensor>& momentum_buffers, double lr,
+           double momentum, double dampening, double weight_decay,
+           bool nesterov, bool init_buffers) {
+          NoGilSection nogil;
+          SgdStep(params, grads, momentum_buffers, lr, momentum, dampening,
+                  weight_decay, nesterov, init_buffers);
+        },
+        py::arg("params"), py::arg("grads"), py::arg("momentum_buffers"),
+        py::arg("lr"), py::arg("momentum") = 0.0, py::arg("dampening") = 0.0,
+        py::arg("weight_decay") = 0.0, py::arg("nesterov") = false,
+        py::arg("init_buffers") = false);
+  m.def("_xla_adam_step_",
+        [](const std::vector<at::Tensor>& params,
+           const std::vector<at::Tensor>& grads,
+           const std::vector<at::Tensor>& exp_avgs,
+           const std::vector<at::Tensor>& exp_avg_sqs,
+           const std::vector<at::Tensor>& max_exp_avg_sqs, double step_size,
+           double beta1, double beta2, double eps, double weight_decay) {
+          NoGilSection nogil;
+          AdamStep(params, grads, exp_avgs, exp_avg_sqs, max_exp_avg_sqs,
+                   step_size, beta1, beta2, eps, weight_decay);
+        },
+        py::arg("params"), py::arg("grads"), py::arg("exp_avgs"),
+        py::arg("exp_avg_sqs"), py::arg("max_exp_avg_sqs"),
+        py::arg("step_size"), py::arg("beta1"), py::arg("beta2"),
+        py::arg("eps"), py::arg("weight_decay") = 0.0);
+  m.def("_xla_lamb_step_",
+        [](const std::vector<at::Tensor>& params,
+           const std::vector<at::Tensor>& grads,
+           const std::vector<at::Tensor>& exp_avgs,
+           const std::vector<at::Tensor>& exp_avg_sqs, double lr,
+           double beta1, double beta2, double eps, double weight_decay,
+           double bias_correction1, double bias_correction2) {
+          NoGilSection nogil;
+          LambStep(params, grads, exp_avgs, exp_avg_sqs, lr, beta1, beta2, eps,
+                   weight_decay, bias_correction1, bias_correction2);
+        },
+        py::arg("params"), py::arg("grads"), py::arg("exp_avgs"),
+        py::arg("exp_avg_sqs"), py::arg("lr"), py::arg("beta1"),
+        py::arg("beta2"), py::arg("eps"), py::arg("weight_decay") = 0.0,
+        py::arg("bias_correction1") = 1.0, py::arg("bias_correction2") = 1.0);
+  m.def("_xla_clip_grad_norm_",
+        [](const std::vector<at::Tensor>& grads, double max_norm,
+           double norm_type) {
+          NoGilSection nogil;
+          return ClipGradNorm(grads, max_norm, norm_type);
+        },
+        py::arg("grads"), py::arg("max_norm"), py::arg("norm_type") = 2.0);
+  m.def("_xla_amp_unscale_",
+        [](const std::vector<at::Tensor>& grads, const at::Tensor& loss_scale) {
+          NoGilSection nogil;
+          return AmpUnscale(grads, loss_scale);
+        });
+  m.def("_xla_select_finite_updates_",
+        [](const std::vector<at::Tensor>& tensors,
+           const std::vector<at::Tensor>& previous,
+           const at::Tensor& found_inf) {
+          NoGilSection nogil;
+          SelectFiniteUpdates(tensors, previous, found_inf);
+        });
+  m.def("_xla_update_loss_scale_",
+        [](const at::Tensor& loss_scale, const at::Tensor& good_steps,
+           const at::Tensor& found_inf, double growth_factor,
+           double backoff_factor, xla::int64 growth_interval,
+           double min_scale) {
+          NoGilSection nogil;
+          UpdateLossScale(loss_scale, good_steps, found_inf, growth_factor,
+                          backoff_factor, growth_interval, min_scale);
+        },
+        py::arg("loss_scale"), py::arg("good_steps"), py::arg("found_inf"),
+        py::arg("growth_factor"), py::arg("backoff_factor"),
+        py::arg("growth_interval"), py::arg("min_scale"));
+  m.def("_xla_quantized_linear",
+        [](const at::Tensor& input, const at::Tensor& weight,
+           const at::Tensor& weight_scales, const py::object& bias,
+           double input_scale) {
+          XLATensor xla_bias = GetOptionalXlaTensor(bias);
+          NoGilSection nogil;
+          return QuantizedLinear(input, weight, weight_scales, xla_bias,
+                                 input_scale);
+        },
+        py::arg("input"), py::arg("weight"), py::arg("weight_scales"),
+        py::arg("bias") = py::none(), py::arg("input_scale") = 1.0);
+  m.def("_xla_quantized_convolution",
+        [](const at::Tensor& input, const at::Tensor& weight,
+           const at::Tensor& weight_scales, const py::object& bias,
+           double input_scale, std::vector<xla::int64> stride,
+           std::vector<xla::int64> padding, std::vector<xla::int64> dilation,
+           xla::int64 groups) {
+          XLATensor xla_bias = GetOptionalXlaTensor(bias);
+          NoGilSection nogil;
+          return QuantizedConvolution(input, weight, weight_scales, xla_bias,
+                                      input_scale, std::move(stride),
+                                      std::move(padding), std::move(dilation),
+                                      groups);
+        },
+        py::arg("input"), py::arg("weight"), py::arg("weight_scales"),
+        py::arg("bias"), py::arg("input_scale"), py::arg("stride"),
+        py::arg("padding"), py::arg("dilation"), py::arg("groups") = 1);
+  m.def("_xla_nonzero_bounded", [](const at::Tensor& input) {
+    NoGilSection nogil;
+    return BoundedResult(
+        XLATensor::nonzero_bounded(bridge::GetXlaTensor(input)));
+  });
+  m.def("_xla_masked_select_bounded",
+        [](const at::Tensor& input, const at::Tensor& mask) {
+          NoGilSection nogil;
+          return BoundedResult(XLATensor::masked_select_bounded(
+              bridge::GetXlaTensor(input), bridge::GetXlaTensor(mask)));
+        });
+  m.def("_xla_unique_bounded", [](const at::Tensor& input) {
+    NoGilSection nogil;
+    return BoundedResult(
+        XLATensor::unique_bounded(bridge::GetXlaTensor(input)));
+  });
+  m.def("_xla_subgraph_parameters",
+        [](const std::vector<at::Tensor>& operands) {
+          NoGilSection nogil;
+          return SubgraphParameters(operands);
+        });
+  m.def("_xla_cond",
+        [](const at::Tensor& predicate, const std::vector<at::Tensor>& operands,
+           xla::int64 scope, const std::vector<at::Tensor>& true_outputs,
+           const std::vector<at::Tensor>& false_outputs) {
+          NoGilSection nogil;
+          return Cond(predicate, operands, scope, true_outputs, false_outputs);
+        });
+  m.def("_xla_while_loop",
+        [](const std::vector<at::Tensor>& operands, xla::int64 scope,
+           const at::Tensor& condition,
+           const std::vector<at::Tensor>& body_outputs) {
+          NoGilSection nogil;
+          return WhileLoop(operands, scope, condition, body_outputs);
+        });
   m.def("_xla_set_default_device",
         [](const std::string& device) { return SetCurrentDevice(device); });
   m.def("_xla_get_default_device", []() { return GetCurrentDevice(); });
+  m.def("_xla_bind_thread_to_device_cpus", [](const std::string& device) {
+    Device xla_device = bridge::AtenDeviceToXlaDevice(c10::Device(device));
+    return xla::affinity::SetThreadCpus(
+        xla::affinity::GetDeviceCpus(xla_device.ToString()));
+  });
   m.def("_xla_sync_multi",
         [](const std::vector<at::Tensor>& tensors,
            const std::vector<std::string>& devices, bool wait,
@@ -306,6 +1746,15 @@ void InitXlaModuleBindings(py::module m) {
           SyncLiveTensors(device, devices, wait);
         },
         py::arg("device") = "", py::arg("devices"), py::arg("wait") = true);
+  m.def("_xla_sync_live_tensors_steps",
+        [](const std::string& device,
+           const std::vector<at::Tensor>& step_inputs,
+           const std::vector<at::Tensor>& stacked_inputs, bool wait) {
+          NoGilSection nogil;
+          SyncLiveTensorsSteps(device, step_inputs, stacked_inputs, wait);
+        },
+        py::arg("device"), py::arg("step_inputs"), py::arg("stacked_inputs"),
+        py::arg("wait") = true);
   m.def("_xla_step_marker",
         [](const std::string& device, const std::vector<std::string>& devices,
            bool wait) {
@@ -313,17 +1762,126 @@ void InitXlaModuleBindings(py::module m) {
           StepMarker(device, devices, wait);
         },
         py::arg("device") = "", py::arg("devices"), py::arg("wait") = true);
+  m.def("_xla_set_rng_seed",
+        [](uint64_t seed, const std::string& device) {
+          auto opt_device = GetOptionalDevice(device);
+          XLATensor::SetRngSeed(opt_device ? &opt_device.value() : nullptr,
+                                seed);
+        },
+        py::arg("seed"), py::arg("device") = "");
+  m.def("_xla_get_rng_seed",
+        [](const std::string& device) {
+          auto opt_device = GetOptionalDevice(device);
+          return XLATensor::GetRunningSeed(
+              GetDeviceOrDefault(opt_device ? &opt_device.value() : nullptr));
+        },
+        py::arg("device") = "");
   m.def("_xla_counter_names", []() { return xla::metrics::GetCounterNames(); });
   m.def("_xla_counter_value", [](const std::string& name) -> py::object {
     xla::metrics::CounterData* data = xla::metrics::GetCounter(name);
     return data != nullptr ? py::cast<int64_t>(data->Value()) : py::none();
   });
+  m.def("_xla_counter_add", [](const std::string& name, int64_t value) {
+    xla::metrics::Counter(name).AddValue(value);
+  });
   m.def("_xla_metric_names", []() { return xla::metrics::GetMetricNames(); });
+  m.def("_xla_metric_add_time", [](const std::string& name, double value_ns) {
+    xla::metrics::Metric(name, xla::metrics::MetricFnTime).AddSample(value_ns);
+  });
+  m.def("_xla_metric_add_value", [](const std::string& name, double value) {
+    xla::metrics::Metric(name).AddSample(value);
+  });
   m.def("_xla_metric_data", [](const std::string& name) -> py::object {
     return GetMetricData(name);
   });
   m.def("_xla_metrics_report",
         []() { return xla::metrics::CreateMetricReport(); });
+  m.def("_xla_openmetrics_report",
+        []() { return xla::metrics::CreateOpenMetricsReport(); });
+  m.def("_xla_start_metrics_server",
+        [](int port) { return xla::metrics::StartMetricsServer(port); },
+        py::arg("port") = 0);
+  m.def("_xla_start_metrics_pusher",
+        [](const std::string& address, double period) {
+          xla::metrics::StartMetricsPusher(address, period);
+        },
+        py::arg("address"), py::arg("period") = 60.0);
+  m.def("_xla_graph_stats",
+        [](const std::string& sort_by) { return GetGraphStats(sort_by); },
+        py::arg("sort_by") = "execute_time");
+  m.def("_xla_graph_stats_report",
+        [](const std::string& sort_by, size_t max_graphs) {
+          return GraphStats::Get()->CreateReport(sort_by, max_graphs);
+        },
+        py::arg("sort_by") = "execute_time", py::arg("max_graphs") = 20);
+  m.def("_xla_clear_graph_stats", []() { GraphStats::Get()->Clear(); });
+  m.def("_xla_cache_miss_explanations",
+        []() { return CacheMissExplainer::Get()->GetExplanations(); });
+  m.def("_xla_clear_cache_miss_explanations",
+        []() { CacheMissExplainer::Get()->Clear(); });
+  m.def("_xla_fallback_stats",
+        [](const std::string& sort_by) { return GetFallbackStats(sort_by); },
+        py::arg("sort_by") = "time");
+  m.def("_xla_fallback_report",
+        [](const std::string& sort_by) {
+          return FallbackProfiler::Get()->CreateReport(sort_by);
+        },
+        py::arg("sort_by") = "time");
+  m.def("_xla_clear_fallback_stats",
+        []() { FallbackProfiler::Get()->Clear(); });
+  m.def("_xla_op_profile_add",
+        [](const std::vector<std::pair<std::string, double>>& samples) {
+          std::vector<std::pair<std::string, xla::int64>> ns_samples;
+          ns_samples.reserve(samples.size());
+          for (auto& op_name_time : samples) {
+            ns_samples.emplace_back(
+                op_name_time.first,
+                static_cast<xla::int64>(op_name_time.second * 1.0e9));
+          }
+          return OpProfiler::Get()->AddSamples(ns_samples);
+        });
+  m.def("_xla_op_profile_stats", []() { return GetOpProfileStats(); });
+  m.def("_xla_op_profile_report",
+        [](size_t max_entries) {
+          return OpProfiler::Get()->CreateReport(max_entries);
+        },
+        py::arg("max_entries") = 30);
+  m.def("_xla_op_profile_folded_stacks",
+        []() { return OpProfiler::Get()->CreateFoldedStacks(); });
+  m.def("_xla_clear_op_profile", []() { OpProfiler::Get()->Clear(); });
+  m.def("_xla_set_memory_category",
+        [](const std::vector<at::Tensor>& tensors,
+           const std::string& category) {
+          SetMemoryCategory(tensors, category);
+        });
+  m.def("_xla_set_materialize",
+        [](const std::vector<at::Tensor>& tensors, bool materialize) {
+          SetMaterialize(tensors, materialize);
+        });
+  m.def("_xla_mark_sharding",
+        [](const at::Tensor& tensor, const std::vector<xla::int64>& mesh_shape,
+           const std::vector<xla::int64>& dim_axes) {
+          NoGilSection nogil;
+          MarkSharding(tensor, mesh_shape, dim_axes);
+        });
+  m.def("_xla_memory_info", []() { return GetMemoryInfo(); });
+  m.def("_xla_largest_allocations",
+        [](size_t count, const std::string& device) {
+          return GetLargestAllocations(count, device);
+        },
+        py::arg("count") = 20, py::arg("device") = "");
+  m.def("_xla_memory_report",
+        [](size_t max_allocations) {
+          return xla::MemoryTracker::Get()->CreateReport(max_allocations);
+        },
+        py::arg("max_allocations") = 20);
+  m.def("_xla_reset_memory_peaks",
+        []() { xla::MemoryTracker::Get()->ResetPeaks(); });
+  m.def("_xla_set_tracing",
+        [](bool enabled) { xla::tracing::SetEnabled(enabled); });
+  m.def("_xla_chrome_trace",
+        []() { return xla::tracing::DumpChromeTrace(); });
+  m.def("_xla_clear_trace", []() { xla::tracing::Clear(); });
   m.def("_xla_tensors_report",
         [](size_t nodes_threshold, const std::string& device) {
           return GetLiveTensorsReport(nodes_threshold, device);
@@ -336,11 +1894,30 @@ void InitXlaModuleBindings(py::module m) {
                                          : xla::PrecisionConfig::DEFAULT);
         },
         py::arg("use_full_mat_mul_precision") = true);
+  m.def("_xla_set_mixed_precision",
+        [](const std::string& compute_type,
+           const std::string& accumulation_type) {
+          XlaHelpers::MixedPrecision mixed_precision;
+          mixed_precision.compute_type = ParseMixedPrecisionType(compute_type);
+          mixed_precision.accumulation_type =
+              ParseMixedPrecisionType(accumulation_type);
+          XlaHelpers::set_mixed_precision(mixed_precision);
+        },
+        py::arg("compute_type") = "", py::arg("accumulation_type") = "");
+  m.def("_xla_get_mixed_precision", []() {
+    XlaHelpers::MixedPrecision mixed_precision = XlaHelpers::mixed_precision();
+    return std::make_pair(
+        MixedPrecisionTypeName(mixed_precision.compute_type),
+        MixedPrecisionTypeName(mixed_precision.accumulation_type));
+  });
 }
 
 }  // namespace
 
-void InitXlaBindings(py::module m) { InitXlaModuleBindings(m); }
+void InitXlaBindings(py::module m) {
+  InitXlaModuleBindings(m);
+  xla::metrics::MaybeStartMetricsExporters();
+}
 
 }  // namespace torch_xla
 
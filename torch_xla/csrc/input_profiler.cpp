@@ -0,0 +1,71 @@
+#include "torch_xla/csrc/input_profiler.h"
+
+#include <algorithm>
+
+#include "tensorflow/compiler/xla/xla_client/metrics.h"
+#include "tensorflow/compiler/xla/xla_client/sys_util.h"
+
+namespace torch_xla {
+
+InputProfiler* InputProfiler::Get() {
+  static InputProfiler* profiler = new InputProfiler();
+  return profiler;
+}
+
+bool InputProfiler::IsEnabled() {
+  static const bool enabled =
+      xla::sys_util::GetEnvBool("XLA_INPUT_PROFILE", false);
+  return enabled;
+}
+
+void InputProfiler::RecordUploaded(
+    const std::vector<xla::ComputationClient::DataPtr>& datas) {
+  xla::int64 now_ns = xla::sys_util::NowNs();
+  std::lock_guard<std::mutex> lock(lock_);
+  for (auto& data : datas) {
+    Entry entry;
+    entry.data = data;
+    entry.uploaded_ns = now_ns;
+    entries_[data.get()] = std::move(entry);
+  }
+  if (entries_.size() >= prune_size_) {
+    PruneReleased();
+  }
+}
+
+void InputProfiler::RecordConsumed(
+    const std::vector<xla::ComputationClient::DataPtr>& datas) {
+  static xla::metrics::Metric* live_time_metric = new xla::metrics::Metric(
+      "InputDeviceLiveTime", xla::metrics::MetricFnTime);
+  xla::int64 now_ns = xla::sys_util::NowNs();
+  std::lock_guard<std::mutex> lock(lock_);
+  if (entries_.empty()) {
+    return;
+  }
+  for (auto& data : datas) {
+    auto it = entries_.find(data.get());
+    // An expired entry refers to a released device data whose memory has been
+    // reused by the one at hand.
+    if (it != entries_.end()) {
+      if (!it->second.data.expired()) {
+        live_time_metric->AddSample(now_ns - it->second.uploaded_ns);
+      }
+      entries_.erase(it);
+    }
+  }
+}
+
+void InputProfiler::PruneReleased() {
+  for (auto it = entries_.begin(); it != entries_.end();) {
+    if (it->second.data.expired()) {
+      XLA_COUNTER("InputProfilerUnconsumedData", 1);
+      it = entries_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+  // Keep the sweeps amortized when many batches are legitimately in flight.
+  prune_size_ = std::max<size_t>(1024, 2 * entries_.size());
+}
+
+}  // namespace torch_xla
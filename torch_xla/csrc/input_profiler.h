@@ -0,0 +1,50 @@
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "tensorflow/compiler/xla/types.h"
+#include "tensorflow/compiler/xla/xla_client/computation_client.h"
+
+namespace torch_xla {
+
+// Tracks how long the uploaded input batches stay live on the device before
+// an execution consumes them. When enabled (XLA_INPUT_PROFILE), the input
+// pipelines register the device data of the batches once their upload
+// completes, and the first execution taking any of them as parameter samples
+// the InputDeviceLiveTime metric. Together with the queue metrics of the
+// input pipelines (InputQueueDepth, InputPendingTime, InputReadyTime and
+// InputStallTime), this gives the lifecycle of every input batch.
+class InputProfiler {
+ public:
+  static InputProfiler* Get();
+
+  static bool IsEnabled();
+
+  // Registers the device data of an input batch whose upload just completed.
+  void RecordUploaded(
+      const std::vector<xla::ComputationClient::DataPtr>& datas);
+
+  // Accounts the registered device data among the parameters of an execution
+  // being dispatched, and stops tracking them.
+  void RecordConsumed(
+      const std::vector<xla::ComputationClient::DataPtr>& datas);
+
+ private:
+  struct Entry {
+    std::weak_ptr<xla::ComputationClient::Data> data;
+    xla::int64 uploaded_ns = 0;
+  };
+
+  // Drops the entries whose device data has been released without ever being
+  // consumed by an execution. Called with the lock held.
+  void PruneReleased();
+
+  std::mutex lock_;
+  std::unordered_map<const xla::ComputationClient::Data*, Entry> entries_;
+  size_t prune_size_ = 1024;
+};
+
+}  // namespace torch_xla
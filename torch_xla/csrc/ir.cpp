@@ -1,19 +1,57 @@
 #include "torch_xla/csrc/ir.h"
 
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
 #include <functional>
+#include <iterator>
+#include <limits>
+#include <mutex>
 #include <sstream>
+#include <vector>
 
+#include "tensorflow/compiler/xla/shape_util.h"
 #include "tensorflow/compiler/xla/xla_client/cache.h"
 #include "tensorflow/compiler/xla/xla_client/debug_macros.h"
+#include "tensorflow/compiler/xla/xla_client/metrics.h"
 #include "tensorflow/compiler/xla/xla_client/sys_util.h"
 #include "tensorflow/compiler/xla/xla_client/util.h"
+#include "torch_xla/csrc/ir_util.h"
 #include "torch_xla/csrc/lowering_context.h"
+#include "torch_xla/csrc/ops/xla_ops.h"
 
 namespace torch_xla {
 namespace ir {
 namespace {
 
-using ShapeCache = xla::util::Cache<size_t, xla::Shape>;
+using ShapeCache = xla::util::ShardedCache<size_t, xla::Shape>;
+
+const size_t kMaxGraphSizeBound = std::numeric_limits<size_t>::max();
+
+// The policy deciding for which IR nodes the Python frames are captured.
+struct FrameCapturePolicy {
+  // Capture the frames for every node (XLA_IR_DEBUG).
+  bool all = false;
+  // Capture the frames for one in sample_rate nodes, if positive.
+  xla::int64 sample_rate = 0;
+  bool on_miss = false;
+  bool roots = false;
+};
+
+const FrameCapturePolicy& GetFrameCapturePolicy() {
+  static const FrameCapturePolicy* policy = []() {
+    FrameCapturePolicy* policy = new FrameCapturePolicy();
+    policy->all = xla::sys_util::GetEnvBool("XLA_IR_DEBUG", false);
+    policy->sample_rate =
+        xla::sys_util::GetEnvInt("XLA_IR_DEBUG_SAMPLE_RATE", 0);
+    policy->on_miss = xla::sys_util::GetEnvBool("XLA_IR_DEBUG_ON_MISS", false);
+    policy->roots = xla::sys_util::GetEnvBool("XLA_IR_DEBUG_ROOTS", false);
+    return policy;
+  }();
+  return *policy;
+}
+
+std::atomic<bool> g_after_cache_miss(false);
 
 ShapeCache* GetShapeCache() {
   static const size_t kMaxShapeCacheSize = 1024;
@@ -22,9 +60,9 @@ ShapeCache* GetShapeCache() {
 }
 
 void EmitShortFrameInfo(std::ostream& stream,
-                        const std::vector<SourceLocation>& frames) {
-  if (!frames.empty()) {
-    const SourceLocation& frame = frames.front();
+                        const std::vector<SourceLocation>* frames) {
+  if (frames != nullptr && !frames->empty()) {
+    const SourceLocation& frame = frames->front();
     std::string::size_type pos = frame.file.find_last_of('/');
     if (pos == std::string::npos) {
       pos = 0;
@@ -36,8 +74,190 @@ void EmitShortFrameInfo(std::ostream& stream,
   }
 }
 
+// Per-thread free lists of IR node memory blocks, indexed by size class.
+class NodeBlockPool {
+ public:
+  static const size_t kSizeGranularity = alignof(std::max_align_t);
+  static const size_t kMaxPooledSize = 1024;
+  static const size_t kMaxFreeBlocks = 4096;
+
+  ~NodeBlockPool() {
+    destroyed_ = true;
+    for (auto& free_blocks : free_lists_) {
+      for (void* ptr : free_blocks) {
+        ::operator delete(ptr);
+      }
+    }
+  }
+
+  // Returns nullptr if the calling thread is exiting, and its pool has already
+  // been destroyed.
+  static NodeBlockPool* Get() {
+    if (destroyed_) {
+      return nullptr;
+    }
+    thread_local NodeBlockPool pool;
+    return &pool;
+  }
+
+  void* Allocate(size_t size) {
+    if (size > kMaxPooledSize) {
+      return ::operator new(size);
+    }
+    size_t size_class = GetSizeClass(size);
+    std::vector<void*>& free_blocks = free_lists_[size_class];
+    if (free_blocks.empty()) {
+      return ::operator new((size_class + 1) * kSizeGranularity);
+    }
+    void* ptr = free_blocks.back();
+    free_blocks.pop_back();
+    return ptr;
+  }
+
+  void Free(void* ptr, size_t size) {
+    if (size > kMaxPooledSize) {
+      ::operator delete(ptr);
+      return;
+    }
+    std::vector<void*>& free_blocks = free_lists_[GetSizeClass(size)];
+    if (free_blocks.size() < kMaxFreeBlocks) {
+      free_blocks.push_back(ptr);
+    } else {
+      ::operator delete(ptr);
+    }
+  }
+
+ private:
+  static size_t GetSizeClass(size_t size) {
+    return (size + kSizeGranularity - 1) / kSizeGranularity - 1;
+  }
+
+  // Trivially destructible, so it is still accessible while the thread local
+  // objects are being destroyed.
+  static thread_local bool destroyed_;
+
+  std::vector<void*> free_lists_[kMaxPooledSize / kSizeGranularity];
+};
+
+thread_local bool NodeBlockPool::destroyed_ = false;
+
+// Weakly holds the nodes created within the current step, indexed by graph
+// hash, so that equivalent nodes can be shared.
+class NodeInternTable {
+ public:
+  static NodeInternTable* Get() {
+    static NodeInternTable* table = new NodeInternTable(
+        xla::sys_util::GetEnvInt("XLA_IR_INTERN_MAX_NODES", 100000));
+    return table;
+  }
+
+  static bool Enabled() {
+    static const bool enabled =
+        xla::sys_util::GetEnvBool("XLA_IR_INTERN", false);
+    return enabled;
+  }
+
+  NodePtr Intern(NodePtr node) {
+    std::lock_guard<std::mutex> lock(lock_);
+    std::vector<std::weak_ptr<Node>>& bucket = nodes_[node->hash()];
+    for (size_t i = 0; i < bucket.size();) {
+      NodePtr existing = bucket[i].lock();
+      if (existing == nullptr) {
+        bucket[i] = std::move(bucket.back());
+        bucket.pop_back();
+        --num_nodes_;
+      } else if (IsEquivalent(*existing, *node)) {
+        XLA_COUNTER("IrInternedNodes", 1);
+        return existing;
+      } else {
+        ++i;
+      }
+    }
+    if (num_nodes_ >= max_nodes_) {
+      Prune();
+    }
+    // The bucket reference might have been invalidated by Prune().
+    nodes_[node->hash()].emplace_back(node);
+    ++num_nodes_;
+    return node;
+  }
+
+  void Clear() {
+    std::lock_guard<std::mutex> lock(lock_);
+    nodes_.clear();
+    num_nodes_ = 0;
+  }
+
+ private:
+  explicit NodeInternTable(size_t max_nodes) : max_nodes_(max_nodes) {}
+
+  static bool IsEquivalent(const Node& node1, const Node& node2) {
+    return node1.op() == node2.op() && node1.hash() == node2.hash() &&
+           node1.num_outputs() == node2.num_outputs() &&
+           node1.operands() == node2.operands() &&
+           xla::ShapeUtil::Equal(node1.shape(), node2.shape());
+  }
+
+  // Drops the expired entries, and the whole table if it is still full after
+  // that.
+  void Prune() {
+    num_nodes_ = 0;
+    for (auto it = nodes_.begin(); it != nodes_.end();) {
+      auto& bucket = it->second;
+      bucket.erase(std::remove_if(bucket.begin(), bucket.end(),
+                                  [](const std::weak_ptr<Node>& wptr) {
+                                    return wptr.expired();
+                                  }),
+                   bucket.end());
+      num_nodes_ += bucket.size();
+      it = bucket.empty() ? nodes_.erase(it) : std::next(it);
+    }
+    if (num_nodes_ >= max_nodes_) {
+      XLA_COUNTER("IrInternTableResets", 1);
+      nodes_.clear();
+      num_nodes_ = 0;
+    }
+  }
+
+  std::mutex lock_;
+  std::unordered_map<size_t, std::vector<std::weak_ptr<Node>>> nodes_;
+  size_t num_nodes_ = 0;
+  size_t max_nodes_ = 0;
+};
+
+bool IsInternable(const Node* node) {
+  return node->op() != *ops::xla_device_data && !Util::IsRandomOp(node);
+}
+
 }  // namespace
 
+NodePtr InternNode(NodePtr node) {
+  if (!NodeInternTable::Enabled() || !IsInternable(node.get())) {
+    return node;
+  }
+  return NodeInternTable::Get()->Intern(std::move(node));
+}
+
+void ClearInternedNodes() {
+  if (NodeInternTable::Enabled()) {
+    NodeInternTable::Get()->Clear();
+  }
+}
+
+void* AllocateNodeBlock(size_t size) {
+  NodeBlockPool* pool = NodeBlockPool::Get();
+  return pool != nullptr ? pool->Allocate(size) : ::operator new(size);
+}
+
+void FreeNodeBlock(void* ptr, size_t size) {
+  NodeBlockPool* pool = NodeBlockPool::Get();
+  if (pool != nullptr) {
+    pool->Free(ptr, size);
+  } else {
+    ::operator delete(ptr);
+  }
+}
+
 bool Use::operator<(const Use& rhs) const {
   if (node->op() != rhs.node->op()) {
     return node->op() < rhs.node->op();
@@ -86,7 +306,24 @@ OpKind OpKind::Get(const std::string& name) {
   return OpKind(c10::Symbol::fromQualString(name));
 }
 
-size_t OpKind::hash() const { return xla::util::StringHash(op.toQualString()); }
+size_t OpKind::hash() const {
+  // The symbol IDs are small and dense, so the hashes of the qualified names
+  // are memoized in a table indexed by them. A zero entry has not been computed
+  // yet (or the hash is zero, in which case it is simply computed every time).
+  static const size_t kMaxInternedSymbols = 16 * 1024;
+  static std::atomic<size_t>* hashes =
+      new std::atomic<size_t>[kMaxInternedSymbols]();
+  size_t id = static_cast<size_t>(c10::unique_t(op));
+  if (id >= kMaxInternedSymbols) {
+    return xla::util::StringHash(op.toQualString());
+  }
+  size_t hash = hashes[id].load(std::memory_order_relaxed);
+  if (hash == 0) {
+    hash = xla::util::StringHash(op.toQualString());
+    hashes[id].store(hash, std::memory_order_relaxed);
+  }
+  return hash;
+}
 
 Node::Node(OpKind op, OpList operands, xla::Shape shape, size_t num_outputs,
            size_t hash_seed)
@@ -99,6 +336,10 @@ Node::Node(OpKind op, OpList operands, xla::Shape shape, size_t num_outputs,
   for (auto& operand : operands) {
     AddOperand(operand.node, operand.index);
     hash_ = xla::util::HashCombine(hash_, operand.hash());
+    size_t operand_size = operand.node->graph_size_bound();
+    graph_size_bound_ = operand_size < kMaxGraphSizeBound - graph_size_bound_
+                            ? graph_size_bound_ + operand_size
+                            : kMaxGraphSizeBound;
   }
 }
 
@@ -134,6 +375,24 @@ const xla::Shape& Node::shape(size_t output_index) const {
   return shape_;
 }
 
+void Node::AddUse(Use use) {
+  auto it = std::lower_bound(uses_.begin(), uses_.end(), use);
+  if (it == uses_.end() || use < *it) {
+    uses_.insert(it, std::move(use));
+  }
+}
+
+void Node::RemoveUse(const Use& use) {
+  auto it = std::lower_bound(uses_.begin(), uses_.end(), use);
+  if (it != uses_.end() && !(use < *it)) {
+    uses_.erase(it);
+  }
+}
+
+Value Node::operand_value(size_t i) const {
+  return Value(operands_.at(i), operands_as_outputs_.at(i).index);
+}
+
 void Node::AddOperand(NodePtr node, size_t index) {
   XLA_CHECK_LT(index, node->num_outputs());
   operands_.push_back(std::move(node));
@@ -209,12 +468,39 @@ xla::Shape Node::GetOpShape(const std::function<xla::Shape()>& shape_fn) const {
   return *shape;
 }
 
-std::vector<SourceLocation> Node::GetFrameInfo() {
+void Node::SetFrameInfo(const std::vector<SourceLocation>* frames) {
+  if (metadata_.frame_info == nullptr) {
+    metadata_.frame_info = frames;
+  }
+}
+
+bool Node::CaptureRootFrames() { return GetFrameCapturePolicy().roots; }
+
+void Node::NotifyGraphCacheLookup(bool hit) {
+  if (GetFrameCapturePolicy().on_miss) {
+    g_after_cache_miss.store(!hit, std::memory_order_relaxed);
+  }
+}
+
+const std::vector<SourceLocation>* Node::GetFrameInfo() {
   // At the time of writing, retrieving Python frames costs from 1us up to 20us.
   // This per IR Node. Since it is not unreasonable to have a many hundreds of
   // IR Node, this can be a multi-millisecond cost, which is not negligible.
-  static bool wants_frames = xla::sys_util::GetEnvBool("XLA_IR_DEBUG", false);
-  return wants_frames ? GetPythonFrames() : std::vector<SourceLocation>();
+  // Sampling a fraction of the nodes keeps the cost down while still giving
+  // the provenance of most graphs.
+  const FrameCapturePolicy& policy = GetFrameCapturePolicy();
+  bool capture =
+      policy.all ||
+      (policy.on_miss && g_after_cache_miss.load(std::memory_order_relaxed));
+  if (!capture && policy.sample_rate > 0) {
+    static thread_local xla::int64 node_count = 0;
+    capture = ++node_count % policy.sample_rate == 0;
+  }
+  if (!capture) {
+    return nullptr;
+  }
+  XLA_COUNTER("IrFrameCaptures", 1);
+  return InternFrames(GetPythonFrames());
 }
 
 }  // namespace ir
@@ -2,6 +2,7 @@
 
 #include <ATen/core/interned_strings.h>
 
+#include <cstddef>
 #include <functional>
 #include <iostream>
 #include <memory>
@@ -27,6 +28,43 @@ using NodePtr = std::shared_ptr<Node>;
 
 using XlaOpVector = tensorflow::gtl::InlinedVector<xla::XlaOp, 1>;
 
+// Allocates a memory block of the given size for an IR node, possibly
+// recycling one which has been previously released with FreeNodeBlock().
+void* AllocateNodeBlock(size_t size);
+
+void FreeNodeBlock(void* ptr, size_t size);
+
+// IR nodes are created and destroyed in large numbers at every step, so their
+// memory blocks (which, when using std::allocate_shared(), include the
+// shared_ptr control block) are recycled through per-thread free lists instead
+// of going through the heap every time. Since the blocks are not tied to a
+// step lifetime, IR nodes can freely outlive the step which created them.
+template <typename T>
+struct NodeAllocator {
+  using value_type = T;
+
+  NodeAllocator() = default;
+  template <typename U>
+  NodeAllocator(const NodeAllocator<U>&) {}
+
+  T* allocate(size_t n) {
+    static_assert(alignof(T) <= alignof(std::max_align_t),
+                  "Over-aligned IR node types are not supported");
+    return static_cast<T*>(AllocateNodeBlock(n * sizeof(T)));
+  }
+
+  void deallocate(T* ptr, size_t n) { FreeNodeBlock(ptr, n * sizeof(T)); }
+
+  template <typename U>
+  bool operator==(const NodeAllocator<U>&) const {
+    return true;
+  }
+  template <typename U>
+  bool operator!=(const NodeAllocator<U>&) const {
+    return false;
+  }
+};
+
 // The base class for user defined metadata which is possible to attach to IR
 // nodes.
 struct UserMetaData {
@@ -34,7 +72,9 @@ struct UserMetaData {
 };
 
 struct MetaData {
-  std::vector<SourceLocation> frame_info;
+  // The interned Python frames captured at the node creation, or nullptr if
+  // the frame capture policy skipped the node.
+  const std::vector<SourceLocation>* frame_info = nullptr;
 };
 
 // Represents a use of the output of a given node.
@@ -62,6 +102,8 @@ inline std::ostream& operator<<(std::ostream& stream, const Use& use) {
   return stream;
 }
 
+using UseVector = tensorflow::gtl::InlinedVector<Use, 1>;
+
 // Represents a specific output produced by a node. Since the output of a node
 // can be composed by multiple outputs, the node+index coordinates fully qualify
 // each single output.
@@ -103,6 +145,8 @@ inline std::ostream& operator<<(std::ostream& stream, const Output& output) {
 
 using OutputSet = std::unordered_set<Output, Output::Hasher>;
 
+using OutputVector = tensorflow::gtl::InlinedVector<Output, 2>;
+
 template <typename T>
 using OutputMap = std::unordered_map<Output, T, Output::Hasher>;
 
@@ -196,18 +240,42 @@ class Node {
   // multi-output node, output_index must be zero.
   const xla::Shape& shape(size_t output_index) const;
 
-  const std::vector<Output>& operands() const { return operands_as_outputs_; }
+  const OutputVector& operands() const { return operands_as_outputs_; }
 
   const Output& operand(size_t i) const { return operands_as_outputs_.at(i); }
 
-  const std::set<Use>& uses() const { return uses_; }
+  // Retrieves the i-th operand as a Value, which holds a reference to the
+  // operand node.
+  Value operand_value(size_t i) const;
+
+  // The uses of this node, sorted according to the Use ordering.
+  const UseVector& uses() const { return uses_; }
 
   size_t node_hash() const { return node_hash_; }
 
   size_t hash() const { return hash_; }
 
+  // Retrieves an upper bound of the number of nodes within the graph rooted at
+  // this node, computed at construction time. Nodes reachable via multiple
+  // paths are accounted multiple times, so the exact size can be much smaller
+  // than this value, but never bigger (unless the graph is mutated after
+  // construction, via the ReplaceOperand() API).
+  size_t graph_size_bound() const { return graph_size_bound_; }
+
   const MetaData& metadata() const { return metadata_; }
 
+  // Attaches the frames to the node, unless it already has its own.
+  void SetFrameInfo(const std::vector<SourceLocation>* frames);
+
+  // Whether the frames should be captured for the roots of the graphs being
+  // synced (XLA_IR_DEBUG_ROOTS).
+  static bool CaptureRootFrames();
+
+  // Records the outcome of a graph cache lookup. With XLA_IR_DEBUG_ON_MISS,
+  // frames are captured for all the nodes created after a cache miss, up to the
+  // next cache hit.
+  static void NotifyGraphCacheLookup(bool hit);
+
   template <typename T>
   T* user_metadata() const {
     return dynamic_cast<T*>(user_metadata_.get());
@@ -240,31 +308,34 @@ class Node {
   // Adds node's index output number as operand.
   void AddOperand(NodePtr node, size_t index = 0);
 
-  void AddUse(Use use) { uses_.insert(std::move(use)); }
+  void AddUse(Use use);
 
-  void RemoveUse(const Use& use) { uses_.erase(use); }
+  void RemoveUse(const Use& use);
 
   xla::Shape GetOpShape(const std::function<xla::Shape()>& shape_fn) const;
 
   static size_t GetOpHash(OpKind op, const xla::Shape& shape, size_t hash_seed);
 
-  static std::vector<SourceLocation> GetFrameInfo();
+  static const std::vector<SourceLocation>* GetFrameInfo();
 
   // The ID of the operation captured by this node.
   OpKind op_;
   size_t num_outputs_ = 1;
   xla::Shape shape_;
   // A node holds a real reference to its operands.
-  std::vector<NodePtr> operands_;
+  tensorflow::gtl::InlinedVector<NodePtr, 2> operands_;
   // Outputs do not hold references on the nodes, and neither do the uses, since
   // otherwise we get into circular reference counting.
-  std::vector<Output> operands_as_outputs_;
-  // We use a set for uses, as we want deterministic use sequencing.
-  std::set<Use> uses_;
+  OutputVector operands_as_outputs_;
+  // Uses are kept sorted (with set semantics), as we want deterministic use
+  // sequencing.
+  UseVector uses_;
   // The hash value of this node.
   size_t node_hash_ = 0;
   // The hash value of the graph rooted at this node.
   size_t hash_ = 0;
+  // The (saturated) upper bound of the size of the graph rooted at this node.
+  size_t graph_size_bound_ = 1;
   // The IR specific metadata attached to the IR node.
   MetaData metadata_;
   // The IR framework user can attach a user defined metadata object deriving
@@ -277,9 +348,20 @@ inline std::ostream& operator<<(std::ostream& stream, const Node& node) {
   return stream;
 }
 
+// If node interning is enabled (XLA_IR_INTERN), returns an existing node
+// equivalent to the given one (same op, graph hash, shape and operands), which
+// has been created since the last ClearInternedNodes() call. Otherwise, or if
+// no such node exists, returns the given node. Device data and random number
+// generating nodes are never interned.
+NodePtr InternNode(NodePtr node);
+
+// Drops all the nodes from the interning table. Called at step boundaries.
+void ClearInternedNodes();
+
 template <typename T, typename... Args>
 NodePtr MakeNode(Args&&... args) {
-  return std::make_shared<T>(std::forward<Args>(args)...);
+  return InternNode(std::allocate_shared<T>(NodeAllocator<T>(),
+                                            std::forward<Args>(args)...));
 }
 
 }  // namespace ir
@@ -0,0 +1,347 @@
+#include "torch_xla/csrc/ir_capture.h"
+
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <memory>
+#include <sstream>
+#include <unordered_map>
+
+#include "absl/strings/str_cat.h"
+#include "tensorflow/compiler/xla/xla_client/computation_client.h"
+#include "tensorflow/compiler/xla/xla_client/debug_macros.h"
+#include "tensorflow/compiler/xla/xla_client/metrics.h"
+#include "tensorflow/compiler/xla/xla_client/sys_util.h"
+#include "tensorflow/compiler/xla/xla_client/util.h"
+#include "tensorflow/compiler/xla/xla_client/xla_util.h"
+#include "torch_xla/csrc/helpers.h"
+#include "torch_xla/csrc/ir_util.h"
+#include "torch_xla/csrc/lowering_context.h"
+#include "torch_xla/csrc/ops/device_data.h"
+#include "torch_xla/csrc/ops/ops.h"
+#include "torch_xla/csrc/tensor_util.h"
+
+namespace torch_xla {
+namespace ir {
+namespace {
+
+// The capture starts with the magic, followed by the computations (each one a
+// serialized xla::HloModuleProto), the nodes in post-order, and the roots.
+// Every node is made of its kind, its attributes, its serialized
+// xla::ShapeProto, its number of outputs, the index of its computation (or
+// kParameter for the device data), and its operands. The operands and the
+// roots are (node index, output index) pairs. All the integers are 64 bit, in
+// host byte order.
+const size_t kMagicSize = 8;
+const char kMagic[kMagicSize] = {'X', 'L', 'A', 'I', 'R', 'C', 'P', '1'};
+const xla::uint64 kParameter = std::numeric_limits<xla::uint64>::max();
+
+void AppendUint64(xla::uint64 value, std::string* data) {
+  data->append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+void AppendString(const std::string& value, std::string* data) {
+  AppendUint64(value.size(), data);
+  data->append(value);
+}
+
+class Reader {
+ public:
+  explicit Reader(const std::string& data) : data_(data) {}
+
+  const char* Read(size_t size) {
+    XLA_CHECK_LE(size, data_.size() - offset_) << "Truncated IR capture";
+    const char* ptr = data_.data() + offset_;
+    offset_ += size;
+    return ptr;
+  }
+
+  xla::uint64 ReadUint64() {
+    xla::uint64 value;
+    std::memcpy(&value, Read(sizeof(value)), sizeof(value));
+    return value;
+  }
+
+  std::string ReadString() {
+    size_t size = ReadUint64();
+    return std::string(Read(size), size);
+  }
+
+ private:
+  const std::string& data_;
+  size_t offset_ = 0;
+};
+
+// Lowers the node alone, as a computation taking its operands as parameters,
+// and returning the tuple of its outputs.
+std::string LowerNodeComputation(const Node* node) {
+  LoweringContext lowering_ctx("IrCaptureNode");
+  for (size_t i = 0; i < node->operands().size(); ++i) {
+    const Output& operand = node->operands()[i];
+    lowering_ctx.AssignOutputOp(
+        operand, xla::Parameter(lowering_ctx.builder(), i, operand.shape(),
+                                absl::StrCat("p", i)));
+  }
+  XlaOpVector ops = lowering_ctx.LowerNode(node);
+  XLA_CHECK(lowering_ctx.GetParametersData().empty())
+      << "The IR node reads device data it does not have as operand, and "
+         "cannot be captured: "
+      << node->ToString();
+  xla::XlaComputation computation = ConsumeValue(lowering_ctx.Build(
+      xla::Tuple(lowering_ctx.builder(),
+                 std::vector<xla::XlaOp>(ops.begin(), ops.end()))));
+  return computation.proto().SerializeAsString();
+}
+
+// The nodes with the same key lower to the same computation, so they share
+// it within the capture.
+size_t ComputeNodeKey(const Node* node) {
+  size_t key = xla::util::ShapeHash(node->shape());
+  for (auto& operand : node->operands()) {
+    key = xla::util::HashCombine(key, xla::util::ShapeHash(operand.shape()));
+  }
+  return xla::util::HashCombine(key, node->node_hash());
+}
+
+NodePtr MakeReplayNode(const std::string& kind, xla::Shape shape,
+                       size_t num_outputs, std::vector<Value> operands,
+                       std::shared_ptr<xla::XlaComputation> computation,
+                       size_t computation_hash) {
+  auto lower_fn = [computation, num_outputs](
+                      const Node& node, LoweringContext* loctx) -> XlaOpVector {
+    std::vector<xla::XlaOp> inputs;
+    for (auto& operand : node.operands()) {
+      inputs.push_back(loctx->GetOutputOp(operand));
+    }
+    xla::XlaOp call = xla::Call(loctx->builder(), *computation, inputs);
+    std::vector<xla::XlaOp> outputs;
+    for (size_t i = 0; i < num_outputs; ++i) {
+      outputs.push_back(xla::GetTupleElement(call, i));
+    }
+    return node.ReturnOps(outputs, loctx);
+  };
+  return ops::GenericOp(OpKind::Get(kind), operands, std::move(shape),
+                        std::move(lower_fn), num_outputs, computation_hash);
+}
+
+std::vector<xla::ComputationClient::DataPtr> CreateSyntheticData(
+    const std::vector<xla::Shape>& shapes, const Device& device) {
+  std::vector<xla::ComputationClient::TensorSource> sources;
+  for (auto& shape : shapes) {
+    sources.emplace_back(shape, device.ToString(),
+                         [](const xla::ComputationClient::TensorSource&,
+                            void* buffer, size_t size) {
+                           std::memset(buffer, 0, size);
+                         });
+  }
+  return xla::ComputationClient::Get()->TransferToServer(sources);
+}
+
+double ElapsedMs(xla::int64 start_ns) {
+  return (xla::sys_util::NowNs() - start_ns) / 1.0e6;
+}
+
+}  // namespace
+
+std::string IrCapture::Serialize(
+    tensorflow::gtl::ArraySlice<const Value> roots) {
+  XLA_TIMED("IrCaptureSerialize");
+  std::vector<const Node*> root_nodes;
+  for (auto& root : roots) {
+    root_nodes.push_back(root.node.get());
+  }
+  std::vector<const Node*> post_order = Util::ComputePostOrder(root_nodes);
+  std::unordered_map<const Node*, size_t> node_indices;
+  std::vector<std::string> computations;
+  std::unordered_map<size_t, size_t> computation_indices;
+  std::string nodes_data;
+  for (auto node : post_order) {
+    node_indices.emplace(node, node_indices.size());
+    xla::uint64 computation_index = kParameter;
+    if (dynamic_cast<const ops::DeviceData*>(node) == nullptr) {
+      size_t key = ComputeNodeKey(node);
+      auto it = computation_indices.find(key);
+      if (it == computation_indices.end()) {
+        it = computation_indices.emplace(key, computations.size()).first;
+        computations.push_back(LowerNodeComputation(node));
+      }
+      computation_index = it->second;
+    }
+    AppendString(node->op().ToString(), &nodes_data);
+    AppendString(node->ToString(), &nodes_data);
+    AppendString(node->shape().ToProto().SerializeAsString(), &nodes_data);
+    AppendUint64(node->num_outputs(), &nodes_data);
+    AppendUint64(computation_index, &nodes_data);
+    AppendUint64(node->operands().size(), &nodes_data);
+    for (auto& operand : node->operands()) {
+      AppendUint64(node_indices.at(operand.node), &nodes_data);
+      AppendUint64(operand.index, &nodes_data);
+    }
+  }
+  std::string data(kMagic, kMagicSize);
+  AppendUint64(computations.size(), &data);
+  for (auto& computation : computations) {
+    AppendString(computation, &data);
+  }
+  AppendUint64(post_order.size(), &data);
+  data.append(nodes_data);
+  AppendUint64(roots.size(), &data);
+  for (auto& root : roots) {
+    AppendUint64(node_indices.at(root.node.get()), &data);
+    AppendUint64(root.index, &data);
+  }
+  XLA_COUNTER("IrCaptureNodes", post_order.size());
+  return data;
+}
+
+std::vector<Value> IrCapture::Deserialize(const std::string& data,
+                                          const Device& device) {
+  XLA_TIMED("IrCaptureDeserialize");
+  Reader reader(data);
+  XLA_CHECK_EQ(std::memcmp(reader.Read(kMagicSize), kMagic, kMagicSize), 0)
+      << "Not an IR capture";
+  std::vector<std::shared_ptr<xla::XlaComputation>> computations(
+      reader.ReadUint64());
+  std::vector<size_t> computation_hashes;
+  for (auto& computation : computations) {
+    std::string proto_data = reader.ReadString();
+    xla::HloModuleProto module_proto;
+    XLA_CHECK(module_proto.ParseFromString(proto_data))
+        << "Corrupted IR capture";
+    computation =
+        std::make_shared<xla::XlaComputation>(std::move(module_proto));
+    computation_hashes.push_back(xla::util::Hash(proto_data));
+  }
+
+  struct NodeRecord {
+    std::string kind;
+    xla::Shape shape;
+    size_t num_outputs = 0;
+    xla::uint64 computation_index = kParameter;
+    std::vector<std::pair<size_t, size_t>> operands;
+  };
+  std::vector<NodeRecord> records(reader.ReadUint64());
+  std::vector<xla::Shape> parameter_shapes;
+  for (auto& record : records) {
+    record.kind = reader.ReadString();
+    // The attributes are informative only, the captured lowering carries them.
+    reader.ReadString();
+    xla::ShapeProto shape_proto;
+    XLA_CHECK(shape_proto.ParseFromString(reader.ReadString()))
+        << "Corrupted IR capture";
+    record.shape = xla::Shape(shape_proto);
+    record.num_outputs = reader.ReadUint64();
+    record.computation_index = reader.ReadUint64();
+    XLA_CHECK(record.computation_index == kParameter ||
+              record.computation_index < computations.size())
+        << "Corrupted IR capture";
+    record.operands.resize(reader.ReadUint64());
+    for (auto& operand : record.operands) {
+      operand.first = reader.ReadUint64();
+      operand.second = reader.ReadUint64();
+    }
+    if (record.computation_index == kParameter) {
+      parameter_shapes.push_back(record.shape);
+    }
+  }
+  std::vector<xla::ComputationClient::DataPtr> parameters_data =
+      CreateSyntheticData(parameter_shapes, device);
+
+  std::vector<NodePtr> nodes;
+  nodes.reserve(records.size());
+  size_t parameter_index = 0;
+  for (auto& record : records) {
+    if (record.computation_index == kParameter) {
+      nodes.push_back(
+          MakeNode<ops::DeviceData>(parameters_data[parameter_index++]));
+      continue;
+    }
+    std::vector<Value> operands;
+    for (auto& operand : record.operands) {
+      XLA_CHECK_LT(operand.first, nodes.size()) << "Corrupted IR capture";
+      operands.emplace_back(nodes[operand.first], operand.second);
+    }
+    nodes.push_back(MakeReplayNode(
+        record.kind, std::move(record.shape), record.num_outputs,
+        std::move(operands), computations[record.computation_index],
+        computation_hashes[record.computation_index]));
+  }
+  std::vector<Value> roots(reader.ReadUint64());
+  for (auto& root : roots) {
+    size_t node_index = reader.ReadUint64();
+    XLA_CHECK_LT(node_index, nodes.size()) << "Corrupted IR capture";
+    root = Value(nodes[node_index], reader.ReadUint64());
+  }
+  return roots;
+}
+
+void IrCapture::Save(tensorflow::gtl::ArraySlice<const Value> roots,
+                     const std::string& path) {
+  std::string data = Serialize(roots);
+  std::ofstream file(path, std::ios::binary | std::ios::trunc);
+  XLA_CHECK(file) << "Unable to create IR capture " << path;
+  file.write(data.data(), data.size());
+  XLA_CHECK(file) << "Unable to write IR capture " << path;
+}
+
+IrCapture::ReplayStats IrCapture::Replay(const std::string& path,
+                                         const Device& device,
+                                         size_t iterations) {
+  std::ifstream file(path, std::ios::binary);
+  XLA_CHECK(file) << "Unable to open IR capture " << path;
+  std::stringstream buffer;
+  buffer << file.rdbuf();
+  std::vector<Value> roots = Deserialize(buffer.str(), device);
+
+  ReplayStats stats;
+  xla::int64 start_ns = xla::sys_util::NowNs();
+  LoweringContext lowering_ctx("IrReplay");
+  for (auto& root : roots) {
+    lowering_ctx.AddResult(lowering_ctx.GetOutputOp(root));
+  }
+  xla::XlaComputation computation = ConsumeValue(lowering_ctx.Build());
+  stats.lowering_ms = ElapsedMs(start_ns);
+  std::vector<const Node*> root_nodes;
+  for (auto& root : roots) {
+    root_nodes.push_back(root.node.get());
+  }
+  stats.num_nodes = Util::ComputePostOrder(root_nodes).size();
+  std::vector<xla::ComputationClient::DataPtr> parameters_data =
+      lowering_ctx.GetParametersData();
+  stats.num_parameters = parameters_data.size();
+
+  xla::ProgramShape program_shape = ConsumeValue(computation.GetProgramShape());
+  xla::Shape shape =
+      MakeShapeWithDeviceLayout(program_shape.result(), device.hw_type);
+  xla::ComputationClient* client = xla::ComputationClient::Get();
+  std::vector<xla::ComputationClient::CompileInstance> instances;
+  instances.push_back(
+      {std::move(computation), device.ToString(),
+       client->GetCompilationDevices(device.ToString(), {}), &shape});
+  start_ns = xla::sys_util::NowNs();
+  std::vector<std::shared_ptr<xla::ComputationClient::Computation>>
+      computations = client->Compile(std::move(instances));
+  stats.compile_ms = ElapsedMs(start_ns);
+
+  for (size_t i = 0; i < iterations; ++i) {
+    start_ns = xla::sys_util::NowNs();
+    std::vector<xla::ComputationClient::DataPtr> results =
+        client->ExecuteComputation(*computations.front(), parameters_data,
+                                   device.ToString(), {});
+    for (auto& result : results) {
+      result->WaitValue();
+    }
+    stats.execute_ms.push_back(ElapsedMs(start_ns));
+    if (i + 1 == iterations) {
+      for (auto& result : results) {
+        stats.output_sizes.push_back(
+            xla::util::ToVector<xla::int64>(result->shape().dimensions()));
+      }
+    }
+  }
+  XLA_COUNTER("IrCaptureReplays", 1);
+  return stats;
+}
+
+}  // namespace ir
+}  // namespace torch_xla
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "tensorflow/core/lib/gtl/array_slice.h"
+#include "torch_xla/csrc/device.h"
+#include "torch_xla/csrc/ir.h"
+
+namespace torch_xla {
+namespace ir {
+
+// Captures IR graphs into a compact binary format, which can be replayed
+// offline, without the model and the data which produced them.
+// Every node of the graph is stored with its kind, attributes (as the node
+// ToString() text), shape and operands, together with its own lowering, as a
+// standalone XLA computation of its operands, which is shared by all the
+// nodes lowering to the same computation. The device data nodes are stored as
+// parameters, with their shapes only.
+// The replayed graph is made of generic nodes invoking the captured lowerings,
+// fed by synthetic (zero filled) device data, so it goes through the same IR
+// hashing, LoweringContext, compilation and execution paths a traced graph
+// does.
+class IrCapture {
+ public:
+  struct ReplayStats {
+    size_t num_nodes = 0;
+    size_t num_parameters = 0;
+    double lowering_ms = 0;
+    double compile_ms = 0;
+    // The execution timings of every iteration.
+    std::vector<double> execute_ms;
+    // The sizes of the results of the replayed graph, one per root.
+    std::vector<std::vector<xla::int64>> output_sizes;
+  };
+
+  static std::string Serialize(tensorflow::gtl::ArraySlice<const Value> roots);
+
+  // Rebuilds the roots of a serialized graph, with the parameters bound to
+  // synthetic device data allocated on the given device.
+  static std::vector<Value> Deserialize(const std::string& data,
+                                        const Device& device);
+
+  static void Save(tensorflow::gtl::ArraySlice<const Value> roots,
+                   const std::string& path);
+
+  // Loads the graph saved by Save(), then lowers, compiles and executes it
+  // the given number of times on the device, and returns the timings.
+  static ReplayStats Replay(const std::string& path, const Device& device,
+                            size_t iterations);
+};
+
+}  // namespace ir
+}  // namespace torch_xla
@@ -0,0 +1,200 @@
+#include "torch_xla/csrc/ir_optimizer.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <type_traits>
+
+#include "tensorflow/compiler/xla/shape_util.h"
+#include "tensorflow/compiler/xla/xla_client/sys_util.h"
+#include "tensorflow/compiler/xla/xla_client/util.h"
+#include "torch_xla/csrc/ir_util.h"
+#include "torch_xla/csrc/ops/device_data.h"
+#include "torch_xla/csrc/ops/scalar.h"
+
+namespace torch_xla {
+namespace ir {
+namespace {
+
+bool IsMergeable(const Node* node) {
+  return dynamic_cast<const ops::DeviceData*>(node) == nullptr &&
+         !Util::IsRandomOp(node);
+}
+
+bool ScalarValuesEqual(const ops::Scalar* scalar1,
+                       const ops::Scalar* scalar2) {
+  const at::Scalar& value1 = scalar1->value();
+  const at::Scalar& value2 = scalar2->value();
+  if (value1.isFloatingPoint() != value2.isFloatingPoint()) {
+    return false;
+  }
+  return value1.isFloatingPoint() ? value1.toDouble() == value2.toDouble()
+                                  : value1.toLong() == value2.toLong();
+}
+
+// Folds the binary arithmetic operation using the T type, which must match
+// the one the XLA computation would be using.
+template <typename T>
+bool FoldBinaryOp(const c10::Symbol& op, T value1, T value2, T* result) {
+  if (op == at::aten::add) {
+    *result = value1 + value2;
+  } else if (op == at::aten::sub) {
+    *result = value1 - value2;
+  } else if (op == at::aten::mul) {
+    *result = value1 * value2;
+  } else if (op == at::aten::div && std::is_floating_point<T>::value) {
+    *result = value1 / value2;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+}  // namespace
+
+Optimizer::Optimizer(
+    tensorflow::gtl::ArraySlice<const Node* const> post_order) {
+  std::unordered_map<size_t, std::vector<const Node*>> canonical_nodes;
+  for (auto node : post_order) {
+    const Node* target = node;
+    NodePtr folded_node = FoldScalarOp(node);
+    if (folded_node != nullptr) {
+      target = folded_node.get();
+      replacements_[node] = target;
+      folded_nodes_.push_back(std::move(folded_node));
+      ++num_folded_;
+    }
+    if (!IsMergeable(target)) {
+      continue;
+    }
+    auto& candidates = canonical_nodes[GetNodeKey(target)];
+    auto it = std::find_if(candidates.begin(), candidates.end(),
+                           [&](const Node* candidate) {
+                             return IsEquivalent(target, candidate);
+                           });
+    if (it != candidates.end()) {
+      replacements_[node] = *it;
+      ++num_merged_;
+    } else {
+      candidates.push_back(target);
+    }
+  }
+}
+
+const Node* Optimizer::GetReplacement(const Node* node) const {
+  auto it = replacements_.find(node);
+  return it != replacements_.end() ? it->second : nullptr;
+}
+
+bool Optimizer::Enabled() {
+  static const bool enabled =
+      xla::sys_util::GetEnvBool("XLA_IR_OPTIMIZE", true);
+  return enabled;
+}
+
+Output Optimizer::GetCanonicalOutput(const Output& output) const {
+  const Node* replacement = GetReplacement(output.node);
+  return replacement != nullptr ? Output(replacement, output.index) : output;
+}
+
+bool Optimizer::IsEquivalent(const Node* node1, const Node* node2) const {
+  if (node1->op() != node2->op() || node1->node_hash() != node2->node_hash() ||
+      node1->num_outputs() != node2->num_outputs() ||
+      node1->operands().size() != node2->operands().size() ||
+      !xla::ShapeUtil::Equal(node1->shape(), node2->shape())) {
+    return false;
+  }
+  for (size_t i = 0; i < node1->operands().size(); ++i) {
+    if (GetCanonicalOutput(node1->operand(i)) !=
+        GetCanonicalOutput(node2->operand(i))) {
+      return false;
+    }
+  }
+  const ops::Scalar* scalar1 = dynamic_cast<const ops::Scalar*>(node1);
+  const ops::Scalar* scalar2 = dynamic_cast<const ops::Scalar*>(node2);
+  if (scalar1 != nullptr || scalar2 != nullptr) {
+    return scalar1 != nullptr && scalar2 != nullptr &&
+           ScalarValuesEqual(scalar1, scalar2);
+  }
+  return true;
+}
+
+size_t Optimizer::GetNodeKey(const Node* node) const {
+  size_t key = node->node_hash();
+  for (auto& operand : node->operands()) {
+    Output output = GetCanonicalOutput(operand);
+    key = xla::util::HashCombine(
+        key, xla::util::HashCombine(
+                 reinterpret_cast<std::uintptr_t>(output.node), output.index));
+  }
+  return key;
+}
+
+NodePtr Optimizer::FoldScalarOp(const Node* node) const {
+  const c10::Symbol& op = node->op().op;
+  if ((op != at::aten::add && op != at::aten::sub && op != at::aten::mul &&
+       op != at::aten::div) ||
+      node->operands().size() != 2) {
+    return nullptr;
+  }
+  const ops::Scalar* scalars[2];
+  for (size_t i = 0; i < 2; ++i) {
+    Output operand = GetCanonicalOutput(node->operand(i));
+    scalars[i] = dynamic_cast<const ops::Scalar*>(operand.node);
+    // Operands with a different shape would need a type promotion, which is
+    // left to the lowering code.
+    if (scalars[i] == nullptr ||
+        !xla::ShapeUtil::Equal(scalars[i]->shape(), node->shape())) {
+      return nullptr;
+    }
+  }
+  const at::Scalar& value1 = scalars[0]->value();
+  const at::Scalar& value2 = scalars[1]->value();
+  switch (node->shape().element_type()) {
+    case xla::F32: {
+      float result;
+      if (FoldBinaryOp<float>(op, static_cast<float>(value1.toDouble()),
+                              static_cast<float>(value2.toDouble()),
+                              &result)) {
+        return MakeNode<ops::Scalar>(static_cast<double>(result),
+                                     node->shape());
+      }
+      break;
+    }
+    case xla::F64: {
+      double result;
+      if (FoldBinaryOp<double>(op, value1.toDouble(), value2.toDouble(),
+                               &result)) {
+        return MakeNode<ops::Scalar>(result, node->shape());
+      }
+      break;
+    }
+    case xla::S32: {
+      // Use unsigned arithmetic to get the same wrapping behavior of XLA.
+      uint32_t result;
+      if (FoldBinaryOp<uint32_t>(
+              op, static_cast<uint32_t>(static_cast<int32_t>(value1.toInt())),
+              static_cast<uint32_t>(static_cast<int32_t>(value2.toInt())),
+              &result)) {
+        return MakeNode<ops::Scalar>(
+            static_cast<int64_t>(static_cast<int32_t>(result)), node->shape());
+      }
+      break;
+    }
+    case xla::S64: {
+      uint64_t result;
+      if (FoldBinaryOp<uint64_t>(op, static_cast<uint64_t>(value1.toLong()),
+                                 static_cast<uint64_t>(value2.toLong()),
+                                 &result)) {
+        return MakeNode<ops::Scalar>(static_cast<int64_t>(result),
+                                     node->shape());
+      }
+      break;
+    }
+    default:
+      break;
+  }
+  return nullptr;
+}
+
+}  // namespace ir
+}  // namespace torch_xla
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <unordered_map>
+#include <vector>
+
+#include "tensorflow/core/lib/gtl/array_slice.h"
+#include "torch_xla/csrc/ir.h"
+
+namespace torch_xla {
+namespace ir {
+
+// Runs simple optimizations over an IR graph post-order, whose results are
+// applied by the LoweringContext while lowering it:
+// - Common subexpression elimination: nodes with the same node hash, shape
+//   and (already deduplicated) operands are lowered only once. Device data
+//   and random number generating nodes are never merged.
+// - Folding of arithmetic operations whose operands are both scalar constants
+//   (ir::ops::Scalar nodes), which get replaced by a single scalar constant.
+// The IR graph itself is not modified.
+class Optimizer {
+ public:
+  explicit Optimizer(tensorflow::gtl::ArraySlice<const Node* const> post_order);
+
+  // Returns the node whose outputs replace the ones of the given node, or
+  // nullptr if the node has to be lowered as is. A replacement node is either
+  // a node which comes earlier within the post-order, or a folded scalar
+  // constant node owned by this object.
+  const Node* GetReplacement(const Node* node) const;
+
+  size_t num_merged() const { return num_merged_; }
+
+  size_t num_folded() const { return num_folded_; }
+
+  // Whether the IR optimizations should be run before lowering the graphs
+  // (XLA_IR_OPTIMIZE).
+  static bool Enabled();
+
+ private:
+  Output GetCanonicalOutput(const Output& output) const;
+
+  bool IsEquivalent(const Node* node1, const Node* node2) const;
+
+  size_t GetNodeKey(const Node* node) const;
+
+  // Returns the folded scalar node for the given node, or nullptr if the node
+  // cannot be folded.
+  NodePtr FoldScalarOp(const Node* node) const;
+
+  std::unordered_map<const Node*, const Node*> replacements_;
+  std::vector<NodePtr> folded_nodes_;
+  size_t num_merged_ = 0;
+  size_t num_folded_ = 0;
+};
+
+}  // namespace ir
+}  // namespace torch_xla
@@ -1,5 +1,8 @@
 #include "torch_xla/csrc/ir_util.h"
 
+#include <algorithm>
+
+#include "tensorflow/compiler/xla/shape_util.h"
 #include "tensorflow/compiler/xla/xla_client/debug_macros.h"
 
 namespace torch_xla {
@@ -90,11 +93,152 @@ std::vector<Value> Util::Clone(
   return Clone(values, post_order);
 }
 
+bool Util::IsRandomOp(const Node* node) {
+  const c10::Symbol& op = node->op().op;
+  return op == at::aten::bernoulli || op == at::aten::dropout ||
+         op == at::aten::randperm || op == at::aten::rrelu_with_noise;
+}
+
 size_t Util::GetGraphSize(
     tensorflow::gtl::ArraySlice<const Node* const> nodes) {
   std::vector<const Node*> post_order = ComputePostOrder(nodes);
   return post_order.size();
 }
 
+Util::Liveness Util::ComputeLiveness(
+    tensorflow::gtl::ArraySlice<const Node* const> post_order,
+    tensorflow::gtl::ArraySlice<const Node* const> roots) {
+  std::unordered_map<const Node*, size_t> positions;
+  for (size_t i = 0; i < post_order.size(); ++i) {
+    positions.emplace(post_order[i], i);
+  }
+  Liveness liveness;
+  liveness.last_uses.resize(post_order.size(), 0);
+  for (size_t i = 0; i < post_order.size(); ++i) {
+    liveness.last_uses[i] = i;
+    for (auto& operand : post_order[i]->operands()) {
+      auto it = positions.find(operand.node);
+      XLA_CHECK(it != positions.end()) << "Node not in post-order: "
+                                       << *operand.node;
+      liveness.last_uses[it->second] = i;
+    }
+  }
+  for (auto root : roots) {
+    auto it = positions.find(root);
+    XLA_CHECK(it != positions.end()) << "Root not in post-order: " << *root;
+    liveness.last_uses[it->second] = post_order.size();
+  }
+  std::vector<xla::int64> released_bytes(post_order.size(), 0);
+  for (size_t i = 0; i < post_order.size(); ++i) {
+    if (!post_order[i]->operands().empty() &&
+        liveness.last_uses[i] < post_order.size()) {
+      released_bytes[liveness.last_uses[i]] += GetOutputBytes(post_order[i]);
+    }
+  }
+  liveness.live_bytes.reserve(post_order.size());
+  liveness.resident_bytes.reserve(post_order.size());
+  xla::int64 live_bytes = 0;
+  for (size_t i = 0; i < post_order.size(); ++i) {
+    if (!post_order[i]->operands().empty()) {
+      live_bytes += GetOutputBytes(post_order[i]);
+    }
+    liveness.live_bytes.push_back(live_bytes);
+    live_bytes -= released_bytes[i];
+    liveness.resident_bytes.push_back(live_bytes);
+  }
+  return liveness;
+}
+
+std::vector<size_t> Util::ComputeSegmentCuts(const Liveness& liveness,
+                                             size_t num_nodes,
+                                             size_t num_segments) {
+  size_t window = std::max<size_t>(num_nodes / (4 * num_segments), 1);
+  std::vector<size_t> cuts;
+  size_t start = 0;
+  for (size_t k = 1; k < num_segments; ++k) {
+    size_t target = k * num_nodes / num_segments;
+    size_t first = std::max(start, target > window ? target - window : 0);
+    size_t last = std::min(num_nodes - 1, target + window);
+    if (first >= last) {
+      continue;
+    }
+    size_t cut = first;
+    for (size_t i = first + 1; i < last; ++i) {
+      if (liveness.resident_bytes[i] < liveness.resident_bytes[cut]) {
+        cut = i;
+      }
+    }
+    cuts.push_back(cut);
+    start = cut + 1;
+  }
+  return cuts;
+}
+
+Util::Segments Util::ComputeSegments(
+    tensorflow::gtl::ArraySlice<const Node* const> post_order,
+    tensorflow::gtl::ArraySlice<const size_t> cuts,
+    tensorflow::gtl::ArraySlice<const Output> roots) {
+  size_t num_segments = cuts.size() + 1;
+  Segments segments;
+  segments.outputs.resize(num_segments);
+  segments.output_indices.resize(num_segments);
+  segments.inputs.resize(num_segments);
+  for (size_t i = 0, segment = 0; i < post_order.size(); ++i) {
+    if (!post_order[i]->operands().empty()) {
+      segments.node_segments.emplace(post_order[i], segment);
+    }
+    if (segment < cuts.size() && i == cuts[segment]) {
+      ++segment;
+    }
+  }
+  auto add_output = [&](size_t segment, const Output& output) {
+    auto it = segments.output_indices[segment]
+                  .emplace(output, segments.outputs[segment].size())
+                  .first;
+    if (it->second == segments.outputs[segment].size()) {
+      segments.outputs[segment].push_back(output);
+    }
+    return it->second;
+  };
+  std::vector<OutputMap<size_t>> input_indices(num_segments);
+  for (auto node : post_order) {
+    auto it = segments.node_segments.find(node);
+    if (it == segments.node_segments.end()) {
+      continue;
+    }
+    for (auto& operand : node->operands()) {
+      auto operand_it = segments.node_segments.find(operand.node);
+      if (operand_it != segments.node_segments.end() &&
+          operand_it->second < it->second) {
+        add_output(operand_it->second, operand);
+        if (input_indices[it->second]
+                .emplace(operand, segments.inputs[it->second].size())
+                .second) {
+          segments.inputs[it->second].push_back(operand);
+        }
+      }
+    }
+  }
+  for (auto& root : roots) {
+    auto it = segments.node_segments.find(root.node);
+    size_t segment =
+        it != segments.node_segments.end() ? it->second : num_segments - 1;
+    segments.root_outputs.emplace_back(segment, add_output(segment, root));
+  }
+  return segments;
+}
+
+xla::int64 Util::GetOutputBytes(const Node* node) {
+  xla::int64 bytes = 0;
+  xla::ShapeUtil::ForEachSubshape(
+      node->shape(),
+      [&](const xla::Shape& subshape, const xla::ShapeIndex& /*index*/) {
+        if (subshape.IsArray()) {
+          bytes += xla::ShapeUtil::ByteSizeOf(subshape);
+        }
+      });
+  return bytes;
+}
+
 }  // namespace ir
 }  // namespace torch_xla
@@ -43,10 +43,72 @@ class Util {
       tensorflow::gtl::ArraySlice<const Value> values,
       tensorflow::gtl::ArraySlice<const Node* const> post_order);
 
+  // Whether the node generates random numbers, in which case two nodes with the
+  // same operands do not produce the same results.
+  static bool IsRandomOp(const Node* node);
+
   // Retrieves the number of nodes within the graph whose sink are passed in the
   // nodes argument.
   static size_t GetGraphSize(
       tensorflow::gtl::ArraySlice<const Node* const> nodes);
+
+  // The estimated device memory used by the intermediate results of a graph,
+  // when its nodes are computed in post-order and each result is released
+  // after its last use. The leaf nodes (like device data and constants) are
+  // not accounted for.
+  struct Liveness {
+    // The bytes live while the node at each post-order position is computed,
+    // which include its operands and its results.
+    std::vector<xla::int64> live_bytes;
+    // The bytes still live after the node at each post-order position has
+    // been computed, once the operands it used last are released.
+    std::vector<xla::int64> resident_bytes;
+    // The post-order position of the last user of each node. The roots, whose
+    // results are kept, are last used at post_order.size().
+    std::vector<size_t> last_uses;
+  };
+
+  // The wiring of a graph cut into consecutive segments of its post-order,
+  // each one lowered into its own computation.
+  struct Segments {
+    // The segment of every node, except the leaves (like device data and
+    // constants) which belong to no segment, and get lowered within every
+    // segment using them.
+    std::unordered_map<const Node*, size_t> node_segments;
+    // The outputs every segment computes for the following segments, or for
+    // the roots, and their positions within them.
+    std::vector<std::vector<Output>> outputs;
+    std::vector<OutputMap<size_t>> output_indices;
+    // The outputs of the previous segments every segment reads.
+    std::vector<std::vector<Output>> inputs;
+    // The segment and the segment output index of every root. The roots which
+    // are leaves are computed by the last segment.
+    std::vector<std::pair<size_t, size_t>> root_outputs;
+  };
+
+  // Estimates the liveness of the graph with the given post-order and roots.
+  static Liveness ComputeLiveness(
+      tensorflow::gtl::ArraySlice<const Node* const> post_order,
+      tensorflow::gtl::ArraySlice<const Node* const> roots);
+
+  // Returns the post-order positions of the last nodes of the first segments,
+  // when splitting a graph into num_segments segments of similar size. The
+  // cuts go where the fewest bytes are resident, within a window around the
+  // even split point, as those become the parameters of the following
+  // segments.
+  static std::vector<size_t> ComputeSegmentCuts(const Liveness& liveness,
+                                                size_t num_nodes,
+                                                size_t num_segments);
+
+  // Computes the wiring of the segments of the given post-order, each one
+  // ending at the position stored within cuts, plus the last one.
+  static Segments ComputeSegments(
+      tensorflow::gtl::ArraySlice<const Node* const> post_order,
+      tensorflow::gtl::ArraySlice<const size_t> cuts,
+      tensorflow::gtl::ArraySlice<const Output> roots);
+
+  // The size in bytes of all the outputs of the node.
+  static xla::int64 GetOutputBytes(const Node* node);
 };
 
 }  // namespace ir
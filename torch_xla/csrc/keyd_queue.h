@@ -0,0 +1,158 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+
+#include "absl/types/optional.h"
+
+namespace torch_xla {
+
+// Shared state of the bounded queues. Once closed, the queues drop their
+// items and wake up all the waiters, while once closed for writing, the
+// readers drain the remaining items and then get absl::nullopt.
+class QueueBase {
+ public:
+  explicit QueueBase(size_t max_size) : max_size_(max_size) {}
+
+  size_t max_size() const { return max_size_; }
+
+  // Tells the queue that no more items will be put.
+  void CloseWrite() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    close_write_ = true;
+    ready_cv_.notify_all();
+  }
+
+ protected:
+  size_t max_size_ = 0;
+  std::mutex mutex_;
+  std::condition_variable ready_cv_;
+  std::condition_variable space_available_cv_;
+  bool close_read_ = false;
+  bool close_write_ = false;
+};
+
+// A bounded multi-producer, multi-consumer FIFO queue. The items are moved in
+// and out, so the queue never copies them, and a put item is only moved from
+// if it is accepted.
+template <typename T>
+class Queue : public QueueBase {
+ public:
+  explicit Queue(size_t max_size) : QueueBase(max_size) {}
+
+  // Waits for space to be available, and appends the item. Returns false,
+  // leaving item untouched, if the queue has been closed.
+  bool Put(T&& item) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    space_available_cv_.wait(
+        lock, [this] { return close_read_ || items_.size() < max_size_; });
+    if (close_read_) {
+      return false;
+    }
+    items_.push_back(std::move(item));
+    ready_cv_.notify_one();
+    return true;
+  }
+
+  // Waits for an item, and returns it. Returns absl::nullopt if the queue is
+  // closed, or closed for writing and empty.
+  absl::optional<T> Get() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    ready_cv_.wait(lock, [this] { return !items_.empty() || close_write_; });
+    if (close_read_ || items_.empty()) {
+      return absl::nullopt;
+    }
+    T item = std::move(items_.front());
+    items_.pop_front();
+    space_available_cv_.notify_one();
+    return std::move(item);
+  }
+
+  // Closes the queue, and returns the dropped items, so that the caller can
+  // control the context they are destroyed in.
+  std::deque<T> Close() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    close_read_ = true;
+    close_write_ = true;
+    ready_cv_.notify_all();
+    space_available_cv_.notify_all();
+    std::deque<T> items;
+    items.swap(items_);
+    return items;
+  }
+
+ private:
+  std::deque<T> items_;
+};
+
+// A bounded queue whose items are put and got by key, in any order. A put of
+// a key a reader is waiting for never blocks, so readers consuming keys in a
+// different order than the producers put them cannot deadlock on a full
+// queue.
+template <typename K, typename T>
+class KeydQueue : public QueueBase {
+ public:
+  explicit KeydQueue(size_t max_size) : QueueBase(max_size) {}
+
+  // Waits for space available (unless a reader waits for key), and stores the
+  // item. Returns false, leaving item untouched, if the queue has been closed.
+  bool Put(const K& key, T&& item) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    space_available_cv_.wait(lock, [&] {
+      return close_read_ || items_.size() < max_size_ ||
+             waited_keys_.count(key) > 0;
+    });
+    if (close_read_) {
+      return false;
+    }
+    items_[key] = std::move(item);
+    if (waited_keys_.count(key) > 0) {
+      ready_cv_.notify_all();
+    }
+    return true;
+  }
+
+  // Waits for the item with the given key, and returns it. Returns
+  // absl::nullopt if the queue is closed, or closed for writing and the item
+  // was never put.
+  absl::optional<T> Get(const K& key) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (items_.count(key) == 0 && !close_write_) {
+      waited_keys_.insert(key);
+      space_available_cv_.notify_all();
+      ready_cv_.wait(lock);
+      waited_keys_.erase(key);
+    }
+    auto it = items_.find(key);
+    if (close_read_ || it == items_.end()) {
+      return absl::nullopt;
+    }
+    T item = std::move(it->second);
+    items_.erase(it);
+    space_available_cv_.notify_one();
+    return std::move(item);
+  }
+
+  // Closes the queue, and returns the dropped items (see Queue::Close()).
+  std::unordered_map<K, T> Close() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    close_read_ = true;
+    close_write_ = true;
+    ready_cv_.notify_all();
+    space_available_cv_.notify_all();
+    std::unordered_map<K, T> items;
+    items.swap(items_);
+    return items;
+  }
+
+ private:
+  std::unordered_map<K, T> items_;
+  std::unordered_set<K> waited_keys_;
+};
+
+}  // namespace torch_xla
@@ -2,7 +2,9 @@
 
 #include <algorithm>
 #include <functional>
+#include <set>
 
+#include "absl/strings/str_split.h"
 #include "tensorflow/compiler/xla/shape_util.h"
 #include "tensorflow/compiler/xla/xla_client/debug_macros.h"
 #include "tensorflow/compiler/xla/xla_client/sys_util.h"
@@ -26,6 +28,43 @@ xla::Shape MakeShapeWithSortedLayout(
 
 }  // namespace
 
+bool UseChannelsLastLayout(DeviceType device_type) {
+  static const std::set<DeviceType>* device_types = []() {
+    std::string env =
+        xla::sys_util::GetEnvString("XLA_CHANNELS_LAST_DEVICES", "");
+    std::set<DeviceType> types;
+    for (auto& name : absl::StrSplit(env, ',', absl::SkipEmpty())) {
+      if (name == "CPU") {
+        types.insert(DeviceType::CPU);
+      } else if (name == "GPU") {
+        types.insert(DeviceType::GPU);
+      } else if (name == "TPU") {
+        types.insert(DeviceType::TPU);
+      } else {
+        XLA_ERROR() << "Invalid device type in XLA_CHANNELS_LAST_DEVICES: "
+                    << name;
+      }
+    }
+    return new std::set<DeviceType>(std::move(types));
+  }();
+  return device_types->count(device_type) > 0;
+}
+
+xla::Shape MakeChannelsLastLayout(
+    tensorflow::gtl::ArraySlice<const xla::int64> dimensions,
+    xla::PrimitiveType type) {
+  XLA_CHECK(dimensions.size() == 4 || dimensions.size() == 5)
+      << "Invalid rank for a channels-last layout: " << dimensions.size();
+  // Channels first, then the spatial dimensions from the innermost, then the
+  // batch. For a 4D array this is the NHWC (or OHWI for kernels) layout.
+  std::vector<xla::int64> layout({1});
+  for (xla::int64 dim = dimensions.size() - 1; dim >= 2; --dim) {
+    layout.push_back(dim);
+  }
+  layout.push_back(0);
+  return xla::ShapeUtil::MakeShapeWithLayout(type, dimensions, layout);
+}
+
 xla::Shape MakeTorchTensorLayout(
     tensorflow::gtl::ArraySlice<const xla::int64> dimensions,
     xla::PrimitiveType type) {
@@ -35,6 +74,10 @@ xla::Shape MakeTorchTensorLayout(
 xla::Shape MakeArrayShapeFromDimensions(
     tensorflow::gtl::ArraySlice<const xla::int64> dimensions,
     xla::PrimitiveType type, DeviceType device_type) {
+  if ((dimensions.size() == 4 || dimensions.size() == 5) &&
+      UseChannelsLastLayout(device_type)) {
+    return MakeChannelsLastLayout(dimensions, type);
+  }
   if (dimensions.size() > 1 && device_type == DeviceType::TPU) {
     return MakeShapeWithSortedLayout(dimensions, type);
   }
@@ -7,6 +7,18 @@
 
 namespace torch_xla {
 
+// Whether the rank 4 and 5 arrays (like the activations and kernels of the
+// convolutions and poolings) should be laid out channels-last on the given
+// device type, as listed by XLA_CHANNELS_LAST_DEVICES. The arrays keep their
+// PyTorch NCHW dimensions, with the channels (dimension 1) as the most minor
+// dimension of their layout, followed by the spatial ones and by the batch.
+bool UseChannelsLastLayout(DeviceType device_type);
+
+// Creates a channels-last layout for the given rank 4 or 5 dimensions.
+xla::Shape MakeChannelsLastLayout(
+    tensorflow::gtl::ArraySlice<const xla::int64> dimensions,
+    xla::PrimitiveType type);
+
 // Creates a minor-to-major layout from given dimensions.
 xla::Shape MakeTorchTensorLayout(
     tensorflow::gtl::ArraySlice<const xla::int64> dimensions,
@@ -14,7 +26,8 @@ xla::Shape MakeTorchTensorLayout(
 
 // Create an XLA shape with the given dimensions and type, suitable to be used
 // in the specified device type. The type of device can affect the choice of the
-// XLA layout.
+// XLA layout. The channels-last layout is used for the rank 4 and 5 arrays on
+// the devices which prefer it.
 xla::Shape MakeArrayShapeFromDimensions(
     tensorflow::gtl::ArraySlice<const xla::int64> dimensions,
     xla::PrimitiveType type, DeviceType device_type);
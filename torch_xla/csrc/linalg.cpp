@@ -0,0 +1,241 @@
+#include "torch_xla/csrc/linalg.h"
+
+#include <algorithm>
+#include <numeric>
+
+#include "tensorflow/compiler/xla/client/lib/constants.h"
+#include "tensorflow/compiler/xla/client/lib/matrix.h"
+#include "tensorflow/compiler/xla/client/lib/qr.h"
+#include "tensorflow/compiler/xla/shape_util.h"
+#include "tensorflow/compiler/xla/xla_client/debug_macros.h"
+#include "tensorflow/compiler/xla/xla_client/sys_util.h"
+#include "tensorflow/compiler/xla/xla_client/util.h"
+#include "torch_xla/csrc/helpers.h"
+#include "torch_xla/csrc/matrix.h"
+
+namespace torch_xla {
+namespace {
+
+bool UseUnrolledKernel(xla::int64 rows, xla::int64 cols) {
+  static const xla::int64 max_size =
+      xla::sys_util::GetEnvInt("XLA_LINALG_UNROLL_MAX_SIZE", 32);
+  return rows <= max_size && cols <= max_size;
+}
+
+xla::XlaOp TransposeMinor(const xla::XlaOp& input) {
+  xla::int64 rank = XlaHelpers::ShapeOfXlaOp(input).rank();
+  return xla::Transpose(input, XlaHelpers::MakeTransposePermutation(
+                                   /*dim0=*/rank - 2, /*dim1=*/rank - 1,
+                                   /*rank=*/rank));
+}
+
+// Slices the rows (minor_dim 0) or the columns (minor_dim 1) of the matrices.
+xla::XlaOp SliceMinor(const xla::XlaOp& input, xla::int64 minor_dim,
+                      xla::int64 start, xla::int64 limit) {
+  xla::int64 rank = XlaHelpers::ShapeOfXlaOp(input).rank();
+  return xla::SliceInDim(input, start, limit, 1, rank - 2 + minor_dim);
+}
+
+xla::XlaOp ConcatMinor(const xla::XlaOp& lhs, const xla::XlaOp& rhs,
+                       xla::int64 minor_dim) {
+  xla::int64 rank = XlaHelpers::ShapeOfXlaOp(lhs).rank();
+  return xla::ConcatInDim(lhs.builder(), {lhs, rhs}, rank - 2 + minor_dim);
+}
+
+// Multiplies the batches of matrices, with either of them transposed. The
+// factorizations feed every step into the next ones, so the products always
+// use the highest precision, like the XLA expansions do.
+xla::XlaOp BatchMatMul(const xla::XlaOp& lhs, bool transpose_lhs,
+                       const xla::XlaOp& rhs, bool transpose_rhs) {
+  xla::int64 rank = XlaHelpers::ShapeOfXlaOp(lhs).rank();
+  xla::DotDimensionNumbers dims;
+  for (xla::int64 i = 0; i < rank - 2; ++i) {
+    dims.add_lhs_batch_dimensions(i);
+    dims.add_rhs_batch_dimensions(i);
+  }
+  dims.add_lhs_contracting_dimensions(transpose_lhs ? rank - 2 : rank - 1);
+  dims.add_rhs_contracting_dimensions(transpose_rhs ? rank - 1 : rank - 2);
+  xla::PrecisionConfig precision_config =
+      XlaHelpers::BuildPrecisionConfig(xla::PrecisionConfig::HIGHEST);
+  return xla::DotGeneral(lhs, rhs, dims, &precision_config);
+}
+
+// Broadcasts the [..., 1, 1] input to the shape of like.
+xla::XlaOp BroadcastScalars(const xla::XlaOp& input, const xla::XlaOp& like) {
+  std::vector<xla::int64> sizes = XlaHelpers::SizesOfXlaOp(like);
+  std::vector<xla::int64> dims(sizes.size());
+  std::iota(dims.begin(), dims.end(), 0);
+  return xla::BroadcastInDim(input, sizes, dims);
+}
+
+// Returns the predicate of the elements of the input whose row index compares
+// with the given one.
+template <typename F>
+xla::XlaOp RowPredicate(const xla::XlaOp& input, xla::int64 row,
+                        const F& compare) {
+  xla::Shape shape = XlaHelpers::ShapeOfXlaOp(input);
+  xla::XlaOp rows = xla::Iota(
+      input.builder(),
+      xla::ShapeUtil::MakeShape(xla::PrimitiveType::S32, shape.dimensions()),
+      shape.rank() - 2);
+  return compare(rows, xla::ConstantR0<xla::int32>(input.builder(), row));
+}
+
+// Zeroes the rows of the input before the given one.
+xla::XlaOp RowsFrom(const xla::XlaOp& input, xla::int64 row) {
+  xla::XlaOp predicate = RowPredicate(
+      input, row, [](const xla::XlaOp& x, const xla::XlaOp& y) {
+        return xla::Ge(x, y);
+      });
+  return xla::Select(predicate, input, xla::ZerosLike(input));
+}
+
+// Left looking Cholesky factorization, computing a column of the lower factor
+// at every step.
+xla::XlaOp UnrolledCholesky(const xla::XlaOp& a) {
+  xla::int64 n = XlaHelpers::SizesOfXlaOp(a).back();
+  xla::XlaOp l;
+  for (xla::int64 j = 0; j < n; ++j) {
+    xla::XlaOp column = SliceMinor(a, 1, j, j + 1);
+    if (j > 0) {
+      xla::XlaOp row = SliceMinor(l, 0, j, j + 1);
+      column = column - BatchMatMul(l, /*transpose_lhs=*/false, row,
+                                    /*transpose_rhs=*/true);
+    }
+    xla::XlaOp diagonal = xla::Sqrt(SliceMinor(column, 0, j, j + 1));
+    column = RowsFrom(column / BroadcastScalars(diagonal, column), j);
+    l = j > 0 ? ConcatMinor(l, column, 1) : column;
+  }
+  return l;
+}
+
+// Solves m * x = b by substitution, computing a row of x at every step.
+xla::XlaOp UnrolledTriangularSolve(const xla::XlaOp& m, const xla::XlaOp& b,
+                                   bool lower, bool unit_diagonal) {
+  xla::int64 n = XlaHelpers::SizesOfXlaOp(m).back();
+  xla::XlaOp x;
+  for (xla::int64 step = 0; step < n; ++step) {
+    xla::int64 i = lower ? step : n - 1 - step;
+    xla::XlaOp row = SliceMinor(b, 0, i, i + 1);
+    xla::XlaOp m_row = SliceMinor(m, 0, i, i + 1);
+    if (step > 0) {
+      xla::XlaOp coefficients = lower ? SliceMinor(m_row, 1, 0, i)
+                                      : SliceMinor(m_row, 1, i + 1, n);
+      row = row - BatchMatMul(coefficients, /*transpose_lhs=*/false, x,
+                              /*transpose_rhs=*/false);
+    }
+    if (!unit_diagonal) {
+      row = row / BroadcastScalars(SliceMinor(m_row, 1, i, i + 1), row);
+    }
+    if (step == 0) {
+      x = row;
+    } else {
+      x = lower ? ConcatMinor(x, row, 0) : ConcatMinor(row, x, 0);
+    }
+  }
+  return x;
+}
+
+// Householder QR, applying a reflection to R and accumulating it into Q at
+// every step.
+std::vector<xla::XlaOp> UnrolledQR(const xla::XlaOp& a, bool full_matrices) {
+  xla::Shape shape = XlaHelpers::ShapeOfXlaOp(a);
+  xla::int64 m = shape.dimensions(shape.rank() - 2);
+  xla::int64 n = shape.dimensions(shape.rank() - 1);
+  xla::int64 k = std::min(m, n);
+  xla::XlaBuilder* builder = a.builder();
+  xla::PrimitiveType type = shape.element_type();
+  xla::XlaOp one = XlaHelpers::ScalarValue<float>(1, type, builder);
+  xla::XlaOp zero = XlaHelpers::ScalarValue<float>(0, type, builder);
+  std::vector<xla::int64> batch_sizes(shape.dimensions().begin(),
+                                      shape.dimensions().end() - 2);
+  xla::XlaOp r = a;
+  xla::XlaOp q =
+      xla::Broadcast(xla::IdentityMatrix(builder, type, m, m), batch_sizes);
+  // A reflection of the last row alone is the identity.
+  for (xla::int64 j = 0; j < std::min(m - 1, n); ++j) {
+    xla::XlaOp x = RowsFrom(SliceMinor(r, 1, j, j + 1), j);
+    xla::XlaOp norm = xla::Sqrt(BatchMatMul(x, /*transpose_lhs=*/true, x,
+                                            /*transpose_rhs=*/false));
+    xla::XlaOp x_j = SliceMinor(x, 0, j, j + 1);
+    // Same sign convention as LAPACK, which reflects x onto -sign(x_j) * |x|.
+    xla::XlaOp alpha = xla::Select(xla::Lt(x_j, zero), norm, xla::Neg(norm));
+    xla::XlaOp is_row_j = RowPredicate(
+        x, j, [](const xla::XlaOp& x, const xla::XlaOp& y) {
+          return xla::Eq(x, y);
+        });
+    xla::XlaOp v = x - xla::Select(is_row_j, BroadcastScalars(alpha, x),
+                                   xla::ZerosLike(x));
+    xla::XlaOp vtv = BatchMatMul(v, /*transpose_lhs=*/true, v,
+                                 /*transpose_rhs=*/false);
+    // Zero columns need no reflection.
+    xla::XlaOp scale =
+        xla::Select(xla::Gt(vtv, zero), (one + one) / vtv, xla::ZerosLike(vtv));
+    xla::XlaOp w = BatchMatMul(v, /*transpose_lhs=*/true, r,
+                               /*transpose_rhs=*/false);
+    r = r - BatchMatMul(v, /*transpose_lhs=*/false,
+                        w * BroadcastScalars(scale, w),
+                        /*transpose_rhs=*/false);
+    xla::XlaOp qv = BatchMatMul(q, /*transpose_lhs=*/false, v,
+                                /*transpose_rhs=*/false);
+    q = q - BatchMatMul(qv * BroadcastScalars(scale, qv),
+                        /*transpose_lhs=*/false, v, /*transpose_rhs=*/true);
+  }
+  r = BuildTriu(r, 0);
+  if (!full_matrices) {
+    q = SliceMinor(q, 1, 0, k);
+    r = SliceMinor(r, 0, 0, k);
+  }
+  return {q, r};
+}
+
+}  // namespace
+
+xla::XlaOp BuildCholesky(const xla::XlaOp& input, bool lower) {
+  xla::int64 n = XlaHelpers::SizesOfXlaOp(input).back();
+  if (!UseUnrolledKernel(n, n)) {
+    return xla::Triangle(xla::Cholesky(input, /*lower=*/lower),
+                         /*lower=*/lower);
+  }
+  // The upper factor of the input is the transposed lower factor of its
+  // transpose, whose lower triangle is the upper triangle of the input.
+  return lower ? UnrolledCholesky(input)
+               : TransposeMinor(UnrolledCholesky(TransposeMinor(input)));
+}
+
+xla::XlaOp BuildTriangularSolve(const xla::XlaOp& a, const xla::XlaOp& b,
+                                bool left_side, bool lower, bool unit_diagonal,
+                                bool transpose) {
+  xla::int64 n = XlaHelpers::SizesOfXlaOp(a).back();
+  xla::int64 nrhs = XlaHelpers::SizesOfXlaOp(b).back();
+  if (!UseUnrolledKernel(n, n) || !UseUnrolledKernel(nrhs, nrhs)) {
+    return xla::TriangularSolve(
+        a, b, left_side, lower, unit_diagonal,
+        transpose ? xla::TriangularSolveOptions::TRANSPOSE
+                  : xla::TriangularSolveOptions::NO_TRANSPOSE);
+  }
+  xla::XlaOp m = transpose ? TransposeMinor(a) : a;
+  bool m_lower = lower != transpose;
+  if (left_side) {
+    return UnrolledTriangularSolve(m, b, m_lower, unit_diagonal);
+  }
+  // x * m = b is the same as m^T * x^T = b^T.
+  return TransposeMinor(UnrolledTriangularSolve(
+      TransposeMinor(m), TransposeMinor(b), !m_lower, unit_diagonal));
+}
+
+std::vector<xla::XlaOp> BuildQR(const xla::XlaOp& input, bool full_matrices) {
+  xla::Shape shape = XlaHelpers::ShapeOfXlaOp(input);
+  xla::int64 m = shape.dimensions(shape.rank() - 2);
+  xla::int64 n = shape.dimensions(shape.rank() - 1);
+  if (UseUnrolledKernel(m, n)) {
+    return UnrolledQR(input, full_matrices);
+  }
+  xla::QRDecompositionResult qr_result =
+      xla::QRDecomposition(input, full_matrices, /*block_size=*/128,
+                           XlaHelpers::mat_mul_precision())
+          .ValueOrDie();
+  return {qr_result.q, qr_result.r};
+}
+
+}  // namespace torch_xla
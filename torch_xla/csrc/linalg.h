@@ -0,0 +1,32 @@
+#pragma once
+
+#include <vector>
+
+#include "tensorflow/compiler/xla/client/xla_builder.h"
+
+namespace torch_xla {
+
+// The linear algebra lowerings below operate on batches of matrices, stored in
+// the two minor dimensions of their operands. Matrices up to
+// XLA_LINALG_UNROLL_MAX_SIZE rows and columns (32 by default) are factored by
+// kernels fully unrolled at compile time, which process the whole batch at
+// every step with static slices, instead of going through the loops of the
+// generic XLA expansions. Larger matrices use the blocked XLA algorithms.
+
+// Computes the lower (or upper) Cholesky factor of the input matrices, reading
+// only their lower (or upper) triangle.
+xla::XlaOp BuildCholesky(const xla::XlaOp& input, bool lower);
+
+// Solves op(a) * x = b if left_side is true, or x * op(a) = b otherwise, with
+// a being lower or upper triangular, and op(a) being its transpose if
+// transpose is true. a and b must have the same batch dimensions.
+xla::XlaOp BuildTriangularSolve(const xla::XlaOp& a, const xla::XlaOp& b,
+                                bool left_side, bool lower, bool unit_diagonal,
+                                bool transpose);
+
+// Computes the Householder QR decomposition of the input matrices, returning
+// the {Q, R} pair. With full_matrices false, Q and R are reduced to min(M, N)
+// columns and rows respectively.
+std::vector<xla::XlaOp> BuildQR(const xla::XlaOp& input, bool full_matrices);
+
+}  // namespace torch_xla
@@ -1,11 +1,20 @@
 #include "torch_xla/csrc/lowering_context.h"
 
+#include <algorithm>
 #include <sstream>
 #include <stdexcept>
+#include <unordered_set>
 
+#include "absl/memory/memory.h"
 #include "absl/strings/str_cat.h"
 #include "tensorflow/compiler/xla/xla_client/debug_macros.h"
+#include "tensorflow/compiler/xla/xla_client/metrics.h"
+#include "tensorflow/compiler/xla/xla_client/multi_wait.h"
 #include "tensorflow/compiler/xla/xla_client/sys_util.h"
+#include "tensorflow/compiler/xla/xla_client/thread_pool.h"
+#include "tensorflow/compiler/xla/xla_client/util.h"
+#include "torch_xla/csrc/op_profiler.h"
+#include "torch_xla/csrc/ops/device_data.h"
 #include "torch_xla/csrc/python_util.h"
 
 namespace torch_xla {
@@ -15,7 +24,7 @@ namespace {
 class HloMetadataSetter {
  public:
   HloMetadataSetter(LoweringContext* loctx, const Node* node) {
-    if (ShouldPopulateXlaOpMetadata()) {
+    if (ShouldPopulateXlaOpMetadata() || OpProfiler::IsEnabled()) {
       PopulateXlaOpMetadata(loctx, node);
       loctx_ = loctx;
     }
@@ -36,8 +45,16 @@ class HloMetadataSetter {
   static void PopulateXlaOpMetadata(LoweringContext* loctx, const Node* node) {
     xla::OpMetadata metadata;
     metadata.set_op_type(node->op().ToString());
-    if (!node->metadata().frame_info.empty()) {
-      const SourceLocation& frame = node->metadata().frame_info.front();
+    if (OpProfiler::IsEnabled()) {
+      xla::int64 id = OpProfiler::Get()->RegisterNode(node);
+      if (id != 0) {
+        metadata.set_op_name(OpProfiler::OpName(id));
+      }
+    }
+    const std::vector<SourceLocation>* frames = node->metadata().frame_info;
+    if (ShouldPopulateXlaOpMetadata() && frames != nullptr &&
+        !frames->empty()) {
+      const SourceLocation& frame = frames->front();
       std::string::size_type pos = frame.file.find_last_of('/');
       if (pos == std::string::npos) {
         pos = 0;
@@ -53,21 +70,150 @@ class HloMetadataSetter {
   LoweringContext* loctx_ = nullptr;
 };
 
+bool IsDeviceData(const Node* node) {
+  return dynamic_cast<const ops::DeviceData*>(node) != nullptr;
+}
+
+size_t GetSubgraphCacheMaxNodes() {
+  static const size_t max_nodes =
+      xla::sys_util::GetEnvInt("XLA_IR_LOWERING_CACHE_MAX_NODES", 4096);
+  return max_nodes;
+}
+
+// Whether the given node becomes a parameter of the subgraph rooted at root.
+// Besides device data, a single output node of the same kind and shape as the
+// root is the output of a previous repetition of the subgraph (like the
+// previous layer of a chain of identical layers), so the subgraph stops there.
+bool IsSubgraphParameter(const Node* node, const Node* root) {
+  return IsDeviceData(node) ||
+         (node != root && node->num_outputs() == 1 &&
+          node->node_hash() == root->node_hash());
+}
+
+// Computes the post-order of the subgraph rooted at the given node, down to
+// its parameters. Returns an empty vector if the subgraph has more than
+// max_nodes nodes.
+std::vector<const Node*> ComputeSubgraphPostOrder(const Node* root,
+                                                  size_t max_nodes) {
+  Util::EmissionMap emap;
+  std::vector<const Node*> post_order;
+  std::vector<const Node*> queue({root});
+  while (!queue.empty()) {
+    const Node* node = queue.back();
+    auto it = emap.find(node);
+    if (it == emap.end()) {
+      if (emap.size() >= max_nodes) {
+        return {};
+      }
+      emap[node] = Util::kEmitting;
+      if (!IsSubgraphParameter(node, root)) {
+        for (auto& output : node->operands()) {
+          if (emap.count(output.node) == 0) {
+            queue.push_back(output.node);
+          }
+        }
+      }
+    } else {
+      if (it->second == Util::kEmitting) {
+        it->second = Util::kEmitted;
+        post_order.push_back(node);
+      }
+      queue.pop_back();
+    }
+  }
+  return post_order;
+}
+
+// Returns the structural key of the subgraph with the given post-order, or
+// zero if the subgraph cannot be emitted as a call. Parameters only contribute
+// their position and shape, so subgraphs over different data share the key.
+// Besides the node hashes, the key captures how nodes are shared within the
+// subgraph, which the graph hash does not.
+size_t GetSubgraphKey(
+    tensorflow::gtl::ArraySlice<const Node* const> post_order,
+    const std::unordered_set<const Node*>& graph_nodes,
+    const std::unordered_set<const Node*>& roots) {
+  const Node* root = post_order.back();
+  std::unordered_set<const Node*> subgraph_nodes(post_order.begin(),
+                                                 post_order.end());
+  std::unordered_map<const Node*, size_t> node_indices;
+  size_t key = 0x5d1b3a7f;
+  size_t num_parameters = 0;
+  for (size_t i = 0; i < post_order.size(); ++i) {
+    const Node* node = post_order[i];
+    node_indices.emplace(node, i);
+    if (IsSubgraphParameter(node, root)) {
+      // Parameters of the subgraph computation are free to be shared with the
+      // rest of the graph.
+      key = xla::util::HashCombine(
+          key, xla::util::HashCombine(
+                   num_parameters, xla::util::Hash(node->shape().ToString())));
+      ++num_parameters;
+      continue;
+    }
+    if (Util::IsRandomOp(node)) {
+      return 0;
+    }
+    if (node != root) {
+      if (roots.count(node) > 0) {
+        return 0;
+      }
+      for (auto& use : node->uses()) {
+        // Users which are not part of the graph being lowered do not matter.
+        if (graph_nodes.count(use.node) > 0 &&
+            subgraph_nodes.count(use.node) == 0) {
+          return 0;
+        }
+      }
+    }
+    key = xla::util::HashCombine(key, node->node_hash());
+    for (auto& operand : node->operands()) {
+      key = xla::util::HashCombine(
+          key, xla::util::HashCombine(node_indices.at(operand.node),
+                                      operand.index));
+    }
+  }
+  return key;
+}
+
+// Returns the representative of the component of the given node index, within
+// the union-find parents vector.
+size_t FindComponent(std::vector<size_t>* parents, size_t index) {
+  while ((*parents)[index] != index) {
+    (*parents)[index] = (*parents)[(*parents)[index]];
+    index = (*parents)[index];
+  }
+  return index;
+}
+
 }  // namespace
 
 xla::XlaOp LoweringContext::GetParameter(
     const std::shared_ptr<xla::ComputationClient::Data>& data) {
   auto it = parameters_map_.find(data.get());
   if (it == parameters_map_.end()) {
-    xla::XlaOp param =
-        xla::Parameter(builder(), parameters_.size(), data->shape(),
-                       absl::StrCat("param_", parameters_.size()));
-    parameters_.push_back(data);
-    it = parameters_map_.emplace(data.get(), param).first;
+    auto constant_it = constant_data_.find(data.get());
+    if (constant_it != constant_data_.end()) {
+      xla::XlaOp constant =
+          xla::ConstantLiteral(builder(), *constant_it->second);
+      it = parameters_map_.emplace(data.get(), constant).first;
+    } else {
+      xla::XlaOp param =
+          xla::Parameter(builder(), parameters_.size(), data->shape(),
+                         absl::StrCat("param_", parameters_.size()));
+      parameters_.push_back(data);
+      it = parameters_map_.emplace(data.get(), param).first;
+    }
   }
   return it->second;
 }
 
+void LoweringContext::SetConstantData(
+    const xla::ComputationClient::DataPtr& data, const xla::Literal* literal) {
+  XLA_CHECK(parameters_map_.find(data.get()) == parameters_map_.end());
+  constant_data_[data.get()] = literal;
+}
+
 xla::int64 LoweringContext::AddResult(xla::XlaOp op) {
   root_tuple_.push_back(std::move(op));
   return root_tuple_.size() - 1;
@@ -91,6 +237,21 @@ void LoweringContext::AssignOutputOp(const Output& output, xla::XlaOp op) {
   emitted_outputs_[output] = op;
 }
 
+void LoweringContext::AssignExternalOutputOp(const Output& output,
+                                             xla::XlaOp op) {
+  emitted_outputs_[output] = op;
+  emit_status_[output.node] = Util::kEmitted;
+  external_outputs_.insert(output);
+}
+
+bool LoweringContext::IsExternalOutput(const Output& output) const {
+  return external_outputs_.count(output) > 0;
+}
+
+bool LoweringContext::IsOutputEmitted(const Output& output) const {
+  return emitted_outputs_.count(output) > 0;
+}
+
 xla::XlaOp LoweringContext::GetOutputOp(const Output& output) {
   auto it = emitted_outputs_.find(output);
   if (it == emitted_outputs_.end()) {
@@ -122,6 +283,322 @@ XlaOpVector LoweringContext::LowerNode(const Node* node) {
   return result_ops;
 }
 
+void LoweringContext::LowerOptimized(
+    tensorflow::gtl::ArraySlice<const Node* const> post_order) {
+  optimizer_ = absl::make_unique<Optimizer>(post_order);
+  XLA_COUNTER("IrOptimizerMergedNodes", optimizer_->num_merged());
+  XLA_COUNTER("IrOptimizerFoldedNodes", optimizer_->num_folded());
+  for (auto node : post_order) {
+    const Node* replacement = optimizer_->GetReplacement(node);
+    if (replacement == nullptr) {
+      LowerNode(node);
+    } else {
+      for (size_t i = 0; i < node->num_outputs(); ++i) {
+        Output output(replacement, i);
+        auto it = emitted_outputs_.find(output);
+        if (it == emitted_outputs_.end()) {
+          // Folded nodes are not part of the post-order.
+          LowerNode(replacement);
+          it = emitted_outputs_.find(output);
+          XLA_CHECK(it != emitted_outputs_.end())
+              << "No XLA operation emitted for output: " << output;
+        }
+        AssignOutputOp(Output(node, i), it->second);
+      }
+    }
+    // Later GetOutputOp() calls must not lower this node again.
+    emit_status_[node] = Util::kEmitted;
+  }
+}
+
+void LoweringContext::LowerCachingSubgraphs(
+    tensorflow::gtl::ArraySlice<const Node* const> post_order,
+    tensorflow::gtl::ArraySlice<const Node* const> roots, size_t min_nodes) {
+  std::unordered_set<const Node*> graph_nodes(post_order.begin(),
+                                              post_order.end());
+  std::unordered_set<const Node*> root_nodes(roots.begin(), roots.end());
+  // The graph hash of a node covers everything it depends on, so the repeated
+  // layers of a chain would never match. Candidates are picked by node hash
+  // instead, and their subgraph keys decide whether they repeat.
+  std::unordered_map<size_t, size_t> hash_counts;
+  for (auto node : post_order) {
+    ++hash_counts[node->node_hash()];
+  }
+  // Walk the post-order backward, so that subgraphs win over the smaller ones
+  // nested within them.
+  struct Subgraph {
+    std::vector<const Node*> post_order;
+    size_t key = 0;
+  };
+  std::unordered_map<const Node*, Subgraph> subgraphs;
+  std::unordered_map<const Node*, const Node*> covered;
+  std::unordered_map<size_t, size_t> key_counts;
+  for (auto it = post_order.rbegin(); it != post_order.rend(); ++it) {
+    const Node* node = *it;
+    if (covered.count(node) > 0 || hash_counts[node->node_hash()] < 2 ||
+        IsDeviceData(node)) {
+      continue;
+    }
+    Subgraph subgraph;
+    subgraph.post_order =
+        ComputeSubgraphPostOrder(node, GetSubgraphCacheMaxNodes());
+    size_t num_nodes = 0;
+    for (auto subgraph_node : subgraph.post_order) {
+      if (!IsSubgraphParameter(subgraph_node, node)) {
+        ++num_nodes;
+      }
+    }
+    if (num_nodes < min_nodes) {
+      continue;
+    }
+    subgraph.key =
+        GetSubgraphKey(subgraph.post_order, graph_nodes, root_nodes);
+    if (subgraph.key == 0) {
+      continue;
+    }
+    for (auto subgraph_node : subgraph.post_order) {
+      if (subgraph_node != node &&
+          !IsSubgraphParameter(subgraph_node, node)) {
+        covered.emplace(subgraph_node, node);
+      }
+    }
+    ++key_counts[subgraph.key];
+    subgraphs.emplace(node, std::move(subgraph));
+  }
+  for (auto node : post_order) {
+    auto cit = covered.find(node);
+    if (cit != covered.end()) {
+      // Inner nodes of subgraphs which have no twin are lowered as usual.
+      auto sit = subgraphs.find(cit->second);
+      if (key_counts[sit->second.key] > 1) {
+        continue;
+      }
+    }
+    auto sit = subgraphs.find(node);
+    if (sit != subgraphs.end() && key_counts[sit->second.key] > 1) {
+      LowerSubgraph(sit->second.post_order, sit->second.key);
+    } else {
+      LowerNode(node);
+    }
+    // Later GetOutputOp() calls must not lower this node again.
+    emit_status_[node] = Util::kEmitted;
+  }
+}
+
+void LoweringContext::LowerParallel(
+    tensorflow::gtl::ArraySlice<const Node* const> post_order,
+    tensorflow::gtl::ArraySlice<const Node* const> roots, size_t num_tasks) {
+  // Leaves join no component, as they are either parameters, or cheap enough to
+  // be lowered within every task using them.
+  std::unordered_map<const Node*, size_t> node_indices;
+  std::vector<size_t> parents;
+  for (auto node : post_order) {
+    if (!node->operands().empty()) {
+      node_indices.emplace(node, parents.size());
+      parents.push_back(parents.size());
+    }
+  }
+  for (auto node : post_order) {
+    auto it = node_indices.find(node);
+    if (it == node_indices.end()) {
+      continue;
+    }
+    for (auto& operand : node->operands()) {
+      auto operand_it = node_indices.find(operand.node);
+      if (operand_it != node_indices.end()) {
+        parents[FindComponent(&parents, it->second)] =
+            FindComponent(&parents, operand_it->second);
+      }
+    }
+  }
+  std::unordered_map<size_t, size_t> component_sizes;
+  for (size_t i = 0; i < parents.size(); ++i) {
+    ++component_sizes[FindComponent(&parents, i)];
+  }
+  if (component_sizes.size() < 2) {
+    return;
+  }
+  // The largest components go first, each to the least loaded task.
+  std::vector<std::pair<size_t, size_t>> components(component_sizes.begin(),
+                                                    component_sizes.end());
+  std::sort(components.begin(), components.end(),
+            [](const std::pair<size_t, size_t>& c1,
+               const std::pair<size_t, size_t>& c2) {
+              return c1.second > c2.second ||
+                     (c1.second == c2.second && c1.first < c2.first);
+            });
+  num_tasks = std::max<size_t>(std::min(num_tasks, components.size()), 1);
+  std::vector<size_t> task_sizes(num_tasks, 0);
+  std::unordered_map<size_t, size_t> component_tasks;
+  for (auto& component_size : components) {
+    size_t task = std::min_element(task_sizes.begin(), task_sizes.end()) -
+                  task_sizes.begin();
+    task_sizes[task] += component_size.second;
+    component_tasks.emplace(component_size.first, task);
+  }
+
+  struct Task {
+    std::vector<const Node*> post_order;
+    // The device data leaves used by the task, which are the parameters of the
+    // task computation.
+    std::vector<const Node*> parameters;
+    std::vector<Output> outputs;
+    xla::XlaComputation computation;
+  };
+  std::vector<Task> tasks(num_tasks);
+  std::unordered_set<const Node*> root_nodes(roots.begin(), roots.end());
+  for (auto node : post_order) {
+    auto it = node_indices.find(node);
+    if (it == node_indices.end()) {
+      if (IsDeviceData(node)) {
+        // The parameters are emitted in post-order, like the per-root lowering
+        // does.
+        LowerNode(node);
+        emit_status_[node] = Util::kEmitted;
+      }
+      continue;
+    }
+    Task& task =
+        tasks[component_tasks.at(FindComponent(&parents, it->second))];
+    task.post_order.push_back(node);
+    if (root_nodes.count(node) > 0) {
+      for (size_t i = 0; i < node->num_outputs(); ++i) {
+        task.outputs.emplace_back(node, i);
+      }
+    }
+  }
+
+  auto lower_fn = [](Task* task, size_t task_index) {
+    LoweringContext task_ctx(absl::StrCat("parallel_", task_index));
+    std::unordered_set<const Node*> emitted_leaves;
+    for (auto node : task->post_order) {
+      for (auto& operand : node->operands()) {
+        const Node* leaf = operand.node;
+        if (!leaf->operands().empty() || !emitted_leaves.insert(leaf).second) {
+          continue;
+        }
+        if (IsDeviceData(leaf)) {
+          xla::XlaOp param = xla::Parameter(
+              task_ctx.builder(), task->parameters.size(), leaf->shape(),
+              absl::StrCat("param_", task->parameters.size()));
+          task_ctx.AssignOutputOp(Output(leaf, 0), param);
+          task->parameters.push_back(leaf);
+        } else {
+          task_ctx.LowerNode(leaf);
+        }
+      }
+      task_ctx.LowerNode(node);
+    }
+    std::vector<xla::XlaOp> outputs;
+    for (auto& output : task->outputs) {
+      outputs.push_back(task_ctx.GetOutputOp(output));
+    }
+    task->computation = ConsumeValue(
+        task_ctx.Build(xla::Tuple(task_ctx.builder(), outputs)));
+  };
+  xla::util::MultiWait mwait(tasks.size());
+  for (size_t i = 0; i < tasks.size(); ++i) {
+    xla::env::ScheduleClosure(mwait.Completer(
+        [&tasks, &lower_fn, i]() { lower_fn(&tasks[i], i); }));
+  }
+  mwait.Wait();
+  XLA_COUNTER("IrParallelLoweringTasks", tasks.size());
+
+  for (auto& task : tasks) {
+    std::vector<xla::XlaOp> operands;
+    for (auto node : task.parameters) {
+      operands.push_back(GetOutputOp(Output(node, 0)));
+    }
+    xla::XlaOp call = xla::Call(builder(), task.computation, operands);
+    for (size_t i = 0; i < task.outputs.size(); ++i) {
+      AssignOutputOp(task.outputs[i], xla::GetTupleElement(call, i));
+    }
+    for (auto node : task.post_order) {
+      // Later GetOutputOp() calls must not lower this node again.
+      emit_status_[node] = Util::kEmitted;
+    }
+  }
+}
+
+bool LoweringContext::IsSubgraphCacheEnabled() {
+  static const bool enabled =
+      xla::sys_util::GetEnvBool("XLA_IR_LOWERING_CACHE", false);
+  return enabled;
+}
+
+size_t LoweringContext::GetSubgraphCacheMinNodes() {
+  static const size_t min_nodes =
+      xla::sys_util::GetEnvInt("XLA_IR_LOWERING_CACHE_MIN_NODES", 8);
+  return min_nodes;
+}
+
+bool LoweringContext::IsParallelLoweringEnabled() {
+  static const bool enabled =
+      xla::sys_util::GetEnvBool("XLA_IR_PARALLEL_LOWERING", false);
+  return enabled;
+}
+
+size_t LoweringContext::GetParallelLoweringMinNodes() {
+  static const size_t min_nodes =
+      xla::sys_util::GetEnvInt("XLA_IR_PARALLEL_LOWERING_MIN_NODES", 10000);
+  return min_nodes;
+}
+
+size_t LoweringContext::GetParallelLoweringTasks() {
+  static const size_t num_tasks =
+      xla::sys_util::GetEnvInt("XLA_IR_PARALLEL_LOWERING_TASKS", 8);
+  return num_tasks;
+}
+
+void LoweringContext::LowerSubgraph(
+    tensorflow::gtl::ArraySlice<const Node* const> post_order, size_t key) {
+  const Node* root = post_order.back();
+  auto it = subgraph_computations_.find(key);
+  if (it == subgraph_computations_.end()) {
+    LoweringContext subgraph_ctx(absl::StrCat("subgraph_", key));
+    xla::int64 num_parameters = 0;
+    for (auto node : post_order) {
+      if (IsSubgraphParameter(node, root)) {
+        xla::XlaOp param = xla::Parameter(
+            subgraph_ctx.builder(), num_parameters, node->shape(),
+            absl::StrCat("param_", num_parameters));
+        subgraph_ctx.AssignOutputOp(Output(node, 0), param);
+        ++num_parameters;
+      } else {
+        subgraph_ctx.LowerNode(node);
+      }
+    }
+    std::vector<xla::XlaOp> outputs;
+    for (size_t i = 0; i < root->num_outputs(); ++i) {
+      outputs.push_back(subgraph_ctx.GetOutputOp(Output(root, i)));
+    }
+    xla::XlaOp result = outputs.size() == 1
+                            ? outputs.front()
+                            : xla::Tuple(subgraph_ctx.builder(), outputs);
+    xla::XlaComputation computation =
+        ConsumeValue(subgraph_ctx.Build(result));
+    it = subgraph_computations_.emplace(key, std::move(computation)).first;
+    XLA_COUNTER("IrLoweringCacheSubgraphs", 1);
+  } else {
+    ++num_reused_subgraphs_;
+    XLA_COUNTER("IrLoweringCacheReuse", 1);
+  }
+  std::vector<xla::XlaOp> operands;
+  for (auto node : post_order) {
+    if (IsSubgraphParameter(node, root)) {
+      operands.push_back(GetOutputOp(Output(node, 0)));
+    }
+  }
+  xla::XlaOp call = xla::Call(builder(), it->second, operands);
+  if (root->num_outputs() == 1) {
+    AssignOutputOp(Output(root, 0), call);
+  } else {
+    for (size_t i = 0; i < root->num_outputs(); ++i) {
+      AssignOutputOp(Output(root, i), xla::GetTupleElement(call, i));
+    }
+  }
+}
+
 void LoweringContext::ReportBuilderError(const Node* node,
                                          const char* error_msg) {
   std::stringstream ss;
@@ -132,7 +609,9 @@ void LoweringContext::ReportBuilderError(const Node* node,
   if (error_msg != nullptr) {
     ss << "Error: " << error_msg << "\n";
   }
-  ss << node->metadata().frame_info;
+  if (node->metadata().frame_info != nullptr) {
+    ss << *node->metadata().frame_info;
+  }
   throw std::runtime_error(ss.str());
 }
 
@@ -12,6 +12,7 @@
 #include "tensorflow/core/lib/gtl/array_slice.h"
 #include "tensorflow/core/platform/macros.h"
 #include "torch_xla/csrc/ir.h"
+#include "torch_xla/csrc/ir_optimizer.h"
 #include "torch_xla/csrc/ir_util.h"
 
 namespace torch_xla {
@@ -29,6 +30,11 @@ class LoweringContext {
   xla::XlaOp GetParameter(
       const std::shared_ptr<xla::ComputationClient::Data>& data);
 
+  // Makes GetParameter() lower the given data as a constant holding the value,
+  // instead of as a parameter. The literal must outlive the lowering.
+  void SetConstantData(const xla::ComputationClient::DataPtr& data,
+                       const xla::Literal* literal);
+
   // Retrieves the vector holding all the tensors associated with the parameter
   // instructions which have been created.
   const std::vector<xla::ComputationClient::DataPtr>& GetParametersData()
@@ -44,6 +50,18 @@ class LoweringContext {
   // operands among the emitted outputs.
   void AssignOutputOp(const Output& output, xla::XlaOp op);
 
+  // Binds the output to an operation computed outside of the graph being
+  // lowered (like a parameter fed by a previous computation), so that the
+  // lowering stops at its node instead of emitting the graph behind it.
+  void AssignExternalOutputOp(const Output& output, xla::XlaOp op);
+
+  // Whether the output has been bound with AssignExternalOutputOp().
+  bool IsExternalOutput(const Output& output) const;
+
+  // Whether the operation of the output has already been emitted, so that
+  // GetOutputOp() returns it without lowering anything.
+  bool IsOutputEmitted(const Output& output) const;
+
   // Retrieves the lowered operation for a output. If the requested output is
   // not available yet, the graph behind the output's Node is lowered, and the
   // corresponding XLA operation returned.
@@ -63,7 +81,65 @@ class LoweringContext {
   // before calling this API. Returns the generated XLA operations.
   XlaOpVector LowerNode(const Node* node);
 
+  // Lowers all the nodes of the given post-order, applying the optimizations
+  // computed by the ir::Optimizer class. The outputs of the nodes can then be
+  // fetched with the GetOutputOp() API.
+  void LowerOptimized(
+      tensorflow::gtl::ArraySlice<const Node* const> post_order);
+
+  // Lowers all the nodes of the given post-order, emitting structurally
+  // identical subgraphs only once, as XLA computations invoked with xla::Call.
+  // Only subgraphs with at least min_nodes nodes, whose inner nodes are used
+  // only within the subgraph itself, are considered. The subgraphs stop at
+  // device data and at the outputs of previous repetitions, which become the
+  // parameters of the subgraph computation. The roots are the nodes whose
+  // outputs are going to be fetched with the GetOutputOp() API.
+  void LowerCachingSubgraphs(
+      tensorflow::gtl::ArraySlice<const Node* const> post_order,
+      tensorflow::gtl::ArraySlice<const Node* const> roots, size_t min_nodes);
+
+  // Lowers all the nodes of the given post-order, in parallel over up to
+  // num_tasks threads. The graph is split into its components, the sets of
+  // nodes connected by anything other than leaves (like device data and
+  // constants), which are distributed among the tasks. Every task lowers its
+  // components into a separate XLA computation, invoked with xla::Call. Graphs
+  // with a single component are left to the usual lowering. The roots are the
+  // nodes whose outputs are going to be fetched with the GetOutputOp() API.
+  void LowerParallel(tensorflow::gtl::ArraySlice<const Node* const> post_order,
+                     tensorflow::gtl::ArraySlice<const Node* const> roots,
+                     size_t num_tasks);
+
+  // The number of subgraphs which have been lowered by calling an already
+  // built subgraph computation.
+  size_t num_reused_subgraphs() const { return num_reused_subgraphs_; }
+
+  // Whether repeated subgraphs should be lowered as calls
+  // (XLA_IR_LOWERING_CACHE).
+  static bool IsSubgraphCacheEnabled();
+
+  // The minimum size of the subgraphs lowered as calls
+  // (XLA_IR_LOWERING_CACHE_MIN_NODES).
+  static size_t GetSubgraphCacheMinNodes();
+
+  // Whether the graphs should be lowered with LowerParallel()
+  // (XLA_IR_PARALLEL_LOWERING).
+  static bool IsParallelLoweringEnabled();
+
+  // The minimum size of the graphs lowered in parallel
+  // (XLA_IR_PARALLEL_LOWERING_MIN_NODES).
+  static size_t GetParallelLoweringMinNodes();
+
+  // The maximum number of parallel lowering tasks
+  // (XLA_IR_PARALLEL_LOWERING_TASKS).
+  static size_t GetParallelLoweringTasks();
+
  private:
+  // Lowers the subgraph with the given post-order, whose leaves are its
+  // parameters, using the cached computation for the given key. The
+  // computation is built with a separate builder at the first use.
+  void LowerSubgraph(tensorflow::gtl::ArraySlice<const Node* const> post_order,
+                     size_t key);
+
   // Reports an XLA builder error for the given node.
   TF_ATTRIBUTE_NORETURN void ReportBuilderError(const Node* node,
                                                 const char* error_msg);
@@ -71,9 +147,18 @@ class LoweringContext {
   xla::XlaBuilder builder_;
   std::vector<xla::ComputationClient::DataPtr> parameters_;
   std::unordered_map<xla::ComputationClient::Data*, xla::XlaOp> parameters_map_;
+  std::unordered_map<xla::ComputationClient::Data*, const xla::Literal*>
+      constant_data_;
   std::vector<xla::XlaOp> root_tuple_;
   OutputMap<xla::XlaOp> emitted_outputs_;
+  OutputSet external_outputs_;
   Util::EmissionMap emit_status_;
+  // Owns the folded nodes which have been lowered in place of graph ones.
+  std::unique_ptr<Optimizer> optimizer_;
+  // The subgraph computations built by LowerCachingSubgraphs(), by structural
+  // key.
+  std::unordered_map<size_t, xla::XlaComputation> subgraph_computations_;
+  size_t num_reused_subgraphs_ = 0;
 };
 
 }  // namespace ir
@@ -0,0 +1,37 @@
+#include "torch_xla/csrc/mapped_file.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstring>
+
+#include "tensorflow/compiler/xla/xla_client/debug_macros.h"
+
+namespace torch_xla {
+
+MappedFile::MappedFile(const std::string& path) : path_(path) {
+  int fd = open(path.c_str(), O_RDONLY);
+  XLA_CHECK_GE(fd, 0) << "Unable to open " << path << ": "
+                      << std::strerror(errno);
+  struct stat file_stat;
+  int status = fstat(fd, &file_stat);
+  if (status == 0) {
+    size_ = file_stat.st_size;
+    data_ = size_ > 0 ? mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0)
+                      : nullptr;
+  }
+  close(fd);
+  XLA_CHECK(status == 0 && data_ != MAP_FAILED)
+      << "Unable to map " << path << ": " << std::strerror(errno);
+}
+
+MappedFile::~MappedFile() {
+  if (data_ != nullptr) {
+    munmap(data_, size_);
+  }
+}
+
+}  // namespace torch_xla
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+namespace torch_xla {
+
+// A read only memory mapping of a whole file. The pages are only read from
+// disk once they are accessed.
+class MappedFile {
+ public:
+  explicit MappedFile(const std::string& path);
+
+  MappedFile(const MappedFile&) = delete;
+
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  ~MappedFile();
+
+  const char* data() const { return static_cast<const char*>(data_); }
+
+  size_t size() const { return size_; }
+
+  const std::string& path() const { return path_; }
+
+ private:
+  std::string path_;
+  void* data_ = nullptr;
+  size_t size_ = 0;
+};
+
+}  // namespace torch_xla
@@ -0,0 +1,153 @@
+#include "torch_xla/csrc/multi_step.h"
+
+#include "absl/strings/str_cat.h"
+#include "tensorflow/compiler/xla/shape_util.h"
+#include "tensorflow/compiler/xla/xla_client/debug_macros.h"
+#include "torch_xla/csrc/helpers.h"
+
+namespace torch_xla {
+namespace {
+
+// The loop state is the step counter, followed by the step parameters, the
+// step outputs (of the last iteration) and the stacked inputs.
+struct LoopState {
+  size_t num_parameters = 0;
+  size_t num_outputs = 0;
+  size_t num_stacked = 0;
+
+  xla::int64 ParameterIndex(size_t i) const { return 1 + i; }
+
+  xla::int64 OutputIndex(size_t i) const { return 1 + num_parameters + i; }
+
+  xla::int64 StackedIndex(size_t i) const {
+    return 1 + num_parameters + num_outputs + i;
+  }
+};
+
+xla::XlaOp GetStepSlice(const xla::XlaOp& stacked, const xla::Shape& shape,
+                        const xla::XlaOp& counter,
+                        const xla::Shape& step_shape) {
+  std::vector<xla::XlaOp> start_indices(
+      shape.rank(), XlaHelpers::ScalarValue<xla::int32>(0, counter.builder()));
+  start_indices[0] = counter;
+  std::vector<xla::int64> slice_sizes(shape.dimensions().begin(),
+                                      shape.dimensions().end());
+  slice_sizes[0] = 1;
+  return xla::Reshape(xla::DynamicSlice(stacked, start_indices, slice_sizes),
+                      step_shape.dimensions());
+}
+
+xla::XlaComputation BuildCondition(const xla::Shape& state_shape,
+                                   xla::int64 num_steps) {
+  xla::XlaBuilder builder("MultiStepCondition");
+  xla::XlaOp state = xla::Parameter(&builder, 0, state_shape, "state");
+  xla::Lt(xla::GetTupleElement(state, 0),
+          XlaHelpers::ScalarValue<xla::int32>(num_steps, &builder));
+  return ConsumeValue(builder.Build());
+}
+
+xla::XlaComputation BuildBody(
+    const xla::XlaComputation& step_computation,
+    const xla::ProgramShape& program_shape, const xla::Shape& state_shape,
+    const LoopState& loop_state,
+    tensorflow::gtl::ArraySlice<const xla::Shape> stacked_shapes,
+    tensorflow::gtl::ArraySlice<const xla::int64> input_parameters,
+    tensorflow::gtl::ArraySlice<const xla::int64> output_parameters) {
+  xla::XlaBuilder builder("MultiStepBody");
+  xla::XlaOp state = xla::Parameter(&builder, 0, state_shape, "state");
+  xla::XlaOp counter = xla::GetTupleElement(state, 0);
+  std::vector<xla::XlaOp> parameters;
+  for (size_t i = 0; i < loop_state.num_parameters; ++i) {
+    parameters.push_back(
+        xla::GetTupleElement(state, loop_state.ParameterIndex(i)));
+  }
+  std::vector<xla::XlaOp> stacked;
+  std::vector<xla::XlaOp> step_parameters = parameters;
+  for (size_t i = 0; i < loop_state.num_stacked; ++i) {
+    stacked.push_back(xla::GetTupleElement(state, loop_state.StackedIndex(i)));
+    if (input_parameters[i] >= 0) {
+      step_parameters[input_parameters[i]] =
+          GetStepSlice(stacked.back(), stacked_shapes[i], counter,
+                       program_shape.parameters(input_parameters[i]));
+    }
+  }
+  xla::XlaOp step_results =
+      xla::Call(&builder, step_computation, step_parameters);
+  std::vector<xla::XlaOp> outputs;
+  for (size_t i = 0; i < loop_state.num_outputs; ++i) {
+    outputs.push_back(xla::GetTupleElement(step_results, i));
+    if (output_parameters[i] >= 0) {
+      parameters[output_parameters[i]] = outputs.back();
+    }
+  }
+  std::vector<xla::XlaOp> next_state(
+      {counter + XlaHelpers::ScalarValue<xla::int32>(1, &builder)});
+  next_state.insert(next_state.end(), parameters.begin(), parameters.end());
+  next_state.insert(next_state.end(), outputs.begin(), outputs.end());
+  next_state.insert(next_state.end(), stacked.begin(), stacked.end());
+  xla::Tuple(&builder, next_state);
+  return ConsumeValue(builder.Build());
+}
+
+}  // namespace
+
+xla::XlaComputation BuildMultiStepComputation(
+    const xla::XlaComputation& step_computation,
+    tensorflow::gtl::ArraySlice<const xla::Shape> stacked_shapes,
+    tensorflow::gtl::ArraySlice<const xla::int64> input_parameters,
+    tensorflow::gtl::ArraySlice<const xla::int64> output_parameters,
+    xla::int64 num_steps) {
+  xla::ProgramShape program_shape =
+      ConsumeValue(step_computation.GetProgramShape());
+  const xla::Shape& result_shape = program_shape.result();
+  XLA_CHECK(result_shape.IsTuple()) << result_shape;
+  LoopState loop_state;
+  loop_state.num_parameters = program_shape.parameters_size();
+  loop_state.num_outputs = xla::ShapeUtil::TupleElementCount(result_shape);
+  loop_state.num_stacked = stacked_shapes.size();
+  XLA_CHECK_EQ(input_parameters.size(), loop_state.num_stacked);
+  XLA_CHECK_EQ(output_parameters.size(), loop_state.num_outputs);
+
+  std::vector<xla::Shape> state_shapes(
+      {xla::ShapeUtil::MakeShape(xla::PrimitiveType::S32, {})});
+  state_shapes.insert(state_shapes.end(), program_shape.parameters().begin(),
+                      program_shape.parameters().end());
+  state_shapes.insert(state_shapes.end(), result_shape.tuple_shapes().begin(),
+                      result_shape.tuple_shapes().end());
+  state_shapes.insert(state_shapes.end(), stacked_shapes.begin(),
+                      stacked_shapes.end());
+  xla::Shape state_shape = xla::ShapeUtil::MakeTupleShape(state_shapes);
+
+  xla::XlaBuilder builder("MultiStepGraph");
+  std::vector<xla::XlaOp> init_state(
+      {XlaHelpers::ScalarValue<xla::int32>(0, &builder)});
+  for (size_t i = 0; i < loop_state.num_parameters; ++i) {
+    init_state.push_back(
+        xla::Parameter(&builder, i, program_shape.parameters(i),
+                       absl::StrCat("p", i)));
+  }
+  // The outputs are only read after the last iteration, so their initial
+  // values do not matter.
+  for (auto& output_shape : result_shape.tuple_shapes()) {
+    init_state.push_back(
+        XlaHelpers::ScalarBroadcast<xla::int32>(0, output_shape, &builder));
+  }
+  for (size_t i = 0; i < loop_state.num_stacked; ++i) {
+    init_state.push_back(xla::Parameter(
+        &builder, loop_state.num_parameters + i, stacked_shapes[i],
+        absl::StrCat("stacked", i)));
+  }
+  xla::XlaOp loop = xla::While(
+      BuildCondition(state_shape, num_steps),
+      BuildBody(step_computation, program_shape, state_shape, loop_state,
+                stacked_shapes, input_parameters, output_parameters),
+      xla::Tuple(&builder, init_state));
+  std::vector<xla::XlaOp> results;
+  for (size_t i = 0; i < loop_state.num_outputs; ++i) {
+    results.push_back(xla::GetTupleElement(loop, loop_state.OutputIndex(i)));
+  }
+  xla::Tuple(&builder, results);
+  return ConsumeValue(builder.Build());
+}
+
+}  // namespace torch_xla
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <vector>
+
+#include "tensorflow/compiler/xla/client/xla_builder.h"
+#include "tensorflow/compiler/xla/types.h"
+#include "tensorflow/core/lib/gtl/array_slice.h"
+
+namespace torch_xla {
+
+// Wraps the computation of a single traced step within an XLA While loop
+// running num_steps iterations. The returned computation has the parameters
+// of the step computation, followed by the stacked inputs, whose outer
+// dimension is num_steps. At iteration k, the step parameter with index
+// input_parameters[i] (if not negative) is replaced with the k-th slice of the
+// i-th stacked input, and the step output with index j is fed back to the step
+// parameter with index output_parameters[j] (if not negative) of the following
+// iteration. The results are the step outputs of the last iteration.
+xla::XlaComputation BuildMultiStepComputation(
+    const xla::XlaComputation& step_computation,
+    tensorflow::gtl::ArraySlice<const xla::Shape> stacked_shapes,
+    tensorflow::gtl::ArraySlice<const xla::int64> input_parameters,
+    tensorflow::gtl::ArraySlice<const xla::int64> output_parameters,
+    xla::int64 num_steps);
+
+}  // namespace torch_xla
@@ -108,6 +108,13 @@ xla::XlaOp BuildNllLoss(const xla::XlaOp& logits, const xla::XlaOp& labels,
   return xla::ReduceAll(mul, zero, add_func) / batch;
 }
 
+xla::XlaOp BuildCrossEntropy(const xla::XlaOp& logits,
+                             const xla::XlaOp& log_sum_exp,
+                             const xla::XlaOp& labels, int ignore_index) {
+  xla::XlaOp log_probs = xla::Sub(logits, log_sum_exp, {0});
+  return BuildNllLoss(log_probs, labels, ignore_index);
+}
+
 // Builds the NLLLoss gradient for log-probabilities "logits" and class indices
 // "labels".
 xla::XlaOp BuildNllLossBackward(const xla::XlaOp& logits,
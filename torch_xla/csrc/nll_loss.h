@@ -8,6 +8,13 @@ namespace torch_xla {
 xla::XlaOp BuildNllLoss(const xla::XlaOp& logits, const xla::XlaOp& labels,
                         int ignore_index);
 
+// Builds the NLLLoss of log_softmax(logits) for class indices "labels", with
+// the log-probabilities computed on the fly from the logits and their
+// log_sum_exp along the class dimension, without materializing them.
+xla::XlaOp BuildCrossEntropy(const xla::XlaOp& logits,
+                             const xla::XlaOp& log_sum_exp,
+                             const xla::XlaOp& labels, int ignore_index);
+
 // Builds the NLLLoss gradient for log-probabilities "logits" and class indices
 // "labels".
 xla::XlaOp BuildNllLossBackward(const xla::XlaOp& logits,
@@ -2,12 +2,16 @@
 
 #include <list>
 #include <unordered_map>
+#include <unordered_set>
 
 #include "absl/strings/str_cat.h"
+#include "absl/strings/str_split.h"
 #include "tensorflow/compiler/xla/client/xla_builder.h"
 #include "tensorflow/compiler/xla/xla_client/debug_macros.h"
 #include "tensorflow/compiler/xla/xla_client/metrics.h"
+#include "tensorflow/compiler/xla/xla_client/multi_wait.h"
 #include "tensorflow/compiler/xla/xla_client/sys_util.h"
+#include "tensorflow/compiler/xla/xla_client/thread_pool.h"
 #include "tensorflow/compiler/xla/xla_client/util.h"
 #include "tensorflow/compiler/xla/xla_client/xla_util.h"
 #include "torch_xla/csrc/device.h"
@@ -15,6 +19,7 @@
 #include "torch_xla/csrc/lowering_context.h"
 #include "torch_xla/csrc/ops/device_data.h"
 #include "torch_xla/csrc/tensor_util.h"
+#include "torch_xla/csrc/upload_batcher.h"
 
 namespace torch_xla {
 namespace {
@@ -41,14 +46,14 @@ const xla::Shape& GetParameterShape(const ir::Output& operand,
              : xla::ShapeUtil::GetTupleElementShape(input_shape, operand.index);
 }
 
+// The parameter_shapes argument of the APIs below holds the shapes of the node
+// operands, as seen by the node computation (see GetParameterShape()).
 size_t ComputeNodeKey(
     const ir::Node* node,
-    tensorflow::gtl::ArraySlice<const xla::Shape*> input_shapes) {
+    tensorflow::gtl::ArraySlice<const xla::Shape*> parameter_shapes) {
   size_t key = 0x129b98d6968b7;
-  const auto& operands = node->operands();
-  for (size_t i = 0; i < operands.size(); ++i) {
-    key = xla::util::HashCombine(key, xla::util::ShapeHash(GetParameterShape(
-                                          operands[i], *input_shapes[i])));
+  for (auto parameter_shape : parameter_shapes) {
+    key = xla::util::HashCombine(key, xla::util::ShapeHash(*parameter_shape));
   }
   key = xla::util::HashCombine(key, xla::util::ShapeHash(node->shape()));
   return xla::util::HashCombine(key, node->node_hash());
@@ -56,14 +61,13 @@ size_t ComputeNodeKey(
 
 xla::XlaComputation BuildNodeComputation(
     const ir::Node* node,
-    tensorflow::gtl::ArraySlice<const xla::Shape*> input_shapes,
+    tensorflow::gtl::ArraySlice<const xla::Shape*> parameter_shapes,
     const Device& device) {
   ir::LoweringContext loctx("BuildNodeComputation");
   const auto& operands = node->operands();
   for (size_t i = 0; i < operands.size(); ++i) {
-    xla::XlaOp param = xla::Parameter(
-        loctx.builder(), i, GetParameterShape(operands[i], *input_shapes[i]),
-        absl::StrCat("param_", i));
+    xla::XlaOp param = xla::Parameter(loctx.builder(), i, *parameter_shapes[i],
+                                      absl::StrCat("param_", i));
     loctx.AssignOutputOp(operands[i], param);
   }
   for (auto& xla_op : loctx.LowerNode(node)) {
@@ -72,10 +76,222 @@ xla::XlaComputation BuildNodeComputation(
   return ConsumeValue(loctx.Build());
 }
 
+// The key of the fused computation of the stable nodes, in hybrid mode. The
+// device data hash only includes its shape, so the graph hashes alone do not
+// tell a*a from a*b. The key hashes every node together with the post-order
+// positions of its operands, which captures the mapping of the operands to the
+// computation parameters.
+size_t ComputeFusedKey(
+    tensorflow::gtl::ArraySlice<const ir::Node* const> post_order,
+    tensorflow::gtl::ArraySlice<const ir::Output> outputs) {
+  std::unordered_map<const ir::Node*, size_t> positions;
+  size_t key = 0x3d81b7f52c6e9;
+  for (size_t i = 0; i < post_order.size(); ++i) {
+    const ir::Node* node = post_order[i];
+    positions.emplace(node, i);
+    key = xla::util::HashCombine(key, node->hash());
+    for (auto& operand : node->operands()) {
+      key = xla::util::HashCombine(
+          key, xla::util::HashCombine(positions.at(operand.node),
+                                      operand.index));
+    }
+  }
+  for (auto& output : outputs) {
+    key = xla::util::HashCombine(
+        key, xla::util::HashCombine(positions.at(output.node), output.index));
+  }
+  return key;
+}
+
+// Whether the cached fused computation takes, as parameters, the device data
+// of the post_order argument, so that a key collision does not feed it the
+// wrong inputs.
+bool MatchesFusedParameters(
+    const xla::ComputationClient::Computation& computation,
+    tensorflow::gtl::ArraySlice<const ir::Node* const> post_order) {
+  const xla::ProgramShape& program_shape = computation.program_shape();
+  int num_parameters = 0;
+  for (auto node : post_order) {
+    const ir::ops::DeviceData* device_data =
+        dynamic_cast<const ir::ops::DeviceData*>(node);
+    if (device_data != nullptr) {
+      if (num_parameters >= program_shape.parameters_size() ||
+          !xla::ShapeUtil::Compatible(
+              program_shape.parameters(num_parameters),
+              device_data->data()->shape())) {
+        return false;
+      }
+      ++num_parameters;
+    }
+  }
+  return num_parameters == program_shape.parameters_size();
+}
+
+// Lowers the fused computation of the stable nodes. The post_order argument
+// is the one computed from the outputs nodes, and every device data node
+// within it becomes a parameter of the computation, in post-order.
+xla::XlaComputation BuildFusedComputation(
+    tensorflow::gtl::ArraySlice<const ir::Node* const> post_order,
+    tensorflow::gtl::ArraySlice<const ir::Output> outputs) {
+  ir::LoweringContext loctx("BuildFusedComputation");
+  xla::int64 num_parameters = 0;
+  for (auto node : post_order) {
+    const ir::ops::DeviceData* device_data =
+        dynamic_cast<const ir::ops::DeviceData*>(node);
+    if (device_data != nullptr) {
+      xla::XlaOp param = xla::Parameter(
+          loctx.builder(), num_parameters, device_data->data()->shape(),
+          absl::StrCat("param_", num_parameters));
+      loctx.AssignOutputOp(ir::Output(node), param);
+      ++num_parameters;
+    } else {
+      loctx.LowerNode(node);
+    }
+  }
+  for (auto& output : outputs) {
+    loctx.AddResult(loctx.GetOutputOp(output));
+  }
+  return ConsumeValue(loctx.Build());
+}
+
+std::set<ir::OpKind> ParseOpKinds(const std::string& names) {
+  std::set<ir::OpKind> op_kinds;
+  for (auto& name : absl::StrSplit(names, ',', absl::SkipEmpty())) {
+    op_kinds.insert(ir::OpKind::Get(std::string(name)));
+  }
+  return op_kinds;
+}
+
+// The shape of the computation returned by BuildNodeComputation(), which wraps
+// the node outputs into a tuple.
+xla::Shape GetNodeComputationShape(const ir::Node* node) {
+  return node->num_outputs() > 1 ? node->shape()
+                                 : xla::ShapeUtil::MakeTupleShape(
+                                       {node->shape()});
+}
+
+// Lowers the nodes computations in parallel, storing them within the compile
+// instances.
+void BuildNodeComputations(
+    tensorflow::gtl::ArraySlice<const ir::Node* const> nodes,
+    const std::vector<std::vector<const xla::Shape*>>& input_shapes,
+    const Device& device,
+    std::vector<xla::ComputationClient::CompileInstance>* instances) {
+  XLA_VALUE_METRIC("OpByOpNodeComputations", nodes.size());
+  xla::util::MultiWait mwait(nodes.size());
+  for (size_t i = 0; i < nodes.size(); ++i) {
+    auto builder = [&, i]() {
+      xla::XlaComputation computation =
+          BuildNodeComputation(nodes[i], input_shapes[i], device);
+      xla::ProgramShape program_shape =
+          ConsumeValue(computation.GetProgramShape());
+      XLA_CHECK(xla::ShapeUtil::Compatible(program_shape.result(),
+                                           *(*instances)[i].output_shape))
+          << nodes[i]->ToString() << ": " << program_shape.result() << " vs "
+          << *(*instances)[i].output_shape;
+      (*instances)[i].computation = std::move(computation);
+    };
+    xla::env::ScheduleClosure(mwait.Completer(std::move(builder)));
+  }
+  mwait.Wait();
+}
+
+size_t ComputeChainKey(tensorflow::gtl::ArraySlice<const ir::Value> roots,
+                       const std::string& device,
+                       tensorflow::gtl::ArraySlice<const std::string> devices,
+                       bool hybrid_mode) {
+  size_t key = xla::util::HashCombine(xla::util::Hash(device),
+                                      xla::util::ContainerHash(devices));
+  key = xla::util::HashCombine(key, hybrid_mode);
+  for (auto& root : roots) {
+    key = xla::util::HashCombine(key, root.hash());
+  }
+  return key;
+}
+
 }  // namespace
 
-OpByOpExecutor::OpByOpExecutor(size_t compile_cache_size)
-    : compile_cache_(compile_cache_size) {}
+OpByOpExecutor::OpByOpExecutor(size_t compile_cache_size,
+                               size_t chain_cache_size, bool hybrid_mode,
+                               std::set<ir::OpKind> volatile_ops)
+    : compile_cache_(compile_cache_size),
+      chain_cache_(chain_cache_size),
+      hybrid_mode_(hybrid_mode),
+      volatile_ops_(std::move(volatile_ops)) {}
+
+std::unordered_set<const ir::Node*> OpByOpExecutor::GetStableNodes(
+    tensorflow::gtl::ArraySlice<const ir::Node* const> post_order) const {
+  std::unordered_set<const ir::Node*> stable_nodes;
+  for (auto node : post_order) {
+    if (dynamic_cast<const ir::ops::DeviceData*>(node) != nullptr ||
+        volatile_ops_.count(node->op()) > 0) {
+      continue;
+    }
+    bool stable = true;
+    for (auto& operand : node->operands()) {
+      if (stable_nodes.count(operand.node) == 0 &&
+          dynamic_cast<const ir::ops::DeviceData*>(operand.node) == nullptr) {
+        stable = false;
+        break;
+      }
+    }
+    if (stable) {
+      stable_nodes.insert(node);
+    }
+  }
+  return stable_nodes;
+}
+
+std::vector<xla::ComputationClient::ExecuteChainedOp>
+OpByOpExecutor::GetCachedChain(
+    size_t chain_key,
+    tensorflow::gtl::ArraySlice<const ir::Node* const> post_order) {
+  std::vector<xla::ComputationClient::ExecuteChainedOp> chained_exec_ops;
+  ChainCache::TypePtr cached_chain = chain_cache_.Get(chain_key);
+  if (cached_chain == nullptr) {
+    return chained_exec_ops;
+  }
+  if (cached_chain->node_hashes.size() != post_order.size()) {
+    XLA_COUNTER("OpByOpChainCacheMismatch", 1);
+    return chained_exec_ops;
+  }
+  for (size_t i = 0; i < post_order.size(); ++i) {
+    if (cached_chain->node_hashes[i] != post_order[i]->hash()) {
+      XLA_COUNTER("OpByOpChainCacheMismatch", 1);
+      return chained_exec_ops;
+    }
+  }
+  chained_exec_ops = cached_chain->ops;
+  for (auto& op_node_indices : cached_chain->device_data_indices) {
+    const ir::Node* node = post_order[op_node_indices.second];
+    const ir::ops::DeviceData* device_data =
+        dynamic_cast<const ir::ops::DeviceData*>(node);
+    XLA_CHECK(device_data != nullptr) << node->ToString();
+    chained_exec_ops[op_node_indices.first].device_data = device_data->data();
+  }
+  return chained_exec_ops;
+}
+
+void OpByOpExecutor::CacheChain(
+    size_t chain_key,
+    tensorflow::gtl::ArraySlice<const ir::Node* const> post_order,
+    const std::vector<xla::ComputationClient::ExecuteChainedOp>& ops,
+    tensorflow::gtl::ArraySlice<const size_t> ops_node_indices) {
+  auto cached_chain = std::make_shared<CachedChain>();
+  cached_chain->ops = ops;
+  cached_chain->node_hashes.reserve(post_order.size());
+  for (auto node : post_order) {
+    cached_chain->node_hashes.push_back(node->hash());
+  }
+  for (size_t i = 0; i < cached_chain->ops.size(); ++i) {
+    if (cached_chain->ops[i].device_data != nullptr) {
+      // Do not keep the device data alive from within the cache.
+      cached_chain->ops[i].device_data = nullptr;
+      cached_chain->device_data_indices.emplace_back(i, ops_node_indices[i]);
+    }
+  }
+  chain_cache_.Add(chain_key, std::move(cached_chain));
+}
 
 std::vector<xla::ComputationClient::ExecuteChainedOp> OpByOpExecutor::BuildOps(
     tensorflow::gtl::ArraySlice<const ir::Value> roots,
@@ -90,85 +306,238 @@ std::vector<xla::ComputationClient::ExecuteChainedOp> OpByOpExecutor::BuildOps(
       ir::Util::ComputePostOrder(root_nodes);
   XLA_VALUE_METRIC("OpByOpPostOrderSize", post_order.size());
 
+  // The same graph is usually executed step after step, so try to reuse the
+  // whole chain first, and only bind the device data to it.
+  bool hybrid_mode = hybrid_mode_;
+  size_t chain_key = ComputeChainKey(roots, device, devices, hybrid_mode);
+  std::vector<xla::ComputationClient::ExecuteChainedOp> cached_exec_ops =
+      GetCachedChain(chain_key, post_order);
+  if (!cached_exec_ops.empty()) {
+    XLA_COUNTER("OpByOpChainCacheHit", 1);
+    return cached_exec_ops;
+  }
+  XLA_COUNTER("OpByOpChainCacheMiss", 1);
+
   std::unordered_map<const ir::Node*, size_t> node_to_index;
   node_to_index.reserve(post_order.size());
   for (size_t i = 0; i < post_order.size(); ++i) {
     node_to_index[post_order[i]] = i;
   }
+  std::unordered_set<const ir::Node*> stable_nodes;
+  if (hybrid_mode) {
+    stable_nodes = GetStableNodes(post_order);
+  }
 
   Device exec_device(device);
   std::vector<size_t> cache_keys;
   std::unordered_map<size_t, std::vector<size_t>> compile_indices;
   std::unordered_map<size_t, size_t> cache_keys_instance;
   std::list<xla::Shape> compile_shapes;
-  std::vector<bool> device_data_ops(post_order.size());
-  std::vector<const xla::Shape*> ops_shapes(post_order.size());
+  // The nodes to be lowered (one per compile instance), with their parameters
+  // shapes.
+  std::vector<const ir::Node*> compile_nodes;
+  std::vector<std::vector<const xla::Shape*>> compile_parameter_shapes;
   std::vector<xla::ComputationClient::CompileInstance> compile_instances;
-  std::vector<xla::ComputationClient::ExecuteChainedOp> chained_exec_ops(
-      post_order.size());
+  // The op index of every node within the post-order. Stable nodes have no op
+  // of their own, as their outputs are produced by the fused op.
+  std::vector<size_t> node_ops(post_order.size());
+  // The post-order index of the node every op has been built from.
+  std::vector<size_t> ops_node_indices;
+  std::vector<bool> device_data_ops;
+  std::vector<const xla::Shape*> ops_shapes;
+  std::vector<xla::ComputationClient::ExecuteChainedOp> chained_exec_ops;
+  chained_exec_ops.reserve(post_order.size());
+  auto add_op = [&](xla::ComputationClient::ExecuteChainedOp cxop,
+                    size_t node_index, bool is_device_data,
+                    const xla::Shape* shape) {
+    node_ops[node_index] = chained_exec_ops.size();
+    chained_exec_ops.push_back(std::move(cxop));
+    ops_node_indices.push_back(node_index);
+    device_data_ops.push_back(is_device_data);
+    ops_shapes.push_back(shape);
+  };
+
+  // The device data ops go first, so that the fused op, if any, can be placed
+  // right after them.
   for (size_t i = 0; i < post_order.size(); ++i) {
-    const ir::Node* node = post_order[i];
-    xla::ComputationClient::ExecuteChainedOp& cxop = chained_exec_ops[i];
     const ir::ops::DeviceData* device_data =
-        dynamic_cast<const ir::ops::DeviceData*>(node);
+        dynamic_cast<const ir::ops::DeviceData*>(post_order[i]);
     if (device_data != nullptr) {
+      xla::ComputationClient::ExecuteChainedOp cxop;
       cxop.device_data = device_data->data();
-      ops_shapes[i] = &cxop.device_data->shape();
-      device_data_ops[i] = true;
-    } else {
-      std::vector<const xla::Shape*> op_input_shapes;
-      for (auto& operand : node->operands()) {
-        size_t op_index = node_to_index.at(operand.node);
+      const xla::Shape* shape = &cxop.device_data->shape();
+      add_op(std::move(cxop), i, /*is_device_data=*/true, shape);
+    }
+  }
+
+  // The outputs of the stable nodes consumed by the other nodes, or by the
+  // roots, become the outputs of the fused op.
+  std::vector<ir::Output> fused_outputs;
+  ir::OutputMap<size_t> fused_outputs_index;
+  size_t fused_op_index = 0;
+  const xla::Shape* fused_shape = nullptr;
+  // At most one fused compile instance, with its cache key.
+  std::vector<size_t> fused_keys;
+  std::vector<xla::ComputationClient::CompileInstance> fused_instances;
+  if (!stable_nodes.empty()) {
+    auto add_fused_output = [&](const ir::Output& output) {
+      if (stable_nodes.count(output.node) > 0 &&
+          fused_outputs_index.emplace(output, fused_outputs.size()).second) {
+        fused_outputs.push_back(output);
+      }
+    };
+    for (auto node : post_order) {
+      if (stable_nodes.count(node) == 0) {
+        for (auto& operand : node->operands()) {
+          add_fused_output(operand);
+        }
+      }
+    }
+    for (auto& root : roots) {
+      add_fused_output(ir::Output(root.node.get(), root.index));
+    }
+    XLA_VALUE_METRIC("OpByOpFusedNodes", stable_nodes.size());
+
+    // The fused computation only depends on the stable nodes and on the device
+    // data feeding them, which become its parameters.
+    std::vector<const ir::Node*> fused_roots;
+    for (auto& output : fused_outputs) {
+      fused_roots.push_back(output.node);
+    }
+    std::vector<const ir::Node*> fused_post_order =
+        ir::Util::ComputePostOrder(fused_roots);
+
+    xla::ComputationClient::ExecuteChainedOp cxop;
+    for (auto node : fused_post_order) {
+      if (stable_nodes.count(node) == 0) {
         cxop.inputs.push_back(
-            {op_index,
-             GetOutputIndex(device_data_ops[op_index], operand.index)});
-        op_input_shapes.push_back(ops_shapes[op_index]);
+            {node_ops[node_to_index.at(node)], absl::nullopt});
       }
+    }
+    size_t fused_cache_key = ComputeFusedKey(fused_post_order, fused_outputs);
+    cxop.computation = compile_cache_.Get(fused_cache_key);
+    if (cxop.computation != nullptr &&
+        !MatchesFusedParameters(*cxop.computation, fused_post_order)) {
+      XLA_COUNTER("OpByOpFusedCompileCacheCollision", 1);
+      cxop.computation = nullptr;
+    }
+    if (cxop.computation == nullptr) {
+      XLA_COUNTER("OpByOpFusedCompileCacheMiss", 1);
+      xla::XlaComputation computation =
+          BuildFusedComputation(fused_post_order, fused_outputs);
+      xla::ProgramShape program_shape =
+          ConsumeValue(computation.GetProgramShape());
+      compile_shapes.push_back(MakeShapeWithDeviceLayout(
+          program_shape.result(), exec_device.hw_type));
+      fused_shape = &compile_shapes.back();
+      fused_keys.push_back(fused_cache_key);
+      fused_instances.push_back(
+          {std::move(computation), device,
+           xla::ComputationClient::Get()->GetCompilationDevices(device,
+                                                                devices),
+           fused_shape});
+      compile_indices[fused_cache_key].push_back(chained_exec_ops.size());
+    } else {
+      XLA_COUNTER("OpByOpFusedCompileCacheHit", 1);
+      fused_shape = &cxop.computation->program_shape().result();
+    }
+    fused_op_index = chained_exec_ops.size();
+    add_op(std::move(cxop), node_to_index.at(fused_roots.front()),
+           /*is_device_data=*/false, fused_shape);
+  }
 
-      size_t cache_key = ComputeNodeKey(node, op_input_shapes);
-      cxop.computation = compile_cache_.Get(cache_key);
-      if (cxop.computation == nullptr) {
-        XLA_COUNTER("OpByOpCompileCacheMiss", 1);
-
-        // Within a single IR graph, there can be many duplicated IR nodes, so
-        // make sure we do not issue an XLA compilation for each one of those.
-        auto& cache_key_indices = compile_indices[cache_key];
-        cache_key_indices.push_back(i);
-        if (cache_key_indices.size() == 1) {
-          cache_keys.push_back(cache_key);
-          cache_keys_instance[cache_key] = compile_instances.size();
-
-          xla::XlaComputation computation =
-              BuildNodeComputation(node, op_input_shapes, exec_device);
-          xla::ProgramShape program_shape =
-              ConsumeValue(computation.GetProgramShape());
-          compile_shapes.push_back(MakeShapeWithDeviceLayout(
-              program_shape.result(), exec_device.hw_type));
-          compile_instances.push_back(
-              {std::move(computation), device,
-               xla::ComputationClient::Get()->GetCompilationDevices(device,
-                                                                    devices),
-               &compile_shapes.back()});
-
-          ops_shapes[i] = &compile_shapes.back();
-        } else {
-          ops_shapes[i] =
-              compile_instances[cache_keys_instance.at(cache_key)].output_shape;
+  // Resolves the op producing the given operand, with the shape the operand
+  // has as parameter of a node computation.
+  auto get_operand_input =
+      [&](const ir::Output& operand,
+          xla::ComputationClient::ExecuteChainedOp::Input* input) {
+        if (stable_nodes.count(operand.node) > 0) {
+          size_t output_index = fused_outputs_index.at(operand);
+          *input = {fused_op_index, output_index};
+          return &xla::ShapeUtil::GetTupleElementShape(*fused_shape,
+                                                       output_index);
         }
+        size_t op_index = node_ops[node_to_index.at(operand.node)];
+        *input = {op_index,
+                  GetOutputIndex(device_data_ops[op_index], operand.index)};
+        return &GetParameterShape(operand, *ops_shapes[op_index]);
+      };
+
+  for (size_t i = 0; i < post_order.size(); ++i) {
+    const ir::Node* node = post_order[i];
+    if (stable_nodes.count(node) > 0 ||
+        dynamic_cast<const ir::ops::DeviceData*>(node) != nullptr) {
+      continue;
+    }
+    xla::ComputationClient::ExecuteChainedOp cxop;
+    std::vector<const xla::Shape*> op_parameter_shapes;
+    for (auto& operand : node->operands()) {
+      xla::ComputationClient::ExecuteChainedOp::Input input;
+      op_parameter_shapes.push_back(get_operand_input(operand, &input));
+      cxop.inputs.push_back(input);
+    }
+
+    const xla::Shape* op_shape = nullptr;
+    size_t cache_key = ComputeNodeKey(node, op_parameter_shapes);
+    cxop.computation = compile_cache_.Get(cache_key);
+    if (cxop.computation == nullptr) {
+      XLA_COUNTER("OpByOpCompileCacheMiss", 1);
+
+      // Within a single IR graph, there can be many duplicated IR nodes, so
+      // make sure we do not issue an XLA compilation for each one of those.
+      auto& cache_key_indices = compile_indices[cache_key];
+      cache_key_indices.push_back(chained_exec_ops.size());
+      if (cache_key_indices.size() == 1) {
+        cache_keys.push_back(cache_key);
+        cache_keys_instance[cache_key] = compile_instances.size();
+
+        // The node lowering happens later, in parallel, so the output shape of
+        // the node computation is derived from the node's one.
+        compile_shapes.push_back(MakeShapeWithDeviceLayout(
+            GetNodeComputationShape(node), exec_device.hw_type));
+        compile_instances.push_back(
+            {xla::XlaComputation(), device,
+             xla::ComputationClient::Get()->GetCompilationDevices(device,
+                                                                  devices),
+             &compile_shapes.back()});
+        compile_nodes.push_back(node);
+        compile_parameter_shapes.push_back(std::move(op_parameter_shapes));
+
+        op_shape = &compile_shapes.back();
       } else {
-        ops_shapes[i] = &cxop.computation->program_shape().result();
+        op_shape =
+            compile_instances[cache_keys_instance.at(cache_key)].output_shape;
       }
+    } else {
+      op_shape = &cxop.computation->program_shape().result();
     }
+    add_op(std::move(cxop), i, /*is_device_data=*/false, op_shape);
   }
   // Fixup the requested outputs (roots) within the chained ops vector.
   for (size_t i = 0; i < roots.size(); ++i) {
-    size_t op_index = node_to_index.at(roots[i].node.get());
-    chained_exec_ops[op_index].outputs.push_back(
-        {i, GetOutputIndex(device_data_ops[op_index], roots[i].index)});
+    const ir::Node* node = roots[i].node.get();
+    if (stable_nodes.count(node) > 0) {
+      chained_exec_ops[fused_op_index].outputs.push_back(
+          {i, fused_outputs_index.at(ir::Output(node, roots[i].index))});
+    } else {
+      size_t op_index = node_ops[node_to_index.at(node)];
+      chained_exec_ops[op_index].outputs.push_back(
+          {i, GetOutputIndex(device_data_ops[op_index], roots[i].index)});
+    }
   }
 
   // If we missed the cache for certain ops, compile them now and fixup the
   // chained ops vector.
+  if (!compile_instances.empty()) {
+    BuildNodeComputations(compile_nodes, compile_parameter_shapes, exec_device,
+                          &compile_instances);
+  }
+  // The fused computation has already been lowered, so it goes after the node
+  // ones.
+  for (size_t i = 0; i < fused_instances.size(); ++i) {
+    cache_keys.push_back(fused_keys[i]);
+    compile_instances.push_back(std::move(fused_instances[i]));
+  }
   if (!compile_instances.empty()) {
     auto computation_ptrs =
         xla::ComputationClient::Get()->Compile(std::move(compile_instances));
@@ -179,6 +548,7 @@ std::vector<xla::ComputationClient::ExecuteChainedOp> OpByOpExecutor::BuildOps(
       }
     }
   }
+  CacheChain(chain_key, post_order, chained_exec_ops, ops_node_indices);
   return chained_exec_ops;
 }
 
@@ -187,6 +557,8 @@ std::vector<xla::ComputationClient::DataPtr> OpByOpExecutor::Execute(
     const std::string& device,
     tensorflow::gtl::ArraySlice<const std::string> devices) {
   auto chained_exec_ops = BuildOps(roots, device, devices);
+  // The device data inputs might include deferred uploads.
+  UploadBatcher::Get()->Flush();
   return xla::ComputationClient::Get()->ExecuteChained(chained_exec_ops,
                                                        device);
 }
@@ -209,8 +581,16 @@ OpByOpExecutor::AsyncTask OpByOpExecutor::ExecuteAsync(
 OpByOpExecutor* OpByOpExecutor::Get() {
   static const xla::int64 compile_cache_size =
       xla::sys_util::GetEnvInt("SPLIT_EXECUTOR_CACHE_SIZE", 2048);
+  static const xla::int64 chain_cache_size =
+      xla::sys_util::GetEnvInt("SPLIT_EXECUTOR_CHAIN_CACHE_SIZE", 256);
+  static const bool hybrid_mode =
+      xla::sys_util::GetEnvBool("SPLIT_EXECUTOR_HYBRID", false);
+  static const std::string volatile_ops = xla::sys_util::GetEnvString(
+      "SPLIT_EXECUTOR_VOLATILE_OPS",
+      "aten::index_select,aten::nonzero,aten::randperm,aten::masked_select");
   static OpByOpExecutor* split_executor =
-      new OpByOpExecutor(compile_cache_size);
+      new OpByOpExecutor(compile_cache_size, chain_cache_size, hybrid_mode,
+                         ParseOpKinds(volatile_ops));
   return split_executor;
 }
 
@@ -1,6 +1,10 @@
 #pragma once
 
+#include <atomic>
+#include <set>
 #include <string>
+#include <unordered_set>
+#include <utility>
 #include <vector>
 
 #include "tensorflow/compiler/xla/types.h"
@@ -16,6 +20,11 @@ namespace torch_xla {
 // allows to run an IR graph is per-IR-node isolation mode. Instead of lowering
 // the whole IR graph in a single XLA computation, the single IR nodes are
 // lowered and executed independently.
+// In hybrid mode, the part of the graph which does not depend on volatile IR
+// nodes (nodes whose shapes or values change from step to step, like
+// data-dependent index selections) is lowered as a single fused computation,
+// and only the remaining nodes are lowered independently. All the computations
+// are still run in a single chained execution.
 class OpByOpExecutor {
  public:
   using AsyncResult = std::vector<xla::ComputationClient::DataPtr>;
@@ -38,13 +47,52 @@ class OpByOpExecutor {
       const std::string& device,
       tensorflow::gtl::ArraySlice<const std::string> devices);
 
+  bool IsHybridMode() const { return hybrid_mode_; }
+
+  void SetHybridMode(bool hybrid_mode) { hybrid_mode_ = hybrid_mode; }
+
  private:
   using CompileCache =
-      xla::util::Cache<size_t, xla::ComputationClient::Computation>;
+      xla::util::ShardedCache<size_t, xla::ComputationClient::Computation>;
+
+  // A chain of operations built for a given graph. The device data operations
+  // have no data within them, as that has to be bound at every execution.
+  struct CachedChain {
+    std::vector<xla::ComputationClient::ExecuteChainedOp> ops;
+    // The graph hash of every node within the post-order the ops have been
+    // built from. Used to verify a chain cache hit.
+    std::vector<size_t> node_hashes;
+    // The (op index, post-order index) pairs of the device data operations.
+    std::vector<std::pair<size_t, size_t>> device_data_indices;
+  };
+
+  using ChainCache = xla::util::Cache<size_t, CachedChain>;
+
+  OpByOpExecutor(size_t compile_cache_size, size_t chain_cache_size,
+                 bool hybrid_mode, std::set<ir::OpKind> volatile_ops);
+
+  // Returns the nodes of the post-order which can be lowered within a single
+  // fused computation, in hybrid mode. Those are the nodes, other than device
+  // data, which do not depend (directly or indirectly) on volatile nodes.
+  std::unordered_set<const ir::Node*> GetStableNodes(
+      tensorflow::gtl::ArraySlice<const ir::Node* const> post_order) const;
+
+  // Returns the ops of the cached chain for the given post-order, with the
+  // device data bound, or an empty vector if no matching chain is cached.
+  std::vector<xla::ComputationClient::ExecuteChainedOp> GetCachedChain(
+      size_t chain_key,
+      tensorflow::gtl::ArraySlice<const ir::Node* const> post_order);
 
-  explicit OpByOpExecutor(size_t compile_cache_size);
+  void CacheChain(
+      size_t chain_key,
+      tensorflow::gtl::ArraySlice<const ir::Node* const> post_order,
+      const std::vector<xla::ComputationClient::ExecuteChainedOp>& ops,
+      tensorflow::gtl::ArraySlice<const size_t> ops_node_indices);
 
   CompileCache compile_cache_;
+  ChainCache chain_cache_;
+  std::atomic<bool> hybrid_mode_;
+  std::set<ir::OpKind> volatile_ops_;
 };
 
 }  // namespace torch_xla
@@ -0,0 +1,187 @@
+#include "torch_xla/csrc/op_profiler.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <map>
+#include <sstream>
+
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_cat.h"
+#include "tensorflow/compiler/xla/xla_client/metrics.h"
+#include "tensorflow/compiler/xla/xla_client/sys_util.h"
+
+namespace torch_xla {
+namespace {
+
+const char* const kOpNamePrefix = "xla_ir.";
+
+// Extracts the IR node ID from the op_name of a profiled HLO operation, which
+// might have been decorated by the profiling tools (like with scopes or the
+// operation type). Returns zero if there is none.
+xla::int64 ParseNodeId(const std::string& op_name) {
+  std::string::size_type pos = op_name.find(kOpNamePrefix);
+  if (pos == std::string::npos) {
+    return 0;
+  }
+  pos += std::strlen(kOpNamePrefix);
+  std::string::size_type end = pos;
+  while (end < op_name.size() && std::isdigit(op_name[end])) {
+    ++end;
+  }
+  xla::int64 id = 0;
+  if (!absl::SimpleAtoi(op_name.substr(pos, end - pos), &id)) {
+    return 0;
+  }
+  return id;
+}
+
+std::string LocationName(const SourceLocation& frame) {
+  return absl::StrCat(frame.function, "@", frame.file, ":", frame.line);
+}
+
+std::string RecordLocation(const OpProfiler::Record& record) {
+  return record.frames.empty() ? std::string("<unknown>")
+                               : LocationName(record.frames.front());
+}
+
+void AppendEntries(const std::map<std::string, xla::int64>& times,
+                   size_t max_entries, std::stringstream* ss) {
+  std::vector<std::pair<std::string, xla::int64>> entries(times.begin(),
+                                                          times.end());
+  std::stable_sort(entries.begin(), entries.end(),
+                   [](const std::pair<std::string, xla::int64>& e1,
+                      const std::pair<std::string, xla::int64>& e2) {
+                     return e1.second > e2.second;
+                   });
+  for (size_t i = 0; i < entries.size() && i < max_entries; ++i) {
+    (*ss) << "  " << xla::metrics::MetricFnTime(entries[i].second) << "  "
+          << entries[i].first << "\n";
+  }
+}
+
+}  // namespace
+
+OpProfiler* OpProfiler::Get() {
+  static OpProfiler* profiler = new OpProfiler();
+  return profiler;
+}
+
+bool OpProfiler::IsEnabled() {
+  static const bool enabled =
+      xla::sys_util::GetEnvBool("XLA_OP_PROFILE", false);
+  return enabled;
+}
+
+xla::int64 OpProfiler::RegisterNode(const ir::Node* node) {
+  static const xla::int64 kMaxNodes =
+      xla::sys_util::GetEnvInt("XLA_OP_PROFILE_MAX_NODES", 1000000);
+  Record record;
+  record.op_type = node->op().ToString();
+  if (node->metadata().frame_info != nullptr) {
+    record.frames = *node->metadata().frame_info;
+  }
+  std::lock_guard<std::mutex> lock(lock_);
+  if (static_cast<xla::int64>(records_.size()) >= kMaxNodes) {
+    XLA_COUNTER("OpProfilerDroppedNodes", 1);
+    return 0;
+  }
+  record.id = next_id_++;
+  xla::int64 id = record.id;
+  records_.emplace(id, std::move(record));
+  return id;
+}
+
+std::string OpProfiler::OpName(xla::int64 id) {
+  return absl::StrCat(kOpNamePrefix, id);
+}
+
+size_t OpProfiler::AddSamples(
+    const std::vector<std::pair<std::string, xla::int64>>& samples) {
+  size_t attributed = 0;
+  std::lock_guard<std::mutex> lock(lock_);
+  for (auto& op_name_time : samples) {
+    auto it = records_.find(ParseNodeId(op_name_time.first));
+    if (it != records_.end()) {
+      it->second.samples += 1;
+      it->second.total_ns += op_name_time.second;
+      ++attributed;
+    } else {
+      unattributed_samples_ += 1;
+      unattributed_ns_ += op_name_time.second;
+    }
+  }
+  return attributed;
+}
+
+std::vector<OpProfiler::Record> OpProfiler::GetRecords() const {
+  std::vector<Record> records;
+  {
+    std::lock_guard<std::mutex> lock(lock_);
+    for (auto& id_record : records_) {
+      if (id_record.second.samples > 0) {
+        records.push_back(id_record.second);
+      }
+    }
+  }
+  std::sort(records.begin(), records.end(),
+            [](const Record& r1, const Record& r2) {
+              return r1.total_ns > r2.total_ns ||
+                     (r1.total_ns == r2.total_ns && r1.id < r2.id);
+            });
+  return records;
+}
+
+std::string OpProfiler::CreateReport(size_t max_entries) const {
+  std::vector<Record> records = GetRecords();
+  std::map<std::string, xla::int64> location_times;
+  std::map<std::string, xla::int64> op_times;
+  xla::int64 total_ns = 0;
+  for (auto& record : records) {
+    location_times[RecordLocation(record)] += record.total_ns;
+    op_times[record.op_type] += record.total_ns;
+    total_ns += record.total_ns;
+  }
+  std::stringstream ss;
+  {
+    std::lock_guard<std::mutex> lock(lock_);
+    ss << "AttributedTime: " << xla::metrics::MetricFnTime(total_ns) << "\n";
+    ss << "UnattributedTime: " << xla::metrics::MetricFnTime(unattributed_ns_)
+       << " (" << unattributed_samples_ << " samples)\n";
+  }
+  ss << "SourceLocations:\n";
+  AppendEntries(location_times, max_entries, &ss);
+  ss << "OpTypes:\n";
+  AppendEntries(op_times, max_entries, &ss);
+  return ss.str();
+}
+
+std::string OpProfiler::CreateFoldedStacks() const {
+  std::vector<Record> records = GetRecords();
+  std::map<std::string, xla::int64> stack_times;
+  for (auto& record : records) {
+    std::string stack;
+    for (auto it = record.frames.rbegin(); it != record.frames.rend(); ++it) {
+      absl::StrAppend(&stack, LocationName(*it), ";");
+    }
+    absl::StrAppend(&stack, record.op_type);
+    stack_times[stack] += record.total_ns;
+  }
+  std::stringstream ss;
+  for (auto& stack_time : stack_times) {
+    ss << stack_time.first << " " << stack_time.second / 1000 << "\n";
+  }
+  return ss.str();
+}
+
+void OpProfiler::Clear() {
+  std::lock_guard<std::mutex> lock(lock_);
+  for (auto& id_record : records_) {
+    id_record.second.samples = 0;
+    id_record.second.total_ns = 0;
+  }
+  unattributed_samples_ = 0;
+  unattributed_ns_ = 0;
+}
+
+}  // namespace torch_xla
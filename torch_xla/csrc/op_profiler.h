@@ -0,0 +1,75 @@
+#pragma once
+
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "tensorflow/compiler/xla/types.h"
+#include "torch_xla/csrc/ir.h"
+#include "torch_xla/csrc/python_util.h"
+
+namespace torch_xla {
+
+// Attributes the device time of the HLO operations to the IR nodes they have
+// been lowered from, and to the Python frames which created them.
+// When enabled (XLA_OP_PROFILE), every lowered IR node gets a compact ID,
+// which is stamped into the op_name metadata of the HLO operations it emits
+// (as "xla_ir.<ID>"), and which survives the XLA passes into the device
+// profiles. The per operation timings of a profile are then fed back with
+// AddSamples(), and aggregated by IR node, and by source location.
+class OpProfiler {
+ public:
+  struct Record {
+    xla::int64 id = 0;
+    std::string op_type;
+    // The Python frames captured at the node creation, innermost first. Empty
+    // if the frame capture policy skipped the node (see XLA_IR_DEBUG).
+    std::vector<SourceLocation> frames;
+    xla::int64 samples = 0;
+    xla::int64 total_ns = 0;
+  };
+
+  static OpProfiler* Get();
+
+  static bool IsEnabled();
+
+  // Registers a node being lowered, and returns its ID.
+  xla::int64 RegisterNode(const ir::Node* node);
+
+  // Returns the op_name metadata of the HLO operations lowered from the node
+  // with the given ID.
+  static std::string OpName(xla::int64 id);
+
+  // Accounts the (op_name, time in nanoseconds) samples of a device profile to
+  // their IR nodes. The samples whose op_name does not carry an IR node ID are
+  // accounted as unattributed. Returns the number of attributed samples.
+  size_t AddSamples(
+      const std::vector<std::pair<std::string, xla::int64>>& samples);
+
+  // Returns the IR node records with samples, sorted by descending time.
+  std::vector<Record> GetRecords() const;
+
+  // Returns a flat profile, with the time of the max_entries most expensive
+  // source locations (the innermost frame of the nodes), and of their IR node
+  // types.
+  std::string CreateReport(size_t max_entries) const;
+
+  // Returns the profile in the folded stacks format of the flame graph tools,
+  // one "outer;...;inner;op_type time_us" line per distinct stack.
+  std::string CreateFoldedStacks() const;
+
+  // Clears the samples. The node registrations are kept, since the IDs are
+  // baked into the cached computations.
+  void Clear();
+
+ private:
+  mutable std::mutex lock_;
+  xla::int64 next_id_ = 1;
+  std::unordered_map<xla::int64, Record> records_;
+  xla::int64 unattributed_samples_ = 0;
+  xla::int64 unattributed_ns_ = 0;
+};
+
+}  // namespace torch_xla
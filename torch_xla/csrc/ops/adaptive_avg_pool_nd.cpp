@@ -0,0 +1,74 @@
+#include "torch_xla/csrc/ops/adaptive_avg_pool_nd.h"
+
+#include "tensorflow/compiler/xla/xla_client/debug_macros.h"
+#include "tensorflow/compiler/xla/xla_client/util.h"
+#include "torch_xla/csrc/lowering_context.h"
+#include "torch_xla/csrc/ops/infer_output_shape.h"
+#include "torch_xla/csrc/pooling.h"
+
+namespace torch_xla {
+namespace ir {
+namespace ops {
+namespace {
+
+xla::Shape NodeOutputShape(
+    const Value& input, xla::int64 spatial_dim_count,
+    tensorflow::gtl::ArraySlice<const xla::int64> output_size) {
+  auto lower_for_shape_fn =
+      [&](tensorflow::gtl::ArraySlice<const xla::XlaOp> operands)
+      -> xla::XlaOp {
+    XLA_CHECK_EQ(operands.size(), 1);
+    return BuildAdaptiveAvgPoolNd(operands[0], spatial_dim_count, output_size);
+  };
+  return InferOutputShape({input.shape()}, lower_for_shape_fn);
+}
+
+c10::Symbol AdaptiveAvgPoolNdSymbol(xla::int64 spatial_dim_count) {
+  switch (spatial_dim_count) {
+    case 1:
+      return at::aten::adaptive_avg_pool1d;
+    case 2:
+      return at::aten::adaptive_avg_pool2d;
+    case 3:
+      return at::aten::adaptive_avg_pool3d;
+    default:
+      XLA_ERROR() << "Invalid number of spatial dimensions: "
+                  << spatial_dim_count;
+  }
+}
+
+}  // namespace
+
+AdaptiveAvgPoolNd::AdaptiveAvgPoolNd(const Value& input,
+                                     xla::int64 spatial_dim_count,
+                                     std::vector<xla::int64> output_size)
+    : Node(ir::OpKind(AdaptiveAvgPoolNdSymbol(spatial_dim_count)), {input},
+           [&]() {
+             return NodeOutputShape(input, spatial_dim_count, output_size);
+           },
+           /*num_outputs=*/1, xla::util::MHash(spatial_dim_count, output_size)),
+      spatial_dim_count_(spatial_dim_count),
+      output_size_(std::move(output_size)) {}
+
+NodePtr AdaptiveAvgPoolNd::Clone(OpList operands) const {
+  return MakeNode<AdaptiveAvgPoolNd>(operands.at(0), spatial_dim_count_,
+                                     output_size_);
+}
+
+XlaOpVector AdaptiveAvgPoolNd::Lower(LoweringContext* loctx) const {
+  xla::XlaOp input = loctx->GetOutputOp(operand(0));
+  xla::XlaOp output =
+      BuildAdaptiveAvgPoolNd(input, spatial_dim_count_, output_size_);
+  return ReturnOp(output, loctx);
+}
+
+std::string AdaptiveAvgPoolNd::ToString() const {
+  std::stringstream ss;
+  ss << Node::ToString() << ", spatial_dim_count=" << spatial_dim_count_
+     << ", output_size=[" << absl::StrJoin(output_size_, ", ") << "]";
+  return ss.str();
+}
+
+}  // namespace ops
+}  // namespace ir
+}  // namespace torch_xla
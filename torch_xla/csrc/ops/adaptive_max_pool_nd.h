@@ -0,0 +1,33 @@
+#pragma once
+
+#include "tensorflow/compiler/xla/xla_data.pb.h"
+#include "tensorflow/core/lib/gtl/array_slice.h"
+#include "torch_xla/csrc/ir.h"
+
+namespace torch_xla {
+namespace ir {
+namespace ops {
+
+class AdaptiveMaxPoolNd : public Node {
+ public:
+  AdaptiveMaxPoolNd(const Value& input, xla::int64 spatial_dim_count,
+                    std::vector<xla::int64> output_size);
+
+  NodePtr Clone(OpList operands) const override;
+
+  XlaOpVector Lower(LoweringContext* loctx) const override;
+
+  std::string ToString() const override;
+
+  xla::int64 spatial_dim_count() const { return spatial_dim_count_; }
+
+  const std::vector<xla::int64>& output_size() const { return output_size_; }
+
+ private:
+  xla::int64 spatial_dim_count_;
+  std::vector<xla::int64> output_size_;
+};
+
+}  // namespace ops
+}  // namespace ir
+}  // namespace torch_xla
@@ -0,0 +1,72 @@
+#include "torch_xla/csrc/ops/all_to_all.h"
+
+#include "absl/strings/str_join.h"
+#include "tensorflow/compiler/xla/xla_client/util.h"
+#include "torch_xla/csrc/cross_replica_reduces.h"
+#include "torch_xla/csrc/lowering_context.h"
+#include "torch_xla/csrc/ops/infer_output_shape.h"
+#include "torch_xla/csrc/ops/xla_ops.h"
+
+namespace torch_xla {
+namespace ir {
+namespace ops {
+namespace {
+
+xla::Shape NodeOutputShape(const Value& input, xla::int64 split_dimension,
+                           xla::int64 concat_dimension, xla::int64 split_count,
+                           const std::vector<std::vector<xla::int64>>& groups) {
+  auto lower_for_shape_fn =
+      [&](tensorflow::gtl::ArraySlice<const xla::XlaOp> operands)
+      -> xla::XlaOp {
+    return BuildAllToAll(operands[0], split_dimension, concat_dimension,
+                         split_count, groups);
+  };
+  return InferOutputShape({input.shape()}, lower_for_shape_fn);
+}
+
+}  // namespace
+
+AllToAll::AllToAll(const Value& input, xla::int64 split_dimension,
+                   xla::int64 concat_dimension, xla::int64 split_count,
+                   std::vector<std::vector<xla::int64>> groups)
+    : Node(xla_all_to_all, {input},
+           [&]() {
+             return NodeOutputShape(input, split_dimension, concat_dimension,
+                                    split_count, groups);
+           },
+           /*num_outputs=*/1,
+           xla::util::MHash(split_dimension, concat_dimension, split_count,
+                            groups)),
+      split_dimension_(split_dimension),
+      concat_dimension_(concat_dimension),
+      split_count_(split_count),
+      groups_(std::move(groups)) {}
+
+std::string AllToAll::ToString() const {
+  std::stringstream ss;
+  ss << Node::ToString() << ", split_dimension=" << split_dimension_
+     << ", concat_dimension=" << concat_dimension_
+     << ", split_count=" << split_count_ << ", groups=(";
+  for (size_t i = 0; i < groups_.size(); ++i) {
+    ss << (i == 0 ? "(" : ",(");
+    ss << absl::StrJoin(groups_[i], ", ") << ")";
+  }
+  ss << ")";
+  return ss.str();
+}
+
+NodePtr AllToAll::Clone(OpList operands) const {
+  return MakeNode<AllToAll>(operands.at(0), split_dimension_,
+                            concat_dimension_, split_count_, groups_);
+}
+
+XlaOpVector AllToAll::Lower(LoweringContext* loctx) const {
+  xla::XlaOp input = loctx->GetOutputOp(operand(0));
+  return ReturnOp(BuildAllToAll(input, split_dimension_, concat_dimension_,
+                                split_count_, groups_),
+                  loctx);
+}
+
+}  // namespace ops
+}  // namespace ir
+}  // namespace torch_xla
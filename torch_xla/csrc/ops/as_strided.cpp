@@ -5,35 +5,21 @@
 #include "torch_xla/csrc/lowering_context.h"
 #include "torch_xla/csrc/ops/infer_output_shape.h"
 #include "torch_xla/csrc/torch_util.h"
+#include "torch_xla/csrc/xla_lower_util.h"
 
 namespace torch_xla {
 namespace ir {
 namespace ops {
 namespace {
 
-xla::XlaOp LowerAsStrided(const xla::XlaOp& input,
-                          tensorflow::gtl::ArraySlice<xla::int64> size,
-                          xla::int64 storage_offset) {
-  xla::int64 input_element_count =
-      xla::ShapeUtil::ElementsIn(XlaHelpers::ShapeOfXlaOp(input));
-  xla::int64 slice_size = xla::util::Multiply<xla::int64>(size);
-  if (input_element_count == slice_size) {
-    XLA_CHECK_EQ(storage_offset, 0);
-    return xla::Reshape(input, size);
-  }
-  xla::XlaOp r1_slice = xla::Reshape(input, {input_element_count});
-  xla::XlaOp r1_result = xla::SliceInDim(r1_slice, storage_offset,
-                                         storage_offset + slice_size, 1, 0);
-  return xla::Reshape(r1_result, size);
-}
-
 xla::Shape NodeOutputShape(const Value& input,
                            tensorflow::gtl::ArraySlice<xla::int64> size,
+                           tensorflow::gtl::ArraySlice<xla::int64> stride,
                            xla::int64 storage_offset) {
   auto lower_for_shape_fn =
       [&](tensorflow::gtl::ArraySlice<const xla::XlaOp> operands)
       -> xla::XlaOp {
-    return LowerAsStrided(operands[0], size, storage_offset);
+    return BuildAsStrided(operands[0], size, stride, storage_offset);
   };
   return InferOutputShape({input.shape()}, lower_for_shape_fn);
 }
@@ -41,39 +27,53 @@ xla::Shape NodeOutputShape(const Value& input,
 }  // namespace
 
 AsStrided::AsStrided(const Value& input, std::vector<xla::int64> size,
-                     xla::int64 storage_offset)
+                     std::vector<xla::int64> stride, xla::int64 storage_offset)
     : Node(ir::OpKind(at::aten::as_strided), {input},
-           [&]() { return NodeOutputShape(input, size, storage_offset); },
-           /*num_outputs=*/1, xla::util::MHash(size, storage_offset)),
+           [&]() {
+             return NodeOutputShape(input, size, stride, storage_offset);
+           },
+           /*num_outputs=*/1, xla::util::MHash(size, stride, storage_offset)),
       size_(std::move(size)),
+      stride_(std::move(stride)),
       storage_offset_(storage_offset) {}
 
 std::string AsStrided::ToString() const {
   std::stringstream ss;
   ss << Node::ToString() << ", size=[" << absl::StrJoin(size_, ", ")
+     << "], stride=[" << absl::StrJoin(stride_, ", ")
      << "], storage_offset=" << storage_offset_;
   return ss.str();
 }
 
 NodePtr AsStrided::Clone(OpList operands) const {
-  return MakeNode<AsStrided>(operands.at(0), size_, storage_offset_);
+  return MakeNode<AsStrided>(operands.at(0), size_, stride_, storage_offset_);
 }
 
 XlaOpVector AsStrided::Lower(LoweringContext* loctx) const {
   xla::XlaOp input = loctx->GetOutputOp(operand(0));
-  return ReturnOp(LowerAsStrided(input, size_, storage_offset_), loctx);
+  return ReturnOp(BuildAsStrided(input, size_, stride_, storage_offset_),
+                  loctx);
 }
 
 bool AsStrided::StrideIsSupported(
-    tensorflow::gtl::ArraySlice<xla::int64> size,
-    tensorflow::gtl::ArraySlice<xla::int64> stride) {
+    const xla::Shape& input_shape, tensorflow::gtl::ArraySlice<xla::int64> size,
+    tensorflow::gtl::ArraySlice<xla::int64> stride, xla::int64 storage_offset) {
   XLA_CHECK_EQ(size.size(), stride.size());
   XLA_CHECK(!size.empty()) << "Output size cannot be empty";
-  std::vector<xla::int64> expected_stride(size.size(), 1);
-  for (size_t i = size.size() - 1; i > 0; --i) {
-    expected_stride[i - 1] = expected_stride[i] * size[i];
+  if (storage_offset < 0) {
+    return false;
+  }
+  xla::int64 max_index = storage_offset;
+  for (size_t i = 0; i < size.size(); ++i) {
+    if (size[i] == 0) {
+      return true;
+    }
+    if (stride[i] < 0) {
+      return false;
+    }
+    max_index += (size[i] - 1) * stride[i];
   }
-  return stride == expected_stride;
+  return max_index < xla::ShapeUtil::ElementsIn(input_shape);
 }
 
 }  // namespace ops
@@ -12,7 +12,7 @@ namespace ops {
 class AsStrided : public Node {
  public:
   AsStrided(const Value& input, std::vector<xla::int64> size,
-            xla::int64 storage_offset);
+            std::vector<xla::int64> stride, xla::int64 storage_offset);
 
   std::string ToString() const override;
 
@@ -22,14 +22,20 @@ class AsStrided : public Node {
 
   const std::vector<xla::int64>& size() const { return size_; }
 
+  const std::vector<xla::int64>& stride() const { return stride_; }
+
   xla::int64 storage_offset() const { return storage_offset_; }
 
-  // We only support strides which are already consistent with the size.
-  static bool StrideIsSupported(tensorflow::gtl::ArraySlice<xla::int64> size,
-                                tensorflow::gtl::ArraySlice<xla::int64> stride);
+  // Whether the strided view only reads elements within the input, whose
+  // elements are seen as a contiguous storage.
+  static bool StrideIsSupported(const xla::Shape& input_shape,
+                                tensorflow::gtl::ArraySlice<xla::int64> size,
+                                tensorflow::gtl::ArraySlice<xla::int64> stride,
+                                xla::int64 storage_offset);
 
  private:
   std::vector<xla::int64> size_;
+  std::vector<xla::int64> stride_;
   xla::int64 storage_offset_;
 };
 
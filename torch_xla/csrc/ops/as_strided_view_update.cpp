@@ -1,12 +1,12 @@
 #include "torch_xla/csrc/ops/as_strided_view_update.h"
 
 #include "tensorflow/compiler/xla/xla_client/util.h"
-#include "torch_xla/csrc/data_ops.h"
 #include "torch_xla/csrc/helpers.h"
 #include "torch_xla/csrc/lowering_context.h"
 #include "torch_xla/csrc/ops/infer_output_shape.h"
 #include "torch_xla/csrc/ops/xla_ops.h"
 #include "torch_xla/csrc/torch_util.h"
+#include "torch_xla/csrc/xla_lower_util.h"
 
 namespace torch_xla {
 namespace ir {
@@ -15,28 +15,20 @@ namespace {
 
 xla::XlaOp LowerAsStridedViewUpdate(
     const xla::XlaOp& target, const xla::XlaOp& input,
-    tensorflow::gtl::ArraySlice<xla::int64> size, xla::int64 storage_offset) {
-  xla::int64 input_element_count =
-      xla::ShapeUtil::ElementsIn(XlaHelpers::ShapeOfXlaOp(input));
-  xla::int64 slice_size = xla::util::Multiply<xla::int64>(size);
-  if (input_element_count == slice_size) {
-    XLA_CHECK_EQ(storage_offset, 0);
-    return xla::Reshape(input, size);
-  }
-  xla::XlaOp r1_target = xla::Reshape(target, {slice_size});
-  xla::XlaOp r1_input = xla::Reshape(input, {input_element_count});
-  xla::XlaOp r1_result = BuildUnselect(r1_target, r1_input, 0, storage_offset,
-                                       storage_offset + input_element_count, 1);
-  return xla::Reshape(r1_result, size);
+    tensorflow::gtl::ArraySlice<xla::int64> size,
+    tensorflow::gtl::ArraySlice<xla::int64> stride, xla::int64 storage_offset) {
+  return xla::Reshape(
+      BuildAsStridedUpdate(target, input, stride, storage_offset), size);
 }
 
 xla::Shape NodeOutputShape(const Value& target, const Value& input,
                            tensorflow::gtl::ArraySlice<xla::int64> size,
+                           tensorflow::gtl::ArraySlice<xla::int64> stride,
                            xla::int64 storage_offset) {
   auto lower_for_shape_fn =
       [&](tensorflow::gtl::ArraySlice<const xla::XlaOp> operands)
       -> xla::XlaOp {
-    return LowerAsStridedViewUpdate(operands[0], operands[1], size,
+    return LowerAsStridedViewUpdate(operands[0], operands[1], size, stride,
                                     storage_offset);
   };
   return InferOutputShape({target.shape(), input.shape()}, lower_for_shape_fn);
@@ -47,32 +39,37 @@ xla::Shape NodeOutputShape(const Value& target, const Value& input,
 AsStridedViewUpdate::AsStridedViewUpdate(const Value& target,
                                          const Value& input,
                                          std::vector<xla::int64> size,
+                                         std::vector<xla::int64> stride,
                                          xla::int64 storage_offset)
     : Node(xla_as_strided_view_update, {target, input},
            [&]() {
-             return NodeOutputShape(target, input, size, storage_offset);
+             return NodeOutputShape(target, input, size, stride,
+                                    storage_offset);
            },
-           /*num_outputs=*/1, xla::util::MHash(size, storage_offset)),
+           /*num_outputs=*/1, xla::util::MHash(size, stride, storage_offset)),
       size_(std::move(size)),
+      stride_(std::move(stride)),
       storage_offset_(storage_offset) {}
 
 std::string AsStridedViewUpdate::ToString() const {
   std::stringstream ss;
   ss << Node::ToString() << ", size=[" << absl::StrJoin(size_, ", ")
+     << "], stride=[" << absl::StrJoin(stride_, ", ")
      << "], storage_offset=" << storage_offset_;
   return ss.str();
 }
 
 NodePtr AsStridedViewUpdate::Clone(OpList operands) const {
   return MakeNode<AsStridedViewUpdate>(operands.at(0), operands.at(1), size_,
-                                       storage_offset_);
+                                       stride_, storage_offset_);
 }
 
 XlaOpVector AsStridedViewUpdate::Lower(LoweringContext* loctx) const {
   xla::XlaOp target = loctx->GetOutputOp(operand(0));
   xla::XlaOp input = loctx->GetOutputOp(operand(1));
   return ReturnOp(
-      LowerAsStridedViewUpdate(target, input, size_, storage_offset_), loctx);
+      LowerAsStridedViewUpdate(target, input, size_, stride_, storage_offset_),
+      loctx);
 }
 
 }  // namespace ops
@@ -0,0 +1,69 @@
+#include "torch_xla/csrc/ops/attention.h"
+
+#include "tensorflow/compiler/xla/xla_client/debug_macros.h"
+#include "tensorflow/compiler/xla/xla_client/util.h"
+#include "torch_xla/csrc/attention.h"
+#include "torch_xla/csrc/lowering_context.h"
+#include "torch_xla/csrc/ops/infer_output_shape.h"
+#include "torch_xla/csrc/ops/xla_ops.h"
+
+namespace torch_xla {
+namespace ir {
+namespace ops {
+namespace {
+
+xla::Shape NodeOutputShape(const Value& query, const Value& key,
+                           const Value& value, const Value& mask, double scale,
+                           xla::int64 block_size) {
+  auto lower_for_shape_fn =
+      [&](tensorflow::gtl::ArraySlice<const xla::XlaOp> operands)
+      -> xla::XlaOp {
+    XLA_CHECK_EQ(operands.size(), 4);
+    AttentionResult result = BuildAttention(operands[0], operands[1],
+                                            operands[2], operands[3], scale,
+                                            block_size);
+    return xla::Tuple(operands[0].builder(), {result.output, result.logsumexp});
+  };
+  return InferOutputShape(
+      {query.shape(), key.shape(), value.shape(), mask.shape()},
+      lower_for_shape_fn);
+}
+
+}  // namespace
+
+Attention::Attention(const Value& query, const Value& key, const Value& value,
+                     const Value& mask, double scale, xla::int64 block_size)
+    : Node(xla_attention, {query, key, value, mask},
+           [&]() {
+             return NodeOutputShape(query, key, value, mask, scale,
+                                    block_size);
+           },
+           /*num_outputs=*/2, xla::util::MHash(scale, block_size)),
+      scale_(scale),
+      block_size_(block_size) {}
+
+std::string Attention::ToString() const {
+  std::stringstream ss;
+  ss << Node::ToString() << ", scale=" << scale_
+     << ", block_size=" << block_size_;
+  return ss.str();
+}
+
+NodePtr Attention::Clone(OpList operands) const {
+  return MakeNode<Attention>(operands.at(0), operands.at(1), operands.at(2),
+                             operands.at(3), scale_, block_size_);
+}
+
+XlaOpVector Attention::Lower(LoweringContext* loctx) const {
+  xla::XlaOp query = loctx->GetOutputOp(operand(0));
+  xla::XlaOp key = loctx->GetOutputOp(operand(1));
+  xla::XlaOp value = loctx->GetOutputOp(operand(2));
+  xla::XlaOp mask = loctx->GetOutputOp(operand(3));
+  AttentionResult result =
+      BuildAttention(query, key, value, mask, scale_, block_size_);
+  return ReturnOps({result.output, result.logsumexp}, loctx);
+}
+
+}  // namespace ops
+}  // namespace ir
+}  // namespace torch_xla
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "torch_xla/csrc/ir.h"
+
+namespace torch_xla {
+namespace ir {
+namespace ops {
+
+// The fused attention, with the output and the logsumexp of the score rows as
+// outputs.
+class Attention : public Node {
+ public:
+  Attention(const Value& query, const Value& key, const Value& value,
+            const Value& mask, double scale, xla::int64 block_size);
+
+  std::string ToString() const override;
+
+  NodePtr Clone(OpList operands) const override;
+
+  XlaOpVector Lower(LoweringContext* loctx) const override;
+
+  double scale() const { return scale_; }
+
+  xla::int64 block_size() const { return block_size_; }
+
+ private:
+  double scale_;
+  xla::int64 block_size_;
+};
+
+}  // namespace ops
+}  // namespace ir
+}  // namespace torch_xla
@@ -0,0 +1,58 @@
+#include "torch_xla/csrc/ops/attention_backward.h"
+
+#include "tensorflow/compiler/xla/shape_util.h"
+#include "tensorflow/compiler/xla/xla_client/debug_macros.h"
+#include "tensorflow/compiler/xla/xla_client/util.h"
+#include "torch_xla/csrc/attention.h"
+#include "torch_xla/csrc/lowering_context.h"
+#include "torch_xla/csrc/ops/xla_ops.h"
+
+namespace torch_xla {
+namespace ir {
+namespace ops {
+
+AttentionBackward::AttentionBackward(const Value& grad_output,
+                                     const Value& query, const Value& key,
+                                     const Value& value, const Value& mask,
+                                     const Value& output,
+                                     const Value& logsumexp, double scale,
+                                     xla::int64 block_size)
+    : Node(xla_attention_backward,
+           {grad_output, query, key, value, mask, output, logsumexp},
+           xla::ShapeUtil::MakeTupleShape(
+               {query.shape(), key.shape(), value.shape()}),
+           /*num_outputs=*/3, xla::util::MHash(scale, block_size)),
+      scale_(scale),
+      block_size_(block_size) {}
+
+std::string AttentionBackward::ToString() const {
+  std::stringstream ss;
+  ss << Node::ToString() << ", scale=" << scale_
+     << ", block_size=" << block_size_;
+  return ss.str();
+}
+
+NodePtr AttentionBackward::Clone(OpList operands) const {
+  return MakeNode<AttentionBackward>(
+      operands.at(0), operands.at(1), operands.at(2), operands.at(3),
+      operands.at(4), operands.at(5), operands.at(6), scale_, block_size_);
+}
+
+XlaOpVector AttentionBackward::Lower(LoweringContext* loctx) const {
+  xla::XlaOp grad_output = loctx->GetOutputOp(operand(0));
+  xla::XlaOp query = loctx->GetOutputOp(operand(1));
+  xla::XlaOp key = loctx->GetOutputOp(operand(2));
+  xla::XlaOp value = loctx->GetOutputOp(operand(3));
+  xla::XlaOp mask = loctx->GetOutputOp(operand(4));
+  xla::XlaOp output = loctx->GetOutputOp(operand(5));
+  xla::XlaOp logsumexp = loctx->GetOutputOp(operand(6));
+  AttentionGrads grads =
+      BuildAttentionBackward(grad_output, query, key, value, mask, output,
+                             logsumexp, scale_, block_size_);
+  return ReturnOps({grads.grad_query, grads.grad_key, grads.grad_value},
+                   loctx);
+}
+
+}  // namespace ops
+}  // namespace ir
+}  // namespace torch_xla
@@ -1,9 +1,9 @@
 #include "torch_xla/csrc/ops/avg_pool_nd_backward.h"
 
+#include "tensorflow/compiler/xla/shape_util.h"
 #include "tensorflow/compiler/xla/xla_client/debug_macros.h"
 #include "tensorflow/compiler/xla/xla_client/util.h"
 #include "torch_xla/csrc/lowering_context.h"
-#include "torch_xla/csrc/ops/infer_output_shape.h"
 #include "torch_xla/csrc/pooling.h"
 
 namespace torch_xla {
@@ -11,24 +11,12 @@ namespace ir {
 namespace ops {
 namespace {
 
-xla::Shape NodeOutputShape(
-    const Value& grad_output, const Value& input, xla::int64 spatial_dim_count,
-    tensorflow::gtl::ArraySlice<const xla::int64> kernel_size,
-    tensorflow::gtl::ArraySlice<const xla::int64> stride,
-    tensorflow::gtl::ArraySlice<const xla::int64> padding, bool ceil_mode,
-    bool count_include_pad) {
-  auto lower_for_shape_fn =
-      [&](tensorflow::gtl::ArraySlice<const xla::XlaOp> operands)
-      -> xla::XlaOp {
-    XLA_CHECK_EQ(operands.size(), 2)
-        << "Unexpected number of operands: " << operands.size();
-    return BuildAvgPoolNdBackward(/*out_backprop=*/operands[0],
-                                  /*input=*/operands[1], spatial_dim_count,
-                                  kernel_size, stride, padding, ceil_mode,
-                                  count_include_pad);
-  };
-  return InferOutputShape({grad_output.shape(), input.shape()},
-                          lower_for_shape_fn);
+xla::Shape NodeOutputShape(const Value& grad_output, const Value& input) {
+  // The gradients have the type of the output gradients, and the sizes of the
+  // input.
+  XLA_CHECK_EQ(grad_output.shape().rank(), input.shape().rank());
+  return xla::ShapeUtil::MakeShape(grad_output.shape().element_type(),
+                                   input.shape().dimensions());
 }
 
 c10::Symbol AvgNdBackwardSymbol(xla::int64 spatial_dim_count) {
@@ -50,11 +38,7 @@ AvgPoolNdBackward::AvgPoolNdBackward(
     std::vector<xla::int64> kernel_size, std::vector<xla::int64> stride,
     std::vector<xla::int64> padding, bool ceil_mode, bool count_include_pad)
     : Node(OpKind(AvgNdBackwardSymbol(spatial_dim_count)), {grad_output, input},
-           [&]() {
-             return NodeOutputShape(grad_output, input, spatial_dim_count,
-                                    kernel_size, stride, padding, ceil_mode,
-                                    count_include_pad);
-           },
+           [&]() { return NodeOutputShape(grad_output, input); },
            /*num_outputs=*/1,
            xla::util::MHash(spatial_dim_count, kernel_size, stride, padding,
                             ceil_mode, count_include_pad)),
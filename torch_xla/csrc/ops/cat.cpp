@@ -1,10 +1,11 @@
 #include "torch_xla/csrc/ops/cat.h"
 
+#include "tensorflow/compiler/xla/shape_util.h"
+#include "tensorflow/compiler/xla/xla_client/debug_macros.h"
 #include "tensorflow/compiler/xla/xla_client/util.h"
 #include "torch_xla/csrc/data_ops.h"
 #include "torch_xla/csrc/helpers.h"
 #include "torch_xla/csrc/lowering_context.h"
-#include "torch_xla/csrc/ops/infer_output_shape.h"
 
 namespace torch_xla {
 namespace ir {
@@ -13,15 +14,18 @@ namespace {
 
 xla::Shape NodeOutputShape(tensorflow::gtl::ArraySlice<const ir::Value> values,
                            xla::int64 dim) {
-  auto lower_for_shape_fn =
-      [&](tensorflow::gtl::ArraySlice<const xla::XlaOp> operands)
-      -> xla::XlaOp { return BuildCat(operands, dim); };
-  std::vector<xla::Shape> shapes;
-  shapes.reserve(values.size());
-  for (auto& value : values) {
-    shapes.push_back(value.shape());
+  XLA_CHECK_GT(values.size(), 0);
+  const xla::Shape& shape = values[0].shape();
+  XLA_CHECK_LT(dim, shape.rank());
+  std::vector<xla::int64> output_sizes =
+      xla::util::ToVector<xla::int64>(shape.dimensions());
+  for (size_t i = 1; i < values.size(); ++i) {
+    const xla::Shape& value_shape = values[i].shape();
+    XLA_CHECK_EQ(value_shape.rank(), shape.rank())
+        << value_shape << " vs. " << shape;
+    output_sizes[dim] += value_shape.dimensions(dim);
   }
-  return InferOutputShape(shapes, lower_for_shape_fn);
+  return xla::ShapeUtil::MakeShape(shape.element_type(), output_sizes);
 }
 
 }  // namespace
@@ -1,8 +1,7 @@
 #include "torch_xla/csrc/ops/cholesky.h"
 
-#include "tensorflow/compiler/xla/client/lib/matrix.h"
-#include "tensorflow/compiler/xla/client/xla_builder.h"
 #include "tensorflow/compiler/xla/xla_client/util.h"
+#include "torch_xla/csrc/linalg.h"
 #include "torch_xla/csrc/lowering_context.h"
 
 namespace torch_xla {
@@ -20,8 +19,7 @@ NodePtr Cholesky::Clone(OpList operands) const {
 
 XlaOpVector Cholesky::Lower(LoweringContext* loctx) const {
   xla::XlaOp input = loctx->GetOutputOp(operand(0));
-  xla::XlaOp output =
-      xla::Triangle(xla::Cholesky(input, /*lower=*/lower_), /*lower=*/lower_);
+  xla::XlaOp output = BuildCholesky(input, /*lower=*/lower_);
   return ReturnOp(output, loctx);
 }
 
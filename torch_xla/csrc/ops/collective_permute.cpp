@@ -0,0 +1,41 @@
+#include "torch_xla/csrc/ops/collective_permute.h"
+
+#include "tensorflow/compiler/xla/xla_client/util.h"
+#include "torch_xla/csrc/cross_replica_reduces.h"
+#include "torch_xla/csrc/lowering_context.h"
+#include "torch_xla/csrc/ops/xla_ops.h"
+
+namespace torch_xla {
+namespace ir {
+namespace ops {
+
+CollectivePermute::CollectivePermute(
+    const Value& input,
+    std::vector<std::pair<xla::int64, xla::int64>> source_target_pairs)
+    : Node(xla_collective_permute, {input}, input.shape(),
+           /*num_outputs=*/1, xla::util::MHash(source_target_pairs)),
+      source_target_pairs_(std::move(source_target_pairs)) {}
+
+std::string CollectivePermute::ToString() const {
+  std::stringstream ss;
+  ss << Node::ToString() << ", source_target_pairs=(";
+  for (size_t i = 0; i < source_target_pairs_.size(); ++i) {
+    ss << (i == 0 ? "(" : ", (") << source_target_pairs_[i].first << ", "
+       << source_target_pairs_[i].second << ")";
+  }
+  ss << ")";
+  return ss.str();
+}
+
+NodePtr CollectivePermute::Clone(OpList operands) const {
+  return MakeNode<CollectivePermute>(operands.at(0), source_target_pairs_);
+}
+
+XlaOpVector CollectivePermute::Lower(LoweringContext* loctx) const {
+  xla::XlaOp input = loctx->GetOutputOp(operand(0));
+  return ReturnOp(BuildCollectivePermute(input, source_target_pairs_), loctx);
+}
+
+}  // namespace ops
+}  // namespace ir
+}  // namespace torch_xla
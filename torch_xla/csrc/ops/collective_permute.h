@@ -0,0 +1,36 @@
+#pragma once
+
+#include <utility>
+
+#include "torch_xla/csrc/ir.h"
+
+namespace torch_xla {
+namespace ir {
+namespace ops {
+
+// Sends the input of every source replica to its target replica. The replicas
+// which are not the target of any pair get zeros.
+class CollectivePermute : public Node {
+ public:
+  CollectivePermute(
+      const Value& input,
+      std::vector<std::pair<xla::int64, xla::int64>> source_target_pairs);
+
+  std::string ToString() const override;
+
+  NodePtr Clone(OpList operands) const override;
+
+  XlaOpVector Lower(LoweringContext* loctx) const override;
+
+  const std::vector<std::pair<xla::int64, xla::int64>>& source_target_pairs()
+      const {
+    return source_target_pairs_;
+  }
+
+ private:
+  std::vector<std::pair<xla::int64, xla::int64>> source_target_pairs_;
+};
+
+}  // namespace ops
+}  // namespace ir
+}  // namespace torch_xla
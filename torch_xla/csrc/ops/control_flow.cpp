@@ -0,0 +1,305 @@
+#include "torch_xla/csrc/ops/control_flow.h"
+
+#include <atomic>
+#include <sstream>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "tensorflow/compiler/xla/shape_util.h"
+#include "tensorflow/compiler/xla/xla_client/debug_macros.h"
+#include "tensorflow/compiler/xla/xla_client/util.h"
+#include "torch_xla/csrc/helpers.h"
+#include "torch_xla/csrc/lowering_context.h"
+#include "torch_xla/csrc/ops/device_data.h"
+#include "torch_xla/csrc/ops/xla_ops.h"
+
+namespace torch_xla {
+namespace ir {
+namespace ops {
+namespace {
+
+bool IsCapture(const Node* node, xla::int64 scope) {
+  const SubgraphParameter* parameter =
+      dynamic_cast<const SubgraphParameter*>(node);
+  if (parameter != nullptr) {
+    return parameter->scope() != scope;
+  }
+  return dynamic_cast<const DeviceData*>(node) != nullptr;
+}
+
+std::vector<Value> Concat(std::initializer_list<OpList> groups) {
+  std::vector<Value> values;
+  for (auto& group : groups) {
+    values.insert(values.end(), group.begin(), group.end());
+  }
+  return values;
+}
+
+std::vector<Value> OperandRange(OpList operands, size_t start, size_t count) {
+  XLA_CHECK_LE(start + count, operands.size());
+  return std::vector<Value>(operands.begin() + start,
+                            operands.begin() + start + count);
+}
+
+// The hash of the subgraphs does not depend on the scope, as the one of the
+// subgraph parameters does not.
+size_t SubgraphsHash(std::initializer_list<OpList> groups) {
+  size_t hash = 0x3c6ef372;
+  for (auto& group : groups) {
+    hash = xla::util::HashCombine(hash, group.size());
+    for (auto& value : group) {
+      hash = xla::util::HashCombine(hash, value.hash());
+    }
+  }
+  return hash;
+}
+
+xla::Shape MakeOutputShape(OpList outputs) {
+  std::vector<xla::Shape> shapes;
+  for (auto& output : outputs) {
+    shapes.push_back(output.shape());
+  }
+  return xla::ShapeUtil::MakeTupleShape(shapes);
+}
+
+void CheckCompatibleShapes(OpList values1, OpList values2) {
+  XLA_CHECK_EQ(values1.size(), values2.size());
+  for (size_t i = 0; i < values1.size(); ++i) {
+    XLA_CHECK(
+        xla::ShapeUtil::Compatible(values1[i].shape(), values2[i].shape()))
+        << "Subgraph output " << i << " has shape " << values2[i].shape()
+        << ", expected " << values1[i].shape();
+  }
+}
+
+// Lowers the subgraphs of the outputs into a computation whose parameter is
+// the given tuple, holding the values of the subgraph parameters of scope,
+// followed by the ones of the captures. The computation returns the tuple of
+// the outputs, followed by the captures if passthrough_captures is true, or
+// the only output if tuple_result is false.
+xla::XlaComputation BuildSubgraphComputation(
+    const std::string& name, xla::int64 scope, const xla::Shape& tuple_shape,
+    size_t num_operands, OpList outputs, OpList captures,
+    bool passthrough_captures, bool tuple_result) {
+  LoweringContext loctx(name);
+  xla::XlaOp tuple =
+      xla::Parameter(loctx.builder(), 0, tuple_shape, "operands");
+  std::unordered_map<const Node*, size_t> capture_indices;
+  for (size_t i = 0; i < captures.size(); ++i) {
+    capture_indices.emplace(captures[i].node.get(), num_operands + i);
+  }
+  std::vector<const Node*> roots;
+  for (auto& output : outputs) {
+    roots.push_back(output.node.get());
+  }
+  for (auto node : Util::ComputePostOrder(roots)) {
+    const SubgraphParameter* parameter =
+        dynamic_cast<const SubgraphParameter*>(node);
+    if (parameter != nullptr && parameter->scope() == scope) {
+      XLA_CHECK_LT(parameter->index(), num_operands);
+      loctx.AssignOutputOp(Output(node, 0),
+                           xla::GetTupleElement(tuple, parameter->index()));
+      continue;
+    }
+    auto it = capture_indices.find(node);
+    if (it != capture_indices.end()) {
+      loctx.AssignOutputOp(Output(node, 0),
+                           xla::GetTupleElement(tuple, it->second));
+      continue;
+    }
+    loctx.LowerNode(node);
+  }
+  std::vector<xla::XlaOp> results;
+  for (auto& output : outputs) {
+    results.push_back(loctx.GetOutputOp(output));
+  }
+  if (passthrough_captures) {
+    for (size_t i = 0; i < captures.size(); ++i) {
+      results.push_back(xla::GetTupleElement(tuple, num_operands + i));
+    }
+  }
+  XLA_CHECK(tuple_result || results.size() == 1);
+  return ConsumeValue(loctx.Build(
+      tuple_result ? xla::Tuple(loctx.builder(), results) : results.front()));
+}
+
+// Lowers the operands of the node, from start on, into a tuple.
+xla::XlaOp LowerOperandsTuple(const Node& node, size_t start,
+                              LoweringContext* loctx) {
+  std::vector<xla::XlaOp> ops;
+  for (size_t i = start; i < node.operands().size(); ++i) {
+    ops.push_back(loctx->GetOutputOp(node.operand(i)));
+  }
+  return xla::Tuple(loctx->builder(), ops);
+}
+
+std::vector<xla::XlaOp> GetTupleElements(const xla::XlaOp& tuple,
+                                         size_t count) {
+  std::vector<xla::XlaOp> ops;
+  for (size_t i = 0; i < count; ++i) {
+    ops.push_back(xla::GetTupleElement(tuple, i));
+  }
+  return ops;
+}
+
+}  // namespace
+
+SubgraphParameter::SubgraphParameter(xla::int64 scope, xla::int64 index,
+                                     xla::Shape shape)
+    : Node(xla_subgraph_parameter, std::move(shape), /*num_outputs=*/1,
+           xla::util::MHash(index)),
+      scope_(scope),
+      index_(index) {}
+
+std::string SubgraphParameter::ToString() const {
+  std::stringstream ss;
+  ss << Node::ToString() << ", scope=" << scope_ << ", index=" << index_;
+  return ss.str();
+}
+
+NodePtr SubgraphParameter::Clone(OpList operands) const {
+  return MakeNode<SubgraphParameter>(scope_, index_, shape());
+}
+
+XlaOpVector SubgraphParameter::Lower(LoweringContext* loctx) const {
+  XLA_ERROR() << "Subgraph parameters can only be lowered within their "
+                 "subgraph, and the tensors computed from them must not be "
+                 "used outside of it: "
+              << ToString();
+}
+
+xla::int64 SubgraphParameter::NewScope() {
+  static std::atomic<xla::int64> scope(0);
+  return ++scope;
+}
+
+std::vector<Value> CollectSubgraphCaptures(
+    xla::int64 scope, std::initializer_list<OpList> groups) {
+  std::vector<Value> captures;
+  std::unordered_set<const Node*> visited;
+  std::vector<Value> stack;
+  for (auto& group : groups) {
+    stack.insert(stack.end(), group.rbegin(), group.rend());
+  }
+  while (!stack.empty()) {
+    Value value = std::move(stack.back());
+    stack.pop_back();
+    if (!visited.insert(value.node.get()).second) {
+      continue;
+    }
+    if (IsCapture(value.node.get(), scope)) {
+      captures.emplace_back(value.node, 0);
+      continue;
+    }
+    for (size_t i = value->operands().size(); i > 0; --i) {
+      stack.push_back(value->operand_value(i - 1));
+    }
+  }
+  return captures;
+}
+
+Cond::Cond(const Value& predicate, OpList operands, OpList capture_values,
+           xla::int64 scope, OpList true_outputs, OpList false_outputs,
+           std::vector<Value> captures)
+    : Node(xla_cond, Concat({{predicate}, operands, capture_values}),
+           MakeOutputShape(true_outputs),
+           /*num_outputs=*/true_outputs.size(),
+           xla::util::HashCombine(
+               operands.size(),
+               SubgraphsHash({true_outputs, false_outputs, captures}))),
+      scope_(scope),
+      num_operands_(operands.size()),
+      true_outputs_(true_outputs.begin(), true_outputs.end()),
+      false_outputs_(false_outputs.begin(), false_outputs.end()),
+      captures_(std::move(captures)) {
+  XLA_CHECK_EQ(capture_values.size(), captures_.size());
+  XLA_CHECK(predicate.shape().element_type() == xla::PrimitiveType::PRED &&
+            predicate.shape().rank() == 0)
+      << "The predicate must be a scalar boolean: " << predicate.shape();
+  CheckCompatibleShapes(true_outputs, false_outputs);
+}
+
+std::string Cond::ToString() const {
+  std::stringstream ss;
+  ss << Node::ToString() << ", scope=" << scope_
+     << ", num_operands=" << num_operands_
+     << ", num_captures=" << captures_.size();
+  return ss.str();
+}
+
+NodePtr Cond::Clone(OpList operands) const {
+  return MakeNode<Cond>(operands.at(0),
+                        OperandRange(operands, 1, num_operands_),
+                        OperandRange(operands, 1 + num_operands_,
+                                     captures_.size()),
+                        scope_, true_outputs_, false_outputs_, captures_);
+}
+
+XlaOpVector Cond::Lower(LoweringContext* loctx) const {
+  xla::XlaOp predicate = loctx->GetOutputOp(operand(0));
+  xla::XlaOp tuple = LowerOperandsTuple(*this, 1, loctx);
+  xla::Shape tuple_shape = XlaHelpers::ShapeOfXlaOp(tuple);
+  xla::XlaComputation true_computation = BuildSubgraphComputation(
+      "CondTrue", scope_, tuple_shape, num_operands_, true_outputs_,
+      captures_, /*passthrough_captures=*/false, /*tuple_result=*/true);
+  xla::XlaComputation false_computation = BuildSubgraphComputation(
+      "CondFalse", scope_, tuple_shape, num_operands_, false_outputs_,
+      captures_, /*passthrough_captures=*/false, /*tuple_result=*/true);
+  xla::XlaOp result = xla::Conditional(predicate, tuple, true_computation,
+                                       tuple, false_computation);
+  return ReturnOps(GetTupleElements(result, true_outputs_.size()), loctx);
+}
+
+WhileLoop::WhileLoop(OpList operands, OpList capture_values, xla::int64 scope,
+                     const Value& condition, OpList body_outputs,
+                     std::vector<Value> captures)
+    : Node(xla_while_loop, Concat({operands, capture_values}),
+           MakeOutputShape(operands),
+           /*num_outputs=*/operands.size(),
+           xla::util::HashCombine(
+               operands.size(),
+               SubgraphsHash({{condition}, body_outputs, captures}))),
+      scope_(scope),
+      num_operands_(operands.size()),
+      condition_(condition),
+      body_outputs_(body_outputs.begin(), body_outputs.end()),
+      captures_(std::move(captures)) {
+  XLA_CHECK_EQ(capture_values.size(), captures_.size());
+  XLA_CHECK(condition.shape().element_type() == xla::PrimitiveType::PRED &&
+            condition.shape().rank() == 0)
+      << "The loop condition must be a scalar boolean: " << condition.shape();
+  CheckCompatibleShapes(operands, body_outputs);
+}
+
+std::string WhileLoop::ToString() const {
+  std::stringstream ss;
+  ss << Node::ToString() << ", scope=" << scope_
+     << ", num_operands=" << num_operands_
+     << ", num_captures=" << captures_.size();
+  return ss.str();
+}
+
+NodePtr WhileLoop::Clone(OpList operands) const {
+  return MakeNode<WhileLoop>(OperandRange(operands, 0, num_operands_),
+                             OperandRange(operands, num_operands_,
+                                          captures_.size()),
+                             scope_, condition_, body_outputs_, captures_);
+}
+
+XlaOpVector WhileLoop::Lower(LoweringContext* loctx) const {
+  xla::XlaOp tuple = LowerOperandsTuple(*this, 0, loctx);
+  xla::Shape tuple_shape = XlaHelpers::ShapeOfXlaOp(tuple);
+  xla::XlaComputation condition_computation = BuildSubgraphComputation(
+      "WhileCondition", scope_, tuple_shape, num_operands_, {condition_},
+      captures_, /*passthrough_captures=*/false, /*tuple_result=*/false);
+  xla::XlaComputation body_computation = BuildSubgraphComputation(
+      "WhileBody", scope_, tuple_shape, num_operands_, body_outputs_,
+      captures_, /*passthrough_captures=*/true, /*tuple_result=*/true);
+  xla::XlaOp result =
+      xla::While(condition_computation, body_computation, tuple);
+  return ReturnOps(GetTupleElements(result, num_operands_), loctx);
+}
+
+}  // namespace ops
+}  // namespace ir
+}  // namespace torch_xla
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <initializer_list>
+#include <vector>
+
+#include "torch_xla/csrc/ir.h"
+
+namespace torch_xla {
+namespace ir {
+namespace ops {
+
+// The placeholder for the index-th operand of the subgraphs traced within a
+// scope (like the branches of a Cond, or the condition and body of a
+// WhileLoop). Subgraph parameters can only be lowered by the node owning the
+// subgraphs, which binds them to its operands. The scope is not part of the
+// hash, so that graphs tracing the same subgraphs at every step hit the
+// compilation cache.
+class SubgraphParameter : public Node {
+ public:
+  SubgraphParameter(xla::int64 scope, xla::int64 index, xla::Shape shape);
+
+  std::string ToString() const override;
+
+  NodePtr Clone(OpList operands) const override;
+
+  XlaOpVector Lower(LoweringContext* loctx) const override;
+
+  xla::int64 scope() const { return scope_; }
+
+  xla::int64 index() const { return index_; }
+
+  // Returns a new scope, never returned before.
+  static xla::int64 NewScope();
+
+ private:
+  xla::int64 scope_;
+  xla::int64 index_;
+};
+
+// Collects, in a deterministic order, the leaves of the subgraphs rooted at
+// the values of the groups which must be bound to values of the enclosing
+// graph: the device data, and the subgraph parameters of other scopes.
+std::vector<Value> CollectSubgraphCaptures(
+    xla::int64 scope, std::initializer_list<OpList> groups);
+
+// Selects, on device, between the outputs of two subgraphs traced with the
+// subgraph parameters of scope, bound to the operands. The captures of the
+// subgraphs (see CollectSubgraphCaptures()) are bound to the capture values,
+// which are the nodes operands following the predicate and the operands (and
+// which are the captures themselves, unless the node is cloned).
+class Cond : public Node {
+ public:
+  Cond(const Value& predicate, OpList operands, OpList capture_values,
+       xla::int64 scope, OpList true_outputs, OpList false_outputs,
+       std::vector<Value> captures);
+
+  std::string ToString() const override;
+
+  NodePtr Clone(OpList operands) const override;
+
+  XlaOpVector Lower(LoweringContext* loctx) const override;
+
+ private:
+  xla::int64 scope_;
+  size_t num_operands_;
+  std::vector<Value> true_outputs_;
+  std::vector<Value> false_outputs_;
+  std::vector<Value> captures_;
+};
+
+// Runs, on device, the body subgraph for as long as the condition subgraph
+// returns true, both traced with the subgraph parameters of scope. The
+// parameters are bound to the operands at the first iteration, and to the body
+// outputs of the previous iteration afterwards. The outputs are the values of
+// the parameters once the condition returns false. The captures are handled
+// like in Cond, following the operands.
+class WhileLoop : public Node {
+ public:
+  WhileLoop(OpList operands, OpList capture_values, xla::int64 scope,
+            const Value& condition, OpList body_outputs,
+            std::vector<Value> captures);
+
+  std::string ToString() const override;
+
+  NodePtr Clone(OpList operands) const override;
+
+  XlaOpVector Lower(LoweringContext* loctx) const override;
+
+ private:
+  xla::int64 scope_;
+  size_t num_operands_;
+  Value condition_;
+  std::vector<Value> body_outputs_;
+  std::vector<Value> captures_;
+};
+
+}  // namespace ops
+}  // namespace ir
+}  // namespace torch_xla
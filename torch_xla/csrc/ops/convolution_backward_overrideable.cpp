@@ -18,16 +18,14 @@ xla::Shape NodeOutputShape(
     tensorflow::gtl::ArraySlice<const xla::int64> padding,
     tensorflow::gtl::ArraySlice<const xla::int64> dilation, bool transposed,
     tensorflow::gtl::ArraySlice<const xla::int64> output_padding,
-    xla::int64 groups) {
+    xla::int64 groups, const XlaHelpers::MixedPrecision& mixed_precision) {
   auto lower_for_shape_fn =
-      [stride, padding, dilation, transposed, output_padding,
-       groups](tensorflow::gtl::ArraySlice<const xla::XlaOp> operands)
+      [&](tensorflow::gtl::ArraySlice<const xla::XlaOp> operands)
       -> xla::XlaOp {
     XLA_CHECK_EQ(operands.size(), 3);
-    // The precision doesn't matter for shape inference.
     ConvGrads grads = BuildConvolutionBackwardOverrideable(
         operands[0], operands[1], operands[2], stride, padding, dilation,
-        transposed, output_padding, groups);
+        transposed, output_padding, groups, mixed_precision);
     return xla::Tuple(operands[0].builder(),
                       {grads.grad_input, grads.grad_weight, grads.grad_bias});
   };
@@ -41,28 +39,30 @@ ConvolutionBackwardOverrideable::ConvolutionBackwardOverrideable(
     const Value& grad_output, const Value& input, const Value& weight,
     std::vector<xla::int64> stride, std::vector<xla::int64> padding,
     std::vector<xla::int64> dilation, bool transposed,
-    std::vector<xla::int64> output_padding, xla::int64 groups)
+    std::vector<xla::int64> output_padding, xla::int64 groups,
+    XlaHelpers::MixedPrecision mixed_precision)
     : Node(ir::OpKind(at::aten::convolution_backward_overrideable),
            {grad_output, input, weight},
            [&]() {
              return NodeOutputShape(grad_output, input, weight, stride, padding,
                                     dilation, transposed, output_padding,
-                                    groups);
+                                    groups, mixed_precision);
            },
            /*num_outputs=*/3,
            xla::util::MHash(stride, padding, dilation, transposed,
-                            output_padding, groups)),
+                            output_padding, groups, mixed_precision.Hash())),
       stride_(std::move(stride)),
       padding_(std::move(padding)),
       dilation_(std::move(dilation)),
       output_padding_(std::move(output_padding)),
       transposed_(transposed),
-      groups_(groups) {}
+      groups_(groups),
+      mixed_precision_(mixed_precision) {}
 
 NodePtr ConvolutionBackwardOverrideable::Clone(OpList operands) const {
   return MakeNode<ConvolutionBackwardOverrideable>(
       operands.at(0), operands.at(1), operands.at(2), stride_, padding_,
-      dilation_, transposed_, output_padding_, groups_);
+      dilation_, transposed_, output_padding_, groups_, mixed_precision_);
 }
 
 XlaOpVector ConvolutionBackwardOverrideable::Lower(
@@ -72,7 +72,7 @@ XlaOpVector ConvolutionBackwardOverrideable::Lower(
   xla::XlaOp weight = loctx->GetOutputOp(operand(2));
   auto grads = BuildConvolutionBackwardOverrideable(
       grad_output, input, weight, stride_, padding_, dilation_, transposed_,
-      output_padding_, groups_);
+      output_padding_, groups_, mixed_precision_);
   return ReturnOps({std::move(grads.grad_input), std::move(grads.grad_weight),
                     std::move(grads.grad_bias)},
                    loctx);
@@ -84,7 +84,7 @@ std::string ConvolutionBackwardOverrideable::ToString() const {
      << "], padding=[" << absl::StrJoin(padding_, ", ") << "], dilation=["
      << absl::StrJoin(dilation_, ", ") << "], transpose=" << transposed_
      << ", output_padding=[" << absl::StrJoin(output_padding_, ", ")
-     << "], groups=" << groups_;
+     << "], groups=" << groups_ << ", " << mixed_precision_.ToString();
   return ss.str();
 }
 
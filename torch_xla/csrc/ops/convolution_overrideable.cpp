@@ -19,15 +19,14 @@ xla::Shape NodeOutputShape(
     tensorflow::gtl::ArraySlice<const xla::int64> padding,
     tensorflow::gtl::ArraySlice<const xla::int64> dilation, bool transposed,
     tensorflow::gtl::ArraySlice<const xla::int64> output_padding,
-    xla::int64 groups) {
+    xla::int64 groups, const XlaHelpers::MixedPrecision& mixed_precision) {
   auto lower_for_shape_fn =
-      [stride, padding, dilation, output_padding, transposed,
-       groups](tensorflow::gtl::ArraySlice<const xla::XlaOp> operands)
+      [&](tensorflow::gtl::ArraySlice<const xla::XlaOp> operands)
       -> xla::XlaOp {
     XLA_CHECK(operands.size() == 2 || operands.size() == 3);
-    return BuildConvolutionOverrideable(operands[0], operands[1], stride,
-                                        padding, dilation, transposed,
-                                        output_padding, groups);
+    return BuildConvolutionOverrideable(
+        operands[0], operands[1], stride, padding, dilation, transposed,
+        output_padding, groups, mixed_precision);
   };
   return InferOutputShape({input.shape(), weight.shape()}, lower_for_shape_fn);
 }
@@ -38,50 +37,57 @@ ConvolutionOverrideable::ConvolutionOverrideable(
     const Value& input, const Value& weight, const Value& bias,
     std::vector<xla::int64> stride, std::vector<xla::int64> padding,
     std::vector<xla::int64> dilation, bool transposed,
-    std::vector<xla::int64> output_padding, xla::int64 groups)
+    std::vector<xla::int64> output_padding, xla::int64 groups,
+    XlaHelpers::MixedPrecision mixed_precision)
     : Node(ir::OpKind(at::aten::convolution_overrideable),
            {input, weight, bias},
            [&]() {
              return NodeOutputShape(input, weight, stride, padding, dilation,
-                                    transposed, output_padding, groups);
+                                    transposed, output_padding, groups,
+                                    mixed_precision);
            },
            /*num_outputs=*/1,
            xla::util::MHash(stride, padding, dilation, transposed,
-                            output_padding, groups)),
+                            output_padding, groups, mixed_precision.Hash())),
       stride_(std::move(stride)),
       padding_(std::move(padding)),
       dilation_(std::move(dilation)),
       output_padding_(std::move(output_padding)),
       transposed_(transposed),
-      groups_(groups) {}
+      groups_(groups),
+      mixed_precision_(mixed_precision) {}
 
 ConvolutionOverrideable::ConvolutionOverrideable(
     const Value& input, const Value& weight, std::vector<xla::int64> stride,
     std::vector<xla::int64> padding, std::vector<xla::int64> dilation,
-    bool transposed, std::vector<xla::int64> output_padding, xla::int64 groups)
+    bool transposed, std::vector<xla::int64> output_padding, xla::int64 groups,
+    XlaHelpers::MixedPrecision mixed_precision)
     : Node(ir::OpKind(at::aten::convolution_overrideable), {input, weight},
            [&]() {
              return NodeOutputShape(input, weight, stride, padding, dilation,
-                                    transposed, output_padding, groups);
+                                    transposed, output_padding, groups,
+                                    mixed_precision);
            },
            /*num_outputs=*/1,
            xla::util::MHash(stride, padding, dilation, transposed,
-                            output_padding, groups)),
+                            output_padding, groups, mixed_precision.Hash())),
       stride_(std::move(stride)),
       padding_(std::move(padding)),
       dilation_(std::move(dilation)),
       output_padding_(std::move(output_padding)),
       transposed_(transposed),
-      groups_(groups) {}
+      groups_(groups),
+      mixed_precision_(mixed_precision) {}
 
 NodePtr ConvolutionOverrideable::Clone(OpList operands) const {
   return operands.size() == 3
              ? MakeNode<ConvolutionOverrideable>(
                    operands.at(0), operands.at(1), operands.at(2), stride_,
-                   padding_, dilation_, transposed_, output_padding_, groups_)
+                   padding_, dilation_, transposed_, output_padding_, groups_,
+                   mixed_precision_)
              : MakeNode<ConvolutionOverrideable>(
                    operands.at(0), operands.at(1), stride_, padding_, dilation_,
-                   transposed_, output_padding_, groups_);
+                   transposed_, output_padding_, groups_, mixed_precision_);
 }
 
 XlaOpVector ConvolutionOverrideable::Lower(LoweringContext* loctx) const {
@@ -90,14 +96,15 @@ XlaOpVector ConvolutionOverrideable::Lower(LoweringContext* loctx) const {
   xla::XlaOp output;
   if (operands().size() == 3) {
     xla::XlaOp bias = loctx->GetOutputOp(operand(2));
-    output = BuildConvolutionOverrideableBias(input, kernel, bias, stride_,
-                                              padding_, dilation_, transposed_,
-                                              output_padding_, groups_);
+    output = BuildConvolutionOverrideableBias(
+        input, kernel, bias, stride_, padding_, dilation_, transposed_,
+        output_padding_, groups_, mixed_precision_);
   } else {
     XLA_CHECK_EQ(operands().size(), 2);
     output = BuildConvolutionOverrideable(input, kernel, stride_, padding_,
                                           dilation_, transposed_,
-                                          output_padding_, groups_);
+                                          output_padding_, groups_,
+                                          mixed_precision_);
   }
   return ReturnOp(output, loctx);
 }
@@ -108,7 +115,7 @@ std::string ConvolutionOverrideable::ToString() const {
      << "], padding=[" << absl::StrJoin(padding_, ", ") << "], dilation=["
      << absl::StrJoin(dilation_, ", ") << "], transpose=" << transposed_
      << ", output_padding=[" << absl::StrJoin(output_padding_, ", ")
-     << "], groups=" << groups_;
+     << "], groups=" << groups_ << ", " << mixed_precision_.ToString();
   return ss.str();
 }
 
@@ -2,6 +2,7 @@
 
 #include "tensorflow/compiler/xla/xla_data.pb.h"
 #include "tensorflow/core/lib/gtl/array_slice.h"
+#include "torch_xla/csrc/helpers.h"
 #include "torch_xla/csrc/ir.h"
 
 namespace torch_xla {
@@ -16,14 +17,16 @@ class ConvolutionOverrideable : public Node {
                           std::vector<xla::int64> padding,
                           std::vector<xla::int64> dilation, bool transposed,
                           std::vector<xla::int64> output_padding,
-                          xla::int64 groups);
+                          xla::int64 groups,
+                          XlaHelpers::MixedPrecision mixed_precision);
 
   ConvolutionOverrideable(const Value& input, const Value& weight,
                           std::vector<xla::int64> stride,
                           std::vector<xla::int64> padding,
                           std::vector<xla::int64> dilation, bool transposed,
                           std::vector<xla::int64> output_padding,
-                          xla::int64 groups);
+                          xla::int64 groups,
+                          XlaHelpers::MixedPrecision mixed_precision);
 
   NodePtr Clone(OpList operands) const override;
 
@@ -45,6 +48,10 @@ class ConvolutionOverrideable : public Node {
 
   xla::int64 groups() const { return groups_; }
 
+  const XlaHelpers::MixedPrecision& mixed_precision() const {
+    return mixed_precision_;
+  }
+
  private:
   std::vector<xla::int64> stride_;
   std::vector<xla::int64> padding_;
@@ -52,6 +59,7 @@ class ConvolutionOverrideable : public Node {
   std::vector<xla::int64> output_padding_;
   bool transposed_;
   xla::int64 groups_;
+  XlaHelpers::MixedPrecision mixed_precision_;
 };
 
 }  // namespace ops
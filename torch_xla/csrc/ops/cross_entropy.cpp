@@ -0,0 +1,59 @@
+#include "torch_xla/csrc/ops/cross_entropy.h"
+
+#include "tensorflow/compiler/xla/xla_client/util.h"
+#include "torch_xla/csrc/lowering_context.h"
+#include "torch_xla/csrc/nll_loss.h"
+#include "torch_xla/csrc/ops/infer_output_shape.h"
+#include "torch_xla/csrc/ops/xla_ops.h"
+
+namespace torch_xla {
+namespace ir {
+namespace ops {
+namespace {
+
+xla::Shape NodeOutputShape(const Value& logits, const Value& log_sum_exp,
+                           const Value& labels, int ignore_index) {
+  auto lower_for_shape_fn =
+      [&](tensorflow::gtl::ArraySlice<const xla::XlaOp> operands)
+      -> xla::XlaOp {
+    return BuildCrossEntropy(operands[0], operands[1], operands[2],
+                             ignore_index);
+  };
+  return InferOutputShape(
+      {logits.shape(), log_sum_exp.shape(), labels.shape()},
+      lower_for_shape_fn);
+}
+
+}  // namespace
+
+CrossEntropy::CrossEntropy(const Value& logits, const Value& log_sum_exp,
+                           const Value& labels, int ignore_index)
+    : Node(xla_cross_entropy, {logits, log_sum_exp, labels},
+           [&]() {
+             return NodeOutputShape(logits, log_sum_exp, labels, ignore_index);
+           },
+           /*num_outputs=*/1, xla::util::MHash(ignore_index)),
+      ignore_index_(ignore_index) {}
+
+std::string CrossEntropy::ToString() const {
+  std::stringstream ss;
+  ss << Node::ToString() << ", ignore_index=" << ignore_index_;
+  return ss.str();
+}
+
+NodePtr CrossEntropy::Clone(OpList operands) const {
+  return MakeNode<CrossEntropy>(operands.at(0), operands.at(1), operands.at(2),
+                                ignore_index_);
+}
+
+XlaOpVector CrossEntropy::Lower(LoweringContext* loctx) const {
+  xla::XlaOp logits = loctx->GetOutputOp(operand(0));
+  xla::XlaOp log_sum_exp = loctx->GetOutputOp(operand(1));
+  xla::XlaOp labels = loctx->GetOutputOp(operand(2));
+  return ReturnOp(BuildCrossEntropy(logits, log_sum_exp, labels, ignore_index_),
+                  loctx);
+}
+
+}  // namespace ops
+}  // namespace ir
+}  // namespace torch_xla
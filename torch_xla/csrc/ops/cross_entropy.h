@@ -0,0 +1,32 @@
+#pragma once
+
+#include "torch_xla/csrc/ir.h"
+
+namespace torch_xla {
+namespace ir {
+namespace ops {
+
+// IR node for the NllLoss of a LogSoftmax, computed from the LogSoftmax input
+// logits and their LogSumExp along the class dimension. Unlike the
+// NllLoss(LogSoftmax(logits)) sequence, this does not need the log-probability
+// tensor, which then does not have to be kept for the backward pass either.
+class CrossEntropy : public Node {
+ public:
+  CrossEntropy(const Value& logits, const Value& log_sum_exp,
+               const Value& labels, int ignore_index);
+
+  std::string ToString() const override;
+
+  NodePtr Clone(OpList operands) const override;
+
+  XlaOpVector Lower(LoweringContext* loctx) const override;
+
+  int ignore_index() const { return ignore_index_; }
+
+ private:
+  int ignore_index_;
+};
+
+}  // namespace ops
+}  // namespace ir
+}  // namespace torch_xla
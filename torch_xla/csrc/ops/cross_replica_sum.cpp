@@ -1,6 +1,7 @@
 #include "torch_xla/csrc/ops/cross_replica_sum.h"
 
 #include "absl/strings/str_join.h"
+#include "tensorflow/compiler/xla/shape_util.h"
 #include "tensorflow/compiler/xla/xla_client/util.h"
 #include "torch_xla/csrc/cross_replica_reduces.h"
 #include "torch_xla/csrc/lowering_context.h"
@@ -10,12 +11,33 @@ namespace torch_xla {
 namespace ir {
 namespace ops {
 
-CrossReplicaSum::CrossReplicaSum(const Value& operand, double scale,
-                                 std::vector<std::vector<xla::int64>> groups)
-    : Node(xla_cross_replica_sum, {operand}, operand.shape(),
-           /*num_outputs=*/1, xla::util::MHash(scale, groups)),
+namespace {
+
+xla::Shape NodeOutputShape(OpList operands) {
+  if (operands.size() == 1) {
+    return operands[0].shape();
+  }
+  std::vector<xla::Shape> shapes;
+  for (auto& operand : operands) {
+    shapes.push_back(operand.shape());
+  }
+  return xla::ShapeUtil::MakeTupleShape(shapes);
+}
+
+}  // namespace
+
+CrossReplicaSum::CrossReplicaSum(
+    OpList operands, double scale, std::vector<std::vector<xla::int64>> groups,
+    CrossReplicaSumCompression compression,
+    std::vector<std::vector<xla::int64>> host_groups)
+    : Node(xla_cross_replica_sum, operands, NodeOutputShape(operands),
+           /*num_outputs=*/operands.size(),
+           xla::util::MHash(scale, groups, static_cast<int>(compression),
+                            host_groups)),
       scale_(scale),
-      groups_(std::move(groups)) {}
+      groups_(std::move(groups)),
+      compression_(compression),
+      host_groups_(std::move(host_groups)) {}
 
 std::string CrossReplicaSum::ToString() const {
   std::stringstream ss;
@@ -25,17 +47,33 @@ std::string CrossReplicaSum::ToString() const {
     ss << absl::StrJoin(groups_[i], ", ") << ")";
   }
   ss << ")";
+  if (compression_ == CrossReplicaSumCompression::kBF16) {
+    ss << ", compression=bf16";
+  }
+  if (!host_groups_.empty()) {
+    ss << ", host_groups=(";
+    for (size_t i = 0; i < host_groups_.size(); ++i) {
+      ss << (i == 0 ? "(" : ",(");
+      ss << absl::StrJoin(host_groups_[i], ", ") << ")";
+    }
+    ss << ")";
+  }
   return ss.str();
 }
 
 NodePtr CrossReplicaSum::Clone(OpList operands) const {
-  return MakeNode<CrossReplicaSum>(operands.at(0), scale_, groups_);
+  return MakeNode<CrossReplicaSum>(operands, scale_, groups_, compression_,
+                                   host_groups_);
 }
 
 XlaOpVector CrossReplicaSum::Lower(LoweringContext* loctx) const {
-  xla::XlaOp op = loctx->GetOutputOp(operand(0));
-  xla::XlaOp crs = BuildCrossReplicaSum(op, scale_, groups_);
-  return ReturnOp(crs, loctx);
+  std::vector<xla::XlaOp> ops;
+  for (auto& operand : operands()) {
+    ops.push_back(loctx->GetOutputOp(operand));
+  }
+  return ReturnOps(BuildCrossReplicaSum(ops, scale_, groups_, compression_,
+                                        host_groups_),
+                   loctx);
 }
 
 }  // namespace ops
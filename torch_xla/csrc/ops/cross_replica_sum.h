@@ -1,15 +1,21 @@
 #pragma once
 
+#include "torch_xla/csrc/cross_replica_reduces.h"
 #include "torch_xla/csrc/ir.h"
 
 namespace torch_xla {
 namespace ir {
 namespace ops {
 
+// Sums the operands across replicas with a single collective, producing one
+// output per operand. A non empty host_groups list selects the hierarchical
+// collective, spanning all the replicas.
 class CrossReplicaSum : public Node {
  public:
-  CrossReplicaSum(const Value& operand, double scale,
-                  std::vector<std::vector<xla::int64>> groups);
+  CrossReplicaSum(OpList operands, double scale,
+                  std::vector<std::vector<xla::int64>> groups,
+                  CrossReplicaSumCompression compression,
+                  std::vector<std::vector<xla::int64>> host_groups);
 
   std::string ToString() const override;
 
@@ -21,9 +27,17 @@ class CrossReplicaSum : public Node {
 
   const std::vector<std::vector<xla::int64>>& groups() const { return groups_; }
 
+  CrossReplicaSumCompression compression() const { return compression_; }
+
+  const std::vector<std::vector<xla::int64>>& host_groups() const {
+    return host_groups_;
+  }
+
  private:
   double scale_;
   std::vector<std::vector<xla::int64>> groups_;
+  CrossReplicaSumCompression compression_;
+  std::vector<std::vector<xla::int64>> host_groups_;
 };
 
 }  // namespace ops
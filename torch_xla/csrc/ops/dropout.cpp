@@ -8,18 +8,19 @@ namespace torch_xla {
 namespace ir {
 namespace ops {
 
-Dropout::Dropout(const Value& input, double probability)
-    : Node(ir::OpKind(at::aten::dropout), {input}, input.shape(),
+Dropout::Dropout(const Value& input, const Value& seed, double probability)
+    : Node(ir::OpKind(at::aten::dropout), {input, seed}, input.shape(),
            /*num_outputs=*/1, xla::util::MHash(probability)),
       probability_(probability) {}
 
 NodePtr Dropout::Clone(OpList operands) const {
-  return MakeNode<Dropout>(operands.at(0), probability_);
+  return MakeNode<Dropout>(operands.at(0), operands.at(1), probability_);
 }
 
 XlaOpVector Dropout::Lower(LoweringContext* loctx) const {
   xla::XlaOp input = loctx->GetOutputOp(operand(0));
-  return ReturnOp(BuildDropout(input, probability_), loctx);
+  xla::XlaOp seed = loctx->GetOutputOp(operand(1));
+  return ReturnOp(BuildDropout(input, probability_, seed), loctx);
 }
 
 std::string Dropout::ToString() const {
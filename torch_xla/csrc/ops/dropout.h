@@ -8,7 +8,7 @@ namespace ops {
 
 class Dropout : public Node {
  public:
-  Dropout(const Value& input, double probability);
+  Dropout(const Value& input, const Value& seed, double probability);
 
   std::string ToString() const override;
 
@@ -3,6 +3,7 @@
 #include "tensorflow/compiler/xla/client/lib/matrix.h"
 #include "tensorflow/compiler/xla/xla_client/util.h"
 #include "torch_xla/csrc/data_ops.h"
+#include "torch_xla/csrc/einsum_planner.h"
 #include "torch_xla/csrc/helpers.h"
 #include "torch_xla/csrc/lowering_context.h"
 #include "torch_xla/csrc/ops/infer_output_shape.h"
@@ -12,22 +13,36 @@ namespace ir {
 namespace ops {
 namespace {
 
-xla::Shape NodeOutputShape(tensorflow::gtl::ArraySlice<const ir::Value> values,
-                           const std::string& equation) {
-  XLA_CHECK_EQ(values.size(), 2)
-      << "Only two inputs supported for einsum for now";
-  auto lower_for_shape_fn =
-      [equation](tensorflow::gtl::ArraySlice<const xla::XlaOp> operands)
-      -> xla::XlaOp {
-    return xla::Einsum(operands[0], operands[1], equation,
-                       XlaHelpers::mat_mul_precision());
-  };
+std::vector<xla::Shape> GetShapes(
+    tensorflow::gtl::ArraySlice<const ir::Value> values) {
   std::vector<xla::Shape> shapes;
   shapes.reserve(values.size());
   for (auto& value : values) {
     shapes.push_back(value.shape());
   }
-  return InferOutputShape(shapes, lower_for_shape_fn);
+  return shapes;
+}
+
+xla::XlaOp BuildEinsum(const EinsumPlan* plan,
+                       tensorflow::gtl::ArraySlice<const xla::XlaOp> operands,
+                       const std::string& equation) {
+  if (plan != nullptr) {
+    return plan->Build(operands);
+  }
+  XLA_CHECK_EQ(operands.size(), 2)
+      << "Only two inputs supported for einsum for now";
+  return xla::Einsum(operands[0], operands[1], equation,
+                     XlaHelpers::mat_mul_precision());
+}
+
+xla::Shape NodeOutputShape(tensorflow::gtl::ArraySlice<const ir::Value> values,
+                           const std::string& equation) {
+  std::shared_ptr<const EinsumPlan> plan =
+      EinsumPlan::Get(equation, GetShapes(values));
+  auto lower_for_shape_fn =
+      [&](tensorflow::gtl::ArraySlice<const xla::XlaOp> operands)
+      -> xla::XlaOp { return BuildEinsum(plan.get(), operands, equation); };
+  return InferOutputShape(GetShapes(values), lower_for_shape_fn);
 }
 
 }  // namespace
@@ -37,17 +52,19 @@ Einsum::Einsum(const std::string& equation,
     : Node(ir::OpKind(at::aten::einsum), values,
            [&]() { return NodeOutputShape(values, equation); },
            /*num_outputs=*/1, xla::util::MHash(equation)),
-      equation_(equation) {}
+      equation_(equation),
+      plan_(EinsumPlan::Get(equation, GetShapes(values))) {}
 
 NodePtr Einsum::Clone(OpList operands) const {
   return MakeNode<Einsum>(equation_, operands);
 }
 
 XlaOpVector Einsum::Lower(LoweringContext* loctx) const {
-  xla::XlaOp output = xla::Einsum(loctx->GetOutputOp(operand(0)),
-                                  loctx->GetOutputOp(operand(1)), equation_,
-                                  XlaHelpers::mat_mul_precision());
-  return ReturnOp(output, loctx);
+  std::vector<xla::XlaOp> xla_operands;
+  for (auto& operand : operands()) {
+    xla_operands.push_back(loctx->GetOutputOp(operand));
+  }
+  return ReturnOp(BuildEinsum(plan_.get(), xla_operands, equation_), loctx);
 }
 
 std::string Einsum::ToString() const {
@@ -56,7 +73,14 @@ std::string Einsum::ToString() const {
   return ss.str();
 }
 
-bool Einsum::SupportsEquation(const std::string& equation) {
+bool Einsum::SupportsEquation(const std::string& equation,
+                              size_t num_operands) {
+  if (EinsumPlan::SupportsEquation(equation, num_operands)) {
+    return true;
+  }
+  if (num_operands != 2) {
+    return false;
+  }
   auto einsum_config_numeric_or_err = xla::ParseEinsumString(equation);
   if (!einsum_config_numeric_or_err.ok()) {
     return false;
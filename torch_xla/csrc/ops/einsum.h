@@ -1,6 +1,9 @@
 #pragma once
 
+#include <memory>
+
 #include "tensorflow/core/lib/gtl/array_slice.h"
+#include "torch_xla/csrc/einsum_planner.h"
 #include "torch_xla/csrc/ir.h"
 
 namespace torch_xla {
@@ -20,10 +23,15 @@ class Einsum : public Node {
 
   const std::string& equation() const { return equation_; }
 
-  static bool SupportsEquation(const std::string& equation);
+  // Returns whether the equation is supported with num_operands operands.
+  static bool SupportsEquation(const std::string& equation,
+                               size_t num_operands);
 
  private:
   std::string equation_;
+  // The lowering plan of the equation, or nullptr if the planner does not
+  // support it, in which case the lowering goes through xla::Einsum().
+  std::shared_ptr<const EinsumPlan> plan_;
 };
 
 }  // namespace ops
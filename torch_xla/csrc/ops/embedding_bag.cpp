@@ -0,0 +1,72 @@
+#include "torch_xla/csrc/ops/embedding_bag.h"
+
+#include "tensorflow/compiler/xla/xla_client/debug_macros.h"
+#include "tensorflow/compiler/xla/xla_client/util.h"
+#include "torch_xla/csrc/lowering_context.h"
+#include "torch_xla/csrc/ops/infer_output_shape.h"
+
+namespace torch_xla {
+namespace ir {
+namespace ops {
+namespace {
+
+xla::Shape NodeOutputShape(const Value& weight, const Value& indices,
+                           const Value& offsets,
+                           const Value& per_sample_weights,
+                           EmbeddingBagMode mode) {
+  auto lower_for_shape_fn =
+      [&](tensorflow::gtl::ArraySlice<const xla::XlaOp> operands)
+      -> xla::XlaOp {
+    XLA_CHECK_EQ(operands.size(), 4);
+    EmbeddingBagResult result = BuildEmbeddingBag(
+        operands[0], operands[1], operands[2], operands[3], mode);
+    return xla::Tuple(operands[0].builder(),
+                      {result.output, result.offset2bag, result.bag_size,
+                       result.max_indices});
+  };
+  return InferOutputShape({weight.shape(), indices.shape(), offsets.shape(),
+                           per_sample_weights.shape()},
+                          lower_for_shape_fn);
+}
+
+}  // namespace
+
+EmbeddingBag::EmbeddingBag(const Value& weight, const Value& indices,
+                           const Value& offsets,
+                           const Value& per_sample_weights,
+                           EmbeddingBagMode mode)
+    : Node(ir::OpKind(at::aten::_embedding_bag),
+           {weight, indices, offsets, per_sample_weights},
+           [&]() {
+             return NodeOutputShape(weight, indices, offsets,
+                                    per_sample_weights, mode);
+           },
+           /*num_outputs=*/4, xla::util::MHash(static_cast<int>(mode))),
+      mode_(mode) {}
+
+std::string EmbeddingBag::ToString() const {
+  std::stringstream ss;
+  ss << Node::ToString() << ", mode=" << static_cast<int>(mode_);
+  return ss.str();
+}
+
+NodePtr EmbeddingBag::Clone(OpList operands) const {
+  return MakeNode<EmbeddingBag>(operands.at(0), operands.at(1),
+                                operands.at(2), operands.at(3), mode_);
+}
+
+XlaOpVector EmbeddingBag::Lower(LoweringContext* loctx) const {
+  xla::XlaOp weight = loctx->GetOutputOp(operand(0));
+  xla::XlaOp indices = loctx->GetOutputOp(operand(1));
+  xla::XlaOp offsets = loctx->GetOutputOp(operand(2));
+  xla::XlaOp per_sample_weights = loctx->GetOutputOp(operand(3));
+  EmbeddingBagResult result =
+      BuildEmbeddingBag(weight, indices, offsets, per_sample_weights, mode_);
+  return ReturnOps({result.output, result.offset2bag, result.bag_size,
+                    result.max_indices},
+                   loctx);
+}
+
+}  // namespace ops
+}  // namespace ir
+}  // namespace torch_xla
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "torch_xla/csrc/embedding_bag.h"
+#include "torch_xla/csrc/ir.h"
+
+namespace torch_xla {
+namespace ir {
+namespace ops {
+
+// The embedding bag, with the output, offset2bag, bag_size and max_indices
+// outputs of BuildEmbeddingBag(). The per_sample_weights are a scalar when
+// missing.
+class EmbeddingBag : public Node {
+ public:
+  EmbeddingBag(const Value& weight, const Value& indices, const Value& offsets,
+               const Value& per_sample_weights, EmbeddingBagMode mode);
+
+  std::string ToString() const override;
+
+  NodePtr Clone(OpList operands) const override;
+
+  XlaOpVector Lower(LoweringContext* loctx) const override;
+
+  EmbeddingBagMode mode() const { return mode_; }
+
+ private:
+  EmbeddingBagMode mode_;
+};
+
+}  // namespace ops
+}  // namespace ir
+}  // namespace torch_xla
@@ -0,0 +1,59 @@
+#include "torch_xla/csrc/ops/embedding_bag_backward.h"
+
+#include "tensorflow/compiler/xla/shape_util.h"
+#include "tensorflow/compiler/xla/xla_client/util.h"
+#include "torch_xla/csrc/lowering_context.h"
+
+namespace torch_xla {
+namespace ir {
+namespace ops {
+
+EmbeddingBagBackward::EmbeddingBagBackward(
+    const Value& grad, const Value& indices, const Value& offset2bag,
+    const Value& bag_size, const Value& max_indices,
+    const Value& per_sample_weights, xla::int64 num_weights,
+    bool scale_grad_by_freq, EmbeddingBagMode mode)
+    : Node(ir::OpKind(at::aten::_embedding_bag_dense_backward),
+           {grad, indices, offset2bag, bag_size, max_indices,
+            per_sample_weights},
+           xla::ShapeUtil::MakeShape(grad.shape().element_type(),
+                                     {num_weights, grad.shape().dimensions(1)}),
+           /*num_outputs=*/1,
+           xla::util::MHash(num_weights, scale_grad_by_freq,
+                            static_cast<int>(mode))),
+      num_weights_(num_weights),
+      scale_grad_by_freq_(scale_grad_by_freq),
+      mode_(mode) {}
+
+std::string EmbeddingBagBackward::ToString() const {
+  std::stringstream ss;
+  ss << Node::ToString() << ", num_weights=" << num_weights_
+     << ", scale_grad_by_freq=" << scale_grad_by_freq_
+     << ", mode=" << static_cast<int>(mode_);
+  return ss.str();
+}
+
+NodePtr EmbeddingBagBackward::Clone(OpList operands) const {
+  return MakeNode<EmbeddingBagBackward>(
+      operands.at(0), operands.at(1), operands.at(2), operands.at(3),
+      operands.at(4), operands.at(5), num_weights_, scale_grad_by_freq_,
+      mode_);
+}
+
+XlaOpVector EmbeddingBagBackward::Lower(LoweringContext* loctx) const {
+  xla::XlaOp grad = loctx->GetOutputOp(operand(0));
+  xla::XlaOp indices = loctx->GetOutputOp(operand(1));
+  xla::XlaOp offset2bag = loctx->GetOutputOp(operand(2));
+  xla::XlaOp bag_size = loctx->GetOutputOp(operand(3));
+  xla::XlaOp max_indices = loctx->GetOutputOp(operand(4));
+  xla::XlaOp per_sample_weights = loctx->GetOutputOp(operand(5));
+  return ReturnOp(BuildEmbeddingBagBackward(
+                      grad, indices, offset2bag, bag_size, max_indices,
+                      per_sample_weights, num_weights_, scale_grad_by_freq_,
+                      mode_),
+                  loctx);
+}
+
+}  // namespace ops
+}  // namespace ir
+}  // namespace torch_xla
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "torch_xla/csrc/embedding_bag.h"
+#include "torch_xla/csrc/ir.h"
+
+namespace torch_xla {
+namespace ir {
+namespace ops {
+
+// The dense weight gradient of EmbeddingBag, see BuildEmbeddingBagBackward().
+class EmbeddingBagBackward : public Node {
+ public:
+  EmbeddingBagBackward(const Value& grad, const Value& indices,
+                       const Value& offset2bag, const Value& bag_size,
+                       const Value& max_indices,
+                       const Value& per_sample_weights, xla::int64 num_weights,
+                       bool scale_grad_by_freq, EmbeddingBagMode mode);
+
+  std::string ToString() const override;
+
+  NodePtr Clone(OpList operands) const override;
+
+  XlaOpVector Lower(LoweringContext* loctx) const override;
+
+  xla::int64 num_weights() const { return num_weights_; }
+
+  bool scale_grad_by_freq() const { return scale_grad_by_freq_; }
+
+  EmbeddingBagMode mode() const { return mode_; }
+
+ private:
+  xla::int64 num_weights_;
+  bool scale_grad_by_freq_;
+  EmbeddingBagMode mode_;
+};
+
+}  // namespace ops
+}  // namespace ir
+}  // namespace torch_xla
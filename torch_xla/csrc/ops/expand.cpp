@@ -1,11 +1,12 @@
 #include "torch_xla/csrc/ops/expand.h"
 
 #include "absl/strings/str_join.h"
+#include "tensorflow/compiler/xla/shape_util.h"
+#include "tensorflow/compiler/xla/xla_client/debug_macros.h"
 #include "tensorflow/compiler/xla/xla_client/util.h"
 #include "torch_xla/csrc/data_ops.h"
 #include "torch_xla/csrc/helpers.h"
 #include "torch_xla/csrc/lowering_context.h"
-#include "torch_xla/csrc/ops/infer_output_shape.h"
 
 namespace torch_xla {
 namespace ir {
@@ -14,10 +15,8 @@ namespace {
 
 xla::Shape NodeOutputShape(const Value& input,
                            const std::vector<xla::int64>& size) {
-  auto lower_for_shape_fn =
-      [&](tensorflow::gtl::ArraySlice<const xla::XlaOp> operands)
-      -> xla::XlaOp { return BuildExpand(operands[0], size); };
-  return InferOutputShape({input.shape()}, lower_for_shape_fn);
+  XLA_CHECK_LE(input.shape().rank(), size.size());
+  return xla::ShapeUtil::MakeShape(input.shape().element_type(), size);
 }
 
 }  // namespace
@@ -0,0 +1,78 @@
+#include "torch_xla/csrc/ops/fused_convolution.h"
+
+#include "absl/strings/str_join.h"
+#include "tensorflow/compiler/xla/xla_client/debug_macros.h"
+#include "tensorflow/compiler/xla/xla_client/util.h"
+#include "torch_xla/csrc/convolution.h"
+#include "torch_xla/csrc/elementwise.h"
+#include "torch_xla/csrc/lowering_context.h"
+#include "torch_xla/csrc/ops/xla_ops.h"
+
+namespace torch_xla {
+namespace ir {
+namespace ops {
+
+FusedConvolution::FusedConvolution(
+    const Value& input, const Value& weight, const Value& bias,
+    xla::Shape shape, std::vector<xla::int64> stride,
+    std::vector<xla::int64> padding, std::vector<xla::int64> dilation,
+    xla::int64 groups, XlaHelpers::MixedPrecision mixed_precision,
+    Activation activation, double negative_slope)
+    : Node(xla_fused_convolution, {input, weight, bias}, std::move(shape),
+           /*num_outputs=*/1,
+           xla::util::MHash(stride, padding, dilation, groups,
+                            mixed_precision.Hash(),
+                            static_cast<int>(activation), negative_slope)),
+      stride_(std::move(stride)),
+      padding_(std::move(padding)),
+      dilation_(std::move(dilation)),
+      groups_(groups),
+      mixed_precision_(mixed_precision),
+      activation_(activation),
+      negative_slope_(negative_slope) {}
+
+NodePtr FusedConvolution::Clone(OpList operands) const {
+  return MakeNode<FusedConvolution>(operands.at(0), operands.at(1),
+                                    operands.at(2), shape(), stride_, padding_,
+                                    dilation_, groups_, mixed_precision_,
+                                    activation_, negative_slope_);
+}
+
+XlaOpVector FusedConvolution::Lower(LoweringContext* loctx) const {
+  xla::XlaOp input = loctx->GetOutputOp(operand(0));
+  xla::XlaOp kernel = loctx->GetOutputOp(operand(1));
+  xla::XlaOp bias = loctx->GetOutputOp(operand(2));
+  xla::XlaOp output = BuildConvolutionOverrideableBias(
+      input, kernel, bias, stride_, padding_, dilation_, /*transposed=*/false,
+      /*output_padding=*/std::vector<xla::int64>(stride_.size(), 0), groups_,
+      mixed_precision_);
+  switch (activation_) {
+    case Activation::kNone:
+      break;
+    case Activation::kRelu:
+      output = BuildRelu(output);
+      break;
+    case Activation::kLeakyRelu:
+      output = BuildLeakyRelu(output, negative_slope_);
+      break;
+  }
+  return ReturnOp(output, loctx);
+}
+
+std::string FusedConvolution::ToString() const {
+  static const char* const kActivationNames[] = {"none", "relu", "leaky_relu"};
+  std::stringstream ss;
+  ss << Node::ToString() << ", stride=[" << absl::StrJoin(stride_, ", ")
+     << "], padding=[" << absl::StrJoin(padding_, ", ") << "], dilation=["
+     << absl::StrJoin(dilation_, ", ") << "], groups=" << groups_ << ", "
+     << mixed_precision_.ToString()
+     << ", activation=" << kActivationNames[static_cast<int>(activation_)];
+  if (activation_ == Activation::kLeakyRelu) {
+    ss << ", negative_slope=" << negative_slope_;
+  }
+  return ss.str();
+}
+
+}  // namespace ops
+}  // namespace ir
+}  // namespace torch_xla
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "tensorflow/compiler/xla/xla_data.pb.h"
+#include "torch_xla/csrc/helpers.h"
+#include "torch_xla/csrc/ir.h"
+
+namespace torch_xla {
+namespace ir {
+namespace ops {
+
+// IR node for a non transposed convolution with bias, followed by an optional
+// activation, which the inference graph folding produces out of a convolution,
+// a batch normalization and an activation node.
+class FusedConvolution : public Node {
+ public:
+  enum class Activation {
+    kNone,
+    kRelu,
+    kLeakyRelu,
+  };
+
+  FusedConvolution(const Value& input, const Value& weight, const Value& bias,
+                   xla::Shape shape, std::vector<xla::int64> stride,
+                   std::vector<xla::int64> padding,
+                   std::vector<xla::int64> dilation, xla::int64 groups,
+                   XlaHelpers::MixedPrecision mixed_precision,
+                   Activation activation, double negative_slope);
+
+  NodePtr Clone(OpList operands) const override;
+
+  XlaOpVector Lower(LoweringContext* loctx) const override;
+
+  std::string ToString() const override;
+
+  Activation activation() const { return activation_; }
+
+  double negative_slope() const { return negative_slope_; }
+
+ private:
+  std::vector<xla::int64> stride_;
+  std::vector<xla::int64> padding_;
+  std::vector<xla::int64> dilation_;
+  xla::int64 groups_;
+  XlaHelpers::MixedPrecision mixed_precision_;
+  Activation activation_;
+  double negative_slope_;
+};
+
+}  // namespace ops
+}  // namespace ir
+}  // namespace torch_xla
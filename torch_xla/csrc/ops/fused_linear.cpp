@@ -0,0 +1,116 @@
+#include "torch_xla/csrc/ops/fused_linear.h"
+
+#include "tensorflow/compiler/xla/xla_client/debug_macros.h"
+#include "tensorflow/compiler/xla/xla_client/util.h"
+#include "torch_xla/csrc/data_ops.h"
+#include "torch_xla/csrc/elementwise.h"
+#include "torch_xla/csrc/lowering_context.h"
+#include "torch_xla/csrc/ops/infer_output_shape.h"
+#include "torch_xla/csrc/ops/xla_ops.h"
+
+namespace torch_xla {
+namespace ir {
+namespace ops {
+namespace {
+
+xla::XlaOp BuildFusedLinear(const xla::XlaOp& input, const xla::XlaOp& weight,
+                            const xla::XlaOp& bias,
+                            FusedLinear::Activation activation,
+                            const xla::PrecisionConfig* precision_config,
+                            const XlaHelpers::MixedPrecision& mixed_precision) {
+  xla::XlaOp dot = XlaHelpers::MixedPrecisionOp(
+      mixed_precision, input, weight,
+      [&](const xla::XlaOp& lhs, const xla::XlaOp& rhs) {
+        return xla::Dot(lhs, rhs, precision_config);
+      });
+  const auto dot_sizes = XlaHelpers::SizesOfXlaOp(dot);
+  xla::XlaOp expanded_bias = bias;
+  if (XlaHelpers::SizesOfXlaOp(bias) != dot_sizes) {
+    expanded_bias = BuildExpand(bias, dot_sizes);
+  }
+  xla::XlaOp output = XlaHelpers::PromotedAdd(dot, expanded_bias);
+  switch (activation) {
+    case FusedLinear::Activation::kNone:
+      break;
+    case FusedLinear::Activation::kRelu:
+      output = BuildRelu(output);
+      break;
+    case FusedLinear::Activation::kSigmoid:
+      output = BuildSigmoid(output);
+      break;
+    case FusedLinear::Activation::kTanh:
+      output = xla::Tanh(output);
+      break;
+  }
+  return output;
+}
+
+xla::Shape NodeOutputShape(const Value& input, const Value& weight,
+                           const Value& bias,
+                           const XlaHelpers::MixedPrecision& mixed_precision) {
+  auto lower_for_shape_fn =
+      [&](tensorflow::gtl::ArraySlice<const xla::XlaOp> operands)
+      -> xla::XlaOp {
+    return BuildFusedLinear(operands[0], operands[1], operands[2],
+                            FusedLinear::Activation::kNone,
+                            /*precision_config=*/nullptr, mixed_precision);
+  };
+  return InferOutputShape({input.shape(), weight.shape(), bias.shape()},
+                          lower_for_shape_fn);
+}
+
+}  // namespace
+
+FusedLinear::FusedLinear(const Value& input, const Value& weight,
+                         const Value& bias, Activation activation,
+                         xla::PrecisionConfig::Precision precision_level,
+                         XlaHelpers::MixedPrecision mixed_precision)
+    : Node(xla_fused_linear, {input, weight, bias},
+           [&]() {
+             return NodeOutputShape(input, weight, bias, mixed_precision);
+           },
+           /*num_outputs=*/1,
+           xla::util::MHash(static_cast<int>(activation),
+                            static_cast<int>(precision_level),
+                            mixed_precision.Hash())),
+      activation_(activation),
+      precision_level_(precision_level),
+      mixed_precision_(mixed_precision) {}
+
+NodePtr FusedLinear::WithActivation(Activation activation) const {
+  return MakeNode<FusedLinear>(operand_value(0), operand_value(1),
+                               operand_value(2), activation, precision_level_,
+                               mixed_precision_);
+}
+
+NodePtr FusedLinear::Clone(OpList operands) const {
+  return MakeNode<FusedLinear>(operands.at(0), operands.at(1), operands.at(2),
+                               activation_, precision_level_,
+                               mixed_precision_);
+}
+
+XlaOpVector FusedLinear::Lower(LoweringContext* loctx) const {
+  xla::XlaOp input = loctx->GetOutputOp(operand(0));
+  xla::XlaOp weight = loctx->GetOutputOp(operand(1));
+  xla::XlaOp bias = loctx->GetOutputOp(operand(2));
+  xla::PrecisionConfig precision_config =
+      XlaHelpers::BuildPrecisionConfig(precision_level_);
+  return ReturnOp(BuildFusedLinear(input, weight, bias, activation_,
+                                   &precision_config, mixed_precision_),
+                  loctx);
+}
+
+std::string FusedLinear::ToString() const {
+  static const char* const kActivationNames[] = {"none", "relu", "sigmoid",
+                                                 "tanh"};
+  std::stringstream ss;
+  ss << Node::ToString() << ", activation="
+     << kActivationNames[static_cast<int>(activation_)]
+     << ", precision=" << static_cast<int>(precision_level_) << ", "
+     << mixed_precision_.ToString();
+  return ss.str();
+}
+
+}  // namespace ops
+}  // namespace ir
+}  // namespace torch_xla
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "tensorflow/compiler/xla/xla_data.pb.h"
+#include "torch_xla/csrc/helpers.h"
+#include "torch_xla/csrc/ir.h"
+
+namespace torch_xla {
+namespace ir {
+namespace ops {
+
+// IR node for the bias + input @ weight matmul of addmm, followed by an
+// optional element-wise activation epilogue. The activation nodes reading an
+// un-activated FusedLinear output are folded into it at trace time, so that
+// the whole chain is lowered next to the dot, as a single fusion candidate,
+// and the pre-activation value does not need to be materialized.
+class FusedLinear : public Node {
+ public:
+  enum class Activation {
+    kNone,
+    kRelu,
+    kSigmoid,
+    kTanh,
+  };
+
+  FusedLinear(const Value& input, const Value& weight, const Value& bias,
+              Activation activation,
+              xla::PrecisionConfig::Precision precision_level,
+              XlaHelpers::MixedPrecision mixed_precision);
+
+  // Returns a node computing the same matmul, with the given activation.
+  NodePtr WithActivation(Activation activation) const;
+
+  NodePtr Clone(OpList operands) const override;
+
+  XlaOpVector Lower(LoweringContext* loctx) const override;
+
+  std::string ToString() const override;
+
+  Activation activation() const { return activation_; }
+
+ private:
+  Activation activation_;
+  xla::PrecisionConfig::Precision precision_level_;
+  XlaHelpers::MixedPrecision mixed_precision_;
+};
+
+}  // namespace ops
+}  // namespace ir
+}  // namespace torch_xla
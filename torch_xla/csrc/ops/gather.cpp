@@ -2,9 +2,9 @@
 
 #include "tensorflow/compiler/xla/client/lib/slicing.h"
 #include "tensorflow/compiler/xla/shape_util.h"
-#include "tensorflow/compiler/xla/xla_client/sys_util.h"
 #include "tensorflow/compiler/xla/xla_client/util.h"
 #include "torch_xla/csrc/helpers.h"
+#include "torch_xla/csrc/index_cost_model.h"
 #include "torch_xla/csrc/lowering_context.h"
 #include "torch_xla/csrc/ops/infer_output_shape.h"
 
@@ -15,23 +15,19 @@ namespace {
 
 bool IsSparseGather(const xla::XlaOp& input, const xla::XlaOp& index,
                     xla::int64 dim) {
-  static int dense_gather_factor =
-      xla::sys_util::GetEnvInt("XLA_DENSE_GATHER_FACTOR", 100);
-  xla::Shape input_shape = XlaHelpers::ShapeOfXlaOp(input);
-  xla::Shape index_shape = XlaHelpers::ShapeOfXlaOp(index);
-  xla::int64 input_elements = xla::ShapeUtil::ElementsIn(input_shape);
-  xla::int64 index_elements = xla::ShapeUtil::ElementsIn(index_shape);
-  // Simple heuristic. Might need fine tuning.
-  return index_elements < input_elements / dense_gather_factor;
+  return !IndexCostModel::Get()->UseDense(IndexCostModel::Op::kGather,
+                                          XlaHelpers::ShapeOfXlaOp(input),
+                                          XlaHelpers::ShapeOfXlaOp(index));
 }
 
 xla::Shape NodeOutputShape(const Value& input, const Value& index,
                            xla::int64 dim) {
+  // The output shape does not depend on the lowering, so avoid going through
+  // the IndexCostModel (and its decision counters).
   auto lower_for_shape_fn =
       [&](tensorflow::gtl::ArraySlice<const xla::XlaOp> operands)
       -> xla::XlaOp {
-    return TorchGather(operands[0], operands[1], dim,
-                       IsSparseGather(operands[0], operands[1], dim));
+    return TorchGather(operands[0], operands[1], dim, /*sparse=*/true);
   };
   return InferOutputShape({input.shape(), index.shape()}, lower_for_shape_fn);
 }
@@ -51,9 +47,10 @@ NodePtr Gather::Clone(OpList operands) const {
 XlaOpVector Gather::Lower(LoweringContext* loctx) const {
   xla::XlaOp input = loctx->GetOutputOp(operand(0));
   xla::XlaOp index = loctx->GetOutputOp(operand(1));
-  return ReturnOp(
-      TorchGather(input, index, dim_, IsSparseGather(input, index, dim_)),
-      loctx);
+  bool sparse = IsSparseGather(input, index, dim_);
+  xla::XlaOp narrowed_index = XlaHelpers::NarrowIndices(
+      index, XlaHelpers::ShapeOfXlaOp(input).dimensions(dim_));
+  return ReturnOp(TorchGather(input, narrowed_index, dim_, sparse), loctx);
 }
 
 std::string Gather::ToString() const {
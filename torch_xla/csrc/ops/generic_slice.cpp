@@ -1,10 +1,11 @@
 #include "torch_xla/csrc/ops/generic_slice.h"
 
 #include "absl/strings/str_join.h"
+#include "tensorflow/compiler/xla/shape_util.h"
+#include "tensorflow/compiler/xla/xla_client/debug_macros.h"
 #include "tensorflow/compiler/xla/xla_client/util.h"
 #include "torch_xla/csrc/data_ops.h"
 #include "torch_xla/csrc/lowering_context.h"
-#include "torch_xla/csrc/ops/infer_output_shape.h"
 #include "torch_xla/csrc/ops/xla_ops.h"
 
 namespace torch_xla {
@@ -16,10 +17,9 @@ xla::Shape NodeOutputShape(
     const Value& input,
     tensorflow::gtl::ArraySlice<const xla::int64> base_indices,
     tensorflow::gtl::ArraySlice<const xla::int64> sizes) {
-  auto lower_for_shape_fn =
-      [&](tensorflow::gtl::ArraySlice<const xla::XlaOp> operands)
-      -> xla::XlaOp { return BuildSlice(operands[0], base_indices, sizes); };
-  return InferOutputShape({input.shape()}, lower_for_shape_fn);
+  XLA_CHECK_EQ(base_indices.size(), sizes.size());
+  XLA_CHECK_EQ(sizes.size(), input.shape().rank());
+  return xla::ShapeUtil::MakeShape(input.shape().element_type(), sizes);
 }
 
 }  // namespace
@@ -0,0 +1,58 @@
+#include "torch_xla/csrc/ops/group_norm.h"
+
+#include "absl/strings/str_join.h"
+#include "tensorflow/compiler/xla/shape_util.h"
+#include "tensorflow/compiler/xla/xla_client/util.h"
+#include "torch_xla/csrc/batch_norm.h"
+#include "torch_xla/csrc/lowering_context.h"
+#include "torch_xla/csrc/ops/xla_ops.h"
+
+namespace torch_xla {
+namespace ir {
+namespace ops {
+namespace {
+
+xla::Shape NodeOutputShape(const Value& input, xla::int64 num_groups) {
+  xla::Shape groups_shape = xla::ShapeUtil::MakeShape(
+      input.shape().element_type(), {num_groups});
+  return xla::ShapeUtil::MakeTupleShape(
+      {input.shape(), groups_shape, groups_shape});
+}
+
+}  // namespace
+
+GroupNorm::GroupNorm(const Value& input, const Value& weight,
+                     const Value& bias, xla::int64 num_groups,
+                     std::vector<xla::int64> affine_dims, double eps)
+    : Node(xla_group_norm, {input, weight, bias},
+           NodeOutputShape(input, num_groups),
+           /*num_outputs=*/3, xla::util::MHash(num_groups, affine_dims, eps)),
+      num_groups_(num_groups),
+      affine_dims_(std::move(affine_dims)),
+      eps_(eps) {}
+
+std::string GroupNorm::ToString() const {
+  std::stringstream ss;
+  ss << Node::ToString() << ", num_groups=" << num_groups_
+     << ", affine_dims=[" << absl::StrJoin(affine_dims_, ", ")
+     << "], eps=" << eps_;
+  return ss.str();
+}
+
+NodePtr GroupNorm::Clone(OpList operands) const {
+  return MakeNode<GroupNorm>(operands.at(0), operands.at(1), operands.at(2),
+                             num_groups_, affine_dims_, eps_);
+}
+
+XlaOpVector GroupNorm::Lower(LoweringContext* loctx) const {
+  xla::XlaOp input = loctx->GetOutputOp(operand(0));
+  xla::XlaOp weight = loctx->GetOutputOp(operand(1));
+  xla::XlaOp bias = loctx->GetOutputOp(operand(2));
+  GroupNormOutput output =
+      BuildGroupNorm(input, weight, bias, num_groups_, affine_dims_, eps_);
+  return ReturnOps({output.output, output.mean, output.rstd}, loctx);
+}
+
+}  // namespace ops
+}  // namespace ir
+}  // namespace torch_xla
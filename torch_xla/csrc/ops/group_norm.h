@@ -0,0 +1,41 @@
+#pragma once
+
+#include <vector>
+
+#include "torch_xla/csrc/ir.h"
+
+namespace torch_xla {
+namespace ir {
+namespace ops {
+
+// The layer, group and instance norms, normalizing the input with the
+// statistics of num_groups groups of consecutive elements, and applying the
+// weight and bias along affine_dims. The outputs are the normalized input, and
+// the per group mean and inverse standard deviation.
+class GroupNorm : public Node {
+ public:
+  GroupNorm(const Value& input, const Value& weight, const Value& bias,
+            xla::int64 num_groups, std::vector<xla::int64> affine_dims,
+            double eps);
+
+  std::string ToString() const override;
+
+  NodePtr Clone(OpList operands) const override;
+
+  XlaOpVector Lower(LoweringContext* loctx) const override;
+
+  xla::int64 num_groups() const { return num_groups_; }
+
+  const std::vector<xla::int64>& affine_dims() const { return affine_dims_; }
+
+  double eps() const { return eps_; }
+
+ private:
+  xla::int64 num_groups_;
+  std::vector<xla::int64> affine_dims_;
+  double eps_;
+};
+
+}  // namespace ops
+}  // namespace ir
+}  // namespace torch_xla
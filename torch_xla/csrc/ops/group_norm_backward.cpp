@@ -0,0 +1,54 @@
+#include "torch_xla/csrc/ops/group_norm_backward.h"
+
+#include "absl/strings/str_join.h"
+#include "tensorflow/compiler/xla/shape_util.h"
+#include "tensorflow/compiler/xla/xla_client/util.h"
+#include "torch_xla/csrc/batch_norm.h"
+#include "torch_xla/csrc/lowering_context.h"
+#include "torch_xla/csrc/ops/xla_ops.h"
+
+namespace torch_xla {
+namespace ir {
+namespace ops {
+
+GroupNormBackward::GroupNormBackward(const Value& grad_output,
+                                     const Value& input, const Value& weight,
+                                     const Value& mean, const Value& rstd,
+                                     xla::int64 num_groups,
+                                     std::vector<xla::int64> affine_dims)
+    : Node(xla_group_norm_backward, {grad_output, input, weight, mean, rstd},
+           xla::ShapeUtil::MakeTupleShape(
+               {input.shape(), weight.shape(), weight.shape()}),
+           /*num_outputs=*/3, xla::util::MHash(num_groups, affine_dims)),
+      num_groups_(num_groups),
+      affine_dims_(std::move(affine_dims)) {}
+
+std::string GroupNormBackward::ToString() const {
+  std::stringstream ss;
+  ss << Node::ToString() << ", num_groups=" << num_groups_
+     << ", affine_dims=[" << absl::StrJoin(affine_dims_, ", ") << "]";
+  return ss.str();
+}
+
+NodePtr GroupNormBackward::Clone(OpList operands) const {
+  return MakeNode<GroupNormBackward>(operands.at(0), operands.at(1),
+                                     operands.at(2), operands.at(3),
+                                     operands.at(4), num_groups_,
+                                     affine_dims_);
+}
+
+XlaOpVector GroupNormBackward::Lower(LoweringContext* loctx) const {
+  xla::XlaOp grad_output = loctx->GetOutputOp(operand(0));
+  xla::XlaOp input = loctx->GetOutputOp(operand(1));
+  xla::XlaOp weight = loctx->GetOutputOp(operand(2));
+  xla::XlaOp mean = loctx->GetOutputOp(operand(3));
+  xla::XlaOp rstd = loctx->GetOutputOp(operand(4));
+  BatchNormGrads grads = BuildGroupNormBackward(
+      grad_output, input, weight, mean, rstd, num_groups_, affine_dims_);
+  return ReturnOps({grads.grad_input, grads.grad_weight, grads.grad_bias},
+                   loctx);
+}
+
+}  // namespace ops
+}  // namespace ir
+}  // namespace torch_xla
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <vector>
+
+#include "torch_xla/csrc/ir.h"
+
+namespace torch_xla {
+namespace ir {
+namespace ops {
+
+// The gradients of the GroupNorm node with respect to the input, weight and
+// bias, computed from the saved per group mean and inverse standard deviation.
+class GroupNormBackward : public Node {
+ public:
+  GroupNormBackward(const Value& grad_output, const Value& input,
+                    const Value& weight, const Value& mean, const Value& rstd,
+                    xla::int64 num_groups, std::vector<xla::int64> affine_dims);
+
+  std::string ToString() const override;
+
+  NodePtr Clone(OpList operands) const override;
+
+  XlaOpVector Lower(LoweringContext* loctx) const override;
+
+  xla::int64 num_groups() const { return num_groups_; }
+
+  const std::vector<xla::int64>& affine_dims() const { return affine_dims_; }
+
+ private:
+  xla::int64 num_groups_;
+  std::vector<xla::int64> affine_dims_;
+};
+
+}  // namespace ops
+}  // namespace ir
+}  // namespace torch_xla
@@ -1,5 +1,6 @@
 #include "torch_xla/csrc/ops/index_get.h"
 
+#include "absl/strings/str_join.h"
 #include "tensorflow/compiler/xla/xla_client/debug_macros.h"
 #include "tensorflow/compiler/xla/xla_client/util.h"
 #include "torch_xla/csrc/lowering_context.h"
@@ -12,12 +13,13 @@ namespace ops {
 namespace {
 
 xla::Shape NodeOutputShape(const Value& base, const Value& indices,
+                           tensorflow::gtl::ArraySlice<xla::int64> index_dims,
                            xla::int64 start_dim) {
   auto lower_for_shape_fn =
-      [start_dim](tensorflow::gtl::ArraySlice<const xla::XlaOp> operands)
+      [&](tensorflow::gtl::ArraySlice<const xla::XlaOp> operands)
       -> xla::XlaOp {
     XLA_CHECK_EQ(operands.size(), 2);
-    return CreateIndex(operands[0], operands[1], start_dim);
+    return CreateIndex(operands[0], operands[1], index_dims, start_dim);
   };
   return InferOutputShape({base.shape(), indices.shape()}, lower_for_shape_fn);
 }
@@ -25,26 +27,31 @@ xla::Shape NodeOutputShape(const Value& base, const Value& indices,
 }  // namespace
 
 IndexGet::IndexGet(const ir::Value& base, const ir::Value& indices,
-                   xla::int64 start_dim)
+                   std::vector<xla::int64> index_dims, xla::int64 start_dim)
     : Node(OpKind(at::aten::index), {base, indices},
-           [&]() { return NodeOutputShape(base, indices, start_dim); },
-           /*num_outputs=*/1, xla::util::MHash(start_dim)),
+           [&]() {
+             return NodeOutputShape(base, indices, index_dims, start_dim);
+           },
+           /*num_outputs=*/1, xla::util::MHash(index_dims, start_dim)),
+      index_dims_(std::move(index_dims)),
       start_dim_(start_dim) {}
 
 std::string IndexGet::ToString() const {
   std::stringstream ss;
-  ss << Node::ToString() << ", start_dim=" << start_dim_;
+  ss << Node::ToString() << ", index_dims=[" << absl::StrJoin(index_dims_, ", ")
+     << "], start_dim=" << start_dim_;
   return ss.str();
 }
 
 NodePtr IndexGet::Clone(OpList operands) const {
-  return MakeNode<IndexGet>(operands.at(0), operands.at(1), start_dim_);
+  return MakeNode<IndexGet>(operands.at(0), operands.at(1), index_dims_,
+                            start_dim_);
 }
 
 XlaOpVector IndexGet::Lower(LoweringContext* loctx) const {
   xla::XlaOp base = loctx->GetOutputOp(operand(0));
   xla::XlaOp indices = loctx->GetOutputOp(operand(1));
-  xla::XlaOp output = CreateIndex(base, indices, start_dim_);
+  xla::XlaOp output = CreateIndex(base, indices, index_dims_, start_dim_);
   return ReturnOp(output, loctx);
 }
 
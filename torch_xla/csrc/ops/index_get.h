@@ -9,7 +9,7 @@ namespace ops {
 class IndexGet : public Node {
  public:
   IndexGet(const ir::Value& base, const ir::Value& indices,
-           xla::int64 start_dim);
+           std::vector<xla::int64> index_dims, xla::int64 start_dim);
 
   std::string ToString() const override;
 
@@ -17,10 +17,14 @@ class IndexGet : public Node {
 
   XlaOpVector Lower(LoweringContext* loctx) const override;
 
+  const std::vector<xla::int64>& index_dims() const { return index_dims_; }
+
   xla::int64 start_dim() const { return start_dim_; }
 
  private:
-  // The dimension number at which indexing starts.
+  // The dimensions of the base which are indexed.
+  std::vector<xla::int64> index_dims_;
+  // The dimension of the result at which the indices dimensions are placed.
   xla::int64 start_dim_;
 };
 
@@ -14,7 +14,6 @@
 #include "torch_xla/csrc/ops/index_put.h"
 #include "torch_xla/csrc/ops/infer_output_shape.h"
 #include "torch_xla/csrc/ops/ops.h"
-#include "torch_xla/csrc/ops/permute.h"
 #include "torch_xla/csrc/ops/scalar.h"
 #include "torch_xla/csrc/xla_lower_util.h"
 
@@ -69,8 +68,9 @@ struct IndexAdjacencyInfo {
   xla::int64 start_dim = 0;
 };
 
-// Checks whether all the non-null tensors are adjacent, in which case we must
-// not permute the base and instead treat the null tensors prefix as a no-op.
+// Checks whether all the non-null tensors are adjacent, in which case the
+// dimensions of the indices replace the indexed ones within the result,
+// rather than going first.
 // Replicates the behavior of at::native::hasContiguousSubspace and also returns
 // the position of the first non-null index.
 IndexAdjacencyInfo GetIndexAdjacencyInfo(at::TensorList indices) {
@@ -83,55 +83,18 @@ IndexAdjacencyInfo GetIndexAdjacencyInfo(at::TensorList indices) {
   return {it == stop.base(), start_dim};
 }
 
-// Transposes the tensor and indices together so that all the non-null indices
-// index the first k dimensions of the tensor. Returns the transposed tensor and
-// the reordered indices. For example:
-//  TransposeToFront(tensor, {nullptr, a, nullptr, b})
-// returns
-//  tensor.permute([1, 3, 0, 2]), {a, b}
-//
-// This is a simplified version of at::native::transposeToFront which better
-// fits our requirements.
-CanonicalIndexInfo TransposeToFront(at::Tensor base, at::TensorList indices) {
-  std::vector<int64_t> dims;
-  std::vector<at::Tensor> transposed_indices;
-  size_t base_rank = base.dim();
-  dims.reserve(base_rank);
-  XLA_CHECK_LE(indices.size(), base_rank);
-  for (size_t i = 0; i < indices.size(); i++) {
-    if (indices[i].defined()) {
-      dims.push_back(i);
-      transposed_indices.emplace_back(indices[i]);
-    }
-  }
-  for (size_t i = 0; i < indices.size(); i++) {
-    if (!indices[i].defined()) {
-      dims.push_back(i);
-    }
-  }
-  for (size_t i = indices.size(); i < base_rank; ++i) {
-    dims.push_back(i);
-  }
-  IndexAdjacencyInfo adjacency_info = GetIndexAdjacencyInfo(indices);
-  if (adjacency_info.contiguous_non_null) {
-    return {base, std::move(transposed_indices),
-            xla::util::Iota<xla::int64>(base_rank), adjacency_info.start_dim};
-  }
-  return {base.permute(dims), std::move(transposed_indices),
-          xla::InversePermutation(XlaHelpers::I64List(dims)), 0};
-}
-
 // Wraps index tensors once into the [0, dim_size) interval, where dim_size is
 // the size of the current indexed dimension.
 std::vector<XLATensor> WrapIndicesOnce(
     const XLATensor& base, tensorflow::gtl::ArraySlice<const XLATensor> indices,
-    int start_dim) {
+    tensorflow::gtl::ArraySlice<const xla::int64> index_dims) {
   std::vector<XLATensor> canonical_indices;
   auto base_shape_ref = base.shape();
+  XLA_CHECK_EQ(indices.size(), index_dims.size());
   XLA_CHECK_LE(indices.size(), base_shape_ref.get().rank());
   for (size_t dim_idx = 0; dim_idx < indices.size(); ++dim_idx) {
     const XLATensor& dim_index = indices[dim_idx];
-    int64_t dim_size = base_shape_ref.get().dimensions(dim_idx + start_dim);
+    int64_t dim_size = base_shape_ref.get().dimensions(index_dims[dim_idx]);
     XLATensor wrapped_dim_index = XLATensor::Create(
         dim_index.GetIrValue() +
             XLATensor::GetIrValueForScalar(dim_size, dim_index.shape(),
@@ -194,7 +157,7 @@ ir::NodePtr IndexAddOp(const ir::Value& buffer, xla::int64 dim,
             {buffer.shape(), index_rank1.shape(), source.shape()},
             lower_for_shape_fn);
       },
-      std::move(lower_fn));
+      std::move(lower_fn), /*num_outputs=*/1, xla::util::MHash(dim));
 }
 
 ir::NodePtr IndexCopyOp(const ir::Value& buffer, xla::int64 dim,
@@ -220,7 +183,7 @@ ir::NodePtr IndexCopyOp(const ir::Value& buffer, xla::int64 dim,
             {buffer.shape(), index_rank1.shape(), source.shape()},
             lower_for_shape_fn);
       },
-      std::move(lower_fn));
+      std::move(lower_fn), /*num_outputs=*/1, xla::util::MHash(dim));
 }
 
 }  // namespace
@@ -231,9 +194,20 @@ CanonicalIndexInfo GetCanonicalIndexInfo(const at::Tensor& base,
   // First expand ByteTensor (boolean masks) into 1 or more LongTensors, then
   // broadcast all index tensors together.
   auto indices = at::expand_outplace(ExpandByteTensors(base, orig_indices));
-  // If the non-null indices are not all adjacent, transpose base and indices
-  // together so that they're adjacent at the front.
-  CanonicalIndexInfo canonical_index_info = TransposeToFront(base, indices);
+  XLA_CHECK_LE(indices.size(), base.dim());
+  CanonicalIndexInfo canonical_index_info;
+  for (size_t i = 0; i < indices.size(); ++i) {
+    if (indices[i].defined()) {
+      canonical_index_info.indices.push_back(indices[i]);
+      canonical_index_info.index_dims.push_back(i);
+    }
+  }
+  // If the non-null indices are not all adjacent, the dimensions of the
+  // indices go first within the result.
+  IndexAdjacencyInfo adjacency_info = GetIndexAdjacencyInfo(indices);
+  if (adjacency_info.contiguous_non_null) {
+    canonical_index_info.start_dim = adjacency_info.start_dim;
+  }
   // Ensure indices are on the same device as the base.
   for (size_t i = 0; i < canonical_index_info.indices.size(); i++) {
     if (canonical_index_info.indices[i].device() != base.device()) {
@@ -251,40 +225,41 @@ ir::Value EnsureRank1(const ir::Value& index) {
              : index;
 }
 
-XLATensor IndexByTensors(const XLATensor& base,
-                         tensorflow::gtl::ArraySlice<const XLATensor> indices,
-                         xla::int64 start_dim) {
+XLATensor IndexByTensors(
+    const XLATensor& base, tensorflow::gtl::ArraySlice<const XLATensor> indices,
+    tensorflow::gtl::ArraySlice<const xla::int64> index_dims,
+    xla::int64 start_dim) {
   if (indices.empty()) {
     return base;
   }
-  auto canonical_indices = WrapIndicesOnce(base, indices, start_dim);
+  auto canonical_indices = WrapIndicesOnce(base, indices, index_dims);
   xla::int64 indices_rank = canonical_indices.front().shape().get().rank();
   // Stack the indices to allow the whole multi-indexing to be dispatched with a
   // single gather.
   XLATensor indices_nd = XLATensor::stack(canonical_indices, indices_rank);
   return XLATensor::Create(
-      ir::MakeNode<ir::ops::IndexGet>(base.GetIrValue(),
-                                      indices_nd.GetIrValue(), start_dim),
+      ir::MakeNode<ir::ops::IndexGet>(
+          base.GetIrValue(), indices_nd.GetIrValue(),
+          xla::util::ToVector<xla::int64>(index_dims), start_dim),
       base.GetDevice(), base.dtype());
 }
 
 ir::Value IndexPutByTensors(
     const XLATensor& base, tensorflow::gtl::ArraySlice<const XLATensor> indices,
-    xla::int64 start_dim, const XLATensor& values, bool accumulate,
-    tensorflow::gtl::ArraySlice<const xla::int64> result_permutation) {
+    tensorflow::gtl::ArraySlice<const xla::int64> index_dims,
+    xla::int64 start_dim, const XLATensor& values, bool accumulate) {
   if (indices.empty()) {
     return base.GetIrValue();
   }
-  auto canonical_indices = WrapIndicesOnce(base, indices, start_dim);
+  auto canonical_indices = WrapIndicesOnce(base, indices, index_dims);
   xla::int64 indices_rank = canonical_indices.front().shape().get().rank();
   // Stack the indices to allow the whole multi-indexing to be dispatched with a
   // single scatter.
   XLATensor indices_nd = XLATensor::stack(canonical_indices, indices_rank);
-  return ir::MakeNode<ir::ops::Permute>(
-      ir::MakeNode<ir::ops::IndexPut>(base.GetIrValue(),
-                                      indices_nd.GetIrValue(), start_dim,
-                                      values.GetIrValue(), accumulate),
-      xla::util::ToVector<xla::int64>(result_permutation));
+  return ir::MakeNode<ir::ops::IndexPut>(
+      base.GetIrValue(), indices_nd.GetIrValue(),
+      xla::util::ToVector<xla::int64>(index_dims), start_dim,
+      values.GetIrValue(), accumulate);
 }
 
 ir::NodePtr IndexFill(const XLATensor& base, xla::int64 dim,
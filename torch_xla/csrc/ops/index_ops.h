@@ -18,8 +18,10 @@
 // mask.
 //
 // Note 2: The behavior is more complicated when the index tensors are not all
-// adjacent (e.g. x[[0, 1], :, [2, 3]]). In this case, self and the index
-// tensors are transposed to the front: x.transpose(1, 2)[[0, 1], [2, 3]]
+// adjacent (e.g. x[[0, 1], :, [2, 3]]). In this case, the dimensions of the
+// indices go first within the result, as with x.transpose(1, 2)[[0, 1], [2, 3]]
+// (the gather and scatter dimension numbers take care of it, without actually
+// transposing x).
 
 #pragma once
 
@@ -31,20 +33,18 @@
 namespace torch_xla {
 
 struct CanonicalIndexInfo {
-  at::Tensor base;
+  // The non-null indices.
   std::vector<at::Tensor> indices;
-  // The permutation to be applied to the result. This is needed for indexed
-  // updates, since a permutation is applied to the base to bring non-null
-  // indices to front. This is the inverse of that permutation.
-  std::vector<xla::int64> result_permutation;
-  // The dimension number at which indexing starts.
+  // The dimensions of the base the indices index.
+  std::vector<xla::int64> index_dims;
+  // The dimension of the result at which the dimensions of the indices are
+  // placed.
   xla::int64 start_dim = 0;
 };
 
 // Transform the given base and indices to a form supported by the XLATensor
-// index implementation. Input indices are reordered so that non-null indices
-// are first and the tail of null indices is dropped. The dimensions of the base
-// are reordered to be consistent with this reordering.
+// index implementation. The null indices are dropped, and the dimensions the
+// remaining ones index are recorded.
 CanonicalIndexInfo GetCanonicalIndexInfo(const at::Tensor& base,
                                          at::TensorList orig_indices);
 
@@ -53,14 +53,15 @@ ir::Value EnsureRank1(const ir::Value& index);
 
 // Implements indexing by tensors of long according to the top-level
 // description.
-XLATensor IndexByTensors(const XLATensor& base,
-                         tensorflow::gtl::ArraySlice<const XLATensor> indices,
-                         xla::int64 start_dim);
+XLATensor IndexByTensors(
+    const XLATensor& base, tensorflow::gtl::ArraySlice<const XLATensor> indices,
+    tensorflow::gtl::ArraySlice<const xla::int64> index_dims,
+    xla::int64 start_dim);
 
 ir::Value IndexPutByTensors(
     const XLATensor& base, tensorflow::gtl::ArraySlice<const XLATensor> indices,
-    xla::int64 start_dim, const XLATensor& updates, bool accumulate,
-    tensorflow::gtl::ArraySlice<const xla::int64> result_permutation);
+    tensorflow::gtl::ArraySlice<const xla::int64> index_dims,
+    xla::int64 start_dim, const XLATensor& updates, bool accumulate);
 
 ir::NodePtr IndexFill(const XLATensor& base, xla::int64 dim,
                       const XLATensor& index, at::Scalar value);
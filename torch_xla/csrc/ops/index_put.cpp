@@ -1,5 +1,6 @@
 #include "torch_xla/csrc/ops/index_put.h"
 
+#include "absl/strings/str_join.h"
 #include "tensorflow/compiler/xla/xla_client/util.h"
 #include "torch_xla/csrc/lowering_context.h"
 #include "torch_xla/csrc/xla_lower_util.h"
@@ -9,23 +10,25 @@ namespace ir {
 namespace ops {
 
 IndexPut::IndexPut(const ir::Value& base, const ir::Value& indices,
-                   xla::int64 start_dim, const ir::Value& values,
-                   bool accumulate)
+                   std::vector<xla::int64> index_dims, xla::int64 start_dim,
+                   const ir::Value& values, bool accumulate)
     : Node(OpKind(at::aten::index_put), {base, indices, values}, base.shape(),
-           /*num_outputs=*/1, xla::util::MHash(start_dim, accumulate)),
+           /*num_outputs=*/1,
+           xla::util::MHash(index_dims, start_dim, accumulate)),
+      index_dims_(std::move(index_dims)),
       start_dim_(start_dim),
       accumulate_(accumulate) {}
 
 std::string IndexPut::ToString() const {
   std::stringstream ss;
-  ss << Node::ToString() << ", start_dim=" << start_dim_
-     << ", accumulate=" << accumulate_;
+  ss << Node::ToString() << ", index_dims=[" << absl::StrJoin(index_dims_, ", ")
+     << "], start_dim=" << start_dim_ << ", accumulate=" << accumulate_;
   return ss.str();
 }
 
 NodePtr IndexPut::Clone(OpList operands) const {
-  return MakeNode<IndexPut>(operands.at(0), operands.at(1), start_dim_,
-                            operands.at(2), accumulate_);
+  return MakeNode<IndexPut>(operands.at(0), operands.at(1), index_dims_,
+                            start_dim_, operands.at(2), accumulate_);
 }
 
 XlaOpVector IndexPut::Lower(LoweringContext* loctx) const {
@@ -38,7 +41,7 @@ XlaOpVector IndexPut::Lower(LoweringContext* loctx) const {
   xla::XlaOp indices = loctx->GetOutputOp(operand(1));
   xla::XlaOp values = loctx->GetOutputOp(operand(2));
   xla::XlaOp output =
-      CreateIndexUpdate(base, indices, start_dim_, values,
+      CreateIndexUpdate(base, indices, index_dims_, start_dim_, values,
                         accumulate_ ? add_scatter_combiner : nullptr);
   return ReturnOp(output, loctx);
 }
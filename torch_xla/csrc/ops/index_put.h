@@ -9,7 +9,8 @@ namespace ops {
 class IndexPut : public Node {
  public:
   IndexPut(const ir::Value& base, const ir::Value& indices,
-           xla::int64 start_dim, const ir::Value& values, bool accumulate);
+           std::vector<xla::int64> index_dims, xla::int64 start_dim,
+           const ir::Value& values, bool accumulate);
 
   std::string ToString() const override;
 
@@ -17,12 +18,16 @@ class IndexPut : public Node {
 
   XlaOpVector Lower(LoweringContext* loctx) const override;
 
+  const std::vector<xla::int64>& index_dims() const { return index_dims_; }
+
   xla::int64 start_dim() const { return start_dim_; }
 
   bool accumulate() const { return accumulate_; }
 
  private:
-  // The dimension number at which indexing starts.
+  // The dimensions of the base which are indexed.
+  std::vector<xla::int64> index_dims_;
+  // The dimension of the values at which the indices dimensions are placed.
   xla::int64 start_dim_;
   // Whether to accumulate instead of set.
   bool accumulate_;
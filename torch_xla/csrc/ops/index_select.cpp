@@ -36,7 +36,9 @@ NodePtr IndexSelect::Clone(OpList operands) const {
 XlaOpVector IndexSelect::Lower(LoweringContext* loctx) const {
   xla::XlaOp input = loctx->GetOutputOp(operand(0));
   xla::XlaOp index = loctx->GetOutputOp(operand(1));
-  return ReturnOp(xla::TorchIndexSelect(input, index, dim_), loctx);
+  xla::XlaOp narrowed_index = XlaHelpers::NarrowIndices(
+      index, XlaHelpers::ShapeOfXlaOp(input).dimensions(dim_));
+  return ReturnOp(xla::TorchIndexSelect(input, narrowed_index, dim_), loctx);
 }
 
 std::string IndexSelect::ToString() const {
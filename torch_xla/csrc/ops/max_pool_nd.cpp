@@ -1,17 +1,20 @@
 #include "torch_xla/csrc/ops/max_pool_nd.h"
 
+#include "tensorflow/compiler/xla/shape_util.h"
 #include "tensorflow/compiler/xla/xla_client/debug_macros.h"
 #include "tensorflow/compiler/xla/xla_client/util.h"
 #include "torch_xla/csrc/lowering_context.h"
 #include "torch_xla/csrc/ops/infer_output_shape.h"
 #include "torch_xla/csrc/pooling.h"
+#include "torch_xla/csrc/tensor_util.h"
 
 namespace torch_xla {
 namespace ir {
 namespace ops {
 namespace {
 
-// Infers the output shape of the max pooling operation.
+// Infers the output shape of the max pooling operation, a tuple of the result
+// and the indices of the maximums.
 xla::Shape NodeOutputShape(
     const Value& input, xla::int64 spatial_dim_count,
     tensorflow::gtl::ArraySlice<const xla::int64> kernel_size,
@@ -25,7 +28,12 @@ xla::Shape NodeOutputShape(
     return BuildMaxPoolNd(operands[0], spatial_dim_count, kernel_size, stride,
                           padding, ceil_mode);
   };
-  return InferOutputShape({input.shape()}, lower_for_shape_fn);
+  xla::Shape result_shape =
+      InferOutputShape({input.shape()}, lower_for_shape_fn);
+  xla::Shape indices_shape = result_shape;
+  indices_shape.set_element_type(
+      GetDevicePrimitiveType(xla::PrimitiveType::S64, /*device=*/nullptr));
+  return xla::ShapeUtil::MakeTupleShape({result_shape, indices_shape});
 }
 
 c10::Symbol MaxPoolNdSymbol(xla::int64 spatial_dim_count) {
@@ -53,7 +61,7 @@ MaxPoolNd::MaxPoolNd(const Value& input, xla::int64 spatial_dim_count,
              return NodeOutputShape(input, spatial_dim_count, kernel_size,
                                     stride, padding, ceil_mode);
            },
-           /*num_outputs=*/1,
+           /*num_outputs=*/2,
            xla::util::MHash(spatial_dim_count, kernel_size, stride, padding,
                             ceil_mode)),
       spatial_dim_count_(spatial_dim_count),
@@ -69,9 +77,11 @@ NodePtr MaxPoolNd::Clone(OpList operands) const {
 
 XlaOpVector MaxPoolNd::Lower(LoweringContext* loctx) const {
   xla::XlaOp input = loctx->GetOutputOp(operand(0));
-  xla::XlaOp output = BuildMaxPoolNd(input, spatial_dim_count_, kernel_size_,
-                                     stride_, padding_, ceil_mode_);
-  return ReturnOp(output, loctx);
+  // The indices are only used by the backward when it scatters the gradients,
+  // otherwise they are dropped from the computation.
+  MaxPoolResult result = BuildMaxPoolNdWithIndices(
+      input, spatial_dim_count_, kernel_size_, stride_, padding_, ceil_mode_);
+  return ReturnOps({result.result, result.indices}, loctx);
 }
 
 std::string MaxPoolNd::ToString() const {
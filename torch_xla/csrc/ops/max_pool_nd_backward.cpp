@@ -1,9 +1,9 @@
 #include "torch_xla/csrc/ops/max_pool_nd_backward.h"
 
+#include "tensorflow/compiler/xla/shape_util.h"
 #include "tensorflow/compiler/xla/xla_client/debug_macros.h"
 #include "tensorflow/compiler/xla/xla_client/util.h"
 #include "torch_xla/csrc/lowering_context.h"
-#include "torch_xla/csrc/ops/infer_output_shape.h"
 #include "torch_xla/csrc/pooling.h"
 
 namespace torch_xla {
@@ -11,21 +11,12 @@ namespace ir {
 namespace ops {
 namespace {
 
-xla::Shape NodeOutputShape(
-    const Value& grad_output, const Value& input, xla::int64 spatial_dim_count,
-    tensorflow::gtl::ArraySlice<const xla::int64> kernel_size,
-    tensorflow::gtl::ArraySlice<const xla::int64> stride,
-    tensorflow::gtl::ArraySlice<const xla::int64> padding, bool ceil_mode) {
-  auto lower_for_shape_fn =
-      [&](tensorflow::gtl::ArraySlice<const xla::XlaOp> operands)
-      -> xla::XlaOp {
-    XLA_CHECK_EQ(operands.size(), 2);
-    return BuildMaxPoolNdBackward(/*out_backprop=*/operands[0],
-                                  /*input=*/operands[1], spatial_dim_count,
-                                  kernel_size, stride, padding, ceil_mode);
-  };
-  return InferOutputShape({grad_output.shape(), input.shape()},
-                          lower_for_shape_fn);
+xla::Shape NodeOutputShape(const Value& grad_output, const Value& input) {
+  // The gradients are scattered over a tensor shaped like the input.
+  const xla::Shape& input_shape = input.shape();
+  XLA_CHECK_EQ(grad_output.shape().rank(), input_shape.rank());
+  return xla::ShapeUtil::MakeShape(input_shape.element_type(),
+                                   input_shape.dimensions());
 }
 
 c10::Symbol MaxPoolNdBackwardSymbol(xla::int64 spatial_dim_count) {
@@ -46,12 +37,27 @@ MaxPoolNdBackward::MaxPoolNdBackward(
     const Value& grad_output, const Value& input, xla::int64 spatial_dim_count,
     std::vector<xla::int64> kernel_size, std::vector<xla::int64> stride,
     std::vector<xla::int64> padding, bool ceil_mode)
-    : Node(ir::OpKind(MaxPoolNdBackwardSymbol(spatial_dim_count)),
-           {grad_output, input},
-           [&]() {
-             return NodeOutputShape(grad_output, input, spatial_dim_count,
-                                    kernel_size, stride, padding, ceil_mode);
-           },
+    : MaxPoolNdBackward({grad_output, input}, spatial_dim_count,
+                        std::move(kernel_size), std::move(stride),
+                        std::move(padding), ceil_mode) {}
+
+MaxPoolNdBackward::MaxPoolNdBackward(
+    const Value& grad_output, const Value& input, const Value& indices,
+    xla::int64 spatial_dim_count, std::vector<xla::int64> kernel_size,
+    std::vector<xla::int64> stride, std::vector<xla::int64> padding,
+    bool ceil_mode)
+    : MaxPoolNdBackward({grad_output, input, indices}, spatial_dim_count,
+                        std::move(kernel_size), std::move(stride),
+                        std::move(padding), ceil_mode) {}
+
+MaxPoolNdBackward::MaxPoolNdBackward(OpList operands,
+                                     xla::int64 spatial_dim_count,
+                                     std::vector<xla::int64> kernel_size,
+                                     std::vector<xla::int64> stride,
+                                     std::vector<xla::int64> padding,
+                                     bool ceil_mode)
+    : Node(ir::OpKind(MaxPoolNdBackwardSymbol(spatial_dim_count)), operands,
+           [&]() { return NodeOutputShape(operands[0], operands[1]); },
            /*num_outputs=*/1,
            xla::util::MHash(spatial_dim_count, kernel_size, stride, padding,
                             ceil_mode)),
@@ -62,6 +68,11 @@ MaxPoolNdBackward::MaxPoolNdBackward(
       ceil_mode_(ceil_mode) {}
 
 NodePtr MaxPoolNdBackward::Clone(OpList operands) const {
+  if (operands.size() > 2) {
+    return MakeNode<MaxPoolNdBackward>(
+        operands.at(0), operands.at(1), operands.at(2), spatial_dim_count_,
+        kernel_size_, stride_, padding_, ceil_mode_);
+  }
   return MakeNode<MaxPoolNdBackward>(operands.at(0), operands.at(1),
                                      spatial_dim_count_, kernel_size_, stride_,
                                      padding_, ceil_mode_);
@@ -70,9 +81,16 @@ NodePtr MaxPoolNdBackward::Clone(OpList operands) const {
 XlaOpVector MaxPoolNdBackward::Lower(LoweringContext* loctx) const {
   xla::XlaOp grad_output = loctx->GetOutputOp(operand(0));
   xla::XlaOp input = loctx->GetOutputOp(operand(1));
-  xla::XlaOp output = BuildMaxPoolNdBackward(
-      /*out_backprop=*/grad_output, /*input=*/input, spatial_dim_count_,
-      kernel_size_, stride_, padding_, ceil_mode_);
+  xla::XlaOp output;
+  if (operands().size() > 2) {
+    output = BuildMaxPoolNdBackwardWithIndices(
+        /*out_backprop=*/grad_output, /*input=*/input,
+        /*indices=*/loctx->GetOutputOp(operand(2)), spatial_dim_count_);
+  } else {
+    output = BuildMaxPoolNdBackward(
+        /*out_backprop=*/grad_output, /*input=*/input, spatial_dim_count_,
+        kernel_size_, stride_, padding_, ceil_mode_);
+  }
   return ReturnOp(output, loctx);
 }
 
@@ -14,6 +14,14 @@ class MaxPoolNdBackward : public Node {
                     std::vector<xla::int64> stride,
                     std::vector<xla::int64> padding, bool ceil_mode);
 
+  // Scatters the gradients at the indices of the maximums computed by the
+  // forward, instead of searching the pooling windows again.
+  MaxPoolNdBackward(const Value& grad_output, const Value& input,
+                    const Value& indices, xla::int64 spatial_dim_count,
+                    std::vector<xla::int64> kernel_size,
+                    std::vector<xla::int64> stride,
+                    std::vector<xla::int64> padding, bool ceil_mode);
+
   NodePtr Clone(OpList operands) const override;
 
   XlaOpVector Lower(LoweringContext* loctx) const override;
@@ -31,6 +39,11 @@ class MaxPoolNdBackward : public Node {
   bool ceil_mode() const { return ceil_mode_; }
 
  private:
+  MaxPoolNdBackward(OpList operands, xla::int64 spatial_dim_count,
+                    std::vector<xla::int64> kernel_size,
+                    std::vector<xla::int64> stride,
+                    std::vector<xla::int64> padding, bool ceil_mode);
+
   xla::int64 spatial_dim_count_;
   std::vector<xla::int64> kernel_size_;
   std::vector<xla::int64> stride_;
@@ -4,7 +4,6 @@
 #include "tensorflow/compiler/xla/xla_client/util.h"
 #include "torch_xla/csrc/helpers.h"
 #include "torch_xla/csrc/lowering_context.h"
-#include "torch_xla/csrc/ops/infer_output_shape.h"
 #include "torch_xla/csrc/reduction.h"
 #include "torch_xla/csrc/tensor_util.h"
 #include "torch_xla/csrc/torch_util.h"
@@ -28,12 +27,12 @@ xla::Shape NodeOutputShape(const Value& input,
                            std::vector<xla::int64>& dimensions,
                            bool keep_reduced_dimensions,
                            const c10::optional<at::ScalarType>& dtype) {
-  auto lower_for_shape_fn =
-      [&](tensorflow::gtl::ArraySlice<const xla::XlaOp> operands)
-      -> xla::XlaOp {
-    return LowerMean(operands[0], dimensions, keep_reduced_dimensions, dtype);
-  };
-  return InferOutputShape({input.shape()}, lower_for_shape_fn);
+  xla::Shape shape =
+      GetReductionShape(input.shape(), dimensions, keep_reduced_dimensions);
+  if (dtype) {
+    shape.set_element_type(MakeXlaPrimitiveType(*dtype, /*device=*/nullptr));
+  }
+  return shape;
 }
 
 }  // namespace
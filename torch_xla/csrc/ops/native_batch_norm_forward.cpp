@@ -24,8 +24,7 @@ std::vector<xla::XlaOp> LowerBatchNorm(const xla::XlaOp& input,
     values.push_back(std::move(batch_norm_output.output));
     values.push_back(std::move(batch_norm_output.batch_mean));
     values.push_back(std::move(batch_norm_output.batch_variance));
-    values.push_back(
-        BatchNormVarianceInvert(batch_norm_output.batch_variance, eps));
+    values.push_back(std::move(batch_norm_output.batch_invstd));
   } else {
     values.push_back(BuildBatchNormInference(input, weight, bias, running_mean,
                                              running_var, eps));
@@ -1,15 +1,20 @@
 #include "torch_xla/csrc/ops/ops.h"
 
 #include <cmath>
+#include <functional>
 
 #include "tensorflow/compiler/xla/client/lib/math.h"
 #include "tensorflow/compiler/xla/client/lib/matrix.h"
 #include "tensorflow/compiler/xla/shape_util.h"
 #include "tensorflow/compiler/xla/xla_client/debug_macros.h"
+#include "tensorflow/compiler/xla/xla_client/metrics.h"
 #include "tensorflow/compiler/xla/xla_client/util.h"
+#include "torch_xla/csrc/bounded_ops.h"
 #include "torch_xla/csrc/convert_ops.h"
+#include "torch_xla/csrc/cross_replica_reduces.h"
 #include "torch_xla/csrc/data_ops.h"
 #include "torch_xla/csrc/elementwise.h"
+#include "torch_xla/csrc/embedding_bag.h"
 #include "torch_xla/csrc/helpers.h"
 #include "torch_xla/csrc/lowering_context.h"
 #include "torch_xla/csrc/nll_loss.h"
@@ -21,7 +26,12 @@
 #include "torch_xla/csrc/ops/permute.h"
 #include "torch_xla/csrc/ops/softmax_backward.h"
 #include "torch_xla/csrc/ops/sum.h"
+#include "torch_xla/csrc/ops/xla_ops.h"
 #include "torch_xla/csrc/pooling.h"
+#include "torch_xla/csrc/quantization.h"
+#include "torch_xla/csrc/random.h"
+#include "torch_xla/csrc/rnn.h"
+#include "torch_xla/csrc/softmax_builder.h"
 #include "torch_xla/csrc/tensor_util.h"
 #include "torch_xla/csrc/xla_lower_util.h"
 
@@ -40,27 +50,19 @@ namespace ops {
                      std::move(lower_fn));                        \
   }
 
-#define PTXLA_BINARY_OP(name, sym, xla_fn)                                     \
-  NodePtr name(const Value& input0, const Value& input1) {                     \
-    auto shape_fn =                                                            \
-        [&](tensorflow::gtl::ArraySlice<const xla::XlaOp> operands)            \
-        -> xla::XlaOp {                                                        \
-      auto promoted = XlaHelpers::Promote(operands[0], operands[1]);           \
-      return xla_fn(promoted.first, promoted.second);                          \
-    };                                                                         \
-    auto lower_fn = [](const Node& node,                                       \
-                       LoweringContext* loctx) -> XlaOpVector {                \
-      xla::XlaOp xla_input0 = loctx->GetOutputOp(node.operand(0));             \
-      xla::XlaOp xla_input1 = loctx->GetOutputOp(node.operand(1));             \
-      auto promoted = XlaHelpers::Promote(xla_input0, xla_input1);             \
-      return node.ReturnOp(xla_fn(promoted.first, promoted.second), loctx);    \
-    };                                                                         \
-    return GenericOp(                                                          \
-        OpKind(sym), OpList{input0, input1},                                   \
-        [&]() {                                                                \
-          return InferOutputShape({input0.shape(), input1.shape()}, shape_fn); \
-        },                                                                     \
-        std::move(lower_fn));                                                  \
+#define PTXLA_BINARY_OP(name, sym, xla_fn)                                 \
+  NodePtr name(const Value& input0, const Value& input1) {                 \
+    auto lower_fn = [](const Node& node,                                   \
+                       LoweringContext* loctx) -> XlaOpVector {            \
+      xla::XlaOp xla_input0 = loctx->GetOutputOp(node.operand(0));         \
+      xla::XlaOp xla_input1 = loctx->GetOutputOp(node.operand(1));         \
+      auto promoted = XlaHelpers::Promote(xla_input0, xla_input1);         \
+      return node.ReturnOp(xla_fn(promoted.first, promoted.second), loctx); \
+    };                                                                     \
+    return GenericOp(OpKind(sym), OpList{input0, input1},                  \
+                     XlaHelpers::GetPromotedBinaryOpShape(input0.shape(),  \
+                                                          input1.shape()), \
+                     std::move(lower_fn));                                 \
   }
 
 PTXLA_UNARY_OP(Acos, at::aten::acos, xla::Acos);
@@ -141,14 +143,7 @@ NodePtr ReluOp(const Value& input) {
     xla::XlaOp xla_output = BuildRelu(xla_input);
     return node.ReturnOp(xla_output, loctx);
   };
-  auto lower_for_shape_fn =
-      [](tensorflow::gtl::ArraySlice<const xla::XlaOp> operands) -> xla::XlaOp {
-    XLA_CHECK_EQ(operands.size(), 1) << "Unexpected number of operands";
-    return BuildRelu(operands[0]);
-  };
-  xla::Shape output_shape =
-      InferOutputShape({input.shape()}, lower_for_shape_fn);
-  return GenericOp(OpKind(at::aten::relu), OpList{input}, output_shape,
+  return GenericOp(OpKind(at::aten::relu), OpList{input}, input.shape(),
                    std::move(lower_fn));
 }
 
@@ -205,6 +200,379 @@ NodePtr SoftmaxBackwardOp(const Value& grad_output, const Value& output,
       XlaHelpers::GetCanonicalDimensionIndex(dim, grad_output.shape().rank()));
 }
 
+NodePtr LogSumExp(const Value& input, xla::int64 dim) {
+  auto lower_fn = [dim](const Node& node,
+                        LoweringContext* loctx) -> XlaOpVector {
+    xla::XlaOp xla_input = loctx->GetOutputOp(node.operand(0));
+    return node.ReturnOp(BuildLogSumExp(xla_input, dim), loctx);
+  };
+  auto lower_for_shape_fn =
+      [dim](tensorflow::gtl::ArraySlice<const xla::XlaOp> operands)
+      -> xla::XlaOp { return BuildLogSumExp(operands[0], dim); };
+  xla::Shape output_shape =
+      InferOutputShape({input.shape()}, lower_for_shape_fn);
+  return GenericOp(OpKind(at::aten::logsumexp), OpList{input}, output_shape,
+                   std::move(lower_fn), /*num_outputs=*/1,
+                   xla::util::MHash(dim));
+}
+
+NodePtr LogSoftmaxBackwardFromLogits(const Value& grad_output,
+                                     const Value& logits,
+                                     const Value& log_sum_exp, xla::int64 dim) {
+  auto lower_fn = [dim](const Node& node,
+                        LoweringContext* loctx) -> XlaOpVector {
+    xla::XlaOp xla_grad_output = loctx->GetOutputOp(node.operand(0));
+    xla::XlaOp xla_logits = loctx->GetOutputOp(node.operand(1));
+    xla::XlaOp xla_log_sum_exp = loctx->GetOutputOp(node.operand(2));
+    return node.ReturnOp(
+        BuildLogSoftmaxGradFromLogits(xla_grad_output, xla_logits,
+                                      xla_log_sum_exp, dim),
+        loctx);
+  };
+  return GenericOp(OpKind(at::aten::_log_softmax_backward_data),
+                   OpList{grad_output, logits, log_sum_exp},
+                   grad_output.shape(), std::move(lower_fn),
+                   /*num_outputs=*/1, xla::util::MHash(dim));
+}
+
+NodePtr SegmentSum(const Value& indices, const Value& values, xla::int64 dim,
+                   xla::int64 num_segments) {
+  auto lower_fn = [dim, num_segments](const Node& node,
+                                      LoweringContext* loctx) -> XlaOpVector {
+    xla::XlaOp xla_indices = loctx->GetOutputOp(node.operand(0));
+    xla::XlaOp xla_values = loctx->GetOutputOp(node.operand(1));
+    return node.ReturnOps(
+        BuildSegmentSum(xla_indices, xla_values, dim, num_segments), loctx);
+  };
+  return GenericOp(
+      xla_segment_sum, OpList{indices, values},
+      xla::ShapeUtil::MakeTupleShape({indices.shape(), values.shape()}),
+      std::move(lower_fn), /*num_outputs=*/2,
+      xla::util::MHash(dim, num_segments));
+}
+
+NodePtr ConvertTo(const Value& input, xla::PrimitiveType element_type) {
+  auto lower_fn = [element_type](const Node& node,
+                                 LoweringContext* loctx) -> XlaOpVector {
+    xla::XlaOp xla_input = loctx->GetOutputOp(node.operand(0));
+    return node.ReturnOp(xla::ConvertElementType(xla_input, element_type),
+                         loctx);
+  };
+  xla::Shape output_shape = input.shape();
+  output_shape.set_element_type(element_type);
+  return GenericOp(xla_convert, OpList{input}, output_shape,
+                   std::move(lower_fn), /*num_outputs=*/1,
+                   xla::util::MHash(static_cast<int>(element_type)));
+}
+
+NodePtr DynamicQuantize(const Value& input, xla::PrimitiveType element_type) {
+  auto lower_fn = [element_type](const Node& node,
+                                 LoweringContext* loctx) -> XlaOpVector {
+    xla::XlaOp xla_input = loctx->GetOutputOp(node.operand(0));
+    return node.ReturnOps(BuildDynamicQuantize(xla_input, element_type),
+                          loctx);
+  };
+  xla::Shape values_shape = input.shape();
+  values_shape.set_element_type(element_type);
+  return GenericOp(
+      xla_dynamic_quantize, OpList{input},
+      xla::ShapeUtil::MakeTupleShape(
+          {values_shape,
+           xla::ShapeUtil::MakeShape(xla::PrimitiveType::F32, {})}),
+      std::move(lower_fn), /*num_outputs=*/2,
+      xla::util::MHash(static_cast<int>(element_type)));
+}
+
+NodePtr Histogram(const Value& input, xla::int64 bins) {
+  auto lower_fn = [bins](const Node& node,
+                         LoweringContext* loctx) -> XlaOpVector {
+    xla::XlaOp xla_input = loctx->GetOutputOp(node.operand(0));
+    return node.ReturnOps(BuildHistogram(xla_input, bins), loctx);
+  };
+  return GenericOp(
+      xla_histogram, OpList{input},
+      xla::ShapeUtil::MakeTupleShape(
+          {xla::ShapeUtil::MakeShape(xla::PrimitiveType::F32, {bins}),
+           xla::ShapeUtil::MakeShape(xla::PrimitiveType::F32, {2})}),
+      std::move(lower_fn), /*num_outputs=*/2, xla::util::MHash(bins));
+}
+
+NodePtr UnpackBits(const Value& input, const xla::Shape& shape) {
+  auto lower_fn = [shape](const Node& node,
+                          LoweringContext* loctx) -> XlaOpVector {
+    xla::XlaOp xla_input = loctx->GetOutputOp(node.operand(0));
+    return node.ReturnOp(BuildUnpackBits(xla_input, shape.dimensions()),
+                         loctx);
+  };
+  return GenericOp(
+      xla_unpack_bits, OpList{input}, shape, std::move(lower_fn),
+      /*num_outputs=*/1,
+      xla::util::MHash(xla::util::ToVector<xla::int64>(shape.dimensions())));
+}
+
+NodePtr RematAnchor(tensorflow::gtl::ArraySlice<const Value> inputs,
+                    const Value& anchor) {
+  auto lower_fn = [](const Node& node, LoweringContext* loctx) -> XlaOpVector {
+    std::vector<xla::XlaOp> xla_inputs;
+    for (size_t i = 0; i + 1 < node.operands().size(); ++i) {
+      xla_inputs.push_back(loctx->GetOutputOp(node.operand(i)));
+    }
+    xla::XlaOp xla_anchor = loctx->GetOutputOp(node.operands().back());
+    return node.ReturnOps(BuildRematAnchor(xla_inputs, xla_anchor), loctx);
+  };
+  std::vector<Value> operands(inputs.begin(), inputs.end());
+  std::vector<xla::Shape> shapes;
+  for (const Value& input : inputs) {
+    shapes.push_back(input.shape());
+  }
+  operands.push_back(anchor);
+  return GenericOp(xla_remat_anchor, operands,
+                   xla::ShapeUtil::MakeTupleShape(shapes), std::move(lower_fn),
+                   /*num_outputs=*/inputs.size());
+}
+
+NodePtr ShardingAnnotation(const Value& input,
+                           const xla::OpSharding& sharding) {
+  auto lower_fn = [sharding](const Node& node,
+                             LoweringContext* loctx) -> XlaOpVector {
+    xla::XlaOp xla_input = loctx->GetOutputOp(node.operand(0));
+    return node.ReturnOp(BuildShardingAnnotation(xla_input, sharding), loctx);
+  };
+  return GenericOp(xla_sharding, OpList{input}, input.shape(),
+                   std::move(lower_fn), /*num_outputs=*/1,
+                   xla::util::MHash(sharding.SerializeAsString()));
+}
+
+namespace {
+
+using MultiOutputBuilder = std::function<std::vector<xla::XlaOp>(
+    tensorflow::gtl::ArraySlice<const xla::XlaOp>)>;
+
+// Returns a node lowered by builder, which receives the lowered operands and
+// returns the num_outputs outputs.
+NodePtr MultiOutputOp(OpKind op, OpList operands, MultiOutputBuilder builder,
+                      size_t num_outputs) {
+  auto lower_fn = [builder](const Node& node,
+                            LoweringContext* loctx) -> XlaOpVector {
+    std::vector<xla::XlaOp> xla_operands;
+    for (auto& operand : node.operands()) {
+      xla_operands.push_back(loctx->GetOutputOp(operand));
+    }
+    return node.ReturnOps(builder(xla_operands), loctx);
+  };
+  auto lower_for_shape_fn =
+      [builder](tensorflow::gtl::ArraySlice<const xla::XlaOp> operands)
+      -> xla::XlaOp {
+    return xla::Tuple(operands[0].builder(), builder(operands));
+  };
+  std::vector<xla::Shape> shapes;
+  for (auto& operand : operands) {
+    shapes.push_back(operand.shape());
+  }
+  return GenericOp(std::move(op), operands,
+                   InferOutputShape(shapes, lower_for_shape_fn),
+                   std::move(lower_fn), num_outputs);
+}
+
+}  // namespace
+
+NodePtr NonZeroBounded(const Value& input) {
+  return MultiOutputOp(
+      xla_nonzero_bounded, {input},
+      [](tensorflow::gtl::ArraySlice<const xla::XlaOp> operands) {
+        return BuildNonZeroBounded(operands[0]);
+      },
+      /*num_outputs=*/2);
+}
+
+NodePtr MaskedSelectBounded(const Value& input, const Value& mask) {
+  return MultiOutputOp(
+      xla_masked_select_bounded, {input, mask},
+      [](tensorflow::gtl::ArraySlice<const xla::XlaOp> operands) {
+        return BuildMaskedSelectBounded(operands[0], operands[1]);
+      },
+      /*num_outputs=*/2);
+}
+
+NodePtr UniqueBounded(const Value& input) {
+  return MultiOutputOp(
+      xla_unique_bounded, {input},
+      [](tensorflow::gtl::ArraySlice<const xla::XlaOp> operands) {
+        return BuildUniqueBounded(operands[0]);
+      },
+      /*num_outputs=*/2);
+}
+
+NodePtr LstmCell(const Value& input, const Value& hx, const Value& cx,
+                 const Value& w_ih, const Value& w_hh, const Value& b_ih,
+                 const Value& b_hh) {
+  return MultiOutputOp(
+      xla_lstm_cell, {input, hx, cx, w_ih, w_hh, b_ih, b_hh},
+      [](tensorflow::gtl::ArraySlice<const xla::XlaOp> operands) {
+        LstmCellResult result =
+            BuildLstmCell(operands[0], operands[1], operands[2], operands[3],
+                          operands[4], operands[5], operands[6]);
+        return std::vector<xla::XlaOp>({result.h, result.c, result.gates});
+      },
+      /*num_outputs=*/3);
+}
+
+NodePtr LstmCellBackward(const Value& grad_h, const Value& grad_c,
+                         const Value& input, const Value& hx, const Value& cx,
+                         const Value& w_ih, const Value& w_hh, const Value& c,
+                         const Value& gates) {
+  return MultiOutputOp(
+      xla_lstm_cell_backward,
+      {grad_h, grad_c, input, hx, cx, w_ih, w_hh, c, gates},
+      [](tensorflow::gtl::ArraySlice<const xla::XlaOp> operands) {
+        return BuildLstmCellBackward(operands[0], operands[1], operands[2],
+                                     operands[3], operands[4], operands[5],
+                                     operands[6], operands[7], operands[8]);
+      },
+      /*num_outputs=*/6);
+}
+
+NodePtr GruCell(const Value& input, const Value& hx, const Value& w_ih,
+                const Value& w_hh, const Value& b_ih, const Value& b_hh) {
+  return MultiOutputOp(
+      xla_gru_cell, {input, hx, w_ih, w_hh, b_ih, b_hh},
+      [](tensorflow::gtl::ArraySlice<const xla::XlaOp> operands) {
+        GruCellResult result =
+            BuildGruCell(operands[0], operands[1], operands[2], operands[3],
+                         operands[4], operands[5]);
+        return std::vector<xla::XlaOp>({result.h, result.gates});
+      },
+      /*num_outputs=*/2);
+}
+
+NodePtr GruCellBackward(const Value& grad_h, const Value& input,
+                        const Value& hx, const Value& w_ih, const Value& w_hh,
+                        const Value& gates) {
+  return MultiOutputOp(
+      xla_gru_cell_backward, {grad_h, input, hx, w_ih, w_hh, gates},
+      [](tensorflow::gtl::ArraySlice<const xla::XlaOp> operands) {
+        return BuildGruCellBackward(operands[0], operands[1], operands[2],
+                                    operands[3], operands[4], operands[5]);
+      },
+      /*num_outputs=*/6);
+}
+
+NodePtr LstmSequence(const Value& input, const Value& h0, const Value& c0,
+                     const Value& w_ih, const Value& w_hh, const Value& b_ih,
+                     const Value& b_hh) {
+  return MultiOutputOp(
+      xla_lstm_sequence, {input, h0, c0, w_ih, w_hh, b_ih, b_hh},
+      [](tensorflow::gtl::ArraySlice<const xla::XlaOp> operands) {
+        LstmSequenceResult result =
+            BuildLstmSequence(operands[0], operands[1], operands[2],
+                              operands[3], operands[4], operands[5],
+                              operands[6]);
+        return std::vector<xla::XlaOp>(
+            {result.output, result.cells, result.gates});
+      },
+      /*num_outputs=*/3);
+}
+
+NodePtr LstmSequenceBackward(const Value& grad_output, const Value& grad_cells,
+                             const Value& input, const Value& h0,
+                             const Value& c0, const Value& w_ih,
+                             const Value& w_hh, const Value& output,
+                             const Value& cells, const Value& gates) {
+  return MultiOutputOp(
+      xla_lstm_sequence_backward,
+      {grad_output, grad_cells, input, h0, c0, w_ih, w_hh, output, cells,
+       gates},
+      [](tensorflow::gtl::ArraySlice<const xla::XlaOp> operands) {
+        return BuildLstmSequenceBackward(
+            operands[0], operands[1], operands[2], operands[3], operands[4],
+            operands[5], operands[6], operands[7], operands[8], operands[9]);
+      },
+      /*num_outputs=*/6);
+}
+
+NodePtr GruSequence(const Value& input, const Value& h0, const Value& w_ih,
+                    const Value& w_hh, const Value& b_ih, const Value& b_hh) {
+  return MultiOutputOp(
+      xla_gru_sequence, {input, h0, w_ih, w_hh, b_ih, b_hh},
+      [](tensorflow::gtl::ArraySlice<const xla::XlaOp> operands) {
+        GruSequenceResult result =
+            BuildGruSequence(operands[0], operands[1], operands[2],
+                             operands[3], operands[4], operands[5]);
+        return std::vector<xla::XlaOp>({result.output, result.gates});
+      },
+      /*num_outputs=*/2);
+}
+
+NodePtr GruSequenceBackward(const Value& grad_output, const Value& input,
+                            const Value& h0, const Value& w_ih,
+                            const Value& w_hh, const Value& output,
+                            const Value& gates) {
+  return MultiOutputOp(
+      xla_gru_sequence_backward,
+      {grad_output, input, h0, w_ih, w_hh, output, gates},
+      [](tensorflow::gtl::ArraySlice<const xla::XlaOp> operands) {
+        return BuildGruSequenceBackward(operands[0], operands[1], operands[2],
+                                        operands[3], operands[4], operands[5],
+                                        operands[6]);
+      },
+      /*num_outputs=*/6);
+}
+
+NodePtr EmbeddingBagPerSampleWeightsBackward(const Value& grad,
+                                             const Value& weight,
+                                             const Value& indices,
+                                             const Value& offset2bag) {
+  auto lower_fn = [](const Node& node, LoweringContext* loctx) -> XlaOpVector {
+    xla::XlaOp xla_grad = loctx->GetOutputOp(node.operand(0));
+    xla::XlaOp xla_weight = loctx->GetOutputOp(node.operand(1));
+    xla::XlaOp xla_indices = loctx->GetOutputOp(node.operand(2));
+    xla::XlaOp xla_offset2bag = loctx->GetOutputOp(node.operand(3));
+    return node.ReturnOp(BuildEmbeddingBagPerSampleWeightsBackward(
+                             xla_grad, xla_weight, xla_indices, xla_offset2bag),
+                         loctx);
+  };
+  return GenericOp(
+      OpKind(at::aten::_embedding_bag_per_sample_weights_backward),
+      {grad, weight, indices, offset2bag},
+      xla::ShapeUtil::MakeShape(grad.shape().element_type(),
+                                {indices.shape().dimensions(0)}),
+      std::move(lower_fn));
+}
+
+NodePtr PackedDropout(const Value& input, const Value& seed,
+                      double probability) {
+  auto lower_fn = [probability](const Node& node,
+                                LoweringContext* loctx) -> XlaOpVector {
+    xla::XlaOp xla_input = loctx->GetOutputOp(node.operand(0));
+    xla::XlaOp xla_seed = loctx->GetOutputOp(node.operand(1));
+    return node.ReturnOps(BuildPackedDropout(xla_input, probability, xla_seed),
+                          loctx);
+  };
+  // The mask holds one bit per input element, in 32 bits words.
+  xla::int64 num_words = (xla::ShapeUtil::ElementsIn(input.shape()) + 31) / 32;
+  xla::Shape shape = xla::ShapeUtil::MakeTupleShape(
+      {input.shape(),
+       xla::ShapeUtil::MakeShape(xla::PrimitiveType::S32, {num_words})});
+  return GenericOp(xla_packed_dropout, {input, seed}, std::move(shape),
+                   std::move(lower_fn), /*num_outputs=*/2,
+                   xla::util::MHash(probability));
+}
+
+NodePtr PackedDropoutBackward(const Value& grad_output,
+                              const Value& packed_mask, double probability) {
+  auto lower_fn = [probability](const Node& node,
+                                LoweringContext* loctx) -> XlaOpVector {
+    xla::XlaOp xla_grad_output = loctx->GetOutputOp(node.operand(0));
+    xla::XlaOp xla_packed_mask = loctx->GetOutputOp(node.operand(1));
+    return node.ReturnOp(BuildPackedDropoutBackward(
+                             xla_grad_output, xla_packed_mask, probability),
+                         loctx);
+  };
+  return GenericOp(xla_packed_dropout_backward, {grad_output, packed_mask},
+                   grad_output.shape(), std::move(lower_fn), /*num_outputs=*/1,
+                   xla::util::MHash(probability));
+}
+
 NodePtr Clamp(const Value& input, const Value& min, const Value& max) {
   auto lower_fn = [](const Node& node, LoweringContext* loctx) -> XlaOpVector {
     xla::XlaOp xla_input = loctx->GetOutputOp(node.operand(0));
@@ -220,8 +588,10 @@ NodePtr AddMatMulOp(const Value& input, const Value& weight,
                     const Value& bias) {
   const xla::PrecisionConfig::Precision precision_level =
       XlaHelpers::mat_mul_precision();
-  auto lower_fn = [precision_level](const Node& node,
-                                    LoweringContext* loctx) -> XlaOpVector {
+  const XlaHelpers::MixedPrecision mixed_precision =
+      XlaHelpers::mixed_precision();
+  auto lower_fn = [precision_level, mixed_precision](
+                      const Node& node, LoweringContext* loctx) -> XlaOpVector {
     XLA_CHECK_EQ(node.operands().size(), 3) << "Unexpected number of operands";
     xla::XlaOp xla_input = loctx->GetOutputOp(node.operand(0));
     xla::XlaOp xla_weight = loctx->GetOutputOp(node.operand(1));
@@ -229,85 +599,228 @@ NodePtr AddMatMulOp(const Value& input, const Value& weight,
     const auto bias_sizes = XlaHelpers::SizesOfXlaOp(xla_bias);
     xla::PrecisionConfig precision_config =
         XlaHelpers::BuildPrecisionConfig(precision_level);
-    xla::XlaOp xla_dot = xla::Dot(xla_input, xla_weight, &precision_config);
+    xla::XlaOp xla_dot = XlaHelpers::MixedPrecisionOp(
+        mixed_precision, xla_input, xla_weight,
+        [&](const xla::XlaOp& lhs, const xla::XlaOp& rhs) {
+          return xla::Dot(lhs, rhs, &precision_config);
+        });
     const auto dot_sizes = XlaHelpers::SizesOfXlaOp(xla_dot);
     if (bias_sizes != dot_sizes) {
       xla_bias = BuildExpand(xla_bias, dot_sizes);
     }
-    xla::XlaOp xla_output = xla_dot + xla_bias;
+    xla::XlaOp xla_output = XlaHelpers::PromotedAdd(xla_dot, xla_bias);
     return node.ReturnOp(xla_output, loctx);
   };
   auto lower_for_shape_fn =
-      [](tensorflow::gtl::ArraySlice<const xla::XlaOp> operands) -> xla::XlaOp {
-    XLA_CHECK_EQ(operands.size(), 2) << "Unexpected number of operands";
-    return xla::Dot(operands[0], operands[1]);
+      [mixed_precision](tensorflow::gtl::ArraySlice<const xla::XlaOp> operands)
+      -> xla::XlaOp {
+    XLA_CHECK_EQ(operands.size(), 3) << "Unexpected number of operands";
+    xla::XlaOp xla_dot = XlaHelpers::MixedPrecisionOp(
+        mixed_precision, operands[0], operands[1],
+        [](const xla::XlaOp& lhs, const xla::XlaOp& rhs) {
+          return xla::Dot(lhs, rhs);
+        });
+    return XlaHelpers::PromotedAdd(
+        xla_dot, BuildExpand(operands[2], XlaHelpers::SizesOfXlaOp(xla_dot)));
   };
-  xla::Shape output_shape =
-      InferOutputShape({input.shape(), weight.shape()}, lower_for_shape_fn);
+  xla::Shape output_shape = InferOutputShape(
+      {input.shape(), weight.shape(), bias.shape()}, lower_for_shape_fn);
   return GenericOp(OpKind(at::aten::addmm), OpList{input, weight, bias},
-                   output_shape, std::move(lower_fn));
+                   output_shape, std::move(lower_fn), /*num_outputs=*/1,
+                   xla::util::MHash(static_cast<int>(precision_level),
+                                    mixed_precision.Hash()));
+}
+
+namespace {
+
+// Returns the XLA operation feeding a matmul operand. If the operand is a
+// permute whose source has already been emitted, the source is returned
+// instead, with the permutation stored into the permutation argument, so that
+// the matmul can fold it. A permute bound to an external operation, like the
+// parameter of a graph segment, has no source within the lowering context,
+// and is consumed as is.
+xla::XlaOp GetMatMulOperandOp(const Output& operand, LoweringContext* loctx,
+                              std::vector<xla::int64>* permutation) {
+  const Permute* permute = dynamic_cast<const Permute*>(operand.node);
+  if (permute == nullptr || loctx->IsExternalOutput(operand) ||
+      !loctx->IsOutputEmitted(permute->operand(0))) {
+    return loctx->GetOutputOp(operand);
+  }
+  XLA_COUNTER("MatMulFoldedPermutes", 1);
+  *permutation = permute->dims();
+  return loctx->GetOutputOp(permute->operand(0));
 }
 
+// Lowers a matmul between operands of the same rank, folding the permutes
+// which produce them.
+xla::XlaOp LowerPermutedMatMul(
+    const Node& node, LoweringContext* loctx,
+    const xla::PrecisionConfig::Precision precision_level,
+    const XlaHelpers::MixedPrecision& mixed_precision) {
+  std::vector<xla::int64> lhs_permutation;
+  std::vector<xla::int64> rhs_permutation;
+  xla::XlaOp xla_lhs =
+      GetMatMulOperandOp(node.operand(0), loctx, &lhs_permutation);
+  xla::XlaOp xla_rhs =
+      GetMatMulOperandOp(node.operand(1), loctx, &rhs_permutation);
+  xla::PrecisionConfig precision_config =
+      XlaHelpers::BuildPrecisionConfig(precision_level);
+  return XlaHelpers::MixedPrecisionOp(
+      mixed_precision, xla_lhs, xla_rhs,
+      [&](const xla::XlaOp& lhs, const xla::XlaOp& rhs) {
+        return CreatePermutedMatMul(lhs, lhs_permutation, rhs, rhs_permutation,
+                                    &precision_config);
+      });
+}
+
+// Whether the matmul operands have the same rank and batch dimensions, in
+// which case no broadcast is needed and the matmul maps to a DotGeneral().
+bool IsPlainMatMul(const xla::Shape& lhs_shape, const xla::Shape& rhs_shape) {
+  if (lhs_shape.rank() < 2 || lhs_shape.rank() != rhs_shape.rank()) {
+    return false;
+  }
+  for (xla::int64 i = 0; i < lhs_shape.rank() - 2; ++i) {
+    if (lhs_shape.dimensions(i) != rhs_shape.dimensions(i)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace
+
 NodePtr Dot(const Value& input, const Value& weight) {
   const xla::PrecisionConfig::Precision precision_level =
       XlaHelpers::mat_mul_precision();
-  auto lower_fn = [precision_level](const Node& node,
-                                    LoweringContext* loctx) -> XlaOpVector {
+  const XlaHelpers::MixedPrecision mixed_precision =
+      XlaHelpers::mixed_precision();
+  auto lower_fn = [precision_level, mixed_precision](
+                      const Node& node, LoweringContext* loctx) -> XlaOpVector {
     XLA_CHECK_EQ(node.operands().size(), 2) << "Unexpected number of operands";
-    xla::XlaOp xla_input = loctx->GetOutputOp(node.operand(0));
-    xla::XlaOp xla_weight = loctx->GetOutputOp(node.operand(1));
-    xla::PrecisionConfig precision_config =
-        XlaHelpers::BuildPrecisionConfig(precision_level);
-    return node.ReturnOp(xla::Dot(xla_input, xla_weight, &precision_config),
-                         loctx);
+    return node.ReturnOp(
+        LowerPermutedMatMul(node, loctx, precision_level, mixed_precision),
+        loctx);
   };
   auto lower_for_shape_fn =
-      [](tensorflow::gtl::ArraySlice<const xla::XlaOp> operands) -> xla::XlaOp {
+      [mixed_precision](tensorflow::gtl::ArraySlice<const xla::XlaOp> operands)
+      -> xla::XlaOp {
     XLA_CHECK_EQ(operands.size(), 2) << "Unexpected number of operands";
-    return xla::Dot(operands[0], operands[1]);
+    return XlaHelpers::MixedPrecisionOp(
+        mixed_precision, operands[0], operands[1],
+        [](const xla::XlaOp& lhs, const xla::XlaOp& rhs) {
+          return xla::Dot(lhs, rhs);
+        });
   };
   xla::Shape output_shape =
       InferOutputShape({input.shape(), weight.shape()}, lower_for_shape_fn);
   return GenericOp(OpKind(at::aten::mm), OpList{input, weight}, output_shape,
-                   std::move(lower_fn));
+                   std::move(lower_fn), /*num_outputs=*/1,
+                   xla::util::MHash(static_cast<int>(precision_level),
+                                    mixed_precision.Hash()));
 }
 
 NodePtr MatMul(const Value& lhs, const Value& rhs) {
-  auto lower_fn = [](const Node& node, LoweringContext* loctx) -> XlaOpVector {
+  const XlaHelpers::MixedPrecision mixed_precision =
+      XlaHelpers::mixed_precision();
+  auto lower_fn = [mixed_precision](const Node& node,
+                                    LoweringContext* loctx) -> XlaOpVector {
+    if (IsPlainMatMul(node.operand(0).shape(), node.operand(1).shape())) {
+      return node.ReturnOp(
+          LowerPermutedMatMul(node, loctx, XlaHelpers::mat_mul_precision(),
+                              mixed_precision),
+          loctx);
+    }
     xla::XlaOp xla_lhs = loctx->GetOutputOp(node.operand(0));
     xla::XlaOp xla_rhs = loctx->GetOutputOp(node.operand(1));
-    return node.ReturnOp(CreateMatMul(xla_lhs, xla_rhs), loctx);
+    return node.ReturnOp(CreateMatMul(xla_lhs, xla_rhs, mixed_precision),
+                         loctx);
   };
   auto lower_for_shape_fn =
-      [](tensorflow::gtl::ArraySlice<const xla::XlaOp> operands) -> xla::XlaOp {
-    return CreateMatMul(operands[0], operands[1]);
+      [mixed_precision](tensorflow::gtl::ArraySlice<const xla::XlaOp> operands)
+      -> xla::XlaOp {
+    return CreateMatMul(operands[0], operands[1], mixed_precision);
   };
   xla::Shape output_shape =
       InferOutputShape({lhs.shape(), rhs.shape()}, lower_for_shape_fn);
   return GenericOp(OpKind(at::aten::matmul), OpList{lhs, rhs}, output_shape,
-                   std::move(lower_fn));
+                   std::move(lower_fn), /*num_outputs=*/1,
+                   mixed_precision.Hash());
 }
 
-NodePtr AdaptiveAvgPool2dBackward(const Value& grad_output,
-                                  const Value& input) {
-  auto lower_fn = [](const Node& node, LoweringContext* loctx) -> XlaOpVector {
+NodePtr CompressionResidual(const Value& input,
+                            CrossReplicaSumCompression compression) {
+  auto lower_fn = [compression](const Node& node,
+                                LoweringContext* loctx) -> XlaOpVector {
+    xla::XlaOp xla_input = loctx->GetOutputOp(node.operand(0));
+    return node.ReturnOp(BuildCompressionResidual(xla_input, compression),
+                         loctx);
+  };
+  return GenericOp(xla_compression_residual, OpList{input}, input.shape(),
+                   std::move(lower_fn), /*num_outputs=*/1,
+                   xla::util::MHash(static_cast<int>(compression)));
+}
+
+NodePtr AdaptiveAvgPoolNdBackward(const Value& grad_output, const Value& input,
+                                  xla::int64 spatial_dim_count) {
+  auto lower_fn = [spatial_dim_count](const Node& node,
+                                      LoweringContext* loctx) -> XlaOpVector {
     xla::XlaOp grad_output = loctx->GetOutputOp(node.operand(0));
     xla::XlaOp input = loctx->GetOutputOp(node.operand(1));
-    xla::XlaOp xla_output = BuildAdaptiveAvgPool2dBackward(
-        /*out_backprop=*/grad_output, /*input=*/input);
+    xla::XlaOp xla_output = BuildAdaptiveAvgPoolNdBackward(
+        /*out_backprop=*/grad_output, /*input=*/input, spatial_dim_count);
     return node.ReturnOp(xla_output, loctx);
   };
   auto lower_for_shape_fn =
-      [](tensorflow::gtl::ArraySlice<const xla::XlaOp> operands) -> xla::XlaOp {
+      [spatial_dim_count](
+          tensorflow::gtl::ArraySlice<const xla::XlaOp> operands)
+      -> xla::XlaOp {
     XLA_CHECK_EQ(operands.size(), 2);
-    return BuildAdaptiveAvgPool2dBackward(/*out_backprop=*/operands[0],
-                                          /*input=*/operands[1]);
+    return BuildAdaptiveAvgPoolNdBackward(/*out_backprop=*/operands[0],
+                                          /*input=*/operands[1],
+                                          spatial_dim_count);
   };
   xla::Shape output_shape = InferOutputShape(
       {grad_output.shape(), input.shape()}, lower_for_shape_fn);
-  return GenericOp(OpKind(at::aten::adaptive_avg_pool2d_backward),
+  return GenericOp(spatial_dim_count == 3
+                       ? OpKind(at::aten::adaptive_avg_pool3d_backward)
+                       : OpKind(at::aten::adaptive_avg_pool2d_backward),
                    OpList{grad_output, input}, output_shape,
-                   std::move(lower_fn));
+                   std::move(lower_fn), /*num_outputs=*/1,
+                   xla::util::MHash(spatial_dim_count));
+}
+
+NodePtr AdaptiveMaxPoolNdBackward(const Value& grad_output, const Value& input,
+                                  const Value& indices,
+                                  xla::int64 spatial_dim_count) {
+  auto lower_fn = [spatial_dim_count](const Node& node,
+                                      LoweringContext* loctx) -> XlaOpVector {
+    xla::XlaOp grad_output = loctx->GetOutputOp(node.operand(0));
+    xla::XlaOp input = loctx->GetOutputOp(node.operand(1));
+    xla::XlaOp indices = loctx->GetOutputOp(node.operand(2));
+    xla::XlaOp xla_output = BuildAdaptiveMaxPoolNdBackward(
+        /*out_backprop=*/grad_output, /*input=*/input, indices,
+        spatial_dim_count);
+    return node.ReturnOp(xla_output, loctx);
+  };
+  auto lower_for_shape_fn =
+      [spatial_dim_count](
+          tensorflow::gtl::ArraySlice<const xla::XlaOp> operands)
+      -> xla::XlaOp {
+    XLA_CHECK_EQ(operands.size(), 3);
+    return BuildAdaptiveMaxPoolNdBackward(/*out_backprop=*/operands[0],
+                                          /*input=*/operands[1],
+                                          /*indices=*/operands[2],
+                                          spatial_dim_count);
+  };
+  xla::Shape output_shape = InferOutputShape(
+      {grad_output.shape(), input.shape(), indices.shape()},
+      lower_for_shape_fn);
+  return GenericOp(spatial_dim_count == 3
+                       ? OpKind(at::aten::adaptive_max_pool3d_backward)
+                       : OpKind(at::aten::adaptive_max_pool2d_backward),
+                   OpList{grad_output, input, indices}, output_shape,
+                   std::move(lower_fn), /*num_outputs=*/1,
+                   xla::util::MHash(spatial_dim_count));
 }
 
 NodePtr ComparisonOp(c10::Symbol kind, const Value& input, const Value& other) {
@@ -550,18 +1063,60 @@ NodePtr MinUnary(const Value& input) {
                    std::move(lower_fn));
 }
 
-NodePtr Bernoulli(const Value& input, const Value& probability) {
+NodePtr Bernoulli(const Value& input, const Value& probability,
+                  const Value& seed) {
   auto lower_fn = [](const Node& node, LoweringContext* loctx) -> XlaOpVector {
     xla::XlaOp xla_input = loctx->GetOutputOp(node.operand(0));
     xla::XlaOp xla_probability = loctx->GetOutputOp(node.operand(1));
-    xla::XlaOp result =
-        BuildBernoulli(xla_probability, XlaHelpers::ShapeOfXlaOp(xla_input));
+    xla::XlaOp xla_seed = loctx->GetOutputOp(node.operand(2));
+    xla::XlaOp result = BuildBernoulli(xla_probability, xla_seed,
+                                       XlaHelpers::ShapeOfXlaOp(xla_input));
     return node.ReturnOp(result, loctx);
   };
   NodePtr probability_expanded = MakeNode<Expand>(
       probability, xla::util::ToVector<xla::int64>(input.shape().dimensions()));
-  return GenericOp(OpKind(at::aten::bernoulli), {input, probability_expanded},
-                   input.shape(), std::move(lower_fn));
+  return GenericOp(OpKind(at::aten::bernoulli),
+                   {input, probability_expanded, seed}, input.shape(),
+                   std::move(lower_fn));
+}
+
+NodePtr Normal(const xla::Shape& shape, const Value& mean, const Value& std,
+               const Value& seed) {
+  auto lower_fn = [](const Node& node, LoweringContext* loctx) -> XlaOpVector {
+    xla::XlaOp xla_mean = loctx->GetOutputOp(node.operand(0));
+    xla::XlaOp xla_std = loctx->GetOutputOp(node.operand(1));
+    xla::XlaOp xla_seed = loctx->GetOutputOp(node.operand(2));
+    return node.ReturnOp(RngNormal(xla_seed, node.shape(), xla_mean, xla_std),
+                         loctx);
+  };
+  return GenericOp(OpKind(at::aten::normal), {mean, std, seed}, shape,
+                   std::move(lower_fn));
+}
+
+NodePtr Uniform(const xla::Shape& shape, const Value& from, const Value& to,
+                const Value& seed) {
+  auto lower_fn = [](const Node& node, LoweringContext* loctx) -> XlaOpVector {
+    xla::XlaOp xla_from = loctx->GetOutputOp(node.operand(0));
+    xla::XlaOp xla_to = loctx->GetOutputOp(node.operand(1));
+    xla::XlaOp xla_seed = loctx->GetOutputOp(node.operand(2));
+    return node.ReturnOp(RngUniform(xla_seed, node.shape(), xla_from, xla_to),
+                         loctx);
+  };
+  return GenericOp(OpKind(at::aten::uniform), {from, to, seed}, shape,
+                   std::move(lower_fn));
+}
+
+NodePtr RandomInt(const xla::Shape& shape, xla::int64 from, xla::int64 to,
+                  const Value& seed) {
+  auto lower_fn = [from, to](const Node& node,
+                             LoweringContext* loctx) -> XlaOpVector {
+    xla::XlaOp xla_seed = loctx->GetOutputOp(node.operand(0));
+    return node.ReturnOp(RngUniformInt(xla_seed, node.shape(), from, to),
+                         loctx);
+  };
+  return GenericOp(OpKind(at::aten::random), {seed}, shape,
+                   std::move(lower_fn), /*num_outputs=*/1,
+                   xla::util::MHash(from, to));
 }
 
 }  // namespace ops
@@ -58,9 +58,15 @@ inline NodePtr GenericOp(OpKind op, xla::Shape shape, Generic::LowerFn lower_fn,
 
 inline NodePtr CrossReplicaSumOp(const Value& operand, double scale,
                                  std::vector<std::vector<xla::int64>> groups) {
-  return MakeNode<CrossReplicaSum>(operand, scale, std::move(groups));
+  return MakeNode<CrossReplicaSum>(OpList{operand}, scale, std::move(groups),
+                                   CrossReplicaSumCompression::kNone,
+                                   std::vector<std::vector<xla::int64>>());
 }
 
+// Computes the error introduced by the cross replica sum compression on input.
+NodePtr CompressionResidual(const Value& input,
+                            CrossReplicaSumCompression compression);
+
 NodePtr Acos(const Value& input);
 
 NodePtr Cos(const Value& input);
@@ -136,6 +142,107 @@ NodePtr LogSoftmaxBackwardOp(const Value& grad_output, const Value& output,
 NodePtr SoftmaxBackwardOp(const Value& grad_output, const Value& output,
                           xla::int64 dim);
 
+NodePtr LogSumExp(const Value& input, xla::int64 dim);
+
+// Same as LogSoftmaxBackwardOp(), but takes the LogSoftmax input and its
+// LogSumExp() instead of the LogSoftmax output.
+NodePtr LogSoftmaxBackwardFromLogits(const Value& grad_output,
+                                     const Value& logits,
+                                     const Value& log_sum_exp, xla::int64 dim);
+
+// Sums the slices of values along dim with the same index. The first output
+// holds the distinct indices, the second one the segment sums (see
+// BuildSegmentSum()).
+NodePtr SegmentSum(const Value& indices, const Value& values, xla::int64 dim,
+                   xla::int64 num_segments);
+
+// Converts the input to the given element type, regardless of the one its
+// logical PyTorch type maps to (like BF16 for a float tensor).
+NodePtr ConvertTo(const Value& input, xla::PrimitiveType element_type);
+
+// Quantizes the input to int8 with a scale computed on device. The first output
+// holds the values (of element_type), the second one the F32 scale (see
+// BuildDynamicQuantize()).
+NodePtr DynamicQuantize(const Value& input, xla::PrimitiveType element_type);
+
+// Returns the F32 counts of the bins of the input, and its {min, max} range
+// (see BuildHistogram()).
+NodePtr Histogram(const Value& input, xla::int64 bins);
+
+// Unpacks the S32 words holding the bits of a PRED tensor of the given shape
+// (see BuildUnpackBits()).
+NodePtr UnpackBits(const Value& input, const xla::Shape& shape);
+
+// Returns the inputs (one output each) with a data dependency on the anchor,
+// see BuildRematAnchor().
+NodePtr RematAnchor(tensorflow::gtl::ArraySlice<const Value> inputs,
+                    const Value& anchor);
+
+// Returns the input annotated with the sharding, see BuildShardingAnnotation().
+NodePtr ShardingAnnotation(const Value& input, const xla::OpSharding& sharding);
+
+// The bounded versions of nonzero, masked_select and unique, returning the
+// padded result (output 0) and the count of its valid rows (output 1), see
+// bounded_ops.h.
+NodePtr NonZeroBounded(const Value& input);
+
+NodePtr MaskedSelectBounded(const Value& input, const Value& mask);
+
+NodePtr UniqueBounded(const Value& input);
+
+// The fused recurrent cells and sequences, and their backward, see rnn.h. The
+// outputs are the ones of the respective Build*() functions, in the order of
+// their result fields.
+NodePtr LstmCell(const Value& input, const Value& hx, const Value& cx,
+                 const Value& w_ih, const Value& w_hh, const Value& b_ih,
+                 const Value& b_hh);
+
+NodePtr LstmCellBackward(const Value& grad_h, const Value& grad_c,
+                         const Value& input, const Value& hx, const Value& cx,
+                         const Value& w_ih, const Value& w_hh, const Value& c,
+                         const Value& gates);
+
+NodePtr GruCell(const Value& input, const Value& hx, const Value& w_ih,
+                const Value& w_hh, const Value& b_ih, const Value& b_hh);
+
+NodePtr GruCellBackward(const Value& grad_h, const Value& input,
+                        const Value& hx, const Value& w_ih, const Value& w_hh,
+                        const Value& gates);
+
+NodePtr LstmSequence(const Value& input, const Value& h0, const Value& c0,
+                     const Value& w_ih, const Value& w_hh, const Value& b_ih,
+                     const Value& b_hh);
+
+NodePtr LstmSequenceBackward(const Value& grad_output, const Value& grad_cells,
+                             const Value& input, const Value& h0,
+                             const Value& c0, const Value& w_ih,
+                             const Value& w_hh, const Value& output,
+                             const Value& cells, const Value& gates);
+
+NodePtr GruSequence(const Value& input, const Value& h0, const Value& w_ih,
+                    const Value& w_hh, const Value& b_ih, const Value& b_hh);
+
+NodePtr GruSequenceBackward(const Value& grad_output, const Value& input,
+                            const Value& h0, const Value& w_ih,
+                            const Value& w_hh, const Value& output,
+                            const Value& gates);
+
+// The gradient of the per sample weights of EmbeddingBag, see
+// BuildEmbeddingBagPerSampleWeightsBackward().
+NodePtr EmbeddingBagPerSampleWeightsBackward(const Value& grad,
+                                             const Value& weight,
+                                             const Value& indices,
+                                             const Value& offset2bag);
+
+// Returns the dropout of the input (output 0), with probability the probability
+// of dropping an element, and the bit packed mask of the kept elements (output
+// 1), see BuildPackedDropout().
+NodePtr PackedDropout(const Value& input, const Value& seed,
+                      double probability);
+
+NodePtr PackedDropoutBackward(const Value& grad_output,
+                              const Value& packed_mask, double probability);
+
 NodePtr Clamp(const Value& input, const Value& min, const Value& max);
 
 NodePtr Ceil(const Value& input);
@@ -152,7 +259,12 @@ NodePtr Dot(const Value& input, const Value& weight);
 
 NodePtr MatMul(const Value& lhs, const Value& rhs);
 
-NodePtr AdaptiveAvgPool2dBackward(const Value& grad_output, const Value& input);
+NodePtr AdaptiveAvgPoolNdBackward(const Value& grad_output, const Value& input,
+                                  xla::int64 spatial_dim_count);
+
+NodePtr AdaptiveMaxPoolNdBackward(const Value& grad_output, const Value& input,
+                                  const Value& indices,
+                                  xla::int64 spatial_dim_count);
 
 NodePtr ComparisonOp(c10::Symbol kind, const Value& input, const Value& other);
 
@@ -192,7 +304,19 @@ NodePtr MaxUnary(const Value& input);
 
 NodePtr MinUnary(const Value& input);
 
-NodePtr Bernoulli(const Value& input, const Value& probability);
+NodePtr Bernoulli(const Value& input, const Value& probability,
+                  const Value& seed);
+
+// The random nodes below generate values with the given shape, on device,
+// from the mean/std (or from/to range) scalars and the seed.
+NodePtr Normal(const xla::Shape& shape, const Value& mean, const Value& std,
+               const Value& seed);
+
+NodePtr Uniform(const xla::Shape& shape, const Value& from, const Value& to,
+                const Value& seed);
+
+NodePtr RandomInt(const xla::Shape& shape, xla::int64 from, xla::int64 to,
+                  const Value& seed);
 
 }  // namespace ops
 }  // namespace ir
@@ -0,0 +1,360 @@
+#include "torch_xla/csrc/ops/optimizer_step.h"
+
+#include "tensorflow/compiler/xla/shape_util.h"
+#include "tensorflow/compiler/xla/xla_client/debug_macros.h"
+#include "tensorflow/compiler/xla/xla_client/util.h"
+#include "torch_xla/csrc/lowering_context.h"
+#include "torch_xla/csrc/ops/xla_ops.h"
+#include "torch_xla/csrc/optimizers.h"
+
+namespace torch_xla {
+namespace ir {
+namespace ops {
+namespace {
+
+// Concatenates the tensor operand groups, followed by the scalar operands which
+// are present.
+std::vector<Value> MakeOperands(std::initializer_list<OpList> groups,
+                                std::initializer_list<Value> scalars) {
+  std::vector<Value> operands;
+  for (auto& group : groups) {
+    operands.insert(operands.end(), group.begin(), group.end());
+  }
+  for (auto& scalar : scalars) {
+    if (scalar) {
+      operands.push_back(scalar);
+    }
+  }
+  return operands;
+}
+
+// The outputs have the shapes of the tensor operands, in the same order.
+xla::Shape MakeOutputShape(std::initializer_list<OpList> groups) {
+  std::vector<xla::Shape> shapes;
+  for (auto& group : groups) {
+    for (auto& value : group) {
+      shapes.push_back(value.shape());
+    }
+  }
+  return xla::ShapeUtil::MakeTupleShape(shapes);
+}
+
+size_t NumOutputs(std::initializer_list<OpList> groups) {
+  size_t count = 0;
+  for (auto& group : groups) {
+    count += group.size();
+  }
+  return count;
+}
+
+// The gradients, followed by a F32 scalar (like the total norm).
+xla::Shape MakeGradsAndScalarShape(OpList grads) {
+  std::vector<xla::Shape> shapes;
+  for (auto& grad : grads) {
+    shapes.push_back(grad.shape());
+  }
+  shapes.push_back(xla::ShapeUtil::MakeShape(xla::PrimitiveType::F32, {}));
+  return xla::ShapeUtil::MakeTupleShape(shapes);
+}
+
+std::vector<Value> OperandRange(OpList operands, size_t start, size_t count) {
+  XLA_CHECK_LE(start + count, operands.size());
+  return std::vector<Value>(operands.begin() + start,
+                            operands.begin() + start + count);
+}
+
+std::vector<xla::XlaOp> LowerOperandRange(const Node& node, size_t start,
+                                          size_t count,
+                                          LoweringContext* loctx) {
+  std::vector<xla::XlaOp> ops;
+  ops.reserve(count);
+  for (size_t i = start; i < start + count; ++i) {
+    ops.push_back(loctx->GetOutputOp(node.operand(i)));
+  }
+  return ops;
+}
+
+}  // namespace
+
+SgdStep::SgdStep(OpList params, OpList grads, OpList momentum_buffers,
+                 const Value& lr, const Value& momentum,
+                 const Value& dampening, const Value& weight_decay,
+                 bool nesterov, bool init_buffers)
+    : Node(xla_sgd_step,
+           MakeOperands({params, grads, momentum_buffers},
+                        {lr, momentum, dampening, weight_decay}),
+           MakeOutputShape({params, momentum_buffers}),
+           /*num_outputs=*/NumOutputs({params, momentum_buffers}),
+           xla::util::MHash(params.size(), !momentum_buffers.empty(),
+                            static_cast<bool>(weight_decay), nesterov,
+                            init_buffers)),
+      num_params_(params.size()),
+      use_momentum_(!momentum_buffers.empty()),
+      use_weight_decay_(static_cast<bool>(weight_decay)),
+      nesterov_(nesterov),
+      init_buffers_(init_buffers) {
+  XLA_CHECK_EQ(grads.size(), num_params_);
+  XLA_CHECK(!use_momentum_ || momentum_buffers.size() == num_params_);
+}
+
+std::string SgdStep::ToString() const {
+  std::stringstream ss;
+  ss << Node::ToString() << ", num_params=" << num_params_
+     << ", momentum=" << use_momentum_
+     << ", weight_decay=" << use_weight_decay_ << ", nesterov=" << nesterov_
+     << ", init_buffers=" << init_buffers_;
+  return ss.str();
+}
+
+NodePtr SgdStep::Clone(OpList operands) const {
+  size_t num_buffers = use_momentum_ ? num_params_ : 0;
+  size_t scalars = 2 * num_params_ + num_buffers;
+  return MakeNode<SgdStep>(
+      OperandRange(operands, 0, num_params_),
+      OperandRange(operands, num_params_, num_params_),
+      OperandRange(operands, 2 * num_params_, num_buffers),
+      operands.at(scalars), operands.at(scalars + 1),
+      operands.at(scalars + 2),
+      use_weight_decay_ ? operands.at(scalars + 3) : Value(), nesterov_,
+      init_buffers_);
+}
+
+XlaOpVector SgdStep::Lower(LoweringContext* loctx) const {
+  size_t num_buffers = use_momentum_ ? num_params_ : 0;
+  size_t scalars = 2 * num_params_ + num_buffers;
+  std::vector<xla::XlaOp> results = BuildSgdStep(
+      LowerOperandRange(*this, 0, num_params_, loctx),
+      LowerOperandRange(*this, num_params_, num_params_, loctx),
+      LowerOperandRange(*this, 2 * num_params_, num_buffers, loctx),
+      loctx->GetOutputOp(operand(scalars)),
+      loctx->GetOutputOp(operand(scalars + 1)),
+      loctx->GetOutputOp(operand(scalars + 2)),
+      use_weight_decay_ ? loctx->GetOutputOp(operand(scalars + 3))
+                        : xla::XlaOp(),
+      nesterov_, init_buffers_);
+  return ReturnOps(results, loctx);
+}
+
+AdamStep::AdamStep(OpList params, OpList grads, OpList exp_avgs,
+                   OpList exp_avg_sqs, OpList max_exp_avg_sqs,
+                   const Value& step_size, const Value& beta1,
+                   const Value& beta2, const Value& eps,
+                   const Value& weight_decay)
+    : Node(xla_adam_step,
+           MakeOperands({params, grads, exp_avgs, exp_avg_sqs, max_exp_avg_sqs},
+                        {step_size, beta1, beta2, eps, weight_decay}),
+           MakeOutputShape({params, exp_avgs, exp_avg_sqs, max_exp_avg_sqs}),
+           /*num_outputs=*/
+           NumOutputs({params, exp_avgs, exp_avg_sqs, max_exp_avg_sqs}),
+           xla::util::MHash(params.size(), !max_exp_avg_sqs.empty(),
+                            static_cast<bool>(weight_decay))),
+      num_params_(params.size()),
+      amsgrad_(!max_exp_avg_sqs.empty()),
+      use_weight_decay_(static_cast<bool>(weight_decay)) {
+  XLA_CHECK_EQ(grads.size(), num_params_);
+  XLA_CHECK_EQ(exp_avgs.size(), num_params_);
+  XLA_CHECK_EQ(exp_avg_sqs.size(), num_params_);
+  XLA_CHECK(!amsgrad_ || max_exp_avg_sqs.size() == num_params_);
+}
+
+std::string AdamStep::ToString() const {
+  std::stringstream ss;
+  ss << Node::ToString() << ", num_params=" << num_params_
+     << ", amsgrad=" << amsgrad_ << ", weight_decay=" << use_weight_decay_;
+  return ss.str();
+}
+
+NodePtr AdamStep::Clone(OpList operands) const {
+  size_t num_max = amsgrad_ ? num_params_ : 0;
+  size_t scalars = 4 * num_params_ + num_max;
+  return MakeNode<AdamStep>(
+      OperandRange(operands, 0, num_params_),
+      OperandRange(operands, num_params_, num_params_),
+      OperandRange(operands, 2 * num_params_, num_params_),
+      OperandRange(operands, 3 * num_params_, num_params_),
+      OperandRange(operands, 4 * num_params_, num_max), operands.at(scalars),
+      operands.at(scalars + 1), operands.at(scalars + 2),
+      operands.at(scalars + 3),
+      use_weight_decay_ ? operands.at(scalars + 4) : Value());
+}
+
+XlaOpVector AdamStep::Lower(LoweringContext* loctx) const {
+  size_t num_max = amsgrad_ ? num_params_ : 0;
+  size_t scalars = 4 * num_params_ + num_max;
+  std::vector<xla::XlaOp> results = BuildAdamStep(
+      LowerOperandRange(*this, 0, num_params_, loctx),
+      LowerOperandRange(*this, num_params_, num_params_, loctx),
+      LowerOperandRange(*this, 2 * num_params_, num_params_, loctx),
+      LowerOperandRange(*this, 3 * num_params_, num_params_, loctx),
+      LowerOperandRange(*this, 4 * num_params_, num_max, loctx),
+      loctx->GetOutputOp(operand(scalars)),
+      loctx->GetOutputOp(operand(scalars + 1)),
+      loctx->GetOutputOp(operand(scalars + 2)),
+      loctx->GetOutputOp(operand(scalars + 3)),
+      use_weight_decay_ ? loctx->GetOutputOp(operand(scalars + 4))
+                        : xla::XlaOp());
+  return ReturnOps(results, loctx);
+}
+
+LambStep::LambStep(OpList params, OpList grads, OpList exp_avgs,
+                   OpList exp_avg_sqs, const Value& lr, const Value& beta1,
+                   const Value& beta2, const Value& eps,
+                   const Value& weight_decay, const Value& bias_correction1,
+                   const Value& bias_correction2)
+    : Node(xla_lamb_step,
+           MakeOperands({params, grads, exp_avgs, exp_avg_sqs},
+                        {lr, beta1, beta2, eps, bias_correction1,
+                         bias_correction2, weight_decay}),
+           MakeOutputShape({params, exp_avgs, exp_avg_sqs}),
+           /*num_outputs=*/NumOutputs({params, exp_avgs, exp_avg_sqs}),
+           xla::util::MHash(params.size(), static_cast<bool>(weight_decay))),
+      num_params_(params.size()),
+      use_weight_decay_(static_cast<bool>(weight_decay)) {
+  XLA_CHECK_EQ(grads.size(), num_params_);
+  XLA_CHECK_EQ(exp_avgs.size(), num_params_);
+  XLA_CHECK_EQ(exp_avg_sqs.size(), num_params_);
+}
+
+std::string LambStep::ToString() const {
+  std::stringstream ss;
+  ss << Node::ToString() << ", num_params=" << num_params_
+     << ", weight_decay=" << use_weight_decay_;
+  return ss.str();
+}
+
+NodePtr LambStep::Clone(OpList operands) const {
+  size_t scalars = 4 * num_params_;
+  return MakeNode<LambStep>(
+      OperandRange(operands, 0, num_params_),
+      OperandRange(operands, num_params_, num_params_),
+      OperandRange(operands, 2 * num_params_, num_params_),
+      OperandRange(operands, 3 * num_params_, num_params_),
+      operands.at(scalars), operands.at(scalars + 1), operands.at(scalars + 2),
+      operands.at(scalars + 3),
+      use_weight_decay_ ? operands.at(scalars + 6) : Value(),
+      operands.at(scalars + 4), operands.at(scalars + 5));
+}
+
+XlaOpVector LambStep::Lower(LoweringContext* loctx) const {
+  size_t scalars = 4 * num_params_;
+  std::vector<xla::XlaOp> results = BuildLambStep(
+      LowerOperandRange(*this, 0, num_params_, loctx),
+      LowerOperandRange(*this, num_params_, num_params_, loctx),
+      LowerOperandRange(*this, 2 * num_params_, num_params_, loctx),
+      LowerOperandRange(*this, 3 * num_params_, num_params_, loctx),
+      loctx->GetOutputOp(operand(scalars)),
+      loctx->GetOutputOp(operand(scalars + 1)),
+      loctx->GetOutputOp(operand(scalars + 2)),
+      loctx->GetOutputOp(operand(scalars + 3)),
+      use_weight_decay_ ? loctx->GetOutputOp(operand(scalars + 6))
+                        : xla::XlaOp(),
+      loctx->GetOutputOp(operand(scalars + 4)),
+      loctx->GetOutputOp(operand(scalars + 5)));
+  return ReturnOps(results, loctx);
+}
+
+ClipGradNorm::ClipGradNorm(OpList grads, const Value& max_norm,
+                           double norm_type)
+    : Node(xla_clip_grad_norm, MakeOperands({grads}, {max_norm}),
+           MakeGradsAndScalarShape(grads),
+           /*num_outputs=*/grads.size() + 1,
+           xla::util::MHash(grads.size(), norm_type)),
+      norm_type_(norm_type) {}
+
+std::string ClipGradNorm::ToString() const {
+  std::stringstream ss;
+  ss << Node::ToString() << ", norm_type=" << norm_type_;
+  return ss.str();
+}
+
+NodePtr ClipGradNorm::Clone(OpList operands) const {
+  size_t num_grads = operands.size() - 1;
+  return MakeNode<ClipGradNorm>(OperandRange(operands, 0, num_grads),
+                                operands.at(num_grads), norm_type_);
+}
+
+XlaOpVector ClipGradNorm::Lower(LoweringContext* loctx) const {
+  size_t num_grads = operands().size() - 1;
+  std::vector<xla::XlaOp> results =
+      BuildClipGradNorm(LowerOperandRange(*this, 0, num_grads, loctx),
+                        loctx->GetOutputOp(operand(num_grads)), norm_type_);
+  return ReturnOps(results, loctx);
+}
+
+AmpUnscale::AmpUnscale(OpList grads, const Value& loss_scale)
+    : Node(xla_amp_unscale, MakeOperands({grads}, {loss_scale}),
+           MakeGradsAndScalarShape(grads),
+           /*num_outputs=*/grads.size() + 1, xla::util::MHash(grads.size())) {}
+
+NodePtr AmpUnscale::Clone(OpList operands) const {
+  size_t num_grads = operands.size() - 1;
+  return MakeNode<AmpUnscale>(OperandRange(operands, 0, num_grads),
+                              operands.at(num_grads));
+}
+
+XlaOpVector AmpUnscale::Lower(LoweringContext* loctx) const {
+  size_t num_grads = operands().size() - 1;
+  std::vector<xla::XlaOp> results =
+      BuildAmpUnscale(LowerOperandRange(*this, 0, num_grads, loctx),
+                      loctx->GetOutputOp(operand(num_grads)));
+  return ReturnOps(results, loctx);
+}
+
+SelectFiniteUpdates::SelectFiniteUpdates(OpList updated, OpList previous,
+                                         const Value& found_inf)
+    : Node(xla_select_finite_updates,
+           MakeOperands({updated, previous}, {found_inf}),
+           MakeOutputShape({updated}),
+           /*num_outputs=*/updated.size(), xla::util::MHash(updated.size())) {
+  XLA_CHECK_EQ(updated.size(), previous.size());
+}
+
+NodePtr SelectFiniteUpdates::Clone(OpList operands) const {
+  size_t count = num_outputs();
+  return MakeNode<SelectFiniteUpdates>(OperandRange(operands, 0, count),
+                                       OperandRange(operands, count, count),
+                                       operands.at(2 * count));
+}
+
+XlaOpVector SelectFiniteUpdates::Lower(LoweringContext* loctx) const {
+  size_t count = num_outputs();
+  std::vector<xla::XlaOp> results = BuildSelectFiniteUpdates(
+      LowerOperandRange(*this, 0, count, loctx),
+      LowerOperandRange(*this, count, count, loctx),
+      loctx->GetOutputOp(operand(2 * count)));
+  return ReturnOps(results, loctx);
+}
+
+UpdateLossScale::UpdateLossScale(const Value& loss_scale,
+                                 const Value& good_steps,
+                                 const Value& found_inf,
+                                 const Value& growth_factor,
+                                 const Value& backoff_factor,
+                                 const Value& growth_interval,
+                                 const Value& min_scale)
+    : Node(xla_update_loss_scale,
+           {loss_scale, good_steps, found_inf, growth_factor, backoff_factor,
+            growth_interval, min_scale},
+           xla::ShapeUtil::MakeTupleShape({loss_scale.shape(),
+                                           good_steps.shape()}),
+           /*num_outputs=*/2) {}
+
+NodePtr UpdateLossScale::Clone(OpList operands) const {
+  return MakeNode<UpdateLossScale>(operands.at(0), operands.at(1),
+                                   operands.at(2), operands.at(3),
+                                   operands.at(4), operands.at(5),
+                                   operands.at(6));
+}
+
+XlaOpVector UpdateLossScale::Lower(LoweringContext* loctx) const {
+  std::vector<xla::XlaOp> results = BuildUpdateLossScale(
+      loctx->GetOutputOp(operand(0)), loctx->GetOutputOp(operand(1)),
+      loctx->GetOutputOp(operand(2)), loctx->GetOutputOp(operand(3)),
+      loctx->GetOutputOp(operand(4)), loctx->GetOutputOp(operand(5)),
+      loctx->GetOutputOp(operand(6)));
+  return ReturnOps(results, loctx);
+}
+
+}  // namespace ops
+}  // namespace ir
+}  // namespace torch_xla
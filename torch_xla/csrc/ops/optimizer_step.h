@@ -0,0 +1,142 @@
+#pragma once
+
+#include "torch_xla/csrc/ir.h"
+
+namespace torch_xla {
+namespace ir {
+namespace ops {
+
+// The multi-tensor optimizer steps, which update all the parameters of a
+// parameter group within a single node (see optimizers.h). The operands are
+// the parameters, the gradients and the state tensors, followed by the scalar
+// hyperparameters, with the weight decay only present when it is not zero. The
+// outputs are the updated parameters, followed by the updated state tensors.
+
+class SgdStep : public Node {
+ public:
+  SgdStep(OpList params, OpList grads, OpList momentum_buffers,
+          const Value& lr, const Value& momentum, const Value& dampening,
+          const Value& weight_decay, bool nesterov, bool init_buffers);
+
+  std::string ToString() const override;
+
+  NodePtr Clone(OpList operands) const override;
+
+  XlaOpVector Lower(LoweringContext* loctx) const override;
+
+  size_t num_params() const { return num_params_; }
+
+  bool nesterov() const { return nesterov_; }
+
+  bool init_buffers() const { return init_buffers_; }
+
+ private:
+  size_t num_params_;
+  bool use_momentum_;
+  bool use_weight_decay_;
+  bool nesterov_;
+  bool init_buffers_;
+};
+
+class AdamStep : public Node {
+ public:
+  AdamStep(OpList params, OpList grads, OpList exp_avgs, OpList exp_avg_sqs,
+           OpList max_exp_avg_sqs, const Value& step_size, const Value& beta1,
+           const Value& beta2, const Value& eps, const Value& weight_decay);
+
+  std::string ToString() const override;
+
+  NodePtr Clone(OpList operands) const override;
+
+  XlaOpVector Lower(LoweringContext* loctx) const override;
+
+  size_t num_params() const { return num_params_; }
+
+  bool amsgrad() const { return amsgrad_; }
+
+ private:
+  size_t num_params_;
+  bool amsgrad_;
+  bool use_weight_decay_;
+};
+
+class LambStep : public Node {
+ public:
+  LambStep(OpList params, OpList grads, OpList exp_avgs, OpList exp_avg_sqs,
+           const Value& lr, const Value& beta1, const Value& beta2,
+           const Value& eps, const Value& weight_decay,
+           const Value& bias_correction1, const Value& bias_correction2);
+
+  std::string ToString() const override;
+
+  NodePtr Clone(OpList operands) const override;
+
+  XlaOpVector Lower(LoweringContext* loctx) const override;
+
+  size_t num_params() const { return num_params_; }
+
+ private:
+  size_t num_params_;
+  bool use_weight_decay_;
+};
+
+// Scales the gradients operands by the clip coefficient of their total norm.
+// The last operand is the max_norm scalar, and the last output is the total
+// norm.
+class ClipGradNorm : public Node {
+ public:
+  ClipGradNorm(OpList grads, const Value& max_norm, double norm_type);
+
+  std::string ToString() const override;
+
+  NodePtr Clone(OpList operands) const override;
+
+  XlaOpVector Lower(LoweringContext* loctx) const override;
+
+  double norm_type() const { return norm_type_; }
+
+ private:
+  double norm_type_;
+};
+
+// Unscales the gradients operands by the last operand, the loss scale. The
+// last output is the F32 found_inf flag (see BuildAmpUnscale()).
+class AmpUnscale : public Node {
+ public:
+  AmpUnscale(OpList grads, const Value& loss_scale);
+
+  NodePtr Clone(OpList operands) const override;
+
+  XlaOpVector Lower(LoweringContext* loctx) const override;
+};
+
+// Selects between the updated and the previous values of the tensors, on the
+// found_inf flag (the last operand). The outputs have the shapes of the updated
+// values.
+class SelectFiniteUpdates : public Node {
+ public:
+  SelectFiniteUpdates(OpList updated, OpList previous, const Value& found_inf);
+
+  NodePtr Clone(OpList operands) const override;
+
+  XlaOpVector Lower(LoweringContext* loctx) const override;
+};
+
+// Computes the new loss scale and good steps counter, out of the current ones,
+// the found_inf flag and the scaler hyperparameters (see
+// BuildUpdateLossScale()).
+class UpdateLossScale : public Node {
+ public:
+  UpdateLossScale(const Value& loss_scale, const Value& good_steps,
+                  const Value& found_inf, const Value& growth_factor,
+                  const Value& backoff_factor, const Value& growth_interval,
+                  const Value& min_scale);
+
+  NodePtr Clone(OpList operands) const override;
+
+  XlaOpVector Lower(LoweringContext* loctx) const override;
+};
+
+}  // namespace ops
+}  // namespace ir
+}  // namespace torch_xla
@@ -1,9 +1,10 @@
 #include "torch_xla/csrc/ops/permute.h"
 
+#include "tensorflow/compiler/xla/shape_util.h"
 #include "tensorflow/compiler/xla/xla_client/debug_macros.h"
 #include "tensorflow/compiler/xla/xla_client/util.h"
+#include "torch_xla/csrc/helpers.h"
 #include "torch_xla/csrc/lowering_context.h"
-#include "torch_xla/csrc/ops/infer_output_shape.h"
 
 namespace torch_xla {
 namespace ir {
@@ -12,13 +13,11 @@ namespace {
 
 xla::Shape NodeOutputShape(const Value& input,
                            tensorflow::gtl::ArraySlice<const xla::int64> dims) {
-  auto lower_for_shape_fn =
-      [dims](tensorflow::gtl::ArraySlice<const xla::XlaOp> operands)
-      -> xla::XlaOp {
-    XLA_CHECK_EQ(operands.size(), 1);
-    return xla::Transpose(operands[0], dims);
-  };
-  return InferOutputShape({input.shape()}, lower_for_shape_fn);
+  const xla::Shape& input_shape = input.shape();
+  XLA_CHECK_EQ(dims.size(), input_shape.rank());
+  return xla::ShapeUtil::MakeShape(
+      input_shape.element_type(),
+      XlaHelpers::Permute(dims, input_shape.dimensions()));
 }
 
 }  // namespace
@@ -1,11 +1,9 @@
 #include "torch_xla/csrc/ops/qr.h"
 
-#include "tensorflow/compiler/xla/client/lib/constants.h"
-#include "tensorflow/compiler/xla/client/lib/matrix.h"
-#include "tensorflow/compiler/xla/client/lib/qr.h"
+#include "tensorflow/compiler/xla/shape_util.h"
+#include "tensorflow/compiler/xla/xla_client/debug_macros.h"
 #include "tensorflow/compiler/xla/xla_client/util.h"
-#include "torch_xla/csrc/data_ops.h"
-#include "torch_xla/csrc/helpers.h"
+#include "torch_xla/csrc/linalg.h"
 #include "torch_xla/csrc/lowering_context.h"
 
 namespace torch_xla {
@@ -13,16 +11,6 @@ namespace ir {
 namespace ops {
 namespace {
 
-std::vector<xla::XlaOp> LowerQR(const xla::XlaOp& input, bool some) {
-  xla::QRDecompositionResult qr_result =
-      xla::QRDecomposition(input, /*full_matrices=*/!some,
-                           /*block_size=*/128, XlaHelpers::mat_mul_precision())
-          .ValueOrDie();
-  xla::XlaOp q = qr_result.q;
-  xla::XlaOp r = qr_result.r;
-  return {q, r};
-}
-
 xla::Shape NodeOutputShape(const Value& input, bool some) {
   const xla::Shape& input_shape = input.shape();
   XLA_CHECK_GE(input_shape.rank(), 2) << input_shape;
@@ -58,7 +46,7 @@ NodePtr QR::Clone(OpList operands) const {
 
 XlaOpVector QR::Lower(LoweringContext* loctx) const {
   xla::XlaOp input = loctx->GetOutputOp(operand(0));
-  return ReturnOps(LowerQR(input, some_), loctx);
+  return ReturnOps(BuildQR(input, /*full_matrices=*/!some_), loctx);
 }
 
 std::string QR::ToString() const {
@@ -0,0 +1,114 @@
+#include "torch_xla/csrc/ops/quantized_convolution.h"
+
+#include "absl/strings/str_join.h"
+#include "tensorflow/compiler/xla/xla_client/debug_macros.h"
+#include "tensorflow/compiler/xla/xla_client/util.h"
+#include "torch_xla/csrc/lowering_context.h"
+#include "torch_xla/csrc/ops/infer_output_shape.h"
+#include "torch_xla/csrc/ops/xla_ops.h"
+#include "torch_xla/csrc/quantization.h"
+
+namespace torch_xla {
+namespace ir {
+namespace ops {
+namespace {
+
+// The bias doesn't matter for shape inference.
+xla::Shape NodeOutputShape(
+    const Value& input, const Value& weight, const Value& weight_scales,
+    double input_scale, tensorflow::gtl::ArraySlice<const xla::int64> stride,
+    tensorflow::gtl::ArraySlice<const xla::int64> padding,
+    tensorflow::gtl::ArraySlice<const xla::int64> dilation,
+    xla::int64 groups) {
+  auto lower_for_shape_fn =
+      [&](tensorflow::gtl::ArraySlice<const xla::XlaOp> operands)
+      -> xla::XlaOp {
+    return BuildQuantizedConvolution(operands[0], operands[1], operands[2],
+                                     /*bias=*/nullptr, input_scale, stride,
+                                     padding, dilation, groups);
+  };
+  return InferOutputShape(
+      {input.shape(), weight.shape(), weight_scales.shape()},
+      lower_for_shape_fn);
+}
+
+}  // namespace
+
+QuantizedConvolution::QuantizedConvolution(
+    const Value& input, const Value& weight, const Value& weight_scales,
+    const Value& bias, double input_scale, std::vector<xla::int64> stride,
+    std::vector<xla::int64> padding, std::vector<xla::int64> dilation,
+    xla::int64 groups)
+    : Node(xla_quantized_convolution, {input, weight, weight_scales, bias},
+           [&]() {
+             return NodeOutputShape(input, weight, weight_scales, input_scale,
+                                    stride, padding, dilation, groups);
+           },
+           /*num_outputs=*/1,
+           xla::util::MHash(input_scale, stride, padding, dilation, groups)),
+      input_scale_(input_scale),
+      stride_(std::move(stride)),
+      padding_(std::move(padding)),
+      dilation_(std::move(dilation)),
+      groups_(groups) {}
+
+QuantizedConvolution::QuantizedConvolution(
+    const Value& input, const Value& weight, const Value& weight_scales,
+    double input_scale, std::vector<xla::int64> stride,
+    std::vector<xla::int64> padding, std::vector<xla::int64> dilation,
+    xla::int64 groups)
+    : Node(xla_quantized_convolution, {input, weight, weight_scales},
+           [&]() {
+             return NodeOutputShape(input, weight, weight_scales, input_scale,
+                                    stride, padding, dilation, groups);
+           },
+           /*num_outputs=*/1,
+           xla::util::MHash(input_scale, stride, padding, dilation, groups)),
+      input_scale_(input_scale),
+      stride_(std::move(stride)),
+      padding_(std::move(padding)),
+      dilation_(std::move(dilation)),
+      groups_(groups) {}
+
+NodePtr QuantizedConvolution::Clone(OpList operands) const {
+  return operands.size() == 4
+             ? MakeNode<QuantizedConvolution>(
+                   operands.at(0), operands.at(1), operands.at(2),
+                   operands.at(3), input_scale_, stride_, padding_, dilation_,
+                   groups_)
+             : MakeNode<QuantizedConvolution>(
+                   operands.at(0), operands.at(1), operands.at(2),
+                   input_scale_, stride_, padding_, dilation_, groups_);
+}
+
+XlaOpVector QuantizedConvolution::Lower(LoweringContext* loctx) const {
+  xla::XlaOp input = loctx->GetOutputOp(operand(0));
+  xla::XlaOp weight = loctx->GetOutputOp(operand(1));
+  xla::XlaOp weight_scales = loctx->GetOutputOp(operand(2));
+  xla::XlaOp output;
+  if (operands().size() == 4) {
+    xla::XlaOp bias = loctx->GetOutputOp(operand(3));
+    output = BuildQuantizedConvolution(input, weight, weight_scales, &bias,
+                                       input_scale_, stride_, padding_,
+                                       dilation_, groups_);
+  } else {
+    XLA_CHECK_EQ(operands().size(), 3);
+    output = BuildQuantizedConvolution(input, weight, weight_scales,
+                                       /*bias=*/nullptr, input_scale_,
+                                       stride_, padding_, dilation_, groups_);
+  }
+  return ReturnOp(output, loctx);
+}
+
+std::string QuantizedConvolution::ToString() const {
+  std::stringstream ss;
+  ss << Node::ToString() << ", input_scale=" << input_scale_ << ", stride=["
+     << absl::StrJoin(stride_, ", ") << "], padding=["
+     << absl::StrJoin(padding_, ", ") << "], dilation=["
+     << absl::StrJoin(dilation_, ", ") << "], groups=" << groups_;
+  return ss.str();
+}
+
+}  // namespace ops
+}  // namespace ir
+}  // namespace torch_xla
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "torch_xla/csrc/ir.h"
+
+namespace torch_xla {
+namespace ir {
+namespace ops {
+
+// IR node for 2D & 3D convolutions with an int8 weight, with or without bias
+// (see BuildQuantizedConvolution()).
+class QuantizedConvolution : public Node {
+ public:
+  QuantizedConvolution(const Value& input, const Value& weight,
+                       const Value& weight_scales, const Value& bias,
+                       double input_scale, std::vector<xla::int64> stride,
+                       std::vector<xla::int64> padding,
+                       std::vector<xla::int64> dilation, xla::int64 groups);
+
+  QuantizedConvolution(const Value& input, const Value& weight,
+                       const Value& weight_scales, double input_scale,
+                       std::vector<xla::int64> stride,
+                       std::vector<xla::int64> padding,
+                       std::vector<xla::int64> dilation, xla::int64 groups);
+
+  NodePtr Clone(OpList operands) const override;
+
+  XlaOpVector Lower(LoweringContext* loctx) const override;
+
+  std::string ToString() const override;
+
+  double input_scale() const { return input_scale_; }
+
+  const std::vector<xla::int64>& stride() const { return stride_; }
+
+  const std::vector<xla::int64>& padding() const { return padding_; }
+
+  const std::vector<xla::int64>& dilation() const { return dilation_; }
+
+  xla::int64 groups() const { return groups_; }
+
+ private:
+  double input_scale_;
+  std::vector<xla::int64> stride_;
+  std::vector<xla::int64> padding_;
+  std::vector<xla::int64> dilation_;
+  xla::int64 groups_;
+};
+
+}  // namespace ops
+}  // namespace ir
+}  // namespace torch_xla
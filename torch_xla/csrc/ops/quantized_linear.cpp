@@ -0,0 +1,85 @@
+#include "torch_xla/csrc/ops/quantized_linear.h"
+
+#include "tensorflow/compiler/xla/xla_client/debug_macros.h"
+#include "tensorflow/compiler/xla/xla_client/util.h"
+#include "torch_xla/csrc/lowering_context.h"
+#include "torch_xla/csrc/ops/infer_output_shape.h"
+#include "torch_xla/csrc/ops/xla_ops.h"
+#include "torch_xla/csrc/quantization.h"
+
+namespace torch_xla {
+namespace ir {
+namespace ops {
+namespace {
+
+// The bias doesn't matter for shape inference.
+xla::Shape NodeOutputShape(const Value& input, const Value& weight,
+                           const Value& weight_scales, double input_scale) {
+  auto lower_for_shape_fn =
+      [&](tensorflow::gtl::ArraySlice<const xla::XlaOp> operands)
+      -> xla::XlaOp {
+    return BuildQuantizedLinear(operands[0], operands[1], operands[2],
+                                /*bias=*/nullptr, input_scale);
+  };
+  return InferOutputShape(
+      {input.shape(), weight.shape(), weight_scales.shape()},
+      lower_for_shape_fn);
+}
+
+}  // namespace
+
+QuantizedLinear::QuantizedLinear(const Value& input, const Value& weight,
+                                 const Value& weight_scales, const Value& bias,
+                                 double input_scale)
+    : Node(xla_quantized_linear, {input, weight, weight_scales, bias},
+           [&]() {
+             return NodeOutputShape(input, weight, weight_scales, input_scale);
+           },
+           /*num_outputs=*/1, xla::util::MHash(input_scale)),
+      input_scale_(input_scale) {}
+
+QuantizedLinear::QuantizedLinear(const Value& input, const Value& weight,
+                                 const Value& weight_scales,
+                                 double input_scale)
+    : Node(xla_quantized_linear, {input, weight, weight_scales},
+           [&]() {
+             return NodeOutputShape(input, weight, weight_scales, input_scale);
+           },
+           /*num_outputs=*/1, xla::util::MHash(input_scale)),
+      input_scale_(input_scale) {}
+
+NodePtr QuantizedLinear::Clone(OpList operands) const {
+  return operands.size() == 4
+             ? MakeNode<QuantizedLinear>(operands.at(0), operands.at(1),
+                                         operands.at(2), operands.at(3),
+                                         input_scale_)
+             : MakeNode<QuantizedLinear>(operands.at(0), operands.at(1),
+                                         operands.at(2), input_scale_);
+}
+
+XlaOpVector QuantizedLinear::Lower(LoweringContext* loctx) const {
+  xla::XlaOp input = loctx->GetOutputOp(operand(0));
+  xla::XlaOp weight = loctx->GetOutputOp(operand(1));
+  xla::XlaOp weight_scales = loctx->GetOutputOp(operand(2));
+  xla::XlaOp output;
+  if (operands().size() == 4) {
+    xla::XlaOp bias = loctx->GetOutputOp(operand(3));
+    output = BuildQuantizedLinear(input, weight, weight_scales, &bias,
+                                  input_scale_);
+  } else {
+    XLA_CHECK_EQ(operands().size(), 3);
+    output = BuildQuantizedLinear(input, weight, weight_scales,
+                                  /*bias=*/nullptr, input_scale_);
+  }
+  return ReturnOp(output, loctx);
+}
+
+std::string QuantizedLinear::ToString() const {
+  std::stringstream ss;
+  ss << Node::ToString() << ", input_scale=" << input_scale_;
+  return ss.str();
+}
+
+}  // namespace ops
+}  // namespace ir
+}  // namespace torch_xla
@@ -0,0 +1,34 @@
+#pragma once
+
+#include "torch_xla/csrc/ir.h"
+
+namespace torch_xla {
+namespace ir {
+namespace ops {
+
+// IR node for the linear layer with an int8 weight, with or without bias (see
+// BuildQuantizedLinear()).
+class QuantizedLinear : public Node {
+ public:
+  QuantizedLinear(const Value& input, const Value& weight,
+                  const Value& weight_scales, const Value& bias,
+                  double input_scale);
+
+  QuantizedLinear(const Value& input, const Value& weight,
+                  const Value& weight_scales, double input_scale);
+
+  NodePtr Clone(OpList operands) const override;
+
+  XlaOpVector Lower(LoweringContext* loctx) const override;
+
+  std::string ToString() const override;
+
+  double input_scale() const { return input_scale_; }
+
+ private:
+  double input_scale_;
+};
+
+}  // namespace ops
+}  // namespace ir
+}  // namespace torch_xla
@@ -8,8 +8,9 @@ namespace torch_xla {
 namespace ir {
 namespace ops {
 
-Randperm::Randperm(xla::int64 upper_bound, xla::PrimitiveType element_type)
-    : Node(ir::OpKind(at::aten::randperm), {},
+Randperm::Randperm(const Value& seed, xla::int64 upper_bound,
+                   xla::PrimitiveType element_type)
+    : Node(ir::OpKind(at::aten::randperm), {seed},
            xla::ShapeUtil::MakeShape(element_type, {upper_bound}),
            /*num_outputs=*/1,
            xla::util::MHash(upper_bound, static_cast<int>(element_type))),
@@ -17,12 +18,12 @@ Randperm::Randperm(xla::int64 upper_bound, xla::PrimitiveType element_type)
       element_type_(element_type) {}
 
 NodePtr Randperm::Clone(OpList operands) const {
-  return MakeNode<Randperm>(upper_bound_, element_type_);
+  return MakeNode<Randperm>(operands.at(0), upper_bound_, element_type_);
 }
 
 XlaOpVector Randperm::Lower(LoweringContext* loctx) const {
-  return ReturnOp(BuildRandperm(upper_bound_, element_type_, loctx->builder()),
-                  loctx);
+  xla::XlaOp seed = loctx->GetOutputOp(operand(0));
+  return ReturnOp(BuildRandperm(upper_bound_, element_type_, seed), loctx);
 }
 
 std::string Randperm::ToString() const {
@@ -8,7 +8,8 @@ namespace ops {
 
 class Randperm : public Node {
  public:
-  Randperm(xla::int64 upper_bound, xla::PrimitiveType element_type);
+  Randperm(const Value& seed, xla::int64 upper_bound,
+           xla::PrimitiveType element_type);
 
   std::string ToString() const override;
 
@@ -0,0 +1,67 @@
+#include "torch_xla/csrc/ops/reduce_scatter.h"
+
+#include "absl/strings/str_join.h"
+#include "tensorflow/compiler/xla/xla_client/util.h"
+#include "torch_xla/csrc/cross_replica_reduces.h"
+#include "torch_xla/csrc/lowering_context.h"
+#include "torch_xla/csrc/ops/infer_output_shape.h"
+#include "torch_xla/csrc/ops/xla_ops.h"
+
+namespace torch_xla {
+namespace ir {
+namespace ops {
+namespace {
+
+xla::Shape NodeOutputShape(const Value& input, double scale, xla::int64 dim,
+                           xla::int64 shard_count,
+                           const std::vector<std::vector<xla::int64>>& groups) {
+  auto lower_for_shape_fn =
+      [&](tensorflow::gtl::ArraySlice<const xla::XlaOp> operands)
+      -> xla::XlaOp {
+    return BuildReduceScatter(operands[0], scale, dim, shard_count, groups);
+  };
+  return InferOutputShape({input.shape()}, lower_for_shape_fn);
+}
+
+}  // namespace
+
+ReduceScatter::ReduceScatter(const Value& input, double scale, xla::int64 dim,
+                             xla::int64 shard_count,
+                             std::vector<std::vector<xla::int64>> groups)
+    : Node(xla_reduce_scatter, {input},
+           [&]() {
+             return NodeOutputShape(input, scale, dim, shard_count, groups);
+           },
+           /*num_outputs=*/1,
+           xla::util::MHash(scale, dim, shard_count, groups)),
+      scale_(scale),
+      dim_(dim),
+      shard_count_(shard_count),
+      groups_(std::move(groups)) {}
+
+std::string ReduceScatter::ToString() const {
+  std::stringstream ss;
+  ss << Node::ToString() << ", scale=" << scale_ << ", dim=" << dim_
+     << ", shard_count=" << shard_count_ << ", groups=(";
+  for (size_t i = 0; i < groups_.size(); ++i) {
+    ss << (i == 0 ? "(" : ",(");
+    ss << absl::StrJoin(groups_[i], ", ") << ")";
+  }
+  ss << ")";
+  return ss.str();
+}
+
+NodePtr ReduceScatter::Clone(OpList operands) const {
+  return MakeNode<ReduceScatter>(operands.at(0), scale_, dim_, shard_count_,
+                                 groups_);
+}
+
+XlaOpVector ReduceScatter::Lower(LoweringContext* loctx) const {
+  xla::XlaOp input = loctx->GetOutputOp(operand(0));
+  return ReturnOp(
+      BuildReduceScatter(input, scale_, dim_, shard_count_, groups_), loctx);
+}
+
+}  // namespace ops
+}  // namespace ir
+}  // namespace torch_xla
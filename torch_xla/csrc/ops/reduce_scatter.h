@@ -0,0 +1,41 @@
+#pragma once
+
+#include "torch_xla/csrc/ir.h"
+
+namespace torch_xla {
+namespace ir {
+namespace ops {
+
+// Sums the inputs across the shard_count replicas of every group, scaled by
+// scale, and keeps the slice along dim matching the replica index within the
+// group.
+class ReduceScatter : public Node {
+ public:
+  ReduceScatter(const Value& input, double scale, xla::int64 dim,
+                xla::int64 shard_count,
+                std::vector<std::vector<xla::int64>> groups);
+
+  std::string ToString() const override;
+
+  NodePtr Clone(OpList operands) const override;
+
+  XlaOpVector Lower(LoweringContext* loctx) const override;
+
+  double scale() const { return scale_; }
+
+  xla::int64 dim() const { return dim_; }
+
+  xla::int64 shard_count() const { return shard_count_; }
+
+  const std::vector<std::vector<xla::int64>>& groups() const { return groups_; }
+
+ private:
+  double scale_;
+  xla::int64 dim_;
+  xla::int64 shard_count_;
+  std::vector<std::vector<xla::int64>> groups_;
+};
+
+}  // namespace ops
+}  // namespace ir
+}  // namespace torch_xla
@@ -9,9 +9,10 @@ namespace torch_xla {
 namespace ir {
 namespace ops {
 
-RreluWithNoise::RreluWithNoise(const Value& input, at::Scalar lower,
-                               at::Scalar upper, bool training)
-    : Node(ir::OpKind(at::aten::rrelu_with_noise), {input},
+RreluWithNoise::RreluWithNoise(const Value& input, const Value& seed,
+                               at::Scalar lower, at::Scalar upper,
+                               bool training)
+    : Node(ir::OpKind(at::aten::rrelu_with_noise), {input, seed},
            xla::ShapeUtil::MakeTupleShape({input.shape(), input.shape()}),
            /*num_outputs=*/2,
            xla::util::MHash(ScalarHash(lower), ScalarHash(upper), training)),
@@ -20,12 +21,14 @@ RreluWithNoise::RreluWithNoise(const Value& input, at::Scalar lower,
       training_(training) {}
 
 NodePtr RreluWithNoise::Clone(OpList operands) const {
-  return MakeNode<RreluWithNoise>(operands.at(0), lower_, upper_, training_);
+  return MakeNode<RreluWithNoise>(operands.at(0), operands.at(1), lower_,
+                                  upper_, training_);
 }
 
 XlaOpVector RreluWithNoise::Lower(LoweringContext* loctx) const {
   xla::XlaOp input = loctx->GetOutputOp(operand(0));
-  return ReturnOps(BuildRrelu(input, lower_, upper_, training_), loctx);
+  xla::XlaOp seed = loctx->GetOutputOp(operand(1));
+  return ReturnOps(BuildRrelu(input, lower_, upper_, training_, seed), loctx);
 }
 
 std::string RreluWithNoise::ToString() const {
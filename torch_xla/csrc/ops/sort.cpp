@@ -0,0 +1,60 @@
+#include "torch_xla/csrc/ops/sort.h"
+
+#include "tensorflow/compiler/xla/xla_client/util.h"
+#include "torch_xla/csrc/lowering_context.h"
+#include "torch_xla/csrc/ops/infer_output_shape.h"
+#include "torch_xla/csrc/xla_lower_util.h"
+
+namespace torch_xla {
+namespace ir {
+namespace ops {
+namespace {
+
+xla::Shape NodeOutputShape(tensorflow::gtl::ArraySlice<const ir::Value> keys,
+                           xla::int64 dim, bool descending, bool stable) {
+  auto lower_for_shape_fn =
+      [&](tensorflow::gtl::ArraySlice<const xla::XlaOp> operands)
+      -> xla::XlaOp {
+    return xla::Tuple(operands[0].builder(),
+                      CreateSort(operands, dim, descending, stable));
+  };
+  std::vector<xla::Shape> shapes;
+  for (auto& key : keys) {
+    shapes.push_back(key.shape());
+  }
+  return InferOutputShape(shapes, lower_for_shape_fn);
+}
+
+}  // namespace
+
+Sort::Sort(tensorflow::gtl::ArraySlice<const ir::Value> keys, xla::int64 dim,
+           bool descending, bool stable)
+    : Node(ir::OpKind(at::aten::sort), keys,
+           [&]() { return NodeOutputShape(keys, dim, descending, stable); },
+           /*num_outputs=*/2, xla::util::MHash(dim, descending, stable)),
+      dim_(dim),
+      descending_(descending),
+      stable_(stable) {}
+
+NodePtr Sort::Clone(OpList operands) const {
+  return MakeNode<Sort>(operands, dim_, descending_, stable_);
+}
+
+XlaOpVector Sort::Lower(LoweringContext* loctx) const {
+  std::vector<xla::XlaOp> keys;
+  for (auto& operand : operands()) {
+    keys.push_back(loctx->GetOutputOp(operand));
+  }
+  return ReturnOps(CreateSort(keys, dim_, descending_, stable_), loctx);
+}
+
+std::string Sort::ToString() const {
+  std::stringstream ss;
+  ss << Node::ToString() << ", dim=" << dim_ << ", descending=" << descending_
+     << ", stable=" << stable_;
+  return ss.str();
+}
+
+}  // namespace ops
+}  // namespace ir
+}  // namespace torch_xla
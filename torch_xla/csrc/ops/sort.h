@@ -0,0 +1,36 @@
+#pragma once
+
+#include "torch_xla/csrc/ir.h"
+
+namespace torch_xla {
+namespace ir {
+namespace ops {
+
+// Sorts the keys lexicographically along dim, and returns the sorted first key
+// and the positions of the sorted elements.
+class Sort : public Node {
+ public:
+  Sort(tensorflow::gtl::ArraySlice<const ir::Value> keys, xla::int64 dim,
+       bool descending, bool stable);
+
+  std::string ToString() const override;
+
+  NodePtr Clone(OpList operands) const override;
+
+  XlaOpVector Lower(LoweringContext* loctx) const override;
+
+  xla::int64 dim() const { return dim_; }
+
+  bool descending() const { return descending_; }
+
+  bool stable() const { return stable_; }
+
+ private:
+  xla::int64 dim_;
+  bool descending_;
+  bool stable_;
+};
+
+}  // namespace ops
+}  // namespace ir
+}  // namespace torch_xla
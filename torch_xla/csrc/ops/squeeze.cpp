@@ -1,10 +1,10 @@
 #include "torch_xla/csrc/ops/squeeze.h"
 
+#include "tensorflow/compiler/xla/shape_util.h"
 #include "tensorflow/compiler/xla/xla_client/debug_macros.h"
 #include "tensorflow/compiler/xla/xla_client/util.h"
 #include "torch_xla/csrc/data_ops.h"
 #include "torch_xla/csrc/lowering_context.h"
-#include "torch_xla/csrc/ops/infer_output_shape.h"
 
 namespace torch_xla {
 namespace ir {
@@ -20,13 +20,23 @@ xla::XlaOp LowerSqueeze(const xla::XlaOp& input, int dim) {
 }
 
 xla::Shape NodeOutputShape(const Value& input, int dim) {
-  auto lower_for_shape_fn =
-      [dim](tensorflow::gtl::ArraySlice<const xla::XlaOp> operands)
-      -> xla::XlaOp {
-    XLA_CHECK_EQ(operands.size(), 1);
-    return LowerSqueeze(operands[0], dim);
-  };
-  return InferOutputShape({input.shape()}, lower_for_shape_fn);
+  const xla::Shape& input_shape = input.shape();
+  std::vector<xla::int64> output_sizes;
+  if (dim == -1) {
+    for (auto dim_size : input_shape.dimensions()) {
+      if (dim_size != 1) {
+        output_sizes.push_back(dim_size);
+      }
+    }
+  } else {
+    XLA_CHECK_GE(dim, 0);
+    XLA_CHECK_LT(dim, input_shape.rank());
+    output_sizes = xla::util::ToVector<xla::int64>(input_shape.dimensions());
+    if (output_sizes[dim] == 1) {
+      output_sizes.erase(output_sizes.begin() + dim);
+    }
+  }
+  return xla::ShapeUtil::MakeShape(input_shape.element_type(), output_sizes);
 }
 
 }  // namespace
@@ -1,10 +1,11 @@
 #include "torch_xla/csrc/ops/stack.h"
 
+#include "tensorflow/compiler/xla/shape_util.h"
+#include "tensorflow/compiler/xla/xla_client/debug_macros.h"
 #include "tensorflow/compiler/xla/xla_client/util.h"
 #include "torch_xla/csrc/data_ops.h"
 #include "torch_xla/csrc/helpers.h"
 #include "torch_xla/csrc/lowering_context.h"
-#include "torch_xla/csrc/ops/infer_output_shape.h"
 
 namespace torch_xla {
 namespace ir {
@@ -13,15 +14,13 @@ namespace {
 
 xla::Shape NodeOutputShape(tensorflow::gtl::ArraySlice<const ir::Value> values,
                            xla::int64 dim) {
-  auto lower_for_shape_fn =
-      [&](tensorflow::gtl::ArraySlice<const xla::XlaOp> operands)
-      -> xla::XlaOp { return BuildStack(operands, dim); };
-  std::vector<xla::Shape> shapes;
-  shapes.reserve(values.size());
-  for (auto& value : values) {
-    shapes.push_back(value.shape());
-  }
-  return InferOutputShape(shapes, lower_for_shape_fn);
+  XLA_CHECK_GT(values.size(), 0);
+  const xla::Shape& shape = values[0].shape();
+  XLA_CHECK_LE(dim, shape.rank());
+  std::vector<xla::int64> output_sizes =
+      xla::util::ToVector<xla::int64>(shape.dimensions());
+  output_sizes.insert(output_sizes.begin() + dim, values.size());
+  return xla::ShapeUtil::MakeShape(shape.element_type(), output_sizes);
 }
 
 }  // namespace
@@ -5,7 +5,6 @@
 #include "torch_xla/csrc/convert_ops.h"
 #include "torch_xla/csrc/helpers.h"
 #include "torch_xla/csrc/lowering_context.h"
-#include "torch_xla/csrc/ops/infer_output_shape.h"
 #include "torch_xla/csrc/reduction.h"
 #include "torch_xla/csrc/tensor_util.h"
 #include "torch_xla/csrc/torch_util.h"
@@ -27,12 +26,9 @@ xla::Shape NodeOutputShape(
     const Value& input,
     tensorflow::gtl::ArraySlice<const xla::int64> dimensions,
     bool keep_reduced_dimensions, c10::optional<at::ScalarType> dtype) {
-  auto lower_for_shape_fn =
-      [&](tensorflow::gtl::ArraySlice<const xla::XlaOp> operands)
-      -> xla::XlaOp {
-    return LowerSum(operands[0], dimensions, keep_reduced_dimensions, dtype);
-  };
-  return InferOutputShape({input.shape()}, lower_for_shape_fn);
+  xla::Shape shape = input.shape();
+  shape.set_element_type(GetCastToScalarType(shape.element_type(), dtype));
+  return GetReductionShape(shape, dimensions, keep_reduced_dimensions);
 }
 
 }  // namespace
@@ -17,9 +17,9 @@ class TopK : public Node {
 
   XlaOpVector Lower(LoweringContext* loctx) const override;
 
-  xla::int64 k() const { return k_; };
+  xla::int64 k() const { return k_; }
 
-  xla::int64 dim() const { return dim_; };
+  xla::int64 dim() const { return dim_; }
 
   bool largest() const { return largest_; }
 
@@ -4,6 +4,7 @@
 #include "tensorflow/compiler/xla/layout_util.h"
 #include "tensorflow/compiler/xla/xla_client/util.h"
 #include "torch_xla/csrc/helpers.h"
+#include "torch_xla/csrc/linalg.h"
 #include "torch_xla/csrc/lowering_context.h"
 
 namespace torch_xla {
@@ -59,10 +60,9 @@ std::vector<xla::XlaOp> LowerTriangularSolve(const xla::XlaOp& rhs,
   xla::XlaOp lhs_broadcasted =
       XlaHelpers::ImplicitBroadcast(lhs, lhs_shape, broadcasted_shapes.second);
 
-  xla::XlaOp solution = xla::TriangularSolve(
-      lhs_broadcasted, rhs_broadcasted, left_side, lower, unit_diagonal,
-      transpose ? xla::TriangularSolveOptions::TRANSPOSE
-                : xla::TriangularSolveOptions::NO_TRANSPOSE);
+  xla::XlaOp solution =
+      BuildTriangularSolve(lhs_broadcasted, rhs_broadcasted, left_side, lower,
+                           unit_diagonal, transpose);
   return {solution, lhs_broadcasted};
 }
 
@@ -0,0 +1,58 @@
+#include "torch_xla/csrc/ops/upsample_bilinear2d.h"
+
+#include "absl/strings/str_join.h"
+#include "tensorflow/compiler/xla/shape_util.h"
+#include "tensorflow/compiler/xla/xla_client/util.h"
+#include "torch_xla/csrc/lowering_context.h"
+#include "torch_xla/csrc/upsample.h"
+
+namespace torch_xla {
+namespace ir {
+namespace ops {
+namespace {
+
+xla::Shape NodeOutputShape(
+    const Value& input,
+    tensorflow::gtl::ArraySlice<const xla::int64> output_size) {
+  xla::Shape shape = input.shape();
+  xla::int64 dim_offset = shape.rank() - output_size.size();
+  for (size_t i = 0; i < output_size.size(); ++i) {
+    shape.set_dimensions(dim_offset + i, output_size[i]);
+  }
+  return shape;
+}
+
+}  // namespace
+
+UpsampleBilinear::UpsampleBilinear(const Value& input,
+                                   std::vector<xla::int64> output_size,
+                                   bool align_corners)
+    : Node(ir::OpKind(at::aten::upsample_bilinear2d), {input},
+           [&]() { return NodeOutputShape(input, output_size); },
+           /*num_outputs=*/1, xla::util::MHash(output_size, align_corners)),
+      output_size_(std::move(output_size)),
+      align_corners_(align_corners) {}
+
+NodePtr UpsampleBilinear::Clone(OpList operands) const {
+  return MakeNode<UpsampleBilinear>(operands.at(0), output_size_,
+                                    align_corners_);
+}
+
+XlaOpVector UpsampleBilinear::Lower(LoweringContext* loctx) const {
+  xla::XlaOp input = loctx->GetOutputOp(operand(0));
+  xla::XlaOp output =
+      BuildUpsampleBilinear(input, output_size_, align_corners_);
+  return ReturnOp(output, loctx);
+}
+
+std::string UpsampleBilinear::ToString() const {
+  std::stringstream ss;
+  ss << Node::ToString() << ", output_size=["
+     << absl::StrJoin(output_size_, ", ")
+     << "], align_corners=" << align_corners_;
+  return ss.str();
+}
+
+}  // namespace ops
+}  // namespace ir
+}  // namespace torch_xla
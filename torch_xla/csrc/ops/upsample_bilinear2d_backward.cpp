@@ -0,0 +1,45 @@
+#include "torch_xla/csrc/ops/upsample_bilinear2d_backward.h"
+
+#include "absl/strings/str_join.h"
+#include "tensorflow/compiler/xla/shape_util.h"
+#include "tensorflow/compiler/xla/xla_client/util.h"
+#include "torch_xla/csrc/lowering_context.h"
+#include "torch_xla/csrc/upsample.h"
+
+namespace torch_xla {
+namespace ir {
+namespace ops {
+
+UpsampleBilinearBackward::UpsampleBilinearBackward(
+    const Value& grad_output, std::vector<xla::int64> input_size,
+    bool align_corners)
+    : Node(ir::OpKind(at::aten::upsample_bilinear2d_backward), {grad_output},
+           xla::ShapeUtil::MakeShape(grad_output.shape().element_type(),
+                                     input_size),
+           /*num_outputs=*/1, xla::util::MHash(input_size, align_corners)),
+      input_size_(std::move(input_size)),
+      align_corners_(align_corners) {}
+
+NodePtr UpsampleBilinearBackward::Clone(OpList operands) const {
+  return MakeNode<UpsampleBilinearBackward>(operands.at(0), input_size_,
+                                            align_corners_);
+}
+
+XlaOpVector UpsampleBilinearBackward::Lower(LoweringContext* loctx) const {
+  xla::XlaOp grad_output = loctx->GetOutputOp(operand(0));
+  xla::XlaOp output =
+      BuildUpsampleBilinearBackward(grad_output, input_size_, align_corners_);
+  return ReturnOp(output, loctx);
+}
+
+std::string UpsampleBilinearBackward::ToString() const {
+  std::stringstream ss;
+  ss << Node::ToString() << ", input_size=["
+     << absl::StrJoin(input_size_, ", ")
+     << "], align_corners=" << align_corners_;
+  return ss.str();
+}
+
+}  // namespace ops
+}  // namespace ir
+}  // namespace torch_xla
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <vector>
+
+#include "torch_xla/csrc/ir.h"
+
+namespace torch_xla {
+namespace ir {
+namespace ops {
+
+class UpsampleBilinearBackward : public Node {
+ public:
+  UpsampleBilinearBackward(const Value& grad_output,
+                           std::vector<xla::int64> input_size,
+                           bool align_corners);
+
+  NodePtr Clone(OpList operands) const override;
+
+  XlaOpVector Lower(LoweringContext* loctx) const override;
+
+  std::string ToString() const override;
+
+  const std::vector<xla::int64>& input_size() const { return input_size_; }
+
+  bool align_corners() const { return align_corners_; }
+
+ private:
+  std::vector<xla::int64> input_size_;
+  bool align_corners_;
+};
+
+}  // namespace ops
+}  // namespace ir
+}  // namespace torch_xla
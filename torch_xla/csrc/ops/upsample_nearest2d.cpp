@@ -0,0 +1,53 @@
+#include "torch_xla/csrc/ops/upsample_nearest2d.h"
+
+#include "absl/strings/str_join.h"
+#include "tensorflow/compiler/xla/shape_util.h"
+#include "tensorflow/compiler/xla/xla_client/util.h"
+#include "torch_xla/csrc/lowering_context.h"
+#include "torch_xla/csrc/upsample.h"
+
+namespace torch_xla {
+namespace ir {
+namespace ops {
+namespace {
+
+xla::Shape NodeOutputShape(
+    const Value& input,
+    tensorflow::gtl::ArraySlice<const xla::int64> output_size) {
+  xla::Shape shape = input.shape();
+  xla::int64 dim_offset = shape.rank() - output_size.size();
+  for (size_t i = 0; i < output_size.size(); ++i) {
+    shape.set_dimensions(dim_offset + i, output_size[i]);
+  }
+  return shape;
+}
+
+}  // namespace
+
+UpsampleNearest::UpsampleNearest(const Value& input,
+                                 std::vector<xla::int64> output_size)
+    : Node(ir::OpKind(at::aten::upsample_nearest2d), {input},
+           [&]() { return NodeOutputShape(input, output_size); },
+           /*num_outputs=*/1, xla::util::MHash(output_size)),
+      output_size_(std::move(output_size)) {}
+
+NodePtr UpsampleNearest::Clone(OpList operands) const {
+  return MakeNode<UpsampleNearest>(operands.at(0), output_size_);
+}
+
+XlaOpVector UpsampleNearest::Lower(LoweringContext* loctx) const {
+  xla::XlaOp input = loctx->GetOutputOp(operand(0));
+  xla::XlaOp output = BuildUpsampleNearest(input, output_size_);
+  return ReturnOp(output, loctx);
+}
+
+std::string UpsampleNearest::ToString() const {
+  std::stringstream ss;
+  ss << Node::ToString() << ", output_size=["
+     << absl::StrJoin(output_size_, ", ") << "]";
+  return ss.str();
+}
+
+}  // namespace ops
+}  // namespace ir
+}  // namespace torch_xla
@@ -1,16 +1,16 @@
 #pragma once
 
-#include "tensorflow/compiler/xla/xla_data.pb.h"
-#include "tensorflow/core/lib/gtl/array_slice.h"
+#include <vector>
+
 #include "torch_xla/csrc/ir.h"
 
 namespace torch_xla {
 namespace ir {
 namespace ops {
 
-class AdaptiveAvgPool2d : public Node {
+class UpsampleNearest : public Node {
  public:
-  AdaptiveAvgPool2d(const Value& input, std::vector<xla::int64> output_size);
+  UpsampleNearest(const Value& input, std::vector<xla::int64> output_size);
 
   NodePtr Clone(OpList operands) const override;
 
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <vector>
+
+#include "torch_xla/csrc/ir.h"
+
+namespace torch_xla {
+namespace ir {
+namespace ops {
+
+class UpsampleNearestBackward : public Node {
+ public:
+  UpsampleNearestBackward(const Value& grad_output,
+                          std::vector<xla::int64> input_size);
+
+  NodePtr Clone(OpList operands) const override;
+
+  XlaOpVector Lower(LoweringContext* loctx) const override;
+
+  std::string ToString() const override;
+
+  const std::vector<xla::int64>& input_size() const { return input_size_; }
+
+ private:
+  std::vector<xla::int64> input_size_;
+};
+
+}  // namespace ops
+}  // namespace ir
+}  // namespace torch_xla
@@ -1,11 +1,11 @@
 #include "torch_xla/csrc/ops/view.h"
 
 #include "absl/strings/str_join.h"
+#include "tensorflow/compiler/xla/shape_util.h"
 #include "tensorflow/compiler/xla/xla_client/debug_macros.h"
 #include "tensorflow/compiler/xla/xla_client/util.h"
 #include "torch_xla/csrc/data_ops.h"
 #include "torch_xla/csrc/lowering_context.h"
-#include "torch_xla/csrc/ops/infer_output_shape.h"
 
 namespace torch_xla {
 namespace ir {
@@ -15,14 +15,10 @@ namespace {
 xla::Shape NodeOutputShape(
     const Value& input,
     tensorflow::gtl::ArraySlice<const xla::int64> output_sizes) {
-  auto lower_for_shape_fn =
-      [&output_sizes](tensorflow::gtl::ArraySlice<const xla::XlaOp> operands)
-      -> xla::XlaOp {
-    XLA_CHECK_EQ(operands.size(), 1)
-        << "Unexpected number of operands: " << operands.size();
-    return BuildView(operands[0], output_sizes);
-  };
-  return InferOutputShape({input.shape()}, lower_for_shape_fn);
+  const xla::Shape& input_shape = input.shape();
+  return xla::ShapeUtil::MakeShape(
+      input_shape.element_type(),
+      GetCompleteShape(output_sizes, input_shape.dimensions()));
 }
 
 }  // namespace
@@ -33,6 +29,10 @@ View::View(const Value& input, std::vector<xla::int64> output_size)
            /*num_outputs=*/1, xla::util::MHash(output_size)),
       output_size_(std::move(output_size)) {}
 
+NodePtr View::Clone(OpList operands) const {
+  return MakeNode<View>(operands.at(0), output_size_);
+}
+
 XlaOpVector View::Lower(LoweringContext* loctx) const {
   xla::XlaOp input = loctx->GetOutputOp(operand(0));
   xla::XlaOp output = BuildView(input, output_size_);
@@ -12,6 +12,8 @@ class View : public Node {
  public:
   View(const Value& input, std::vector<xla::int64> output_size);
 
+  NodePtr Clone(OpList operands) const override;
+
   XlaOpVector Lower(LoweringContext* loctx) const override;
 
   std::string ToString() const override;
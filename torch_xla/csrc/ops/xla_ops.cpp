@@ -4,17 +4,62 @@ namespace torch_xla {
 namespace ir {
 namespace ops {
 
+const OpKindWrapper xla_adam_step("xla::adam_step");
+const OpKindWrapper xla_all_gather("xla::all_gather");
+const OpKindWrapper xla_all_to_all("xla::all_to_all");
+const OpKindWrapper xla_amp_unscale("xla::amp_unscale");
 const OpKindWrapper xla_as_strided_view_update("xla::as_strided_view_update");
+const OpKindWrapper xla_attention("xla::attention");
+const OpKindWrapper xla_attention_backward("xla::attention_backward");
 const OpKindWrapper xla_cast("xla::cast");
+const OpKindWrapper xla_clip_grad_norm("xla::clip_grad_norm");
+const OpKindWrapper xla_collective_permute("xla::collective_permute");
+const OpKindWrapper xla_compression_residual("xla::compression_residual");
+const OpKindWrapper xla_cond("xla::cond");
+const OpKindWrapper xla_convert("xla::convert");
+const OpKindWrapper xla_cross_entropy("xla::cross_entropy");
 const OpKindWrapper xla_cross_replica_sum("xla::cross_replica_sum");
 const OpKindWrapper xla_device_data("xla::device_data");
+const OpKindWrapper xla_dynamic_quantize("xla::dynamic_quantize");
+const OpKindWrapper xla_fused_convolution("xla::fused_convolution");
+const OpKindWrapper xla_fused_linear("xla::fused_linear");
 const OpKindWrapper xla_generic_slice("xla::generic_slice");
+const OpKindWrapper xla_group_norm("xla::group_norm");
+const OpKindWrapper xla_group_norm_backward("xla::group_norm_backward");
+const OpKindWrapper xla_gru_cell("xla::gru_cell");
+const OpKindWrapper xla_gru_cell_backward("xla::gru_cell_backward");
+const OpKindWrapper xla_gru_sequence("xla::gru_sequence");
+const OpKindWrapper xla_gru_sequence_backward("xla::gru_sequence_backward");
+const OpKindWrapper xla_histogram("xla::histogram");
+const OpKindWrapper xla_lamb_step("xla::lamb_step");
+const OpKindWrapper xla_lstm_cell("xla::lstm_cell");
+const OpKindWrapper xla_lstm_cell_backward("xla::lstm_cell_backward");
+const OpKindWrapper xla_lstm_sequence("xla::lstm_sequence");
+const OpKindWrapper xla_lstm_sequence_backward("xla::lstm_sequence_backward");
+const OpKindWrapper xla_masked_select_bounded("xla::masked_select_bounded");
 const OpKindWrapper xla_moving_average("xla::moving_average");
+const OpKindWrapper xla_nonzero_bounded("xla::nonzero_bounded");
 const OpKindWrapper xla_not_supported("xla::not_supported");
+const OpKindWrapper xla_packed_dropout("xla::packed_dropout");
+const OpKindWrapper xla_packed_dropout_backward(
+    "xla::packed_dropout_backward");
+const OpKindWrapper xla_quantized_convolution("xla::quantized_convolution");
+const OpKindWrapper xla_quantized_linear("xla::quantized_linear");
+const OpKindWrapper xla_reduce_scatter("xla::reduce_scatter");
+const OpKindWrapper xla_remat_anchor("xla::remat_anchor");
+const OpKindWrapper xla_segment_sum("xla::segment_sum");
 const OpKindWrapper xla_select("xla::select");
+const OpKindWrapper xla_select_finite_updates("xla::select_finite_updates");
+const OpKindWrapper xla_sgd_step("xla::sgd_step");
+const OpKindWrapper xla_sharding("xla::sharding");
+const OpKindWrapper xla_subgraph_parameter("xla::subgraph_parameter");
 const OpKindWrapper xla_tensor_data("xla::tensor_data");
+const OpKindWrapper xla_unique_bounded("xla::unique_bounded");
+const OpKindWrapper xla_unpack_bits("xla::unpack_bits");
 const OpKindWrapper xla_unselect("xla::unselect");
+const OpKindWrapper xla_update_loss_scale("xla::update_loss_scale");
 const OpKindWrapper xla_update_slice("xla::update_slice");
+const OpKindWrapper xla_while_loop("xla::while_loop");
 
 }  // namespace ops
 }  // namespace ir
@@ -28,17 +28,61 @@ class OpKindWrapper {
   mutable std::once_flag once_;
 };
 
+extern const OpKindWrapper xla_adam_step;
+extern const OpKindWrapper xla_all_gather;
+extern const OpKindWrapper xla_all_to_all;
+extern const OpKindWrapper xla_amp_unscale;
 extern const OpKindWrapper xla_as_strided_view_update;
+extern const OpKindWrapper xla_attention;
+extern const OpKindWrapper xla_attention_backward;
 extern const OpKindWrapper xla_cast;
+extern const OpKindWrapper xla_clip_grad_norm;
+extern const OpKindWrapper xla_collective_permute;
+extern const OpKindWrapper xla_compression_residual;
+extern const OpKindWrapper xla_cond;
+extern const OpKindWrapper xla_convert;
+extern const OpKindWrapper xla_cross_entropy;
 extern const OpKindWrapper xla_cross_replica_sum;
 extern const OpKindWrapper xla_device_data;
+extern const OpKindWrapper xla_dynamic_quantize;
+extern const OpKindWrapper xla_fused_convolution;
+extern const OpKindWrapper xla_fused_linear;
 extern const OpKindWrapper xla_generic_slice;
+extern const OpKindWrapper xla_group_norm;
+extern const OpKindWrapper xla_group_norm_backward;
+extern const OpKindWrapper xla_gru_cell;
+extern const OpKindWrapper xla_gru_cell_backward;
+extern const OpKindWrapper xla_gru_sequence;
+extern const OpKindWrapper xla_gru_sequence_backward;
+extern const OpKindWrapper xla_histogram;
+extern const OpKindWrapper xla_lamb_step;
+extern const OpKindWrapper xla_lstm_cell;
+extern const OpKindWrapper xla_lstm_cell_backward;
+extern const OpKindWrapper xla_lstm_sequence;
+extern const OpKindWrapper xla_lstm_sequence_backward;
+extern const OpKindWrapper xla_masked_select_bounded;
 extern const OpKindWrapper xla_moving_average;
+extern const OpKindWrapper xla_nonzero_bounded;
 extern const OpKindWrapper xla_not_supported;
+extern const OpKindWrapper xla_packed_dropout;
+extern const OpKindWrapper xla_packed_dropout_backward;
+extern const OpKindWrapper xla_quantized_convolution;
+extern const OpKindWrapper xla_quantized_linear;
+extern const OpKindWrapper xla_reduce_scatter;
+extern const OpKindWrapper xla_remat_anchor;
+extern const OpKindWrapper xla_segment_sum;
 extern const OpKindWrapper xla_select;
+extern const OpKindWrapper xla_select_finite_updates;
+extern const OpKindWrapper xla_sgd_step;
+extern const OpKindWrapper xla_sharding;
+extern const OpKindWrapper xla_subgraph_parameter;
 extern const OpKindWrapper xla_tensor_data;
+extern const OpKindWrapper xla_unique_bounded;
+extern const OpKindWrapper xla_unpack_bits;
 extern const OpKindWrapper xla_unselect;
+extern const OpKindWrapper xla_update_loss_scale;
 extern const OpKindWrapper xla_update_slice;
+extern const OpKindWrapper xla_while_loop;
 
 }  // namespace ops
 }  // namespace ir
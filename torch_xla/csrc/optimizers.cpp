@@ -0,0 +1,298 @@
+#include "torch_xla/csrc/optimizers.h"
+
+#include <cmath>
+
+#include "tensorflow/compiler/xla/client/lib/arithmetic.h"
+#include "tensorflow/compiler/xla/xla_client/debug_macros.h"
+#include "torch_xla/csrc/helpers.h"
+
+namespace torch_xla {
+namespace {
+
+// Converts the F32 scalar hyperparameter to the element type of like.
+xla::XlaOp ScalarLike(const xla::XlaOp& scalar, const xla::XlaOp& like) {
+  xla::PrimitiveType type = XlaHelpers::TypeOfXlaOp(like);
+  return XlaHelpers::TypeOfXlaOp(scalar) == type
+             ? scalar
+             : xla::ConvertElementType(scalar, type);
+}
+
+// Computes the L2 norm of the input in F32, as a F32 scalar.
+xla::XlaOp BuildF32Norm(const xla::XlaOp& input) {
+  xla::XlaOp input_f32 =
+      xla::ConvertElementType(input, xla::PrimitiveType::F32);
+  xla::XlaOp zero = XlaHelpers::ScalarValue<float>(0, xla::PrimitiveType::F32,
+                                                   input.builder());
+  return xla::Sqrt(xla::ReduceAll(
+      input_f32 * input_f32, zero,
+      XlaHelpers::CreateAddComputation(xla::PrimitiveType::F32)));
+}
+
+// Reduces the input, in F32, to the sum of its absolute values raised to
+// norm_type, or to its absolute maximum if norm_type is infinity.
+xla::XlaOp BuildF32NormPartial(const xla::XlaOp& input, double norm_type) {
+  xla::XlaOp abs_f32 =
+      xla::Abs(xla::ConvertElementType(input, xla::PrimitiveType::F32));
+  if (std::isinf(norm_type)) {
+    return xla::ReduceAll(
+        abs_f32,
+        XlaHelpers::ScalarValue<float>(0, xla::PrimitiveType::F32,
+                                       input.builder()),
+        XlaHelpers::CreateMaxComputation(xla::PrimitiveType::F32));
+  }
+  xla::XlaOp powered =
+      norm_type == 1
+          ? abs_f32
+          : (norm_type == 2
+                 ? abs_f32 * abs_f32
+                 : xla::Pow(abs_f32, XlaHelpers::ScalarValue<float>(
+                                         norm_type, xla::PrimitiveType::F32,
+                                         input.builder())));
+  return xla::ReduceAll(
+      powered,
+      XlaHelpers::ScalarValue<float>(0, xla::PrimitiveType::F32,
+                                     input.builder()),
+      XlaHelpers::CreateAddComputation(xla::PrimitiveType::F32));
+}
+
+}  // namespace
+
+std::vector<xla::XlaOp> BuildSgdStep(
+    tensorflow::gtl::ArraySlice<const xla::XlaOp> params,
+    tensorflow::gtl::ArraySlice<const xla::XlaOp> grads,
+    tensorflow::gtl::ArraySlice<const xla::XlaOp> momentum_buffers,
+    const xla::XlaOp& lr, const xla::XlaOp& momentum,
+    const xla::XlaOp& dampening, const xla::XlaOp& weight_decay, bool nesterov,
+    bool init_buffers) {
+  XLA_CHECK_EQ(params.size(), grads.size());
+  XLA_CHECK(momentum_buffers.empty() ||
+            momentum_buffers.size() == params.size());
+  xla::XlaOp one = XlaHelpers::ScalarValue<float>(1, xla::PrimitiveType::F32,
+                                                  lr.builder());
+  std::vector<xla::XlaOp> new_params;
+  std::vector<xla::XlaOp> new_buffers;
+  for (size_t i = 0; i < params.size(); ++i) {
+    const xla::XlaOp& param = params[i];
+    xla::XlaOp d_p = grads[i];
+    if (weight_decay.valid()) {
+      d_p = d_p + ScalarLike(weight_decay, param) * param;
+    }
+    if (!momentum_buffers.empty()) {
+      xla::XlaOp param_momentum = ScalarLike(momentum, param);
+      xla::XlaOp buffer =
+          init_buffers ? d_p
+                       : momentum_buffers[i] * param_momentum +
+                             ScalarLike(one - dampening, param) * d_p;
+      d_p = nesterov ? d_p + param_momentum * buffer : buffer;
+      new_buffers.push_back(buffer);
+    }
+    new_params.push_back(param - ScalarLike(lr, param) * d_p);
+  }
+  new_params.insert(new_params.end(), new_buffers.begin(), new_buffers.end());
+  return new_params;
+}
+
+std::vector<xla::XlaOp> BuildAdamStep(
+    tensorflow::gtl::ArraySlice<const xla::XlaOp> params,
+    tensorflow::gtl::ArraySlice<const xla::XlaOp> grads,
+    tensorflow::gtl::ArraySlice<const xla::XlaOp> exp_avgs,
+    tensorflow::gtl::ArraySlice<const xla::XlaOp> exp_avg_sqs,
+    tensorflow::gtl::ArraySlice<const xla::XlaOp> max_exp_avg_sqs,
+    const xla::XlaOp& step_size, const xla::XlaOp& beta1,
+    const xla::XlaOp& beta2, const xla::XlaOp& eps,
+    const xla::XlaOp& weight_decay) {
+  XLA_CHECK_EQ(params.size(), grads.size());
+  XLA_CHECK_EQ(params.size(), exp_avgs.size());
+  XLA_CHECK_EQ(params.size(), exp_avg_sqs.size());
+  XLA_CHECK(max_exp_avg_sqs.empty() ||
+            max_exp_avg_sqs.size() == params.size());
+  xla::XlaOp one = XlaHelpers::ScalarValue<float>(1, xla::PrimitiveType::F32,
+                                                  step_size.builder());
+  std::vector<xla::XlaOp> new_params;
+  std::vector<xla::XlaOp> new_exp_avgs;
+  std::vector<xla::XlaOp> new_exp_avg_sqs;
+  std::vector<xla::XlaOp> new_max_exp_avg_sqs;
+  for (size_t i = 0; i < params.size(); ++i) {
+    const xla::XlaOp& param = params[i];
+    xla::XlaOp grad = grads[i];
+    if (weight_decay.valid()) {
+      grad = grad + ScalarLike(weight_decay, param) * param;
+    }
+    xla::XlaOp exp_avg = exp_avgs[i] * ScalarLike(beta1, param) +
+                         ScalarLike(one - beta1, param) * grad;
+    xla::XlaOp exp_avg_sq = exp_avg_sqs[i] * ScalarLike(beta2, param) +
+                            ScalarLike(one - beta2, param) * grad * grad;
+    xla::XlaOp denom_sq = exp_avg_sq;
+    if (!max_exp_avg_sqs.empty()) {
+      denom_sq = xla::Max(max_exp_avg_sqs[i], exp_avg_sq);
+      new_max_exp_avg_sqs.push_back(denom_sq);
+    }
+    xla::XlaOp denom = xla::Sqrt(denom_sq) + ScalarLike(eps, param);
+    new_params.push_back(param -
+                         ScalarLike(step_size, param) * exp_avg / denom);
+    new_exp_avgs.push_back(exp_avg);
+    new_exp_avg_sqs.push_back(exp_avg_sq);
+  }
+  new_params.insert(new_params.end(), new_exp_avgs.begin(),
+                    new_exp_avgs.end());
+  new_params.insert(new_params.end(), new_exp_avg_sqs.begin(),
+                    new_exp_avg_sqs.end());
+  new_params.insert(new_params.end(), new_max_exp_avg_sqs.begin(),
+                    new_max_exp_avg_sqs.end());
+  return new_params;
+}
+
+std::vector<xla::XlaOp> BuildLambStep(
+    tensorflow::gtl::ArraySlice<const xla::XlaOp> params,
+    tensorflow::gtl::ArraySlice<const xla::XlaOp> grads,
+    tensorflow::gtl::ArraySlice<const xla::XlaOp> exp_avgs,
+    tensorflow::gtl::ArraySlice<const xla::XlaOp> exp_avg_sqs,
+    const xla::XlaOp& lr, const xla::XlaOp& beta1, const xla::XlaOp& beta2,
+    const xla::XlaOp& eps, const xla::XlaOp& weight_decay,
+    const xla::XlaOp& bias_correction1, const xla::XlaOp& bias_correction2) {
+  XLA_CHECK_EQ(params.size(), grads.size());
+  XLA_CHECK_EQ(params.size(), exp_avgs.size());
+  XLA_CHECK_EQ(params.size(), exp_avg_sqs.size());
+  xla::XlaOp zero =
+      XlaHelpers::ScalarValue<float>(0, xla::PrimitiveType::F32, lr.builder());
+  xla::XlaOp one =
+      XlaHelpers::ScalarValue<float>(1, xla::PrimitiveType::F32, lr.builder());
+  std::vector<xla::XlaOp> new_params;
+  std::vector<xla::XlaOp> new_exp_avgs;
+  std::vector<xla::XlaOp> new_exp_avg_sqs;
+  for (size_t i = 0; i < params.size(); ++i) {
+    const xla::XlaOp& param = params[i];
+    const xla::XlaOp& grad = grads[i];
+    xla::XlaOp exp_avg = exp_avgs[i] * ScalarLike(beta1, param) +
+                         ScalarLike(one - beta1, param) * grad;
+    xla::XlaOp exp_avg_sq = exp_avg_sqs[i] * ScalarLike(beta2, param) +
+                            ScalarLike(one - beta2, param) * grad * grad;
+    xla::XlaOp update =
+        (exp_avg / ScalarLike(bias_correction1, param)) /
+        (xla::Sqrt(exp_avg_sq / ScalarLike(bias_correction2, param)) +
+         ScalarLike(eps, param));
+    if (weight_decay.valid()) {
+      update = update + ScalarLike(weight_decay, param) * param;
+    }
+    // The trust ratio falls back to one when either norm is zero, like for
+    // the freshly zero initialized parameters.
+    xla::XlaOp param_norm = BuildF32Norm(param);
+    xla::XlaOp update_norm = BuildF32Norm(update);
+    xla::XlaOp trust_ratio =
+        xla::Select(xla::And(xla::Gt(param_norm, zero),
+                             xla::Gt(update_norm, zero)),
+                    param_norm / update_norm, one);
+    new_params.push_back(param - ScalarLike(lr * trust_ratio, param) * update);
+    new_exp_avgs.push_back(exp_avg);
+    new_exp_avg_sqs.push_back(exp_avg_sq);
+  }
+  new_params.insert(new_params.end(), new_exp_avgs.begin(),
+                    new_exp_avgs.end());
+  new_params.insert(new_params.end(), new_exp_avg_sqs.begin(),
+                    new_exp_avg_sqs.end());
+  return new_params;
+}
+
+std::vector<xla::XlaOp> BuildClipGradNorm(
+    tensorflow::gtl::ArraySlice<const xla::XlaOp> grads,
+    const xla::XlaOp& max_norm, double norm_type) {
+  XLA_CHECK_GT(norm_type, 0) << "Invalid norm type: " << norm_type;
+  xla::XlaBuilder* builder = max_norm.builder();
+  xla::XlaOp one =
+      XlaHelpers::ScalarValue<float>(1, xla::PrimitiveType::F32, builder);
+  xla::XlaOp total_norm =
+      XlaHelpers::ScalarValue<float>(0, xla::PrimitiveType::F32, builder);
+  bool inf_norm = std::isinf(norm_type);
+  for (auto& grad : grads) {
+    xla::XlaOp partial = BuildF32NormPartial(grad, norm_type);
+    total_norm =
+        inf_norm ? xla::Max(total_norm, partial) : total_norm + partial;
+  }
+  if (!inf_norm && norm_type != 1) {
+    total_norm = norm_type == 2
+                     ? xla::Sqrt(total_norm)
+                     : xla::Pow(total_norm, XlaHelpers::ScalarValue<float>(
+                                                1.0 / norm_type,
+                                                xla::PrimitiveType::F32,
+                                                builder));
+  }
+  // Like torch.nn.utils.clip_grad_norm_, the gradients are only scaled when
+  // the clip coefficient is below one.
+  xla::XlaOp clip_coef = xla::Min(
+      max_norm / (total_norm + XlaHelpers::ScalarValue<float>(
+                                   1e-6, xla::PrimitiveType::F32, builder)),
+      one);
+  std::vector<xla::XlaOp> results;
+  results.reserve(grads.size() + 1);
+  for (auto& grad : grads) {
+    results.push_back(grad * ScalarLike(clip_coef, grad));
+  }
+  results.push_back(total_norm);
+  return results;
+}
+
+std::vector<xla::XlaOp> BuildAmpUnscale(
+    tensorflow::gtl::ArraySlice<const xla::XlaOp> grads,
+    const xla::XlaOp& loss_scale) {
+  xla::XlaBuilder* builder = loss_scale.builder();
+  xla::XlaOp inv_scale =
+      XlaHelpers::ScalarValue<float>(1, xla::PrimitiveType::F32, builder) /
+      loss_scale;
+  xla::XlaOp all_finite = xla::ConstantR0<bool>(builder, true);
+  std::vector<xla::XlaOp> results;
+  results.reserve(grads.size() + 1);
+  for (auto& grad : grads) {
+    xla::XlaOp unscaled = grad * ScalarLike(inv_scale, grad);
+    all_finite = xla::And(
+        all_finite,
+        xla::ReduceAll(xla::IsFinite(unscaled),
+                       xla::ConstantR0<bool>(builder, true),
+                       xla::CreateScalarAndComputation(
+                           xla::PrimitiveType::PRED, builder)));
+    results.push_back(unscaled);
+  }
+  results.push_back(
+      xla::ConvertElementType(xla::Not(all_finite), xla::PrimitiveType::F32));
+  return results;
+}
+
+std::vector<xla::XlaOp> BuildSelectFiniteUpdates(
+    tensorflow::gtl::ArraySlice<const xla::XlaOp> updated,
+    tensorflow::gtl::ArraySlice<const xla::XlaOp> previous,
+    const xla::XlaOp& found_inf) {
+  XLA_CHECK_EQ(updated.size(), previous.size());
+  xla::XlaOp finite = xla::Eq(
+      found_inf, XlaHelpers::ScalarValue<float>(0, xla::PrimitiveType::F32,
+                                                found_inf.builder()));
+  std::vector<xla::XlaOp> results;
+  results.reserve(updated.size());
+  for (size_t i = 0; i < updated.size(); ++i) {
+    const xla::Shape& shape = XlaHelpers::ShapeOfXlaOp(updated[i]);
+    results.push_back(xla::Select(xla::Broadcast(finite, shape.dimensions()),
+                                  updated[i], previous[i]));
+  }
+  return results;
+}
+
+std::vector<xla::XlaOp> BuildUpdateLossScale(
+    const xla::XlaOp& loss_scale, const xla::XlaOp& good_steps,
+    const xla::XlaOp& found_inf, const xla::XlaOp& growth_factor,
+    const xla::XlaOp& backoff_factor, const xla::XlaOp& growth_interval,
+    const xla::XlaOp& min_scale) {
+  xla::XlaBuilder* builder = loss_scale.builder();
+  xla::XlaOp zero =
+      XlaHelpers::ScalarValue<float>(0, xla::PrimitiveType::F32, builder);
+  xla::XlaOp one =
+      XlaHelpers::ScalarValue<float>(1, xla::PrimitiveType::F32, builder);
+  xla::XlaOp finite = xla::Eq(found_inf, zero);
+  xla::XlaOp next_good_steps = good_steps + one;
+  xla::XlaOp grow = xla::And(finite, xla::Ge(next_good_steps, growth_interval));
+  xla::XlaOp new_scale = xla::Select(
+      finite, xla::Select(grow, loss_scale * growth_factor, loss_scale),
+      xla::Max(loss_scale * backoff_factor, min_scale));
+  xla::XlaOp new_good_steps = xla::Select(
+      xla::Or(grow, xla::Not(finite)), zero, next_good_steps);
+  return {new_scale, new_good_steps};
+}
+
+}  // namespace torch_xla
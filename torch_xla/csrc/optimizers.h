@@ -0,0 +1,91 @@
+#pragma once
+
+#include <vector>
+
+#include "tensorflow/compiler/xla/client/xla_builder.h"
+#include "tensorflow/core/lib/gtl/array_slice.h"
+
+namespace torch_xla {
+
+// The lowerings below update a whole list of parameters at once, with the math
+// of the matching torch.optim optimizers. The hyperparameters are F32 scalar
+// operands, converted to the element type of every parameter, so that changing
+// them (like with a learning rate schedule) does not produce a new computation.
+// The optional weight_decay operand is not valid() when the weight decay is
+// zero.
+
+// Lowers torch.optim.SGD. The momentum buffers are empty when the momentum is
+// zero, and are initialized with the gradients if init_buffers is true.
+// Returns the updated parameters, followed by the updated momentum buffers.
+std::vector<xla::XlaOp> BuildSgdStep(
+    tensorflow::gtl::ArraySlice<const xla::XlaOp> params,
+    tensorflow::gtl::ArraySlice<const xla::XlaOp> grads,
+    tensorflow::gtl::ArraySlice<const xla::XlaOp> momentum_buffers,
+    const xla::XlaOp& lr, const xla::XlaOp& momentum,
+    const xla::XlaOp& dampening, const xla::XlaOp& weight_decay, bool nesterov,
+    bool init_buffers);
+
+// Lowers torch.optim.Adam, where step_size is the learning rate scaled by the
+// bias corrections of the current step. The max_exp_avg_sqs are empty unless
+// amsgrad is used. Returns the updated parameters, followed by the updated
+// exp_avgs, exp_avg_sqs and max_exp_avg_sqs.
+std::vector<xla::XlaOp> BuildAdamStep(
+    tensorflow::gtl::ArraySlice<const xla::XlaOp> params,
+    tensorflow::gtl::ArraySlice<const xla::XlaOp> grads,
+    tensorflow::gtl::ArraySlice<const xla::XlaOp> exp_avgs,
+    tensorflow::gtl::ArraySlice<const xla::XlaOp> exp_avg_sqs,
+    tensorflow::gtl::ArraySlice<const xla::XlaOp> max_exp_avg_sqs,
+    const xla::XlaOp& step_size, const xla::XlaOp& beta1,
+    const xla::XlaOp& beta2, const xla::XlaOp& eps,
+    const xla::XlaOp& weight_decay);
+
+// Lowers the LAMB optimizer (https://arxiv.org/abs/1904.00962), which scales
+// the Adam update of every parameter (with the weight decay added to it) by the
+// ratio between the norm of the parameter and the one of the update. The
+// bias corrections are 1 - beta^step, or 1 when they are disabled. Returns the
+// updated parameters, followed by the updated exp_avgs and exp_avg_sqs.
+std::vector<xla::XlaOp> BuildLambStep(
+    tensorflow::gtl::ArraySlice<const xla::XlaOp> params,
+    tensorflow::gtl::ArraySlice<const xla::XlaOp> grads,
+    tensorflow::gtl::ArraySlice<const xla::XlaOp> exp_avgs,
+    tensorflow::gtl::ArraySlice<const xla::XlaOp> exp_avg_sqs,
+    const xla::XlaOp& lr, const xla::XlaOp& beta1, const xla::XlaOp& beta2,
+    const xla::XlaOp& eps, const xla::XlaOp& weight_decay,
+    const xla::XlaOp& bias_correction1, const xla::XlaOp& bias_correction2);
+
+// Lowers torch.nn.utils.clip_grad_norm_, computing the total norm of all the
+// gradients with a single reduction and scaling them by the clip coefficient
+// within the same computation, so that no scalar needs to be read back to the
+// host. The norm_type can be infinity. Returns the scaled gradients, followed
+// by the F32 total norm.
+std::vector<xla::XlaOp> BuildClipGradNorm(
+    tensorflow::gtl::ArraySlice<const xla::XlaOp> grads,
+    const xla::XlaOp& max_norm, double norm_type);
+
+// Unscales the gradients by the F32 loss_scale, and checks all of them for non
+// finite values within the same computation. Returns the unscaled gradients,
+// followed by the F32 found_inf flag, which is one if any gradient holds an
+// infinity or a NaN, and zero otherwise.
+std::vector<xla::XlaOp> BuildAmpUnscale(
+    tensorflow::gtl::ArraySlice<const xla::XlaOp> grads,
+    const xla::XlaOp& loss_scale);
+
+// Returns the updated values when the found_inf flag is zero, and the previous
+// ones otherwise, so that a step with non finite gradients leaves the
+// parameters and the optimizer state untouched.
+std::vector<xla::XlaOp> BuildSelectFiniteUpdates(
+    tensorflow::gtl::ArraySlice<const xla::XlaOp> updated,
+    tensorflow::gtl::ArraySlice<const xla::XlaOp> previous,
+    const xla::XlaOp& found_inf);
+
+// Updates the F32 loss_scale and good_steps counter, like the dynamic loss
+// scalers do: the scale is multiplied by backoff_factor (not going below
+// min_scale) when found_inf is set, and by growth_factor after growth_interval
+// consecutive steps with finite gradients. Returns the new scale and counter.
+std::vector<xla::XlaOp> BuildUpdateLossScale(
+    const xla::XlaOp& loss_scale, const xla::XlaOp& good_steps,
+    const xla::XlaOp& found_inf, const xla::XlaOp& growth_factor,
+    const xla::XlaOp& backoff_factor, const xla::XlaOp& growth_interval,
+    const xla::XlaOp& min_scale);
+
+}  // namespace torch_xla
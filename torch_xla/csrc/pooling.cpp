@@ -1,11 +1,17 @@
 #include "torch_xla/csrc/pooling.h"
 
+#include <numeric>
+
+#include "tensorflow/compiler/xla/client/lib/constants.h"
 #include "tensorflow/compiler/xla/client/lib/pooling.h"
+#include "tensorflow/compiler/xla/client/lib/slicing.h"
 #include "tensorflow/compiler/xla/xla_client/debug_macros.h"
 #include "tensorflow/compiler/xla/xla_client/util.h"
 #include "torch/csrc/jit/autodiff.h"
 #include "torch_xla/csrc/data_ops.h"
 #include "torch_xla/csrc/helpers.h"
+#include "torch_xla/csrc/tensor_util.h"
+#include "torch_xla/csrc/xla_lower_util.h"
 
 namespace torch_xla {
 namespace {
@@ -61,8 +67,8 @@ std::vector<xla::int64> AdaptiveAvgPoolKernelSize(
     tensorflow::gtl::ArraySlice<const xla::int64> output_size) {
   // Create a NCHW kernel size with 1 for batch size and feature.
   std::vector<xla::int64> kernel_size(2, 1);
-  xla::int64 spatial_dim_off = input_size.size() - 2;
-  for (int spatial_dim = 0; spatial_dim < 2; ++spatial_dim) {
+  xla::int64 spatial_dim_off = input_size.size() - output_size.size();
+  for (int spatial_dim = 0; spatial_dim < output_size.size(); ++spatial_dim) {
     XLA_CHECK_EQ(
         input_size[spatial_dim_off + spatial_dim] % output_size[spatial_dim], 0)
         << "Target output size " << output_size[spatial_dim]
@@ -74,6 +80,79 @@ std::vector<xla::int64> AdaptiveAvgPoolKernelSize(
   return kernel_size;
 }
 
+// Returns true if every spatial input size is a multiple of the respective
+// output size, in which case adaptive average pooling is a plain average
+// pooling.
+bool IsDivisibleAdaptivePool(
+    tensorflow::gtl::ArraySlice<const xla::int64> input_size,
+    tensorflow::gtl::ArraySlice<const xla::int64> output_size) {
+  xla::int64 spatial_dim_off = input_size.size() - output_size.size();
+  for (int spatial_dim = 0; spatial_dim < output_size.size(); ++spatial_dim) {
+    if (input_size[spatial_dim_off + spatial_dim] % output_size[spatial_dim] !=
+        0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Returns the [start, end) input range pooled by the output_index element of
+// an adaptive pooling. Consecutive ranges might overlap by one element.
+std::pair<xla::int64, xla::int64> AdaptivePoolRange(xla::int64 output_index,
+                                                    xla::int64 input_size,
+                                                    xla::int64 output_size) {
+  xla::int64 start = (output_index * input_size) / output_size;
+  xla::int64 end =
+      ((output_index + 1) * input_size + output_size - 1) / output_size;
+  return {start, end};
+}
+
+// Creates the output_size x input_size matrix which averages the input ranges
+// of an adaptive pooling along one dimension.
+xla::XlaOp AdaptiveAvgPoolMatrix(xla::int64 input_size, xla::int64 output_size,
+                                 xla::PrimitiveType type,
+                                 xla::XlaBuilder* builder) {
+  std::vector<float> weights(output_size * input_size, 0.0f);
+  for (xla::int64 i = 0; i < output_size; ++i) {
+    auto range = AdaptivePoolRange(i, input_size, output_size);
+    for (xla::int64 j = range.first; j < range.second; ++j) {
+      weights[i * input_size + j] = 1.0f / (range.second - range.first);
+    }
+  }
+  return xla::ConvertElementType(
+      xla::Reshape(xla::ConstantR1<float>(builder, weights),
+                   {output_size, input_size}),
+      type);
+}
+
+// Contracts each of the spatial_dim_count trailing dimensions of input with
+// the matrix returned by make_matrix(dim_size, spatial_dim) along its
+// matrix_dim dimension. Every contraction moves the reduced dimension to the
+// back, so handling the spatial dimensions in order leaves them in place,
+// without any transpose.
+xla::XlaOp ApplyAdaptivePoolMatrices(
+    const xla::XlaOp& input, xla::int64 spatial_dim_count,
+    xla::int64 matrix_dim,
+    const std::function<xla::XlaOp(xla::int64, xla::int64)>& make_matrix) {
+  // The averaging weights are not representable with low precision types, so
+  // the contractions always run at the highest precision.
+  xla::PrecisionConfig precision_config =
+      XlaHelpers::BuildPrecisionConfig(xla::PrecisionConfig::HIGHEST);
+  xla::XlaOp result = input;
+  for (xla::int64 spatial_dim = 0; spatial_dim < spatial_dim_count;
+       ++spatial_dim) {
+    xla::Shape shape = XlaHelpers::ShapeOfXlaOp(result);
+    xla::int64 dim = shape.rank() - spatial_dim_count;
+    xla::DotDimensionNumbers dimension_numbers;
+    dimension_numbers.add_lhs_contracting_dimensions(dim);
+    dimension_numbers.add_rhs_contracting_dimensions(matrix_dim);
+    result = xla::DotGeneral(result,
+                             make_matrix(shape.dimensions(dim), spatial_dim),
+                             dimension_numbers, &precision_config);
+  }
+  return result;
+}
+
 struct BatchInput {
   xla::XlaOp batch_input;
   xla::int64 original_rank;
@@ -149,18 +228,6 @@ xla::PaddingConfig MakeXlaPaddingConfig(
 
 }  // namespace
 
-bool IsSupportedAdaptiveAvgPool2d(
-    tensorflow::gtl::ArraySlice<const xla::int64> input_size,
-    tensorflow::gtl::ArraySlice<const xla::int64> output_size) {
-  xla::int64 rank = input_size.size();
-  for (int spatial_dim = 0; spatial_dim < 2; ++spatial_dim) {
-    if (input_size[rank - 2 + spatial_dim] % output_size[spatial_dim] != 0) {
-      return false;
-    }
-  }
-  return true;
-}
-
 xla::XlaOp BuildMaxPoolNd(
     const xla::XlaOp& input, xla::int64 spatial_dim_count,
     tensorflow::gtl::ArraySlice<const xla::int64> kernel_size,
@@ -231,6 +298,123 @@ xla::XlaOp BuildMaxPoolNdBackward(
                             /*spatial_dim_count=*/spatial_dim_count);
 }
 
+MaxPoolResult BuildMaxPoolNdWithIndices(
+    const xla::XlaOp& input, xla::int64 spatial_dim_count,
+    tensorflow::gtl::ArraySlice<const xla::int64> kernel_size,
+    tensorflow::gtl::ArraySlice<const xla::int64> stride,
+    tensorflow::gtl::ArraySlice<const xla::int64> padding, bool ceil_mode) {
+  xla::XlaBuilder* builder = input.builder();
+  BatchInput batch_input_info = CreateBatchInput(input, spatial_dim_count);
+  xla::XlaOp batch_input = batch_input_info.batch_input;
+  xla::Shape input_shape = XlaHelpers::ShapeOfXlaOp(batch_input);
+  xla::PrimitiveType type = input_shape.element_type();
+  xla::PrimitiveType index_type =
+      GetDevicePrimitiveType(xla::PrimitiveType::S64, /*device=*/nullptr);
+  xla::XlaOp batch_result = BuildMaxPoolNd(batch_input, spatial_dim_count,
+                                           kernel_size, stride, padding,
+                                           ceil_mode);
+  xla::Shape result_shape = XlaHelpers::ShapeOfXlaOp(batch_result);
+  // The flat spatial indices of the input elements, padded like the input with
+  // -1 values, which never get selected.
+  std::vector<xla::int64> spatial_sizes(input_shape.dimensions().begin() + 2,
+                                        input_shape.dimensions().end());
+  xla::XlaOp indices = xla::Reshape(
+      xla::Iota(builder,
+                xla::ShapeUtil::MakeShape(
+                    index_type, {xla::util::Multiply<xla::int64>(
+                                    spatial_sizes)}),
+                0),
+      spatial_sizes);
+  xla::PaddingConfig padding_config = MakeXlaPaddingConfig(
+      padding, input_shape, kernel_size, stride, ceil_mode);
+  xla::PaddingConfig indices_padding_config;
+  for (xla::int64 dim = 2; dim < padding_config.dimensions_size(); ++dim) {
+    *indices_padding_config.add_dimensions() = padding_config.dimensions(dim);
+  }
+  xla::XlaOp padded_input =
+      xla::Pad(batch_input, xla::MinValue(builder, type), padding_config);
+  xla::XlaOp padded_indices = xla::Pad(
+      indices, XlaHelpers::ScalarValue<xla::int64>(-1, index_type, builder),
+      indices_padding_config);
+  // Every kernel offset selects, through a strided slice, one element of all
+  // the pooling windows. The offsets are visited in reverse row major order,
+  // so that the first maximum of every window wins, like in PyTorch. NaN
+  // values are maximums as well.
+  std::vector<xla::int64> batch_sizes(result_shape.dimensions().begin(),
+                                      result_shape.dimensions().begin() + 2);
+  xla::XlaOp result_indices =
+      xla::Broadcast(xla::MaxValue(builder, index_type),
+                     result_shape.dimensions());
+  xla::int64 kernel_elements = xla::util::Multiply<xla::int64>(kernel_size);
+  for (xla::int64 i = kernel_elements - 1; i >= 0; --i) {
+    std::vector<xla::int64> start(2, 0);
+    std::vector<xla::int64> limit(batch_sizes);
+    std::vector<xla::int64> strides(2, 1);
+    xla::int64 offset = i;
+    for (xla::int64 dim = spatial_dim_count - 1; dim >= 0; --dim) {
+      xla::int64 kernel_offset = offset % kernel_size[dim];
+      offset /= kernel_size[dim];
+      start.insert(start.begin() + 2, kernel_offset);
+      limit.insert(limit.begin() + 2,
+                   kernel_offset +
+                       (result_shape.dimensions(2 + dim) - 1) * stride[dim] +
+                       1);
+      strides.insert(strides.begin() + 2, stride[dim]);
+    }
+    xla::XlaOp values = xla::Slice(padded_input, start, limit, strides);
+    xla::XlaOp offset_indices = xla::Broadcast(
+        xla::Slice(padded_indices,
+                   std::vector<xla::int64>(start.begin() + 2, start.end()),
+                   std::vector<xla::int64>(limit.begin() + 2, limit.end()),
+                   std::vector<xla::int64>(strides.begin() + 2,
+                                           strides.end())),
+        batch_sizes);
+    xla::XlaOp is_max = xla::And(
+        xla::Or(xla::Eq(values, batch_result), xla::Ne(values, values)),
+        xla::Ge(offset_indices, xla::Zero(builder, index_type)));
+    result_indices = xla::Select(is_max, offset_indices, result_indices);
+  }
+  return {RemoveTrivialBatch(batch_result, batch_input_info.original_rank,
+                             spatial_dim_count),
+          RemoveTrivialBatch(result_indices, batch_input_info.original_rank,
+                             spatial_dim_count)};
+}
+
+xla::XlaOp BuildMaxPoolNdBackwardWithIndices(const xla::XlaOp& out_backprop,
+                                             const xla::XlaOp& input,
+                                             const xla::XlaOp& indices,
+                                             xla::int64 spatial_dim_count) {
+  xla::Shape input_shape = XlaHelpers::ShapeOfXlaOp(input);
+  xla::Shape out_backprop_shape = XlaHelpers::ShapeOfXlaOp(out_backprop);
+  xla::int64 spatial_dim_off = input_shape.rank() - spatial_dim_count;
+  auto flat_sizes = [&](const xla::Shape& shape) -> std::vector<xla::int64> {
+    xla::int64 batch_size = 1;
+    xla::int64 spatial_size = 1;
+    for (xla::int64 dim = 0; dim < shape.rank(); ++dim) {
+      if (dim < spatial_dim_off) {
+        batch_size *= shape.dimensions(dim);
+      } else {
+        spatial_size *= shape.dimensions(dim);
+      }
+    }
+    return {batch_size, spatial_size};
+  };
+  // Scatter-add the gradients at the flat spatial indices of the maximums, as
+  // windows can overlap.
+  xla::XlaOp zeros = xla::Broadcast(
+      xla::Zero(input.builder(), out_backprop_shape.element_type()),
+      flat_sizes(input_shape));
+  auto add_scatter_combiner = [](const xla::XlaOp& x,
+                                 const xla::XlaOp& y) -> xla::XlaOp {
+    return x + y;
+  };
+  xla::XlaOp grad = CreateScatter(
+      zeros, xla::Reshape(indices, flat_sizes(out_backprop_shape)),
+      xla::Reshape(out_backprop, flat_sizes(out_backprop_shape)), /*dim=*/1,
+      add_scatter_combiner);
+  return xla::Reshape(grad, input_shape.dimensions());
+}
+
 xla::XlaOp BuildAvgPoolNd(
     const xla::XlaOp& input, xla::int64 spatial_dim_count,
     tensorflow::gtl::ArraySlice<const xla::int64> kernel_size,
@@ -287,60 +471,183 @@ xla::XlaOp BuildAvgPoolNdBackward(
                             /*spatial_dim_count=*/spatial_dim_count);
 }
 
-xla::XlaOp BuildAdaptiveAvgPool2d(
-    const xla::XlaOp& input,
+xla::XlaOp BuildAdaptiveAvgPoolNd(
+    const xla::XlaOp& input, xla::int64 spatial_dim_count,
     tensorflow::gtl::ArraySlice<const xla::int64> output_size) {
-  XLA_CHECK_EQ(output_size.size(), 2) << "Invalid output size rank";
+  XLA_CHECK_EQ(output_size.size(), spatial_dim_count)
+      << "Invalid output size rank";
   const auto input_size = XlaHelpers::SizesOfXlaOp(input);
-  XLA_CHECK(input_size.size() == 4 || input_size.size() == 3)
-      << "Only 4D or 3D tensors supported";
+  XLA_CHECK(input_size.size() == spatial_dim_count + 2 ||
+            input_size.size() == spatial_dim_count + 1)
+      << "Only " << spatial_dim_count + 2 << "D or " << spatial_dim_count + 1
+      << "D tensors supported";
+  if (!IsDivisibleAdaptivePool(input_size, output_size)) {
+    xla::PrimitiveType type = XlaHelpers::TypeOfXlaOp(input);
+    return ApplyAdaptivePoolMatrices(
+        input, spatial_dim_count, /*matrix_dim=*/1,
+        [&](xla::int64 dim_size, xla::int64 spatial_dim) {
+          return AdaptiveAvgPoolMatrix(dim_size, output_size[spatial_dim],
+                                       type, input.builder());
+        });
+  }
   const auto kernel_size = AdaptiveAvgPoolKernelSize(input_size, output_size);
-  std::vector<std::pair<xla::int64, xla::int64>> no_padding(2);
-  BatchInput batch_input_info =
-      CreateBatchInput(input, /*spatial_dim_count=*/2);
+  std::vector<std::pair<xla::int64, xla::int64>> no_padding(spatial_dim_count);
+  BatchInput batch_input_info = CreateBatchInput(input, spatial_dim_count);
   xla::XlaOp batch_result = xla::AvgPool(
       /*operand=*/batch_input_info.batch_input,
       /*kernel_size=*/kernel_size,
       /*stride=*/kernel_size,
       /*padding=*/no_padding,
-      /*data_format=*/MakeNCHWFormat(2),
+      /*data_format=*/MakeNCHWFormat(spatial_dim_count),
       /*counts_include_padding=*/false);
   return RemoveTrivialBatch(/*batch=*/batch_result,
                             /*original_rank=*/batch_input_info.original_rank,
-                            /*spatial_dim_count=*/2);
+                            /*spatial_dim_count=*/spatial_dim_count);
 }
 
-xla::XlaOp BuildAdaptiveAvgPool2dBackward(const xla::XlaOp& out_backprop,
-                                          const xla::XlaOp& input) {
+xla::XlaOp BuildAdaptiveAvgPoolNdBackward(const xla::XlaOp& out_backprop,
+                                          const xla::XlaOp& input,
+                                          xla::int64 spatial_dim_count) {
   BatchInput batch_out_backprop_info =
-      CreateBatchInput(/*input=*/out_backprop, /*spatial_dim_count=*/2);
+      CreateBatchInput(/*input=*/out_backprop, spatial_dim_count);
   const auto out_backprop_size =
       XlaHelpers::SizesOfXlaOp(batch_out_backprop_info.batch_input);
-  XLA_CHECK_EQ(out_backprop_size.size(), 4)
+  XLA_CHECK_EQ(out_backprop_size.size(), spatial_dim_count + 2)
       << "Invalid rank of gradient output";
-  std::vector<xla::int64> output_size{out_backprop_size[2],
-                                      out_backprop_size[3]};
+  std::vector<xla::int64> output_size(out_backprop_size.begin() + 2,
+                                      out_backprop_size.end());
   auto gradients_size = XlaHelpers::SizesOfXlaOp(input);
-  XLA_CHECK(gradients_size.size() == 4 || gradients_size.size() == 3)
-      << "Only 4D or 3D tensors supported";
-  if (gradients_size.size() == 3) {
+  XLA_CHECK(gradients_size.size() == spatial_dim_count + 2 ||
+            gradients_size.size() == spatial_dim_count + 1)
+      << "Only " << spatial_dim_count + 2 << "D or " << spatial_dim_count + 1
+      << "D tensors supported";
+  if (!IsDivisibleAdaptivePool(gradients_size, output_size)) {
+    // The gradient of the averaging contractions are the contractions with the
+    // same matrices, along the output dimension.
+    xla::PrimitiveType type = XlaHelpers::TypeOfXlaOp(out_backprop);
+    xla::int64 spatial_dim_off = gradients_size.size() - spatial_dim_count;
+    return ApplyAdaptivePoolMatrices(
+        out_backprop, spatial_dim_count, /*matrix_dim=*/0,
+        [&](xla::int64 dim_size, xla::int64 spatial_dim) {
+          return AdaptiveAvgPoolMatrix(
+              gradients_size[spatial_dim_off + spatial_dim], dim_size, type,
+              out_backprop.builder());
+        });
+  }
+  if (gradients_size.size() == spatial_dim_count + 1) {
     gradients_size.insert(gradients_size.begin(), 1);
   }
   const auto kernel_size =
       AdaptiveAvgPoolKernelSize(gradients_size, output_size);
-  std::vector<std::pair<xla::int64, xla::int64>> no_padding(2);
+  std::vector<std::pair<xla::int64, xla::int64>> no_padding(spatial_dim_count);
   xla::XlaOp batch_result = xla::AvgPoolGrad(
       /*out_backprop=*/batch_out_backprop_info.batch_input,
       /*gradients_size=*/gradients_size,
       /*kernel_size=*/kernel_size,
       /*stride=*/kernel_size,
       /*spatial_padding=*/no_padding,
-      /*data_format=*/MakeNCHWFormat(2),
+      /*data_format=*/MakeNCHWFormat(spatial_dim_count),
       /*counts_include_padding=*/false);
   return RemoveTrivialBatch(
       /*batch=*/batch_result,
       /*original_rank=*/batch_out_backprop_info.original_rank,
-      /*spatial_dim_count=*/2);
+      /*spatial_dim_count=*/spatial_dim_count);
+}
+
+AdaptiveMaxPoolResult BuildAdaptiveMaxPoolNd(
+    const xla::XlaOp& input, xla::int64 spatial_dim_count,
+    tensorflow::gtl::ArraySlice<const xla::int64> output_size) {
+  XLA_CHECK_EQ(output_size.size(), spatial_dim_count)
+      << "Invalid output size rank";
+  xla::Shape input_shape = XlaHelpers::ShapeOfXlaOp(input);
+  xla::int64 rank = input_shape.rank();
+  XLA_CHECK(rank == spatial_dim_count + 2 || rank == spatial_dim_count + 1)
+      << "Only " << spatial_dim_count + 2 << "D or " << spatial_dim_count + 1
+      << "D tensors supported";
+  xla::int64 spatial_dim_off = rank - spatial_dim_count;
+  xla::XlaBuilder* builder = input.builder();
+  xla::PrimitiveType index_type =
+      GetDevicePrimitiveType(xla::PrimitiveType::S64, /*device=*/nullptr);
+  std::vector<xla::int64> spatial_sizes(
+      input_shape.dimensions().begin() + spatial_dim_off,
+      input_shape.dimensions().end());
+  // The flat spatial indices of the input elements, which get gathered along
+  // with the input itself.
+  xla::XlaOp indices = xla::Reshape(
+      xla::Iota(builder,
+                xla::ShapeUtil::MakeShape(
+                    index_type, {xla::util::Multiply<xla::int64>(
+                                    spatial_sizes)}),
+                0),
+      spatial_sizes);
+  // Gather every spatial dimension of size N into a [M, K] pair of dimensions,
+  // where M is the output size and K the largest pooled range. Shorter ranges
+  // are completed by repeating their first element, which does not alter
+  // either the maximum or its first index.
+  xla::XlaOp windows = input;
+  std::vector<xla::int64> window_dims;
+  std::vector<xla::int64> output_dims(spatial_dim_off);
+  std::iota(output_dims.begin(), output_dims.end(), 0);
+  for (xla::int64 spatial_dim = 0; spatial_dim < spatial_dim_count;
+       ++spatial_dim) {
+    xla::int64 input_size = spatial_sizes[spatial_dim];
+    xla::int64 window_size = 0;
+    for (xla::int64 i = 0; i < output_size[spatial_dim]; ++i) {
+      auto range = AdaptivePoolRange(i, input_size, output_size[spatial_dim]);
+      window_size = std::max(window_size, range.second - range.first);
+    }
+    std::vector<xla::int64> gather_indices;
+    for (xla::int64 i = 0; i < output_size[spatial_dim]; ++i) {
+      auto range = AdaptivePoolRange(i, input_size, output_size[spatial_dim]);
+      for (xla::int64 k = 0; k < window_size; ++k) {
+        gather_indices.push_back(range.first +
+                                 (range.first + k < range.second ? k : 0));
+      }
+    }
+    xla::XlaOp gather_index = xla::ConvertElementType(
+        xla::ConstantR1<xla::int64>(builder, gather_indices), index_type);
+    auto gather_dim = [&](const xla::XlaOp& op, xla::int64 dim) {
+      std::vector<xla::int64> sizes = XlaHelpers::SizesOfXlaOp(op);
+      sizes[dim] = window_size;
+      sizes.insert(sizes.begin() + dim, output_size[spatial_dim]);
+      return xla::Reshape(xla::TorchIndexSelect(op, gather_index, dim), sizes);
+    };
+    xla::int64 dim = spatial_dim_off + 2 * spatial_dim;
+    windows = gather_dim(windows, dim);
+    indices = gather_dim(indices, 2 * spatial_dim);
+    output_dims.push_back(dim);
+    window_dims.push_back(dim + 1);
+  }
+  xla::Shape windows_shape = XlaHelpers::ShapeOfXlaOp(windows);
+  xla::PrimitiveType type = windows_shape.element_type();
+  xla::XlaOp result =
+      xla::Reduce(windows, xla::MinValue(builder, type),
+                  XlaHelpers::CreateMaxComputation(type), window_dims);
+  // The index of the maximum is the smallest one among the elements matching
+  // it, where NaN values always match.
+  std::vector<xla::int64> index_dims = xla::util::Iota<xla::int64>(
+      2 * spatial_dim_count, spatial_dim_off);
+  xla::XlaOp is_max = xla::Or(
+      xla::Eq(windows, xla::BroadcastInDim(result, windows_shape.dimensions(),
+                                           output_dims)),
+      xla::Ne(windows, windows));
+  xla::XlaOp candidates = xla::Select(
+      is_max,
+      xla::BroadcastInDim(indices, windows_shape.dimensions(), index_dims),
+      xla::Broadcast(xla::MaxValue(builder, index_type),
+                     windows_shape.dimensions()));
+  xla::XlaOp result_indices =
+      xla::Reduce(candidates, xla::MaxValue(builder, index_type),
+                  XlaHelpers::CreateMinComputation(index_type), window_dims);
+  return {result, result_indices};
+}
+
+xla::XlaOp BuildAdaptiveMaxPoolNdBackward(const xla::XlaOp& out_backprop,
+                                          const xla::XlaOp& input,
+                                          const xla::XlaOp& indices,
+                                          xla::int64 spatial_dim_count) {
+  return BuildMaxPoolNdBackwardWithIndices(out_backprop, input, indices,
+                                           spatial_dim_count);
 }
 
 }  // namespace torch_xla
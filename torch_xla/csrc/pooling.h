@@ -20,6 +20,28 @@ xla::XlaOp BuildMaxPoolNdBackward(
     tensorflow::gtl::ArraySlice<const xla::int64> stride,
     tensorflow::gtl::ArraySlice<const xla::int64> padding, bool ceil_mode);
 
+struct MaxPoolResult {
+  xla::XlaOp result;
+  // The flat spatial indices of the maximums within the input.
+  xla::XlaOp indices;
+};
+
+// Computes max pooling for the given input, along with the indices of the
+// maximums. The indices are found by comparing the pooling windows with their
+// maximum, one kernel offset at a time, so that no window search is needed.
+MaxPoolResult BuildMaxPoolNdWithIndices(
+    const xla::XlaOp& input, xla::int64 spatial_dim_count,
+    tensorflow::gtl::ArraySlice<const xla::int64> kernel_size,
+    tensorflow::gtl::ArraySlice<const xla::int64> stride,
+    tensorflow::gtl::ArraySlice<const xla::int64> padding, bool ceil_mode);
+
+// Computes the gradient for max pooling, scattering it at the indices returned
+// by the forward, instead of searching the windows maximums again.
+xla::XlaOp BuildMaxPoolNdBackwardWithIndices(const xla::XlaOp& out_backprop,
+                                             const xla::XlaOp& input,
+                                             const xla::XlaOp& indices,
+                                             xla::int64 spatial_dim_count);
+
 // Computes average pooling for the given input.
 xla::XlaOp BuildAvgPoolNd(
     const xla::XlaOp& input, xla::int64 spatial_dim_count,
@@ -37,19 +59,35 @@ xla::XlaOp BuildAvgPoolNdBackward(
     tensorflow::gtl::ArraySlice<const xla::int64> padding, bool ceil_mode,
     bool count_include_pad);
 
-// Computes adaptive average pooling for the given input and output size.
-xla::XlaOp BuildAdaptiveAvgPool2d(
-    const xla::XlaOp& input,
+// Computes adaptive average pooling for the given input and output size. When
+// the input sizes are not multiples of the output sizes, every spatial
+// dimension is contracted with a precomputed averaging matrix.
+xla::XlaOp BuildAdaptiveAvgPoolNd(
+    const xla::XlaOp& input, xla::int64 spatial_dim_count,
     tensorflow::gtl::ArraySlice<const xla::int64> output_size);
 
 // Computes the gradient for adaptive average pooling.
-xla::XlaOp BuildAdaptiveAvgPool2dBackward(const xla::XlaOp& out_backprop,
-                                          const xla::XlaOp& input);
+xla::XlaOp BuildAdaptiveAvgPoolNdBackward(const xla::XlaOp& out_backprop,
+                                          const xla::XlaOp& input,
+                                          xla::int64 spatial_dim_count);
+
+struct AdaptiveMaxPoolResult {
+  xla::XlaOp result;
+  // The flat spatial indices of the maximums within the input.
+  xla::XlaOp indices;
+};
 
-// Returns true if XLA lowering is supported for the given input and output size
-// combination.
-bool IsSupportedAdaptiveAvgPool2d(
-    tensorflow::gtl::ArraySlice<const xla::int64> input_size,
+// Computes adaptive max pooling for the given input and output size. The
+// pooled ranges are gathered using static indices, and then reduced.
+AdaptiveMaxPoolResult BuildAdaptiveMaxPoolNd(
+    const xla::XlaOp& input, xla::int64 spatial_dim_count,
     tensorflow::gtl::ArraySlice<const xla::int64> output_size);
 
+// Computes the gradient for adaptive max pooling, given the indices returned
+// by the forward.
+xla::XlaOp BuildAdaptiveMaxPoolNdBackward(const xla::XlaOp& out_backprop,
+                                          const xla::XlaOp& input,
+                                          const xla::XlaOp& indices,
+                                          xla::int64 spatial_dim_count);
+
 }  // namespace torch_xla
@@ -5,7 +5,40 @@
 #include <torch/csrc/utils/auto_gil.h>
 #include <torch/csrc/utils/python_strings.h>
 
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+#include "tensorflow/compiler/xla/xla_client/util.h"
+
 namespace torch_xla {
+namespace {
+
+size_t FramesHash(const std::vector<SourceLocation>& frames) {
+  size_t hash = 0;
+  for (auto& location : frames) {
+    hash = xla::util::MHash(hash, location.file, location.function,
+                            location.line);
+  }
+  return hash;
+}
+
+bool FramesEqual(const std::vector<SourceLocation>& frames1,
+                 const std::vector<SourceLocation>& frames2) {
+  if (frames1.size() != frames2.size()) {
+    return false;
+  }
+  for (size_t i = 0; i < frames1.size(); ++i) {
+    if (frames1[i].line != frames2[i].line ||
+        frames1[i].file != frames2[i].file ||
+        frames1[i].function != frames2[i].function) {
+      return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace
 
 c10::optional<SourceLocation> GetPythonFrameTop() {
   if (!Py_IsInitialized()) {
@@ -40,6 +73,27 @@ std::vector<SourceLocation> GetPythonFrames() {
   return frames;
 }
 
+const std::vector<SourceLocation>* InternFrames(
+    std::vector<SourceLocation> frames) {
+  using FramesTable =
+      std::unordered_multimap<size_t,
+                              std::unique_ptr<std::vector<SourceLocation>>>;
+  static std::mutex* lock = new std::mutex();
+  static FramesTable* table = new FramesTable();
+  size_t hash = FramesHash(frames);
+  std::lock_guard<std::mutex> guard(*lock);
+  auto range = table->equal_range(hash);
+  for (auto it = range.first; it != range.second; ++it) {
+    if (FramesEqual(*it->second, frames)) {
+      return it->second.get();
+    }
+  }
+  auto it = table->emplace(hash, std::unique_ptr<std::vector<SourceLocation>>(
+                                     new std::vector<SourceLocation>(
+                                         std::move(frames))));
+  return it->second.get();
+}
+
 std::ostream& operator<<(std::ostream& stream,
                          const std::vector<SourceLocation>& frames) {
   stream << "Python Frames:\n";
@@ -18,6 +18,12 @@ c10::optional<SourceLocation> GetPythonFrameTop();
 
 std::vector<SourceLocation> GetPythonFrames();
 
+// Returns the interned copy of the frames, which lives for the whole process.
+// IR nodes created at the same call site share the same frames, so interning
+// them keeps a single copy for each distinct stack.
+const std::vector<SourceLocation>* InternFrames(
+    std::vector<SourceLocation> frames);
+
 std::ostream& operator<<(std::ostream& stream,
                          const std::vector<SourceLocation>& frames);
 
@@ -0,0 +1,124 @@
+#include "torch_xla/csrc/quantization.h"
+
+#include <utility>
+#include <vector>
+
+#include "tensorflow/compiler/xla/client/lib/arithmetic.h"
+#include "tensorflow/compiler/xla/client/lib/constants.h"
+#include "tensorflow/compiler/xla/xla_client/debug_macros.h"
+#include "torch_xla/csrc/helpers.h"
+
+namespace torch_xla {
+namespace {
+
+// Converts the S32 accumulator into the given floating point type, scaled by
+// input_scale times the per channel scales on the channel dimension, and adds
+// the bias on the same dimension.
+xla::XlaOp Requantize(const xla::XlaOp& accumulator,
+                      const xla::XlaOp& weight_scales, const xla::XlaOp* bias,
+                      double input_scale, xla::int64 channel_dim,
+                      xla::PrimitiveType type) {
+  const xla::Shape& shape = XlaHelpers::ShapeOfXlaOp(accumulator);
+  xla::XlaOp scales = xla::ConvertElementType(weight_scales, type) *
+                      XlaHelpers::ScalarValue<double>(input_scale, type,
+                                                      accumulator.builder());
+  xla::XlaOp result =
+      xla::ConvertElementType(accumulator, type) *
+      xla::BroadcastInDim(scales, shape.dimensions(), {channel_dim});
+  if (bias != nullptr) {
+    result =
+        result + xla::BroadcastInDim(xla::ConvertElementType(*bias, type),
+                                     shape.dimensions(), {channel_dim});
+  }
+  return result;
+}
+
+void CheckQuantizedWeight(const xla::XlaOp& weight,
+                          const xla::XlaOp& weight_scales) {
+  const xla::Shape& weight_shape = XlaHelpers::ShapeOfXlaOp(weight);
+  const xla::Shape& scales_shape = XlaHelpers::ShapeOfXlaOp(weight_scales);
+  XLA_CHECK(weight_shape.element_type() == xla::PrimitiveType::S8 ||
+            weight_shape.element_type() == xla::PrimitiveType::S32)
+      << "Quantized weights must be int8: " << weight_shape;
+  XLA_CHECK(scales_shape.rank() == 1 &&
+            scales_shape.dimensions(0) == weight_shape.dimensions(0))
+      << "The weight scales must have one entry per output channel: "
+      << scales_shape << " vs. " << weight_shape;
+}
+
+}  // namespace
+
+xla::XlaOp BuildQuantize(const xla::XlaOp& input, double scale) {
+  xla::PrimitiveType type = XlaHelpers::TypeOfXlaOp(input);
+  xla::XlaBuilder* builder = input.builder();
+  xla::XlaOp scaled = xla::Round(
+      input / XlaHelpers::ScalarValue<double>(scale, type, builder));
+  return xla::ConvertElementType(
+      xla::Clamp(XlaHelpers::ScalarValue<double>(-127, type, builder), scaled,
+                 XlaHelpers::ScalarValue<double>(127, type, builder)),
+      xla::PrimitiveType::S32);
+}
+
+std::vector<xla::XlaOp> BuildDynamicQuantize(const xla::XlaOp& input,
+                                             xla::PrimitiveType element_type) {
+  xla::XlaBuilder* builder = input.builder();
+  xla::XlaOp values = xla::ConvertElementType(input, xla::PrimitiveType::F32);
+  xla::XlaOp zero = xla::Zero(builder, xla::PrimitiveType::F32);
+  xla::XlaOp max_abs = xla::ReduceAll(
+      xla::Abs(values), zero,
+      xla::CreateScalarMaxComputation(xla::PrimitiveType::F32, builder));
+  // An all zeros input gets a unit scale, to keep the division finite.
+  xla::XlaOp scale = xla::Select(
+      xla::Gt(max_abs, zero),
+      max_abs / XlaHelpers::ScalarValue<float>(127, builder),
+      xla::One(builder, xla::PrimitiveType::F32));
+  xla::XlaOp quantized = xla::Clamp(
+      XlaHelpers::ScalarValue<float>(-127, builder), xla::Round(values / scale),
+      XlaHelpers::ScalarValue<float>(127, builder));
+  return {xla::ConvertElementType(quantized, element_type), scale};
+}
+
+xla::XlaOp BuildQuantizedLinear(const xla::XlaOp& input,
+                                const xla::XlaOp& weight,
+                                const xla::XlaOp& weight_scales,
+                                const xla::XlaOp* bias, double input_scale) {
+  CheckQuantizedWeight(weight, weight_scales);
+  const xla::Shape& input_shape = XlaHelpers::ShapeOfXlaOp(input);
+  XLA_CHECK_GE(input_shape.rank(), 1) << input_shape;
+  xla::DotDimensionNumbers dimension_numbers;
+  dimension_numbers.add_lhs_contracting_dimensions(input_shape.rank() - 1);
+  dimension_numbers.add_rhs_contracting_dimensions(1);
+  xla::XlaOp accumulator = xla::DotGeneral(
+      BuildQuantize(input, input_scale),
+      xla::ConvertElementType(weight, xla::PrimitiveType::S32),
+      dimension_numbers);
+  return Requantize(accumulator, weight_scales, bias, input_scale,
+                    input_shape.rank() - 1, input_shape.element_type());
+}
+
+xla::XlaOp BuildQuantizedConvolution(
+    const xla::XlaOp& input, const xla::XlaOp& weight,
+    const xla::XlaOp& weight_scales, const xla::XlaOp* bias,
+    double input_scale, tensorflow::gtl::ArraySlice<const xla::int64> stride,
+    tensorflow::gtl::ArraySlice<const xla::int64> padding,
+    tensorflow::gtl::ArraySlice<const xla::int64> dilation,
+    xla::int64 groups) {
+  CheckQuantizedWeight(weight, weight_scales);
+  std::vector<std::pair<xla::int64, xla::int64>> dims_padding;
+  for (auto dim_padding : padding) {
+    dims_padding.emplace_back(dim_padding, dim_padding);
+  }
+  xla::XlaOp accumulator = xla::ConvGeneralDilated(
+      BuildQuantize(input, input_scale),
+      xla::ConvertElementType(weight, xla::PrimitiveType::S32), stride,
+      dims_padding,
+      /*lhs_dilation*/ {},
+      /*rhs_dilation*/ dilation,
+      /*dimension_numbers*/
+      xla::XlaBuilder::CreateDefaultConvDimensionNumbers(stride.size()),
+      /*feature_group_count*/ groups);
+  return Requantize(accumulator, weight_scales, bias, input_scale,
+                    /*channel_dim=*/1, XlaHelpers::TypeOfXlaOp(input));
+}
+
+}  // namespace torch_xla
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <vector>
+
+#include "tensorflow/compiler/xla/client/xla_builder.h"
+#include "tensorflow/core/lib/gtl/array_slice.h"
+
+namespace torch_xla {
+
+// Quantizes the floating point input to the symmetric int8 range, with the
+// given scale, returning a S32 tensor (the type the products are accumulated
+// with).
+xla::XlaOp BuildQuantize(const xla::XlaOp& input, double scale);
+
+// Quantizes the floating point input to the symmetric int8 range, with a scale
+// computed on device out of its maximum absolute value. Returns the quantized
+// values, converted to element_type, and the F32 scalar scale (the input is
+// approximated by values * scale).
+std::vector<xla::XlaOp> BuildDynamicQuantize(const xla::XlaOp& input,
+                                             xla::PrimitiveType element_type);
+
+// Computes the linear layer of the floating point input (quantized with
+// input_scale) with the S8 weight of shape [out_features, in_features], whose
+// rows are quantized with the per channel weight_scales. The products are
+// accumulated in S32, and requantized to the type of the input, before adding
+// the (optional) floating point bias.
+xla::XlaOp BuildQuantizedLinear(const xla::XlaOp& input,
+                                const xla::XlaOp& weight,
+                                const xla::XlaOp& weight_scales,
+                                const xla::XlaOp* bias, double input_scale);
+
+// Same as above, for the convolution of the input with the S8 weight of shape
+// [out_channels, in_channels / groups, ...], whose output channels are
+// quantized with the per channel weight_scales.
+xla::XlaOp BuildQuantizedConvolution(
+    const xla::XlaOp& input, const xla::XlaOp& weight,
+    const xla::XlaOp& weight_scales, const xla::XlaOp* bias,
+    double input_scale, tensorflow::gtl::ArraySlice<const xla::int64> stride,
+    tensorflow::gtl::ArraySlice<const xla::int64> padding,
+    tensorflow::gtl::ArraySlice<const xla::int64> dilation,
+    xla::int64 groups);
+
+}  // namespace torch_xla
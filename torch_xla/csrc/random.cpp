@@ -0,0 +1,156 @@
+#include "torch_xla/csrc/random.h"
+
+#include <array>
+#include <cmath>
+#include <limits>
+
+#include "tensorflow/compiler/xla/client/lib/constants.h"
+#include "tensorflow/compiler/xla/shape_util.h"
+#include "tensorflow/compiler/xla/xla_client/debug_macros.h"
+#include "tensorflow/compiler/xla/xla_client/util.h"
+
+namespace torch_xla {
+namespace {
+
+using RngPair = std::array<xla::XlaOp, 2>;
+
+xla::XlaOp U32Constant(xla::XlaBuilder* builder, xla::uint32 value) {
+  return xla::ConstantR0<xla::uint32>(builder, value);
+}
+
+xla::XlaOp RotateLeft(const xla::XlaOp& value, xla::uint32 distance) {
+  xla::XlaBuilder* builder = value.builder();
+  return xla::Or(
+      xla::ShiftLeft(value, U32Constant(builder, distance)),
+      xla::ShiftRightLogical(value, U32Constant(builder, 32 - distance)));
+}
+
+// The Threefry-2x32 block function, from "Parallel Random Numbers: As Easy as
+// 1, 2, 3" (Salmon et al., 2011).
+RngPair Threefry2x32(const RngPair& key, const RngPair& counter) {
+  static const xla::uint32 kRotations[2][4] = {{13, 15, 26, 6},
+                                               {17, 29, 16, 24}};
+  xla::XlaBuilder* builder = key[0].builder();
+  std::array<xla::XlaOp, 3> schedule = {
+      key[0], key[1],
+      xla::Xor(xla::Xor(key[0], key[1]), U32Constant(builder, 0x1BD11BDA))};
+  RngPair x = {counter[0] + schedule[0], counter[1] + schedule[1]};
+  for (xla::uint32 i = 0; i < 5; ++i) {
+    for (auto rotation : kRotations[i % 2]) {
+      x[0] = x[0] + x[1];
+      x[1] = xla::Xor(RotateLeft(x[1], rotation), x[0]);
+    }
+    x[0] = x[0] + schedule[(i + 1) % 3];
+    x[1] = x[1] + schedule[(i + 2) % 3] + U32Constant(builder, i + 1);
+  }
+  return x;
+}
+
+RngPair SeedToKey(const xla::XlaOp& seed) {
+  xla::XlaBuilder* builder = seed.builder();
+  xla::XlaOp seed64 = xla::BitcastConvertType(
+      xla::ConvertElementType(seed, xla::PrimitiveType::S64),
+      xla::PrimitiveType::U64);
+  xla::XlaOp low = xla::And(
+      seed64, xla::ConstantR0<xla::uint64>(builder, 0xffffffffULL));
+  xla::XlaOp high =
+      xla::ShiftRightLogical(seed64, xla::ConstantR0<xla::uint64>(builder, 32));
+  return {xla::ConvertElementType(low, xla::PrimitiveType::U32),
+          xla::ConvertElementType(high, xla::PrimitiveType::U32)};
+}
+
+// Maps U32 random bits to F32 values uniformly distributed within [0, 1).
+xla::XlaOp BitsToUnit(const xla::XlaOp& bits) {
+  xla::XlaBuilder* builder = bits.builder();
+  // Put 23 random bits in the mantissa of a float within [1, 2).
+  xla::XlaOp mantissa =
+      xla::Or(xla::ShiftRightLogical(bits, U32Constant(builder, 9)),
+              U32Constant(builder, 0x3f800000));
+  return xla::BitcastConvertType(mantissa, xla::PrimitiveType::F32) -
+         xla::One(builder, xla::PrimitiveType::F32);
+}
+
+// Returns the two halves of the random bits for twice the given dimensions,
+// reshaped to dims.
+RngPair RngUniformBitsPair(const xla::XlaOp& seed,
+                           tensorflow::gtl::ArraySlice<const xla::int64> dims) {
+  xla::int64 size = xla::util::Multiply<xla::int64>(dims);
+  xla::XlaOp bits = RngUniformBits(seed, {2, size});
+  return {xla::Reshape(xla::SliceInDim(bits, 0, 1, 1, 0), dims),
+          xla::Reshape(xla::SliceInDim(bits, 1, 2, 1, 0), dims)};
+}
+
+}  // namespace
+
+xla::XlaOp RngUniformBits(const xla::XlaOp& seed,
+                          tensorflow::gtl::ArraySlice<const xla::int64> dims) {
+  xla::XlaBuilder* builder = seed.builder();
+  xla::int64 size = xla::util::Multiply<xla::int64>(dims);
+  // Every block produces two outputs, so only half of the counters are needed.
+  xla::int64 num_blocks = (size + 1) / 2;
+  xla::XlaOp counter = xla::Iota(builder, xla::PrimitiveType::U32, num_blocks);
+  RngPair bits = Threefry2x32(
+      SeedToKey(seed),
+      {counter, xla::Broadcast(U32Constant(builder, 0), {num_blocks})});
+  xla::XlaOp flat_bits = xla::ConcatInDim(builder, {bits[0], bits[1]}, 0);
+  if (2 * num_blocks != size) {
+    flat_bits = xla::SliceInDim(flat_bits, 0, size, 1, 0);
+  }
+  return xla::Reshape(flat_bits, dims);
+}
+
+xla::XlaOp RngUniform(const xla::XlaOp& seed, const xla::Shape& shape,
+                      const xla::XlaOp& minval, const xla::XlaOp& maxval) {
+  xla::XlaOp unit = BitsToUnit(RngUniformBits(seed, shape.dimensions()));
+  xla::XlaOp low = xla::ConvertElementType(minval, xla::PrimitiveType::F32);
+  xla::XlaOp high = xla::ConvertElementType(maxval, xla::PrimitiveType::F32);
+  return xla::ConvertElementType(unit * (high - low) + low,
+                                 shape.element_type());
+}
+
+xla::XlaOp RngNormal(const xla::XlaOp& seed, const xla::Shape& shape,
+                     const xla::XlaOp& mean, const xla::XlaOp& std) {
+  xla::XlaBuilder* builder = seed.builder();
+  RngPair bits = RngUniformBitsPair(seed, shape.dimensions());
+  // The radius uses 1 - u, within (0, 1], so that its log is finite.
+  xla::XlaOp radius_unit =
+      xla::One(builder, xla::PrimitiveType::F32) - BitsToUnit(bits[0]);
+  xla::XlaOp angle_unit = BitsToUnit(bits[1]);
+  xla::XlaOp radius = xla::Sqrt(xla::ConstantR0<float>(builder, -2.0f) *
+                                xla::Log(radius_unit));
+  xla::XlaOp angle = xla::ConstantR0<float>(builder, 2.0f * M_PI) * angle_unit;
+  xla::XlaOp normal = radius * xla::Cos(angle);
+  xla::XlaOp xla_mean = xla::ConvertElementType(mean, xla::PrimitiveType::F32);
+  xla::XlaOp xla_std = xla::ConvertElementType(std, xla::PrimitiveType::F32);
+  return xla::ConvertElementType(normal * xla_std + xla_mean,
+                                 shape.element_type());
+}
+
+xla::XlaOp RngUniformInt(const xla::XlaOp& seed, const xla::Shape& shape,
+                         xla::int64 from, xla::int64 to) {
+  XLA_CHECK_LT(from, to) << "Empty random range";
+  xla::XlaBuilder* builder = seed.builder();
+  xla::uint64 range =
+      static_cast<xla::uint64>(to) - static_cast<xla::uint64>(from);
+  xla::XlaOp offset;
+  if (range <= std::numeric_limits<xla::uint32>::max()) {
+    xla::XlaOp bits = RngUniformBits(seed, shape.dimensions());
+    offset = xla::ConvertElementType(
+        xla::Rem(bits, U32Constant(builder, static_cast<xla::uint32>(range))),
+        xla::PrimitiveType::S64);
+  } else {
+    RngPair bits = RngUniformBitsPair(seed, shape.dimensions());
+    xla::XlaOp high = xla::ConvertElementType(bits[0], xla::PrimitiveType::U64);
+    xla::XlaOp low = xla::ConvertElementType(bits[1], xla::PrimitiveType::U64);
+    xla::XlaOp bits64 = xla::Or(
+        xla::ShiftLeft(high, xla::ConstantR0<xla::uint64>(builder, 32)), low);
+    offset = xla::BitcastConvertType(
+        xla::Rem(bits64, xla::ConstantR0<xla::uint64>(builder, range)),
+        xla::PrimitiveType::S64);
+  }
+  return xla::ConvertElementType(
+      offset + xla::ConstantR0<xla::int64>(builder, from),
+      shape.element_type());
+}
+
+}  // namespace torch_xla
@@ -0,0 +1,34 @@
+#pragma once
+
+#include "tensorflow/compiler/xla/client/xla_builder.h"
+#include "tensorflow/compiler/xla/types.h"
+#include "tensorflow/core/lib/gtl/array_slice.h"
+
+namespace torch_xla {
+
+// Returns uniformly distributed U32 random bits with the given dimensions. The
+// bits are computed by the stateless, counter based, Threefry-2x32 generator
+// (20 rounds), keyed by the integer seed scalar, so the same seed always
+// produces the same values, on every device.
+xla::XlaOp RngUniformBits(const xla::XlaOp& seed,
+                          tensorflow::gtl::ArraySlice<const xla::int64> dims);
+
+// Returns values uniformly distributed within [minval, maxval), with the
+// shape and the element type of shape. The values are computed in F32 (from
+// 23 random bits) and then converted to the shape type.
+xla::XlaOp RngUniform(const xla::XlaOp& seed, const xla::Shape& shape,
+                      const xla::XlaOp& minval, const xla::XlaOp& maxval);
+
+// Returns values normally distributed with the given mean and standard
+// deviation, with the shape and the element type of shape. Every value is
+// computed in F32 by the Box-Muller transform of two uniform values.
+xla::XlaOp RngNormal(const xla::XlaOp& seed, const xla::Shape& shape,
+                     const xla::XlaOp& mean, const xla::XlaOp& std);
+
+// Returns integer values uniformly distributed within [from, to), with the
+// shape and the element type of shape. The values are computed from 32 random
+// bits, or 64 if the range does not fit 32 bits.
+xla::XlaOp RngUniformInt(const xla::XlaOp& seed, const xla::Shape& shape,
+                         xla::int64 from, xla::int64 to);
+
+}  // namespace torch_xla
@@ -1,10 +1,17 @@
 #include "torch_xla/csrc/reduction.h"
 
+#include <algorithm>
 #include <cmath>
+#include <set>
 
+#include "absl/strings/str_split.h"
 #include "tensorflow/compiler/xla/client/lib/arithmetic.h"
 #include "tensorflow/compiler/xla/literal_util.h"
+#include "tensorflow/compiler/xla/primitive_util.h"
+#include "tensorflow/compiler/xla/shape_util.h"
 #include "tensorflow/compiler/xla/xla_client/debug_macros.h"
+#include "tensorflow/compiler/xla/xla_client/sys_util.h"
+#include "torch_xla/csrc/convert_ops.h"
 #include "torch_xla/csrc/helpers.h"
 #include "torch_xla/csrc/tensor_util.h"
 
@@ -67,20 +74,28 @@ xla::XlaOp CreateSummation(
     tensorflow::gtl::ArraySlice<const xla::int64> dimensions,
     bool keep_reduced_dimensions, bool scale) {
   xla::Shape shape = XlaHelpers::ShapeOfXlaOp(input);
+  xla::PrimitiveType accumulation_type =
+      GetAccumulationType(shape.element_type(), scale ? "mean" : "sum");
   xla::XlaOp init_value =
-      XlaHelpers::ScalarValue<float>(0, shape.element_type(), input.builder());
+      XlaHelpers::ScalarValue<float>(0, accumulation_type, input.builder());
   ReductionInfo rinfo =
       GetReductionInfo(shape, dimensions, keep_reduced_dimensions);
+  // The conversions get fused within the reduction, so the input is still
+  // read in its own type.
   xla::XlaOp result = xla::Reduce(
-      input, init_value, XlaHelpers::CreateAddComputation(shape.element_type()),
+      MaybeConvertTo(input, shape.element_type(), accumulation_type,
+                     /*device=*/nullptr),
+      init_value, XlaHelpers::CreateAddComputation(accumulation_type),
       dimensions);
   if (scale) {
     xla::XlaOp scale = XlaHelpers::ScalarValue<float>(
         rinfo.element_count > 0 ? 1.0f / static_cast<float>(rinfo.element_count)
                                 : NAN,
-        shape.element_type(), input.builder());
+        accumulation_type, input.builder());
     result = xla::Mul(result, scale);
   }
+  result = MaybeConvertTo(result, accumulation_type, shape.element_type(),
+                          /*device=*/nullptr);
   if (keep_reduced_dimensions) {
     result = xla::Reshape(result, rinfo.new_dimensions);
   }
@@ -105,20 +120,73 @@ xla::XlaOp CreateProduct(
   return result;
 }
 
+// Runs the arg_fn reduction with the narrowest index type for the dimension
+// size, and widens the result to the aten Long type.
+template <typename F>
+xla::XlaOp BuildArgIndex(const F& arg_fn, const xla::XlaOp& operand,
+                         xla::int64 dim_size, xla::int64 dim) {
+  xla::PrimitiveType result_type =
+      GetDevicePrimitiveType(xla::PrimitiveType::S64, /*device=*/nullptr);
+  xla::PrimitiveType index_type = XlaHelpers::GetIndexType(dim_size);
+  if (xla::primitive_util::BitWidth(index_type) >=
+      xla::primitive_util::BitWidth(result_type)) {
+    return arg_fn(operand, result_type, dim);
+  }
+  return xla::ConvertElementType(arg_fn(operand, index_type, dim), result_type);
+}
+
 }  // namespace
 
+xla::PrimitiveType GetAccumulationType(xla::PrimitiveType type,
+                                       const std::string& kind) {
+  static const std::set<std::string>* narrow_kinds = []() {
+    std::string env =
+        xla::sys_util::GetEnvString("XLA_NARROW_ACCUMULATION_OPS", "");
+    std::set<std::string> kinds = absl::StrSplit(env, ',', absl::SkipEmpty());
+    return new std::set<std::string>(std::move(kinds));
+  }();
+  if (type != xla::PrimitiveType::BF16 && type != xla::PrimitiveType::F16) {
+    return type;
+  }
+  return narrow_kinds->count(kind) > 0 || narrow_kinds->count("all") > 0
+             ? type
+             : xla::PrimitiveType::F32;
+}
+
 xla::XlaOp BuildCumulativeComputation(const xla::XlaOp& input, xla::int64 dim,
                                       const xla::XlaComputation& reducer,
                                       const xla::XlaOp& init) {
+  static const xla::int64 scan_min_size =
+      xla::sys_util::GetEnvInt("XLA_CUMULATIVE_SCAN_MIN_SIZE", 128);
   xla::Shape input_shape = XlaHelpers::ShapeOfXlaOp(input);
+  xla::int64 dim_size = input_shape.dimensions(dim);
   std::vector<xla::int64> window_strides(input_shape.rank(), 1);
   std::vector<xla::int64> window_dims(input_shape.rank(), 1);
-  window_dims[dim] = input_shape.dimensions(dim);
   std::vector<std::pair<xla::int64, xla::int64>> padding(input_shape.rank());
-  padding[dim].first = input_shape.dimensions(dim) - 1;
-  return xla::ReduceWindowWithGeneralPadding(
-      input, init, reducer, window_dims, window_strides,
-      /*base_dilations=*/{}, /*window_dilations=*/{}, padding);
+  if (dim_size < scan_min_size) {
+    // A single window spanning the whole dimension, which takes O(N^2) work.
+    window_dims[dim] = dim_size;
+    padding[dim].first = dim_size - 1;
+    return xla::ReduceWindowWithGeneralPadding(
+        input, init, reducer, window_dims, window_strides,
+        /*base_dilations=*/{}, /*window_dilations=*/{}, padding);
+  }
+  // Hillis-Steele parallel prefix scan: at every step, each element gets
+  // combined with the one which is offset positions before it, for offsets
+  // doubling up to the dimension size. A two element window with an offset
+  // dilation does that within a single ReduceWindow, for O(N log N) work and
+  // O(log N) depth.
+  window_dims[dim] = 2;
+  std::vector<xla::int64> window_dilations(input_shape.rank(), 1);
+  xla::XlaOp result = input;
+  for (xla::int64 offset = 1; offset < dim_size; offset *= 2) {
+    window_dilations[dim] = offset;
+    padding[dim].first = offset;
+    result = xla::ReduceWindowWithGeneralPadding(
+        result, init, reducer, window_dims, window_strides,
+        /*base_dilations=*/{}, window_dilations, padding);
+  }
+  return result;
 }
 
 xla::XlaOp BuildMean(const xla::XlaOp& input,
@@ -141,6 +209,22 @@ xla::XlaOp BuildProd(const xla::XlaOp& input,
   return CreateProduct(input, dimensions, keep_reduced_dimensions);
 }
 
+xla::Shape GetReductionShape(
+    const xla::Shape& shape,
+    tensorflow::gtl::ArraySlice<const xla::int64> dimensions,
+    bool keep_reduced_dimensions) {
+  std::vector<xla::int64> new_dimensions;
+  for (xla::int64 i = 0; i < shape.rank(); ++i) {
+    if (std::find(dimensions.begin(), dimensions.end(), i) ==
+        dimensions.end()) {
+      new_dimensions.push_back(shape.dimensions(i));
+    } else if (keep_reduced_dimensions) {
+      new_dimensions.push_back(1);
+    }
+  }
+  return xla::ShapeUtil::MakeShape(shape.element_type(), new_dimensions);
+}
+
 xla::XlaOp BuildMaxInDim(const xla::XlaOp& input, xla::int64 dim,
                          bool keep_reduced_dimensions) {
   xla::Shape shape = XlaHelpers::ShapeOfXlaOp(input);
@@ -183,9 +267,11 @@ xla::XlaOp BuildArgMax(const xla::XlaOp& input, xla::int64 dim, bool keepdim) {
     operand = xla::Reshape(operand, {xla::ShapeUtil::ElementsIn(shape)});
     shape = XlaHelpers::ShapeOfXlaOp(operand);
   }
-  xla::XlaOp result = xla::ArgMaxTwoPass(
-      operand,
-      GetDevicePrimitiveType(xla::PrimitiveType::S64, /*device=*/nullptr), dim);
+  xla::XlaOp result = BuildArgIndex(
+      [](const xla::XlaOp& op, xla::PrimitiveType type, xla::int64 axis) {
+        return xla::ArgMaxTwoPass(op, type, axis);
+      },
+      operand, shape.dimensions(dim), dim);
   if (keepdim) {
     auto dimensions = xla::util::ToVector<xla::int64>(shape.dimensions());
     dimensions[dim] = 1;
@@ -202,9 +288,11 @@ xla::XlaOp BuildArgMin(const xla::XlaOp& input, xla::int64 dim, bool keepdim) {
     operand = xla::Reshape(operand, {xla::ShapeUtil::ElementsIn(shape)});
     shape = XlaHelpers::ShapeOfXlaOp(operand);
   }
-  xla::XlaOp result = xla::ArgMinTwoPass(
-      operand,
-      GetDevicePrimitiveType(xla::PrimitiveType::S64, /*device=*/nullptr), dim);
+  xla::XlaOp result = BuildArgIndex(
+      [](const xla::XlaOp& op, xla::PrimitiveType type, xla::int64 axis) {
+        return xla::ArgMinTwoPass(op, type, axis);
+      },
+      operand, shape.dimensions(dim), dim);
   if (keepdim) {
     auto dimensions = xla::util::ToVector<xla::int64>(shape.dimensions());
     dimensions[dim] = 1;
@@ -1,10 +1,20 @@
 #pragma once
 
+#include <string>
+
 #include "tensorflow/compiler/xla/client/xla_builder.h"
 #include "tensorflow/core/lib/gtl/array_slice.h"
 
 namespace torch_xla {
 
+// Returns the type the reductions of the given kind ("sum", "mean", "softmax"
+// or "log_softmax") accumulate inputs of the given type in. The BF16 and F16
+// types accumulate in F32, and the results are written back in the input type,
+// unless the kind (or "all") is listed in the comma separated
+// XLA_NARROW_ACCUMULATION_OPS environment variable.
+xla::PrimitiveType GetAccumulationType(xla::PrimitiveType type,
+                                       const std::string& kind);
+
 // Builds a mean by reducing all the dimensions listed in dimensions. If
 // keep_reduced_dimensions is true, the reduced dimensions will be retained,
 // with value 1.
@@ -19,6 +29,13 @@ xla::XlaOp BuildSum(const xla::XlaOp& input,
                     tensorflow::gtl::ArraySlice<const xla::int64> dimensions,
                     bool keep_reduced_dimensions);
 
+// Returns the shape of the result of BuildSum(), BuildMean() or BuildProd()
+// over an input of the given shape, without building any XLA operation.
+xla::Shape GetReductionShape(
+    const xla::Shape& shape,
+    tensorflow::gtl::ArraySlice<const xla::int64> dimensions,
+    bool keep_reduced_dimensions);
+
 // Builds the max of all values by reducing in the given dimension. If
 // keep_reduced_dimensions is true, the reduced dimension will be retained, with
 // value 1.
@@ -45,7 +62,8 @@ xla::XlaOp BuildProd(const xla::XlaOp& input,
                      bool keep_reduced_dimensions);
 
 // Compute the cumulative computation specified by "reducer" and "init" in the
-// given dimension "dim".
+// given dimension "dim". Dimensions of at least XLA_CUMULATIVE_SCAN_MIN_SIZE
+// elements use a log-depth parallel prefix scan.
 xla::XlaOp BuildCumulativeComputation(const xla::XlaOp& input, xla::int64 dim,
                                       const xla::XlaComputation& reducer,
                                       const xla::XlaOp& init);
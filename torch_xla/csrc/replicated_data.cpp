@@ -0,0 +1,74 @@
+#include "torch_xla/csrc/replicated_data.h"
+
+#include <algorithm>
+
+#include "tensorflow/compiler/xla/xla_client/debug_macros.h"
+#include "tensorflow/compiler/xla/xla_client/metrics.h"
+#include "torch_xla/csrc/tensor_util.h"
+
+namespace torch_xla {
+
+ReplicatedData* ReplicatedData::Get() {
+  static ReplicatedData* replicated_data = new ReplicatedData();
+  return replicated_data;
+}
+
+void ReplicatedData::Register(
+    const std::vector<xla::ComputationClient::DataPtr>& replicas,
+    size_t master_index) {
+  Entry entry;
+  entry.master = replicas[master_index];
+  for (size_t i = 0; i < replicas.size(); ++i) {
+    entry.replicas.push_back(i == master_index ? nullptr : replicas[i]);
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  entries_[replicas[master_index]->unique_id()] = std::move(entry);
+  if (entries_.size() >= cleanup_size_) {
+    RemoveExpiredEntries();
+  }
+}
+
+std::vector<xla::ComputationClient::DataPtr> ReplicatedData::GetReplicas(
+    const xla::ComputationClient::DataPtr& master,
+    const std::vector<std::string>& devices, size_t master_index) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = entries_.find(master->unique_id());
+    if (it != entries_.end()) {
+      XLA_CHECK_EQ(it->second.replicas.size(), devices.size());
+      std::vector<xla::ComputationClient::DataPtr> replicas =
+          it->second.replicas;
+      replicas[master_index] = master;
+      return replicas;
+    }
+  }
+  XLA_COUNTER("ReplicatedDataBroadcasts", 1);
+  at::Tensor tensor = XlaDataToTensors(
+      {master}, {TensorTypeFromXlaType(master->shape().element_type())})[0];
+  std::vector<std::string> replica_devices;
+  for (size_t i = 0; i < devices.size(); ++i) {
+    if (i != master_index) {
+      replica_devices.push_back(devices[i]);
+    }
+  }
+  std::vector<xla::ComputationClient::DataPtr> replica_data = CreateTensorsData(
+      std::vector<at::Tensor>(replica_devices.size(), tensor), replica_devices);
+  replica_data.insert(replica_data.begin() + master_index, master);
+  Register(replica_data, master_index);
+  return replica_data;
+}
+
+void ReplicatedData::RemoveExpiredEntries() {
+  for (auto it = entries_.begin(); it != entries_.end();) {
+    if (it->second.master.expired()) {
+      it = entries_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+  // Sweeping only once the map doubled in size keeps the registration cost
+  // amortized constant.
+  cleanup_size_ = std::max<size_t>(2 * entries_.size(), 64);
+}
+
+}  // namespace torch_xla
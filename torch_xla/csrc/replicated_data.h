@@ -0,0 +1,56 @@
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "tensorflow/compiler/xla/types.h"
+#include "tensorflow/compiler/xla/xla_client/computation_client.h"
+
+namespace torch_xla {
+
+// Supports the single thread (SPMD) replicated execution, where one thread
+// traces the step graph on the master device, and the graph then runs on all
+// the replication devices at once. The tensors only hold the device data of
+// the master replica, and this class tracks the data of the other replicas,
+// indexed by the master one. Master data without replicas (like the one of
+// the model parameters, or of the constants) is broadcast to the other
+// replicas the first time they are needed.
+class ReplicatedData {
+ public:
+  static ReplicatedData* Get();
+
+  bool IsEnabled() const { return enabled_; }
+
+  void SetEnabled(bool enabled) { enabled_ = enabled; }
+
+  // Records replicas[i] as the data of the i-th replication device, for the
+  // replicas[master_index] master data.
+  void Register(const std::vector<xla::ComputationClient::DataPtr>& replicas,
+                size_t master_index);
+
+  // Returns the per device data of the master data, which lives on
+  // devices[master_index].
+  std::vector<xla::ComputationClient::DataPtr> GetReplicas(
+      const xla::ComputationClient::DataPtr& master,
+      const std::vector<std::string>& devices, size_t master_index);
+
+ private:
+  struct Entry {
+    std::weak_ptr<xla::ComputationClient::Data> master;
+    // The replicas by device index, without the master one, which would
+    // otherwise be kept alive by the entry.
+    std::vector<xla::ComputationClient::DataPtr> replicas;
+  };
+
+  void RemoveExpiredEntries();
+
+  bool enabled_ = false;
+  std::mutex mutex_;
+  std::unordered_map<xla::int64, Entry> entries_;
+  size_t cleanup_size_ = 64;
+};
+
+}  // namespace torch_xla
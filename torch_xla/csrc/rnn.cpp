@@ -0,0 +1,425 @@
+#include "torch_xla/csrc/rnn.h"
+
+#include <functional>
+
+#include "tensorflow/compiler/xla/client/lib/constants.h"
+#include "tensorflow/compiler/xla/shape_util.h"
+#include "tensorflow/compiler/xla/xla_client/debug_macros.h"
+#include "torch_xla/csrc/elementwise.h"
+#include "torch_xla/csrc/helpers.h"
+
+namespace torch_xla {
+namespace {
+
+// Contracts the lhs_dim of the rank 2 lhs with the rhs_dim of the rank 2 rhs.
+xla::XlaOp Dot(const xla::XlaOp& lhs, const xla::XlaOp& rhs,
+               xla::int64 lhs_dim, xla::int64 rhs_dim) {
+  xla::PrecisionConfig precision_config =
+      XlaHelpers::BuildPrecisionConfig(XlaHelpers::mat_mul_precision());
+  xla::DotDimensionNumbers dimension_numbers;
+  dimension_numbers.add_lhs_contracting_dimensions(lhs_dim);
+  dimension_numbers.add_rhs_contracting_dimensions(rhs_dim);
+  return xla::DotGeneral(lhs, rhs, dimension_numbers, &precision_config);
+}
+
+// Computes input * weight^T + bias, for a [N, K] input and a [G, K] weight.
+xla::XlaOp Projection(const xla::XlaOp& input, const xla::XlaOp& weight,
+                      const xla::XlaOp& bias) {
+  return xla::Add(Dot(input, weight, 1, 1), bias, {1});
+}
+
+xla::XlaOp SumRows(const xla::XlaOp& input) {
+  xla::PrimitiveType type = XlaHelpers::ShapeOfXlaOp(input).element_type();
+  return xla::Reduce(input, xla::Zero(input.builder(), type),
+                     XlaHelpers::CreateAddComputation(type), {0});
+}
+
+xla::XlaOp One(const xla::XlaOp& like) {
+  return xla::One(like.builder(),
+                  XlaHelpers::ShapeOfXlaOp(like).element_type());
+}
+
+// Returns the index-th of the [B, H] gates stacked in the last dimension.
+xla::XlaOp Gate(const xla::XlaOp& gates, xla::int64 hidden_size,
+                xla::int64 index) {
+  return xla::SliceInDim(gates, index * hidden_size, (index + 1) * hidden_size,
+                         1, 1);
+}
+
+xla::int64 HiddenSize(const xla::XlaOp& hx) {
+  return XlaHelpers::ShapeOfXlaOp(hx).dimensions(1);
+}
+
+// Reshapes a [T, B, X] tensor into a [T * B, X] one.
+xla::XlaOp FlattenSteps(const xla::XlaOp& input) {
+  xla::Shape shape = XlaHelpers::ShapeOfXlaOp(input);
+  return xla::Reshape(input, {shape.dimensions(0) * shape.dimensions(1),
+                              shape.dimensions(2)});
+}
+
+xla::XlaOp UnflattenSteps(const xla::XlaOp& input, xla::int64 num_steps) {
+  xla::Shape shape = XlaHelpers::ShapeOfXlaOp(input);
+  return xla::Reshape(input, {num_steps, shape.dimensions(0) / num_steps,
+                              shape.dimensions(1)});
+}
+
+// Returns the [B, X] slice of the step within a [T, B, X] tensor.
+xla::XlaOp GetStep(const xla::XlaOp& stacked, const xla::XlaOp& step) {
+  xla::Shape shape = XlaHelpers::ShapeOfXlaOp(stacked);
+  xla::XlaOp zero = XlaHelpers::ScalarValue<xla::int32>(0, step.builder());
+  xla::XlaOp slice =
+      xla::DynamicSlice(stacked, {step, zero, zero},
+                        {1, shape.dimensions(1), shape.dimensions(2)});
+  return xla::Reshape(slice, {shape.dimensions(1), shape.dimensions(2)});
+}
+
+xla::XlaOp SetStep(const xla::XlaOp& stacked, const xla::XlaOp& value,
+                   const xla::XlaOp& step) {
+  xla::Shape shape = XlaHelpers::ShapeOfXlaOp(value);
+  xla::XlaOp zero = XlaHelpers::ScalarValue<xla::int32>(0, step.builder());
+  return xla::DynamicUpdateSlice(
+      stacked,
+      xla::Reshape(value, {1, shape.dimensions(0), shape.dimensions(1)}),
+      {step, zero, zero});
+}
+
+xla::XlaOp ZerosSteps(const xla::XlaOp& like, xla::int64 num_steps,
+                      xla::int64 size) {
+  xla::Shape shape = XlaHelpers::ShapeOfXlaOp(like);
+  return xla::Broadcast(xla::Zero(like.builder(), shape.element_type()),
+                        {num_steps, shape.dimensions(0), size});
+}
+
+// Returns the [T, B, X] states entering every step, which are the initial one
+// followed by the ones output by the first T - 1 steps.
+xla::XlaOp PreviousStates(const xla::XlaOp& initial, const xla::XlaOp& states) {
+  xla::Shape shape = XlaHelpers::ShapeOfXlaOp(states);
+  return xla::ConcatInDim(
+      states.builder(),
+      {xla::Reshape(initial, {1, shape.dimensions(1), shape.dimensions(2)}),
+       xla::SliceInDim(states, 0, shape.dimensions(0) - 1, 1, 0)},
+      0);
+}
+
+using TimeStepFn = std::function<std::vector<xla::XlaOp>(
+    const xla::XlaOp&, const std::vector<xla::XlaOp>&)>;
+
+// Runs step_fn for the T steps within an XLA While, whose state is the step
+// counter followed by the given ones. The step_fn receives the S32 index of
+// the step (walked from T - 1 down to 0 if reverse is true) and the current
+// state, and returns the next one. Returns the final state.
+std::vector<xla::XlaOp> BuildTimeLoop(const std::vector<xla::XlaOp>& state,
+                                      xla::int64 num_steps, bool reverse,
+                                      const TimeStepFn& step_fn) {
+  std::vector<xla::Shape> shapes(
+      {xla::ShapeUtil::MakeShape(xla::PrimitiveType::S32, {})});
+  for (auto& op : state) {
+    shapes.push_back(XlaHelpers::ShapeOfXlaOp(op));
+  }
+  xla::Shape state_shape = xla::ShapeUtil::MakeTupleShape(shapes);
+
+  xla::XlaBuilder cond_builder("RnnCondition");
+  xla::XlaOp cond_state =
+      xla::Parameter(&cond_builder, 0, state_shape, "state");
+  xla::Lt(xla::GetTupleElement(cond_state, 0),
+          XlaHelpers::ScalarValue<xla::int32>(num_steps, &cond_builder));
+
+  xla::XlaBuilder body_builder("RnnBody");
+  xla::XlaOp body_state =
+      xla::Parameter(&body_builder, 0, state_shape, "state");
+  xla::XlaOp counter = xla::GetTupleElement(body_state, 0);
+  xla::XlaOp step =
+      reverse ? XlaHelpers::ScalarValue<xla::int32>(num_steps - 1,
+                                                    &body_builder) -
+                    counter
+              : counter;
+  std::vector<xla::XlaOp> step_state;
+  for (size_t i = 0; i < state.size(); ++i) {
+    step_state.push_back(xla::GetTupleElement(body_state, 1 + i));
+  }
+  std::vector<xla::XlaOp> next_state = step_fn(step, step_state);
+  XLA_CHECK_EQ(next_state.size(), state.size());
+  next_state.insert(
+      next_state.begin(),
+      counter + XlaHelpers::ScalarValue<xla::int32>(1, &body_builder));
+  xla::Tuple(&body_builder, next_state);
+
+  xla::XlaBuilder* builder = state.front().builder();
+  std::vector<xla::XlaOp> init_state(
+      {XlaHelpers::ScalarValue<xla::int32>(0, builder)});
+  init_state.insert(init_state.end(), state.begin(), state.end());
+  xla::XlaOp loop = xla::While(ConsumeValue(cond_builder.Build()),
+                               ConsumeValue(body_builder.Build()),
+                               xla::Tuple(builder, init_state));
+  std::vector<xla::XlaOp> results;
+  for (size_t i = 0; i < state.size(); ++i) {
+    results.push_back(xla::GetTupleElement(loop, 1 + i));
+  }
+  return results;
+}
+
+// Applies the LSTM gates to the [B, 4H] pre-activations.
+LstmCellResult LstmStep(const xla::XlaOp& preactivations,
+                        const xla::XlaOp& cx) {
+  xla::int64 hidden_size = HiddenSize(cx);
+  xla::XlaOp i = BuildSigmoid(Gate(preactivations, hidden_size, 0));
+  xla::XlaOp f = BuildSigmoid(Gate(preactivations, hidden_size, 1));
+  xla::XlaOp g = xla::Tanh(Gate(preactivations, hidden_size, 2));
+  xla::XlaOp o = BuildSigmoid(Gate(preactivations, hidden_size, 3));
+  xla::XlaOp c = f * cx + i * g;
+  return {o * xla::Tanh(c), c,
+          xla::ConcatInDim(cx.builder(), {i, f, g, o}, 1)};
+}
+
+struct LstmStepGrads {
+  // The gradient of the [B, 4H] pre-activations.
+  xla::XlaOp grad_preactivations;
+  xla::XlaOp grad_cx;
+};
+
+LstmStepGrads LstmStepBackward(const xla::XlaOp& grad_h,
+                               const xla::XlaOp& grad_c, const xla::XlaOp& cx,
+                               const xla::XlaOp& c, const xla::XlaOp& gates) {
+  xla::int64 hidden_size = HiddenSize(cx);
+  xla::XlaOp one = One(c);
+  xla::XlaOp i = Gate(gates, hidden_size, 0);
+  xla::XlaOp f = Gate(gates, hidden_size, 1);
+  xla::XlaOp g = Gate(gates, hidden_size, 2);
+  xla::XlaOp o = Gate(gates, hidden_size, 3);
+  xla::XlaOp tanh_c = xla::Tanh(c);
+  xla::XlaOp grad_cell = grad_c + grad_h * o * (one - tanh_c * tanh_c);
+  xla::XlaOp grad_i = grad_cell * g * i * (one - i);
+  xla::XlaOp grad_f = grad_cell * cx * f * (one - f);
+  xla::XlaOp grad_g = grad_cell * i * (one - g * g);
+  xla::XlaOp grad_o = grad_h * tanh_c * o * (one - o);
+  return {xla::ConcatInDim(c.builder(), {grad_i, grad_f, grad_g, grad_o}, 1),
+          grad_cell * f};
+}
+
+// Applies the GRU gates to the [B, 3H] input and hidden projections.
+GruCellResult GruStep(const xla::XlaOp& input_projection,
+                      const xla::XlaOp& hidden_projection,
+                      const xla::XlaOp& hx) {
+  xla::int64 hidden_size = HiddenSize(hx);
+  xla::XlaOp r = BuildSigmoid(Gate(input_projection, hidden_size, 0) +
+                              Gate(hidden_projection, hidden_size, 0));
+  xla::XlaOp z = BuildSigmoid(Gate(input_projection, hidden_size, 1) +
+                              Gate(hidden_projection, hidden_size, 1));
+  xla::XlaOp hn = Gate(hidden_projection, hidden_size, 2);
+  xla::XlaOp n = xla::Tanh(Gate(input_projection, hidden_size, 2) + r * hn);
+  return {(One(hx) - z) * n + z * hx,
+          xla::ConcatInDim(hx.builder(), {r, z, n, hn}, 1)};
+}
+
+struct GruStepGrads {
+  // The gradients of the [B, 3H] input and hidden projections.
+  xla::XlaOp grad_input_projection;
+  xla::XlaOp grad_hidden_projection;
+  // The gradient of hx through the z gate interpolation only.
+  xla::XlaOp grad_hx;
+};
+
+GruStepGrads GruStepBackward(const xla::XlaOp& grad_h, const xla::XlaOp& hx,
+                             const xla::XlaOp& gates) {
+  xla::int64 hidden_size = HiddenSize(hx);
+  xla::XlaOp one = One(hx);
+  xla::XlaOp r = Gate(gates, hidden_size, 0);
+  xla::XlaOp z = Gate(gates, hidden_size, 1);
+  xla::XlaOp n = Gate(gates, hidden_size, 2);
+  xla::XlaOp hn = Gate(gates, hidden_size, 3);
+  xla::XlaOp grad_n = grad_h * (one - z) * (one - n * n);
+  xla::XlaOp grad_r = grad_n * hn * r * (one - r);
+  xla::XlaOp grad_z = grad_h * (hx - n) * z * (one - z);
+  xla::XlaBuilder* builder = hx.builder();
+  return {xla::ConcatInDim(builder, {grad_r, grad_z, grad_n}, 1),
+          xla::ConcatInDim(builder, {grad_r, grad_z, grad_n * r}, 1),
+          grad_h * z};
+}
+
+}  // namespace
+
+LstmCellResult BuildLstmCell(const xla::XlaOp& input, const xla::XlaOp& hx,
+                             const xla::XlaOp& cx, const xla::XlaOp& w_ih,
+                             const xla::XlaOp& w_hh, const xla::XlaOp& b_ih,
+                             const xla::XlaOp& b_hh) {
+  xla::XlaBuilder* builder = input.builder();
+  xla::XlaOp preactivations =
+      Projection(xla::ConcatInDim(builder, {input, hx}, 1),
+                 xla::ConcatInDim(builder, {w_ih, w_hh}, 1), b_ih + b_hh);
+  return LstmStep(preactivations, cx);
+}
+
+std::vector<xla::XlaOp> BuildLstmCellBackward(
+    const xla::XlaOp& grad_h, const xla::XlaOp& grad_c,
+    const xla::XlaOp& input, const xla::XlaOp& hx, const xla::XlaOp& cx,
+    const xla::XlaOp& w_ih, const xla::XlaOp& w_hh, const xla::XlaOp& c,
+    const xla::XlaOp& gates) {
+  xla::XlaBuilder* builder = input.builder();
+  xla::int64 input_size = XlaHelpers::ShapeOfXlaOp(input).dimensions(1);
+  xla::int64 hidden_size = HiddenSize(hx);
+  LstmStepGrads grads = LstmStepBackward(grad_h, grad_c, cx, c, gates);
+  // Like the forward, a single dot for each of the [input, hx] and
+  // [w_ih, w_hh] gradients, split afterwards.
+  xla::XlaOp grad_input_hx =
+      Dot(grads.grad_preactivations,
+          xla::ConcatInDim(builder, {w_ih, w_hh}, 1), 1, 0);
+  xla::XlaOp grad_weight =
+      Dot(grads.grad_preactivations,
+          xla::ConcatInDim(builder, {input, hx}, 1), 0, 0);
+  return {xla::SliceInDim(grad_input_hx, 0, input_size, 1, 1),
+          xla::SliceInDim(grad_input_hx, input_size, input_size + hidden_size,
+                          1, 1),
+          grads.grad_cx,
+          xla::SliceInDim(grad_weight, 0, input_size, 1, 1),
+          xla::SliceInDim(grad_weight, input_size, input_size + hidden_size, 1,
+                          1),
+          SumRows(grads.grad_preactivations)};
+}
+
+GruCellResult BuildGruCell(const xla::XlaOp& input, const xla::XlaOp& hx,
+                           const xla::XlaOp& w_ih, const xla::XlaOp& w_hh,
+                           const xla::XlaOp& b_ih, const xla::XlaOp& b_hh) {
+  return GruStep(Projection(input, w_ih, b_ih), Projection(hx, w_hh, b_hh), hx);
+}
+
+std::vector<xla::XlaOp> BuildGruCellBackward(const xla::XlaOp& grad_h,
+                                             const xla::XlaOp& input,
+                                             const xla::XlaOp& hx,
+                                             const xla::XlaOp& w_ih,
+                                             const xla::XlaOp& w_hh,
+                                             const xla::XlaOp& gates) {
+  GruStepGrads grads = GruStepBackward(grad_h, hx, gates);
+  return {Dot(grads.grad_input_projection, w_ih, 1, 0),
+          grads.grad_hx + Dot(grads.grad_hidden_projection, w_hh, 1, 0),
+          Dot(grads.grad_input_projection, input, 0, 0),
+          Dot(grads.grad_hidden_projection, hx, 0, 0),
+          SumRows(grads.grad_input_projection),
+          SumRows(grads.grad_hidden_projection)};
+}
+
+LstmSequenceResult BuildLstmSequence(const xla::XlaOp& input,
+                                     const xla::XlaOp& h0, const xla::XlaOp& c0,
+                                     const xla::XlaOp& w_ih,
+                                     const xla::XlaOp& w_hh,
+                                     const xla::XlaOp& b_ih,
+                                     const xla::XlaOp& b_hh) {
+  xla::int64 num_steps = XlaHelpers::ShapeOfXlaOp(input).dimensions(0);
+  xla::int64 hidden_size = HiddenSize(h0);
+  xla::XlaOp input_projections = UnflattenSteps(
+      Projection(FlattenSteps(input), w_ih, b_ih + b_hh), num_steps);
+  auto step_fn = [](const xla::XlaOp& step,
+                    const std::vector<xla::XlaOp>& state) {
+    // The state is h, c, output, cells, gates, input_projections and w_hh.
+    LstmCellResult result = LstmStep(
+        GetStep(state[5], step) + Dot(state[0], state[6], 1, 1), state[1]);
+    return std::vector<xla::XlaOp>(
+        {result.h, result.c, SetStep(state[2], result.h, step),
+         SetStep(state[3], result.c, step),
+         SetStep(state[4], result.gates, step), state[5], state[6]});
+  };
+  std::vector<xla::XlaOp> state = BuildTimeLoop(
+      {h0, c0, ZerosSteps(h0, num_steps, hidden_size),
+       ZerosSteps(h0, num_steps, hidden_size),
+       ZerosSteps(h0, num_steps, 4 * hidden_size), input_projections, w_hh},
+      num_steps, /*reverse=*/false, step_fn);
+  return {state[2], state[3], state[4]};
+}
+
+std::vector<xla::XlaOp> BuildLstmSequenceBackward(
+    const xla::XlaOp& grad_output, const xla::XlaOp& grad_cells,
+    const xla::XlaOp& input, const xla::XlaOp& h0, const xla::XlaOp& c0,
+    const xla::XlaOp& w_ih, const xla::XlaOp& w_hh, const xla::XlaOp& output,
+    const xla::XlaOp& cells, const xla::XlaOp& gates) {
+  xla::int64 num_steps = XlaHelpers::ShapeOfXlaOp(input).dimensions(0);
+  xla::int64 hidden_size = HiddenSize(h0);
+  xla::XlaOp previous_outputs = PreviousStates(h0, output);
+  auto step_fn = [](const xla::XlaOp& step,
+                    const std::vector<xla::XlaOp>& state) {
+    // The state is grad_h, grad_c, grad_preactivations, grad_output,
+    // grad_cells, previous_cells, cells, gates and w_hh.
+    LstmStepGrads grads = LstmStepBackward(
+        state[0] + GetStep(state[3], step), state[1] + GetStep(state[4], step),
+        GetStep(state[5], step), GetStep(state[6], step),
+        GetStep(state[7], step));
+    return std::vector<xla::XlaOp>(
+        {Dot(grads.grad_preactivations, state[8], 1, 0), grads.grad_cx,
+         SetStep(state[2], grads.grad_preactivations, step), state[3],
+         state[4], state[5], state[6], state[7], state[8]});
+  };
+  std::vector<xla::XlaOp> state = BuildTimeLoop(
+      {xla::ZerosLike(h0), xla::ZerosLike(c0),
+       ZerosSteps(h0, num_steps, 4 * hidden_size), grad_output, grad_cells,
+       PreviousStates(c0, cells), cells, gates, w_hh},
+      num_steps, /*reverse=*/true, step_fn);
+  xla::XlaOp grad_preactivations = FlattenSteps(state[2]);
+  return {UnflattenSteps(Dot(grad_preactivations, w_ih, 1, 0), num_steps),
+          state[0],
+          state[1],
+          Dot(grad_preactivations, FlattenSteps(input), 0, 0),
+          Dot(grad_preactivations, FlattenSteps(previous_outputs), 0, 0),
+          SumRows(grad_preactivations)};
+}
+
+GruSequenceResult BuildGruSequence(const xla::XlaOp& input,
+                                   const xla::XlaOp& h0, const xla::XlaOp& w_ih,
+                                   const xla::XlaOp& w_hh,
+                                   const xla::XlaOp& b_ih,
+                                   const xla::XlaOp& b_hh) {
+  xla::int64 num_steps = XlaHelpers::ShapeOfXlaOp(input).dimensions(0);
+  xla::int64 hidden_size = HiddenSize(h0);
+  xla::XlaOp input_projections =
+      UnflattenSteps(Projection(FlattenSteps(input), w_ih, b_ih), num_steps);
+  auto step_fn = [](const xla::XlaOp& step,
+                    const std::vector<xla::XlaOp>& state) {
+    // The state is h, output, gates, input_projections, w_hh and b_hh.
+    GruCellResult result =
+        GruStep(GetStep(state[3], step),
+                Projection(state[0], state[4], state[5]), state[0]);
+    return std::vector<xla::XlaOp>(
+        {result.h, SetStep(state[1], result.h, step),
+         SetStep(state[2], result.gates, step), state[3], state[4], state[5]});
+  };
+  std::vector<xla::XlaOp> state = BuildTimeLoop(
+      {h0, ZerosSteps(h0, num_steps, hidden_size),
+       ZerosSteps(h0, num_steps, 4 * hidden_size), input_projections, w_hh,
+       b_hh},
+      num_steps, /*reverse=*/false, step_fn);
+  return {state[1], state[2]};
+}
+
+std::vector<xla::XlaOp> BuildGruSequenceBackward(
+    const xla::XlaOp& grad_output, const xla::XlaOp& input,
+    const xla::XlaOp& h0, const xla::XlaOp& w_ih, const xla::XlaOp& w_hh,
+    const xla::XlaOp& output, const xla::XlaOp& gates) {
+  xla::int64 num_steps = XlaHelpers::ShapeOfXlaOp(input).dimensions(0);
+  xla::int64 hidden_size = HiddenSize(h0);
+  xla::XlaOp previous_outputs = PreviousStates(h0, output);
+  auto step_fn = [](const xla::XlaOp& step,
+                    const std::vector<xla::XlaOp>& state) {
+    // The state is grad_h, grad_input_projections, grad_hidden_projections,
+    // grad_output, previous_outputs, gates and w_hh.
+    GruStepGrads grads =
+        GruStepBackward(state[0] + GetStep(state[3], step),
+                        GetStep(state[4], step), GetStep(state[5], step));
+    return std::vector<xla::XlaOp>(
+        {grads.grad_hx + Dot(grads.grad_hidden_projection, state[6], 1, 0),
+         SetStep(state[1], grads.grad_input_projection, step),
+         SetStep(state[2], grads.grad_hidden_projection, step), state[3],
+         state[4], state[5], state[6]});
+  };
+  std::vector<xla::XlaOp> state = BuildTimeLoop(
+      {xla::ZerosLike(h0), ZerosSteps(h0, num_steps, 3 * hidden_size),
+       ZerosSteps(h0, num_steps, 3 * hidden_size), grad_output,
+       previous_outputs, gates, w_hh},
+      num_steps, /*reverse=*/true, step_fn);
+  xla::XlaOp grad_input_projections = FlattenSteps(state[1]);
+  xla::XlaOp grad_hidden_projections = FlattenSteps(state[2]);
+  return {UnflattenSteps(Dot(grad_input_projections, w_ih, 1, 0), num_steps),
+          state[0],
+          Dot(grad_input_projections, FlattenSteps(input), 0, 0),
+          Dot(grad_hidden_projections, FlattenSteps(previous_outputs), 0, 0),
+          SumRows(grad_input_projections),
+          SumRows(grad_hidden_projections)};
+}
+
+}  // namespace torch_xla
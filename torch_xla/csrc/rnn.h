@@ -0,0 +1,108 @@
+#pragma once
+
+#include <vector>
+
+#include "tensorflow/compiler/xla/client/xla_builder.h"
+
+namespace torch_xla {
+
+// The recurrent lowerings follow the PyTorch layouts: the input is [B, I] for
+// the cells and [T, B, I] for the sequences, the hidden states are [B, H],
+// w_ih is [G * H, I], w_hh [G * H, H] and the biases [G * H], with the gates
+// stacked in the i, f, g, o order for LSTM (G = 4) and r, z, n for GRU (G = 3).
+
+struct LstmCellResult {
+  xla::XlaOp h;
+  xla::XlaOp c;
+  // The [B, 4H] activations of the i, f, g, o gates, needed by the backward.
+  xla::XlaOp gates;
+};
+
+// Computes an LSTM step, with the input and hidden projections computed by a
+// single dot of [input, hx] with [w_ih, w_hh].
+LstmCellResult BuildLstmCell(const xla::XlaOp& input, const xla::XlaOp& hx,
+                             const xla::XlaOp& cx, const xla::XlaOp& w_ih,
+                             const xla::XlaOp& w_hh, const xla::XlaOp& b_ih,
+                             const xla::XlaOp& b_hh);
+
+// Returns the gradients of input, hx, cx, w_ih, w_hh and the one of the biases
+// (which b_ih and b_hh share), given the c and gates of BuildLstmCell().
+std::vector<xla::XlaOp> BuildLstmCellBackward(
+    const xla::XlaOp& grad_h, const xla::XlaOp& grad_c,
+    const xla::XlaOp& input, const xla::XlaOp& hx, const xla::XlaOp& cx,
+    const xla::XlaOp& w_ih, const xla::XlaOp& w_hh, const xla::XlaOp& c,
+    const xla::XlaOp& gates);
+
+struct GruCellResult {
+  xla::XlaOp h;
+  // The [B, 4H] activations of the r, z, n gates, followed by the w_hn * hx +
+  // b_hn hidden projection, needed by the backward.
+  xla::XlaOp gates;
+};
+
+// Computes a GRU step. Unlike LSTM, the input and hidden projections need
+// separate dots, as the reset gate only scales the hidden one of the n gate.
+GruCellResult BuildGruCell(const xla::XlaOp& input, const xla::XlaOp& hx,
+                           const xla::XlaOp& w_ih, const xla::XlaOp& w_hh,
+                           const xla::XlaOp& b_ih, const xla::XlaOp& b_hh);
+
+// Returns the gradients of input, hx, w_ih, w_hh, b_ih and b_hh, given the
+// gates of BuildGruCell().
+std::vector<xla::XlaOp> BuildGruCellBackward(const xla::XlaOp& grad_h,
+                                             const xla::XlaOp& input,
+                                             const xla::XlaOp& hx,
+                                             const xla::XlaOp& w_ih,
+                                             const xla::XlaOp& w_hh,
+                                             const xla::XlaOp& gates);
+
+struct LstmSequenceResult {
+  // The [T, B, H] hidden and cell states of every step.
+  xla::XlaOp output;
+  xla::XlaOp cells;
+  // The [T, B, 4H] gate activations of every step.
+  xla::XlaOp gates;
+};
+
+// Runs an LSTM over the T steps of the input within an XLA While, so that the
+// graph size does not depend on T. The input projections of all the steps are
+// computed by a single dot ahead of the loop.
+LstmSequenceResult BuildLstmSequence(const xla::XlaOp& input,
+                                     const xla::XlaOp& h0, const xla::XlaOp& c0,
+                                     const xla::XlaOp& w_ih,
+                                     const xla::XlaOp& w_hh,
+                                     const xla::XlaOp& b_ih,
+                                     const xla::XlaOp& b_hh);
+
+// Returns the gradients of input, h0, c0, w_ih, w_hh and the one of the biases,
+// given the gradients of the output and cells of BuildLstmSequence(). The
+// steps are walked backward within an XLA While, which only carries the
+// recurrent gradients, while the weight gradients are computed by single dots
+// after the loop.
+std::vector<xla::XlaOp> BuildLstmSequenceBackward(
+    const xla::XlaOp& grad_output, const xla::XlaOp& grad_cells,
+    const xla::XlaOp& input, const xla::XlaOp& h0, const xla::XlaOp& c0,
+    const xla::XlaOp& w_ih, const xla::XlaOp& w_hh, const xla::XlaOp& output,
+    const xla::XlaOp& cells, const xla::XlaOp& gates);
+
+struct GruSequenceResult {
+  // The [T, B, H] hidden states of every step.
+  xla::XlaOp output;
+  // The [T, B, 4H] gates (see GruCellResult) of every step.
+  xla::XlaOp gates;
+};
+
+// Same as BuildLstmSequence(), for a GRU.
+GruSequenceResult BuildGruSequence(const xla::XlaOp& input,
+                                   const xla::XlaOp& h0, const xla::XlaOp& w_ih,
+                                   const xla::XlaOp& w_hh,
+                                   const xla::XlaOp& b_ih,
+                                   const xla::XlaOp& b_hh);
+
+// Returns the gradients of input, h0, w_ih, w_hh, b_ih and b_hh, given the one
+// of the output of BuildGruSequence().
+std::vector<xla::XlaOp> BuildGruSequenceBackward(
+    const xla::XlaOp& grad_output, const xla::XlaOp& input,
+    const xla::XlaOp& h0, const xla::XlaOp& w_ih, const xla::XlaOp& w_hh,
+    const xla::XlaOp& output, const xla::XlaOp& gates);
+
+}  // namespace torch_xla
@@ -1,13 +1,16 @@
 #include "torch_xla/csrc/softmax_builder.h"
 
 #include "tensorflow/compiler/xla/xla_client/debug_macros.h"
+#include "torch_xla/csrc/convert_ops.h"
 #include "torch_xla/csrc/helpers.h"
+#include "torch_xla/csrc/reduction.h"
 
 namespace torch_xla {
 namespace {
 
 struct SoftMaxPartials {
   std::vector<xla::int64> broadcast_dimensions;
+  xla::XlaOp logits_max;
   xla::XlaOp shifted_logits;
   xla::XlaOp exp_shifted;
   xla::XlaOp reduce;
@@ -25,6 +28,7 @@ std::vector<xla::int64> BroadcastDimensions(xla::int64 dims,
   return result_dims;
 }
 
+// The logits must already be in the accumulation type.
 SoftMaxPartials LogSoftmaxPartials(const xla::XlaOp& logits, xla::int64 dim) {
   xla::Shape logits_shape = XlaHelpers::ShapeOfXlaOp(logits);
   std::vector<xla::int64> broadcast_dimensions =
@@ -44,33 +48,53 @@ SoftMaxPartials LogSoftmaxPartials(const xla::XlaOp& logits, xla::int64 dim) {
   xla::XlaOp reduce = xla::Reduce(
       exp_shifted, init_value,
       XlaHelpers::CreateAddComputation(logits_shape.element_type()), {dim});
-  return {std::move(broadcast_dimensions), shifted_logits, exp_shifted, reduce};
+  return {std::move(broadcast_dimensions), logits_max, shifted_logits,
+          exp_shifted, reduce};
 }
 
-xla::XlaOp SoftmaxSumOfGrad(const xla::XlaOp& grad_output, xla::int64 dim) {
-  xla::Shape grad_output_shape = XlaHelpers::ShapeOfXlaOp(grad_output);
-  auto broadcast_dimensions =
-      BroadcastDimensions(grad_output_shape.rank(), dim);
+// Sums the gradient along dim in the accumulation type of kind, and returns
+// the sum in the gradient type.
+xla::XlaOp SoftmaxSumOfGrad(const xla::XlaOp& grad_output, xla::int64 dim,
+                            const std::string& kind) {
+  xla::PrimitiveType type =
+      XlaHelpers::ShapeOfXlaOp(grad_output).element_type();
+  xla::PrimitiveType accumulation_type = GetAccumulationType(type, kind);
   const auto init_value = XlaHelpers::ScalarValue<float>(
-      0, grad_output_shape.element_type(), grad_output.builder());
-  return xla::Reduce(
-      grad_output, init_value,
-      XlaHelpers::CreateAddComputation(grad_output_shape.element_type()),
-      {dim});
+      0, accumulation_type, grad_output.builder());
+  xla::XlaOp sum = xla::Reduce(
+      MaybeConvertTo(grad_output, type, accumulation_type, /*device=*/nullptr),
+      init_value, XlaHelpers::CreateAddComputation(accumulation_type), {dim});
+  return MaybeConvertTo(sum, accumulation_type, type, /*device=*/nullptr);
+}
+
+// Runs build_fn over the logits converted to the accumulation type of kind,
+// and converts its result back to the logits type. The conversions get fused
+// within the softmax computations, so they cost no extra memory traffic.
+template <typename F>
+xla::XlaOp BuildWithAccumulation(const xla::XlaOp& logits,
+                                 const std::string& kind, const F& build_fn) {
+  xla::PrimitiveType type = XlaHelpers::ShapeOfXlaOp(logits).element_type();
+  xla::PrimitiveType accumulation_type = GetAccumulationType(type, kind);
+  return MaybeConvertTo(build_fn(MaybeConvertTo(logits, type, accumulation_type,
+                                                /*device=*/nullptr)),
+                        accumulation_type, type, /*device=*/nullptr);
 }
 
 }  // namespace
 
 xla::XlaOp BuildLogSoftmax(const xla::XlaOp& logits, xla::int64 dim) {
-  SoftMaxPartials parts = LogSoftmaxPartials(logits, dim);
-  return xla::Sub(parts.shifted_logits, xla::Log(parts.reduce),
-                  parts.broadcast_dimensions);
+  return BuildWithAccumulation(
+      logits, "log_softmax", [dim](const xla::XlaOp& wide_logits) {
+        SoftMaxPartials parts = LogSoftmaxPartials(wide_logits, dim);
+        return xla::Sub(parts.shifted_logits, xla::Log(parts.reduce),
+                        parts.broadcast_dimensions);
+      });
 }
 
 xla::XlaOp BuildLogSoftmaxGrad(const xla::XlaOp& grad_output,
                                const xla::XlaOp& output, xla::int64 dim) {
   // Inspired from tf2xla.
-  xla::XlaOp sum = SoftmaxSumOfGrad(grad_output, dim);
+  xla::XlaOp sum = SoftmaxSumOfGrad(grad_output, dim, "log_softmax");
   xla::Shape grad_output_shape = XlaHelpers::ShapeOfXlaOp(grad_output);
   auto broadcast_dimensions =
       BroadcastDimensions(grad_output_shape.rank(), dim);
@@ -78,14 +102,42 @@ xla::XlaOp BuildLogSoftmaxGrad(const xla::XlaOp& grad_output,
                   xla::Mul(xla::Exp(output), sum, broadcast_dimensions));
 }
 
+xla::XlaOp BuildLogSumExp(const xla::XlaOp& logits, xla::int64 dim) {
+  return BuildWithAccumulation(
+      logits, "log_softmax", [dim](const xla::XlaOp& wide_logits) {
+        SoftMaxPartials parts = LogSoftmaxPartials(wide_logits, dim);
+        return xla::Add(parts.logits_max, xla::Log(parts.reduce));
+      });
+}
+
+xla::XlaOp BuildLogSoftmaxGradFromLogits(const xla::XlaOp& grad_output,
+                                         const xla::XlaOp& logits,
+                                         const xla::XlaOp& log_sum_exp,
+                                         xla::int64 dim) {
+  xla::XlaOp sum = SoftmaxSumOfGrad(grad_output, dim, "log_softmax");
+  xla::Shape grad_output_shape = XlaHelpers::ShapeOfXlaOp(grad_output);
+  auto broadcast_dimensions =
+      BroadcastDimensions(grad_output_shape.rank(), dim);
+  // The softmax is recomputed from the logits, instead of being kept around
+  // in the form of the LogSoftmax output.
+  xla::XlaOp softmax =
+      xla::Exp(xla::Sub(logits, log_sum_exp, broadcast_dimensions));
+  return xla::Sub(grad_output, xla::Mul(softmax, sum, broadcast_dimensions));
+}
+
 xla::XlaOp BuildSoftmax(const xla::XlaOp& logits, xla::int64 dim) {
-  SoftMaxPartials parts = LogSoftmaxPartials(logits, dim);
-  return xla::Div(parts.exp_shifted, parts.reduce, parts.broadcast_dimensions);
+  return BuildWithAccumulation(
+      logits, "softmax", [dim](const xla::XlaOp& wide_logits) {
+        SoftMaxPartials parts = LogSoftmaxPartials(wide_logits, dim);
+        return xla::Div(parts.exp_shifted, parts.reduce,
+                        parts.broadcast_dimensions);
+      });
 }
 
 xla::XlaOp BuildSoftmaxGrad(const xla::XlaOp& grad_output,
                             const xla::XlaOp& output, xla::int64 dim) {
-  xla::XlaOp sum = SoftmaxSumOfGrad(xla::Mul(grad_output, output), dim);
+  xla::XlaOp sum =
+      SoftmaxSumOfGrad(xla::Mul(grad_output, output), dim, "softmax");
   xla::Shape grad_output_shape = XlaHelpers::ShapeOfXlaOp(grad_output);
   auto broadcast_dimensions =
       BroadcastDimensions(grad_output_shape.rank(), dim);
@@ -11,6 +11,18 @@ xla::XlaOp BuildLogSoftmax(const xla::XlaOp& logits, xla::int64 dim);
 xla::XlaOp BuildLogSoftmaxGrad(const xla::XlaOp& grad_output,
                                const xla::XlaOp& output, xla::int64 dim);
 
+// Computes log(sum(exp(logits))) along the dimension specified by "dim", which
+// gets reduced away.
+xla::XlaOp BuildLogSumExp(const xla::XlaOp& logits, xla::int64 dim);
+
+// Computes the gradient of the input of the LogSoftmax function, using the
+// function input and the log_sum_exp returned by BuildLogSumExp(), instead of
+// its output.
+xla::XlaOp BuildLogSoftmaxGradFromLogits(const xla::XlaOp& grad_output,
+                                         const xla::XlaOp& logits,
+                                         const xla::XlaOp& log_sum_exp,
+                                         xla::int64 dim);
+
 xla::XlaOp BuildSoftmax(const xla::XlaOp& logits, xla::int64 dim);
 
 xla::XlaOp BuildSoftmaxGrad(const xla::XlaOp& grad_output,
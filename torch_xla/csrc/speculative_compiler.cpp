@@ -0,0 +1,178 @@
+#include "torch_xla/csrc/speculative_compiler.h"
+
+#include <algorithm>
+#include <exception>
+#include <utility>
+
+#include "tensorflow/compiler/xla/xla_client/computation_client.h"
+#include "tensorflow/compiler/xla/xla_client/metrics.h"
+#include "tensorflow/compiler/xla/xla_client/sys_util.h"
+#include "tensorflow/compiler/xla/xla_client/tf_logging.h"
+#include "tensorflow/compiler/xla/xla_client/thread_pool.h"
+#include "torch_xla/csrc/tensor.h"
+
+namespace torch_xla {
+namespace {
+
+// The maximum number of successors of a synced graph which get scheduled for
+// compilation.
+size_t GetMaxPredictions() {
+  static size_t max_predictions = std::max<xla::int64>(
+      xla::sys_util::GetEnvInt("XLA_SPECULATIVE_COMPILE_FANOUT", 2), 1);
+  return max_predictions;
+}
+
+}  // namespace
+
+SpeculativeCompiler* SpeculativeCompiler::Get() {
+  static SpeculativeCompiler* compiler = new SpeculativeCompiler();
+  return compiler;
+}
+
+void SpeculativeCompiler::AddGraph(size_t hash, Graph graph) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (graphs_.emplace(hash, std::make_shared<Graph>(std::move(graph)))
+          .second) {
+    graph_order_.push_back(hash);
+  }
+}
+
+void SpeculativeCompiler::AddTransitions(
+    const std::vector<Transition>& transitions) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (auto& transition : transitions) {
+    transitions_[transition.from_hash][transition.to_hash] += transition.count;
+  }
+}
+
+std::vector<SpeculativeCompiler::Transition>
+SpeculativeCompiler::GetTransitions() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::vector<Transition> transitions;
+  for (auto& from_successors : transitions_) {
+    for (auto& to_count : from_successors.second) {
+      transitions.push_back(
+          {from_successors.first, to_count.first, to_count.second});
+    }
+  }
+  return transitions;
+}
+
+void SpeculativeCompiler::OnSync(size_t hash, const std::string& device) {
+  std::shared_ptr<Graph> graph;
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    size_t& last_hash = last_hashes_[device];
+    if (last_hash != 0) {
+      transitions_[last_hash][hash] += 1;
+    }
+    last_hash = hash;
+    if (graphs_.empty() && compiling_.empty() && speculated_.empty()) {
+      return;
+    }
+    if (speculated_.erase(hash) > 0) {
+      XLA_COUNTER("SpeculativeCompileHits", 1);
+    } else if (compiling_.count(hash) > 0) {
+      XLA_COUNTER("SpeculativeCompileWaits", 1);
+      cv_.wait(lock, [&] { return compiling_.count(hash) == 0; });
+      speculated_.erase(hash);
+    } else {
+      auto it = graphs_.find(hash);
+      if (it != graphs_.end()) {
+        XLA_COUNTER("SpeculativeCompileMisses", 1);
+        graph = std::move(it->second);
+        graphs_.erase(it);
+        compiling_.insert(hash);
+      }
+    }
+
+    auto it = transitions_.find(hash);
+    if (it != transitions_.end()) {
+      std::vector<std::pair<xla::uint64, size_t>> successors;
+      for (auto& to_count : it->second) {
+        if (graphs_.count(to_count.first) > 0) {
+          successors.emplace_back(to_count.second, to_count.first);
+        }
+      }
+      std::sort(successors.begin(), successors.end(),
+                [](const std::pair<xla::uint64, size_t>& s1,
+                   const std::pair<xla::uint64, size_t>& s2) {
+                  return s1.first > s2.first;
+                });
+      successors.resize(std::min(successors.size(), GetMaxPredictions()));
+      // The most likely successor ends up at the front of the queue.
+      for (auto sit = successors.rbegin(); sit != successors.rend(); ++sit) {
+        queue_.push_front(sit->second);
+      }
+      XLA_COUNTER("SpeculativeCompilePredictions", successors.size());
+    }
+    if (!running_ && !graphs_.empty()) {
+      running_ = true;
+      xla::env::ScheduleIoClosure([this]() { RunCompilations(); });
+    }
+  }
+  if (graph != nullptr) {
+    Compile(hash, std::move(*graph), /*speculative=*/false);
+  }
+}
+
+void SpeculativeCompiler::RunCompilations() {
+  for (;;) {
+    size_t hash = 0;
+    std::shared_ptr<Graph> graph;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      // The predicted graphs go first, then the other known ones, in the order
+      // they were added.
+      while (graph == nullptr && (!queue_.empty() || !graph_order_.empty())) {
+        std::deque<size_t>& hashes = !queue_.empty() ? queue_ : graph_order_;
+        hash = hashes.front();
+        hashes.pop_front();
+        auto it = graphs_.find(hash);
+        if (it != graphs_.end()) {
+          graph = std::move(it->second);
+          graphs_.erase(it);
+          compiling_.insert(hash);
+        }
+      }
+      if (graph == nullptr) {
+        running_ = false;
+        return;
+      }
+    }
+    Compile(hash, std::move(*graph), /*speculative=*/true);
+  }
+}
+
+void SpeculativeCompiler::Compile(size_t hash, Graph graph, bool speculative) {
+  bool compiled = false;
+  try {
+    std::vector<xla::ComputationClient::CompileInstance> instances;
+    instances.emplace_back(std::move(graph.computation), graph.device,
+                           graph.devices, &graph.output_shape);
+    std::vector<std::shared_ptr<xla::ComputationClient::Computation>>
+        computations =
+            xla::ComputationClient::Get()->Compile(std::move(instances));
+    XLATensor::CachedGraph cached_graph;
+    cached_graph.hash = hash;
+    cached_graph.computation = std::move(computations.front());
+    cached_graph.num_parameters = graph.num_parameters;
+    XLATensor::AddCachedGraph(cached_graph);
+    compiled = true;
+    if (speculative) {
+      XLA_COUNTER("SpeculativeCompiles", 1);
+    }
+  } catch (const std::exception& ex) {
+    // The sync of the graph will trace and compile it again.
+    XLA_COUNTER("SpeculativeCompileErrors", 1);
+    TF_LOG(ERROR) << "Speculative compilation failed: " << ex.what();
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  compiling_.erase(hash);
+  if (compiled && speculative) {
+    speculated_.insert(hash);
+  }
+  cv_.notify_all();
+}
+
+}  // namespace torch_xla
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "tensorflow/compiler/xla/client/xla_computation.h"
+#include "tensorflow/compiler/xla/shape.h"
+#include "tensorflow/compiler/xla/types.h"
+
+namespace torch_xla {
+
+// Compiles ahead of time the graphs which are likely to be synced next, so
+// that the first sync of a graph (like a new shape bucket of a dynamic shape
+// workload) does not stall on its compilation.
+// The compiler records the sequence of the graph hashes synced on every
+// device, and after every sync it compiles, on a background thread, the most
+// frequent successors of the synced graph among the known, but not yet
+// compiled, ones (like the graphs of a bundle loaded with lazy compilation).
+// When there are no predictions, the known graphs are compiled in the order
+// they were added, so they all get compiled while the device is busy.
+class SpeculativeCompiler {
+ public:
+  struct Graph {
+    xla::XlaComputation computation;
+    // The device the graph is compiled on, and all the ones it runs on.
+    std::string device;
+    std::vector<std::string> devices;
+    xla::Shape output_shape;
+    size_t num_parameters = 0;
+  };
+
+  struct Transition {
+    size_t from_hash = 0;
+    size_t to_hash = 0;
+    xla::uint64 count = 0;
+  };
+
+  static SpeculativeCompiler* Get();
+
+  // Adds a graph which is compiled (and added to the compilation cache) once
+  // it is predicted, or synced.
+  void AddGraph(size_t hash, Graph graph);
+
+  // Adds the transitions observed by a previous run, to seed the predictions.
+  void AddTransitions(const std::vector<Transition>& transitions);
+
+  // Returns the transitions observed so far.
+  std::vector<Transition> GetTransitions() const;
+
+  // Called right before the computation cache lookup of the sync of the graph
+  // with the given hash, on the given device. If the graph is known but not
+  // compiled yet, compiles it (or waits for its ongoing background compilation)
+  // before returning, and schedules the compilation of the graphs predicted
+  // to follow it.
+  void OnSync(size_t hash, const std::string& device);
+
+ private:
+  void RunCompilations();
+
+  // Compiles the graph, adds it to the computation cache, and wakes up the
+  // syncs waiting for it.
+  void Compile(size_t hash, Graph graph, bool speculative);
+
+  mutable std::mutex mutex_;
+  std::condition_variable cv_;
+  std::unordered_map<size_t, std::shared_ptr<Graph>> graphs_;
+  // The hashes of the known graphs, in insertion order.
+  std::deque<size_t> graph_order_;
+  std::unordered_set<size_t> compiling_;
+  // The graphs compiled in background, and not synced yet.
+  std::unordered_set<size_t> speculated_;
+  // The hashes of the predicted graphs, most likely first.
+  std::deque<size_t> queue_;
+  bool running_ = false;
+  std::map<size_t, std::map<size_t, xla::uint64>> transitions_;
+  std::map<std::string, size_t> last_hashes_;
+};
+
+}  // namespace torch_xla
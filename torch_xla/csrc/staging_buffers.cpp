@@ -0,0 +1,55 @@
+#include "torch_xla/csrc/staging_buffers.h"
+
+#include "tensorflow/compiler/xla/xla_client/metrics.h"
+#include "tensorflow/compiler/xla/xla_client/sys_util.h"
+#include "tensorflow/compiler/xla/xla_client/util.h"
+#include "torch_xla/csrc/tensor_util.h"
+
+namespace torch_xla {
+
+StagingBufferPool* StagingBufferPool::Get() {
+  static size_t max_buffers_per_shape =
+      xla::sys_util::GetEnvInt("XLA_STAGING_BUFFERS_PER_SHAPE", 32);
+  static StagingBufferPool* pool =
+      new StagingBufferPool(max_buffers_per_shape);
+  return pool;
+}
+
+size_t StagingBufferPool::BufferKeyHasher::operator()(
+    const BufferKey& key) const {
+  return xla::util::HashCombine(xla::util::GetEnumValue(key.scalar_type),
+                                xla::util::ContainerHash(key.sizes));
+}
+
+at::Tensor StagingBufferPool::CopyToStaging(const at::Tensor& tensor,
+                                            const Device& device) {
+  if (IsZeroCopySource(tensor, device)) {
+    XLA_COUNTER("StagingBufferSkips", 1);
+    return tensor;
+  }
+  at::Tensor buffer = Acquire(tensor);
+  buffer.copy_(tensor);
+  return buffer;
+}
+
+at::Tensor StagingBufferPool::Acquire(const at::Tensor& tensor) {
+  BufferKey key{tensor.scalar_type(), tensor.sizes().vec()};
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::vector<at::Tensor>& buffers = buffers_[key];
+  for (auto& buffer : buffers) {
+    // The pool holds one reference, so a buffer is available only if nobody
+    // else holds a reference to either the tensor or its storage.
+    if (buffer.use_count() == 1 && buffer.storage().use_count() == 1) {
+      XLA_COUNTER("StagingBufferHits", 1);
+      return buffer;
+    }
+  }
+  XLA_COUNTER("StagingBufferMisses", 1);
+  at::Tensor buffer = at::empty(key.sizes, tensor.options());
+  if (buffers.size() < max_buffers_per_shape_) {
+    buffers.push_back(buffer);
+  }
+  return buffer;
+}
+
+}  // namespace torch_xla
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <ATen/ATen.h>
+
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "torch_xla/csrc/device.h"
+
+namespace torch_xla {
+
+// Pool of host tensors used as staging area for the data which is sent to the
+// devices, so that input pipelines sending tensors of the same shapes at every
+// step do not need to allocate new host memory every time.
+// A buffer can be handed out again once the pool holds the only reference to
+// it (that is, once the transfer reading from it has completed, and the tensor
+// returned by Acquire() has been dropped).
+class StagingBufferPool {
+ public:
+  static StagingBufferPool* Get();
+
+  explicit StagingBufferPool(size_t max_buffers_per_shape)
+      : max_buffers_per_shape_(max_buffers_per_shape) {}
+
+  // Returns a host tensor with the same type and sizes as the input one, and
+  // with the input tensor data copied into it. Tensors whose memory the
+  // transfers to the device read as it is are returned unchanged, as the
+  // transfer holds them alive anyway.
+  at::Tensor CopyToStaging(const at::Tensor& tensor, const Device& device);
+
+ private:
+  struct BufferKey {
+    at::ScalarType scalar_type;
+    std::vector<int64_t> sizes;
+  };
+
+  struct BufferKeyHasher {
+    size_t operator()(const BufferKey& key) const;
+  };
+
+  struct BufferKeyEqual {
+    bool operator()(const BufferKey& key1, const BufferKey& key2) const {
+      return key1.scalar_type == key2.scalar_type && key1.sizes == key2.sizes;
+    }
+  };
+
+  at::Tensor Acquire(const at::Tensor& tensor);
+
+  size_t max_buffers_per_shape_ = 0;
+  std::mutex mutex_;
+  std::unordered_map<BufferKey, std::vector<at::Tensor>, BufferKeyHasher,
+                     BufferKeyEqual>
+      buffers_;
+};
+
+}  // namespace torch_xla
@@ -6,33 +6,51 @@
 #include <condition_variable>
 #include <exception>
 #include <functional>
+#include <list>
+#include <map>
 #include <mutex>
 #include <set>
 #include <stdexcept>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
 
 #include "tensorflow/compiler/xla/literal_util.h"
+#include "tensorflow/compiler/xla/shape_util.h"
 #include "tensorflow/compiler/xla/xla_client/cache.h"
 #include "tensorflow/compiler/xla/xla_client/debug_macros.h"
 #include "tensorflow/compiler/xla/xla_client/metrics.h"
 #include "tensorflow/compiler/xla/xla_client/sys_util.h"
 #include "tensorflow/compiler/xla/xla_client/thread_pool.h"
+#include "tensorflow/compiler/xla/xla_client/tf_logging.h"
+#include "tensorflow/compiler/xla/xla_client/tracing.h"
 #include "tensorflow/compiler/xla/xla_client/unique.h"
 #include "tensorflow/compiler/xla/xla_client/xla_util.h"
 #include "tensorflow/core/lib/core/errors.h"
 #include "torch/csrc/autograd/variable.h"
+#include "torch_xla/csrc/cache_miss_explainer.h"
 #include "torch_xla/csrc/debug_util.h"
+#include "torch_xla/csrc/graph_specializer.h"
+#include "torch_xla/csrc/graph_stats.h"
 #include "torch_xla/csrc/helpers.h"
+#include "torch_xla/csrc/input_profiler.h"
 #include "torch_xla/csrc/ir_dump_util.h"
 #include "torch_xla/csrc/ir_util.h"
 #include "torch_xla/csrc/layout_manager.h"
 #include "torch_xla/csrc/lowering_context.h"
+#include "torch_xla/csrc/multi_step.h"
 #include "torch_xla/csrc/op_by_op_executor.h"
+#include "torch_xla/csrc/ops/arithmetic_ir_ops.h"
 #include "torch_xla/csrc/ops/expand.h"
 #include "torch_xla/csrc/ops/ops.h"
 #include "torch_xla/csrc/ops/view.h"
 #include "torch_xla/csrc/ops/xla_ops.h"
+#include "torch_xla/csrc/python_util.h"
+#include "torch_xla/csrc/replicated_data.h"
+#include "torch_xla/csrc/speculative_compiler.h"
 #include "torch_xla/csrc/tensor_util.h"
 #include "torch_xla/csrc/torch_util.h"
+#include "torch_xla/csrc/upload_batcher.h"
 
 namespace torch_xla {
 namespace {
@@ -51,8 +69,19 @@ namespace {
 // Since asynchronous operations capture device locks, only one asynchronous
 // operation can execute at the same time, on a given device. Tensor operations
 // which send data to device do not need to hold any device locks while doing
-// so. Only operations which _use_ device data (computations, and transfer from
-// server) need to wait for asynchronous operations to complete (barrier).
+// so. Computations hold the locks of their devices, which orders them after
+// the in-flight ones they might take inputs from, while transfers from server
+// only wait for the placeholders they read to get their values (see
+// ComputationClient::Data::WaitValue()), so they do not wait for in-flight
+// operations producing other data. Syncs with nothing to compute take no locks.
+// In pipelined sync mode (XLA_PIPELINED_SYNC), the SyncTensorsGraph() API only
+// reserves its turn on the device locks, and the asynchronous operation waits
+// for it before executing. Device locks are granted in reservation order.
+// Every priority class of the ExecutionScheduler has its own device locks, so
+// syncs of different classes are not ordered by them, and can be in flight at
+// the same time on a device. Their executions are dispatched in priority order
+// by the ExecutionScheduler, after the parameters produced by the in-flight
+// syncs of the other classes got their values.
 
 class DeviceLocker {
  public:
@@ -60,27 +89,55 @@ class DeviceLocker {
 
   const Device& device() const { return device_; }
 
-  void Lock() {
+  // Device lock owners are served in FIFO order, using tickets. Lock() waits
+  // for the returned ticket to be served, while Reserve() simply reserves the
+  // next ticket, which can later be waited with WaitTurn(). Every ticket must
+  // be released with Unlock().
+  size_t Lock() {
+    XLA_TRACE_SCOPE("device_locker", "Lock");
     std::unique_lock<std::mutex> lock(mutex_);
-    cv_.wait(lock, [this] { return !locked_; });
-    CheckResetException();
-    locked_ = true;
+    size_t ticket = next_ticket_++;
+    cv_.wait(lock, [this, ticket] { return serving_ticket_ == ticket; });
+    std::exception_ptr exptr = std::move(exptr_);
+    exptr_ = nullptr;
+    if (exptr != nullptr) {
+      // We are not going to own the lock, so pass it to the next in line.
+      ++serving_ticket_;
+      cv_.notify_all();
+      std::rethrow_exception(exptr);
+    }
+    return ticket;
   }
 
-  void Unlock(std::exception_ptr exptr) {
-    std::lock_guard<std::mutex> lock(mutex_);
-    locked_ = false;
-    exptr_ = std::move(exptr);
-    cv_.notify_all();
+  size_t Reserve(size_t max_pending) {
+    XLA_TRACE_SCOPE("device_locker", "Reserve");
+    std::unique_lock<std::mutex> lock(mutex_);
+    cv_.wait(lock, [this, max_pending] {
+      return next_ticket_ - serving_ticket_ < max_pending;
+    });
+    return next_ticket_++;
   }
 
-  void Barrier() {
+  void WaitTurn(size_t ticket) {
+    XLA_TRACE_SCOPE("device_locker", "WaitTurn");
     std::unique_lock<std::mutex> lock(mutex_);
-    cv_.wait(lock, [this] { return !locked_; });
-    cv_.notify_all();
+    cv_.wait(lock, [this, ticket] { return serving_ticket_ == ticket; });
     CheckResetException();
   }
 
+  void Unlock(size_t ticket, std::exception_ptr exptr) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    // A reserved ticket might be released without being waited (like when an
+    // error happens before the operation is scheduled), so we need to wait
+    // for its turn in order to keep the owners FIFO order.
+    cv_.wait(lock, [this, ticket] { return serving_ticket_ == ticket; });
+    ++serving_ticket_;
+    if (exptr != nullptr) {
+      exptr_ = std::move(exptr);
+    }
+    cv_.notify_all();
+  }
+
  private:
   void CheckResetException() {
     std::exception_ptr exptr = std::move(exptr_);
@@ -93,7 +150,8 @@ class DeviceLocker {
   Device device_;
   std::mutex mutex_;
   std::condition_variable cv_;
-  bool locked_ = false;
+  size_t next_ticket_ = 0;
+  size_t serving_ticket_ = 0;
   std::exception_ptr exptr_;
 };
 
@@ -104,101 +162,370 @@ class DeviceLockerArena {
     return arena;
   }
 
-  std::shared_ptr<DeviceLocker> GetLocker(const Device& device) {
+  std::shared_ptr<DeviceLocker> GetLocker(
+      const Device& device, ExecutionScheduler::Priority priority) {
     std::lock_guard<std::mutex> lock(mutex_);
-    auto it = lockers_.find(device);
+    auto key = std::make_pair(device, static_cast<int>(priority));
+    auto it = lockers_.find(key);
     if (it == lockers_.end()) {
-      it = lockers_.emplace(device, std::make_shared<DeviceLocker>(device))
-               .first;
+      it = lockers_.emplace(key, std::make_shared<DeviceLocker>(device)).first;
     }
     return it->second;
   }
 
  private:
   std::mutex mutex_;
-  std::map<Device, std::shared_ptr<DeviceLocker>> lockers_;
+  std::map<std::pair<Device, int>, std::shared_ptr<DeviceLocker>> lockers_;
 };
 
-xla::util::ExceptionCleanup LockDevice(const Device& device) {
-  auto locker = DeviceLockerArena::Get()->GetLocker(device);
-  locker->Lock();
+// In pipelined sync mode, SyncTensorsGraph() only reserves the device locks,
+// and the asynchronous operation waits for them right before using the device
+// data. This lets the caller trace (and lower/compile) the next step while the
+// previous one is still executing on device, using the placeholders of the
+// in-flight operation as inputs.
+bool UsePipelinedSync() {
+  static bool pipelined_sync =
+      xla::sys_util::GetEnvBool("XLA_PIPELINED_SYNC", false);
+  return pipelined_sync;
+}
+
+size_t GetMaxPipelinedSyncs() {
+  static size_t max_pipelined_syncs = std::max<xla::int64>(
+      xla::sys_util::GetEnvInt("XLA_PIPELINED_SYNC_DEPTH", 2), 1);
+  return max_pipelined_syncs;
+}
+
+xla::util::ExceptionCleanup LockDevice(const Device& device,
+                                       std::function<void()>* waiter) {
+  auto locker = DeviceLockerArena::Get()->GetLocker(
+      device, ExecutionScheduler::GetThreadPriority());
+  size_t ticket;
+  if (waiter != nullptr) {
+    ticket = locker->Reserve(GetMaxPipelinedSyncs());
+    *waiter = [locker, ticket]() { locker->WaitTurn(ticket); };
+  } else {
+    ticket = locker->Lock();
+  }
   return xla::util::ExceptionCleanup(
-      [locker =
-           std::move(locker)](xla::util::ExceptionCleanup::StatusType status) {
-        locker->Unlock(std::move(status));
+      [locker = std::move(locker),
+       ticket](xla::util::ExceptionCleanup::StatusType status) {
+        locker->Unlock(ticket, std::move(status));
       });
 }
 
-void DeviceBarrier(const Device& device) {
-  auto locker = DeviceLockerArena::Get()->GetLocker(device);
-  locker->Barrier();
-}
-
 // Use a set to impose an order on the device locking sequence (ABBA
-// prevention).
+// prevention). If waiters is not nullptr, the device locks are only reserved,
+// and the functions to be called to wait for them are stored in waiters.
 std::vector<xla::util::ExceptionCleanup> LockDevices(
-    const std::set<Device>& devices) {
+    const std::set<Device>& devices,
+    std::vector<std::function<void()>>* waiters) {
+  static std::mutex* reserve_mutex = new std::mutex();
   std::vector<xla::util::ExceptionCleanup> unlocker;
   unlocker.reserve(devices.size());
-  for (auto& device : devices) {
-    unlocker.emplace_back(LockDevice(device));
+  if (waiters != nullptr) {
+    // Tickets for all the devices must be reserved atomically, otherwise two
+    // concurrent reservations could end up being served in different orders
+    // on different devices.
+    std::lock_guard<std::mutex> lock(*reserve_mutex);
+    for (auto& device : devices) {
+      waiters->emplace_back();
+      unlocker.emplace_back(LockDevice(device, &waiters->back()));
+    }
+  } else {
+    for (auto& device : devices) {
+      unlocker.emplace_back(LockDevice(device, nullptr));
+    }
   }
   return unlocker;
 }
 
+// Wakes up the waiters of the placeholders of a failed operation.
+void SetDataError(
+    const std::vector<xla::ComputationClient::DataPtr>& tensors_data,
+    const std::exception_ptr& exptr) {
+  for (auto& xla_data : tensors_data) {
+    if (xla_data != nullptr && !xla_data->HasValue()) {
+      xla_data->SetError(exptr);
+    }
+  }
+}
+
+void WaitDeviceLocks(const std::vector<std::function<void()>>& waiters) {
+  for (auto& waiter : waiters) {
+    waiter();
+  }
+}
+
+// The device locks only order the operations of the same priority class, so
+// the data produced by the in-flight operations of the other classes needs to
+// be waited for.
+void WaitDataValues(
+    const std::vector<xla::ComputationClient::DataPtr>& datas) {
+  for (auto& xla_data : datas) {
+    // WaitValue() checks the value under the data lock, which a bare
+    // HasValue() does not, while the producing operation assigns it.
+    xla_data->WaitValue();
+  }
+}
+
+// Content addressed cache of device data, used for the small and medium sized
+// constant tensors which are fed to the XLA operations (special scalars,
+// masks, lookup tables, ...). Every device has its own cache, each one bounded
+// by the total size of the device data it holds, and sharded by the key hash,
+// as it is looked up by every tracing thread. The byte budget is split evenly
+// among the shards, so device data bigger than the budget of one shard (1/16
+// of XLA_DEVDATA_CACHE_BYTES) evicts all the others from its shard, and only
+// stays cached until the next insertion there. The cacheable tensor size
+// (XLA_DEVDATA_CACHE_MAX_TENSOR_BYTES) should stay below it.
 class XlaDataCacheArena {
  public:
+  struct TensorKey {
+    explicit TensorKey(at::Tensor tensor)
+        : tensor(std::move(tensor)),
+          hash(xla::util::HashCombine(
+              xla::util::GetEnumValue(this->tensor.scalar_type()),
+              TensorHash(this->tensor))) {}
+
+    at::Tensor tensor;
+    size_t hash = 0;
+  };
   struct TensorHasher {
-    size_t operator()(const at::Tensor& tensor) const {
-      return xla::util::HashCombine(
-          xla::util::GetEnumValue(tensor.scalar_type()), TensorHash(tensor));
-    };
+    size_t operator()(const TensorKey& key) const { return key.hash; };
   };
   struct TensorComparer {
-    bool operator()(const at::Tensor& tensor1,
-                    const at::Tensor& tensor2) const {
-      return tensor1.scalar_type() == tensor2.scalar_type() &&
-             tensor1.equal(tensor2);
+    bool operator()(const TensorKey& key1, const TensorKey& key2) const {
+      return key1.hash == key2.hash &&
+             key1.tensor.scalar_type() == key2.tensor.scalar_type() &&
+             key1.tensor.sizes() == key2.tensor.sizes() &&
+             key1.tensor.equal(key2.tensor);
     }
   };
 
   using XlaDataCache =
-      xla::util::Cache<at::Tensor, xla::ComputationClient::Data, TensorHasher,
-                       TensorComparer>;
+      xla::util::ShardedCache<TensorKey, xla::ComputationClient::Data,
+                              TensorHasher, TensorComparer>;
 
-  explicit XlaDataCacheArena(size_t max_cache_size)
-      : max_cache_size_(max_cache_size) {}
+  explicit XlaDataCacheArena(size_t max_cache_bytes)
+      : max_cache_bytes_(max_cache_bytes) {}
 
   XlaDataCache* Get(const Device& device) {
-    std::lock_guard<std::mutex> lock(mutex_);
-    auto it = device_caches_.find(device);
-    if (it == device_caches_.end()) {
-      std::unique_ptr<XlaDataCache> cache(new XlaDataCache(max_cache_size_));
-      it = device_caches_.emplace(device, std::move(cache)).first;
+    // The caches are never destroyed, so every thread can skip the arena lock
+    // when looking up the same device as the last time.
+    thread_local Device last_device;
+    thread_local XlaDataCache* last_cache = nullptr;
+    if (last_cache != nullptr && last_device == device) {
+      return last_cache;
     }
-    return it->second.get();
+    XlaDataCache* cache = nullptr;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      auto it = device_caches_.find(device);
+      if (it == device_caches_.end()) {
+        auto size_fn = [](const TensorKey& key,
+                          const xla::ComputationClient::Data& data) -> size_t {
+          return xla::ShapeUtil::ByteSizeOf(data.shape());
+        };
+        std::unique_ptr<XlaDataCache> new_cache(
+            new XlaDataCache(max_cache_bytes_, size_fn));
+        it = device_caches_.emplace(device, std::move(new_cache)).first;
+      }
+      cache = it->second.get();
+    }
+    last_device = device;
+    last_cache = cache;
+    return cache;
   }
 
  private:
-  size_t max_cache_size_ = 0;
+  size_t max_cache_bytes_ = 0;
   std::mutex mutex_;
   std::map<Device, std::unique_ptr<XlaDataCache>> device_caches_;
 };
 
+// Tracks the points of a step, in number of IR values assigned to tensors
+// since the last step marker, where the pending graph got trimmed. The
+// following steps trim at the same points, so that the partial graphs they
+// produce match the ones of the previous step, and hit the computation cache.
+// The state is kept per device (see DeviceContextArena), so that the step
+// marker resets it whichever thread traced the step.
+class GraphCutTracker {
+ public:
+  // Moves to the next IR value assignment, and returns its index within the
+  // current step.
+  size_t NextOp() {
+    ++op_index_;
+    while (next_learned_cut_ < learned_cuts_.size() &&
+           learned_cuts_[next_learned_cut_] < op_index_) {
+      ++next_learned_cut_;
+    }
+    return op_index_;
+  }
+
+  // Whether the previous step trimmed the graph at the current index.
+  bool IsLearnedCut() const {
+    return next_learned_cut_ < learned_cuts_.size() &&
+           learned_cuts_[next_learned_cut_] == op_index_;
+  }
+
+  void RecordCut() {
+    if (IsLearnedCut()) {
+      ++num_learned_cuts_;
+    }
+    cuts_.push_back(op_index_);
+  }
+
+  // Reports how many of the cuts of the ending step happened at the same
+  // points as the ones of the previous step, and learns the new cut points.
+  void MarkStep() {
+    size_t num_cuts = std::max(cuts_.size(), learned_cuts_.size());
+    if (num_cuts > 0) {
+      XLA_VALUE_METRIC("TrimIrGraphCutStability",
+                       100.0 * num_learned_cuts_ / num_cuts);
+      if (cuts_ == learned_cuts_) {
+        XLA_COUNTER("TrimIrGraphStableSteps", 1);
+      }
+    }
+    learned_cuts_ = std::move(cuts_);
+    cuts_.clear();
+    op_index_ = 0;
+    next_learned_cut_ = 0;
+    num_learned_cuts_ = 0;
+  }
+
+ private:
+  size_t op_index_ = 0;
+  std::vector<size_t> learned_cuts_;
+  size_t next_learned_cut_ = 0;
+  std::vector<size_t> cuts_;
+  size_t num_learned_cuts_ = 0;
+};
+
+// Whether graph trimming should happen at points which are deterministic
+// within a step, and learned from the previous step.
+bool UseStableGraphCuts() {
+  static bool stable_cuts =
+      xla::sys_util::GetEnvBool("TRIM_GRAPH_STABLE_CUTS", false);
+  return stable_cuts;
+}
+
+// Tracks the scalars fed to the IR graphs, by their index within the current
+// step (number of scalars created since the last step marker). The special
+// scalars, which would be embedded as constants, get promoted to device data
+// when the scalar at the same index had a different value in the previous step,
+// so that schedules moving through them (like a loss scale hitting 1.0) do not
+// produce new graphs. Like for the graph cuts, the state is kept per device.
+class ScalarPromotionTracker {
+ public:
+  // Records the next scalar of the step, and returns whether it should be
+  // routed to device data, even if special.
+  bool NextScalar(const at::Scalar& value, xla::PrimitiveType type) {
+    if (!value.isIntegral() && !value.isFloatingPoint()) {
+      return false;
+    }
+    size_t index = scalars_.size();
+    scalars_.push_back({value.toDouble(), type});
+    if (index < learned_scalars_.size() &&
+        learned_scalars_[index].type == type &&
+        learned_scalars_[index].value != scalars_.back().value &&
+        promoted_.insert(index).second) {
+      XLA_COUNTER("PromotedScalars", 1);
+    }
+    return promoted_.count(index) > 0;
+  }
+
+  void MarkStep() {
+    learned_scalars_ = std::move(scalars_);
+    scalars_.clear();
+  }
+
+ private:
+  struct ScalarInfo {
+    double value;
+    xla::PrimitiveType type;
+  };
+
+  std::vector<ScalarInfo> learned_scalars_;
+  std::vector<ScalarInfo> scalars_;
+  std::set<size_t> promoted_;
+};
+
 XlaDataCacheArena::XlaDataCache* GetXlaDataCache(const Device& device) {
-  static const size_t kMaxCacheSize =
-      xla::sys_util::GetEnvInt("XLA_DEVDATA_CACHE_SIZE", 128);
-  static XlaDataCacheArena* arena = new XlaDataCacheArena(kMaxCacheSize);
+  static const size_t kMaxCacheBytes =
+      xla::sys_util::GetEnvInt("XLA_DEVDATA_CACHE_BYTES", 128 * 1024 * 1024);
+  static XlaDataCacheArena* arena = new XlaDataCacheArena(kMaxCacheBytes);
   return arena->Get(device);
 }
 
+// Whether tensors whose data is routed through the device data cache should
+// be uploaded to all the replication devices on a cache miss.
+bool UseDeviceDataBroadcast() {
+  static bool broadcast =
+      xla::sys_util::GetEnvBool("XLA_DEVDATA_CACHE_BROADCAST", false);
+  return broadcast;
+}
+
+bool IsCacheableDeviceData(const at::Tensor& tensor) {
+  static const xla::int64 kMaxTensorBytes = xla::sys_util::GetEnvInt(
+      "XLA_DEVDATA_CACHE_MAX_TENSOR_BYTES", 4 * 1024 * 1024);
+  return tensor.numel() * tensor.element_size() <= kMaxTensorBytes;
+}
+
+// Uploads the tensor to all the replication devices which do not have it
+// within their cache yet, and returns the device data for the device.
+xla::ComputationClient::DataPtr BroadcastDeviceData(
+    const XlaDataCacheArena::TensorKey& key, const Device& device) {
+  const std::vector<std::string>& replication_devices =
+      xla::ComputationClient::Get()->GetReplicationDevices();
+  std::string device_str = device.ToString();
+  if (std::find(replication_devices.begin(), replication_devices.end(),
+                device_str) == replication_devices.end()) {
+    return nullptr;
+  }
+  std::vector<XlaDataCacheArena::XlaDataCache*> caches;
+  std::vector<at::Tensor> tensors;
+  std::vector<std::string> devices;
+  for (auto& replication_device : replication_devices) {
+    XlaDataCacheArena::XlaDataCache* cache =
+        GetXlaDataCache(Device(replication_device));
+    if (replication_device == device_str || cache->Get(key) == nullptr) {
+      caches.push_back(cache);
+      tensors.push_back(key.tensor);
+      devices.push_back(replication_device);
+    }
+  }
+  std::vector<xla::ComputationClient::DataPtr> handles =
+      CreateTensorsData(tensors, devices);
+  XLA_COUNTER("DeviceDataCacheBroadcasts", 1);
+  xla::ComputationClient::DataPtr device_data;
+  for (size_t i = 0; i < handles.size(); ++i) {
+    xla::ComputationClient::DataPtr data = caches[i]->Add(key, handles[i]);
+    if (devices[i] == device_str) {
+      device_data = std::move(data);
+    }
+  }
+  return device_data;
+}
+
 xla::ComputationClient::DataPtr GetDeviceData(const at::Tensor& tensor,
                                               const Device& device) {
+  XlaDataCacheArena::TensorKey key(tensor);
   XlaDataCacheArena::XlaDataCache* cache = GetXlaDataCache(device);
-  xla::ComputationClient::DataPtr device_data = cache->Get(tensor);
+  xla::ComputationClient::DataPtr device_data = cache->Get(key);
   if (device_data == nullptr) {
-    device_data = TensorToXlaData(tensor, device);
-    cache->Add(CopyTensor(tensor), device_data);
+    XLA_COUNTER("DeviceDataCacheMiss", 1);
+    // The cache holds references to the key tensors, so those must not be
+    // shared with the callers, who could modify them in place.
+    XlaDataCacheArena::TensorKey cache_key(CopyTensor(tensor));
+    if (UseDeviceDataBroadcast()) {
+      device_data = BroadcastDeviceData(cache_key, device);
+    }
+    if (device_data == nullptr) {
+      device_data = UploadBatcher::Get()->Add(cache_key.tensor, device);
+      if (device_data == nullptr) {
+        device_data = TensorToXlaData(cache_key.tensor, device);
+      }
+      device_data = cache->Add(std::move(cache_key), std::move(device_data));
+    }
   }
   return device_data;
 }
@@ -224,10 +551,175 @@ bool IsSpecialScalar(at::Scalar value) {
   return false;
 }
 
+bool UseScalarPromotion() {
+  static bool promote_scalars =
+      xla::sys_util::GetEnvBool("XLA_PROMOTE_CHANGING_SCALARS", false);
+  return promote_scalars;
+}
+
+// Whether the scalar should be embedded within the graph as a constant, instead
+// of being fed to it as device data. The promoted scalars come from the
+// ScalarPromotionTracker of the device.
+bool IsConstantScalar(const at::Scalar& value, bool promoted) {
+  if (!IsSpecialScalar(value)) {
+    return false;
+  }
+  if (promoted) {
+    XLA_COUNTER("PromotedScalarData", 1);
+    return false;
+  }
+  return true;
+}
+
 bool ShouldSyncIrValue(const ir::Value& ir_value) {
   return ir_value->op() != ir::ops::xla_not_supported;
 }
 
+// The maximum number of intermediate results of the graph synced by a
+// GetTensors(), which are materialized together with the fetched tensors,
+// because the IR of other pending tensors uses them.
+size_t GetMaxSharedOutputs() {
+  static size_t max_outputs =
+      xla::sys_util::GetEnvInt("XLA_SYNC_SHARED_OUTPUTS", 8);
+  return max_outputs;
+}
+
+// The shared intermediate results larger than this do not get materialized, as
+// the device memory they hold would outweigh the saved computation.
+xla::int64 GetMaxSharedOutputBytes() {
+  static xla::int64 max_bytes = xla::sys_util::GetEnvInt(
+      "XLA_SYNC_SHARED_OUTPUT_MAX_BYTES", 64 * 1024 * 1024);
+  return max_bytes;
+}
+
+// The device memory budget of the synced graphs, checked against the peak
+// memory estimate of their intermediate results and parameters. Graphs which
+// exceed it are split. Zero disables the check.
+xla::int64 GetGraphMemoryBudget() {
+  static xla::int64 budget =
+      xla::sys_util::GetEnvInt("XLA_GRAPH_MEMORY_BUDGET", 0);
+  return budget;
+}
+
+// The maximum number of parts a synced graph exceeding the memory budget gets
+// split into.
+size_t GetMaxGraphMemorySplits() {
+  static size_t max_splits =
+      xla::sys_util::GetEnvInt("XLA_GRAPH_MEMORY_MAX_SPLITS", 16);
+  return max_splits;
+}
+
+// The number of nodes above which the synced graphs are compiled as a chain of
+// smaller computations, trading some fusion for a faster compilation. Zero
+// disables the partitioning.
+size_t GetGraphCompileMaxNodes() {
+  static size_t max_nodes =
+      xla::sys_util::GetEnvInt("XLA_GRAPH_COMPILE_MAX_NODES", 0);
+  return max_nodes;
+}
+
+// Buffer donation requires the server side runtime to support input/output
+// aliasing of the computation parameters.
+bool UseBufferDonation() {
+  static bool donate_buffers =
+      xla::sys_util::GetEnvBool("XLA_DONATE_BUFFERS", false);
+  return donate_buffers;
+}
+
+// Releases the computation parameters which no tensor refers to anymore, as
+// soon as the execution consuming them has been dispatched.
+bool UseEagerRelease() {
+  static bool eager_release =
+      xla::sys_util::GetEnvBool("XLA_EAGER_RELEASE", true);
+  return eager_release;
+}
+
+void ReleaseConsumedParameters(
+    std::vector<xla::ComputationClient::DataPtr>* parameters_data) {
+  // The replicated data tracking can resurrect the master data through its
+  // weak references, so it must go through the ordinary release.
+  if (UseEagerRelease() && !ReplicatedData::Get()->IsEnabled()) {
+    xla::ComputationClient::Get()->ReleaseConsumedData(parameters_data);
+  }
+}
+
+// Whether the bool tensor is uploaded bit packed, which shrinks the transfer
+// by up to 8x, at the cost of an unpack within the consuming computation. The
+// tensors going through the device data cache are checked first, and are not
+// packed.
+bool UsePackedBoolUpload(const at::Tensor& tensor, const Device& device) {
+  static const xla::int64 min_elements =
+      xla::sys_util::GetEnvInt("XLA_PACKED_BOOL_MIN_ELEMENTS", 0);
+  return min_elements > 0 && tensor.scalar_type() == at::ScalarType::Bool &&
+         tensor.numel() >= min_elements &&
+         MakeXlaPrimitiveType(tensor.scalar_type(), &device) ==
+             xla::PrimitiveType::PRED;
+}
+
+bool UseParallelSync() {
+  static bool parallel_sync =
+      xla::sys_util::GetEnvBool("XLA_PARALLEL_SYNC", true);
+  return parallel_sync;
+}
+
+bool HasMultipleDevices(const std::vector<XLATensor>& tensors) {
+  for (size_t i = 1; i < tensors.size(); ++i) {
+    if (tensors[i].GetDevice() != tensors[0].GetDevice()) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool UseAsyncCompile() {
+  static bool async_compile =
+      xla::sys_util::GetEnvBool("XLA_ASYNC_COMPILE", false);
+  return async_compile;
+}
+
+// Tracks the graph hashes whose compilation has been scheduled in background,
+// so that the same graph does not get compiled more than once while the first
+// compilation is still in flight.
+class PendingCompilations {
+ public:
+  static PendingCompilations* Get() {
+    static PendingCompilations* pending = new PendingCompilations();
+    return pending;
+  }
+
+  // Returns true if the hash was not already pending.
+  bool Add(size_t hash) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return hashes_.insert(hash).second;
+  }
+
+  void Remove(size_t hash) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    hashes_.erase(hash);
+  }
+
+ private:
+  std::mutex mutex_;
+  std::unordered_set<size_t> hashes_;
+};
+
+// The budget, in bytes, of the host copies of the large tensors which are kept
+// next to their (valid) device data, per device. A negative value keeps all of
+// them.
+xla::int64 GetHostCopyBudget() {
+  static const xla::int64 budget =
+      xla::sys_util::GetEnvInt("XLA_HOST_COPY_BUDGET_BYTES", -1);
+  return budget;
+}
+
+// The host copies of the tensors up to this size are always kept, as they are
+// cheap and save a device round trip to a following ToTensor().
+xla::int64 GetHostCopyMaxKeptBytes() {
+  static const xla::int64 max_kept_bytes =
+      xla::sys_util::GetEnvInt("XLA_HOST_COPY_KEEP_MAX_BYTES", 64 * 1024);
+  return max_kept_bytes;
+}
+
 }  // namespace
 
 // The DeviceContextArena holds per device live information and statistics,
@@ -236,12 +728,69 @@ bool ShouldSyncIrValue(const ir::Value& ir_value) {
 // operations and ensure the same XLA computations are created during the
 // training loops.
 class XLATensor::DeviceContextArena {
+  // The tensors registry is split into shards (selected by the tensor unique
+  // ID), each one with its own lock, so that threads creating and destroying
+  // tensors concurrently (like in DataParallel runs) rarely contend.
+  static const size_t kNumShards = 32;
+  static const size_t kMaxQueuedUploads = 1024;
+
+  struct TensorsShard {
+    std::mutex lock;
+    std::unordered_map<xla::int64, std::weak_ptr<Data>> tensors_data;
+    // The tensors which may need a sync: the ones without device data, or
+    // with a view. Tensors get added when they lose their device data, and
+    // are removed lazily, by the scans finding they got it back.
+    std::unordered_map<xla::int64, std::weak_ptr<Data>> pending_data;
+  };
+
+  // The host copy is only valid as long as the tensor holds the same device
+  // data, with the same generation.
+  struct HostCopy {
+    at::Tensor tensor;
+    std::list<xla::int64>::iterator lru_it;
+    xla::int64 bytes = 0;
+    xla::int64 xla_data_id = 0;
+    size_t generation = 0;
+  };
+
+  // The large host copies which are held next to a valid device data, which
+  // get dropped in LRU order once their total size exceeds the budget. The
+  // arena owns them, rather than the tensors, so that the eviction never
+  // touches the data of a tensor another thread might be using.
+  struct HostCopies {
+    std::unordered_map<xla::int64, HostCopy> copies;
+    // The unique IDs of the tensors, most recently used first.
+    std::list<xla::int64> lru;
+    xla::int64 bytes = 0;
+  };
+
   struct DeviceContext {
+    TensorsShard* GetShard(xla::int64 unique_id) {
+      return &shards[static_cast<size_t>(unique_id) % kNumShards];
+    }
+
     std::mutex lock;
-    std::map<xla::int64, std::weak_ptr<Data>> tensors_data;
+    TensorsShard shards[kNumShards];
     std::set<size_t> sync_hashes;
+    // The seed of the current step, and the seed of the last random operation,
+    // in both host and IR form.
+    xla::uint64 seed = 101;
+    xla::uint64 running_seed = 101;
+    ir::Value seed_ir_value;
+    HostCopies host_copies;
+    // The tensors holding host data only, whose uploads are batched together
+    // (see XLATensor::QueueUpload()), by queueing thread. The uploads only
+    // batch the tensors queued by the same thread, so that they never assign
+    // the device data of a tensor another thread is using.
+    std::map<std::thread::id, std::vector<std::weak_ptr<Data>>> queued_uploads;
+    GraphCutTracker graph_cuts;
+    ScalarPromotionTracker scalar_promotions;
   };
 
+  static bool IsPending(const Data& data) {
+    return data.xla_data == nullptr || data.view != nullptr;
+  }
+
  public:
   static DeviceContextArena* Get() {
     static DeviceContextArena* arena = new DeviceContextArena();
@@ -249,29 +798,215 @@ class XLATensor::DeviceContextArena {
   }
 
   void RegisterTensor(std::shared_ptr<Data> data) {
-    DeviceContext* devctx = GetDeviceContext(data->device);
-    std::lock_guard<std::mutex> lock(devctx->lock);
-    devctx->tensors_data.emplace(data->unique_id, data);
+    TensorsShard* shard =
+        GetDeviceContext(data->device)->GetShard(data->unique_id);
+    {
+      std::lock_guard<std::mutex> lock(shard->lock);
+      shard->tensors_data.emplace(data->unique_id, data);
+      if (IsPending(*data)) {
+        shard->pending_data.emplace(data->unique_id, data);
+      }
+    }
     XLA_COUNTER("CreateXlaTensor", 1);
   }
 
   void UnregisterTensor(Data* data) {
+    TensorsShard* shard =
+        GetDeviceContext(data->device)->GetShard(data->unique_id);
+    {
+      std::lock_guard<std::mutex> lock(shard->lock);
+      shard->tensors_data.erase(data->unique_id);
+      shard->pending_data.erase(data->unique_id);
+    }
+    if (GetHostCopyBudget() >= 0) {
+      // The host copy is released once the lock is not held anymore.
+      at::Tensor released;
+      DeviceContext* devctx = GetDeviceContext(data->device);
+      std::lock_guard<std::mutex> lock(devctx->lock);
+      released = EraseHostCopy(&devctx->host_copies, data->unique_id);
+    }
+    XLA_COUNTER("DestroyXlaTensor", 1);
+  }
+
+  // Moves the host copy of a tensor which holds a valid device data as well
+  // into the host copies of its device, and drops the least recently used
+  // ones (which can be fetched back from device) if they exceed the budget.
+  // Must be called by the thread owning the tensor.
+  void RetainHostCopy(Data* data) {
+    xla::int64 budget = GetHostCopyBudget();
+    if (budget < 0 || !data->tensor_data || data->xla_data == nullptr ||
+        data->view != nullptr) {
+      return;
+    }
+    xla::int64 bytes =
+        data->tensor_data->numel() * data->tensor_data->element_size();
+    if (bytes <= GetHostCopyMaxKeptBytes()) {
+      return;
+    }
+    // The dropped host copies are released once the lock is not held anymore.
+    std::vector<at::Tensor> released;
     DeviceContext* devctx = GetDeviceContext(data->device);
     std::lock_guard<std::mutex> lock(devctx->lock);
-    devctx->tensors_data.erase(data->unique_id);
-    XLA_COUNTER("DestroyXlaTensor", 1);
+    HostCopies* host_copies = &devctx->host_copies;
+    released.push_back(EraseHostCopy(host_copies, data->unique_id));
+    host_copies->lru.push_front(data->unique_id);
+    HostCopy& host_copy = host_copies->copies[data->unique_id];
+    host_copy.tensor = std::move(*data->tensor_data);
+    host_copy.lru_it = host_copies->lru.begin();
+    host_copy.bytes = bytes;
+    host_copy.xla_data_id = data->xla_data->unique_id();
+    host_copy.generation = data->generation;
+    host_copies->bytes += bytes;
+    data->tensor_data = c10::nullopt;
+    while (host_copies->bytes > budget && !host_copies->lru.empty()) {
+      xla::int64 unique_id = host_copies->lru.back();
+      XLA_COUNTER("DroppedHostCopies", 1);
+      XLA_COUNTER("DroppedHostCopyBytes",
+                  host_copies->copies.at(unique_id).bytes);
+      released.push_back(EraseHostCopy(host_copies, unique_id));
+    }
+  }
+
+  // Returns the host copy RetainHostCopy() moved out of the tensor, if it is
+  // still valid, marking it as the most recently used one.
+  c10::optional<at::Tensor> GetHostCopy(const Data& data) {
+    if (data.xla_data == nullptr || data.view != nullptr) {
+      return c10::nullopt;
+    }
+    at::Tensor released;
+    DeviceContext* devctx = GetDeviceContext(data.device);
+    std::lock_guard<std::mutex> lock(devctx->lock);
+    HostCopies* host_copies = &devctx->host_copies;
+    auto it = host_copies->copies.find(data.unique_id);
+    if (it == host_copies->copies.end()) {
+      return c10::nullopt;
+    }
+    if (it->second.xla_data_id != data.xla_data->unique_id() ||
+        it->second.generation != data.generation) {
+      // The tensor changed since its host copy was recorded.
+      released = EraseHostCopy(host_copies, data.unique_id);
+      return c10::nullopt;
+    }
+    host_copies->lru.splice(host_copies->lru.begin(), host_copies->lru,
+                            it->second.lru_it);
+    return it->second.tensor;
+  }
+
+  void QueueUpload(std::shared_ptr<Data> data) {
+    DeviceContext* devctx = GetDeviceContext(data->device);
+    std::lock_guard<std::mutex> lock(devctx->lock);
+    std::vector<std::weak_ptr<Data>>* queued =
+        &devctx->queued_uploads[std::this_thread::get_id()];
+    if (queued->size() >= kMaxQueuedUploads) {
+      // The queued tensors might never be used by a computation, so the dead
+      // ones are pruned once in a while.
+      queued->erase(std::remove_if(queued->begin(), queued->end(),
+                                   [](const std::weak_ptr<Data>& queued_data) {
+                                     return queued_data.expired();
+                                   }),
+                    queued->end());
+    }
+    queued->push_back(std::move(data));
+  }
+
+  // Uploads the tensors of the device queued by the calling thread, which
+  // still hold host data only, with a single transfer. Returns whether any
+  // tensor got uploaded.
+  bool UploadQueuedTensors(const Device& device) {
+    std::vector<std::weak_ptr<Data>> queued;
+    {
+      DeviceContext* devctx = GetDeviceContext(device);
+      std::lock_guard<std::mutex> lock(devctx->lock);
+      auto it = devctx->queued_uploads.find(std::this_thread::get_id());
+      if (it == devctx->queued_uploads.end()) {
+        return false;
+      }
+      queued.swap(it->second);
+      devctx->queued_uploads.erase(it);
+    }
+    std::vector<std::shared_ptr<Data>> uploads;
+    std::vector<at::Tensor> at_tensors;
+    std::vector<std::string> devices;
+    for (auto& queued_data : queued) {
+      std::shared_ptr<Data> data = queued_data.lock();
+      if (data != nullptr && data->tensor_data && data->xla_data == nullptr &&
+          !data->ir_value && data->view == nullptr) {
+        at_tensors.push_back(*data->tensor_data);
+        devices.push_back(device.ToString());
+        uploads.push_back(std::move(data));
+      }
+    }
+    if (uploads.empty()) {
+      return false;
+    }
+    XLA_COUNTER("QueuedUploads", 1);
+    XLA_COUNTER("QueuedUploadTensors", uploads.size());
+    std::vector<xla::ComputationClient::DataPtr> handles =
+        CreateTensorsData(at_tensors, devices);
+    for (size_t i = 0; i < handles.size(); ++i) {
+      if (uploads[i]->memory_category) {
+        handles[i]->SetMemoryCategory(*uploads[i]->memory_category);
+      }
+      uploads[i]->xla_data = std::move(handles[i]);
+      RetainHostCopy(uploads[i].get());
+    }
+    return true;
+  }
+
+  void MarkPendingTensor(std::shared_ptr<Data> data) {
+    TensorsShard* shard =
+        GetDeviceContext(data->device)->GetShard(data->unique_id);
+    std::lock_guard<std::mutex> lock(shard->lock);
+    shard->pending_data.emplace(data->unique_id, std::move(data));
+  }
+
+  // Same as GetLiveTensors(), but only returns the tensors which may need a
+  // sync, so that the cost of the step-end syncs depends on the number of
+  // tensors modified by the step, instead of the number of live ones.
+  std::vector<XLATensor> GetPendingTensors(const Device* device) {
+    std::vector<XLATensor> tensors;
+    auto fn = [&](DeviceContext* devctx) {
+      size_t base = tensors.size();
+      for (auto& shard : devctx->shards) {
+        std::lock_guard<std::mutex> lock(shard.lock);
+        for (auto it = shard.pending_data.begin();
+             it != shard.pending_data.end();) {
+          std::shared_ptr<Data> data = it->second.lock();
+          if (data == nullptr || !IsPending(*data)) {
+            it = shard.pending_data.erase(it);
+          } else {
+            tensors.push_back(XLATensor(std::move(data)));
+            ++it;
+          }
+        }
+      }
+      std::sort(tensors.begin() + base, tensors.end(),
+                [](const XLATensor& t1, const XLATensor& t2) {
+                  return t1.GetUniqueId() < t2.GetUniqueId();
+                });
+    };
+    ForAllDeviceContexts(fn, device);
+    return tensors;
   }
 
   std::vector<XLATensor> GetLiveTensors(const Device* device) {
     std::vector<XLATensor> tensors;
     auto fn = [&](DeviceContext* devctx) {
-      std::lock_guard<std::mutex> lock(devctx->lock);
-      for (auto& uid_wptr : devctx->tensors_data) {
-        std::shared_ptr<Data> data = uid_wptr.second.lock();
-        if (data != nullptr) {
-          tensors.push_back(XLATensor(std::move(data)));
+      size_t base = tensors.size();
+      for (auto& shard : devctx->shards) {
+        std::lock_guard<std::mutex> lock(shard.lock);
+        for (auto& uid_wptr : shard.tensors_data) {
+          std::shared_ptr<Data> data = uid_wptr.second.lock();
+          if (data != nullptr) {
+            tensors.push_back(XLATensor(std::move(data)));
+          }
         }
       }
+      // Within a device, tensors are returned sorted by unique ID.
+      std::sort(tensors.begin() + base, tensors.end(),
+                [](const XLATensor& t1, const XLATensor& t2) {
+                  return t1.GetUniqueId() < t2.GetUniqueId();
+                });
     };
     ForAllDeviceContexts(fn, device);
     return tensors;
@@ -285,6 +1020,100 @@ class XLATensor::DeviceContextArena {
     ForAllDeviceContexts(fn, device);
   }
 
+  // Returns the seed for a new random operation, by advancing the running seed
+  // within the IR graph. The step seed enters the graph as device data, so a
+  // seed change does not alter the graph.
+  ir::Value GetRngSeed(const Device& device) {
+    static const xla::uint64 kSeedMul = 214013;
+    static const xla::uint64 kSeedAdd = 2531011;
+    DeviceContext* devctx = GetDeviceContext(device);
+    std::lock_guard<std::mutex> lock(devctx->lock);
+    if (!devctx->seed_ir_value) {
+      devctx->seed_ir_value = ir::MakeNode<ir::ops::DeviceData>(TensorToXlaData(
+          at::scalar_tensor(static_cast<int64_t>(devctx->running_seed),
+                            at::TensorOptions(at::kLong)),
+          device));
+    }
+    xla::PrimitiveType seed_type =
+        devctx->seed_ir_value.shape().element_type();
+    devctx->running_seed = kSeedAdd + kSeedMul * devctx->running_seed;
+    devctx->seed_ir_value =
+        ir::ops::ScalarOp(static_cast<int64_t>(kSeedAdd), seed_type) +
+        ir::ops::ScalarOp(static_cast<int64_t>(kSeedMul), seed_type) *
+            devctx->seed_ir_value;
+    return devctx->seed_ir_value;
+  }
+
+  void SetRngSeed(const Device* device, xla::uint64 seed) {
+    auto fn = [&](DeviceContext* devctx) {
+      std::lock_guard<std::mutex> lock(devctx->lock);
+      devctx->seed = seed;
+      devctx->running_seed = seed;
+      devctx->seed_ir_value = ir::Value();
+    };
+    ForAllDeviceContexts(fn, device);
+  }
+
+  xla::uint64 GetRunningSeed(const Device& device) {
+    DeviceContext* devctx = GetDeviceContext(device);
+    std::lock_guard<std::mutex> lock(devctx->lock);
+    return devctx->running_seed;
+  }
+
+  // Moves to the seed of the next step, which is derived from the one of the
+  // current step only, so that it does not depend on how many random
+  // operations the step ran.
+  void AdvanceStepSeed(const Device* device) {
+    static const xla::uint64 kStepSeedMul = 7012063;
+    static const xla::uint64 kStepSeedAdd = 1012031;
+    auto fn = [&](DeviceContext* devctx) {
+      std::lock_guard<std::mutex> lock(devctx->lock);
+      devctx->seed = kStepSeedAdd + kStepSeedMul * devctx->seed;
+      devctx->running_seed = devctx->seed;
+      devctx->seed_ir_value = ir::Value();
+    };
+    ForAllDeviceContexts(fn, device);
+  }
+
+  // Moves the graph cut tracking of the device to the next IR value
+  // assignment, and returns its index within the current step, together with
+  // whether the previous step trimmed the graph there.
+  size_t NextGraphOp(const Device& device, bool* is_learned_cut) {
+    DeviceContext* devctx = GetDeviceContext(device);
+    std::lock_guard<std::mutex> lock(devctx->lock);
+    size_t op_index = devctx->graph_cuts.NextOp();
+    *is_learned_cut = devctx->graph_cuts.IsLearnedCut();
+    return op_index;
+  }
+
+  void RecordGraphCut(const Device& device) {
+    DeviceContext* devctx = GetDeviceContext(device);
+    std::lock_guard<std::mutex> lock(devctx->lock);
+    devctx->graph_cuts.RecordCut();
+  }
+
+  bool NextScalar(const Device& device, const at::Scalar& value,
+                  xla::PrimitiveType type) {
+    DeviceContext* devctx = GetDeviceContext(device);
+    std::lock_guard<std::mutex> lock(devctx->lock);
+    return devctx->scalar_promotions.NextScalar(value, type);
+  }
+
+  // Ends the step of the graph cut and scalar promotion tracking.
+  void MarkTrackersStep(const Device* device, bool graph_cuts,
+                        bool scalar_promotions) {
+    auto fn = [&](DeviceContext* devctx) {
+      std::lock_guard<std::mutex> lock(devctx->lock);
+      if (graph_cuts) {
+        devctx->graph_cuts.MarkStep();
+      }
+      if (scalar_promotions) {
+        devctx->scalar_promotions.MarkStep();
+      }
+    };
+    ForAllDeviceContexts(fn, device);
+  }
+
   void AddSyncedHash(const Device& device, size_t hash) {
     DeviceContext* devctx = GetDeviceContext(device);
     std::lock_guard<std::mutex> lock(devctx->lock);
@@ -314,12 +1143,41 @@ class XLATensor::DeviceContextArena {
   }
 
   DeviceContext* GetDeviceContext(const Device& device) {
-    std::lock_guard<std::mutex> lock(lock_);
-    auto it = device_contexts_.find(device);
-    if (it == device_contexts_.end()) {
-      it = device_contexts_.emplace(device, new DeviceContext()).first;
+    // Device contexts are never destroyed, so every thread can cache the last
+    // one it looked up, and skip the arena lock in the common case of
+    // consecutive operations on the same device.
+    thread_local Device last_device;
+    thread_local DeviceContext* last_devctx = nullptr;
+    if (last_devctx != nullptr && last_device == device) {
+      return last_devctx;
     }
-    return it->second;
+    DeviceContext* devctx = nullptr;
+    {
+      std::lock_guard<std::mutex> lock(lock_);
+      auto it = device_contexts_.find(device);
+      if (it == device_contexts_.end()) {
+        it = device_contexts_.emplace(device, new DeviceContext()).first;
+      }
+      devctx = it->second;
+    }
+    last_device = device;
+    last_devctx = devctx;
+    return devctx;
+  }
+
+  // Removes the host copy of the tensor, if any, and returns it, so that the
+  // caller can release it once the device context lock is not held anymore.
+  static at::Tensor EraseHostCopy(HostCopies* host_copies,
+                                  xla::int64 unique_id) {
+    at::Tensor tensor;
+    auto it = host_copies->copies.find(unique_id);
+    if (it != host_copies->copies.end()) {
+      tensor = std::move(it->second.tensor);
+      host_copies->bytes -= it->second.bytes;
+      host_copies->lru.erase(it->second.lru_it);
+      host_copies->copies.erase(it);
+    }
+    return tensor;
   }
 
   std::mutex lock_;
@@ -358,8 +1216,11 @@ XLATensor::Async::Async(
     : mwait(1),
       indices(std::move(coll->indices)),
       unlocker(std::move(coll->unlocker)),
+      waiters(std::move(coll->waiters)),
       parameters_data(std::move(parameters_data)),
       device(std::move(device)),
+      hash(coll->hash),
+      priority(ExecutionScheduler::GetThreadPriority()),
       cached_computation(std::move(cached_computation)) {
   tensors_data.reserve(indices.size());
 }
@@ -505,6 +1366,13 @@ xla::ComputationClient::DataPtr XLATensor::GetXlaData() {
   if (up_to_date) {
     xla::ComputationClient::DataPtr xla_data = CurrentXlaData();
     if (xla_data != nullptr) {
+      if (!xla_data->HasValue()) {
+        // The placeholder can still be owned by an in-flight operation, like a
+        // sync in pipelined mode or a device to device copy, or a deferred
+        // upload, so wait for it to land.
+        UploadBatcher::Get()->Flush();
+        xla_data->WaitValue();
+      }
       XLA_CHECK(xla_data->HasValue())
           << "Trying to access XLA data while an async operation is in flight: "
           << xla_data->shape();
@@ -549,7 +1417,11 @@ void XLATensor::SetXlaData(xla::ComputationClient::DataPtr xla_data) {
 
 void XLATensor::SetXlaData(xla::ComputationClient::DataPtr xla_data,
                            bool sync) {
+  if (xla_data != nullptr && data()->memory_category) {
+    xla_data->SetMemoryCategory(*data()->memory_category);
+  }
   data()->xla_data = std::move(xla_data);
+  data()->donor_data_id = 0;
   // Assigning a device data should always clear the IR node, to allow graph
   // trimming. A view cannot be rest though, unless we are at a step-end sync.
   AssignIrValue(ir::Value());
@@ -557,16 +1429,75 @@ void XLATensor::SetXlaData(xla::ComputationClient::DataPtr xla_data,
     data()->view = nullptr;
     data()->tensor_data = c10::nullopt;
   }
+  if (data()->xla_data == nullptr) {
+    MarkPending();
+  }
 }
 
-void XLATensor::SetIrValue(ir::Value ir_value) {
-  data()->xla_data = nullptr;
-  data()->tensor_data = c10::nullopt;
-  data()->generation += 1;
-  if (data()->view != nullptr) {
-    // If we have an active view, and a SetIrValue() happens, it means we are
-    // within an in-place execution context, and we need to update the view's
-    // alias as well.
+void XLATensor::MarkPending() const {
+  DeviceContextArena::Get()->MarkPendingTensor(data_ptr());
+}
+
+void XLATensor::RetainHostCopy() const {
+  DeviceContextArena::Get()->RetainHostCopy(data());
+}
+
+void XLATensor::QueueUpload() const {
+  c10::optional<at::Tensor> tensor_data = CurrentTensorData();
+  // The rank 0 tensors are lowered as constants whenever possible, which is
+  // better than uploading them.
+  if (tensor_data && (tensor_data->dim() > 0 || tensor_data->numel() != 1) &&
+      data()->xla_data == nullptr && !data()->ir_value &&
+      data()->view == nullptr) {
+    DeviceContextArena::Get()->QueueUpload(data_ptr());
+  }
+}
+
+void XLATensor::SetHostCopy(at::Tensor tensor) {
+  SetTensorData(std::move(tensor));
+  if (data()->xla_data != nullptr) {
+    RetainHostCopy();
+  }
+}
+
+void XLATensor::SetMaterialize(bool materialize) {
+  data()->materialize = materialize;
+}
+
+void XLATensor::SetMemoryCategory(xla::MemoryTracker::Category category) {
+  data()->memory_category = category;
+  if (data()->xla_data != nullptr) {
+    data()->xla_data->SetMemoryCategory(category);
+  }
+}
+
+void XLATensor::OffloadXlaData(at::Tensor tensor_data) {
+  XLA_CHECK(data()->view == nullptr) << "Cannot offload the data of a view";
+  XLA_CHECK(data()->xla_data != nullptr)
+      << "Cannot offload a tensor without device data";
+  XLA_CHECK(!data()->ir_value || dynamic_cast<const ir::ops::DeviceData*>(
+                                     data()->ir_value.node.get()) != nullptr)
+      << "Cannot offload a tensor with a pending graph";
+  XLA_CHECK(tensor_data.sizes().equals(
+      xla::util::ToVector<int64_t>(shape().get().dimensions())));
+  AssignIrValue(ir::Value());
+  data()->xla_data = nullptr;
+  data()->tensor_data = std::move(tensor_data);
+  MarkPending();
+}
+
+void XLATensor::SetIrValue(ir::Value ir_value) {
+  if (data()->xla_data != nullptr) {
+    data()->donor_data_id = data()->xla_data->unique_id();
+    data()->xla_data = nullptr;
+    MarkPending();
+  }
+  data()->tensor_data = c10::nullopt;
+  data()->generation += 1;
+  if (data()->view != nullptr) {
+    // If we have an active view, and a SetIrValue() happens, it means we are
+    // within an in-place execution context, and we need to update the view's
+    // alias as well.
     data()->view = UpdateView(data()->view, std::move(ir_value));
   } else {
     AssignIrValue(std::move(ir_value));
@@ -594,8 +1525,17 @@ void XLATensor::TryLimitGraphSize() {
       xla::sys_util::GetEnvInt("TRIM_GRAPH_CHECK_FREQUENCY", 1000);
   static const size_t kMaxPendingGraphSize =
       xla::sys_util::GetEnvInt("TRIM_GRAPH_SIZE", 50000);
-  static std::atomic<size_t> counter(1);
-  if (data()->ir_value && counter.fetch_add(1) % kCheckFrequency == 0) {
+  thread_local size_t counter = 1;
+  if (UseStableGraphCuts()) {
+    TryLimitGraphSizeStable(kCheckFrequency, kMaxPendingGraphSize);
+    return;
+  }
+  // The graph size bound tracked by the IR nodes is inexpensive to check, and
+  // as long as it is within limits, there is no need to walk the graph to
+  // compute the exact size.
+  if (data()->ir_value &&
+      data()->ir_value->graph_size_bound() > kMaxPendingGraphSize &&
+      counter++ % kCheckFrequency == 0) {
     size_t graph_size = ir::Util::GetGraphSize({data()->ir_value.node.get()});
     if (graph_size > kMaxPendingGraphSize) {
       XLA_COUNTER("TrimIrGraph", 1);
@@ -604,6 +1544,32 @@ void XLATensor::TryLimitGraphSize() {
   }
 }
 
+void XLATensor::TryLimitGraphSizeStable(size_t check_frequency,
+                                        size_t max_graph_size) {
+  // Unlike the thread counter, the index within the step is the same at the
+  // same point of every step, and so are the checks which happen there.
+  bool is_learned_cut = false;
+  size_t op_index =
+      DeviceContextArena::Get()->NextGraphOp(GetDevice(), &is_learned_cut);
+  if (!data()->ir_value) {
+    return;
+  }
+  bool cut = false;
+  if (is_learned_cut) {
+    XLA_COUNTER("TrimIrGraphLearnedCut", 1);
+    cut = true;
+  } else if (data()->ir_value->graph_size_bound() > max_graph_size &&
+             op_index % check_frequency == 0) {
+    cut = ir::Util::GetGraphSize({data()->ir_value.node.get()}) >
+          max_graph_size;
+  }
+  if (cut) {
+    XLA_COUNTER("TrimIrGraph", 1);
+    DeviceContextArena::Get()->RecordGraphCut(GetDevice());
+    ApplyPendingGraph();
+  }
+}
+
 ir::Value XLATensor::GetIrValue() const {
   ir::Value ir_value = CurrentIrValue();
   if (ir_value) {
@@ -622,6 +1588,13 @@ ir::Value XLATensor::GetIrValue() const {
   }
   c10::optional<at::Tensor> tensor_data = CurrentTensorData();
   XLA_CHECK(tensor_data);
+  if (DeviceContextArena::Get()->UploadQueuedTensors(GetDevice()) &&
+      data()->xla_data != nullptr) {
+    // The tensor was queued for upload, together with others, which all got
+    // their device data with the same transfer.
+    AssignIrValue(CreateTensorNode(data()->xla_data));
+    return data()->ir_value;
+  }
   AssignIrValue(GetIrValueForTensor(*tensor_data, GetDevice()));
   return data()->ir_value;
 }
@@ -641,6 +1614,9 @@ c10::optional<at::Tensor> XLATensor::CurrentTensorData() const {
   if (data()->view != nullptr && !data()->view->IsUpToDate()) {
     return c10::nullopt;
   }
+  if (!data()->tensor_data && GetHostCopyBudget() >= 0) {
+    return DeviceContextArena::Get()->GetHostCopy(*data());
+  }
   return data()->tensor_data;
 }
 
@@ -649,12 +1625,22 @@ ir::Value XLATensor::GetIrValueForTensor(const at::Tensor& tensor,
   xla::ComputationClient::DataPtr data;
   if (tensor.dim() == 0 && tensor.numel() == 1) {
     at::Scalar value = tensor.item();
-    if (IsSpecialScalar(value)) {
-      return ir::ops::ScalarOp(
-          std::move(value),
-          MakeXlaPrimitiveType(tensor.scalar_type(), &device));
+    xla::PrimitiveType type =
+        MakeXlaPrimitiveType(tensor.scalar_type(), &device);
+    bool promoted = UseScalarPromotion() &&
+                    DeviceContextArena::Get()->NextScalar(device, value, type);
+    if (IsConstantScalar(value, promoted)) {
+      return ir::ops::ScalarOp(std::move(value), type);
     }
     data = GetDeviceData(tensor, device);
+  } else if (IsCacheableDeviceData(tensor)) {
+    data = GetDeviceData(tensor, device);
+  } else if (UsePackedBoolUpload(tensor, device)) {
+    // The bits get unpacked on device, by the computation consuming them.
+    xla::Shape shape = CreateComputationShapeFromTensor(tensor, &device);
+    ir::Value words = ir::MakeNode<ir::ops::DeviceData>(
+        TensorToXlaData(PackBoolTensor(tensor), device));
+    return ir::ops::UnpackBits(words, shape);
   } else {
     data = TensorToXlaData(tensor, device);
   }
@@ -664,7 +1650,9 @@ ir::Value XLATensor::GetIrValueForTensor(const at::Tensor& tensor,
 ir::Value XLATensor::GetIrValueForScalar(at::Scalar value,
                                          xla::PrimitiveType type,
                                          const Device& device) {
-  if (IsSpecialScalar(value)) {
+  bool promoted = UseScalarPromotion() &&
+                  DeviceContextArena::Get()->NextScalar(device, value, type);
+  if (IsConstantScalar(value, promoted)) {
     return ir::ops::ScalarOp(std::move(value), type);
   }
   xla::ComputationClient::DataPtr data =
@@ -727,6 +1715,7 @@ std::shared_ptr<View> XLATensor::CreateView(ViewInfo view_info) const {
   data()->view = std::make_shared<View>(ir_value.shape(), alias,
                                         std::move(this_view_info));
   AssignIrValue(ir::Value());
+  MarkPending();
   return std::make_shared<View>(view_info.shape, alias, view_info);
 }
 
@@ -739,14 +1728,61 @@ at::Tensor XLATensor::ToTensor() {
   if (!tensor_data) {
     // The GetXlaData() call will trigger an ApplyPendingGraph() if an IR Node
     // is available on the tensor.
-    std::vector<xla::Literal> literals =
-        xla::ComputationClient::Get()->TransferFromServer({GetXlaData()});
-    tensor_data = MakeTensorFromXlaLiteral(literals.front(), dtype());
+    std::vector<at::Tensor> tensors =
+        XlaDataToTensors({GetXlaData()}, {dtype()});
+    tensor_data = std::move(tensors.front());
     SetTensorData(*tensor_data);
   }
+  if (data()->xla_data != nullptr) {
+    RetainHostCopy();
+  }
   return *tensor_data;
 }
 
+at::Scalar XLATensor::ToScalar() {
+  static const size_t max_batch =
+      xla::sys_util::GetEnvInt("XLA_SCALAR_READ_BATCH", 64);
+  c10::optional<at::Tensor> tensor_data = CurrentTensorData();
+  if (tensor_data) {
+    return tensor_data->item();
+  }
+  XLA_COUNTER("ScalarReads", 1);
+  std::vector<xla::ComputationClient::DataPtr> xla_data({GetXlaData()});
+  std::vector<at::ScalarType> element_types({dtype()});
+  std::vector<XLATensor> batched_tensors;
+  if (max_batch > 1) {
+    Device device = GetDevice();
+    std::vector<XLATensor> live_tensors = GetLiveTensors(&device);
+    // Visit the most recently created tensors first, as those are the ones
+    // computed by the last step.
+    for (auto it = live_tensors.rbegin(); it != live_tensors.rend(); ++it) {
+      if (batched_tensors.size() + 1 >= max_batch) {
+        break;
+      }
+      XLATensor& tensor = *it;
+      // Only pick the tensors whose value is already on device, so that the
+      // batching never triggers a computation.
+      xla::ComputationClient::DataPtr tensor_xla_data = tensor.CurrentXlaData();
+      if (tensor_xla_data == nullptr || tensor_xla_data == xla_data.front() ||
+          !tensor_xla_data->HasValue() || tensor.data()->view != nullptr ||
+          tensor.data()->tensor_data ||
+          xla::ShapeUtil::ElementsIn(tensor_xla_data->shape()) != 1) {
+        continue;
+      }
+      xla_data.push_back(std::move(tensor_xla_data));
+      element_types.push_back(tensor.dtype());
+      batched_tensors.push_back(std::move(tensor));
+    }
+    XLA_COUNTER("BatchedScalarReads", batched_tensors.size());
+  }
+  std::vector<at::Scalar> scalars = XlaDataToScalars(xla_data, element_types);
+  for (size_t i = 0; i < batched_tensors.size(); ++i) {
+    batched_tensors[i].SetTensorData(at::scalar_tensor(
+        scalars[i + 1], at::TensorOptions(element_types[i + 1])));
+  }
+  return scalars.front();
+}
+
 void XLATensor::SetScalarType(
     c10::optional<at::ScalarType> logical_element_type) {
   data()->logical_element_type = logical_element_type;
@@ -758,6 +1794,7 @@ void XLATensor::SetTensor(at::Tensor tensor) {
   data()->xla_data = nullptr;
   AssignIrValue(ir::Value());
   data()->generation += 1;
+  MarkPending();
 }
 
 void XLATensor::UpdateFromTensor(at::Tensor tensor) {
@@ -768,26 +1805,35 @@ void XLATensor::UpdateFromTensor(at::Tensor tensor) {
   }
   data()->xla_data = nullptr;
   AssignIrValue(ir::Value());
+  MarkPending();
 }
 
 std::vector<XLATensor> XLATensor::GetLiveTensors(const Device* device) {
   return DeviceContextArena::Get()->GetLiveTensors(device);
 }
 
+std::vector<XLATensor> XLATensor::GetPendingTensors(const Device* device) {
+  return DeviceContextArena::Get()->GetPendingTensors(device);
+}
+
 std::vector<xla::ComputationClient::DataPtr> XLATensor::GatherTensorsXlaData(
     const std::vector<XLATensor>& tensors,
     tensorflow::gtl::ArraySlice<const size_t> indices,
     tensorflow::gtl::ArraySlice<const xla::ComputationClient::DataPtr>
         tensors_data) {
+  // The indices are in the graph roots order, which is not the tensors one.
+  std::vector<xla::int64> data_positions(tensors.size(), -1);
+  for (size_t i = 0; i < indices.size(); ++i) {
+    if (indices[i] < tensors.size()) {
+      data_positions[indices[i]] = i;
+    }
+  }
   std::vector<xla::ComputationClient::DataPtr> result_tensors_data;
-  size_t indices_index = 0;
   for (size_t i = 0; i < tensors.size(); ++i) {
-    if (indices_index < indices.size() && i == indices[indices_index]) {
-      // If we are at the current index (it means that the tensor at index
-      // 'i' had an IR node to sync, use the XLA data held within the Async
-      // object.
-      result_tensors_data.push_back(tensors_data[indices_index]);
-      ++indices_index;
+    if (data_positions[i] >= 0) {
+      // If the tensor at index 'i' had an IR node to sync, use the XLA data
+      // held within the Async object.
+      result_tensors_data.push_back(tensors_data[data_positions[i]]);
     } else if (!tensors[i].CurrentTensorData()) {
       xla::ComputationClient::DataPtr xla_data = tensors[i].CurrentXlaData();
       XLA_CHECK(xla_data != nullptr);
@@ -797,11 +1843,41 @@ std::vector<xla::ComputationClient::DataPtr> XLATensor::GatherTensorsXlaData(
   return result_tensors_data;
 }
 
+std::vector<at::Tensor> XLATensor::FetchTensors(
+    const std::vector<XLATensor>& tensors,
+    tensorflow::gtl::ArraySlice<const xla::ComputationClient::DataPtr>
+        tensors_data) {
+  std::vector<at::ScalarType> element_types;
+  element_types.reserve(tensors_data.size());
+  for (auto& tensor : tensors) {
+    if (!tensor.CurrentTensorData()) {
+      element_types.push_back(tensor.dtype());
+    }
+  }
+  std::vector<at::Tensor> fetched_tensors =
+      XlaDataToTensors(tensors_data, element_types);
+  std::vector<at::Tensor> results;
+  size_t fetched_index = 0;
+  results.reserve(tensors.size());
+  for (auto& tensor : tensors) {
+    c10::optional<at::Tensor> tensor_data = tensor.CurrentTensorData();
+    if (tensor_data) {
+      results.push_back(*tensor_data);
+    } else {
+      XLA_CHECK_LT(fetched_index, fetched_tensors.size());
+      results.push_back(std::move(fetched_tensors[fetched_index]));
+      ++fetched_index;
+    }
+  }
+  return results;
+}
+
 std::vector<at::Tensor> XLATensor::GetTensorsOpByOp(
     std::vector<XLATensor>* tensors) {
   SyncTensorsConfig config;
   config.force_xla_data = false;
   SyncTensorCollection coll = CollectSyncTensors(*tensors, config);
+  WaitDeviceLocks(coll.waiters);
   std::vector<xla::ComputationClient::DataPtr> async_tensors_data;
   if (!coll.indices.empty()) {
     DebugUtil::SaveTensorsGraphInfo("GetTensorsOpByOp", *tensors,
@@ -819,23 +1895,7 @@ std::vector<at::Tensor> XLATensor::GetTensorsOpByOp(
 
   std::vector<xla::ComputationClient::DataPtr> tensors_data =
       GatherTensorsXlaData(*tensors, coll.indices, async_tensors_data);
-  std::vector<xla::Literal> literals =
-      xla::ComputationClient::Get()->TransferFromServer(tensors_data);
-  std::vector<at::Tensor> results;
-  size_t literals_index = 0;
-  results.reserve(tensors->size());
-  for (size_t i = 0; i < tensors->size(); ++i) {
-    c10::optional<at::Tensor> tensor_data = (*tensors)[i].CurrentTensorData();
-    if (tensor_data) {
-      results.push_back(*tensor_data);
-    } else {
-      XLA_CHECK_LT(literals_index, literals.size());
-      results.push_back(MakeTensorFromXlaLiteral(literals[literals_index],
-                                                 (*tensors)[i].dtype()));
-      ++literals_index;
-    }
-  }
-  return results;
+  return FetchTensors(*tensors, tensors_data);
 }
 
 std::vector<at::Tensor> XLATensor::GetTensors(std::vector<XLATensor>* tensors) {
@@ -844,13 +1904,171 @@ std::vector<at::Tensor> XLATensor::GetTensors(std::vector<XLATensor>* tensors) {
   return op_by_op ? GetTensorsOpByOp(tensors) : GetTensorsFused(tensors);
 }
 
+XLATensor::SharedOutputs XLATensor::CollectSharedOutputs(
+    std::vector<XLATensor>* tensors) {
+  SharedOutputs shared;
+  if (GetMaxSharedOutputs() == 0 || tensors->empty()) {
+    return shared;
+  }
+  Device device = tensors->front().GetDevice();
+  std::vector<const ir::Node*> roots;
+  ir::OutputMap<size_t> root_indices;
+  std::unordered_set<xla::int64> synced_ids;
+  for (size_t i = 0; i < tensors->size(); ++i) {
+    const XLATensor& tensor = (*tensors)[i];
+    if (tensor.GetDevice() != device) {
+      return shared;
+    }
+    synced_ids.insert(tensor.GetUniqueId());
+    if (tensor.CurrentXlaData() == nullptr) {
+      ir::Value ir_value = tensor.CurrentIrValue();
+      if (ir_value && ShouldSyncIrValue(ir_value)) {
+        roots.push_back(ir_value.node.get());
+        root_indices.emplace(ir_value, i);
+      }
+    }
+  }
+  if (roots.empty()) {
+    return shared;
+  }
+  // The nodes of the synced graph are marked as emitted, so that the post
+  // orders of the pending tensors only contain the nodes outside of it.
+  std::unordered_set<const ir::Node*> synced_nodes;
+  ir::Util::EmissionMap emap;
+  for (auto node : ir::Util::ComputePostOrder(roots)) {
+    synced_nodes.insert(node);
+    emap[node] = ir::Util::kEmitted;
+  }
+
+  size_t num_computed = 0;
+  auto add_output = [&](const ir::Value& value) {
+    ir::Output output = value;
+    if (shared.outputs.count(output) > 0) {
+      return;
+    }
+    auto it = root_indices.find(output);
+    if (it != root_indices.end()) {
+      shared.outputs.emplace(output, it->second);
+    } else if (num_computed < GetMaxSharedOutputs() &&
+               value->operands().size() > 0 && ShouldSyncIrValue(value) &&
+               xla::ShapeUtil::ByteSizeOf(value.shape()) <=
+                   GetMaxSharedOutputBytes()) {
+      // Leaves (like device data and constants) are not worth materializing.
+      shared.outputs.emplace(output, tensors->size());
+      tensors->push_back(Create(value, device));
+      ++num_computed;
+    }
+  };
+  for (auto& tensor : GetPendingTensors(&device)) {
+    ir::Value ir_value = tensor.CurrentIrValue();
+    if (!ir_value || synced_ids.count(tensor.GetUniqueId()) > 0 ||
+        tensor.data()->view != nullptr) {
+      continue;
+    }
+    if (synced_nodes.count(ir_value.node.get()) > 0) {
+      add_output(ir_value);
+    }
+    std::vector<const ir::Node*> post_order =
+        ir::Util::ComputePostOrder(ir_value.node.get(), &emap);
+    for (auto node : post_order) {
+      for (size_t i = 0; i < node->operands().size(); ++i) {
+        if (synced_nodes.count(node->operands()[i].node) > 0) {
+          add_output(node->operand_value(i));
+        }
+      }
+    }
+    shared.post_order.insert(shared.post_order.end(), post_order.begin(),
+                             post_order.end());
+    shared.users.push_back(std::move(tensor));
+  }
+  XLA_COUNTER("SyncSharedOutputs", num_computed);
+  return shared;
+}
+
+size_t XLATensor::ReplaceIrOutputs(
+    const std::vector<XLATensor>& tensors,
+    tensorflow::gtl::ArraySlice<const ir::Node* const> post_order,
+    const ir::OutputMap<ir::Value>& replacements) {
+  // The nodes using the replaced outputs, directly or not, are cloned instead
+  // of being updated in place, as their hashes (which key the compiled
+  // computations) would otherwise not reflect their new operands.
+  std::unordered_map<const ir::Node*, ir::NodePtr> clone_map;
+  for (auto node : post_order) {
+    std::vector<ir::Value> inputs;
+    bool changed = false;
+    for (size_t i = 0; i < node->operands().size(); ++i) {
+      const ir::Output& output = node->operands()[i];
+      auto rit = replacements.find(output);
+      if (rit != replacements.end()) {
+        inputs.push_back(rit->second);
+        changed = true;
+        continue;
+      }
+      auto cit = clone_map.find(output.node);
+      if (cit != clone_map.end()) {
+        inputs.emplace_back(cit->second, output.index);
+        changed = true;
+      } else {
+        inputs.push_back(node->operand_value(i));
+      }
+    }
+    if (changed) {
+      clone_map[node] = node->Clone(inputs);
+    }
+  }
+  size_t num_users = 0;
+  for (auto& tensor : tensors) {
+    ir::Value ir_value = tensor.CurrentIrValue();
+    auto rit = replacements.find(ir_value);
+    if (rit != replacements.end()) {
+      tensor.AssignIrValue(rit->second);
+      ++num_users;
+      continue;
+    }
+    auto cit = clone_map.find(ir_value.node.get());
+    if (cit != clone_map.end()) {
+      tensor.AssignIrValue(ir::Value(cit->second, ir_value.index));
+      ++num_users;
+    }
+  }
+  return num_users;
+}
+
+void XLATensor::ReplaceSharedOutputs(const SharedOutputs& shared,
+                                     const Async& async) {
+  if (shared.outputs.empty()) {
+    return;
+  }
+  std::unordered_map<size_t, xla::ComputationClient::DataPtr> indices_data;
+  for (size_t i = 0; i < async.indices.size(); ++i) {
+    if (async.tensors_data[i] != nullptr) {
+      indices_data.emplace(async.indices[i], async.tensors_data[i]);
+    }
+  }
+  ir::OutputMap<ir::Value> replacements;
+  for (auto& output_index : shared.outputs) {
+    auto it = indices_data.find(output_index.second);
+    if (it != indices_data.end()) {
+      replacements.emplace(output_index.first, CreateTensorNode(it->second));
+    }
+  }
+  XLA_COUNTER("SyncSharedOutputUsers",
+              ReplaceIrOutputs(shared.users, shared.post_order, replacements));
+}
+
 std::vector<at::Tensor> XLATensor::GetTensorsFused(
     std::vector<XLATensor>* tensors) {
   SyncTensorsConfig config;
   config.force_xla_data = false;
-  auto async = SyncTensorsGraphInternal(tensors, {}, config);
+  // The intermediate results of the synced graph which the other pending
+  // tensors use are computed as well, so that the next sync of those does not
+  // compute them again.
+  std::vector<XLATensor> sync_tensors = *tensors;
+  SharedOutputs shared = CollectSharedOutputs(&sync_tensors);
+  auto async = SyncTensorsGraphInternal(&sync_tensors, {}, config);
   if (async != nullptr) {
     async->mwait.Wait();
+    ReplaceSharedOutputs(shared, *async);
   }
   std::vector<xla::ComputationClient::DataPtr> tensors_data =
       GatherTensorsXlaData(
@@ -860,23 +2078,65 @@ std::vector<at::Tensor> XLATensor::GetTensorsFused(
           async != nullptr ? async->tensors_data
                            : tensorflow::gtl::ArraySlice<
                                  const xla::ComputationClient::DataPtr>());
-  std::vector<xla::Literal> literals =
-      xla::ComputationClient::Get()->TransferFromServer(tensors_data);
-  std::vector<at::Tensor> results;
-  size_t literals_index = 0;
-  results.reserve(tensors->size());
-  for (size_t i = 0; i < tensors->size(); ++i) {
-    c10::optional<at::Tensor> tensor_data = (*tensors)[i].CurrentTensorData();
-    if (tensor_data) {
-      results.push_back(*tensor_data);
-    } else {
-      XLA_CHECK_LT(literals_index, literals.size());
-      results.push_back(MakeTensorFromXlaLiteral(literals[literals_index],
-                                                 (*tensors)[i].dtype()));
-      ++literals_index;
+  return FetchTensors(*tensors, tensors_data);
+}
+
+xla::util::Future<std::vector<at::Tensor>> XLATensor::GetTensorsAsync(
+    std::vector<XLATensor>* tensors) {
+  static const bool op_by_op =
+      xla::sys_util::GetEnvBool("GET_TENSORS_OPBYOP", false);
+  if (op_by_op) {
+    xla::util::Promise<std::vector<at::Tensor>> promise;
+    promise.SetValue(GetTensorsOpByOp(tensors));
+    return promise.GetFuture();
+  }
+  XLA_COUNTER("GetTensorsAsync", 1);
+  SyncTensorsConfig config;
+  config.force_xla_data = false;
+  auto async = SyncTensorsGraphInternal(tensors, {}, config);
+  std::vector<xla::ComputationClient::DataPtr> tensors_data =
+      GatherTensorsXlaData(
+          *tensors,
+          async != nullptr ? async->indices
+                           : tensorflow::gtl::ArraySlice<const size_t>(),
+          async != nullptr ? async->tensors_data
+                           : tensorflow::gtl::ArraySlice<
+                                 const xla::ComputationClient::DataPtr>());
+  // Snapshot the tensor data available on the host, and the types of the ones
+  // to fetch, here, so that the background transfer does not race with the
+  // caller updating the tensors.
+  std::vector<c10::optional<at::Tensor>> host_tensors;
+  std::vector<at::ScalarType> element_types;
+  host_tensors.reserve(tensors->size());
+  for (auto& tensor : *tensors) {
+    host_tensors.push_back(tensor.CurrentTensorData());
+    if (!host_tensors.back()) {
+      element_types.push_back(tensor.dtype());
     }
   }
-  return results;
+  auto fetch_fn = [async, tensors_data = std::move(tensors_data),
+                   host_tensors = std::move(host_tensors),
+                   element_types = std::move(element_types)]() {
+    if (async != nullptr) {
+      async->mwait.Wait();
+    }
+    std::vector<at::Tensor> fetched_tensors =
+        XlaDataToTensors(tensors_data, element_types);
+    std::vector<at::Tensor> results;
+    size_t fetched_index = 0;
+    results.reserve(host_tensors.size());
+    for (auto& tensor_data : host_tensors) {
+      if (tensor_data) {
+        results.push_back(*tensor_data);
+      } else {
+        XLA_CHECK_LT(fetched_index, fetched_tensors.size());
+        results.push_back(std::move(fetched_tensors[fetched_index]));
+        ++fetched_index;
+      }
+    }
+    return results;
+  };
+  return xla::util::ScheduleIoFuture(std::move(fetch_fn));
 }
 
 std::vector<XLATensor> XLATensor::CreateTensors(
@@ -897,8 +2157,18 @@ ir::Value XLATensor::CreateTensorNode(xla::ComputationClient::DataPtr data) {
 }
 
 xla::int64 XLATensor::GetNextTensorId() {
+  // The IDs are handed out to the threads in blocks, so that the threads
+  // creating tensors at the same time do not contend on the generator. The IDs
+  // of the tensors created by the same thread keep increasing.
+  static const xla::int64 kIdBlockSize = 1024;
   static std::atomic<xla::int64>* id_generator = new std::atomic<xla::int64>(1);
-  return id_generator->fetch_add(1);
+  thread_local xla::int64 next_id = 0;
+  thread_local xla::int64 block_end = 0;
+  if (next_id == block_end) {
+    next_id = id_generator->fetch_add(kIdBlockSize);
+    block_end = next_id + kIdBlockSize;
+  }
+  return next_id++;
 }
 
 std::vector<XLATensor> XLATensor::MakeOutputTensors(ir::NodePtr node) const {
@@ -911,8 +2181,55 @@ std::vector<XLATensor> XLATensor::MakeOutputTensors(ir::NodePtr node) const {
 }
 
 XLATensor XLATensor::CopyTensorToDevice(const Device& device) {
-  // TODO: This can be optimized via proper XRT/XLA computation.
-  return Create(ToTensor(), device);
+  c10::optional<at::Tensor> tensor_data = CurrentTensorData();
+  Device src_device = GetDevice();
+  if (tensor_data || src_device.hw_type != device.hw_type) {
+    // Either the data is already on the host, or the device layouts could
+    // differ, so upload it from there.
+    return Create(ToTensor(), device);
+  }
+  xla::ComputationClient::DataPtr xla_data = CurrentXlaData();
+  if (xla_data == nullptr || data()->view != nullptr) {
+    // Materializes the pending IR graph (or view updates) on the source device.
+    xla_data = GetXlaData();
+  }
+  XLA_COUNTER("DeviceToDeviceCopies", 1);
+  // The copy runs asynchronously, holding the locks of both devices, so that
+  // it is ordered after the in-flight operations writing the source data, and
+  // before the ones using the copy. In the meantime the source tensor stays
+  // readable, and the copied tensor holds a placeholder.
+  struct CopyAsync {
+    std::vector<xla::util::ExceptionCleanup> unlocker;
+    std::vector<std::function<void()>> waiters;
+    xla::ComputationClient::DataPtr src_data;
+    xla::ComputationClient::DataPtr dst_data;
+  };
+  auto async = std::make_shared<CopyAsync>();
+  async->unlocker = LockDevices({src_device, device},
+                                UsePipelinedSync() ? &async->waiters : nullptr);
+  async->src_data = std::move(xla_data);
+  async->dst_data = xla::ComputationClient::Get()->CreateDataPlaceholder(
+      device.ToString(), async->src_data->shape());
+
+  auto copyfn = [async, device = device.ToString()]() {
+    try {
+      WaitDeviceLocks(async->waiters);
+      WaitDataValues({async->src_data});
+      std::vector<xla::ComputationClient::DataPtr> results =
+          xla::ComputationClient::Get()->TransferToDevice({async->src_data},
+                                                          device);
+      async->dst_data->Assign(*results.front());
+    } catch (...) {
+      std::exception_ptr exptr = std::current_exception();
+      for (auto& unlocker : async->unlocker) {
+        unlocker.SetStatus(exptr);
+      }
+      async->dst_data->SetError(exptr);
+    }
+  };
+  xla::ComputationClient::DataPtr dst_data = async->dst_data;
+  xla::env::ScheduleIoClosure(std::move(copyfn), xla::env::Priority::kHigh);
+  return Create(std::move(dst_data), dtype());
 }
 
 XLATensor XLATensor::CreateFrom(ir::Value ir_value) const {
@@ -945,7 +2262,6 @@ XLATensor XLATensor::CreateFrom(ir::Value ir_value, const Device& device,
 }
 
 void XLATensor::ApplyPendingGraph() {
-  DeviceBarrier(GetDevice());
   // This method is called to ensure that the tensor data is available on
   // device, so that a call to CurrentXlaData() returns a valid pointer.
   if (CurrentXlaData() == nullptr) {
@@ -956,6 +2272,7 @@ void XLATensor::ApplyPendingGraph() {
 
 XLATensor::SyncTensorCollection XLATensor::CollectSyncTensors(
     const std::vector<XLATensor>& tensors, const SyncTensorsConfig& config) {
+  XLA_FN_TRACE("tensor");
   xla::util::Unique<Device> unique_device;
   for (size_t i = 0; i < tensors.size(); ++i) {
     unique_device.set(tensors[i].GetDevice());
@@ -966,15 +2283,26 @@ XLATensor::SyncTensorCollection XLATensor::CollectSyncTensors(
   std::vector<size_t> at_tensor_index;
   SyncTensorCollection coll;
   coll.indices.reserve(tensors.size());
-  coll.unlocker = LockDevices(unique_device.AsSet());
+  // With XLA_IR_DEBUG_ROOTS the roots of the graph get the frames of the sync
+  // call, which are captured once and shared by all of them.
+  bool capture_root_frames = ir::Node::CaptureRootFrames();
+  const std::vector<SourceLocation>* root_frames = nullptr;
+  // The (graph hash, tensor index) pairs of the tensors to sync.
+  std::vector<std::pair<size_t, size_t>> roots;
   for (size_t i = 0; i < tensors.size(); ++i) {
     if (tensors[i].CurrentXlaData() == nullptr) {
       ir::Value ir_value = tensors[i].CurrentIrValue();
       if (ir_value) {
         if (ShouldSyncIrValue(ir_value)) {
           // Add only tensors which need to be synced.
-          coll.hash = xla::util::HashCombine(coll.hash, ir_value.hash());
-          coll.indices.push_back(i);
+          roots.emplace_back(ir_value.hash(), i);
+          if (capture_root_frames &&
+              ir_value.node->metadata().frame_info == nullptr) {
+            if (root_frames == nullptr) {
+              root_frames = InternFrames(GetPythonFrames());
+            }
+            ir_value.node->SetFrameInfo(root_frames);
+          }
         }
       } else if (config.force_xla_data) {
         // The tensor only has at::Tensor data. We need to queue it for a
@@ -987,6 +2315,21 @@ XLATensor::SyncTensorCollection XLATensor::CollectSyncTensors(
       }
     }
   }
+  // The roots are sorted by their graph hashes, so that the graph hash, and
+  // the order of the computation results and parameters, do not depend on the
+  // order the tensors are passed in. Syncs of the same graphs, listed in a
+  // different order, then share the compiled computation.
+  std::sort(roots.begin(), roots.end());
+  for (auto& hash_index : roots) {
+    coll.hash = xla::util::HashCombine(coll.hash, hash_index.first);
+    coll.indices.push_back(hash_index.second);
+  }
+  if (!coll.indices.empty()) {
+    // Only computations need the device locks, the reads of the tensors which
+    // are in-flight placeholders wait for their values instead.
+    coll.unlocker = LockDevices(unique_device.AsSet(),
+                                UsePipelinedSync() ? &coll.waiters : nullptr);
+  }
   if (unique_device) {
     // Mix the hash with the resource domain hashes as compile handles are only
     // valid within a domain (usually a single host).
@@ -1002,70 +2345,228 @@ XLATensor::SyncTensorCollection XLATensor::CollectSyncTensors(
       // If we are here, it means that the IR Value for the tensor is not
       // present. Also, we uploaded the at::Tensor data to the device, but such
       // data is still valid so we leave it live on the XLA tensor (so that a
-      // following ToTensor() does not need to fetch it from device).
+      // following ToTensor() does not need to fetch it from device), within
+      // the host copies budget.
       tensors[at_tensor_index[i]].data()->xla_data = std::move(handles[i]);
+      tensors[at_tensor_index[i]].RetainHostCopy();
     }
   }
   return coll;
 }
 
-std::shared_ptr<XLATensor::Async> XLATensor::TryRunCachedSync(
-    std::vector<XLATensor>* tensors, const SyncTensorsConfig& config,
-    SyncTensorCollection* coll) {
-  ComputationCache::TypePtr cached_computation =
-      GetComputationCache()->Get(coll->hash);
-  if (cached_computation == nullptr) {
-    return nullptr;
-  }
-
-  xla::util::Unique<Device> unique_device;
+void XLATensor::CollectParametersData(const std::vector<XLATensor>& tensors,
+                                      SyncTensorCollection* coll) {
   std::vector<const ir::Node*> roots;
   roots.reserve(coll->indices.size());
   for (auto index : coll->indices) {
-    ir::Value ir_value = (*tensors)[index].CurrentIrValue();
-    roots.push_back(ir_value.node.get());
-    unique_device.set((*tensors)[index].GetDevice());
+    roots.push_back(tensors[index].CurrentIrValue().node.get());
   }
-  std::vector<xla::ComputationClient::DataPtr> parameters_data;
-  std::unordered_set<xla::int64> data_uids;
+  std::unordered_map<xla::int64, size_t> data_parameters;
   for (auto node : ir::Util::ComputePostOrder(roots)) {
     const ir::ops::DeviceData* device_data =
         dynamic_cast<const ir::ops::DeviceData*>(node);
     if (device_data != nullptr) {
-      if (data_uids.insert(device_data->data()->unique_id()).second) {
-        parameters_data.push_back(device_data->data());
+      auto it = data_parameters
+                    .emplace(device_data->data()->unique_id(),
+                             coll->parameters_data.size())
+                    .first;
+      if (it->second == coll->parameters_data.size()) {
+        coll->parameters_data.push_back(device_data->data());
       }
+      // The graph hash only covers the device data shapes, the handles bound
+      // to the parameters change from one sync to the next.
+      coll->hash = xla::util::HashCombine(coll->hash, it->second);
     }
   }
-  if (cached_computation->num_parameters != parameters_data.size()) {
+}
+
+void XLATensor::ApplyGraphSpecialization(SyncTensorCollection* coll) {
+  std::shared_ptr<const GraphSpecializer::Specialization> specialization =
+      GraphSpecializer::Get()->OnSync(coll->hash, coll->parameters_data,
+                                      coll->buffer_aliases);
+  if (specialization == nullptr) {
+    return;
+  }
+  std::vector<size_t> new_indices(coll->parameters_data.size());
+  std::vector<xla::ComputationClient::DataPtr> parameters_data;
+  size_t folded = 0;
+  for (size_t i = 0; i < coll->parameters_data.size(); ++i) {
+    if (folded < specialization->parameters.size() &&
+        specialization->parameters[folded] == i) {
+      coll->constant_data.push_back(std::move(coll->parameters_data[i]));
+      ++folded;
+    } else {
+      new_indices[i] = parameters_data.size();
+      parameters_data.push_back(std::move(coll->parameters_data[i]));
+    }
+  }
+  // The donated buffers are never folded.
+  for (auto& alias : coll->buffer_aliases) {
+    alias.first = new_indices[alias.first];
+  }
+  coll->parameters_data = std::move(parameters_data);
+  coll->hash = specialization->hash;
+  coll->specialization = std::move(specialization);
+}
+
+XLATensor::ComputationCache::TypePtr XLATensor::LookupCachedComputation(
+    const SyncTensorCollection& coll) {
+  ComputationCache::TypePtr cached_computation =
+      GetComputationCache()->Get(coll.hash);
+  ir::Node::NotifyGraphCacheLookup(cached_computation != nullptr);
+  if (cached_computation == nullptr) {
+    return nullptr;
+  }
+
+  if (cached_computation->num_parameters != coll.parameters_data.size()) {
+    // Since the parameters mapping is part of the hash, this is a hash
+    // collision, and the computation of the new graph replaces the cached one.
     XLA_COUNTER("CachedSyncParamMismatch", 1);
-    GetComputationCache()->Erase(coll->hash);
     return nullptr;
   }
   XLA_COUNTER("CachedSyncTensors", 1);
+  return cached_computation;
+}
 
+std::shared_ptr<XLATensor::Async> XLATensor::TryRunCachedSync(
+    std::vector<XLATensor>* tensors, const SyncTensorsConfig& config,
+    SyncTensorCollection* coll) {
+  ComputationCache::TypePtr cached_computation =
+      LookupCachedComputation(*coll);
+  if (cached_computation == nullptr) {
+    return nullptr;
+  }
+
+  xla::util::Unique<Device> unique_device;
+  for (auto index : coll->indices) {
+    unique_device.set((*tensors)[index].GetDevice());
+  }
   return ScheduleSyncTensorsGraph(
-      tensors, config, coll, std::move(parameters_data),
+      tensors, config, coll, std::move(coll->parameters_data),
       unique_device->ToString(), std::move(cached_computation));
 }
 
-XLATensor::ComputationCache* XLATensor::GetComputationCache() {
+XLATensor::ComputationCache* XLATensor::CreateComputationCache() {
+  // If XLA_COMPILATION_CACHE_BYTES is set, both this cache and the computation
+  // client one account entries by their computation size, using the same
+  // limit.
+  static const xla::int64 kMaxCacheBytes =
+      xla::sys_util::GetEnvInt("XLA_COMPILATION_CACHE_BYTES", 0);
+  if (kMaxCacheBytes > 0) {
+    auto size_fn = [](const size_t& hash,
+                      const CachedComputation& cached_computation) -> size_t {
+      return cached_computation.computation->computation()
+          .proto()
+          .ByteSizeLong();
+    };
+    return new ComputationCache(kMaxCacheBytes, size_fn);
+  }
   static const size_t kMaxCacheSize =
       xla::sys_util::GetEnvInt("XLA_COMPILATION_CACHE_SIZE", 1024);
-  static ComputationCache* cache = new ComputationCache(kMaxCacheSize);
+  return new ComputationCache(kMaxCacheSize);
+}
+
+XLATensor::ComputationCache* XLATensor::GetComputationCache() {
+  static ComputationCache* cache = CreateComputationCache();
   return cache;
 }
 
+std::vector<XLATensor::CachedGraph> XLATensor::GetCachedGraphs() {
+  std::vector<CachedGraph> graphs;
+  for (auto& hash_computation : GetComputationCache()->GetElements()) {
+    CachedGraph graph;
+    graph.hash = hash_computation.first;
+    graph.computation = hash_computation.second->computation;
+    graph.num_parameters = hash_computation.second->num_parameters;
+    graphs.push_back(std::move(graph));
+  }
+  return graphs;
+}
+
+void XLATensor::AddCachedGraph(const CachedGraph& graph) {
+  XLA_CHECK(!graph.computation->devices().empty());
+  Device device(graph.computation->devices().front());
+  GetComputationCache()->Add(graph.hash, std::make_shared<CachedComputation>(
+                                             graph.computation,
+                                             graph.num_parameters));
+}
+
+std::vector<xla::ComputationClient::DataPtr> XLATensor::ExecuteReplicatedSync(
+    Async* async) {
+  const std::vector<std::string>& devices =
+      xla::ComputationClient::Get()->GetReplicationDevices();
+  auto it = std::find(devices.begin(), devices.end(), async->device);
+  XLA_CHECK(it != devices.end())
+      << "The replicated execution device " << async->device
+      << " is not a replication device";
+  size_t master_index = it - devices.begin();
+  std::vector<std::vector<xla::ComputationClient::DataPtr>> arguments(
+      devices.size());
+  for (auto& data : async->parameters_data) {
+    std::vector<xla::ComputationClient::DataPtr> replicas =
+        ReplicatedData::Get()->GetReplicas(data, devices, master_index);
+    for (size_t i = 0; i < replicas.size(); ++i) {
+      arguments[i].push_back(std::move(replicas[i]));
+    }
+  }
+  xla::ComputationClient::ExecuteReplicatedOptions options;
+  std::vector<std::vector<xla::ComputationClient::DataPtr>> results =
+      xla::ComputationClient::Get()->ExecuteReplicated(
+          *async->cached_computation->computation, arguments, devices,
+          options);
+  XLA_COUNTER("ReplicatedSyncExecutions", 1);
+  // The outputs get assigned to the tensors placeholders, when present, so the
+  // replicas are recorded under those.
+  for (size_t i = 0; i < results[master_index].size(); ++i) {
+    std::vector<xla::ComputationClient::DataPtr> replicas;
+    for (auto& replica_results : results) {
+      replicas.push_back(replica_results[i]);
+    }
+    if (async->tensors_data[i] != nullptr) {
+      replicas[master_index] = async->tensors_data[i];
+    }
+    ReplicatedData::Get()->Register(replicas, master_index);
+  }
+  return std::move(results[master_index]);
+}
+
 std::shared_ptr<XLATensor::Async> XLATensor::ScheduleSyncTensorsGraph(
     std::vector<XLATensor>* tensors, const SyncTensorsConfig& config,
     SyncTensorCollection* coll,
     std::vector<xla::ComputationClient::DataPtr> parameters_data,
     std::string device, ComputationCache::TypePtr cached_computation) {
-  DebugUtil::SaveTensorsGraphInfo("ScheduleSyncTensorsGraph", *tensors,
-                                  &coll->indices);
-
   std::shared_ptr<Async> async = std::make_shared<Async>(
       coll, std::move(parameters_data), device, std::move(cached_computation));
+  auto execute_fn = [](Async* async) {
+    xla::int64 start_ns = xla::sys_util::NowNs();
+    std::vector<xla::ComputationClient::DataPtr> results;
+    if (ReplicatedData::Get()->IsEnabled()) {
+      results = ExecuteReplicatedSync(async);
+    } else {
+      xla::ComputationClient::ExecuteComputationOptions options;
+      results = xla::ComputationClient::Get()->ExecuteComputation(
+          *async->cached_computation->computation, async->parameters_data,
+          async->device, options);
+    }
+    if (GraphStats::IsEnabled()) {
+      GraphStats::Get()->RecordExecution(
+          async->hash, xla::sys_util::NowNs() - start_ns,
+          async->parameters_data, results);
+    }
+    return results;
+  };
+  return ScheduleSyncTensorsGraph(tensors, config, std::move(async),
+                                  std::move(execute_fn));
+}
+
+void XLATensor::PrepareSyncTensorsData(std::vector<XLATensor>* tensors,
+                                       const SyncTensorsConfig& config,
+                                       Async* async) {
+  DebugUtil::SaveTensorsGraphInfo("ScheduleSyncTensorsGraph", *tensors,
+                                  &async->indices);
+  // The computation parameters might include deferred uploads.
+  UploadBatcher::Get()->Flush();
+
   for (auto index : async->indices) {
     // If the config.force_xla_data flag is true, the purpose of this tensor
     // sync operation is to truncate the IR graph and materialize device data in
@@ -1075,41 +2576,65 @@ std::shared_ptr<XLATensor::Async> XLATensor::ScheduleSyncTensorsGraph(
     // where the tensors reside (locks held within the coll structure, and moved
     // into the async variable), any other operation trying to access the
     // tensor's device data will have to wait until the asynchronous operation
-    // completes.
+    // completes. In pipelined mode, following syncs can use the placeholder as
+    // computation parameter, as their execution is ordered after this one.
     xla::ComputationClient::DataPtr xla_data =
         (*tensors)[index].CurrentXlaData();
     if (xla_data == nullptr && config.force_xla_data) {
-      xla::Shape shape = MakeShapeWithDeviceLayout((*tensors)[index].shape(),
-                                                   Device(device).hw_type);
+      xla::Shape shape = MakeShapeWithDeviceLayout(
+          (*tensors)[index].shape(), Device(async->device).hw_type);
       xla_data = xla::ComputationClient::Get()->CreateDataPlaceholder(
-          device, std::move(shape));
+          async->device, std::move(shape));
       (*tensors)[index].SetXlaData(xla_data, config.sync_xla_data);
     }
     async->tensors_data.emplace_back(std::move(xla_data));
   }
+}
+
+void XLATensor::AssignSyncResults(
+    std::vector<xla::ComputationClient::DataPtr> results, Async* async) {
+  for (size_t i = 0; i < results.size(); ++i) {
+    if (async->tensors_data[i] != nullptr) {
+      async->tensors_data[i]->Assign(*results[i]);
+    } else {
+      async->tensors_data[i] = std::move(results[i]);
+    }
+  }
+}
 
-  auto syncfn = [async]() {
-    xla::ComputationClient::ExecuteComputationOptions options;
+void XLATensor::SetSyncError(std::exception_ptr exptr, Async* async) {
+  for (auto& unlocker : async->unlocker) {
+    unlocker.SetStatus(exptr);
+  }
+  SetDataError(async->tensors_data, exptr);
+}
+
+std::shared_ptr<XLATensor::Async> XLATensor::ScheduleSyncTensorsGraph(
+    std::vector<XLATensor>* tensors, const SyncTensorsConfig& config,
+    std::shared_ptr<Async> async, AsyncExecuteFn execute_fn) {
+  PrepareSyncTensorsData(tensors, config, async.get());
+
+  auto syncfn = [async, execute_fn = std::move(execute_fn)]() {
     try {
-      auto results = xla::ComputationClient::Get()->ExecuteComputation(
-          *async->cached_computation->computation, async->parameters_data,
-          async->device, options);
-      for (size_t i = 0; i < results.size(); ++i) {
-        if (async->tensors_data[i] != nullptr) {
-          async->tensors_data[i]->Assign(*results[i]);
-        } else {
-          async->tensors_data[i] = std::move(results[i]);
+      WaitDeviceLocks(async->waiters);
+      WaitDataValues(async->parameters_data);
+      auto results = [&]() {
+        auto slot =
+            ExecutionScheduler::Get()->Acquire(async->device, async->priority);
+        if (InputProfiler::IsEnabled()) {
+          InputProfiler::Get()->RecordConsumed(async->parameters_data);
         }
-      }
+        return execute_fn(async.get());
+      }();
+      ReleaseConsumedParameters(&async->parameters_data);
+      AssignSyncResults(std::move(results), async.get());
     } catch (...) {
-      std::exception_ptr exptr = std::current_exception();
-      for (auto& unlocker : async->unlocker) {
-        unlocker.SetStatus(exptr);
-      }
+      SetSyncError(std::current_exception(), async.get());
     }
   };
 
-  xla::env::ScheduleIoClosure(async->mwait.Completer(std::move(syncfn)));
+  xla::env::ScheduleIoClosure(async->mwait.Completer(std::move(syncfn)),
+                              xla::env::Priority::kHigh);
   return async;
 }
 
@@ -1117,15 +2642,30 @@ void XLATensor::SyncTensorsGraph(
     std::vector<XLATensor>* tensors,
     tensorflow::gtl::ArraySlice<const std::string> devices, bool wait,
     bool sync_xla_data) {
-  static const bool op_by_op =
-      xla::sys_util::GetEnvBool("SYNC_TENSORS_OPBYOP", false);
   SyncTensorsConfig config;
   config.sync_xla_data = sync_xla_data;
+  SyncTensorsGraph(tensors, devices, wait, config);
+}
+
+void XLATensor::SyncTensorsGraph(
+    std::vector<XLATensor>* tensors,
+    tensorflow::gtl::ArraySlice<const std::string> devices, bool wait,
+    const SyncTensorsConfig& config) {
+  static const bool op_by_op =
+      xla::sys_util::GetEnvBool("SYNC_TENSORS_OPBYOP", false) ||
+      OpByOpExecutor::Get()->IsHybridMode();
   if (op_by_op) {
     OpByOpAsync async = SyncTensorsGraphOpByOp(tensors, devices, config);
     if (wait) {
       async.Wait();
     }
+  } else if (UseParallelSync() && HasMultipleDevices(*tensors)) {
+    auto asyncs = SyncTensorsGraphParallel(tensors, devices, config);
+    if (wait) {
+      for (auto& async : asyncs) {
+        async->mwait.Wait();
+      }
+    }
   } else {
     auto async = SyncTensorsGraphInternal(tensors, devices, config);
     if (wait && async != nullptr) {
@@ -1137,12 +2677,144 @@ void XLATensor::SyncTensorsGraph(
 void XLATensor::SyncLiveTensorsGraph(
     const Device* device,
     tensorflow::gtl::ArraySlice<const std::string> devices, bool wait) {
-  auto tensors = GetLiveTensors(device);
-  SyncTensorsGraph(&tensors, devices, wait, /*sync_xla_data=*/true);
+  auto tensors = GetPendingTensors(device);
+  SyncTensorsConfig config;
+  config.donate_buffers = UseBufferDonation();
+  config.retained_data_ids = PruneSyncTensors(&tensors);
+  SyncTensorsGraph(&tensors, devices, wait, config);
+}
+
+void XLATensor::SyncLiveTensorsGraphSteps(
+    const Device& device, const std::vector<XLATensor>& step_inputs,
+    const std::vector<XLATensor>& stacked_inputs, bool wait) {
+  XLA_CHECK_EQ(step_inputs.size(), stacked_inputs.size());
+  XLA_CHECK(!stacked_inputs.empty());
+  // The input data must be fetched before the device gets locked by the
+  // collection of the tensors to be synced.
+  xla::int64 num_steps = stacked_inputs.front().shape().get().dimensions(0);
+  std::unordered_map<xla::int64, size_t> step_input_ids;
+  std::vector<xla::ComputationClient::DataPtr> stacked_data;
+  std::vector<xla::Shape> stacked_shapes;
+  for (size_t i = 0; i < step_inputs.size(); ++i) {
+    xla::ComputationClient::DataPtr step_data =
+        step_inputs[i].CurrentXlaData();
+    XLA_CHECK(step_data != nullptr)
+        << "The step inputs must be device data tensors";
+    step_input_ids.emplace(step_data->unique_id(), i);
+    xla::Shape step_shape = step_inputs[i].shape();
+    xla::Shape stacked_shape = stacked_inputs[i].shape();
+    XLA_CHECK(stacked_shape.rank() == step_shape.rank() + 1 &&
+              stacked_shape.dimensions(0) == num_steps &&
+              std::equal(step_shape.dimensions().begin(),
+                         step_shape.dimensions().end(),
+                         stacked_shape.dimensions().begin() + 1))
+        << "Stacked input " << stacked_shape << " does not match "
+        << step_shape << " over " << num_steps << " steps";
+    stacked_data.push_back(stacked_inputs[i].GetXlaData());
+    stacked_shapes.push_back(stacked_data.back()->shape());
+  }
+
+  std::vector<XLATensor> tensors = GetPendingTensors(&device);
+  SyncTensorsConfig config;
+  SyncTensorCollection coll = CollectSyncTensors(tensors, config);
+  if (coll.indices.empty()) {
+    return;
+  }
+  XLA_COUNTER("MultiStepSyncs", 1);
+  XLA_VALUE_METRIC("MultiStepCount", num_steps);
+  // Map the stacked inputs to the parameters the step inputs feed, and the
+  // outputs to the parameters holding the data they replaced, which is how
+  // the in-place updates carry from one step to the next.
+  std::unordered_map<xla::int64, size_t> donor_outputs;
+  for (size_t i = 0; i < coll.indices.size(); ++i) {
+    const XLATensor& tensor = tensors[coll.indices[i]];
+    if (tensor.data()->donor_data_id != 0) {
+      donor_outputs.emplace(tensor.data()->donor_data_id, i);
+    }
+  }
+  CollectParametersData(tensors, &coll);
+  std::vector<xla::ComputationClient::DataPtr> parameters_data =
+      std::move(coll.parameters_data);
+  std::vector<xla::int64> input_parameters(stacked_inputs.size(), -1);
+  std::vector<xla::int64> output_parameters(coll.indices.size(), -1);
+  for (size_t i = 0; i < parameters_data.size(); ++i) {
+    xla::int64 unique_id = parameters_data[i]->unique_id();
+    auto input_it = step_input_ids.find(unique_id);
+    if (input_it != step_input_ids.end()) {
+      input_parameters[input_it->second] = i;
+    }
+    auto output_it = donor_outputs.find(unique_id);
+    if (output_it != donor_outputs.end()) {
+      output_parameters[output_it->second] = i;
+    }
+  }
+  coll.hash = xla::util::MHash(coll.hash, num_steps, input_parameters,
+                               output_parameters);
+  for (auto& shape : stacked_shapes) {
+    coll.hash = xla::util::HashCombine(coll.hash, xla::util::ShapeHash(shape));
+  }
+
+  ComputationCache::TypePtr cached_computation =
+      GetComputationCache()->Get(coll.hash);
+  if (cached_computation == nullptr) {
+    XLA_COUNTER("UncachedMultiStepSyncs", 1);
+    ir::LoweringContext lowering_ctx("SyncTensorsGraphStep");
+    xla::XlaComputation step_computation =
+        LowerSyncTensorsGraph(tensors, coll, &lowering_ctx);
+    XLA_CHECK_EQ(lowering_ctx.GetParametersData().size(),
+                 parameters_data.size());
+    xla::XlaComputation computation =
+        BuildMultiStepComputation(step_computation, stacked_shapes,
+                                  input_parameters, output_parameters,
+                                  num_steps);
+    xla::ProgramShape program_shape =
+        ConsumeValue(computation.GetProgramShape());
+    xla::Shape shape =
+        MakeShapeWithDeviceLayout(program_shape.result(), device.hw_type);
+
+    std::vector<xla::ComputationClient::CompileInstance> instances;
+    instances.push_back({std::move(computation), device.ToString(),
+                         xla::ComputationClient::Get()->GetCompilationDevices(
+                             device.ToString(), {}),
+                         &shape});
+    std::vector<std::shared_ptr<xla::ComputationClient::Computation>>
+        computations =
+            xla::ComputationClient::Get()->Compile(std::move(instances));
+    cached_computation = GetComputationCache()->Add(
+        coll.hash,
+        std::make_shared<CachedComputation>(
+            std::move(computations.front()),
+            parameters_data.size() + stacked_data.size()));
+  }
+  parameters_data.insert(parameters_data.end(), stacked_data.begin(),
+                         stacked_data.end());
+  auto async =
+      ScheduleSyncTensorsGraph(&tensors, config, &coll,
+                               std::move(parameters_data), device.ToString(),
+                               std::move(cached_computation));
+  if (wait) {
+    async->mwait.Wait();
+  }
+}
+
+ir::Value XLATensor::GetRngSeed(const Device& device) {
+  return DeviceContextArena::Get()->GetRngSeed(device);
+}
+
+void XLATensor::SetRngSeed(const Device* device, xla::uint64 seed) {
+  DeviceContextArena::Get()->SetRngSeed(device, seed);
+}
+
+xla::uint64 XLATensor::GetRunningSeed(const Device& device) {
+  return DeviceContextArena::Get()->GetRunningSeed(device);
 }
 
 void XLATensor::MarkStep(const Device* device) {
   DeviceContextArena::Get()->ClearProfileData(device);
+  DeviceContextArena::Get()->AdvanceStepSeed(device);
+  ir::ClearInternedNodes();
+  DeviceContextArena::Get()->MarkTrackersStep(device, UseStableGraphCuts(),
+                                              UseScalarPromotion());
 }
 
 XLATensor::OpByOpAsync XLATensor::SyncTensorsGraphOpByOp(
@@ -1185,6 +2857,7 @@ XLATensor::OpByOpAsync XLATensor::SyncTensorsGraphOpByOp(
   auto syncfn = [async]() -> xla::Status {
     xla::Status status;
     try {
+      WaitDeviceLocks(async->coll.waiters);
       std::string device = async->unique_device
                                ? async->unique_device->ToString()
                                : std::string();
@@ -1200,6 +2873,7 @@ XLATensor::OpByOpAsync XLATensor::SyncTensorsGraphOpByOp(
       for (auto& unlocker : async->coll.unlocker) {
         unlocker.SetStatus(exptr);
       }
+      SetDataError(async->tensors_data, exptr);
     }
     return status;
   };
@@ -1207,30 +2881,619 @@ XLATensor::OpByOpAsync XLATensor::SyncTensorsGraphOpByOp(
   return async_op.Schedule();
 }
 
+std::unordered_set<xla::int64> XLATensor::PruneSyncTensors(
+    std::vector<XLATensor>* tensors) {
+  static const bool prune_internal =
+      xla::sys_util::GetEnvBool("XLA_PRUNE_INTERNAL_OUTPUTS", false);
+  // The nodes reachable through at least one operand edge from the pending IR
+  // of the tensors to be materialized.
+  std::unordered_set<const ir::Node*> internal_nodes;
+  if (prune_internal) {
+    std::vector<const ir::Node*> stack;
+    for (auto& tensor : *tensors) {
+      if (tensor.data()->materialize && tensor.CurrentXlaData() == nullptr) {
+        ir::Value ir_value = tensor.CurrentIrValue();
+        if (ir_value) {
+          for (auto& operand : ir_value->operands()) {
+            stack.push_back(operand.node);
+          }
+        }
+      }
+    }
+    while (!stack.empty()) {
+      const ir::Node* node = stack.back();
+      stack.pop_back();
+      if (internal_nodes.insert(node).second) {
+        for (auto& operand : node->operands()) {
+          stack.push_back(operand.node);
+        }
+      }
+    }
+  }
+  std::vector<XLATensor> synced_tensors;
+  std::vector<const ir::Node*> pruned_roots;
+  for (auto& tensor : *tensors) {
+    // Views are always synced, as their IR value is derived from the one of
+    // their base, which gets replaced by the sync.
+    if (tensor.CurrentXlaData() == nullptr && tensor.data()->view == nullptr) {
+      ir::Value ir_value = tensor.CurrentIrValue();
+      if (ir_value && (!tensor.data()->materialize ||
+                       internal_nodes.count(ir_value.node.get()) > 0)) {
+        pruned_roots.push_back(ir_value.node.get());
+        continue;
+      }
+    }
+    synced_tensors.push_back(std::move(tensor));
+  }
+  std::unordered_set<xla::int64> retained_data_ids;
+  if (!pruned_roots.empty()) {
+    XLA_COUNTER("PrunedSyncTensors", pruned_roots.size());
+    for (auto node : ir::Util::ComputePostOrder(pruned_roots)) {
+      const ir::ops::DeviceData* device_data =
+          dynamic_cast<const ir::ops::DeviceData*>(node);
+      if (device_data != nullptr) {
+        retained_data_ids.insert(device_data->data()->unique_id());
+      }
+    }
+    tensors->swap(synced_tensors);
+  }
+  return retained_data_ids;
+}
+
+std::vector<std::pair<size_t, size_t>> XLATensor::ComputeBufferAliases(
+    const std::vector<XLATensor>& tensors, const SyncTensorCollection& coll,
+    const std::unordered_set<xla::int64>& retained_data_ids) {
+  std::unordered_map<xla::int64, size_t> donor_outputs;
+  std::vector<const ir::Node*> roots;
+  roots.reserve(coll.indices.size());
+  for (size_t i = 0; i < coll.indices.size(); ++i) {
+    const XLATensor& tensor = tensors[coll.indices[i]];
+    if (tensor.data()->donor_data_id != 0) {
+      donor_outputs.emplace(tensor.data()->donor_data_id, i);
+    }
+    roots.push_back(tensor.CurrentIrValue().node.get());
+  }
+  std::vector<std::pair<size_t, size_t>> aliases;
+  if (donor_outputs.empty()) {
+    return aliases;
+  }
+  // Collect the parameters in the same order the lowering does, counting how
+  // many DeviceData nodes reference each of them.
+  std::vector<xla::ComputationClient::DataPtr> parameters_data;
+  std::vector<long> node_references;
+  std::unordered_map<xla::int64, size_t> data_indices;
+  for (auto node : ir::Util::ComputePostOrder(roots)) {
+    const ir::ops::DeviceData* device_data =
+        dynamic_cast<const ir::ops::DeviceData*>(node);
+    if (device_data != nullptr) {
+      auto it = data_indices.emplace(device_data->data()->unique_id(),
+                                     parameters_data.size());
+      if (it.second) {
+        parameters_data.push_back(device_data->data());
+        node_references.push_back(0);
+      }
+      node_references[it.first->second] += 1;
+    }
+  }
+  for (size_t i = 0; i < parameters_data.size(); ++i) {
+    auto it = donor_outputs.find(parameters_data[i]->unique_id());
+    // Besides the IR nodes, the only other reference must be the one held
+    // within the parameters_data vector.
+    if (it == donor_outputs.end() ||
+        parameters_data[i].use_count() != node_references[i] + 1 ||
+        retained_data_ids.count(parameters_data[i]->unique_id()) > 0) {
+      continue;
+    }
+    const XLATensor& tensor = tensors[coll.indices[it->second]];
+    xla::Shape shape = MakeShapeWithDeviceLayout(tensor.shape(),
+                                                 tensor.GetDevice().hw_type);
+    if (xla::ShapeUtil::Equal(shape, parameters_data[i]->shape())) {
+      aliases.emplace_back(i, it->second);
+      donor_outputs.erase(it);
+    }
+  }
+  return aliases;
+}
+
+xla::XlaComputation XLATensor::LowerSyncTensorsGraph(
+    const std::vector<XLATensor>& tensors, const SyncTensorCollection& coll,
+    ir::LoweringContext* lowering_ctx) {
+  XLA_FN_TRACE("tensor");
+  for (size_t i = 0; i < coll.constant_data.size(); ++i) {
+    lowering_ctx->SetConstantData(coll.constant_data[i],
+                                  &coll.specialization->values[i]);
+  }
+  bool subgraph_cache = ir::LoweringContext::IsSubgraphCacheEnabled();
+  if (subgraph_cache || ir::Optimizer::Enabled() ||
+      ir::LoweringContext::IsParallelLoweringEnabled()) {
+    std::vector<const ir::Node*> roots;
+    roots.reserve(coll.indices.size());
+    for (auto index : coll.indices) {
+      roots.push_back(tensors[index].CurrentIrValue().node.get());
+    }
+    // The post-order lowering emits the parameters in the same order the
+    // per-root lowering below would.
+    std::vector<const ir::Node*> post_order = ir::Util::ComputePostOrder(roots);
+    if (subgraph_cache) {
+      lowering_ctx->LowerCachingSubgraphs(
+          post_order, roots, ir::LoweringContext::GetSubgraphCacheMinNodes());
+    } else if (ir::Optimizer::Enabled()) {
+      lowering_ctx->LowerOptimized(post_order);
+    } else if (post_order.size() >=
+               ir::LoweringContext::GetParallelLoweringMinNodes()) {
+      lowering_ctx->LowerParallel(
+          post_order, roots, ir::LoweringContext::GetParallelLoweringTasks());
+    }
+  }
+  for (auto index : coll.indices) {
+    ir::Value ir_value = tensors[index].CurrentIrValue();
+    xla::XlaOp root = lowering_ctx->GetOutputOp(ir_value);
+    lowering_ctx->AddResult(root);
+  }
+  const std::vector<xla::ComputationClient::DataPtr>& parameters_data =
+      lowering_ctx->GetParametersData();
+  for (auto& alias : coll.buffer_aliases) {
+    XLA_CHECK_LT(alias.first, parameters_data.size());
+    lowering_ctx->builder()->SetUpAlias(
+        {static_cast<xla::int64>(alias.second)},
+        static_cast<xla::int64>(alias.first), {});
+  }
+  return ConsumeValue(lowering_ctx->Build());
+}
+
+std::shared_ptr<XLATensor::Async> XLATensor::ScheduleAsyncCompile(
+    std::vector<XLATensor>* tensors,
+    tensorflow::gtl::ArraySlice<const std::string> devices,
+    const SyncTensorsConfig& config, SyncTensorCollection* coll) {
+  xla::util::Unique<Device> unique_device;
+  std::vector<ir::Value> roots;
+  roots.reserve(coll->indices.size());
+  for (auto index : coll->indices) {
+    roots.push_back((*tensors)[index].CurrentIrValue());
+    unique_device.set((*tensors)[index].GetDevice());
+  }
+  std::string device = unique_device->ToString();
+  std::vector<std::string> devices_vector(devices.begin(), devices.end());
+
+  if (PendingCompilations::Get()->Add(coll->hash)) {
+    XLA_COUNTER("AsyncCompilations", 1);
+
+    // The lowering happens here, as the IR graph might be changed by the
+    // caller once we return.
+    ir::LoweringContext lowering_ctx("SyncTensorsGraph");
+    auto computation = std::make_shared<xla::XlaComputation>(
+        LowerSyncTensorsGraph(*tensors, *coll, &lowering_ctx));
+    size_t num_parameters = lowering_ctx.GetParametersData().size();
+    xla::ProgramShape program_shape =
+        ConsumeValue(computation->GetProgramShape());
+    auto shape = std::make_shared<xla::Shape>(MakeShapeWithDeviceLayout(
+        program_shape.result(), unique_device->hw_type));
+
+    auto compilefn = [hash = coll->hash, computation, shape, num_parameters,
+                      device, devices_vector]() {
+      try {
+        std::vector<xla::ComputationClient::CompileInstance> instances;
+        instances.push_back(
+            {std::move(*computation), device,
+             xla::ComputationClient::Get()->GetCompilationDevices(
+                 device, devices_vector),
+             shape.get()});
+        xla::int64 start_ns = xla::sys_util::NowNs();
+        std::vector<std::shared_ptr<xla::ComputationClient::Computation>>
+            computations =
+                xla::ComputationClient::Get()->Compile(std::move(instances));
+        if (GraphStats::IsEnabled()) {
+          GraphStats::Get()->RecordCompile(
+              hash, computations.front()->computation(),
+              xla::sys_util::NowNs() - start_ns);
+        }
+        GetComputationCache()->Add(
+            hash, std::make_shared<CachedComputation>(
+                      std::move(computations.front()), num_parameters));
+      } catch (const std::exception& ex) {
+        XLA_COUNTER("AsyncCompilationErrors", 1);
+        TF_LOG(ERROR) << "Background compilation failed: " << ex.what();
+      }
+      PendingCompilations::Get()->Remove(hash);
+    };
+    xla::env::ScheduleIoClosure(std::move(compilefn));
+  }
+  XLA_COUNTER("AsyncCompileOpByOpSyncs", 1);
+
+  std::shared_ptr<Async> async = std::make_shared<Async>(
+      coll, std::vector<xla::ComputationClient::DataPtr>(), device, nullptr);
+  auto execute_fn = [roots = std::move(roots),
+                     devices = std::move(devices_vector)](Async* async) {
+    return OpByOpExecutor::Get()->Execute(roots, async->device, devices);
+  };
+  return ScheduleSyncTensorsGraph(tensors, config, std::move(async),
+                                  std::move(execute_fn));
+}
+
+void XLATensor::TrySplitGraphByMemory(
+    std::vector<XLATensor>* tensors,
+    tensorflow::gtl::ArraySlice<const std::string> devices) {
+  // The graphs which were found to fit the budget, which do not need to be
+  // estimated again.
+  static xla::util::Cache<size_t, bool>* fitting_graphs =
+      new xla::util::Cache<size_t, bool>(4096);
+  xla::int64 budget = GetGraphMemoryBudget();
+  for (size_t split = 0; split < GetMaxGraphMemorySplits(); ++split) {
+    std::vector<std::pair<size_t, const ir::Node*>> hash_roots;
+    for (auto& tensor : *tensors) {
+      if (tensor.CurrentXlaData() == nullptr) {
+        ir::Value ir_value = tensor.CurrentIrValue();
+        if (ir_value && ShouldSyncIrValue(ir_value)) {
+          hash_roots.emplace_back(ir_value.hash(), ir_value.node.get());
+        }
+      }
+    }
+    if (hash_roots.empty()) {
+      return;
+    }
+    std::sort(hash_roots.begin(), hash_roots.end());
+    size_t hash = 0;
+    std::vector<const ir::Node*> roots;
+    for (auto& hash_root : hash_roots) {
+      hash = xla::util::HashCombine(hash, hash_root.first);
+      roots.push_back(hash_root.second);
+    }
+    if (fitting_graphs->Get(hash) != nullptr) {
+      return;
+    }
+    std::vector<const ir::Node*> post_order =
+        ir::Util::ComputePostOrder(roots);
+    ir::Util::Liveness liveness = ir::Util::ComputeLiveness(post_order, roots);
+    xla::int64 parameters_bytes = 0;
+    for (auto node : post_order) {
+      if (node->op() == ir::ops::xla_device_data) {
+        parameters_bytes += ir::Util::GetOutputBytes(node);
+      }
+    }
+    // The best cut is the one with the fewest resident bytes, which become the
+    // parameters of the rest of the graph, among the ones whose prefix fits
+    // the budget. The latest one wins on ties, to shrink the graph the most.
+    xla::int64 prefix_peak_bytes = parameters_bytes;
+    xla::int64 peak_bytes = parameters_bytes;
+    size_t cut = post_order.size();
+    for (size_t i = 0; i < post_order.size(); ++i) {
+      peak_bytes = std::max(peak_bytes,
+                            parameters_bytes + liveness.live_bytes[i]);
+      if (i + 1 < post_order.size() && peak_bytes <= budget) {
+        prefix_peak_bytes = peak_bytes;
+        if (liveness.resident_bytes[i] > 0 &&
+            (cut == post_order.size() ||
+             liveness.resident_bytes[i] <= liveness.resident_bytes[cut])) {
+          cut = i;
+        }
+      }
+    }
+    if (peak_bytes <= budget) {
+      fitting_graphs->Add(hash, std::make_shared<bool>(true));
+      return;
+    }
+    if (cut == post_order.size()) {
+      // Not even the first nodes fit, there is nothing splitting can do.
+      XLA_COUNTER("GraphMemorySplitFailures", 1);
+      TF_LOG(WARNING) << "Graph with " << post_order.size()
+                      << " nodes and an estimated peak of " << peak_bytes
+                      << " bytes cannot be split within the " << budget
+                      << " bytes memory budget";
+      fitting_graphs->Add(hash, std::make_shared<bool>(true));
+      return;
+    }
+    // The results live across the cut get computed by the prefix graph, and
+    // read as device data by the rest of the graph.
+    std::unordered_set<const ir::Node*> prefix_nodes(
+        post_order.begin(), post_order.begin() + cut + 1);
+    auto is_cut_output = [&](const ir::Output& output) {
+      return !output.node->operands().empty() &&
+             prefix_nodes.count(output.node) > 0;
+    };
+    ir::OutputMap<ir::Value> cut_values;
+    for (size_t i = cut + 1; i < post_order.size(); ++i) {
+      const ir::Node* node = post_order[i];
+      for (size_t j = 0; j < node->operands().size(); ++j) {
+        if (is_cut_output(node->operands()[j])) {
+          cut_values.emplace(node->operands()[j], node->operand_value(j));
+        }
+      }
+    }
+    for (auto& tensor : *tensors) {
+      ir::Value ir_value = tensor.CurrentIrValue();
+      if (tensor.CurrentXlaData() == nullptr && ir_value &&
+          is_cut_output(ir_value)) {
+        cut_values.emplace(ir_value, ir_value);
+      }
+    }
+    const Device& device = tensors->front().GetDevice();
+    std::vector<XLATensor> cut_tensors;
+    for (auto& output_value : cut_values) {
+      cut_tensors.push_back(Create(output_value.second, device));
+    }
+    SyncTensorsGraphInternal(&cut_tensors, devices, SyncTensorsConfig());
+
+    ir::OutputMap<ir::Value> replacements;
+    size_t index = 0;
+    for (auto& output_value : cut_values) {
+      replacements.emplace(
+          output_value.first,
+          CreateTensorNode(cut_tensors[index].CurrentXlaData()));
+      ++index;
+    }
+    ReplaceIrOutputs(*tensors,
+                     tensorflow::gtl::ArraySlice<const ir::Node* const>(
+                         post_order.data() + cut + 1,
+                         post_order.size() - cut - 1),
+                     replacements);
+    XLA_COUNTER("GraphMemorySplits", 1);
+    TF_VLOG(3) << "Split graph of " << post_order.size()
+               << " nodes, with an estimated peak of " << peak_bytes
+               << " bytes, at node " << cut << " with "
+               << liveness.resident_bytes[cut]
+               << " live bytes, and a prefix peak of " << prefix_peak_bytes
+               << " bytes";
+  }
+}
+
+XLATensor::PartitionedComputationCache*
+XLATensor::GetPartitionedComputationCache() {
+  static PartitionedComputationCache* cache = new PartitionedComputationCache(
+      xla::sys_util::GetEnvInt("XLA_COMPILATION_CACHE_SIZE", 1024));
+  return cache;
+}
+
+std::shared_ptr<XLATensor::PartitionedComputation>
+XLATensor::PartitionSyncTensorsGraph(
+    const std::vector<XLATensor>& tensors, const SyncTensorCollection& coll,
+    const Device& device,
+    tensorflow::gtl::ArraySlice<const std::string> devices) {
+  XLA_FN_TRACE("tensor");
+  size_t max_nodes = GetGraphCompileMaxNodes();
+  std::vector<const ir::Node*> roots;
+  std::vector<ir::Output> root_outputs;
+  for (auto index : coll.indices) {
+    ir::Value ir_value = tensors[index].CurrentIrValue();
+    roots.push_back(ir_value.node.get());
+    root_outputs.emplace_back(ir_value.node.get(), ir_value.index);
+  }
+  std::vector<const ir::Node*> post_order = ir::Util::ComputePostOrder(roots);
+  if (post_order.size() <= max_nodes) {
+    return nullptr;
+  }
+  ir::Util::Liveness liveness = ir::Util::ComputeLiveness(post_order, roots);
+  std::vector<size_t> cuts = ir::Util::ComputeSegmentCuts(
+      liveness, post_order.size(),
+      (post_order.size() + max_nodes - 1) / max_nodes);
+  if (cuts.empty()) {
+    return nullptr;
+  }
+  size_t num_segments = cuts.size() + 1;
+  ir::Util::Segments segments =
+      ir::Util::ComputeSegments(post_order, cuts, root_outputs);
+
+  auto partitioned = std::make_shared<PartitionedComputation>();
+  partitioned->num_parameters = coll.parameters_data.size();
+  // The segments made of leaves only compute nothing, and are dropped.
+  std::vector<int> chain_indices(num_segments, -1);
+  std::map<std::pair<size_t, size_t>, size_t> chained_results;
+  for (auto& root_output : segments.root_outputs) {
+    size_t index = chained_results.size();
+    auto it = chained_results.emplace(root_output, index).first;
+    partitioned->results.push_back(it->second);
+  }
+  std::unordered_map<xla::int64, size_t> parameter_indices;
+  for (size_t i = 0; i < coll.parameters_data.size(); ++i) {
+    parameter_indices.emplace(coll.parameters_data[i]->unique_id(), i);
+  }
+  std::list<xla::Shape> output_shapes;
+  std::vector<xla::ComputationClient::CompileInstance> instances;
+  for (size_t segment = 0; segment < num_segments; ++segment) {
+    if (segments.outputs[segment].empty()) {
+      continue;
+    }
+    ir::LoweringContext lowering_ctx("SyncTensorsGraphSegment");
+    for (size_t i = 0; i < coll.constant_data.size(); ++i) {
+      lowering_ctx.SetConstantData(coll.constant_data[i],
+                                   &coll.specialization->values[i]);
+    }
+    // The outputs of the previous segments are fed as parameters, bound to
+    // placeholders which only live for the lowering.
+    std::unordered_map<xla::int64, PartitionedComputation::Input>
+        placeholder_inputs;
+    for (auto& input : segments.inputs[segment]) {
+      size_t input_segment = segments.node_segments.at(input.node);
+      xla::ComputationClient::DataPtr placeholder =
+          xla::ComputationClient::Get()->CreateDataPlaceholder(
+              device.ToString(),
+              MakeShapeWithDeviceLayout(input.shape(), device.hw_type));
+      placeholder_inputs.emplace(
+          placeholder->unique_id(),
+          PartitionedComputation::Input{
+              chain_indices[input_segment],
+              segments.output_indices[input_segment].at(input)});
+      lowering_ctx.AssignExternalOutputOp(
+          input, lowering_ctx.GetParameter(placeholder));
+    }
+    for (auto& output : segments.outputs[segment]) {
+      lowering_ctx.AddResult(lowering_ctx.GetOutputOp(output));
+    }
+    PartitionedComputation::Segment chain_segment;
+    for (auto& data : lowering_ctx.GetParametersData()) {
+      auto it = placeholder_inputs.find(data->unique_id());
+      if (it != placeholder_inputs.end()) {
+        chain_segment.inputs.push_back(it->second);
+      } else {
+        auto parameter_it = parameter_indices.find(data->unique_id());
+        XLA_CHECK(parameter_it != parameter_indices.end());
+        chain_segment.inputs.push_back({-1, parameter_it->second});
+      }
+    }
+    for (auto& root_output : chained_results) {
+      if (root_output.first.first == segment) {
+        chain_segment.results.emplace_back(root_output.second,
+                                           root_output.first.second);
+      }
+    }
+    xla::XlaComputation computation = ConsumeValue(lowering_ctx.Build());
+    xla::ProgramShape program_shape =
+        ConsumeValue(computation.GetProgramShape());
+    output_shapes.push_back(
+        MakeShapeWithDeviceLayout(program_shape.result(), device.hw_type));
+    instances.push_back(
+        {std::move(computation), device.ToString(),
+         xla::ComputationClient::Get()->GetCompilationDevices(
+             device.ToString(), devices),
+         &output_shapes.back()});
+    chain_indices[segment] = partitioned->segments.size();
+    partitioned->segments.push_back(std::move(chain_segment));
+  }
+  // All the segments compile in parallel, with a single call.
+  std::vector<std::shared_ptr<xla::ComputationClient::Computation>>
+      computations =
+          xla::ComputationClient::Get()->Compile(std::move(instances));
+  for (size_t i = 0; i < computations.size(); ++i) {
+    partitioned->segments[i].computation = std::move(computations[i]);
+  }
+  XLA_COUNTER("PartitionedSyncCompiles", 1);
+  XLA_VALUE_METRIC("PartitionedSyncSegments", partitioned->segments.size());
+  TF_VLOG(3) << "Partitioned graph of " << post_order.size() << " nodes into "
+             << partitioned->segments.size() << " computations";
+  return partitioned;
+}
+
+std::shared_ptr<XLATensor::Async> XLATensor::SchedulePartitionedSync(
+    std::vector<XLATensor>* tensors, const SyncTensorsConfig& config,
+    SyncTensorCollection* coll,
+    std::shared_ptr<PartitionedComputation> partitioned, std::string device) {
+  std::shared_ptr<Async> async = std::make_shared<Async>(
+      coll, std::move(coll->parameters_data), std::move(device), nullptr);
+  auto execute_fn = [partitioned = std::move(partitioned)](Async* async) {
+    // The parameters go first, followed by the segments in chain order.
+    std::vector<xla::ComputationClient::ExecuteChainedOp> ops;
+    for (auto& data : async->parameters_data) {
+      xla::ComputationClient::ExecuteChainedOp op;
+      op.device_data = data;
+      ops.push_back(std::move(op));
+    }
+    size_t num_parameters = ops.size();
+    for (auto& segment : partitioned->segments) {
+      xla::ComputationClient::ExecuteChainedOp op;
+      op.computation = segment.computation;
+      for (auto& input : segment.inputs) {
+        if (input.segment < 0) {
+          op.inputs.push_back({input.index, absl::nullopt});
+        } else {
+          op.inputs.push_back({num_parameters + input.segment, input.index});
+        }
+      }
+      for (auto& result : segment.results) {
+        op.outputs.push_back({result.first, result.second});
+      }
+      ops.push_back(std::move(op));
+    }
+    std::vector<xla::ComputationClient::DataPtr> chained_results =
+        xla::ComputationClient::Get()->ExecuteChained(ops, async->device);
+    std::vector<xla::ComputationClient::DataPtr> results;
+    results.reserve(partitioned->results.size());
+    for (auto index : partitioned->results) {
+      results.push_back(chained_results.at(index));
+    }
+    XLA_COUNTER("PartitionedSyncExecutions", 1);
+    return results;
+  };
+  return ScheduleSyncTensorsGraph(tensors, config, std::move(async),
+                                  std::move(execute_fn));
+}
+
+void XLATensor::PrepareSyncParameters(const std::vector<XLATensor>& tensors,
+                                      const SyncTensorsConfig& config,
+                                      SyncTensorCollection* coll) {
+  CollectParametersData(tensors, coll);
+  if (config.donate_buffers) {
+    coll->buffer_aliases =
+        ComputeBufferAliases(tensors, *coll, config.retained_data_ids);
+    if (!coll->buffer_aliases.empty()) {
+      XLA_COUNTER("DonatedBuffers", coll->buffer_aliases.size());
+      // The aliasing is part of the computation, so it must be part of the
+      // hash as well.
+      for (auto& alias : coll->buffer_aliases) {
+        coll->hash = xla::util::HashCombine(
+            coll->hash, xla::util::HashCombine(alias.first, alias.second));
+      }
+    }
+  }
+  if (GraphSpecializer::IsEnabled()) {
+    ApplyGraphSpecialization(coll);
+  }
+  SpeculativeCompiler::Get()->OnSync(
+      coll->hash, tensors[coll->indices.front()].GetDevice().ToString());
+}
+
+void XLATensor::RecordCacheMiss(const std::vector<XLATensor>& tensors,
+                                const SyncTensorCollection& coll) {
+  XLA_COUNTER("UncachedSyncTensors", 1);
+  if (GraphStats::IsEnabled()) {
+    GraphStats::Get()->RecordMiss(coll.hash);
+  }
+  if (CacheMissExplainer::IsEnabled()) {
+    std::vector<const ir::Node*> roots;
+    for (auto index : coll.indices) {
+      roots.push_back(tensors[index].CurrentIrValue().node.get());
+    }
+    CacheMissExplainer::Get()->ExplainMiss(coll.hash, roots);
+  }
+}
+
 std::shared_ptr<XLATensor::Async> XLATensor::SyncTensorsGraphInternal(
     std::vector<XLATensor>* tensors,
     tensorflow::gtl::ArraySlice<const std::string> devices,
     const SyncTensorsConfig& config) {
+  if (GetGraphMemoryBudget() > 0) {
+    TrySplitGraphByMemory(tensors, devices);
+  }
   SyncTensorCollection coll = CollectSyncTensors(*tensors, config);
   if (coll.indices.empty()) {
     return nullptr;
   }
+  PrepareSyncParameters(*tensors, config, &coll);
+  xla::util::Unique<Device> unique_device;
+  for (auto index : coll.indices) {
+    unique_device.set((*tensors)[index].GetDevice());
+  }
+  if (GetGraphCompileMaxNodes() > 0) {
+    std::shared_ptr<PartitionedComputation> partitioned =
+        GetPartitionedComputationCache()->Get(coll.hash);
+    if (partitioned != nullptr &&
+        partitioned->num_parameters == coll.parameters_data.size()) {
+      XLA_COUNTER("CachedPartitionedSyncs", 1);
+      return SchedulePartitionedSync(tensors, config, &coll,
+                                     std::move(partitioned),
+                                     unique_device->ToString());
+    }
+  }
   std::shared_ptr<Async> async = TryRunCachedSync(tensors, config, &coll);
   if (async != nullptr) {
     return async;
   }
-  XLA_COUNTER("UncachedSyncTensors", 1);
-
-  xla::util::Unique<Device> unique_device;
-  ir::LoweringContext lowering_ctx("SyncTensorsGraph");
-  for (auto index : coll.indices) {
-    ir::Value ir_value = (*tensors)[index].CurrentIrValue();
-    xla::XlaOp root = lowering_ctx.GetOutputOp(ir_value);
-    lowering_ctx.AddResult(root);
-    unique_device.set((*tensors)[index].GetDevice());
+  RecordCacheMiss(*tensors, coll);
+  if (UseAsyncCompile()) {
+    return ScheduleAsyncCompile(tensors, devices, config, &coll);
+  }
+  if (GetGraphCompileMaxNodes() > 0) {
+    std::shared_ptr<PartitionedComputation> partitioned =
+        PartitionSyncTensorsGraph(*tensors, coll, *unique_device, devices);
+    if (partitioned != nullptr) {
+      GetPartitionedComputationCache()->Add(coll.hash, partitioned);
+      return SchedulePartitionedSync(tensors, config, &coll,
+                                     std::move(partitioned),
+                                     unique_device->ToString());
+    }
   }
 
-  xla::XlaComputation computation = ConsumeValue(lowering_ctx.Build());
+  ir::LoweringContext lowering_ctx("SyncTensorsGraph");
+  xla::XlaComputation computation =
+      LowerSyncTensorsGraph(*tensors, coll, &lowering_ctx);
   xla::ProgramShape program_shape = ConsumeValue(computation.GetProgramShape());
   xla::Shape shape =
       MakeShapeWithDeviceLayout(program_shape.result(), unique_device->hw_type);
@@ -1241,9 +3504,15 @@ std::shared_ptr<XLATensor::Async> XLATensor::SyncTensorsGraphInternal(
                            unique_device->ToString(), devices),
                        &shape});
 
+  xla::int64 start_ns = xla::sys_util::NowNs();
   std::vector<std::shared_ptr<xla::ComputationClient::Computation>>
       computations =
           xla::ComputationClient::Get()->Compile(std::move(instances));
+  if (GraphStats::IsEnabled()) {
+    GraphStats::Get()->RecordCompile(coll.hash,
+                                     computations.front()->computation(),
+                                     xla::sys_util::NowNs() - start_ns);
+  }
   std::vector<xla::ComputationClient::DataPtr> parameters_data =
       lowering_ctx.GetParametersData();
   ComputationCache::TypePtr cached_computation = GetComputationCache()->Add(
@@ -1255,4 +3524,166 @@ std::shared_ptr<XLATensor::Async> XLATensor::SyncTensorsGraphInternal(
       unique_device->ToString(), std::move(cached_computation));
 }
 
+std::vector<std::shared_ptr<XLATensor::Async>>
+XLATensor::SyncTensorsGraphParallel(
+    std::vector<XLATensor>* tensors,
+    tensorflow::gtl::ArraySlice<const std::string> devices,
+    const SyncTensorsConfig& config) {
+  XLA_FN_TRACE("tensor");
+  // The device maps are ordered, so the device locks are always taken in the
+  // same order.
+  std::map<Device, std::vector<XLATensor>> device_tensors;
+  for (auto& tensor : *tensors) {
+    device_tensors[tensor.GetDevice()].push_back(tensor);
+  }
+  std::vector<std::shared_ptr<Async>> asyncs;
+  if (UseAsyncCompile() || ReplicatedData::Get()->IsEnabled() ||
+      GetGraphMemoryBudget() > 0 || GetGraphCompileMaxNodes() > 0) {
+    // These have their own per device compilation and execution strategies.
+    for (auto& device_tensors_it : device_tensors) {
+      std::shared_ptr<Async> async =
+          SyncTensorsGraphInternal(&device_tensors_it.second, devices, config);
+      if (async != nullptr) {
+        asyncs.push_back(std::move(async));
+      }
+    }
+    return asyncs;
+  }
+
+  struct DeviceSync {
+    std::vector<XLATensor>* tensors = nullptr;
+    Device device;
+    SyncTensorCollection coll;
+    std::vector<xla::ComputationClient::DataPtr> parameters_data;
+    ComputationCache::TypePtr cached_computation;
+  };
+  std::vector<DeviceSync> syncs;
+  std::list<xla::Shape> output_shapes;
+  std::vector<xla::ComputationClient::CompileInstance> instances;
+  std::vector<size_t> compiled_syncs;
+  for (auto& device_tensors_it : device_tensors) {
+    DeviceSync sync;
+    sync.tensors = &device_tensors_it.second;
+    sync.device = device_tensors_it.first;
+    sync.coll = CollectSyncTensors(*sync.tensors, config);
+    if (sync.coll.indices.empty()) {
+      continue;
+    }
+    PrepareSyncParameters(*sync.tensors, config, &sync.coll);
+    sync.cached_computation = LookupCachedComputation(sync.coll);
+    if (sync.cached_computation != nullptr) {
+      sync.parameters_data = std::move(sync.coll.parameters_data);
+    } else {
+      RecordCacheMiss(*sync.tensors, sync.coll);
+      ir::LoweringContext lowering_ctx("SyncTensorsGraph");
+      xla::XlaComputation computation =
+          LowerSyncTensorsGraph(*sync.tensors, sync.coll, &lowering_ctx);
+      xla::ProgramShape program_shape =
+          ConsumeValue(computation.GetProgramShape());
+      output_shapes.push_back(MakeShapeWithDeviceLayout(
+          program_shape.result(), sync.device.hw_type));
+      std::string device = sync.device.ToString();
+      instances.push_back(
+          {std::move(computation), device,
+           xla::ComputationClient::Get()->GetCompilationDevices(device,
+                                                                devices),
+           &output_shapes.back()});
+      sync.parameters_data = lowering_ctx.GetParametersData();
+      compiled_syncs.push_back(syncs.size());
+    }
+    syncs.push_back(std::move(sync));
+  }
+  if (!instances.empty()) {
+    // All the cache misses are compiled with a single call, which runs the
+    // compilations in parallel.
+    xla::int64 start_ns = xla::sys_util::NowNs();
+    std::vector<std::shared_ptr<xla::ComputationClient::Computation>>
+        computations =
+            xla::ComputationClient::Get()->Compile(std::move(instances));
+    xla::int64 compile_ns = xla::sys_util::NowNs() - start_ns;
+    for (size_t i = 0; i < computations.size(); ++i) {
+      DeviceSync* sync = &syncs[compiled_syncs[i]];
+      if (GraphStats::IsEnabled()) {
+        GraphStats::Get()->RecordCompile(
+            sync->coll.hash, computations[i]->computation(), compile_ns);
+      }
+      sync->cached_computation = GetComputationCache()->Add(
+          sync->coll.hash,
+          std::make_shared<CachedComputation>(std::move(computations[i]),
+                                              sync->parameters_data.size()));
+    }
+  }
+  if (syncs.size() == 1) {
+    DeviceSync* sync = &syncs.front();
+    asyncs.push_back(ScheduleSyncTensorsGraph(
+        sync->tensors, config, &sync->coll, std::move(sync->parameters_data),
+        sync->device.ToString(), std::move(sync->cached_computation)));
+    return asyncs;
+  }
+
+  for (auto& sync : syncs) {
+    std::shared_ptr<Async> async = std::make_shared<Async>(
+        &sync.coll, std::move(sync.parameters_data), sync.device.ToString(),
+        std::move(sync.cached_computation));
+    PrepareSyncTensorsData(sync.tensors, config, async.get());
+    asyncs.push_back(std::move(async));
+  }
+  if (asyncs.empty()) {
+    return asyncs;
+  }
+  XLA_COUNTER("ParallelSyncDevices", asyncs.size());
+
+  auto syncfn = [asyncs]() {
+    try {
+      for (auto& async : asyncs) {
+        WaitDeviceLocks(async->waiters);
+        WaitDataValues(async->parameters_data);
+      }
+      std::vector<xla::util::Cleanup<int>> slots;
+      std::vector<const xla::ComputationClient::Computation*> computations;
+      std::vector<std::vector<xla::ComputationClient::DataPtr>> arguments;
+      std::vector<std::string> sync_devices;
+      for (auto& async : asyncs) {
+        slots.push_back(ExecutionScheduler::Get()->Acquire(async->device,
+                                                           async->priority));
+        if (InputProfiler::IsEnabled()) {
+          InputProfiler::Get()->RecordConsumed(async->parameters_data);
+        }
+        computations.push_back(async->cached_computation->computation.get());
+        arguments.push_back(async->parameters_data);
+        sync_devices.push_back(async->device);
+      }
+      xla::int64 start_ns = xla::sys_util::NowNs();
+      xla::ComputationClient::ExecuteParallelOptions options;
+      std::vector<std::vector<xla::ComputationClient::DataPtr>> results =
+          xla::ComputationClient::Get()->ExecuteParallel(
+              computations, arguments, sync_devices, options);
+      xla::int64 execute_ns = xla::sys_util::NowNs() - start_ns;
+      slots.clear();
+      arguments.clear();
+      for (size_t i = 0; i < asyncs.size(); ++i) {
+        if (GraphStats::IsEnabled()) {
+          GraphStats::Get()->RecordExecution(asyncs[i]->hash, execute_ns,
+                                             asyncs[i]->parameters_data,
+                                             results[i]);
+        }
+        ReleaseConsumedParameters(&asyncs[i]->parameters_data);
+        AssignSyncResults(std::move(results[i]), asyncs[i].get());
+      }
+    } catch (...) {
+      std::exception_ptr exptr = std::current_exception();
+      for (auto& async : asyncs) {
+        SetSyncError(exptr, async.get());
+      }
+    }
+  };
+  // Every device sync completes once the shared execution does.
+  std::function<void()> closure = std::move(syncfn);
+  for (auto& async : asyncs) {
+    closure = async->mwait.Completer(std::move(closure));
+  }
+  xla::env::ScheduleIoClosure(std::move(closure), xla::env::Priority::kHigh);
+  return asyncs;
+}
+
 }  // namespace torch_xla
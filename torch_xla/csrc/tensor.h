@@ -1,8 +1,13 @@
 #pragma once
 
+#include <exception>
+#include <functional>
 #include <iostream>
+#include <memory>
 #include <string>
 #include <unordered_map>
+#include <unordered_set>
+#include <utility>
 
 #include "tensorflow/compiler/xla/client/xla_builder.h"
 #include "tensorflow/compiler/xla/status.h"
@@ -10,10 +15,14 @@
 #include "tensorflow/compiler/xla/xla_client/async_task.h"
 #include "tensorflow/compiler/xla/xla_client/cache.h"
 #include "tensorflow/compiler/xla/xla_client/computation_client.h"
+#include "tensorflow/compiler/xla/xla_client/future.h"
 #include "tensorflow/compiler/xla/xla_client/multi_wait.h"
 #include "tensorflow/compiler/xla/xla_client/util.h"
 #include "torch/csrc/autograd/variable.h"
+#include "torch_xla/csrc/cross_replica_reduces.h"
 #include "torch_xla/csrc/device.h"
+#include "torch_xla/csrc/execution_scheduler.h"
+#include "torch_xla/csrc/graph_specializer.h"
 #include "torch_xla/csrc/ir.h"
 #include "torch_xla/csrc/view.h"
 
@@ -47,6 +56,12 @@ class XLATensor {
 
   at::Tensor ToTensor();
 
+  // Reads the value of a single element tensor. The other single element
+  // tensors of the same device, whose device data has not been fetched yet
+  // (like the losses and metrics computed by the same step), are fetched with
+  // the same transfer, and their value is cached as tensor data.
+  at::Scalar ToScalar();
+
   // Assigns the tensor value to the XLA tensor.
   void SetTensor(at::Tensor tensor);
 
@@ -72,6 +87,33 @@ class XLATensor {
 
   void SetXlaData(xla::ComputationClient::DataPtr xla_data);
 
+  // Sets the category under which the device memory of the tensor is
+  // accounted. The category is applied to all the device data the tensor will
+  // hold from now on, like the results of the following steps.
+  void SetMemoryCategory(xla::MemoryTracker::Category category);
+
+  // Sets whether the pending IR value of the tensor becomes an output of the
+  // live tensors syncs (like the ones of mark_step()). A tensor which is not
+  // materialized keeps its IR value, so it uses no device memory of its own,
+  // and it is computed (again) only if it gets read.
+  void SetMaterialize(bool materialize);
+
+  // Drops the device data of the tensor, whose value must not be pending, and
+  // keeps the tensor_data host copy of it instead. The device memory is
+  // released once no other tensor or graph refers to the data, and the next
+  // use of the tensor uploads the value again.
+  void OffloadXlaData(at::Tensor tensor_data);
+
+  // Queues the upload of the host data of the tensor, which is deferred until a
+  // computation uses the tensor, or any other tensor of its device queued by
+  // the same thread. All those queued tensors are then uploaded with a single
+  // transfer.
+  void QueueUpload() const;
+
+  // Records tensor, which must hold the current value of the tensor, as its
+  // host copy, so that the following reads from host do not fetch it again.
+  void SetHostCopy(at::Tensor tensor);
+
   // Retrieves the current IR Node, or nullptr in case no active IR Node is
   // available.
   ir::Value CurrentIrValue() const;
@@ -114,6 +156,10 @@ class XLATensor {
   // key, and by unique ID as secondary key.
   static std::vector<XLATensor> GetLiveTensors(const Device* device);
 
+  // Returns the live tensors which may need a sync (the ones without device
+  // data, or with a view), with the ordering of GetLiveTensors().
+  static std::vector<XLATensor> GetPendingTensors(const Device* device);
+
   // Applies all the pending IR operations queued over the input tensors. All
   // the tensors must be on the same device. If wait is true, the sync operation
   // will be run synchronously. The devices argument, if not empty, tells the
@@ -131,14 +177,60 @@ class XLATensor {
       const Device* device,
       tensorflow::gtl::ArraySlice<const std::string> devices, bool wait);
 
+  // Like SyncLiveTensorsGraph(), but runs the pending IR operations of the
+  // device, traced for a single step, once for every slice of the outer
+  // dimension of the stacked_inputs, within a single device execution. The
+  // step_inputs are the device data tensors the step was traced with, and
+  // step k sees the k-th slice of stacked_inputs[i] in place of
+  // step_inputs[i]. The tensors updated in place by a step feed their new
+  // values to the following one, and all the synced tensors end up holding
+  // the values of the last step.
+  static void SyncLiveTensorsGraphSteps(
+      const Device& device, const std::vector<XLATensor>& step_inputs,
+      const std::vector<XLATensor>& stacked_inputs, bool wait);
+
+  // A compiled graph, as held by the compilation cache.
+  struct CachedGraph {
+    size_t hash = 0;
+    std::shared_ptr<xla::ComputationClient::Computation> computation;
+    size_t num_parameters = 0;
+  };
+
+  // Returns the graphs currently held by the compilation cache.
+  static std::vector<CachedGraph> GetCachedGraphs();
+
+  // Adds a graph compiled out of band (like one loaded from a bundle) to the
+  // compilation cache, so that the syncs of the graphs with the same hash run
+  // it without tracing and compiling it again.
+  static void AddCachedGraph(const CachedGraph& graph);
+
   // Marks an execution step, which allows the tensor framework to understand
-  // the computation boundaries.
+  // the computation boundaries. Also moves the RNG of the device (all the
+  // devices if nullptr) to the seed of the next step.
   static void MarkStep(const Device* device);
 
+  // Returns the seed IR value for a new random operation on the device. Every
+  // call advances the per device RNG state within the IR graph, starting from
+  // the seed of the step, which is fed to the graph as device data.
+  static ir::Value GetRngSeed(const Device& device);
+
+  // Sets the RNG seed of the device (all the devices if nullptr).
+  static void SetRngSeed(const Device* device, xla::uint64 seed);
+
+  // Returns the host copy of the seed of the last random operation.
+  static xla::uint64 GetRunningSeed(const Device& device);
+
   // Retrieves the PyTorch tensors behind the XLA tensors. All the tensors must
   // be on the same device.
   static std::vector<at::Tensor> GetTensors(std::vector<XLATensor>* tensors);
 
+  // Like GetTensors(), but returns right after the sync of the pending IR
+  // operations has been scheduled. The device to host transfer runs in
+  // background once the sync completes, and the returned future holds the
+  // PyTorch tensors.
+  static xla::util::Future<std::vector<at::Tensor>> GetTensorsAsync(
+      std::vector<XLATensor>* tensors);
+
   // Operation which creates XLA tensors out of autograd variable by batching
   // the requests to the computation servers.
   static std::vector<XLATensor> CreateTensors(
@@ -178,18 +270,42 @@ class XLATensor {
   static XLATensor __xor__(const XLATensor& input, at::Scalar other);
   static XLATensor __xor__(const XLATensor& input, const XLATensor& other);
 
-  static XLATensor _adaptive_avg_pool2d(const XLATensor& input,
-                                        std::vector<xla::int64> output_size);
-
-  static XLATensor _adaptive_avg_pool2d_backward(const XLATensor& grad_output,
-                                                 const XLATensor& input);
-
   static XLATensor abs(const XLATensor& input);
   static void abs_(XLATensor& input);
 
   static XLATensor acos(const XLATensor& input);
   static void acos_(XLATensor& input);
 
+  // Updates, in place, the parameters and the state tensors with one step of
+  // torch.optim.Adam, within a single IR node. The max_exp_avg_sqs are empty
+  // unless amsgrad is used, and step_size is the learning rate scaled by the
+  // bias corrections of the step.
+  static void adam_step_(std::vector<XLATensor>& params,
+                         const std::vector<XLATensor>& grads,
+                         std::vector<XLATensor>& exp_avgs,
+                         std::vector<XLATensor>& exp_avg_sqs,
+                         std::vector<XLATensor>& max_exp_avg_sqs,
+                         double step_size, double beta1, double beta2,
+                         double eps, double weight_decay);
+
+  static XLATensor adaptive_avg_pool_nd(const XLATensor& input,
+                                        xla::int64 spatial_dim_count,
+                                        std::vector<xla::int64> output_size);
+
+  static XLATensor adaptive_avg_pool_nd_backward(const XLATensor& grad_output,
+                                                 const XLATensor& input,
+                                                 xla::int64 spatial_dim_count);
+
+  // Returns the pooled input and the flat spatial indices of the maximums.
+  static std::tuple<XLATensor, XLATensor> adaptive_max_pool_nd(
+      const XLATensor& input, xla::int64 spatial_dim_count,
+      std::vector<xla::int64> output_size);
+
+  static XLATensor adaptive_max_pool_nd_backward(const XLATensor& grad_output,
+                                                 const XLATensor& input,
+                                                 const XLATensor& indices,
+                                                 xla::int64 spatial_dim_count);
+
   static XLATensor add(const XLATensor& input, const XLATensor& other,
                        at::Scalar alpha);
   static void add_(XLATensor& input, const XLATensor& other, at::Scalar alpha);
@@ -214,6 +330,26 @@ class XLATensor {
                        std::vector<xla::int64> dimensions,
                        bool keep_reduced_dimensions);
 
+  // Concatenates the inputs of the shard_count replicas of every group (or of
+  // all the replicas, with empty groups) along dim, in replica order.
+  static XLATensor all_gather(
+      const XLATensor& input, xla::int64 dim, xla::int64 shard_count,
+      const std::vector<std::vector<xla::int64>>& groups);
+
+  // Splits the input in split_count slices along split_dimension, sends the
+  // j-th slice to the j-th replica of the group, and concatenates the received
+  // slices along concat_dimension.
+  static XLATensor all_to_all(
+      const XLATensor& input, xla::int64 split_dimension,
+      xla::int64 concat_dimension, xla::int64 split_count,
+      const std::vector<std::vector<xla::int64>>& groups);
+
+  // Unscales, in place, the gradients by the F32 scalar loss_scale tensor, and
+  // checks them for non finite values, within a single IR node. Returns the
+  // F32 scalar found_inf flag, which stays on device.
+  static XLATensor amp_unscale_(std::vector<XLATensor>& grads,
+                                const XLATensor& loss_scale);
+
   static XLATensor any(const XLATensor& input,
                        std::vector<xla::int64> dimensions,
                        bool keep_reduced_dimensions);
@@ -227,14 +363,16 @@ class XLATensor {
   static XLATensor argmin(const XLATensor& input, xla::int64 dim, bool keepdim);
   static XLATensor argmin(const XLATensor& input);
 
-  // Takes a slice from the input as R1 at the specified offset and reshapes it
-  // into the provided size.
+  // Takes the strided view of the input, seen as a contiguous R1 storage,
+  // starting at the specified offset.
   static XLATensor as_strided(const XLATensor& input,
                               std::vector<xla::int64> size,
+                              std::vector<xla::int64> stride,
                               c10::optional<xla::int64> storage_offset);
 
   // In-place version of the method above.
   static void as_strided_(XLATensor& input, std::vector<xla::int64> size,
+                          std::vector<xla::int64> stride,
                           c10::optional<xla::int64> storage_offset);
 
   static XLATensor asin(const XLATensor& input);
@@ -246,6 +384,21 @@ class XLATensor {
   static XLATensor atan2(const XLATensor& input, const XLATensor& other);
   static void atan2_(XLATensor& input, const XLATensor& other);
 
+  // Computes softmax(query * key^T * scale + mask) * value with a blocked
+  // lowering, which never materializes the full scores tensor. The mask is
+  // optional, and can either be a boolean one (true excludes the score) or an
+  // additive one. Returns the output and the logsumexp of the score rows.
+  static std::tuple<XLATensor, XLATensor> attention(const XLATensor& query,
+                                                    const XLATensor& key,
+                                                    const XLATensor& value,
+                                                    const XLATensor& mask,
+                                                    double scale);
+
+  static std::tuple<XLATensor, XLATensor, XLATensor> attention_backward(
+      const XLATensor& grad_output, const XLATensor& query,
+      const XLATensor& key, const XLATensor& value, const XLATensor& mask,
+      const XLATensor& output, const XLATensor& logsumexp, double scale);
+
   static XLATensor avg_pool_nd(const XLATensor& input,
                                xla::int64 spatial_dim_count,
                                std::vector<xla::int64> kernel_size,
@@ -290,8 +443,29 @@ class XLATensor {
   static void clamp_(XLATensor& input, c10::optional<at::Scalar> min,
                      c10::optional<at::Scalar> max);
 
+  // Scales, in place, the gradients by the clip coefficient of their total
+  // norm, like torch.nn.utils.clip_grad_norm_, within a single IR node. Returns
+  // the total norm as a F32 scalar tensor, which stays on device.
+  static XLATensor clip_grad_norm_(std::vector<XLATensor>& grads,
+                                   double max_norm, double norm_type);
+
   static XLATensor clone(const XLATensor& input);
 
+  // Sends the input of every source replica to its target replica. The
+  // replicas which are not the target of any pair get zeros.
+  static XLATensor collective_permute(
+      const XLATensor& input,
+      std::vector<std::pair<xla::int64, xla::int64>> source_target_pairs);
+
+  // Returns the outputs of the true or the false subgraph, depending on the
+  // value of the scalar boolean predicate, as a conditional within the device
+  // computation. The subgraphs are traced from the subgraph_parameters() of
+  // scope, which are bound to the operands.
+  static std::vector<XLATensor> cond(
+      const XLATensor& predicate, const std::vector<XLATensor>& operands,
+      xla::int64 scope, const std::vector<XLATensor>& true_outputs,
+      const std::vector<XLATensor>& false_outputs);
+
   // Pad with the given value and size specified by the given list of low and
   // high paddings.
   static XLATensor constant_pad_nd(
@@ -338,6 +512,21 @@ class XLATensor {
       XLATensor& input, double scale,
       const std::vector<std::vector<xla::int64>>& groups);
 
+  // Sums the inputs across replicas in place. The inputs are packed, in order
+  // and by element type, within buckets of up to XLA_CRS_BUCKET_BYTES bytes,
+  // each one reduced by a single collective. The bucket boundaries only
+  // depend on the inputs shapes, so the same inputs produce the same graph at
+  // every step.
+  // With error_feedback, the error introduced by the compression on every
+  // input is kept within the input tensor itself, and added back to it before
+  // the following reduction. A non empty host_groups (the replicas of every
+  // host) selects the hierarchical reduction.
+  static void cross_replica_sum_(
+      std::vector<XLATensor>& inputs, double scale,
+      const std::vector<std::vector<xla::int64>>& groups,
+      CrossReplicaSumCompression compression, bool error_feedback,
+      const std::vector<std::vector<xla::int64>>& host_groups);
+
   // Returns the cumulative product of elements of input in the given dimension.
   static XLATensor cumprod(const XLATensor& input, xla::int64 dim,
                            c10::optional<at::ScalarType> dtype);
@@ -364,6 +553,16 @@ class XLATensor {
   static XLATensor dropout(const XLATensor& input, double p);
   static void dropout_(XLATensor& input, double p);
 
+  // Returns the dropout of the input, with p the probability of dropping an
+  // element, together with the mask of the kept elements, packed in S32 words
+  // (one bit per element) to be saved for the backward pass.
+  static std::tuple<XLATensor, XLATensor> packed_dropout(const XLATensor& input,
+                                                         double p);
+
+  static XLATensor packed_dropout_backward(const XLATensor& grad_output,
+                                           const XLATensor& packed_mask,
+                                           double p);
+
   // A generalized contraction between tensors of arbitrary dimension defined by
   // the given equation and applied to the input tensors.
   static XLATensor einsum(const std::string& equation,
@@ -377,6 +576,26 @@ class XLATensor {
                                 at::Scalar scale, at::Scalar input_scale,
                                 const XLATensor& output);
 
+  // Reduces (with the ATen embedding_bag mode) the weight rows of the indices
+  // within every bag starting at the offsets. Returns the output, followed by
+  // the offset2bag, bag_size and max_indices tensors needed by the backward.
+  // The per_sample_weights are ignored if null.
+  static std::tuple<XLATensor, XLATensor, XLATensor, XLATensor> embedding_bag(
+      const XLATensor& weight, const XLATensor& indices,
+      const XLATensor& offsets, xla::int64 mode,
+      const XLATensor& per_sample_weights);
+
+  static XLATensor embedding_bag_dense_backward(
+      const XLATensor& grad, const XLATensor& indices,
+      const XLATensor& offset2bag, const XLATensor& bag_size,
+      const XLATensor& max_indices, xla::int64 num_weights,
+      bool scale_grad_by_freq, xla::int64 mode,
+      const XLATensor& per_sample_weights);
+
+  static XLATensor embedding_bag_per_sample_weights_backward(
+      const XLATensor& grad, const XLATensor& weight, const XLATensor& indices,
+      const XLATensor& offset2bag);
+
   static XLATensor embedding_dense_backward(const XLATensor& grad_output,
                                             const XLATensor& indices,
                                             xla::int64 num_weights,
@@ -444,12 +663,53 @@ class XLATensor {
   static XLATensor ge(const XLATensor& input, const XLATensor& other);
   static void ge_(XLATensor& input, const XLATensor& other);
 
+  // Normalizes the input with the statistics of num_groups equally sized
+  // groups of consecutive elements, and applies the (optional) weight and bias
+  // along affine_dims. Covers the layer, group and instance norms. Returns the
+  // output and the per group mean and inverse standard deviation.
+  static std::tuple<XLATensor, XLATensor, XLATensor> group_norm(
+      const XLATensor& input, const XLATensor& weight, const XLATensor& bias,
+      xla::int64 num_groups, std::vector<xla::int64> affine_dims, double eps);
+
+  static std::tuple<XLATensor, XLATensor, XLATensor> group_norm_backward(
+      const XLATensor& grad_output, const XLATensor& input,
+      const XLATensor& weight, const XLATensor& mean, const XLATensor& rstd,
+      xla::int64 num_groups, std::vector<xla::int64> affine_dims);
+
   static XLATensor gt(const XLATensor& input, at::Scalar other);
   static void gt_(XLATensor& input, at::Scalar other);
 
   static XLATensor gt(const XLATensor& input, const XLATensor& other);
   static void gt_(XLATensor& input, const XLATensor& other);
 
+  // The fused recurrent cells and sequences (see rnn.h), whose biases are
+  // optional. The forward ones return the h (and c) outputs, followed by the
+  // state needed by the backward ones, which return the gradients of the
+  // inputs, the states and the weights, and the one of the biases (shared by
+  // b_ih and b_hh for LSTM, separate ones for GRU).
+  static std::vector<XLATensor> gru_cell(const XLATensor& input,
+                                         const XLATensor& hx,
+                                         const XLATensor& w_ih,
+                                         const XLATensor& w_hh,
+                                         const XLATensor& b_ih,
+                                         const XLATensor& b_hh);
+
+  static std::vector<XLATensor> gru_cell_backward(
+      const XLATensor& grad_h, const XLATensor& input, const XLATensor& hx,
+      const XLATensor& w_ih, const XLATensor& w_hh, const XLATensor& gates);
+
+  static std::vector<XLATensor> gru_sequence(const XLATensor& input,
+                                             const XLATensor& h0,
+                                             const XLATensor& w_ih,
+                                             const XLATensor& w_hh,
+                                             const XLATensor& b_ih,
+                                             const XLATensor& b_hh);
+
+  static std::vector<XLATensor> gru_sequence_backward(
+      const XLATensor& grad_output, const XLATensor& input,
+      const XLATensor& h0, const XLATensor& w_ih, const XLATensor& w_hh,
+      const XLATensor& output, const XLATensor& gates);
+
   static std::tuple<XLATensor, XLATensor> kthvalue(const XLATensor& input,
                                                    xla::int64 k, xla::int64 dim,
                                                    bool keepdim);
@@ -458,10 +718,15 @@ class XLATensor {
   // shape of the indices are first made consistent using broadcast semantics.
   // For input of shape d1 x d2 x ... x dn and p indices of shape i1 x i2 x ...
   // x ik, the output shape is d1 x ... x d(start_dim) x i1 x ... x ik x
-  // d(start_dim+p+1) x ... x dn.
-  static XLATensor index(const XLATensor& input,
-                         tensorflow::gtl::ArraySlice<const XLATensor> indices,
-                         xla::int64 start_dim);
+  // d(start_dim+p+1) x ... x dn, when the indices index the adjacent dimensions
+  // starting at start_dim. In general the indices index the index_dims
+  // dimensions, which get dropped from the result, where the indices
+  // dimensions are placed at start_dim.
+  static XLATensor index(
+      const XLATensor& input,
+      tensorflow::gtl::ArraySlice<const XLATensor> indices,
+      tensorflow::gtl::ArraySlice<const xla::int64> index_dims,
+      xla::int64 start_dim);
 
   static XLATensor index_add(const XLATensor& input, xla::int64 dim,
                              const XLATensor& index, const XLATensor& source);
@@ -493,17 +758,17 @@ class XLATensor {
 
   // Puts values into the input tensor using the given indices (a tuple of
   // tensors) and returns the result.
+  // The index_dims and start_dim have the same meaning as for index().
   static XLATensor index_put(
       const XLATensor& input,
       tensorflow::gtl::ArraySlice<const XLATensor> indices,
-      xla::int64 start_dim, const XLATensor& values, bool accumulate,
-      tensorflow::gtl::ArraySlice<const xla::int64> result_permutation);
+      tensorflow::gtl::ArraySlice<const xla::int64> index_dims,
+      xla::int64 start_dim, const XLATensor& values, bool accumulate);
 
   static void index_put_(
-      XLATensor& input, const XLATensor& canonical_base,
-      tensorflow::gtl::ArraySlice<const XLATensor> indices,
-      xla::int64 start_dim, const XLATensor& values, bool accumulate,
-      tensorflow::gtl::ArraySlice<const xla::int64> result_permutation);
+      XLATensor& input, tensorflow::gtl::ArraySlice<const XLATensor> indices,
+      tensorflow::gtl::ArraySlice<const xla::int64> index_dims,
+      xla::int64 start_dim, const XLATensor& values, bool accumulate);
 
   static XLATensor index_select(const XLATensor& input, xla::int64 dim,
                                 const XLATensor& index);
@@ -513,6 +778,16 @@ class XLATensor {
                                    const XLATensor& target,
                                    xla::int64 reduction);
 
+  // Like adam_step_(), for the LAMB optimizer. The bias corrections are
+  // 1 - beta^step, or 1 when they are disabled.
+  static void lamb_step_(std::vector<XLATensor>& params,
+                         const std::vector<XLATensor>& grads,
+                         std::vector<XLATensor>& exp_avgs,
+                         std::vector<XLATensor>& exp_avg_sqs, double lr,
+                         double beta1, double beta2, double eps,
+                         double weight_decay, double bias_correction1,
+                         double bias_correction2);
+
   static XLATensor le(const XLATensor& input, at::Scalar other);
   static void le_(XLATensor& input, at::Scalar other);
 
@@ -563,6 +838,34 @@ class XLATensor {
   static XLATensor lt(const XLATensor& input, const XLATensor& other);
   static void lt_(XLATensor& input, const XLATensor& other);
 
+  static std::vector<XLATensor> lstm_cell(
+      const XLATensor& input, const XLATensor& hx, const XLATensor& cx,
+      const XLATensor& w_ih, const XLATensor& w_hh, const XLATensor& b_ih,
+      const XLATensor& b_hh);
+
+  static std::vector<XLATensor> lstm_cell_backward(
+      const XLATensor& grad_h, const XLATensor& grad_c, const XLATensor& input,
+      const XLATensor& hx, const XLATensor& cx, const XLATensor& w_ih,
+      const XLATensor& w_hh, const XLATensor& c, const XLATensor& gates);
+
+  static std::vector<XLATensor> lstm_sequence(
+      const XLATensor& input, const XLATensor& h0, const XLATensor& c0,
+      const XLATensor& w_ih, const XLATensor& w_hh, const XLATensor& b_ih,
+      const XLATensor& b_hh);
+
+  static std::vector<XLATensor> lstm_sequence_backward(
+      const XLATensor& grad_output, const XLATensor& grad_cells,
+      const XLATensor& input, const XLATensor& h0, const XLATensor& c0,
+      const XLATensor& w_ih, const XLATensor& w_hh, const XLATensor& output,
+      const XLATensor& cells, const XLATensor& gates);
+
+  // Annotates the value of the input with the sharding which tiles it over a
+  // device mesh, see CreateTiledSharding().
+  static void mark_sharding_(
+      XLATensor& input,
+      tensorflow::gtl::ArraySlice<const xla::int64> mesh_shape,
+      tensorflow::gtl::ArraySlice<const xla::int64> dim_axes);
+
   // Fills elements of the input tensor with the provided value where mask is
   // one. The shape of mask must be broadcastable with the shape of the
   // underlying tensor.
@@ -573,6 +876,12 @@ class XLATensor {
   static void masked_fill_(XLATensor& input, const XLATensor& mask,
                            at::Scalar value);
 
+  // Returns the elements of input where mask is true, padded with zeros to the
+  // number of elements of their broadcast shape, and the count of the valid
+  // elements, so that the result size does not depend on the data.
+  static std::tuple<XLATensor, XLATensor> masked_select_bounded(
+      const XLATensor& input, const XLATensor& mask);
+
   static XLATensor matmul(const XLATensor& input, const XLATensor& other);
 
   static XLATensor max(const XLATensor& input, const XLATensor& other);
@@ -588,6 +897,12 @@ class XLATensor {
                                std::vector<xla::int64> stride,
                                std::vector<xla::int64> padding, bool ceil_mode);
 
+  // Returns the pooled input and the flat spatial indices of the maximums.
+  static std::tuple<XLATensor, XLATensor> max_pool_nd_with_indices(
+      const XLATensor& input, xla::int64 spatial_dim_count,
+      std::vector<xla::int64> kernel_size, std::vector<xla::int64> stride,
+      std::vector<xla::int64> padding, bool ceil_mode);
+
   static XLATensor max_pool_nd_backward(const XLATensor& out_backprop,
                                         const XLATensor& input,
                                         xla::int64 spatial_dim_count,
@@ -596,6 +911,14 @@ class XLATensor {
                                         std::vector<xla::int64> padding,
                                         bool ceil_mode);
 
+  // Computes the max pooling gradient from the indices returned by
+  // max_pool_nd_with_indices().
+  static XLATensor max_pool_nd_backward_with_indices(
+      const XLATensor& out_backprop, const XLATensor& input,
+      const XLATensor& indices, xla::int64 spatial_dim_count,
+      std::vector<xla::int64> kernel_size, std::vector<xla::int64> stride,
+      std::vector<xla::int64> padding, bool ceil_mode);
+
   static XLATensor mean(const XLATensor& input,
                         std::vector<xla::int64> dimensions,
                         bool keep_reduced_dimensions,
@@ -648,10 +971,19 @@ class XLATensor {
   static XLATensor nll_loss_backward(const XLATensor& input,
                                      const XLATensor& target, int ignore_index);
 
+  // Returns the [numel, rank] indices of the non-zero elements of input, padded
+  // with zero rows, and the count of the valid rows.
+  static std::tuple<XLATensor, XLATensor> nonzero_bounded(
+      const XLATensor& input);
+
   static XLATensor norm(const XLATensor& input, c10::optional<at::Scalar> p,
                         c10::optional<at::ScalarType> dtype,
                         at::IntArrayRef dim, bool keepdim);
 
+  // Fills the input with values drawn, on device, from the normal distribution
+  // with the given mean and standard deviation.
+  static void normal_(XLATensor& input, double mean, double std);
+
   static XLATensor not_supported(std::string description, xla::Shape shape,
                                  const Device& device);
 
@@ -672,12 +1004,49 @@ class XLATensor {
 
   static std::tuple<XLATensor, XLATensor> qr(const XLATensor& input, bool some);
 
+  // Computes the convolution of the input with the int8 weight, quantized per
+  // output channel with weight_scales, while the input is quantized with
+  // input_scale. The bias is added unless it is null.
+  static XLATensor quantized_convolution(
+      const XLATensor& input, const XLATensor& weight,
+      const XLATensor& weight_scales, const XLATensor& bias,
+      double input_scale, std::vector<xla::int64> stride,
+      std::vector<xla::int64> padding, std::vector<xla::int64> dilation,
+      xla::int64 groups);
+
+  // Same as above, for the linear layer with the int8 weight of shape
+  // [out_features, in_features].
+  static XLATensor quantized_linear(const XLATensor& input,
+                                    const XLATensor& weight,
+                                    const XLATensor& weight_scales,
+                                    const XLATensor& bias, double input_scale);
+
+  // Fills the input with integer values drawn, on device, from the uniform
+  // distribution within [from, to).
+  static void random_(XLATensor& input, xla::int64 from, xla::int64 to);
+
   static XLATensor randperm(xla::int64 n, const Device& device,
                             at::ScalarType scalar_type);
 
   static XLATensor reciprocal(const XLATensor& input);
   static void reciprocal_(XLATensor& input);
 
+  // Sums the inputs across the shard_count replicas of every group (or all the
+  // replicas, with empty groups), scales the result by scale, and returns the
+  // slice along dim matching the replica index within the group.
+  static XLATensor reduce_scatter(
+      const XLATensor& input, double scale, xla::int64 dim,
+      xla::int64 shard_count,
+      const std::vector<std::vector<xla::int64>>& groups);
+
+  // Returns the inputs, with a data dependency on anchor, so that the
+  // computations using them are not started before the anchor is available,
+  // and are not merged with the ones using the original inputs. Used to
+  // recompute activations within the backward pass.
+  static std::vector<XLATensor> remat_anchor(
+      tensorflow::gtl::ArraySlice<const XLATensor> inputs,
+      const XLATensor& anchor);
+
   static XLATensor relu(const XLATensor& input);
   static void relu_(XLATensor& input);
 
@@ -734,9 +1103,33 @@ class XLATensor {
   static XLATensor scatter(const XLATensor& input, xla::int64 dim,
                            const XLATensor& index, at::Scalar value);
 
+  // Sums the slices of values along dim with the same index, within the rank 1
+  // indices tensor. Returns the indices, where each distinct one appears only
+  // once (the other slots have num_segments as index), and the sums.
+  static std::tuple<XLATensor, XLATensor> segment_sum(const XLATensor& indices,
+                                                      const XLATensor& values,
+                                                      xla::int64 dim,
+                                                      xla::int64 num_segments);
+
   static XLATensor select(const XLATensor& input, xla::int64 dim,
                           xla::int64 index);
 
+  // Restores the previous values of the tensors, in place, if the found_inf
+  // flag returned by amp_unscale_() is set, so that the update they have got
+  // in the meantime (like an optimizer step) is dropped on device.
+  static void select_finite_updates_(std::vector<XLATensor>& tensors,
+                                     const std::vector<XLATensor>& previous,
+                                     const XLATensor& found_inf);
+
+  // Like adam_step_(), for torch.optim.SGD. The momentum buffers are empty
+  // when the momentum is zero, and are initialized from the gradients if
+  // init_buffers is true.
+  static void sgd_step_(std::vector<XLATensor>& params,
+                        const std::vector<XLATensor>& grads,
+                        std::vector<XLATensor>& momentum_buffers, double lr,
+                        double momentum, double dampening, double weight_decay,
+                        bool nesterov, bool init_buffers);
+
   static XLATensor sigmoid(const XLATensor& input);
   static void sigmoid_(XLATensor& input);
   static XLATensor sigmoid_backward(const XLATensor& grad_output,
@@ -783,6 +1176,20 @@ class XLATensor {
                                        const XLATensor& input,
                                        at::Scalar lambda);
 
+  // Returns the input sorted along dim, and the positions of the sorted
+  // elements, out of a single sort. A stable sort keeps the equal elements in
+  // their original order.
+  static std::tuple<XLATensor, XLATensor> sort(const XLATensor& input,
+                                               xla::int64 dim, bool descending,
+                                               bool stable);
+
+  // Same as above, with the elements ordered lexicographically by the keys
+  // (the first key being the most significant one), and returning the sorted
+  // first key.
+  static std::tuple<XLATensor, XLATensor> sort(
+      const std::vector<XLATensor>& keys, xla::int64 dim, bool descending,
+      bool stable);
+
   static std::vector<XLATensor> split(const XLATensor& input,
                                       xla::int64 split_size, xla::int64 dim);
 
@@ -814,6 +1221,13 @@ class XLATensor {
                        at::Scalar alpha);
   static void sub_(XLATensor& input, at::Scalar other, at::Scalar alpha);
 
+  // Creates the placeholders of the operands of the subgraphs traced within a
+  // new scope, for cond() and while_loop(). The tensors computed from them must
+  // not be used outside of the subgraphs. Returns the scope, and the
+  // placeholders.
+  static std::pair<xla::int64, std::vector<XLATensor>> subgraph_parameters(
+      const std::vector<XLATensor>& operands);
+
   static XLATensor sum(const XLATensor& input,
                        std::vector<xla::int64> dimensions,
                        bool keep_reduced_dimensions,
@@ -883,12 +1297,42 @@ class XLATensor {
   // removed.
   static std::vector<XLATensor> unbind(const XLATensor& input, xla::int64 dim);
 
+  // Fills the input with values drawn, on device, from the uniform
+  // distribution within [from, to).
+  static void uniform_(XLATensor& input, double from, double to);
+
+  // Returns the sorted unique elements of input, padded with zeros to the
+  // number of elements of input, and the count of the valid elements.
+  static std::tuple<XLATensor, XLATensor> unique_bounded(
+      const XLATensor& input);
+
+  // Updates, in place, the F32 scalar loss_scale and good_steps tensors of a
+  // dynamic loss scaler, out of the found_inf flag returned by amp_unscale_().
+  static void update_loss_scale_(XLATensor& loss_scale, XLATensor& good_steps,
+                                 const XLATensor& found_inf,
+                                 double growth_factor, double backoff_factor,
+                                 xla::int64 growth_interval, double min_scale);
+
   // Insert a dimension of size one at the specified position.
   static XLATensor unsqueeze(const XLATensor& input, xla::int64 dim);
 
   // In-place version of the method above.
   static void unsqueeze_(XLATensor& input, xla::int64 dim);
 
+  static XLATensor upsample_bilinear2d(const XLATensor& input,
+                                       std::vector<xla::int64> output_size,
+                                       bool align_corners);
+
+  static XLATensor upsample_bilinear2d_backward(
+      const XLATensor& grad_output, std::vector<xla::int64> input_size,
+      bool align_corners);
+
+  static XLATensor upsample_nearest2d(const XLATensor& input,
+                                      std::vector<xla::int64> output_size);
+
+  static XLATensor upsample_nearest2d_backward(
+      const XLATensor& grad_output, std::vector<xla::int64> input_size);
+
   // Like reshape, but it returns a view into the original tensor.
   static XLATensor view(
       const XLATensor& input,
@@ -899,11 +1343,34 @@ class XLATensor {
   static XLATensor where(const XLATensor& condition, const XLATensor& input,
                          const XLATensor& other);
 
+  // Runs the body subgraph while the condition subgraph returns true, as a loop
+  // within the device computation, and returns the final values of the loop
+  // state. Both subgraphs are traced from the subgraph_parameters() of scope,
+  // which are bound to the operands at the first iteration, and to the body
+  // outputs afterwards.
+  static std::vector<XLATensor> while_loop(
+      const std::vector<XLATensor>& operands, xla::int64 scope,
+      const XLATensor& condition, const std::vector<XLATensor>& body_outputs);
+
  private:
   struct SyncTensorCollection {
+    // The indices of the tensors to sync, in the canonical order of the graph
+    // roots (see CollectSyncTensors()).
     std::vector<size_t> indices;
     size_t hash = 0;
     std::vector<xla::util::ExceptionCleanup> unlocker;
+    // In pipelined sync mode, the device locks are only reserved, and these
+    // must be called to wait for them, before using the device data.
+    std::vector<std::function<void()>> waiters;
+    // The (parameter index, output index) pairs of the device data buffers
+    // which are donated to the computation outputs.
+    std::vector<std::pair<size_t, size_t>> buffer_aliases;
+    // The device data feeding the computation parameters, in parameter order.
+    std::vector<xla::ComputationClient::DataPtr> parameters_data;
+    // The specialization on the invariant inputs the graph is lowered with, if
+    // any, and the device data it folds as constants.
+    std::shared_ptr<const GraphSpecializer::Specialization> specialization;
+    std::vector<xla::ComputationClient::DataPtr> constant_data;
   };
 
   struct CachedComputation {
@@ -916,7 +1383,35 @@ class XLATensor {
     size_t num_parameters;
   };
 
-  using ComputationCache = xla::util::Cache<size_t, CachedComputation>;
+  using ComputationCache =
+      xla::util::ShardedCache<size_t, CachedComputation>;
+
+  // A graph compiled as a chain of computations over consecutive segments of
+  // its post-order, which run back to back with ExecuteChained().
+  struct PartitionedComputation {
+    struct Input {
+      // The segment producing the input, or -1 for the graph parameters.
+      int segment;
+      // The output index within the producing segment, or the parameter index.
+      size_t index;
+    };
+
+    struct Segment {
+      std::shared_ptr<xla::ComputationClient::Computation> computation;
+      std::vector<Input> inputs;
+      // The (chained result index, output index) pairs of the segment outputs
+      // which are values of the synced tensors.
+      std::vector<std::pair<size_t, size_t>> results;
+    };
+
+    std::vector<Segment> segments;
+    // The chained result index of every synced tensor, in coll.indices order.
+    std::vector<size_t> results;
+    size_t num_parameters = 0;
+  };
+
+  using PartitionedComputationCache =
+      xla::util::Cache<size_t, PartitionedComputation>;
 
   struct Async {
     Async(SyncTensorCollection* coll,
@@ -928,8 +1423,13 @@ class XLATensor {
     xla::util::MultiWait mwait;
     std::vector<size_t> indices;
     std::vector<xla::util::ExceptionCleanup> unlocker;
+    std::vector<std::function<void()>> waiters;
     std::vector<xla::ComputationClient::DataPtr> parameters_data;
     std::string device;
+    // The graph hash, which is the key of the cached computation.
+    size_t hash;
+    // The priority class of the thread which scheduled the sync.
+    ExecutionScheduler::Priority priority;
     ComputationCache::TypePtr cached_computation;
     std::vector<xla::ComputationClient::DataPtr> tensors_data;
   };
@@ -941,6 +1441,13 @@ class XLATensor {
     // Whether when setting the XLA data, the other properties of the tensor
     // state should be reset.
     bool sync_xla_data = true;
+    // Whether the device data of the synced tensors, which is not referenced
+    // anymore once the sync completes, can be donated to the computation
+    // outputs. This is only safe when all the live tensors are being synced.
+    bool donate_buffers = false;
+    // The unique IDs of the device data still referenced by the IR of tensors
+    // which are not synced, and which therefore must not be donated.
+    std::unordered_set<xla::int64> retained_data_ids;
   };
 
   // This is the core XLA tensor data structure where all the tensor data is
@@ -981,6 +1488,13 @@ class XLATensor {
     const Device device;
     const xla::int64 unique_id = 0;
     size_t generation = 1;
+    // The unique ID of the device data which was held by the tensor before the
+    // current IR value was set, or zero.
+    xla::int64 donor_data_id = 0;
+    // The compression error feedback of the cross replica sums of the tensor.
+    std::unique_ptr<XLATensor> crs_residual;
+    c10::optional<xla::MemoryTracker::Category> memory_category;
+    bool materialize = true;
   };
 
   XLATensor(const at::Tensor& tensor, const Device& device);
@@ -1004,6 +1518,15 @@ class XLATensor {
 
   void SetIrValue(ir::Value ir_value);
 
+  // Registers the tensor as one which may need a sync, see
+  // GetPendingTensors().
+  void MarkPending() const;
+
+  // Records the use of the host copy of the tensor, which can be dropped when
+  // the tensor holds a device data as well, and the host copies exceed their
+  // budget.
+  void RetainHostCopy() const;
+
   void AssignIrValue(ir::Value ir_value) const;
 
   void SetTensorData(at::Tensor tensor_data);
@@ -1017,6 +1540,8 @@ class XLATensor {
   std::shared_ptr<View> CreateView(ViewInfo view_info) const;
   XLATensor CreateViewTensor(ViewInfo view_info) const;
 
+  // Copies the tensor data to device, asynchronously and within the servers,
+  // when the two devices have the same hardware type.
   XLATensor CopyTensorToDevice(const Device& device);
 
   // Create a new XLA tensor with the same metadata of the input tensor (with
@@ -1040,16 +1565,37 @@ class XLATensor {
   //     a = a + b
   void TryLimitGraphSize();
 
+  // Implements TryLimitGraphSize() with trim points which are stable across
+  // steps (TRIM_GRAPH_STABLE_CUTS).
+  void TryLimitGraphSizeStable(size_t check_frequency, size_t max_graph_size);
+
   std::vector<XLATensor> MakeOutputTensors(ir::NodePtr node) const;
 
   static ir::Value GetIrValueForTensor(const at::Tensor& tensor,
                                        const Device& device);
 
+  static ComputationCache* CreateComputationCache();
+
   static ComputationCache* GetComputationCache();
 
+  static PartitionedComputationCache* GetPartitionedComputationCache();
+
   static SyncTensorCollection CollectSyncTensors(
       const std::vector<XLATensor>& tensors, const SyncTensorsConfig& config);
 
+  // Collects the device data the graph of the synced tensors reads, which feed
+  // the computation parameters, and mixes the mapping of the graph device data
+  // nodes to the parameters into the graph hash. Device data nodes holding the
+  // same buffer share a parameter, so the same graph can map to computations
+  // with a different number of parameters.
+  static void CollectParametersData(const std::vector<XLATensor>& tensors,
+                                    SyncTensorCollection* coll);
+
+  // Switches the sync to the computation specialized on its invariant inputs,
+  // if the GraphSpecializer has one. The folded device data is removed from
+  // the parameters, and the buffer aliases are renumbered accordingly.
+  static void ApplyGraphSpecialization(SyncTensorCollection* coll);
+
   // Implementation of the GetTensors() API using the op-by-op executor.
   static std::vector<at::Tensor> GetTensorsOpByOp(
       std::vector<XLATensor>* tensors);
@@ -1057,6 +1603,44 @@ class XLATensor {
   static std::vector<at::Tensor> GetTensorsFused(
       std::vector<XLATensor>* tensors);
 
+  // The intermediate results of the graph synced by a GetTensors(), which are
+  // also used by the IR of the other pending tensors of the device.
+  struct SharedOutputs {
+    // Maps the shared outputs to the indices of the synced tensors computing
+    // them.
+    ir::OutputMap<size_t> outputs;
+    // The pending tensors which are not synced, and the post order of their
+    // graphs, excluding the synced nodes.
+    std::vector<XLATensor> users;
+    std::vector<const ir::Node*> post_order;
+  };
+
+  // Collects the shared outputs of the graph of the tensors, appending to them
+  // the temporary tensors which compute the ones not fetched already.
+  static SharedOutputs CollectSharedOutputs(std::vector<XLATensor>* tensors);
+
+  // Rewrites the IR of the tensors, whose graphs nodes are within the
+  // post-order, to use the replacement values in place of the given outputs.
+  // Returns the number of tensors rewritten.
+  static size_t ReplaceIrOutputs(
+      const std::vector<XLATensor>& tensors,
+      tensorflow::gtl::ArraySlice<const ir::Node* const> post_order,
+      const ir::OutputMap<ir::Value>& replacements);
+
+  // Rewrites the IR of the users of the shared outputs, to read the device data
+  // computed for them by the sync.
+  static void ReplaceSharedOutputs(const SharedOutputs& shared,
+                                   const Async& async);
+
+  // While the estimated peak memory of the graph of the tensors to sync exceeds
+  // the XLA_GRAPH_MEMORY_BUDGET, syncs first a prefix of its post-order which
+  // fits it, and rewrites the rest of the graph to read the results live
+  // across the cut as device data. The cut is placed where the fewest bytes
+  // are live.
+  static void TrySplitGraphByMemory(
+      std::vector<XLATensor>* tensors,
+      tensorflow::gtl::ArraySlice<const std::string> devices);
+
   // Runs an asynchronous syn operation using the op-by-op executor.
   using OpByOpAsync = xla::util::AsyncTask<xla::Status>;
   static OpByOpAsync SyncTensorsGraphOpByOp(
@@ -1072,6 +1656,21 @@ class XLATensor {
       tensorflow::gtl::ArraySlice<const xla::ComputationClient::DataPtr>
           tensors_data);
 
+  // Returns the at::Tensor values of the input tensors, using their current
+  // tensor data if available, or fetching their XLA data, as returned by
+  // GatherTensorsXlaData(), from the device.
+  static std::vector<at::Tensor> FetchTensors(
+      const std::vector<XLATensor>& tensors,
+      tensorflow::gtl::ArraySlice<const xla::ComputationClient::DataPtr>
+          tensors_data);
+
+  // Runs the async computation on all the replication devices, feeding every
+  // replica with its own data for the parameters, and returns the results of
+  // the master replica. The results of the other replicas are recorded within
+  // the ReplicatedData.
+  static std::vector<xla::ComputationClient::DataPtr> ExecuteReplicatedSync(
+      Async* async);
+
   // Schedules the execution of a sync tensors operation in background. The
   // asynchronous operation will hold the device locks by capturing the ones
   // present within the coll structure.
@@ -1081,15 +1680,110 @@ class XLATensor {
       std::vector<xla::ComputationClient::DataPtr> parameters_data,
       std::string device, ComputationCache::TypePtr cached_computation);
 
+  // Installs the device data placeholders of the tensors the async operation
+  // is going to sync.
+  static void PrepareSyncTensorsData(std::vector<XLATensor>* tensors,
+                                     const SyncTensorsConfig& config,
+                                     Async* async);
+
+  // Assigns the computation results to the device data of the synced tensors.
+  static void AssignSyncResults(
+      std::vector<xla::ComputationClient::DataPtr> results, Async* async);
+
+  // Propagates the error of a failed sync to the device locks and to the
+  // device data of the synced tensors.
+  static void SetSyncError(std::exception_ptr exptr, Async* async);
+
+  // Schedules the execution of a sync tensors operation in background, using
+  // the given function to compute the results for the async->indices tensors.
+  using AsyncExecuteFn =
+      std::function<std::vector<xla::ComputationClient::DataPtr>(Async*)>;
+  static std::shared_ptr<Async> ScheduleSyncTensorsGraph(
+      std::vector<XLATensor>* tensors, const SyncTensorsConfig& config,
+      std::shared_ptr<Async> async, AsyncExecuteFn execute_fn);
+
+  static void SyncTensorsGraph(
+      std::vector<XLATensor>* tensors,
+      tensorflow::gtl::ArraySlice<const std::string> devices, bool wait,
+      const SyncTensorsConfig& config);
+
+  // Finds the parameters of the graph whose device data was held by one of the
+  // tensors being synced, and is not referenced by anything other than the
+  // graph itself (or listed in retained_data_ids). Those can be aliased with
+  // the tensors outputs.
+  static std::vector<std::pair<size_t, size_t>> ComputeBufferAliases(
+      const std::vector<XLATensor>& tensors, const SyncTensorCollection& coll,
+      const std::unordered_set<xla::int64>& retained_data_ids);
+
+  // Removes from the live tensors to be synced the ones whose pending IR value
+  // should not become a graph output: the ones not to be materialized, and,
+  // with XLA_PRUNE_INTERNAL_OUTPUTS, the ones whose IR value is only consumed
+  // by the IR of the other synced tensors. Returns the unique IDs of the device
+  // data referenced by the IR of the removed tensors.
+  static std::unordered_set<xla::int64> PruneSyncTensors(
+      std::vector<XLATensor>* tensors);
+
+  // Lowers the IR graphs of the tensors selected by coll, adding their values
+  // as results of the returned computation.
+  static xla::XlaComputation LowerSyncTensorsGraph(
+      const std::vector<XLATensor>& tensors, const SyncTensorCollection& coll,
+      ir::LoweringContext* lowering_ctx);
+
+  // Triggers a background compilation of the graph (unless one is already in
+  // flight for the same hash), and schedules the sync of the tensors using the
+  // op-by-op executor.
+  static std::shared_ptr<Async> ScheduleAsyncCompile(
+      std::vector<XLATensor>* tensors,
+      tensorflow::gtl::ArraySlice<const std::string> devices,
+      const SyncTensorsConfig& config, SyncTensorCollection* coll);
+
+  // Collects the parameters of the graph selected by coll, with their buffer
+  // aliases and specialization, completing the graph hash.
+  static void PrepareSyncParameters(const std::vector<XLATensor>& tensors,
+                                    const SyncTensorsConfig& config,
+                                    SyncTensorCollection* coll);
+
+  // Returns the cached computation of the graph selected by coll, if any.
+  static ComputationCache::TypePtr LookupCachedComputation(
+      const SyncTensorCollection& coll);
+
+  // Accounts a computation cache miss of the graph selected by coll.
+  static void RecordCacheMiss(const std::vector<XLATensor>& tensors,
+                              const SyncTensorCollection& coll);
+
   static std::shared_ptr<Async> TryRunCachedSync(
       std::vector<XLATensor>* tensors, const SyncTensorsConfig& config,
       SyncTensorCollection* coll);
 
+  // Lowers the graph selected by coll, if it has more nodes than
+  // XLA_GRAPH_COMPILE_MAX_NODES, as a chain of computations over segments of
+  // its post-order, cut where the fewest bytes are live, and compiles them with
+  // a single Compile() call. Returns nullptr for the smaller graphs.
+  static std::shared_ptr<PartitionedComputation> PartitionSyncTensorsGraph(
+      const std::vector<XLATensor>& tensors, const SyncTensorCollection& coll,
+      const Device& device,
+      tensorflow::gtl::ArraySlice<const std::string> devices);
+
+  // Schedules the sync of the tensors selected by coll, running the segments
+  // of the partitioned computation with a single ExecuteChained() call.
+  static std::shared_ptr<Async> SchedulePartitionedSync(
+      std::vector<XLATensor>* tensors, const SyncTensorsConfig& config,
+      SyncTensorCollection* coll,
+      std::shared_ptr<PartitionedComputation> partitioned, std::string device);
+
   static std::shared_ptr<Async> SyncTensorsGraphInternal(
       std::vector<XLATensor>* tensors,
       tensorflow::gtl::ArraySlice<const std::string> devices,
       const SyncTensorsConfig& config);
 
+  // Syncs tensors living on several devices, collecting the graphs of all the
+  // devices first, compiling the cache misses with a single Compile() call,
+  // and running all the graphs with a single ExecuteParallel() call.
+  static std::vector<std::shared_ptr<Async>> SyncTensorsGraphParallel(
+      std::vector<XLATensor>* tensors,
+      tensorflow::gtl::ArraySlice<const std::string> devices,
+      const SyncTensorsConfig& config);
+
   static ir::Value CreateTensorNode(xla::ComputationClient::DataPtr data);
 
   static xla::int64 GetNextTensorId();
@@ -4,8 +4,11 @@
 #include <c10/core/impl/DeviceGuardImplInterface.h>
 #include <c10/macros/Macros.h>
 
+#include <vector>
+
 #include "tensorflow/compiler/xla/xla_client/computation_client.h"
 #include "tensorflow/compiler/xla/xla_client/debug_macros.h"
+#include "tensorflow/compiler/xla/xla_client/sys_util.h"
 #include "torch_xla/csrc/aten_xla_bridge.h"
 #include "torch_xla/csrc/layout_manager.h"
 #include "torch_xla/csrc/tensor_util.h"
@@ -48,8 +51,65 @@ struct XLAGuardImpl : public c10::impl::DeviceGuardImplInterface {
 
 C10_REGISTER_GUARD_IMPL(XLA, XLAGuardImpl);
 
+// The free list of the XLATensorImpl blocks released by a thread. Blocks are
+// returned to the list of the thread releasing them, which might not be the
+// one which allocated them.
+class ImplFreeList {
+ public:
+  ~ImplFreeList();
+
+  void* Allocate() {
+    if (blocks_.empty()) {
+      return ::operator new(sizeof(XLATensorImpl));
+    }
+    void* block = blocks_.back();
+    blocks_.pop_back();
+    return block;
+  }
+
+  void Release(void* block) {
+    static const size_t max_blocks =
+        xla::sys_util::GetEnvInt("XLA_TENSOR_IMPL_POOL_SIZE", 1024);
+    if (blocks_.size() < max_blocks) {
+      blocks_.push_back(block);
+    } else {
+      ::operator delete(block);
+    }
+  }
+
+ private:
+  std::vector<void*> blocks_;
+};
+
+// Tensors can still be released by the destructors of other thread local
+// objects, after the free list of the thread is gone.
+thread_local bool g_impl_free_list_destroyed = false;
+thread_local ImplFreeList g_impl_free_list;
+
+ImplFreeList::~ImplFreeList() {
+  g_impl_free_list_destroyed = true;
+  for (void* block : blocks_) {
+    ::operator delete(block);
+  }
+}
+
 }  // namespace
 
+void* XLATensorImpl::operator new(size_t size) {
+  // Classes deriving from XLATensorImpl get the plain allocation.
+  return size == sizeof(XLATensorImpl) && !g_impl_free_list_destroyed
+             ? g_impl_free_list.Allocate()
+             : ::operator new(size);
+}
+
+void XLATensorImpl::operator delete(void* ptr, size_t size) {
+  if (size == sizeof(XLATensorImpl) && !g_impl_free_list_destroyed) {
+    g_impl_free_list.Release(ptr);
+  } else {
+    ::operator delete(ptr);
+  }
+}
+
 XLATensorImpl::XLATensorImpl(XLATensor tensor)
     : c10::TensorImpl(c10::XLATensorId(), GetTypeMeta(tensor),
                       bridge::XlaDeviceToAtenDevice(tensor.GetDevice())),
@@ -14,6 +14,13 @@ class XLATensorImpl : public c10::TensorImpl {
  public:
   explicit XLATensorImpl(XLATensor tensor);
 
+  // Every operation creates an XLATensorImpl for its result, and drops the ones
+  // of its temporary inputs, so their memory is recycled through per thread
+  // free lists.
+  static void* operator new(size_t size);
+
+  static void operator delete(void* ptr, size_t size);
+
   XLATensor& tensor() { return tensor_; }
 
   c10::intrusive_ptr<TensorImpl> shallow_copy_and_detach(
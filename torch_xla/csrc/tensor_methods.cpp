@@ -1,36 +1,48 @@
 #include <algorithm>
 #include <functional>
+#include <map>
 
 #include "absl/strings/str_cat.h"
 #include "absl/strings/str_split.h"
 #include "tensorflow/compiler/xla/literal_util.h"
 #include "tensorflow/compiler/xla/xla_client/debug_macros.h"
 #include "tensorflow/compiler/xla/xla_client/metrics.h"
+#include "tensorflow/compiler/xla/xla_client/sys_util.h"
+#include "tensorflow/compiler/xla/xla_client/unique.h"
 #include "tensorflow/compiler/xla/xla_client/util.h"
 #include "tensorflow/compiler/xla/xla_client/xla_util.h"
 #include "torch/csrc/autograd/variable.h"
+#include "torch_xla/csrc/attention.h"
 #include "torch_xla/csrc/data_ops.h"
 #include "torch_xla/csrc/helpers.h"
 #include "torch_xla/csrc/ir_util.h"
 #include "torch_xla/csrc/layout_manager.h"
 #include "torch_xla/csrc/lowering_context.h"
-#include "torch_xla/csrc/ops/adaptive_avg_pool2d.h"
+#include "torch_xla/csrc/ops/adaptive_avg_pool_nd.h"
+#include "torch_xla/csrc/ops/adaptive_max_pool_nd.h"
 #include "torch_xla/csrc/ops/all.h"
+#include "torch_xla/csrc/ops/all_gather.h"
+#include "torch_xla/csrc/ops/all_to_all.h"
 #include "torch_xla/csrc/ops/any.h"
 #include "torch_xla/csrc/ops/arg_max.h"
 #include "torch_xla/csrc/ops/arg_min.h"
 #include "torch_xla/csrc/ops/arithmetic_ir_ops.h"
 #include "torch_xla/csrc/ops/as_strided.h"
+#include "torch_xla/csrc/ops/attention.h"
+#include "torch_xla/csrc/ops/attention_backward.h"
 #include "torch_xla/csrc/ops/avg_pool_nd.h"
 #include "torch_xla/csrc/ops/avg_pool_nd_backward.h"
 #include "torch_xla/csrc/ops/bitwise_ir_ops.h"
 #include "torch_xla/csrc/ops/cast.h"
 #include "torch_xla/csrc/ops/cat.h"
 #include "torch_xla/csrc/ops/cholesky.h"
+#include "torch_xla/csrc/ops/collective_permute.h"
 #include "torch_xla/csrc/ops/constant.h"
 #include "torch_xla/csrc/ops/constant_pad_nd.h"
+#include "torch_xla/csrc/ops/control_flow.h"
 #include "torch_xla/csrc/ops/convolution_backward_overrideable.h"
 #include "torch_xla/csrc/ops/convolution_overrideable.h"
+#include "torch_xla/csrc/ops/cross_entropy.h"
 #include "torch_xla/csrc/ops/cross_replica_sum.h"
 #include "torch_xla/csrc/ops/cumprod.h"
 #include "torch_xla/csrc/ops/cumsum.h"
@@ -38,10 +50,15 @@
 #include "torch_xla/csrc/ops/diagonal.h"
 #include "torch_xla/csrc/ops/dropout.h"
 #include "torch_xla/csrc/ops/einsum.h"
+#include "torch_xla/csrc/ops/embedding_bag.h"
+#include "torch_xla/csrc/ops/embedding_bag_backward.h"
 #include "torch_xla/csrc/ops/expand.h"
 #include "torch_xla/csrc/ops/flip.h"
+#include "torch_xla/csrc/ops/fused_linear.h"
 #include "torch_xla/csrc/ops/gather.h"
 #include "torch_xla/csrc/ops/generic.h"
+#include "torch_xla/csrc/ops/group_norm.h"
+#include "torch_xla/csrc/ops/group_norm_backward.h"
 #include "torch_xla/csrc/ops/hardshrink.h"
 #include "torch_xla/csrc/ops/hardtanh_backward.h"
 #include "torch_xla/csrc/ops/index_ops.h"
@@ -64,10 +81,14 @@
 #include "torch_xla/csrc/ops/nll_loss_backward.h"
 #include "torch_xla/csrc/ops/not_supported.h"
 #include "torch_xla/csrc/ops/ops.h"
+#include "torch_xla/csrc/ops/optimizer_step.h"
 #include "torch_xla/csrc/ops/permute.h"
 #include "torch_xla/csrc/ops/prod.h"
 #include "torch_xla/csrc/ops/qr.h"
+#include "torch_xla/csrc/ops/quantized_convolution.h"
+#include "torch_xla/csrc/ops/quantized_linear.h"
 #include "torch_xla/csrc/ops/randperm.h"
+#include "torch_xla/csrc/ops/reduce_scatter.h"
 #include "torch_xla/csrc/ops/repeat.h"
 #include "torch_xla/csrc/ops/resize.h"
 #include "torch_xla/csrc/ops/rrelu_with_noise.h"
@@ -78,6 +99,7 @@
 #include "torch_xla/csrc/ops/shrink_backward.h"
 #include "torch_xla/csrc/ops/softmax.h"
 #include "torch_xla/csrc/ops/softshrink.h"
+#include "torch_xla/csrc/ops/sort.h"
 #include "torch_xla/csrc/ops/split.h"
 #include "torch_xla/csrc/ops/squeeze.h"
 #include "torch_xla/csrc/ops/stack.h"
@@ -91,14 +113,56 @@
 #include "torch_xla/csrc/ops/tril.h"
 #include "torch_xla/csrc/ops/triu.h"
 #include "torch_xla/csrc/ops/unsqueeze.h"
+#include "torch_xla/csrc/ops/upsample_bilinear2d.h"
+#include "torch_xla/csrc/ops/upsample_bilinear2d_backward.h"
+#include "torch_xla/csrc/ops/upsample_nearest2d.h"
+#include "torch_xla/csrc/ops/upsample_nearest2d_backward.h"
 #include "torch_xla/csrc/ops/view.h"
 #include "torch_xla/csrc/tensor.h"
 #include "torch_xla/csrc/tensor_ops.h"
 #include "torch_xla/csrc/tensor_util.h"
+#include "torch_xla/csrc/xla_lower_util.h"
 
 namespace torch_xla {
 namespace {
 
+// Returns the device of the parameters updated by an optimizer step, which
+// must all be on the same one.
+Device GetOptimizerStepDevice(const std::vector<XLATensor>& params) {
+  xla::util::Unique<Device> unique_device;
+  for (auto& param : params) {
+    unique_device.set(param.GetDevice());
+  }
+  return *unique_device;
+}
+
+// The hyperparameters of the optimizer steps are F32 scalar operands, and the
+// weight decay is left out when it is zero.
+ir::Value GetOptimizerScalar(double value, const Device& device) {
+  return XLATensor::GetIrValueForScalar(value, xla::PrimitiveType::F32,
+                                        device);
+}
+
+std::vector<ir::Value> GetTensorsIrValues(
+    const std::vector<XLATensor>& tensors) {
+  std::vector<ir::Value> values;
+  values.reserve(tensors.size());
+  for (auto& tensor : tensors) {
+    values.push_back(tensor.GetIrValue());
+  }
+  return values;
+}
+
+// Sets the outputs of the optimizer step node, starting at the given index,
+// as the new values of the tensors. Returns the index past the last output.
+size_t SetOptimizerStepOutputs(const ir::NodePtr& node, size_t index,
+                               std::vector<XLATensor>& tensors) {
+  for (auto& tensor : tensors) {
+    tensor.SetIrValue(ir::Value(node, index++));
+  }
+  return index;
+}
+
 struct MinMaxValues {
   ir::Value min;
   ir::Value max;
@@ -184,6 +248,26 @@ xla::Shape BatchNormFeaturesShape(const XLATensor& input) {
   return xla::ShapeUtil::MakeShape(input_element_type, {input.size(1)});
 }
 
+// Checks the group norm parameters, and returns the shape of its weight and
+// bias, made of the affine_dims input dimensions.
+xla::Shape GroupNormAffineShape(
+    const XLATensor& input,
+    tensorflow::gtl::ArraySlice<const xla::int64> affine_dims,
+    xla::int64 num_groups) {
+  xla::int64 numel = xla::ShapeUtil::ElementsIn(input.shape());
+  XLA_CHECK(num_groups > 0 && numel % num_groups == 0)
+      << "Invalid number of normalization groups " << num_groups
+      << " for an input of " << numel << " elements";
+  std::vector<xla::int64> dimensions;
+  for (auto dim : affine_dims) {
+    XLA_CHECK(dim >= 0 && dim < input.shape().get().rank())
+        << "Invalid affine dimension " << dim;
+    dimensions.push_back(input.size(dim));
+  }
+  return xla::ShapeUtil::MakeShape(
+      MakeXlaPrimitiveType(input.dtype(), &input.GetDevice()), dimensions);
+}
+
 // Returns the IR for the given input or the provided default value broadcasted
 // to the default shape, if the input is undefined.
 ir::Value GetIrValueOrDefault(const XLATensor& input, at::Scalar default_value,
@@ -206,10 +290,11 @@ void CheckIsIntegralOrPred(const xla::Shape& shape,
 ViewInfo CreateAsStridedViewInfo(
     const xla::Shape& input_shape,
     tensorflow::gtl::ArraySlice<const xla::int64> size,
-    c10::optional<xla::int64> storage_offset) {
+    std::vector<xla::int64> stride, c10::optional<xla::int64> storage_offset) {
   xla::Shape result_shape =
       xla::ShapeUtil::MakeShape(input_shape.element_type(), size);
   AsStridedInfo as_strided_info;
+  as_strided_info.stride = std::move(stride);
   if (storage_offset) {
     as_strided_info.offset = *storage_offset;
   }
@@ -218,6 +303,60 @@ ViewInfo CreateAsStridedViewInfo(
                   std::move(as_strided_info));
 }
 
+// Returns the LogSoftmax node producing the given value, if its consumers can
+// be rewritten in terms of its input (XLA_FUSE_LOG_SOFTMAX).
+const ir::ops::LogSoftmax* GetFusableLogSoftmax(const ir::Value& value) {
+  static const bool fuse_log_softmax =
+      xla::sys_util::GetEnvBool("XLA_FUSE_LOG_SOFTMAX", true);
+  if (!fuse_log_softmax) {
+    return nullptr;
+  }
+  const ir::ops::LogSoftmax* log_softmax =
+      dynamic_cast<const ir::ops::LogSoftmax*>(value.node.get());
+  // A type casting LogSoftmax does not produce the same type of its input.
+  return log_softmax != nullptr && !log_softmax->dtype() ? log_softmax
+                                                         : nullptr;
+}
+
+bool FuseLinearEpilogues() {
+  static const bool fuse_linear_epilogues =
+      xla::sys_util::GetEnvBool("XLA_FUSE_LINEAR_EPILOGUE", true);
+  return fuse_linear_epilogues;
+}
+
+// Returns the value of the activation applied to the given value, folded into
+// the un-activated FusedLinear node producing it, or the value computed by
+// activation_fn if there is no such node.
+ir::Value ApplyLinearEpilogue(
+    const ir::Value& value, ir::ops::FusedLinear::Activation activation,
+    const std::function<ir::NodePtr(const ir::Value&)>& activation_fn) {
+  const ir::ops::FusedLinear* fused_linear =
+      dynamic_cast<const ir::ops::FusedLinear*>(value.node.get());
+  if (fused_linear != nullptr &&
+      fused_linear->activation() == ir::ops::FusedLinear::Activation::kNone) {
+    XLA_COUNTER("FusedLinearEpilogues", 1);
+    return fused_linear->WithActivation(activation);
+  }
+  return activation_fn(value);
+}
+
+// Returns the bias of a recurrent layer, or zeros if it is missing.
+ir::Value GetRnnBias(const XLATensor& bias, const XLATensor& w_ih) {
+  xla::Shape weight_shape = w_ih.shape();
+  xla::Shape bias_shape = xla::ShapeUtil::MakeShape(
+      weight_shape.element_type(), {weight_shape.dimensions(0)});
+  return GetIrValueOrDefault(bias, 0, bias_shape, w_ih.GetDevice());
+}
+
+std::vector<XLATensor> CreateNodeOutputs(const XLATensor& input,
+                                         const ir::NodePtr& node) {
+  std::vector<XLATensor> results;
+  for (size_t i = 0; i < node->num_outputs(); ++i) {
+    results.push_back(input.CreateFrom(ir::Value(node, i)));
+  }
+  return results;
+}
+
 }  // namespace
 
 XLATensor XLATensor::__and__(const XLATensor& input, at::Scalar other) {
@@ -338,18 +477,6 @@ XLATensor XLATensor::__xor__(const XLATensor& input, const XLATensor& other) {
       ir::ops::BitwiseXor(input.GetIrValue(), other.GetIrValue()));
 }
 
-XLATensor XLATensor::_adaptive_avg_pool2d(const XLATensor& input,
-                                          std::vector<xla::int64> output_size) {
-  return input.CreateFrom(ir::MakeNode<ir::ops::AdaptiveAvgPool2d>(
-      input.GetIrValue(), std::move(output_size)));
-}
-
-XLATensor XLATensor::_adaptive_avg_pool2d_backward(const XLATensor& grad_output,
-                                                   const XLATensor& input) {
-  return input.CreateFrom(ir::ops::AdaptiveAvgPool2dBackward(
-      grad_output.GetIrValue(), input.GetIrValue()));
-}
-
 XLATensor XLATensor::abs(const XLATensor& input) {
   return input.CreateFrom(ir::ops::Abs(input.GetIrValue()));
 }
@@ -366,6 +493,63 @@ void XLATensor::acos_(XLATensor& input) {
   input.SetIrValue(ir::ops::Acos(input.GetIrValue()));
 }
 
+void XLATensor::adam_step_(std::vector<XLATensor>& params,
+                           const std::vector<XLATensor>& grads,
+                           std::vector<XLATensor>& exp_avgs,
+                           std::vector<XLATensor>& exp_avg_sqs,
+                           std::vector<XLATensor>& max_exp_avg_sqs,
+                           double step_size, double beta1, double beta2,
+                           double eps, double weight_decay) {
+  if (params.empty()) {
+    return;
+  }
+  Device device = GetOptimizerStepDevice(params);
+  ir::NodePtr node = ir::MakeNode<ir::ops::AdamStep>(
+      GetTensorsIrValues(params), GetTensorsIrValues(grads),
+      GetTensorsIrValues(exp_avgs), GetTensorsIrValues(exp_avg_sqs),
+      GetTensorsIrValues(max_exp_avg_sqs),
+      GetOptimizerScalar(step_size, device), GetOptimizerScalar(beta1, device),
+      GetOptimizerScalar(beta2, device), GetOptimizerScalar(eps, device),
+      weight_decay != 0 ? GetOptimizerScalar(weight_decay, device)
+                        : ir::Value());
+  size_t index = SetOptimizerStepOutputs(node, 0, params);
+  index = SetOptimizerStepOutputs(node, index, exp_avgs);
+  index = SetOptimizerStepOutputs(node, index, exp_avg_sqs);
+  SetOptimizerStepOutputs(node, index, max_exp_avg_sqs);
+}
+
+XLATensor XLATensor::adaptive_avg_pool_nd(const XLATensor& input,
+                                          xla::int64 spatial_dim_count,
+                                          std::vector<xla::int64> output_size) {
+  return input.CreateFrom(ir::MakeNode<ir::ops::AdaptiveAvgPoolNd>(
+      input.GetIrValue(), spatial_dim_count, std::move(output_size)));
+}
+
+XLATensor XLATensor::adaptive_avg_pool_nd_backward(
+    const XLATensor& grad_output, const XLATensor& input,
+    xla::int64 spatial_dim_count) {
+  return input.CreateFrom(ir::ops::AdaptiveAvgPoolNdBackward(
+      grad_output.GetIrValue(), input.GetIrValue(), spatial_dim_count));
+}
+
+std::tuple<XLATensor, XLATensor> XLATensor::adaptive_max_pool_nd(
+    const XLATensor& input, xla::int64 spatial_dim_count,
+    std::vector<xla::int64> output_size) {
+  ir::NodePtr node = ir::MakeNode<ir::ops::AdaptiveMaxPoolNd>(
+      input.GetIrValue(), spatial_dim_count, std::move(output_size));
+  return std::make_tuple(
+      input.CreateFrom(ir::Value(node, 0)),
+      input.CreateFrom(ir::Value(node, 1), at::ScalarType::Long));
+}
+
+XLATensor XLATensor::adaptive_max_pool_nd_backward(
+    const XLATensor& grad_output, const XLATensor& input,
+    const XLATensor& indices, xla::int64 spatial_dim_count) {
+  return input.CreateFrom(ir::ops::AdaptiveMaxPoolNdBackward(
+      grad_output.GetIrValue(), input.GetIrValue(), indices.GetIrValue(),
+      spatial_dim_count));
+}
+
 XLATensor XLATensor::add(const XLATensor& input, const XLATensor& other,
                          at::Scalar alpha) {
   ir::Value constant =
@@ -433,6 +617,12 @@ XLATensor XLATensor::addcmul(const XLATensor& input, at::Scalar value,
 
 XLATensor XLATensor::addmm(const XLATensor& input, const XLATensor& weight,
                            const XLATensor& bias) {
+  if (FuseLinearEpilogues()) {
+    return input.CreateFrom(ir::MakeNode<ir::ops::FusedLinear>(
+        input.GetIrValue(), weight.GetIrValue(), bias.GetIrValue(),
+        ir::ops::FusedLinear::Activation::kNone,
+        XlaHelpers::mat_mul_precision(), XlaHelpers::mixed_precision()));
+  }
   return input.CreateFrom(ir::ops::AddMatMulOp(
       input.GetIrValue(), weight.GetIrValue(), bias.GetIrValue()));
 }
@@ -447,6 +637,37 @@ XLATensor XLATensor::all(const XLATensor& input,
                                  keep_reduced_dimensions));
 }
 
+XLATensor XLATensor::all_gather(
+    const XLATensor& input, xla::int64 dim, xla::int64 shard_count,
+    const std::vector<std::vector<xla::int64>>& groups) {
+  return input.CreateFrom(ir::MakeNode<ir::ops::AllGather>(
+      input.GetIrValue(),
+      XlaHelpers::GetCanonicalDimensionIndex(dim, input.shape().get().rank()),
+      shard_count, groups));
+}
+
+XLATensor XLATensor::all_to_all(
+    const XLATensor& input, xla::int64 split_dimension,
+    xla::int64 concat_dimension, xla::int64 split_count,
+    const std::vector<std::vector<xla::int64>>& groups) {
+  xla::int64 rank = input.shape().get().rank();
+  return input.CreateFrom(ir::MakeNode<ir::ops::AllToAll>(
+      input.GetIrValue(),
+      XlaHelpers::GetCanonicalDimensionIndex(split_dimension, rank),
+      XlaHelpers::GetCanonicalDimensionIndex(concat_dimension, rank),
+      split_count, groups));
+}
+
+XLATensor XLATensor::amp_unscale_(std::vector<XLATensor>& grads,
+                                  const XLATensor& loss_scale) {
+  XLA_CHECK(!grads.empty());
+  Device device = GetOptimizerStepDevice(grads);
+  ir::NodePtr node = ir::MakeNode<ir::ops::AmpUnscale>(
+      GetTensorsIrValues(grads), loss_scale.GetIrValue());
+  size_t index = SetOptimizerStepOutputs(node, 0, grads);
+  return Create(ir::Value(node, index), device, at::ScalarType::Float);
+}
+
 XLATensor XLATensor::any(const XLATensor& input,
                          std::vector<xla::int64> dimensions,
                          bool keep_reduced_dimensions) {
@@ -495,21 +716,24 @@ XLATensor XLATensor::argmin(const XLATensor& input) {
 
 XLATensor XLATensor::as_strided(const XLATensor& input,
                                 std::vector<xla::int64> size,
+                                std::vector<xla::int64> stride,
                                 c10::optional<xla::int64> storage_offset) {
   auto input_shape = input.shape();
-  return input.CreateViewTensor(
-      CreateAsStridedViewInfo(input_shape, size, storage_offset));
+  return input.CreateViewTensor(CreateAsStridedViewInfo(
+      input_shape, size, std::move(stride), storage_offset));
 }
 
 void XLATensor::as_strided_(XLATensor& input, std::vector<xla::int64> size,
+                            std::vector<xla::int64> stride,
                             c10::optional<xla::int64> storage_offset) {
   if (input.data()->view == nullptr) {
     input.SetIrValue(ir::MakeNode<ir::ops::AsStrided>(
-        input.GetIrValue(), std::move(size), storage_offset.value_or(0)));
+        input.GetIrValue(), std::move(size), std::move(stride),
+        storage_offset.value_or(0)));
   } else {
     auto input_shape = input.shape();
-    input.SetSubView(
-        CreateAsStridedViewInfo(input_shape, size, storage_offset));
+    input.SetSubView(CreateAsStridedViewInfo(
+        input_shape, size, std::move(stride), storage_offset));
   }
 }
 
@@ -538,6 +762,39 @@ void XLATensor::atan2_(XLATensor& input, const XLATensor& other) {
   input.SetIrValue(ir::ops::Atan2(input.GetIrValue(), other.GetIrValue()));
 }
 
+std::tuple<XLATensor, XLATensor> XLATensor::attention(const XLATensor& query,
+                                                      const XLATensor& key,
+                                                      const XLATensor& value,
+                                                      const XLATensor& mask,
+                                                      double scale) {
+  xla::Shape mask_shape =
+      xla::ShapeUtil::MakeShape(query.shape().get().element_type(), {});
+  ir::Value mask_value =
+      GetIrValueOrDefault(mask, 0, mask_shape, query.GetDevice());
+  ir::NodePtr node = ir::MakeNode<ir::ops::Attention>(
+      query.GetIrValue(), key.GetIrValue(), value.GetIrValue(), mask_value,
+      scale, AttentionBlockSize());
+  return std::make_tuple(query.CreateFrom(ir::Value(node, 0)),
+                         query.CreateFrom(ir::Value(node, 1)));
+}
+
+std::tuple<XLATensor, XLATensor, XLATensor> XLATensor::attention_backward(
+    const XLATensor& grad_output, const XLATensor& query, const XLATensor& key,
+    const XLATensor& value, const XLATensor& mask, const XLATensor& output,
+    const XLATensor& logsumexp, double scale) {
+  xla::Shape mask_shape =
+      xla::ShapeUtil::MakeShape(query.shape().get().element_type(), {});
+  ir::Value mask_value =
+      GetIrValueOrDefault(mask, 0, mask_shape, query.GetDevice());
+  ir::NodePtr node = ir::MakeNode<ir::ops::AttentionBackward>(
+      grad_output.GetIrValue(), query.GetIrValue(), key.GetIrValue(),
+      value.GetIrValue(), mask_value, output.GetIrValue(),
+      logsumexp.GetIrValue(), scale, AttentionBlockSize());
+  return std::make_tuple(query.CreateFrom(ir::Value(node, 0)),
+                         key.CreateFrom(ir::Value(node, 1)),
+                         value.CreateFrom(ir::Value(node, 2)));
+}
+
 XLATensor XLATensor::avg_pool_nd(const XLATensor& input,
                                  xla::int64 spatial_dim_count,
                                  std::vector<xla::int64> kernel_size,
@@ -569,23 +826,26 @@ XLATensor XLATensor::avg_pool_nd_backward(
 XLATensor XLATensor::bernoulli(const XLATensor& input, double probability) {
   return input.CreateFrom(ir::ops::Bernoulli(
       input.GetIrValue(),
-      GetIrValueForScalar(probability, input.shape(), input.GetDevice())));
+      GetIrValueForScalar(probability, input.shape(), input.GetDevice()),
+      GetRngSeed(input.GetDevice())));
 }
 
 XLATensor XLATensor::bernoulli(const XLATensor& input) {
-  return input.CreateFrom(
-      ir::ops::Bernoulli(input.GetIrValue(), input.GetIrValue()));
+  return input.CreateFrom(ir::ops::Bernoulli(
+      input.GetIrValue(), input.GetIrValue(), GetRngSeed(input.GetDevice())));
 }
 
 void XLATensor::bernoulli_(XLATensor& input, double probability) {
   input.SetIrValue(ir::ops::Bernoulli(
       input.GetIrValue(),
-      GetIrValueForScalar(probability, input.shape(), input.GetDevice())));
+      GetIrValueForScalar(probability, input.shape(), input.GetDevice()),
+      GetRngSeed(input.GetDevice())));
 }
 
 void XLATensor::bernoulli_(XLATensor& input, const XLATensor& probability) {
-  input.SetIrValue(
-      ir::ops::Bernoulli(input.GetIrValue(), probability.GetIrValue()));
+  input.SetIrValue(ir::ops::Bernoulli(input.GetIrValue(),
+                                      probability.GetIrValue(),
+                                      GetRngSeed(input.GetDevice())));
 }
 
 XLATensor XLATensor::bmm(const XLATensor& batch1, const XLATensor& batch2) {
@@ -659,10 +919,47 @@ void XLATensor::clamp_(XLATensor& input, c10::optional<at::Scalar> min,
       ir::ops::Clamp(input.GetIrValue(), min_max.min, min_max.max));
 }
 
+XLATensor XLATensor::clip_grad_norm_(std::vector<XLATensor>& grads,
+                                     double max_norm, double norm_type) {
+  XLA_CHECK(!grads.empty());
+  Device device = GetOptimizerStepDevice(grads);
+  ir::NodePtr node = ir::MakeNode<ir::ops::ClipGradNorm>(
+      GetTensorsIrValues(grads), GetOptimizerScalar(max_norm, device),
+      norm_type);
+  size_t index = SetOptimizerStepOutputs(node, 0, grads);
+  return Create(ir::Value(node, index), device, at::ScalarType::Float);
+}
+
 XLATensor XLATensor::clone(const XLATensor& input) {
   return input.CreateFrom(input.GetIrValue());
 }
 
+XLATensor XLATensor::collective_permute(
+    const XLATensor& input,
+    std::vector<std::pair<xla::int64, xla::int64>> source_target_pairs) {
+  return input.CreateFrom(ir::MakeNode<ir::ops::CollectivePermute>(
+      input.GetIrValue(), std::move(source_target_pairs)));
+}
+
+std::vector<XLATensor> XLATensor::cond(
+    const XLATensor& predicate, const std::vector<XLATensor>& operands,
+    xla::int64 scope, const std::vector<XLATensor>& true_outputs,
+    const std::vector<XLATensor>& false_outputs) {
+  std::vector<ir::Value> true_values = GetTensorsIrValues(true_outputs);
+  std::vector<ir::Value> false_values = GetTensorsIrValues(false_outputs);
+  std::vector<ir::Value> captures =
+      ir::ops::CollectSubgraphCaptures(scope, {true_values, false_values});
+  ir::NodePtr node = ir::MakeNode<ir::ops::Cond>(
+      predicate.GetIrValue(), GetTensorsIrValues(operands), captures, scope,
+      true_values, false_values, captures);
+  std::vector<XLATensor> results;
+  for (size_t i = 0; i < true_outputs.size(); ++i) {
+    results.push_back(true_outputs[i].CreateFrom(ir::Value(node, i),
+                                                 predicate.GetDevice()));
+  }
+  return results;
+}
+
 XLATensor XLATensor::constant_pad_nd(
     const XLATensor& input, tensorflow::gtl::ArraySlice<const xla::int64> pad,
     at::Scalar value) {
@@ -680,7 +977,7 @@ XLATensor XLATensor::convolution_overrideable(
   ir::NodePtr ir_value = ir::MakeNode<ir::ops::ConvolutionOverrideable>(
       input.GetIrValue(), weight.GetIrValue(), bias.GetIrValue(),
       std::move(stride), std::move(padding), std::move(dilation), transposed,
-      std::move(output_padding), groups);
+      std::move(output_padding), groups, XlaHelpers::mixed_precision());
   return input.CreateFrom(ir_value);
 }
 
@@ -692,7 +989,7 @@ XLATensor XLATensor::convolution_overrideable(
   ir::NodePtr ir_value = ir::MakeNode<ir::ops::ConvolutionOverrideable>(
       input.GetIrValue(), weight.GetIrValue(), std::move(stride),
       std::move(padding), std::move(dilation), transposed,
-      std::move(output_padding), groups);
+      std::move(output_padding), groups, XlaHelpers::mixed_precision());
   return input.CreateFrom(ir_value);
 }
 
@@ -706,7 +1003,7 @@ XLATensor::convolution_backward_overrideable(
   ir::NodePtr node = ir::MakeNode<ir::ops::ConvolutionBackwardOverrideable>(
       out_backprop.GetIrValue(), input.GetIrValue(), weight.GetIrValue(),
       std::move(stride), std::move(padding), std::move(dilation), transposed,
-      std::move(output_padding), groups);
+      std::move(output_padding), groups, XlaHelpers::mixed_precision());
   XLATensor grad_input = out_backprop.CreateFrom(ir::Value(node, 0));
   XLATensor grad_weight = out_backprop.CreateFrom(ir::Value(node, 1));
   XLATensor grad_bias = out_backprop.CreateFrom(ir::Value(node, 2));
@@ -749,6 +1046,64 @@ void XLATensor::cross_replica_sum_(
       ir::ops::CrossReplicaSumOp(input.GetIrValue(), scale, groups));
 }
 
+void XLATensor::cross_replica_sum_(
+    std::vector<XLATensor>& inputs, double scale,
+    const std::vector<std::vector<xla::int64>>& groups,
+    CrossReplicaSumCompression compression, bool error_feedback,
+    const std::vector<std::vector<xla::int64>>& host_groups) {
+  static const xla::int64 bucket_bytes =
+      xla::sys_util::GetEnvInt("XLA_CRS_BUCKET_BYTES", 32 * 1024 * 1024);
+  struct Bucket {
+    std::vector<size_t> indices;
+    xla::int64 bytes = 0;
+  };
+  auto flush_bucket = [&](Bucket* bucket) {
+    std::vector<ir::Value> values;
+    for (auto index : bucket->indices) {
+      XLATensor& input = inputs[index];
+      ir::Value value = input.GetIrValue();
+      if (error_feedback) {
+        std::unique_ptr<XLATensor>& residual = input.data()->crs_residual;
+        if (residual != nullptr) {
+          value = value + residual->GetIrValue();
+        }
+        XLATensor new_residual = input.CreateFrom(
+            ir::ops::CompressionResidual(value, compression));
+        if (residual != nullptr) {
+          residual->SetIrValue(new_residual.GetIrValue());
+        } else {
+          residual.reset(new XLATensor(std::move(new_residual)));
+        }
+      }
+      values.push_back(value);
+    }
+    ir::NodePtr node = ir::MakeNode<ir::ops::CrossReplicaSum>(
+        values, scale, groups, compression, host_groups);
+    for (size_t i = 0; i < bucket->indices.size(); ++i) {
+      inputs[bucket->indices[i]].SetIrValue(ir::Value(node, i));
+    }
+    XLA_COUNTER("CrossReplicaSumBuckets", 1);
+    bucket->indices.clear();
+    bucket->bytes = 0;
+  };
+  std::map<xla::PrimitiveType, Bucket> buckets;
+  for (size_t i = 0; i < inputs.size(); ++i) {
+    xla::Shape shape = inputs[i].shape();
+    xla::int64 bytes = xla::ShapeUtil::ByteSizeOf(shape);
+    Bucket& bucket = buckets[shape.element_type()];
+    if (!bucket.indices.empty() && bucket.bytes + bytes > bucket_bytes) {
+      flush_bucket(&bucket);
+    }
+    bucket.indices.push_back(i);
+    bucket.bytes += bytes;
+  }
+  for (auto& type_bucket : buckets) {
+    if (!type_bucket.second.indices.empty()) {
+      flush_bucket(&type_bucket.second);
+    }
+  }
+}
+
 XLATensor XLATensor::cumprod(const XLATensor& input, xla::int64 dim,
                              c10::optional<at::ScalarType> dtype) {
   xla::int64 canonical_dim =
@@ -809,12 +1164,29 @@ void XLATensor::div_(XLATensor& input, at::Scalar other) {
 }
 
 XLATensor XLATensor::dropout(const XLATensor& input, double p) {
-  return input.CreateFrom(
-      ir::MakeNode<ir::ops::Dropout>(input.GetIrValue(), p));
+  return input.CreateFrom(ir::MakeNode<ir::ops::Dropout>(
+      input.GetIrValue(), GetRngSeed(input.GetDevice()), p));
 }
 
 void XLATensor::dropout_(XLATensor& input, double p) {
-  input.SetIrValue(ir::MakeNode<ir::ops::Dropout>(input.GetIrValue(), p));
+  input.SetIrValue(ir::MakeNode<ir::ops::Dropout>(
+      input.GetIrValue(), GetRngSeed(input.GetDevice()), p));
+}
+
+std::tuple<XLATensor, XLATensor> XLATensor::packed_dropout(
+    const XLATensor& input, double p) {
+  ir::NodePtr node = ir::ops::PackedDropout(
+      input.GetIrValue(), GetRngSeed(input.GetDevice()), p);
+  return std::make_tuple(
+      input.CreateFrom(ir::Value(node, 0)),
+      input.CreateFrom(ir::Value(node, 1), at::ScalarType::Int));
+}
+
+XLATensor XLATensor::packed_dropout_backward(const XLATensor& grad_output,
+                                             const XLATensor& packed_mask,
+                                             double p) {
+  return grad_output.CreateFrom(ir::ops::PackedDropoutBackward(
+      grad_output.GetIrValue(), packed_mask.GetIrValue(), p));
 }
 
 XLATensor XLATensor::eq(const XLATensor& input, at::Scalar other) {
@@ -844,7 +1216,6 @@ XLATensor XLATensor::einsum(
   for (const auto& tensor : tensors) {
     tensor_ir_values.push_back(tensor.GetIrValue());
   }
-  XLA_CHECK_EQ(tensors.size(), 2);
   return tensors[0].CreateFrom(
       ir::MakeNode<ir::ops::Einsum>(equation, tensor_ir_values));
 }
@@ -869,6 +1240,48 @@ XLATensor XLATensor::elu_backward(const XLATensor& grad_output,
                                                      scale, input_scale));
 }
 
+std::tuple<XLATensor, XLATensor, XLATensor, XLATensor>
+XLATensor::embedding_bag(const XLATensor& weight, const XLATensor& indices,
+                         const XLATensor& offsets, xla::int64 mode,
+                         const XLATensor& per_sample_weights) {
+  xla::Shape scalar_shape =
+      xla::ShapeUtil::MakeShape(weight.shape().get().element_type(), {});
+  ir::NodePtr node = ir::MakeNode<ir::ops::EmbeddingBag>(
+      weight.GetIrValue(), indices.GetIrValue(), offsets.GetIrValue(),
+      GetIrValueOrDefault(per_sample_weights, 1, scalar_shape,
+                          weight.GetDevice()),
+      static_cast<EmbeddingBagMode>(mode));
+  return std::make_tuple(
+      weight.CreateFrom(ir::Value(node, 0)),
+      weight.CreateFrom(ir::Value(node, 1), at::ScalarType::Long),
+      weight.CreateFrom(ir::Value(node, 2), at::ScalarType::Long),
+      weight.CreateFrom(ir::Value(node, 3), at::ScalarType::Long));
+}
+
+XLATensor XLATensor::embedding_bag_dense_backward(
+    const XLATensor& grad, const XLATensor& indices,
+    const XLATensor& offset2bag, const XLATensor& bag_size,
+    const XLATensor& max_indices, xla::int64 num_weights,
+    bool scale_grad_by_freq, xla::int64 mode,
+    const XLATensor& per_sample_weights) {
+  xla::Shape scalar_shape =
+      xla::ShapeUtil::MakeShape(grad.shape().get().element_type(), {});
+  return grad.CreateFrom(ir::MakeNode<ir::ops::EmbeddingBagBackward>(
+      grad.GetIrValue(), indices.GetIrValue(), offset2bag.GetIrValue(),
+      bag_size.GetIrValue(), max_indices.GetIrValue(),
+      GetIrValueOrDefault(per_sample_weights, 1, scalar_shape,
+                          grad.GetDevice()),
+      num_weights, scale_grad_by_freq, static_cast<EmbeddingBagMode>(mode)));
+}
+
+XLATensor XLATensor::embedding_bag_per_sample_weights_backward(
+    const XLATensor& grad, const XLATensor& weight, const XLATensor& indices,
+    const XLATensor& offset2bag) {
+  return grad.CreateFrom(ir::ops::EmbeddingBagPerSampleWeightsBackward(
+      grad.GetIrValue(), weight.GetIrValue(), indices.GetIrValue(),
+      offset2bag.GetIrValue()));
+}
+
 XLATensor XLATensor::embedding_dense_backward(const XLATensor& grad_output,
                                               const XLATensor& indices,
                                               xla::int64 num_weights,
@@ -1034,6 +1447,40 @@ void XLATensor::ge_(XLATensor& input, const XLATensor& other) {
   input.SetIrValue(ir::MakeNode<ir::ops::Cast>(cmp_result, input.dtype()));
 }
 
+std::tuple<XLATensor, XLATensor, XLATensor> XLATensor::group_norm(
+    const XLATensor& input, const XLATensor& weight, const XLATensor& bias,
+    xla::int64 num_groups, std::vector<xla::int64> affine_dims, double eps) {
+  xla::Shape affine_shape =
+      GroupNormAffineShape(input, affine_dims, num_groups);
+  ir::Value weight_value =
+      GetIrValueOrDefault(weight, 1, affine_shape, input.GetDevice());
+  ir::Value bias_value =
+      GetIrValueOrDefault(bias, 0, affine_shape, input.GetDevice());
+  ir::NodePtr node = ir::MakeNode<ir::ops::GroupNorm>(
+      input.GetIrValue(), weight_value, bias_value, num_groups,
+      std::move(affine_dims), eps);
+  return std::make_tuple(input.CreateFrom(ir::Value(node, 0)),
+                         input.CreateFrom(ir::Value(node, 1)),
+                         input.CreateFrom(ir::Value(node, 2)));
+}
+
+std::tuple<XLATensor, XLATensor, XLATensor> XLATensor::group_norm_backward(
+    const XLATensor& grad_output, const XLATensor& input,
+    const XLATensor& weight, const XLATensor& mean, const XLATensor& rstd,
+    xla::int64 num_groups, std::vector<xla::int64> affine_dims) {
+  xla::Shape affine_shape =
+      GroupNormAffineShape(input, affine_dims, num_groups);
+  ir::Value weight_value =
+      GetIrValueOrDefault(weight, 1, affine_shape, input.GetDevice());
+  ir::NodePtr node = ir::MakeNode<ir::ops::GroupNormBackward>(
+      grad_output.GetIrValue(), input.GetIrValue(), weight_value,
+      mean.GetIrValue(), rstd.GetIrValue(), num_groups,
+      std::move(affine_dims));
+  return std::make_tuple(input.CreateFrom(ir::Value(node, 0)),
+                         input.CreateFrom(ir::Value(node, 1)),
+                         input.CreateFrom(ir::Value(node, 2)));
+}
+
 XLATensor XLATensor::gt(const XLATensor& input, at::Scalar other) {
   return DispatchComparisonOp(at::aten::gt, input, other);
 }
@@ -1054,10 +1501,57 @@ void XLATensor::gt_(XLATensor& input, const XLATensor& other) {
   input.SetIrValue(ir::MakeNode<ir::ops::Cast>(cmp_result, input.dtype()));
 }
 
-XLATensor XLATensor::index(const XLATensor& input,
-                           tensorflow::gtl::ArraySlice<const XLATensor> indices,
-                           xla::int64 start_dim) {
-  return IndexByTensors(input, indices, start_dim);
+std::vector<XLATensor> XLATensor::gru_cell(const XLATensor& input,
+                                           const XLATensor& hx,
+                                           const XLATensor& w_ih,
+                                           const XLATensor& w_hh,
+                                           const XLATensor& b_ih,
+                                           const XLATensor& b_hh) {
+  return CreateNodeOutputs(
+      input, ir::ops::GruCell(input.GetIrValue(), hx.GetIrValue(),
+                              w_ih.GetIrValue(), w_hh.GetIrValue(),
+                              GetRnnBias(b_ih, w_ih), GetRnnBias(b_hh, w_ih)));
+}
+
+std::vector<XLATensor> XLATensor::gru_cell_backward(
+    const XLATensor& grad_h, const XLATensor& input, const XLATensor& hx,
+    const XLATensor& w_ih, const XLATensor& w_hh, const XLATensor& gates) {
+  return CreateNodeOutputs(
+      input, ir::ops::GruCellBackward(grad_h.GetIrValue(), input.GetIrValue(),
+                                      hx.GetIrValue(), w_ih.GetIrValue(),
+                                      w_hh.GetIrValue(), gates.GetIrValue()));
+}
+
+std::vector<XLATensor> XLATensor::gru_sequence(const XLATensor& input,
+                                               const XLATensor& h0,
+                                               const XLATensor& w_ih,
+                                               const XLATensor& w_hh,
+                                               const XLATensor& b_ih,
+                                               const XLATensor& b_hh) {
+  return CreateNodeOutputs(
+      input,
+      ir::ops::GruSequence(input.GetIrValue(), h0.GetIrValue(),
+                           w_ih.GetIrValue(), w_hh.GetIrValue(),
+                           GetRnnBias(b_ih, w_ih), GetRnnBias(b_hh, w_ih)));
+}
+
+std::vector<XLATensor> XLATensor::gru_sequence_backward(
+    const XLATensor& grad_output, const XLATensor& input, const XLATensor& h0,
+    const XLATensor& w_ih, const XLATensor& w_hh, const XLATensor& output,
+    const XLATensor& gates) {
+  return CreateNodeOutputs(
+      input, ir::ops::GruSequenceBackward(
+                 grad_output.GetIrValue(), input.GetIrValue(), h0.GetIrValue(),
+                 w_ih.GetIrValue(), w_hh.GetIrValue(), output.GetIrValue(),
+                 gates.GetIrValue()));
+}
+
+XLATensor XLATensor::index(
+    const XLATensor& input,
+    tensorflow::gtl::ArraySlice<const XLATensor> indices,
+    tensorflow::gtl::ArraySlice<const xla::int64> index_dims,
+    xla::int64 start_dim) {
+  return IndexByTensors(input, indices, index_dims, start_dim);
 }
 
 XLATensor XLATensor::index_add(const XLATensor& input, xla::int64 dim,
@@ -1121,20 +1615,19 @@ void XLATensor::index_fill_(XLATensor& input, xla::int64 dim,
 
 XLATensor XLATensor::index_put(
     const XLATensor& input,
-    tensorflow::gtl::ArraySlice<const XLATensor> indices, xla::int64 start_dim,
-    const XLATensor& values, bool accumulate,
-    tensorflow::gtl::ArraySlice<const xla::int64> result_permutation) {
-  return input.CreateFrom(IndexPutByTensors(input, indices, start_dim, values,
-                                            accumulate, result_permutation));
+    tensorflow::gtl::ArraySlice<const XLATensor> indices,
+    tensorflow::gtl::ArraySlice<const xla::int64> index_dims,
+    xla::int64 start_dim, const XLATensor& values, bool accumulate) {
+  return input.CreateFrom(IndexPutByTensors(input, indices, index_dims,
+                                            start_dim, values, accumulate));
 }
 
 void XLATensor::index_put_(
-    XLATensor& input, const XLATensor& canonical_base,
-    tensorflow::gtl::ArraySlice<const XLATensor> indices, xla::int64 start_dim,
-    const XLATensor& values, bool accumulate,
-    tensorflow::gtl::ArraySlice<const xla::int64> result_permutation) {
-  input.SetIrValue(IndexPutByTensors(canonical_base, indices, start_dim, values,
-                                     accumulate, result_permutation));
+    XLATensor& input, tensorflow::gtl::ArraySlice<const XLATensor> indices,
+    tensorflow::gtl::ArraySlice<const xla::int64> index_dims,
+    xla::int64 start_dim, const XLATensor& values, bool accumulate) {
+  input.SetIrValue(IndexPutByTensors(input, indices, index_dims, start_dim,
+                                     values, accumulate));
 }
 
 XLATensor XLATensor::index_select(const XLATensor& input, xla::int64 dim,
@@ -1166,6 +1659,31 @@ std::tuple<XLATensor, XLATensor> XLATensor::kthvalue(const XLATensor& input,
       input.CreateFrom(ir::Value(node, 1), at::ScalarType::Long));
 }
 
+void XLATensor::lamb_step_(std::vector<XLATensor>& params,
+                           const std::vector<XLATensor>& grads,
+                           std::vector<XLATensor>& exp_avgs,
+                           std::vector<XLATensor>& exp_avg_sqs, double lr,
+                           double beta1, double beta2, double eps,
+                           double weight_decay, double bias_correction1,
+                           double bias_correction2) {
+  if (params.empty()) {
+    return;
+  }
+  Device device = GetOptimizerStepDevice(params);
+  ir::NodePtr node = ir::MakeNode<ir::ops::LambStep>(
+      GetTensorsIrValues(params), GetTensorsIrValues(grads),
+      GetTensorsIrValues(exp_avgs), GetTensorsIrValues(exp_avg_sqs),
+      GetOptimizerScalar(lr, device), GetOptimizerScalar(beta1, device),
+      GetOptimizerScalar(beta2, device), GetOptimizerScalar(eps, device),
+      weight_decay != 0 ? GetOptimizerScalar(weight_decay, device)
+                        : ir::Value(),
+      GetOptimizerScalar(bias_correction1, device),
+      GetOptimizerScalar(bias_correction2, device));
+  size_t index = SetOptimizerStepOutputs(node, 0, params);
+  index = SetOptimizerStepOutputs(node, index, exp_avgs);
+  SetOptimizerStepOutputs(node, index, exp_avg_sqs);
+}
+
 XLATensor XLATensor::le(const XLATensor& input, at::Scalar other) {
   return DispatchComparisonOp(at::aten::le, input, other);
 }
@@ -1271,8 +1789,21 @@ XLATensor XLATensor::log_softmax(const XLATensor& input, xla::int64 dim,
 XLATensor XLATensor::log_softmax_backward(const XLATensor& grad_output,
                                           const XLATensor& output,
                                           xla::int64 dim) {
+  ir::Value output_value = output.GetIrValue();
+  const ir::ops::LogSoftmax* log_softmax = GetFusableLogSoftmax(output_value);
+  xla::int64 canonical_dim = XlaHelpers::GetCanonicalDimensionIndex(
+      dim, grad_output.shape().get().rank());
+  if (log_softmax != nullptr && log_softmax->dim() == canonical_dim) {
+    // Recompute the softmax from the logits, so that the LogSoftmax output
+    // does not need to be kept alive until the backward pass.
+    XLA_COUNTER("FusedLogSoftmaxBackward", 1);
+    ir::Value logits = log_softmax->operand_value(0);
+    return grad_output.CreateFrom(ir::ops::LogSoftmaxBackwardFromLogits(
+        grad_output.GetIrValue(), logits,
+        ir::ops::LogSumExp(logits, canonical_dim), canonical_dim));
+  }
   return grad_output.CreateFrom(ir::ops::LogSoftmaxBackwardOp(
-      grad_output.GetIrValue(), output.GetIrValue(), dim));
+      grad_output.GetIrValue(), output_value, dim));
 }
 
 XLATensor XLATensor::log1p(const XLATensor& input) {
@@ -1303,6 +1834,53 @@ void XLATensor::lt_(XLATensor& input, const XLATensor& other) {
   input.SetIrValue(ir::MakeNode<ir::ops::Cast>(cmp_result, input.dtype()));
 }
 
+std::vector<XLATensor> XLATensor::lstm_cell(
+    const XLATensor& input, const XLATensor& hx, const XLATensor& cx,
+    const XLATensor& w_ih, const XLATensor& w_hh, const XLATensor& b_ih,
+    const XLATensor& b_hh) {
+  return CreateNodeOutputs(
+      input,
+      ir::ops::LstmCell(input.GetIrValue(), hx.GetIrValue(), cx.GetIrValue(),
+                        w_ih.GetIrValue(), w_hh.GetIrValue(),
+                        GetRnnBias(b_ih, w_ih), GetRnnBias(b_hh, w_ih)));
+}
+
+std::vector<XLATensor> XLATensor::lstm_cell_backward(
+    const XLATensor& grad_h, const XLATensor& grad_c, const XLATensor& input,
+    const XLATensor& hx, const XLATensor& cx, const XLATensor& w_ih,
+    const XLATensor& w_hh, const XLATensor& c, const XLATensor& gates) {
+  return CreateNodeOutputs(
+      input, ir::ops::LstmCellBackward(
+                 grad_h.GetIrValue(), grad_c.GetIrValue(), input.GetIrValue(),
+                 hx.GetIrValue(), cx.GetIrValue(), w_ih.GetIrValue(),
+                 w_hh.GetIrValue(), c.GetIrValue(), gates.GetIrValue()));
+}
+
+std::vector<XLATensor> XLATensor::lstm_sequence(
+    const XLATensor& input, const XLATensor& h0, const XLATensor& c0,
+    const XLATensor& w_ih, const XLATensor& w_hh, const XLATensor& b_ih,
+    const XLATensor& b_hh) {
+  return CreateNodeOutputs(
+      input,
+      ir::ops::LstmSequence(input.GetIrValue(), h0.GetIrValue(),
+                            c0.GetIrValue(), w_ih.GetIrValue(),
+                            w_hh.GetIrValue(), GetRnnBias(b_ih, w_ih),
+                            GetRnnBias(b_hh, w_ih)));
+}
+
+std::vector<XLATensor> XLATensor::lstm_sequence_backward(
+    const XLATensor& grad_output, const XLATensor& grad_cells,
+    const XLATensor& input, const XLATensor& h0, const XLATensor& c0,
+    const XLATensor& w_ih, const XLATensor& w_hh, const XLATensor& output,
+    const XLATensor& cells, const XLATensor& gates) {
+  return CreateNodeOutputs(
+      input, ir::ops::LstmSequenceBackward(
+                 grad_output.GetIrValue(), grad_cells.GetIrValue(),
+                 input.GetIrValue(), h0.GetIrValue(), c0.GetIrValue(),
+                 w_ih.GetIrValue(), w_hh.GetIrValue(), output.GetIrValue(),
+                 cells.GetIrValue(), gates.GetIrValue()));
+}
+
 XLATensor XLATensor::masked_fill(const XLATensor& input, const XLATensor& mask,
                                  at::Scalar value) {
   // Expand mask to be the same size as input.
@@ -1313,6 +1891,15 @@ XLATensor XLATensor::masked_fill(const XLATensor& input, const XLATensor& mask,
       input.GetIrValue(), expanded_mask, value));
 }
 
+void XLATensor::mark_sharding_(
+    XLATensor& input, tensorflow::gtl::ArraySlice<const xla::int64> mesh_shape,
+    tensorflow::gtl::ArraySlice<const xla::int64> dim_axes) {
+  XLA_CHECK_EQ(dim_axes.size(), input.shape().get().rank())
+      << "The sharding needs a mesh axis (or -1) for every dimension";
+  input.SetIrValue(ir::ops::ShardingAnnotation(
+      input.GetIrValue(), CreateTiledSharding(mesh_shape, dim_axes)));
+}
+
 void XLATensor::masked_fill_(XLATensor& input, const XLATensor& mask,
                              at::Scalar value) {
   // Expand mask to be the same size as input.
@@ -1323,6 +1910,15 @@ void XLATensor::masked_fill_(XLATensor& input, const XLATensor& mask,
                                                      expanded_mask, value));
 }
 
+std::tuple<XLATensor, XLATensor> XLATensor::masked_select_bounded(
+    const XLATensor& input, const XLATensor& mask) {
+  ir::NodePtr node =
+      ir::ops::MaskedSelectBounded(input.GetIrValue(), mask.GetIrValue());
+  return std::make_tuple(
+      input.CreateFrom(ir::Value(node, 0)),
+      input.CreateFrom(ir::Value(node, 1), at::ScalarType::Long));
+}
+
 XLATensor XLATensor::matmul(const XLATensor& input, const XLATensor& other) {
   return input.CreateFrom(
       ir::ops::MatMul(input.GetIrValue(), other.GetIrValue()));
@@ -1361,6 +1957,21 @@ XLATensor XLATensor::max_pool_nd(const XLATensor& input,
       std::move(stride), std::move(padding), ceil_mode));
 }
 
+std::tuple<XLATensor, XLATensor> XLATensor::max_pool_nd_with_indices(
+    const XLATensor& input, xla::int64 spatial_dim_count,
+    std::vector<xla::int64> kernel_size, std::vector<xla::int64> stride,
+    std::vector<xla::int64> padding, bool ceil_mode) {
+  kernel_size = CheckIntList(kernel_size, spatial_dim_count, "kernel_size");
+  stride = CheckIntList(stride, spatial_dim_count, "stride", kernel_size);
+  padding = CheckIntList(padding, spatial_dim_count, "padding");
+  ir::NodePtr node = ir::MakeNode<ir::ops::MaxPoolNd>(
+      input.GetIrValue(), spatial_dim_count, std::move(kernel_size),
+      std::move(stride), std::move(padding), ceil_mode);
+  return std::make_tuple(
+      input.CreateFrom(ir::Value(node, 0)),
+      input.CreateFrom(ir::Value(node, 1), at::ScalarType::Long));
+}
+
 XLATensor XLATensor::max_pool_nd_backward(const XLATensor& out_backprop,
                                           const XLATensor& input,
                                           xla::int64 spatial_dim_count,
@@ -1377,6 +1988,20 @@ XLATensor XLATensor::max_pool_nd_backward(const XLATensor& out_backprop,
       ceil_mode));
 }
 
+XLATensor XLATensor::max_pool_nd_backward_with_indices(
+    const XLATensor& out_backprop, const XLATensor& input,
+    const XLATensor& indices, xla::int64 spatial_dim_count,
+    std::vector<xla::int64> kernel_size, std::vector<xla::int64> stride,
+    std::vector<xla::int64> padding, bool ceil_mode) {
+  kernel_size = CheckIntList(kernel_size, spatial_dim_count, "kernel_size");
+  stride = CheckIntList(stride, spatial_dim_count, "stride", kernel_size);
+  padding = CheckIntList(padding, spatial_dim_count, "padding");
+  return out_backprop.CreateFrom(ir::MakeNode<ir::ops::MaxPoolNdBackward>(
+      out_backprop.GetIrValue(), input.GetIrValue(), indices.GetIrValue(),
+      spatial_dim_count, std::move(kernel_size), std::move(stride),
+      std::move(padding), ceil_mode));
+}
+
 XLATensor XLATensor::mean(const XLATensor& input,
                           std::vector<xla::int64> dimensions,
                           bool keep_reduced_dimensions,
@@ -1538,15 +2163,40 @@ void XLATensor::neg_(XLATensor& input) {
 
 XLATensor XLATensor::nll_loss(const XLATensor& input, const XLATensor& target,
                               int ignore_index) {
+  ir::Value input_value = input.GetIrValue();
+  const ir::ops::LogSoftmax* log_softmax = GetFusableLogSoftmax(input_value);
+  if (log_softmax != nullptr && log_softmax->dim() == 1) {
+    XLA_COUNTER("FusedCrossEntropy", 1);
+    ir::Value logits = log_softmax->operand_value(0);
+    return input.CreateFrom(ir::MakeNode<ir::ops::CrossEntropy>(
+        logits, ir::ops::LogSumExp(logits, /*dim=*/1), target.GetIrValue(),
+        ignore_index));
+  }
   return input.CreateFrom(ir::MakeNode<ir::ops::NllLoss>(
-      input.GetIrValue(), target.GetIrValue(), ignore_index));
+      input_value, target.GetIrValue(), ignore_index));
 }
 
 XLATensor XLATensor::nll_loss_backward(const XLATensor& input,
                                        const XLATensor& target,
                                        int ignore_index) {
+  ir::Value input_value = input.GetIrValue();
+  const ir::ops::LogSoftmax* log_softmax = GetFusableLogSoftmax(input_value);
+  if (log_softmax != nullptr) {
+    // The gradient only depends on the shape of the log-probabilities, so
+    // avoid referencing the LogSoftmax output, which would then need to be
+    // computed.
+    input_value = log_softmax->operand_value(0);
+  }
   return input.CreateFrom(ir::MakeNode<ir::ops::NllLossBackward>(
-      input.GetIrValue(), target.GetIrValue(), ignore_index));
+      input_value, target.GetIrValue(), ignore_index));
+}
+
+void XLATensor::normal_(XLATensor& input, double mean, double std) {
+  xla::PrimitiveType type = input.shape().get().element_type();
+  input.SetIrValue(ir::ops::Normal(
+      input.shape(), GetIrValueForScalar(mean, type, input.GetDevice()),
+      GetIrValueForScalar(std, type, input.GetDevice()),
+      GetRngSeed(input.GetDevice())));
 }
 
 XLATensor XLATensor::not_supported(std::string description, xla::Shape shape,
@@ -1556,6 +2206,14 @@ XLATensor XLATensor::not_supported(std::string description, xla::Shape shape,
                 device);
 }
 
+std::tuple<XLATensor, XLATensor> XLATensor::nonzero_bounded(
+    const XLATensor& input) {
+  ir::NodePtr node = ir::ops::NonZeroBounded(input.GetIrValue());
+  return std::make_tuple(
+      input.CreateFrom(ir::Value(node, 0), at::ScalarType::Long),
+      input.CreateFrom(ir::Value(node, 1), at::ScalarType::Long));
+}
+
 XLATensor XLATensor::norm(const XLATensor& input, c10::optional<at::Scalar> p,
                           c10::optional<at::ScalarType> dtype,
                           at::IntArrayRef dim, bool keepdim) {
@@ -1623,12 +2281,63 @@ std::tuple<XLATensor, XLATensor> XLATensor::qr(const XLATensor& input,
                          input.CreateFrom(ir::Value(node, 1)));
 }
 
+XLATensor XLATensor::quantized_convolution(
+    const XLATensor& input, const XLATensor& weight,
+    const XLATensor& weight_scales, const XLATensor& bias, double input_scale,
+    std::vector<xla::int64> stride, std::vector<xla::int64> padding,
+    std::vector<xla::int64> dilation, xla::int64 groups) {
+  ir::NodePtr node =
+      bias.is_null()
+          ? ir::MakeNode<ir::ops::QuantizedConvolution>(
+                input.GetIrValue(), weight.GetIrValue(),
+                weight_scales.GetIrValue(), input_scale, std::move(stride),
+                std::move(padding), std::move(dilation), groups)
+          : ir::MakeNode<ir::ops::QuantizedConvolution>(
+                input.GetIrValue(), weight.GetIrValue(),
+                weight_scales.GetIrValue(), bias.GetIrValue(), input_scale,
+                std::move(stride), std::move(padding), std::move(dilation),
+                groups);
+  return input.CreateFrom(node);
+}
+
+XLATensor XLATensor::quantized_linear(const XLATensor& input,
+                                      const XLATensor& weight,
+                                      const XLATensor& weight_scales,
+                                      const XLATensor& bias,
+                                      double input_scale) {
+  ir::NodePtr node =
+      bias.is_null()
+          ? ir::MakeNode<ir::ops::QuantizedLinear>(
+                input.GetIrValue(), weight.GetIrValue(),
+                weight_scales.GetIrValue(), input_scale)
+          : ir::MakeNode<ir::ops::QuantizedLinear>(
+                input.GetIrValue(), weight.GetIrValue(),
+                weight_scales.GetIrValue(), bias.GetIrValue(), input_scale);
+  return input.CreateFrom(node);
+}
+
+void XLATensor::random_(XLATensor& input, xla::int64 from, xla::int64 to) {
+  input.SetIrValue(ir::ops::RandomInt(input.shape(), from, to,
+                                      GetRngSeed(input.GetDevice())));
+}
+
 XLATensor XLATensor::randperm(xla::int64 n, const Device& device,
                               at::ScalarType element_type) {
   xla::PrimitiveType xla_element_type =
       MakeXlaPrimitiveType(element_type, &device);
-  return Create(ir::MakeNode<ir::ops::Randperm>(n, xla_element_type), device,
-                element_type);
+  return Create(
+      ir::MakeNode<ir::ops::Randperm>(GetRngSeed(device), n, xla_element_type),
+      device, element_type);
+}
+
+XLATensor XLATensor::reduce_scatter(
+    const XLATensor& input, double scale, xla::int64 dim,
+    xla::int64 shard_count,
+    const std::vector<std::vector<xla::int64>>& groups) {
+  return input.CreateFrom(ir::MakeNode<ir::ops::ReduceScatter>(
+      input.GetIrValue(), scale,
+      XlaHelpers::GetCanonicalDimensionIndex(dim, input.shape().get().rank()),
+      shard_count, groups));
 }
 
 XLATensor XLATensor::reciprocal(const XLATensor& input) {
@@ -1639,12 +2348,31 @@ void XLATensor::reciprocal_(XLATensor& input) {
   input.SetIrValue(ir::ops::ReciprocalOp(input.GetIrValue()));
 }
 
+std::vector<XLATensor> XLATensor::remat_anchor(
+    tensorflow::gtl::ArraySlice<const XLATensor> inputs,
+    const XLATensor& anchor) {
+  std::vector<ir::Value> input_values;
+  for (const auto& input : inputs) {
+    input_values.push_back(input.GetIrValue());
+  }
+  ir::NodePtr node = ir::ops::RematAnchor(input_values, anchor.GetIrValue());
+  std::vector<XLATensor> results;
+  for (size_t i = 0; i < inputs.size(); ++i) {
+    results.push_back(inputs[i].CreateFrom(ir::Value(node, i)));
+  }
+  return results;
+}
+
 XLATensor XLATensor::relu(const XLATensor& input) {
-  return input.CreateFrom(ir::ops::ReluOp(input.GetIrValue()));
+  return input.CreateFrom(ApplyLinearEpilogue(
+      input.GetIrValue(), ir::ops::FusedLinear::Activation::kRelu,
+      ir::ops::ReluOp));
 }
 
 void XLATensor::relu_(XLATensor& input) {
-  input.SetIrValue(ir::ops::ReluOp(input.GetIrValue()));
+  input.SetIrValue(ApplyLinearEpilogue(input.GetIrValue(),
+                                       ir::ops::FusedLinear::Activation::kRelu,
+                                       ir::ops::ReluOp));
 }
 
 XLATensor XLATensor::remainder(const XLATensor& input, const XLATensor& other) {
@@ -1699,7 +2427,8 @@ XLATensor XLATensor::rrelu_with_noise(const XLATensor& input, XLATensor& noise,
                                       at::Scalar lower, at::Scalar upper,
                                       bool training) {
   ir::NodePtr output_node = ir::MakeNode<ir::ops::RreluWithNoise>(
-      input.GetIrValue(), lower, upper, training);
+      input.GetIrValue(), GetRngSeed(input.GetDevice()), lower, upper,
+      training);
   noise.SetIrValue(ir::Value(output_node, 1));
   return input.CreateFrom(ir::Value(output_node, 0));
 }
@@ -1799,17 +2528,66 @@ XLATensor XLATensor::scatter(const XLATensor& input, xla::int64 dim,
       XlaHelpers::GetCanonicalDimensionIndex(dim, input.shape().get().rank())));
 }
 
+std::tuple<XLATensor, XLATensor> XLATensor::segment_sum(
+    const XLATensor& indices, const XLATensor& values, xla::int64 dim,
+    xla::int64 num_segments) {
+  ir::NodePtr node = ir::ops::SegmentSum(
+      indices.GetIrValue(), values.GetIrValue(),
+      XlaHelpers::GetCanonicalDimensionIndex(dim, values.shape().get().rank()),
+      num_segments);
+  return std::make_tuple(indices.CreateFrom(ir::Value(node, 0)),
+                         values.CreateFrom(ir::Value(node, 1)));
+}
+
 XLATensor XLATensor::select(const XLATensor& input, xla::int64 dim,
                             xla::int64 index) {
   return tensor_ops::Select(input, dim, index);
 }
 
+void XLATensor::select_finite_updates_(std::vector<XLATensor>& tensors,
+                                       const std::vector<XLATensor>& previous,
+                                       const XLATensor& found_inf) {
+  if (tensors.empty()) {
+    return;
+  }
+  ir::NodePtr node = ir::MakeNode<ir::ops::SelectFiniteUpdates>(
+      GetTensorsIrValues(tensors), GetTensorsIrValues(previous),
+      found_inf.GetIrValue());
+  SetOptimizerStepOutputs(node, 0, tensors);
+}
+
+void XLATensor::sgd_step_(std::vector<XLATensor>& params,
+                          const std::vector<XLATensor>& grads,
+                          std::vector<XLATensor>& momentum_buffers, double lr,
+                          double momentum, double dampening,
+                          double weight_decay, bool nesterov,
+                          bool init_buffers) {
+  if (params.empty()) {
+    return;
+  }
+  Device device = GetOptimizerStepDevice(params);
+  ir::NodePtr node = ir::MakeNode<ir::ops::SgdStep>(
+      GetTensorsIrValues(params), GetTensorsIrValues(grads),
+      GetTensorsIrValues(momentum_buffers), GetOptimizerScalar(lr, device),
+      GetOptimizerScalar(momentum, device),
+      GetOptimizerScalar(dampening, device),
+      weight_decay != 0 ? GetOptimizerScalar(weight_decay, device)
+                        : ir::Value(),
+      nesterov, init_buffers);
+  size_t index = SetOptimizerStepOutputs(node, 0, params);
+  SetOptimizerStepOutputs(node, index, momentum_buffers);
+}
+
 XLATensor XLATensor::sigmoid(const XLATensor& input) {
-  return input.CreateFrom(ir::ops::Sigmoid(input.GetIrValue()));
+  return input.CreateFrom(ApplyLinearEpilogue(
+      input.GetIrValue(), ir::ops::FusedLinear::Activation::kSigmoid,
+      ir::ops::Sigmoid));
 }
 
 void XLATensor::sigmoid_(XLATensor& input) {
-  input.SetIrValue(ir::ops::Sigmoid(input.GetIrValue()));
+  input.SetIrValue(ApplyLinearEpilogue(
+      input.GetIrValue(), ir::ops::FusedLinear::Activation::kSigmoid,
+      ir::ops::Sigmoid));
 }
 
 XLATensor XLATensor::sigmoid_backward(const XLATensor& grad_output,
@@ -1917,6 +2695,30 @@ XLATensor XLATensor::softshrink_backward(const XLATensor& grad_out,
       input.GetIrValue(), lambda));
 }
 
+std::tuple<XLATensor, XLATensor> XLATensor::sort(const XLATensor& input,
+                                                 xla::int64 dim,
+                                                 bool descending, bool stable) {
+  return sort(std::vector<XLATensor>{input}, dim, descending, stable);
+}
+
+std::tuple<XLATensor, XLATensor> XLATensor::sort(
+    const std::vector<XLATensor>& keys, xla::int64 dim, bool descending,
+    bool stable) {
+  XLA_CHECK(!keys.empty());
+  std::vector<ir::Value> values;
+  for (auto& key : keys) {
+    values.push_back(key.GetIrValue());
+  }
+  ir::NodePtr node = ir::MakeNode<ir::ops::Sort>(
+      values,
+      XlaHelpers::GetCanonicalDimensionIndex(dim,
+                                             keys[0].shape().get().rank()),
+      descending, stable);
+  return std::make_tuple(
+      keys[0].CreateFrom(ir::Value(node, 0)),
+      keys[0].CreateFrom(ir::Value(node, 1), at::ScalarType::Long));
+}
+
 std::vector<XLATensor> XLATensor::split(const XLATensor& input,
                                         xla::int64 split_size, xla::int64 dim) {
   auto input_shape = input.shape();
@@ -1999,6 +2801,18 @@ XLATensor XLATensor::sub(const XLATensor& input, const XLATensor& other,
   return input.CreateFrom(input.GetIrValue() - other.GetIrValue() * constant);
 }
 
+std::pair<xla::int64, std::vector<XLATensor>> XLATensor::subgraph_parameters(
+    const std::vector<XLATensor>& operands) {
+  xla::int64 scope = ir::ops::SubgraphParameter::NewScope();
+  std::vector<XLATensor> parameters;
+  for (size_t i = 0; i < operands.size(); ++i) {
+    parameters.push_back(operands[i].CreateFrom(
+        ir::MakeNode<ir::ops::SubgraphParameter>(scope, i,
+                                                 operands[i].shape())));
+  }
+  return std::make_pair(scope, std::move(parameters));
+}
+
 XLATensor XLATensor::sum(const XLATensor& input,
                          std::vector<xla::int64> dimensions,
                          bool keep_reduced_dimensions,
@@ -2067,11 +2881,15 @@ void XLATensor::tan_(XLATensor& input) {
 }
 
 XLATensor XLATensor::tanh(const XLATensor& input) {
-  return input.CreateFrom(ir::ops::Tanh(input.GetIrValue()));
+  return input.CreateFrom(ApplyLinearEpilogue(
+      input.GetIrValue(), ir::ops::FusedLinear::Activation::kTanh,
+      ir::ops::Tanh));
 }
 
 void XLATensor::tanh_(XLATensor& input) {
-  input.SetIrValue(ir::ops::Tanh(input.GetIrValue()));
+  input.SetIrValue(ApplyLinearEpilogue(input.GetIrValue(),
+                                       ir::ops::FusedLinear::Activation::kTanh,
+                                       ir::ops::Tanh));
 }
 
 XLATensor XLATensor::tanh_backward(const XLATensor& grad_output,
@@ -2206,6 +3024,39 @@ std::vector<XLATensor> XLATensor::unbind(const XLATensor& input,
   return slices;
 }
 
+void XLATensor::uniform_(XLATensor& input, double from, double to) {
+  xla::PrimitiveType type = input.shape().get().element_type();
+  input.SetIrValue(ir::ops::Uniform(
+      input.shape(), GetIrValueForScalar(from, type, input.GetDevice()),
+      GetIrValueForScalar(to, type, input.GetDevice()),
+      GetRngSeed(input.GetDevice())));
+}
+
+std::tuple<XLATensor, XLATensor> XLATensor::unique_bounded(
+    const XLATensor& input) {
+  ir::NodePtr node = ir::ops::UniqueBounded(input.GetIrValue());
+  return std::make_tuple(
+      input.CreateFrom(ir::Value(node, 0)),
+      input.CreateFrom(ir::Value(node, 1), at::ScalarType::Long));
+}
+
+void XLATensor::update_loss_scale_(XLATensor& loss_scale,
+                                   XLATensor& good_steps,
+                                   const XLATensor& found_inf,
+                                   double growth_factor, double backoff_factor,
+                                   xla::int64 growth_interval,
+                                   double min_scale) {
+  const Device& device = loss_scale.GetDevice();
+  ir::NodePtr node = ir::MakeNode<ir::ops::UpdateLossScale>(
+      loss_scale.GetIrValue(), good_steps.GetIrValue(),
+      found_inf.GetIrValue(), GetOptimizerScalar(growth_factor, device),
+      GetOptimizerScalar(backoff_factor, device),
+      GetOptimizerScalar(growth_interval, device),
+      GetOptimizerScalar(min_scale, device));
+  loss_scale.SetIrValue(ir::Value(node, 0));
+  good_steps.SetIrValue(ir::Value(node, 1));
+}
+
 XLATensor XLATensor::unsqueeze(const XLATensor& input, xla::int64 dim) {
   auto input_shape = input.shape();
   xla::int64 squeeze_dim =
@@ -2222,6 +3073,32 @@ void XLATensor::unsqueeze_(XLATensor& input, xla::int64 dim) {
       ir::MakeNode<ir::ops::Unsqueeze>(input.GetIrValue(), squeeze_dim));
 }
 
+XLATensor XLATensor::upsample_bilinear2d(
+    const XLATensor& input, std::vector<xla::int64> output_size,
+    bool align_corners) {
+  return input.CreateFrom(ir::MakeNode<ir::ops::UpsampleBilinear>(
+      input.GetIrValue(), std::move(output_size), align_corners));
+}
+
+XLATensor XLATensor::upsample_bilinear2d_backward(
+    const XLATensor& grad_output, std::vector<xla::int64> input_size,
+    bool align_corners) {
+  return grad_output.CreateFrom(ir::MakeNode<ir::ops::UpsampleBilinearBackward>(
+      grad_output.GetIrValue(), std::move(input_size), align_corners));
+}
+
+XLATensor XLATensor::upsample_nearest2d(const XLATensor& input,
+                                        std::vector<xla::int64> output_size) {
+  return input.CreateFrom(ir::MakeNode<ir::ops::UpsampleNearest>(
+      input.GetIrValue(), std::move(output_size)));
+}
+
+XLATensor XLATensor::upsample_nearest2d_backward(
+    const XLATensor& grad_output, std::vector<xla::int64> input_size) {
+  return grad_output.CreateFrom(ir::MakeNode<ir::ops::UpsampleNearestBackward>(
+      grad_output.GetIrValue(), std::move(input_size)));
+}
+
 XLATensor XLATensor::view(
     const XLATensor& input,
     tensorflow::gtl::ArraySlice<const xla::int64> output_size) {
@@ -2249,6 +3126,23 @@ XLATensor XLATensor::where(const XLATensor& condition, const XLATensor& input,
       condition.GetIrValue(), input.GetIrValue(), other.GetIrValue()));
 }
 
+std::vector<XLATensor> XLATensor::while_loop(
+    const std::vector<XLATensor>& operands, xla::int64 scope,
+    const XLATensor& condition, const std::vector<XLATensor>& body_outputs) {
+  ir::Value condition_value = condition.GetIrValue();
+  std::vector<ir::Value> body_values = GetTensorsIrValues(body_outputs);
+  std::vector<ir::Value> captures = ir::ops::CollectSubgraphCaptures(
+      scope, {{condition_value}, body_values});
+  ir::NodePtr node = ir::MakeNode<ir::ops::WhileLoop>(
+      GetTensorsIrValues(operands), captures, scope, condition_value,
+      body_values, captures);
+  std::vector<XLATensor> results;
+  for (size_t i = 0; i < operands.size(); ++i) {
+    results.push_back(operands[i].CreateFrom(ir::Value(node, i)));
+  }
+  return results;
+}
+
 XLATensor XLATensor::DispatchComparisonOp(c10::Symbol kind,
                                           const XLATensor& input,
                                           at::Scalar other) {
@@ -3,6 +3,7 @@
 #include <ATen/core/Reduction.h>
 
 #include "tensorflow/compiler/xla/xla_client/debug_macros.h"
+#include "tensorflow/compiler/xla/xla_client/sys_util.h"
 #include "tensorflow/compiler/xla/xla_client/util.h"
 #include "torch_xla/csrc/helpers.h"
 
@@ -19,6 +20,60 @@ XLATensor IndexAcrossDims(const XLATensor& input, xla::int64 dim,
                             dim);
 }
 
+// Returns the embedding gradient of each of the (flattened) indices, already
+// scaled and masked according to scale_grad_by_freq and padding_idx, together
+// with the rank 1 indices.
+std::tuple<XLATensor, XLATensor> EmbeddingGrad(const XLATensor& grad_output,
+                                               const XLATensor& indices,
+                                               xla::int64 num_weights,
+                                               xla::int64 padding_idx,
+                                               bool scale_grad_by_freq) {
+  XLA_CHECK_EQ(indices.dtype(), at::ScalarType::Long)
+      << "Embedding indices are expected to be of scalar type Long";
+  auto indices_shape_ref = indices.shape();
+  // The weight must be of rank 2, which means the rank of grad_output is one
+  // more than the indices.
+  XLA_CHECK_EQ(grad_output.shape().get().rank(),
+               indices_shape_ref.get().rank() + 1);
+  xla::int64 numel = xla::ShapeUtil::ElementsIn(indices_shape_ref.get());
+  XLATensor grad = XLATensor::view(grad_output, {numel, grad_output.size(-1)});
+  XLATensor indices_rank1 = XLATensor::view(indices, {numel});
+  if (scale_grad_by_freq) {
+    // Compute the histogram of index values.
+    XLATensor counts =
+        XLATensor::full({num_weights}, 0, indices.GetDevice(), indices.dtype());
+    XLATensor ones =
+        XLATensor::full({numel}, 1, indices.GetDevice(), indices.dtype());
+    XLATensor::index_put_(counts, {indices_rank1}, /*index_dims=*/{0},
+                          /*start_dim=*/0, /*values=*/ones,
+                          /*accumulate=*/true);
+    XLATensor grad_weights_scale =
+        XLATensor::index(counts, {indices_rank1}, /*index_dims=*/{0},
+                         /*start_dim=*/0);
+    // Scale the value of the gradient by the histogram.
+    grad = XLATensor::div(grad, XLATensor::unsqueeze(grad_weights_scale, 1));
+  }
+  // Don't accumulate gradients for indices which are equal with the given
+  // padding_idx.
+  XLATensor skip_padding = XLATensor::unsqueeze(
+      XLATensor::ne(indices_rank1, static_cast<double>(padding_idx)), 1);
+  skip_padding = XLATensor::expand(
+      skip_padding,
+      xla::util::ToVector<xla::int64>(grad.shape().get().dimensions()));
+  XLATensor zero_grad =
+      XLATensor::full_like(grad, 0, grad.GetDevice(), grad.dtype());
+  return std::make_tuple(XLATensor::where(skip_padding, grad, zero_grad),
+                         indices_rank1);
+}
+
+// Whether the dense embedding gradient should be computed by summing the
+// gradients of the duplicated indices first (XLA_SEGMENT_SUM_SCATTER).
+bool UseSegmentSumEmbeddingGrad() {
+  static const bool use_segment_sum =
+      xla::sys_util::GetEnvBool("XLA_SEGMENT_SUM_SCATTER", false);
+  return use_segment_sum;
+}
+
 }  // namespace
 
 XLATensor Cross(const XLATensor& input, const XLATensor& other,
@@ -178,51 +233,44 @@ XLATensor Select(const XLATensor& input, xla::int64 dim, xla::int64 index) {
   return XLATensor::view(result, new_dims);
 }
 
+std::tuple<XLATensor, XLATensor> EmbeddingSparseBackward(
+    const XLATensor& grad_output, const XLATensor& indices,
+    xla::int64 num_weights, xla::int64 padding_idx, bool scale_grad_by_freq) {
+  XLATensor grad;
+  XLATensor indices_rank1;
+  std::tie(grad, indices_rank1) = EmbeddingGrad(
+      grad_output, indices, num_weights, padding_idx, scale_grad_by_freq);
+  return XLATensor::segment_sum(indices_rank1, grad, /*dim=*/0, num_weights);
+}
+
 XLATensor EmbeddingDenseBackward(const XLATensor& grad_output,
                                  const XLATensor& indices,
                                  xla::int64 num_weights, xla::int64 padding_idx,
                                  bool scale_grad_by_freq) {
-  XLA_CHECK_EQ(indices.dtype(), at::ScalarType::Long)
-      << "Embedding indices are expected to be of scalar type Long";
-  auto indices_shape_ref = indices.shape();
-  // The weight must be of rank 2, which means the rank of grad_output is one
-  // more than the indices.
-  XLA_CHECK_EQ(grad_output.shape().get().rank(),
-               indices_shape_ref.get().rank() + 1);
-  xla::int64 numel = xla::ShapeUtil::ElementsIn(indices_shape_ref.get());
-  XLATensor grad = XLATensor::view(grad_output, {numel, grad_output.size(-1)});
   XLATensor grad_weight =
       XLATensor::full({num_weights, grad_output.size(-1)}, 0,
                       grad_output.GetDevice(), grad_output.dtype());
-  XLATensor indices_rank1 = XLATensor::view(indices, {numel});
-  if (scale_grad_by_freq) {
-    // Compute the histogram of index values.
-    XLATensor counts =
-        XLATensor::full({num_weights}, 0, indices.GetDevice(), indices.dtype());
-    XLATensor ones =
-        XLATensor::full({numel}, 1, indices.GetDevice(), indices.dtype());
-    XLATensor::index_put_(counts, counts, {indices_rank1}, /*start_dim=*/0,
-                          /*values=*/ones,
-                          /*accumulate=*/true, /*result_permutation=*/{0});
-    XLATensor grad_weights_scale = XLATensor::index(counts, {indices_rank1}, 0);
-    // Scale the value of the gradient by the histogram.
-    grad = XLATensor::div(grad, XLATensor::unsqueeze(grad_weights_scale, 1));
+  if (UseSegmentSumEmbeddingGrad()) {
+    // The rows are unique after the segment sum, so there is no need to
+    // accumulate.
+    XLATensor rows;
+    XLATensor row_grads;
+    std::tie(rows, row_grads) =
+        EmbeddingSparseBackward(grad_output, indices, num_weights, padding_idx,
+                                scale_grad_by_freq);
+    return XLATensor::index_put(grad_weight, {rows}, /*index_dims=*/{0},
+                                /*start_dim=*/0, /*values=*/row_grads,
+                                /*accumulate=*/false);
   }
-  // Don't accumulate gradients for indices which are equal with the given
-  // padding_idx.
-  XLATensor skip_padding = XLATensor::unsqueeze(
-      XLATensor::ne(indices_rank1, static_cast<double>(padding_idx)), 1);
-  skip_padding = XLATensor::expand(
-      skip_padding,
-      xla::util::ToVector<xla::int64>(grad.shape().get().dimensions()));
-  XLATensor zero_grad =
-      XLATensor::full_like(grad, 0, grad.GetDevice(), grad.dtype());
-  return XLATensor::index_put(
-      grad_weight, {indices_rank1},
-      /*start_dim=*/0,
-      /*values=*/XLATensor::where(skip_padding, grad, zero_grad),
-      /*accumulate=*/true,
-      /*result_permutation=*/{0, 1});
+  XLATensor grad;
+  XLATensor indices_rank1;
+  std::tie(grad, indices_rank1) = EmbeddingGrad(
+      grad_output, indices, num_weights, padding_idx, scale_grad_by_freq);
+  return XLATensor::index_put(grad_weight, {indices_rank1},
+                              /*index_dims=*/{0},
+                              /*start_dim=*/0,
+                              /*values=*/grad,
+                              /*accumulate=*/true);
 }
 
 }  // namespace tensor_ops
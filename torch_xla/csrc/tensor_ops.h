@@ -33,6 +33,16 @@ XLATensor SoftplusBackward(const XLATensor& grad_output, const XLATensor& input,
 
 XLATensor Select(const XLATensor& input, xla::int64 dim, xla::int64 index);
 
+// Returns the embedding gradient in sparse form: a rank 1 tensor with the
+// indices of the touched rows, each one appearing only once, and a rank 2
+// tensor with the gradient of each of such rows. The unused slots have
+// num_weights as index and zero gradient, so that they are dropped by the XLA
+// index_add_() and index_put_() operations. This allows optimizers to update
+// only the rows of the weight which have actually been looked up.
+std::tuple<XLATensor, XLATensor> EmbeddingSparseBackward(
+    const XLATensor& grad_output, const XLATensor& indices,
+    xla::int64 num_weights, xla::int64 padding_idx, bool scale_grad_by_freq);
+
 XLATensor EmbeddingDenseBackward(const XLATensor& grad_output,
                                  const XLATensor& indices,
                                  xla::int64 num_weights, xla::int64 padding_idx,
@@ -1,22 +1,29 @@
 #include "torch_xla/csrc/tensor_util.h"
 
 #include <algorithm>
+#include <cstring>
 #include <functional>
 #include <list>
 #include <numeric>
 #include <thread>
+#include <type_traits>
 
+#include "absl/strings/str_join.h"
+#include "tensorflow/compiler/xla/layout_util.h"
 #include "tensorflow/compiler/xla/literal_util.h"
 #include "tensorflow/compiler/xla/shape_util.h"
 #include "tensorflow/compiler/xla/xla_client/debug_macros.h"
+#include "tensorflow/compiler/xla/xla_client/metrics.h"
 #include "tensorflow/compiler/xla/xla_client/multi_wait.h"
 #include "tensorflow/compiler/xla/xla_client/sys_util.h"
 #include "tensorflow/compiler/xla/xla_client/tf_logging.h"
 #include "tensorflow/compiler/xla/xla_client/thread_pool.h"
 #include "tensorflow/compiler/xla/xla_client/util.h"
 #include "tensorflow/core/lib/bfloat16/bfloat16.h"
+#include "torch_xla/csrc/copy_kernels.h"
 #include "torch_xla/csrc/helpers.h"
 #include "torch_xla/csrc/layout_manager.h"
+#include "torch_xla/csrc/upload_batcher.h"
 
 namespace torch_xla {
 namespace {
@@ -77,12 +84,42 @@ xla::PrimitiveType XlaTypeFromTensorType(at::ScalarType scalar_type,
 template <typename S, typename D>
 void StridedCopy(D* dest, xla::int64 dest_stride, const S* source,
                  xla::int64 source_stride, xla::int64 n) {
+  if (std::is_same<S, D>::value && sizeof(S) == 4 && dest_stride == 1 &&
+      source_stride != 1) {
+    copy_kernels::StridedGather32(source, source_stride, dest, n);
+    return;
+  }
   const S* source_top = source + n * source_stride;
   for (; source < source_top; dest += dest_stride, source += source_stride) {
     *dest = static_cast<D>(*source);
   }
 }
 
+// Copies the rows x cols matrix at source, whose rows are source_ld elements
+// apart, transposed into dest, whose rows are dest_ld elements apart. The
+// matrices are walked in square tiles, so that both the reads and the writes
+// stay within the cache lines of the tile.
+template <typename S, typename D>
+void TransposeCopy(D* dest, xla::int64 dest_ld, const S* source,
+                   xla::int64 source_ld, xla::int64 rows, xla::int64 cols) {
+  if (std::is_same<S, D>::value && sizeof(S) == 4) {
+    copy_kernels::Transpose32(source, source_ld, dest, dest_ld, rows, cols);
+    return;
+  }
+  static const xla::int64 kTile = 32;
+  for (xla::int64 i0 = 0; i0 < rows; i0 += kTile) {
+    xla::int64 i1 = std::min(i0 + kTile, rows);
+    for (xla::int64 j0 = 0; j0 < cols; j0 += kTile) {
+      xla::int64 j1 = std::min(j0 + kTile, cols);
+      for (xla::int64 j = j0; j < j1; ++j) {
+        for (xla::int64 i = i0; i < i1; ++i) {
+          dest[j * dest_ld + i] = static_cast<D>(source[i * source_ld + j]);
+        }
+      }
+    }
+  }
+}
+
 // Computes the offset of the value at a given index, assuming a contiguous/flat
 // tensor data representation.
 template <typename S>
@@ -120,14 +157,18 @@ struct CopyType<true> {
 
 template <typename D, typename S>
 void CopyData(D* dest, const S* source, xla::int64 n, const CopyDirect&) {
-  std::copy(source, source + n, dest);
+  if (!copy_kernels::ConvertData(dest, source, n)) {
+    std::copy(source, source + n, dest);
+  }
 }
 
 template <typename D, typename S>
 void CopyData(D* dest, const S* source, xla::int64 n, const CopyCasted&) {
-  // Use strided copy with step 1 since it has the static_cast<> required to
-  // convert from/to bfloat16.
-  StridedCopy(dest, 1, source, 1, n);
+  if (!copy_kernels::ConvertData(dest, source, n)) {
+    // Use strided copy with step 1 since it has the static_cast<> required to
+    // convert from/to bfloat16.
+    StridedCopy(dest, 1, source, 1, n);
+  }
 }
 
 std::vector<xla::int64> GetIterationDimensions(const xla::Shape& shape) {
@@ -163,14 +204,20 @@ struct CopyPartition {
   std::vector<xla::int64> limit;
 };
 
+// The minimum number of elements copy that can be assigned to a thread.
+const xla::int64 kMinThreadElements = 100000;
+
+xla::int64 GetMaxCopyParts() {
+  // Use at most 50% of the available cores.
+  static const xla::int64 max_parts =
+      std::max<xla::int64>(std::thread::hardware_concurrency() / 2, 1);
+  return max_parts;
+}
+
 std::vector<CopyPartition> CreateCopyPartitions(
     tensorflow::gtl::ArraySlice<const xla::int64> dimensions,
     xla::int64 strided_copy_dimension) {
-  // The minimum number of elements copy that can be assigned to a thread.
-  static const xla::int64 kMinThreadElements = 100000;
-  // Use at most 50% of the available cores.
-  xla::int64 max_parts =
-      std::max<xla::int64>(std::thread::hardware_concurrency() / 2, 1);
+  xla::int64 max_parts = GetMaxCopyParts();
   // Find the maximum dimension which is not the strided copy dimension.
   xla::int64 max_dim = -1;
   for (xla::int64 i = 0; i < dimensions.size(); ++i) {
@@ -227,6 +274,53 @@ void SlicedCopy(tensorflow::gtl::ArraySlice<const xla::int64> dimensions,
   }
 }
 
+// Returns the most minor dimension of the shape layout which has a size
+// greater than one, or -1 if there is none.
+xla::int64 GetMinorDimension(const xla::Shape& shape) {
+  for (auto dim : shape.layout().minor_to_major()) {
+    if (shape.dimensions(dim) > 1) {
+      return dim;
+    }
+  }
+  return -1;
+}
+
+// Copies the part of the tensor as a sequence of transposes of the planes
+// made by the source and destination minor dimensions, which are contiguous
+// within the source and destination buffers respectively.
+template <typename SType, typename DType>
+void TransposedCopy(tensorflow::gtl::ArraySlice<const xla::int64> dimensions,
+                    const SType* src_data,
+                    tensorflow::gtl::ArraySlice<const xla::int64> src_strides,
+                    xla::int64 src_minor, DType* dest_data,
+                    tensorflow::gtl::ArraySlice<const xla::int64> dest_strides,
+                    xla::int64 dest_minor, const CopyPartition& part) {
+  std::vector<xla::int64> outer_dims;
+  for (xla::int64 dim = 0; dim < dimensions.size(); ++dim) {
+    if (dim != src_minor && dim != dest_minor) {
+      outer_dims.push_back(dim);
+    }
+  }
+  xla::int64 rows = part.limit[dest_minor] - part.base[dest_minor];
+  xla::int64 cols = part.limit[src_minor] - part.base[src_minor];
+  std::vector<xla::int64> indices(part.base);
+  size_t n = 0;
+  do {
+    TransposeCopy(dest_data + GetFlatTensorOffset(dest_strides, indices),
+                  dest_strides[src_minor],
+                  src_data + GetFlatTensorOffset(src_strides, indices),
+                  src_strides[dest_minor], rows, cols);
+    for (n = 0; n < outer_dims.size(); ++n) {
+      xla::int64 dim = outer_dims[n];
+      indices[dim] += 1;
+      if (indices[dim] < part.limit[dim]) {
+        break;
+      }
+      indices[dim] = part.base[dim];
+    }
+  } while (n < outer_dims.size());
+}
+
 template <typename SType, typename DType>
 void CopyTensors(const void* src_buffer, const xla::Shape& src_shape,
                  void* dest_buffer, size_t dest_buffer_size,
@@ -241,15 +335,55 @@ void CopyTensors(const void* src_buffer, const xla::Shape& src_shape,
   DType* dest_data = reinterpret_cast<DType*>(dest_buffer);
   if (src_shape.layout().minor_to_major() ==
       dest_shape.layout().minor_to_major()) {
-    CopyData<DType, SType>(dest_data, src_data, total_elements,
-                           typename CopyType < NeedCast<SType>::value ||
-                               NeedCast<DType>::value > ::type());
+    using CopyTag = typename CopyType < NeedCast<SType>::value ||
+                    NeedCast<DType>::value > ::type;
+    xla::int64 num_parts = std::min<xla::int64>(
+        GetMaxCopyParts(), total_elements / kMinThreadElements);
+    if (num_parts <= 1) {
+      CopyData<DType, SType>(dest_data, src_data, total_elements, CopyTag());
+    } else {
+      // Large flat copies are split into contiguous chunks, each one copied
+      // by a different thread.
+      xla::int64 part_size = (total_elements + num_parts - 1) / num_parts;
+      xla::util::MultiWait mwait(num_parts);
+      for (xla::int64 i = 0; i < num_parts; ++i) {
+        auto copy_fn = [&, i]() {
+          xla::int64 base = i * part_size;
+          xla::int64 n = std::min(part_size, total_elements - base);
+          if (n > 0) {
+            CopyData<DType, SType>(dest_data + base, src_data + base, n,
+                                   CopyTag());
+          }
+        };
+        xla::env::ScheduleClosure(mwait.Completer(std::move(copy_fn)));
+      }
+      mwait.Wait();
+    }
   } else if (total_elements > 0) {
     // We issue a multi-threaded copy by slicing the bigger dimension and
     // assigning its copy to different threads. This code is only valid for
     // ranks >= 2, but the layout check above covers the case.
     std::vector<xla::int64> src_strides = ComputeShapeStrides(src_shape);
     std::vector<xla::int64> dest_strides = ComputeShapeStrides(dest_shape);
+    xla::int64 src_minor = GetMinorDimension(src_shape);
+    xla::int64 dest_minor = GetMinorDimension(dest_shape);
+    if (src_minor >= 0 && dest_minor >= 0 && src_minor != dest_minor) {
+      // The layouts transpose the contiguous dimensions, which the strided
+      // copy would walk with cache line sized strides in one of the buffers.
+      std::vector<CopyPartition> parts =
+          CreateCopyPartitions(dest_shape.dimensions(), src_minor);
+      xla::util::MultiWait mwait(parts.size());
+      for (size_t i = 0; i < parts.size(); ++i) {
+        auto copy_fn = [&, i]() {
+          TransposedCopy<SType, DType>(dest_shape.dimensions(), src_data,
+                                       src_strides, src_minor, dest_data,
+                                       dest_strides, dest_minor, parts[i]);
+        };
+        xla::env::ScheduleClosure(mwait.Completer(std::move(copy_fn)));
+      }
+      mwait.Wait();
+      return;
+    }
     std::vector<xla::int64> iter_dims = GetIterationDimensions(dest_shape);
     std::vector<CopyPartition> parts =
         CreateCopyPartitions(dest_shape.dimensions(), iter_dims.front());
@@ -364,6 +498,34 @@ void PopulateTensorBuffer(const at::Tensor& tensor,
   }
 }
 
+// Whether the tensor memory has exactly the content PopulateTensorBuffer()
+// would write into a buffer of the given shape (contiguous tensor, same element
+// type and dense dim0-major layout).
+bool IsZeroCopySource(const at::Tensor& tensor, const xla::Shape& shape,
+                      const Device& device) {
+  static bool zero_copy =
+      xla::sys_util::GetEnvBool("XLA_ZERO_COPY_TRANSFERS", true);
+  return zero_copy && tensor.is_contiguous() &&
+         XlaTypeFromTensorType(tensor.type().scalarType(), device) ==
+             shape.element_type() &&
+         xla::ShapeUtil::ByteSizeOfPrimitiveType(shape.element_type()) ==
+             tensor.element_size() &&
+         xla::util::ToVector<xla::int64>(shape.dimensions()) ==
+             XlaHelpers::I64List(tensor.sizes()) &&
+         xla::LayoutUtil::IsMonotonicWithDim0Major(shape.layout());
+}
+
+// Exposes the tensor memory to the computation client, if suitable, so that it
+// can be transferred without extra copies.
+void SetZeroCopySource(const at::Tensor& tensor, const xla::Shape& shape,
+                       const Device& device,
+                       xla::ComputationClient::TensorSource* source) {
+  if (IsZeroCopySource(tensor, shape, device)) {
+    source->data = tensor.data_ptr();
+    source->data_owner = std::make_shared<at::Tensor>(tensor);
+  }
+}
+
 xla::ComputationClient::DataPtr TensorToXlaData(const at::Tensor& tensor,
                                                 const xla::Shape& shape,
                                                 const Device& device) {
@@ -376,6 +538,7 @@ xla::ComputationClient::DataPtr TensorToXlaData(const at::Tensor& tensor,
 
   std::vector<xla::ComputationClient::TensorSource> source_tensors;
   source_tensors.emplace_back(shape, device.ToString(), std::move(populate_fn));
+  SetZeroCopySource(tensor, shape, device, &source_tensors.back());
 
   auto handles =
       xla::ComputationClient::Get()->TransferToServer(source_tensors);
@@ -384,47 +547,80 @@ xla::ComputationClient::DataPtr TensorToXlaData(const at::Tensor& tensor,
 }
 
 template <typename SType, typename DType>
-at::Tensor XlaLiteralToTensor(const xla::Literal& literal,
-                              at::ScalarType atype) {
+at::Tensor XlaDataToTensor(const xla::Shape& shape, const void* data,
+                           at::ScalarType atype) {
   std::vector<int64_t> dimensions =
-      xla::util::ToVector<int64_t>(literal.shape().dimensions());
-  xla::Shape torch_shape = MakeTorchTensorLayout(
-      literal.shape().dimensions(), literal.shape().element_type());
+      xla::util::ToVector<int64_t>(shape.dimensions());
+  xla::Shape torch_shape =
+      MakeTorchTensorLayout(shape.dimensions(), shape.element_type());
   xla::int64 total_elements = xla::ShapeUtil::ElementsIn(torch_shape);
 
-  const auto literal_data = literal.data<SType>();
   at::Tensor tensor = at::empty(dimensions, at::TensorOptions(atype));
-  CopyTensors<SType, DType>(literal_data.data(), literal.shape(),
-                            tensor.data_ptr<DType>(),
+  CopyTensors<SType, DType>(data, shape, tensor.data_ptr<DType>(),
                             total_elements * sizeof(DType), torch_shape);
   return tensor;
 }
 
 template <typename SType>
-at::Tensor XlaLiteralToTensorHelper(const xla::Literal& literal,
-                                    at::ScalarType dest_element_type) {
+at::Tensor XlaDataToTensorHelper(const xla::Shape& shape, const void* data,
+                                 at::ScalarType dest_element_type) {
   switch (dest_element_type) {
     case at::ScalarType::Bool:
-      return XlaLiteralToTensor<SType, bool>(literal, dest_element_type);
+      return XlaDataToTensor<SType, bool>(shape, data, dest_element_type);
     case at::ScalarType::Byte:
-      return XlaLiteralToTensor<SType, uint8_t>(literal, dest_element_type);
+      return XlaDataToTensor<SType, uint8_t>(shape, data, dest_element_type);
     case at::ScalarType::Char:
-      return XlaLiteralToTensor<SType, int8_t>(literal, dest_element_type);
+      return XlaDataToTensor<SType, int8_t>(shape, data, dest_element_type);
     case at::ScalarType::Short:
-      return XlaLiteralToTensor<SType, int16_t>(literal, dest_element_type);
+      return XlaDataToTensor<SType, int16_t>(shape, data, dest_element_type);
     case at::ScalarType::Int:
-      return XlaLiteralToTensor<SType, int32_t>(literal, dest_element_type);
+      return XlaDataToTensor<SType, int32_t>(shape, data, dest_element_type);
     case at::ScalarType::Long:
-      return XlaLiteralToTensor<SType, int64_t>(literal, dest_element_type);
+      return XlaDataToTensor<SType, int64_t>(shape, data, dest_element_type);
     case at::ScalarType::Float:
-      return XlaLiteralToTensor<SType, float>(literal, dest_element_type);
+      return XlaDataToTensor<SType, float>(shape, data, dest_element_type);
     case at::ScalarType::Double:
-      return XlaLiteralToTensor<SType, double>(literal, dest_element_type);
+      return XlaDataToTensor<SType, double>(shape, data, dest_element_type);
     default:
       XLA_ERROR() << "Unsupported scalar type: " << dest_element_type;
   }
 }
 
+template <typename SType>
+at::Scalar XlaDataToScalarHelper(const void* data,
+                                 at::ScalarType dest_element_type) {
+  SType value = *reinterpret_cast<const SType*>(data);
+  switch (dest_element_type) {
+    case at::ScalarType::Bool:
+      return at::Scalar(static_cast<bool>(value));
+    case at::ScalarType::Byte:
+      return at::Scalar(static_cast<uint8_t>(value));
+    case at::ScalarType::Char:
+      return at::Scalar(static_cast<int8_t>(value));
+    case at::ScalarType::Short:
+      return at::Scalar(static_cast<int16_t>(value));
+    case at::ScalarType::Int:
+      return at::Scalar(static_cast<int32_t>(value));
+    case at::ScalarType::Long:
+      return at::Scalar(static_cast<int64_t>(value));
+    case at::ScalarType::Float:
+      return at::Scalar(static_cast<float>(value));
+    case at::ScalarType::Double:
+      return at::Scalar(static_cast<double>(value));
+    default:
+      XLA_ERROR() << "Unsupported scalar type: " << dest_element_type;
+  }
+}
+
+void WaitDataValues(
+    tensorflow::gtl::ArraySlice<const xla::ComputationClient::DataPtr>
+        xla_data) {
+  UploadBatcher::Get()->Flush();
+  for (auto& data : xla_data) {
+    data->WaitValue();
+  }
+}
+
 }  // namespace
 
 std::vector<xla::int64> ComputeShapeStrides(const xla::Shape& shape) {
@@ -437,39 +633,166 @@ std::vector<xla::int64> ComputeShapeStrides(const xla::Shape& shape) {
   return strides;
 }
 
+at::Tensor MakeTensorFromXlaData(const xla::Shape& shape, const void* data,
+                                 at::ScalarType dest_element_type) {
+  switch (shape.element_type()) {
+    case xla::PrimitiveType::PRED:
+      return XlaDataToTensorHelper<bool>(shape, data, dest_element_type);
+    case xla::PrimitiveType::BF16:
+      return XlaDataToTensorHelper<tensorflow::bfloat16>(shape, data,
+                                                         dest_element_type);
+    case xla::PrimitiveType::F32:
+      return XlaDataToTensorHelper<float>(shape, data, dest_element_type);
+    case xla::PrimitiveType::F64:
+      return XlaDataToTensorHelper<double>(shape, data, dest_element_type);
+    case xla::PrimitiveType::U8:
+      return XlaDataToTensorHelper<xla::uint8>(shape, data, dest_element_type);
+    case xla::PrimitiveType::S8:
+      return XlaDataToTensorHelper<xla::int8>(shape, data, dest_element_type);
+    case xla::PrimitiveType::S16:
+      return XlaDataToTensorHelper<xla::int16>(shape, data, dest_element_type);
+    case xla::PrimitiveType::S32:
+      return XlaDataToTensorHelper<xla::int32>(shape, data, dest_element_type);
+    case xla::PrimitiveType::S64:
+      return XlaDataToTensorHelper<xla::int64>(shape, data, dest_element_type);
+    default:
+      XLA_ERROR() << "Unsupported literal type: " << shape;
+  }
+}
+
 at::Tensor MakeTensorFromXlaLiteral(const xla::Literal& literal,
                                     at::ScalarType dest_element_type) {
-  switch (literal.shape().element_type()) {
+  return MakeTensorFromXlaData(literal.shape(), literal.untyped_data(),
+                               dest_element_type);
+}
+
+at::Scalar MakeScalarFromXlaData(const xla::Shape& shape, const void* data,
+                                 at::ScalarType dest_element_type) {
+  XLA_CHECK_EQ(xla::ShapeUtil::ElementsIn(shape), 1) << shape;
+  switch (shape.element_type()) {
     case xla::PrimitiveType::PRED:
-      return XlaLiteralToTensorHelper<bool>(literal, dest_element_type);
+      return XlaDataToScalarHelper<bool>(data, dest_element_type);
     case xla::PrimitiveType::BF16:
-      return XlaLiteralToTensorHelper<tensorflow::bfloat16>(literal,
-                                                            dest_element_type);
+      return XlaDataToScalarHelper<tensorflow::bfloat16>(data,
+                                                         dest_element_type);
     case xla::PrimitiveType::F32:
-      return XlaLiteralToTensorHelper<float>(literal, dest_element_type);
+      return XlaDataToScalarHelper<float>(data, dest_element_type);
     case xla::PrimitiveType::F64:
-      return XlaLiteralToTensorHelper<double>(literal, dest_element_type);
+      return XlaDataToScalarHelper<double>(data, dest_element_type);
     case xla::PrimitiveType::U8:
-      return XlaLiteralToTensorHelper<xla::uint8>(literal, dest_element_type);
+      return XlaDataToScalarHelper<xla::uint8>(data, dest_element_type);
     case xla::PrimitiveType::S8:
-      return XlaLiteralToTensorHelper<xla::int8>(literal, dest_element_type);
+      return XlaDataToScalarHelper<xla::int8>(data, dest_element_type);
     case xla::PrimitiveType::S16:
-      return XlaLiteralToTensorHelper<xla::int16>(literal, dest_element_type);
+      return XlaDataToScalarHelper<xla::int16>(data, dest_element_type);
     case xla::PrimitiveType::S32:
-      return XlaLiteralToTensorHelper<xla::int32>(literal, dest_element_type);
+      return XlaDataToScalarHelper<xla::int32>(data, dest_element_type);
     case xla::PrimitiveType::S64:
-      return XlaLiteralToTensorHelper<xla::int64>(literal, dest_element_type);
+      return XlaDataToScalarHelper<xla::int64>(data, dest_element_type);
     default:
-      XLA_ERROR() << "Unsupported literal type: " << literal.shape();
+      XLA_ERROR() << "Unsupported literal type: " << shape;
   }
 }
 
+std::vector<at::Tensor> XlaDataToTensors(
+    tensorflow::gtl::ArraySlice<const xla::ComputationClient::DataPtr>
+        xla_data,
+    tensorflow::gtl::ArraySlice<const at::ScalarType> dest_element_types) {
+  XLA_CHECK_EQ(xla_data.size(), dest_element_types.size());
+  std::vector<at::Tensor> tensors(xla_data.size());
+  auto data_fn = [&](size_t index, const xla::Shape& shape, const void* data,
+                     size_t size) {
+    tensors[index] =
+        MakeTensorFromXlaData(shape, data, dest_element_types[index]);
+  };
+  // The device data might be the placeholder of a deferred upload, or of an
+  // in-flight operation.
+  WaitDataValues(xla_data);
+  xla::ComputationClient::Get()->TransferFromServer(xla_data, data_fn);
+  return tensors;
+}
+
+std::vector<at::Scalar> XlaDataToScalars(
+    tensorflow::gtl::ArraySlice<const xla::ComputationClient::DataPtr>
+        xla_data,
+    tensorflow::gtl::ArraySlice<const at::ScalarType> dest_element_types) {
+  XLA_CHECK_EQ(xla_data.size(), dest_element_types.size());
+  std::vector<at::Scalar> scalars(xla_data.size());
+  auto data_fn = [&](size_t index, const xla::Shape& shape, const void* data,
+                     size_t size) {
+    scalars[index] =
+        MakeScalarFromXlaData(shape, data, dest_element_types[index]);
+  };
+  WaitDataValues(xla_data);
+  xla::ComputationClient::Get()->TransferFromServer(xla_data, data_fn);
+  return scalars;
+}
+
+std::vector<xla::Literal> XlaDataToLiterals(
+    tensorflow::gtl::ArraySlice<const xla::ComputationClient::DataPtr>
+        xla_data) {
+  WaitDataValues(xla_data);
+  return xla::ComputationClient::Get()->TransferFromServer(xla_data);
+}
+
 xla::ComputationClient::DataPtr TensorToXlaData(const at::Tensor& tensor,
                                                 const Device& device) {
   return TensorToXlaData(
       tensor, CreateComputationShapeFromTensor(tensor, &device), device);
 }
 
+at::Tensor PackBoolTensor(const at::Tensor& tensor) {
+  XLA_CHECK_EQ(tensor.scalar_type(), at::ScalarType::Bool);
+  at::Tensor contiguous = tensor.contiguous();
+  xla::int64 num_elements = contiguous.numel();
+  at::Tensor words = at::empty({(num_elements + 31) / 32},
+                               at::TensorOptions(at::ScalarType::Int));
+  XLA_COUNTER("PackedBoolTensors", 1);
+  uint32_t* dest = reinterpret_cast<uint32_t*>(words.data_ptr<int32_t>());
+  copy_kernels::PackBits32(contiguous.data_ptr<bool>(), dest, num_elements);
+  return words;
+}
+
+std::vector<xla::ComputationClient::DataPtr> MappedFileToXlaData(
+    std::shared_ptr<MappedFile> file,
+    tensorflow::gtl::ArraySlice<const size_t> offsets,
+    tensorflow::gtl::ArraySlice<const std::vector<xla::int64>> sizes,
+    at::ScalarType scalar_type, const Device& device) {
+  XLA_CHECK_EQ(offsets.size(), sizes.size());
+  std::vector<xla::ComputationClient::TensorSource> source_tensors;
+  for (size_t i = 0; i < offsets.size(); ++i) {
+    std::vector<int64_t> tensor_sizes(sizes[i].begin(), sizes[i].end());
+    size_t num_bytes = at::elementSize(scalar_type) *
+                       xla::util::Multiply<size_t>(tensor_sizes);
+    XLA_CHECK_LE(offsets[i] + num_bytes, file->size())
+        << "Region at offset " << offsets[i] << " with sizes "
+        << absl::StrJoin(sizes[i], ", ") << " is past the end of "
+        << file->path();
+    // The tensor only wraps the mapped pages, without copying them.
+    at::Tensor tensor =
+        at::from_blob(const_cast<char*>(file->data()) + offsets[i],
+                      tensor_sizes, at::TensorOptions(scalar_type));
+    xla::Shape shape = CreateComputationShapeFromTensor(tensor, &device);
+    auto populate_fn =
+        [file, tensor, device](
+            const xla::ComputationClient::TensorSource& source_tensor,
+            void* dest_buffer, size_t dest_buffer_size) {
+          PopulateTensorBuffer(tensor, source_tensor.shape, dest_buffer,
+                               dest_buffer_size, device);
+        };
+    source_tensors.emplace_back(std::move(shape), device.ToString(),
+                                std::move(populate_fn));
+    SetZeroCopySource(tensor, source_tensors.back().shape, device,
+                      &source_tensors.back());
+    if (source_tensors.back().data != nullptr) {
+      // The pages must stay mapped until the transfer is done with them.
+      source_tensors.back().data_owner = file;
+    }
+  }
+  XLA_COUNTER("MappedFileUploads", source_tensors.size());
+  return xla::ComputationClient::Get()->TransferToServer(source_tensors);
+}
+
 std::vector<xla::ComputationClient::DataPtr> CreateTensorsData(
     const std::vector<at::Tensor>& tensors,
     const std::vector<std::string>& devices) {
@@ -486,10 +809,17 @@ std::vector<xla::ComputationClient::DataPtr> CreateTensorsData(
         };
     source_tensors.emplace_back(std::move(shape), devices[i],
                                 std::move(populate_fn));
+    SetZeroCopySource(tensors[i], source_tensors.back().shape, device,
+                      &source_tensors.back());
   }
   return xla::ComputationClient::Get()->TransferToServer(source_tensors);
 }
 
+bool IsZeroCopySource(const at::Tensor& tensor, const Device& device) {
+  return IsZeroCopySource(
+      tensor, CreateComputationShapeFromTensor(tensor, &device), device);
+}
+
 xla::Literal GetTensorLiteral(const at::Tensor& tensor, const xla::Shape* shape,
                               const Device* device) {
   if (device == nullptr) {
@@ -509,28 +839,52 @@ xla::Literal GetTensorLiteral(const at::Tensor& tensor, const xla::Shape* shape,
 }
 
 size_t TensorHash(const at::Tensor& tensor) {
-  at::Tensor ctensor = tensor.contiguous();
-  int64_t size = ctensor.numel() * ctensor.element_size();
-  switch (ctensor.scalar_type()) {
-    case at::ScalarType::Bool:
-      return xla::util::DataHash(ctensor.data_ptr<bool>(), size);
-    case at::ScalarType::Byte:
-      return xla::util::DataHash(ctensor.data_ptr<uint8_t>(), size);
-    case at::ScalarType::Char:
-      return xla::util::DataHash(ctensor.data_ptr<int8_t>(), size);
-    case at::ScalarType::Short:
-      return xla::util::DataHash(ctensor.data_ptr<int16_t>(), size);
-    case at::ScalarType::Int:
-      return xla::util::DataHash(ctensor.data_ptr<int32_t>(), size);
-    case at::ScalarType::Long:
-      return xla::util::DataHash(ctensor.data_ptr<int64_t>(), size);
-    case at::ScalarType::Float:
-      return xla::util::DataHash(ctensor.data_ptr<float>(), size);
-    case at::ScalarType::Double:
-      return xla::util::DataHash(ctensor.data_ptr<double>(), size);
-    default:
-      XLA_ERROR() << "Unsupported scalar type: " << ctensor.scalar_type();
+  // The element bytes are hashed in row major order, in blocks of
+  // kHashBlockSize bytes. The blocks are hashed in place for contiguous
+  // tensors, and gathered into a bounded buffer otherwise, so that the result
+  // does not depend on the strides, and no contiguous copy is ever made.
+  static const size_t kHashBlockSize = 64 * 1024;
+  const char* data = static_cast<const char*>(tensor.data_ptr());
+  size_t element_size = tensor.element_size();
+  size_t hash = xla::util::MHash();
+  if (tensor.is_contiguous()) {
+    size_t size = tensor.numel() * element_size;
+    for (size_t offset = 0; offset < size; offset += kHashBlockSize) {
+      hash = xla::util::HashCombine(
+          hash, xla::util::DataHash(data + offset,
+                                    std::min(kHashBlockSize, size - offset)));
+    }
+    return hash;
+  }
+  auto sizes = tensor.sizes();
+  auto strides = tensor.strides();
+  std::vector<int64_t> index(sizes.size(), 0);
+  std::vector<char> block(kHashBlockSize);
+  size_t block_size = 0;
+  int64_t offset = 0;
+  for (int64_t i = 0; i < tensor.numel(); ++i) {
+    std::memcpy(block.data() + block_size, data + offset * element_size,
+                element_size);
+    block_size += element_size;
+    if (block_size == kHashBlockSize) {
+      hash = xla::util::HashCombine(
+          hash, xla::util::DataHash(block.data(), block_size));
+      block_size = 0;
+    }
+    for (int64_t dim = sizes.size() - 1; dim >= 0; --dim) {
+      offset += strides[dim];
+      if (++index[dim] < sizes[dim]) {
+        break;
+      }
+      offset -= sizes[dim] * strides[dim];
+      index[dim] = 0;
+    }
+  }
+  if (block_size > 0) {
+    hash = xla::util::HashCombine(
+        hash, xla::util::DataHash(block.data(), block_size));
   }
+  return hash;
 }
 
 std::vector<xla::Shape> GetComponentShapes(const xla::Shape& shape) {
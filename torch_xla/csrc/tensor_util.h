@@ -1,5 +1,6 @@
 #pragma once
 
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -10,6 +11,7 @@
 #include "tensorflow/core/lib/gtl/array_slice.h"
 #include "torch/csrc/autograd/variable.h"
 #include "torch_xla/csrc/device.h"
+#include "torch_xla/csrc/mapped_file.h"
 
 namespace torch_xla {
 
@@ -19,11 +21,55 @@ std::vector<xla::int64> ComputeShapeStrides(const xla::Shape& shape);
 at::Tensor MakeTensorFromXlaLiteral(const xla::Literal& literal,
                                     at::ScalarType dest_element_type);
 
+// Converts the dense data of the given shape (and layout) to an at::Tensor of
+// the given element type.
+at::Tensor MakeTensorFromXlaData(const xla::Shape& shape, const void* data,
+                                 at::ScalarType dest_element_type);
+
+// Fetches the device data and converts it to at::Tensor values of the given
+// element types, without going through intermediate XLA literals.
+std::vector<at::Tensor> XlaDataToTensors(
+    tensorflow::gtl::ArraySlice<const xla::ComputationClient::DataPtr>
+        xla_data,
+    tensorflow::gtl::ArraySlice<const at::ScalarType> dest_element_types);
+
+// Converts the single element of the dense data of the given shape to an
+// at::Scalar, as the given element type would read it.
+at::Scalar MakeScalarFromXlaData(const xla::Shape& shape, const void* data,
+                                 at::ScalarType dest_element_type);
+
+// Fetches the single element device data as at::Scalar values, without any
+// at::Tensor allocation.
+std::vector<at::Scalar> XlaDataToScalars(
+    tensorflow::gtl::ArraySlice<const xla::ComputationClient::DataPtr>
+        xla_data,
+    tensorflow::gtl::ArraySlice<const at::ScalarType> dest_element_types);
+
+// Fetches the device data as XLA literals, waiting for the pending values.
+std::vector<xla::Literal> XlaDataToLiterals(
+    tensorflow::gtl::ArraySlice<const xla::ComputationClient::DataPtr>
+        xla_data);
+
 // Uploads an ATEN tensor data to the device and fetches the corresponding
 // device data handle.
 xla::ComputationClient::DataPtr TensorToXlaData(const at::Tensor& tensor,
                                                 const Device& device);
 
+// Uploads the dense, row major arrays stored within the mapped file, starting
+// at the given offsets and having the given sizes and type, to the device.
+// The mapped pages are handed over to the transfer as they are, if their
+// type and layout match the device ones, or converted straight into the
+// transfer buffers otherwise, with no intermediate host copy.
+std::vector<xla::ComputationClient::DataPtr> MappedFileToXlaData(
+    std::shared_ptr<MappedFile> file,
+    tensorflow::gtl::ArraySlice<const size_t> offsets,
+    tensorflow::gtl::ArraySlice<const std::vector<xla::int64>> sizes,
+    at::ScalarType scalar_type, const Device& device);
+
+// Returns the rank 1 int32 tensor holding the elements of the bool tensor,
+// bit packed in row major order by copy_kernels::PackBits32().
+at::Tensor PackBoolTensor(const at::Tensor& tensor);
+
 size_t TensorHash(const at::Tensor& tensor);
 
 // Retrieves the device data handles by parallel uploading data onto the
@@ -52,6 +98,10 @@ xla::Shape MakeShapeWithDeviceLayout(const xla::Shape& shape,
 xla::Shape CreateComputationShapeFromTensor(const at::Tensor& tensor,
                                             const Device* device);
 
+// Whether the transfers of the tensor to the device read its memory as it is,
+// without copying it into a transfer buffer first.
+bool IsZeroCopySource(const at::Tensor& tensor, const Device& device);
+
 at::ScalarType TensorTypeFromXlaType(xla::PrimitiveType xla_type);
 
 // Maps an XLA type to the one which can be used on the given device (or the
@@ -0,0 +1,69 @@
+#include "torch_xla/csrc/upload_batcher.h"
+
+#include "tensorflow/compiler/xla/xla_client/debug_macros.h"
+#include "tensorflow/compiler/xla/xla_client/metrics.h"
+#include "tensorflow/compiler/xla/xla_client/sys_util.h"
+#include "torch_xla/csrc/tensor_util.h"
+
+namespace torch_xla {
+
+UploadBatcher* UploadBatcher::Get() {
+  static bool enabled = xla::sys_util::GetEnvBool("XLA_BATCH_UPLOADS", false);
+  static size_t max_tensor_bytes =
+      xla::sys_util::GetEnvInt("XLA_BATCH_UPLOADS_MAX_BYTES", 1024);
+  static UploadBatcher* batcher = new UploadBatcher(enabled, max_tensor_bytes);
+  return batcher;
+}
+
+xla::ComputationClient::DataPtr UploadBatcher::Add(const at::Tensor& tensor,
+                                                   const Device& device) {
+  if (!enabled_ || tensor.numel() * tensor.element_size() > max_tensor_bytes_) {
+    return nullptr;
+  }
+  std::string device_str = device.ToString();
+  xla::ComputationClient::DataPtr data =
+      xla::ComputationClient::Get()->CreateDataPlaceholder(
+          device_str, CreateComputationShapeFromTensor(tensor, &device));
+  std::lock_guard<std::mutex> lock(mutex_);
+  pending_.push_back({tensor, std::move(device_str), data});
+  XLA_COUNTER("BatchedUploadsDeferred", 1);
+  return data;
+}
+
+void UploadBatcher::Flush() {
+  if (!enabled_) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (pending_.empty()) {
+    return;
+  }
+  std::vector<at::Tensor> tensors;
+  std::vector<std::string> devices;
+  tensors.reserve(pending_.size());
+  devices.reserve(pending_.size());
+  for (auto& upload : pending_) {
+    tensors.push_back(upload.tensor);
+    devices.push_back(upload.device);
+  }
+  std::vector<xla::ComputationClient::DataPtr> handles;
+  try {
+    handles = CreateTensorsData(tensors, devices);
+  } catch (...) {
+    // The placeholders will never get their values, so wake up their waiters.
+    std::exception_ptr exptr = std::current_exception();
+    for (auto& upload : pending_) {
+      upload.data->SetError(exptr);
+    }
+    pending_.clear();
+    throw;
+  }
+  XLA_CHECK_EQ(handles.size(), pending_.size());
+  for (size_t i = 0; i < handles.size(); ++i) {
+    pending_[i].data->Assign(*handles[i]);
+  }
+  XLA_COUNTER("BatchedUploadsFlushes", 1);
+  pending_.clear();
+}
+
+}  // namespace torch_xla
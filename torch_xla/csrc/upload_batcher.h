@@ -0,0 +1,51 @@
+#pragma once
+
+#include <ATen/ATen.h>
+
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "tensorflow/compiler/xla/xla_client/computation_client.h"
+#include "torch_xla/csrc/device.h"
+
+namespace torch_xla {
+
+// Defers the upload of small tensors (like the scalars used as computation
+// parameters) to the devices, so that all the ones created while tracing a
+// step are transferred together, right before the first operation which may
+// need them. Together with XLA_TRANSFER_PACK_MAX_BYTES, this turns the many
+// tiny per-scalar transfers into a single packed one.
+class UploadBatcher {
+ public:
+  static UploadBatcher* Get();
+
+  UploadBatcher(bool enabled, size_t max_tensor_bytes)
+      : enabled_(enabled), max_tensor_bytes_(max_tensor_bytes) {}
+
+  // Returns placeholder device data which gets populated with the tensor value
+  // at the next Flush() call, or nullptr if the tensor upload should not be
+  // deferred. The tensor must not be modified until then.
+  xla::ComputationClient::DataPtr Add(const at::Tensor& tensor,
+                                      const Device& device);
+
+  // Uploads all the pending tensors and assigns them to their placeholders.
+  // Must be called before any device data returned by Add() is used.
+  void Flush();
+
+ private:
+  struct PendingUpload {
+    at::Tensor tensor;
+    std::string device;
+    xla::ComputationClient::DataPtr data;
+  };
+
+  bool enabled_ = false;
+  size_t max_tensor_bytes_ = 0;
+  // Held for the whole Flush(), so that concurrent callers wait for the
+  // placeholders to be populated.
+  std::mutex mutex_;
+  std::vector<PendingUpload> pending_;
+};
+
+}  // namespace torch_xla
@@ -0,0 +1,278 @@
+#include "torch_xla/csrc/upsample.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "tensorflow/compiler/xla/client/lib/slicing.h"
+#include "tensorflow/compiler/xla/xla_client/debug_macros.h"
+#include "tensorflow/compiler/xla/xla_client/util.h"
+#include "torch_xla/csrc/helpers.h"
+#include "torch_xla/csrc/xla_lower_util.h"
+
+namespace torch_xla {
+namespace {
+
+// The integer factor a nearest upsampling scales a dimension by, if any.
+struct NearestScale {
+  xla::int64 upscale = 0;
+  xla::int64 downscale = 0;
+};
+
+// The source indices of the nearest upsampling of a dimension, with the float
+// arithmetic of the ATen kernels.
+std::vector<xla::int64> NearestIndices(xla::int64 input_size,
+                                       xla::int64 output_size) {
+  float scale = static_cast<float>(input_size) / output_size;
+  std::vector<xla::int64> indices;
+  indices.reserve(output_size);
+  for (xla::int64 i = 0; i < output_size; ++i) {
+    indices.push_back(std::min(static_cast<xla::int64>(std::floor(i * scale)),
+                               input_size - 1));
+  }
+  return indices;
+}
+
+NearestScale GetNearestScale(const std::vector<xla::int64>& indices,
+                             xla::int64 input_size) {
+  xla::int64 output_size = indices.size();
+  NearestScale scale;
+  if (output_size % input_size == 0) {
+    xla::int64 factor = output_size / input_size;
+    bool matches = true;
+    for (xla::int64 i = 0; i < output_size && matches; ++i) {
+      matches = indices[i] == i / factor;
+    }
+    scale.upscale = matches ? factor : 0;
+  } else if (input_size % output_size == 0) {
+    xla::int64 factor = input_size / output_size;
+    bool matches = true;
+    for (xla::int64 i = 0; i < output_size && matches; ++i) {
+      matches = indices[i] == i * factor;
+    }
+    scale.downscale = matches ? factor : 0;
+  }
+  return scale;
+}
+
+// The two source indices, and their weights, of every output element of the
+// linear interpolation of a dimension.
+struct LinearCoefficients {
+  std::vector<xla::int64> low_indices;
+  std::vector<xla::int64> high_indices;
+  std::vector<float> low_weights;
+  std::vector<float> high_weights;
+};
+
+LinearCoefficients GetLinearCoefficients(xla::int64 input_size,
+                                         xla::int64 output_size,
+                                         bool align_corners) {
+  float scale = 0;
+  if (align_corners) {
+    scale = output_size > 1
+                ? static_cast<float>(input_size - 1) / (output_size - 1)
+                : 0;
+  } else {
+    scale = static_cast<float>(input_size) / output_size;
+  }
+  LinearCoefficients coefficients;
+  for (xla::int64 i = 0; i < output_size; ++i) {
+    float source = align_corners ? scale * i
+                                 : std::max(scale * (i + 0.5f) - 0.5f, 0.0f);
+    xla::int64 low = static_cast<xla::int64>(source);
+    float high_weight = source - low;
+    coefficients.low_indices.push_back(low);
+    coefficients.high_indices.push_back(low < input_size - 1 ? low + 1 : low);
+    coefficients.low_weights.push_back(1.0f - high_weight);
+    coefficients.high_weights.push_back(high_weight);
+  }
+  return coefficients;
+}
+
+xla::XlaOp MakeIndices(tensorflow::gtl::ArraySlice<const xla::int64> indices,
+                       xla::XlaBuilder* builder) {
+  return xla::ConstantR1<xla::int64>(builder, indices);
+}
+
+// Multiplies the input by the weights, broadcast along dim.
+xla::XlaOp ScaleAlongDim(const xla::XlaOp& input, xla::int64 dim,
+                         tensorflow::gtl::ArraySlice<const float> weights) {
+  xla::XlaOp weights_op = xla::ConvertElementType(
+      xla::ConstantR1<float>(input.builder(), weights),
+      XlaHelpers::TypeOfXlaOp(input));
+  return xla::Mul(input, weights_op, /*broadcast_dimensions=*/{dim});
+}
+
+// Returns a zero tensor with the shape of the input, other than for having
+// size elements along dim.
+xla::XlaOp ZerosWithDimSize(const xla::XlaOp& input, xla::int64 dim,
+                            xla::int64 size) {
+  std::vector<xla::int64> sizes = XlaHelpers::SizesOfXlaOp(input);
+  sizes[dim] = size;
+  return xla::Broadcast(
+      XlaHelpers::ScalarValue<float>(0, XlaHelpers::TypeOfXlaOp(input),
+                                     input.builder()),
+      sizes);
+}
+
+xla::XlaOp UpsampleNearestDim(const xla::XlaOp& input, xla::int64 dim,
+                              xla::int64 output_size) {
+  std::vector<xla::int64> sizes = XlaHelpers::SizesOfXlaOp(input);
+  xla::int64 input_size = sizes[dim];
+  if (input_size == output_size) {
+    return input;
+  }
+  std::vector<xla::int64> indices = NearestIndices(input_size, output_size);
+  NearestScale scale = GetNearestScale(indices, input_size);
+  if (scale.upscale > 0) {
+    // Repeats every element scale.upscale times, by broadcasting along a new
+    // dimension following dim, which is then collapsed into it.
+    std::vector<xla::int64> broadcast_sizes(sizes);
+    broadcast_sizes.insert(broadcast_sizes.begin() + dim + 1, scale.upscale);
+    std::vector<xla::int64> broadcast_dims;
+    for (xla::int64 i = 0; i < sizes.size(); ++i) {
+      broadcast_dims.push_back(i <= dim ? i : i + 1);
+    }
+    sizes[dim] = output_size;
+    return xla::Reshape(
+        xla::BroadcastInDim(input, broadcast_sizes, broadcast_dims), sizes);
+  }
+  if (scale.downscale > 0) {
+    return xla::SliceInDim(input, 0, input_size, scale.downscale, dim);
+  }
+  return xla::TorchIndexSelect(input, MakeIndices(indices, input.builder()),
+                               dim);
+}
+
+xla::XlaOp UpsampleNearestBackwardDim(const xla::XlaOp& grad_output,
+                                      xla::int64 dim, xla::int64 input_size) {
+  std::vector<xla::int64> sizes = XlaHelpers::SizesOfXlaOp(grad_output);
+  xla::int64 output_size = sizes[dim];
+  if (input_size == output_size) {
+    return grad_output;
+  }
+  std::vector<xla::int64> indices = NearestIndices(input_size, output_size);
+  NearestScale scale = GetNearestScale(indices, input_size);
+  xla::PrimitiveType type = XlaHelpers::TypeOfXlaOp(grad_output);
+  xla::XlaOp zero =
+      XlaHelpers::ScalarValue<float>(0, type, grad_output.builder());
+  if (scale.upscale > 0) {
+    std::vector<xla::int64> window(sizes.size(), 1);
+    window[dim] = scale.upscale;
+    return xla::ReduceWindow(grad_output, zero,
+                             XlaHelpers::CreateAddComputation(type), window,
+                             /*window_strides=*/window, xla::Padding::kValid);
+  }
+  if (scale.downscale > 0) {
+    xla::PaddingConfig padding_config;
+    for (xla::int64 i = 0; i < sizes.size(); ++i) {
+      auto* dims = padding_config.add_dimensions();
+      dims->set_edge_padding_low(0);
+      dims->set_edge_padding_high(i == dim ? scale.downscale - 1 : 0);
+      dims->set_interior_padding(i == dim ? scale.downscale - 1 : 0);
+    }
+    return xla::Pad(grad_output, zero, padding_config);
+  }
+  return CreateIndexAdd(ZerosWithDimSize(grad_output, dim, input_size), dim,
+                        MakeIndices(indices, grad_output.builder()),
+                        grad_output);
+}
+
+xla::XlaOp UpsampleBilinearDim(const xla::XlaOp& input, xla::int64 dim,
+                               xla::int64 output_size, bool align_corners) {
+  xla::int64 input_size = XlaHelpers::SizesOfXlaOp(input)[dim];
+  if (input_size == output_size) {
+    return input;
+  }
+  LinearCoefficients coefficients =
+      GetLinearCoefficients(input_size, output_size, align_corners);
+  xla::XlaOp low = xla::TorchIndexSelect(
+      input, MakeIndices(coefficients.low_indices, input.builder()), dim);
+  xla::XlaOp high = xla::TorchIndexSelect(
+      input, MakeIndices(coefficients.high_indices, input.builder()), dim);
+  return ScaleAlongDim(low, dim, coefficients.low_weights) +
+         ScaleAlongDim(high, dim, coefficients.high_weights);
+}
+
+xla::XlaOp UpsampleBilinearBackwardDim(const xla::XlaOp& grad_output,
+                                       xla::int64 dim, xla::int64 input_size,
+                                       bool align_corners) {
+  xla::int64 output_size = XlaHelpers::SizesOfXlaOp(grad_output)[dim];
+  if (input_size == output_size) {
+    return grad_output;
+  }
+  LinearCoefficients coefficients =
+      GetLinearCoefficients(input_size, output_size, align_corners);
+  // Both the low and the high contributions go through a single scatter-add.
+  std::vector<xla::int64> indices(coefficients.low_indices);
+  indices.insert(indices.end(), coefficients.high_indices.begin(),
+                 coefficients.high_indices.end());
+  xla::XlaOp updates = xla::ConcatInDim(
+      grad_output.builder(),
+      {ScaleAlongDim(grad_output, dim, coefficients.low_weights),
+       ScaleAlongDim(grad_output, dim, coefficients.high_weights)},
+      dim);
+  return CreateIndexAdd(ZerosWithDimSize(grad_output, dim, input_size), dim,
+                        MakeIndices(indices, grad_output.builder()), updates);
+}
+
+xla::int64 GetSpatialDimOffset(const xla::XlaOp& input,
+                               xla::int64 num_spatial_dims) {
+  xla::int64 rank = XlaHelpers::ShapeOfXlaOp(input).rank();
+  XLA_CHECK_LE(num_spatial_dims, rank);
+  return rank - num_spatial_dims;
+}
+
+}  // namespace
+
+xla::XlaOp BuildUpsampleNearest(
+    const xla::XlaOp& input,
+    tensorflow::gtl::ArraySlice<const xla::int64> output_size) {
+  xla::int64 dim_offset = GetSpatialDimOffset(input, output_size.size());
+  xla::XlaOp output = input;
+  for (xla::int64 i = 0; i < output_size.size(); ++i) {
+    output = UpsampleNearestDim(output, dim_offset + i, output_size[i]);
+  }
+  return output;
+}
+
+xla::XlaOp BuildUpsampleNearestBackward(
+    const xla::XlaOp& grad_output,
+    tensorflow::gtl::ArraySlice<const xla::int64> input_size) {
+  XLA_CHECK_EQ(XlaHelpers::ShapeOfXlaOp(grad_output).rank(),
+               input_size.size());
+  xla::XlaOp grad = grad_output;
+  for (xla::int64 dim = input_size.size() - 1; dim >= 0; --dim) {
+    grad = UpsampleNearestBackwardDim(grad, dim, input_size[dim]);
+  }
+  return grad;
+}
+
+xla::XlaOp BuildUpsampleBilinear(
+    const xla::XlaOp& input,
+    tensorflow::gtl::ArraySlice<const xla::int64> output_size,
+    bool align_corners) {
+  xla::int64 dim_offset = GetSpatialDimOffset(input, output_size.size());
+  xla::XlaOp output = input;
+  for (xla::int64 i = 0; i < output_size.size(); ++i) {
+    output = UpsampleBilinearDim(output, dim_offset + i, output_size[i],
+                                 align_corners);
+  }
+  return output;
+}
+
+xla::XlaOp BuildUpsampleBilinearBackward(
+    const xla::XlaOp& grad_output,
+    tensorflow::gtl::ArraySlice<const xla::int64> input_size,
+    bool align_corners) {
+  XLA_CHECK_EQ(XlaHelpers::ShapeOfXlaOp(grad_output).rank(),
+               input_size.size());
+  xla::XlaOp grad = grad_output;
+  for (xla::int64 dim = input_size.size() - 1; dim >= 0; --dim) {
+    grad = UpsampleBilinearBackwardDim(grad, dim, input_size[dim],
+                                       align_corners);
+  }
+  return grad;
+}
+
+}  // namespace torch_xla
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "tensorflow/compiler/xla/client/xla_builder.h"
+#include "tensorflow/compiler/xla/types.h"
+#include "tensorflow/core/lib/gtl/array_slice.h"
+
+namespace torch_xla {
+
+// Nearest neighbor upsampling of the trailing output_size.size() dimensions of
+// the input, with the source index of an output element being
+// floor(index * input_size / output_size). Dimensions scaled by an integer
+// factor are lowered as broadcasts (upscaling) or strided slices
+// (downscaling), the other ones as gathers.
+xla::XlaOp BuildUpsampleNearest(
+    const xla::XlaOp& input,
+    tensorflow::gtl::ArraySlice<const xla::int64> output_size);
+
+// Computes the gradient of BuildUpsampleNearest(), where input_size is the full
+// shape of the upsampled input. Upscaling integer factors are lowered as sum
+// reduce windows, downscaling ones as interior paddings, and the other ones as
+// scatter-adds.
+xla::XlaOp BuildUpsampleNearestBackward(
+    const xla::XlaOp& grad_output,
+    tensorflow::gtl::ArraySlice<const xla::int64> input_size);
+
+// Bilinear (linear per dimension) upsampling of the trailing
+// output_size.size() dimensions of the input, lowered as two gathers per
+// dimension, weighted by the interpolation coefficients.
+xla::XlaOp BuildUpsampleBilinear(
+    const xla::XlaOp& input,
+    tensorflow::gtl::ArraySlice<const xla::int64> output_size,
+    bool align_corners);
+
+// Computes the gradient of BuildUpsampleBilinear(), where input_size is the
+// full shape of the upsampled input, as one scatter-add per dimension.
+xla::XlaOp BuildUpsampleBilinearBackward(
+    const xla::XlaOp& grad_output,
+    tensorflow::gtl::ArraySlice<const xla::int64> input_size,
+    bool align_corners);
+
+}  // namespace torch_xla
@@ -2,15 +2,19 @@
 
 #include <algorithm>
 #include <functional>
+#include <iterator>
 #include <numeric>
 
 #include "tensorflow/compiler/xla/shape_util.h"
 #include "tensorflow/compiler/xla/util.h"
 #include "tensorflow/compiler/xla/xla_client/debug_macros.h"
+#include "tensorflow/compiler/xla/xla_client/metrics.h"
+#include "tensorflow/compiler/xla/xla_client/sys_util.h"
 #include "tensorflow/compiler/xla/xla_client/util.h"
 #include "torch_xla/csrc/helpers.h"
 #include "torch_xla/csrc/ops/as_strided.h"
 #include "torch_xla/csrc/ops/as_strided_view_update.h"
+#include "torch_xla/csrc/ops/cat.h"
 #include "torch_xla/csrc/ops/generic_slice.h"
 #include "torch_xla/csrc/ops/ops.h"
 #include "torch_xla/csrc/ops/permute.h"
@@ -48,7 +52,7 @@ ir::Value ApplyViewInfo(ir::Value ir_value, const ViewInfo& view_info) {
       return ir::MakeNode<ir::ops::AsStrided>(
           ir_value,
           xla::util::ToVector<xla::int64>(view_info.shape.dimensions()),
-          view_info.as_strided->offset);
+          view_info.as_strided->stride, view_info.as_strided->offset);
     default:
       XLA_ERROR() << "Invalid view type: "
                   << xla::util::GetEnumValue(view_info.view_type);
@@ -57,9 +61,11 @@ ir::Value ApplyViewInfo(ir::Value ir_value, const ViewInfo& view_info) {
 
 ir::Value ApplyUpdate(ir::Value ir_value,
                       const Alias::UpdateData& update_data) {
-  // We first bring the source IR value forward, by reshaping and slicing.
+  // We first bring the source IR value forward, by reshaping and slicing. The
+  // value of the last view is the one being replaced by the update, so it is
+  // not needed.
   std::vector<ir::Value> tmp_values({ir_value});
-  for (size_t i = 0; i < update_data.view_infos.size(); ++i) {
+  for (size_t i = 0; i + 1 < update_data.view_infos.size(); ++i) {
     const ViewInfo& view_info = update_data.view_infos[i];
     tmp_values.push_back(ApplyViewInfo(tmp_values.back(), view_info));
   }
@@ -94,7 +100,7 @@ ir::Value ApplyUpdate(ir::Value ir_value,
       case ViewInfo::Type::kAsStrided:
         result = ir::MakeNode<ir::ops::AsStridedViewUpdate>(
             tmp_values[i - 1], result, view_info.sizes,
-            view_info.as_strided->offset);
+            view_info.as_strided->stride, view_info.as_strided->offset);
         break;
       default:
         XLA_ERROR() << "Invalid view type: "
@@ -104,6 +110,164 @@ ir::Value ApplyUpdate(ir::Value ir_value,
   return result;
 }
 
+// The region of the alias's IR value which is written by an update, expressed
+// as a box within the alias coordinates.
+struct UpdateRegion {
+  std::vector<xla::int64> base;
+  std::vector<xla::int64> sizes;
+  // Whether the update IR value has the shape of the box itself. This is not
+  // the case when the path contains shape changing (but element preserving)
+  // views like reshapes and permutes.
+  bool is_box_value = true;
+};
+
+// Returns the region written by an update with the given view path, or
+// absl::nullopt if the written elements cannot be represented as a box.
+absl::optional<UpdateRegion> GetUpdateRegion(
+    const xla::Shape& alias_shape, const std::vector<ViewInfo>& view_infos) {
+  UpdateRegion region;
+  region.base.resize(alias_shape.rank(), 0);
+  region.sizes = xla::util::ToVector<xla::int64>(alias_shape.dimensions());
+  for (auto& view_info : view_infos) {
+    switch (view_info.view_type) {
+      case ViewInfo::Type::kNoOp:
+        break;
+      case ViewInfo::Type::kNarrow:
+        if (!region.is_box_value ||
+            view_info.shape.rank() != alias_shape.rank()) {
+          return absl::nullopt;
+        }
+        for (size_t dim = 0; dim < region.sizes.size(); ++dim) {
+          region.base[dim] += view_info.indices[dim];
+          region.sizes[dim] = view_info.shape.dimensions(dim);
+        }
+        break;
+      case ViewInfo::Type::kSelect: {
+        xla::int64 dim = view_info.select->dim;
+        if (!region.is_box_value || view_info.select->stride != 1 ||
+            view_info.shape.rank() != alias_shape.rank()) {
+          return absl::nullopt;
+        }
+        region.base[dim] += view_info.select->start;
+        region.sizes[dim] = view_info.shape.dimensions(dim);
+        break;
+      }
+      case ViewInfo::Type::kPermute:
+      case ViewInfo::Type::kReshape:
+        // These write all the elements of their source, but their coordinates
+        // no longer map to the alias ones, so no further narrowing is allowed.
+        region.is_box_value = false;
+        break;
+      default:
+        return absl::nullopt;
+    }
+  }
+  return region;
+}
+
+bool RegionContains(const UpdateRegion& outer, const UpdateRegion& inner) {
+  for (size_t dim = 0; dim < outer.sizes.size(); ++dim) {
+    if (inner.base[dim] < outer.base[dim] ||
+        inner.base[dim] + inner.sizes[dim] >
+            outer.base[dim] + outer.sizes[dim]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Tells whether a later update fully overwrites the elements written by an
+// earlier one, in which case the latter can be dropped.
+bool IsOverwritten(const xla::Shape& alias_shape,
+                   const Alias::UpdateData& update_data,
+                   const absl::optional<UpdateRegion>& new_region,
+                   const std::vector<ViewInfo>& new_view_infos) {
+  if (update_data.view_infos == new_view_infos) {
+    return true;
+  }
+  if (!new_region) {
+    return false;
+  }
+  absl::optional<UpdateRegion> region =
+      GetUpdateRegion(alias_shape, update_data.view_infos);
+  return region && RegionContains(*new_region, *region);
+}
+
+// Tries to merge two box updates which are adjacent along a single dimension
+// into a single update of their union, by concatenating their values. This
+// lowers to a single UpdateSlice instead of one per update. On success, the
+// merged update is stored into update_data.
+bool TryMergeUpdates(const xla::Shape& alias_shape,
+                     const Alias::UpdateData& new_update_data,
+                     Alias::UpdateData* update_data) {
+  absl::optional<UpdateRegion> region =
+      GetUpdateRegion(alias_shape, update_data->view_infos);
+  absl::optional<UpdateRegion> new_region =
+      GetUpdateRegion(alias_shape, new_update_data.view_infos);
+  if (!region || !new_region || !region->is_box_value ||
+      !new_region->is_box_value) {
+    return false;
+  }
+  const xla::Shape& shape = update_data->ir_value.shape();
+  const xla::Shape& new_shape = new_update_data.ir_value.shape();
+  if (shape.element_type() != new_shape.element_type() ||
+      xla::util::ToVector<xla::int64>(shape.dimensions()) != region->sizes ||
+      xla::util::ToVector<xla::int64>(new_shape.dimensions()) !=
+          new_region->sizes) {
+    return false;
+  }
+  absl::optional<xla::int64> cat_dim;
+  for (size_t dim = 0; dim < region->sizes.size(); ++dim) {
+    if (region->base[dim] == new_region->base[dim] &&
+        region->sizes[dim] == new_region->sizes[dim]) {
+      continue;
+    }
+    if (cat_dim) {
+      return false;
+    }
+    cat_dim = dim;
+  }
+  if (!cat_dim) {
+    return false;
+  }
+  xla::int64 dim = *cat_dim;
+  bool new_first;
+  if (new_region->base[dim] + new_region->sizes[dim] == region->base[dim]) {
+    new_first = true;
+  } else if (region->base[dim] + region->sizes[dim] ==
+             new_region->base[dim]) {
+    new_first = false;
+  } else {
+    return false;
+  }
+  std::vector<ir::Value> values;
+  if (new_first) {
+    values = {new_update_data.ir_value, update_data->ir_value};
+  } else {
+    values = {update_data->ir_value, new_update_data.ir_value};
+  }
+  std::vector<xla::int64> sizes(region->sizes);
+  sizes[dim] += new_region->sizes[dim];
+  ViewInfo view_info(ViewInfo::Type::kNarrow,
+                     xla::ShapeUtil::MakeShape(shape.element_type(), sizes),
+                     xla::util::ToVector<xla::int64>(alias_shape.dimensions()));
+  view_info.indices = new_first ? new_region->base : region->base;
+  update_data->ir_value = ir::MakeNode<ir::ops::Cat>(values, dim);
+  update_data->view_infos = {std::move(view_info)};
+  return true;
+}
+
+// The pending updates are kept to drop the overwritten ones and merge the
+// adjacent ones, which costs a scan of the stack at every update. Past this
+// size, the stack is folded into the alias IR value, so that the update cost
+// stays bounded for tensors written many times between reads (like ring
+// buffers and caches).
+size_t GetMaxPendingUpdates() {
+  static size_t max_pending_updates =
+      xla::sys_util::GetEnvInt("XLA_VIEW_MAX_PENDING_UPDATES", 64);
+  return max_pending_updates;
+}
+
 }  // namespace
 
 ViewInfo::ViewInfo(Type view_type, xla::Shape shape,
@@ -143,10 +307,31 @@ ViewInfo::ViewInfo(Type view_type, xla::Shape shape,
 }
 
 void Alias::Update(ir::Value ir_value, std::vector<ViewInfo> view_infos) {
-  if (!updates_.empty() && updates_.back().view_infos == view_infos) {
-    updates_.back().ir_value = std::move(ir_value);
+  // Views only move elements around, so every update writes the same alias
+  // elements no matter which other updates are applied before it. This means
+  // that pending updates whose elements are all overwritten by the new one can
+  // be dropped, wherever they are within the stack.
+  const xla::Shape& alias_shape = ir_value_.shape();
+  absl::optional<UpdateRegion> region =
+      GetUpdateRegion(alias_shape, view_infos);
+  auto it = std::remove_if(updates_.begin(), updates_.end(),
+                           [&](const UpdateData& update_data) {
+                             return IsOverwritten(alias_shape, update_data,
+                                                  region, view_infos);
+                           });
+  XLA_COUNTER("ViewUpdatesCollapsed", std::distance(it, updates_.end()));
+  updates_.erase(it, updates_.end());
+
+  UpdateData update_data{std::move(ir_value), std::move(view_infos)};
+  if (!updates_.empty() &&
+      TryMergeUpdates(alias_shape, update_data, &updates_.back())) {
+    XLA_COUNTER("ViewUpdatesMerged", 1);
   } else {
-    updates_.push_back({std::move(ir_value), std::move(view_infos)});
+    updates_.push_back(std::move(update_data));
+    if (updates_.size() > GetMaxPendingUpdates()) {
+      XLA_COUNTER("ViewUpdatesFolded", updates_.size());
+      SyncUpdateOperations();
+    }
   }
   ++generation_;
 }
@@ -24,9 +24,10 @@ struct SelectInfo {
 
 struct AsStridedInfo {
   bool operator==(const AsStridedInfo& ref) const {
-    return offset == ref.offset;
+    return offset == ref.offset && stride == ref.stride;
   }
 
+  std::vector<xla::int64> stride;
   xla::int64 offset = 0;
 };
 
@@ -53,7 +54,8 @@ struct ViewInfo {
   bool operator==(const ViewInfo& ref) const {
     return view_type == ref.view_type && shape == ref.shape &&
            indices == ref.indices && sizes == ref.sizes &&
-           permutation == ref.permutation && select == ref.select;
+           permutation == ref.permutation && select == ref.select &&
+           as_strided == ref.as_strided;
   }
 
   Type view_type = Type::kInvalid;
@@ -101,7 +103,8 @@ class Alias {
   // The IR value which is the root at which the view was created.
   ir::Value ir_value_;
   // The stacked updates on the view. Orders matter, as most recent updates
-  // might overwrite older ones.
+  // might overwrite older ones. Updates which are fully overwritten by newer
+  // ones are dropped, and adjacent slice updates are merged.
   std::vector<UpdateData> updates_;
   // Incremented every time an update happens. Used by view to track alias
   // changes and regenerate the most current value.
@@ -1,19 +1,29 @@
 #include "torch_xla/csrc/xla_lower_util.h"
 
 #include <algorithm>
+#include <limits>
+#include <tuple>
 #include <vector>
 
+#include "absl/strings/str_cat.h"
+#include "absl/types/optional.h"
 #include "tensorflow/compiler/xla/client/lib/arithmetic.h"
 #include "tensorflow/compiler/xla/client/lib/comparators.h"
 #include "tensorflow/compiler/xla/client/lib/constants.h"
 #include "tensorflow/compiler/xla/client/lib/math.h"
 #include "tensorflow/compiler/xla/client/lib/slicing.h"
 #include "tensorflow/compiler/xla/shape_util.h"
+#include "tensorflow/compiler/xla/primitive_util.h"
+#include "tensorflow/compiler/xla/util.h"
 #include "tensorflow/compiler/xla/xla_client/debug_macros.h"
+#include "tensorflow/compiler/xla/xla_client/metrics.h"
+#include "tensorflow/compiler/xla/xla_client/sys_util.h"
 #include "tensorflow/compiler/xla/xla_client/util.h"
 #include "torch_xla/csrc/convert_ops.h"
 #include "torch_xla/csrc/data_ops.h"
 #include "torch_xla/csrc/helpers.h"
+#include "torch_xla/csrc/index_cost_model.h"
+#include "torch_xla/csrc/random.h"
 #include "torch_xla/csrc/tensor_util.h"
 
 namespace torch_xla {
@@ -98,6 +108,8 @@ xla::XlaOp CreateIndexAlongDim(
     const std::function<xla::XlaOp(const xla::XlaOp&, const xla::XlaOp&)>&
         combiner) {
   xla::Shape buffer_shape = XlaHelpers::ShapeOfXlaOp(buffer);
+  xla::XlaOp narrowed_index =
+      XlaHelpers::NarrowIndices(index, buffer_shape.dimensions(dim));
   xla::ScatterDimensionNumbers dim_numbers;
   dim_numbers.set_index_vector_dim(1);
   for (xla::int64 window_dim = 0; window_dim < buffer_shape.rank();
@@ -127,7 +139,7 @@ xla::XlaOp CreateIndexAlongDim(
   // Create a combiner computation for the scatter.
   xla::XlaComputation combiner_computation =
       MakeScatterComputation(combiner, buffer_shape.element_type());
-  return xla::Scatter(buffer, index, updates, combiner_computation,
+  return xla::Scatter(buffer, narrowed_index, updates, combiner_computation,
                       dim_numbers);
 }
 
@@ -211,6 +223,369 @@ xla::XlaOp XlaDenseScatter(
   });
 }
 
+// The size of the largest of the given dimensions of the shape.
+xla::int64 MaxDimensionSize(
+    const xla::Shape& shape,
+    tensorflow::gtl::ArraySlice<const xla::int64> dimensions) {
+  xla::int64 max_size = 0;
+  for (auto dim : dimensions) {
+    max_size = std::max(max_size, shape.dimensions(dim));
+  }
+  return max_size;
+}
+
+// Whether selecting the first k elements out of a dimension of the given size
+// should be done with k rounds of reductions, instead of sorting the whole
+// dimension. The former is O(k * N) while the latter is O(N * log(N)), so for
+// small k on large dimensions the selection is much cheaper.
+bool UseTopKSelection(xla::int64 k, xla::int64 dim_size) {
+  static const xla::int64 max_k =
+      xla::sys_util::GetEnvInt("XLA_TOPK_SELECTION_MAX_K", 32);
+  static const xla::int64 min_size =
+      xla::sys_util::GetEnvInt("XLA_TOPK_SELECTION_MIN_SIZE", 1024);
+  return k <= max_k && dim_size >= min_size;
+}
+
+struct TopKSelection {
+  // The selected values and (S32) indices, in selection order. Each of them
+  // has the input shape with the dim dimension dropped.
+  std::vector<xla::XlaOp> values;
+  std::vector<xla::XlaOp> indices;
+};
+
+// Selects the k largest (or smallest) elements along dim, by running k rounds
+// of max (or min) reductions, each one masking out the element picked by the
+// previous ones. Among equal values the one with the lowest index is picked
+// first, and NaNs are considered larger than any other value.
+TopKSelection CreateTopKSelection(const xla::XlaOp& input, xla::int64 k,
+                                  xla::int64 dim, bool largest) {
+  xla::XlaBuilder* builder = input.builder();
+  xla::Shape shape = XlaHelpers::ShapeOfXlaOp(input);
+  xla::PrimitiveType type = shape.element_type();
+  std::vector<xla::int64> broadcast_dims;
+  for (xla::int64 i = 0; i < shape.rank(); ++i) {
+    if (i != dim) {
+      broadcast_dims.push_back(i);
+    }
+  }
+  xla::XlaOp iota = xla::Iota(
+      builder,
+      xla::ShapeUtil::MakeShape(xla::PrimitiveType::S32, shape.dimensions()),
+      dim);
+  // The masking value must be the infinity for floating point types, as a
+  // finite one would be picked before the (not yet selected) infinities.
+  xla::XlaOp init_value =
+      largest ? xla::MinValue(builder, type) : xla::MaxValue(builder, type);
+  xla::XlaOp masked_values = xla::Broadcast(init_value, shape.dimensions());
+  xla::XlaComputation reducer =
+      largest ? XlaHelpers::CreateMaxComputation(type)
+              : XlaHelpers::CreateMinComputation(type);
+  xla::XlaOp index_init = xla::MaxValue(builder, xla::PrimitiveType::S32);
+  xla::XlaOp masked_indices = xla::Broadcast(index_init, shape.dimensions());
+  xla::XlaComputation index_reducer =
+      XlaHelpers::CreateMinComputation(xla::PrimitiveType::S32);
+  bool is_floating_point = xla::primitive_util::IsFloatingPointType(type);
+  // When selecting the smallest elements, NaNs are keyed as infinities so
+  // that the min reductions do not pick them first.
+  bool remap_nans = is_floating_point && !largest;
+  xla::XlaOp keys =
+      remap_nans ? xla::Select(xla::Ne(input, input), masked_values, input)
+                 : input;
+
+  TopKSelection selection;
+  xla::XlaOp selected = xla::Broadcast(xla::ConstantR0<bool>(builder, false),
+                                       shape.dimensions());
+  for (xla::int64 i = 0; i < k; ++i) {
+    xla::XlaOp candidates = xla::Select(selected, masked_values, keys);
+    xla::XlaOp value = xla::Reduce(candidates, init_value, reducer, {dim});
+    xla::XlaOp bcast_value =
+        xla::BroadcastInDim(value, shape.dimensions(), broadcast_dims);
+    xla::XlaOp match = xla::Eq(candidates, bcast_value);
+    if (is_floating_point && !remap_nans) {
+      // The max reductions propagate NaNs, which compare non-equal.
+      match = xla::Or(match, xla::And(xla::Ne(bcast_value, bcast_value),
+                                      xla::Ne(candidates, candidates)));
+    }
+    match = xla::And(match, xla::Not(selected));
+    xla::XlaOp index =
+        xla::Reduce(xla::Select(match, iota, masked_indices), index_init,
+                    index_reducer, {dim});
+    xla::XlaOp index_mask = xla::Eq(
+        iota, xla::BroadcastInDim(index, shape.dimensions(), broadcast_dims));
+    if (remap_nans) {
+      // Fetch the original value, which might have been a NaN.
+      value = xla::Reduce(xla::Select(index_mask, input, masked_values),
+                          init_value, reducer, {dim});
+    }
+    selected = xla::Or(selected, index_mask);
+    selection.values.push_back(value);
+    selection.indices.push_back(index);
+  }
+  return selection;
+}
+
+// Shifts the input by the given (positive) amount along dim, filling the slots
+// left on the low side with pad_value.
+xla::XlaOp ShiftAlongDim(const xla::XlaOp& input, const xla::XlaOp& pad_value,
+                         xla::int64 dim, xla::int64 shift) {
+  xla::Shape input_shape = XlaHelpers::ShapeOfXlaOp(input);
+  xla::PaddingConfig padding_config;
+  for (xla::int64 i = 0; i < input_shape.rank(); ++i) {
+    auto* dims = padding_config.add_dimensions();
+    dims->set_edge_padding_low(i == dim ? shift : 0);
+    dims->set_edge_padding_high(i == dim ? -shift : 0);
+    dims->set_interior_padding(0);
+  }
+  return xla::Pad(input, pad_value, padding_config);
+}
+
+// Scales the elements of the input selected by keep by 1 / (1 - probability),
+// and zeroes the other ones.
+xla::XlaOp ApplyDropoutMask(const xla::XlaOp& input, const xla::XlaOp& keep,
+                            float probability) {
+  xla::Shape shape = XlaHelpers::ShapeOfXlaOp(input);
+  float scale = probability < 1.0f ? 1.0f / (1.0f - probability) : 0.0f;
+  xla::XlaOp scaled =
+      input * XlaHelpers::ScalarValue<float>(scale, shape.element_type(),
+                                             input.builder());
+  return xla::Select(keep, scaled, xla::Zeros(input.builder(), shape));
+}
+
+// Whether index_add should reduce the duplicated indices before scattering
+// (XLA_SEGMENT_SUM_SCATTER).
+bool UseSegmentSum(xla::int64 num_indices) {
+  static const bool use_segment_sum =
+      xla::sys_util::GetEnvBool("XLA_SEGMENT_SUM_SCATTER", false);
+  return use_segment_sum && num_indices > 1;
+}
+
+// The maximum size of the dimension unrolled into slices, by the as_strided
+// lowering of the overlapping windows.
+xla::int64 GetAsStridedMaxUnroll() {
+  static xla::int64 max_unroll =
+      xla::sys_util::GetEnvInt("XLA_AS_STRIDED_MAX_UNROLL", 32);
+  return max_unroll;
+}
+
+bool IsContiguousStride(tensorflow::gtl::ArraySlice<const xla::int64> size,
+                        tensorflow::gtl::ArraySlice<const xla::int64> stride) {
+  xla::int64 expected_stride = 1;
+  for (size_t i = size.size(); i > 0; --i) {
+    if (stride[i - 1] != expected_stride) {
+      return false;
+    }
+    expected_stride *= size[i - 1];
+  }
+  return true;
+}
+
+// Returns the dimensions ordered by decreasing stride, if the strided elements
+// do not overlap, and each stride is a multiple of the next one. In such case
+// the elements can be sliced out of a reshape of the flat input. All the sizes
+// must be greater than one, and all the strides greater than zero.
+absl::optional<std::vector<xla::int64>> GetNonOverlappingOrder(
+    tensorflow::gtl::ArraySlice<const xla::int64> size,
+    tensorflow::gtl::ArraySlice<const xla::int64> stride) {
+  std::vector<xla::int64> order =
+      xla::util::Iota<xla::int64>(size.size(), 0, 1);
+  std::stable_sort(order.begin(), order.end(),
+                   [&](xla::int64 a, xla::int64 b) {
+                     return stride[a] > stride[b];
+                   });
+  for (size_t i = 1; i < order.size(); ++i) {
+    xla::int64 outer_stride = stride[order[i - 1]];
+    xla::int64 inner_stride = stride[order[i]];
+    if (outer_stride % inner_stride != 0 ||
+        outer_stride < inner_stride * size[order[i]]) {
+      return absl::nullopt;
+    }
+  }
+  return order;
+}
+
+template <typename T>
+std::vector<T> RemoveDim(tensorflow::gtl::ArraySlice<const T> values,
+                         size_t dim) {
+  std::vector<T> result(values.begin(), values.end());
+  result.erase(result.begin() + dim);
+  return result;
+}
+
+// Computes the flat input index of every element of the strided view.
+xla::XlaOp BuildStridedIndices(
+    xla::XlaBuilder* builder,
+    tensorflow::gtl::ArraySlice<const xla::int64> size,
+    tensorflow::gtl::ArraySlice<const xla::int64> stride,
+    xla::int64 storage_offset, xla::int64 input_element_count) {
+  xla::PrimitiveType type =
+      input_element_count <= std::numeric_limits<xla::int32>::max()
+          ? xla::PrimitiveType::S32
+          : xla::PrimitiveType::S64;
+  xla::Shape indices_shape = xla::ShapeUtil::MakeShape(type, size);
+  xla::XlaOp indices =
+      XlaHelpers::ScalarBroadcast(storage_offset, indices_shape, builder);
+  for (size_t dim = 0; dim < size.size(); ++dim) {
+    if (stride[dim] != 0 && size[dim] > 1) {
+      indices = indices +
+                xla::Iota(builder, indices_shape, dim) *
+                    XlaHelpers::ScalarValue(stride[dim], type, builder);
+    }
+  }
+  return indices;
+}
+
+// Lowers the strided view of the rank 1 input.
+xla::XlaOp BuildR1AsStrided(
+    const xla::XlaOp& r1_input, xla::int64 input_element_count,
+    tensorflow::gtl::ArraySlice<const xla::int64> size,
+    tensorflow::gtl::ArraySlice<const xla::int64> stride,
+    xla::int64 storage_offset) {
+  xla::PrimitiveType type = XlaHelpers::TypeOfXlaOp(r1_input);
+  xla::int64 element_count = xla::util::Multiply<xla::int64>(size);
+  if (element_count == 0) {
+    return xla::Broadcast(xla::Zero(r1_input.builder(), type), size);
+  }
+  // The dimensions with a single element, or with a zero stride, are
+  // broadcasts of the view of the other dimensions.
+  std::vector<xla::int64> kept_dims;
+  std::vector<xla::int64> kept_size;
+  std::vector<xla::int64> kept_stride;
+  for (size_t dim = 0; dim < size.size(); ++dim) {
+    if (size[dim] > 1 && stride[dim] != 0) {
+      kept_dims.push_back(dim);
+      kept_size.push_back(size[dim]);
+      kept_stride.push_back(stride[dim]);
+    }
+  }
+  if (kept_dims.size() < size.size()) {
+    XLA_COUNTER("AsStridedBroadcast", 1);
+    xla::XlaOp kept = BuildR1AsStrided(r1_input, input_element_count,
+                                       kept_size, kept_stride, storage_offset);
+    return xla::BroadcastInDim(kept, size, kept_dims);
+  }
+  if (IsContiguousStride(size, stride)) {
+    xla::XlaOp r1_result = xla::SliceInDim(
+        r1_input, storage_offset, storage_offset + element_count, 1, 0);
+    return xla::Reshape(r1_result, size);
+  }
+  absl::optional<std::vector<xla::int64>> order =
+      GetNonOverlappingOrder(size, stride);
+  if (order) {
+    // Reshape the flat input so that every stride gets its own dimension,
+    // slice the strided elements out of it, and restore the dimensions order.
+    XLA_COUNTER("AsStridedSlice", 1);
+    xla::int64 outer_stride = stride[order->front()];
+    xla::int64 span = size[order->front()] * outer_stride;
+    xla::int64 limit = std::min(storage_offset + span, input_element_count);
+    xla::XlaOp r1_span =
+        xla::SliceInDim(r1_input, storage_offset, limit, 1, 0);
+    if (storage_offset + span > limit) {
+      // The elements past the end of the input are never selected.
+      xla::PaddingConfig padding_config;
+      padding_config.add_dimensions()->set_edge_padding_high(
+          storage_offset + span - limit);
+      r1_span = xla::Pad(r1_span, xla::Zero(r1_input.builder(), type),
+                         padding_config);
+    }
+    std::vector<xla::int64> span_sizes({size[order->front()]});
+    std::vector<xla::int64> limit_sizes({size[order->front()]});
+    for (size_t i = 1; i < order->size(); ++i) {
+      span_sizes.push_back(stride[(*order)[i - 1]] / stride[(*order)[i]]);
+      limit_sizes.push_back(size[(*order)[i]]);
+    }
+    span_sizes.push_back(stride[order->back()]);
+    limit_sizes.push_back(1);
+    xla::XlaOp sliced = xla::Slice(
+        xla::Reshape(r1_span, span_sizes),
+        std::vector<xla::int64>(span_sizes.size(), 0), limit_sizes,
+        std::vector<xla::int64>(span_sizes.size(), 1));
+    limit_sizes.pop_back();
+    xla::XlaOp result = xla::Reshape(sliced, limit_sizes);
+    std::vector<xla::int64> permutation = xla::InversePermutation(*order);
+    return xla::IsIdentityPermutation(permutation)
+               ? result
+               : xla::Transpose(result, permutation);
+  }
+  // Overlapping windows (like the ones of unfold) are unrolled along a small
+  // dimension whose removal leaves non overlapping slices.
+  absl::optional<size_t> unroll_dim;
+  for (size_t dim = 0; dim < size.size(); ++dim) {
+    if (size[dim] <= GetAsStridedMaxUnroll() &&
+        (!unroll_dim || size[dim] < size[*unroll_dim]) &&
+        GetNonOverlappingOrder(RemoveDim(size, dim), RemoveDim(stride, dim))) {
+      unroll_dim = dim;
+    }
+  }
+  if (unroll_dim) {
+    XLA_COUNTER("AsStridedUnroll", 1);
+    std::vector<xla::int64> part_size = RemoveDim(size, *unroll_dim);
+    std::vector<xla::int64> part_stride = RemoveDim(stride, *unroll_dim);
+    std::vector<xla::XlaOp> parts;
+    for (xla::int64 i = 0; i < size[*unroll_dim]; ++i) {
+      parts.push_back(BuildUnsqueeze(
+          BuildR1AsStrided(r1_input, input_element_count, part_size,
+                           part_stride,
+                           storage_offset + i * stride[*unroll_dim]),
+          *unroll_dim));
+    }
+    return xla::ConcatInDim(r1_input.builder(), parts, *unroll_dim);
+  }
+  XLA_COUNTER("AsStridedGather", 1);
+  xla::XlaOp indices =
+      BuildStridedIndices(r1_input.builder(), size, stride, storage_offset,
+                          input_element_count);
+  return CreateIndex(r1_input, BuildUnsqueeze(indices, size.size()), 0);
+}
+
+// Builds the "lhs goes before rhs" predicate for one sort key, with the NaN
+// values placed after all the others in ascending order, and before them in
+// descending one, as PyTorch does. The equality counts two NaN as equal.
+std::pair<xla::XlaOp, xla::XlaOp> SortKeyCompare(const xla::XlaOp& lhs,
+                                                 const xla::XlaOp& rhs,
+                                                 xla::PrimitiveType type,
+                                                 bool descending) {
+  xla::XlaOp before = descending ? xla::Gt(lhs, rhs) : xla::Lt(lhs, rhs);
+  xla::XlaOp equal = xla::Eq(lhs, rhs);
+  if (xla::primitive_util::IsFloatingPointType(type)) {
+    xla::XlaOp lhs_nan = xla::Ne(lhs, lhs);
+    xla::XlaOp rhs_nan = xla::Ne(rhs, rhs);
+    before = xla::Or(before, descending ? xla::And(lhs_nan, xla::Not(rhs_nan))
+                                        : xla::And(xla::Not(lhs_nan), rhs_nan));
+    equal = xla::Or(equal, xla::And(lhs_nan, rhs_nan));
+  }
+  return std::make_pair(before, equal);
+}
+
+// Creates the comparator of a lexicographic sort over the keys, followed by
+// the S32 positions operand. When stable, the positions break the ties, which
+// keeps the equal keys in their original order.
+xla::XlaComputation CreateSortComparator(
+    tensorflow::gtl::ArraySlice<const xla::PrimitiveType> key_types,
+    bool descending, bool stable) {
+  xla::XlaBuilder builder("SortComparator");
+  std::vector<xla::XlaOp> lhs;
+  std::vector<xla::XlaOp> rhs;
+  for (size_t i = 0; i <= key_types.size(); ++i) {
+    xla::Shape shape = xla::ShapeUtil::MakeShape(
+        i < key_types.size() ? key_types[i] : xla::PrimitiveType::S32, {});
+    lhs.push_back(xla::Parameter(&builder, 2 * i, shape,
+                                 absl::StrCat("lhs_", i)));
+    rhs.push_back(xla::Parameter(&builder, 2 * i + 1, shape,
+                                 absl::StrCat("rhs_", i)));
+  }
+  size_t index = key_types.size();
+  xla::XlaOp result = stable ? xla::Lt(lhs[index], rhs[index])
+                             : xla::ConstantR0<bool>(&builder, false);
+  for (size_t i = key_types.size(); i > 0; --i) {
+    xla::XlaOp before;
+    xla::XlaOp equal;
+    std::tie(before, equal) =
+        SortKeyCompare(lhs[i - 1], rhs[i - 1], key_types[i - 1], descending);
+    result = xla::Or(before, xla::And(equal, result));
+  }
+  return ConsumeValue(builder.Build(result));
+}
+
 }  // namespace
 
 xla::XlaOp PadToSize(const xla::XlaOp& input, const xla::XlaOp& pad_value,
@@ -234,6 +609,24 @@ std::vector<xla::XlaOp> CreateKthValue(const xla::XlaOp& input, xla::int64 k,
   // Here 'k' is 1 based (1...).
   xla::Shape shape = XlaHelpers::ShapeOfXlaOp(input);
   XLA_CHECK_LE(k, shape.dimensions(dim));
+  // The k-th smallest is also the (N - k + 1)-th largest.
+  xla::int64 rk = shape.dimensions(dim) - k + 1;
+  if (UseTopKSelection(std::min(k, rk), shape.dimensions(dim))) {
+    TopKSelection selection =
+        CreateTopKSelection(input, std::min(k, rk), dim, /*largest=*/rk < k);
+    xla::XlaOp values = selection.values.back();
+    xla::XlaOp indices = selection.indices.back();
+    if (keepdim) {
+      std::vector<xla::int64> reshape_sizes(shape.dimensions().begin(),
+                                            shape.dimensions().end());
+      reshape_sizes[dim] = 1;
+      values = xla::Reshape(values, reshape_sizes);
+      indices = xla::Reshape(indices, reshape_sizes);
+    }
+    return {values, xla::ConvertElementType(
+                        indices, GetDevicePrimitiveType(xla::PrimitiveType::S64,
+                                                        /*device=*/nullptr))};
+  }
   xla::Shape iota_shape =
       xla::ShapeUtil::MakeShape(xla::PrimitiveType::S32, shape.dimensions());
   xla::XlaOp iota = xla::Iota(input.builder(), iota_shape, dim);
@@ -271,6 +664,24 @@ std::vector<xla::XlaOp> CreateTopK(const xla::XlaOp& input, xla::int64 k,
   // Here 'k' is 1 based (1...).
   xla::Shape shape = XlaHelpers::ShapeOfXlaOp(input);
   XLA_CHECK_LE(k, shape.dimensions(dim));
+  if (UseTopKSelection(k, shape.dimensions(dim))) {
+    // The selection always returns the elements in sorted order.
+    TopKSelection selection = CreateTopKSelection(input, k, dim, largest);
+    std::vector<xla::int64> reshape_sizes(shape.dimensions().begin(),
+                                          shape.dimensions().end());
+    reshape_sizes[dim] = 1;
+    std::vector<xla::XlaOp> values;
+    std::vector<xla::XlaOp> indices;
+    for (xla::int64 i = 0; i < k; ++i) {
+      values.push_back(xla::Reshape(selection.values[i], reshape_sizes));
+      indices.push_back(xla::Reshape(selection.indices[i], reshape_sizes));
+    }
+    return {xla::ConcatInDim(input.builder(), values, dim),
+            xla::ConvertElementType(
+                xla::ConcatInDim(input.builder(), indices, dim),
+                GetDevicePrimitiveType(xla::PrimitiveType::S64,
+                                       /*device=*/nullptr))};
+  }
   xla::Shape iota_shape =
       xla::ShapeUtil::MakeShape(xla::PrimitiveType::S32, shape.dimensions());
   xla::XlaOp iota = xla::Iota(input.builder(), iota_shape, dim);
@@ -299,6 +710,33 @@ std::vector<xla::XlaOp> CreateTopK(const xla::XlaOp& input, xla::int64 k,
                                                       /*device=*/nullptr))};
 }
 
+std::vector<xla::XlaOp> CreateSort(
+    tensorflow::gtl::ArraySlice<const xla::XlaOp> keys, xla::int64 dim,
+    bool descending, bool stable) {
+  XLA_CHECK(!keys.empty());
+  xla::Shape shape = XlaHelpers::ShapeOfXlaOp(keys[0]);
+  std::vector<xla::XlaOp> operands(keys.begin(), keys.end());
+  std::vector<xla::PrimitiveType> key_types;
+  for (auto& key : keys) {
+    xla::Shape key_shape = XlaHelpers::ShapeOfXlaOp(key);
+    XLA_CHECK(xla::ShapeUtil::SameDimensions(shape, key_shape))
+        << key_shape << " vs. " << shape;
+    key_types.push_back(key_shape.element_type());
+  }
+  xla::Shape iota_shape =
+      xla::ShapeUtil::MakeShape(xla::PrimitiveType::S32, shape.dimensions());
+  operands.push_back(xla::Iota(keys[0].builder(), iota_shape, dim));
+  // A single sort carries both the values and their positions, so sort() and
+  // argsort() callers do not need a second gather pass.
+  xla::XlaOp sort_result = xla::Sort(
+      operands, CreateSortComparator(key_types, descending, stable), dim);
+  return {xla::GetTupleElement(sort_result, 0),
+          xla::ConvertElementType(
+              xla::GetTupleElement(sort_result, keys.size()),
+              GetDevicePrimitiveType(xla::PrimitiveType::S64,
+                                     /*device=*/nullptr))};
+}
+
 xla::XlaOp CreateMatMul(const xla::XlaOp& lhs, const xla::XlaOp& rhs) {
   const auto precision_level = XlaHelpers::mat_mul_precision();
   xla::PrecisionConfig precision_config =
@@ -345,31 +783,133 @@ xla::XlaOp CreateMatMul(const xla::XlaOp& lhs, const xla::XlaOp& rhs) {
               << rhs_shape << ")";
 }
 
-xla::XlaOp BuildBernoulli(const xla::XlaOp& probability,
+xla::XlaOp CreateMatMul(const xla::XlaOp& lhs, const xla::XlaOp& rhs,
+                        const XlaHelpers::MixedPrecision& mixed_precision) {
+  return XlaHelpers::MixedPrecisionOp(
+      mixed_precision, lhs, rhs,
+      [](const xla::XlaOp& lhs, const xla::XlaOp& rhs) {
+        return CreateMatMul(lhs, rhs);
+      });
+}
+
+xla::XlaOp CreatePermutedMatMul(
+    const xla::XlaOp& lhs,
+    tensorflow::gtl::ArraySlice<const xla::int64> lhs_permutation,
+    const xla::XlaOp& rhs,
+    tensorflow::gtl::ArraySlice<const xla::int64> rhs_permutation,
+    const xla::PrecisionConfig* precision_config) {
+  xla::int64 rank = XlaHelpers::ShapeOfXlaOp(lhs).rank();
+  XLA_CHECK_GE(rank, 2);
+  XLA_CHECK_EQ(rank, XlaHelpers::ShapeOfXlaOp(rhs).rank());
+  // The dimension d of a permute result is the dimension permutation[d] of
+  // its source.
+  auto source_dim =
+      [](tensorflow::gtl::ArraySlice<const xla::int64> permutation,
+         xla::int64 dim) {
+        return permutation.empty() ? dim : permutation[dim];
+      };
+  // Each operand has a single non contracting dimension, and DotGeneral()
+  // places the lhs one before the rhs one, after the batch dimensions, so the
+  // result has the matmul dimension order whatever the permutations are.
+  xla::DotDimensionNumbers dims;
+  for (xla::int64 i = 0; i < rank - 2; ++i) {
+    dims.add_lhs_batch_dimensions(source_dim(lhs_permutation, i));
+    dims.add_rhs_batch_dimensions(source_dim(rhs_permutation, i));
+  }
+  dims.add_lhs_contracting_dimensions(source_dim(lhs_permutation, rank - 1));
+  dims.add_rhs_contracting_dimensions(source_dim(rhs_permutation, rank - 2));
+  return xla::DotGeneral(lhs, rhs, dims, precision_config);
+}
+
+xla::XlaOp BuildBernoulli(const xla::XlaOp& probability, const xla::XlaOp& seed,
                           const xla::Shape& shape) {
   xla::Shape probability_shape = XlaHelpers::ShapeOfXlaOp(probability);
   xla::XlaOp zero = XlaHelpers::ScalarValue<float>(
       0, probability_shape.element_type(), probability.builder());
   xla::XlaOp one = XlaHelpers::ScalarValue<float>(
       1, probability_shape.element_type(), probability.builder());
-  xla::XlaOp noise = xla::RngUniform(zero, one, probability_shape);
+  xla::XlaOp noise = RngUniform(seed, probability_shape, zero, one);
   return xla::ConvertElementType(xla::Lt(noise, probability),
                                  shape.element_type());
 }
 
-xla::XlaOp BuildDropout(const xla::XlaOp& input, float probability) {
+xla::XlaOp BuildDropout(const xla::XlaOp& input, float probability,
+                        const xla::XlaOp& seed) {
   xla::Shape shape = XlaHelpers::ShapeOfXlaOp(input);
   xla::XlaOp prob =
       XlaHelpers::ScalarBroadcast<float>(probability, shape, input.builder());
-  xla::XlaOp mask = BuildBernoulli(prob, shape);
+  xla::XlaOp mask = BuildBernoulli(prob, seed, shape);
   if (probability > 0.0f) {
     mask = mask / prob;
   }
   return input * mask;
 }
 
+std::vector<xla::XlaOp> BuildPackedDropout(const xla::XlaOp& input,
+                                           float probability,
+                                           const xla::XlaOp& seed) {
+  xla::XlaBuilder* builder = input.builder();
+  xla::Shape shape = XlaHelpers::ShapeOfXlaOp(input);
+  xla::XlaOp noise = RngUniform(
+      seed,
+      xla::ShapeUtil::MakeShape(xla::PrimitiveType::F32, shape.dimensions()),
+      xla::Zero(builder, xla::PrimitiveType::F32),
+      xla::One(builder, xla::PrimitiveType::F32));
+  xla::XlaOp keep =
+      xla::Ge(noise, xla::ConstantR0<float>(builder, probability));
+  return {ApplyDropoutMask(input, keep, probability), BuildPackBits(keep)};
+}
+
+xla::XlaOp BuildPackedDropoutBackward(const xla::XlaOp& grad_output,
+                                      const xla::XlaOp& packed_mask,
+                                      float probability) {
+  xla::Shape shape = XlaHelpers::ShapeOfXlaOp(grad_output);
+  return ApplyDropoutMask(
+      grad_output, BuildUnpackBits(packed_mask, shape.dimensions()),
+      probability);
+}
+
+xla::XlaOp BuildPackBits(const xla::XlaOp& bits) {
+  const xla::int64 kWordBits = 32;
+  xla::XlaBuilder* builder = bits.builder();
+  xla::Shape shape = XlaHelpers::ShapeOfXlaOp(bits);
+  xla::int64 num_elements = xla::ShapeUtil::ElementsIn(shape);
+  xla::int64 num_words = (num_elements + kWordBits - 1) / kWordBits;
+  xla::XlaOp zero = xla::Zero(builder, xla::PrimitiveType::S32);
+  xla::XlaOp flat = xla::Reshape(
+      xla::ConvertElementType(bits, xla::PrimitiveType::S32), {num_elements});
+  flat = PadToSize(flat, zero, {num_words * kWordBits});
+  xla::Shape words_shape = xla::ShapeUtil::MakeShape(xla::PrimitiveType::S32,
+                                                     {num_words, kWordBits});
+  xla::XlaOp lanes = xla::ShiftLeft(xla::Reshape(flat, {num_words, kWordBits}),
+                                    xla::Iota(builder, words_shape, 1));
+  // The lanes hold disjoint bits, so the OR reduction packs them.
+  return xla::Reduce(
+      lanes, zero,
+      xla::CreateScalarOrComputation(xla::PrimitiveType::S32, builder), {1});
+}
+
+xla::XlaOp BuildUnpackBits(const xla::XlaOp& words,
+                           tensorflow::gtl::ArraySlice<const xla::int64> dims) {
+  const xla::int64 kWordBits = 32;
+  xla::XlaBuilder* builder = words.builder();
+  xla::int64 num_words = XlaHelpers::ShapeOfXlaOp(words).dimensions(0);
+  xla::Shape words_shape = xla::ShapeUtil::MakeShape(xla::PrimitiveType::S32,
+                                                     {num_words, kWordBits});
+  xla::XlaOp lanes = xla::ShiftRightLogical(
+      xla::BroadcastInDim(words, {num_words, kWordBits}, {0}),
+      xla::Iota(builder, words_shape, 1));
+  xla::XlaOp bits =
+      xla::Ne(xla::And(lanes, xla::One(builder, xla::PrimitiveType::S32)),
+              xla::Zero(builder, xla::PrimitiveType::S32));
+  bits = xla::SliceInDim(xla::Reshape(bits, {num_words * kWordBits}), 0,
+                         xla::util::Multiply<xla::int64>(dims), 1, 0);
+  return xla::Reshape(bits, dims);
+}
+
 xla::XlaOp BuildRandperm(xla::int64 n, xla::PrimitiveType element_type,
-                         xla::XlaBuilder* builder) {
+                         const xla::XlaOp& seed) {
+  xla::XlaBuilder* builder = seed.builder();
   xla::XlaOp input = xla::Iota(builder, element_type, n);
   // Ensure that the key space is greater than or equal to the cube of the
   // number of values to manage the number of collisions. Inspired by
@@ -378,13 +918,14 @@ xla::XlaOp BuildRandperm(xla::int64 n, xla::PrimitiveType element_type,
   const int kExponent = 3;
   const int rounds = static_cast<int>(
       std::ceil(kExponent * std::log(n) / std::log(tensorflow::kuint32max)));
-  const xla::Shape key_shape = xla::ShapeUtil::MakeShape(xla::U32, {n});
-  xla::XlaOp zero = xla::ConstantR0(builder, 0U);
-  xla::XlaOp max_value = xla::ConstantR0(builder, tensorflow::kuint32max);
+  xla::PrimitiveType seed_type = XlaHelpers::ShapeOfXlaOp(seed).element_type();
 
   xla::XlaOp curr = input;
   for (int i = 0; i < rounds; ++i) {
-    xla::XlaOp keys = xla::RngUniform(zero, max_value, key_shape);
+    // Every round uses its own random stream.
+    xla::XlaOp round_seed =
+        seed + XlaHelpers::ScalarValue<xla::int64>(i, seed_type, builder);
+    xla::XlaOp keys = RngUniformBits(round_seed, {n});
     xla::XlaOp sorted = xla::Sort(
         {keys, curr},
         xla::CreateScalarLtComputation({xla::U32, element_type}, builder));
@@ -412,33 +953,52 @@ std::vector<xla::XlaOp> CreateBroadcastTensors(
 
 xla::XlaOp CreateIndex(const xla::XlaOp& input, const xla::XlaOp& indices,
                        xla::int64 start_dim) {
+  xla::Shape indices_shape = XlaHelpers::ShapeOfXlaOp(indices);
+  XLA_CHECK_GE(indices_shape.rank(), 1);
+  return CreateIndex(
+      input, indices,
+      xla::util::Iota<xla::int64>(
+          indices_shape.dimensions(indices_shape.rank() - 1), start_dim),
+      start_dim);
+}
+
+xla::XlaOp CreateIndex(const xla::XlaOp& input, const xla::XlaOp& indices,
+                       tensorflow::gtl::ArraySlice<const xla::int64> index_dims,
+                       xla::int64 start_dim) {
   xla::Shape input_shape = XlaHelpers::ShapeOfXlaOp(input);
   xla::Shape indices_shape = XlaHelpers::ShapeOfXlaOp(indices);
   XLA_CHECK_GE(indices_shape.rank(), 1);
-  xla::int64 num_index_dims =
-      indices_shape.dimensions(indices_shape.rank() - 1);
+  XLA_CHECK_EQ(indices_shape.dimensions(indices_shape.rank() - 1),
+               static_cast<xla::int64>(index_dims.size()));
+  xla::XlaOp narrowed_indices = XlaHelpers::NarrowIndices(
+      indices, MaxDimensionSize(input_shape, index_dims));
+  xla::int64 indices_rank = indices_shape.rank() - 1;
+  // The indexed dimensions are collapsed, and the batch dimensions of the
+  // indices are placed at start_dim within the result, so the gather reads
+  // the indexed dimensions wherever they are, without permuting the input.
   xla::GatherDimensionNumbers dim_numbers;
   std::vector<xla::int64> slice_sizes;
   slice_sizes.reserve(input_shape.rank());
+  xla::int64 offset_dim = 0;
   for (xla::int64 i = 0; i < input_shape.rank(); ++i) {
-    if (i >= start_dim && i < num_index_dims + start_dim) {
+    if (std::find(index_dims.begin(), index_dims.end(), i) !=
+        index_dims.end()) {
       dim_numbers.add_collapsed_slice_dims(i);
       slice_sizes.push_back(1);
     } else {
       slice_sizes.push_back(input_shape.dimensions(i));
-      xla::int64 indices_rank = indices_shape.rank() - 1;
-      if (i < start_dim) {
-        dim_numbers.add_offset_dims(i);
-      } else {
-        dim_numbers.add_offset_dims(i - num_index_dims + indices_rank);
+      if (offset_dim == start_dim) {
+        offset_dim += indices_rank;
       }
+      dim_numbers.add_offset_dims(offset_dim);
+      ++offset_dim;
     }
   }
-  dim_numbers.set_index_vector_dim(indices_shape.rank() - 1);
-  for (xla::int64 i = 0; i < num_index_dims; i++) {
-    dim_numbers.add_start_index_map(i + start_dim);
+  dim_numbers.set_index_vector_dim(indices_rank);
+  for (auto dim : index_dims) {
+    dim_numbers.add_start_index_map(dim);
   }
-  return xla::Gather(input, indices, dim_numbers, slice_sizes);
+  return xla::Gather(input, narrowed_indices, dim_numbers, slice_sizes);
 }
 
 xla::XlaOp CreateIndexUpdate(
@@ -446,6 +1006,21 @@ xla::XlaOp CreateIndexUpdate(
     const xla::XlaOp& values,
     const std::function<xla::XlaOp(const xla::XlaOp&, const xla::XlaOp&)>&
         combiner) {
+  xla::Shape indices_shape = XlaHelpers::ShapeOfXlaOp(indices);
+  XLA_CHECK_GE(indices_shape.rank(), 1);
+  return CreateIndexUpdate(
+      buffer, indices,
+      xla::util::Iota<xla::int64>(
+          indices_shape.dimensions(indices_shape.rank() - 1), start_dim),
+      start_dim, values, combiner);
+}
+
+xla::XlaOp CreateIndexUpdate(
+    const xla::XlaOp& buffer, const xla::XlaOp& indices,
+    tensorflow::gtl::ArraySlice<const xla::int64> index_dims,
+    xla::int64 start_dim, const xla::XlaOp& values,
+    const std::function<xla::XlaOp(const xla::XlaOp&, const xla::XlaOp&)>&
+        combiner) {
   xla::Shape buffer_shape = XlaHelpers::ShapeOfXlaOp(buffer);
   xla::Shape indices_shape = XlaHelpers::ShapeOfXlaOp(indices);
   xla::Shape values_shape = XlaHelpers::ShapeOfXlaOp(values);
@@ -454,24 +1029,30 @@ xla::XlaOp CreateIndexUpdate(
       xla::AsInt64Slice(indices_shape.dimensions());
   XLA_CHECK(!indices_dims.empty());
   // The minor dimension of indices contains the indices to update.
-  xla::int64 num_index_dims = indices_dims.back();
+  XLA_CHECK_EQ(indices_dims.back(),
+               static_cast<xla::int64>(index_dims.size()));
   indices_dims.remove_suffix(1);
   xla::ScatterDimensionNumbers dim_numbers;
   dim_numbers.set_index_vector_dim(indices_shape.rank() - 1);
 
-  xla::int64 values_rank = values_shape.rank();
-  xla::int64 buffer_rank = buffer_shape.rank();
-  xla::int64 num_window_dims_in_values = buffer_rank - num_index_dims;
-
-  // Make the values match the rank expected by scatter.
+  // Make the values match the rank expected by scatter, which is the one of
+  // the result of the gather with the same indices: the batch dimensions of
+  // the indices at start_dim, surrounded by the not indexed dimensions.
   std::vector<xla::int64> expected_values_dims;
-  for (xla::int64 dim = 0; dim < start_dim; ++dim) {
-    expected_values_dims.push_back(buffer_shape.dimensions(dim));
+  for (xla::int64 dim = 0; dim < buffer_shape.rank(); ++dim) {
+    if (static_cast<xla::int64>(expected_values_dims.size()) == start_dim) {
+      expected_values_dims.insert(expected_values_dims.end(),
+                                  indices_dims.begin(), indices_dims.end());
+    }
+    if (std::find(index_dims.begin(), index_dims.end(), dim) ==
+        index_dims.end()) {
+      dim_numbers.add_update_window_dims(expected_values_dims.size());
+      expected_values_dims.push_back(buffer_shape.dimensions(dim));
+    }
   }
-  expected_values_dims.insert(expected_values_dims.end(), indices_dims.begin(),
-                              indices_dims.end());
-  for (xla::int64 dim = num_index_dims + start_dim; dim < buffer_rank; ++dim) {
-    expected_values_dims.push_back(buffer_shape.dimensions(dim));
+  if (static_cast<xla::int64>(expected_values_dims.size()) == start_dim) {
+    expected_values_dims.insert(expected_values_dims.end(),
+                                indices_dims.begin(), indices_dims.end());
   }
   xla::XlaOp new_values = values;
   if (buffer_shape.element_type() != values_shape.element_type()) {
@@ -479,24 +1060,218 @@ xla::XlaOp CreateIndexUpdate(
                            buffer_shape.element_type(), /*device=*/nullptr);
   }
   new_values = BuildExpand(new_values, expected_values_dims);
-  values_shape = XlaHelpers::ShapeOfXlaOp(new_values);
-  values_rank = values_shape.rank();
 
-  for (xla::int64 dim = 0; dim < start_dim; ++dim) {
-    dim_numbers.add_update_window_dims(dim);
-  }
-  for (xla::int64 i = values_rank - num_window_dims_in_values + start_dim;
-       i < values_rank; ++i) {
-    dim_numbers.add_update_window_dims(i);
-  }
-  for (xla::int64 i = 0; i < num_index_dims; ++i) {
-    dim_numbers.add_inserted_window_dims(i + start_dim);
-    dim_numbers.add_scatter_dims_to_operand_dims(i + start_dim);
+  for (auto dim : index_dims) {
+    dim_numbers.add_inserted_window_dims(dim);
+    dim_numbers.add_scatter_dims_to_operand_dims(dim);
   }
   xla::XlaComputation combiner_computation =
       MakeScatterComputation(combiner, buffer_shape.element_type());
-  return xla::Scatter(buffer, indices, new_values, combiner_computation,
-                      dim_numbers);
+  return xla::Scatter(
+      buffer,
+      XlaHelpers::NarrowIndices(indices,
+                                MaxDimensionSize(buffer_shape, index_dims)),
+      new_values, combiner_computation, dim_numbers);
+}
+
+std::vector<xla::XlaOp> BuildSegmentSum(const xla::XlaOp& indices,
+                                        const xla::XlaOp& values,
+                                        xla::int64 dim,
+                                        xla::int64 num_segments) {
+  xla::XlaBuilder* builder = indices.builder();
+  xla::Shape indices_shape = XlaHelpers::ShapeOfXlaOp(indices);
+  xla::Shape values_shape = XlaHelpers::ShapeOfXlaOp(values);
+  XLA_CHECK_EQ(indices_shape.rank(), 1) << indices_shape;
+  xla::int64 num_indices = indices_shape.dimensions(0);
+  XLA_CHECK_EQ(values_shape.dimensions(dim), num_indices) << values_shape;
+  xla::PrimitiveType index_type = indices_shape.element_type();
+
+  // Sort the indices, so that the duplicated ones form contiguous segments,
+  // and bring the values in the same order.
+  xla::XlaOp iota = xla::Iota(
+      builder,
+      xla::ShapeUtil::MakeShape(xla::PrimitiveType::S32, {num_indices}), 0);
+  xla::XlaOp sort_result = xla::Sort(
+      {indices, iota},
+      xla::CreateScalarLtComputation({index_type, xla::PrimitiveType::S32},
+                                     builder),
+      0);
+  xla::XlaOp sorted_indices = xla::GetTupleElement(sort_result, 0);
+  xla::XlaOp sums = xla::TorchIndexSelect(
+      values, xla::GetTupleElement(sort_result, 1), dim);
+
+  // Segmented inclusive prefix sum, in log2(N) steps. After the step using
+  // the shift S, each slot holds the sum of the (up to 2 * S) slots of its
+  // segment ending with it. Indices are never negative, so -1 can be used to
+  // fill the shifted slots.
+  xla::XlaOp index_pad = XlaHelpers::ScalarValue<xla::int64>(-1, index_type,
+                                                             builder);
+  xla::XlaOp zero = xla::Zero(builder, values_shape.element_type());
+  xla::XlaOp zeros = xla::Broadcast(zero, values_shape.dimensions());
+  for (xla::int64 shift = 1; shift < num_indices; shift *= 2) {
+    xla::XlaOp same_segment = xla::Eq(
+        sorted_indices, ShiftAlongDim(sorted_indices, index_pad, 0, shift));
+    same_segment =
+        xla::BroadcastInDim(same_segment, values_shape.dimensions(), {dim});
+    sums = sums + xla::Select(same_segment,
+                              ShiftAlongDim(sums, zero, dim, shift), zeros);
+  }
+  // Only the last slot of each segment holds the whole segment sum. Every
+  // other slot gets an out of bounds index, which scatter operations drop.
+  xla::XlaOp next_indices = xla::Rev(
+      ShiftAlongDim(xla::Rev(sorted_indices, {0}), index_pad, 0, 1), {0});
+  xla::XlaOp segment_end = xla::Ne(sorted_indices, next_indices);
+  xla::XlaOp unique_indices = xla::Select(
+      segment_end, sorted_indices,
+      xla::Broadcast(XlaHelpers::ScalarValue<xla::int64>(
+                         num_segments, index_type, builder),
+                     {num_indices}));
+  sums = xla::Select(
+      xla::BroadcastInDim(segment_end, values_shape.dimensions(), {dim}), sums,
+      zeros);
+  return {unique_indices, sums};
+}
+
+std::vector<xla::XlaOp> BuildHistogram(const xla::XlaOp& input,
+                                       xla::int64 bins) {
+  XLA_CHECK_GT(bins, 0);
+  xla::XlaBuilder* builder = input.builder();
+  xla::Shape input_shape = XlaHelpers::ShapeOfXlaOp(input);
+  xla::int64 num_elements = xla::ShapeUtil::ElementsIn(input_shape);
+  xla::XlaOp values = xla::ConvertElementType(
+      xla::Reshape(input, {num_elements}), xla::PrimitiveType::F32);
+  xla::XlaOp min_value = xla::Reduce(
+      values, xla::MaxValue(builder, xla::PrimitiveType::F32),
+      xla::CreateScalarMinComputation(xla::PrimitiveType::F32, builder), {0});
+  xla::XlaOp max_value = xla::Reduce(
+      values, xla::MinValue(builder, xla::PrimitiveType::F32),
+      xla::CreateScalarMaxComputation(xla::PrimitiveType::F32, builder), {0});
+  // A constant input gets a unit width range, and lands in the first bin.
+  xla::XlaOp zero = xla::Zero(builder, xla::PrimitiveType::F32);
+  xla::XlaOp one = xla::One(builder, xla::PrimitiveType::F32);
+  xla::XlaOp width = max_value - min_value;
+  width = xla::Select(xla::Gt(width, zero), width, one);
+  xla::XlaOp scale = XlaHelpers::ScalarValue<float>(bins, builder) / width;
+  xla::XlaOp bin_indices = xla::Clamp(
+      XlaHelpers::ScalarValue<xla::int32>(0, builder),
+      xla::ConvertElementType(xla::Floor((values - min_value) * scale),
+                              xla::PrimitiveType::S32),
+      XlaHelpers::ScalarValue<xla::int32>(bins - 1, builder));
+
+  xla::ScatterDimensionNumbers dim_numbers;
+  dim_numbers.set_index_vector_dim(1);
+  dim_numbers.add_inserted_window_dims(0);
+  dim_numbers.add_scatter_dims_to_operand_dims(0);
+  xla::XlaOp counts = xla::Scatter(
+      xla::Broadcast(zero, {bins}),
+      xla::Reshape(bin_indices, {num_elements, 1}),
+      xla::Broadcast(one, {num_elements}),
+      xla::CreateScalarAddComputation(xla::PrimitiveType::F32, builder),
+      dim_numbers);
+  xla::XlaOp range = xla::ConcatInDim(
+      builder, {xla::Reshape(min_value, {1}), xla::Reshape(max_value, {1})},
+      0);
+  return {counts, range};
+}
+
+std::vector<xla::XlaOp> BuildRematAnchor(const std::vector<xla::XlaOp>& inputs,
+                                         const xla::XlaOp& anchor) {
+  xla::Shape anchor_shape = XlaHelpers::ShapeOfXlaOp(anchor);
+  if (xla::ShapeUtil::IsZeroElementArray(anchor_shape)) {
+    return inputs;
+  }
+  xla::XlaOp element = anchor;
+  if (anchor_shape.rank() > 0) {
+    std::vector<xla::int64> zeros(anchor_shape.rank(), 0);
+    std::vector<xla::int64> ones(anchor_shape.rank(), 1);
+    element = xla::Reshape(xla::Slice(anchor, zeros, ones, ones), {});
+  }
+  if (!xla::primitive_util::IsFloatingPointType(
+          anchor_shape.element_type())) {
+    element = xla::ConvertElementType(element, xla::PrimitiveType::F32);
+  }
+  xla::PrimitiveType element_type =
+      XlaHelpers::ShapeOfXlaOp(element).element_type();
+  xla::XlaOp zero = xla::Zero(anchor.builder(), element_type);
+  // The select masks out infinities and NaNs, which would not be turned into
+  // zero by the multiplication.
+  xla::XlaOp dependency =
+      xla::Select(xla::IsFinite(element), element, zero) * zero;
+  std::vector<xla::XlaOp> results;
+  results.reserve(inputs.size());
+  for (auto& input : inputs) {
+    xla::PrimitiveType type = XlaHelpers::ShapeOfXlaOp(input).element_type();
+    if (xla::primitive_util::IsFloatingPointType(type)) {
+      results.push_back(input + xla::ConvertElementType(dependency, type));
+    } else {
+      results.push_back(input);
+    }
+  }
+  return results;
+}
+
+xla::OpSharding CreateTiledSharding(
+    tensorflow::gtl::ArraySlice<const xla::int64> mesh_shape,
+    tensorflow::gtl::ArraySlice<const xla::int64> dim_axes) {
+  std::vector<xla::int64> axis_dims(mesh_shape.size(), -1);
+  for (size_t dim = 0; dim < dim_axes.size(); ++dim) {
+    xla::int64 axis = dim_axes[dim];
+    if (axis < 0) {
+      continue;
+    }
+    XLA_CHECK_LT(axis, mesh_shape.size()) << "Invalid mesh axis: " << axis;
+    XLA_CHECK_EQ(axis_dims[axis], -1)
+        << "The mesh axis " << axis << " splits more than one dimension";
+    axis_dims[axis] = dim;
+  }
+  xla::OpSharding sharding;
+  if (std::all_of(axis_dims.begin(), axis_dims.end(),
+                  [](xla::int64 dim) { return dim < 0; })) {
+    sharding.set_type(xla::OpSharding::REPLICATED);
+    return sharding;
+  }
+  for (size_t axis = 0; axis < mesh_shape.size(); ++axis) {
+    XLA_CHECK(axis_dims[axis] >= 0 || mesh_shape[axis] == 1)
+        << "The mesh axis " << axis << " of size " << mesh_shape[axis]
+        << " does not split any dimension";
+  }
+  sharding.set_type(xla::OpSharding::OTHER);
+  std::vector<xla::int64> tile_dims(dim_axes.size(), 1);
+  for (size_t dim = 0; dim < dim_axes.size(); ++dim) {
+    if (dim_axes[dim] >= 0) {
+      tile_dims[dim] = mesh_shape[dim_axes[dim]];
+    }
+    sharding.add_tile_assignment_dimensions(tile_dims[dim]);
+  }
+  // Walk the tiles in row-major order, mapping the coordinate of every split
+  // dimension to the one of its mesh axis.
+  xla::int64 num_tiles = xla::util::Multiply<xla::int64>(tile_dims);
+  std::vector<xla::int64> tile_index(tile_dims.size(), 0);
+  for (xla::int64 i = 0; i < num_tiles; ++i) {
+    xla::int64 device = 0;
+    for (size_t axis = 0; axis < mesh_shape.size(); ++axis) {
+      xla::int64 coord = axis_dims[axis] >= 0 ? tile_index[axis_dims[axis]] : 0;
+      device = device * mesh_shape[axis] + coord;
+    }
+    sharding.add_tile_assignment_devices(device);
+    for (xla::int64 dim = tile_dims.size() - 1; dim >= 0; --dim) {
+      if (++tile_index[dim] < tile_dims[dim]) {
+        break;
+      }
+      tile_index[dim] = 0;
+    }
+  }
+  return sharding;
+}
+
+xla::XlaOp BuildShardingAnnotation(const xla::XlaOp& input,
+                                   const xla::OpSharding& sharding) {
+  // The sharding is carried by a pass-through instruction, instead of the
+  // "Sharding" custom call, which the compilers not running the SPMD
+  // partitioner cannot lower. Those simply drop the annotation.
+  xla::XlaOp tuple = xla::Tuple(input.builder(), {input});
+  xla::XlaScopedShardingAssignment assign_sharding(input.builder(), sharding);
+  return xla::GetTupleElement(tuple, 0);
 }
 
 xla::XlaOp CreateIndexAdd(const xla::XlaOp& buffer, xla::int64 dim,
@@ -505,6 +1280,17 @@ xla::XlaOp CreateIndexAdd(const xla::XlaOp& buffer, xla::int64 dim,
                                  const xla::XlaOp& y) -> xla::XlaOp {
     return x + y;
   };
+  xla::Shape index_shape = XlaHelpers::ShapeOfXlaOp(index);
+  if (index_shape.rank() == 1 && UseSegmentSum(index_shape.dimensions(0))) {
+    // Scatters with many duplicated indices get serialized on the updates of
+    // the same slot, so reduce the duplicates first.
+    xla::Shape buffer_shape = XlaHelpers::ShapeOfXlaOp(buffer);
+    std::vector<xla::XlaOp> segments =
+        BuildSegmentSum(index, value, dim, buffer_shape.dimensions(dim));
+    return CreateIndexAlongDim(buffer, dim, segments[0], segments[1],
+                               /*broadcast_value_to_index=*/false,
+                               add_scatter_combiner);
+  }
   return CreateIndexAlongDim(buffer, dim, index, value,
                              /*broadcast_value_to_index=*/false,
                              add_scatter_combiner);
@@ -527,10 +1313,25 @@ xla::XlaOp CreateScatter(
     xla::int64 dim,
     const std::function<xla::XlaOp(const xla::XlaOp&, const xla::XlaOp&)>&
         combiner) {
-  static int dense_scatter_factor =
-      xla::sys_util::GetEnvInt("XLA_DENSE_SCATTER_FACTOR", 100);
+  bool dense = IndexCostModel::Get()->UseDense(
+      IndexCostModel::Op::kScatter, XlaHelpers::ShapeOfXlaOp(input),
+      XlaHelpers::ShapeOfXlaOp(index));
+  return CreateScatter(input, index, src, dim, combiner, dense);
+}
+
+xla::XlaOp CreateScatter(
+    const xla::XlaOp& input, const xla::XlaOp& index, const xla::XlaOp& src,
+    xla::int64 dim,
+    const std::function<xla::XlaOp(const xla::XlaOp&, const xla::XlaOp&)>&
+        combiner,
+    bool dense) {
   xla::Shape input_shape = XlaHelpers::ShapeOfXlaOp(input);
-  xla::Shape index_shape = XlaHelpers::ShapeOfXlaOp(index);
+  // The indices of the other dimensions are built with the index type, so the
+  // narrowing is bound by the largest dimension.
+  xla::XlaOp narrowed_index = XlaHelpers::NarrowIndices(
+      index, MaxDimensionSize(input_shape,
+                              xla::util::Iota<xla::int64>(input_shape.rank())));
+  xla::Shape index_shape = XlaHelpers::ShapeOfXlaOp(narrowed_index);
   xla::Shape src_shape = XlaHelpers::ShapeOfXlaOp(src);
   XLA_CHECK_EQ(src_shape.rank(), index_shape.rank());
   xla::XlaOp src_op = src;
@@ -538,11 +1339,8 @@ xla::XlaOp CreateScatter(
     std::vector<xla::int64> base_indices(src_shape.rank(), 0);
     src_op = BuildSlice(src_op, base_indices, index_shape.dimensions());
   }
-
-  xla::int64 input_elements = xla::ShapeUtil::ElementsIn(input_shape);
-  xla::int64 index_elements = xla::ShapeUtil::ElementsIn(index_shape);
-  if (index_elements >= input_elements / dense_scatter_factor) {
-    return XlaDenseScatter(input, index, src_op, dim, combiner);
+  if (dense) {
+    return XlaDenseScatter(input, narrowed_index, src_op, dim, combiner);
   }
 
   xla::ShapeUtil::AppendMajorDimension(1, &index_shape);
@@ -550,7 +1348,8 @@ xla::XlaOp CreateScatter(
   to_concat.reserve(input_shape.rank());
   for (xla::int64 i = 0; i < input_shape.rank(); ++i) {
     if (i == dim) {
-      to_concat.push_back(xla::Reshape(index, index_shape.dimensions()));
+      to_concat.push_back(
+          xla::Reshape(narrowed_index, index_shape.dimensions()));
     } else {
       to_concat.push_back(xla::Iota(input.builder(), index_shape, i));
     }
@@ -569,4 +1368,70 @@ xla::XlaOp CreateScatter(
       scatter_dnums);
 }
 
+xla::XlaOp BuildAsStrided(const xla::XlaOp& input,
+                          tensorflow::gtl::ArraySlice<const xla::int64> size,
+                          tensorflow::gtl::ArraySlice<const xla::int64> stride,
+                          xla::int64 storage_offset) {
+  XLA_CHECK_EQ(size.size(), stride.size());
+  xla::int64 input_element_count =
+      xla::ShapeUtil::ElementsIn(XlaHelpers::ShapeOfXlaOp(input));
+  xla::XlaOp r1_input = xla::Reshape(input, {input_element_count});
+  return BuildR1AsStrided(r1_input, input_element_count, size, stride,
+                          storage_offset);
+}
+
+xla::XlaOp BuildAsStridedUpdate(
+    const xla::XlaOp& target, const xla::XlaOp& input,
+    tensorflow::gtl::ArraySlice<const xla::int64> stride,
+    xla::int64 storage_offset) {
+  xla::Shape target_shape = XlaHelpers::ShapeOfXlaOp(target);
+  xla::Shape input_shape = XlaHelpers::ShapeOfXlaOp(input);
+  XLA_CHECK_EQ(input_shape.rank(), stride.size());
+  xla::int64 target_element_count = xla::ShapeUtil::ElementsIn(target_shape);
+  xla::int64 input_element_count = xla::ShapeUtil::ElementsIn(input_shape);
+  if (input_element_count == 0) {
+    return target;
+  }
+  // The elements of the zero stride dimensions all update the same target
+  // elements, only the first ones are kept.
+  std::vector<xla::int64> kept_size;
+  std::vector<xla::int64> kept_stride;
+  std::vector<xla::int64> limit_sizes;
+  for (xla::int64 dim = 0; dim < input_shape.rank(); ++dim) {
+    bool kept = input_shape.dimensions(dim) > 1 && stride[dim] != 0;
+    limit_sizes.push_back(kept ? input_shape.dimensions(dim) : 1);
+    if (kept) {
+      kept_size.push_back(input_shape.dimensions(dim));
+      kept_stride.push_back(stride[dim]);
+    }
+  }
+  xla::XlaOp kept_input = xla::Reshape(
+      xla::Slice(input, std::vector<xla::int64>(limit_sizes.size(), 0),
+                 limit_sizes, std::vector<xla::int64>(limit_sizes.size(), 1)),
+      kept_size);
+  xla::int64 kept_element_count = xla::util::Multiply<xla::int64>(kept_size);
+  if (kept_element_count == target_element_count) {
+    XLA_CHECK_EQ(storage_offset, 0);
+    if (IsContiguousStride(kept_size, kept_stride)) {
+      return xla::Reshape(kept_input, target_shape.dimensions());
+    }
+  }
+  xla::XlaOp r1_target = xla::Reshape(target, {target_element_count});
+  xla::XlaOp r1_result;
+  if (IsContiguousStride(kept_size, kept_stride)) {
+    r1_result = BuildUpdateSlice(r1_target,
+                                 xla::Reshape(kept_input, {kept_element_count}),
+                                 {storage_offset});
+  } else {
+    XLA_COUNTER("AsStridedScatter", 1);
+    xla::XlaOp indices =
+        BuildStridedIndices(target.builder(), kept_size, kept_stride,
+                            storage_offset, target_element_count);
+    r1_result =
+        CreateIndexUpdate(r1_target, BuildUnsqueeze(indices, kept_size.size()),
+                          0, kept_input, nullptr);
+  }
+  return xla::Reshape(r1_result, target_shape.dimensions());
+}
+
 }  // namespace torch_xla
@@ -2,6 +2,7 @@
 
 #include "tensorflow/compiler/xla/client/xla_builder.h"
 #include "tensorflow/core/lib/gtl/array_slice.h"
+#include "torch_xla/csrc/helpers.h"
 
 namespace torch_xla {
 
@@ -14,15 +15,63 @@ std::vector<xla::XlaOp> CreateKthValue(const xla::XlaOp& input, xla::int64 k,
 std::vector<xla::XlaOp> CreateTopK(const xla::XlaOp& input, xla::int64 k,
                                    xla::int64 dim, bool largest, bool sorted);
 
+// Sorts the keys along dim, lexicographically (with the first key the most
+// significant one), and returns the sorted first key and the (S64) positions
+// of the sorted elements. A stable sort keeps the elements with equal keys in
+// their original order.
+std::vector<xla::XlaOp> CreateSort(
+    tensorflow::gtl::ArraySlice<const xla::XlaOp> keys, xla::int64 dim,
+    bool descending, bool stable);
+
 xla::XlaOp CreateMatMul(const xla::XlaOp& lhs, const xla::XlaOp& rhs);
 
-xla::XlaOp BuildBernoulli(const xla::XlaOp& probability,
+// Same as above, running the matmul according to the mixed precision policy.
+xla::XlaOp CreateMatMul(const xla::XlaOp& lhs, const xla::XlaOp& rhs,
+                        const XlaHelpers::MixedPrecision& mixed_precision);
+
+// Same as CreateMatMul() for operands of the same rank (at least 2), each of
+// which is given as the source of a permute, with an empty permutation meaning
+// no permute. The permutes are folded into the DotGeneral dimension numbers,
+// so no transposed copy of the operands gets materialized.
+xla::XlaOp CreatePermutedMatMul(
+    const xla::XlaOp& lhs,
+    tensorflow::gtl::ArraySlice<const xla::int64> lhs_permutation,
+    const xla::XlaOp& rhs,
+    tensorflow::gtl::ArraySlice<const xla::int64> rhs_permutation,
+    const xla::PrecisionConfig* precision_config);
+
+// The random operations draw their values from the stateless generator in
+// random.h, keyed by the seed scalar.
+xla::XlaOp BuildBernoulli(const xla::XlaOp& probability, const xla::XlaOp& seed,
                           const xla::Shape& shape);
 
-xla::XlaOp BuildDropout(const xla::XlaOp& input, float probability);
+xla::XlaOp BuildDropout(const xla::XlaOp& input, float probability,
+                        const xla::XlaOp& seed);
 
 xla::XlaOp BuildRandperm(xla::int64 n, xla::PrimitiveType element_type,
-                         xla::XlaBuilder* builder);
+                         const xla::XlaOp& seed);
+
+// Returns the dropout of the input, with probability the probability of an
+// element to be dropped, and the mask of the kept elements packed into an S32
+// vector, with one bit per element, to be used by the backward pass.
+std::vector<xla::XlaOp> BuildPackedDropout(const xla::XlaOp& input,
+                                           float probability,
+                                           const xla::XlaOp& seed);
+
+// Computes the gradient of BuildPackedDropout(), from its packed mask.
+xla::XlaOp BuildPackedDropoutBackward(const xla::XlaOp& grad_output,
+                                      const xla::XlaOp& packed_mask,
+                                      float probability);
+
+// Packs the PRED bits, in row major order, into an S32 vector of
+// ceil(num_elements / 32) words, with the first element in the least
+// significant bit.
+xla::XlaOp BuildPackBits(const xla::XlaOp& bits);
+
+// Unpacks the bits of a BuildPackBits() vector, or of a host tensor packed by
+// copy_kernels::PackBits32(), into a PRED array with the given dimensions.
+xla::XlaOp BuildUnpackBits(const xla::XlaOp& words,
+                           tensorflow::gtl::ArraySlice<const xla::int64> dims);
 
 std::vector<xla::XlaOp> CreateBroadcastTensors(
     tensorflow::gtl::ArraySlice<const xla::XlaOp> operands);
@@ -31,6 +80,13 @@ std::vector<xla::XlaOp> CreateBroadcastTensors(
 xla::XlaOp CreateIndex(const xla::XlaOp& input, const xla::XlaOp& indices,
                        xla::int64 start_dim);
 
+// Same as above, with the indices indexing the index_dims dimensions of the
+// input (which need not be adjacent), and their batch dimensions placed at
+// start_dim within the result.
+xla::XlaOp CreateIndex(const xla::XlaOp& input, const xla::XlaOp& indices,
+                       tensorflow::gtl::ArraySlice<const xla::int64> index_dims,
+                       xla::int64 start_dim);
+
 // Similar to tf.scatter_nd, used to implement advanced indexing updates.
 xla::XlaOp CreateIndexUpdate(
     const xla::XlaOp& buffer, const xla::XlaOp& indices, xla::int64 start_dim,
@@ -38,6 +94,53 @@ xla::XlaOp CreateIndexUpdate(
     const std::function<xla::XlaOp(const xla::XlaOp&, const xla::XlaOp&)>&
         combiner);
 
+// Same as above, with the indexed dimensions and the updates layout of the
+// CreateIndex() overload taking the index_dims.
+xla::XlaOp CreateIndexUpdate(
+    const xla::XlaOp& buffer, const xla::XlaOp& indices,
+    tensorflow::gtl::ArraySlice<const xla::int64> index_dims,
+    xla::int64 start_dim, const xla::XlaOp& updates,
+    const std::function<xla::XlaOp(const xla::XlaOp&, const xla::XlaOp&)>&
+        combiner);
+
+// Sums the slices of values along dim which have the same index within the rank
+// 1 indices tensor. Returns the indices of the segments (of the same shape of
+// the input indices) and the slices with the segment sums, where each distinct
+// index appears exactly once. The unused slots have num_segments as index (out
+// of bounds for scatter operations, which drop them) and zero values.
+std::vector<xla::XlaOp> BuildSegmentSum(const xla::XlaOp& indices,
+                                        const xla::XlaOp& values,
+                                        xla::int64 dim,
+                                        xla::int64 num_segments);
+
+// Counts the elements of the input falling in each of the bins equal width
+// intervals between its minimum and maximum value. Returns the F32 counts of
+// shape [bins] and the F32 [2] tensor holding the {min, max} range.
+std::vector<xla::XlaOp> BuildHistogram(const xla::XlaOp& input,
+                                       xla::int64 bins);
+
+// Returns the inputs made dependent on the anchor value, without changing
+// them: the floating point inputs get a zero computed out of one element of the
+// anchor added. This forces the computations using the returned values to be
+// scheduled after the anchor is available, and prevents them from being merged
+// with the ones using the original inputs.
+std::vector<xla::XlaOp> BuildRematAnchor(const std::vector<xla::XlaOp>& inputs,
+                                         const xla::XlaOp& anchor);
+
+// Creates the sharding which tiles a tensor over a device mesh of the given
+// shape, whose devices are numbered in row-major order. The dim_axes hold, for
+// every dimension of the tensor, the mesh axis it is split along, or -1 if it
+// is not split. Every mesh axis of size greater than one must split a
+// dimension, unless no dimension is split, which means replicated.
+xla::OpSharding CreateTiledSharding(
+    tensorflow::gtl::ArraySlice<const xla::int64> mesh_shape,
+    tensorflow::gtl::ArraySlice<const xla::int64> dim_axes);
+
+// Returns the input annotated with the sharding, which tells the SPMD
+// partitioner how to split the value across the devices.
+xla::XlaOp BuildShardingAnnotation(const xla::XlaOp& input,
+                                   const xla::OpSharding& sharding);
+
 xla::XlaOp CreateIndexAdd(const xla::XlaOp& buffer, xla::int64 dim,
                           const xla::XlaOp& index, const xla::XlaOp& value);
 
@@ -47,11 +150,36 @@ xla::XlaOp CreateIndexCopy(const xla::XlaOp& buffer, xla::int64 dim,
 xla::XlaOp CreateIndexFill(const xla::XlaOp& buffer, xla::int64 dim,
                            const xla::XlaOp& index, const xla::XlaOp& values);
 
-// Used to lower scatter and scatter_add.
+// Used to lower scatter and scatter_add. The lowering (dense or XLA scatter)
+// is selected by the IndexCostModel.
 xla::XlaOp CreateScatter(
     const xla::XlaOp& input, const xla::XlaOp& index, const xla::XlaOp& src,
     xla::int64 dim,
     const std::function<xla::XlaOp(const xla::XlaOp&, const xla::XlaOp&)>&
         combiner);
 
+// Same as above, with an explicit selection of the dense lowering.
+xla::XlaOp CreateScatter(
+    const xla::XlaOp& input, const xla::XlaOp& index, const xla::XlaOp& src,
+    xla::int64 dim,
+    const std::function<xla::XlaOp(const xla::XlaOp&, const xla::XlaOp&)>&
+        combiner,
+    bool dense);
+
+// Lowers the as_strided view of the input, whose elements are read as if they
+// were a contiguous storage. The common stride patterns (contiguous slices,
+// broadcasts, strided slices, diagonals and sliding windows) are lowered as
+// slices and broadcasts, the others with a gather.
+xla::XlaOp BuildAsStrided(const xla::XlaOp& input,
+                          tensorflow::gtl::ArraySlice<const xla::int64> size,
+                          tensorflow::gtl::ArraySlice<const xla::int64> stride,
+                          xla::int64 storage_offset);
+
+// Writes the input into the as_strided view of the target, with the given
+// strides and storage offset.
+xla::XlaOp BuildAsStridedUpdate(
+    const xla::XlaOp& target, const xla::XlaOp& input,
+    tensorflow::gtl::ArraySlice<const xla::int64> stride,
+    xla::int64 storage_offset);
+
 }  // namespace torch_xla
@@ -0,0 +1,50 @@
+from __future__ import division
+from __future__ import print_function
+
+import math
+import torch
+import torch_xla
+
+
+class _FusedAttention(torch.autograd.Function):
+
+  @staticmethod
+  def forward(ctx, query, key, value, mask, scale):
+    output, logsumexp = torch_xla._XLAC._xla_attention(
+        query, key, value, mask=mask, scale=scale)
+    ctx.mask = mask
+    ctx.scale = scale
+    ctx.save_for_backward(query, key, value, output, logsumexp)
+    return output
+
+  @staticmethod
+  def backward(ctx, grad_output):
+    query, key, value, output, logsumexp = ctx.saved_tensors
+    grad_query, grad_key, grad_value = torch_xla._XLAC._xla_attention_backward(
+        grad_output,
+        query,
+        key,
+        value,
+        ctx.mask,
+        output,
+        logsumexp,
+        scale=ctx.scale)
+    return grad_query, grad_key, grad_value, None, None
+
+
+def attention(query, key, value, mask=None, scale=None):
+  """Computes `softmax(query @ key^T * scale + mask) @ value` as a single fused
+  operation, which never materializes the full attention scores.
+
+  The query is `[..., Sq, D]`, the key `[..., Sk, D]` and the value
+  `[..., Sk, Dv]`, with matching batch dimensions. The optional mask broadcasts
+  to `[..., Sq, Sk]`, and it is either a boolean tensor whose `True` elements
+  exclude the respective scores (like `masked_fill(mask, -inf)` does), or an
+  additive floating point one. The mask does not receive gradients. The scale
+  defaults to `1 / sqrt(D)`.
+  The keys are processed in blocks of `XLA_ATTENTION_BLOCK_SIZE` (512 by
+  default), and the backward recomputes the scores block by block.
+  """
+  if scale is None:
+    scale = 1.0 / math.sqrt(query.size(-1))
+  return _FusedAttention.apply(query, key, value, mask, scale)
@@ -63,6 +63,153 @@ class PerDeviceLoader(object):
     return item
 
 
+class ShapeBucketer(object):
+  """Pads input tensors to a fixed set of dimension sizes.
+
+  Every distinct input shape makes the IR graph hash change, and hence triggers
+  a new compilation. Padding the dynamic dimensions (like the batch or sequence
+  ones) to the smallest fitting bucket size caps the number of graphs to the
+  number of buckets.
+
+  Args:
+    buckets (dict): Maps a dimension index to the list of sizes that dimension
+      can be padded to. Tensors whose size on a dimension exceeds the biggest
+      bucket are left untouched on that dimension.
+    pad_value (number, optional): The value used to fill the padded area.
+      Default: 0
+
+  Calling the bucketer on a (possibly nested) data structure returns a tuple
+  `(data, masks)`, where `masks` maps every bucketed dimension to a boolean
+  tensor of the padded size, which is `True` for the original (not padded)
+  elements.
+  """
+
+  def __init__(self, buckets, pad_value=0):
+    self._buckets = dict()
+    for dim, sizes in iteritems(buckets):
+      self._buckets[dim] = sorted(sizes)
+    self._pad_value = pad_value
+    self._lock = threading.Lock()
+    self._input_shapes = set()
+    self._bucket_shapes = set()
+
+  def _bucket_size(self, size, dim):
+    for bsize in self._buckets[dim]:
+      if bsize >= size:
+        return bsize
+    return size
+
+  def _get_sizes(self, data):
+    sizes = dict()
+
+    def fn(v):
+      for dim in self._buckets:
+        if dim < v.dim():
+          csize = sizes.setdefault(dim, v.size()[dim])
+          assert csize == v.size()[dim], (
+              'Mismatching sizes for dimension {}: {} vs {}'.format(
+                  dim, csize, v.size()[dim]))
+
+    xu.for_each_instance(data, torch.Tensor, fn)
+    return sizes
+
+  def _pad(self, tensor, bucket_sizes):
+    size = list(tensor.size())
+    for dim, bsize in iteritems(bucket_sizes):
+      if dim < len(size):
+        size[dim] = bsize
+    if size == list(tensor.size()):
+      return tensor
+    padded = tensor.new_full(size, self._pad_value)
+    view = padded
+    for dim in range(0, tensor.dim()):
+      view = view.narrow(dim, 0, tensor.size()[dim])
+    view.copy_(tensor)
+    return padded
+
+  def _count_graphs(self, sizes, bucket_sizes):
+    input_shape = tuple(sorted(iteritems(sizes)))
+    bucket_shape = tuple(sorted(iteritems(bucket_sizes)))
+    with self._lock:
+      if input_shape not in self._input_shapes:
+        self._input_shapes.add(input_shape)
+        if bucket_shape in self._bucket_shapes:
+          torch_xla._XLAC._xla_counter_add('ShapeBucketingAvoidedGraphs', 1)
+        self._bucket_shapes.add(bucket_shape)
+
+  def __call__(self, data):
+    sizes = self._get_sizes(data)
+    bucket_sizes = dict()
+    masks = dict()
+    for dim, size in iteritems(sizes):
+      bsize = self._bucket_size(size, dim)
+      bucket_sizes[dim] = bsize
+      mask = torch.zeros(bsize, dtype=torch.bool)
+      mask[:size] = True
+      masks[dim] = mask
+    self._count_graphs(sizes, bucket_sizes)
+
+    def convert_fn(tensors):
+      return [self._pad(t, bucket_sizes) for t in tensors]
+
+    def select_fn(v):
+      return type(v) == torch.Tensor
+
+    return xm.ToXlaTensorArena(convert_fn, select_fn).transform(data), masks
+
+
+class DistributedSampler(torch.utils.data.Sampler):
+  """Samples the shard of a dataset belonging to the local host.
+
+  The shards are computed out of the mesh configuration, so every host (or
+  process, in multi-processing mode) reads a disjoint and deterministic part of
+  the dataset, without coordination. With shuffle, the permutation depends on
+  seed and on the epoch set with set_epoch(), and it is the same on all hosts.
+
+  The shards are padded (or truncated with drop_last) so that every host gets
+  the same number of batch_size batches for each of its local devices, which
+  keeps the hosts issuing the same number of steps (and hence collectives).
+  """
+
+  def __init__(self,
+               dataset,
+               batch_size=1,
+               shuffle=True,
+               seed=0,
+               drop_last=False):
+    self._dataset_size = len(dataset)
+    self._batch_size = batch_size
+    self._shuffle = shuffle
+    self._seed = seed
+    self._drop_last = drop_last
+    self._epoch = 0
+    (self._shard_index, self._shard_count,
+     self._local_devices) = torch_xla._XLAC._xla_get_data_shard_position()
+
+  @property
+  def local_devices(self):
+    return self._local_devices
+
+  def set_epoch(self, epoch):
+    self._epoch = epoch
+
+  def _indices(self):
+    return torch_xla._XLAC._xla_get_data_shard_indices(
+        self._shard_index, self._shard_count, self._dataset_size, self._seed,
+        self._epoch, self._shuffle, self._drop_last,
+        self._batch_size * self._local_devices)
+
+  def __iter__(self):
+    return iter(self._indices())
+
+  def __len__(self):
+    chunk_size = self._shard_count * self._batch_size * self._local_devices
+    chunks = self._dataset_size // chunk_size
+    if not self._drop_last and self._dataset_size % chunk_size != 0:
+      chunks += 1
+    return chunks * self._batch_size * self._local_devices
+
+
 class ParallelLoader(object):
 
   def __init__(self,
@@ -71,11 +218,21 @@ class ParallelLoader(object):
                batchdim=0,
                fixed_batch_size=False,
                loader_prefetch_size=8,
-               device_prefetch_size=4):
-    self._loader = loader
+               device_prefetch_size=4,
+               bucketer=None):
     self._devices = list(devices)
+    sampler = getattr(loader, 'sampler', None)
+    if (isinstance(sampler, DistributedSampler) and
+        sampler.local_devices != len(self._devices)):
+      # The shard padding only guarantees the same number of steps on all the
+      # hosts if the batches are spread over all the local devices.
+      raise RuntimeError(
+          'The DistributedSampler shards for {} local devices, got {}'.format(
+              sampler.local_devices, len(self._devices)))
+    self._loader = loader
     self._batchdim = batchdim
     self._fixed_batch_size = fixed_batch_size
+    self._bucketer = bucketer
     self._done = False
     self._queues = dict()
     for device in self._devices:
@@ -142,6 +299,8 @@ class ParallelLoader(object):
           batch_size = self._get_batch_size(data, self._batchdim)
         elif batch_size != self._get_batch_size(data, self._batchdim):
           break
+      if self._bucketer is not None:
+        data = self._bucketer(data)
       batch.append((batch_number, data))
       batch_number += 1
       if len(batch) == len(self._devices):
@@ -162,6 +321,9 @@ class ParallelLoader(object):
 
   def _worker(self, dqueue):
     device = torch.device(dqueue.device)
+    # Keep the host side of the uploads on the CPUs next to the device, if
+    # XLA_DEVICE_CPUS configures them.
+    torch_xla._XLAC._xla_bind_thread_to_device_cpus(str(device))
     while True:
       batch = self._get_batch(dqueue)
       if not batch:
@@ -175,7 +337,11 @@ class ParallelLoader(object):
 
 class DataParallel(object):
 
-  def __init__(self, network, device_ids=None, batchdim=0):
+  def __init__(self,
+               network,
+               device_ids=None,
+               batchdim=0,
+               broadcast_params=None):
     if device_ids is None:
       device_ids = xm.get_xla_supported_devices()
     self._device_ids = list(device_ids)
@@ -183,9 +349,19 @@ class DataParallel(object):
     self._native_run = False
     self._models = []
     self._contexts = []
+    if broadcast_params is None:
+      broadcast_params = xu.getenv_as('XLA_BROADCAST_PARAMS', bool, False)
+    # With broadcast_params, only one device (per host) gets the model uploaded
+    # from the host, while the models of the other devices start as zeros
+    # created on the device, and get the parameters broadcast at the first run.
+    self._broadcast_params = broadcast_params and len(self._device_ids) > 1
+    root_index = self._get_broadcast_root() if self._broadcast_params else 0
     module = network if isinstance(network, torch.nn.Module) else network()
-    for device in device_ids:
-      device_module = deepcopy(module).to(device=torch.device(device))
+    for i, device in enumerate(device_ids):
+      if i != root_index and self._broadcast_params:
+        device_module = self._zeros_module(module, torch.device(device))
+      else:
+        device_module = deepcopy(module).to(device=torch.device(device))
       self._models.append(device_module)
       self._contexts.append(Context(torch.device(device)))
     if not self._models:
@@ -204,6 +380,19 @@ class DataParallel(object):
   def models(self):
     return self._models
 
+  def _get_broadcast_root(self):
+    # The root is the local device with the lowest replica index, which is the
+    # first one of the host group of the replication devices.
+    replication_devices = xm.xla_replication_devices(self._device_ids)
+    real_devices = xm.xla_real_devices(self._device_ids)
+    return min(
+        range(len(real_devices)),
+        key=lambda i: replication_devices.index(real_devices[i]))
+
+  def _zeros_module(self, module, device):
+    return deepcopy(module)._apply(
+        lambda t: torch.zeros(t.size(), dtype=t.dtype, device=device))
+
   def _get_model_device(self, model):
     devices = {str(p.device) for p in model.parameters()}
     if len(devices) > 1:
@@ -226,6 +415,9 @@ class DataParallel(object):
     if len(self._device_ids) > 1:
       xm.set_replication(device, self._device_ids)
     try:
+      if self._broadcast_params:
+        xm.broadcast_master_param(
+            module, groups=torch_xla._XLAC._xla_get_replication_host_groups())
       result.result = loop_fn(module, loader, torch.device(device), context)
     except Exception as e:
       result.result = e
@@ -260,4 +452,5 @@ class DataParallel(object):
     for thread in threads:
       thread.join()
     para_loader.close()
+    self._broadcast_params = False
     return [x.result for x in results]
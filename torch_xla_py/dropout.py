@@ -0,0 +1,60 @@
+from __future__ import division
+from __future__ import print_function
+
+import torch
+import torch_xla
+
+
+class _PackedDropout(torch.autograd.Function):
+
+  @staticmethod
+  def forward(ctx, input, p):
+    output, packed_mask = torch_xla._XLAC._xla_packed_dropout(input, p)
+    ctx.p = p
+    ctx.save_for_backward(packed_mask)
+    return output
+
+  @staticmethod
+  def backward(ctx, grad_output):
+    packed_mask, = ctx.saved_tensors
+    return torch_xla._XLAC._xla_packed_dropout_backward(
+        grad_output, packed_mask, ctx.p), None
+
+
+def dropout(input, p=0.5, training=True):
+  """Like `torch.nn.functional.dropout()`, but the mask saved for the backward
+  pass holds one bit per element.
+
+  The mask of the kept elements is packed into 32 bits integer words by the
+  forward computation, so the activation memory retained by a dropout layer
+  is 1/32 of the one of a float mask (1/16 when training in bfloat16).
+  """
+  if not training or p == 0:
+    return input
+  return _PackedDropout.apply(input, p)
+
+
+class Dropout(torch.nn.Module):
+  """A drop-in replacement of `torch.nn.Dropout`, using `dropout()`."""
+
+  def __init__(self, p=0.5):
+    super(Dropout, self).__init__()
+    self.p = p
+
+  def forward(self, input):
+    return dropout(input, p=self.p, training=self.training)
+
+  def extra_repr(self):
+    return 'p={}'.format(self.p)
+
+
+def replace_dropout(module):
+  """Replaces, in place, the `torch.nn.Dropout` submodules of the module with
+  `Dropout` ones, and returns the module.
+  """
+  for name, child in module.named_children():
+    if type(child) is torch.nn.Dropout:
+      setattr(module, name, Dropout(p=child.p))
+    else:
+      replace_dropout(child)
+  return module
@@ -0,0 +1,194 @@
+from __future__ import division
+from __future__ import print_function
+
+import collections
+import torch
+import torch_xla
+
+
+class HostEmbedding(object):
+  """An embedding table resident in host memory, whose hot rows are cached on
+  an XLA device.
+
+  Only the rows needed by the next batch are uploaded (`prefetch()`), into a
+  device cache of `cache_size` rows with LRU eviction. The lookups index the
+  device cache, and `step()` applies a sparse SGD update to the cached rows,
+  while their gradients are downloaded in background and applied to the host
+  table. A row is never uploaded before the pending updates of it reach the
+  host table, so evicted rows come back up to date.
+
+  Example:
+
+    embedding = HostEmbedding(weight, cache_size=65536, device=device, lr=0.1)
+    for indices, target in loader:
+      embedding.prefetch(indices)
+      ...
+      loss_fn(model(embedding.lookup(indices)), target).backward()
+      embedding.step()
+      optimizer.step()
+      xm.mark_step()
+
+  Every device needs its own instance (and cache), which can share the host
+  table across the devices of the same host.
+
+  Args:
+    weight (torch.Tensor): The 2D CPU tensor holding the table, which is
+      updated in place.
+    cache_size (int): The number of rows the device cache holds. It must fit
+      the unique rows of the batches prefetched, and not yet stepped.
+    device (torch.device): The XLA device hosting the cache.
+    lr (float): The learning rate of the SGD update of the rows.
+    max_pending_steps (int, optional): The number of steps whose updates can be
+      downloading, before waiting for the oldest of them.
+      Default: 2
+  """
+
+  def __init__(self, weight, cache_size, device, lr, max_pending_steps=2):
+    assert weight.dim() == 2, 'The embedding weight must be 2D'
+    self.weight = weight
+    self._cache_size = cache_size
+    self._device = torch.device(device)
+    self._lr = lr
+    self._max_pending_steps = max_pending_steps
+    self._cache = torch.zeros(
+        cache_size, weight.size(1), dtype=weight.dtype,
+        device=self._device).requires_grad_()
+    # Maps the table rows to their cache slot, least recently used first.
+    self._slots = collections.OrderedDict()
+    self._free_slots = list(range(cache_size - 1, -1, -1))
+    # The number of prefetched, or looked up, batches using every slot, which
+    # cannot be evicted until they are stepped.
+    self._pins = collections.Counter()
+    self._prefetched = collections.deque()
+    self._lookups = []
+    # The (host rows, gradients) pairs of the updates of the stepped, and
+    # possibly not yet issued, graphs, and the (host rows, gradients future)
+    # pairs of the downloading ones, oldest first.
+    self._staged_updates = []
+    self._updates = collections.deque()
+    # The number of downloading updates of every host row.
+    self._pending_rows = collections.Counter()
+
+  def _apply_oldest_update(self):
+    host_rows, future = self._updates.popleft()
+    grads = future.wait()[0]
+    self.weight.index_add_(0, host_rows, grads.mul_(-self._lr))
+    for row in host_rows.tolist():
+      self._pending_rows[row] -= 1
+      if self._pending_rows[row] == 0:
+        del self._pending_rows[row]
+
+  def _start_downloads(self):
+    for host_rows, grads in self._staged_updates:
+      self._updates.append(
+          (host_rows, torch_xla._XLAC._xla_get_tensors_async([grads])))
+      self._pending_rows.update(host_rows.tolist())
+    self._staged_updates = []
+    while len(self._updates) > self._max_pending_steps:
+      self._apply_oldest_update()
+
+  def _complete_updates(self):
+    self._start_downloads()
+    while self._updates:
+      self._apply_oldest_update()
+
+  def _allocate_slot(self):
+    if self._free_slots:
+      return self._free_slots.pop()
+    for row, slot in self._slots.items():
+      if self._pins[slot] == 0:
+        del self._slots[row]
+        return slot
+    raise RuntimeError('The embedding cache of {} rows cannot fit the rows '
+                       'of the pending batches'.format(self._cache_size))
+
+  def prefetch(self, indices):
+    """Starts uploading the table rows of the indices missing from the cache.
+
+    Args:
+      indices (torch.Tensor): The CPU tensor of the row indices of a batch,
+        which must then be passed to `lookup()`, in the same order as the
+        prefetched batches.
+    """
+    self._start_downloads()
+    rows = indices.reshape(-1).tolist()
+    unique_rows = list(collections.OrderedDict.fromkeys(rows))
+    missing = [row for row in unique_rows if row not in self._slots]
+    uslots = dict()
+    for row in unique_rows:
+      slot = self._slots.get(row, None)
+      if slot is not None:
+        uslots[row] = slot
+        self._slots[row] = self._slots.pop(row)
+        self._pins[slot] += 1
+    for row in missing:
+      slot = self._allocate_slot()
+      uslots[row] = slot
+      self._slots[row] = slot
+      self._pins[slot] += 1
+    torch_xla._XLAC._xla_counter_add('EmbeddingCacheHits',
+                                     len(unique_rows) - len(missing))
+    torch_xla._XLAC._xla_counter_add('EmbeddingCacheMisses', len(missing))
+    upload = None
+    if missing:
+      if any(row in self._pending_rows for row in missing):
+        self._complete_updates()
+      miss_slots = torch.tensor([uslots[row] for row in missing])
+      host_rows = self.weight.index_select(0, torch.tensor(missing))
+      upload = torch_xla._XLAC._xla_tensors_from_aten_async(
+          [host_rows, miss_slots], [str(self._device)] * 2)
+    slots = torch.tensor([uslots[row] for row in rows]).view(indices.size())
+    self._prefetched.append((indices, slots, sorted(uslots.values()), upload))
+
+  def lookup(self, indices):
+    """Returns the embeddings of the indices, as an XLA tensor of shape
+    `indices.size() + (embedding_dim,)`.
+
+    Args:
+      indices (torch.Tensor): The CPU tensor of the row indices, as passed to
+        the oldest pending `prefetch()`, which is called now if there is none.
+    """
+    if not self._prefetched:
+      self.prefetch(indices)
+    pindices, slots, uslots, upload = self._prefetched.popleft()
+    assert pindices is indices, 'The lookups must follow the prefetch order'
+    if upload is not None:
+      host_rows, miss_slots = upload.wait()
+      with torch.no_grad():
+        self._cache.index_copy_(0, miss_slots, host_rows)
+    self._lookups.append(uslots)
+    xslots = torch_xla._XLAC._xla_tensors_from_aten([slots],
+                                                    [str(self._device)])[0]
+    return self._cache.index_select(0, xslots.view(-1)).view(
+        tuple(indices.size()) + (self.weight.size(1),))
+
+  def step(self):
+    """Updates the rows looked up since the last step, with the gradients of
+    the lookups, and queues the sparse updates of the host table.
+
+    The gradients are downloaded once the step graph has been issued (at the
+    next `prefetch()`), so that the download does not split it.
+    """
+    uslots = sorted(set(slot for lslots in self._lookups for slot in lslots))
+    rows_by_slot = dict((slot, row) for row, slot in self._slots.items())
+    for lslots in self._lookups:
+      for slot in lslots:
+        self._pins[slot] -= 1
+    self._lookups = []
+    if not uslots or self._cache.grad is None:
+      return
+    host_rows = torch.tensor([rows_by_slot[slot] for slot in uslots])
+    xslots = torch_xla._XLAC._xla_tensors_from_aten([torch.tensor(uslots)],
+                                                    [str(self._device)])[0]
+    with torch.no_grad():
+      grads = self._cache.grad.index_select(0, xslots)
+      self._cache.index_add_(0, xslots, grads * -self._lr)
+      self._cache.grad.zero_()
+    self._staged_updates.append((host_rows, grads))
+
+  def flush(self):
+    """Waits for the pending updates to be applied to the host table.
+
+    The graph of the last step must have been issued (by `xm.mark_step()`).
+    """
+    self._complete_updates()
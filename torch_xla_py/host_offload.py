@@ -0,0 +1,269 @@
+from __future__ import division
+from __future__ import print_function
+
+import collections
+import itertools
+import time
+import torch
+import torch_xla
+import torch_xla_py.xla_model as xm
+
+
+class OptimizerStateOffloader(object):
+  """Keeps the XLA tensors of an optimizer state in host memory, between the
+  optimizer steps.
+
+  The state is only resident on the device while the optimizer step runs, which
+  trades host to device bandwidth for device memory. The transfers run in
+  background, overlapped with the step execution: the download of the updated
+  state starts as soon as the graph running the optimizer step is issued, and
+  the upload of the state (prefetch()) should be started after the forward and
+  backward graph is issued, so that it overlaps its execution.
+
+  Example:
+
+    offloader = OptimizerStateOffloader(optimizer)
+    for data, target in loader:
+      optimizer.zero_grad()
+      loss_fn(model(data), target).backward()
+      xm.mark_step()
+      offloader.prefetch()
+      with offloader.resident():
+        xm.optimizer_step(optimizer, barrier=True)
+
+  The step graph must be split at the optimizer step (the mark_step() after the
+  backward pass), otherwise the state must be resident for the whole step
+  execution, and offloading it only costs transfers.
+  Once the download completes (`prefetch()` and `restore()` wait for it), the
+  state of the optimizer holds CPU tensors, so it can be saved with the usual
+  `optimizer.state_dict()`.
+
+  Args:
+    optimizer (torch.optim.Optimizer): The optimizer whose state to offload.
+    filter_fn (callable, optional): Called with the state key (like `exp_avg`)
+      and the tensor, returns whether the tensor should be offloaded. All the
+      XLA state tensors are offloaded if not given.
+  """
+
+  def __init__(self, optimizer, filter_fn=None):
+    self._optimizer = optimizer
+    self._filter_fn = filter_fn
+    self._device = None
+    # The (state, key) entries which are being downloaded, or uploaded, with
+    # the future of the transfer.
+    self._download = None
+    self._upload = None
+
+  def _offloaded_entries(self):
+    entries = []
+    for state in self._optimizer.state.values():
+      for key, value in state.items():
+        if (isinstance(value, torch.Tensor) and xm.is_xla_tensor(value) and
+            (self._filter_fn is None or self._filter_fn(key, value))):
+          entries.append((state, key))
+    return entries
+
+  def _complete_download(self):
+    if self._download is not None:
+      entries, future = self._download
+      self._download = None
+      for (state, key), tensor in zip(entries, future.wait()):
+        state[key] = tensor
+      return entries
+    return []
+
+  def offload(self):
+    """Starts moving the optimizer state to host memory.
+
+    Called by resident() once the optimizer step is done. The device memory of
+    the state is released once the download completes.
+    """
+    entries = self._offloaded_entries()
+    if not entries:
+      return
+    tensors = [state[key] for state, key in entries]
+    self._device = str(tensors[0].device)
+    future = torch_xla._XLAC._xla_get_tensors_async(tensors)
+    # Drop the references to the device tensors, which are now held by the
+    # download only.
+    for state, key in entries:
+      state[key] = None
+    self._download = (entries, future)
+
+  def prefetch(self):
+    """Starts uploading the offloaded optimizer state to the device."""
+    if self._upload is not None:
+      return
+    entries = self._complete_download()
+    if entries:
+      tensors = [state[key] for state, key in entries]
+      self._upload = (entries,
+                      torch_xla._XLAC._xla_tensors_from_aten_async(
+                          tensors, [self._device] * len(tensors)))
+
+  def restore(self):
+    """Makes the optimizer state resident on the device, waiting for the
+    upload.
+    """
+    self.prefetch()
+    if self._upload is not None:
+      entries, future = self._upload
+      self._upload = None
+      for (state, key), tensor in zip(entries, future.wait()):
+        state[key] = tensor
+
+  def resident(self):
+    """Returns a context manager which makes the optimizer state resident on
+    the device within its scope, and starts offloading it on exit.
+    """
+    return _ResidentScope(self)
+
+
+class _ResidentScope(object):
+
+  def __init__(self, offloader):
+    self._offloader = offloader
+
+  def __enter__(self):
+    self._offloader.restore()
+
+  def __exit__(self, exc_type, exc_value, traceback):
+    if exc_type is None:
+      self._offloader.offload()
+
+
+class _ModelEntry(object):
+
+  def __init__(self, module, tensors, nbytes):
+    self.module = module
+    self.tensors = tensors
+    self.nbytes = nbytes
+    # The host copies of the tensors, when the model is offloaded, and the
+    # future of their upload, with its start time, while it is being warmed up.
+    self.host_tensors = None
+    self.upload = None
+
+
+class ModelResidencyManager(object):
+  """Keeps the parameter sets of several models sharing one device within a
+  device memory budget, offloading the least recently used ones to host memory.
+
+  The parameters and buffers of a registered model are accounted as resident
+  while they are on the device. When making a model resident would exceed the
+  budget, the least recently used models are offloaded: their device data is
+  downloaded and released, and the module tensors keep a host copy of it. An
+  offloaded model is uploaded back when acquire() is called for it, or ahead of
+  time with prefetch(), which overlaps the upload with the work in flight.
+
+  Example:
+
+    manager = ModelResidencyManager(budget_bytes=8 * 1024**3)
+    manager.register('encoder', encoder)
+    manager.register('ranker', ranker)
+    features = manager.acquire('encoder')(data)
+    manager.prefetch('ranker')
+    ...
+    scores = manager.acquire('ranker')(features)
+
+  The evictions and warmups are reported by the ModelEvictions and
+  ModelWarmups counters, and their latency by the ModelEvictTime and
+  ModelWarmupTime metrics. The manager is not thread safe.
+
+  Args:
+    budget_bytes (int): The device bytes the resident models can use.
+    device (torch.device, optional): The XLA device the models run on.
+      Default: the current default XLA device
+  """
+
+  def __init__(self, budget_bytes, device=None):
+    self._budget_bytes = budget_bytes
+    self._device = str(device) if device is not None else str(xm.xla_device())
+    # The entries of the models, in least recently used order.
+    self._models = collections.OrderedDict()
+
+  def register(self, name, module):
+    """Registers the model, whose tensors must already be on the device, and
+    makes it the most recently used one.
+    """
+    assert name not in self._models, 'Model {} already registered'.format(name)
+    tensors, seen = [], set()
+    for tensor in itertools.chain(module.parameters(), module.buffers()):
+      if xm.is_xla_tensor(tensor) and id(tensor) not in seen:
+        seen.add(id(tensor))
+        tensors.append(tensor)
+    xm.set_memory_category(tensors, 'parameter')
+    nbytes = sum(t.numel() * t.element_size() for t in tensors)
+    self._evict_for(nbytes)
+    self._models[name] = _ModelEntry(module, tensors, nbytes)
+
+  def unregister(self, name):
+    """Stops managing the model, making it resident first."""
+    self.acquire(name)
+    del self._models[name]
+
+  def model_bytes(self, name):
+    return self._models[name].nbytes
+
+  def resident_bytes(self):
+    """Returns the device bytes accounted to the resident models, including
+    the ones being warmed up.
+    """
+    return sum(
+        e.nbytes for e in self._models.values() if e.host_tensors is None)
+
+  def is_resident(self, name):
+    entry = self._models[name]
+    return entry.host_tensors is None and entry.upload is None
+
+  def prefetch(self, name):
+    """Starts uploading the model, if offloaded, evicting the least recently
+    used models to make room for it.
+    """
+    entry = self._models[name]
+    if entry.host_tensors is None:
+      return
+    self._evict_for(entry.nbytes, keep=name)
+    entry.upload = (torch_xla._XLAC._xla_tensors_from_aten_async(
+        entry.host_tensors,
+        [self._device] * len(entry.host_tensors)), time.time())
+    entry.host_tensors = None
+
+  def acquire(self, name):
+    """Makes the model resident, waiting for its upload, marks it as the most
+    recently used one, and returns its module.
+    """
+    entry = self._models[name]
+    self.prefetch(name)
+    if entry.upload is not None:
+      future, start_time = entry.upload
+      entry.upload = None
+      torch_xla._XLAC._xla_restore_tensors_data(entry.tensors, future.wait())
+      torch_xla._XLAC._xla_counter_add('ModelWarmups', 1)
+      torch_xla._XLAC._xla_metric_add_time('ModelWarmupTime',
+                                           (time.time() - start_time) * 1e9)
+    self._models[name] = self._models.pop(name)
+    return entry.module
+
+  def offload(self, name):
+    """Moves the model to host memory."""
+    entry = self._models[name]
+    if entry.host_tensors is not None:
+      return
+    if entry.upload is not None:
+      self.acquire(name)
+    start_time = time.time()
+    host_tensors = torch_xla._XLAC._xla_get_tensors_async(entry.tensors).wait()
+    torch_xla._XLAC._xla_offload_tensors_data(entry.tensors, host_tensors)
+    entry.host_tensors = host_tensors
+    torch_xla._XLAC._xla_counter_add('ModelEvictions', 1)
+    torch_xla._XLAC._xla_metric_add_time('ModelEvictTime',
+                                         (time.time() - start_time) * 1e9)
+
+  def _evict_for(self, nbytes, keep=None):
+    resident_bytes = self.resident_bytes()
+    for name, entry in list(self._models.items()):
+      if resident_bytes + nbytes <= self._budget_bytes:
+        break
+      if name != keep and entry.host_tensors is None:
+        self.offload(name)
+        resident_bytes -= entry.nbytes
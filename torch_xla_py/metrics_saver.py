@@ -21,3 +21,49 @@ def save_metrics(metrics_file=None):
       with _STEP_METRICS_FILE_LOCK:
         with open(metrics_file, 'a') as fd:
           fd.write(metrics_data)
+
+
+def start_metrics_server(port=0):
+  """Serves the metrics and counters in the OpenMetrics text format, at the
+  /metrics path of the given HTTP port, from a background thread (which can
+  also be started with XLA_METRICS_PORT).
+
+  Unlike `save_metrics()`, the report is only created when scraped, so there
+  is no cost on the step path. Returns the port the server listens on, which is
+  a free one if `port` is zero. The server only accepts local connections,
+  unless XLA_METRICS_HOST is set to another address to bind (like 0.0.0.0).
+  """
+  return torch_xla._XLAC._xla_start_metrics_server(port)
+
+
+def start_metrics_pusher(address, period=60.0):
+  """Pushes the OpenMetrics report to a push gateway every `period` seconds,
+  from a background thread (which can also be started with
+  XLA_METRICS_PUSH_ADDRESS and XLA_METRICS_PUSH_PERIOD).
+
+  Args:
+    address (string): The `host:port/path` address the report is PUT to.
+    period (float): The push period, in seconds.
+  """
+  torch_xla._XLAC._xla_start_metrics_pusher(address, period)
+
+
+def set_tracing(enabled):
+  """Enables or disables the recording of the timeline trace events (which can
+  also be enabled at startup with XLA_TRACE=1).
+  """
+  torch_xla._XLAC._xla_set_tracing(enabled)
+
+
+def save_trace(trace_file, clear=True):
+  """Writes the recorded trace events to trace_file, in the Chrome trace event
+  JSON format, which can be loaded by chrome://tracing or Perfetto.
+
+  With clear, the written events are dropped, so that the next save only
+  contains the new ones.
+  """
+  trace_data = torch_xla._XLAC._xla_chrome_trace()
+  if clear:
+    torch_xla._XLAC._xla_clear_trace()
+  with open(trace_file, 'w') as fd:
+    fd.write(trace_data)
@@ -0,0 +1,209 @@
+from __future__ import division
+from __future__ import print_function
+
+import contextlib
+import math
+import torch
+import torch_xla
+import torch_xla_py.xla_model as xm
+
+
+@contextlib.contextmanager
+def precision_scope(compute_type='bf16', accumulation_type='f32'):
+  """Runs the matmul and convolution operations created within the scope
+  according to a mixed precision policy.
+
+  The floating point operands of the operations are converted to compute_type,
+  and their results to accumulation_type. Valid types are 'bf16', 'f16', 'f32',
+  'f64', or the empty string to keep the operand types. The policy is per
+  thread, and it is captured when the operations are recorded, so the backward
+  of the operations only follows it if it runs within the scope as well. The
+  autograd engine threads, which record the backward of the XLA tensors,
+  follow the policy of the scope entered last by any thread.
+  """
+  prev_compute_type, prev_accumulation_type = (
+      torch_xla._XLAC._xla_get_mixed_precision())
+  torch_xla._XLAC._xla_set_mixed_precision(compute_type, accumulation_type)
+  try:
+    yield
+  finally:
+    torch_xla._XLAC._xla_set_mixed_precision(prev_compute_type,
+                                             prev_accumulation_type)
+
+
+class DynamicLossScaler(object):
+  """Scales the loss, to keep low precision gradients from underflowing.
+
+  The scale is lowered every time non finite gradients are found, in which case
+  the optimizer step is skipped, and it is raised again after growth_interval
+  consecutive steps with finite gradients.
+  Checking the gradients requires fetching a scalar value from the device, so
+  every step() call forces the execution of the pending graph.
+
+  Example:
+    scaler = DynamicLossScaler()
+    with precision_scope('bf16', 'f32'):
+      loss = loss_fn(model(data), target)
+      scaler.scale(loss).backward()
+    scaler.step(optimizer)
+  """
+
+  def __init__(self,
+               init_scale=2.0**15,
+               growth_factor=2.0,
+               backoff_factor=0.5,
+               growth_interval=2000,
+               min_scale=1.0):
+    self._scale = init_scale
+    self._growth_factor = growth_factor
+    self._backoff_factor = backoff_factor
+    self._growth_interval = growth_interval
+    self._min_scale = min_scale
+    self._good_steps = 0
+
+  @property
+  def loss_scale(self):
+    return self._scale
+
+  def scale(self, loss):
+    return loss * self._scale
+
+  def _unscale_gradients(self, gradients):
+    inv_scale = 1.0 / self._scale
+    # A single reduction over all the gradients is enough to detect non finite
+    # values, as both infinities and NaNs propagate through the sum.
+    total = None
+    for grad in gradients:
+      grad.mul_(inv_scale)
+      grad_sum = grad.float().abs().sum()
+      total = grad_sum if total is None else total + grad_sum
+    if total is None:
+      return True
+    total = total.item()
+    return not (math.isinf(total) or math.isnan(total))
+
+  def step(self, optimizer, optimizer_args={}):
+    """Reduces and unscales the gradients, and runs the optimizer step if they
+    are all finite.
+
+    Returns the value returned by the optimizer step, or None if the step has
+    been skipped.
+    """
+    xm.reduce_gradients(optimizer)
+    if not self._unscale_gradients(xm._fetch_gradients(optimizer)):
+      self._scale = max(self._scale * self._backoff_factor, self._min_scale)
+      self._good_steps = 0
+      return None
+    loss = optimizer.step(**optimizer_args)
+    self._good_steps += 1
+    if self._good_steps >= self._growth_interval:
+      self._scale *= self._growth_factor
+      self._good_steps = 0
+    return loss
+
+
+class DeviceLossScaler(object):
+  """A dynamic loss scaler which keeps its state on device, and never reads a
+  value back to the host.
+
+  The gradients are unscaled and checked for non finite values by a single IR
+  node, and the optimizer update of a step with non finite gradients is
+  dropped within the step graph, by selecting the previous values of the
+  parameters and of the optimizer state tensors. The loss scale is updated on
+  device as well, like `DynamicLossScaler` does on the host, so the whole
+  mixed precision step is traced into a single graph, which does not change
+  from one step to the next.
+  The optimizer state which is not made of tensors (like the host step
+  counters of `torch_xla_py.optimizers.Adam`) still advances on the skipped
+  steps.
+
+  Example:
+    scaler = DeviceLossScaler()
+    with precision_scope('bf16', 'f32'):
+      loss = loss_fn(model(data), target)
+      scaler.scale(loss).backward()
+    scaler.step(optimizer)
+    xm.mark_step()
+  """
+
+  def __init__(self,
+               init_scale=2.0**15,
+               growth_factor=2.0,
+               backoff_factor=0.5,
+               growth_interval=2000,
+               min_scale=1.0,
+               device=None):
+    device = device if device is not None else xm.xla_device()
+    self._scale = torch.tensor(init_scale, dtype=torch.float32, device=device)
+    self._good_steps = torch.zeros((), dtype=torch.float32, device=device)
+    self._growth_factor = growth_factor
+    self._backoff_factor = backoff_factor
+    self._growth_interval = growth_interval
+    self._min_scale = min_scale
+    self._found_inf = torch.zeros((), dtype=torch.float32, device=device)
+
+  @property
+  def loss_scale(self):
+    """The loss scale, as a F32 scalar XLA tensor."""
+    return self._scale
+
+  @property
+  def found_inf(self):
+    """The F32 scalar XLA tensor which is one if the gradients of the last step
+    held non finite values, and zero otherwise.
+    """
+    return self._found_inf
+
+  def scale(self, loss):
+    return loss * self._scale
+
+  def _capture_state(self, optimizer):
+    params = []
+    for group in optimizer.param_groups:
+      params.extend(p for p in group['params'] if p.grad is not None)
+    state = {}
+    for p in params:
+      state[p] = {
+          k: v.clone()
+          for k, v in optimizer.state[p].items()
+          if isinstance(v, torch.Tensor)
+      }
+    return params, [p.clone() for p in params], state
+
+  def step(self, optimizer, optimizer_args={}):
+    """Reduces and unscales the gradients, and runs the optimizer step, whose
+    updates are only kept if the gradients are all finite.
+
+    Returns the value returned by the optimizer step.
+    """
+    xm.reduce_gradients(optimizer)
+    gradients = xm._fetch_gradients(optimizer)
+    if gradients:
+      self._found_inf = torch_xla._XLAC._xla_amp_unscale_(
+          gradients, self._scale)
+    else:
+      # Without gradients there is nothing to skip, so the flag of the
+      # previous step must not carry over.
+      self._found_inf = torch.zeros_like(self._found_inf)
+    with torch.no_grad():
+      params, prev_params, prev_state = self._capture_state(optimizer)
+      loss = optimizer.step(**optimizer_args)
+      tensors, previous = list(params), prev_params
+      for p in params:
+        for k, v in optimizer.state[p].items():
+          if isinstance(v, torch.Tensor):
+            tensors.append(v)
+            # The state created by this step starts from zeros, like the
+            # optimizers initialize it.
+            previous.append(prev_state[p].get(k, torch.zeros_like(v)))
+      torch_xla._XLAC._xla_select_finite_updates_(tensors, previous,
+                                                  self._found_inf)
+      torch_xla._XLAC._xla_update_loss_scale_(
+          self._scale,
+          self._good_steps,
+          self._found_inf,
+          growth_factor=self._growth_factor,
+          backoff_factor=self._backoff_factor,
+          growth_interval=self._growth_interval,
+          min_scale=self._min_scale)
+    return loss
@@ -0,0 +1,73 @@
+from __future__ import division
+from __future__ import print_function
+
+import torch
+import torch_xla
+
+
+class _FusedGroupNorm(torch.autograd.Function):
+
+  @staticmethod
+  def forward(ctx, input, weight, bias, num_groups, affine_dims, eps):
+    output, mean, rstd = torch_xla._XLAC._xla_group_norm(
+        input, weight, bias, num_groups, affine_dims, eps=eps)
+    ctx.num_groups = num_groups
+    ctx.affine_dims = affine_dims
+    ctx.has_weight = weight is not None
+    ctx.has_bias = bias is not None
+    ctx.save_for_backward(input, weight, mean, rstd)
+    return output
+
+  @staticmethod
+  def backward(ctx, grad_output):
+    input, weight, mean, rstd = ctx.saved_tensors
+    grad_input, grad_weight, grad_bias = (
+        torch_xla._XLAC._xla_group_norm_backward(
+            grad_output,
+            input,
+            weight if ctx.has_weight else None,
+            mean,
+            rstd,
+            ctx.num_groups,
+            ctx.affine_dims))
+    return (grad_input, grad_weight if ctx.has_weight else None,
+            grad_bias if ctx.has_bias else None, None, None, None)
+
+
+def layer_norm(input, normalized_shape, weight=None, bias=None, eps=1e-5):
+  """Like `torch.nn.functional.layer_norm()`, lowered as a single fused
+  operation, which computes the statistics within one pass over the input, and
+  whose backward only saves the input and the per row mean and inverse standard
+  deviation.
+  """
+  if isinstance(normalized_shape, int):
+    normalized_shape = [normalized_shape]
+  begin_axis = input.dim() - len(normalized_shape)
+  assert list(input.size()[begin_axis:]) == list(normalized_shape), (
+      'Invalid normalized shape {} for input of size {}'.format(
+          normalized_shape, input.size()))
+  num_groups = 1
+  for size in input.size()[:begin_axis]:
+    num_groups *= size
+  return _FusedGroupNorm.apply(input, weight, bias, num_groups,
+                               list(range(begin_axis, input.dim())), eps)
+
+
+def group_norm(input, num_groups, weight=None, bias=None, eps=1e-5):
+  """Like `torch.nn.functional.group_norm()`, lowered as a single fused
+  operation (see `layer_norm()`).
+  """
+  assert input.size(1) % num_groups == 0, (
+      'The number of channels {} is not divisible by the groups {}'.format(
+          input.size(1), num_groups))
+  return _FusedGroupNorm.apply(input, weight, bias,
+                               input.size(0) * num_groups, [1], eps)
+
+
+def instance_norm(input, weight=None, bias=None, eps=1e-5):
+  """Like `torch.nn.functional.instance_norm()` with `use_input_stats=True` and
+  no running statistics, lowered as a single fused operation (see
+  `layer_norm()`).
+  """
+  return _FusedGroupNorm.apply(input, weight, bias,
+                               input.size(0) * input.size(1), [1], eps)
@@ -0,0 +1,238 @@
+from __future__ import division
+from __future__ import print_function
+
+import collections
+import math
+import torch
+import torch_xla
+
+
+def _group_params(params, key_fn):
+  # Splits the parameters with gradients by the key, keeping their order, so
+  # that the ones with different state (like a different step count) get
+  # updated by different fused steps.
+  groups = collections.OrderedDict()
+  for p in params:
+    if p.grad is not None:
+      groups.setdefault(key_fn(p), []).append(p)
+  return list(groups.items())
+
+
+def clip_grad_norm_(parameters, max_norm, norm_type=2):
+  """A replacement of `torch.nn.utils.clip_grad_norm_`, for XLA parameters.
+
+  The total norm of the gradients, and their scaling, are computed by a single
+  IR node, so no scalar is read back to the host in the middle of the step.
+
+  Args:
+    parameters (Iterable[Tensor] or Tensor): The parameters whose gradients
+      should be clipped.
+    max_norm (float or int): The max norm of the gradients.
+    norm_type (float or int): The type of the used p-norm, which can be
+      `inf` for the infinity norm.
+
+  Returns:
+    The total norm of the gradients, as a scalar XLA tensor.
+  """
+  if isinstance(parameters, torch.Tensor):
+    parameters = [parameters]
+  grads = [p.grad for p in parameters if p.grad is not None]
+  if not grads:
+    return torch.tensor(0.)
+  with torch.no_grad():
+    return torch_xla._XLAC._xla_clip_grad_norm_(
+        grads, max_norm=float(max_norm), norm_type=float(norm_type))
+
+
+class SGD(torch.optim.Optimizer):
+  """A drop-in replacement of `torch.optim.SGD`, for XLA parameters.
+
+  Every parameter group is updated by a single multi-tensor IR node, instead
+  of a handful of elementwise operations for every parameter, which shrinks
+  the graph, and the time it takes to trace and compile it. The learning rate
+  and the other hyperparameters are computation arguments, so changing them
+  does not trigger new compilations.
+  """
+
+  def __init__(self,
+               params,
+               lr,
+               momentum=0,
+               dampening=0,
+               weight_decay=0,
+               nesterov=False):
+    if lr < 0.0:
+      raise ValueError('Invalid learning rate: {}'.format(lr))
+    if momentum < 0.0:
+      raise ValueError('Invalid momentum value: {}'.format(momentum))
+    if weight_decay < 0.0:
+      raise ValueError('Invalid weight_decay value: {}'.format(weight_decay))
+    if nesterov and (momentum <= 0 or dampening != 0):
+      raise ValueError('Nesterov momentum requires a momentum and zero '
+                       'dampening')
+    defaults = dict(
+        lr=lr,
+        momentum=momentum,
+        dampening=dampening,
+        weight_decay=weight_decay,
+        nesterov=nesterov)
+    super(SGD, self).__init__(params, defaults)
+
+  def step(self, closure=None):
+    loss = None
+    if closure is not None:
+      loss = closure()
+    with torch.no_grad():
+      for group in self.param_groups:
+        use_momentum = group['momentum'] != 0
+
+        # The momentum buffers are initialized with the first gradients.
+        def needs_init(p):
+          return use_momentum and 'momentum_buffer' not in self.state[p]
+
+        for init_buffers, params in _group_params(group['params'], needs_init):
+          buffers = []
+          if use_momentum:
+            for p in params:
+              state = self.state[p]
+              if init_buffers:
+                state['momentum_buffer'] = torch.zeros_like(p)
+              buffers.append(state['momentum_buffer'])
+          torch_xla._XLAC._xla_sgd_step_(
+              params, [p.grad for p in params],
+              buffers,
+              lr=group['lr'],
+              momentum=group['momentum'],
+              dampening=group['dampening'],
+              weight_decay=group['weight_decay'],
+              nesterov=group['nesterov'],
+              init_buffers=init_buffers)
+    return loss
+
+
+class Adam(torch.optim.Optimizer):
+  """A drop-in replacement of `torch.optim.Adam`, for XLA parameters, which
+  updates every parameter group with a single IR node (see `SGD`).
+  """
+
+  def __init__(self,
+               params,
+               lr=1e-3,
+               betas=(0.9, 0.999),
+               eps=1e-8,
+               weight_decay=0,
+               amsgrad=False):
+    if lr < 0.0:
+      raise ValueError('Invalid learning rate: {}'.format(lr))
+    if eps < 0.0:
+      raise ValueError('Invalid epsilon value: {}'.format(eps))
+    if not 0.0 <= betas[0] < 1.0 or not 0.0 <= betas[1] < 1.0:
+      raise ValueError('Invalid beta parameters: {}'.format(betas))
+    defaults = dict(
+        lr=lr, betas=betas, eps=eps, weight_decay=weight_decay, amsgrad=amsgrad)
+    super(Adam, self).__init__(params, defaults)
+
+  def step(self, closure=None):
+    loss = None
+    if closure is not None:
+      loss = closure()
+    with torch.no_grad():
+      for group in self.param_groups:
+        beta1, beta2 = group['betas']
+        amsgrad = group['amsgrad']
+        get_step = lambda p: self.state[p].get('step', 0)
+        for num_steps, params in _group_params(group['params'], get_step):
+          for p in params:
+            state = self.state[p]
+            if not state:
+              state['step'] = 0
+              state['exp_avg'] = torch.zeros_like(p)
+              state['exp_avg_sq'] = torch.zeros_like(p)
+              if amsgrad:
+                state['max_exp_avg_sq'] = torch.zeros_like(p)
+            state['step'] += 1
+          num_steps += 1
+          bias_correction1 = 1 - beta1**num_steps
+          bias_correction2 = 1 - beta2**num_steps
+          step_size = group['lr'] * math.sqrt(
+              bias_correction2) / bias_correction1
+          states = [self.state[p] for p in params]
+          torch_xla._XLAC._xla_adam_step_(
+              params, [p.grad for p in params],
+              [s['exp_avg'] for s in states],
+              [s['exp_avg_sq'] for s in states],
+              [s['max_exp_avg_sq'] for s in states] if amsgrad else [],
+              step_size=step_size,
+              beta1=beta1,
+              beta2=beta2,
+              eps=group['eps'],
+              weight_decay=group['weight_decay'])
+    return loss
+
+
+class Lamb(torch.optim.Optimizer):
+  """The LAMB optimizer (https://arxiv.org/abs/1904.00962), for XLA
+  parameters, which updates every parameter group with a single IR node (see
+  `SGD`).
+
+  The Adam update of every parameter, with the weight decay added to it, is
+  scaled by the ratio between the norm of the parameter and the one of the
+  update (or by one, if either is zero).
+  """
+
+  def __init__(self,
+               params,
+               lr=1e-3,
+               betas=(0.9, 0.999),
+               eps=1e-6,
+               weight_decay=0,
+               bias_correction=True):
+    if lr < 0.0:
+      raise ValueError('Invalid learning rate: {}'.format(lr))
+    if eps < 0.0:
+      raise ValueError('Invalid epsilon value: {}'.format(eps))
+    if not 0.0 <= betas[0] < 1.0 or not 0.0 <= betas[1] < 1.0:
+      raise ValueError('Invalid beta parameters: {}'.format(betas))
+    defaults = dict(
+        lr=lr,
+        betas=betas,
+        eps=eps,
+        weight_decay=weight_decay,
+        bias_correction=bias_correction)
+    super(Lamb, self).__init__(params, defaults)
+
+  def step(self, closure=None):
+    loss = None
+    if closure is not None:
+      loss = closure()
+    with torch.no_grad():
+      for group in self.param_groups:
+        beta1, beta2 = group['betas']
+        get_step = lambda p: self.state[p].get('step', 0)
+        for num_steps, params in _group_params(group['params'], get_step):
+          for p in params:
+            state = self.state[p]
+            if not state:
+              state['step'] = 0
+              state['exp_avg'] = torch.zeros_like(p)
+              state['exp_avg_sq'] = torch.zeros_like(p)
+            state['step'] += 1
+          num_steps += 1
+          bias_correction1 = 1.0
+          bias_correction2 = 1.0
+          if group['bias_correction']:
+            bias_correction1 = 1 - beta1**num_steps
+            bias_correction2 = 1 - beta2**num_steps
+          states = [self.state[p] for p in params]
+          torch_xla._XLAC._xla_lamb_step_(
+              params, [p.grad for p in params],
+              [s['exp_avg'] for s in states],
+              [s['exp_avg_sq'] for s in states],
+              lr=group['lr'],
+              beta1=beta1,
+              beta2=beta2,
+              eps=group['eps'],
+              weight_decay=group['weight_decay'],
+              bias_correction1=bias_correction1,
+              bias_correction2=bias_correction2)
+    return loss
@@ -3,6 +3,7 @@ from __future__ import print_function
 
 import multiprocessing.dummy
 import threading
+import time
 import torch
 import torch_xla
 import torch_xla_py.utils as xu
@@ -11,7 +12,35 @@ import torch_xla_py.keyd_queue as kq
 
 class ParallelLoader(object):
 
-  def __init__(self, loader, batch_size, devices, prefetch_size=4, batchdim=0):
+  """Wraps a host data loader, and uploads its batches to the devices ahead of
+  their use.
+
+  Args:
+    loader: The host data loader, returning (data, target) batches.
+    batch_size (int): The size of the batches, which are split across the
+      devices along the batchdim dimension.
+    devices (list): The devices to send the batch slices to.
+    prefetch_size (int): The number of batches uploaded ahead of their use.
+    batchdim (int): The batch dimension of the data.
+    use_infeed (bool): Whether the uploads are run by the C++ infeed queue,
+      on background threads which do not involve the Python interpreter, or
+      by Python worker threads.
+
+  Either way, the lifecycle of the batches is reported by the InputQueueDepth
+  (uploaded batches ready when one is requested), InputPendingTime (loaded to
+  uploaded), InputReadyTime (uploaded to returned by next()) and
+  InputStallTime (time next() waits for a batch not uploaded yet) metrics.
+  A high InputStallTime marks an input bound training, while a InputQueueDepth
+  steadily close to prefetch_size means that the prefetch can be reduced.
+  """
+
+  def __init__(self,
+               loader,
+               batch_size,
+               devices,
+               prefetch_size=4,
+               batchdim=0,
+               use_infeed=True):
     self._loader = loader
     self._prefetch_size = prefetch_size
     self._batch_size = batch_size
@@ -28,6 +57,15 @@ class ParallelLoader(object):
     self._worker_count = 0
     self._data = None
     self._device_slices = None
+    self._infeed = None
+    self._host_batches = dict()
+    self._ready_times = dict()
+    if use_infeed:
+      self._infeed = torch_xla._XLAC.InfeedQueue(self._prefetch_size)
+      thread = threading.Thread(target=self._infeed_worker)
+      thread.daemon = True
+      thread.start()
+      return
     thread = threading.Thread(target=self._loader_worker)
     thread.daemon = True
     thread.start()
@@ -43,7 +81,10 @@ class ParallelLoader(object):
     return self.next()
 
   def next(self):
-    item = self._queue.get(self._batch_number)
+    if self._infeed is not None:
+      item = self._next_infeed()
+    else:
+      item = self._next_queued()
     if item is None:
       raise StopIteration
     self._data, target, self._device_slices = item
@@ -52,6 +93,8 @@ class ParallelLoader(object):
 
   def close(self):
     self._done = True
+    if self._infeed is not None:
+      self._infeed.close()
     self._queue.close()
     self._loader_queue.close()
 
@@ -69,7 +112,7 @@ class ParallelLoader(object):
     for (data, target) in self._loader:
       if data.size()[self._batchdim] != self._batch_size or self._done:
         break
-      self._loader_queue.put((batch_number, (data, target)))
+      self._loader_queue.put((batch_number, (data, target), time.time()))
       batch_number += 1
     self._loader_queue.close_write()
 
@@ -89,12 +132,11 @@ class ParallelLoader(object):
       raise RuntimeError('Unsupported input type: {}'.format(type(data)))
 
   def _send_to_devices(self, slices, pool):
-
-    def _send(i):
-      return slices[i].to(device=torch.device(self._devices[i]))
-
     if isinstance(slices[0], torch.Tensor):
-      return pool.map(_send, range(0, len(slices)))
+      # The slices are copied into reusable host staging buffers, and then
+      # sent to the devices with a single (parallel) transfer.
+      return torch_xla._XLAC._xla_staged_tensors_from_aten(
+          slices, [str(device) for device in self._devices])
     elif isinstance(slices[0], (list, tuple)):
       device_slices = []
       for xslice in slices:
@@ -103,6 +145,68 @@ class ParallelLoader(object):
     else:
       raise RuntimeError('Unsupported input type: {}'.format(type(slices[0])))
 
+  def _flatten_slices(self, slices, tensors, devices, device):
+    if isinstance(slices, torch.Tensor):
+      tensors.append(slices)
+      devices.append(str(device))
+    else:
+      for xslice in slices:
+        self._flatten_slices(xslice, tensors, devices, device)
+
+  def _unflatten_slices(self, slices, tensors_iter):
+    if isinstance(slices, torch.Tensor):
+      return next(tensors_iter)
+    return type(slices)(
+        self._unflatten_slices(xslice, tensors_iter) for xslice in slices)
+
+  def _infeed_worker(self):
+    batch_number = 0
+    for (data, target) in self._loader:
+      if data.size()[self._batchdim] != self._batch_size or self._done:
+        break
+      slices = self._create_tensor_slices(data)
+      tensors, devices = [], []
+      for device, device_slice in zip(self._devices, slices):
+        self._flatten_slices(device_slice, tensors, devices, device)
+      with self._lock:
+        self._host_batches[batch_number] = (data, target, slices)
+      if not self._infeed.put(batch_number, tensors, devices):
+        break
+      batch_number += 1
+    self._infeed.close_write()
+
+  def _next_infeed(self):
+    tensors = self._infeed.get(self._batch_number)
+    if tensors is None:
+      return None
+    with self._lock:
+      data, target, slices = self._host_batches.pop(self._batch_number)
+    tensors_iter = iter(tensors)
+    device_slices = [
+        self._unflatten_slices(device_slice, tensors_iter)
+        for device_slice in slices
+    ]
+    return data, target, device_slices
+
+  def _next_queued(self):
+    # The infeed queue reports the same metrics from C++.
+    with self._lock:
+      depth = len(self._ready_times)
+      ready = self._batch_number in self._ready_times
+    torch_xla._XLAC._xla_metric_add_value('InputQueueDepth', depth)
+    start_time = time.time()
+    item = self._queue.get(self._batch_number)
+    now = time.time()
+    if not ready:
+      torch_xla._XLAC._xla_metric_add_time('InputStallTime',
+                                           1e9 * (now - start_time))
+    if item is not None:
+      with self._lock:
+        ready_time = self._ready_times.pop(self._batch_number)
+      torch_xla._XLAC._xla_metric_add_time('InputReadyTime',
+                                           1e9 * (now - ready_time))
+    return item
+
   def _worker(self):
     pool = multiprocessing.dummy.Pool(len(self._devices))
     self._up_workers(1)
@@ -110,9 +214,14 @@ class ParallelLoader(object):
       item = self._loader_queue.get()
       if item is None:
         break
-      batch_number, (data, target) = item
+      batch_number, (data, target), load_time = item
       slices = self._create_tensor_slices(data)
       device_slices = self._send_to_devices(slices, pool)
+      ready_time = time.time()
+      torch_xla._XLAC._xla_metric_add_time('InputPendingTime',
+                                           1e9 * (ready_time - load_time))
+      with self._lock:
+        self._ready_times[batch_number] = ready_time
       self._queue.put(batch_number, (data, target, device_slices))
     if self._up_workers(-1) == 0:
       self._queue.close_write()
@@ -0,0 +1,148 @@
+from __future__ import division
+from __future__ import print_function
+
+import itertools
+import torch
+import torch_xla
+
+
+class Pipeline(object):
+  """Runs a model split into sequential stages, each placed on its own XLA
+  device, as a GPipe style pipeline.
+
+  The batches are split into `chunks` micro-batches, which flow through the
+  stages following the pipeline clock: at clock `t`, stage `i` runs the
+  micro-batch `t - i` (the backward pass walks the stages the other way). The
+  computation of every micro-batch on a stage is issued asynchronously once
+  traced, and its activations (or gradients) move to the next stage with a
+  direct device to device copy, so that the devices run their micro-batches
+  concurrently, while the host traces the following ones.
+
+  Example:
+
+    pipe = Pipeline([encoder, decoder], [devices[0], devices[1]], chunks=4)
+    optimizer = optim.SGD(pipe.parameters(), lr=0.1)
+    for data, target in loader:
+      optimizer.zero_grad()
+      loss = pipe.forward_backward(data, target, loss_fn)
+      optimizer.step()
+      xm.mark_step()
+
+  Args:
+    stages (list): The `torch.nn.Module` stages, which are moved to their
+      devices. Every stage is called with the output of the previous one.
+    devices (list): The XLA devices of the stages.
+    chunks (int): The number of micro-batches every batch is split into.
+  """
+
+  def __init__(self, stages, devices, chunks):
+    assert len(stages) == len(devices), 'Every stage needs its own device'
+    assert chunks > 0, 'The number of micro-batches must be positive'
+    self._devices = [torch.device(device) for device in devices]
+    self._stages = [
+        stage.to(device) for stage, device in zip(stages, self._devices)
+    ]
+    self._chunks = chunks
+
+  @property
+  def stages(self):
+    return self._stages
+
+  @property
+  def devices(self):
+    return self._devices
+
+  def parameters(self):
+    return itertools.chain(*[stage.parameters() for stage in self._stages])
+
+  def _send(self, tensor, index, device):
+    # Issues the pending computations of the stage, so that the copy (and the
+    # tracing of the following micro-batches) does not wait for them, and the
+    # activations saved for the backward pass get materialized with them.
+    torch_xla._XLAC._xla_sync_live_tensors(
+        str(self._devices[index]), [], wait=False)
+    return tensor.detach().to(device)
+
+  def _clocks(self):
+    return range(self._chunks + len(self._stages) - 1)
+
+  def _run_forward(self, micro_batches):
+    num_stages = len(self._stages)
+    inputs = [[None] * len(micro_batches) for _ in range(num_stages)]
+    outputs = [[None] * len(micro_batches) for _ in range(num_stages)]
+    for clock in self._clocks():
+      for i in range(num_stages):
+        k = clock - i
+        if k < 0 or k >= len(micro_batches):
+          continue
+        if i == 0:
+          x = micro_batches[k].to(self._devices[0])
+        else:
+          x = self._send(outputs[i - 1][k], i - 1, self._devices[i])
+          x.requires_grad_(torch.is_grad_enabled())
+        inputs[i][k] = x
+        outputs[i][k] = self._stages[i](x)
+    return inputs, outputs
+
+  def forward(self, input):
+    """Runs the batch through the pipeline.
+
+    Args:
+      input (torch.Tensor): The batch, split into micro-batches along its first
+        dimension.
+
+    Returns:
+      The output of the last stage, on its device, with the micro-batch
+      outputs concatenated along the first dimension. The gradients do not
+      flow through the stage boundaries, use `forward_backward()` to train.
+    """
+    with torch.no_grad():
+      _, outputs = self._run_forward(input.chunk(self._chunks))
+    return torch.cat(outputs[-1])
+
+  def __call__(self, input):
+    return self.forward(input)
+
+  def forward_backward(self, input, target, loss_fn):
+    """Runs the forward and backward passes of the batch through the pipeline,
+    accumulating the gradients of the stage parameters.
+
+    Args:
+      input (torch.Tensor): The batch, split into micro-batches along its first
+        dimension.
+      target (torch.Tensor): The targets of the batch, split like the input.
+      loss_fn (callable): The loss function, called with the output of the
+        last stage and the target, for every micro-batch. It must average over
+        the batch, as the micro-batch losses are weighted by their share of the
+        batch.
+
+    Returns:
+      The loss of the batch, on the device of the last stage.
+    """
+    micro_batches = input.chunk(self._chunks)
+    micro_targets = target.chunk(self._chunks)
+    assert len(micro_batches) == len(micro_targets)
+    num_stages = len(self._stages)
+    inputs, outputs = self._run_forward(micro_batches)
+    last_device = self._devices[-1]
+    grads = [None] * len(micro_batches)
+    loss = None
+    for clock in self._clocks():
+      for i in range(num_stages - 1, -1, -1):
+        k = clock - (num_stages - 1 - i)
+        if k < 0 or k >= len(micro_batches):
+          continue
+        if i == num_stages - 1:
+          weight = micro_batches[k].size(0) / input.size(0)
+          mb_loss = loss_fn(outputs[i][k],
+                            micro_targets[k].to(last_device)) * weight
+          loss = mb_loss.detach() if loss is None else loss + mb_loss.detach()
+          mb_loss.backward()
+        else:
+          outputs[i][k].backward(
+              self._send(grads[k], i + 1, self._devices[i]))
+        if i > 0:
+          grads[k] = inputs[i][k].grad
+        inputs[i][k] = None
+        outputs[i][k] = None
+    return loss
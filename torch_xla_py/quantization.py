@@ -0,0 +1,114 @@
+from __future__ import division
+from __future__ import print_function
+
+import torch
+import torch.nn as nn
+import torch_xla
+
+
+def quantize_per_channel(weight):
+  """Quantizes a floating point weight to int8, with symmetric per output
+  channel (dimension 0) scales.
+
+  Args:
+    weight (torch.Tensor): The CPU weight to quantize.
+
+  Returns:
+    The `(qweight, scales)` tuple, with the int8 weight, and the float scales
+    of its output channels, such that `weight ~= qweight * scales`.
+  """
+  flat = weight.detach().reshape(weight.size(0), -1).float()
+  scales = flat.abs().max(dim=1)[0] / 127.0
+  scales = torch.where(scales > 0, scales, torch.ones_like(scales))
+  qweight = torch.round(flat / scales.unsqueeze(1)).clamp_(-127, 127)
+  return qweight.to(torch.int8).view(weight.size()), scales
+
+
+class QuantizedLinear(nn.Module):
+  """An inference only `nn.Linear` with an int8 weight.
+
+  The input is quantized with the static `input_scale` (like the max absolute
+  value of the calibration inputs, divided by 127), the products are
+  accumulated in int32, and the result is requantized with the per channel
+  weight scales. Moving the module to an XLA device uploads the int8 weight,
+  a quarter of the size of the float one.
+
+  Args:
+    qweight (torch.Tensor): The int8 weight, of shape
+      `[out_features, in_features]`.
+    scales (torch.Tensor): The float scales of the output features.
+    bias (torch.Tensor, optional): The float bias.
+    input_scale (float): The quantization scale of the input.
+  """
+
+  def __init__(self, qweight, scales, bias=None, input_scale=1.0):
+    super(QuantizedLinear, self).__init__()
+    self.register_buffer('qweight', qweight)
+    self.register_buffer('scales', scales)
+    self.register_buffer('bias', bias)
+    self.input_scale = input_scale
+
+  @classmethod
+  def from_float(cls, linear, input_scale):
+    qweight, scales = quantize_per_channel(linear.weight)
+    bias = linear.bias.detach() if linear.bias is not None else None
+    return cls(qweight, scales, bias=bias, input_scale=input_scale)
+
+  def forward(self, input):
+    return torch_xla._XLAC._xla_quantized_linear(
+        input,
+        self.qweight,
+        self.scales,
+        bias=self.bias,
+        input_scale=self.input_scale)
+
+
+class QuantizedConv2d(nn.Module):
+  """An inference only `nn.Conv2d` with an int8 weight (see
+  `QuantizedLinear`).
+  """
+
+  def __init__(self,
+               qweight,
+               scales,
+               bias=None,
+               input_scale=1.0,
+               stride=1,
+               padding=0,
+               dilation=1,
+               groups=1):
+    super(QuantizedConv2d, self).__init__()
+    self.register_buffer('qweight', qweight)
+    self.register_buffer('scales', scales)
+    self.register_buffer('bias', bias)
+    self.input_scale = input_scale
+    self.stride = nn.modules.utils._pair(stride)
+    self.padding = nn.modules.utils._pair(padding)
+    self.dilation = nn.modules.utils._pair(dilation)
+    self.groups = groups
+
+  @classmethod
+  def from_float(cls, conv, input_scale):
+    qweight, scales = quantize_per_channel(conv.weight)
+    bias = conv.bias.detach() if conv.bias is not None else None
+    return cls(
+        qweight,
+        scales,
+        bias=bias,
+        input_scale=input_scale,
+        stride=conv.stride,
+        padding=conv.padding,
+        dilation=conv.dilation,
+        groups=conv.groups)
+
+  def forward(self, input):
+    return torch_xla._XLAC._xla_quantized_convolution(
+        input,
+        self.qweight,
+        self.scales,
+        self.bias,
+        self.input_scale,
+        stride=list(self.stride),
+        padding=list(self.padding),
+        dilation=list(self.dilation),
+        groups=self.groups)
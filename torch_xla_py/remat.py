@@ -0,0 +1,133 @@
+from __future__ import division
+from __future__ import print_function
+
+import math
+import torch
+import torch_xla
+
+
+def _as_tuple(value):
+  return value if isinstance(value, tuple) else (value,)
+
+
+class _Checkpoint(torch.autograd.Function):
+
+  @staticmethod
+  def forward(ctx, function, *args):
+    ctx.function = function
+    ctx.save_for_backward(*args)
+    with torch.no_grad():
+      outputs = function(*args)
+    return outputs
+
+  @staticmethod
+  def backward(ctx, *grads):
+    inputs = ctx.saved_tensors
+    anchor = next((grad for grad in grads if grad is not None), None)
+    if anchor is not None:
+      # Make the recomputation dependent on the incoming gradients, so that the
+      # activations are not materialized before the backward pass needs them,
+      # and the recomputation is not merged with the forward one.
+      anchored = torch_xla._XLAC._xla_remat_anchor(list(inputs), anchor)
+    else:
+      anchored = [input.detach() for input in inputs]
+    detached = []
+    for input, anchored_input in zip(inputs, anchored):
+      detached.append(anchored_input.requires_grad_(input.requires_grad))
+    with torch.enable_grad():
+      outputs = _as_tuple(ctx.function(*detached))
+    backward_outputs = []
+    backward_grads = []
+    for output, grad in zip(outputs, grads):
+      if output.requires_grad and grad is not None:
+        backward_outputs.append(output)
+        backward_grads.append(grad)
+    torch.autograd.backward(backward_outputs, backward_grads)
+    return (None,) + tuple(input.grad for input in detached)
+
+
+def checkpoint(function, *args):
+  """Runs `function(*args)` without retaining its intermediate activations.
+
+  The function runs under `torch.no_grad()` in the forward pass, and it is run
+  again within the backward pass, to recompute the activations needed by the
+  gradients. The recomputation is anchored to the incoming gradients, so that
+  XLA keeps it within the backward pass, instead of merging it with the forward
+  computation. The arguments must be XLA tensors, and the function must return a
+  tensor or a tuple of tensors. At least one of the arguments must require
+  gradients, for the backward pass to run through the function (including the
+  gradients of the parameters it uses).
+  The function should not use random operations, as the recomputation would
+  draw different random values than the forward pass.
+  """
+  return _Checkpoint.apply(function, *args)
+
+
+def _run_segment(functions):
+
+  def run(input):
+    for function in functions:
+      input = function(input)
+    return input
+
+  return run
+
+
+def _activation_bytes(functions, input):
+  # The activations are only traced, and never executed, since their values are
+  # dropped without being fetched.
+  sizes = []
+  with torch.no_grad():
+    for function in functions:
+      input = function(input)
+      sizes.append(input.numel() * input.element_size())
+  return sizes
+
+
+def _budget_segments(sizes, budget_bytes):
+  # Greedily closes a segment when its activations would exceed the budget.
+  # Segments of a single function are never split further.
+  segments = []
+  start = 0
+  segment_bytes = 0
+  for i, size in enumerate(sizes):
+    if i > start and segment_bytes + size > budget_bytes:
+      segments.append((start, i))
+      start = i
+      segment_bytes = 0
+    segment_bytes += size
+  segments.append((start, len(sizes)))
+  return segments
+
+
+def checkpoint_sequential(functions, input, segments=None, budget_bytes=None):
+  """Runs the `functions` in sequence over the `input`, checkpointing them.
+
+  The functions are split into segments, and only the inputs of each segment
+  are retained for the backward pass, while the activations within a segment
+  are recomputed with `checkpoint()`. If `budget_bytes` is given, the segments
+  are chosen so that the activations of each one (estimated from the sizes of
+  the function outputs) fit the budget, which bounds the memory needed to run
+  the backward pass of a segment. Otherwise the functions are split into
+  `segments` segments of equal length, or `sqrt(len(functions))` if not given.
+  The last segment is not checkpointed, as its backward pass follows
+  immediately.
+  """
+  if isinstance(functions, torch.nn.Sequential):
+    functions = list(functions.children())
+  functions = list(functions)
+  if not functions:
+    return input
+  if budget_bytes is not None:
+    bounds = _budget_segments(
+        _activation_bytes(functions, input), budget_bytes)
+  else:
+    if segments is None:
+      segments = max(int(math.sqrt(len(functions))), 1)
+    size = int(math.ceil(len(functions) / segments))
+    bounds = [(start, min(start + size, len(functions)))
+              for start in range(0, len(functions), size)]
+  for start, end in bounds[:-1]:
+    input = checkpoint(_run_segment(functions[start:end]), input)
+  start, end = bounds[-1]
+  return _run_segment(functions[start:end])(input)
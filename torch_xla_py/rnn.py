@@ -0,0 +1,136 @@
+from __future__ import division
+from __future__ import print_function
+
+import torch
+import torch_xla
+
+
+def _grad_or_zeros(grad, like):
+  return torch.zeros_like(like) if grad is None else grad
+
+
+def _bias_grad(grad, bias):
+  return None if bias is None else grad
+
+
+class _FusedLSTMCell(torch.autograd.Function):
+
+  @staticmethod
+  def forward(ctx, input, hx, cx, w_ih, w_hh, b_ih, b_hh):
+    h, c, gates = torch_xla._XLAC._xla_lstm_cell(
+        input, hx, cx, w_ih, w_hh, b_ih=b_ih, b_hh=b_hh)
+    ctx.biases = (b_ih, b_hh)
+    ctx.save_for_backward(input, hx, cx, w_ih, w_hh, c, gates)
+    return h, c
+
+  @staticmethod
+  def backward(ctx, grad_h, grad_c):
+    input, hx, cx, w_ih, w_hh, c, gates = ctx.saved_tensors
+    grads = torch_xla._XLAC._xla_lstm_cell_backward(
+        _grad_or_zeros(grad_h, c), _grad_or_zeros(grad_c, c), input, hx, cx,
+        w_ih, w_hh, c, gates)
+    b_ih, b_hh = ctx.biases
+    return tuple(grads[:5]) + (_bias_grad(grads[5], b_ih),
+                               _bias_grad(grads[5], b_hh))
+
+
+class _FusedGRUCell(torch.autograd.Function):
+
+  @staticmethod
+  def forward(ctx, input, hx, w_ih, w_hh, b_ih, b_hh):
+    h, gates = torch_xla._XLAC._xla_gru_cell(
+        input, hx, w_ih, w_hh, b_ih=b_ih, b_hh=b_hh)
+    ctx.biases = (b_ih, b_hh)
+    ctx.save_for_backward(input, hx, w_ih, w_hh, gates)
+    return h
+
+  @staticmethod
+  def backward(ctx, grad_h):
+    input, hx, w_ih, w_hh, gates = ctx.saved_tensors
+    grads = torch_xla._XLAC._xla_gru_cell_backward(grad_h, input, hx, w_ih,
+                                                   w_hh, gates)
+    b_ih, b_hh = ctx.biases
+    return tuple(grads[:4]) + (_bias_grad(grads[4], b_ih),
+                               _bias_grad(grads[5], b_hh))
+
+
+class _FusedLSTM(torch.autograd.Function):
+
+  @staticmethod
+  def forward(ctx, input, h0, c0, w_ih, w_hh, b_ih, b_hh):
+    output, cells, gates = torch_xla._XLAC._xla_lstm_sequence(
+        input, h0, c0, w_ih, w_hh, b_ih=b_ih, b_hh=b_hh)
+    ctx.biases = (b_ih, b_hh)
+    ctx.save_for_backward(input, h0, c0, w_ih, w_hh, output, cells, gates)
+    return output, cells
+
+  @staticmethod
+  def backward(ctx, grad_output, grad_cells):
+    input, h0, c0, w_ih, w_hh, output, cells, gates = ctx.saved_tensors
+    grads = torch_xla._XLAC._xla_lstm_sequence_backward(
+        _grad_or_zeros(grad_output, output), _grad_or_zeros(grad_cells, cells),
+        input, h0, c0, w_ih, w_hh, output, cells, gates)
+    b_ih, b_hh = ctx.biases
+    return tuple(grads[:5]) + (_bias_grad(grads[5], b_ih),
+                               _bias_grad(grads[5], b_hh))
+
+
+class _FusedGRU(torch.autograd.Function):
+
+  @staticmethod
+  def forward(ctx, input, h0, w_ih, w_hh, b_ih, b_hh):
+    output, gates = torch_xla._XLAC._xla_gru_sequence(
+        input, h0, w_ih, w_hh, b_ih=b_ih, b_hh=b_hh)
+    ctx.biases = (b_ih, b_hh)
+    ctx.save_for_backward(input, h0, w_ih, w_hh, output, gates)
+    return output
+
+  @staticmethod
+  def backward(ctx, grad_output):
+    input, h0, w_ih, w_hh, output, gates = ctx.saved_tensors
+    grads = torch_xla._XLAC._xla_gru_sequence_backward(
+        grad_output, input, h0, w_ih, w_hh, output, gates)
+    b_ih, b_hh = ctx.biases
+    return tuple(grads[:4]) + (_bias_grad(grads[4], b_ih),
+                               _bias_grad(grads[5], b_hh))
+
+
+def lstm_cell(input, hx, cx, w_ih, w_hh, b_ih=None, b_hh=None):
+  """Computes an LSTM cell step, like `torch.nn.LSTMCell` does, as a single
+  fused operation whose input and hidden projections share one dot.
+
+  The arguments follow the `torch.nn.LSTMCell` layouts (the weights and biases
+  are its `weight_ih`, `weight_hh`, `bias_ih` and `bias_hh`), and the biases
+  are optional. Returns the `(h, c)` tuple of the new states.
+  """
+  return _FusedLSTMCell.apply(input, hx, cx, w_ih, w_hh, b_ih, b_hh)
+
+
+def gru_cell(input, hx, w_ih, w_hh, b_ih=None, b_hh=None):
+  """Computes a GRU cell step, like `torch.nn.GRUCell` does, as a single fused
+  operation. Returns the new hidden state.
+  """
+  return _FusedGRUCell.apply(input, hx, w_ih, w_hh, b_ih, b_hh)
+
+
+def lstm(input, h0, c0, w_ih, w_hh, b_ih=None, b_hh=None):
+  """Runs a single layer, unidirectional, LSTM over the `[T, B, I]` input, like
+  `torch.nn.LSTM` does.
+
+  The steps are lowered to an XLA While loop (the backward walks them back
+  within another one), so that the size of the graph does not grow with `T`.
+  The input projections of all the steps are computed by a single dot ahead of
+  the loop. Returns the `[T, B, H]` output and the `(h_n, c_n)` tuple of the
+  final states, which are `[B, H]` (unlike `torch.nn.LSTM`, there is no layers
+  dimension).
+  """
+  output, cells = _FusedLSTM.apply(input, h0, c0, w_ih, w_hh, b_ih, b_hh)
+  return output, (output[-1], cells[-1])
+
+
+def gru(input, h0, w_ih, w_hh, b_ih=None, b_hh=None):
+  """Same as `lstm()`, for a GRU. Returns the `[T, B, H]` output and the `[B,
+  H]` final hidden state.
+  """
+  output = _FusedGRU.apply(input, h0, w_ih, w_hh, b_ih, b_hh)
+  return output, output[-1]
@@ -0,0 +1,104 @@
+from __future__ import division
+from __future__ import print_function
+
+import torch
+import torch.nn.functional as F
+import torch_xla
+import torch_xla_py.xla_model as xm
+
+
+class ShardedOptimizer(object):
+  """Wraps an optimizer so that every replica only keeps the optimizer state of
+  its shard of the parameters.
+
+  Every parameter is flattened, padded to a multiple of the number of
+  replicas, and split in as many shards. The wrapped optimizer is created over
+  the shards of the local replica only, so its state (like the Adam moments)
+  takes 1/N of the memory it would take otherwise. At every step, the
+  gradients are reduce-scattered into the shards, the wrapped optimizer
+  updates them, and the updated shards are all-gathered back into the full
+  parameters.
+
+  The gradients are reduced within step(), so xm.reduce_gradients() leaves
+  them untouched for this optimizer, and the optimizer_step() compression
+  arguments do not apply.
+
+  Example:
+    optimizer = ShardedOptimizer(torch.optim.Adam, model.parameters(), lr=1e-3)
+    ...
+    xm.optimizer_step(optimizer)
+
+  Args:
+    optimizer_cls (class): The class of the wrapped optimizer.
+    params (iterable): The parameters to optimize, or the dicts defining the
+      parameter groups, like for any torch optimizer.
+    **defaults: The arguments of the wrapped optimizer constructor.
+  """
+
+  shards_gradients = True
+
+  def __init__(self, optimizer_cls, params, **defaults):
+    self._replica_count = max(
+        torch_xla._XLAC._xla_get_replication_devices_count(), 1)
+    self._replica_index = xm.get_replica_index()
+    param_groups = list(params)
+    if not param_groups or not isinstance(param_groups[0], dict):
+      param_groups = [{'params': param_groups}]
+    self.param_groups = []
+    self._shards = []
+    shard_groups = []
+    for group in param_groups:
+      params = [p for p in group['params'] if p.requires_grad]
+      shards = [self._create_shard(p) for p in params]
+      self.param_groups.append(dict(group, params=params))
+      shard_groups.append(dict(group, params=shards))
+      self._shards.extend(zip(params, shards))
+    self.optimizer = optimizer_cls(shard_groups, **defaults)
+
+  def _shard_size(self, p):
+    return (p.numel() + self._replica_count - 1) // self._replica_count
+
+  def _flat_padded(self, tensor):
+    flat = tensor.reshape(-1)
+    padding = self._shard_size(tensor) * self._replica_count - flat.numel()
+    return F.pad(flat, (0, padding)) if padding > 0 else flat
+
+  def _create_shard(self, p):
+    size = self._shard_size(p)
+    start = self._replica_index * size
+    shard = self._flat_padded(p.data)[start:start + size].clone()
+    return torch.nn.Parameter(shard)
+
+  def __getstate__(self):
+    return {'param_groups': self.param_groups}
+
+  def zero_grad(self):
+    for p, _ in self._shards:
+      if p.grad is not None:
+        p.grad.detach_()
+        p.grad.zero_()
+
+  def step(self, closure=None):
+    for p, shard in self._shards:
+      if p.grad is None:
+        shard.grad = None
+        continue
+      grad = self._flat_padded(p.grad.data)
+      if self._replica_count > 1:
+        shard.grad = xm.reduce_scatter(grad, scale=1.0 / self._replica_count)
+      else:
+        shard.grad = grad
+    loss = self.optimizer.step(closure)
+    for p, shard in self._shards:
+      if self._replica_count > 1:
+        full = xm.all_gather(shard.data)
+      else:
+        full = shard.data
+      p.data.copy_(full[:p.numel()].view_as(p))
+    return loss
+
+  def state_dict(self):
+    return self.optimizer.state_dict()
+
+  def load_state_dict(self, state_dict):
+    self.optimizer.load_state_dict(state_dict)
@@ -1,9 +1,12 @@
 from __future__ import print_function
 
 import collections
+import contextlib
 import gc
+import itertools
 from six import itervalues
 import os
+import pickle
 import re
 import threading
 import time
@@ -16,6 +19,7 @@ import torch_xla_py.utils as xu
 import torch_xla_py.keyd_queue as kq
 
 _TLS = threading.local()
+_GRAD_READY_COUNTER = itertools.count()
 
 
 def is_xla_tensor(tensor):
@@ -57,6 +61,17 @@ def is_master_ordinal():
   return getattr(_TLS, 'device_index', 0) == 0
 
 
+def get_replica_index():
+  """Returns the index of the current device within the replication devices,
+  which is the replica ID the collectives refer to.
+  """
+  replication_devices = torch_xla._XLAC._xla_get_replication_devices()
+  if not replication_devices:
+    return 0
+  device = xla_real_devices([torch_xla._XLAC._xla_get_default_device()])[0]
+  return replication_devices.index(device)
+
+
 def xla_device(n=None, devkind=None):
   if n is None:
     devices = get_xla_supported_devices(devkind=devkind)
@@ -110,6 +125,11 @@ def xla_replication_devices(local_devices):
       raise RuntimeError('Invalid device format: {}'.format(device))
     if xdev[0] == device_type:
       replication_devices.append(device)
+  if xu.getenv_as('XLA_TOPOLOGY_REPLICA_ORDER', bool, True):
+    # Order the replicas so that ring collectives only hop between neighbor
+    # devices of the interconnect.
+    replication_devices = torch_xla._XLAC._xla_get_topology_ordered_devices(
+        replication_devices)
   return replication_devices
 
 
@@ -125,6 +145,31 @@ def set_replication(device, devices):
   torch_xla._XLAC._xla_set_default_device(device)
 
 
+def set_replicated_execution(devices):
+  """Enables the single thread replicated execution over devices.
+
+  The calling thread traces the step graph on the first device, and the graph
+  is compiled once and executed on all the devices at the same time, instead
+  of being traced by one thread per device. The tensors holding different
+  values on every replica (like the input batches) must be created with
+  replicated_tensor(), while the regular tensors (like the model parameters)
+  have the same value on all the replicas. Fetching a tensor value returns
+  the one of the first replica.
+  """
+  set_replication(devices[0], devices)
+  torch_xla._XLAC._xla_set_replicated_execution(True)
+
+
+def replicated_tensor(shards):
+  """Returns a tensor which, within the replicated execution, holds shards[i]
+  on the i-th replication device.
+  """
+  master_device = xla_real_devices(
+      [torch_xla._XLAC._xla_get_default_device()])[0]
+  return torch_xla._XLAC._xla_replicated_tensor(
+      shards, torch_xla._XLAC._xla_get_replication_devices(), master_device)
+
+
 class RateTracker(object):
 
   def __init__(self, smooth_factor=None):
@@ -240,6 +285,109 @@ class TestStepMetrics(object):
                                   self._accuracy, self._examples_per_sec)
 
 
+class MetricAccumulator(object):
+  """Accumulates the loss and the top-k accuracy of a training or evaluation
+  loop within device tensors.
+
+  The running sums are updated in place by the step graphs, and are only
+  fetched to the host (asynchronously) when `fetch()` is called, like at the
+  logging intervals, so that the steps do not need to sync with the host to
+  report their metrics.
+
+  Args:
+    device (torch.device): The device the sums are kept on.
+    topk (tuple, optional): The `k` values whose top-k correct predictions are
+      counted.
+      Default: (1,)
+  """
+
+  def __init__(self, device, topk=(1,)):
+    self._device = device
+    self._topk = tuple(topk)
+    self.reset()
+
+  def reset(self):
+    """Zeroes the accumulated metrics."""
+    self._loss_sum = torch.zeros([], dtype=torch.float32, device=self._device)
+    self._correct = torch.zeros([len(self._topk)],
+                                dtype=torch.float32,
+                                device=self._device)
+    self._count = 0
+
+  def add(self, target, output=None, loss=None):
+    """Accumulates the metrics of a batch.
+
+    Args:
+      target (torch.Tensor): The XLA tensor with the class indices of the
+        batch samples.
+      output (torch.Tensor, optional): The XLA tensor with the per class scores
+        of the batch samples (shaped `[batch, classes]`), whose top-k
+        predictions are checked against `target`.
+      loss (torch.Tensor, optional): The XLA tensor with the mean loss of the
+        batch.
+    """
+    count = target.size(0)
+    with torch.no_grad():
+      if loss is not None:
+        self._loss_sum.add_(loss.detach().float() * count)
+      if output is not None:
+        _, pred = output.detach().topk(max(self._topk), dim=1)
+        hits = pred.eq(target.view(-1, 1)).float()
+        correct = [hits[:, :k].sum() for k in self._topk]
+        self._correct.add_(torch.stack(correct))
+    self._count += count
+
+  def fetch(self, callback=None):
+    """Starts fetching the accumulated metrics to the host.
+
+    Args:
+      callback (callable, optional): The function called with the dict of the
+        metrics once the fetch completes, likely from a background thread.
+
+    Returns:
+      A handle whose `wait()` method returns the dict of the metrics, with the
+      `count` of the samples, the mean `loss` and the `top<k>` accuracy
+      percentages, and whose `is_ready()` method tells whether the fetch has
+      completed.
+    """
+    return _MetricAccumulatorFetch(self._loss_sum, self._correct, self._count,
+                                   self._topk, callback)
+
+
+class _MetricAccumulatorFetch(object):
+
+  def __init__(self, loss_sum, correct, count, topk, callback):
+    self._count = count
+    self._topk = topk
+    self._handle = None
+    self._values = None
+    if is_xla_tensor(loss_sum):
+      done_fn = None
+      if callback is not None:
+        done_fn = lambda handle: callback(self._to_metrics(handle.wait()))
+      self._handle = fetch_async([loss_sum, correct], callback=done_fn)
+    else:
+      # The loops running on the PyTorch CPU engine have nothing to fetch.
+      self._values = [loss_sum.clone(), correct.clone()]
+      if callback is not None:
+        callback(self._to_metrics(self._values))
+
+  def _to_metrics(self, values):
+    loss_sum, correct = values
+    count = max(self._count, 1)
+    metrics = {'count': self._count, 'loss': loss_sum.item() / count}
+    for i, k in enumerate(self._topk):
+      metrics['top{}'.format(k)] = 100.0 * correct[i].item() / count
+    return metrics
+
+  def is_ready(self):
+    return self._handle is None or self._handle.is_ready()
+
+  def wait(self):
+    values = self._values if self._handle is None else self._handle.wait()
+    return self._to_metrics(values)
+
+
 class ToXlaTensorArena(object):
 
   def __init__(self, convert_fn, select_fn):
@@ -350,6 +498,39 @@ def _fetch_gradients(optimizer):
   return gradients
 
 
+def _record_grad_ready(p):
+
+  def hook(grad):
+    p._xla_grad_ready = next(_GRAD_READY_COUNTER)
+
+  p.register_hook(hook)
+  p._xla_grad_ready = -1
+
+
+def _fetch_gradients_in_ready_order(optimizer):
+  """Returns the optimizer gradients in the order the backward pass computed
+  them.
+
+  The cross replica sum buckets the gradients in the order they are passed, so
+  this keeps the gradients which become available together within the same
+  buckets, and the collectives of the earliest buckets only depend on the
+  first part of the backward pass, which lets the XLA scheduler overlap them
+  with the rest of it. The order is recorded by gradient hooks, which get
+  registered at the first call, so the first step uses the parameters order.
+  """
+  params = []
+  for param_group in optimizer.__getstate__()['param_groups']:
+    for p in param_group['params']:
+      if isinstance(p, torch.Tensor) and p.grad is not None:
+        if not hasattr(p, '_xla_grad_ready'):
+          _record_grad_ready(p)
+        params.append(p)
+  # The parameters which just got their hooks have the -1 mark, and the sort is
+  # stable, so they stay in parameters order.
+  params.sort(key=lambda p: p._xla_grad_ready)
+  return [p.grad.data for p in params]
+
+
 def mark_step():
   torch_xla._XLAC._xla_step_marker(
       torch_xla._XLAC._xla_get_default_device(), [],
@@ -360,12 +541,843 @@ def mark_step():
     ms.save_metrics()
 
 
-def optimizer_step(optimizer, barrier=False, optimizer_args={}):
-  gradients = _fetch_gradients(optimizer)
+def set_rng_state(seed, device=None):
+  """Sets the seed of the XLA random number generator.
+
+  The random operations draw their values from a stateless, counter based,
+  generator, whose state is advanced within the graph, starting from a per step
+  seed which is fed to the graph as device data. Changing the seed does not
+  cause recompilations, and replicas with the same seed produce the same random
+  streams.
+
+  Args:
+    seed (int): The new seed.
+    device (string, optional): The device whose seed to set. If None, the seed
+      of all the devices is set.
+  """
+  torch_xla._XLAC._xla_set_rng_seed(
+      seed, str(device) if device is not None else '')
+
+
+def get_rng_state(device=None):
+  """Returns the current seed of the XLA random number generator of the device
+  (the default one if None).
+  """
+  return torch_xla._XLAC._xla_get_rng_seed(
+      str(device) if device is not None else '')
+
+
+_EXECUTION_PRIORITIES = {'high': 0, 'normal': 1, 'low': 2}
+
+
+@contextlib.contextmanager
+def execution_priority(priority):
+  """Runs the syncs issued within the scope with the given priority class.
+
+  The syncs of different priority classes are not serialized on the device, so
+  a low priority graph (like an evaluation step) can be issued while the normal
+  priority training steps are in flight, and its execution is dispatched to the
+  device once no higher priority executions are waiting. The number of
+  concurrent executions per device is bounded by XLA_DEVICE_MAX_EXECUTIONS.
+  The priority is per thread.
+
+  Args:
+    priority (string): One of 'high', 'normal' or 'low'.
+  """
+  assert priority in _EXECUTION_PRIORITIES, (
+      'Invalid execution priority: {}'.format(priority))
+  prev_priority = torch_xla._XLAC._xla_set_execution_priority(
+      _EXECUTION_PRIORITIES[priority])
+  try:
+    yield
+  finally:
+    torch_xla._XLAC._xla_set_execution_priority(prev_priority)
+
+
+def fetch_async(tensors, callback=None):
+  """Starts fetching the values of the XLA tensors to the host, without
+  waiting for their computation to complete.
+
+  Returns a handle whose wait() method returns the list of CPU tensors, and
+  whose is_ready() method tells whether the fetch has completed. If callback
+  is not None, it is called with the handle once the fetch completes, likely
+  from a background thread. Fetching after mark_step() overlaps the transfer
+  with the tracing of the next step, which is useful to report losses and
+  metrics without serializing host and device.
+
+  Args:
+    tensors (list): The XLA tensors to fetch. They must all be on the same
+      device.
+    callback (callable, optional): The function to call with the handle, once
+      the fetch completes.
+  """
+  handle = torch_xla._XLAC._xla_get_tensors_async(tensors)
+  if callback is not None:
+    handle.add_done_callback(callback)
+  return handle
+
+
+def _as_tensor_list(outputs):
+  if isinstance(outputs, torch.Tensor):
+    return [outputs]
+  return list(outputs)
+
+
+def cond(pred, true_fn, false_fn, operands):
+  """Returns `true_fn(*operands)` if the `pred` tensor holds true, or
+  `false_fn(*operands)` otherwise, computed by a conditional within the device
+  computation, so that `pred` does not have to be fetched to the host.
+
+  Both functions are traced once, with placeholders of the operands, and must
+  return lists (or tuples) of tensors of the same sizes and types. The tensors
+  they read, besides the operands, are captured by the conditional, while the
+  ones they compute must not be used outside of them. No autograd history is
+  recorded within the functions.
+
+  Args:
+    pred (torch.Tensor): The scalar boolean XLA tensor selecting the branch.
+    true_fn (callable): The function computing the outputs when `pred` is true.
+    false_fn (callable): The function computing the outputs when `pred` is
+      false.
+    operands (list): The XLA tensors the functions are called with.
+
+  Returns:
+    The list of the XLA tensors holding the outputs of the selected function.
+  """
+  operands = list(operands)
+  scope, params = torch_xla._XLAC._xla_subgraph_parameters(operands)
+  with torch.no_grad():
+    true_outputs = _as_tensor_list(true_fn(*params))
+    false_outputs = _as_tensor_list(false_fn(*params))
+  return torch_xla._XLAC._xla_cond(pred, operands, scope, true_outputs,
+                                   false_outputs)
+
+
+def while_loop(cond_fn, body_fn, operands):
+  """Runs `operands = body_fn(*operands)` while `cond_fn(*operands)` returns
+  true, as a loop within the device computation, so that the loop condition
+  does not have to be fetched to the host at every iteration.
+
+  Both functions are traced once, with placeholders of the operands. The
+  `cond_fn` must return a scalar boolean tensor, and the `body_fn` a list (or
+  tuple) of tensors with the sizes and types of the operands. The captured
+  tensors are handled like within `cond()`.
+
+  Args:
+    cond_fn (callable): The function computing the loop condition.
+    body_fn (callable): The function computing the loop state of the next
+      iteration.
+    operands (list): The XLA tensors holding the initial loop state.
+
+  Returns:
+    The list of the XLA tensors holding the loop state once `cond_fn` returns
+    false.
+  """
+  operands = list(operands)
+  scope, params = torch_xla._XLAC._xla_subgraph_parameters(operands)
+  with torch.no_grad():
+    condition = cond_fn(*params)
+    body_outputs = _as_tensor_list(body_fn(*params))
+  return torch_xla._XLAC._xla_while_loop(operands, scope, condition,
+                                         body_outputs)
+
+
+def bounded_valid_mask(count, size):
+  """Returns the boolean mask of the valid leading rows of a bounded result.
+
+  Args:
+    count (torch.Tensor): The XLA scalar tensor with the count of the valid
+      rows, as returned together with the bounded result.
+    size (int): The size of the outer dimension of the bounded result.
+
+  Returns:
+    The XLA tensor of shape `[size]` which is true for the valid rows, and
+    which can be used to mask the padded rows within the following operations
+    (like reductions), without fetching the count to the host.
+  """
+  return torch.arange(0, size, device=count.device, dtype=count.dtype) < count
+
+
+def nonzero_bounded(input):
+  """Returns the indices of the non-zero elements of the `input`, like
+  `torch.nonzero()`, but with a size which does not depend on the data, so that
+  it runs on the device.
+
+  Args:
+    input (torch.Tensor): The XLA input tensor.
+
+  Returns:
+    A `(indices, count)` tuple, with the `[input.numel(), input.dim()]`
+    indices tensor, whose first `count` rows are the indices of the non-zero
+    elements (the other ones are zeros), and the scalar `count` tensor.
+  """
+  return torch_xla._XLAC._xla_nonzero_bounded(input)
+
+
+def masked_select_bounded(input, mask):
+  """Returns the elements of the `input` where the `mask` is true, like
+  `torch.masked_select()`, but with a size which does not depend on the data.
+
+  Args:
+    input (torch.Tensor): The XLA input tensor.
+    mask (torch.Tensor): The XLA boolean mask, broadcastable with the `input`.
+
+  Returns:
+    A `(values, count)` tuple, with the 1D values tensor, sized as the number
+    of elements of the broadcast shape, whose first `count` elements are the
+    selected ones (the other ones are zeros), and the scalar `count` tensor.
+  """
+  return torch_xla._XLAC._xla_masked_select_bounded(input, mask)
+
+
+def unique_bounded(input):
+  """Returns the sorted unique elements of the `input`, like `torch.unique()`,
+  but with a size which does not depend on the data.
+
+  Args:
+    input (torch.Tensor): The XLA input tensor.
+
+  Returns:
+    A `(values, count)` tuple, with the 1D values tensor, sized as
+    `input.numel()`, whose first `count` elements are the unique elements in
+    ascending order (the other ones are zeros), and the scalar `count` tensor.
+  """
+  return torch_xla._XLAC._xla_unique_bounded(input)
+
+
+def run_steps(step_fn, stacked_inputs, device=None):
+  """Runs a training step once for every slice of the outer dimension of the
+  `stacked_inputs`, within a single device execution.
+
+  The step is traced once, by calling `step_fn` with the XLA tensors of the
+  first slices, and its graph is wrapped within a device side loop which feeds
+  it the following slices. All the slices are uploaded together, so the host
+  dispatch and upload costs are paid once every K steps, which helps small
+  models reach the device throughput. The tensors updated in place by the step
+  (like the model parameters, and the optimizer state) carry their values from
+  one step to the next. Host side values (like the Python step counters of
+  the optimizers, a learning rate schedule, or the RNG seed) are only traced
+  once, so all the K steps see the same ones.
+
+  Args:
+    step_fn (callable): The function running one training step, called with
+      the XLA tensors of the inputs of the step.
+    stacked_inputs (list): The CPU tensors holding the inputs of the K steps,
+      stacked along their first dimension.
+    device (torch.device, optional): The XLA device the steps run on.
+      Default: the current default XLA device
+
+  Returns:
+    The value returned by `step_fn`, whose tensors hold the values of the last
+    step.
+  """
+  device = str(device) if device is not None else str(xla_device())
+  stacked_inputs = list(stacked_inputs)
+  devices = [device] * len(stacked_inputs)
+  # The pending operations must not end up within the loop.
+  torch_xla._XLAC._xla_sync_live_tensors(device, [], wait=False)
+  stacked = torch_xla._XLAC._xla_tensors_from_aten_async(
+      stacked_inputs, devices).wait()
+  step_inputs = torch_xla._XLAC._xla_tensors_from_aten_async(
+      [t[0].clone() for t in stacked_inputs], devices).wait()
+  outputs = step_fn(*step_inputs)
+  torch_xla._XLAC._xla_sync_live_tensors_steps(
+      device,
+      step_inputs,
+      stacked,
+      wait=xu.getenv_as('XLA_SYNC_WAIT', bool, False))
+  torch_xla._XLAC._xla_step_marker(device, [], wait=False)
+  return outputs
+
+
+def create_execution_plan(fn, example_inputs, device=None):
+  """Traces and compiles `fn` once, returning a callable which runs it on new
+  input values, without tracing it again.
+
+  The returned plan is called with a list of CPU tensors, of the same sizes and
+  types of the `example_inputs`, and returns the list of the XLA tensors
+  holding the outputs of `fn`. Every call only uploads the inputs and runs the
+  compiled computation, so the host side cost does not depend on the size of
+  the graph, and the plan can be called from multiple threads at once. The
+  other tensors read by `fn` (like the model parameters) are bound to the plan
+  with their current values, and they must not have pending computations
+  (call `mark_step()` first, after updating them). The inference mode batch
+  normalizations following a convolution are folded into the convolution
+  weights, unless the `XLA_FOLD_INFERENCE_GRAPHS` environment variable is
+  false.
+
+  Args:
+    fn (callable): The function to trace, called with the XLA tensors of the
+      inputs. It must return a tensor, or a list or tuple of tensors.
+    example_inputs (list): The CPU tensors whose sizes and types the plan
+      inputs must have.
+    device (torch.device, optional): The XLA device the plan runs on.
+      Default: the current default XLA device
+  """
+  device = str(device) if device is not None else str(xla_device())
+  inputs = torch_xla._XLAC._xla_tensors_from_aten_async(
+      list(example_inputs), [device] * len(example_inputs)).wait()
+  with torch.no_grad():
+    outputs = fn(*inputs)
+  if isinstance(outputs, torch.Tensor):
+    outputs = [outputs]
+  return torch_xla._XLAC.ExecutionPlan(inputs, list(outputs))
+
+
+def create_batching_executor(fn,
+                             example_inputs,
+                             batch_sizes=(1, 2, 4, 8, 16, 32),
+                             max_delay_ms=2.0,
+                             device=None):
+  """Creates an executor which batches the concurrent calls of `fn`, to run
+  them as a single computation.
+
+  One execution plan (see `create_execution_plan()`) is compiled for every
+  batch size. The requests are submitted with `submit()`, which takes the list
+  of the CPU tensors of the inputs, with the batch dimension (the first one) of
+  any size up to the largest one in `batch_sizes`, and returns a future of the
+  list of the CPU tensors of the outputs. The queued requests are grouped into
+  a batch once the largest batch size is filled, or once the oldest request has
+  waited `max_delay_ms` milliseconds. The batch is padded to the smallest batch
+  size fitting it, and the outputs (which must be batched along their first
+  dimension as well) are split back among the requests. The executor is thread
+  safe.
+
+  Args:
+    fn (callable): The function to trace, called with the XLA tensors of the
+      inputs. It must return a tensor, or a list or tuple of tensors.
+    example_inputs (list): The CPU tensors whose types, and sizes past the
+      first dimension, the request inputs must have.
+    batch_sizes (list, optional): The batch sizes the plans are compiled for.
+      More batch sizes reduce the padding, at the cost of compilations.
+      Default: (1, 2, 4, 8, 16, 32)
+    max_delay_ms (float, optional): The time the requests can wait in queue
+      for more requests to batch them with. Default: 2.0
+    device (torch.device, optional): The XLA device the plans run on.
+      Default: the current default XLA device
+  """
+  plans = dict()
+  for batch_size in sorted(set(batch_sizes)):
+    inputs = [
+        torch.zeros((batch_size,) + tuple(t.shape[1:]), dtype=t.dtype)
+        for t in example_inputs
+    ]
+    plans[batch_size] = create_execution_plan(fn, inputs, device=device)
+  return torch_xla._XLAC.BatchingExecutor(plans, int(max_delay_ms * 1e6))
+
+
+def save_checkpoint(state_dict, path):
+  """Saves the XLA tensors of a flat name to tensor dict, to a checkpoint file.
+
+  The device data is streamed straight into the file, in chunks, from multiple
+  threads, without creating intermediate CPU tensors. The format is not the
+  torch.save() one, and the file must be loaded with load_checkpoint().
+
+  Args:
+    state_dict (dict): The dict of name to XLA tensor, like the one returned by
+      the state_dict() API of a module on an XLA device.
+    path (string): The path of the checkpoint file.
+  """
+  names = list(state_dict.keys())
+  tensors = [state_dict[name] for name in names]
+  torch_xla._XLAC._xla_save_checkpoint(path, names, tensors)
+
+
+def save_checkpoint_async(state_dict, path):
+  """Saves the XLA tensors of a state dict to a checkpoint file, in background.
+
+  Like save_checkpoint(), but only waits for the pending operations of the
+  tensors to be executed, which is cheap right after a mark_step(). The device
+  data of the tensors is captured at that point, and written to the file while
+  the training goes on, so the following updates of the tensors do not affect
+  the saved values. The captured device memory is released once the write
+  completes.
+
+  Args:
+    state_dict (dict): The dict of name to XLA tensor, like the one returned by
+      the state_dict() API of a module on an XLA device.
+    path (string): The path of the checkpoint file.
+
+  Returns:
+    A future object, whose `wait()` API blocks until the file is written (and
+    raises the error of the write, if any), and whose `is_ready()` API tells
+    whether the write has completed.
+  """
+  names = list(state_dict.keys())
+  tensors = [state_dict[name] for name in names]
+  return torch_xla._XLAC._xla_save_checkpoint_async(path, names, tensors)
+
+
+def load_checkpoint(path, device=None):
+  """Loads a checkpoint file written by save_checkpoint() to an XLA device.
+
+  Args:
+    path (string): The path of the checkpoint file.
+    device (torch.device, optional): The XLA device the tensors are loaded to.
+      Default: the current default XLA device
+
+  Returns:
+    The collections.OrderedDict of the names to the XLA tensors, in the order
+    they were saved.
+  """
+  entries = torch_xla._XLAC._xla_load_checkpoint(
+      path, str(device) if device is not None else '')
+  return collections.OrderedDict(entries)
+
+
+def save_graph_bundle(path):
+  """Saves the graphs compiled so far into a bundle file, which can be loaded
+  at deployment time with load_graph_bundle().
+
+  The graphs of interest should be traced and run (like a few training or
+  inference steps, with all the input shapes the deployment will see) before
+  saving the bundle.
+
+  Args:
+    path (string): The path of the bundle file.
+  """
+  torch_xla._XLAC._xla_save_graph_bundle(path)
+
+
+def load_graph_bundle(path, lazy=False):
+  """Loads a bundle written by save_graph_bundle(), compiling all its graphs
+  upfront, so that the steps which trace the same graphs run without
+  compiling them.
+
+  The bundle can only be loaded on a service with the same devices (and
+  replication devices) it was saved with, and an error is raised otherwise.
+
+  Args:
+    path (string): The path of the bundle file.
+    lazy (bool, optional): If True, the graphs are compiled in background
+      instead, starting with the ones predicted to be synced next (according to
+      the graph sequences seen by the run which saved the bundle, and by the
+      current one). A step syncing a graph not compiled yet compiles it right
+      away, without tracing it again.
+      Default: False
+
+  Returns:
+    The number of loaded graphs.
+  """
+  return torch_xla._XLAC._xla_load_graph_bundle(path, lazy=lazy)
+
+
+def save_ir_capture(tensors, path):
+  """Captures the IR graph of the tensors into a compact binary file, which can
+  be replayed offline with replay_ir_capture(), without the model and the data
+  which produced it.
+
+  Args:
+    tensors (list): The XLA tensors whose pending graph is captured.
+    path (string): The path of the capture file.
+  """
+  torch_xla._XLAC._xla_save_ir_capture(tensors, path)
+
+
+def replay_ir_capture(path, device=None, iterations=10):
+  """Replays a graph saved by save_ir_capture(), with zero filled inputs of the
+  captured shapes, lowering, compiling and running it on the device.
+
+  Args:
+    path (string): The path of the capture file.
+    device (torch.device, optional): The device to replay the graph on.
+      Default: the default XLA device
+    iterations (int, optional): The number of executions of the graph.
+      Default: 10
+
+  Returns:
+    A dictionary with the number of nodes and parameters of the graph, the
+    lowering and compilation times (`lowering_ms`, `compile_ms`) and the list
+    of the per iteration execution times (`execute_ms`), in milliseconds, and
+    the sizes of the graph results (`output_sizes`).
+  """
+  return torch_xla._XLAC._xla_replay_ir_capture(
+      path,
+      device=str(device) if device is not None else '',
+      iterations=iterations)
+
+
+def fetch_for_monitoring(tensors, transform='bf16', dequantize=True):
+  """Fetches the XLA tensors to the host for logging or visualization, after
+  reducing them on device, so that only the reduced data is transferred.
+
+  Args:
+    tensors (list): The XLA tensors to be fetched.
+    transform (string, optional): The reduction applied on device. One of
+      `none`, `bf16` (rounded to bfloat16), `int8` (symmetric int8
+      quantization), `subsample:<stride>` (every stride-th element of the
+      flattened tensor) or `histogram:<bins>`.
+      Default: `bf16`
+    dequantize (bool, optional): Whether the `int8` results are converted back
+      to float on the host, instead of being returned as (values, scale) pairs.
+      Default: True
+
+  Returns:
+    The list of the host results, one per input tensor. The `histogram`
+    results are (counts, range) pairs, where range holds the {min, max} values
+    the bins span.
+  """
+  results = torch_xla._XLAC._xla_fetch_transformed(tensors, transform)
+  outputs = []
+  for result in results:
+    if len(result) == 1:
+      outputs.append(result[0])
+    elif transform == 'int8' and dequantize:
+      outputs.append(result[0].float() * result[1])
+    else:
+      outputs.append(tuple(result))
+  return outputs
+
+
+def tensors_from_file(mapped_file, offsets, sizes, dtype, device=None):
+  """Uploads dense arrays stored within a binary file, straight to an XLA
+  device.
+
+  The arrays must be stored in row major order, with no padding. Their data
+  goes from the memory mapped file pages to the transfer, without creating
+  intermediate CPU tensors, or staging copies.
+
+  Example:
+    mapped_file = torch_xla._XLAC.MappedFile('/data/train.bin')
+    images, labels = xm.tensors_from_file(
+        mapped_file, [offset, offset + images_size],
+        [(batch_size, 3, 224, 224), (batch_size,)], torch.uint8)
+
+  Args:
+    mapped_file (torch_xla._XLAC.MappedFile or string): The memory mapped file,
+      or its path. Mapping the file once, and reusing the object, avoids the
+      cost of mapping it at every call.
+    offsets (list): The byte offsets of the arrays within the file.
+    sizes (list): The sizes of the arrays, as lists of dimensions.
+    dtype (torch.dtype): The type of the arrays elements.
+    device (torch.device, optional): The XLA device the tensors are uploaded
+      to. Default: the current default XLA device
+
+  Returns:
+    The list of the XLA tensors, one per array.
+  """
+  if isinstance(mapped_file, str):
+    mapped_file = torch_xla._XLAC.MappedFile(mapped_file)
+  return torch_xla._XLAC._xla_tensors_from_mapped_file(
+      mapped_file, offsets, [list(s) for s in sizes], dtype,
+      str(device) if device is not None else '')
+
+
+def _shard_count(groups):
+  if groups:
+    return len(groups[0])
+  return torch_xla._XLAC._xla_get_replication_devices_count()
+
+
+def all_gather(value, dim=0, groups=None):
+  """Concatenates the value tensors of the replicas along dim.
+
+  With groups (a list of lists of replica indices, all of the same size), the
+  concatenation only spans the replicas of every group.
+  """
+  groups = groups or []
+  return torch_xla._XLAC._xla_all_gather(value, dim, _shard_count(groups),
+                                         groups)
+
+
+def reduce_scatter(value, scale=1.0, dim=0, groups=None):
+  """Sums the value tensors of the replicas, scales the result, and returns the
+  slice along dim matching the replica index (within its group).
+
+  The size of dim must be a multiple of the number of replicas (per group).
+  """
+  groups = groups or []
+  return torch_xla._XLAC._xla_reduce_scatter(value, scale, dim,
+                                             _shard_count(groups), groups)
+
+
+def all_to_all(value, split_dimension, concat_dimension, groups=None):
+  """Splits the value along split_dimension, sends the j-th slice to the j-th
+  replica (within its group), and concatenates the received slices along
+  concat_dimension.
+  """
+  groups = groups or []
+  return torch_xla._XLAC._xla_all_to_all(value, split_dimension,
+                                         concat_dimension, _shard_count(groups),
+                                         groups)
+
+
+def collective_permute(value, source_target_pairs):
+  """Sends the value of every source replica to its target replica, given as
+  a list of (source, target) pairs. Replicas which are not the target of any
+  pair get zeros.
+  """
+  return torch_xla._XLAC._xla_collective_permute(value, source_target_pairs)
+
+
+def rendezvous(tag, payload=None, replicas=None):
+  """Waits for all the processes (xrt_world_size() of them, by default) to
+  reach the rendezvous with the same tag, through the mesh service.
+
+  Returns the payloads (bytes) of the processes which sent one, sorted by
+  ordinal. The tag must be unique among the rendezvous which can be in flight
+  at the same time.
+  """
+  if replicas is None:
+    replicas = xrt_world_size()
+  return torch_xla._XLAC._xla_rendezvous(tag, replicas, get_ordinal(), payload)
+
+
+def mesh_broadcast(tag, value=None, root_ordinal=0):
+  """Returns the value passed by the process with root_ordinal, to all the
+  processes. The value can be any picklable object, and it is only sent by the
+  root process, within a single mesh service rendezvous.
+  """
+  payload = pickle.dumps(value) if get_ordinal() == root_ordinal else None
+  payloads = rendezvous(tag, payload=payload)
+  return pickle.loads(payloads[0])
+
+
+def mesh_reduce(tag, value, reduce_fn):
+  """Reduces small host values (like scalars, or early stopping flags) across
+  the processes, without involving the devices.
+
+  Every process gets reduce_fn(values), where values is the list of the
+  (picklable) values of all the processes, in ordinal order.
+  """
+  payloads = rendezvous(tag, payload=pickle.dumps(value))
+  return reduce_fn([pickle.loads(p) for p in payloads])
+
+
+def set_key_values(key_values):
+  """Stores the dict of key/value (string/bytes) pairs in the mesh service."""
+  torch_xla._XLAC._xla_set_key_values(key_values)
+
+
+def get_key_values(keys, wait_seconds=300.0):
+  """Returns the values of the keys stored in the mesh service, waiting up to
+  wait_seconds for all of them to be set.
+  """
+  return torch_xla._XLAC._xla_get_key_values(keys, wait_seconds)
+
+
+def _hierarchical_host_groups():
+  host_groups = torch_xla._XLAC._xla_get_replication_host_groups()
+  # The hierarchical reduction only pays off with multiple hosts, each having
+  # multiple replicas, and it requires all the hosts to have the same number
+  # of replicas.
+  if len(host_groups) < 2 or len(host_groups[0]) < 2:
+    return []
+  if any(len(group) != len(host_groups[0]) for group in host_groups):
+    return []
+  return host_groups
+
+
+def broadcast_master_param(model, root=0, groups=None):
+  """Replaces the parameters and buffers of the model (or the tensors of a
+  list) with the ones of the root replica.
+
+  The broadcast is a cross replica sum, where the other replicas contribute
+  zeros, so only the root replica needs to hold the actual values, uploaded
+  once from the host. The other replicas can skip loading a checkpoint, or
+  uploading their copy of the model. All the replicas must call it, with the XLA
+  tensors of the same shapes, and types, in the same order.
+  With groups (a list of lists of replica indices), the broadcast happens within
+  every group, from its root-th replica.
+  """
+  if torch_xla._XLAC._xla_get_replication_devices_count() <= 1:
+    return
+  if isinstance(model, torch.nn.Module):
+    tensors = list(model.parameters()) + list(model.buffers())
+  else:
+    tensors = list(model)
+  replica = get_replica_index()
+  if groups:
+    group = next(group for group in groups if replica in group)
+    is_root = group[root] == replica
+  else:
+    is_root = replica == root
+  values = [t.detach() if is_root else torch.zeros_like(t) for t in tensors]
+  # Boolean tensors cannot be summed, so they go through uint8, where only the
+  # root replica contributes a one.
+  values = [v.to(torch.uint8) if v.dtype == torch.bool else v for v in values]
+  torch_xla._XLAC._xla_cross_replica_sum(values, 1.0, groups or [])
+  values = [
+      v.to(torch.bool) if t.dtype == torch.bool else v
+      for t, v in zip(tensors, values)
+  ]
+  for tensor, value in zip(tensors, values):
+    tensor.data = value
+  torch_xla._XLAC._xla_sync_multi(values, [], wait=False)
+
+
+def reduce_gradients(optimizer,
+                     compression='',
+                     error_feedback=False,
+                     hierarchical=False):
+  """Averages the optimizer gradients across the replicas.
+
+  With compression='bf16', the f32 gradients are reduced in bf16 and
+  accumulated back in f32. With error_feedback, the rounding error of every
+  gradient is added back to it at the following reduction. With hierarchical,
+  the gradients are reduce-scattered within every host, the shards summed
+  across the hosts, and all-gathered back within every host.
+  """
   count = torch_xla._XLAC._xla_get_replication_devices_count()
-  if count > 1:
-    torch_xla._XLAC._xla_cross_replica_sum(gradients, 1.0 / count, [])
+  # Sharded optimizers reduce the gradients into their shards within step().
+  if count > 1 and not getattr(optimizer, 'shards_gradients', False):
+    gradients = _fetch_gradients_in_ready_order(optimizer)
+    torch_xla._XLAC._xla_cross_replica_sum(
+        gradients,
+        1.0 / count, [],
+        compression=compression,
+        error_feedback=error_feedback,
+        host_groups=_hierarchical_host_groups() if hierarchical else [])
+
+
+def set_memory_category(tensors, category):
+  """Sets the category under which the device memory of the tensors is
+  accounted, one of 'input', 'activation', 'parameter' or 'optimizer_state'.
+
+  The category sticks to the tensors, and applies to the values they get from
+  the following steps as well.
+  """
+  tensors = [t for t in tensors if is_xla_tensor(t)]
+  if tensors:
+    torch_xla._XLAC._xla_set_memory_category(tensors, category)
+
+
+def set_materialize(tensors, materialize=False):
+  """Sets whether the pending values of the tensors get computed, and kept in
+  device memory, by the graphs of the following `mark_step()` calls.
+
+  Tensors which are not materialized keep their pending computation, and get
+  computed (again) only if they are read, so it is meant for intermediate
+  results still referenced by Python, but not needed after the step. With
+  `XLA_PRUNE_INTERNAL_OUTPUTS=1`, the tensors whose pending values are only
+  consumed by the pending computations of other tensors are not materialized
+  either.
+  """
+  tensors = [t for t in tensors if is_xla_tensor(t)]
+  if tensors:
+    torch_xla._XLAC._xla_set_materialize(tensors, materialize)
+
+
+def mark_sharding(tensor, mesh_shape, partition_spec):
+  """Annotates the pending value of the tensor with the way it is split across
+  a device mesh, so that the compiler partitions the graph using it (SPMD) and
+  inserts the needed collectives.
+
+  The annotation becomes part of the graph (and of its hash), so it needs to be
+  applied at every step, like right after the operation computing the value
+  (for example the output of a large matmul, or an embedding table).
+
+  Args:
+    tensor (torch.Tensor): The XLA tensor to annotate.
+    mesh_shape (list): The shape of the device mesh, whose devices are numbered
+      in row-major order.
+    partition_spec (list): For every dimension of the tensor, the index of the
+      mesh axis it is split along, or None if it is not split. All the mesh
+      axes need to split a dimension, unless no dimension is split, which
+      makes the tensor replicated.
+  """
+  dim_axes = [-1 if axis is None else axis for axis in partition_spec]
+  torch_xla._XLAC._xla_mark_sharding(tensor, list(mesh_shape), dim_axes)
+
+
+def memory_info():
+  """Returns a dictionary with the live, peak and per category bytes of every
+  device.
+  """
+  return torch_xla._XLAC._xla_memory_info()
+
+
+def largest_allocations(count=20, device=None):
+  """Returns the count largest live device tensors, as dictionaries with their
+  device, shape, bytes and category.
+  """
+  return torch_xla._XLAC._xla_largest_allocations(
+      count=count, device=str(device) if device is not None else '')
+
+
+def _tag_optimizer_memory(optimizer):
+  # The optimizer state is created by the first step, and the categories stick
+  # to the tensors, so tagging once is enough.
+  if getattr(optimizer, '_xla_memory_tagged', False):
+    return
+  for param_group in optimizer.param_groups:
+    set_memory_category(param_group['params'], 'parameter')
+  for state in getattr(optimizer, 'state', {}).values():
+    set_memory_category(
+        [v for v in state.values() if isinstance(v, torch.Tensor)],
+        'optimizer_state')
+  optimizer._xla_memory_tagged = True
+
+
+def _accumulate_gradients(optimizer, accumulation_steps):
+  # Folds the gradients of a micro-batch into device resident buffers, which
+  # are updated in place, and returns whether the last micro-batch of the
+  # accumulation has been reached, in which case the gradients hold the sums.
+  buffers = getattr(optimizer, '_xla_grad_buffers', None)
+  if buffers is None:
+    buffers = dict()
+    optimizer._xla_grad_buffers = buffers
+  count = getattr(optimizer, '_xla_accumulated_steps', 0) + 1
+  last = count >= accumulation_steps
+  for param_group in optimizer.param_groups:
+    for p in param_group['params']:
+      buf = buffers.get(id(p), None)
+      if p.grad is None:
+        if last and buf is not None:
+          # The parameter got no gradient in the last micro-batch, but did in
+          # the previous ones.
+          p.grad = buf.clone()
+          buf.zero_()
+        continue
+      if last:
+        if buf is not None:
+          p.grad.add_(buf)
+          # Zeroing in place keeps the buffers as device data for the next
+          # accumulation, so all its micro-batches run the same graph.
+          buf.zero_()
+      else:
+        if buf is None:
+          buffers[id(p)] = p.grad.detach().clone()
+        else:
+          buf.add_(p.grad)
+        p.grad = None
+  optimizer._xla_accumulated_steps = 0 if last else count
+  return last
+
+
+def optimizer_step(optimizer,
+                   barrier=False,
+                   optimizer_args={},
+                   compression='',
+                   error_feedback=False,
+                   hierarchical=False,
+                   accumulation_steps=1):
+  """Reduces the gradients across the replicas, and runs the optimizer step.
+
+  With `accumulation_steps` greater than 1, every call accounts for a
+  micro-batch, and only one call every `accumulation_steps` ones updates the
+  parameters, with the sum of the gradients of the micro-batches (to get their
+  mean, scale the loss by `1 / accumulation_steps`). The other calls add the
+  gradients to device resident buffers, and run the micro-batch graph with a
+  `mark_step()`, which is the same graph for all of them, so it is compiled
+  once. With `XLA_DONATE_BUFFERS=1` the buffers are updated in place. The
+  cross replica reduction only runs for the accumulated gradients.
+
+  Returns:
+    The value returned by the optimizer step, or None for the calls which only
+    accumulate the gradients.
+  """
+  if accumulation_steps > 1 and not _accumulate_gradients(
+      optimizer, accumulation_steps):
+    mark_step()
+    return None
+  reduce_gradients(
+      optimizer,
+      compression=compression,
+      error_feedback=error_feedback,
+      hierarchical=hierarchical)
   loss = optimizer.step(**optimizer_args)
+  _tag_optimizer_memory(optimizer)
   if barrier:
     mark_step()
   return loss